@@ -53,6 +53,34 @@ void TFE_OpReset(TFE_Op* op_to_reset, const char* op_or_function_name,
   }
 }
 
+void TFE_OpReplaceInputs(TFE_Op* op, TFE_TensorHandle** inputs,
+                         int num_inputs, TF_Status* status) {
+  tensorflow::ImmediateExecutionOperation* operation = tensorflow::unwrap(op);
+  absl::Span<tensorflow::ImmediateExecutionTensorHandle* const>
+      current_inputs = operation->GetInputs();
+  if (num_inputs != static_cast<int>(current_inputs.size())) {
+    status->status = tensorflow::errors::InvalidArgument(
+        "Expected ", current_inputs.size(), " inputs for ", operation->Name(),
+        " but got ", num_inputs);
+    return;
+  }
+  for (int i = 0; i < num_inputs; ++i) {
+    if (tensorflow::unwrap(inputs[i])->DataType() !=
+        current_inputs[i]->DataType()) {
+      status->status = tensorflow::errors::InvalidArgument(
+          "Input ", i, " of ", operation->Name(), " has dtype ",
+          tensorflow::DataTypeString(tensorflow::unwrap(inputs[i])->DataType()),
+          " instead of ",
+          tensorflow::DataTypeString(current_inputs[i]->DataType()));
+      return;
+    }
+  }
+  for (int i = 0; i < num_inputs; ++i) {
+    status->status = operation->SetInput(i, tensorflow::unwrap(inputs[i]));
+    if (!status->status.ok()) return;
+  }
+}
+
 void TFE_ContextEnableGraphCollection(TFE_Context* ctx) {
   tensorflow::unwrap(ctx)->SetShouldStoreGraphs(true);
 }
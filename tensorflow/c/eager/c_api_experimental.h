@@ -34,6 +34,19 @@ TF_CAPI_EXPORT extern void TFE_OpReset(TFE_Op* op_to_reset,
                                        const char* raw_device_name,
                                        TF_Status* status);
 
+// Replaces the inputs of `op` with the `num_inputs` handles of `inputs`, which
+// must have the same number and dtypes, and keeps its attributes and the device
+// it was placed on. This is for performance optimization of ops executed
+// repeatedly from the same call site: unlike resetting the op and adding its
+// attributes and inputs again, executing an op whose inputs were replaced
+// reuses the kernel of its previous execution without fingerprinting the op,
+// as long as its attributes aren't set and the inputs are placed like the
+// previous ones.
+TF_CAPI_EXPORT extern void TFE_OpReplaceInputs(TFE_Op* op,
+                                               TFE_TensorHandle** inputs,
+                                               int num_inputs,
+                                               TF_Status* status);
+
 // Enables only graph collection in RunMetadata on the functions executed from
 // this context.
 TF_CAPI_EXPORT extern void TFE_ContextEnableGraphCollection(TFE_Context* ctx);
@@ -368,6 +368,60 @@ void Executor_MatMul_CPU(bool async) {
 TEST(CAPI, Executor_MatMul_CPU) { Executor_MatMul_CPU(false); }
 TEST(CAPI, Executor_MatMul_CPUAsync) { Executor_MatMul_CPU(true); }
 
+TEST(CAPI, OpReplaceInputs) {
+  TF_Status* status = TF_NewStatus();
+  TFE_ContextOptions* opts = TFE_NewContextOptions();
+  TFE_Context* ctx = TFE_NewContext(opts, status);
+  CHECK_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  TFE_DeleteContextOptions(opts);
+
+  TFE_TensorHandle* m = TestMatrixTensorHandle(ctx);
+  TFE_Op* matmul = MatMulOp(ctx, m, m);
+  TFE_TensorHandle* retvals[1] = {nullptr};
+  int num_retvals = 1;
+  TFE_Execute(matmul, &retvals[0], &num_retvals, status);
+  ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  TFE_DeleteTensorHandle(retvals[0]);
+
+  // The op is executed again with other inputs, reusing its kernel.
+  float values[] = {1.0f, 0.0f, 0.0f, 2.0f};
+  int64_t dims[] = {2, 2};
+  TFE_TensorHandle* diagonal =
+      TestMatrixTensorHandleWithInput(ctx, values, dims, 2);
+  TFE_TensorHandle* inputs[] = {m, diagonal};
+  TFE_OpReplaceInputs(matmul, inputs, 2, status);
+  ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  num_retvals = 1;
+  TFE_Execute(matmul, &retvals[0], &num_retvals, status);
+  ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  TF_Tensor* t = TFE_TensorHandleResolve(retvals[0], status);
+  ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  TFE_DeleteTensorHandle(retvals[0]);
+  float product[4] = {0};
+  EXPECT_EQ(sizeof(product), TF_TensorByteSize(t));
+  memcpy(&product[0], TF_TensorData(t), TF_TensorByteSize(t));
+  TF_DeleteTensor(t);
+  EXPECT_EQ(1, product[0]);
+  EXPECT_EQ(4, product[1]);
+  EXPECT_EQ(3, product[2]);
+  EXPECT_EQ(8, product[3]);
+
+  // The inputs must keep their number and dtypes.
+  TFE_OpReplaceInputs(matmul, inputs, 1, status);
+  EXPECT_EQ(TF_INVALID_ARGUMENT, TF_GetCode(status));
+  TFE_TensorHandle* double_matrix = DoubleTestMatrixTensorHandle(ctx);
+  TFE_TensorHandle* double_inputs[] = {m, double_matrix};
+  TFE_OpReplaceInputs(matmul, double_inputs, 2, status);
+  EXPECT_EQ(TF_INVALID_ARGUMENT, TF_GetCode(status));
+
+  TFE_DeleteOp(matmul);
+  TFE_DeleteTensorHandle(double_matrix);
+  TFE_DeleteTensorHandle(diagonal);
+  TFE_DeleteTensorHandle(m);
+  TFE_DeleteContext(ctx);
+  TF_DeleteStatus(status);
+}
+
 void Deleter(void* data, size_t unused, void* tensor_handle) {
   TFE_DeleteTensorHandle(static_cast<TFE_TensorHandle*>(tensor_handle));
 }
@@ -62,9 +62,6 @@ void RegisterExecutionForCluster(
 // signature before  we attempt to compile it.
 constexpr int64_t kDefaultCompilationThreshold = 2;
 
-// Maximum number of ongoing compilations.
-constexpr int64_t kMaxNumOngoingCompilations = kNumAsyncDeviceCompilerThreads;
-
 }  // namespace
 
 DeviceCompilationProfiler::~DeviceCompilationProfiler() {
@@ -137,7 +134,7 @@ bool DeviceCompilationProfiler::ShouldCompileCluster(
   if (compile_mode == DeviceCompileMode::kLazy) {
     compile_threshold = kDefaultCompilationThreshold;
   } else if (compile_mode == DeviceCompileMode::kAsync) {
-    compile_threshold = 0;  // for now, always compile right away.
+    compile_threshold = async_compilation_threshold_;
   }
 
   if (compile_mode == DeviceCompileMode::kStrict) {
@@ -177,7 +174,7 @@ bool DeviceCompilationProfiler::ShouldCompileCluster(
 
   if (compile_mode == DeviceCompileMode::kAsync) {
     // Asynchronous compilation is enabled.
-    if (num_ongoing_compilations_ >= kMaxNumOngoingCompilations) {
+    if (num_ongoing_compilations_ >= max_num_ongoing_compilations_) {
       VLOG(2) << "Not asynchronously compiling cluster " << function.name()
               << " because of too many ongoing compilations.";
       return false;
@@ -29,6 +29,13 @@ namespace tensorflow {
 class DeviceCompilationProfiler : public ResourceBase {
  public:
   DeviceCompilationProfiler() = default;
+  // Compiles at most `max_num_ongoing_compilations` clusters asynchronously at
+  // once, and only once their signature was requested
+  // `async_compilation_threshold` times.
+  DeviceCompilationProfiler(int64_t max_num_ongoing_compilations,
+                            int64_t async_compilation_threshold)
+      : max_num_ongoing_compilations_(max_num_ongoing_compilations),
+        async_compilation_threshold_(async_compilation_threshold) {}
   ~DeviceCompilationProfiler() final;
 
   struct ClusterCompileStats {
@@ -84,6 +91,9 @@ class DeviceCompilationProfiler : public ResourceBase {
   std::string DebugString() const override;
 
  private:
+  const int64_t max_num_ongoing_compilations_ = kNumAsyncDeviceCompilerThreads;
+  const int64_t async_compilation_threshold_ = 0;
+
   mutable mutex mu_;
 
   // Maps cluster names to compilation statistics for said cluster.
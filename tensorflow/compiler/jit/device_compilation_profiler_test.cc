@@ -212,6 +212,36 @@ TEST(DeviceCompilationProfilerTest, ShouldCompileClusterAsync) {
       profiler->ShouldCompileCluster(function, DeviceCompileMode::kAsync, 0));
 }
 
+TEST(DeviceCompilationProfilerTest, ShouldCompileClusterAsyncConfigured) {
+  DeviceCompilationProfiler* profiler = new DeviceCompilationProfiler(
+      /*max_num_ongoing_compilations=*/1, /*async_compilation_threshold=*/2);
+  core::ScopedUnref profiler_ref(profiler);
+
+  NameAttrList function;
+  function.set_name("TestFunc");
+
+  // Should allow compilation since this is the first execution.
+  profiler->RegisterExecution(function);
+  EXPECT_TRUE(
+      profiler->ShouldCompileCluster(function, DeviceCompileMode::kAsync, 0));
+
+  // Shouldn't allow compilation until compilation has been requested at least
+  // twice.
+  profiler->RegisterExecution(function);
+  EXPECT_FALSE(
+      profiler->ShouldCompileCluster(function, DeviceCompileMode::kAsync, 1));
+  EXPECT_TRUE(
+      profiler->ShouldCompileCluster(function, DeviceCompileMode::kAsync, 2));
+
+  // Shouldn't allow compilation while another one is ongoing.
+  profiler->IncrementOngoingAsyncCompilations();
+  EXPECT_FALSE(
+      profiler->ShouldCompileCluster(function, DeviceCompileMode::kAsync, 2));
+  profiler->DecrementOngoingAsyncCompilations();
+  EXPECT_TRUE(
+      profiler->ShouldCompileCluster(function, DeviceCompileMode::kAsync, 2));
+}
+
 TEST(DeviceCompilationProfilerTest, ShouldCompileClusterLazy) {
   DeviceCompilationProfiler* profiler = new DeviceCompilationProfiler();
   core::ScopedUnref profiler_ref(profiler);
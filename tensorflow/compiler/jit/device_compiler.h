@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_JIT_DEVICE_COMPILER_H_
 #define TENSORFLOW_COMPILER_JIT_DEVICE_COMPILER_H_
 
+#include <algorithm>
 #include <memory>
 #include <numeric>
 #include <optional>
@@ -66,11 +67,13 @@ namespace tensorflow {
 template <typename ExecutableType, typename ClientType>
 class DeviceCompiler : public ResourceBase {
  public:
+  // Asynchronous compilations run on `num_async_compiler_threads` threads.
   DeviceCompiler(
       std::unique_ptr<DeviceExecutablePersistor<ExecutableType, ClientType>>
           persistor,
       std::unique_ptr<DeviceCompilerClient<ExecutableType, ClientType>>
-          compiler_client);
+          compiler_client,
+      int num_async_compiler_threads = kNumAsyncDeviceCompilerThreads);
   ~DeviceCompiler() override;
 
   enum class CompileScope {
@@ -201,13 +204,14 @@ DeviceCompiler<ExecutableType, ClientType>::DeviceCompiler(
     std::unique_ptr<DeviceExecutablePersistor<ExecutableType, ClientType>>
         persistor,
     std::unique_ptr<DeviceCompilerClient<ExecutableType, ClientType>>
-        compiler_client)
+        compiler_client,
+    int num_async_compiler_threads)
     : persistor_(std::move(persistor)),
       compiler_client_(std::move(compiler_client)) {
   cache_ = std::make_unique<DeviceCompilationCache<ExecutableType>>();
   async_compiler_threads_ = std::make_unique<tensorflow::thread::ThreadPool>(
       tensorflow::Env::Default(), "async_compiler_threads",
-      kNumAsyncDeviceCompilerThreads);
+      std::max(num_async_compiler_threads, 1));
 }
 
 template <typename ExecutableType, typename ClientType>
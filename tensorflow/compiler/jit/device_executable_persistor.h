@@ -16,22 +16,70 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_JIT_DEVICE_EXECUTABLE_PERSISTOR_H_
 #define TENSORFLOW_COMPILER_JIT_DEVICE_EXECUTABLE_PERSISTOR_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <map>
 #include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/strip.h"
 #include "tensorflow/compiler/jit/xla_compilation_cache.pb.h"
 #include "tensorflow/compiler/jit/xla_device_compiler_client.h"
 #include "tensorflow/compiler/tf2xla/xla_compiler.h"
+#include "tensorflow/compiler/xla/debug_options_flags.h"
 #include "tensorflow/compiler/xla/service/hlo.pb.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/core/framework/device.h"
 #include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/public/version.h"
 #include "tensorflow/tsl/platform/statusor.h"
 
 namespace tensorflow {
+namespace device_executable_persistor_internal {
+
+// The suffix of the empty file next to a cache entry, whose modification time
+// records when the entry was last read.
+constexpr char kLastUsedSuffix[] = ".last_used";
+
+// Returns the path of the file recording when the entry at `file_path` was
+// last read.
+inline std::string LastUsedFilePath(absl::string_view file_path) {
+  return absl::StrCat(file_path, kLastUsedSuffix);
+}
+
+// Returns a fingerprint of the TensorFlow version, the XLA flags and
+// `device_description`.
+inline uint64 CompilerFingerprint(absl::string_view device_description) {
+  std::string debug_options;
+  SerializeToStringDeterministic(xla::GetDebugOptionsFromFlags(),
+                                 &debug_options);
+  return Fingerprint64(absl::StrCat(TF_VERSION_STRING, "\n", debug_options,
+                                    "\n", device_description));
+}
+
+// Writes `entry` to a temporary file that is then renamed to `file_path`, so
+// that the processes sharing the cache never read a partially written entry.
+inline Status WriteEntryAtomically(Env* env, const std::string& file_path,
+                                   const XlaSerializedCacheEntry& entry) {
+  const std::string temp_file_path =
+      absl::StrCat(file_path, ".tmp", random::New64());
+  TF_RETURN_IF_ERROR(WriteBinaryProto(env, temp_file_path, entry));
+  Status status = env->RenameFile(temp_file_path, file_path);
+  if (!status.ok()) env->DeleteFile(temp_file_path).IgnoreError();
+  return status;
+}
+
+}  // namespace device_executable_persistor_internal
 
 // Offers a way to persist and/or load compiled `ExecutableType`s along with the
 // corresponding HLO (`CompilationResult`) to/from `persistent_cache_directory`
@@ -59,6 +107,23 @@ class DeviceExecutablePersistor {
 
     // The cache persistence prefix to use if serializing/deserialzing entries.
     std::string persistence_prefix;
+
+    // Describes the device the executables are compiled for (e.g. its model
+    // and compute capability), so that processes running on different devices
+    // can share a cache directory.
+    std::string device_description;
+
+    // If positive, the least recently used entries of
+    // `persistent_cache_directory` are deleted when the entries take more than
+    // this size in total.
+    int64_t persistent_cache_max_size_bytes = 0;
+
+    // If non-empty, a second tier of the cache, e.g. on an object storage
+    // file system ("gs://...") shared by all the workers of a job. Entries
+    // missing from `persistent_cache_directory` are loaded from there and
+    // copied to `persistent_cache_directory`, and new entries are also saved
+    // there.
+    std::string remote_cache_directory;
   };
 
   DeviceExecutablePersistor(const Config& config,
@@ -94,6 +159,10 @@ class DeviceExecutablePersistor {
     return persistent_cache_directory_;
   }
 
+  // Fingerprint of the TensorFlow version, the XLA flags and the device
+  // description, which all affect the compiled executables.
+  uint64 compiler_fingerprint() const { return compiler_fingerprint_; }
+
  private:
   // Returns a cache key proto that identifies an entry in the compilation
   // cache.
@@ -108,12 +177,16 @@ class DeviceExecutablePersistor {
       DeviceCompilerClient<ExecutableType, ClientType>* compiler_client) const;
 
   // Saves the cache entry in the file directory supplied during the
-  // construction of this class. Overwrites existing entries.
+  // construction of this class, and in the remote cache directory if it was
+  // supplied and doesn't have the entry yet. Overwrites existing entries.
   Status SaveSerializedEntry(const XlaSerializedCacheEntry& entry) const;
 
+  // Saves the cache entry in `persistent_cache_directory_` only.
+  Status SaveLocalSerializedEntry(const XlaSerializedCacheEntry& entry) const;
+
   // Tries to read a cache entry given a `key` by searching the file directory
-  // supplied during the construction of this class. Returns std::nullopt if no
-  // cache entry is found.
+  // supplied during the construction of this class, and then the remote cache
+  // directory. Returns std::nullopt if no cache entry is found.
   StatusOr<std::optional<XlaSerializedCacheEntry>> TryToReadSerializedEntry(
       const XlaSerializedCacheKey& key) const;
 
@@ -124,7 +197,13 @@ class DeviceExecutablePersistor {
 
   std::string XlaSerializedCacheKeyToString(
       const XlaSerializedCacheKey& key) const;
-  std::string GetFilePath(const XlaSerializedCacheKey& key) const;
+  std::string GetFilePath(const XlaSerializedCacheKey& key,
+                          const std::string& directory) const;
+
+  // Deletes the least recently used entries of `persistent_cache_directory_`
+  // other than `kept_file_path` until they take at most
+  // `persistent_cache_max_size_bytes_`.
+  Status EvictEntries(const std::string& kept_file_path) const;
 
   const DeviceType device_type_;
   const bool disable_strict_signature_checks_;
@@ -133,6 +212,9 @@ class DeviceExecutablePersistor {
   // If non-empty, JIT-compiled executables are saved to and loaded from the
   // specified file system directory path.
   const std::string persistent_cache_directory_;
+  const int64_t persistent_cache_max_size_bytes_;
+  const std::string remote_cache_directory_;
+  const uint64 compiler_fingerprint_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(DeviceExecutablePersistor);
 };
@@ -144,7 +226,12 @@ DeviceExecutablePersistor<ExecutableType, ClientType>::
     : device_type_(device_type),
       disable_strict_signature_checks_(config.disable_strict_signature_checks),
       persistence_prefix_(config.persistence_prefix),
-      persistent_cache_directory_(config.persistent_cache_directory) {}
+      persistent_cache_directory_(config.persistent_cache_directory),
+      persistent_cache_max_size_bytes_(config.persistent_cache_max_size_bytes),
+      remote_cache_directory_(config.remote_cache_directory),
+      compiler_fingerprint_(
+          device_executable_persistor_internal::CompilerFingerprint(
+              config.device_description)) {}
 
 template <typename ExecutableType, typename ClientType>
 std::string DeviceExecutablePersistor<ExecutableType, ClientType>::
@@ -154,15 +241,16 @@ std::string DeviceExecutablePersistor<ExecutableType, ClientType>::
       key.prefix(), key.prefix().empty() ? "" : kXlaSerializedCacheKeySeparator,
       key.signature_fingerprint(), kXlaSerializedCacheKeySeparator,
       key.cluster_fingerprint(), kXlaSerializedCacheKeySeparator,
-      key.device_type());
+      key.device_type(), kXlaSerializedCacheKeySeparator,
+      key.compiler_fingerprint());
 }
 
 template <typename ExecutableType, typename ClientType>
 std::string DeviceExecutablePersistor<ExecutableType, ClientType>::GetFilePath(
-    const XlaSerializedCacheKey& key) const {
+    const XlaSerializedCacheKey& key, const std::string& directory) const {
   const std::string file_name =
       absl::StrCat(XlaSerializedCacheKeyToString(key), ".pb");
-  return io::JoinPath(persistent_cache_directory_, file_name);
+  return io::JoinPath(directory, file_name);
 }
 
 template <typename ExecutableType, typename ClientType>
@@ -175,6 +263,7 @@ DeviceExecutablePersistor<ExecutableType, ClientType>::BuildSerializedCacheKey(
       DeterministicProtoHash64(hlo_module));
   serialized_cache_key.set_device_type(device_type().type_string());
   serialized_cache_key.set_prefix(persistence_prefix());
+  serialized_cache_key.set_compiler_fingerprint(compiler_fingerprint());
   return serialized_cache_key;
 }
 
@@ -183,13 +272,41 @@ StatusOr<std::optional<XlaSerializedCacheEntry>>
 DeviceExecutablePersistor<ExecutableType, ClientType>::TryToReadSerializedEntry(
     const XlaSerializedCacheKey& key) const {
   Env* env = Env::Default();
-  const std::string file_path = GetFilePath(key);
-  if (!env->FileExists(file_path).ok()) {
-    return StatusOr<std::optional<XlaSerializedCacheEntry>>(std::nullopt);
+  XlaSerializedCacheEntry entry;
+  const std::string file_path = GetFilePath(key, persistent_cache_directory_);
+  if (env->FileExists(file_path).ok()) {
+    TF_RETURN_IF_ERROR(ReadTextOrBinaryProto(env, file_path, &entry));
+    if (persistent_cache_max_size_bytes_ > 0) {
+      // Marks the entry as recently used for the eviction, without writing
+      // the entry itself again.
+      Status status = WriteStringToFile(
+          env,
+          device_executable_persistor_internal::LastUsedFilePath(file_path),
+          "");
+      if (!status.ok()) {
+        VLOG(1) << "Failed to mark cache entry " << file_path
+                << " as used: " << status;
+      }
+    }
+    return std::optional<XlaSerializedCacheEntry>(entry);
   }
 
-  XlaSerializedCacheEntry entry;
-  TF_RETURN_IF_ERROR(ReadTextOrBinaryProto(env, file_path, &entry));
+  if (remote_cache_directory_.empty()) {
+    return StatusOr<std::optional<XlaSerializedCacheEntry>>(std::nullopt);
+  }
+  const std::string remote_file_path =
+      GetFilePath(key, remote_cache_directory_);
+  if (!env->FileExists(remote_file_path).ok()) {
+    return StatusOr<std::optional<XlaSerializedCacheEntry>>(std::nullopt);
+  }
+  TF_RETURN_IF_ERROR(ReadTextOrBinaryProto(env, remote_file_path, &entry));
+  // The remote tier is typically slower, so the entry is copied locally for
+  // the next processes.
+  Status status = SaveLocalSerializedEntry(entry);
+  if (!status.ok()) {
+    VLOG(1) << "Failed to copy remote cache entry " << remote_file_path << ": "
+            << status;
+  }
   return std::optional<XlaSerializedCacheEntry>(entry);
 }
 
@@ -231,10 +348,119 @@ template <typename ExecutableType, typename ClientType>
 Status
 DeviceExecutablePersistor<ExecutableType, ClientType>::SaveSerializedEntry(
     const XlaSerializedCacheEntry& entry) const {
+  TF_RETURN_IF_ERROR(SaveLocalSerializedEntry(entry));
+  if (remote_cache_directory_.empty()) {
+    return OkStatus();
+  }
+
+  Env* env = Env::Default();
+  const std::string remote_file_path =
+      GetFilePath(entry.key(), remote_cache_directory_);
+  // Another worker compiling the same cluster has most likely saved the entry
+  // already.
+  if (env->FileExists(remote_file_path).ok()) {
+    return OkStatus();
+  }
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(remote_cache_directory_));
+  return device_executable_persistor_internal::WriteEntryAtomically(
+      env, remote_file_path, entry);
+}
+
+template <typename ExecutableType, typename ClientType>
+Status DeviceExecutablePersistor<ExecutableType, ClientType>::
+    SaveLocalSerializedEntry(const XlaSerializedCacheEntry& entry) const {
   Env* env = Env::Default();
   TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(persistent_cache_directory_));
-  const std::string file_path = GetFilePath(entry.key());
-  return WriteBinaryProto(env, file_path, entry);
+  const std::string file_path =
+      GetFilePath(entry.key(), persistent_cache_directory_);
+  TF_RETURN_IF_ERROR(device_executable_persistor_internal::WriteEntryAtomically(
+      env, file_path, entry));
+  if (persistent_cache_max_size_bytes_ > 0) {
+    TF_RETURN_IF_ERROR(EvictEntries(file_path));
+  }
+  return OkStatus();
+}
+
+template <typename ExecutableType, typename ClientType>
+Status DeviceExecutablePersistor<ExecutableType, ClientType>::EvictEntries(
+    const std::string& kept_file_path) const {
+  Env* env = Env::Default();
+  std::vector<std::string> children;
+  TF_RETURN_IF_ERROR(env->GetChildren(persistent_cache_directory_, &children));
+
+  struct CachedFile {
+    std::string path;
+    int64_t size;
+    // When the entry was last written or read.
+    int64_t last_used_nsec;
+  };
+  std::vector<CachedFile> files;
+  // The paths of the marker files of the entries read since they were
+  // written, by entry path.
+  std::map<std::string, std::string> last_used_paths;
+  int64_t total_size = 0;
+  for (const std::string& child : children) {
+    if (!absl::StartsWith(child, persistence_prefix_)) {
+      continue;
+    }
+    const std::string path = io::JoinPath(persistent_cache_directory_, child);
+    absl::string_view entry_path = path;
+    if (absl::ConsumeSuffix(
+            &entry_path,
+            device_executable_persistor_internal::kLastUsedSuffix)) {
+      last_used_paths[std::string(entry_path)] = path;
+      continue;
+    }
+    // Skips the temporary files of the entries being written.
+    if (!absl::EndsWith(child, ".pb")) {
+      continue;
+    }
+    FileStatistics stats;
+    // The file may have been evicted by another process in the meantime.
+    if (!env->Stat(path, &stats).ok() || stats.is_directory) {
+      continue;
+    }
+    files.push_back({path, stats.length, stats.mtime_nsec});
+    total_size += stats.length;
+  }
+  for (CachedFile& file : files) {
+    auto it = last_used_paths.find(file.path);
+    if (it == last_used_paths.end()) continue;
+    FileStatistics stats;
+    if (env->Stat(it->second, &stats).ok()) {
+      file.last_used_nsec = std::max(file.last_used_nsec, stats.mtime_nsec);
+    }
+    last_used_paths.erase(it);
+  }
+  // The markers left are those of entries evicted by other processes.
+  for (const auto& [entry_path, last_used_path] : last_used_paths) {
+    env->DeleteFile(last_used_path).IgnoreError();
+  }
+
+  // The modification times may only have a resolution of seconds, so the
+  // entry just saved is kept explicitly, even if it's larger than the limit.
+  std::sort(files.begin(), files.end(),
+            [](const CachedFile& a, const CachedFile& b) {
+              return a.last_used_nsec < b.last_used_nsec;
+            });
+  for (const CachedFile& file : files) {
+    if (total_size <= persistent_cache_max_size_bytes_) {
+      break;
+    }
+    if (file.path == kept_file_path) {
+      continue;
+    }
+    Status status = env->DeleteFile(file.path);
+    if (!status.ok() && !errors::IsNotFound(status)) {
+      return status;
+    }
+    env->DeleteFile(
+           device_executable_persistor_internal::LastUsedFilePath(file.path))
+        .IgnoreError();
+    VLOG(1) << "Evicted cache entry " << file.path;
+    total_size -= file.size;
+  }
+  return OkStatus();
 }
 
 template <typename ExecutableType, typename ClientType>
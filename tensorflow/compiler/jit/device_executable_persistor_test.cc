@@ -146,7 +146,8 @@ std::string GetFilePath(XlaSerializedCacheKey key,
       key.prefix(), key.prefix().empty() ? "" : kXlaSerializedCacheKeySeparator,
       key.signature_fingerprint(), kXlaSerializedCacheKeySeparator,
       key.cluster_fingerprint(), kXlaSerializedCacheKeySeparator,
-      key.device_type(), ".pb");
+      key.device_type(), kXlaSerializedCacheKeySeparator,
+      key.compiler_fingerprint(), ".pb");
 
   return io::JoinPath(persistent_cache_dir, file_name);
 }
@@ -162,13 +163,15 @@ StatusOr<XlaSerializedCacheEntry> ReadCacheEntryFromFile(
 XlaSerializedCacheKey CreateCacheKey(
     uint64 signature_hash,
     const XlaCompiler::CompilationResult& compilation_result,
-    const DeviceType& device_type, const std::string& persistence_prefix) {
+    const DeviceType& device_type, const std::string& persistence_prefix,
+    uint64 compiler_fingerprint) {
   XlaSerializedCacheKey key;
   key.set_signature_fingerprint(signature_hash);
   key.set_cluster_fingerprint(
       DeterministicProtoHash64(compilation_result.computation->proto()));
   key.set_device_type(device_type.type_string());
   key.set_prefix(persistence_prefix);
+  key.set_compiler_fingerprint(compiler_fingerprint);
   return key;
 }
 
@@ -187,7 +190,8 @@ TEST_F(DeviceExecutionPersistorTest, PersistCacheDirNotSet) {
 
   auto key =
       CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
-                     persistor.device_type(), persistor.persistence_prefix());
+                     persistor.device_type(), persistor.persistence_prefix(),
+                     persistor.compiler_fingerprint());
   auto entry = ReadCacheEntryFromFile(key, "");
   EXPECT_FALSE(entry.ok());
 }
@@ -210,7 +214,8 @@ TEST_F(DeviceExecutionPersistorTest, PersistSerializeAlreadyBuiltExecutable) {
 
   auto key =
       CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
-                     persistor.device_type(), persistor.persistence_prefix());
+                     persistor.device_type(), persistor.persistence_prefix(),
+                     persistor.compiler_fingerprint());
   TF_ASSERT_OK_AND_ASSIGN(auto entry, ReadCacheEntryFromFile(key, cache_dir_));
 
   EXPECT_EQ(entry.executable(), serialized_executable_);
@@ -236,7 +241,8 @@ TEST_F(DeviceExecutionPersistorTest, PersistBuildSerializedExecutable) {
 
   auto key =
       CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
-                     persistor.device_type(), persistor.persistence_prefix());
+                     persistor.device_type(), persistor.persistence_prefix(),
+                     persistor.compiler_fingerprint());
   TF_ASSERT_OK_AND_ASSIGN(auto entry, ReadCacheEntryFromFile(key, cache_dir_));
 
   EXPECT_EQ(entry.executable(), serialized_executable_);
@@ -341,10 +347,12 @@ TEST_F(DeviceExecutionPersistorTest, LoadSerializedKeyMismatch) {
 
   auto key1 =
       CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
-                     persistor.device_type(), persistor.persistence_prefix());
+                     persistor.device_type(), persistor.persistence_prefix(),
+                     persistor.compiler_fingerprint());
   auto key2 =
       CreateCacheKey(/*signature_hash=*/456, compilation_result_add_,
-                     persistor.device_type(), persistor.persistence_prefix());
+                     persistor.device_type(), persistor.persistence_prefix(),
+                     persistor.compiler_fingerprint());
   // File for key2 contains the same content as key1.
   TF_ASSERT_OK(Env::Default()->CopyFile(
       GetFilePath(key1, persistor.persistent_cache_directory()),
@@ -375,10 +383,12 @@ TEST_F(DeviceExecutionPersistorTest, LoadSerializedHloMismatch) {
 
   auto key1 =
       CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
-                     persistor.device_type(), persistor.persistence_prefix());
+                     persistor.device_type(), persistor.persistence_prefix(),
+                     persistor.compiler_fingerprint());
   auto key2 =
       CreateCacheKey(/*signature_hash=*/123, compilation_result_mul,
-                     persistor.device_type(), persistor.persistence_prefix());
+                     persistor.device_type(), persistor.persistence_prefix(),
+                     persistor.compiler_fingerprint());
 
   // Read serialized entry corresponding to key1.
   XlaSerializedCacheEntry entry;
@@ -417,10 +427,12 @@ TEST_F(DeviceExecutionPersistorTest, LoadStrictChecksDisabled) {
 
   auto key1 =
       CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
-                     persistor.device_type(), persistor.persistence_prefix());
+                     persistor.device_type(), persistor.persistence_prefix(),
+                     persistor.compiler_fingerprint());
   auto key2 =
       CreateCacheKey(/*signature_hash=*/123, compilation_result_mul,
-                     persistor.device_type(), persistor.persistence_prefix());
+                     persistor.device_type(), persistor.persistence_prefix(),
+                     persistor.compiler_fingerprint());
 
   // Read serialized entry corresponding to key1.
   XlaSerializedCacheEntry entry;
@@ -455,7 +467,8 @@ TEST_F(DeviceExecutionPersistorTest, LoadSerializedExecutableEmpty) {
 
   auto key =
       CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
-                     persistor.device_type(), persistor.persistence_prefix());
+                     persistor.device_type(), persistor.persistence_prefix(),
+                     persistor.compiler_fingerprint());
 
   // Read serialized entry.
   XlaSerializedCacheEntry entry;
@@ -479,5 +492,175 @@ TEST_F(DeviceExecutionPersistorTest, LoadSerializedExecutableEmpty) {
               testing::StatusIs(error::INVALID_ARGUMENT));
 }
 
+TEST_F(DeviceExecutionPersistorTest, DeviceDescriptionChangesKey) {
+  XlaDeviceExecutablePersistor::Config config(
+      /*persistent_cache_directory=*/cache_dir_,
+      /*disable_strict_signature_checks=*/false,
+      /*persistence_prefix=*/"xla_device");
+  config.device_description = "device_a";
+  XlaDeviceExecutablePersistor persistor_a(config,
+                                           DefaultOptions().device_type);
+  config.device_description = "device_b";
+  XlaDeviceExecutablePersistor persistor_b(config,
+                                           DefaultOptions().device_type);
+  EXPECT_NE(persistor_a.compiler_fingerprint(),
+            persistor_b.compiler_fingerprint());
+
+  MockCompilerClient mock_client;
+  EXPECT_CALL(mock_client, SerializeExecutable(_))
+      .WillOnce(Return(StatusOr<std::string>(serialized_executable_)));
+  TF_ASSERT_OK_AND_ASSIGN(auto executable, BuildSampleExecutable());
+  TF_ASSERT_OK(persistor_a.TryToPersistExecutable(
+      /*signature_hash=*/123, "signature_string", DefaultOptions(),
+      compilation_result_add_, *executable, &mock_client));
+
+  // The executable compiled for device_a isn't loaded for device_b.
+  auto loaded_executable = persistor_b.TryToLoadExecutable(
+      /*signature_hash=*/123, "signature_string", DefaultOptions(),
+      compilation_result_add_, &mock_client);
+  EXPECT_FALSE(loaded_executable.has_value());
+}
+
+TEST_F(DeviceExecutionPersistorTest, LoadFromRemoteCache) {
+  const std::string remote_dir = io::JoinPath(cache_dir_, "remote");
+  XlaDeviceExecutablePersistor::Config config(
+      /*persistent_cache_directory=*/io::JoinPath(cache_dir_, "worker_1"),
+      /*disable_strict_signature_checks=*/false,
+      /*persistence_prefix=*/"xla");
+  config.remote_cache_directory = remote_dir;
+  XlaDeviceExecutablePersistor persistor_1(config,
+                                           DefaultOptions().device_type);
+  config.persistent_cache_directory = io::JoinPath(cache_dir_, "worker_2");
+  XlaDeviceExecutablePersistor persistor_2(config,
+                                           DefaultOptions().device_type);
+
+  MockCompilerClient mock_client;
+  EXPECT_CALL(mock_client, SerializeExecutable(_))
+      .WillOnce(Return(StatusOr<std::string>(serialized_executable_)));
+  TF_ASSERT_OK_AND_ASSIGN(auto executable, BuildSampleExecutable());
+  TF_ASSERT_OK(persistor_1.TryToPersistExecutable(
+      /*signature_hash=*/123, "signature_string", DefaultOptions(),
+      compilation_result_add_, *executable, &mock_client));
+
+  auto key = CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
+                            persistor_2.device_type(),
+                            persistor_2.persistence_prefix(),
+                            persistor_2.compiler_fingerprint());
+  TF_ASSERT_OK(Env::Default()->FileExists(GetFilePath(key, remote_dir)));
+  EXPECT_FALSE(
+      Env::Default()
+          ->FileExists(
+              GetFilePath(key, persistor_2.persistent_cache_directory()))
+          .ok());
+
+  TF_ASSERT_OK_AND_ASSIGN(executable, BuildSampleExecutable());
+  EXPECT_CALL(mock_client, LoadExecutable(_, _, serialized_executable_))
+      .WillOnce(Return(ByMove(std::move(executable))));
+  auto loaded_executable = persistor_2.TryToLoadExecutable(
+      /*signature_hash=*/123, "signature_string", DefaultOptions(),
+      compilation_result_add_, &mock_client);
+  ASSERT_TRUE(loaded_executable.has_value());
+  TF_EXPECT_OK(loaded_executable->status());
+
+  // The remote entry is copied to the local cache directory.
+  TF_EXPECT_OK(Env::Default()->FileExists(
+      GetFilePath(key, persistor_2.persistent_cache_directory())));
+}
+
+TEST_F(DeviceExecutionPersistorTest, EvictLeastRecentlyUsedEntries) {
+  XlaDeviceExecutablePersistor::Config config(
+      /*persistent_cache_directory=*/io::JoinPath(cache_dir_, "bounded"),
+      /*disable_strict_signature_checks=*/false,
+      /*persistence_prefix=*/"xla");
+  // Leaves room for a single entry.
+  config.persistent_cache_max_size_bytes = 1;
+  XlaDeviceExecutablePersistor persistor(config, DefaultOptions().device_type);
+
+  MockCompilerClient mock_client;
+  EXPECT_CALL(mock_client, SerializeExecutable(_))
+      .WillRepeatedly(Return(StatusOr<std::string>(serialized_executable_)));
+  TF_ASSERT_OK_AND_ASSIGN(auto executable, BuildSampleExecutable());
+  TF_ASSERT_OK(persistor.TryToPersistExecutable(
+      /*signature_hash=*/123, "signature_string", DefaultOptions(),
+      compilation_result_add_, *executable, &mock_client));
+  TF_ASSERT_OK(persistor.TryToPersistExecutable(
+      /*signature_hash=*/456, "other_signature_string", DefaultOptions(),
+      compilation_result_add_, *executable, &mock_client));
+
+  auto key_1 = CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
+                              persistor.device_type(),
+                              persistor.persistence_prefix(),
+                              persistor.compiler_fingerprint());
+  auto key_2 = CreateCacheKey(/*signature_hash=*/456, compilation_result_add_,
+                              persistor.device_type(),
+                              persistor.persistence_prefix(),
+                              persistor.compiler_fingerprint());
+  EXPECT_FALSE(Env::Default()
+                   ->FileExists(GetFilePath(
+                       key_1, persistor.persistent_cache_directory()))
+                   .ok());
+  TF_EXPECT_OK(Env::Default()->FileExists(
+      GetFilePath(key_2, persistor.persistent_cache_directory())));
+}
+
+TEST_F(DeviceExecutionPersistorTest, EvictEntriesNotReadRecently) {
+  XlaDeviceExecutablePersistor::Config config(
+      /*persistent_cache_directory=*/io::JoinPath(cache_dir_, "read"),
+      /*disable_strict_signature_checks=*/false,
+      /*persistence_prefix=*/"xla");
+  XlaDeviceExecutablePersistor unbounded_persistor(
+      config, DefaultOptions().device_type);
+  auto file_path = [&](uint64 signature_hash) {
+    return GetFilePath(
+        CreateCacheKey(signature_hash, compilation_result_add_,
+                       unbounded_persistor.device_type(),
+                       unbounded_persistor.persistence_prefix(),
+                       unbounded_persistor.compiler_fingerprint()),
+        unbounded_persistor.persistent_cache_directory());
+  };
+  // The modification times of the entries and of their markers must differ.
+  auto wait = []() { Env::Default()->SleepForMicroseconds(10 * 1000); };
+
+  MockCompilerClient mock_client;
+  EXPECT_CALL(mock_client, SerializeExecutable(_))
+      .WillRepeatedly(Return(StatusOr<std::string>(serialized_executable_)));
+  TF_ASSERT_OK_AND_ASSIGN(auto executable, BuildSampleExecutable());
+  TF_ASSERT_OK(unbounded_persistor.TryToPersistExecutable(
+      /*signature_hash=*/456, "signature_string", DefaultOptions(),
+      compilation_result_add_, *executable, &mock_client));
+  wait();
+  TF_ASSERT_OK(unbounded_persistor.TryToPersistExecutable(
+      /*signature_hash=*/457, "other_signature_string", DefaultOptions(),
+      compilation_result_add_, *executable, &mock_client));
+
+  // Leaves room for two entries, which have the same size.
+  FileStatistics stats;
+  TF_ASSERT_OK(Env::Default()->Stat(file_path(456), &stats));
+  config.persistent_cache_max_size_bytes = 2 * stats.length;
+  XlaDeviceExecutablePersistor persistor(config, DefaultOptions().device_type);
+
+  // Reading the older entry makes it the most recently used one.
+  wait();
+  TF_ASSERT_OK_AND_ASSIGN(executable, BuildSampleExecutable());
+  EXPECT_CALL(mock_client, LoadExecutable(_, _, serialized_executable_))
+      .WillOnce(Return(ByMove(std::move(executable))));
+  auto loaded_executable = persistor.TryToLoadExecutable(
+      /*signature_hash=*/456, "signature_string", DefaultOptions(),
+      compilation_result_add_, &mock_client);
+  ASSERT_TRUE(loaded_executable.has_value());
+  TF_ASSERT_OK(loaded_executable->status());
+  TF_EXPECT_OK(Env::Default()->FileExists(
+      device_executable_persistor_internal::LastUsedFilePath(file_path(456))));
+
+  wait();
+  TF_ASSERT_OK_AND_ASSIGN(executable, BuildSampleExecutable());
+  TF_ASSERT_OK(persistor.TryToPersistExecutable(
+      /*signature_hash=*/458, "third_signature_string", DefaultOptions(),
+      compilation_result_add_, *executable, &mock_client));
+  TF_EXPECT_OK(Env::Default()->FileExists(file_path(456)));
+  EXPECT_FALSE(Env::Default()->FileExists(file_path(457)).ok());
+  TF_EXPECT_OK(Env::Default()->FileExists(file_path(458)));
+}
+
 }  // namespace
 }  // namespace tensorflow
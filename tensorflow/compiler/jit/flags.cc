@@ -154,7 +154,34 @@ void AppendMarkForCompilationPassFlagsInternal(std::vector<Flag>* flag_list) {
       Flag("tf_xla_persistent_cache_prefix",
            &mark_for_compilation_flags->tf_xla_persistent_cache_prefix,
            "Specifies the persistance cache prefix. Default is "
-           "\"xla_compile_cache\"")};
+           "\"xla_compile_cache\""),
+      Flag("tf_xla_persistent_cache_max_size_bytes",
+           &mark_for_compilation_flags->tf_xla_persistent_cache_max_size_bytes,
+           "If positive, the least recently used entries of the persistent "
+           "cache directory are evicted when the entries take more than this "
+           "size in total. Unbounded by default."),
+      Flag("tf_xla_persistent_cache_remote_directory",
+           &mark_for_compilation_flags
+                ->tf_xla_persistent_cache_remote_directory,
+           "If non-empty, a directory shared by all the processes of a job, "
+           "e.g. on an object storage file system, that the entries missing "
+           "from the persistent cache directory are loaded from and new "
+           "entries are saved to. Empty by default."),
+      Flag("tf_xla_min_parameterized_constant_size_bytes",
+           &mark_for_compilation_flags
+                ->tf_xla_min_parameterized_constant_size_bytes,
+           "If positive, the constants of at least this size which don't need "
+           "to be compile-time constants are passed to the clusters as "
+           "arguments instead of being compiled in, so that refreshing their "
+           "values doesn't trigger recompilations. Disabled by default."),
+      Flag("tf_xla_cost_aware_clustering_runs",
+           &mark_for_compilation_flags->tf_xla_cost_aware_clustering_runs,
+           "If positive, auto-clustering estimates the gain of each cluster "
+           "over this many runs and the cost of its expected compilations, "
+           "given the dimensions of its inputs that aren't known statically, "
+           "and doesn't compile the clusters whose gain doesn't cover the "
+           "cost. The estimates of every cluster are logged. Disabled by "
+           "default.")};
   flag_list->insert(flag_list->end(), new_flags.begin(), new_flags.end());
 }
 
@@ -210,6 +237,10 @@ void AllocateAndParseFlags() {
   mark_for_compilation_flags->tf_xla_disable_strict_signature_checks = false;
   mark_for_compilation_flags->tf_xla_persistent_cache_prefix =
       "xla_compile_cache";
+  mark_for_compilation_flags->tf_xla_persistent_cache_max_size_bytes = 0;
+  mark_for_compilation_flags->tf_xla_persistent_cache_remote_directory = "";
+  mark_for_compilation_flags->tf_xla_min_parameterized_constant_size_bytes = 0;
+  mark_for_compilation_flags->tf_xla_cost_aware_clustering_runs = 0;
 
   device_flags = new XlaDeviceFlags;
   device_flags->tf_xla_compile_on_demand = false;
@@ -218,7 +249,10 @@ void AllocateAndParseFlags() {
   ops_flags = new XlaOpsCommonFlags;
   ops_flags->tf_xla_always_defer_compilation = false;
   ops_flags->tf_xla_async_compilation = false;
+  ops_flags->tf_xla_max_concurrent_async_compilations = 10;
+  ops_flags->tf_xla_async_compilation_threshold = 0;
   ops_flags->tf_xla_use_device_api = false;
+  ops_flags->tf_xla_shape_buckets = "";
 
   // The `enable_mlir_bridge` flag allows the user to explicitly request that
   // their program is (or isn't) compiled using the MLIR-based TF-to-XLA bridge.
@@ -271,9 +305,24 @@ void AllocateAndParseFlags() {
             "When lazy compilation is enabled, asynchronous compilation starts "
             "the cluster compilation in the background, and the fallback path "
             "is executed until the compilation has finished."),
+       Flag("tf_xla_max_concurrent_async_compilations",
+            &ops_flags->tf_xla_max_concurrent_async_compilations,
+            "The maximum number of clusters compiled asynchronously at once. "
+            "The new signatures beyond it keep taking the fallback path."),
+       Flag("tf_xla_async_compilation_threshold",
+            &ops_flags->tf_xla_async_compilation_threshold,
+            "The number of times a new signature takes the fallback path "
+            "before it is compiled asynchronously."),
        Flag("tf_xla_use_device_api", &ops_flags->tf_xla_use_device_api,
             "If true, uses the Device API (PjRt) for single device compilation."
             " Defaults to false."),
+       Flag("tf_xla_shape_buckets", &ops_flags->tf_xla_shape_buckets,
+            "If not empty, pads the leading dimension of the inputs of the "
+            "clusters to these buckets, either \"pow2\" or a comma-separated "
+            "list of increasing sizes, and slices the outputs back, so that "
+            "inputs of many sizes share a few compilations. Only applies to "
+            "the clusters whose output rows only depend on the same rows of "
+            "their inputs."),
 
        Flag("tf_mlir_enable_mlir_bridge", &enable_mlir_bridge,
             "Enables experimental MLIR-Based TensorFlow Compiler Bridge.",
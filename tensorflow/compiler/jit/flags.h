@@ -101,6 +101,25 @@ struct MarkForCompilationPassFlags {
 
   // Specifies the persistance cache prefix. Default is "xla_compile_cache"
   string tf_xla_persistent_cache_prefix;
+
+  // If positive, the least recently used entries of the persistent cache
+  // directory are evicted when the entries take more than this size in total.
+  int64_t tf_xla_persistent_cache_max_size_bytes;
+
+  // If non-empty, a remote directory (e.g. on an object storage file system)
+  // shared by all the processes of a job, that the entries missing from the
+  // persistent cache directory are loaded from and new entries are saved to.
+  std::string tf_xla_persistent_cache_remote_directory;
+
+  // If positive, the constants of at least this size which don't need to be
+  // compile-time constants are left out of the clusters and passed to them as
+  // arguments, so that changing the values of these constants doesn't trigger
+  // a recompilation.
+  int64_t tf_xla_min_parameterized_constant_size_bytes;
+
+  // If positive, the clusters whose estimated gain over this many runs doesn't
+  // cover the estimated cost of their expected compilations are not compiled.
+  int64_t tf_xla_cost_aware_clustering_runs;
 };
 
 // Flags associated with the XLA bridge's xla_device module.
@@ -123,9 +142,22 @@ struct XlaOpsCommonFlags {
   // If true, _XlaCompile compiles the cluster asynchronously with respect to
   // the main execution. The fallback path is taken while compilation happens.
   bool tf_xla_async_compilation;
+  // The maximum number of clusters compiled asynchronously at once, beyond
+  // which the new signatures keep taking the fallback path. Defaults to 10.
+  int32 tf_xla_max_concurrent_async_compilations;
+  // The number of times a new signature takes the fallback path before it is
+  // compiled asynchronously. The first signature of a cluster is always
+  // compiled right away. Defaults to 0, i.e. they all are.
+  int64_t tf_xla_async_compilation_threshold;
   // If true, uses Device API (PjRt) for single device compilation. Defaults to
   // false.
   bool tf_xla_use_device_api;
+  // If not empty, the leading dimension of the inputs of the clusters is
+  // padded to these buckets, "pow2" or a list of sizes, so that the inputs of
+  // many sizes share a few compilations. Only applies to the clusters whose
+  // output rows only depend on the same rows of their inputs. Defaults to
+  // empty.
+  std::string tf_xla_shape_buckets;
 };
 
 // Flags for the build_xla_ops pass.
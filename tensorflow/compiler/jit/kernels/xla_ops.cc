@@ -29,6 +29,7 @@ limitations under the License.
 #include "tensorflow/compiler/jit/device_compiler.h"
 #include "tensorflow/compiler/jit/encapsulate_subgraphs_pass.h"
 #include "tensorflow/compiler/jit/flags.h"
+#include "tensorflow/compiler/jit/shape_bucketing.h"
 #include "tensorflow/compiler/jit/xla_activity_listener.h"
 #include "tensorflow/compiler/jit/xla_compile_util.h"
 #include "tensorflow/compiler/jit/xla_platform_info.h"
@@ -88,12 +89,14 @@ class XlaExecutableClosure {
   explicit XlaExecutableClosure(
       xla::LocalClient* client, xla::LocalExecutable* executable,
       const XlaCompiler::CompilationResult* compilation_result,
-      ResourceVarsSnapshot resource_var_snapshots, int num_constant_args)
+      ResourceVarsSnapshot resource_var_snapshots, int num_constant_args,
+      std::optional<ClusterPadding> padding)
       : client_(client),
         executable_(executable),
         compilation_result_(compilation_result),
         resource_var_snapshots_(std::move(resource_var_snapshots)),
-        num_constant_args_(num_constant_args) {}
+        num_constant_args_(num_constant_args),
+        padding_(std::move(padding)) {}
 
   XlaExecutableClosure(XlaExecutableClosure&&) = default;
   XlaExecutableClosure& operator=(XlaExecutableClosure&&) = default;
@@ -107,6 +110,7 @@ class XlaExecutableClosure {
     return resource_var_snapshots_;
   }
   int num_constant_args() const { return num_constant_args_; }
+  std::optional<ClusterPadding>& padding() { return padding_; }
 
  private:
   xla::LocalClient* client_;
@@ -114,6 +118,8 @@ class XlaExecutableClosure {
   const XlaCompiler::CompilationResult* compilation_result_;
   ResourceVarsSnapshot resource_var_snapshots_;
   int num_constant_args_;
+  // How the inputs are padded to a shape bucket, if they are.
+  std::optional<ClusterPadding> padding_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(XlaExecutableClosure);
 };
@@ -230,6 +236,38 @@ GetXlaCompilerArgsAndSnapshotVariables(
   return result;
 }
 
+// Returns the padder of the inputs of the cluster `function` to shape buckets,
+// or nullptr if they are not padded.
+std::unique_ptr<ClusterPadder> MaybeCreateClusterPadder(
+    const XlaPlatformInfo& platform_info, const NameAttrList& function,
+    const std::vector<int>& constants, const std::vector<int>& resources) {
+  const ShapeBuckets* buckets = ShapeBuckets::FromFlags();
+  // The XlaTensors of XLA devices hold the shapes of their buffers, and the
+  // resource variables can't be padded.
+  if (buckets == nullptr || platform_info.is_on_xla_device() ||
+      !resources.empty()) {
+    return nullptr;
+  }
+  return std::make_unique<ClusterPadder>(buckets, function, constants);
+}
+
+// Plans the padding of `inputs` to shape buckets, and pads the shapes of
+// `args` accordingly.
+StatusOr<std::optional<ClusterPadding>> PlanClusterPadding(
+    OpKernelContext* ctx, ClusterPadder* padder,
+    absl::Span<const Tensor* const> inputs,
+    std::vector<XlaCompiler::Argument>* args) {
+  if (padder == nullptr) return std::optional<ClusterPadding>();
+  TF_ASSIGN_OR_RETURN(
+      std::optional<ClusterPadding> padding,
+      padder->Plan(*ctx->function_library()->GetFunctionLibraryDefinition(),
+                   inputs));
+  if (padding.has_value()) {
+    TF_RETURN_IF_ERROR(PadCompilerArguments(*padding, args));
+  }
+  return padding;
+}
+
 }  // namespace
 
 XlaLocalLaunchBase::XlaLocalLaunchBase(OpKernelConstruction* ctx,
@@ -242,7 +280,9 @@ XlaLocalLaunchBase::XlaLocalLaunchBase(OpKernelConstruction* ctx,
       resources_(resources),
       function_(function),
       platform_info_(XlaPlatformInfoFromDevice(ctx->device())),
-      has_ref_vars_(has_ref_vars) {}
+      has_ref_vars_(has_ref_vars),
+      padder_(MaybeCreateClusterPadder(platform_info_, function, constants,
+                                       resources)) {}
 
 static Status CompileToLocalExecutable(
     OpKernelContext* ctx, const NameAttrList& function, bool has_ref_vars,
@@ -270,7 +310,10 @@ static Status CompileToLocalExecutable(
   TF_RETURN_IF_ERROR(rm->LookupOrCreate<DeviceCompilationProfiler>(
       rm->default_container(), "device_compilation_profiler", &profiler,
       [](DeviceCompilationProfiler** profiler) {
-        *profiler = new DeviceCompilationProfiler();
+        const XlaOpsCommonFlags* flags = GetXlaOpsCommonFlags();
+        *profiler = new DeviceCompilationProfiler(
+            flags->tf_xla_max_concurrent_async_compilations,
+            flags->tf_xla_async_compilation_threshold);
         return OkStatus();
       }));
   // Hold the reference to the XLA device compiler and profiler during
@@ -354,6 +397,9 @@ void XlaLocalLaunchBase::ComputeAsync(OpKernelContext* ctx, DoneCallback done) {
     OP_REQUIRES_OK_ASYNC(ctx, status_or_xla_compiler_args.status(), done);
     xla_compiler_args = std::move(status_or_xla_compiler_args.value());
   }
+  StatusOr<std::optional<ClusterPadding>> padding = PlanClusterPadding(
+      ctx, padder_.get(), inputs, &xla_compiler_args);
+  OP_REQUIRES_OK_ASYNC(ctx, padding.status(), done);
   Status status = CompileToLocalExecutable(
       ctx, function_, /*has_ref_vars=*/has_ref_vars_, platform_info_,
       xla_compiler_args, DeviceCompileMode::kStrict,
@@ -363,7 +409,8 @@ void XlaLocalLaunchBase::ComputeAsync(OpKernelContext* ctx, DoneCallback done) {
 
   // Continuation of the execution, may be run in a different thread.
   auto run_xla_cluster = [ctx, client, executable, compilation_result, done,
-                          inputs, resources = resources_]() {
+                          inputs, resources = resources_,
+                          padding = *std::move(padding)]() mutable {
     auto platform_info = XlaPlatformInfoFromDevice(ctx->device());
     std::vector<VariableInfo> variable_infos;
     std::set<int> variables_updated;
@@ -391,10 +438,16 @@ void XlaLocalLaunchBase::ComputeAsync(OpKernelContext* ctx, DoneCallback done) {
 
     const xla::HloInputOutputAliasConfig& input_output_alias =
         executable->executable()->module().input_output_alias_config();
+    if (padding.has_value()) {
+      OP_REQUIRES_OK_ASYNC(
+          ctx, PadInputs(ctx, /*missing_ctx_input_prefix=*/0, &*padding),
+          done);
+    }
     StatusOr<std::vector<xla::ExecutionInput>> execution_inputs =
         launch_context.PopulateInputs(
             ctx, compilation_result, resource_var_ptrs,
-            /*missing_ctx_input_prefix=*/0, input_output_alias);
+            /*missing_ctx_input_prefix=*/0, input_output_alias,
+            padding.has_value() ? &*padding : nullptr);
     OP_REQUIRES_OK_ASYNC(ctx, execution_inputs.status(), done);
 
     xla::gpu::GpuExecutableRunOptions gpu_options;
@@ -426,7 +479,8 @@ void XlaLocalLaunchBase::ComputeAsync(OpKernelContext* ctx, DoneCallback done) {
         launch_context.PopulateOutputs(
             ctx, compilation_result, execution_output->ConsumeResult(),
             /*missing_ctx_input_prefix=*/0, absl::MakeSpan(variable_infos),
-            input_output_alias, resource_var_ptrs),
+            input_output_alias, resource_var_ptrs,
+            padding.has_value() ? &*padding : nullptr),
         done);
     VLOG(1) << "Done";
     done();
@@ -510,7 +564,9 @@ XlaCompileOp::XlaCompileOp(OpKernelConstruction* ctx)
       function_(FunctionAttr(ctx)),
       platform_info_(XlaPlatformInfoFromDevice(ctx->device())),
       must_compile_(MustCompileAttr(ctx)),
-      has_ref_vars_(HasRefVars(ctx)) {}
+      has_ref_vars_(HasRefVars(ctx)),
+      padder_(MaybeCreateClusterPadder(platform_info_, function_, constants_,
+                                       resources_)) {}
 
 void XlaCompileOp::Compute(OpKernelContext* ctx) {
   VLOG(3) << "XlaCompileOp " << def().name()
@@ -519,6 +575,7 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
   const XlaCompiler::CompilationResult* kernel;
   xla::LocalExecutable* executable;
   ResourceVarsSnapshot variables_snapshot;
+  std::optional<ClusterPadding> padding;
 
   std::vector<const Tensor*> inputs = InputsFromContext(ctx);
   bool cannot_compile_cluster;
@@ -542,9 +599,13 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
     auto args_and_variables_snapshot = GetXlaCompilerArgsAndSnapshotVariables(
         resources_, constants_, inputs, ctx);
     OP_REQUIRES_OK(ctx, args_and_variables_snapshot.status());
-    const std::vector<XlaCompiler::Argument>& args =
+    std::vector<XlaCompiler::Argument>& args =
         args_and_variables_snapshot->first;
     variables_snapshot = std::move(args_and_variables_snapshot->second);
+    StatusOr<std::optional<ClusterPadding>> padding_or =
+        PlanClusterPadding(ctx, padder_.get(), inputs, &args);
+    OP_REQUIRES_OK(ctx, padding_or.status());
+    padding = *std::move(padding_or);
 
     // Do not alias resource updates as locking variables in XlaCompile and
     // unlocking them in XlaRun may lead to deadlocks.
@@ -593,7 +654,7 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
   XlaExecutableClosureStore::KeyT key =
       XlaExecutableClosureStore::Global()->Produce(XlaExecutableClosure(
           client, executable, kernel, std::move(variables_snapshot),
-          constants_.size()));
+          constants_.size(), std::move(padding)));
 
   Tensor compilation_key(cpu_allocator, DT_STRING, TensorShape({}));
   compilation_key.flat<tstring>()(0) = key;
@@ -615,6 +676,8 @@ void XlaRunOp::Compute(OpKernelContext* ctx) {
 
   XlaExecutableClosure closure =
       XlaExecutableClosureStore::Global()->Consume(key);
+  const ClusterPadding* padding =
+      closure.padding().has_value() ? &*closure.padding() : nullptr;
   std::shared_ptr<se::DeviceMemoryAllocator> allocator =
       GetAllocator(ctx->device(), GetStream(ctx), platform_info_);
   XlaComputationLaunchContext launch_context =
@@ -642,10 +705,14 @@ void XlaRunOp::Compute(OpKernelContext* ctx) {
                                                 ? &variable_tensor.value()
                                                 : nullptr);
     }
+    if (closure.padding().has_value()) {
+      OP_REQUIRES_OK(ctx, PadInputs(ctx, closure.num_constant_args(),
+                                    &*closure.padding()));
+    }
     execution_inputs = launch_context.PopulateInputs(
         ctx, closure.compilation_result(), snapshot_ptrs,
         /*missing_ctx_input_prefix=*/closure.num_constant_args(),
-        input_output_alias);
+        input_output_alias, padding);
     OP_REQUIRES_OK(ctx, execution_inputs.status());
   }
 
@@ -670,7 +737,8 @@ void XlaRunOp::Compute(OpKernelContext* ctx) {
       launch_context.PopulateOutputs(
           ctx, closure.compilation_result(), execution_output->ConsumeResult(),
           /*missing_ctx_input_prefix=*/closure.num_constant_args(),
-          absl::MakeSpan(*variable_infos), input_output_alias, snapshot_ptrs));
+          absl::MakeSpan(*variable_infos), input_output_alias, snapshot_ptrs,
+          padding));
 }
 
 XlaMergeOp::XlaMergeOp(OpKernelConstruction* ctx) : OpKernel(ctx) {}
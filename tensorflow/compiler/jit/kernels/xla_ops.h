@@ -17,8 +17,10 @@ limitations under the License.
 #define TENSORFLOW_COMPILER_JIT_KERNELS_XLA_OPS_H_
 
 #include <atomic>
+#include <memory>
 
 #include "tensorflow/compiler/jit/device_compiler.h"
+#include "tensorflow/compiler/jit/shape_bucketing.h"
 #include "tensorflow/compiler/jit/xla_device.h"
 #include "tensorflow/compiler/jit/xla_launch_util.h"
 #include "tensorflow/compiler/jit/xla_platform_info.h"
@@ -66,6 +68,9 @@ class XlaLocalLaunchBase : public AsyncOpKernel {
   const XlaPlatformInfo platform_info_;
 
   bool has_ref_vars_;
+
+  // Pads the inputs to shape buckets, nullptr if they are not padded.
+  const std::unique_ptr<ClusterPadder> padder_;
 };
 
 // XlaLocalLaunchOp is used to replace a region of the TensorFlow graph
@@ -107,6 +112,9 @@ class XlaCompileOp : public OpKernel {
   // Whether the graph has TF reference variables.
   const bool has_ref_vars_;
 
+  // Pads the inputs to shape buckets, nullptr if they are not padded.
+  const std::unique_ptr<ClusterPadder> padder_;
+
   // cannot_compile_cluster_ is set to true if XLA returns an Unimplemented
   // error when compiling the cluster this _XlaCompile is supposed to compile.
   // If `cannot_compile_cluster_` is true then we avoid compiling this cluster
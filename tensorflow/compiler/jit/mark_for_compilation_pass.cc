@@ -21,6 +21,8 @@ limitations under the License.
 #include <limits>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "absl/base/call_once.h"
 #include "absl/container/flat_hash_map.h"
@@ -32,6 +34,7 @@ limitations under the License.
 #include "tensorflow/compiler/jit/device_util.h"
 #include "tensorflow/compiler/jit/flags.h"
 #include "tensorflow/compiler/jit/resource_operation_safety_analysis.h"
+#include "tensorflow/compiler/jit/shape_inference.h"
 #include "tensorflow/compiler/jit/xla_cluster_util.h"
 #include "tensorflow/compiler/tf2xla/const_analysis.h"
 #include "tensorflow/compiler/tf2xla/resource_operation_table.h"
@@ -48,6 +51,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/control_flow.h"
@@ -115,6 +119,15 @@ class MarkForCompilationPassImpl {
     std::atomic<int64_t>* fuel;
 
     bool dump_graphs;
+
+    // If positive, the constants of at least this size which don't need to be
+    // compile-time constants are not clustered.
+    int64_t min_parameterized_constant_size_bytes;
+
+    // If positive, the clusters whose estimated gain over this many runs
+    // doesn't cover the estimated cost of their compilations are not
+    // compiled.
+    int64_t cost_aware_clustering_runs;
   };
 
   MarkForCompilationPassImpl(DebugOptions debug_options, Graph* graph,
@@ -295,6 +308,29 @@ class MarkForCompilationPassImpl {
   // This function removes "obviously bad" cases like these.
   Status DeclusterNodes();
 
+  // The estimated benefit and cost of compiling a cluster, see
+  // `EstimateClusterCost`.
+  struct ClusterCostEstimate {
+    // The time saved by a run of the cluster over running its ops in TF.
+    double gain_per_run_us = 0;
+    // The time spent compiling the cluster once.
+    double compilation_cost_us = 0;
+    // The expected number of compilations of the cluster, from the number of
+    // dimensions of its inputs that aren't known statically.
+    int64_t expected_compilations = 1;
+    // The bytes of the intermediate tensors that XLA doesn't materialize.
+    int64_t fused_bytes = 0;
+  };
+
+  StatusOr<ClusterCostEstimate> EstimateClusterCost(
+      const Cluster& cluster, absl::Span<Node* const> nodes,
+      const GraphShapeInfo& shape_info);
+
+  // Declusters the clusters that aren't expected to pay for their
+  // compilations within debug_options_.cost_aware_clustering_runs runs, and
+  // logs the estimates of every cluster.
+  Status DeclusterUnprofitableClusters();
+
   // Manifests the clustering decisions into the TF graph by tagging nodes with
   // an `_XlaCluster` attribute.  Also some basic filter logic, like
   // tf_xla_min_cluster_size, are applied here.
@@ -445,6 +481,9 @@ class MarkForCompilationPassImpl {
   DebugOptions debug_options_;
   Graph* graph_;
   uint64 graph_fingerprint_;
+  // The names of the constants left out of the clusters so that they are
+  // passed to them as arguments.
+  absl::flat_hash_set<std::string> parameterized_constants_;
   FunctionLibraryDefinition* flib_def_;
   Env* env_;
   OptimizerOptions::GlobalJitLevel global_jit_level_;
@@ -654,7 +693,10 @@ StatusOr<bool> MarkForCompilationPassImpl::Initialize() {
   // If the user is requesting deterministic cluster names compute a hash of the
   // input graph to provide a stable but unique prefix for the name.
   if (debug_options_.deterministic_cluster_names) {
-    TF_ASSIGN_OR_RETURN(graph_fingerprint_, FingerprintGraph(*graph_));
+    // The values of the parameterized constants are arguments of the
+    // clusters, so they don't affect the names.
+    TF_ASSIGN_OR_RETURN(graph_fingerprint_,
+                        FingerprintGraph(*graph_, parameterized_constants_));
   }
 
   // Each compilation candidate belongs to a cluster. The cluster's
@@ -900,6 +942,165 @@ Status MarkForCompilationPassImpl::DeclusterNodes() {
   return OkStatus();
 }
 
+// A rough model of the costs of running ops in TF and in XLA, used by the
+// cost-aware clustering. The costs of the ops themselves are assumed to be the
+// same in both, so the gain of a cluster is the dispatch overhead of its ops
+// and the memory traffic of the intermediate tensors that XLA fuses away.
+constexpr double kCpuOpDispatchCostUs = 2;
+constexpr double kGpuOpDispatchCostUs = 8;
+// The memory bandwidths, in bytes per microsecond.
+constexpr double kCpuMemoryBandwidth = 2e4;
+constexpr double kGpuMemoryBandwidth = 5e5;
+// A cluster is launched by an _XlaCompile and an _XlaRun op.
+constexpr int kXlaLaunchOps = 2;
+constexpr double kCompilationFixedCostUs = 5e4;
+constexpr double kCompilationCostPerOpUs = 2e3;
+// Each dimension that isn't known statically is assumed to take a few
+// distinct values, each of which requires a compilation.
+constexpr int64_t kCompilationsPerUnknownDimension = 4;
+constexpr int64_t kMaxExpectedCompilations = 64;
+
+StatusOr<MarkForCompilationPassImpl::ClusterCostEstimate>
+MarkForCompilationPassImpl::EstimateClusterCost(
+    const Cluster& cluster, absl::Span<Node* const> nodes,
+    const GraphShapeInfo& shape_info) {
+  TF_ASSIGN_OR_RETURN(DeviceId chosen_device,
+                      PickDeviceForXla(device_info_cache_, cluster.devices(),
+                                       /*allow_mixing_unknown_and_cpu=*/false));
+  const bool is_cpu =
+      device_info_cache_.GetDeviceTypeFor(chosen_device).type_string() ==
+      DEVICE_CPU;
+
+  auto get_shape = [&](const Node* n,
+                       size_t output) -> const PartialTensorShape* {
+    auto it = shape_info.find(n->name());
+    if (it == shape_info.end() || output >= it->second.size()) {
+      return nullptr;
+    }
+    return &it->second[output].shape;
+  };
+
+  ClusterCostEstimate estimate;
+  int64_t unknown_dimensions = 0;
+  absl::flat_hash_set<std::pair<const Node*, int>> seen_inputs;
+  for (Node* n : nodes) {
+    for (const Edge* e : n->in_edges()) {
+      if (e->IsControlEdge() || GetClusterForNode(e->src()) == &cluster ||
+          !seen_inputs.insert({e->src(), e->src_output()}).second) {
+        continue;
+      }
+      const PartialTensorShape* shape = get_shape(e->src(), e->src_output());
+      if (shape == nullptr || shape->unknown_rank()) {
+        // Assumes that a tensor of unknown rank has a few dynamic dimensions.
+        unknown_dimensions += 2;
+        continue;
+      }
+      for (int64_t dim : shape->dim_sizes()) {
+        if (dim < 0) ++unknown_dimensions;
+      }
+    }
+
+    // The outputs only used within the cluster are never materialized.
+    for (int output = 0; output < n->num_outputs(); ++output) {
+      bool used = false;
+      bool only_used_in_cluster = true;
+      for (const Edge* e : n->out_edges()) {
+        if (e->IsControlEdge() || e->src_output() != output) continue;
+        used = true;
+        only_used_in_cluster &= GetClusterForNode(e->dst()) == &cluster;
+      }
+      const PartialTensorShape* shape = get_shape(n, output);
+      if (!used || !only_used_in_cluster || shape == nullptr ||
+          !shape->IsFullyDefined()) {
+        continue;
+      }
+      const int dtype_size = DataTypeSize(n->output_type(output));
+      estimate.fused_bytes += shape->num_elements() * dtype_size;
+    }
+  }
+
+  const double dispatch_cost_us =
+      is_cpu ? kCpuOpDispatchCostUs : kGpuOpDispatchCostUs;
+  const double memory_bandwidth =
+      is_cpu ? kCpuMemoryBandwidth : kGpuMemoryBandwidth;
+  // The intermediate tensors are written once and read at least once.
+  estimate.gain_per_run_us =
+      (cluster.effective_cluster_size() - kXlaLaunchOps) * dispatch_cost_us +
+      2.0 * estimate.fused_bytes / memory_bandwidth;
+  estimate.compilation_cost_us =
+      kCompilationFixedCostUs +
+      kCompilationCostPerOpUs * cluster.effective_cluster_size();
+  estimate.expected_compilations =
+      std::min(kMaxExpectedCompilations,
+               1 + unknown_dimensions * kCompilationsPerUnknownDimension);
+  return estimate;
+}
+
+Status MarkForCompilationPassImpl::DeclusterUnprofitableClusters() {
+  const int64_t runs = debug_options_.cost_aware_clustering_runs;
+  if (runs <= 0) {
+    return OkStatus();
+  }
+
+  GraphShapeInfo shape_info;
+  Status status = InferShapes(graph_, /*arg_shapes=*/{}, flib_def_,
+                              &shape_info);
+  if (!status.ok()) {
+    // The estimates then assume that no shape is known statically.
+    VLOG(1) << "Failed to infer shapes for cost-aware clustering: " << status;
+    shape_info.clear();
+  }
+
+  std::vector<Cluster*> clusters;
+  absl::flat_hash_map<Cluster*, std::vector<Node*>> nodes_by_cluster;
+  for (Node* n : compilation_candidates_) {
+    Cluster* cluster = GetClusterForNode(n);
+    if (cluster == nullptr || declustered_nodes_.contains(n)) {
+      continue;
+    }
+    std::vector<Node*>& nodes = nodes_by_cluster[cluster];
+    if (nodes.empty()) clusters.push_back(cluster);
+    nodes.push_back(n);
+  }
+
+  for (Cluster* cluster : clusters) {
+    // The clusters that are explicitly requested or too small to be compiled
+    // are left alone.
+    if (cluster->is_xla_compile_attr_true() ||
+        (cluster->effective_cluster_size() < debug_options_.min_cluster_size &&
+         !cluster->has_functional_control_flow())) {
+      continue;
+    }
+    TF_ASSIGN_OR_RETURN(bool should_compile, ShouldCompileCluster(*cluster));
+    if (!should_compile) {
+      continue;
+    }
+
+    const std::vector<Node*>& nodes = nodes_by_cluster[cluster];
+    TF_ASSIGN_OR_RETURN(ClusterCostEstimate estimate,
+                        EstimateClusterCost(*cluster, nodes, shape_info));
+    const double total_gain_us = estimate.gain_per_run_us * runs;
+    const double total_cost_us =
+        estimate.compilation_cost_us * estimate.expected_compilations;
+    const bool profitable = total_gain_us >= total_cost_us;
+    VLOG(2) << "Cost-aware clustering "
+            << (profitable ? "keeps" : "declusters") << " the cluster of "
+            << cluster->effective_cluster_size() << " ops containing "
+            << nodes.front()->name() << ": estimated gain of "
+            << estimate.gain_per_run_us << "us per run ("
+            << estimate.fused_bytes << " fused bytes), "
+            << estimate.expected_compilations << " expected compilations of "
+            << estimate.compilation_cost_us << "us each, speedup of "
+            << total_gain_us / total_cost_us << "x over " << runs
+            << " runs";
+    if (!profitable) {
+      declustered_nodes_.insert(nodes.begin(), nodes.end());
+    }
+  }
+
+  return OkStatus();
+}
+
 // Tracks monotonic sequence numbers for graphs.
 class ClusterSequenceNumberGenerator {
  public:
@@ -1236,6 +1437,23 @@ absl::flat_hash_set<string> GetOrCreateAllowlist() {
   return allowlist;
 }
 
+// Returns whether `node` is a Const node whose value takes at least
+// `min_size_bytes` bytes.
+bool IsLargeConstant(const Node& node, int64_t min_size_bytes) {
+  if (min_size_bytes <= 0 || node.type_string() != "Const") {
+    return false;
+  }
+  const AttrValue* value = node.attrs().Find("value");
+  if (value == nullptr ||
+      !TensorShape::IsValid(value->tensor().tensor_shape())) {
+    return false;
+  }
+  const TensorProto& tensor = value->tensor();
+  return TensorShape(tensor.tensor_shape()).num_elements() *
+             DataTypeSize(tensor.dtype()) >=
+         min_size_bytes;
+}
+
 Status MarkForCompilationPassImpl::FindCompilationCandidates() {
   OptimizerOptions opts;
   std::unique_ptr<ProcessFunctionLibraryRuntime> pflr(
@@ -1349,6 +1567,19 @@ Status MarkForCompilationPassImpl::FindCompilationCandidates() {
       continue;
     }
 
+    // Leave the large constants which feed regular inputs out of the clusters,
+    // so that they are passed to the clusters as arguments: the compiled
+    // executables then don't depend on the values of the constants, and can
+    // be reused when the constants are refreshed.
+    if (!compile_time_const_nodes[node->id()] &&
+        IsLargeConstant(*node,
+                        debug_options_.min_parameterized_constant_size_bytes)) {
+      VLOG(2) << "Not clustering " << node->name()
+              << ": parameterized large constant";
+      parameterized_constants_.insert(node->name());
+      continue;
+    }
+
     if (compile_time_const_nodes[node->id()]) {
       const OpDef* op_def;
       TF_RETURN_IF_ERROR(
@@ -1562,6 +1793,7 @@ Status MarkForCompilationPassImpl::Run() {
 
   TF_RETURN_IF_ERROR(RunEdgeContractionLoop());
   TF_RETURN_IF_ERROR(DeclusterNodes());
+  TF_RETURN_IF_ERROR(DeclusterUnprofitableClusters());
   TF_RETURN_IF_ERROR(CreateClusters());
   TF_RETURN_IF_ERROR(DumpDebugInfo());
 
@@ -1882,6 +2114,10 @@ Status MarkForCompilationPass::Run(
   debug_options.min_cluster_size = flags->tf_xla_min_cluster_size;
   debug_options.fuel = GetPointerToFuel(flags->tf_xla_clustering_fuel);
   debug_options.dump_graphs = flags->tf_xla_clustering_debug;
+  debug_options.min_parameterized_constant_size_bytes =
+      flags->tf_xla_min_parameterized_constant_size_bytes;
+  debug_options.cost_aware_clustering_runs =
+      flags->tf_xla_cost_aware_clustering_runs;
 
   return MarkForCompilation(options, debug_options);
 }
@@ -1901,6 +2137,10 @@ Status MarkForCompilationPass::RunForTest(
   debug_options.min_cluster_size = flags->tf_xla_min_cluster_size;
   debug_options.fuel = GetPointerToFuel(flags->tf_xla_clustering_fuel);
   debug_options.dump_graphs = flags->tf_xla_clustering_debug;
+  debug_options.min_parameterized_constant_size_bytes =
+      flags->tf_xla_min_parameterized_constant_size_bytes;
+  debug_options.cost_aware_clustering_runs =
+      flags->tf_xla_cost_aware_clustering_runs;
 
   return MarkForCompilation(options, debug_options);
 }
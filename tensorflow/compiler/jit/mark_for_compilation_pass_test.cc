@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/cc/ops/sendrecv_ops.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/compiler/jit/defs.h"
+#include "tensorflow/compiler/jit/flags.h"
 #include "tensorflow/compiler/jit/mark_for_compilation_pass_test_helper.h"
 #include "tensorflow/compiler/jit/node_matchers.h"
 #include "tensorflow/compiler/jit/xla_cluster_util.h"
@@ -1853,6 +1854,106 @@ TEST(XlaCompilationTest, DeterministicClusterNames) {
   // clusters0/2 should differ from clusters1/3
 }
 
+// Builds a graph which adds a table of 16 floats to a placeholder, and reshapes
+// the sum with a shape of 16 int32.
+std::unique_ptr<Graph> CreateGraphWithLargeConstants(float table_value) {
+  Scope root = Scope::NewRootScope().ExitOnError();
+  Output a = ops::Placeholder(root.WithOpName("a"), DT_FLOAT);
+  Output table = ops::Const(root.WithOpName("table"), table_value, {16});
+  Output shape = ops::Const(root.WithOpName("shape"), 1, {16});
+  Output x = ops::Add(root.WithOpName("x"), a, table);
+  Output y = ops::Reshape(root.WithOpName("y"), x, shape);
+  ops::Neg(root.WithOpName("z"), y);
+
+  std::unique_ptr<Graph> graph(new Graph(OpRegistry::Global()));
+  TF_CHECK_OK(root.ToGraph(graph.get()));
+  return graph;
+}
+
+TEST(XlaCompilationTest, ParameterizeLargeConstants) {
+  MarkForCompilationPassFlags* flags = GetMarkForCompilationPassFlags();
+  const int64_t old_min_size_bytes =
+      flags->tf_xla_min_parameterized_constant_size_bytes;
+  flags->tf_xla_min_parameterized_constant_size_bytes = 64;
+
+  std::unique_ptr<Graph> graph = CreateGraphWithLargeConstants(1.0f);
+  TF_ASSERT_OK(MarkForCompilationPassTestHelper::MarkForCompilation(&graph));
+  std::unordered_map<string, string> clusters = GetClusters(*graph);
+
+  // The table is passed to the cluster, but the shape is a compile-time
+  // constant.
+  EXPECT_EQ(clusters["table"], "");
+  EXPECT_NE(clusters["x"], "");
+  EXPECT_EQ(clusters["shape"], clusters["x"]);
+  EXPECT_EQ(clusters["y"], clusters["x"]);
+  EXPECT_EQ(clusters["z"], clusters["x"]);
+
+  flags->tf_xla_min_parameterized_constant_size_bytes = old_min_size_bytes;
+}
+
+TEST(XlaCompilationTest, ParameterizedConstantsDontChangeClusterNames) {
+  MarkForCompilationPassFlags* flags = GetMarkForCompilationPassFlags();
+  const int64_t old_min_size_bytes =
+      flags->tf_xla_min_parameterized_constant_size_bytes;
+  auto options = MarkForCompilationPassTestHelper::Options()
+                     .WithDeterministicClusterNames();
+  // Returns the fingerprint part of the name of the cluster of a graph.
+  auto get_fingerprint = [&](float table_value) -> std::string {
+    std::unique_ptr<Graph> graph = CreateGraphWithLargeConstants(table_value);
+    TF_CHECK_OK(
+        MarkForCompilationPassTestHelper::MarkForCompilation(&graph, options));
+    std::set<string> names = GetClusterNames(*graph);
+    CHECK_EQ(names.size(), 1);
+    std::vector<std::string> parts = absl::StrSplit(*names.begin(), '_');
+    CHECK_EQ(parts.size(), 3);
+    return parts[1];
+  };
+
+  flags->tf_xla_min_parameterized_constant_size_bytes = 0;
+  EXPECT_NE(get_fingerprint(1.0f), get_fingerprint(2.0f));
+
+  flags->tf_xla_min_parameterized_constant_size_bytes = 64;
+  EXPECT_EQ(get_fingerprint(1.0f), get_fingerprint(2.0f));
+
+  flags->tf_xla_min_parameterized_constant_size_bytes = old_min_size_bytes;
+}
+
+TEST(XlaCompilationTest, CostAwareClusteringDeclustersUnprofitableClusters) {
+  MarkForCompilationPassFlags* flags = GetMarkForCompilationPassFlags();
+  const int64_t old_runs = flags->tf_xla_cost_aware_clustering_runs;
+  auto create_graph = [] {
+    Scope root = Scope::NewRootScope().ExitOnError();
+    Output a =
+        ops::Placeholder(root.WithOpName("a"), DT_FLOAT,
+                         ops::Placeholder::Shape(TensorShape({1024, 1024})));
+    Output b = ops::Relu(root.WithOpName("b"), a);
+    Output c = ops::Neg(root.WithOpName("c"), b);
+    Output d = ops::Sigmoid(root.WithOpName("d"), c);
+    ops::Tanh(root.WithOpName("e"), d);
+    std::unique_ptr<Graph> graph(new Graph(OpRegistry::Global()));
+    TF_CHECK_OK(root.ToGraph(graph.get()));
+    return graph;
+  };
+
+  // A single run doesn't pay for the compilation.
+  flags->tf_xla_cost_aware_clustering_runs = 1;
+  std::unique_ptr<Graph> graph = create_graph();
+  TF_ASSERT_OK(MarkForCompilationPassTestHelper::MarkForCompilation(&graph));
+  EXPECT_TRUE(GetClusters(*graph).empty());
+
+  // Many runs do.
+  flags->tf_xla_cost_aware_clustering_runs = 1000000;
+  graph = create_graph();
+  TF_ASSERT_OK(MarkForCompilationPassTestHelper::MarkForCompilation(&graph));
+  std::unordered_map<string, string> clusters = GetClusters(*graph);
+  EXPECT_NE(clusters["b"], "");
+  EXPECT_EQ(clusters["c"], clusters["b"]);
+  EXPECT_EQ(clusters["d"], clusters["b"]);
+  EXPECT_EQ(clusters["e"], clusters["b"]);
+
+  flags->tf_xla_cost_aware_clustering_runs = old_runs;
+}
+
 namespace {
 Node* MakeStageNode(GraphDefBuilder& builder, string name,
                     std::initializer_list<DataType> dtypes,
@@ -0,0 +1,382 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/jit/shape_bucketing.h"
+
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/jit/flags.h"
+#include "tensorflow/core/common_runtime/function_def_utils.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/stream_executor_no_cuda.h"
+
+namespace tensorflow {
+
+namespace {
+
+// What is known about a tensor of a cluster.
+struct TensorInfo {
+  // Whether the leading dimension of the tensor is the padded one.
+  bool padded = false;
+  // The rank of the tensor, or -1 if it is unknown.
+  int rank = -1;
+  // The shape of the tensor, if it is not padded and is known.
+  std::optional<TensorShape> shape;
+};
+
+// The ops that apply to each element of their input.
+bool IsUnaryElementwiseOp(const Node& n) {
+  static const auto* ops = new absl::flat_hash_set<absl::string_view>(
+      {"Abs", "Acos", "Acosh", "Asin", "Asinh", "Atan", "Atanh", "Cast", "Ceil",
+       "Cos", "Cosh", "Elu", "Erf", "Erfc", "Exp", "Expm1", "Floor", "Identity",
+       "Inv", "IsFinite", "IsInf", "IsNan", "LeakyRelu", "Log", "Log1p",
+       "LogicalNot", "Neg", "Reciprocal", "Relu", "Relu6", "Rint", "Round",
+       "Rsqrt", "Selu", "Sigmoid", "Sign", "Sin", "Sinh", "Softplus",
+       "Softsign", "Sqrt", "Square", "StopGradient", "Tan", "Tanh"});
+  return ops->contains(n.type_string());
+}
+
+// The ops that apply to each element of their broadcast inputs.
+bool IsBroadcastingElementwiseOp(const Node& n) {
+  static const auto* ops = new absl::flat_hash_set<absl::string_view>(
+      {"Add", "AddV2", "Atan2", "Div", "DivNoNan", "Equal", "FloorDiv",
+       "FloorMod", "Greater", "GreaterEqual", "Less", "LessEqual", "LogicalAnd",
+       "LogicalOr", "Maximum", "Minimum", "Mod", "Mul", "MulNoNan", "NotEqual",
+       "Pow", "RealDiv", "Relu6Grad", "ReluGrad", "RsqrtGrad", "SelectV2",
+       "SigmoidGrad", "SqrtGrad", "SquaredDifference", "Sub", "TanhGrad",
+       "TruncateDiv", "TruncateMod"});
+  return ops->contains(n.type_string());
+}
+
+// The reductions over the axes given by their second input.
+bool IsReductionOp(const Node& n) {
+  static const auto* ops = new absl::flat_hash_set<absl::string_view>(
+      {"All", "Any", "Max", "Mean", "Min", "Prod", "Sum"});
+  return ops->contains(n.type_string());
+}
+
+// Returns the output of an op that broadcasts `inputs`, or nullopt if the
+// unpadded inputs may not be broadcast along the padded dimension.
+std::optional<TensorInfo> BroadcastOutput(
+    absl::Span<const TensorInfo* const> inputs) {
+  int rank = -1;
+  for (const TensorInfo* input : inputs) {
+    if (!input->padded) continue;
+    if (rank != -1 && input->rank != rank) return std::nullopt;
+    rank = input->rank;
+  }
+  for (const TensorInfo* input : inputs) {
+    if (input->padded) continue;
+    if (!input->shape.has_value()) return std::nullopt;
+    const int input_rank = input->shape->dims();
+    if (input_rank > rank ||
+        (input_rank == rank && input->shape->dim_size(0) != 1)) {
+      return std::nullopt;
+    }
+  }
+  return TensorInfo{/*padded=*/true, rank, std::nullopt};
+}
+
+// Returns the output of the reduction `n` of the padded `input`, or nullopt
+// if it may reduce the padded dimension.
+std::optional<TensorInfo> ReductionOutput(const Node& n,
+                                          const TensorInfo& input) {
+  const Node* axes_node;
+  if (!n.input_node(1, &axes_node).ok() || !axes_node->IsConstant()) {
+    return std::nullopt;
+  }
+  Tensor axes;
+  bool keep_dims;
+  if (!GetNodeAttr(axes_node->attrs(), "value", &axes).ok() ||
+      !GetNodeAttr(n.attrs(), "keep_dims", &keep_dims).ok()) {
+    return std::nullopt;
+  }
+  absl::flat_hash_set<int64_t> reduced;
+  for (int64_t i = 0; i < axes.NumElements(); ++i) {
+    int64_t axis = axes.dtype() == DT_INT32 ? axes.flat<int32>()(i)
+                                            : axes.flat<int64_t>()(i);
+    if (axis < 0) axis += input.rank;
+    if (axis == 0) return std::nullopt;
+    reduced.insert(axis);
+  }
+  const int rank =
+      keep_dims ? input.rank : input.rank - static_cast<int>(reduced.size());
+  return TensorInfo{/*padded=*/true, rank, std::nullopt};
+}
+
+// Returns the output of `n` given its inputs, some of which are padded, or
+// nullopt if its rows may depend on other rows of the padded inputs.
+std::optional<TensorInfo> PaddedOutput(
+    const Node& n, absl::Span<const TensorInfo* const> inputs) {
+  if (n.num_outputs() != 1) return std::nullopt;
+  if (IsUnaryElementwiseOp(n) && inputs.size() == 1) {
+    return *inputs[0];
+  }
+  if (IsBroadcastingElementwiseOp(n)) {
+    return BroadcastOutput(inputs);
+  }
+  const absl::string_view type = n.type_string();
+  if ((type == "BiasAdd" || type == "BiasAddV1") && inputs[0]->padded &&
+      !inputs[1]->padded) {
+    return *inputs[0];
+  }
+  if (type == "MatMul" && inputs[0]->padded && !inputs[1]->padded) {
+    bool transpose_a;
+    if (!GetNodeAttr(n.attrs(), "transpose_a", &transpose_a).ok() ||
+        transpose_a) {
+      return std::nullopt;
+    }
+    return TensorInfo{/*padded=*/true, /*rank=*/2, std::nullopt};
+  }
+  // Softmax normalizes the last dimension, which must not be the padded one.
+  if ((type == "Softmax" || type == "LogSoftmax") && inputs[0]->rank >= 2) {
+    return *inputs[0];
+  }
+  if (IsReductionOp(n) && inputs[0]->padded && !inputs[1]->padded) {
+    return ReductionOutput(n, *inputs[0]);
+  }
+  return std::nullopt;
+}
+
+}  // namespace
+
+StatusOr<ShapeBuckets> ShapeBuckets::Parse(absl::string_view spec) {
+  if (spec == "pow2") return ShapeBuckets({});
+  std::vector<int64_t> sizes;
+  for (absl::string_view size_str : absl::StrSplit(spec, ',')) {
+    int64_t size;
+    if (!absl::SimpleAtoi(size_str, &size) || size <= 0 ||
+        (!sizes.empty() && size <= sizes.back())) {
+      return errors::InvalidArgument(
+          "Invalid shape buckets '", spec,
+          "', expected 'pow2' or a list of increasing sizes");
+    }
+    sizes.push_back(size);
+  }
+  return ShapeBuckets(std::move(sizes));
+}
+
+const ShapeBuckets* ShapeBuckets::FromFlags() {
+  static const ShapeBuckets* buckets = []() -> const ShapeBuckets* {
+    const std::string& spec = GetXlaOpsCommonFlags()->tf_xla_shape_buckets;
+    if (spec.empty()) return nullptr;
+    StatusOr<ShapeBuckets> parsed = Parse(spec);
+    if (!parsed.ok()) {
+      LOG(ERROR) << "Disabling shape bucketing: " << parsed.status();
+      return nullptr;
+    }
+    return new ShapeBuckets(std::move(parsed).value());
+  }();
+  return buckets;
+}
+
+std::optional<int64_t> ShapeBuckets::Bucket(int64_t size) const {
+  if (sizes_.empty()) {
+    if (size > (int64_t{1} << 62)) return std::nullopt;
+    int64_t bucket = 1;
+    while (bucket < size) bucket <<= 1;
+    return bucket;
+  }
+  auto it = absl::c_lower_bound(sizes_, size);
+  if (it == sizes_.end()) return std::nullopt;
+  return *it;
+}
+
+std::optional<std::vector<bool>> PaddedClusterOutputs(
+    const Graph& graph, absl::Span<const int> arg_ranks,
+    absl::Span<const int> constant_args) {
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order, NodeComparatorID());
+
+  // The tensors produced by each node, by node id.
+  std::vector<std::vector<TensorInfo>> outputs(graph.num_node_ids());
+  std::vector<bool> padded_outputs;
+  for (Node* n : order) {
+    if (!n->IsOp()) continue;
+    std::vector<const TensorInfo*> inputs(n->num_inputs());
+    for (const Edge* e : n->in_edges()) {
+      if (e->IsControlEdge()) continue;
+      inputs[e->dst_input()] = &outputs[e->src()->id()][e->src_output()];
+    }
+    std::vector<TensorInfo>& node_outputs = outputs[n->id()];
+    node_outputs.resize(n->num_outputs());
+
+    int index;
+    if (n->IsArg()) {
+      if (!GetNodeAttr(n->attrs(), "index", &index).ok() || index < 0 ||
+          index >= static_cast<int>(arg_ranks.size())) {
+        return std::nullopt;
+      }
+      TensorInfo& info = node_outputs[0];
+      if (!absl::c_binary_search(constant_args, index)) {
+        info.rank = arg_ranks[index];
+        info.padded = info.rank > 0;
+        if (info.rank == 0) info.shape = TensorShape();
+      }
+    } else if (n->IsRetval()) {
+      if (!GetNodeAttr(n->attrs(), "index", &index).ok() || index < 0) {
+        return std::nullopt;
+      }
+      if (index >= static_cast<int>(padded_outputs.size())) {
+        padded_outputs.resize(index + 1);
+      }
+      padded_outputs[index] = inputs[0]->padded;
+    } else if (absl::c_none_of(inputs, [](const TensorInfo* input) {
+                 return input->padded;
+               })) {
+      // Computations on unpadded tensors are not affected by the padding, only
+      // their shapes are tracked for the broadcasts.
+      Tensor value;
+      if (n->IsConstant() && GetNodeAttr(n->attrs(), "value", &value).ok()) {
+        node_outputs[0].shape = value.shape();
+        node_outputs[0].rank = value.dims();
+      } else if (IsUnaryElementwiseOp(*n) && inputs.size() == 1) {
+        node_outputs[0] = *inputs[0];
+      }
+    } else {
+      std::optional<TensorInfo> output = PaddedOutput(*n, inputs);
+      if (!output.has_value()) {
+        VLOG(2) << "Cannot pad the leading dimension of the inputs of "
+                << n->DebugString();
+        return std::nullopt;
+      }
+      node_outputs[0] = *std::move(output);
+    }
+  }
+  return padded_outputs;
+}
+
+ClusterPadder::ClusterPadder(const ShapeBuckets* buckets,
+                             NameAttrList function,
+                             std::vector<int> constant_args)
+    : buckets_(buckets),
+      function_(std::move(function)),
+      constant_args_(std::move(constant_args)) {}
+
+StatusOr<std::optional<ClusterPadding>> ClusterPadder::Plan(
+    const FunctionLibraryDefinition& flib_def,
+    absl::Span<const Tensor* const> inputs) {
+  ClusterPadding padding;
+  std::vector<int> arg_ranks(inputs.size());
+  // All the padded inputs share the size of their leading dimension.
+  int64_t size = -1;
+  for (int i = 0; i < inputs.size(); ++i) {
+    const Tensor& input = *inputs[i];
+    arg_ranks[i] = input.dims();
+    if (absl::c_binary_search(constant_args_, i) || input.dims() == 0) {
+      continue;
+    }
+    if (input.dtype() == DT_RESOURCE || input.NumElements() == 0 ||
+        (size != -1 && input.dim_size(0) != size)) {
+      return std::optional<ClusterPadding>();
+    }
+    size = input.dim_size(0);
+    padding.padded_args.push_back(i);
+  }
+  if (padding.padded_args.empty()) return std::optional<ClusterPadding>();
+  std::optional<int64_t> bucket = buckets_->Bucket(size);
+  if (!bucket.has_value() || *bucket == size) {
+    return std::optional<ClusterPadding>();
+  }
+  padding.size = size;
+  padding.bucket = *bucket;
+
+  mutex_lock l(mu_);
+  auto it = padded_outputs_.find(arg_ranks);
+  if (it == padded_outputs_.end()) {
+    if (fbody_ == nullptr) {
+      const FunctionDef* fdef = flib_def.Find(function_.name());
+      if (fdef == nullptr) {
+        return errors::NotFound("Cluster function ", function_.name(),
+                                " not found");
+      }
+      TF_RETURN_IF_ERROR(FunctionDefToBodyHelper(
+          *fdef, AttrSlice(&function_.attr()), &flib_def, &fbody_));
+    }
+    it = padded_outputs_
+             .emplace(arg_ranks, PaddedClusterOutputs(*fbody_->graph,
+                                                      arg_ranks,
+                                                      constant_args_))
+             .first;
+    VLOG(1) << "The leading dimension of the inputs of " << function_.name()
+            << (it->second.has_value() ? " is" : " isn't")
+            << " padded to shape buckets";
+  }
+  if (!it->second.has_value()) return std::optional<ClusterPadding>();
+  padding.padded_outputs = *it->second;
+  return std::optional<ClusterPadding>(std::move(padding));
+}
+
+Status PadCompilerArguments(const ClusterPadding& padding,
+                            std::vector<XlaCompiler::Argument>* args) {
+  for (int arg_num : padding.padded_args) {
+    XlaCompiler::Argument& arg = (*args)[arg_num];
+    TF_RET_CHECK(arg.kind == XlaCompiler::Argument::kParameter);
+    TF_RET_CHECK(std::holds_alternative<TensorShape>(arg.shape));
+    std::get<TensorShape>(arg.shape).set_dim(0, padding.bucket);
+  }
+  return OkStatus();
+}
+
+Status PadInputs(OpKernelContext* ctx, int missing_ctx_input_prefix,
+                 ClusterPadding* padding) {
+  se::Stream* stream =
+      ctx->op_device_context() ? ctx->op_device_context()->stream() : nullptr;
+  for (int arg_num : padding->padded_args) {
+    const Tensor& input = ctx->input(arg_num - missing_ctx_input_prefix);
+    TensorShape shape = input.shape();
+    shape.set_dim(0, padding->bucket);
+    Tensor padded;
+    TF_RETURN_IF_ERROR(ctx->allocate_temp(input.dtype(), shape, &padded));
+
+    // The leading rows are contiguous, the input is copied to the front of
+    // the padded tensor and the rest is zeroed.
+    const uint64_t input_bytes = input.TotalBytes();
+    const uint64_t padding_bytes = padded.TotalBytes() - input_bytes;
+    char* dst = const_cast<char*>(padded.tensor_data().data());
+    const char* src = input.tensor_data().data();
+    if (stream != nullptr) {
+      se::DeviceMemoryBase dst_mem(dst, input_bytes);
+      se::DeviceMemoryBase padding_mem(dst + input_bytes, padding_bytes);
+      stream->ThenMemcpy(&dst_mem,
+                         se::DeviceMemoryBase(const_cast<char*>(src),
+                                              input_bytes),
+                         input_bytes);
+      stream->ThenMemZero(&padding_mem, padding_bytes);
+      if (!stream->ok()) {
+        return errors::Internal("Failed to pad the input ", arg_num,
+                                " of the cluster");
+      }
+    } else {
+      std::memcpy(dst, src, input_bytes);
+      std::memset(dst + input_bytes, 0, padding_bytes);
+    }
+    padding->padded_inputs[arg_num] = std::move(padded);
+  }
+  return OkStatus();
+}
+
+}  // namespace tensorflow
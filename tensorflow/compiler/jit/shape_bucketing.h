@@ -0,0 +1,130 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_JIT_SHAPE_BUCKETING_H_
+#define TENSORFLOW_COMPILER_JIT_SHAPE_BUCKETING_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_compiler.h"
+#include "tensorflow/core/common_runtime/function_body.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// The sizes that the leading dimension of the inputs of a cluster is padded
+// to, so that the inputs of many sizes share a few compilations.
+class ShapeBuckets {
+ public:
+  // Parses `spec`, either "pow2" for the powers of two, or a comma-separated
+  // list of increasing sizes.
+  static StatusOr<ShapeBuckets> Parse(absl::string_view spec);
+
+  // Returns the buckets set by --tf_xla_shape_buckets, or nullptr if
+  // bucketing is disabled.
+  static const ShapeBuckets* FromFlags();
+
+  // Returns the smallest bucket that holds `size`, or nullopt if there is
+  // none.
+  std::optional<int64_t> Bucket(int64_t size) const;
+
+ private:
+  explicit ShapeBuckets(std::vector<int64_t> sizes)
+      : sizes_(std::move(sizes)) {}
+
+  // The listed sizes, empty for the powers of two.
+  std::vector<int64_t> sizes_;
+};
+
+// How the leading dimension of the inputs of a cluster is padded to a bucket.
+//
+// The inputs are padded with zeros and the outputs are sliced back to their
+// leading `size` rows, which is only valid if the rows of the outputs only
+// depend on the same rows of the inputs, see PaddedClusterOutputs().
+struct ClusterPadding {
+  // The size of the leading dimension of the padded inputs.
+  int64_t size = 0;
+  // The size it is padded to.
+  int64_t bucket = 0;
+  // The indices of the padded arguments of the cluster.
+  std::vector<int> padded_args;
+  // Whether the leading dimension of each output of the cluster is padded.
+  std::vector<bool> padded_outputs;
+  // The padded values of `padded_args`, once PadInputs() ran.
+  absl::flat_hash_map<int, Tensor> padded_inputs;
+};
+
+// Returns, for each _Retval of the cluster `graph`, whether its leading
+// dimension is that of the padded arguments when the leading dimension of the
+// arguments of rank `arg_ranks` is padded. Returns nullopt if the rows of an
+// output may depend on other rows of the arguments, e.g. because of a
+// reduction over the leading dimension, in which case padding isn't valid.
+//
+// The arguments in `constant_args`, sorted, and the scalar arguments are not
+// padded.
+std::optional<std::vector<bool>> PaddedClusterOutputs(
+    const Graph& graph, absl::Span<const int> arg_ranks,
+    absl::Span<const int> constant_args);
+
+// Decides how the inputs of the cluster `function` are padded. Thread-safe.
+class ClusterPadder {
+ public:
+  ClusterPadder(const ShapeBuckets* buckets, NameAttrList function,
+                std::vector<int> constant_args);
+
+  // Returns how to pad `inputs`, the inputs of the cluster, or nullopt if
+  // they are not padded.
+  StatusOr<std::optional<ClusterPadding>> Plan(
+      const FunctionLibraryDefinition& flib_def,
+      absl::Span<const Tensor* const> inputs);
+
+ private:
+  const ShapeBuckets* const buckets_;
+  const NameAttrList function_;
+  const std::vector<int> constant_args_;
+
+  mutex mu_;
+  std::unique_ptr<FunctionBody> fbody_ TF_GUARDED_BY(mu_);
+  // The PaddedClusterOutputs() of the cluster, by argument ranks.
+  absl::flat_hash_map<std::vector<int>, std::optional<std::vector<bool>>>
+      padded_outputs_ TF_GUARDED_BY(mu_);
+};
+
+// Sets the shapes of the padded arguments in `args`.
+Status PadCompilerArguments(const ClusterPadding& padding,
+                            std::vector<XlaCompiler::Argument>* args);
+
+// Pads the inputs of `ctx` into `padding->padded_inputs`. The first
+// `missing_ctx_input_prefix` arguments of the cluster are not inputs of
+// `ctx`.
+Status PadInputs(OpKernelContext* ctx, int missing_ctx_input_prefix,
+                 ClusterPadding* padding);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMPILER_JIT_SHAPE_BUCKETING_H_
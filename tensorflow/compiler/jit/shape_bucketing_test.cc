@@ -0,0 +1,131 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/jit/shape_bucketing.h"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "tensorflow/cc/framework/scope.h"
+#include "tensorflow/cc/ops/array_ops.h"
+#include "tensorflow/cc/ops/function_ops.h"
+#include "tensorflow/cc/ops/math_ops.h"
+#include "tensorflow/cc/ops/nn_ops.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(ShapeBucketsTest, PowersOfTwo) {
+  TF_ASSERT_OK_AND_ASSIGN(ShapeBuckets buckets, ShapeBuckets::Parse("pow2"));
+  EXPECT_EQ(buckets.Bucket(1), 1);
+  EXPECT_EQ(buckets.Bucket(5), 8);
+  EXPECT_EQ(buckets.Bucket(8), 8);
+  EXPECT_EQ(buckets.Bucket(1000), 1024);
+}
+
+TEST(ShapeBucketsTest, ListedSizes) {
+  TF_ASSERT_OK_AND_ASSIGN(ShapeBuckets buckets,
+                          ShapeBuckets::Parse("16,64,100"));
+  EXPECT_EQ(buckets.Bucket(1), 16);
+  EXPECT_EQ(buckets.Bucket(16), 16);
+  EXPECT_EQ(buckets.Bucket(17), 64);
+  EXPECT_EQ(buckets.Bucket(100), 100);
+  EXPECT_EQ(buckets.Bucket(101), std::nullopt);
+
+  EXPECT_FALSE(ShapeBuckets::Parse("").ok());
+  EXPECT_FALSE(ShapeBuckets::Parse("64,16").ok());
+  EXPECT_FALSE(ShapeBuckets::Parse("0,16").ok());
+  EXPECT_FALSE(ShapeBuckets::Parse("pow3").ok());
+}
+
+TEST(PaddedClusterOutputsTest, RowWiseOps) {
+  Scope root = Scope::NewRootScope().ExitOnError();
+  auto x = ops::_Arg(root.WithOpName("x"), DT_FLOAT, 0);
+  auto w = ops::Const(root.WithOpName("w"), 1.0f, {4, 8});
+  auto b = ops::Const(root.WithOpName("b"), 1.0f, {8});
+  auto matmul = ops::MatMul(root.WithOpName("matmul"), x, w);
+  auto bias_add = ops::BiasAdd(root.WithOpName("bias_add"), matmul, b);
+  auto relu = ops::Relu(root.WithOpName("relu"), bias_add);
+  auto scaled = ops::Mul(root.WithOpName("scaled"), relu,
+                         ops::Const(root.WithOpName("scale"), 2.0f));
+  auto softmax = ops::Softmax(root.WithOpName("softmax"), scaled);
+  auto sum = ops::Sum(root.WithOpName("sum"), softmax,
+                      ops::Const(root.WithOpName("axes"), {1}));
+  auto total = ops::Sum(root.WithOpName("total"), w,
+                        ops::Const(root.WithOpName("all_axes"), {0, 1}));
+  ops::_Retval(root.WithOpName("out0"), softmax, 0);
+  ops::_Retval(root.WithOpName("out1"), sum, 1);
+  ops::_Retval(root.WithOpName("out2"), total, 2);
+  Graph graph(OpRegistry::Global());
+  TF_ASSERT_OK(root.ToGraph(&graph));
+
+  std::optional<std::vector<bool>> padded_outputs =
+      PaddedClusterOutputs(graph, /*arg_ranks=*/{2}, /*constant_args=*/{});
+  ASSERT_TRUE(padded_outputs.has_value());
+  EXPECT_EQ(*padded_outputs, std::vector<bool>({true, true, false}));
+}
+
+TEST(PaddedClusterOutputsTest, ReductionOverPaddedDimension) {
+  Scope root = Scope::NewRootScope().ExitOnError();
+  auto x = ops::_Arg(root.WithOpName("x"), DT_FLOAT, 0);
+  auto mean = ops::Mean(root.WithOpName("mean"), x,
+                        ops::Const(root.WithOpName("axes"), {-2}));
+  ops::_Retval(root.WithOpName("out"), mean, 0);
+  Graph graph(OpRegistry::Global());
+  TF_ASSERT_OK(root.ToGraph(&graph));
+
+  EXPECT_EQ(PaddedClusterOutputs(graph, {2}, {}), std::nullopt);
+}
+
+TEST(PaddedClusterOutputsTest, BroadcastAlongPaddedDimension) {
+  for (const TensorShape& shape :
+       {TensorShape({1, 4}), TensorShape({4}), TensorShape({3, 4})}) {
+    Scope root = Scope::NewRootScope().ExitOnError();
+    auto x = ops::_Arg(root.WithOpName("x"), DT_FLOAT, 0);
+    Tensor value(DT_FLOAT, shape);
+    value.flat<float>().setZero();
+    auto add = ops::Add(root.WithOpName("add"), x,
+                        ops::Const(root.WithOpName("c"), value));
+    ops::_Retval(root.WithOpName("out"), add, 0);
+    Graph graph(OpRegistry::Global());
+    TF_ASSERT_OK(root.ToGraph(&graph));
+
+    // An unpadded operand with several rows can't be broadcast along the
+    // padded dimension.
+    EXPECT_EQ(PaddedClusterOutputs(graph, {2}, {}).has_value(),
+              shape.dim_size(0) != 3)
+        << shape.DebugString();
+  }
+}
+
+TEST(PaddedClusterOutputsTest, UnhandledOp) {
+  Scope root = Scope::NewRootScope().ExitOnError();
+  auto x = ops::_Arg(root.WithOpName("x"), DT_FLOAT, 0);
+  auto shape = ops::Shape(root.WithOpName("shape"), x);
+  ops::_Retval(root.WithOpName("out"), shape, 0);
+  Graph graph(OpRegistry::Global());
+  TF_ASSERT_OK(root.ToGraph(&graph));
+
+  EXPECT_EQ(PaddedClusterOutputs(graph, {2}, {}), std::nullopt);
+  // Unless its input isn't padded.
+  EXPECT_EQ(PaddedClusterOutputs(graph, {2}, /*constant_args=*/{0}),
+            std::vector<bool>({false}));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 #include "absl/algorithm/container.h"
 #include "absl/container/inlined_vector.h"
@@ -29,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/graph/control_flow.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/strings/proto_serialization.h"
@@ -592,10 +594,28 @@ StatusOr<absl::flat_hash_set<Node*>> GetNodesRelatedToRefVariables(
   return result;
 }
 
-StatusOr<std::string> SerializeGraphDeterministic(const Graph& graph) {
+StatusOr<std::string> SerializeGraphDeterministic(
+    const Graph& graph,
+    const absl::flat_hash_set<std::string>& ignored_constant_values) {
   GraphDef def;
   graph.ToGraphDef(&def);
 
+  if (!ignored_constant_values.empty()) {
+    for (NodeDef& node : *def.mutable_node()) {
+      if (node.op() != "Const" ||
+          !ignored_constant_values.contains(node.name())) {
+        continue;
+      }
+      auto it = node.mutable_attr()->find("value");
+      if (it == node.mutable_attr()->end()) continue;
+      TensorProto* value = it->second.mutable_tensor();
+      TensorProto type_and_shape;
+      type_and_shape.set_dtype(value->dtype());
+      *type_and_shape.mutable_tensor_shape() = value->tensor_shape();
+      *value = std::move(type_and_shape);
+    }
+  }
+
   // Before serialization, sort each node's control inputs to achieve
   // determinism. Sorting control inputs could help (but not necessarily) create
   // a deterministic serialization and fingerprint. Other sources of
@@ -609,9 +629,12 @@ StatusOr<std::string> SerializeGraphDeterministic(const Graph& graph) {
   return s;
 }
 
-StatusOr<uint64> FingerprintGraph(const Graph& graph) {
-  TF_ASSIGN_OR_RETURN(std::string serialized,
-                      SerializeGraphDeterministic(graph));
+StatusOr<uint64> FingerprintGraph(
+    const Graph& graph,
+    const absl::flat_hash_set<std::string>& ignored_constant_values) {
+  TF_ASSIGN_OR_RETURN(
+      std::string serialized,
+      SerializeGraphDeterministic(graph, ignored_constant_values));
   return Hash64(serialized.data(), serialized.size());
 }
 
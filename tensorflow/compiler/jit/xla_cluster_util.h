@@ -100,13 +100,20 @@ XlaAutoClusteringSummary GetXlaAutoClusteringSummary(const Graph& graph);
 StatusOr<absl::flat_hash_set<Node*>> GetNodesRelatedToRefVariables(
     const Graph& graph, FunctionLibraryRuntime* lib_runtime);
 
-// Deterministically serialized the graph to a byte string.
-StatusOr<std::string> SerializeGraphDeterministic(const Graph& graph);
+// Deterministically serialized the graph to a byte string. Only the types and
+// shapes of the values of the Const nodes named in `ignored_constant_values`
+// are serialized.
+StatusOr<std::string> SerializeGraphDeterministic(
+    const Graph& graph,
+    const absl::flat_hash_set<std::string>& ignored_constant_values = {});
 
 // Computes a fingerprint of the given `graph`. The fingerprint can use used to
 // check if two graphs are likely the same but should not be relied on
-// determining if the graphs are identical.
-StatusOr<uint64> FingerprintGraph(const Graph& graph);
+// determining if the graphs are identical. The fingerprint doesn't depend on
+// the values of the Const nodes named in `ignored_constant_values`.
+StatusOr<uint64> FingerprintGraph(
+    const Graph& graph,
+    const absl::flat_hash_set<std::string>& ignored_constant_values = {});
 
 }  // namespace tensorflow
 
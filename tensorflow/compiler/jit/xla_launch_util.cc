@@ -303,7 +303,8 @@ XlaComputationLaunchContext::PopulateInputs(
     const XlaCompiler::CompilationResult* compilation_result,
     const std::map<int, const Tensor*>& resource_vars,
     int missing_ctx_input_prefix,
-    const xla::HloInputOutputAliasConfig& input_output_alias) {
+    const xla::HloInputOutputAliasConfig& input_output_alias,
+    const ClusterPadding* padding) {
   std::vector<xla::ExecutionInput> arguments;
   arguments.reserve(compilation_result->xla_input_shapes.size());
 
@@ -329,6 +330,10 @@ XlaComputationLaunchContext::PopulateInputs(
     const Tensor* t = is_resource_variable
                           ? resource_vars.at(arg_num)
                           : &(ctx->input(arg_num - missing_ctx_input_prefix));
+    if (padding != nullptr) {
+      auto it = padding->padded_inputs.find(arg_num);
+      if (it != padding->padded_inputs.end()) t = &it->second;
+    }
     CHECK(t);
     bool donate_buffer =
         t->RefCountIsOne() && is_updated_resource_variable &&
@@ -513,7 +518,8 @@ Status XlaComputationLaunchContext::PopulateOutputs(
     ScopedShapedBuffer output, int missing_ctx_input_prefix,
     absl::Span<VariableInfo> variable_infos,
     const xla::HloInputOutputAliasConfig& input_output_alias,
-    const std::map<int, const Tensor*>& resource_vars) {
+    const std::map<int, const Tensor*>& resource_vars,
+    const ClusterPadding* padding) {
   se::Stream* stream =
       ctx->op_device_context() ? ctx->op_device_context()->stream() : nullptr;
   Allocator* allocator = ctx->device()->GetAllocator({});
@@ -588,6 +594,18 @@ Status XlaComputationLaunchContext::PopulateOutputs(
       output_tensor_shapes.push_back(compilation_result->outputs[i].shape);
     }
   }
+  if (padding != nullptr) {
+    // The leading rows are a prefix of the output buffers, which only need to
+    // be given the unpadded shapes.
+    TF_RET_CHECK(!allocate_xla_tensors_);
+    TF_RET_CHECK(padding->padded_outputs.size() == output_tensor_shapes.size());
+    for (int i = 0; i < padding->padded_outputs.size(); ++i) {
+      if (!padding->padded_outputs[i]) continue;
+      TF_RET_CHECK(output_tensor_shapes[i].dims() > 0 &&
+                   output_tensor_shapes[i].dim_size(0) == padding->bucket);
+      output_tensor_shapes[i].set_dim(0, padding->size);
+    }
+  }
 
   // Copy XLA results to the OpOutputList.
   int output_num = 0;
@@ -657,6 +675,7 @@ Status XlaComputationLaunchContext::PopulateOutputs(
                                    use_multiple_streams_, definition_event));
     var->is_initialized |= write.modified;
     *var->tensor() = output_tensor;
+    if (write.modified) var->MarkAllRowsDirty();
     ++output_num;
   }
   return OkStatus();
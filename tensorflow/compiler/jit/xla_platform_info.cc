@@ -20,6 +20,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/jit/device_compiler_client.h"
 #include "tensorflow/compiler/jit/device_executable_persistor.h"
 #include "tensorflow/compiler/jit/flags.h"
@@ -32,6 +33,18 @@ namespace tensorflow {
 namespace {
 using XlaDeviceCompiler =
     DeviceCompiler<xla::LocalExecutable, xla::LocalClient>;
+
+// Describes the device of `client` for the persistent compilation cache.
+std::string GetDeviceDescription(const xla::LocalClient* client) {
+  if (client == nullptr) {
+    return "";
+  }
+  const se::DeviceDescription& description =
+      client->backend().default_stream_executor()->GetDeviceDescription();
+  return absl::StrCat(client->platform()->Name(), ":", description.name(),
+                      ":", description.model_str(), ":",
+                      description.platform_version());
+}
 }  // namespace
 
 xla::StatusOr<std::optional<std::set<int>>> ParseVisibleDeviceList(
@@ -64,15 +77,23 @@ Status BuildXlaDeviceCompiler(DeviceBase* device, FunctionLibraryRuntime* flr,
       GetMarkForCompilationPassFlags()->tf_xla_persistent_cache_directory,
       GetMarkForCompilationPassFlags()->tf_xla_disable_strict_signature_checks,
       GetMarkForCompilationPassFlags()->tf_xla_persistent_cache_prefix);
+  persistor_config.persistent_cache_max_size_bytes =
+      GetMarkForCompilationPassFlags()->tf_xla_persistent_cache_max_size_bytes;
+  persistor_config.remote_cache_directory =
+      GetMarkForCompilationPassFlags()
+          ->tf_xla_persistent_cache_remote_directory;
 
   if (platform_info.xla_device_metadata()) {
+    persistor_config.device_description =
+        GetDeviceDescription(platform_info.xla_device_metadata()->client());
     auto persistor = std::make_unique<XlaDeviceExecutablePersistor>(
         std::move(persistor_config),
         platform_info.xla_device_metadata()->jit_device_type());
     auto compiler_client = std::make_unique<XlaDeviceCompilerClient>(
         platform_info.xla_device_metadata()->client());
-    *xla_device_compiler =
-        new XlaDeviceCompiler(std::move(persistor), std::move(compiler_client));
+    *xla_device_compiler = new XlaDeviceCompiler(
+        std::move(persistor), std::move(compiler_client),
+        GetXlaOpsCommonFlags()->tf_xla_max_concurrent_async_compilations);
     return OkStatus();
   }
 
@@ -82,8 +103,9 @@ Status BuildXlaDeviceCompiler(DeviceBase* device, FunctionLibraryRuntime* flr,
     auto persistor = std::make_unique<XlaDeviceExecutablePersistor>(
         std::move(persistor_config), DeviceType(DEVICE_TPU_XLA_JIT));
     auto compiler_client = std::make_unique<XlaDeviceCompilerClient>(nullptr);
-    *xla_device_compiler =
-        new XlaDeviceCompiler(std::move(persistor), std::move(compiler_client));
+    *xla_device_compiler = new XlaDeviceCompiler(
+        std::move(persistor), std::move(compiler_client),
+        GetXlaOpsCommonFlags()->tf_xla_max_concurrent_async_compilations);
     return OkStatus();
   }
 
@@ -138,13 +160,15 @@ Status BuildXlaDeviceCompiler(DeviceBase* device, FunctionLibraryRuntime* flr,
                                    platform_info.device_type().type());
   }
 
+  persistor_config.device_description = GetDeviceDescription(client.value());
   auto persistor = std::make_unique<XlaDeviceExecutablePersistor>(
       std::move(persistor_config),
       DeviceType(registration->compilation_device_name));
   auto compiler_client =
       std::make_unique<XlaDeviceCompilerClient>(client.value());
-  *xla_device_compiler =
-      new XlaDeviceCompiler(std::move(persistor), std::move(compiler_client));
+  *xla_device_compiler = new XlaDeviceCompiler(
+      std::move(persistor), std::move(compiler_client),
+      GetXlaOpsCommonFlags()->tf_xla_max_concurrent_async_compilations);
   return OkStatus();
 }
 
@@ -19,11 +19,13 @@ limitations under the License.
 #include "absl/memory/memory.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/compiler/tf2tensorrt/common/utils.h"
 #include "tensorflow/compiler/tf2tensorrt/convert/convert_nodes.h"
 #include "tensorflow/compiler/tf2tensorrt/convert/utils.h"
 #include "tensorflow/compiler/tf2tensorrt/utils/trt_allocator.h"
+#include "tensorflow/compiler/tf2tensorrt/utils/trt_engine_instance.pb.h"  // NOLINT
 #include "tensorflow/compiler/tf2tensorrt/utils/trt_engine_utils.h"
 #include "tensorflow/compiler/tf2tensorrt/utils/trt_logger.h"
 #include "tensorflow/compiler/tf2tensorrt/utils/trt_lru_cache.h"
@@ -40,11 +42,17 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/utils.h"
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
 #include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/stream_executor.h"
+#include "tensorflow/core/platform/tensor_float_32_utils.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
@@ -196,6 +204,26 @@ class TRTEngineOp : public AsyncOpKernel {
       bool use_calibration, TRTInt8Calibrator* calibrator,
       TRTEngineCacheResource* cache_resource, OpKernelContext* ctx);
 
+  // Returns the key of the engine for the input shapes in the persistent
+  // engine cache. It covers everything the engine depends on: the segment, the
+  // conversion parameters, the optimization profiles, the TensorRT version and
+  // the GPU model.
+  StatusOr<string> GetEngineCacheKey(
+      const std::vector<PartialTensorShape>& conversion_input_shapes,
+      int batch_size, const TrtShapeOptimizationProfile& profiles,
+      OpKernelContext* ctx);
+
+  // Loads the engine stored under `key` in the persistent engine cache and
+  // restores its optimization profiles. Returns nullptr if there is no such
+  // engine or it can't be loaded.
+  TrtUniquePtrType<nvinfer1::ICudaEngine> LoadCachedEngine(
+      const string& cache_dir, const string& key,
+      TRTEngineCacheResource* cache_resource, OpKernelContext* ctx);
+
+  // Stores `engine` under `key` in the persistent engine cache.
+  Status SaveCachedEngine(const string& cache_dir, const string& key,
+                          nvinfer1::ICudaEngine* engine, Env* env);
+
   // Verify that the input shapes are consistent and can be handled by this op.
   Status VerifyInputShapes(const std::vector<TensorShape>& shapes);
 
@@ -1066,6 +1094,143 @@ Status TRTEngineOp::GetEngineCacheResource(OpKernelContext* ctx,
       }});
 }
 
+// Returns the directory of the persistent engine cache, or an empty string if
+// it is disabled. The engines built at runtime are saved there, and loaded
+// instead of being built again, e.g. by restarted serving replicas.
+static string GetEngineCacheDir() {
+  string value;
+  Status status =
+      ReadStringFromEnvVar("TF_TRT_ENGINE_CACHE_DIR", /*default_val=*/"",
+                           &value);
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+  }
+  return value;
+}
+
+static string GetEngineCacheFilename(const string& cache_dir,
+                                     const string& key) {
+  return io::JoinPath(cache_dir,
+                      StrCat("trt_engine_", strings::FpToString(
+                                                Fingerprint64(key))));
+}
+
+StatusOr<string> TRTEngineOp::GetEngineCacheKey(
+    const std::vector<PartialTensorShape>& conversion_input_shapes,
+    int batch_size, const TrtShapeOptimizationProfile& profiles,
+    OpKernelContext* ctx) {
+  string segment;
+  if (!SerializeToStringDeterministic(segment_graph_def_, &segment)) {
+    return errors::Internal("Failed to serialize the segment of ", name());
+  }
+  string precision_mode;
+  TF_RETURN_IF_ERROR(TrtPrecisionModeToName(precision_mode_, &precision_mode));
+  const int platform_device_id =
+      ctx->device()->tensorflow_accelerator_device_info()->gpu_id;
+  cudaDeviceProp device_prop;
+  cudaError_t err = cudaGetDeviceProperties(&device_prop, platform_device_id);
+  if (err != cudaSuccess) {
+    return errors::Internal("Failed to get the properties of GPU ",
+                            platform_device_id, ": ", cudaGetErrorString(err));
+  }
+  return StrCat(
+      name(), ", Segment:", Fingerprint64(segment),
+      ", Precision:", precision_mode, ", Implicit-Batch:", use_implicit_batch_,
+      ", Batch-Size:", batch_size,
+      ", Explicit-Precision:", use_explicit_precision_,
+      ", Max-Workspace-Size:", workspace_size_,
+      ", TF32:", tensor_float_32_execution_enabled(),
+      ", Input-Shapes:", DebugString(conversion_input_shapes),
+      ", Profiles:",
+      use_implicit_batch_ ? "" : profiles.GetProfilesDebugString(),
+      ", TRT:", absl::StrJoin(GetLoadedTensorRTVersion(), "."),
+      ", GPU:", device_prop.name, " ", device_prop.major, ".",
+      device_prop.minor);
+}
+
+TrtUniquePtrType<nvinfer1::ICudaEngine> TRTEngineOp::LoadCachedEngine(
+    const string& cache_dir, const string& key,
+    TRTEngineCacheResource* cache_resource, OpKernelContext* ctx) {
+  tensorflow::profiler::TraceMe activity(
+      "TRTEngineOp::LoadCachedEngine",
+      tensorflow::profiler::TraceMeLevel::kInfo);
+  const string filename = GetEngineCacheFilename(cache_dir, key);
+  if (!ctx->env()->FileExists(filename).ok()) return nullptr;
+
+  string contents;
+  Status status = ReadFileToString(ctx->env(), filename, &contents);
+  TRTEngineInstance engine_instance;
+  if (!status.ok() || !engine_instance.ParseFromString(contents)) {
+    LOG_FIRST_FEW_WARNING_WITH_PREFIX << "Failed to read the cached engine "
+                                      << filename << " for " << name() << ": "
+                                      << status;
+    return nullptr;
+  }
+  if (engine_instance.cache_key() != key) {
+    VLOG(1) << "The cached engine " << filename << " does not match " << key;
+    return nullptr;
+  }
+
+  TrtUniquePtrType<IRuntime> infer(nvinfer1::createInferRuntime(logger));
+  infer->setGpuAllocator(cache_resource->allocator_.get());
+  // Need to initialize plugins in order to deserialize engines that contain
+  // plugins.
+  MaybeInitializeTrtPlugins(&logger);
+  TrtUniquePtrType<nvinfer1::ICudaEngine> engine(infer->deserializeCudaEngine(
+      engine_instance.serialized_engine().c_str(),
+      engine_instance.serialized_engine().size(), nullptr));
+  if (!engine) {
+    LOG_FIRST_FEW_WARNING_WITH_PREFIX << "Failed to deserialize the cached "
+                                      << "engine " << filename << " for "
+                                      << name();
+    return nullptr;
+  }
+  if (!use_implicit_batch_) {
+    // The profiles are normally finalized when building the engine, so
+    // restore them from the engine instead, as InitializeTRTResource does.
+    TrtShapeOptimizationProfile profiles = cache_resource->profiles_;
+    profiles.clear();
+    status = profiles.RestoreProfiles(engine.get(), ctx->num_inputs());
+    if (!status.ok()) {
+      LOG_FIRST_FEW_WARNING_WITH_PREFIX << "Failed to restore the profiles of "
+                                        << "the cached engine " << filename
+                                        << " for " << name() << ": " << status;
+      return nullptr;
+    }
+    cache_resource->profiles_ = std::move(profiles);
+  }
+  VLOG(1) << "Loaded the cached engine " << filename << " for " << name();
+  return engine;
+}
+
+Status TRTEngineOp::SaveCachedEngine(const string& cache_dir,
+                                     const string& key,
+                                     nvinfer1::ICudaEngine* engine, Env* env) {
+  tensorflow::profiler::TraceMe activity(
+      "TRTEngineOp::SaveCachedEngine",
+      tensorflow::profiler::TraceMeLevel::kInfo);
+  TRTEngineInstance engine_instance;
+  engine_instance.set_cache_key(key);
+  TrtUniquePtrType<nvinfer1::IHostMemory> engine_data(engine->serialize());
+  engine_instance.set_serialized_engine(engine_data->data(),
+                                        engine_data->size());
+
+  // Write to a temporary file first, so that concurrent readers, e.g. other
+  // replicas sharing the directory, never see a partially written engine.
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(cache_dir));
+  const string filename = GetEngineCacheFilename(cache_dir, key);
+  string tmp_filename = filename;
+  if (!env->CreateUniqueFileName(&tmp_filename, ".tmp")) {
+    return errors::Internal("Failed to create a temporary file for ",
+                            filename);
+  }
+  TF_RETURN_IF_ERROR(WriteStringToFile(env, tmp_filename,
+                                       engine_instance.SerializeAsString()));
+  TF_RETURN_IF_ERROR(env->RenameFile(tmp_filename, filename));
+  VLOG(1) << "Saved the engine for " << name() << " to " << filename;
+  return OkStatus();
+}
+
 StatusOr<TrtUniquePtrType<nvinfer1::ICudaEngine>> TRTEngineOp::BuildEngine(
     const std::vector<TensorShape>& input_concrete_shapes, int batch_size,
     bool use_calibration, TRTInt8Calibrator* calibrator,
@@ -1084,6 +1249,24 @@ StatusOr<TrtUniquePtrType<nvinfer1::ICudaEngine>> TRTEngineOp::BuildEngine(
                                             input_concrete_shapes.end())
           : input_partial_shapes_;
 
+  // Look for the engine in the persistent engine cache. Calibrated engines are
+  // not cached, since the key doesn't cover the calibration table.
+  const string cache_dir = GetEngineCacheDir();
+  string cache_key;
+  if (!cache_dir.empty() && !use_calibration) {
+    StatusOr<string> key = GetEngineCacheKey(
+        conversion_input_shapes, batch_size, cache_resource->profiles_, ctx);
+    if (key.ok()) {
+      cache_key = std::move(key).value();
+      TrtUniquePtrType<nvinfer1::ICudaEngine> engine =
+          LoadCachedEngine(cache_dir, cache_key, cache_resource, ctx);
+      if (engine) return engine;
+    } else {
+      LOG_FIRST_FEW_WARNING_WITH_PREFIX << "Not caching the engine for "
+                                        << name() << ": " << key.status();
+    }
+  }
+
   VLOG(1) << "Building a new TensorRT engine for " << name()
           << " with input shapes: " << DebugString(conversion_input_shapes);
 
@@ -1111,6 +1294,13 @@ StatusOr<TrtUniquePtrType<nvinfer1::ICudaEngine>> TRTEngineOp::BuildEngine(
                                    std::make_unique<EngineContext>());
     return status;
   }
+  if (!cache_key.empty()) {
+    status = SaveCachedEngine(cache_dir, cache_key, engine.get(), ctx->env());
+    if (!status.ok()) {
+      LOG_FIRST_FEW_WARNING_WITH_PREFIX << "Failed to cache the engine for "
+                                        << name() << ": " << status;
+    }
+  }
   return engine;
 }
 
@@ -46,6 +46,8 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/public/version.h"
@@ -283,6 +285,52 @@ TEST_F(TRTEngineOpTestBase, AllowBuildAtRuntime) {
   EXPECT_EQ(ectx->GetCudaEngine(), nullptr);
 }
 
+// Sets TF_TRT_ENGINE_CACHE_DIR for the duration of each test, even if it
+// fails, so that the other tests build their engines.
+class TRTEngineOpPersistentCacheTest : public TRTEngineOpTestBase {
+ protected:
+  TRTEngineOpPersistentCacheTest()
+      : cache_dir_(io::JoinPath(testing::TmpDir(), "persistent_engine_cache")) {
+    setenv("TF_TRT_ENGINE_CACHE_DIR", cache_dir_.c_str(), /*overwrite=*/1);
+  }
+
+  ~TRTEngineOpPersistentCacheTest() override {
+    unsetenv("TF_TRT_ENGINE_CACHE_DIR");
+  }
+
+  const string cache_dir_;
+};
+
+TEST_F(TRTEngineOpPersistentCacheTest, PersistentEngineCache) {
+  TRTEngineOpTestBase::AddSimpleTrtOp(DT_FLOAT);
+
+  // Building the engine saves it to the cache directory.
+  TensorShape input_shape({2, 2});
+  TRTEngineOpTestBase::AddSimpleInput<float>(input_shape);
+  TF_ASSERT_OK(OpsTestBase::RunOpKernel());
+  std::vector<string> children;
+  TF_ASSERT_OK(Env::Default()->GetChildren(cache_dir_, &children));
+  ASSERT_EQ(children.size(), 1);
+
+  // A new engine cache, e.g. after restarting the process, loads the engine
+  // instead of building it again, which keeps the cached file unchanged.
+  TF_ASSERT_OK(device_->resource_manager()->Delete<TRTEngineCacheResource>(
+      std::string(kTfTrtContainerName), std::string(kOpName)));
+  TF_ASSERT_OK(OpsTestBase::RunOpKernel());
+  test::ExpectTensorEqual<float>(
+      *OpsTestBase::GetOutput(0),
+      test::AsTensor<float>({0, 2, 4, 6}, input_shape));
+  TRTEngineCacheResource* cache_resource = nullptr;
+  TF_ASSERT_OK(device_->resource_manager()->Lookup(
+      std::string(kTfTrtContainerName), std::string(kOpName), &cache_resource));
+  core::ScopedUnref sc(cache_resource);
+  ASSERT_EQ(1, cache_resource->cache_.count({input_shape}));
+  EXPECT_NE(cache_resource->cache_.at({input_shape})->GetCudaEngine(),
+            nullptr);
+  TF_ASSERT_OK(Env::Default()->GetChildren(cache_dir_, &children));
+  EXPECT_EQ(children.size(), 1);
+}
+
 TEST_P(TRTEngineOpTestWithParam, ExplicitBatch) {
   // Test inference in explicit batch mode with static input shapes. Static
   // shapes in this context means that the TensorRT knows all the input shapes
@@ -646,6 +646,14 @@ int TrtShapeOptimizationProfile::GetNumProfiles() const {
   return profiles_.size();
 }
 
+string TrtShapeOptimizationProfile::GetProfilesDebugString() const {
+  string result;
+  for (const OptimizationProfileConfig& profile : profiles_) {
+    StrAppend(&result, profile.DebugString());
+  }
+  return result;
+}
+
 }  // namespace tensorrt
 }  // namespace tensorflow
 #endif  // GOOGLE_CUDA && GOOGLE_TENSORRT
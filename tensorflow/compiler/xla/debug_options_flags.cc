@@ -75,6 +75,11 @@ DebugOptions DefaultDebugOptionsIgnoringFlags() {
 
   // TODO(b/258036887): Remove this flag once CUDA Graphs are fully supported.
   opts.set_xla_gpu_enable_cuda_graphs(false);
+  opts.set_xla_gpu_cuda_graph_min_graph_size(2);
+  opts.set_xla_gpu_attention_key_block_size(0);
+  opts.set_xla_gpu_max_concurrent_streams(1);
+  opts.set_xla_gpu_enable_lazy_parameter_waits(false);
+  opts.set_xla_hlo_pass_computation_threads(1);
 
   // Despite the name, fast min/max on GPUs does not seem to be any faster, and
   // adds very counter-intuitive "NaN-swallowing" behavior.
@@ -103,6 +108,8 @@ DebugOptions DefaultDebugOptionsIgnoringFlags() {
   opts.set_xla_gpu_simplify_all_fp_conversions(true);
   opts.set_xla_dump_latency_hiding_schedule(false);
   opts.set_xla_gpu_enable_latency_hiding_scheduler(false);
+  opts.set_xla_dump_hlo_pass_stats(false);
+  opts.set_xla_gpu_enable_collective_matmul(false);
 
   opts.set_xla_cpu_enable_mlir_tiling_and_fusion(false);
   return opts;
@@ -766,6 +773,46 @@ void MakeDebugOptionsFlags(std::vector<tsl::Flag>* flag_list,
       bool_setter_for(&DebugOptions::set_xla_gpu_enable_cuda_graphs),
       debug_options->xla_gpu_enable_cuda_graphs(),
       "Use CUDA graphs to execute XLA GPU executables when possible."));
+  flag_list->push_back(tsl::Flag(
+      "xla_gpu_cuda_graph_min_graph_size",
+      int64_setter_for(&DebugOptions::set_xla_gpu_cuda_graph_min_graph_size),
+      debug_options->xla_gpu_cuda_graph_min_graph_size(),
+      "Capture only the runs of at least this many consecutive thunks into "
+      "CUDA graphs."));
+  flag_list->push_back(tsl::Flag(
+      "xla_gpu_autotune_cache_dir",
+      string_setter_for(&DebugOptions::set_xla_gpu_autotune_cache_dir),
+      debug_options->xla_gpu_autotune_cache_dir(),
+      "Directory shared by all the processes to read and persist the GEMM and "
+      "convolution autotuning results. Empty disables the shared cache."));
+  flag_list->push_back(tsl::Flag(
+      "xla_gpu_attention_key_block_size",
+      int64_setter_for(&DebugOptions::set_xla_gpu_attention_key_block_size),
+      debug_options->xla_gpu_attention_key_block_size(),
+      "Compute the attentions over blocks of this many keys with an online "
+      "softmax, so that the scores of all the keys are never materialized. 0 "
+      "disables the rewrite."));
+  flag_list->push_back(tsl::Flag(
+      "xla_gpu_max_concurrent_streams",
+      int64_setter_for(&DebugOptions::set_xla_gpu_max_concurrent_streams),
+      debug_options->xla_gpu_max_concurrent_streams(),
+      "Run the independent kernels and GEMMs that underutilize the GPU "
+      "concurrently on up to this many streams. 1 runs all of them on the "
+      "main stream."));
+  flag_list->push_back(tsl::Flag(
+      "xla_gpu_enable_lazy_parameter_waits",
+      bool_setter_for(&DebugOptions::set_xla_gpu_enable_lazy_parameter_waits),
+      debug_options->xla_gpu_enable_lazy_parameter_waits(),
+      "Wait for each argument of a GPU executable just before its first use, "
+      "so that the execution overlaps with the transfers of the other "
+      "arguments."));
+  flag_list->push_back(tsl::Flag(
+      "xla_hlo_pass_computation_threads",
+      int64_setter_for(&DebugOptions::set_xla_hlo_pass_computation_threads),
+      debug_options->xla_hlo_pass_computation_threads(),
+      "Run the HLO passes which support it on the computations of a module "
+      "concurrently, on this many threads. 1 runs them on one computation "
+      "after the other."));
   flag_list->push_back(
       tsl::Flag("xla_dump_disable_metadata",
                 bool_setter_for(&DebugOptions::set_xla_dump_disable_metadata),
@@ -843,6 +890,25 @@ void MakeDebugOptionsFlags(std::vector<tsl::Flag>* flag_list,
       bool_setter_for(&DebugOptions::set_xla_dump_latency_hiding_schedule),
       debug_options->xla_dump_latency_hiding_schedule(),
       "Dump the schedule from the latency-hiding scheduler."));
+  flag_list->push_back(tsl::Flag(
+      "xla_dump_hlo_pass_stats",
+      bool_setter_for(&DebugOptions::set_xla_dump_hlo_pass_stats),
+      debug_options->xla_dump_hlo_pass_stats(),
+      "Collect the wall time, the peak RSS increase and the instruction counts "
+      "of each HLO pass, export them via tsl::monitoring and dump them as JSON "
+      "to --xla_dump_to."));
+  flag_list->push_back(tsl::Flag(
+      "xla_gpu_pgle_profile_file",
+      string_setter_for(&DebugOptions::set_xla_gpu_pgle_profile_file),
+      debug_options->xla_gpu_pgle_profile_file(),
+      "Text or binary ProfiledInstructionsProto with the measured instruction "
+      "costs and collective latencies used by the latency-hiding scheduler."));
+  flag_list->push_back(tsl::Flag(
+      "xla_gpu_enable_collective_matmul",
+      bool_setter_for(&DebugOptions::set_xla_gpu_enable_collective_matmul),
+      debug_options->xla_gpu_enable_collective_matmul(),
+      "Overlap the all-gathers feeding dots and the dots feeding "
+      "reduce-scatters with partial dots over a ring of collective-permutes."));
   flag_list->push_back(tsl::Flag(
       "xla_cpu_enable_mlir_tiling_and_fusion",
       bool_setter_for(&DebugOptions::set_xla_cpu_enable_mlir_tiling_and_fusion),
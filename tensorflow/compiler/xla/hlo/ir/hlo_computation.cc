@@ -141,7 +141,9 @@ HloInstruction* HloComputation::AddInstruction(
 HloInstruction* HloComputation::AddInstructionInternal(
     std::unique_ptr<HloInstruction> instruction) {
   if (parent() != nullptr) {
-    instruction->UniquifyName(&parent()->instruction_name_uniquer());
+    if (!parent()->defer_instruction_name_uniquing()) {
+      instruction->UniquifyName(&parent()->instruction_name_uniquer());
+    }
     instruction->SetUniqueId(parent()->NewUniqueInstructionId());
   }
   instruction->set_parent(this);
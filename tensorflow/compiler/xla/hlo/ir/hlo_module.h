@@ -384,11 +384,20 @@ class HloModule {
   // Returns the NameUniquer for uniquing instruction names in this module.
   NameUniquer& instruction_name_uniquer() { return instruction_name_uniquer_; }
 
-  // Assign a new unique dense id for an instruction
+  // Assign a new unique dense id for an instruction. Thread-safe.
   int NewUniqueInstructionId() {
-    int result = next_unique_id_;
-    next_unique_id_++;
-    return result;
+    return next_unique_id_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // While set, the instructions added to the computations of the module keep
+  // their names instead of being given unique ones, which lets several threads
+  // add instructions to different computations concurrently. The names are to
+  // be made unique once it is cleared, see HloComputationPass.
+  void set_defer_instruction_name_uniquing(bool defer) {
+    defer_instruction_name_uniquing_ = defer;
+  }
+  bool defer_instruction_name_uniquing() const {
+    return defer_instruction_name_uniquing_;
   }
 
   // input_output_alias_config indicates the list of aliased buffers that are
@@ -596,7 +605,8 @@ class HloModule {
   // unique per module.
   NameUniquer computation_name_uniquer_{/*separator=*/"."};
   NameUniquer instruction_name_uniquer_{/*separator=*/"."};
-  int next_unique_id_ = 0;
+  std::atomic<int> next_unique_id_{0};
+  bool defer_instruction_name_uniquing_ = false;
 
   // Used to keep track of the next unique module id that should be assigned.
   static std::atomic<int> next_unique_module_id_;
@@ -801,6 +801,53 @@ const size_t PJRT_LoadedExecutable_Execute_Args_STRUCT_SIZE = PJRT_STRUCT_SIZE(
 typedef PJRT_Error* PJRT_LoadedExecutable_Execute(
     PJRT_LoadedExecutable_Execute_Args* args);
 
+typedef struct {
+  size_t struct_size;
+  void* priv;
+  PJRT_LoadedExecutable* executable;
+  // Only needs to stay alive for the duration of the ExecuteBatch call.
+  PJRT_ExecuteOptions* options;
+  // Execution inputs of size [`num_executions`, `num_devices`, `num_args`],
+  // where `argument_lists[i]` are the argument lists of the i-th execution as
+  // in PJRT_LoadedExecutable_Execute_Args. The lists only need to stay alive
+  // for the duration of the ExecuteBatch call, but the argument buffers must
+  // not be destroyed before the i-th `dispatch_events` is ready.
+  PJRT_Buffer**** argument_lists;
+  size_t num_executions;
+  size_t num_devices;
+  size_t num_args;
+  // Execution outputs of size [`num_executions`, `num_devices`,
+  // `num_outputs`]. All the lists must be allocated by the caller and stay
+  // alive until the corresponding `dispatch_events` is ready, at which point
+  // `output_lists[i]` is populated as in PJRT_LoadedExecutable_Execute_Args
+  // unless the event has an error.
+  PJRT_Buffer**** output_lists;  // in/out
+  // Of length `num_executions`. The i-th event becomes ready once the i-th
+  // execution has been dispatched, with the error of the dispatch if any. The
+  // caller is responsible for calling PJRT_Event_Destroy on the returned
+  // PJRT_Event*s.
+  PJRT_Event** dispatch_events;  // in/out
+  // If `device_complete_events` isn't nullptr, it must be of size
+  // [`num_executions`, `num_devices`], and each `PJRT_Event` will become ready
+  // once the corresponding device execution is complete, or with the error of
+  // the dispatch if it fails. The caller is responsible for calling
+  // PJRT_Event_Destroy on the returned PJRT_Event*s.
+  PJRT_Event*** device_complete_events;  // in/out
+} PJRT_LoadedExecutable_ExecuteBatch_Args;
+const size_t PJRT_LoadedExecutable_ExecuteBatch_Args_STRUCT_SIZE =
+    PJRT_STRUCT_SIZE(PJRT_LoadedExecutable_ExecuteBatch_Args,
+                     device_complete_events);
+
+// Dispatches `num_executions` executions of `executable` asynchronously, on
+// the devices specified at compile time, and returns once they are queued.
+// The executions are dispatched in order by a queue per device, from a thread
+// of the implementation, so that hosts issuing many small executions don't pay
+// for the dispatch on their own thread. The queues are bounded: if too many
+// executions are already queued for the devices of `executable`, the call
+// blocks until the queue drains enough to hold the new ones.
+typedef PJRT_Error* PJRT_LoadedExecutable_ExecuteBatch(
+    PJRT_LoadedExecutable_ExecuteBatch_Args* args);
+
 typedef struct {
   size_t struct_size;
   void* priv;
@@ -1156,10 +1203,12 @@ typedef struct {
   _PJRT_API_STRUCT_FIELD(PJRT_Buffer_IsOnCpu);
   _PJRT_API_STRUCT_FIELD(PJRT_Buffer_ReadyEvent);
   _PJRT_API_STRUCT_FIELD(PJRT_Buffer_UnsafePointer);
+
+  _PJRT_API_STRUCT_FIELD(PJRT_LoadedExecutable_ExecuteBatch);
 } PJRT_Api;
 
 const size_t PJRT_Api_STRUCT_SIZE =
-    PJRT_STRUCT_SIZE(PJRT_Api, PJRT_Buffer_UnsafePointer);
+    PJRT_STRUCT_SIZE(PJRT_Api, PJRT_LoadedExecutable_ExecuteBatch);
 
 #undef _PJRT_API_STRUCT_FIELD
 
@@ -14,10 +14,18 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/compiler/xla/pjrt/c/pjrt_c_api_cpu.h"
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include <gtest/gtest.h>
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/literal_util.h"
 #include "tensorflow/compiler/xla/pjrt/c/pjrt_c_api.h"
 #include "tensorflow/compiler/xla/pjrt/c/pjrt_c_api_wrapper_impl.h"
 #include "tensorflow/compiler/xla/pjrt/pjrt_client.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/tsl/platform/errors.h"
 
 namespace xla {
 namespace pjrt {
@@ -60,6 +68,94 @@ class PjrtCApiCpuTest : public ::testing::Test {
     CHECK_NE(create_args.client, nullptr);
     return create_args.client;
   }
+
+  // Compiles `x + 1` for a scalar F32 `x`.
+  std::unique_ptr<PJRT_LoadedExecutable> make_add_one_executable() {
+    xla::XlaBuilder builder("add_one");
+    xla::XlaOp x = xla::Parameter(
+        &builder, 0, xla::ShapeUtil::MakeScalarShape(xla::F32), "x");
+    xla::Add(x, xla::ConstantR0<float>(&builder, 1.0f));
+    xla::XlaComputation computation = builder.Build().value();
+    std::unique_ptr<xla::PjRtLoadedExecutable> executable =
+        cc_client_->Compile(computation, xla::CompileOptions()).value();
+    return std::make_unique<PJRT_LoadedExecutable>(std::move(executable),
+                                                   client_);
+  }
+
+  std::unique_ptr<PJRT_Buffer> make_buffer(const xla::Literal& literal) {
+    std::unique_ptr<xla::PjRtBuffer> buffer =
+        cc_client_
+            ->BufferFromHostLiteral(literal,
+                                    cc_client_->addressable_devices()[0])
+            .value();
+    return std::make_unique<PJRT_Buffer>(
+        PJRT_Buffer{std::move(buffer), client_});
+  }
+
+  xla::Status ToStatus(PJRT_Error* error) {
+    if (error == nullptr) return xla::OkStatus();
+    xla::Status status = error->status;
+    PJRT_Error_Destroy_Args destroy_args = PJRT_Error_Destroy_Args{
+        .struct_size = PJRT_Error_Destroy_Args_STRUCT_SIZE,
+        .priv = nullptr,
+        .error = error,
+    };
+    api_->PJRT_Error_Destroy(&destroy_args);
+    return status;
+  }
+};
+
+// The arguments and outputs of a batch of executions of an executable taking
+// and returning a single buffer on a single device.
+struct ExecuteBatch {
+  explicit ExecuteBatch(const std::vector<PJRT_Buffer*>& buffers)
+      : arguments(buffers),
+        outputs(buffers.size(), nullptr),
+        dispatch_events(buffers.size(), nullptr),
+        complete_events(buffers.size(), nullptr) {
+    for (int i = 0; i < arguments.size(); ++i) {
+      argument_lists.push_back(&arguments[i]);
+      output_lists.push_back(&outputs[i]);
+      complete_event_lists.push_back(&complete_events[i]);
+    }
+    for (int i = 0; i < arguments.size(); ++i) {
+      argument_list_lists.push_back(&argument_lists[i]);
+      output_list_lists.push_back(&output_lists[i]);
+    }
+  }
+
+  ~ExecuteBatch() {
+    for (PJRT_Buffer* output : outputs) delete output;
+    for (PJRT_Event* event : dispatch_events) delete event;
+    for (PJRT_Event* event : complete_events) delete event;
+  }
+
+  PJRT_LoadedExecutable_ExecuteBatch_Args Args(
+      PJRT_LoadedExecutable* executable, PJRT_ExecuteOptions* options) {
+    return PJRT_LoadedExecutable_ExecuteBatch_Args{
+        .struct_size = PJRT_LoadedExecutable_ExecuteBatch_Args_STRUCT_SIZE,
+        .priv = nullptr,
+        .executable = executable,
+        .options = options,
+        .argument_lists = argument_list_lists.data(),
+        .num_executions = arguments.size(),
+        .num_devices = 1,
+        .num_args = 1,
+        .output_lists = output_list_lists.data(),
+        .dispatch_events = dispatch_events.data(),
+        .device_complete_events = complete_event_lists.data(),
+    };
+  }
+
+  std::vector<PJRT_Buffer*> arguments;
+  std::vector<PJRT_Buffer**> argument_lists;
+  std::vector<PJRT_Buffer***> argument_list_lists;
+  std::vector<PJRT_Buffer*> outputs;
+  std::vector<PJRT_Buffer**> output_lists;
+  std::vector<PJRT_Buffer***> output_list_lists;
+  std::vector<PJRT_Event*> dispatch_events;
+  std::vector<PJRT_Event*> complete_events;
+  std::vector<PJRT_Event**> complete_event_lists;
 };
 
 TEST_F(PjrtCApiCpuTest, ClientProcessIndex) {
@@ -88,6 +184,81 @@ TEST_F(PjrtCApiCpuTest, PlatformName) {
   ASSERT_EQ("cpu", platform_name);
 }
 
+TEST_F(PjrtCApiCpuTest, ExecuteBatch) {
+  std::unique_ptr<PJRT_LoadedExecutable> executable =
+      make_add_one_executable();
+  std::vector<std::unique_ptr<PJRT_Buffer>> buffers;
+  std::vector<PJRT_Buffer*> arguments;
+  for (int i = 0; i < 5; ++i) {
+    buffers.push_back(make_buffer(xla::LiteralUtil::CreateR0<float>(i)));
+    arguments.push_back(buffers.back().get());
+  }
+  ExecuteBatch batch(arguments);
+  PJRT_ExecuteOptions options{.struct_size = PJRT_ExecuteOptions_STRUCT_SIZE,
+                              .priv = nullptr,
+                              .launch_id = 0};
+  PJRT_LoadedExecutable_ExecuteBatch_Args args =
+      batch.Args(executable.get(), &options);
+  ASSERT_EQ(api_->PJRT_LoadedExecutable_ExecuteBatch(&args), nullptr);
+
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_NE(batch.dispatch_events[i], nullptr);
+    ASSERT_TRUE(batch.dispatch_events[i]->future.Await().ok());
+    ASSERT_NE(batch.complete_events[i], nullptr);
+    ASSERT_TRUE(batch.complete_events[i]->future.Await().ok());
+    ASSERT_NE(batch.outputs[i], nullptr);
+    std::shared_ptr<xla::Literal> literal =
+        batch.outputs[i]->buffer->ToLiteralSync().value();
+    EXPECT_EQ(literal->Get<float>({}), i + 1.0f);
+  }
+}
+
+TEST_F(PjrtCApiCpuTest, ExecuteBatchRejectsWrongNumDevices) {
+  std::unique_ptr<PJRT_LoadedExecutable> executable =
+      make_add_one_executable();
+  std::unique_ptr<PJRT_Buffer> buffer =
+      make_buffer(xla::LiteralUtil::CreateR0<float>(1));
+  ExecuteBatch batch({buffer.get()});
+  PJRT_ExecuteOptions options{.struct_size = PJRT_ExecuteOptions_STRUCT_SIZE,
+                              .priv = nullptr,
+                              .launch_id = 0};
+  PJRT_LoadedExecutable_ExecuteBatch_Args args =
+      batch.Args(executable.get(), &options);
+  args.num_devices = 2;
+  xla::Status status =
+      ToStatus(api_->PJRT_LoadedExecutable_ExecuteBatch(&args));
+  EXPECT_TRUE(tsl::errors::IsInvalidArgument(status)) << status;
+  EXPECT_EQ(batch.dispatch_events[0], nullptr);
+  EXPECT_EQ(batch.complete_events[0], nullptr);
+}
+
+TEST_F(PjrtCApiCpuTest, ExecuteBatchReportsDispatchErrors) {
+  std::unique_ptr<PJRT_LoadedExecutable> executable =
+      make_add_one_executable();
+  // The executable takes a scalar, so executing it on a vector fails.
+  std::unique_ptr<PJRT_Buffer> good_buffer =
+      make_buffer(xla::LiteralUtil::CreateR0<float>(1));
+  std::unique_ptr<PJRT_Buffer> bad_buffer =
+      make_buffer(xla::LiteralUtil::CreateR1<float>({1, 2}));
+  ExecuteBatch batch({bad_buffer.get(), good_buffer.get()});
+  PJRT_ExecuteOptions options{.struct_size = PJRT_ExecuteOptions_STRUCT_SIZE,
+                              .priv = nullptr,
+                              .launch_id = 0};
+  PJRT_LoadedExecutable_ExecuteBatch_Args args =
+      batch.Args(executable.get(), &options);
+  ASSERT_EQ(api_->PJRT_LoadedExecutable_ExecuteBatch(&args), nullptr);
+
+  EXPECT_FALSE(batch.dispatch_events[0]->future.Await().ok());
+  EXPECT_FALSE(batch.complete_events[0]->future.Await().ok());
+  EXPECT_EQ(batch.outputs[0], nullptr);
+  // A failed execution doesn't affect the later ones.
+  ASSERT_TRUE(batch.dispatch_events[1]->future.Await().ok());
+  ASSERT_TRUE(batch.complete_events[1]->future.Await().ok());
+  std::shared_ptr<xla::Literal> literal =
+      batch.outputs[1]->buffer->ToLiteralSync().value();
+  EXPECT_EQ(literal->Get<float>({}), 2.0f);
+}
+
 }  // namespace
 }  // namespace pjrt
 }  // namespace xla
@@ -25,6 +25,7 @@ limitations under the License.
 #include <variant>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
 #include "tensorflow/compiler/xla/client/xla_computation.h"
 #include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
@@ -44,9 +45,26 @@ limitations under the License.
 // TODO(b/238999986): Remove this.
 #include "tensorflow/compiler/xla/stream_executor/tpu/c_api_conversions.h"
 #include "tensorflow/compiler/xla/util.h"
+#include "tensorflow/tsl/platform/env.h"
 
 namespace pjrt {
 
+// The maximum number of executions that PJRT_LoadedExecutable_ExecuteBatch may
+// queue per device before blocking.
+constexpr int64_t kMaxQueuedExecutionsPerDevice = 64;
+
+ExecuteQueue::ExecuteQueue(const std::string& name,
+                           int64_t max_queued_executions)
+    : capacity_(max_queued_executions), thread_(tsl::Env::Default(), name) {}
+
+void ExecuteQueue::Schedule(std::function<void()> execution) {
+  capacity_.Acquire(1);
+  thread_.Schedule([this, execution = std::move(execution)]() {
+    execution();
+    capacity_.Release(1);
+  });
+}
+
 std::string ProgramFormatErrorMsg(absl::string_view program_format) {
   return absl::StrCat("Unknown program format '", program_format, "'.");
 }
@@ -732,6 +750,103 @@ PJRT_Error* PJRT_LoadedExecutable_Execute(
   return nullptr;
 }
 
+// Returns the execute queue of `device`, creating it if needed.
+static ExecuteQueue* GetExecuteQueue(PJRT_Client* client,
+                                     xla::PjRtDevice* device) {
+  absl::MutexLock lock(&client->execute_queues_mutex);
+  std::unique_ptr<ExecuteQueue>& queue = client->execute_queues[device];
+  if (queue == nullptr) {
+    queue = std::make_unique<ExecuteQueue>(
+        absl::StrCat("pjrt_execute_queue_", device->id()),
+        kMaxQueuedExecutionsPerDevice);
+  }
+  return queue.get();
+}
+
+PJRT_Error* PJRT_LoadedExecutable_ExecuteBatch(
+    PJRT_LoadedExecutable_ExecuteBatch_Args* args) {
+  PJRT_RETURN_IF_ERROR(CheckMatchingStructSizes(
+      "PJRT_LoadedExecutable_ExecuteBatch_Args",
+      PJRT_LoadedExecutable_ExecuteBatch_Args_STRUCT_SIZE, args->struct_size));
+  PJRT_RETURN_IF_ERROR(CheckMatchingStructSizes("PJRT_ExecuteOptions",
+                                                PJRT_ExecuteOptions_STRUCT_SIZE,
+                                                args->options->struct_size));
+  if (args->executable->addressable_devices.empty()) {
+    return new PJRT_Error{xla::InvalidArgument(
+        "PJRT_LoadedExecutable_ExecuteBatch requires an executable with "
+        "addressable devices")};
+  }
+  if (args->num_devices != args->executable->addressable_devices.size()) {
+    return new PJRT_Error{xla::InvalidArgument(
+        "num_devices and corresponding input and output list sizes must match "
+        "the number of addressable devices of the executable when calling "
+        "PJRT_LoadedExecutable_ExecuteBatch. Got num_devices=%i, expected %i",
+        args->num_devices, args->executable->addressable_devices.size())};
+  }
+  xla::ExecuteOptions options;
+  options.launch_id = args->options->launch_id;
+  options.strict_shape_checking = true;
+  options.arguments_are_tupled = false;
+  options.untuple_result = true;
+  options.context = nullptr;
+  options.multi_slice_config = nullptr;
+
+  // The executions of a multi-device executable are all dispatched by the
+  // queue of its first device, which keeps them in order.
+  PJRT_Client* client = args->executable->client;
+  ExecuteQueue* queue = GetExecuteQueue(
+      client, args->executable->addressable_devices.front()->device);
+  for (size_t i = 0; i < args->num_executions; ++i) {
+    auto dispatch_promise = xla::PjRtFuture<xla::Status>::CreatePromise();
+    args->dispatch_events[i] =
+        new PJRT_Event{xla::PjRtFuture<xla::Status>(dispatch_promise)};
+    std::vector<xla::PjRtFuture<xla::Status>::Promise> complete_promises;
+    if (args->device_complete_events != nullptr) {
+      complete_promises.reserve(args->num_devices);
+      for (size_t j = 0; j < args->num_devices; ++j) {
+        complete_promises.push_back(
+            xla::PjRtFuture<xla::Status>::CreatePromise());
+        args->device_complete_events[i][j] = new PJRT_Event{
+            xla::PjRtFuture<xla::Status>(complete_promises.back())};
+      }
+    }
+    queue->Schedule(
+        [executable = args->executable->executable, client, options,
+         argument_lists = Convert2DCBuffersToCppBuffers(
+             args->argument_lists[i], args->num_devices, args->num_args),
+         output_lists = args->output_lists[i],
+         dispatch_promise = std::move(dispatch_promise),
+         complete_promises = std::move(complete_promises)]() mutable {
+          std::optional<std::vector<xla::PjRtFuture<xla::Status>>>
+              returned_futures;
+          if (!complete_promises.empty()) returned_futures.emplace();
+          auto buffer_lists =
+              executable->Execute(argument_lists, options, returned_futures);
+          if (!buffer_lists.ok()) {
+            for (auto& promise : complete_promises) {
+              promise.Set(buffer_lists.status());
+            }
+            dispatch_promise.Set(buffer_lists.status());
+            return;
+          }
+          for (int j = 0; j < buffer_lists->size(); ++j) {
+            for (int k = 0; k < (*buffer_lists)[j].size(); ++k) {
+              output_lists[j][k] =
+                  new PJRT_Buffer{std::move((*buffer_lists)[j][k]), client};
+            }
+          }
+          // Execute returns a future per device, as many as the events.
+          for (int j = 0; j < complete_promises.size(); ++j) {
+            (*returned_futures)[j].OnReady(
+                [promise = std::move(complete_promises[j])](
+                    xla::Status status) mutable { promise.Set(status); });
+          }
+          dispatch_promise.Set(xla::OkStatus());
+        });
+  }
+  return nullptr;
+}
+
 PJRT_Error* PJRT_Executable_Serialize(PJRT_Executable_Serialize_Args* args) {
   PJRT_RETURN_IF_ERROR(CheckMatchingStructSizes(
       "PJRT_Executable_Serialize_Args",
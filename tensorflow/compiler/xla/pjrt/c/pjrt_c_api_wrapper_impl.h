@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_XLA_PJRT_C_PJRT_C_API_WRAPPER_IMPL_H_
 #define TENSORFLOW_COMPILER_XLA_PJRT_C_PJRT_C_API_WRAPPER_IMPL_H_
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -25,11 +27,33 @@ limitations under the License.
 #include "tensorflow/compiler/xla/pjrt/c/pjrt_c_api.h"
 #include "tensorflow/compiler/xla/pjrt/pjrt_client.h"
 #include "tensorflow/compiler/xla/pjrt/pjrt_future.h"
+#include "tensorflow/compiler/xla/pjrt/semaphore.h"
+#include "tensorflow/compiler/xla/pjrt/worker_thread.h"
 
 struct PJRT_Error {
   xla::Status status;
 };
 
+namespace pjrt {
+
+// Runs the executions dispatched to a device by
+// PJRT_LoadedExecutable_ExecuteBatch in order, on a dedicated thread. At most
+// `max_queued_executions` may be queued at a time.
+class ExecuteQueue {
+ public:
+  ExecuteQueue(const std::string& name, int64_t max_queued_executions);
+
+  // Queues `execution`, blocking while the queue is full.
+  void Schedule(std::function<void()> execution);
+
+ private:
+  xla::Semaphore capacity_;
+  // Destroyed first, so that the queued executions release `capacity_`.
+  xla::WorkerThread thread_;
+};
+
+}  // namespace pjrt
+
 struct PJRT_Client {
   std::unique_ptr<xla::PjRtClient> client;
   std::vector<PJRT_Device> owned_devices;
@@ -41,6 +65,12 @@ struct PJRT_Client {
   // Map from wrapped C++ devices to C devices. The values are the same as
   // `owned_devices`.
   absl::flat_hash_map<xla::PjRtDevice*, PJRT_Device*> c_device_from_cpp_device;
+  // The execute queues of the devices, created on their first
+  // PJRT_LoadedExecutable_ExecuteBatch. Destroyed before `client`, so that the
+  // queued executions complete first.
+  absl::Mutex execute_queues_mutex;
+  absl::flat_hash_map<xla::PjRtDevice*, std::unique_ptr<pjrt::ExecuteQueue>>
+      execute_queues ABSL_GUARDED_BY(execute_queues_mutex);
 };
 
 // PJRT_Devices are owned by their corresponding PJRT_Client.
@@ -160,6 +190,8 @@ PJRT_Error* PJRT_LoadedExecutable_IsDeleted(
     PJRT_LoadedExecutable_IsDeleted_Args* args);
 PJRT_Error* PJRT_LoadedExecutable_Execute(
     PJRT_LoadedExecutable_Execute_Args* args);
+PJRT_Error* PJRT_LoadedExecutable_ExecuteBatch(
+    PJRT_LoadedExecutable_ExecuteBatch_Args* args);
 PJRT_Error* PJRT_Executable_Serialize(PJRT_Executable_Serialize_Args* args);
 PJRT_Error* PJRT_Executable_DeserializeAndLoad(
     PJRT_Executable_DeserializeAndLoad_Args* args);
@@ -300,6 +332,8 @@ constexpr PJRT_Api CreatePjrtApi(PJRT_Client_Create* create_fn) {
       .PJRT_Buffer_IsOnCpu = pjrt::PJRT_Buffer_IsOnCpu,
       .PJRT_Buffer_ReadyEvent = pjrt::PJRT_Buffer_ReadyEvent,
       .PJRT_Buffer_UnsafePointer = pjrt::PJRT_Buffer_UnsafePointer,
+      .PJRT_LoadedExecutable_ExecuteBatch =
+          pjrt::PJRT_LoadedExecutable_ExecuteBatch,
   };
 }
 
@@ -0,0 +1,179 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/pjrt/device_buffer_pool.h"
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/bits.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/logging.h"
+
+namespace xla {
+
+namespace {
+
+// The smallest size class, which holds all the buffers of at most this size.
+constexpr uint64_t kMinSizeClass = 256;
+
+}  // namespace
+
+DeviceBufferPool::DeviceBufferPool(se::DeviceMemoryAllocator* allocator,
+                                   int64_t max_cached_bytes_per_device)
+    : se::DeviceMemoryAllocator(allocator->platform()),
+      allocator_(allocator),
+      max_cached_bytes_per_device_(max_cached_bytes_per_device) {}
+
+DeviceBufferPool::~DeviceBufferPool() { TF_CHECK_OK(Close()); }
+
+uint64_t DeviceBufferPool::SizeClass(uint64_t size) {
+  if (size <= kMinSizeClass) return kMinSizeClass;
+  // Splits each power of two into 4 classes: the sizes in (2^k, 2^(k+1)] are
+  // rounded up to a multiple of 2^(k-2).
+  int log2_floor = absl::bit_width(size - 1) - 1;
+  uint64_t step = uint64_t{1} << (log2_floor - 2);
+  return (size + step - 1) & ~(step - 1);
+}
+
+tsl::StatusOr<se::OwningDeviceMemory> DeviceBufferPool::Allocate(
+    int device_ordinal, uint64_t size, bool retry_on_failure,
+    int64_t memory_space) {
+  if (size == 0) {
+    return se::OwningDeviceMemory();
+  }
+  if (memory_space != 0) {
+    TF_ASSIGN_OR_RETURN(se::OwningDeviceMemory mem,
+                        allocator_->Allocate(device_ordinal, size,
+                                             retry_on_failure, memory_space));
+    absl::MutexLock lock(&mu_);
+    unpooled_buffers_.insert(mem->opaque());
+    return se::OwningDeviceMemory(mem.Release(), device_ordinal, this);
+  }
+
+  {
+    absl::MutexLock lock(&mu_);
+    auto cache = caches_.find(device_ordinal);
+    if (cache != caches_.end()) {
+      auto buffers = cache->second.buffers.find(SizeClass(size));
+      if (buffers != cache->second.buffers.end()) {
+        std::vector<se::DeviceMemoryBase>& candidates = buffers->second;
+        // Prefers the most recently deallocated buffers, which are the most
+        // likely to be warm in the caches of the device.
+        for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+          if (it->size() < size) continue;
+          se::DeviceMemoryBase mem = *it;
+          candidates.erase(std::next(it).base());
+          cache->second.bytes -= mem.size();
+          VLOG(3) << "Reusing a cached buffer of " << mem.size()
+                  << " bytes for an allocation of " << size
+                  << " bytes on device " << device_ordinal;
+          return se::OwningDeviceMemory(mem, device_ordinal, this);
+        }
+      }
+    }
+  }
+
+  tsl::StatusOr<se::OwningDeviceMemory> mem =
+      allocator_->Allocate(device_ordinal, size, retry_on_failure);
+  if (!mem.ok()) {
+    // The cached buffers may be what keeps the allocation from fitting.
+    std::vector<se::DeviceMemoryBase> cached_buffers;
+    {
+      absl::MutexLock lock(&mu_);
+      cached_buffers = TakeCachedBuffers(device_ordinal);
+    }
+    if (cached_buffers.empty()) return mem.status();
+    for (se::DeviceMemoryBase& buffer : cached_buffers) {
+      TF_RETURN_IF_ERROR(allocator_->Deallocate(device_ordinal, buffer));
+    }
+    mem = allocator_->Allocate(device_ordinal, size, retry_on_failure);
+    if (!mem.ok()) return mem.status();
+  }
+  return se::OwningDeviceMemory(mem->Release(), device_ordinal, this);
+}
+
+tsl::Status DeviceBufferPool::Deallocate(int device_ordinal,
+                                         se::DeviceMemoryBase mem) {
+  if (mem.is_null()) {
+    return tsl::OkStatus();
+  }
+  {
+    absl::MutexLock lock(&mu_);
+    bool pooled = unpooled_buffers_.erase(mem.opaque()) == 0;
+    if (pooled && !closed_) {
+      DeviceCache& cache = caches_[device_ordinal];
+      if (cache.bytes + static_cast<int64_t>(mem.size()) <=
+          max_cached_bytes_per_device_) {
+        // The size the buffer is deallocated with may be smaller than the size
+        // it was allocated with, but never larger, so it is only handed out
+        // for the allocations that fit in it.
+        cache.buffers[SizeClass(mem.size())].push_back(mem);
+        cache.bytes += mem.size();
+        return tsl::OkStatus();
+      }
+    }
+  }
+  return allocator_->Deallocate(device_ordinal, mem);
+}
+
+std::vector<se::DeviceMemoryBase> DeviceBufferPool::TakeCachedBuffers(
+    int device_ordinal) {
+  std::vector<se::DeviceMemoryBase> cached_buffers;
+  auto cache = caches_.find(device_ordinal);
+  if (cache == caches_.end()) return cached_buffers;
+  for (auto& [size_class, buffers] : cache->second.buffers) {
+    cached_buffers.insert(cached_buffers.end(), buffers.begin(),
+                          buffers.end());
+  }
+  caches_.erase(cache);
+  return cached_buffers;
+}
+
+tsl::Status DeviceBufferPool::ReleaseCachedBuffers(int device_ordinal) {
+  std::vector<se::DeviceMemoryBase> cached_buffers;
+  {
+    absl::MutexLock lock(&mu_);
+    cached_buffers = TakeCachedBuffers(device_ordinal);
+  }
+  for (se::DeviceMemoryBase& buffer : cached_buffers) {
+    TF_RETURN_IF_ERROR(allocator_->Deallocate(device_ordinal, buffer));
+  }
+  return tsl::OkStatus();
+}
+
+tsl::Status DeviceBufferPool::Close() {
+  std::vector<int> device_ordinals;
+  {
+    absl::MutexLock lock(&mu_);
+    closed_ = true;
+    for (const auto& [device_ordinal, cache] : caches_) {
+      device_ordinals.push_back(device_ordinal);
+    }
+  }
+  for (int device_ordinal : device_ordinals) {
+    TF_RETURN_IF_ERROR(ReleaseCachedBuffers(device_ordinal));
+  }
+  return tsl::OkStatus();
+}
+
+int64_t DeviceBufferPool::cached_bytes(int device_ordinal) const {
+  absl::MutexLock lock(&mu_);
+  auto cache = caches_.find(device_ordinal);
+  return cache == caches_.end() ? 0 : cache->second.bytes;
+}
+
+}  // namespace xla
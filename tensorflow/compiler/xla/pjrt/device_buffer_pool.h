@@ -0,0 +1,117 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_PJRT_DEVICE_BUFFER_POOL_H_
+#define TENSORFLOW_COMPILER_XLA_PJRT_DEVICE_BUFFER_POOL_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/compiler/xla/stream_executor/device_memory_allocator.h"
+#include "tensorflow/compiler/xla/types.h"
+
+namespace xla {
+
+// A device memory allocator that caches the buffers that are deallocated
+// through it, and reuses them for later allocations of the same size class
+// instead of going back to the underlying allocator. This avoids the cost and
+// the locking of the underlying allocator, e.g. a BFC allocator, for programs
+// that repeatedly allocate buffers of the same sizes, such as the outputs and
+// the temporary buffers of an executable run in a loop.
+//
+// The buffers are bucketed by size class, where the classes are spaced by at
+// most 25%. A cached buffer is only reused for an allocation that fits in the
+// size it was deallocated with, so buffers allocated by the underlying
+// allocator directly, e.g. donated arguments, may be deallocated through the
+// pool as well and are then reused like the pool's own buffers.
+//
+// At most `max_cached_bytes_per_device` bytes are cached per device; the
+// buffers deallocated beyond that are returned to the underlying allocator. If
+// the underlying allocator runs out of memory, the cached buffers of the
+// device are returned to it before retrying the allocation.
+//
+// Only the buffers of the default memory space are pooled. Like the
+// underlying allocator, the pool relies on the ordering of the compute stream
+// for the reuse of buffers deallocated before the work using them completes.
+class DeviceBufferPool : public se::DeviceMemoryAllocator {
+ public:
+  DeviceBufferPool(se::DeviceMemoryAllocator* allocator,
+                   int64_t max_cached_bytes_per_device);
+  ~DeviceBufferPool() override;
+
+  tsl::StatusOr<se::OwningDeviceMemory> Allocate(int device_ordinal,
+                                                 uint64_t size,
+                                                 bool retry_on_failure,
+                                                 int64_t memory_space) override;
+
+  // Pull in two-arg overload that sets retry_on_failure to true.
+  using se::DeviceMemoryAllocator::Allocate;
+
+  tsl::Status Deallocate(int device_ordinal, se::DeviceMemoryBase mem) override;
+
+  bool AllowsAsynchronousDeallocation() const override {
+    return allocator_->AllowsAsynchronousDeallocation();
+  }
+
+  tsl::StatusOr<se::Stream*> GetStream(int device_ordinal) override {
+    return allocator_->GetStream(device_ordinal);
+  }
+
+  // Returns the cached buffers to the underlying allocator, and stops caching
+  // the buffers deallocated from now on. Used when the owner of the pool goes
+  // away while some of its buffers are still alive.
+  tsl::Status Close();
+
+  // Returns the cached buffers of `device_ordinal` to the underlying
+  // allocator.
+  tsl::Status ReleaseCachedBuffers(int device_ordinal);
+
+  // Returns the number of bytes cached for `device_ordinal`.
+  int64_t cached_bytes(int device_ordinal) const;
+
+  // Returns the size class of an allocation of `size` bytes.
+  static uint64_t SizeClass(uint64_t size);
+
+ private:
+  // The cached buffers of a device.
+  struct DeviceCache {
+    // The cached buffers, by size class.
+    absl::flat_hash_map<uint64_t, std::vector<se::DeviceMemoryBase>> buffers;
+    int64_t bytes = 0;
+  };
+
+  // Removes the cached buffers of `device_ordinal` from the pool, to be
+  // returned to the underlying allocator.
+  std::vector<se::DeviceMemoryBase> TakeCachedBuffers(int device_ordinal)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  se::DeviceMemoryAllocator* const allocator_;
+  const int64_t max_cached_bytes_per_device_;
+
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<int, DeviceCache> caches_ ABSL_GUARDED_BY(mu_);
+  // The live buffers allocated in other memory spaces than the default one,
+  // which are not pooled.
+  absl::flat_hash_set<const void*> unpooled_buffers_ ABSL_GUARDED_BY(mu_);
+  bool closed_ ABSL_GUARDED_BY(mu_) = false;
+};
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_PJRT_DEVICE_BUFFER_POOL_H_
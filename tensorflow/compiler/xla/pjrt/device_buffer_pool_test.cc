@@ -0,0 +1,176 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/pjrt/device_buffer_pool.h"
+
+#include <cstdint>
+
+#include "tensorflow/compiler/xla/test.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/statusor.h"
+
+namespace xla {
+namespace {
+
+// An allocator of host memory that counts its allocations, and that can only
+// allocate up to `capacity` bytes.
+class CountingAllocator : public se::DeviceMemoryAllocator {
+ public:
+  explicit CountingAllocator(int64_t capacity = INT64_MAX)
+      : se::DeviceMemoryAllocator(/*platform=*/nullptr), capacity_(capacity) {}
+
+  tsl::StatusOr<se::OwningDeviceMemory> Allocate(
+      int device_ordinal, uint64_t size, bool retry_on_failure,
+      int64_t memory_space) override {
+    if (size == 0) return se::OwningDeviceMemory();
+    if (allocated_bytes_ + static_cast<int64_t>(size) > capacity_) {
+      return tsl::errors::ResourceExhausted("Out of memory");
+    }
+    ++num_allocations_;
+    allocated_bytes_ += size;
+    return se::OwningDeviceMemory(
+        se::DeviceMemoryBase(new char[size], size), device_ordinal, this);
+  }
+
+  using se::DeviceMemoryAllocator::Allocate;
+
+  tsl::Status Deallocate(int device_ordinal,
+                         se::DeviceMemoryBase mem) override {
+    if (mem.is_null()) return tsl::OkStatus();
+    ++num_deallocations_;
+    allocated_bytes_ -= mem.size();
+    delete[] static_cast<char*>(mem.opaque());
+    return tsl::OkStatus();
+  }
+
+  tsl::StatusOr<se::Stream*> GetStream(int device_ordinal) override {
+    return tsl::errors::Unimplemented("No streams");
+  }
+
+  int num_allocations() const { return num_allocations_; }
+  int num_deallocations() const { return num_deallocations_; }
+
+ private:
+  const int64_t capacity_;
+  int64_t allocated_bytes_ = 0;
+  int num_allocations_ = 0;
+  int num_deallocations_ = 0;
+};
+
+TEST(DeviceBufferPoolTest, SizeClasses) {
+  EXPECT_EQ(DeviceBufferPool::SizeClass(1), 256u);
+  EXPECT_EQ(DeviceBufferPool::SizeClass(256), 256u);
+  EXPECT_EQ(DeviceBufferPool::SizeClass(257), 320u);
+  EXPECT_EQ(DeviceBufferPool::SizeClass(320), 320u);
+  EXPECT_EQ(DeviceBufferPool::SizeClass(321), 384u);
+  EXPECT_EQ(DeviceBufferPool::SizeClass(512), 512u);
+  EXPECT_EQ(DeviceBufferPool::SizeClass(513), 640u);
+  EXPECT_EQ(DeviceBufferPool::SizeClass(1u << 20), 1u << 20);
+  EXPECT_EQ(DeviceBufferPool::SizeClass((1u << 20) + 1), 5u << 18);
+}
+
+TEST(DeviceBufferPoolTest, ReusesDeallocatedBuffers) {
+  CountingAllocator allocator;
+  DeviceBufferPool pool(&allocator, /*max_cached_bytes_per_device=*/1 << 20);
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory first,
+                          pool.Allocate(/*device_ordinal=*/0, 1000));
+  void* opaque = first->opaque();
+  first = se::OwningDeviceMemory();
+  EXPECT_EQ(pool.cached_bytes(0), 1000);
+
+  // An allocation of the same size class that fits reuses the buffer.
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory second, pool.Allocate(0, 900));
+  EXPECT_EQ(second->opaque(), opaque);
+  EXPECT_EQ(second->size(), 1000u);
+  EXPECT_EQ(pool.cached_bytes(0), 0);
+  EXPECT_EQ(allocator.num_allocations(), 1);
+}
+
+TEST(DeviceBufferPoolTest, DoesNotReuseBuffersThatAreTooSmall) {
+  CountingAllocator allocator;
+  DeviceBufferPool pool(&allocator, /*max_cached_bytes_per_device=*/1 << 20);
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory small, pool.Allocate(0, 900));
+  small = se::OwningDeviceMemory();
+
+  // Same size class, but doesn't fit.
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory large, pool.Allocate(0, 1000));
+  EXPECT_EQ(allocator.num_allocations(), 2);
+  // Fits, but in another size class.
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory tiny, pool.Allocate(0, 100));
+  EXPECT_EQ(allocator.num_allocations(), 3);
+  EXPECT_EQ(pool.cached_bytes(0), 900);
+}
+
+TEST(DeviceBufferPoolTest, PoolsBuffersOfOtherAllocators) {
+  CountingAllocator allocator;
+  DeviceBufferPool pool(&allocator, /*max_cached_bytes_per_device=*/1 << 20);
+  // E.g. a donated argument, allocated by the underlying allocator directly.
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory donated,
+                          allocator.Allocate(0, 1000));
+  void* opaque = donated->opaque();
+  TF_ASSERT_OK(pool.Deallocate(0, donated.Release()));
+
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory reused,
+                          pool.Allocate(0, 1000));
+  EXPECT_EQ(reused->opaque(), opaque);
+  EXPECT_EQ(allocator.num_allocations(), 1);
+}
+
+TEST(DeviceBufferPoolTest, CapsCachedBytesPerDevice) {
+  CountingAllocator allocator;
+  DeviceBufferPool pool(&allocator, /*max_cached_bytes_per_device=*/1500);
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory a, pool.Allocate(0, 1000));
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory b, pool.Allocate(0, 1000));
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory c, pool.Allocate(1, 1000));
+  a = se::OwningDeviceMemory();
+  b = se::OwningDeviceMemory();
+  c = se::OwningDeviceMemory();
+  EXPECT_EQ(pool.cached_bytes(0), 1000);
+  EXPECT_EQ(pool.cached_bytes(1), 1000);
+  EXPECT_EQ(allocator.num_deallocations(), 1);
+
+  TF_ASSERT_OK(pool.ReleaseCachedBuffers(0));
+  EXPECT_EQ(pool.cached_bytes(0), 0);
+  EXPECT_EQ(pool.cached_bytes(1), 1000);
+  EXPECT_EQ(allocator.num_deallocations(), 2);
+}
+
+TEST(DeviceBufferPoolTest, ReleasesCachedBuffersWhenOutOfMemory) {
+  CountingAllocator allocator(/*capacity=*/1500);
+  DeviceBufferPool pool(&allocator, /*max_cached_bytes_per_device=*/1 << 20);
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory a, pool.Allocate(0, 1000));
+  a = se::OwningDeviceMemory();
+
+  // Doesn't fit next to the cached buffer, which is released for it.
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory b, pool.Allocate(0, 1200));
+  EXPECT_EQ(pool.cached_bytes(0), 0);
+  EXPECT_EQ(allocator.num_deallocations(), 1);
+}
+
+TEST(DeviceBufferPoolTest, StopsCachingWhenClosed) {
+  CountingAllocator allocator;
+  DeviceBufferPool pool(&allocator, /*max_cached_bytes_per_device=*/1 << 20);
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory a, pool.Allocate(0, 1000));
+  TF_ASSERT_OK_AND_ASSIGN(se::OwningDeviceMemory b, pool.Allocate(0, 1000));
+  a = se::OwningDeviceMemory();
+  TF_ASSERT_OK(pool.Close());
+  EXPECT_EQ(allocator.num_deallocations(), 1);
+  b = se::OwningDeviceMemory();
+  EXPECT_EQ(pool.cached_bytes(0), 0);
+  EXPECT_EQ(allocator.num_deallocations(), 2);
+}
+
+}  // namespace
+}  // namespace xla
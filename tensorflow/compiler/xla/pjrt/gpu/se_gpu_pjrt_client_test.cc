@@ -22,9 +22,16 @@ limitations under the License.
 #include <vector>
 
 #include "absl/strings/match.h"
+#include "absl/synchronization/notification.h"
+#include "tensorflow/compiler/xla/literal_util.h"
+#include "tensorflow/compiler/xla/pjrt/event_pool.h"
+#include "tensorflow/compiler/xla/pjrt/local_device_state.h"
+#include "tensorflow/compiler/xla/pjrt/tracked_device_buffer.h"
 #include "tensorflow/compiler/xla/service/hlo_parser.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/test.h"
 #include "tensorflow/compiler/xla/tests/literal_test_util.h"
+#include "tensorflow/tsl/platform/casts.h"
 
 namespace xla {
 namespace {
@@ -212,5 +219,69 @@ TEST(StreamExecutorGpuClientTest, RecvErrorNoDeadLock) {
                                 "of size 8 (0 already transferred)"));
 }
 
+static constexpr char const* kAddProgram = R"(HloModule Add
+    ENTRY Add {
+      x = f32[4] parameter(0)
+      y = f32[4] parameter(1)
+      ROOT add = f32[4] add(x, y)
+    })";
+
+TEST(StreamExecutorGpuClientTest, ExecuteWaitsLazilyForArguments) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto client, GetStreamExecutorGpuClient(true, /*allocator_config=*/{},
+                                              /*distributed_client=*/nullptr,
+                                              /*node_id=*/0));
+  CompileOptions compile_options;
+  compile_options.executable_build_options.mutable_debug_options()
+      ->set_xla_gpu_enable_lazy_parameter_waits(true);
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto executable,
+      CompileExecutable(kAddProgram, *client, compile_options));
+
+  PjRtDevice* device = client->addressable_devices()[0];
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto x, client->BufferFromHostLiteral(
+                  LiteralUtil::CreateR1<float>({1.0f, 2.0f, 3.0f, 4.0f}),
+                  device));
+
+  // `y` is defined by a host-to-device transfer that is held back until
+  // `unblock` is notified, i.e. it isn't ready when the execution is enqueued.
+  LocalDeviceState* local_device =
+      tensorflow::down_cast<PjRtStreamExecutorDevice*>(device)
+          ->local_device_state();
+  auto definition_event = std::make_shared<BufferSequencingEvent>();
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto y,
+      tensorflow::down_cast<PjRtStreamExecutorClient*>(client.get())
+          ->CreateUninitializedBuffer(ShapeUtil::MakeShape(F32, {4}), device,
+                                      definition_event));
+  se::DeviceMemoryBase y_memory;
+  {
+    TF_ASSERT_OK_AND_ASSIGN(auto reference, y->AcquireExternalReference());
+    y_memory = se::DeviceMemoryBase(reference->OpaqueDeviceMemoryDataPointer(),
+                                    4 * sizeof(float));
+  }
+  const std::array<float, 4> y_data = {10.0f, 20.0f, 30.0f, 40.0f};
+  absl::Notification unblock;
+  se::Stream* stream = local_device->host_to_device_stream();
+  stream->ThenDoHostCallback([&unblock] { unblock.WaitForNotification(); });
+  stream->ThenMemcpy(&y_memory, y_data.data(), sizeof(y_data));
+  TF_ASSERT_OK_AND_ASSIGN(
+      EventPool::Handle event,
+      local_device->event_pool().ThenAllocateAndRecordEvent(stream));
+  definition_event->SetSequencingEvent(std::move(event), stream);
+
+  auto result = executable->Execute({{x.get(), y.get()}}, ExecuteOptions());
+  // The execution is enqueued without waiting for the transfer on the host.
+  EXPECT_FALSE(definition_event->IsComplete());
+  unblock.Notify();
+
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<xla::Literal> result_literal,
+                          ExtractSingleResult(result));
+  EXPECT_TRUE(LiteralTestUtil::Equal(
+      LiteralUtil::CreateR1<float>({11.0f, 22.0f, 33.0f, 44.0f}),
+      *result_literal));
+}
+
 }  // namespace
 }  // namespace xla
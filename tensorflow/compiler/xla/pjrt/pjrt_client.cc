@@ -42,6 +42,19 @@ StatusOr<std::uintptr_t> PjRtClient::UnsafeBufferPointer(PjRtBuffer* buffer) {
   return absl::bit_cast<std::uintptr_t>(ptr);
 }
 
+PjRtFuture<StatusOr<std::shared_ptr<PjRtLoadedExecutable>>>
+PjRtClient::CompileAsync(const XlaComputation& computation,
+                         CompileOptions options) {
+  StatusOr<std::unique_ptr<PjRtLoadedExecutable>> executable =
+      Compile(computation, std::move(options));
+  if (!executable.ok()) {
+    return PjRtFuture<StatusOr<std::shared_ptr<PjRtLoadedExecutable>>>(
+        executable.status());
+  }
+  return PjRtFuture<StatusOr<std::shared_ptr<PjRtLoadedExecutable>>>(
+      std::shared_ptr<PjRtLoadedExecutable>(std::move(executable).value()));
+}
+
 PjRtFuture<Status> PjRtBuffer::CopyRawToHostFuture(
     PjRtFuture<StatusOr<void*>> dst, int64_t offset, int64_t transfer_size) {
   StatusOr<void*> awaited_dst = dst.Await();
@@ -465,6 +465,14 @@ class PjRtClient {
   virtual StatusOr<std::unique_ptr<PjRtLoadedExecutable>> Compile(
       mlir::ModuleOp module, CompileOptions options) = 0;
 
+  // Variant of `Compile` that returns without waiting for the compilation to
+  // complete. The executable is shared because clients may return the same
+  // executable for identical compilations. The pointers in `options` must stay
+  // valid until the future is ready. The default implementation compiles on
+  // the calling thread.
+  virtual PjRtFuture<StatusOr<std::shared_ptr<PjRtLoadedExecutable>>>
+  CompileAsync(const XlaComputation& computation, CompileOptions options);
+
   // Generates a unique fingerprint for `executable`, may be std::nullopt.
   virtual StatusOr<std::optional<std::string>> ExecutableFingerprint(
       const PjRtLoadedExecutable& executable) const = 0;
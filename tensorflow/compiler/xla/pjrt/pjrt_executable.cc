@@ -38,6 +38,7 @@ StatusOr<CompileOptionsProto> CompileOptions::ToProto() const {
                       executable_build_options.ToProto());
   output.set_compile_portable_executable(compile_portable_executable);
   output.set_profile_version(profile_version);
+  output.set_max_pooled_device_buffer_bytes(max_pooled_device_buffer_bytes);
   if (multi_slice_config != nullptr) {
     output.set_serialized_multi_slice_config(multi_slice_config->Serialize());
   }
@@ -67,6 +68,8 @@ StatusOr<CompileOptions> CompileOptions::FromProto(
   output.executable_build_options = executable_build_options;
   output.compile_portable_executable = proto.compile_portable_executable();
   output.profile_version = proto.profile_version();
+  output.max_pooled_device_buffer_bytes =
+      proto.max_pooled_device_buffer_bytes();
   return output;
 }
 
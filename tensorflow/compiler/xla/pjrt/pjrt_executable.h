@@ -79,6 +79,13 @@ struct CompileOptions {
   // slice operation.
   const MultiSliceConfig* multi_slice_config = nullptr;
 
+  // If positive, the output and temporary device buffers of the executable are
+  // allocated from a pool that keeps up to this many bytes of the released
+  // buffers per device, to be reused by later executions instead of being
+  // returned to the client's allocator. Only supported by the StreamExecutor
+  // clients.
+  int64_t max_pooled_device_buffer_bytes = 0;
+
   // Serialize the CompileOptions into a CompileOptionsProto.
   StatusOr<CompileOptionsProto> ToProto() const;
 
@@ -28,6 +28,7 @@ TEST(CompileOptionsTest, Serialization) {
   src.compile_portable_executable = true;
   src.parameter_is_tupled_arguments = true;
   src.profile_version = 1;
+  src.max_pooled_device_buffer_bytes = 1 << 20;
   src.argument_layouts = {ShapeUtil::MakeShape(S32, {1})};
   ExecutableBuildOptions build_option;
   build_option.set_device_assignment(DeviceAssignment(1, 1));
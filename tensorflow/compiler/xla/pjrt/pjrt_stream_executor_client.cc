@@ -82,6 +82,7 @@ limitations under the License.
 #include "absl/container/flat_hash_set.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
@@ -117,6 +118,8 @@ limitations under the License.
 #include "tensorflow/compiler/xla/stream_executor/stream.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "tensorflow/tsl/lib/strings/proto_serialization.h"
+#include "tensorflow/tsl/platform/cpu_info.h"
 #include "tensorflow/tsl/platform/env.h"
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/fingerprint.h"
@@ -201,6 +204,10 @@ class CpuAllocator : public tsl::Allocator {
   void DeallocateRaw(void* ptr) override { return tsl::port::AlignedFree(ptr); }
 };
 
+// The number of compilations of CompileAsync whose executables are kept for
+// the identical compilations that follow.
+constexpr int kCompileCacheCapacity = 64;
+
 PjRtStreamExecutorClient::PjRtStreamExecutorClient(
     std::string platform_name, LocalClient* client,
     std::vector<std::unique_ptr<PjRtStreamExecutorDevice>> devices,
@@ -221,7 +228,11 @@ PjRtStreamExecutorClient::PjRtStreamExecutorClient(
       thread_pool_(
           tsl::Env::Default(), "pjrt_thread_pool",
           std::max<int>(DefaultThreadPoolSize(), client->device_count())),
-      transpose_cache_(1024) {
+      transpose_cache_(1024),
+      compile_lru_list_(kCompileCacheCapacity),
+      compile_cache_(&compile_lru_list_),
+      compile_thread_pool_(tsl::Env::Default(), "pjrt_compile_thread_pool",
+                           tsl::port::MaxParallelism()) {
   if (owned_allocator_ != nullptr) {
     allocator_ = owned_allocator_.get();
   } else {
@@ -253,6 +264,14 @@ PjRtStreamExecutorClient::PjRtStreamExecutorClient(
                });
 }
 
+DeviceBufferPool* PjRtStreamExecutorClient::CreateDeviceBufferPool(
+    int64_t max_cached_bytes_per_device) {
+  absl::MutexLock lock(&device_buffer_pools_mu_);
+  device_buffer_pools_.push_back(std::make_unique<DeviceBufferPool>(
+      allocator_, max_cached_bytes_per_device));
+  return device_buffer_pools_.back().get();
+}
+
 StatusOr<DeviceAssignment> PjRtStreamExecutorClient::GetDefaultDeviceAssignment(
     int num_replicas, int num_partitions) const {
   return client_->backend().computation_placer()->AssignDevices(num_replicas,
@@ -1837,6 +1856,22 @@ PjRtStreamExecutorExecutable::PjRtStreamExecutorExecutable(
   }
 }
 
+PjRtStreamExecutorExecutable::~PjRtStreamExecutorExecutable() {
+  // The buffers still allocated from the pool are returned to the client's
+  // allocator when they are released.
+  if (buffer_pool_ != nullptr) {
+    TF_CHECK_OK(buffer_pool_->Close());
+  }
+}
+
+void PjRtStreamExecutorExecutable::SetUpBufferPool(
+    int64_t max_pooled_device_buffer_bytes) {
+  if (max_pooled_device_buffer_bytes > 0) {
+    buffer_pool_ =
+        client_->CreateDeviceBufferPool(max_pooled_device_buffer_bytes);
+  }
+}
+
 Status PjRtStreamExecutorExecutable::SetUpDonation(bool tuple_inputs) {
   parameters_that_must_be_donated_.reserve(executables_.size());
   for (auto& executable : executables_) {
@@ -2155,6 +2190,21 @@ StatusOr<ScopedShapedBuffer> PjRtStreamExecutorExecutable::EnqueueExecution(
   VLOG(3) << "Replica " << replica << ", partition " << partition
           << " mapped to device ordinal for execution: " << device_ordinal;
 
+  // If the executable waits for each argument just before its first use, the
+  // events of the arguments that aren't donated are waited for by the
+  // executable, so that the execution can start before the transfers of the
+  // arguments it uses later complete.
+  const Executable* executable =
+      executables_[executable_idx]->executable();
+  const bool wait_lazily =
+      client_->gpu_run_options() != nullptr &&
+      !parameter_is_tupled_arguments_ && executable->has_module() &&
+      executable->module_config()
+          .debug_options()
+          .xla_gpu_enable_lazy_parameter_waits();
+  std::vector<absl::flat_hash_set<BufferSequencingEvent*>> lazy_events(
+      wait_lazily ? argument_handles.size() : 0);
+
   absl::flat_hash_set<BufferSequencingEvent*> events;
   device_buffers->reserve(argument_handles.size());
   absl::Span<int const> donated_params =
@@ -2215,7 +2265,8 @@ StatusOr<ScopedShapedBuffer> PjRtStreamExecutorExecutable::EnqueueExecution(
     // hold so we know that the set of usage events won't be modified while we
     // are enqueueing.
     GetDeviceBufferEvents(*device_buffer, /*get_usage_events=*/must_donate,
-                          &events);
+                          wait_lazily && !must_donate ? &lazy_events[i]
+                                                      : &events);
   }
 
   if (options.arguments_are_tupled) {
@@ -2253,13 +2304,29 @@ StatusOr<ScopedShapedBuffer> PjRtStreamExecutorExecutable::EnqueueExecution(
   run_options.set_stream(device_state->compute_stream());
   run_options.set_host_to_device_stream(device_state->host_to_device_stream());
   run_options.set_device_to_host_stream(device_state->GetDeviceToHostStream());
-  run_options.set_allocator(client_->allocator());
+  run_options.set_allocator(allocator());
   run_options.set_intra_op_thread_pool(
       client_->client()->backend().eigen_intra_op_thread_pool_device());
   run_options.set_device_assignment(device_assignment.get());
   run_options.set_run_id(run_id);
   run_options.set_rng_seed(device_state->GetNewPrngSeed());
-  run_options.set_gpu_executable_run_options(client_->gpu_run_options());
+  gpu::GpuExecutableRunOptions gpu_run_options;
+  if (wait_lazily) {
+    gpu_run_options = *client_->gpu_run_options();
+    gpu_run_options.set_wait_for_parameters_callback(
+        [&lazy_events](absl::Span<const int64_t> parameter_numbers,
+                       se::Stream* stream) {
+          for (int64_t parameter_number : parameter_numbers) {
+            if (parameter_number >= lazy_events.size()) continue;
+            for (BufferSequencingEvent* event : lazy_events[parameter_number]) {
+              event->WaitForEventOnStream(stream);
+            }
+          }
+        });
+    run_options.set_gpu_executable_run_options(&gpu_run_options);
+  } else {
+    run_options.set_gpu_executable_run_options(client_->gpu_run_options());
+  }
   run_options.set_launch_id(options.launch_id);
   run_options.set_send_device_memory_function(&send_device_memory);
   run_options.set_recv_device_memory_function(&recv_device_memory);
@@ -2310,7 +2377,7 @@ StatusOr<ScopedShapedBuffer> PjRtStreamExecutorExecutable::EnqueueExecution(
     compute_callbacks.push_back(
         [references{std::make_tuple(executables_[executable_idx],
                                     compute_reservation, device_assignment)},
-         donated_ptrs{std::move(donated_ptrs)}, allocator{client_->allocator()},
+         donated_ptrs{std::move(donated_ptrs)}, allocator{allocator()},
          device_ordinal]() {
           for (const auto& ptr : donated_ptrs) {
             TF_CHECK_OK(allocator->Deallocate(device_ordinal, ptr));
@@ -2355,7 +2422,7 @@ PjRtStreamExecutorExecutable::MakeOutputBuffers(
       ShapedBuffer root_buffer_holder = result_buffer.release();
       se::DeviceMemoryBase root_buffer = root_buffer_holder.root_buffer();
       compute_callbacks.push_back(
-          [root_buffer, allocator{client_->allocator()}, device_ordinal]() {
+          [root_buffer, allocator{allocator()}, device_ordinal]() {
             TF_CHECK_OK(allocator->Deallocate(device_ordinal, root_buffer));
           });
     }
@@ -2779,6 +2846,7 @@ PjRtStreamExecutorClient::Compile(const XlaComputation& computation,
 
   TF_RETURN_IF_ERROR(
       executable->SetUpDonation(options.parameter_is_tupled_arguments));
+  executable->SetUpBufferPool(options.max_pooled_device_buffer_bytes);
   return std::unique_ptr<PjRtLoadedExecutable>(std::move(executable));
 }
 
@@ -2793,6 +2861,69 @@ PjRtStreamExecutorClient::Compile(mlir::ModuleOp module,
   return Compile(xla_computation, options);
 }
 
+namespace {
+
+// Returns the key of the compilation of `computation` with `options` in the
+// compile cache, or nullopt if `options` can't be fingerprinted.
+std::optional<std::string> CompileCacheKey(const XlaComputation& computation,
+                                           const CompileOptions& options) {
+  // The allocator is not part of the serialized options.
+  if (options.executable_build_options.device_allocator() != nullptr) {
+    return std::nullopt;
+  }
+  StatusOr<CompileOptionsProto> options_proto = options.ToProto();
+  if (!options_proto.ok()) {
+    return std::nullopt;
+  }
+  std::string serialized_computation;
+  std::string serialized_options;
+  if (!tsl::SerializeToStringDeterministic(computation.proto(),
+                                           &serialized_computation) ||
+      !tsl::SerializeToStringDeterministic(*options_proto,
+                                           &serialized_options)) {
+    return std::nullopt;
+  }
+  tsl::Fprint128 fingerprint = tsl::Fingerprint128(
+      absl::StrCat(serialized_computation, serialized_options));
+  return absl::StrCat(absl::Hex(fingerprint.high64, absl::kZeroPad16),
+                      absl::Hex(fingerprint.low64, absl::kZeroPad16));
+}
+
+}  // namespace
+
+PjRtFuture<StatusOr<std::shared_ptr<PjRtLoadedExecutable>>>
+PjRtStreamExecutorClient::CompileAsync(const XlaComputation& computation,
+                                       CompileOptions options) {
+  using CompileFuture =
+      PjRtFuture<StatusOr<std::shared_ptr<PjRtLoadedExecutable>>>;
+  std::optional<std::string> key = CompileCacheKey(computation, options);
+  auto schedule_compile = [&]() {
+    CompilePromise promise = CompileFuture::CreatePromise();
+    compile_thread_pool_.Schedule(
+        [this, promise,
+         computation = std::make_shared<XlaComputation>(computation.proto()),
+         options]() mutable {
+          tsl::profiler::TraceMe traceme(
+              "PjRtStreamExecutorClient::CompileAsync");
+          StatusOr<std::unique_ptr<PjRtLoadedExecutable>> executable =
+              Compile(*computation, options);
+          if (executable.ok()) {
+            promise.Set(std::shared_ptr<PjRtLoadedExecutable>(
+                std::move(executable).value()));
+          } else {
+            promise.Set(executable.status());
+          }
+        });
+    return promise;
+  };
+  if (!key.has_value()) {
+    return CompileFuture(schedule_compile());
+  }
+  absl::MutexLock lock(&compile_cache_mu_);
+  return CompileFuture(compile_cache_.GetOrCreateIfAbsent(
+      *key, [&](const std::string&) { return schedule_compile(); }));
+}
+
 StatusOr<std::string> PjRtStreamExecutorClient::SerializeExecutable(
     const PjRtLoadedExecutable& executable) const {
   const PjRtStreamExecutorExecutable* se_executable =
@@ -2867,6 +2998,7 @@ PjRtStreamExecutorClient::DeserializeExecutable(
 
   TF_RETURN_IF_ERROR(
       executable->SetUpDonation(options->parameter_is_tupled_arguments));
+  executable->SetUpBufferPool(options->max_pooled_device_buffer_bytes);
   return std::unique_ptr<PjRtLoadedExecutable>(std::move(executable));
 }
 
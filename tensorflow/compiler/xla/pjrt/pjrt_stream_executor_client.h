@@ -39,7 +39,9 @@ limitations under the License.
 #include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
 #include "tensorflow/compiler/xla/layout.h"
 #include "tensorflow/compiler/xla/literal.h"
+#include "tensorflow/compiler/xla/pjrt/device_buffer_pool.h"
 #include "tensorflow/compiler/xla/pjrt/local_device_state.h"
+#include "tensorflow/compiler/xla/pjrt/lru_cache.h"
 #include "tensorflow/compiler/xla/pjrt/pjrt_client.h"
 #include "tensorflow/compiler/xla/pjrt/pjrt_future.h"
 #include "tensorflow/compiler/xla/pjrt/tracked_device_buffer.h"
@@ -198,6 +200,12 @@ class PjRtStreamExecutorClient : public PjRtClient {
   StatusOr<std::unique_ptr<PjRtLoadedExecutable>> Compile(
       mlir::ModuleOp mlir_module, CompileOptions options) override;
 
+  // Compiles on a thread pool of the client. The identical compilations share
+  // the same executable, whether the first one is still in flight or complete,
+  // as long as it is among the most recent ones.
+  PjRtFuture<StatusOr<std::shared_ptr<PjRtLoadedExecutable>>> CompileAsync(
+      const XlaComputation& computation, CompileOptions options) override;
+
   StatusOr<std::optional<std::string>> ExecutableFingerprint(
       const PjRtLoadedExecutable& executable) const override {
     return std::optional<std::string>();
@@ -278,6 +286,11 @@ class PjRtStreamExecutorClient : public PjRtClient {
   }
   LocalClient* client() const { return client_; }
   se::DeviceMemoryAllocator* allocator() const { return allocator_; }
+  // Returns a new pool of device buffers on top of allocator(). The pool lives
+  // as long as the client, as the buffers allocated from it may outlive the
+  // executable that uses it.
+  DeviceBufferPool* CreateDeviceBufferPool(
+      int64_t max_cached_bytes_per_device);
   tsl::Allocator* host_memory_allocator() const {
     return host_memory_allocator_.get();
   }
@@ -349,6 +362,12 @@ class PjRtStreamExecutorClient : public PjRtClient {
   se::DeviceMemoryAllocator* allocator_;
   std::unique_ptr<se::DeviceMemoryAllocator> owned_allocator_;
 
+  // The device buffer pools of the executables, which must outlive the devices
+  // for the same reason as the allocator.
+  absl::Mutex device_buffer_pools_mu_;
+  std::vector<std::unique_ptr<DeviceBufferPool>> device_buffer_pools_
+      ABSL_GUARDED_BY(device_buffer_pools_mu_);
+
   // Includes all devices, including non-local devices on multi-host platforms.
   std::vector<std::unique_ptr<PjRtStreamExecutorDevice>> owned_devices_;
   // Pointers to `owned_devices_`.
@@ -370,6 +389,18 @@ class PjRtStreamExecutorClient : public PjRtClient {
 
   absl::Mutex transpose_mu_;
   TransposePlanCache transpose_cache_ ABSL_GUARDED_BY(transpose_mu_);
+
+  // The compilations of CompileAsync, by fingerprint of their computation and
+  // options.
+  using CompilePromise =
+      PjRtFuture<StatusOr<std::shared_ptr<PjRtLoadedExecutable>>>::Promise;
+  absl::Mutex compile_cache_mu_;
+  LRUCache<std::string, CompilePromise>::LRUList compile_lru_list_;
+  LRUCache<std::string, CompilePromise> compile_cache_
+      ABSL_GUARDED_BY(compile_cache_mu_);
+  // Declared last, so that the compilations in flight complete before the rest
+  // of the client is destroyed.
+  tsl::thread::ThreadPool compile_thread_pool_;
 };
 
 // Converts a 2D set of Device objects indexed by [replica][partition] into an
@@ -718,7 +749,7 @@ class PjRtStreamExecutorExecutable : public PjRtLoadedExecutable {
       std::vector<PjRtDevice*> addressable_devices,
       PjRtStreamExecutorClient* client);
 
-  ~PjRtStreamExecutorExecutable() override = default;
+  ~PjRtStreamExecutorExecutable() override;
 
   PjRtStreamExecutorClient* client() const override { return client_; }
 
@@ -820,6 +851,17 @@ class PjRtStreamExecutorExecutable : public PjRtLoadedExecutable {
   // donated due to aliases that were specified by the computation.
   Status SetUpDonation(bool tuple_inputs);
 
+  // Makes the executable allocate its output and temporary buffers from a
+  // device buffer pool that caches up to `max_pooled_device_buffer_bytes` of
+  // the released buffers per device.
+  void SetUpBufferPool(int64_t max_pooled_device_buffer_bytes);
+
+  // Returns the allocator of the output and temporary buffers of the
+  // executions.
+  se::DeviceMemoryAllocator* allocator() const {
+    return buffer_pool_ != nullptr ? buffer_pool_ : client_->allocator();
+  }
+
   // Returns a sorted list of the parameters that must be donated. Derived
   // classes may use custom logic.
   virtual absl::Span<int const> ParametersThatMustBeDonated(
@@ -862,6 +904,9 @@ class PjRtStreamExecutorExecutable : public PjRtLoadedExecutable {
   PjRtStreamExecutorClient* const client_;
   // One executable per partition.
   std::vector<std::shared_ptr<LocalExecutable>> executables_;
+  // If set, the pool of the client the output and temporary buffers are
+  // allocated from.
+  DeviceBufferPool* buffer_pool_ = nullptr;
   // On device shapes of the executable parameters.
   std::vector<std::vector<Shape>> on_device_executable_parameter_shapes_;
   // Per-executable sorted vector of parameters that have any aliased buffers
@@ -114,5 +114,35 @@ TEST(PjRtStreamExecutorClientTest, DonateSameBufferTwice) {
               ::testing::HasSubstr("f(donate(a), donate(a))"));
 }
 
+TEST(PjRtStreamExecutorClientTest, CompileAsyncSharesIdenticalCompilations) {
+  TF_ASSERT_OK_AND_ASSIGN(auto client, GetClient());
+  auto shape = xla::ShapeUtil::MakeScalarShape(xla::F32);
+  XlaBuilder builder("Add");
+  Add(Parameter(&builder, 0, shape, "a"), Parameter(&builder, 1, shape, "b"));
+  TF_ASSERT_OK_AND_ASSIGN(auto computation, builder.Build());
+  XlaBuilder other_builder("Mul");
+  Mul(Parameter(&other_builder, 0, shape, "a"),
+      Parameter(&other_builder, 1, shape, "b"));
+  TF_ASSERT_OK_AND_ASSIGN(auto other_computation, other_builder.Build());
+
+  auto first = client->CompileAsync(computation, CompileOptions());
+  auto second = client->CompileAsync(computation, CompileOptions());
+  auto other = client->CompileAsync(other_computation, CompileOptions());
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<PjRtLoadedExecutable> executable,
+                          first.Await());
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<PjRtLoadedExecutable> same,
+                          second.Await());
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<PjRtLoadedExecutable> different,
+                          other.Await());
+  EXPECT_EQ(executable, same);
+  EXPECT_NE(executable, different);
+
+  // Once complete, the compilation is still shared.
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<PjRtLoadedExecutable> cached,
+      client->CompileAsync(computation, CompileOptions()).Await());
+  EXPECT_EQ(executable, cached);
+}
+
 }  // namespace
 }  // namespace xla
@@ -56,6 +56,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/shape.h"
 #include "tensorflow/compiler/xla/statusor.h"
 #include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "tensorflow/tsl/platform/cpu_info.h"
 #include "tensorflow/tsl/platform/denormal.h"
 #include "tensorflow/tsl/platform/setround.h"
 #include "tensorflow/tsl/profiler/lib/connected_traceme.h"
@@ -121,11 +122,25 @@ static void EnqueueWorkWhenReady(
   });
 }
 
-TfrtCpuDevice::TfrtCpuDevice(int id, bool asynchronous)
+TfrtCpuDevice::TfrtCpuDevice(int id, bool asynchronous, int numa_node,
+                             int num_intra_op_threads)
     : id_(id),
-      max_inflight_computations_semaphore_(/*capacity=*/asynchronous ? 32 : 1) {
+      max_inflight_computations_semaphore_(/*capacity=*/asynchronous ? 32 : 1),
+      numa_node_(numa_node) {
   debug_string_ = absl::StrCat("TFRT_CPU_", id);
   to_string_ = absl::StrCat("CpuDevice(id=", id, ")");
+  if (numa_node_ != tsl::port::kNUMANoAffinity) {
+    CHECK_GT(num_intra_op_threads, 0);
+    attributes_["numa_node"] = PjRtDeviceAttribute(int64_t{numa_node_});
+    tsl::ThreadOptions thread_options;
+    thread_options.numa_node = numa_node_;
+    eigen_intraop_pool_ = std::make_unique<tsl::thread::ThreadPool>(
+        tsl::Env::Default(), thread_options, absl::StrCat("XLAEigen_", id),
+        num_intra_op_threads);
+    eigen_intraop_device_ = std::make_unique<Eigen::ThreadPoolDevice>(
+        eigen_intraop_pool_->AsEigenThreadPool(),
+        eigen_intraop_pool_->NumThreads());
+  }
 }
 
 absl::string_view TfrtCpuDevice::device_kind() const {
@@ -152,23 +167,40 @@ static int CpuDeviceCount() {
 }
 
 static StatusOr<std::vector<std::unique_ptr<TfrtCpuDevice>>> GetTfrtCpuDevices(
-    bool asynchronous, int cpu_device_count) {
+    bool asynchronous, int cpu_device_count, bool bind_devices_to_numa_nodes) {
+  int num_numa_nodes = 1;
+  if (bind_devices_to_numa_nodes && tsl::port::NUMAEnabled()) {
+    num_numa_nodes = tsl::port::NUMANumNodes();
+  }
   std::vector<std::unique_ptr<TfrtCpuDevice>> devices;
   for (int i = 0; i < cpu_device_count; ++i) {
-    auto device = std::make_unique<TfrtCpuDevice>(
-        /*id=*/i, asynchronous);
-    devices.push_back(std::move(device));
+    if (num_numa_nodes <= 1) {
+      devices.push_back(std::make_unique<TfrtCpuDevice>(
+          /*id=*/i, asynchronous));
+      continue;
+    }
+    int numa_node = i % num_numa_nodes;
+    // The cores of a node are shared between the devices bound to it.
+    int devices_on_node = (cpu_device_count - numa_node + num_numa_nodes - 1) /
+                          num_numa_nodes;
+    int num_intra_op_threads = std::max(
+        1, tsl::port::MaxParallelism(numa_node) / devices_on_node);
+    VLOG(1) << "Binding CPU device " << i << " to NUMA node " << numa_node
+            << " with " << num_intra_op_threads << " intra-op threads";
+    devices.push_back(std::make_unique<TfrtCpuDevice>(
+        /*id=*/i, asynchronous, numa_node, num_intra_op_threads));
   }
   return std::move(devices);
 }
 
-StatusOr<std::unique_ptr<PjRtClient>> GetTfrtCpuClient(bool asynchronous,
-                                                       int cpu_device_count) {
+StatusOr<std::unique_ptr<PjRtClient>> GetTfrtCpuClient(
+    bool asynchronous, int cpu_device_count, bool bind_devices_to_numa_nodes) {
   // Need at least CpuDeviceCount threads to launch one collective.
   size_t num_threads = std::max(DefaultThreadPoolSize(), cpu_device_count);
 
   TF_ASSIGN_OR_RETURN(std::vector<std::unique_ptr<TfrtCpuDevice>> devices,
-                      GetTfrtCpuDevices(asynchronous, cpu_device_count));
+                      GetTfrtCpuDevices(asynchronous, cpu_device_count,
+                                        bind_devices_to_numa_nodes));
 
   return std::unique_ptr<PjRtClient>(std::make_unique<TfrtCpuClient>(
       /*process_index=*/0, std::move(devices), num_threads));
@@ -552,7 +584,8 @@ StatusOr<std::unique_ptr<TfrtCpuBuffer>> AllocateDestinationBuffer(
   if (!on_device_shape.IsTuple()) {
     size_t byte_size = ShapeUtil::ByteSizeOf(on_device_shape);
     TF_ASSIGN_OR_RETURN(auto device_buffer,
-                        MaybeOwningCpuMemory::AllocateShared(byte_size));
+                        MaybeOwningCpuMemory::AllocateShared(
+                            byte_size, device->numa_node()));
     buffers.push_back(std::move(device_buffer));
     return std::make_unique<TfrtCpuBuffer>(
         on_device_shape,
@@ -566,7 +599,8 @@ StatusOr<std::unique_ptr<TfrtCpuBuffer>> AllocateDestinationBuffer(
   for (const auto& leaf_shape : on_device_shape.tuple_shapes()) {
     size_t byte_size = ShapeUtil::ByteSizeOf(leaf_shape);
     TF_ASSIGN_OR_RETURN(auto device_buffer,
-                        MaybeOwningCpuMemory::AllocateShared(byte_size));
+                        MaybeOwningCpuMemory::AllocateShared(
+                            byte_size, device->numa_node()));
     buffers.push_back(std::move(device_buffer));
   }
   return std::make_unique<TfrtCpuBuffer>(
@@ -633,8 +667,11 @@ StatusOr<std::unique_ptr<PjRtBuffer>> TfrtCpuClient::BufferFromHostBuffer(
     buffers.push_back(std::move(device_buffer));
     on_delete_callback = std::move(on_done_with_host_buffer);
   } else {
-    TF_ASSIGN_OR_RETURN(auto device_buffer,
-                        MaybeOwningCpuMemory::AllocateShared(byte_size));
+    TF_ASSIGN_OR_RETURN(
+        auto device_buffer,
+        MaybeOwningCpuMemory::AllocateShared(
+            byte_size,
+            tensorflow::down_cast<TfrtCpuDevice*>(device)->numa_node()));
     auto dst_data_ptr = device_buffer->data();
     buffers.push_back(device_buffer);
     if (!has_default_layout) {
@@ -1158,8 +1195,11 @@ StatusOr<std::unique_ptr<PjRtBuffer>> TfrtCpuBuffer::CopyToDevice(
 
   for (int i = 0; i < num_leaf_buffers; ++i) {
     auto src_buffer = src_device_buffer->Buffers()[i];
-    TF_ASSIGN_OR_RETURN(auto dst_buffer, MaybeOwningCpuMemory::AllocateShared(
-                                             src_buffer->size()));
+    TF_ASSIGN_OR_RETURN(
+        auto dst_buffer,
+        MaybeOwningCpuMemory::AllocateShared(
+            src_buffer->size(),
+            tensorflow::down_cast<TfrtCpuDevice*>(dst_device)->numa_node()));
     src_buffers.push_back(std::move(src_buffer));
     dst_buffers.push_back(std::move(dst_buffer));
     dst_definition_events.push_back(
@@ -1328,7 +1368,8 @@ Status TfrtCpuExecutable::SetUpDonation(bool tuple_inputs) {
 // and assemble the buffer pointers in order to call into CpuExecutable.
 static StatusOr<std::shared_ptr<MaybeOwningCpuMemory>> MemoryForAllocation(
     const BufferAllocation& allocation,
-    absl::Span<std::pair<bool, TrackedTfrtCpuDeviceBuffer*> const> arguments) {
+    absl::Span<std::pair<bool, TrackedTfrtCpuDeviceBuffer*> const> arguments,
+    int numa_node) {
   if (allocation.is_entry_computation_parameter()) {
     auto [can_donate, arg] = arguments[allocation.parameter_number()];
     std::shared_ptr<MaybeOwningCpuMemory> out =
@@ -1341,8 +1382,8 @@ static StatusOr<std::shared_ptr<MaybeOwningCpuMemory>> MemoryForAllocation(
     // example we might be pointing to a buffer owned by the client whose
     // lifetime will not extend past the lifetime of the donated input buffer.
     if ((!can_donate || !out->owns_data()) && !allocation.is_readonly()) {
-      TF_ASSIGN_OR_RETURN(
-          auto copy, MaybeOwningCpuMemory::AllocateShared(allocation.size()));
+      TF_ASSIGN_OR_RETURN(auto copy, MaybeOwningCpuMemory::AllocateShared(
+                                         allocation.size(), numa_node));
       std::memcpy(copy->data(), out->data(), allocation.size());
       return copy;
     }
@@ -1354,8 +1395,8 @@ static StatusOr<std::shared_ptr<MaybeOwningCpuMemory>> MemoryForAllocation(
   }
 
   // Output and temporary buffer.
-  TF_ASSIGN_OR_RETURN(auto out,
-                      MaybeOwningCpuMemory::AllocateShared(allocation.size()));
+  TF_ASSIGN_OR_RETURN(auto out, MaybeOwningCpuMemory::AllocateShared(
+                                    allocation.size(), numa_node));
 
   // Since the output buffer and all the temporary buffers were written into
   // by the JITed code, msan has no way of knowing their memory was
@@ -1368,13 +1409,15 @@ static StatusOr<std::shared_ptr<MaybeOwningCpuMemory>> MemoryForAllocation(
 static StatusOr<std::vector<std::shared_ptr<MaybeOwningCpuMemory>>>
 CreateBufferTable(
     const BufferAssignment& assignment,
-    absl::Span<std::pair<bool, TrackedTfrtCpuDeviceBuffer*> const> arguments) {
+    absl::Span<std::pair<bool, TrackedTfrtCpuDeviceBuffer*> const> arguments,
+    int numa_node) {
   std::vector<std::shared_ptr<MaybeOwningCpuMemory>> buffers(
       assignment.Allocations().size());
   for (BufferAllocation::Index i = 0; i < assignment.Allocations().size();
        ++i) {
     const BufferAllocation& allocation = assignment.GetAllocation(i);
-    TF_ASSIGN_OR_RETURN(buffers[i], MemoryForAllocation(allocation, arguments));
+    TF_ASSIGN_OR_RETURN(buffers[i],
+                        MemoryForAllocation(allocation, arguments, numa_node));
   }
   return std::move(buffers);
 }
@@ -1566,7 +1609,8 @@ StatusOr<PjRtLoadedExecutable::Result> TfrtCpuExecutable::ExecuteHelper(
       tensorflow::down_cast<cpu::CpuExecutable*>(cpu_executable_.get());
   TF_ASSIGN_OR_RETURN(
       std::vector<std::shared_ptr<MaybeOwningCpuMemory>> buffer_table,
-      CreateBufferTable(cpu_executable->buffer_assignment(), tracked_buffers));
+      CreateBufferTable(cpu_executable->buffer_assignment(), tracked_buffers,
+                        device->numa_node()));
   auto result_buffers =
       CreateResultShapedBuffer(result_buffer_indices_, buffer_table);
 
@@ -1591,7 +1635,10 @@ StatusOr<PjRtLoadedExecutable::Result> TfrtCpuExecutable::ExecuteHelper(
   run_options.set_device_ordinal(device->local_hardware_id());
   // Need to keep device_assignment alive until execution completes.
   run_options.set_device_assignment(device_assignment.get());
-  run_options.set_intra_op_thread_pool(client_->eigen_intraop_device());
+  run_options.set_intra_op_thread_pool(
+      device->eigen_intraop_device() != nullptr
+          ? device->eigen_intraop_device()
+          : client_->eigen_intraop_device());
 
   // Schedule only one collective at a time.
   bool is_a_collective_launch = !!last_collective_launch_event;
@@ -46,6 +46,8 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/hlo_module_util.h"
 #include "tensorflow/compiler/xla/statusor.h"
 #include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "tensorflow/tsl/platform/numa.h"
+#include "tensorflow/tsl/platform/threadpool.h"
 #include "tensorflow/tsl/profiler/lib/traceme.h"
 #include "tfrt/host_context/async_value_ref.h"  // from @tf_runtime
 
@@ -53,7 +55,12 @@ namespace xla {
 
 class TfrtCpuDevice final : public PjRtDevice {
  public:
-  TfrtCpuDevice(int id, bool asynchronous);
+  // If `numa_node` is not kNUMANoAffinity, the buffers of the device are
+  // allocated on that node and its computations run on its own pool of
+  // `num_intra_op_threads` threads bound to the node.
+  TfrtCpuDevice(int id, bool asynchronous,
+                int numa_node = tsl::port::kNUMANoAffinity,
+                int num_intra_op_threads = 0);
 
   void SetClient(PjRtClient* client) {
     CHECK(client_ == nullptr);
@@ -98,6 +105,15 @@ class TfrtCpuDevice final : public PjRtDevice {
     return attributes_;
   }
 
+  // The NUMA node the device is bound to, or kNUMANoAffinity.
+  int numa_node() const { return numa_node_; }
+
+  // The intra-op thread pool of the device, or nullptr if the device is not
+  // bound to a NUMA node and uses the pool of the client.
+  Eigen::ThreadPoolDevice* eigen_intraop_device() const {
+    return eigen_intraop_device_.get();
+  }
+
  private:
   int id_;
   PjRtClient* client_ = nullptr;
@@ -109,6 +125,10 @@ class TfrtCpuDevice final : public PjRtDevice {
   // ahead of the device.
   Semaphore max_inflight_computations_semaphore_;
   absl::flat_hash_map<std::string, PjRtDeviceAttribute> attributes_ = {};
+
+  int numa_node_;
+  std::unique_ptr<tsl::thread::ThreadPool> eigen_intraop_pool_;
+  std::unique_ptr<Eigen::ThreadPoolDevice> eigen_intraop_device_;
 };
 
 class TfrtCpuExecutable;
@@ -626,9 +646,13 @@ class TfrtCpuExecutable final : public PjRtLoadedExecutable {
 StatusOr<std::unique_ptr<PjRtClient>> GetTfrtCpuClient(bool asynchronous);
 
 // Similar to the function above, but you can set the number of devices
-// explicitly.
-StatusOr<std::unique_ptr<PjRtClient>> GetTfrtCpuClient(bool asynchronous,
-                                                       int cpu_device_count);
+// explicitly. If `bind_devices_to_numa_nodes` is true and the host has several
+// NUMA nodes, the devices are spread round-robin over the nodes, e.g. one per
+// socket, and each device allocates its buffers on its node and runs its
+// computations on threads bound to it.
+StatusOr<std::unique_ptr<PjRtClient>> GetTfrtCpuClient(
+    bool asynchronous, int cpu_device_count,
+    bool bind_devices_to_numa_nodes = false);
 
 }  // namespace xla
 
@@ -15,7 +15,10 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/pjrt/tfrt_cpu_pjrt_client.h"
 
+#include <memory>
 #include <string>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #include <gmock/gmock.h>
@@ -143,5 +146,51 @@ TEST(TfrtCpuClientTest, HloSnapshot) {
       LiteralUtil::CreateR2<float>({{11.0, 22.0}, {33.0, 44.0}, {55.0, 66.0}}));
 }
 
+TEST(TfrtCpuClientTest, NumaBoundDevice) {
+  constexpr char kProgram[] = R"(
+    HloModule add
+    ENTRY add {
+      x = f32[16384] parameter(0)
+      ROOT add = f32[16384] add(x, x)
+    })";
+
+  // NUMA node 0 exists on every host, and the binding is a no-op where NUMA
+  // isn't supported.
+  std::vector<std::unique_ptr<TfrtCpuDevice>> devices;
+  devices.push_back(std::make_unique<TfrtCpuDevice>(
+      /*id=*/0, /*asynchronous=*/true, /*numa_node=*/0,
+      /*num_intra_op_threads=*/2));
+  auto client = std::make_unique<TfrtCpuClient>(
+      /*process_index=*/0, std::move(devices), /*num_threads=*/4);
+  PjRtDevice* device = client->addressable_devices()[0];
+  EXPECT_NE(tensorflow::down_cast<TfrtCpuDevice*>(device)
+                ->eigen_intraop_device(),
+            nullptr);
+  EXPECT_EQ(std::get<int64_t>(device->Attributes().at("numa_node")), 0);
+
+  TF_ASSERT_OK_AND_ASSIGN(auto hlo_module,
+                          ParseAndReturnUnverifiedModule(kProgram, {}));
+  XlaComputation xla_computation(hlo_module->ToProto());
+  TF_ASSERT_OK_AND_ASSIGN(auto pjrt_executable,
+                          client->Compile(xla_computation, {}));
+
+  // Large enough to be allocated on the NUMA node.
+  std::vector<float> data(16384, 1.0);
+  Shape shape = ShapeUtil::MakeShape(F32, {16384});
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto buffer,
+      client->BufferFromHostBuffer(
+          data.data(), shape.element_type(), shape.dimensions(),
+          /*byte_strides=*/std::nullopt,
+          PjRtClient::HostBufferSemantics::kImmutableOnlyDuringCall, nullptr,
+          device));
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto result, pjrt_executable->Execute(
+                       /*argument_handles=*/{{buffer.get()}}, /*options=*/{}));
+  TF_ASSERT_OK_AND_ASSIGN(auto literal, result[0][0]->ToLiteralSync());
+  EXPECT_EQ(*literal,
+            LiteralUtil::CreateR1<float>(std::vector<float>(16384, 2.0)));
+}
+
 }  // namespace
 }  // namespace xla
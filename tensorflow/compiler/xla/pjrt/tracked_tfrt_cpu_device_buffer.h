@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/tsl/platform/mem.h"
+#include "tensorflow/tsl/platform/numa.h"
 #include "tfrt/host_context/async_value_ref.h"  // from @tf_runtime
 
 namespace xla {
@@ -40,8 +41,7 @@ class MaybeOwningCpuMemory {
       : buf_(buf), size_(size) {}
 
   // Owning.
-  using OwnedDataPtr =
-      std::unique_ptr<uint8_t[], decltype(tsl::port::AlignedFree)*>;
+  using OwnedDataPtr = std::unique_ptr<uint8_t[], std::function<void(void*)>>;
   explicit MaybeOwningCpuMemory(OwnedDataPtr data, size_t size)
       : buf_(data.get()), data_(std::move(data)), size_(size) {}
 
@@ -63,11 +63,36 @@ class MaybeOwningCpuMemory {
         OwnedDataPtr{data, tsl::port::AlignedFree}, size);
   }
 
+  // Owning, with affinity to `numa_node`. Falls back to `AllocateShared(size)`
+  // if `numa_node` is kNUMANoAffinity, if NUMA is not supported, or for the
+  // small buffers, for which NUMA allocations, that are rounded up to whole
+  // pages, would be too slow and wasteful.
+  static StatusOr<std::shared_ptr<MaybeOwningCpuMemory>> AllocateShared(
+      size_t size, int numa_node) {
+    if (numa_node == tsl::port::kNUMANoAffinity || !tsl::port::NUMAEnabled() ||
+        size < kMinNumaAllocationSize) {
+      return AllocateShared(size);
+    }
+    uint8_t* data = static_cast<uint8_t*>(tsl::port::NUMAMalloc(
+        numa_node, size, cpu_function_runtime::MinAlign()));
+    if (!data) {
+      return ResourceExhausted(
+          "Out of memory allocating %d bytes on NUMA node %d.", size,
+          numa_node);
+    }
+    auto numa_free = [size](void* ptr) { tsl::port::NUMAFree(ptr, size); };
+    return std::make_shared<MaybeOwningCpuMemory>(
+        OwnedDataPtr{data, std::move(numa_free)}, size);
+  }
+
   void* data() const { return buf_; }
   size_t size() const { return size_; }
   bool owns_data() const { return data_ != nullptr; }
 
  private:
+  // The smallest buffer allocated with a NUMA affinity.
+  static constexpr size_t kMinNumaAllocationSize = 64 * 1024;
+
   void* buf_ = nullptr;                  // Non-owning data pointer.
   OwnedDataPtr data_ = {nullptr, free};  // Owning data pointer;
   size_t size_ = 0;                      // Size in number of bytes.
@@ -0,0 +1,443 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/blockwise_attention_rewriter.h"
+
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_computation.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instruction.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_opcode.h"
+#include "tensorflow/compiler/xla/literal_util.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/service/hlo_creation_utils.h"
+#include "tensorflow/compiler/xla/service/while_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/status_macros.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/logging.h"
+#include "tensorflow/tsl/platform/statusor.h"
+
+namespace xla {
+
+namespace {
+
+// The instructions of a matched attention, see the header for the pattern.
+struct Attention {
+  HloInstruction* scores_dot;  // dot(q, k)
+  HloInstruction* scale;       // Scalar constant, or nullptr.
+  HloInstruction* mask;        // Same shape as the scores, or nullptr.
+  HloInstruction* output_dot;  // dot(probs, v)
+  // The dimension of k, and of v, along which the keys are laid out.
+  int64_t k_keys_dim;
+  int64_t v_keys_dim;
+};
+
+std::vector<int64_t> Iota(int64_t n) {
+  std::vector<int64_t> result(n);
+  std::iota(result.begin(), result.end(), 0);
+  return result;
+}
+
+// Returns whether 'reduce' reduces the last dimension of 'operand' with a
+// 'opcode' computation.
+bool IsReductionOfLastDim(const HloInstruction* reduce,
+                          const HloInstruction* operand, HloOpcode opcode) {
+  if (reduce->opcode() != HloOpcode::kReduce ||
+      reduce->operand_count() != 2 || reduce->operand(0) != operand ||
+      reduce->operand(1)->opcode() != HloOpcode::kConstant ||
+      reduce->dimensions() !=
+          std::vector<int64_t>{operand->shape().rank() - 1}) {
+    return false;
+  }
+  const HloInstruction* root = reduce->to_apply()->root_instruction();
+  return root->opcode() == opcode &&
+         root->operand(0)->opcode() == HloOpcode::kParameter &&
+         root->operand(1)->opcode() == HloOpcode::kParameter;
+}
+
+// If 'broadcast' broadcasts the reduction of the last dimension of 'operand'
+// back to the shape of 'operand', returns the reduction.
+HloInstruction* GetBroadcastReductionOfLastDim(HloInstruction* broadcast,
+                                               const HloInstruction* operand,
+                                               HloOpcode opcode) {
+  if (broadcast->opcode() != HloOpcode::kBroadcast ||
+      broadcast->user_count() != 1 ||
+      broadcast->dimensions() != Iota(operand->shape().rank() - 1)) {
+    return nullptr;
+  }
+  HloInstruction* reduce = broadcast->mutable_operand(0);
+  if (reduce->user_count() != 1 ||
+      !IsReductionOfLastDim(reduce, operand, opcode)) {
+    return nullptr;
+  }
+  return reduce;
+}
+
+// Returns the number of dimensions of the operand of 'dot' that are neither
+// batch nor contracting dimensions.
+int64_t NumNonContractingDims(const HloInstruction* dot, int64_t operand) {
+  const DotDimensionNumbers& dnums = dot->dot_dimension_numbers();
+  int64_t num_batch_dims = operand == 0 ? dnums.lhs_batch_dimensions_size()
+                                        : dnums.rhs_batch_dimensions_size();
+  int64_t num_contracting_dims = operand == 0
+                                     ? dnums.lhs_contracting_dimensions_size()
+                                     : dnums.rhs_contracting_dimensions_size();
+  return dot->operand(operand)->shape().rank() - num_batch_dims -
+         num_contracting_dims;
+}
+
+// Matches the attention whose output is 'output_dot'.
+std::optional<Attention> MatchAttention(HloInstruction* output_dot) {
+  if (output_dot->opcode() != HloOpcode::kDot) return std::nullopt;
+
+  // The probabilities are [batch..., queries, keys], and are contracted along
+  // the keys with v.
+  HloInstruction* probs = output_dot->mutable_operand(0);
+  const Shape& shape = probs->shape();
+  const int64_t rank = shape.rank();
+  const DotDimensionNumbers& output_dnums =
+      output_dot->dot_dimension_numbers();
+  if (rank < 2 || !primitive_util::IsFloatingPointType(shape.element_type()) ||
+      output_dot->shape().element_type() != shape.element_type() ||
+      probs->user_count() != 1 || probs->opcode() != HloOpcode::kDivide ||
+      !absl::c_equal(output_dnums.lhs_batch_dimensions(), Iota(rank - 2)) ||
+      !absl::c_equal(output_dnums.lhs_contracting_dimensions(),
+                     std::vector<int64_t>{rank - 1}) ||
+      NumNonContractingDims(output_dot, 1) != 1) {
+    return std::nullopt;
+  }
+
+  // probs = exp / broadcast(sum(exp))
+  HloInstruction* exp = probs->mutable_operand(0);
+  if (exp->opcode() != HloOpcode::kExp || exp->user_count() != 2 ||
+      GetBroadcastReductionOfLastDim(probs->mutable_operand(1), exp,
+                                     HloOpcode::kAdd) == nullptr) {
+    return std::nullopt;
+  }
+
+  // exp = exp(scores - broadcast(max(scores)))
+  HloInstruction* shifted = exp->mutable_operand(0);
+  if (shifted->opcode() != HloOpcode::kSubtract ||
+      shifted->user_count() != 1) {
+    return std::nullopt;
+  }
+  HloInstruction* scores = shifted->mutable_operand(0);
+  if (scores->user_count() != 2 ||
+      GetBroadcastReductionOfLastDim(shifted->mutable_operand(1), scores,
+                                     HloOpcode::kMaximum) == nullptr) {
+    return std::nullopt;
+  }
+
+  Attention attention;
+  attention.scale = nullptr;
+  attention.mask = nullptr;
+  attention.output_dot = output_dot;
+
+  // scores = dot(q, k) [* broadcast(scale)] [+ mask]
+  auto is_scaled_dot = [](const HloInstruction* instr) {
+    if (instr->opcode() == HloOpcode::kMultiply) {
+      return instr->user_count() == 1 &&
+             absl::c_any_of(instr->operands(), [](const HloInstruction* op) {
+               return op->opcode() == HloOpcode::kDot;
+             });
+    }
+    return instr->opcode() == HloOpcode::kDot;
+  };
+  if (scores->opcode() == HloOpcode::kAdd) {
+    HloInstruction* masked = scores;
+    for (int64_t i = 0; i < 2; ++i) {
+      if (is_scaled_dot(masked->operand(i))) {
+        attention.mask = masked->mutable_operand(1 - i);
+        scores = masked->mutable_operand(i);
+        break;
+      }
+    }
+    if (attention.mask == nullptr || scores->user_count() != 1) {
+      return std::nullopt;
+    }
+  }
+  if (scores->opcode() == HloOpcode::kMultiply) {
+    HloInstruction* scaled = scores;
+    for (int64_t i = 0; i < 2; ++i) {
+      const HloInstruction* broadcast = scaled->operand(1 - i);
+      if (scaled->operand(i)->opcode() == HloOpcode::kDot &&
+          broadcast->opcode() == HloOpcode::kBroadcast &&
+          broadcast->operand(0)->opcode() == HloOpcode::kConstant &&
+          ShapeUtil::IsScalar(broadcast->operand(0)->shape())) {
+        attention.scale = broadcast->mutable_operand(0);
+        scores = scaled->mutable_operand(i);
+        break;
+      }
+    }
+    if (attention.scale == nullptr) return std::nullopt;
+  }
+
+  // The scores are [batch..., queries, keys], so q and k have a single
+  // non-contracting dimension each. Without scale nor mask, the dot is used by
+  // both the max and the shift of the softmax.
+  HloInstruction* scores_dot = scores;
+  const int64_t num_users = scores_dot == shifted->operand(0) ? 2 : 1;
+  if (scores_dot->opcode() != HloOpcode::kDot ||
+      scores_dot->user_count() != num_users ||
+      scores_dot->shape().element_type() != shape.element_type() ||
+      scores_dot->dot_dimension_numbers().lhs_batch_dimensions_size() !=
+          rank - 2 ||
+      NumNonContractingDims(scores_dot, 0) != 1 ||
+      NumNonContractingDims(scores_dot, 1) != 1) {
+    return std::nullopt;
+  }
+  attention.scores_dot = scores_dot;
+
+  const DotDimensionNumbers& scores_dnums =
+      scores_dot->dot_dimension_numbers();
+  for (int64_t i = 0; i < scores_dot->operand(1)->shape().rank(); ++i) {
+    if (!absl::c_linear_search(scores_dnums.rhs_batch_dimensions(), i) &&
+        !absl::c_linear_search(scores_dnums.rhs_contracting_dimensions(), i)) {
+      attention.k_keys_dim = i;
+    }
+  }
+  attention.v_keys_dim = output_dnums.rhs_contracting_dimensions(0);
+  if (attention.mask != nullptr &&
+      !ShapeUtil::SameDimensions(attention.mask->shape(), shape)) {
+    return std::nullopt;
+  }
+  return attention;
+}
+
+// Slices 'operand' along 'dim', from 'start' to 'start' + 'size'.
+StatusOr<HloInstruction*> SliceBlock(HloInstruction* operand, int64_t dim,
+                                     HloInstruction* start, int64_t size) {
+  HloComputation* computation = operand->parent();
+  HloInstruction* zero = computation->AddInstruction(
+      HloInstruction::CreateConstant(LiteralUtil::Zero(S32)));
+  std::vector<HloInstruction*> start_indices(operand->shape().rank(), zero);
+  start_indices[dim] = start;
+  std::vector<int64_t> slice_sizes(operand->shape().dimensions().begin(),
+                                   operand->shape().dimensions().end());
+  slice_sizes[dim] = size;
+  return MakeDynamicSliceHlo(operand, start_indices, slice_sizes);
+}
+
+HloInstruction* BroadcastScalar(HloComputation* computation, Literal literal,
+                                const Shape& shape) {
+  HloInstruction* scalar = computation->AddInstruction(
+      HloInstruction::CreateConstant(std::move(literal)));
+  return MakeBroadcastHlo(scalar, {}, shape);
+}
+
+// Replaces 'attention' with a loop over the blocks of keys.
+Status RewriteAttention(const Attention& attention, int64_t block_size) {
+  HloComputation* computation = attention.output_dot->parent();
+  HloInstruction* scores_dot = attention.scores_dot;
+  HloInstruction* output_dot = attention.output_dot;
+  const Shape& scores_shape = output_dot->operand(0)->shape();
+  const int64_t rank = scores_shape.rank();
+  const PrimitiveType type = scores_shape.element_type();
+  const int64_t num_keys = scores_shape.dimensions(rank - 1);
+  // The shape of the running max and sum: [batch..., queries].
+  const Shape row_shape = ShapeUtil::DeleteDimension(rank - 1, scores_shape);
+
+  WhileUtil::LoopStateTy init_values = {
+      scores_dot->mutable_operand(0),
+      scores_dot->mutable_operand(1),
+      output_dot->mutable_operand(1),
+      BroadcastScalar(computation, LiteralUtil::MinValue(type), row_shape),
+      BroadcastScalar(computation, LiteralUtil::Zero(type), row_shape),
+      BroadcastScalar(computation, LiteralUtil::Zero(type),
+                      output_dot->shape()),
+  };
+  // A broadcasted mask, e.g. the same mask for all the heads, is broadcasted
+  // one block at a time in the loop rather than materialized.
+  HloInstruction* mask_broadcast = nullptr;
+  if (attention.mask != nullptr) {
+    if (attention.mask->opcode() == HloOpcode::kBroadcast) {
+      mask_broadcast = attention.mask;
+      init_values.push_back(mask_broadcast->mutable_operand(0));
+    } else {
+      init_values.push_back(attention.mask);
+    }
+  }
+
+  auto loop_body = [&](HloInstruction* block_index,
+                       const WhileUtil::LoopStateTy& values)
+      -> StatusOr<WhileUtil::LoopStateTy> {
+    HloComputation* body = block_index->parent();
+    HloInstruction* q = values[0];
+    HloInstruction* k = values[1];
+    HloInstruction* v = values[2];
+    HloInstruction* max = values[3];
+    HloInstruction* sum = values[4];
+    HloInstruction* output = values[5];
+
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * start,
+        MakeBinaryHlo(HloOpcode::kMultiply, block_index,
+                      body->AddInstruction(HloInstruction::CreateConstant(
+                          LiteralUtil::CreateR0<int32_t>(block_size)))));
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * k_block,
+        SliceBlock(k, attention.k_keys_dim, start, block_size));
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * v_block,
+        SliceBlock(v, attention.v_keys_dim, start, block_size));
+
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * scores,
+        MakeDotHlo(q, k_block, scores_dot->dot_dimension_numbers(),
+                   scores_dot->precision_config(),
+                   /*preferred_element_type=*/type));
+    if (attention.scale != nullptr) {
+      HloInstruction* scale = MakeBroadcastHlo(
+          body->AddInstruction(attention.scale->Clone()), {}, scores->shape());
+      TF_ASSIGN_OR_RETURN(scores,
+                          MakeBinaryHlo(HloOpcode::kMultiply, scores, scale));
+    }
+    if (attention.mask != nullptr) {
+      HloInstruction* mask_block = values[6];
+      if (mask_broadcast != nullptr) {
+        absl::Span<const int64_t> dims = mask_broadcast->dimensions();
+        auto keys_dim = absl::c_find(dims, rank - 1);
+        if (keys_dim != dims.end()) {
+          TF_ASSIGN_OR_RETURN(
+              mask_block, SliceBlock(mask_block, keys_dim - dims.begin(),
+                                     start, block_size));
+        }
+        mask_block = MakeBroadcastHlo(mask_block, dims, scores->shape());
+      } else {
+        TF_ASSIGN_OR_RETURN(
+            mask_block, SliceBlock(mask_block, rank - 1, start, block_size));
+      }
+      TF_ASSIGN_OR_RETURN(scores,
+                          MakeBinaryHlo(HloOpcode::kAdd, scores, mask_block));
+    }
+
+    // The running max stays -inf for the rows whose keys are all masked so far,
+    // in which case the scores are shifted by 0 instead, so that exp(-inf)
+    // yields 0 rather than exp(-inf - -inf) = NaN.
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * block_max,
+        MakeReduceHlo(scores,
+                      body->AddInstruction(HloInstruction::CreateConstant(
+                          LiteralUtil::MinValue(type))),
+                      {rank - 1}, HloOpcode::kMaximum));
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * new_max,
+        MakeBinaryHlo(HloOpcode::kMaximum, max, block_max));
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * is_empty,
+        MakeCompareHlo(
+            Comparison::Direction::kEq, new_max,
+            BroadcastScalar(body, LiteralUtil::MinValue(type), row_shape)));
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * shift,
+        MakeSelectHlo(is_empty,
+                      BroadcastScalar(body, LiteralUtil::Zero(type), row_shape),
+                      new_max));
+
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * shifted,
+        MakeBinaryHlo(
+            HloOpcode::kSubtract, scores,
+            MakeBroadcastHlo(shift, Iota(rank - 1), scores->shape())));
+    TF_ASSIGN_OR_RETURN(HloInstruction * probs,
+                        MakeUnaryHlo(HloOpcode::kExp, shifted));
+    TF_ASSIGN_OR_RETURN(HloInstruction * max_delta,
+                        MakeBinaryHlo(HloOpcode::kSubtract, max, shift));
+    TF_ASSIGN_OR_RETURN(HloInstruction * correction,
+                        MakeUnaryHlo(HloOpcode::kExp, max_delta));
+
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * block_sum,
+        MakeReduceHlo(probs,
+                      body->AddInstruction(HloInstruction::CreateConstant(
+                          LiteralUtil::Zero(type))),
+                      {rank - 1}, HloOpcode::kAdd));
+    TF_ASSIGN_OR_RETURN(HloInstruction * corrected_sum,
+                        MakeBinaryHlo(HloOpcode::kMultiply, sum, correction));
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * new_sum,
+        MakeBinaryHlo(HloOpcode::kAdd, corrected_sum, block_sum));
+
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * block_output,
+        MakeDotHlo(probs, v_block, output_dot->dot_dimension_numbers(),
+                   output_dot->precision_config(),
+                   /*preferred_element_type=*/type));
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * corrected_output,
+        MakeBinaryHlo(
+            HloOpcode::kMultiply, output,
+            MakeBroadcastHlo(correction, Iota(rank - 1), output->shape())));
+    TF_ASSIGN_OR_RETURN(
+        HloInstruction * new_output,
+        MakeBinaryHlo(HloOpcode::kAdd, corrected_output, block_output));
+
+    WhileUtil::LoopStateTy new_values = {q,       k,       v,
+                                         new_max, new_sum, new_output};
+    if (attention.mask != nullptr) new_values.push_back(values[6]);
+    return new_values;
+  };
+
+  TF_ASSIGN_OR_RETURN(
+      WhileUtil::LoopStateTy results,
+      WhileUtil::MakeCountedLoop(computation, num_keys / block_size,
+                                 init_values, loop_body,
+                                 output_dot->metadata()));
+  TF_ASSIGN_OR_RETURN(
+      HloInstruction * result,
+      MakeBinaryHlo(
+          HloOpcode::kDivide, results[5],
+          MakeBroadcastHlo(results[4], Iota(rank - 1), results[5]->shape())));
+  return computation->ReplaceInstruction(output_dot, result);
+}
+
+}  // namespace
+
+StatusOr<bool> BlockwiseAttentionRewriter::Run(
+    HloModule* module,
+    const absl::flat_hash_set<absl::string_view>& execution_threads) {
+  // Match all the attentions before rewriting any of them, as the rewrite
+  // removes the instructions of the matched pattern.
+  std::vector<Attention> attentions;
+  for (HloComputation* computation :
+       module->MakeNonfusionComputations(execution_threads)) {
+    for (HloInstruction* instr : computation->instructions()) {
+      std::optional<Attention> attention = MatchAttention(instr);
+      if (!attention.has_value()) continue;
+      int64_t num_keys = instr->operand(0)->shape().dimensions().back();
+      if (num_keys % block_size_ != 0 || num_keys < 2 * block_size_) {
+        VLOG(2) << "Not rewriting attention " << instr->name() << " with "
+                << num_keys << " keys into blocks of " << block_size_;
+        continue;
+      }
+      attentions.push_back(*attention);
+    }
+  }
+
+  for (const Attention& attention : attentions) {
+    VLOG(1) << "Rewriting attention " << attention.output_dot->name()
+            << " into blocks of " << block_size_ << " keys";
+    TF_RETURN_IF_ERROR(RewriteAttention(attention, block_size_));
+  }
+  return !attentions.empty();
+}
+
+}  // namespace xla
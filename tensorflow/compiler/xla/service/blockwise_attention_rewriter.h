@@ -0,0 +1,71 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_BLOCKWISE_ATTENTION_REWRITER_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_BLOCKWISE_ATTENTION_REWRITER_H_
+
+#include <cstdint>
+
+#include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
+#include "tensorflow/compiler/xla/service/hlo_pass_interface.h"
+
+namespace xla {
+
+// Rewrites the attention pattern
+//
+//   scores = dot(q, k) [* broadcast(scale)] [+ mask]
+//   probs  = exp(scores - max(scores)) / sum(exp(scores - max(scores)))
+//   out    = dot(probs, v)
+//
+// where the max and the sum reduce the last (key) dimension of the scores, into
+// a loop over the blocks of keys that computes the softmax online, as in flash
+// attention:
+//
+//   for each block j of keys:
+//     s   = dot(q, k_j) [* scale] [+ mask_j]
+//     m'  = maximum(m, max(s))
+//     p   = exp(s - m')
+//     l   = l * exp(m - m') + sum(p)
+//     o   = o * exp(m - m') + dot(p, v_j)
+//     m   = m'
+//   out = o / l
+//
+// so that only the scores of one block of keys are live at a time, instead of
+// the whole [queries, keys] matrix for each head.
+//
+// Only the attentions whose number of keys is a multiple of `block_size`, and
+// spans at least two blocks, are rewritten. The intermediate results of the
+// pattern must not have other users, so e.g. the attention of a training step
+// that keeps the probabilities for the backward pass is left alone.
+class BlockwiseAttentionRewriter : public HloModulePass {
+ public:
+  explicit BlockwiseAttentionRewriter(int64_t block_size)
+      : block_size_(block_size) {}
+  absl::string_view name() const override {
+    return "blockwise-attention-rewriter";
+  }
+
+  using HloPassInterface::Run;
+  StatusOr<bool> Run(
+      HloModule* module,
+      const absl::flat_hash_set<absl::string_view>& execution_threads) override;
+
+ private:
+  int64_t block_size_;
+};
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_BLOCKWISE_ATTENTION_REWRITER_H_
@@ -0,0 +1,177 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/blockwise_attention_rewriter.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_replace.h"
+#include "tensorflow/compiler/xla/hlo/evaluator/hlo_evaluator.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instruction.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_opcode.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/compiler/xla/tests/literal_test_util.h"
+#include "tensorflow/compiler/xla/tests/test_utils.h"
+#include "tensorflow/tsl/platform/statusor.h"
+
+namespace xla {
+namespace {
+
+class BlockwiseAttentionRewriterTest : public HloTestBase {
+ protected:
+  // Checks that the attention of 'hlo_string' is rewritten into a loop, and
+  // that the loop computes the same result.
+  void RewriteAndCompare(absl::string_view hlo_string, int64_t block_size) {
+    TF_ASSERT_OK_AND_ASSIGN(auto module,
+                            ParseAndReturnVerifiedModule(hlo_string));
+    std::unique_ptr<HloModule> original = module->Clone();
+    TF_ASSERT_OK_AND_ASSIGN(
+        bool changed, BlockwiseAttentionRewriter(block_size).Run(module.get()));
+    ASSERT_TRUE(changed);
+    EXPECT_TRUE(absl::c_any_of(
+        module->entry_computation()->instructions(),
+        [](const HloInstruction* instr) {
+          return instr->opcode() == HloOpcode::kWhile;
+        }));
+    EXPECT_FALSE(absl::c_any_of(
+        module->entry_computation()->instructions(),
+        [](const HloInstruction* instr) {
+          return instr->opcode() == HloOpcode::kDot;
+        }));
+
+    TF_ASSERT_OK_AND_ASSIGN(std::vector<Literal> args,
+                            MakeFakeArguments(original.get()));
+    HloEvaluator evaluator;
+    TF_ASSERT_OK_AND_ASSIGN(Literal expected,
+                            evaluator.Evaluate(*original, args));
+    TF_ASSERT_OK_AND_ASSIGN(Literal actual, evaluator.Evaluate(*module, args));
+    EXPECT_TRUE(LiteralTestUtil::Near(expected, actual, ErrorSpec{1e-4, 1e-4}));
+  }
+};
+
+constexpr absl::string_view kComputations = R"(
+max_computation {
+  a = f32[] parameter(0)
+  b = f32[] parameter(1)
+  ROOT maximum = f32[] maximum(a, b)
+}
+
+add_computation {
+  a = f32[] parameter(0)
+  b = f32[] parameter(1)
+  ROOT add = f32[] add(a, b)
+}
+)";
+
+// The softmax of $scores followed by the dot with v.
+constexpr absl::string_view kSoftmaxAndOutput = R"(
+  neg_inf = f32[] constant(-inf)
+  max = f32[2,4] reduce($scores, neg_inf), dimensions={2},
+    to_apply=max_computation
+  max_broadcast = f32[2,4,16] broadcast(max), dimensions={0,1}
+  shifted = f32[2,4,16] subtract($scores, max_broadcast)
+  exp = f32[2,4,16] exponential(shifted)
+  zero = f32[] constant(0)
+  sum = f32[2,4] reduce(exp, zero), dimensions={2}, to_apply=add_computation
+  sum_broadcast = f32[2,4,16] broadcast(sum), dimensions={0,1}
+  probs = f32[2,4,16] divide(exp, sum_broadcast)
+  out = f32[2,4,4] dot(probs, v), lhs_batch_dims={0},
+    lhs_contracting_dims={2}, rhs_batch_dims={0}, rhs_contracting_dims={1}
+)";
+
+// Returns an attention whose scores are the instruction 'scores' computed by
+// 'scores_hlo' from the dot of q and k, 'qk'.
+std::string MakeAttention(
+    absl::string_view scores_hlo, absl::string_view scores,
+    absl::string_view root = "ROOT root = f32[2,4,4] copy(out)") {
+  return absl::StrCat(kComputations, R"(
+ENTRY main {
+  q = f32[2,4,8] parameter(0)
+  k = f32[2,16,8] parameter(1)
+  v = f32[2,16,4] parameter(2)
+  mask = f32[2,4,16] parameter(3)
+  qk = f32[2,4,16] dot(q, k), lhs_batch_dims={0}, lhs_contracting_dims={2},
+    rhs_batch_dims={0}, rhs_contracting_dims={2}
+)",
+                      scores_hlo,
+                      absl::StrReplaceAll(kSoftmaxAndOutput,
+                                          {{"$scores", scores}}),
+                      "  ", root, "\n}\n");
+}
+
+TEST_F(BlockwiseAttentionRewriterTest, Attention) {
+  RewriteAndCompare(MakeAttention("", "qk"), /*block_size=*/4);
+}
+
+TEST_F(BlockwiseAttentionRewriterTest, ScaledAndMaskedAttention) {
+  RewriteAndCompare(MakeAttention(R"(
+  scale = f32[] constant(0.125)
+  scale_broadcast = f32[2,4,16] broadcast(scale), dimensions={}
+  scaled = f32[2,4,16] multiply(qk, scale_broadcast)
+  scores = f32[2,4,16] add(scaled, mask)
+)",
+                                  "scores"),
+                    /*block_size=*/8);
+}
+
+TEST_F(BlockwiseAttentionRewriterTest, FullyMaskedBlocks) {
+  // Query i only attends the keys from 4 * i on, so the first blocks of keys
+  // are entirely masked for the last queries.
+  RewriteAndCompare(MakeAttention(R"(
+  query_iota = s32[4,16] iota(), iota_dimension=0
+  four = s32[] constant(4)
+  four_broadcast = s32[4,16] broadcast(four), dimensions={}
+  first_key = s32[4,16] multiply(query_iota, four_broadcast)
+  key_iota = s32[4,16] iota(), iota_dimension=1
+  masked = pred[4,16] compare(key_iota, first_key), direction=LT
+  mask_neg_inf = f32[] constant(-inf)
+  mask_neg_infs = f32[4,16] broadcast(mask_neg_inf), dimensions={}
+  mask_zero = f32[] constant(0)
+  mask_zeros = f32[4,16] broadcast(mask_zero), dimensions={}
+  causal_mask = f32[4,16] select(masked, mask_neg_infs, mask_zeros)
+  causal_mask_broadcast = f32[2,4,16] broadcast(causal_mask),
+    dimensions={1,2}
+  scores = f32[2,4,16] add(qk, causal_mask_broadcast)
+)",
+                                  "scores"),
+                    /*block_size=*/4);
+}
+
+TEST_F(BlockwiseAttentionRewriterTest, ProbabilitiesWithOtherUsers) {
+  // The probabilities are kept, e.g. for the backward pass.
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto module,
+      ParseAndReturnVerifiedModule(MakeAttention(
+          "", "qk",
+          "ROOT root = (f32[2,4,4], f32[2,4,16]) tuple(out, probs)")));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          BlockwiseAttentionRewriter(4).Run(module.get()));
+  EXPECT_FALSE(changed);
+}
+
+TEST_F(BlockwiseAttentionRewriterTest, KeysNotMultipleOfBlockSize) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto module, ParseAndReturnVerifiedModule(MakeAttention("", "qk")));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          BlockwiseAttentionRewriter(6).Run(module.get()));
+  EXPECT_FALSE(changed);
+}
+
+}  // namespace
+}  // namespace xla
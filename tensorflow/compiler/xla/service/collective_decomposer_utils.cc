@@ -29,19 +29,16 @@ limitations under the License.
 
 namespace xla {
 
-// Create the start indices for decompositing the given collective.
-StatusOr<std::vector<HloInstruction *>>
-CreateStartIndicesForCollectiveDecomposition(
+// Create the index of the executing instance in its group of participants.
+StatusOr<HloInstruction *> CreateParticipantIndexForCollectiveDecomposition(
     CollectiveOpGroupMode group_mode,
-    absl::Span<const ReplicaGroup> replica_groups, const Shape &shard_shape,
-    int64_t shard_dimension, HloComputation *computation,
+    absl::Span<const ReplicaGroup> replica_groups, HloComputation *computation,
     std::function<void(Shape &)> update_layout) {
   HloInstruction *zero = computation->AddInstruction(
       HloInstruction::CreateConstant(LiteralUtil::Zero(U32)));
   if (update_layout) {
     update_layout(*zero->mutable_shape());
   }
-  std::vector<HloInstruction *> start_indices(shard_shape.rank(), zero);
   const Shape &scalar_shape = zero->shape();
 
   auto create_flattened_id = [&](HloInstruction *replica_index) {
@@ -154,6 +151,27 @@ CreateStartIndicesForCollectiveDecomposition(
   if (group_mode == CollectiveOpGroupMode::kCrossReplicaAndPartition) {
     index = create_flattened_id(index);
   }
+  return index;
+}
+
+// Create the start indices for decompositing the given collective.
+StatusOr<std::vector<HloInstruction *>>
+CreateStartIndicesForCollectiveDecomposition(
+    CollectiveOpGroupMode group_mode,
+    absl::Span<const ReplicaGroup> replica_groups, const Shape &shard_shape,
+    int64_t shard_dimension, HloComputation *computation,
+    std::function<void(Shape &)> update_layout) {
+  TF_ASSIGN_OR_RETURN(HloInstruction * index,
+                      CreateParticipantIndexForCollectiveDecomposition(
+                          group_mode, replica_groups, computation,
+                          update_layout));
+  const Shape &scalar_shape = index->shape();
+  HloInstruction *zero = computation->AddInstruction(
+      HloInstruction::CreateConstant(LiteralUtil::Zero(U32)));
+  if (update_layout) {
+    update_layout(*zero->mutable_shape());
+  }
+  std::vector<HloInstruction *> start_indices(shard_shape.rank(), zero);
 
   // scale index by the shard size, which is the size of the shard_dimension.
   HloInstruction *scale = computation->AddInstruction(
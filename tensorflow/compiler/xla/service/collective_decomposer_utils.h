@@ -23,6 +23,14 @@ limitations under the License.
 
 namespace xla {
 
+// Creates a U32 scalar holding the index of the executing instance in its
+// group of participants of a collective with the given group mode and replica
+// groups.
+StatusOr<HloInstruction *> CreateParticipantIndexForCollectiveDecomposition(
+    CollectiveOpGroupMode group_mode,
+    absl::Span<const ReplicaGroup> replica_groups, HloComputation *computation,
+    std::function<void(Shape &)> update_layout = nullptr);
+
 StatusOr<std::vector<HloInstruction *>>
 CreateStartIndicesForCollectiveDecomposition(
     CollectiveOpGroupMode group_mode,
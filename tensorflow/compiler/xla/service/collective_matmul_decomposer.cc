@@ -0,0 +1,408 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/collective_matmul_decomposer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_casting_utils.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_computation.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instruction.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_opcode.h"
+#include "tensorflow/compiler/xla/literal_util.h"
+#include "tensorflow/compiler/xla/service/collective_decomposer_utils.h"
+#include "tensorflow/compiler/xla/service/collective_ops_utils.h"
+#include "tensorflow/compiler/xla/service/hlo_module_config.h"
+#include "tensorflow/compiler/xla/service/hlo_query.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/status_macros.h"
+
+namespace xla {
+
+namespace {
+
+// The participants of a collective, which the decomposition passes the shards
+// around.
+struct Ring {
+  CollectiveOpGroupMode group_mode;
+  std::vector<ReplicaGroup> groups;
+  int64_t size;
+};
+
+// Returns the ring of the participants of 'collective' if they can exchange
+// shards with collective-permutes, i.e. if they are all replicas or all
+// partitions.
+std::optional<Ring> GetRing(const HloCollectiveInstruction* collective,
+                            bool use_global_device_ids) {
+  if (collective->constrain_layout() || collective->operand_count() != 1 ||
+      !collective->shape().IsArray() ||
+      collective->HasControlDependencies()) {
+    return std::nullopt;
+  }
+  StatusOr<CollectiveOpGroupMode> group_mode = GetCollectiveOpGroupMode(
+      collective->channel_id().has_value(), use_global_device_ids);
+  if (!group_mode.ok()) return std::nullopt;
+
+  const HloModuleConfig& config = collective->GetModule()->config();
+  int64_t num_participants;
+  switch (*group_mode) {
+    case CollectiveOpGroupMode::kCrossReplica:
+      num_participants = config.replica_count();
+      break;
+    case CollectiveOpGroupMode::kCrossPartition:
+      num_participants = config.num_partitions();
+      break;
+    case CollectiveOpGroupMode::kFlattenedID:
+      // The flattened ids are the partition ids without replication.
+      if (config.replica_count() != 1) return std::nullopt;
+      num_participants = config.num_partitions();
+      break;
+    case CollectiveOpGroupMode::kCrossReplicaAndPartition:
+      return std::nullopt;
+  }
+
+  Ring ring{*group_mode,
+            {collective->replica_groups().begin(),
+             collective->replica_groups().end()},
+            0};
+  if (ring.groups.empty()) {
+    ring.groups.emplace_back();
+    for (int64_t id = 0; id < num_participants; ++id) {
+      ring.groups.back().add_replica_ids(id);
+    }
+  }
+  ring.size = ring.groups.front().replica_ids_size();
+  return ring;
+}
+
+// Returns the pairs of the collective-permutes which pass the shards from
+// each participant to the previous one in its group.
+std::vector<std::pair<int64_t, int64_t>> SourceTargetPairs(const Ring& ring) {
+  std::vector<std::pair<int64_t, int64_t>> pairs;
+  for (const ReplicaGroup& group : ring.groups) {
+    for (int64_t i = 0; i < group.replica_ids_size(); ++i) {
+      pairs.emplace_back(
+          group.replica_ids((i + 1) % group.replica_ids_size()),
+          group.replica_ids(i));
+    }
+  }
+  return pairs;
+}
+
+// Returns the dimensions of 'operand_rank' which are neither batch nor
+// contracting dimensions, in the order of the dot result.
+std::vector<int64_t> NonContractingDimensions(
+    int64_t operand_rank, absl::Span<const int64_t> batch_dimensions,
+    absl::Span<const int64_t> contracting_dimensions) {
+  std::vector<int64_t> dimensions;
+  for (int64_t i = 0; i < operand_rank; ++i) {
+    if (!absl::c_linear_search(batch_dimensions, i) &&
+        !absl::c_linear_search(contracting_dimensions, i)) {
+      dimensions.push_back(i);
+    }
+  }
+  return dimensions;
+}
+
+// Maps between the non-contracting dimensions of the operands of a dot and
+// the dimensions of its result.
+struct DotDimensionMapping {
+  explicit DotDimensionMapping(const HloInstruction* dot) {
+    const DotDimensionNumbers& dnums = dot->dot_dimension_numbers();
+    num_batch_dimensions = dnums.lhs_batch_dimensions_size();
+    lhs = NonContractingDimensions(dot->operand(0)->shape().rank(),
+                                   dnums.lhs_batch_dimensions(),
+                                   dnums.lhs_contracting_dimensions());
+    rhs = NonContractingDimensions(dot->operand(1)->shape().rank(),
+                                   dnums.rhs_batch_dimensions(),
+                                   dnums.rhs_contracting_dimensions());
+  }
+
+  // Returns the result dimension of the dimension 'dimension' of the operand
+  // 'operand_index', if it is a non-contracting dimension.
+  std::optional<int64_t> ResultDimension(int64_t operand_index,
+                                         int64_t dimension) const {
+    const std::vector<int64_t>& dimensions = operand_index == 0 ? lhs : rhs;
+    auto it = absl::c_find(dimensions, dimension);
+    if (it == dimensions.end()) return std::nullopt;
+    const int64_t offset = operand_index == 0 ? 0 : lhs.size();
+    return num_batch_dimensions + offset + (it - dimensions.begin());
+  }
+
+  // Returns the operand index and the operand dimension of the result
+  // dimension 'dimension', if it is a non-contracting dimension.
+  std::optional<std::pair<int64_t, int64_t>> OperandDimension(
+      int64_t dimension) const {
+    dimension -= num_batch_dimensions;
+    if (dimension < 0) return std::nullopt;
+    const int64_t num_lhs_dimensions = lhs.size();
+    if (dimension < num_lhs_dimensions) {
+      return std::make_pair(int64_t{0}, lhs[dimension]);
+    }
+    return std::make_pair(int64_t{1}, rhs[dimension - num_lhs_dimensions]);
+  }
+
+  int64_t num_batch_dimensions;
+  std::vector<int64_t> lhs;
+  std::vector<int64_t> rhs;
+};
+
+int64_t DotFlops(const HloInstruction* dot) {
+  int64_t contracting_size = 1;
+  for (int64_t dimension :
+       dot->dot_dimension_numbers().lhs_contracting_dimensions()) {
+    contracting_size *= dot->operand(0)->shape().dimensions(dimension);
+  }
+  return 2 * ShapeUtil::ElementsIn(dot->shape()) * contracting_size;
+}
+
+// Builds the instructions of a decomposition in the computation of a
+// collective.
+class RingBuilder {
+ public:
+  RingBuilder(HloComputation* computation, const Ring& ring,
+              HloInstruction* participant_index, int64_t* next_channel_id)
+      : computation_(computation),
+        ring_(ring),
+        participant_index_(participant_index),
+        next_channel_id_(next_channel_id) {}
+
+  // Returns the start indices of the 'chunk_offset'th chunk after the one of
+  // the participant, of size 'chunk_size' along 'dimension'.
+  std::vector<HloInstruction*> StartIndices(int64_t rank, int64_t dimension,
+                                            int64_t chunk_size,
+                                            int64_t chunk_offset) {
+    const Shape& scalar_shape = participant_index_->shape();
+    auto constant = [&](uint32_t value) {
+      return computation_->AddInstruction(
+          HloInstruction::CreateConstant(LiteralUtil::CreateR0(value)));
+    };
+    HloInstruction* chunk = participant_index_;
+    if (chunk_offset % ring_.size != 0) {
+      chunk = computation_->AddInstruction(HloInstruction::CreateBinary(
+          scalar_shape, HloOpcode::kAdd, chunk,
+          constant(chunk_offset % ring_.size)));
+      chunk = computation_->AddInstruction(HloInstruction::CreateBinary(
+          scalar_shape, HloOpcode::kRemainder, chunk, constant(ring_.size)));
+    }
+    std::vector<HloInstruction*> start_indices(rank, constant(0));
+    start_indices[dimension] =
+        computation_->AddInstruction(HloInstruction::CreateBinary(
+            scalar_shape, HloOpcode::kMultiply, chunk, constant(chunk_size)));
+    return start_indices;
+  }
+
+  // Passes 'operand' to the previous participant of the ring.
+  HloInstruction* PermuteToPrevious(HloInstruction* operand) {
+    std::optional<int64_t> channel_id;
+    if (ring_.group_mode != CollectiveOpGroupMode::kCrossReplica) {
+      channel_id = (*next_channel_id_)++;
+    }
+    return computation_->AddInstruction(
+        HloInstruction::CreateCollectivePermute(
+            operand->shape(), operand, SourceTargetPairs(ring_), channel_id));
+  }
+
+  HloInstruction* PartialDot(const HloInstruction* dot, const Shape& shape,
+                             HloInstruction* lhs, HloInstruction* rhs) {
+    HloInstruction* partial_dot =
+        computation_->AddInstruction(HloInstruction::CreateDot(
+            shape, lhs, rhs, dot->dot_dimension_numbers(),
+            dot->precision_config()));
+    partial_dot->set_metadata(dot->metadata());
+    return partial_dot;
+  }
+
+ private:
+  HloComputation* computation_;
+  const Ring& ring_;
+  HloInstruction* participant_index_;
+  int64_t* next_channel_id_;
+};
+
+}  // namespace
+
+bool CollectiveMatmulDecomposer::IsProfitable(int64_t num_steps,
+                                              int64_t shard_bytes,
+                                              int64_t flops) const {
+  const absl::Duration dot_time =
+      absl::Seconds(flops / options_.flops_per_second);
+  const absl::Duration permute_time =
+      absl::Seconds(shard_bytes / options_.bytes_per_second);
+  // The collective moves 'num_steps - 1' shards through each participant.
+  const absl::Duration sequential_time =
+      dot_time + (num_steps - 1) * permute_time;
+  // Each step but the first one overlaps a partial dot with a permute.
+  const absl::Duration step_dot_time = dot_time / num_steps;
+  const absl::Duration decomposed_time =
+      step_dot_time + (num_steps - 1) * std::max(step_dot_time, permute_time) +
+      num_steps * options_.step_overhead;
+  VLOG(2) << "Sequential time: " << sequential_time
+          << ", decomposed time: " << decomposed_time;
+  return decomposed_time < sequential_time;
+}
+
+StatusOr<bool> CollectiveMatmulDecomposer::Run(
+    HloModule* module,
+    const absl::flat_hash_set<absl::string_view>& execution_threads) {
+  bool changed = false;
+  int64_t next_channel_id = hlo_query::NextChannelId(*module);
+
+  for (HloComputation* computation :
+       module->MakeNonfusionComputations(execution_threads)) {
+    for (HloInstruction* instruction :
+         computation->MakeInstructionPostOrder()) {
+      // dot(all-gather(x), y).
+      if (instruction->opcode() == HloOpcode::kDot &&
+          !instruction->HasControlDependencies()) {
+        HloInstruction* dot = instruction;
+        const DotDimensionMapping mapping(dot);
+        for (int64_t operand_index = 0; operand_index < 2; ++operand_index) {
+          auto* ag = DynCast<HloAllGatherInstruction>(
+              dot->mutable_operand(operand_index));
+          if (ag == nullptr || ag->user_count() != 1 ||
+              dot->operand(0) == dot->operand(1)) {
+            continue;
+          }
+          std::optional<Ring> ring = GetRing(ag, ag->use_global_device_ids());
+          std::optional<int64_t> result_dimension = mapping.ResultDimension(
+              operand_index, ag->all_gather_dimension());
+          if (!ring || !result_dimension || ring->size < 2 ||
+              ring->size > options_.max_steps ||
+              !IsProfitable(ring->size,
+                            ShapeUtil::ByteSizeOf(ag->operand(0)->shape()),
+                            DotFlops(dot))) {
+            continue;
+          }
+          VLOG(1) << "Decomposing " << ag->name() << " and " << dot->name()
+                  << " into " << ring->size << " steps";
+
+          TF_ASSIGN_OR_RETURN(HloInstruction * participant_index,
+                              CreateParticipantIndexForCollectiveDecomposition(
+                                  ring->group_mode, ring->groups, computation));
+          RingBuilder builder(computation, *ring, participant_index,
+                              &next_channel_id);
+          HloInstruction* other = dot->mutable_operand(1 - operand_index);
+          const int64_t shard_size =
+              ag->operand(0)->shape().dimensions(ag->all_gather_dimension());
+          Shape partial_shape = dot->shape();
+          partial_shape.set_dimensions(*result_dimension, shard_size);
+
+          // At step k, the participant holds the shard of the k-th participant
+          // after it and computes the corresponding slice of the result.
+          HloInstruction* shard = ag->mutable_operand(0);
+          HloInstruction* result =
+              computation->AddInstruction(HloInstruction::CreateBroadcast(
+                  dot->shape(),
+                  computation->AddInstruction(HloInstruction::CreateConstant(
+                      LiteralUtil::Zero(dot->shape().element_type()))),
+                  {}));
+          for (int64_t step = 0; step < ring->size; ++step) {
+            HloInstruction* next_shard =
+                step + 1 < ring->size ? builder.PermuteToPrevious(shard)
+                                      : nullptr;
+            HloInstruction* partial_dot =
+                operand_index == 0
+                    ? builder.PartialDot(dot, partial_shape, shard, other)
+                    : builder.PartialDot(dot, partial_shape, other, shard);
+            result = computation->AddInstruction(
+                HloInstruction::CreateDynamicUpdateSlice(
+                    dot->shape(), result, partial_dot,
+                    builder.StartIndices(dot->shape().rank(),
+                                         *result_dimension, shard_size,
+                                         step)));
+            shard = next_shard;
+          }
+          TF_RETURN_IF_ERROR(dot->ReplaceAllUsesWith(result));
+          TF_RETURN_IF_ERROR(computation->RemoveInstruction(dot));
+          TF_RETURN_IF_ERROR(computation->RemoveInstruction(ag));
+          changed = true;
+          break;
+        }
+        continue;
+      }
+
+      // reduce-scatter(dot(x, y)).
+      auto* rs = DynCast<HloReduceScatterInstruction>(instruction);
+      if (rs == nullptr || rs->operand(0)->opcode() != HloOpcode::kDot ||
+          rs->operand(0)->user_count() != 1 ||
+          rs->operand(0)->HasControlDependencies() ||
+          MatchReductionComputation(rs->to_apply()) != ReductionKind::SUM) {
+        continue;
+      }
+      HloInstruction* dot = rs->mutable_operand(0);
+      std::optional<Ring> ring = GetRing(rs, rs->use_global_device_ids());
+      std::optional<std::pair<int64_t, int64_t>> operand_dimension =
+          DotDimensionMapping(dot).OperandDimension(rs->scatter_dimension());
+      if (!ring || !operand_dimension || ring->size < 2 ||
+          ring->size > options_.max_steps ||
+          dot->operand(0) == dot->operand(1) ||
+          !IsProfitable(ring->size, ShapeUtil::ByteSizeOf(rs->shape()),
+                        DotFlops(dot))) {
+        continue;
+      }
+      VLOG(1) << "Decomposing " << dot->name() << " and " << rs->name()
+              << " into " << ring->size << " steps";
+
+      TF_ASSIGN_OR_RETURN(HloInstruction * participant_index,
+                          CreateParticipantIndexForCollectiveDecomposition(
+                              ring->group_mode, ring->groups, computation));
+      RingBuilder builder(computation, *ring, participant_index,
+                          &next_channel_id);
+      const auto [operand_index, dimension] = *operand_dimension;
+      HloInstruction* operand = dot->mutable_operand(operand_index);
+      HloInstruction* other = dot->mutable_operand(1 - operand_index);
+      const int64_t chunk_size =
+          rs->shape().dimensions(rs->scatter_dimension());
+      Shape chunk_shape = operand->shape();
+      chunk_shape.set_dimensions(dimension, chunk_size);
+
+      // At step k, the participant adds its contribution to the chunk of the
+      // (k+1)-th participant after it to the partial sum received from the
+      // next participant, so that the last step completes its own chunk.
+      HloInstruction* sum = nullptr;
+      for (int64_t step = 0; step < ring->size; ++step) {
+        HloInstruction* chunk =
+            computation->AddInstruction(HloInstruction::CreateDynamicSlice(
+                chunk_shape, operand,
+                builder.StartIndices(operand->shape().rank(), dimension,
+                                     chunk_size, step + 1),
+                chunk_shape.dimensions()));
+        HloInstruction* partial_dot =
+            operand_index == 0
+                ? builder.PartialDot(dot, rs->shape(), chunk, other)
+                : builder.PartialDot(dot, rs->shape(), other, chunk);
+        sum = sum == nullptr
+                  ? partial_dot
+                  : computation->AddInstruction(HloInstruction::CreateBinary(
+                        rs->shape(), HloOpcode::kAdd,
+                        builder.PermuteToPrevious(sum), partial_dot));
+      }
+      TF_RETURN_IF_ERROR(rs->ReplaceAllUsesWith(sum));
+      TF_RETURN_IF_ERROR(computation->RemoveInstruction(rs));
+      TF_RETURN_IF_ERROR(computation->RemoveInstruction(dot));
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+}  // namespace xla
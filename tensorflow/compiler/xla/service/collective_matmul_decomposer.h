@@ -0,0 +1,80 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_COLLECTIVE_MATMUL_DECOMPOSER_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_COLLECTIVE_MATMUL_DECOMPOSER_H_
+
+#include <cstdint>
+
+#include "absl/time/time.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instructions.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
+#include "tensorflow/compiler/xla/service/hlo_pass_interface.h"
+
+namespace xla {
+
+// Decomposes an all-gather feeding a dot, and a dot feeding a reduce-scatter,
+// into a ring of collective-permutes overlapped with partial dots (a.k.a.
+// windowed einsum), so that the scheduler can hide the communication behind
+// the computation:
+//
+//  - dot(all-gather(x), y), where x is gathered along a non-contracting
+//    dimension, computes the slice of the result for the shard it holds while
+//    the next shard is passed along the ring.
+//  - reduce-scatter(dot(x, y)), where the result is scattered along a
+//    non-contracting dimension, computes the partial result of one shard at
+//    each step and adds it to the partial sum passed along the ring.
+//
+// The decomposition costs one collective-permute and one dot per participant,
+// so it is only applied when the cost model estimates that it is faster than
+// the exposed collective.
+class CollectiveMatmulDecomposer : public HloModulePass {
+ public:
+  struct Options {
+    // Rate of the dots, in FLOP/s.
+    double flops_per_second;
+    // Bandwidth of a collective-permute between two participants, in bytes/s.
+    double bytes_per_second;
+    // Fixed cost of each step of the decomposition, e.g. the launch and the
+    // synchronization of the collective-permute and of the partial dot.
+    absl::Duration step_overhead = absl::Microseconds(10);
+    // Collectives with more participants aren't decomposed.
+    int64_t max_steps = 16;
+  };
+
+  explicit CollectiveMatmulDecomposer(const Options& options)
+      : options_(options) {}
+  absl::string_view name() const override {
+    return "collective-matmul-decomposer";
+  }
+
+  using HloPassInterface::Run;
+  StatusOr<bool> Run(
+      HloModule* module,
+      const absl::flat_hash_set<absl::string_view>& execution_threads) override;
+
+ private:
+  // Returns whether decomposing the collective with 'num_steps' participants,
+  // which moves 'shard_bytes' per participant, and the dot costing 'flops' is
+  // estimated to be faster than running them one after the other.
+  bool IsProfitable(int64_t num_steps, int64_t shard_bytes,
+                    int64_t flops) const;
+
+  Options options_;
+};
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_COLLECTIVE_MATMUL_DECOMPOSER_H_
@@ -0,0 +1,242 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/collective_matmul_decomposer.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instructions.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_opcode.h"
+#include "tensorflow/compiler/xla/service/hlo_matchers.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/tsl/platform/statusor.h"
+
+namespace xla {
+namespace {
+
+namespace op = xla::testing::opcode_matchers;
+
+using Pair = std::pair<int64_t, int64_t>;
+
+class CollectiveMatmulDecomposerTest : public HloTestBase {
+ protected:
+  // A slow network and a fast device make the decomposition profitable.
+  static CollectiveMatmulDecomposer::Options FastDotOptions() {
+    CollectiveMatmulDecomposer::Options options;
+    options.flops_per_second = 1e9;
+    options.bytes_per_second = 1e6;
+    options.step_overhead = absl::ZeroDuration();
+    return options;
+  }
+
+  StatusOr<bool> RunPass(HloModule* module,
+                         const CollectiveMatmulDecomposer::Options& options =
+                             FastDotOptions()) {
+    return CollectiveMatmulDecomposer(options).Run(module);
+  }
+
+  static int64_t CountOpcode(const HloModule& module, HloOpcode opcode) {
+    return absl::c_count_if(
+        module.entry_computation()->instructions(),
+        [&](const HloInstruction* instr) { return instr->opcode() == opcode; });
+  }
+};
+
+TEST_F(CollectiveMatmulDecomposerTest, AllGatherLhs) {
+  absl::string_view hlo_string = R"(
+HloModule module
+
+ENTRY entry {
+  x = f32[8,64] parameter(0)
+  y = f32[64,32] parameter(1)
+  ag = f32[32,64] all-gather(x), channel_id=1, replica_groups={{0,1,2,3}},
+    dimensions={0}, use_global_device_ids=true
+  ROOT dot = f32[32,32] dot(ag, y), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(hlo_string, 1, 4));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunPass(module.get()));
+  EXPECT_TRUE(changed);
+
+  EXPECT_EQ(CountOpcode(*module, HloOpcode::kAllGather), 0);
+  EXPECT_EQ(CountOpcode(*module, HloOpcode::kCollectivePermute), 3);
+  EXPECT_EQ(CountOpcode(*module, HloOpcode::kDot), 4);
+  const HloInstruction* root = module->entry_computation()->root_instruction();
+  EXPECT_THAT(root, op::DynamicUpdateSlice(op::DynamicUpdateSlice(),
+                                           op::Dot(op::CollectivePermute(),
+                                                   op::Parameter(1)),
+                                           op::Multiply(), op::Constant()));
+  EXPECT_EQ(root->operand(1)->shape().dimensions(0), 8);
+  // The shards are passed to the previous partition of the ring.
+  auto* permute = Cast<HloCollectivePermuteInstruction>(
+      root->operand(1)->operand(0));
+  EXPECT_TRUE(permute->channel_id().has_value());
+  EXPECT_THAT(permute->source_target_pairs(),
+              ::testing::ElementsAre(Pair(1, 0), Pair(2, 1), Pair(3, 2),
+                                     Pair(0, 3)));
+}
+
+TEST_F(CollectiveMatmulDecomposerTest, AllGatherRhs) {
+  absl::string_view hlo_string = R"(
+HloModule module
+
+ENTRY entry {
+  x = f32[16,64] parameter(0)
+  y = f32[64,8] parameter(1)
+  ag = f32[64,16] all-gather(y), channel_id=1, replica_groups={{0,1},{2,3}},
+    dimensions={1}, use_global_device_ids=true
+  ROOT dot = f32[16,16] dot(x, ag), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(hlo_string, 1, 4));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunPass(module.get()));
+  EXPECT_TRUE(changed);
+
+  EXPECT_EQ(CountOpcode(*module, HloOpcode::kAllGather), 0);
+  EXPECT_EQ(CountOpcode(*module, HloOpcode::kCollectivePermute), 1);
+  EXPECT_EQ(CountOpcode(*module, HloOpcode::kDot), 2);
+  const HloInstruction* root = module->entry_computation()->root_instruction();
+  EXPECT_THAT(root, op::DynamicUpdateSlice(
+                        op::DynamicUpdateSlice(),
+                        op::Dot(op::Parameter(0), op::CollectivePermute()),
+                        op::Constant(), op::Multiply()));
+  auto* permute = Cast<HloCollectivePermuteInstruction>(
+      root->operand(1)->operand(1));
+  EXPECT_THAT(permute->source_target_pairs(),
+              ::testing::ElementsAre(Pair(1, 0), Pair(0, 1), Pair(3, 2),
+                                     Pair(2, 3)));
+}
+
+TEST_F(CollectiveMatmulDecomposerTest, ReduceScatter) {
+  absl::string_view hlo_string = R"(
+HloModule module
+
+add {
+  a = f32[] parameter(0)
+  b = f32[] parameter(1)
+  ROOT add = f32[] add(a, b)
+}
+
+ENTRY entry {
+  x = f32[32,16] parameter(0)
+  y = f32[16,32] parameter(1)
+  dot = f32[32,32] dot(x, y), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+  ROOT rs = f32[8,32] reduce-scatter(dot), channel_id=1,
+    replica_groups={{0,1,2,3}}, dimensions={0}, use_global_device_ids=true,
+    to_apply=add
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(hlo_string, 1, 4));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunPass(module.get()));
+  EXPECT_TRUE(changed);
+
+  EXPECT_EQ(CountOpcode(*module, HloOpcode::kReduceScatter), 0);
+  EXPECT_EQ(CountOpcode(*module, HloOpcode::kCollectivePermute), 3);
+  EXPECT_EQ(CountOpcode(*module, HloOpcode::kDot), 4);
+  // The last step adds the contribution of the partition to its own chunk.
+  const HloInstruction* root = module->entry_computation()->root_instruction();
+  EXPECT_THAT(root,
+              op::Add(op::CollectivePermute(op::Add()),
+                      op::Dot(op::DynamicSlice(
+                                  op::Parameter(0),
+                                  op::Multiply(op::Add(op::Multiply(),
+                                                       op::PartitionId()),
+                                               op::Constant()),
+                                  op::Constant()),
+                              op::Parameter(1))));
+  EXPECT_EQ(root->shape().dimensions(0), 8);
+}
+
+TEST_F(CollectiveMatmulDecomposerTest, CrossReplicaAllGather) {
+  absl::string_view hlo_string = R"(
+HloModule module
+
+ENTRY entry {
+  x = f32[8,64] parameter(0)
+  y = f32[64,32] parameter(1)
+  ag = f32[16,64] all-gather(x), replica_groups={}, dimensions={0}
+  ROOT dot = f32[16,32] dot(ag, y), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(hlo_string, 2, 1));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunPass(module.get()));
+  EXPECT_TRUE(changed);
+  std::vector<HloInstruction*> permutes;
+  for (HloInstruction* instr : module->entry_computation()->instructions()) {
+    if (instr->opcode() == HloOpcode::kCollectivePermute) {
+      permutes.push_back(instr);
+    }
+  }
+  ASSERT_EQ(permutes.size(), 1);
+  EXPECT_FALSE(permutes[0]->channel_id().has_value());
+}
+
+TEST_F(CollectiveMatmulDecomposerTest, ContractingDimensionNotDecomposed) {
+  absl::string_view hlo_string = R"(
+HloModule module
+
+ENTRY entry {
+  x = f32[32,16] parameter(0)
+  y = f32[64,32] parameter(1)
+  ag = f32[32,64] all-gather(x), channel_id=1, replica_groups={{0,1,2,3}},
+    dimensions={1}, use_global_device_ids=true
+  ROOT dot = f32[32,32] dot(ag, y), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(hlo_string, 1, 4));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunPass(module.get()));
+  EXPECT_FALSE(changed);
+}
+
+TEST_F(CollectiveMatmulDecomposerTest, UnprofitableNotDecomposed) {
+  absl::string_view hlo_string = R"(
+HloModule module
+
+ENTRY entry {
+  x = f32[8,64] parameter(0)
+  y = f32[64,32] parameter(1)
+  ag = f32[32,64] all-gather(x), channel_id=1, replica_groups={{0,1,2,3}},
+    dimensions={0}, use_global_device_ids=true
+  ROOT dot = f32[32,32] dot(ag, y), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(hlo_string, 1, 4));
+  // The overhead of the steps outweighs the tiny collective.
+  CollectiveMatmulDecomposer::Options options;
+  options.flops_per_second = 1e12;
+  options.bytes_per_second = 1e11;
+  options.step_overhead = absl::Microseconds(10);
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunPass(module.get(), options));
+  EXPECT_FALSE(changed);
+}
+
+}  // namespace
+}  // namespace xla
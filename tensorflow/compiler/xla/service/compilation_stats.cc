@@ -15,16 +15,81 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/service/compilation_stats.h"
 
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
 #include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/tsl/lib/monitoring/sampler.h"
 #include "tensorflow/tsl/platform/env.h"
 
 namespace xla {
+namespace {
+
+auto* hlo_pass_duration_usecs = tsl::monitoring::Sampler<1>::New(
+    {"/xla/service/hlo_pass_duration_usecs",
+     "The wall-clock time spent running each HLO pass in microseconds.",
+     "pass"},
+    // Minimum: 10 us, maximum: 10 us * 2 ^ 29 == ~1.5 hours.
+    {tsl::monitoring::Buckets::Exponential(10, 2, 30)});
+
+auto* hlo_pass_peak_rss_delta_bytes = tsl::monitoring::Sampler<1>::New(
+    {"/xla/service/hlo_pass_peak_rss_delta_bytes",
+     "How much each HLO pass raised the peak RSS of the process in bytes.",
+     "pass"},
+    // Minimum: 1 KiB, maximum: 1 KiB * 2 ^ 24 == 16 GiB.
+    {tsl::monitoring::Buckets::Exponential(1024, 2, 25)});
+
+auto* hlo_pass_instruction_count = tsl::monitoring::Sampler<1>::New(
+    {"/xla/service/hlo_pass_instruction_count",
+     "The number of HLO instructions after each HLO pass.", "pass"},
+    // Minimum: 1, maximum: 2 ^ 24.
+    {tsl::monitoring::Buckets::Exponential(1, 2, 25)});
+
+// Returns the peak resident set size of the process in bytes, or 0 if it isn't
+// known.
+int64_t PeakRssBytes() {
+#if defined(__linux__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+  return usage.ru_maxrss;
+#else
+  // Linux reports it in KiB.
+  return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+// Escapes the characters which can't appear as is in a JSON string.
+std::string JsonEscape(absl::string_view str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      absl::StrAppend(&escaped, "\\", std::string(1, c));
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      absl::StrAppendFormat(&escaped, "\\u%04x", static_cast<int>(c));
+    } else {
+      escaped.push_back(c);
+    }
+  }
+  return escaped;
+}
+
+}  // namespace
 
 class NoopStats : public CompilationStats {
  public:
@@ -36,6 +101,8 @@ class NoopStats : public CompilationStats {
 
   void CompilationReport() override {}
 
+  std::string CompilationReportJson() override { return "[]"; }
+
   int GetPassesSize() override { return 0; }
 
   void RecordPassError(absl::string_view pass_name,
@@ -50,8 +117,15 @@ class Stats : public CompilationStats {
 
   void EndPass(absl::string_view pass_name) override;
 
+  void StartPass(absl::string_view pass_name,
+                 int64_t instruction_count) override;
+
+  void EndPass(absl::string_view pass_name, int64_t instruction_count) override;
+
   void CompilationReport() override;
 
+  std::string CompilationReportJson() override;
+
   int GetPassesSize() override;
 
   void RecordPassError(absl::string_view pass_name,
@@ -65,6 +139,10 @@ class Stats : public CompilationStats {
     std::string name;
     int num_runs = 1;
     double duration_ms;
+    int64_t peak_rss_delta_bytes = 0;
+    // -1 if unknown.
+    int64_t instructions_before = -1;
+    int64_t instructions_after = -1;
   };
 
   // Info about the passes that have been run so far.
@@ -74,6 +152,9 @@ class Stats : public CompilationStats {
   std::string current_pass_;
   // The start time of the currently running pass.
   uint64_t start_micros_;
+  // The peak RSS and the instruction count when the current pass started.
+  int64_t start_peak_rss_bytes_;
+  int64_t start_instruction_count_;
 };
 
 /* static */
@@ -87,20 +168,42 @@ std::unique_ptr<CompilationStats> CompilationStats::MakeStats() {
 }
 
 void Stats::StartPass(absl::string_view pass_name) {
+  StartPass(pass_name, /*instruction_count=*/-1);
+}
+
+void Stats::EndPass(absl::string_view pass_name) {
+  EndPass(pass_name, /*instruction_count=*/-1);
+}
+
+void Stats::StartPass(absl::string_view pass_name, int64_t instruction_count) {
   CHECK(!pass_running_) << "Can't start " << pass_name << " while running "
                         << current_pass_;
   pass_running_ = true;
   current_pass_ = std::string(pass_name);
+  start_instruction_count_ = instruction_count;
+  start_peak_rss_bytes_ = PeakRssBytes();
   start_micros_ = tsl::Env::Default()->NowMicros();
 }
 
-void Stats::EndPass(absl::string_view pass_name) {
+void Stats::EndPass(absl::string_view pass_name, int64_t instruction_count) {
   CHECK(pass_running_);
   CHECK_EQ(current_pass_, std::string(pass_name));
   pass_running_ = false;
   uint64_t end_micros = tsl::Env::Default()->NowMicros();
   double duration_ms = (end_micros - start_micros_) / 1000.0;
-  passes_.push_back(PassInfo(current_pass_, duration_ms));
+  PassInfo info(current_pass_, duration_ms);
+  info.peak_rss_delta_bytes = PeakRssBytes() - start_peak_rss_bytes_;
+  info.instructions_before = start_instruction_count_;
+  info.instructions_after = instruction_count;
+
+  hlo_pass_duration_usecs->GetCell(current_pass_)
+      ->Add(end_micros - start_micros_);
+  hlo_pass_peak_rss_delta_bytes->GetCell(current_pass_)
+      ->Add(info.peak_rss_delta_bytes);
+  if (instruction_count >= 0) {
+    hlo_pass_instruction_count->GetCell(current_pass_)->Add(instruction_count);
+  }
+  passes_.push_back(std::move(info));
 }
 
 void Stats::CompilationReport() {
@@ -117,6 +220,8 @@ void Stats::CompilationReport() {
     } else {
       ++summary.at(pass_name).num_runs;
       summary.at(pass_name).duration_ms += pass_run.duration_ms;
+      summary.at(pass_name).peak_rss_delta_bytes +=
+          pass_run.peak_rss_delta_bytes;
     }
   }
 
@@ -131,11 +236,28 @@ void Stats::CompilationReport() {
            std::make_pair(a.duration_ms, b.name);
   });
   LOG(INFO) << "Total runtime (ms) of HLO passes: " << total_duration;
-  LOG(INFO) << "Pass name, num runs, time (ms)";
+  LOG(INFO) << "Pass name, num runs, time (ms), peak RSS delta (KiB)";
   for (auto& pass_info : sorted_summary) {
     LOG(INFO) << pass_info.name << ", " << pass_info.num_runs << ", "
-              << pass_info.duration_ms;
+              << pass_info.duration_ms << ", "
+              << pass_info.peak_rss_delta_bytes / 1024;
+  }
+}
+
+std::string Stats::CompilationReportJson() {
+  CHECK(!pass_running_) << "EndPass never called for " << current_pass_;
+  std::vector<std::string> runs;
+  runs.reserve(passes_.size());
+  for (const PassInfo& pass_run : passes_) {
+    runs.push_back(absl::StrFormat(
+        "{\"pass\": \"%s\", \"duration_ms\": %.3f, "
+        "\"peak_rss_delta_bytes\": %d, \"instructions_before\": %d, "
+        "\"instructions_after\": %d}",
+        JsonEscape(pass_run.name), pass_run.duration_ms,
+        pass_run.peak_rss_delta_bytes, pass_run.instructions_before,
+        pass_run.instructions_after));
   }
+  return absl::StrCat("[", absl::StrJoin(runs, ",\n "), "]\n");
 }
 
 int Stats::GetPassesSize() { return passes_.size(); }
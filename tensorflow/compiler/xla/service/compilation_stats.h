@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_XLA_SERVICE_COMPILATION_STATS_H_
 #define TENSORFLOW_COMPILER_XLA_SERVICE_COMPILATION_STATS_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -26,9 +27,10 @@ namespace xla {
 
 // This class is used to collect information about HLO passes and print some
 // statistics at the end of compilation. From HloPassPipeline, we call StartPass
-// before the execution of a pass, and EndPass after. Currently, we only collect
-// timing information and how many times each pass was run. In the future, we
-// can add more things, such as the size of the HLO graph after each pass.
+// before the execution of a pass, and EndPass after. For each run of a pass, we
+// collect its wall time, how much it raised the peak RSS of the process and the
+// number of HLO instructions before and after it. The runs are also exported to
+// tsl::monitoring, under /xla/service/hlo_pass_*.
 class CompilationStats {
  public:
   virtual ~CompilationStats() = default;
@@ -41,8 +43,23 @@ class CompilationStats {
 
   virtual void EndPass(absl::string_view pass_name) = 0;
 
+  // Same as StartPass and EndPass, with the number of HLO instructions before
+  // and after the pass.
+  virtual void StartPass(absl::string_view pass_name,
+                         int64_t instruction_count) {
+    StartPass(pass_name);
+  }
+  virtual void EndPass(absl::string_view pass_name, int64_t instruction_count) {
+    EndPass(pass_name);
+  }
+
   virtual void CompilationReport() = 0;
 
+  // Returns the runs of the passes as a JSON array, in the order they were run.
+  // Each run is an object with the fields "pass", "duration_ms",
+  // "peak_rss_delta_bytes", "instructions_before" and "instructions_after".
+  virtual std::string CompilationReportJson() = 0;
+
   virtual int GetPassesSize() = 0;
 
   virtual void RecordPassError(absl::string_view pass_name,
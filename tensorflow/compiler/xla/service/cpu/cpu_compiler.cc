@@ -97,6 +97,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/batch_dot_simplification.h"
 #include "tensorflow/compiler/xla/service/batchnorm_expander.h"
 #include "tensorflow/compiler/xla/service/bfloat16_normalization.h"
+#include "tensorflow/compiler/xla/service/bfloat16_support.h"
 #include "tensorflow/compiler/xla/service/bitcast_dtypes_expander.h"
 #include "tensorflow/compiler/xla/service/broadcast_canonicalizer.h"
 #include "tensorflow/compiler/xla/service/buffer_assignment.h"
@@ -137,6 +138,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/flatten_call_graph.h"
 #include "tensorflow/compiler/xla/service/gather_expander.h"
 #include "tensorflow/compiler/xla/service/hlo.pb.h"
+#include "tensorflow/compiler/xla/service/hlo_computation_pass.h"
 #include "tensorflow/compiler/xla/service/hlo_constant_folding.h"
 #include "tensorflow/compiler/xla/service/hlo_cse.h"
 #include "tensorflow/compiler/xla/service/hlo_dce.h"
@@ -187,6 +189,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/xla_data.pb.h"
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/status.h"
+#include "tensorflow/tsl/platform/threadpool.h"
 #include "tensorflow/tsl/protobuf/error_codes.pb.h"
 
 namespace {
@@ -533,6 +536,27 @@ void AddHloVerifier(HloPassPipeline* pipeline, bool allow_sparse_shapes,
   }
 }
 
+// Keeps BF16 dots that are lowered to oneDNN matmuls in BF16, and converts the
+// other BF16 operations to F32.
+class CpuBFloat16Support : public BFloat16Support {
+ public:
+  bool SupportsBF16Operand(const HloInstruction& hlo,
+                           int64_t operand_index) const override {
+    return DotImplementationUsesOneDnn(hlo) ||
+           BFloat16Support::SupportsBF16Operand(hlo, operand_index);
+  }
+
+  bool SupportsBF16Output(const HloInstruction& hlo) const override {
+    return DotImplementationUsesOneDnn(hlo) ||
+           BFloat16Support::SupportsBF16Output(hlo);
+  }
+
+  bool SupportsMixedPrecisions(const HloInstruction& hlo) const override {
+    return DotImplementationUsesOneDnn(hlo) ||
+           BFloat16Support::SupportsMixedPrecisions(hlo);
+  }
+};
+
 }  // namespace
 
 Status CpuCompiler::RunHloPassesThroughLayoutAssn(
@@ -571,7 +595,10 @@ Status CpuCompiler::RunHloPassesThroughLayoutAssn(
   HloPassPipeline pipeline("HLO passes through layout assignment");
   AddHloVerifier(&pipeline, allow_sparse_shapes_);
 
-  pipeline.AddPass<OperandUpcaster>();
+  // Keep the S8 operands of the dots that oneDNN multiplies natively.
+  pipeline.AddPass<OperandUpcaster>([](const HloInstruction* instr) {
+    return !DotImplementationUsesOneDnn(*instr);
+  });
   pipeline.AddPass<ResultCaster>();
 
   // Expand random number generation.
@@ -610,7 +637,7 @@ Status CpuCompiler::RunHloPassesThroughLayoutAssn(
   // Convert BF16 operations to F32 operations so that the CPU backend can
   // support BF16 operations without directly implementing a BF16 lowering for
   // most ops.
-  BFloat16Support bf16;
+  CpuBFloat16Support bf16;
   pipeline.AddPass<BFloat16Normalization>(&bf16);
   // After canonicalization, there may be more batch dots that can be
   // simplified.
@@ -742,6 +769,9 @@ Status CpuCompiler::RunHloPassesThroughLayoutAssn(
         &layout_constraints);
   }
 
+  std::unique_ptr<tsl::thread::ThreadPool> computation_thread_pool =
+      CreateComputationThreadPool(*module);
+  pipeline.SetComputationThreadPool(computation_thread_pool.get());
   return pipeline.Run(module).status();
 }
 
@@ -821,6 +851,9 @@ Status CpuCompiler::RunHloPassesAfterLayoutAssn(
   pipeline.AddPass<HloDCE>();
   pipeline.AddPass<CopyInsertion>();
   pipeline.AddPass<HloDCE>();
+  std::unique_ptr<tsl::thread::ThreadPool> computation_thread_pool =
+      CreateComputationThreadPool(*module);
+  pipeline.SetComputationThreadPool(computation_thread_pool.get());
   return pipeline.Run(module).status();
 }
 
@@ -113,8 +113,14 @@ Status CpuLayoutAssignment::AddBackendConstraints(
 
   const HloComputation* computation = constraints->computation();
   for (auto* instruction : computation->instructions()) {
-    if (OperandsAndResultMustHaveRowMajorLayout(*instruction,
-                                                target_machine_features_)) {
+    if (DotImplementationUsesOneDnn(*instruction)) {
+      // oneDNN reads the operands in either layout, so they keep the layout of
+      // their producers, e.g. the row major result of a previous dot or a
+      // transpose folded into the dot, instead of getting copied.
+      TF_RETURN_IF_ERROR(SetInstructionLayout(
+          RowMajorShape(instruction->shape()), instruction));
+    } else if (OperandsAndResultMustHaveRowMajorLayout(
+                   *instruction, target_machine_features_)) {
       TF_RETURN_IF_ERROR(SetInstructionLayout(
           RowMajorShape(instruction->shape()), instruction));
       for (int i = 0; i < instruction->operand_count(); i++) {
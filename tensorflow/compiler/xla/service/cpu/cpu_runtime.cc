@@ -96,6 +96,12 @@ extern const char* const kMKLSingleThreadedMatMulF32SymbolName =
     "__xla_cpu_runtime_MKLSingleThreadedMatMulF32";
 extern const char* const kMKLSingleThreadedMatMulF64SymbolName =
     "__xla_cpu_runtime_MKLSingleThreadedMatMulF64";
+extern const char* const kOneDnnMatMulBF16SymbolName =
+    "__xla_cpu_runtime_OneDnnMatMulBF16";
+extern const char* const kOneDnnMatMulBF16F32SymbolName =
+    "__xla_cpu_runtime_OneDnnMatMulBF16F32";
+extern const char* const kOneDnnMatMulS8S32SymbolName =
+    "__xla_cpu_runtime_OneDnnMatMulS8S32";
 extern const char* const kEigenConv2DF16SymbolName =
     "__xla_cpu_runtime_EigenConv2DF16";
 extern const char* const kEigenConv2DF32SymbolName =
@@ -56,6 +56,9 @@ extern const char* const kACLMatMulF32SymbolName;
 extern const char* const kACLBatchMatMulF32SymbolName;
 extern const char* const kMKLSingleThreadedMatMulF32SymbolName;
 extern const char* const kMKLSingleThreadedMatMulF64SymbolName;
+extern const char* const kOneDnnMatMulBF16SymbolName;
+extern const char* const kOneDnnMatMulBF16F32SymbolName;
+extern const char* const kOneDnnMatMulS8S32SymbolName;
 extern const char* const kEigenConv2DF16SymbolName;
 extern const char* const kEigenConv2DF32SymbolName;
 extern const char* const kEigenConv3DF16SymbolName;
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/cpu/dot_op_emitter.h"
 
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "absl/strings/str_cat.h"
@@ -36,6 +37,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/hlo/ir/hlo_casting_utils.h"
 #include "tensorflow/compiler/xla/hlo/ir/hlo_instructions.h"
 #include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
+#include "tensorflow/compiler/xla/literal.h"
 #include "tensorflow/compiler/xla/primitive_util.h"
 #include "tensorflow/compiler/xla/service/cpu/backend_config.pb.h"
 #include "tensorflow/compiler/xla/service/cpu/cpu_options.h"
@@ -53,6 +55,10 @@ limitations under the License.
 #include "tensorflow/compiler/xla/xla_data.pb.h"
 #include "tensorflow/tsl/platform/logging.h"
 
+#ifdef ENABLE_MKL
+#include "tensorflow/compiler/xla/service/cpu/runtime_matmul_mkl.h"
+#endif  // ENABLE_MKL
+
 namespace xla {
 
 using llvm_ir::SetToFirstInsertPoint;
@@ -72,6 +78,8 @@ struct DotInfo {
   Shape rhs_shape;
   Shape result_shape;
   DotDimensionNumbers dim_nums;
+  // The value of the RHS if it is a constant, or null.
+  const Literal* rhs_literal = nullptr;
 
   DotInfo() = default;
 
@@ -81,9 +89,34 @@ struct DotInfo {
     rhs_shape = instr.operand(1)->shape();
     result_shape = instr.shape();
     dim_nums = instr.dot_dimension_numbers();
+    if (instr.operand(1)->opcode() == HloOpcode::kConstant) {
+      rhs_literal = &instr.operand(1)->literal();
+    }
   }
 };
 
+#ifdef ENABLE_MKL
+// Returns the type of the oneDNN matmul with the element types of `dot_info`,
+// if there is one.
+std::optional<OneDnnMatMulType> GetOneDnnMatMulType(const DotInfo& dot_info) {
+  const PrimitiveType operand_type = dot_info.lhs_shape.element_type();
+  const PrimitiveType result_type = dot_info.result_shape.element_type();
+  if (dot_info.rhs_shape.element_type() != operand_type) {
+    return std::nullopt;
+  }
+  if (operand_type == BF16 && result_type == BF16) {
+    return OneDnnMatMulType::kBF16;
+  }
+  if (operand_type == BF16 && result_type == F32) {
+    return OneDnnMatMulType::kBF16F32;
+  }
+  if (operand_type == S8 && result_type == S32) {
+    return OneDnnMatMulType::kS8S32;
+  }
+  return std::nullopt;
+}
+#endif  // ENABLE_MKL
+
 // Dictates how a dot operation is implemented.
 enum class DotImplementationStrategy {
   // The dot operation is lowered into LLVM IR that implements a naive nested
@@ -112,6 +145,13 @@ enum class DotImplementationStrategy {
   // GEMM -- we expose this flexibility as flexibility in the contraction
   // dimensions, but we can also see this as flexibility in the input layouts.
   kEigen,
+
+  // The dot operation is lowered into a call into a oneDNN matmul, which
+  // natively multiplies BF16 and S8 matrices (with the AMX instructions of the
+  // CPU when available).  No fusions are supported.  The result has to be row
+  // major, but the operands can have any layout.  Constant RHS operands are
+  // reordered at compile time into the format oneDNN prefers.
+  kOneDnn,
 };
 
 // Returns the implementation strategy for a dot with the configuration
@@ -150,6 +190,10 @@ class DotOpEmitter {
   // Emits a call to the CPU runtime to perform the batch matrix multiply.
   Status EmitCallToBatchRuntime();
 
+  // Emits a call to the oneDNN runtime to perform the BF16 or S8 matrix
+  // multiply.
+  Status EmitCallToOneDnn();
+
   // Represents the dimensions of a matrix-matrix multiply operation.
   struct MatMultDims {
     // The number of rows in the LHS.
@@ -581,6 +625,9 @@ Status DotOpEmitter::Emit() {
 
     case DotImplementationStrategy::kEigen:
       return EmitCallToRuntime();
+
+    case DotImplementationStrategy::kOneDnn:
+      return EmitCallToOneDnn();
   }
 }
 
@@ -914,6 +961,110 @@ Status DotOpEmitter::EmitCallToRuntime() {
   return OkStatus();
 }
 
+Status DotOpEmitter::EmitCallToOneDnn() {
+#ifdef ENABLE_MKL
+  // The signature of the oneDNN runtime matmul functions is:
+  //
+  //   (void)(void* run_options, OutType* out, InType* lhs, InType* rhs,
+  //          int64_t m, int64_t n, int64_t k, int32_t transpose_lhs,
+  //          int32_t transpose_rhs, void* packed_rhs, int32_t multi_threaded);
+  //
+  // where the matrices are row major, and a transposed LHS (RHS) is stored as
+  // [k, m] ([n, k]).
+  const Shape& lhs_shape = lhs_array_.GetShape();
+  const Shape& rhs_shape = rhs_array_.GetShape();
+  const Shape& result_shape = target_array_.GetShape();
+  TF_RET_CHECK(LayoutUtil::IsMonotonicWithDim0Major(result_shape.layout()));
+
+  std::optional<OneDnnMatMulType> type = GetOneDnnMatMulType(dot_info_);
+  TF_RET_CHECK(type.has_value());
+  const char* fn_name = nullptr;
+  switch (*type) {
+    case OneDnnMatMulType::kBF16:
+      fn_name = runtime::kOneDnnMatMulBF16SymbolName;
+      break;
+    case OneDnnMatMulType::kBF16F32:
+      fn_name = runtime::kOneDnnMatMulBF16F32SymbolName;
+      break;
+    case OneDnnMatMulType::kS8S32:
+      fn_name = runtime::kOneDnnMatMulS8S32SymbolName;
+      break;
+  }
+
+  // The operands are transposed if their non-contracting dimension is the
+  // minor one.
+  const int64_t lhs_contracting_dim =
+      dot_info_.dim_nums.lhs_contracting_dimensions(0);
+  const int64_t rhs_contracting_dim =
+      dot_info_.dim_nums.rhs_contracting_dimensions(0);
+  const int64_t m = lhs_shape.dimensions(1 - lhs_contracting_dim);
+  const int64_t n = rhs_shape.dimensions(1 - rhs_contracting_dim);
+  const int64_t k = lhs_shape.dimensions(lhs_contracting_dim);
+  const bool transpose_lhs =
+      LayoutUtil::Minor(lhs_shape.layout(), 0) != lhs_contracting_dim;
+  const bool transpose_rhs =
+      LayoutUtil::Minor(rhs_shape.layout(), 0) == rhs_contracting_dim;
+
+  llvm::Function* function = b_->GetInsertBlock()->getParent();
+  llvm::Module* module = function->getParent();
+  llvm::Type* int64_type = b_->getInt64Ty();
+  llvm::Type* int32_type = b_->getInt32Ty();
+  llvm::PointerType* int8_ptr_type = b_->getInt8Ty()->getPointerTo();
+  llvm::Type* operand_ptr_type =
+      llvm_ir::PrimitiveTypeToIrType(lhs_shape.element_type(), module)
+          ->getPointerTo();
+  llvm::Type* result_ptr_type =
+      llvm_ir::PrimitiveTypeToIrType(result_shape.element_type(), module)
+          ->getPointerTo();
+
+  // Reorder constant weights now instead of at each call.
+  llvm::Value* packed_rhs = llvm::ConstantPointerNull::get(int8_ptr_type);
+  if (dot_info_.rhs_literal != nullptr &&
+      dot_info_.rhs_literal->shape().layout() == rhs_shape.layout()) {
+    std::vector<char> packed = OneDnnPackMatMulWeights(
+        *type, m, n, k, transpose_lhs, transpose_rhs,
+        dot_info_.rhs_literal->untyped_data());
+    if (!packed.empty()) {
+      llvm::Constant* initializer = llvm::ConstantDataArray::getRaw(
+          llvm::StringRef(packed.data(), packed.size()), packed.size(),
+          b_->getInt8Ty());
+      auto* packed_global = new llvm::GlobalVariable(
+          *module, initializer->getType(), /*isConstant=*/true,
+          llvm::GlobalValue::PrivateLinkage, initializer,
+          absl::StrCat(dot_hlo_name_, ".packed_rhs"));
+      packed_global->setAlignment(llvm::Align(64));
+      packed_rhs = b_->CreateBitCast(packed_global, int8_ptr_type);
+    }
+  }
+
+  llvm::FunctionType* matmul_type = llvm::FunctionType::get(
+      b_->getVoidTy(),
+      {int8_ptr_type, result_ptr_type, operand_ptr_type, operand_ptr_type,
+       int64_type, int64_type, int64_type, int32_type, int32_type,
+       int8_ptr_type, int32_type},
+      /*isVarArg=*/false);
+  llvm::FunctionCallee matmul_func =
+      module->getOrInsertFunction(fn_name, matmul_type);
+  if (auto* fn = llvm::dyn_cast<llvm::Function>(matmul_func.getCallee())) {
+    fn->setCallingConv(llvm::CallingConv::C);
+    fn->setDoesNotThrow();
+  }
+
+  b_->CreateCall(
+      matmul_func,
+      {b_->CreateBitCast(executable_run_options_value_, int8_ptr_type),
+       b_->CreateBitCast(target_array_.GetBasePointer(), result_ptr_type),
+       b_->CreateBitCast(lhs_array_.GetBasePointer(), operand_ptr_type),
+       b_->CreateBitCast(rhs_array_.GetBasePointer(), operand_ptr_type),
+       b_->getInt64(m), b_->getInt64(n), b_->getInt64(k),
+       b_->getInt32(transpose_lhs), b_->getInt32(transpose_rhs), packed_rhs,
+       b_->getInt32(ShouldUseMultiThreadedEigen(hlo_module_config_))});
+  return OkStatus();
+#else
+  return Unimplemented("oneDNN dots require building with --config=mkl");
+#endif  // ENABLE_MKL
+}
+
 Status DotOpEmitter::EmitCallToBatchRuntime() {
   // The signature of the runtime batch matmul function is:
   //
@@ -1193,9 +1344,34 @@ bool CanEmitTiledLlvmIrGemm(
   return true;
 }
 
+// Returns true if `dot_info` is a BF16 or S8 matrix multiplication that oneDNN
+// implements on this CPU.
+bool IsOneDnnMatMul(const HloModuleConfig& config, const DotInfo& dot_info) {
+#ifdef ENABLE_MKL
+  if (!config.debug_options().xla_cpu_use_mkl_dnn() ||
+      dot_info.dim_nums.lhs_batch_dimensions_size() != 0 ||
+      dot_info.dim_nums.lhs_contracting_dimensions_size() != 1 ||
+      dot_info.dim_nums.rhs_contracting_dimensions_size() != 1 ||
+      !IsRank2(dot_info.lhs_shape) || !IsRank2(dot_info.rhs_shape) ||
+      !IsRank2(dot_info.result_shape) ||
+      ShapeUtil::IsZeroElementArray(dot_info.lhs_shape) ||
+      ShapeUtil::IsZeroElementArray(dot_info.rhs_shape)) {
+    return false;
+  }
+  std::optional<OneDnnMatMulType> type = GetOneDnnMatMulType(dot_info);
+  return type.has_value() && OneDnnMatMulIsSupported(*type);
+#else
+  return false;
+#endif  // ENABLE_MKL
+}
+
 DotImplementationStrategy GetDotImplementationStrategy(
     const HloModuleConfig& config, const DotInfo& dot_info,
     const TargetMachineFeatures& target_machine_features) {
+  if (IsOneDnnMatMul(config, dot_info)) {
+    return DotImplementationStrategy::kOneDnn;
+  }
+
   PrimitiveType element_type = dot_info.result_shape.element_type();
   // Any Matrix-Vector product of floating point or integral type, or
   // a transpose-dot fusion of the same can be lowered to a tiled LLVM
@@ -1478,7 +1654,13 @@ bool DotImplementationCanHandleTranspose(
 
   return impl_strategy == DotImplementationStrategy::kNaiveLlvmIr ||
          impl_strategy == DotImplementationStrategy::kTiledLlvmIrGemv ||
-         impl_strategy == DotImplementationStrategy::kEigen;
+         impl_strategy == DotImplementationStrategy::kEigen ||
+         impl_strategy == DotImplementationStrategy::kOneDnn;
+}
+
+bool DotImplementationUsesOneDnn(const HloInstruction& dot_instr) {
+  return dot_instr.opcode() == HloOpcode::kDot &&
+         IsOneDnnMatMul(dot_instr.GetModule()->config(), DotInfo(dot_instr));
 }
 
 bool DotOperandsAndResultMustHaveRowMajorLayout(
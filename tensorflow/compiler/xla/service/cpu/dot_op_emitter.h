@@ -42,6 +42,12 @@ bool DotImplementationCanHandleTranspose(
     const HloInstruction& dot_instr,
     const TargetMachineFeatures& target_machine_features);
 
+// Returns true if `dot_instr` is a BF16 or S8 matrix multiplication that is
+// lowered to a oneDNN matmul.  These dots take BF16 and S8 operands as they
+// are, and their operands can have any layout but their result has to be row
+// major.
+bool DotImplementationUsesOneDnn(const HloInstruction& dot_instr);
+
 // Returns the index for an operand to `hlo` that should ideally be column
 // major.  Returns nullopt if there is no such operand or if `hlo` is not a dot
 // or a fusion containing a dot.
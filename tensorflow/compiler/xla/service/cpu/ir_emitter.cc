@@ -1729,6 +1729,166 @@ void IrEmitter::EmitShardedVectorStore(
   }
 }
 
+StatusOr<llvm::Value*> IrEmitter::EmitVectorizedRowReduction(
+    const ReductionGenerator& reduction_generator,
+    const llvm_ir::IrArray::Index& output_index, HloInstruction* init_value,
+    HloInstruction* arg, absl::Span<const int64_t> dimensions, int64_t row_size,
+    int vectorization_factor, llvm::Align element_alignment) {
+  PrimitiveType element_type = arg->shape().element_type();
+  llvm::Type* element_ir_type =
+      llvm_ir::PrimitiveTypeToIrType(element_type, module_);
+
+  // The row starts at the element of the output index with zeros for the
+  // reduced dimensions.
+  std::vector<llvm::Value*> input_multi_index(arg->shape().dimensions_size());
+  llvm_ir::IrArray::Index::const_iterator it = output_index.begin();
+  for (int64_t i = 0; i < input_multi_index.size(); ++i) {
+    input_multi_index[i] =
+        absl::c_linear_search(dimensions, i) ? b_.getInt64(0) : *it++;
+  }
+  CHECK(output_index.end() == it);
+  llvm_ir::IrArray arg_array(GetIrArrayFor(arg));
+  llvm_ir::IrArray::Index input_index(input_multi_index, arg->shape(),
+                                      b_.getInt64Ty());
+  llvm::Value* row =
+      BitCast(arg_array.EmitArrayElementAddress(input_index, &b_),
+              element_ir_type->getPointerTo());
+
+  // Loads the vectorization_factor elements of the row from `offset`.
+  ShardedVectorType vector_type =
+      CreateShardedVectorType(element_type, vectorization_factor);
+  auto load_sharded_vector = [&](llvm::Value* offset) {
+    ShardedVector vector;
+    vector.reserve(vector_type.size());
+    int64_t shard_offset = 0;
+    for (llvm::Type* shard_type : vector_type) {
+      llvm::Value* shard_address =
+          BitCast(InBoundsGEP(element_ir_type, row,
+                              {Add(offset, b_.getInt64(shard_offset))}),
+                  shard_type->getPointerTo());
+      llvm::LoadInst* shard =
+          AlignedLoad(shard_type, shard_address, element_alignment);
+      arg_array.AnnotateLoadStoreInstructionWithMetadata(shard);
+      vector.push_back(shard);
+      auto* shard_vector_type =
+          llvm::dyn_cast<llvm::FixedVectorType>(shard_type);
+      shard_offset +=
+          shard_vector_type ? shard_vector_type->getNumElements() : 1;
+    }
+    return vector;
+  };
+
+  // The lanes of the accumulator hold partial results. The accumulator starts
+  // with the first elements of the row rather than with the initial value, so
+  // that the initial value is reduced only once.
+  ShardedVector accumulator;
+  accumulator.reserve(vector_type.size());
+  for (llvm::Value* shard : load_sharded_vector(b_.getInt64(0))) {
+    llvm::Value* accumulator_shard = llvm_ir::EmitAllocaAtFunctionEntry(
+        shard->getType(), "accumulator", &b_, 0);
+    AlignedStore(shard, accumulator_shard, element_alignment);
+    accumulator.push_back(accumulator_shard);
+  }
+
+  const int64_t vectorized_size =
+      row_size / vectorization_factor * vectorization_factor;
+  llvm_ir::ForLoopNest vectorized_loop_nest(IrName(arg, "vectorized_row"),
+                                            &b_);
+  std::unique_ptr<llvm_ir::ForLoop> vectorized_loop =
+      vectorized_loop_nest.AddLoop(vectorization_factor, vectorized_size,
+                                   vectorization_factor, "reduction_dim");
+  SetToFirstInsertPoint(vectorized_loop->GetBodyBasicBlock(), &b_);
+  ShardedVector addend = load_sharded_vector(vectorized_loop->GetIndVarValue());
+  for (int i = 0; i < accumulator.size(); ++i) {
+    auto alloca = llvm::cast<llvm::AllocaInst>(accumulator[i]);
+    llvm::Value* current_accumulator_value = AlignedLoad(
+        alloca->getAllocatedType(), accumulator[i], element_alignment);
+    AlignedStore(
+        reduction_generator(&b_, current_accumulator_value, addend[i]),
+        accumulator[i], element_alignment);
+  }
+  SetToFirstInsertPoint(vectorized_loop_nest.GetOuterLoopExitBasicBlock(),
+                        &b_);
+
+  // Reduces the lanes of the accumulator into the initial value.
+  llvm::Value* result =
+      Load(IrShapeType(init_value->shape()), GetEmittedValueFor(init_value));
+  for (llvm::Value* accumulator_shard : accumulator) {
+    auto alloca = llvm::cast<llvm::AllocaInst>(accumulator_shard);
+    llvm::Value* shard = AlignedLoad(alloca->getAllocatedType(),
+                                     accumulator_shard, element_alignment);
+    if (auto* shard_vector_type =
+            llvm::dyn_cast<llvm::FixedVectorType>(shard->getType())) {
+      for (unsigned lane = 0; lane < shard_vector_type->getNumElements();
+           ++lane) {
+        result = reduction_generator(&b_, result,
+                                     b_.CreateExtractElement(shard, lane));
+      }
+    } else {
+      result = reduction_generator(&b_, result, shard);
+    }
+  }
+  if (vectorized_size == row_size) {
+    return result;
+  }
+
+  // Reduces the remaining elements of the row one at a time.
+  llvm::Value* result_address = llvm_ir::EmitAllocaAtFunctionEntry(
+      element_ir_type, "row_result", &b_, 0);
+  AlignedStore(result, result_address, element_alignment);
+  llvm_ir::ForLoopNest epilogue_loop_nest(IrName(arg, "row_epilogue"), &b_);
+  std::unique_ptr<llvm_ir::ForLoop> epilogue_loop =
+      epilogue_loop_nest.AddLoop(vectorized_size, row_size, "reduction_dim");
+  SetToFirstInsertPoint(epilogue_loop->GetBodyBasicBlock(), &b_);
+  llvm::LoadInst* element = AlignedLoad(
+      element_ir_type,
+      InBoundsGEP(element_ir_type, row, {epilogue_loop->GetIndVarValue()}),
+      element_alignment);
+  arg_array.AnnotateLoadStoreInstructionWithMetadata(element);
+  llvm::Value* current_result =
+      AlignedLoad(element_ir_type, result_address, element_alignment);
+  AlignedStore(reduction_generator(&b_, current_result, element),
+               result_address, element_alignment);
+  SetToFirstInsertPoint(epilogue_loop_nest.GetOuterLoopExitBasicBlock(), &b_);
+  return AlignedLoad(element_ir_type, result_address, element_alignment);
+}
+
+StatusOr<bool> IrEmitter::EmitVectorizedRowReduce(
+    HloInstruction* reduce, HloInstruction* arg, HloInstruction* init_value,
+    absl::Span<const int64_t> dimensions,
+    const ReductionGenerator& reduction_generator, int vectorization_factor,
+    llvm::Align element_alignment, std::string* failure_reason) {
+  // Each row to reduce is contiguous if the reduced dimensions are the most
+  // minor ones.
+  for (int64_t i = 0; i < dimensions.size(); ++i) {
+    if (!absl::c_linear_search(dimensions,
+                               LayoutUtil::Minor(arg->shape().layout(), i))) {
+      *failure_reason =
+          "reduction over minor dimension is only vectorized when the reduced "
+          "dimensions are the most minor ones";
+      return false;
+    }
+  }
+  int64_t row_size = 1;
+  for (int64_t dimension : dimensions) {
+    row_size *= arg->shape().dimensions(dimension);
+  }
+  if (row_size < vectorization_factor) {
+    *failure_reason = "reduced rows are shorter than the vectorization factor";
+    return false;
+  }
+
+  // The rows are reduced in the loop over the elements of the result, which is
+  // partitioned when the reduction runs on several threads.
+  TF_RETURN_IF_ERROR(EmitTargetElementLoop(
+      reduce, [&](const llvm_ir::IrArray::Index& index) {
+        return EmitVectorizedRowReduction(
+            reduction_generator, index, init_value, arg, dimensions, row_size,
+            vectorization_factor, element_alignment);
+      }));
+  return true;
+}
+
 StatusOr<bool> IrEmitter::EmitVectorizedReduce(
     HloInstruction* reduce, HloInstruction* arg, HloInstruction* init_value,
     absl::Span<const int64_t> dimensions, HloComputation* function,
@@ -1774,8 +1934,17 @@ StatusOr<bool> IrEmitter::EmitVectorizedReduce(
       MinimumAlignmentForPrimitiveType(reduce->shape().element_type())));
 
   if (is_reduction_over_minor_dimension) {
-    // TODO(sanjoy): Implement vectorized reduction over the minor dimension.
-    *failure_reason = "reduction over minor dimension not implemented";
+    return EmitVectorizedRowReduce(reduce, arg, init_value, dimensions,
+                                   reduction_generator, vectorization_factor,
+                                   element_alignment, failure_reason);
+  }
+
+  // The most minor dimension of the result is strided below, so only the other
+  // dimensions can be partitioned across threads.
+  const bool emit_parallel_loop = ShouldEmitParallelLoopFor(*reduce);
+  if (emit_parallel_loop &&
+      num_dynamic_loop_bounds_ >= reduce->shape().dimensions_size()) {
+    *failure_reason = "partitioning of the minor dimension not implemented";
     return false;
   }
 
@@ -1803,15 +1972,29 @@ StatusOr<bool> IrEmitter::EmitVectorizedReduce(
   //  }
 
   llvm_ir::ForLoopNest loop_nest(IrName(reduce), &b_);
-  std::vector<llvm::Value*> array_multi_index(
-      reduce->shape().dimensions_size());
+  const int64_t num_dims = reduce->shape().dimensions_size();
+  std::vector<llvm::Value*> array_multi_index(num_dims);
+  DynamicLoopBounds dynamic_loop_bounds;
+  if (emit_parallel_loop) {
+    dynamic_loop_bounds = compute_function_->GetDynamicLoopBounds();
+  }
   for (int i = LayoutUtil::MinorToMajor(reduce->shape()).size() - 1; i > 0;
        --i) {
     int64_t dimension = LayoutUtil::Minor(reduce->shape().layout(), i);
-    int64_t start_index = 0;
-    int64_t end_index = reduce->shape().dimensions(dimension);
-    std::unique_ptr<llvm_ir::ForLoop> loop = loop_nest.AddLoop(
-        start_index, end_index, absl::StrFormat("dim.%d", dimension));
+    const int64_t bounds_index = num_dims - 1 - i;
+    std::unique_ptr<llvm_ir::ForLoop> loop;
+    if (bounds_index < dynamic_loop_bounds.size()) {
+      // This task only computes its partition of the most major dimensions, as
+      // in ParallelLoopEmitter.
+      loop = loop_nest.AddLoop(absl::StrFormat("dim.%d", dimension),
+                               dynamic_loop_bounds[bounds_index].first,
+                               dynamic_loop_bounds[bounds_index].second);
+    } else {
+      int64_t start_index = 0;
+      int64_t end_index = reduce->shape().dimensions(dimension);
+      loop = loop_nest.AddLoop(start_index, end_index,
+                               absl::StrFormat("dim.%d", dimension));
+    }
     array_multi_index[dimension] = loop->GetIndVarValue();
   }
 
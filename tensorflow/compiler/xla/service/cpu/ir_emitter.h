@@ -417,6 +417,28 @@ class IrEmitter : public DfsHloVisitorWithDefault,
       HloInstruction* arg, absl::Span<const int64_t> dimensions,
       llvm::Align element_alignment);
 
+  // Emits the vectorized reduction of the row of `arg` at `output_index` when
+  // the reduced dimensions are the most minor ones, so that the row_size
+  // elements of the row are contiguous. The row is reduced vectorization_factor
+  // elements at a time into a sharded vector accumulator, whose lanes are then
+  // reduced together with the remaining elements. Helper function for
+  // EmitVectorizedRowReduce.
+  StatusOr<llvm::Value*> EmitVectorizedRowReduction(
+      const ReductionGenerator& reduction_generator,
+      const llvm_ir::IrArray::Index& output_index, HloInstruction* init_value,
+      HloInstruction* arg, absl::Span<const int64_t> dimensions,
+      int64_t row_size, int vectorization_factor,
+      llvm::Align element_alignment);
+
+  // Tries to emit a vectorized reduction over the most minor dimension,
+  // parallelized like the other element loops. Helper function for
+  // EmitVectorizedReduce.
+  StatusOr<bool> EmitVectorizedRowReduce(
+      HloInstruction* reduce, HloInstruction* arg, HloInstruction* init_value,
+      absl::Span<const int64_t> dimensions,
+      const ReductionGenerator& reduction_generator, int vectorization_factor,
+      llvm::Align element_alignment, std::string* failure_reason);
+
   // Tries to emit a fast concatenate operation using memcpy.  Returns true if
   // successful, and false on failure.  On failure, sets "failure_reason" to a
   // string describing why it could not emit a fast concatenate.
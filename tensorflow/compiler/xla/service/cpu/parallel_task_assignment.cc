@@ -63,6 +63,8 @@ class DefaultCostModel : public ParallelCostModel {
   ~DefaultCostModel() override {}
 
   int64_t GetParallelTaskCount(HloInstruction* instruction) override {
+    // The number of partitions per thread of the loop fusions.
+    static constexpr int64_t kLoopFusionTasksPerThread = 4;
     // Parameters for parallel task count computation.
     int64_t instruction_cost;
     int64_t min_cost_per_thread;
@@ -73,8 +75,11 @@ class DefaultCostModel : public ParallelCostModel {
     const float flops_to_bytes_ratio =
         cost_analysis_->flop_count(*instruction) /
         static_cast<float>(bytes_accessed);
-    // Check for I/O bound instructions.
-    if (flops_to_bytes_ratio <= 1.0) {
+    // Check for I/O bound instructions. Loop fusions are costed by the work of
+    // all their fused instructions instead, as capping them like a single
+    // memory bound instruction kept mid-sized elementwise fusions on a few
+    // cores.
+    if (flops_to_bytes_ratio <= 1.0 && !instruction->IsLoopFusion()) {
       // Limit max parallelism for I/O bound instructions by assuming a
       // sub-linear scaling function (fit based on empirical benchmark results).
       // TODO(b/29630486) Develop system bandwidth model.
@@ -84,8 +89,12 @@ class DefaultCostModel : public ParallelCostModel {
       instruction_cost = shape_size_(instruction->shape());
       min_cost_per_thread = 256LL << 10;  // 256KB L2 Cache size.
     } else {
-      // Use max parallelism for compute bound instructions.
-      max_parallelism = max_parallelism_;
+      // Use max parallelism for compute bound instructions. Loop fusions are
+      // split into more partitions than threads, which the runtime balances
+      // across the threads as they become free (see runtime_fork_join.cc).
+      max_parallelism = instruction->IsLoopFusion() && max_parallelism_ > 1
+                            ? max_parallelism_ * kLoopFusionTasksPerThread
+                            : max_parallelism_;
       // Calculate the instruction cost in cycles.
       // TODO(b/29630486) Improve on this linear cost model.
       // Consider making 'min_cost_per_thread' be a function of the target
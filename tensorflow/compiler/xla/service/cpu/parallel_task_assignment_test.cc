@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/service/cpu/parallel_task_assignment.h"
 
+#include "tensorflow/compiler/xla/service/cpu/backend_config.pb.h"
 #include "tensorflow/compiler/xla/service/cpu/cpu_executable.h"
 #include "tensorflow/compiler/xla/service/cpu/target_machine_features_fake.h"
 #include "tensorflow/compiler/xla/test.h"
@@ -206,5 +207,39 @@ TEST_F(ParallelTaskAssignmentTest, ConstantNotParallelized) {
   EXPECT_FALSE(changed);
 }
 
+TEST_F(ParallelTaskAssignmentTest, LoopFusionOverDecomposed) {
+  constexpr char hlo_string[] = R"(
+  HloModule TestTaskParallel_loop_fusion
+    fused_computation {
+      p0 = f32[1024,1024]{1,0} parameter(0)
+      p1 = f32[1024,1024]{1,0} parameter(1)
+      ROOT add = f32[1024,1024]{1,0} add(p0, p1)
+    }
+
+    ENTRY entry {
+      p0 = f32[1024,1024]{1,0} parameter(0)
+      p1 = f32[1024,1024]{1,0} parameter(1)
+      ROOT fusion = f32[1024,1024]{1,0} fusion(p0, p1), kind=kLoop,
+        calls=fused_computation
+    }
+  )";
+
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> m,
+                          ParseAndReturnVerifiedModule(hlo_string));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunParallelTaskAssigner(m.get()));
+  EXPECT_TRUE(changed);
+
+  // The memory bound fusion isn't capped like a memory bound instruction, and
+  // is over-decomposed for the runtime to balance the partitions.
+  const HloInstruction* fusion = m->entry_computation()->root_instruction();
+  TF_ASSERT_OK_AND_ASSIGN(auto backend_config,
+                          fusion->backend_config<cpu::BackendConfig>());
+  int64_t num_partitions = 1;
+  for (int64_t partitions : backend_config.outer_dimension_partitions()) {
+    num_partitions *= partitions;
+  }
+  EXPECT_GT(num_partitions, max_parallelism_);
+}
+
 }  // namespace
 }  // namespace xla
@@ -17,6 +17,9 @@ limitations under the License.
 
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+#include <atomic>
+
 #include "absl/base/dynamic_annotations.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
@@ -29,8 +32,13 @@ limitations under the License.
 using ComputeFunctionType = void (*)(void*, const void*, const void**, void**,
                                      void*, int64_t*, uint64_t*);
 
-// Dispatches 'num_partitions - 1' calls to 'function_ptr' in parallel.
-// Calls 'function_ptr' for first partition inline.
+// Calls 'function_ptr' for each of the 'num_partitions' partitions in parallel.
+// The partitions are claimed dynamically from a shared counter by the calling
+// thread and by up to one worker per thread of the intra-op thread pool, so the
+// threads which finish their partitions early take over the remaining ones.
+// When called from a thread of the intra-op thread pool (nested parallelism),
+// all the partitions are run inline instead, as blocking the thread for the
+// other ones would only oversubscribe the pool.
 // Uses blocking counter to synchronize threads after parallel calls complete.
 //
 // The 'partitions' array has a total number of elements equal to
@@ -82,24 +90,38 @@ ABSL_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_ParallelForkJoin(
 
   std::vector<XlaCustomCallStatus> statuses(num_partitions);
 
-  // Dispatch 'num_partitions - 1' compute functions to run in parallel.
-  tsl::BlockingCounter bc(num_partitions - 1);
-  for (int32_t i = 1; i < num_partitions; ++i) {
-    const int64_t offset = i * stride;
-    run_options->intra_op_thread_pool()->enqueueNoNotification(
-        [i, function, result_ptr, run_options_ptr, buffer_table, prof_counters,
-         partitions, offset, &bc, &statuses]() {
-          function(result_ptr, run_options_ptr, nullptr, buffer_table,
-                   &statuses[i], &partitions[offset], prof_counters);
-          bc.DecrementCount();
-          VLOG(3) << "ParallelForkJoin partition " << i << " done.";
-        });
+  // Runs the partitions which haven't been claimed yet. Any partition may run
+  // on any thread, so none of them is passed 'params', which the parallel
+  // compute functions don't take (see the check above).
+  std::atomic<int32_t> next_partition(0);
+  auto run_partitions = [&]() {
+    for (int32_t i = next_partition.fetch_add(1, std::memory_order_relaxed);
+         i < num_partitions;
+         i = next_partition.fetch_add(1, std::memory_order_relaxed)) {
+      function(result_ptr, run_options_ptr, nullptr, buffer_table,
+               &statuses[i], &partitions[i * stride], prof_counters);
+      VLOG(3) << "ParallelForkJoin partition " << i << " done.";
+    }
+  };
+
+  const Eigen::ThreadPoolDevice* thread_pool =
+      run_options->intra_op_thread_pool();
+  const int32_t num_workers =
+      thread_pool->currentThreadId() == -1
+          ? std::min<int32_t>(num_partitions - 1, thread_pool->numThreads())
+          : 0;
+
+  // Dispatch 'num_workers' workers to run partitions in parallel.
+  tsl::BlockingCounter bc(num_workers);
+  for (int32_t i = 0; i < num_workers; ++i) {
+    thread_pool->enqueueNoNotification([&run_partitions, &bc]() {
+      run_partitions();
+      bc.DecrementCount();
+    });
   }
 
-  // Call first compute function inline.
-  function(result_ptr, run_options_ptr, params, buffer_table, &statuses[0],
-           &partitions[0], prof_counters);
-  VLOG(3) << "ParallelForkJoin partition 0 done.";
+  // Run partitions inline too.
+  run_partitions();
   bc.Wait();
 
   // Collect all error messages (if any).
@@ -0,0 +1,146 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/runtime_fork_join.h"
+
+#define EIGEN_USE_THREADS
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/compiler/xla/executable_run_options.h"
+#include "tensorflow/compiler/xla/service/custom_call_status_internal.h"
+#include "tensorflow/tsl/platform/test.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+// The state shared by the partitions of a fork-join, passed to them as their
+// result pointer.
+struct ForkJoin {
+  explicit ForkJoin(int32_t num_partitions)
+      : num_runs(num_partitions), partitions(2 * num_partitions) {
+    for (int32_t i = 0; i < num_partitions; ++i) {
+      partitions[2 * i] = i;
+      partitions[2 * i + 1] = i + 1;
+    }
+  }
+
+  // Runs the fork-join of `function` over all the partitions.
+  void Run(const ExecutableRunOptions& run_options, void* function) {
+    __xla_cpu_runtime_ParallelForkJoin(
+        this, &run_options, /*params=*/nullptr, /*buffer_table=*/nullptr,
+        &status, /*prof_counters=*/nullptr, num_runs.size(), partitions.data(),
+        /*num_partitioned_dims=*/1, function);
+  }
+
+  // The number of times each partition was run.
+  std::vector<std::atomic<int>> num_runs;
+  // The partition whose run fails, if any.
+  std::optional<int64_t> failing_partition;
+  // The fork-join run by each partition, if any.
+  ForkJoin* nested = nullptr;
+  std::vector<int64_t> partitions;
+  XlaCustomCallStatus status;
+};
+
+void RunPartition(void* result, const void* run_options, const void** params,
+                  void** buffer_table, void* status, int64_t* partition,
+                  uint64_t* prof_counters) {
+  ForkJoin* fork_join = static_cast<ForkJoin*>(result);
+  const int64_t index = partition[0];
+  fork_join->num_runs[index]++;
+  if (fork_join->failing_partition == index) {
+    constexpr absl::string_view kMessage = "failed";
+    XlaCustomCallStatusSetFailure(static_cast<XlaCustomCallStatus*>(status),
+                                  kMessage.data(), kMessage.size());
+  }
+}
+
+// Runs the nested fork-join from within a partition.
+void RunNestedForkJoin(void* result, const void* run_options,
+                       const void** params, void** buffer_table, void* status,
+                       int64_t* partition, uint64_t* prof_counters) {
+  ForkJoin* fork_join = static_cast<ForkJoin*>(result);
+  fork_join->num_runs[partition[0]]++;
+  fork_join->nested->Run(
+      *static_cast<const ExecutableRunOptions*>(run_options),
+      reinterpret_cast<void*>(&RunPartition));
+}
+
+class ForkJoinTest : public ::testing::Test {
+ protected:
+  explicit ForkJoinTest(int num_threads = 4)
+      : pool_(num_threads), device_(&pool_, num_threads) {
+    run_options_.set_intra_op_thread_pool(&device_);
+  }
+
+  Eigen::ThreadPool pool_;
+  Eigen::ThreadPoolDevice device_;
+  ExecutableRunOptions run_options_;
+};
+
+TEST_F(ForkJoinTest, RunsEveryPartitionOnce) {
+  // More partitions than threads, which the threads claim as they get free.
+  ForkJoin fork_join(/*num_partitions=*/64);
+  fork_join.Run(run_options_, reinterpret_cast<void*>(&RunPartition));
+  for (const std::atomic<int>& num_runs : fork_join.num_runs) {
+    EXPECT_EQ(num_runs.load(), 1);
+  }
+  EXPECT_FALSE(CustomCallStatusGetMessage(&fork_join.status).has_value());
+}
+
+TEST_F(ForkJoinTest, ReportsTheErrorsOfThePartitions) {
+  ForkJoin fork_join(/*num_partitions=*/8);
+  fork_join.failing_partition = 3;
+  fork_join.Run(run_options_, reinterpret_cast<void*>(&RunPartition));
+  for (const std::atomic<int>& num_runs : fork_join.num_runs) {
+    EXPECT_EQ(num_runs.load(), 1);
+  }
+  std::optional<absl::string_view> message =
+      CustomCallStatusGetMessage(&fork_join.status);
+  ASSERT_TRUE(message.has_value());
+  EXPECT_EQ(*message, "Partition 3 error: failed");
+}
+
+class NestedForkJoinTest : public ForkJoinTest {
+ protected:
+  NestedForkJoinTest() : ForkJoinTest(/*num_threads=*/1) {}
+};
+
+TEST_F(NestedForkJoinTest, RunsNestedForkJoinsInline) {
+  // The partition run by the only thread of the pool would wait forever for
+  // the pool if the nested fork-join was not run inline.
+  ForkJoin fork_join(/*num_partitions=*/2);
+  ForkJoin nested(/*num_partitions=*/8);
+  fork_join.nested = &nested;
+  fork_join.Run(run_options_, reinterpret_cast<void*>(&RunNestedForkJoin));
+  for (const std::atomic<int>& num_runs : fork_join.num_runs) {
+    EXPECT_EQ(num_runs.load(), 1);
+  }
+  for (const std::atomic<int>& num_runs : nested.num_runs) {
+    EXPECT_EQ(num_runs.load(), 2);
+  }
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace xla
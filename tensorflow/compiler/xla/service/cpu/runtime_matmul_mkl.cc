@@ -126,4 +126,284 @@ __xla_cpu_runtime_MKLSingleThreadedMatMulF64(const void* run_options_ptr,
   // Set thread number back to the previous number.
   mkl_set_num_threads_local(prev_num_threads);
 }
+#endif  // ENABLE_MKL && !INTEL_MKL_DNN_ONLY
+
+#ifdef ENABLE_MKL
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <tuple>
+
+#include "dnnl.hpp"
+#include "dnnl_threadpool.hpp"
+#include "tensorflow/compiler/xla/service/cpu/runtime_matmul_mkl.h"
+
+#define EIGEN_USE_THREADS
+#include "absl/base/dynamic_annotations.h"
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/compiler/xla/executable_run_options.h"
+
+namespace {
+
+using dnnl::engine;
+using dnnl::matmul;
+using dnnl::memory;
+using dnnl::stream;
+using xla::cpu::OneDnnMatMulType;
+
+// The packed weights are preceded by their oneDNN memory descriptor, padded to
+// keep the weights at the alignment oneDNN prefers.
+constexpr size_t kPackedWeightsAlignment = 64;
+constexpr size_t kPackedWeightsOffset =
+    (sizeof(dnnl_memory_desc_t) + kPackedWeightsAlignment - 1) /
+    kPackedWeightsAlignment * kPackedWeightsAlignment;
+
+engine& CpuEngine() {
+  static engine* cpu_engine = new engine(engine::kind::cpu, 0);
+  return *cpu_engine;
+}
+
+#if DNNL_CPU_THREADING_RUNTIME == DNNL_RUNTIME_THREADPOOL
+// Runs the oneDNN primitives on the intra-op thread pool of XLA.
+class EigenThreadPool : public dnnl::threadpool_interop::threadpool_iface {
+ public:
+  explicit EigenThreadPool(const Eigen::ThreadPoolDevice* device)
+      : device_(device) {}
+
+  int get_num_threads() const override { return device_->numThreads(); }
+  bool get_in_parallel() const override {
+    return device_->currentThreadId() != -1;
+  }
+  uint64_t get_flags() const override { return 0; }
+
+  void parallel_for(int n, const std::function<void(int, int)>& fn) override {
+    if (n == 1 || get_in_parallel()) {
+      for (int i = 0; i < n; ++i) fn(i, n);
+      return;
+    }
+    Eigen::Barrier barrier(n - 1);
+    for (int i = 1; i < n; ++i) {
+      device_->enqueueNoNotification([&barrier, &fn, i, n]() {
+        fn(i, n);
+        barrier.Notify();
+      });
+    }
+    fn(0, n);
+    barrier.Wait();
+  }
+
+ private:
+  const Eigen::ThreadPoolDevice* device_;
+};
+#endif  // DNNL_CPU_THREADING_RUNTIME == DNNL_RUNTIME_THREADPOOL
+
+struct OneDnnMatMulParams {
+  OneDnnMatMulType type;
+  int64_t m;
+  int64_t n;
+  int64_t k;
+  bool transpose_lhs;
+  bool transpose_rhs;
+
+  auto Key() const {
+    return std::make_tuple(type, m, n, k, transpose_lhs, transpose_rhs);
+  }
+};
+
+memory::data_type OperandType(OneDnnMatMulType type) {
+  return type == OneDnnMatMulType::kS8S32 ? memory::data_type::s8
+                                          : memory::data_type::bf16;
+}
+
+memory::data_type ResultType(OneDnnMatMulType type) {
+  switch (type) {
+    case OneDnnMatMulType::kBF16:
+      return memory::data_type::bf16;
+    case OneDnnMatMulType::kBF16F32:
+      return memory::data_type::f32;
+    case OneDnnMatMulType::kS8S32:
+      return memory::data_type::s32;
+  }
+  return memory::data_type::undef;
+}
+
+// Returns the descriptors of the row-major operands of the matmul, given the
+// transposes of the operands.
+memory::desc LhsDesc(const OneDnnMatMulParams& params) {
+  return memory::desc({params.m, params.k}, OperandType(params.type),
+                      params.transpose_lhs ? memory::dims{1, params.m}
+                                           : memory::dims{params.k, 1});
+}
+
+memory::desc RhsDesc(const OneDnnMatMulParams& params) {
+  return memory::desc({params.k, params.n}, OperandType(params.type),
+                      params.transpose_rhs ? memory::dims{1, params.k}
+                                           : memory::dims{params.n, 1});
+}
+
+memory::desc ResultDesc(const OneDnnMatMulParams& params) {
+  return memory::desc({params.m, params.n}, ResultType(params.type),
+                      memory::format_tag::ab);
+}
+
+// The matmul primitives for the weights in their own format and in the format
+// oneDNN picks, which are expensive enough to create that they are cached
+// across calls.
+struct OneDnnMatMul {
+  std::unique_ptr<matmul> plain;
+  std::unique_ptr<matmul> packed;
+  memory::desc packed_rhs_desc;
+};
+
+const OneDnnMatMul& GetOneDnnMatMul(const OneDnnMatMulParams& params) {
+  using Key = decltype(params.Key());
+  static std::mutex* mu = new std::mutex;
+  static auto* matmuls = new std::map<Key, std::unique_ptr<OneDnnMatMul>>;
+
+  std::lock_guard<std::mutex> lock(*mu);
+  std::unique_ptr<OneDnnMatMul>& entry = (*matmuls)[params.Key()];
+  if (entry == nullptr) {
+    entry = std::make_unique<OneDnnMatMul>();
+    matmul::primitive_desc plain_desc(
+        matmul::desc(LhsDesc(params), RhsDesc(params), ResultDesc(params)),
+        CpuEngine());
+    entry->plain = std::make_unique<matmul>(plain_desc);
+    matmul::primitive_desc packed_desc(
+        matmul::desc(LhsDesc(params),
+                     memory::desc({params.k, params.n},
+                                  OperandType(params.type),
+                                  memory::format_tag::any),
+                     ResultDesc(params)),
+        CpuEngine());
+    entry->packed = std::make_unique<matmul>(packed_desc);
+    entry->packed_rhs_desc = packed_desc.weights_desc();
+  }
+  return *entry;
+}
+
+void OneDnnMatMulImpl(const void* run_options_ptr,
+                      const OneDnnMatMulParams& params, void* out, void* lhs,
+                      void* rhs, const void* packed_rhs,
+                      int32_t multi_threaded) {
+  const OneDnnMatMul& cached = GetOneDnnMatMul(params);
+
+  const matmul* primitive = cached.plain.get();
+  memory::desc rhs_desc = RhsDesc(params);
+  if (packed_rhs != nullptr &&
+      std::memcmp(packed_rhs, &cached.packed_rhs_desc.data,
+                  sizeof(dnnl_memory_desc_t)) == 0) {
+    // The weights were packed at compile time for the format of this CPU.
+    primitive = cached.packed.get();
+    rhs_desc = cached.packed_rhs_desc;
+    rhs = const_cast<char*>(static_cast<const char*>(packed_rhs) +
+                            kPackedWeightsOffset);
+  }
+
+  memory lhs_memory(LhsDesc(params), CpuEngine(), lhs);
+  memory rhs_memory(rhs_desc, CpuEngine(), rhs);
+  memory out_memory(ResultDesc(params), CpuEngine(), out);
+
+#if DNNL_CPU_THREADING_RUNTIME == DNNL_RUNTIME_THREADPOOL
+  const xla::ExecutableRunOptions* run_options =
+      static_cast<const xla::ExecutableRunOptions*>(run_options_ptr);
+  std::unique_ptr<EigenThreadPool> thread_pool;
+  if (multi_threaded && run_options != nullptr &&
+      run_options->intra_op_thread_pool() != nullptr) {
+    thread_pool =
+        std::make_unique<EigenThreadPool>(run_options->intra_op_thread_pool());
+  }
+  stream matmul_stream =
+      thread_pool != nullptr
+          ? dnnl::threadpool_interop::make_stream(CpuEngine(),
+                                                  thread_pool.get())
+          : stream(CpuEngine());
+#else
+  stream matmul_stream(CpuEngine());
+#endif  // DNNL_CPU_THREADING_RUNTIME == DNNL_RUNTIME_THREADPOOL
+  primitive->execute(matmul_stream, {{DNNL_ARG_SRC, lhs_memory},
+                                     {DNNL_ARG_WEIGHTS, rhs_memory},
+                                     {DNNL_ARG_DST, out_memory}});
+  matmul_stream.wait();
+}
+
+}  // namespace
+
+namespace xla {
+namespace cpu {
+
+bool OneDnnMatMulIsSupported(OneDnnMatMulType type) {
+  static const auto* supported = [] {
+    auto* supported = new std::map<OneDnnMatMulType, bool>;
+    for (OneDnnMatMulType type :
+         {OneDnnMatMulType::kBF16, OneDnnMatMulType::kBF16F32,
+          OneDnnMatMulType::kS8S32}) {
+      const OneDnnMatMulParams params{type, 16, 16, 16, false, false};
+      matmul::primitive_desc desc(
+          matmul::desc(LhsDesc(params), RhsDesc(params), ResultDesc(params)),
+          CpuEngine(), /*allow_empty=*/true);
+      (*supported)[type] = desc.get(/*allow_empty=*/true) != nullptr;
+    }
+    return supported;
+  }();
+  return supported->at(type);
+}
+
+std::vector<char> OneDnnPackMatMulWeights(OneDnnMatMulType type, int64_t m,
+                                          int64_t n, int64_t k,
+                                          bool transpose_lhs,
+                                          bool transpose_rhs,
+                                          const void* rhs) {
+  const OneDnnMatMulParams params{type, m, n, k, transpose_lhs, transpose_rhs};
+  const OneDnnMatMul& cached = GetOneDnnMatMul(params);
+  if (cached.packed_rhs_desc == RhsDesc(params)) return {};
+
+  std::vector<char> packed(kPackedWeightsOffset +
+                           cached.packed_rhs_desc.get_size());
+  std::memcpy(packed.data(), &cached.packed_rhs_desc.data,
+              sizeof(dnnl_memory_desc_t));
+  memory rhs_memory(RhsDesc(params), CpuEngine(), const_cast<void*>(rhs));
+  memory packed_memory(cached.packed_rhs_desc, CpuEngine(),
+                       packed.data() + kPackedWeightsOffset);
+  stream reorder_stream(CpuEngine());
+  dnnl::reorder(rhs_memory, packed_memory)
+      .execute(reorder_stream, rhs_memory, packed_memory);
+  reorder_stream.wait();
+  return packed;
+}
+
+}  // namespace cpu
+}  // namespace xla
+
+ABSL_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_OneDnnMatMulBF16(
+    const void* run_options_ptr, Eigen::bfloat16* out, Eigen::bfloat16* lhs,
+    Eigen::bfloat16* rhs, int64_t m, int64_t n, int64_t k,
+    int32_t transpose_lhs, int32_t transpose_rhs, const void* packed_rhs,
+    int32_t multi_threaded) {
+  OneDnnMatMulImpl(run_options_ptr,
+                   {OneDnnMatMulType::kBF16, m, n, k, transpose_lhs != 0,
+                    transpose_rhs != 0},
+                   out, lhs, rhs, packed_rhs, multi_threaded);
+}
+
+ABSL_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_OneDnnMatMulBF16F32(
+    const void* run_options_ptr, float* out, Eigen::bfloat16* lhs,
+    Eigen::bfloat16* rhs, int64_t m, int64_t n, int64_t k,
+    int32_t transpose_lhs, int32_t transpose_rhs, const void* packed_rhs,
+    int32_t multi_threaded) {
+  OneDnnMatMulImpl(run_options_ptr,
+                   {OneDnnMatMulType::kBF16F32, m, n, k, transpose_lhs != 0,
+                    transpose_rhs != 0},
+                   out, lhs, rhs, packed_rhs, multi_threaded);
+}
+
+ABSL_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_OneDnnMatMulS8S32(
+    const void* run_options_ptr, int32_t* out, int8_t* lhs, int8_t* rhs,
+    int64_t m, int64_t n, int64_t k, int32_t transpose_lhs,
+    int32_t transpose_rhs, const void* packed_rhs, int32_t multi_threaded) {
+  OneDnnMatMulImpl(run_options_ptr,
+                   {OneDnnMatMulType::kS8S32, m, n, k, transpose_lhs != 0,
+                    transpose_rhs != 0},
+                   out, lhs, rhs, packed_rhs, multi_threaded);
+}
 #endif  // ENABLE_MKL
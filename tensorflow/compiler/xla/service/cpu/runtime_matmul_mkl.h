@@ -16,7 +16,11 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_XLA_SERVICE_CPU_RUNTIME_MATMUL_MKL_H_
 #define TENSORFLOW_COMPILER_XLA_SERVICE_CPU_RUNTIME_MATMUL_MKL_H_
 
+#include <cstdint>
 #include <iostream>
+#include <vector>
+
+#include "third_party/eigen3/Eigen/Core"
 
 #ifdef ENABLE_MKL
 #include "third_party/intel_mkl_ml/include/mkl_cblas.h"
@@ -38,6 +42,49 @@ extern void __xla_cpu_runtime_MKLSingleThreadedMatMulF64(
     double* lhs, double* rhs, int64_t m, int64_t n, int64_t k,
     int32_t transpose_lhs, int32_t transpose_rhs);
 
+// Performs the row-major matrix multiplication out[m, n] = lhs[m, k] x
+// rhs[k, n] with oneDNN, which uses the AMX or AVX-512 instructions of the CPU
+// when available. 'lhs' ('rhs') is stored as [k, m] ([n, k]) if
+// 'transpose_lhs' ('transpose_rhs') is set. 'packed_rhs' is null or the result
+// of xla::cpu::OneDnnPackMatMulWeights for the same matmul, which is used in
+// place of 'rhs' when it is in the format oneDNN picks at run time.
+extern void __xla_cpu_runtime_OneDnnMatMulBF16(
+    const void* /* xla::ExecutableRunOptions* */ run_options_ptr,
+    Eigen::bfloat16* out, Eigen::bfloat16* lhs, Eigen::bfloat16* rhs,
+    int64_t m, int64_t n, int64_t k, int32_t transpose_lhs,
+    int32_t transpose_rhs, const void* packed_rhs, int32_t multi_threaded);
+extern void __xla_cpu_runtime_OneDnnMatMulBF16F32(
+    const void* /* xla::ExecutableRunOptions* */ run_options_ptr,
+    float* out, Eigen::bfloat16* lhs, Eigen::bfloat16* rhs, int64_t m,
+    int64_t n, int64_t k, int32_t transpose_lhs, int32_t transpose_rhs,
+    const void* packed_rhs, int32_t multi_threaded);
+extern void __xla_cpu_runtime_OneDnnMatMulS8S32(
+    const void* /* xla::ExecutableRunOptions* */ run_options_ptr,
+    int32_t* out, int8_t* lhs, int8_t* rhs, int64_t m, int64_t n, int64_t k,
+    int32_t transpose_lhs, int32_t transpose_rhs, const void* packed_rhs,
+    int32_t multi_threaded);
+
+namespace xla {
+namespace cpu {
+
+// The element types of the operands and the result of the oneDNN matmuls.
+enum class OneDnnMatMulType { kBF16, kBF16F32, kS8S32 };
+
+// Returns true if oneDNN implements the matmuls of the given type on this CPU.
+bool OneDnnMatMulIsSupported(OneDnnMatMulType type);
+
+// Reorders the weights 'rhs' of the oneDNN matmul with the given parameters
+// into the blocked format oneDNN prefers on this CPU, so that the reorder of
+// constant weights happens at compile time instead of at each call. Returns an
+// empty vector if the matmul is as fast with the weights as they are.
+std::vector<char> OneDnnPackMatMulWeights(OneDnnMatMulType type, int64_t m,
+                                          int64_t n, int64_t k,
+                                          bool transpose_lhs,
+                                          bool transpose_rhs, const void* rhs);
+
+}  // namespace cpu
+}  // namespace xla
+
 #else
 extern void __xla_cpu_runtime_MKLMatMulF32(
     const void* /* xla::ExecutableRunOptions* */ run_options_ptr, float* out,
@@ -71,6 +118,33 @@ extern void __xla_cpu_runtime_MKLSingleThreadedMatMulF64(
                "ENABLE_MKL. Add --config=mkl to build with MKL.";
   exit(1);
 }
+extern void __xla_cpu_runtime_OneDnnMatMulBF16(
+    const void* /* xla::ExecutableRunOptions* */ run_options_ptr,
+    Eigen::bfloat16* out, Eigen::bfloat16* lhs, Eigen::bfloat16* rhs,
+    int64_t m, int64_t n, int64_t k, int32_t transpose_lhs,
+    int32_t transpose_rhs, const void* packed_rhs, int32_t multi_threaded) {
+  std::cerr << "Attempt to call oneDNN MatMul runtime library without "
+               "defining ENABLE_MKL. Add --config=mkl to build with MKL.";
+  exit(1);
+}
+extern void __xla_cpu_runtime_OneDnnMatMulBF16F32(
+    const void* /* xla::ExecutableRunOptions* */ run_options_ptr,
+    float* out, Eigen::bfloat16* lhs, Eigen::bfloat16* rhs, int64_t m,
+    int64_t n, int64_t k, int32_t transpose_lhs, int32_t transpose_rhs,
+    const void* packed_rhs, int32_t multi_threaded) {
+  std::cerr << "Attempt to call oneDNN MatMul runtime library without "
+               "defining ENABLE_MKL. Add --config=mkl to build with MKL.";
+  exit(1);
+}
+extern void __xla_cpu_runtime_OneDnnMatMulS8S32(
+    const void* /* xla::ExecutableRunOptions* */ run_options_ptr,
+    int32_t* out, int8_t* lhs, int8_t* rhs, int64_t m, int64_t n, int64_t k,
+    int32_t transpose_lhs, int32_t transpose_rhs, const void* packed_rhs,
+    int32_t multi_threaded) {
+  std::cerr << "Attempt to call oneDNN MatMul runtime library without "
+               "defining ENABLE_MKL. Add --config=mkl to build with MKL.";
+  exit(1);
+}
 
 #endif  // ENABLE_MKL
 #endif  // TENSORFLOW_COMPILER_XLA_SERVICE_CPU_RUNTIME_MATMUL_MKL_H_
@@ -300,6 +300,9 @@ bool RegisterKnownJITSymbols() {
   REGISTER_CPU_RUNTIME_SYMBOL(MKLMatMulF64);
   REGISTER_CPU_RUNTIME_SYMBOL(MKLSingleThreadedMatMulF32);
   REGISTER_CPU_RUNTIME_SYMBOL(MKLSingleThreadedMatMulF64);
+  REGISTER_CPU_RUNTIME_SYMBOL(OneDnnMatMulBF16);
+  REGISTER_CPU_RUNTIME_SYMBOL(OneDnnMatMulBF16F32);
+  REGISTER_CPU_RUNTIME_SYMBOL(OneDnnMatMulS8S32);
   REGISTER_CPU_RUNTIME_SYMBOL(ACLMatMulF32);
   REGISTER_CPU_RUNTIME_SYMBOL(ACLBatchMatMulF32);
   REGISTER_CPU_RUNTIME_SYMBOL(ACLConv2DF32);
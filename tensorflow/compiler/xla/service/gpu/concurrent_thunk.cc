@@ -0,0 +1,325 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/concurrent_thunk.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/const_init.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "mlir/IR/BuiltinTypes.h"  // from @llvm-project
+#include "mlir/IR/Operation.h"  // from @llvm-project
+#include "mlir/Interfaces/SideEffectInterfaces.h"  // from @llvm-project
+#include "tensorflow/compiler/xla/mlir_hlo/lhlo/IR/lhlo_ops.h"
+#include "tensorflow/compiler/xla/service/gpu/conditional_thunk.h"
+#include "tensorflow/compiler/xla/service/gpu/for_thunk.h"
+#include "tensorflow/compiler/xla/service/gpu/ir_emission_utils.h"
+#include "tensorflow/compiler/xla/service/gpu/kernel_thunk.h"
+#include "tensorflow/compiler/xla/service/gpu/sequential_thunk.h"
+#include "tensorflow/compiler/xla/service/gpu/while_thunk.h"
+#include "tensorflow/compiler/xla/status_macros.h"
+#include "tensorflow/compiler/xla/util.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/logging.h"
+#include "tensorflow/tsl/profiler/lib/scoped_annotation.h"
+
+namespace xla {
+namespace gpu {
+
+using ::tsl::profiler::ScopedAnnotation;
+
+namespace {
+
+// The streams shared by all the ConcurrentThunks of a StreamExecutor. The
+// mutex is held while a ConcurrentThunk enqueues its sub-thunks, so that the
+// concurrent thunks of executions running on different host threads don't
+// interleave on the streams.
+struct ConcurrentStreams {
+  absl::Mutex mutex;
+  std::vector<std::unique_ptr<se::Stream>> streams ABSL_GUARDED_BY(mutex);
+};
+
+ConcurrentStreams* GetConcurrentStreams(se::StreamExecutor* executor) {
+  static absl::Mutex mutex(absl::kConstInit);
+  static auto* streams_by_executor =
+      new absl::flat_hash_map<se::StreamExecutor*,
+                              std::unique_ptr<ConcurrentStreams>>();
+  absl::MutexLock lock(&mutex);
+  std::unique_ptr<ConcurrentStreams>& streams =
+      (*streams_by_executor)[executor];
+  if (streams == nullptr) {
+    streams = std::make_unique<ConcurrentStreams>();
+  }
+  return streams.get();
+}
+
+}  // namespace
+
+ConcurrentThunk::ConcurrentThunk(ThunkInfo thunk_info, ThunkSequence thunks)
+    : Thunk(Kind::kConcurrent, thunk_info), thunks_(std::move(thunks)) {}
+
+std::string ConcurrentThunk::ToStringExtra(int indent) const {
+  std::string result = "\n";
+  absl::StrAppend(&result, thunks().ToString(indent + 1, nullptr));
+  return result;
+}
+
+Status ConcurrentThunk::Initialize(const GpuExecutable& executable,
+                                   se::StreamExecutor* executor) {
+  for (auto& thunk : thunks_) {
+    TF_RETURN_IF_ERROR(thunk->Initialize(executable, executor));
+  }
+
+  // The first sub-thunk runs on the execution stream.
+  ConcurrentStreams* concurrent_streams = GetConcurrentStreams(executor);
+  absl::MutexLock lock(&concurrent_streams->mutex);
+  while (concurrent_streams->streams.size() + 1 < thunks_.size()) {
+    auto stream = std::make_unique<se::Stream>(executor);
+    stream->Init();
+    if (!stream->ok()) {
+      return InternalError("Failed to create a stream for concurrent thunks");
+    }
+    concurrent_streams->streams.push_back(std::move(stream));
+  }
+  return OkStatus();
+}
+
+Status ConcurrentThunk::ExecuteOnStream(const ExecuteParams& params) {
+  ConcurrentStreams* concurrent_streams =
+      GetConcurrentStreams(params.stream->parent());
+  absl::MutexLock lock(&concurrent_streams->mutex);
+  TF_RET_CHECK(concurrent_streams->streams.size() + 1 >= thunks_.size())
+      << "Initialize() not called for StreamExecutor "
+      << params.stream->parent();
+
+  for (int64_t i = 0; i < thunks_.size(); ++i) {
+    ExecuteParams thunk_params = params;
+    if (i > 0) {
+      thunk_params.stream = concurrent_streams->streams[i - 1].get();
+      thunk_params.stream->ThenWaitFor(params.stream);
+    }
+    ScopedAnnotation annotation(
+        [&] { return thunks_[i]->profile_annotation(); });
+    TF_RETURN_IF_ERROR(thunks_[i]->ExecuteOnStream(thunk_params));
+  }
+  for (int64_t i = 1; i < thunks_.size(); ++i) {
+    params.stream->ThenWaitFor(concurrent_streams->streams[i - 1].get());
+  }
+  return OkStatus();
+}
+
+namespace {
+
+// cuBLAS computes a tile of the output with each thread block, so that each of
+// its threads computes many output elements.
+constexpr int64_t kGemmOutputElementsPerThread = 64;
+
+// The buffer slices that a thunk reads and writes, and the fraction of the
+// threads that the GPU can keep resident that the thunk uses.
+struct ThunkUses {
+  std::vector<BufferAllocation::Slice> reads;
+  std::vector<BufferAllocation::Slice> writes;
+  float utilization = 1.f;
+};
+
+bool Overlap(absl::Span<const BufferAllocation::Slice> a,
+             absl::Span<const BufferAllocation::Slice> b) {
+  for (const BufferAllocation::Slice& a_slice : a) {
+    for (const BufferAllocation::Slice& b_slice : b) {
+      if (a_slice.OverlapsWith(b_slice)) return true;
+    }
+  }
+  return false;
+}
+
+// Returns whether the thunks of `a` and `b` must run in order.
+bool Conflict(const ThunkUses& a, const ThunkUses& b) {
+  return Overlap(a.writes, b.reads) || Overlap(a.writes, b.writes) ||
+         Overlap(a.reads, b.writes);
+}
+
+// Returns the uses of `thunk`, or nullopt if the thunk can't run concurrently
+// with other thunks, or if its uses can't be derived from its op.
+std::optional<ThunkUses> GetThunkUses(
+    Thunk* thunk, absl::Span<const BufferAllocation> allocations,
+    const GpuDeviceInfo& gpu_device_info) {
+  if (thunk->kind() != Thunk::kKernel && thunk->kind() != Thunk::kGemm) {
+    return std::nullopt;
+  }
+  mlir::Operation* op = thunk->op();
+  if (op == nullptr) return std::nullopt;
+
+  ThunkUses uses;
+  int64_t num_output_elements = 0;
+  auto add_use = [&](mlir::Value value, bool written) {
+    auto type = value.getType().dyn_cast<mlir::MemRefType>();
+    if (!type) return true;
+    if (!type.hasStaticShape()) return false;
+    StatusOr<BufferAllocation::Slice> slice =
+        GetAllocationSlice(value, allocations);
+    if (!slice.ok()) return false;
+    if (written) {
+      uses.writes.push_back(*slice);
+      num_output_elements =
+          std::max<int64_t>(num_output_elements, type.getNumElements());
+    } else {
+      uses.reads.push_back(*slice);
+    }
+    return true;
+  };
+  if (auto fusion = mlir::dyn_cast<mlir::lmhlo::FusionOp>(op)) {
+    for (mlir::Value value : fusion.getInputBuffers()) {
+      if (!add_use(value, /*written=*/false)) return std::nullopt;
+    }
+    for (mlir::Value value : fusion.getOutputBuffers()) {
+      if (!add_use(value, /*written=*/true)) return std::nullopt;
+    }
+  } else if (mlir::isa<mlir::MemoryEffectOpInterface>(op)) {
+    for (mlir::Value value : op->getOperands()) {
+      if (!add_use(value, WritesMlirBuffer(op, value))) return std::nullopt;
+    }
+  } else {
+    return std::nullopt;
+  }
+
+  int64_t num_threads =
+      thunk->kind() == Thunk::kKernel
+          ? static_cast<KernelThunk*>(thunk)->launch_dimensions().launch_bound()
+          : CeilOfRatio(num_output_elements, kGemmOutputElementsPerThread);
+  float resident_threads = static_cast<float>(gpu_device_info.core_count) *
+                           gpu_device_info.threads_per_core_limit;
+  uses.utilization =
+      resident_threads > 0 ? num_threads / resident_threads : 1.f;
+  return uses;
+}
+
+// Appends the thunks of `run`, which all have uses, to `outlined`, and wraps
+// the ones that can run concurrently into ConcurrentThunks.
+void AssignRun(ThunkSequence run, const std::vector<ThunkUses>& uses,
+               int64_t max_streams, ThunkSequence* outlined) {
+  // The level of a thunk is the length of the longest chain of thunks of the
+  // run that it depends on, so the thunks of a level are independent, and only
+  // depend on the thunks of the previous levels.
+  std::vector<std::vector<int64_t>> levels;
+  std::vector<int64_t> level_of(run.size(), 0);
+  for (int64_t i = 0; i < run.size(); ++i) {
+    for (int64_t j = 0; j < i; ++j) {
+      if (Conflict(uses[i], uses[j])) {
+        level_of[i] = std::max(level_of[i], level_of[j] + 1);
+      }
+    }
+    if (level_of[i] == levels.size()) levels.emplace_back();
+    levels[level_of[i]].push_back(i);
+  }
+
+  // Within a level, the thunks are packed greedily into groups that don't
+  // need more threads than the GPU can keep resident.
+  for (const std::vector<int64_t>& level : levels) {
+    ThunkSequence group;
+    float group_utilization = 0;
+    auto flush_group = [&]() {
+      if (group.size() == 1) {
+        outlined->push_back(std::move(group.front()));
+      } else if (group.size() > 1) {
+        VLOG(2) << "Run " << group.size() << " thunks concurrently";
+        Thunk::ThunkInfo thunk_info(/*op=*/nullptr);
+        thunk_info.profile_annotation =
+            absl::StrCat("Concurrent:", group.front()->profile_annotation());
+        outlined->push_back(std::make_unique<ConcurrentThunk>(
+            std::move(thunk_info), std::move(group)));
+      }
+      group = ThunkSequence();
+      group_utilization = 0;
+    };
+    for (int64_t i : level) {
+      if (!group.empty() &&
+          (group.size() >= max_streams ||
+           group_utilization + uses[i].utilization > 1.f)) {
+        flush_group();
+      }
+      group_utilization += uses[i].utilization;
+      group.push_back(std::move(run[i]));
+    }
+    flush_group();
+  }
+}
+
+}  // namespace
+
+void AssignConcurrentStreams(ThunkSequence* thunk_sequence,
+                             absl::Span<const BufferAllocation> allocations,
+                             const GpuDeviceInfo& gpu_device_info,
+                             int64_t max_streams) {
+  ThunkSequence outlined;
+  ThunkSequence run;
+  std::vector<ThunkUses> run_uses;
+  auto flush_run = [&]() {
+    if (!run.empty()) {
+      AssignRun(std::move(run), run_uses, max_streams, &outlined);
+    }
+    run = ThunkSequence();
+    run_uses.clear();
+  };
+
+  for (std::unique_ptr<Thunk>& thunk : *thunk_sequence) {
+    if (std::optional<ThunkUses> uses =
+            GetThunkUses(thunk.get(), allocations, gpu_device_info)) {
+      run.push_back(std::move(thunk));
+      run_uses.push_back(*std::move(uses));
+      continue;
+    }
+    flush_run();
+
+    if (thunk->kind() == Thunk::kConditional) {
+      auto* cond_thunk = static_cast<ConditionalThunk*>(thunk.get());
+      for (const std::unique_ptr<SequentialThunk>& branch_thunks :
+           cond_thunk->branch_thunks()) {
+        AssignConcurrentStreams(&branch_thunks->thunks(), allocations,
+                                gpu_device_info, max_streams);
+      }
+    } else if (thunk->kind() == Thunk::kFor) {
+      auto* for_thunk = static_cast<ForThunk*>(thunk.get());
+      AssignConcurrentStreams(&for_thunk->body_thunk_sequence()->thunks(),
+                              allocations, gpu_device_info, max_streams);
+    } else if (thunk->kind() == Thunk::kSequential) {
+      auto* sequential_thunk = static_cast<SequentialThunk*>(thunk.get());
+      AssignConcurrentStreams(&sequential_thunk->thunks(), allocations,
+                              gpu_device_info, max_streams);
+    } else if (thunk->kind() == Thunk::kWhile) {
+      auto* while_thunk = static_cast<WhileThunk*>(thunk.get());
+      AssignConcurrentStreams(
+          &while_thunk->condition_thunk_sequence()->thunks(), allocations,
+          gpu_device_info, max_streams);
+      AssignConcurrentStreams(&while_thunk->body_thunk_sequence()->thunks(),
+                              allocations, gpu_device_info, max_streams);
+    }
+    outlined.push_back(std::move(thunk));
+  }
+  flush_run();
+
+  *thunk_sequence = std::move(outlined);
+}
+
+}  // namespace gpu
+}  // namespace xla
@@ -0,0 +1,82 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_GPU_CONCURRENT_THUNK_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_GPU_CONCURRENT_THUNK_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/service/buffer_assignment.h"
+#include "tensorflow/compiler/xla/service/gpu/gpu_device_info.h"
+#include "tensorflow/compiler/xla/service/gpu/thunk.h"
+#include "tensorflow/compiler/xla/stream_executor/stream_executor.h"
+
+namespace xla {
+namespace gpu {
+
+// A thunk that runs independent sub-thunks concurrently, each one on its own
+// stream. The first sub-thunk runs on the stream the thunk is executed on, and
+// the others on streams shared by all the concurrent thunks of the
+// StreamExecutor. These streams first wait for the work already enqueued on
+// the execution stream, and the execution stream then waits for all of them,
+// so the thunks before and after a ConcurrentThunk are ordered with all its
+// sub-thunks.
+//
+// The sub-thunks must not depend on each other, i.e. no sub-thunk may write a
+// buffer that another one reads or writes.
+class ConcurrentThunk : public Thunk {
+ public:
+  ConcurrentThunk(ThunkInfo thunk_info, ThunkSequence thunks);
+  ConcurrentThunk(const ConcurrentThunk&) = delete;
+  ConcurrentThunk& operator=(const ConcurrentThunk&) = delete;
+
+  ThunkSequence& thunks() { return thunks_; }
+  const ThunkSequence& thunks() const { return thunks_; }
+  std::string ToStringExtra(int indent) const override;
+
+  Status Initialize(const GpuExecutable& executable,
+                    se::StreamExecutor* executor) override;
+  Status ExecuteOnStream(const ExecuteParams& params) override;
+
+ private:
+  // The sub-thunks, which run concurrently.
+  ThunkSequence thunks_;
+};
+
+// Reorders the thunks of `thunk_sequence` that are kernel launches or GEMMs,
+// and wraps the independent ones into ConcurrentThunks of at most
+// `max_streams` sub-thunks.
+//
+// The dependencies between the thunks are derived from the buffer slices that
+// their LMHLO ops read and write, so this must run before the compile time
+// info of the thunks is cleared. The other thunks, e.g. the control flow and
+// the collectives, are barriers that no thunk is moved across; the thunk
+// sequences nested in the control flow thunks are assigned streams as well.
+//
+// Only thunks that underutilize the GPU are run concurrently: the number of
+// threads of each one is estimated from its launch dimensions or output size,
+// and the thunks of a ConcurrentThunk may use at most all the threads the GPU
+// of `gpu_device_info` can keep resident, so that they don't oversubscribe it.
+void AssignConcurrentStreams(ThunkSequence* thunk_sequence,
+                             absl::Span<const BufferAllocation> allocations,
+                             const GpuDeviceInfo& gpu_device_info,
+                             int64_t max_streams);
+
+}  // namespace gpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_GPU_CONCURRENT_THUNK_H_
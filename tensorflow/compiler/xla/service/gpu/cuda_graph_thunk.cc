@@ -0,0 +1,266 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/cuda_graph_thunk.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/algorithm/container.h"
+#include "absl/hash/hash.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/service/gpu/buffer_allocations.h"
+#include "tensorflow/compiler/xla/service/gpu/conditional_thunk.h"
+#include "tensorflow/compiler/xla/service/gpu/for_thunk.h"
+#include "tensorflow/compiler/xla/service/gpu/sequential_thunk.h"
+#include "tensorflow/compiler/xla/service/gpu/while_thunk.h"
+#include "tensorflow/compiler/xla/util.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/logging.h"
+#include "tensorflow/tsl/profiler/lib/scoped_annotation.h"
+
+#if GOOGLE_CUDA
+#include "tensorflow/compiler/xla/stream_executor/cuda/cuda_graph.h"
+#endif  // #if GOOGLE_CUDA
+
+namespace xla {
+namespace gpu {
+
+using ::tsl::profiler::ScopedAnnotation;
+
+#if GOOGLE_CUDA
+
+// Instantiated CUDA graph of the sub-thunks for a StreamExecutor. All the
+// fields are guarded by `mutex`, because the graph instance might have to be
+// updated concurrently.
+struct CudaGraphThunk::GraphInstance {
+  absl::Mutex mutex;
+
+  // The graph is captured on a dedicated stream, so that work enqueued
+  // concurrently on the execution streams is never recorded in the graph.
+  std::unique_ptr<se::Stream> capture_stream;
+
+  // The hash of the addresses of the buffer allocations that the graph was
+  // captured with.
+  size_t ptrs_hash = 0;
+  se::gpu::OwnedCudaGraphExec exec;
+
+  // Set if the graph couldn't be captured, in which case the sub-thunks are
+  // always run directly.
+  bool disabled = false;
+};
+
+#else  // #if !GOOGLE_CUDA
+
+struct CudaGraphThunk::GraphInstance {};
+
+#endif  // #if GOOGLE_CUDA
+
+CudaGraphThunk::CudaGraphThunk(ThunkInfo thunk_info, ThunkSequence thunks)
+    : Thunk(Kind::kCudaGraph, thunk_info), thunks_(std::move(thunks)) {}
+
+CudaGraphThunk::~CudaGraphThunk() = default;
+
+std::string CudaGraphThunk::ToStringExtra(int indent) const {
+  std::string result = "\n";
+  absl::StrAppend(&result, thunks().ToString(indent + 1, nullptr));
+  return result;
+}
+
+Status CudaGraphThunk::Initialize(const GpuExecutable& executable,
+                                  se::StreamExecutor* executor) {
+  for (auto& thunk : thunks_) {
+    TF_RETURN_IF_ERROR(thunk->Initialize(executable, executor));
+  }
+
+  absl::MutexLock lock(&mutex_);
+  if (graphs_.contains(executor)) return OkStatus();
+  auto instance = std::make_unique<GraphInstance>();
+#if GOOGLE_CUDA
+  instance->capture_stream = std::make_unique<se::Stream>(executor);
+  instance->capture_stream->Init();
+  if (!instance->capture_stream->ok()) {
+    return InternalError("Failed to create a stream for CUDA graph capture");
+  }
+#endif  // #if GOOGLE_CUDA
+  graphs_.emplace(executor, std::move(instance));
+  return OkStatus();
+}
+
+Status CudaGraphThunk::ExecuteThunks(const ExecuteParams& params) {
+  for (const auto& thunk : thunks_) {
+    ScopedAnnotation annotation([&] { return thunk->profile_annotation(); });
+    TF_RETURN_IF_ERROR(thunk->ExecuteOnStream(params));
+  }
+  return OkStatus();
+}
+
+#if GOOGLE_CUDA
+
+// Returns the hash of the addresses of all the buffer allocations. The thunks
+// are launched with the same addresses, and can be replayed from the same
+// graph, as long as the hash doesn't change.
+static size_t HashBufferAddresses(const BufferAllocations& allocations) {
+  size_t hash = 0;
+  for (BufferAllocation::Index i = 0; i < allocations.size(); ++i) {
+    hash = absl::HashOf(hash, allocations.GetDeviceAddress(i).opaque());
+  }
+  return hash;
+}
+
+#endif  // #if GOOGLE_CUDA
+
+Status CudaGraphThunk::ExecuteOnStream(const ExecuteParams& params) {
+#if GOOGLE_CUDA
+  GraphInstance* instance = nullptr;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = graphs_.find(params.stream->parent());
+    CHECK(it != graphs_.end())
+        << "Initialize() not called for StreamExecutor "
+        << params.stream->parent();
+    instance = it->second.get();
+  }
+
+  absl::MutexLock lock(&instance->mutex);
+  if (instance->disabled) return ExecuteThunks(params);
+
+  // If the buffers didn't move we can launch the cached graph.
+  size_t ptrs_hash = HashBufferAddresses(*params.buffer_allocations);
+  if (instance->exec != nullptr && ptrs_hash == instance->ptrs_hash) {
+    VLOG(3) << "Launch cached CUDA graph";
+    return instance->exec.Launch(params.stream);
+  }
+
+  ExecuteParams capture_params = params;
+  capture_params.stream = instance->capture_stream.get();
+  auto capture = [&]() {
+    return se::gpu::CaptureCudaGraph(
+        capture_params.stream, [&]() { return ExecuteThunks(capture_params); });
+  };
+
+  // Otherwise capture the graph again with the new buffers, and update the
+  // graph instance, or instantiate a new one if the update isn't possible.
+  Status status = [&]() -> Status {
+    if (instance->exec != nullptr) {
+      VLOG(3) << "Update cached CUDA graph instance";
+      TF_ASSIGN_OR_RETURN(se::gpu::OwnedCudaGraph graph, capture());
+      Status updated = instance->exec.Update(std::move(graph));
+      if (updated.ok()) return OkStatus();
+      VLOG(3) << "Failed to update CUDA graph instance: " << updated;
+    }
+    VLOG(3) << "Instantiate CUDA graph";
+    TF_ASSIGN_OR_RETURN(se::gpu::OwnedCudaGraph graph, capture());
+    TF_ASSIGN_OR_RETURN(instance->exec,
+                        se::gpu::InstantiateCudaGraph(std::move(graph)));
+    return OkStatus();
+  }();
+
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to capture a CUDA graph, running the thunks "
+                    "directly instead: "
+                 << status;
+    instance->exec = nullptr;
+    instance->disabled = true;
+    return ExecuteThunks(params);
+  }
+  instance->ptrs_hash = ptrs_hash;
+  return instance->exec.Launch(params.stream);
+
+#else  // #if !GOOGLE_CUDA
+
+  return ExecuteThunks(params);
+
+#endif  // #if GOOGLE_CUDA
+}
+
+bool IsCudaGraphCapturable(const Thunk& thunk) {
+  switch (thunk.kind()) {
+    case Thunk::kCopy:
+    case Thunk::kKernel:
+    case Thunk::kMemset32BitValue:
+    case Thunk::kMemzero:
+      return true;
+    case Thunk::kSequential:
+      return absl::c_all_of(
+          static_cast<const SequentialThunk&>(thunk).thunks(),
+          [](const std::unique_ptr<Thunk>& thunk) {
+            return IsCudaGraphCapturable(*thunk);
+          });
+    default:
+      return false;
+  }
+}
+
+void OutlineCudaGraphThunks(ThunkSequence* thunk_sequence,
+                            int64_t min_graph_size) {
+  ThunkSequence outlined;
+  ThunkSequence graph_thunks;
+  auto flush_graph_thunks = [&]() {
+    if (static_cast<int64_t>(graph_thunks.size()) < min_graph_size) {
+      for (std::unique_ptr<Thunk>& thunk : graph_thunks) {
+        outlined.push_back(std::move(thunk));
+      }
+    } else {
+      VLOG(2) << "Outline " << graph_thunks.size()
+              << " thunks into a CUDA graph";
+      Thunk::ThunkInfo thunk_info(/*op=*/nullptr);
+      thunk_info.profile_annotation = absl::StrCat(
+          "CudaGraph:", graph_thunks.front()->profile_annotation());
+      outlined.push_back(std::make_unique<CudaGraphThunk>(
+          std::move(thunk_info), std::move(graph_thunks)));
+    }
+    graph_thunks = ThunkSequence();
+  };
+
+  for (std::unique_ptr<Thunk>& thunk : *thunk_sequence) {
+    if (IsCudaGraphCapturable(*thunk)) {
+      graph_thunks.push_back(std::move(thunk));
+      continue;
+    }
+    flush_graph_thunks();
+
+    if (thunk->kind() == Thunk::kConditional) {
+      auto* cond_thunk = static_cast<ConditionalThunk*>(thunk.get());
+      for (const std::unique_ptr<SequentialThunk>& branch_thunks :
+           cond_thunk->branch_thunks()) {
+        OutlineCudaGraphThunks(&branch_thunks->thunks(), min_graph_size);
+      }
+    } else if (thunk->kind() == Thunk::kFor) {
+      auto* for_thunk = static_cast<ForThunk*>(thunk.get());
+      OutlineCudaGraphThunks(&for_thunk->body_thunk_sequence()->thunks(),
+                             min_graph_size);
+    } else if (thunk->kind() == Thunk::kSequential) {
+      auto* sequential_thunk = static_cast<SequentialThunk*>(thunk.get());
+      OutlineCudaGraphThunks(&sequential_thunk->thunks(), min_graph_size);
+    } else if (thunk->kind() == Thunk::kWhile) {
+      auto* while_thunk = static_cast<WhileThunk*>(thunk.get());
+      OutlineCudaGraphThunks(&while_thunk->condition_thunk_sequence()->thunks(),
+                             min_graph_size);
+      OutlineCudaGraphThunks(&while_thunk->body_thunk_sequence()->thunks(),
+                             min_graph_size);
+    }
+    outlined.push_back(std::move(thunk));
+  }
+  flush_graph_thunks();
+
+  *thunk_sequence = std::move(outlined);
+}
+
+}  // namespace gpu
+}  // namespace xla
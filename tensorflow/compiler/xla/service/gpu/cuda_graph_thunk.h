@@ -0,0 +1,89 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_GPU_CUDA_GRAPH_THUNK_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_GPU_CUDA_GRAPH_THUNK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/compiler/xla/service/gpu/thunk.h"
+#include "tensorflow/compiler/xla/stream_executor/stream_executor.h"
+
+namespace xla {
+namespace gpu {
+
+// A thunk that captures a sequence of sub-thunks into a CUDA graph the first
+// time it runs on a StreamExecutor, and then launches the instantiated graph
+// instead of the individual sub-thunks, which removes the launch overhead of
+// each kernel.
+//
+// The captured graph depends on the addresses of the buffer allocations, so
+// the graph is captured again when the addresses change, and the graph
+// instance is updated in place, which is much cheaper than instantiating a new
+// one. If the graph can't be captured or instantiated, the sub-thunks are run
+// directly.
+//
+// Only the thunks for which IsCudaGraphCapturable returns true can be wrapped.
+class CudaGraphThunk : public Thunk {
+ public:
+  CudaGraphThunk(ThunkInfo thunk_info, ThunkSequence thunks);
+  CudaGraphThunk(const CudaGraphThunk&) = delete;
+  CudaGraphThunk& operator=(const CudaGraphThunk&) = delete;
+  ~CudaGraphThunk() override;
+
+  ThunkSequence& thunks() { return thunks_; }
+  const ThunkSequence& thunks() const { return thunks_; }
+  std::string ToStringExtra(int indent) const override;
+
+  Status Initialize(const GpuExecutable& executable,
+                    se::StreamExecutor* executor) override;
+  Status ExecuteOnStream(const ExecuteParams& params) override;
+
+ private:
+  struct GraphInstance;  // Defined in the .cc, depends on CUDA.
+
+  // Runs the sub-thunks one by one on `params.stream`.
+  Status ExecuteThunks(const ExecuteParams& params);
+
+  // The list of sub-thunks.
+  ThunkSequence thunks_;
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<se::StreamExecutor*, std::unique_ptr<GraphInstance>>
+      graphs_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Returns whether `thunk` only enqueues work on the stream it is executed on,
+// without synchronizing with the host or with other streams, so that it can be
+// captured into a CUDA graph.
+bool IsCudaGraphCapturable(const Thunk& thunk);
+
+// Wraps each maximal run of at least `min_graph_size` consecutive capturable
+// thunks of `thunk_sequence` into a CudaGraphThunk. The thunk sequences nested
+// in the control flow thunks, e.g. the bodies of the while loops, are outlined
+// as well.
+void OutlineCudaGraphThunks(ThunkSequence* thunk_sequence,
+                            int64_t min_graph_size);
+
+}  // namespace gpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_GPU_CUDA_GRAPH_THUNK_H_
@@ -65,9 +65,11 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/batchnorm_expander.h"
 #include "tensorflow/compiler/xla/service/bfloat16_normalization.h"
 #include "tensorflow/compiler/xla/service/bitcast_dtypes_expander.h"
+#include "tensorflow/compiler/xla/service/blockwise_attention_rewriter.h"
 #include "tensorflow/compiler/xla/service/broadcast_canonicalizer.h"
 #include "tensorflow/compiler/xla/service/buffer_assignment.h"
 #include "tensorflow/compiler/xla/service/call_inliner.h"
+#include "tensorflow/compiler/xla/service/collective_matmul_decomposer.h"
 #include "tensorflow/compiler/xla/service/collectives_schedule_linearizer.h"
 #include "tensorflow/compiler/xla/service/comparison_expander.h"
 #include "tensorflow/compiler/xla/service/conditional_canonicalizer.h"
@@ -88,8 +90,10 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/gather_simplifier.h"
 #include "tensorflow/compiler/xla/service/gpu/alias_passthrough_params.h"
 #include "tensorflow/compiler/xla/service/gpu/all_reduce_blueconnect.h"
+#include "tensorflow/compiler/xla/service/gpu/concurrent_thunk.h"
 #include "tensorflow/compiler/xla/service/gpu/conditional_thunk.h"
 #include "tensorflow/compiler/xla/service/gpu/conv_layout_normalization.h"
+#include "tensorflow/compiler/xla/service/gpu/cuda_graph_thunk.h"
 #include "tensorflow/compiler/xla/service/gpu/dot_dimension_sorter.h"
 #include "tensorflow/compiler/xla/service/gpu/for_thunk.h"
 #include "tensorflow/compiler/xla/service/gpu/fusion_merger.h"
@@ -128,8 +132,10 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/gpu/softmax_fusion.h"
 #include "tensorflow/compiler/xla/service/gpu/tree_reduction_rewriter.h"
 #include "tensorflow/compiler/xla/service/gpu/variadic_op_splitter.h"
+#include "tensorflow/compiler/xla/service/gpu/wait_for_parameters_thunk.h"
 #include "tensorflow/compiler/xla/service/gpu/while_thunk.h"
 #include "tensorflow/compiler/xla/service/hlo_computation_deduplicator.h"
+#include "tensorflow/compiler/xla/service/hlo_computation_pass.h"
 #include "tensorflow/compiler/xla/service/hlo_constant_folding.h"
 #include "tensorflow/compiler/xla/service/hlo_cse.h"
 #include "tensorflow/compiler/xla/service/hlo_dataflow_analysis.h"
@@ -366,6 +372,9 @@ Status GpuCompiler::OptimizeHloModule(
   if (gpu_target_config.platform_name == "ROCM")
     layout_insensitive_algsimp_opts.set_enable_conv_operand_swap(false);
 
+  std::unique_ptr<tsl::thread::ThreadPool> computation_thread_pool =
+      CreateComputationThreadPool(*hlo_module);
+
   const int64_t num_partitions = hlo_module->config().num_partitions();
   if (num_partitions > 1) {
     if (!hlo_module->config().use_spmd_partitioning()) {
@@ -419,6 +428,7 @@ Status GpuCompiler::OptimizeHloModule(
 
   {
     HloPassPipeline pipeline("optimization");
+    pipeline.SetComputationThreadPool(computation_thread_pool.get());
     AddHloVerifier(&pipeline);
     pipeline.AddPass<AllToAllDecomposer>();
 
@@ -565,6 +575,14 @@ Status GpuCompiler::OptimizeHloModule(
       pipeline.AddPass<AlgebraicSimplifier>(layout_insensitive_algsimp_opts);
     }();
 
+    // Compute the attentions one block of keys at a time, rather than
+    // materializing the [queries, keys] scores. This must run before the trip
+    // counts of the loops are annotated.
+    if (debug_options.xla_gpu_attention_key_block_size() > 0) {
+      pipeline.AddPass<BlockwiseAttentionRewriter>(
+          debug_options.xla_gpu_attention_key_block_size());
+    }
+
     // Run WhileLoopTripCountAnnotator at the end of the simplification
     // pipeline, before layout assignment and fusion.  This pass does some
     // pattern-matching on while bodies/conditions, and this is where the HLO is
@@ -597,6 +615,18 @@ Status GpuCompiler::OptimizeHloModule(
 
     collectives_pipeline.AddPass<AllGatherBroadcastReorder>();
 
+    if (debug_options.xla_gpu_enable_collective_matmul()) {
+      const GpuDeviceInfo& gpu_device_info = gpu_target_config.gpu_device_info;
+      CollectiveMatmulDecomposer::Options options;
+      options.flops_per_second = 2e9 * gpu_device_info.clock_rate_ghz *
+                                 gpu_device_info.core_count *
+                                 gpu_device_info.fpus_per_core;
+      // Assume the interconnect is an order of magnitude slower than the
+      // device memory.
+      options.bytes_per_second = gpu_device_info.memory_bandwidth / 10.0;
+      collectives_pipeline.AddPass<CollectiveMatmulDecomposer>(options);
+    }
+
     // promote 16 bit integer all-reduce and reduce-scatter to 32-bit.
     const std::pair<PrimitiveType, PrimitiveType> ar_promoted_types[] = {
         {U16, U32}, {S16, S32}};
@@ -648,6 +678,7 @@ Status GpuCompiler::OptimizeHloModule(
 
   {
     HloPassFix<HloPassPipeline> fusion("fusion");
+    fusion.SetComputationThreadPool(computation_thread_pool.get());
     // We try to split variadic ops with many parameters into several such ops
     // to avoid exceeding the parameter space.
     fusion.AddPass<VariadicOpSplitter>();
@@ -671,6 +702,7 @@ Status GpuCompiler::OptimizeHloModule(
 
   {
     HloPassFix<HloPassPipeline> horizontal_fusion("horizontal fusion");
+    horizontal_fusion.SetComputationThreadPool(computation_thread_pool.get());
     horizontal_fusion.AddPass<GpuHorizontalLoopFusion>();
     horizontal_fusion.AddPass<GpuHorizontalInputFusion>(gpu_device_info);
     horizontal_fusion.AddPass<HloCSE>(/*is_layout_sensitive=*/true,
@@ -1101,6 +1133,9 @@ static void ForAllThunks(const std::function<void(Thunk*)>& fn,
            cond_thunk->branch_thunks()) {
         ForAllThunks(fn, &branch_thunks->thunks());
       }
+    } else if (thunk->kind() == Thunk::kConcurrent) {
+      auto* concurrent_thunk = static_cast<ConcurrentThunk*>(thunk.get());
+      ForAllThunks(fn, &concurrent_thunk->thunks());
     } else if (thunk->kind() == Thunk::kFor) {
       auto* for_thunk = static_cast<ForThunk*>(thunk.get());
       ForAllThunks(fn, &for_thunk->body_thunk_sequence()->thunks());
@@ -1295,8 +1330,24 @@ static Status CompileModuleToLlvmIrImpl(
   }
 
   auto thunk_sequence = ir_emitter->ConsumeThunkSequence();
+  const DebugOptions& debug_options = hlo_module->config().debug_options();
+  // The dependencies between the thunks, and the parameters they use, are
+  // derived from their ops, which are only valid until the compile time info is
+  // cleared.
+  if (debug_options.xla_gpu_max_concurrent_streams() > 1) {
+    AssignConcurrentStreams(thunk_sequence.get(), results->allocations,
+                            gpu_device_info,
+                            debug_options.xla_gpu_max_concurrent_streams());
+  }
+  if (debug_options.xla_gpu_enable_lazy_parameter_waits()) {
+    InsertParameterWaits(thunk_sequence.get(), results->allocations);
+  }
   ForAllThunks([](Thunk* thunk) { thunk->ClearCompileTimeInfo(); },
                thunk_sequence.get());
+  if (debug_options.xla_gpu_enable_cuda_graphs()) {
+    OutlineCudaGraphThunks(thunk_sequence.get(),
+                           debug_options.xla_gpu_cuda_graph_min_graph_size());
+  }
   results->executable = std::move(thunk_sequence);
   return OkStatus();
 }
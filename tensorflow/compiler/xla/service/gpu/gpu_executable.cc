@@ -27,6 +27,7 @@ limitations under the License.
 #include <variant>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/cleanup/cleanup.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
@@ -175,6 +176,17 @@ namespace {
 Status MaybeSyncAndProfile(const ServiceExecutableRunOptions* run_options,
                            uint64_t start_nanos, se::Stream* stream_to_sync);
 
+// Returns the callback with which the executable waits for its arguments, or
+// nullptr if the caller has already waited for all of them.
+const WaitForParametersCallback* GetWaitForParametersCallback(
+    const ServiceExecutableRunOptions* run_options) {
+  const GpuExecutableRunOptions* gpu_options =
+      run_options->run_options().gpu_executable_run_options();
+  return gpu_options && gpu_options->wait_for_parameters_callback()
+             ? &gpu_options->wait_for_parameters_callback()
+             : nullptr;
+}
+
 Status ExecuteThunks(const std::string& module_name, ModuleIdentifier module_id,
                      const ThunkSequence& thunk_sequence,
                      const ServiceExecutableRunOptions* run_options,
@@ -607,6 +619,11 @@ StatusOr<ExecutionOutput> GpuExecutable::ExecuteAsyncOnStreamImpl(
             buffer_allocations.GetMutableDeviceAddress(
                 output_info.allocation_index);
         CHECK_EQ(aliased_buffer.size(), result_buffer.size());
+        if (const WaitForParametersCallback* wait_for_parameters =
+                GetWaitForParametersCallback(run_options)) {
+          (*wait_for_parameters)({allocation->parameter_number()},
+                                 run_options->stream());
+        }
         run_options->stream()->ThenMemcpyD2D(&result_buffer, aliased_buffer,
                                              aliased_buffer.size());
         aliased_buffer = result_buffer;
@@ -654,6 +671,25 @@ Status GpuExecutable::ExecuteThunksOrXlaRuntime(
     unique_id = module().unique_id();
   }
 
+  // Unless the thunks wait for the arguments just before their first use, wait
+  // for all of them before the execution starts.
+  if (const WaitForParametersCallback* wait_for_parameters =
+          GetWaitForParametersCallback(run_options)) {
+    bool waits_for_parameters =
+        thunks_ && absl::c_any_of(*thunks_, [](const auto& thunk) {
+          return thunk->kind() == Thunk::kWaitForParameters;
+        });
+    if (!waits_for_parameters) {
+      std::vector<int64_t> parameter_numbers;
+      for (const BufferAllocation& allocation : allocations_) {
+        if (allocation.is_entry_computation_parameter()) {
+          parameter_numbers.push_back(allocation.parameter_number());
+        }
+      }
+      (*wait_for_parameters)(parameter_numbers, run_options->stream());
+    }
+  }
+
   if (thunks_) {
     se::StreamExecutor* executor = run_options->stream()->parent();
     for (const std::unique_ptr<Thunk>& thunk : *thunks_) {
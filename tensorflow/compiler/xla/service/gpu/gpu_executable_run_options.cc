@@ -53,6 +53,18 @@ const NcclUniqueIdCallback& GpuExecutableRunOptions::nccl_unique_id_callback()
   return nccl_unique_id_callback_;
 }
 
+GpuExecutableRunOptions&
+GpuExecutableRunOptions::set_wait_for_parameters_callback(
+    WaitForParametersCallback wait_for_parameters_callback) {
+  wait_for_parameters_callback_ = std::move(wait_for_parameters_callback);
+  return *this;
+}
+
+const WaitForParametersCallback&
+GpuExecutableRunOptions::wait_for_parameters_callback() const {
+  return wait_for_parameters_callback_;
+}
+
 NcclExecuteParams::NcclExecuteParams(
     const ServiceExecutableRunOptions& run_options, se::Stream* stream)
     : stream(stream),
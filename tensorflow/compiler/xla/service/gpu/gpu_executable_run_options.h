@@ -22,6 +22,7 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "tensorflow/compiler/xla/service/global_device_id.h"
 #include "tensorflow/compiler/xla/service/service_executable_run_options.h"
 #include "tensorflow/compiler/xla/statusor.h"
@@ -56,6 +57,12 @@ class NcclCliqueKey {
 using NcclUniqueIdCallback =
     std::function<StatusOr<std::string>(const NcclCliqueKey&)>;
 
+// Callback that enqueues on `stream` the waits for the arguments of the given
+// entry computation parameters to be defined, e.g. for their host-to-device
+// transfers to complete.
+using WaitForParametersCallback = std::function<void(
+    absl::Span<const int64_t> parameter_numbers, se::Stream* stream)>;
+
 // GPU-specific executable options.
 // We keep these separate from ExecutableRunOptions to avoid adding
 // dependencies to ExecutableRunOptions.
@@ -76,9 +83,19 @@ class GpuExecutableRunOptions {
       NcclUniqueIdCallback nccl_unique_id_callback);
   const NcclUniqueIdCallback& nccl_unique_id_callback() const;
 
+  // Callback with which the executable waits for each of its arguments just
+  // before their first use, instead of the caller waiting for all of them
+  // before the execution starts. If set, the executable waits for all of its
+  // arguments before it completes, and for all of them before it starts if it
+  // can't tell where they are first used.
+  GpuExecutableRunOptions& set_wait_for_parameters_callback(
+      WaitForParametersCallback wait_for_parameters_callback);
+  const WaitForParametersCallback& wait_for_parameters_callback() const;
+
  private:
   std::optional<std::map<int, GlobalDeviceId>> gpu_global_device_ids_;
   NcclUniqueIdCallback nccl_unique_id_callback_;
+  WaitForParametersCallback wait_for_parameters_callback_;
 };
 
 // NCCL-related execution parameters.
@@ -20,16 +20,23 @@ limitations under the License.
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
 #include "tensorflow/compiler/xla/hlo/ir/hlo_instructions.h"
 #include "tensorflow/compiler/xla/hlo/ir/hlo_schedule.h"
 #include "tensorflow/compiler/xla/service/buffer_value.h"
+#include "tensorflow/compiler/xla/service/gpu/gpu_hlo_cost_analysis.h"
+#include "tensorflow/compiler/xla/service/gpu/gpu_performance_model.h"
 #include "tensorflow/compiler/xla/service/hlo_memory_scheduler.h"
 #include "tensorflow/compiler/xla/service/hlo_pass_pipeline.h"
 #include "tensorflow/compiler/xla/service/latency_hiding_scheduler.h"
+#include "tensorflow/compiler/xla/service/profile_guided_latency_estimator.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/profiler/protobuf/profiled_instructions.pb.h"
 
 namespace xla {
 namespace gpu {
@@ -196,6 +203,110 @@ class GpuLatencyEstimatorNop : public LatencyEstimator {
   int CyclesPerMicrosecond() const override { return 1; }
 };
 
+// Latency estimator that estimates the cost of the kernels with the GPU
+// performance model, in microseconds. It is the fallback for the instructions
+// missing from a profile.
+class GpuPerformanceModelLatencyEstimator : public LatencyEstimator {
+ public:
+  GpuPerformanceModelLatencyEstimator(
+      std::unique_ptr<GpuHloCostAnalysis> cost_analysis,
+      const GpuDeviceInfo& gpu_info, int64_t pointer_size)
+      : cost_analysis_(std::move(cost_analysis)),
+        gpu_info_(gpu_info),
+        pointer_size_(pointer_size) {}
+
+  TimeCost GetLatencyBetween(const HloGraphNode& from,
+                             const HloGraphNode& target) const override {
+    static constexpr TimeCost kLowLatency = 1.0;
+    // Rough estimate of an unprofiled collective: a launch overhead plus the
+    // transfer of its operand over an interconnect an order of magnitude
+    // slower than the device memory.
+    static constexpr TimeCost kCollectiveOverheadUs = 10.0;
+    const HloInstruction& start = from.GetInstr();
+    const HloInstruction& done = target.GetInstr();
+    if (!IsAsyncDone(done) || done.operand_count() == 0 ||
+        done.operand(0) != &start || start.operand_count() == 0) {
+      return kLowLatency;
+    }
+    const double bytes =
+        GetSizeOfShape(start.operand(0)->shape(), pointer_size_);
+    return kCollectiveOverheadUs +
+           1e6 * bytes / (gpu_info_.memory_bandwidth / 10.0);
+  }
+
+  TimeCost NodeCost(const HloInstruction* instr) const override {
+    static constexpr TimeCost kLowCost = 1.0;
+    switch (instr->opcode()) {
+      case HloOpcode::kFusion:
+      case HloOpcode::kConvolution:
+      case HloOpcode::kCustomCall:
+      case HloOpcode::kDot:
+        return absl::ToDoubleMicroseconds(
+            GpuPerformanceModel::EstimateRunTimes(instr, cost_analysis_.get(),
+                                                  gpu_info_)
+                .time_unfused);
+      default:
+        // Instructions that don't launch kernels, e.g. tuples, bitcasts and
+        // the async starts and dones.
+        return kLowCost;
+    }
+  }
+
+  int CyclesPerMicrosecond() const override { return 1; }
+
+ private:
+  static bool IsAsyncDone(const HloInstruction& instr) {
+    switch (instr.opcode()) {
+      case HloOpcode::kAsyncDone:
+      case HloOpcode::kAllGatherDone:
+      case HloOpcode::kAllReduceDone:
+      case HloOpcode::kCollectivePermuteDone:
+      case HloOpcode::kSendDone:
+      case HloOpcode::kRecvDone:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  std::unique_ptr<GpuHloCostAnalysis> cost_analysis_;
+  const GpuDeviceInfo gpu_info_;
+  const int64_t pointer_size_;
+};
+
+// Returns the profile-guided latency estimator if a profile is given with
+// --xla_gpu_pgle_profile_file, or else the nop estimator.
+StatusOr<std::unique_ptr<LatencyEstimator>> GetLatencyEstimator(
+    const HloModule& module, int64_t pointer_size,
+    const GpuDeviceInfo& gpu_info) {
+  const std::string& profile_file =
+      module.config().debug_options().xla_gpu_pgle_profile_file();
+  if (profile_file.empty()) {
+    return std::unique_ptr<LatencyEstimator>(
+        std::make_unique<GpuLatencyEstimatorNop>());
+  }
+  tensorflow::profiler::ProfiledInstructionsProto profile;
+  TF_RETURN_IF_ERROR(
+      tsl::ReadTextOrBinaryProto(tsl::Env::Default(), profile_file, &profile));
+
+  auto shape_size_in_bytes = [pointer_size](const Shape& shape) {
+    return GetSizeOfShape(shape, pointer_size);
+  };
+  auto cost_analysis =
+      std::make_unique<GpuHloCostAnalysis>(GpuHloCostAnalysis::Options{
+          shape_size_in_bytes, /*per_second_rates=*/{},
+          /*count_multiple_input_accesses=*/true});
+  for (const HloComputation* computation :
+       module.MakeNonfusionComputations()) {
+    TF_RETURN_IF_ERROR(computation->Accept(cost_analysis.get()));
+  }
+  return std::unique_ptr<LatencyEstimator>(
+      std::make_unique<ProfileGuidedLatencyEstimator>(
+          std::make_unique<GpuPerformanceModelLatencyEstimator>(
+              std::move(cost_analysis), gpu_info, pointer_size),
+          profile));
+}
+
 }  // end namespace
 
 int64_t GetSizeOfShape(const Shape& shape, int pointer_size) {
@@ -224,7 +335,8 @@ Status ScheduleGpuModule(HloModule* module, int64_t pointer_size,
     return OkStatus();
   }
   SchedulerConfig config = GetSchedulerConfig(gpu_info);
-  auto latency_estimator = std::make_unique<GpuLatencyEstimatorNop>();
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<LatencyEstimator> latency_estimator,
+                      GetLatencyEstimator(*module, pointer_size, gpu_info));
   auto async_tracker = std::make_unique<AsyncTracker>(config);
 
   auto shape_size_in_bytes = [pointer_size](const Shape& shape) {
@@ -18,6 +18,7 @@ limitations under the License.
 #include <algorithm>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
@@ -29,6 +30,11 @@ limitations under the License.
 #include "tensorflow/compiler/xla/tests/hlo_test_base.h"
 #include "tensorflow/compiler/xla/tests/test_utils.h"
 #include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/path.h"
+#include "tensorflow/tsl/platform/test.h"
+#include "tensorflow/tsl/profiler/protobuf/profiled_instructions.pb.h"
 
 namespace xla {
 namespace gpu {
@@ -307,5 +313,55 @@ TEST_P(GpuHloScheduleParameterizedTest, AsyncAllReduce) {
 INSTANTIATE_TEST_SUITE_P(GpuHloScheduleParameterizedTest,
                          GpuHloScheduleParameterizedTest, ::testing::Bool());
 
+TEST_F(GpuHloScheduleTest, ProfileGuidedLatencyHidingScheduler) {
+  const char* hlo_text = R"(
+HloModule test, is_scheduled=true
+
+add {
+  x = f32[] parameter(0)
+  y = f32[] parameter(1)
+  ROOT add = f32[] add(x, y)
+}
+
+ENTRY entry {
+  p0 = f32[32,32] parameter(0)
+  p1 = f32[32,32] parameter(1)
+  ar-start = f32[32,32] all-reduce-start(p0), to_apply=add
+  ar-done = f32[32,32] all-reduce-done(ar-start)
+  add0 = f32[32,32] add(p1, p1)
+  add1 = f32[32,32] add(add0, p1)
+  ROOT add2 = f32[32,32] add(add1, ar-done)
+}
+)";
+  tensorflow::profiler::ProfiledInstructionsProto profile;
+  auto* latency = profile.add_latencies();
+  latency->set_name("ar-start");
+  latency->set_latency_us(100.0);
+  for (const char* name : {"add0", "add1"}) {
+    auto* cost = profile.add_costs();
+    cost->set_name(name);
+    cost->set_cost_us(40.0);
+  }
+  const std::string profile_file =
+      tsl::io::JoinPath(tsl::testing::TmpDir(), "profile.pbtxt");
+  TF_ASSERT_OK(tsl::WriteTextProto(tsl::Env::Default(), profile_file, profile));
+
+  HloModuleConfig config;
+  DebugOptions debug_options = GetDebugOptionsForTest();
+  debug_options.set_xla_gpu_enable_latency_hiding_scheduler(true);
+  debug_options.set_xla_gpu_pgle_profile_file(profile_file);
+  config.set_debug_options(debug_options);
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(hlo_text, config));
+
+  SequentialHloOrdering order = BuildHloOrdering(module.get());
+  HloComputation* entry = module->entry_computation();
+  // Both adds are needed to hide the profiled latency of the all-reduce.
+  EXPECT_TRUE(order.ExecutesBefore(entry->GetInstructionWithName("ar-start"),
+                                   entry->GetInstructionWithName("add0")));
+  EXPECT_TRUE(order.ExecutesBefore(entry->GetInstructionWithName("add1"),
+                                   entry->GetInstructionWithName("ar-done")));
+}
+
 }  // namespace gpu
 }  // namespace xla
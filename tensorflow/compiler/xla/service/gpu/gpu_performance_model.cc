@@ -37,6 +37,36 @@ static constexpr float kL1CacheSpeedup = 8;
 // much smaller than the cache size will likely stay in it.
 // For reference, it can be up to 256 kB per SM on RTX A6000.
 static constexpr float kL1CacheSizePerSM = 2 * 1024;
+// Fraction of the threads that the GPU can keep resident at the same time
+// which have to be active to saturate the DRAM bandwidth, i.e. to keep enough
+// memory requests in flight to hide the memory latency. For reference, both
+// V100 and A100 need about 20-25% of their resident threads, which is more
+// threads on A100 because it has more SMs and more threads per SM.
+static constexpr float kOccupancyToSaturateBandwidth = 0.25;
+
+// Returns the fraction of the DRAM bandwidth that the kernel computing `instr`
+// can use, given the number of threads it is launched with.
+float BandwidthUtilization(const GpuDeviceInfo& gpu_device_info,
+                           const HloInstruction* instr) {
+  // The reduction emitters assign several threads to each output element, so
+  // the number of output elements doesn't tell the number of threads; assume
+  // that they saturate the bandwidth.
+  if (instr->opcode() == HloOpcode::kReduce ||
+      (instr->opcode() == HloOpcode::kFusion &&
+       instr->fusion_kind() != HloInstruction::FusionKind::kLoop)) {
+    return 1.f;
+  }
+  float threads_to_saturate_bandwidth = kOccupancyToSaturateBandwidth *
+                                        gpu_device_info.core_count *
+                                        gpu_device_info.threads_per_core_limit;
+  if (threads_to_saturate_bandwidth <= 0) {
+    return 1.f;
+  }
+  // The loop emitter launches one thread per output element.
+  int64_t n_threads =
+      std::max<int64_t>(1, ShapeUtil::ElementsInRecursive(instr->shape()));
+  return std::min(1.f, n_threads / threads_to_saturate_bandwidth);
+}
 
 // Returns whether a fusion uses the parameter at the given index elementwise
 // from its root.
@@ -164,10 +194,15 @@ GpuPerformanceModel::EstimateRunTimes(
   absl::Duration output_write_time_unfused =
       absl::Seconds(producer_bytes_out / memory_bandwidth_bytes_per_second);
   VLOG(8) << "Output write time unfused: " << output_write_time_unfused;
+  float producer_bandwidth_utilization =
+      BandwidthUtilization(gpu_device_info, producer);
+  VLOG(8) << "Producer bandwidth utilization: "
+          << producer_bandwidth_utilization;
   absl::Duration exec_time_unfused = std::max(
       compute_time_unfused,
-      ProducerInputAccessTime(cost_analysis, gpu_device_info, producer) +
-          output_write_time_unfused);
+      (ProducerInputAccessTime(cost_analysis, gpu_device_info, producer) +
+       output_write_time_unfused) /
+          producer_bandwidth_utilization);
 
   int64_t fused_consumer_count = fused_users.size();
   VLOG(8) << "Consumer count: " << fused_consumer_count;
@@ -182,14 +217,20 @@ GpuPerformanceModel::EstimateRunTimes(
     absl::Duration compute_time_by_this_consumer = compute_time(
         cost_analysis->flop_count(*producer) * utilization_by_this_consumer,
         producer_elements_out * utilization_by_this_consumer);
+    // When fused, the inputs of the producer are read by the threads of the
+    // consumer, which may be too few to saturate the bandwidth.
+    float consumer_bandwidth_utilization =
+        BandwidthUtilization(gpu_device_info, u);
     exec_time_fused += std::max(
         compute_time_by_this_consumer,
-        ProducerInputAccessTime(cost_analysis, gpu_device_info, producer, u));
+        ProducerInputAccessTime(cost_analysis, gpu_device_info, producer, u) /
+            consumer_bandwidth_utilization);
     producer_output_read_time_unfused +=
         ReadTime(gpu_device_info,
                  std::min(producer_bytes_out,
                           producer_bytes_out * utilization_by_this_consumer),
-                 producer_bytes_out * utilization_by_this_consumer);
+                 producer_bytes_out * utilization_by_this_consumer) /
+        consumer_bandwidth_utilization;
   }
   VLOG(8) << "Utilization of producer output: " << total_producer_utilization;
 
@@ -813,6 +813,47 @@ ENTRY e {
   EXPECT_NEAR(absl::ToInt64Microseconds(t.time_unfused), 64000, 6400);
 }
 
+TEST_F(GpuPerformanceModelTest, FewThreadsDoNotSaturateBandwidth) {
+  absl::string_view hlo_string = R"(
+HloModule m
+
+add {
+  p0 = f32[] parameter(0)
+  p1 = f32[] parameter(1)
+  ROOT add = f32[] add(p0, p1)
+}
+
+f {
+  p0 = f32[16,65536] parameter(0)
+  zero = f32[] constant(0)
+  ROOT reduce = f32[16] reduce(p0, zero), dimensions={1}, to_apply=add
+}
+
+ENTRY e {
+  p0 = f32[16,65536] parameter(0)
+  loop = f32[16] fusion(p0), kind=kLoop, calls=f
+  input = f32[16] fusion(p0), kind=kInput, calls=f
+  ROOT t = (f32[16], f32[16]) tuple(loop, input)
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(hlo_string));
+  ASSERT_IS_OK(module->entry_computation()->Accept(&analysis_));
+
+  // The loop fusion reads its input with only 16 threads, which is far from
+  // enough to saturate the bandwidth.
+  GpuPerformanceModel::RunTimes loop_t = GpuPerformanceModel::EstimateRunTimes(
+      module->entry_computation()->GetInstructionWithName("loop"), &analysis_,
+      device_info_);
+  EXPECT_GT(loop_t.time_unfused, absl::Milliseconds(1));
+
+  // The reduction emitter spreads the reduced dimension over many threads.
+  GpuPerformanceModel::RunTimes input_t = GpuPerformanceModel::EstimateRunTimes(
+      module->entry_computation()->GetInstructionWithName("input"), &analysis_,
+      device_info_);
+  EXPECT_LT(input_t.time_unfused, absl::Microseconds(20));
+}
+
 TEST_F(GpuPerformanceModelTest, UnusedParameter) {
   Shape shape = ShapeUtil::MakeShape(F32, {100000});
 
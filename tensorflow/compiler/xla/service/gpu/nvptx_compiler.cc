@@ -48,6 +48,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/gpu/ir_emission_utils.h"
 #include "tensorflow/compiler/xla/service/gpu/llvm_gpu_backend/gpu_backend_lib.h"
 #include "tensorflow/compiler/xla/service/gpu/metrics.h"
+#include "tensorflow/compiler/xla/service/gpu/persistent_autotune_cache.h"
 #include "tensorflow/compiler/xla/service/gpu/target_constants.h"
 #include "tensorflow/compiler/xla/service/gpu/triangular_solve_rewriter.h"
 #include "tensorflow/compiler/xla/service/hlo_constant_folding.h"
@@ -166,6 +167,18 @@ Status NVPTXCompiler::OptimizeHloPostLayoutAssignment(
     se::DeviceMemoryAllocator* device_allocator,
     const GpuTargetConfig& gpu_target_config,
     const AutotuneResults* autotune_results) {
+  // Use the autotuning results shared by the other processes, so that only the
+  // GEMMs and convolutions that nobody has autotuned yet are autotuned.
+  const std::string& autotune_cache_dir =
+      hlo_module->config().debug_options().xla_gpu_autotune_cache_dir();
+  std::string autotune_cache_version_key;
+  if (stream_exec && !autotune_cache_dir.empty()) {
+    TF_ASSIGN_OR_RETURN(autotune_cache_version_key,
+                        GetAutotuneCacheVersionKey(stream_exec));
+    TF_RETURN_IF_ERROR(LoadAutotuneResultsFromDir(autotune_cache_dir,
+                                                  autotune_cache_version_key));
+  }
+
   HloPassPipeline pre_pipeline("nvptx post-layout_assignment part 1");
 
   // This needs to run before GemmRewriter, which is part of
@@ -219,6 +232,11 @@ Status NVPTXCompiler::OptimizeHloPostLayoutAssignment(
 
   TF_RETURN_IF_ERROR(post_pipeline.Run(hlo_module).status());
 
+  if (!autotune_cache_version_key.empty()) {
+    TF_RETURN_IF_ERROR(SaveAutotuneResultsToDir(autotune_cache_dir,
+                                                autotune_cache_version_key));
+  }
+
   return OkStatus();
 }
 
@@ -0,0 +1,180 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/persistent_autotune_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/base/const_init.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/compiler/xla/autotune_results.pb.h"
+#include "tensorflow/compiler/xla/autotune_serialize.h"
+#include "tensorflow/compiler/xla/stream_executor/blas.h"
+#include "tensorflow/compiler/xla/stream_executor/dnn.h"
+#include "tensorflow/compiler/xla/util.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/fingerprint.h"
+#include "tensorflow/tsl/platform/logging.h"
+#include "tensorflow/tsl/platform/path.h"
+#include "tensorflow/tsl/platform/statusor.h"
+
+namespace xla {
+namespace gpu {
+namespace {
+
+constexpr absl::string_view kResultFileSuffix = ".pb";
+
+// The paths of the result files that this process has already loaded or
+// saved, so that the shared directory is only read or written for files it
+// doesn't know about.
+absl::Mutex known_files_mu(absl::kConstInit);
+auto& known_files ABSL_GUARDED_BY(known_files_mu) =
+    *new absl::flat_hash_set<std::string>();
+
+std::string VersionDir(absl::string_view dir, absl::string_view version_key) {
+  return tsl::io::JoinPath(
+      dir, absl::StrFormat("%016x", tsl::Fingerprint64(version_key)));
+}
+
+std::string ResultFileName(absl::string_view kind,
+                           const AutotuneResults::Entry& entry) {
+  tsl::Fprint128 fp =
+      tsl::Fingerprint128(absl::StrCat(entry.device(), "\n", entry.hlo()));
+  return absl::StrFormat("%s-%016x%016x%s", kind, fp.high64, fp.low64,
+                         kResultFileSuffix);
+}
+
+// Writes `results` to `path` atomically.
+Status WriteResultFile(const std::string& path,
+                       const AutotuneResults& results) {
+  tsl::Env* env = tsl::Env::Default();
+  std::string tmp_path = path;
+  if (!env->CreateUniqueFileName(&tmp_path, ".tmp")) {
+    return InternalError("Failed to create a unique file name for %s", path);
+  }
+  TF_RETURN_IF_ERROR(
+      tsl::WriteStringToFile(env, tmp_path, results.SerializeAsString()));
+  Status status = env->RenameFile(tmp_path, path);
+  if (!status.ok()) {
+    env->DeleteFile(tmp_path).IgnoreError();
+  }
+  return status;
+}
+
+}  // namespace
+
+StatusOr<std::string> GetAutotuneCacheVersionKey(
+    se::StreamExecutor* stream_exec) {
+  const se::DeviceDescription& desc = stream_exec->GetDeviceDescription();
+  std::string key =
+      absl::StrCat(desc.model_str(), "; driver ", desc.driver_version(),
+                   "; runtime ", desc.runtime_version());
+  if (se::dnn::DnnSupport* dnn = stream_exec->AsDnn()) {
+    TF_ASSIGN_OR_RETURN(se::dnn::VersionInfo version, dnn->GetVersion());
+    absl::StrAppend(&key, "; dnn ", version.major_version(), ".",
+                    version.minor_version(), ".", version.patch());
+  }
+  if (se::blas::BlasSupport* blas = stream_exec->AsBlas()) {
+    std::string version;
+    TF_RETURN_IF_ERROR(blas->GetVersion(&version));
+    absl::StrAppend(&key, "; blas ", version);
+  }
+  return key;
+}
+
+Status LoadAutotuneResultsFromDir(absl::string_view dir,
+                                  absl::string_view version_key) {
+  tsl::Env* env = tsl::Env::Default();
+  std::string version_dir = VersionDir(dir, version_key);
+  if (!env->IsDirectory(version_dir).ok()) return OkStatus();
+
+  std::vector<std::string> children;
+  TF_RETURN_IF_ERROR(env->GetChildren(version_dir, &children));
+
+  absl::MutexLock lock(&known_files_mu);
+  int64_t num_loaded = 0;
+  for (const std::string& child : children) {
+    if (!absl::EndsWith(child, kResultFileSuffix)) continue;
+    std::string path = tsl::io::JoinPath(version_dir, child);
+    if (known_files.contains(path)) continue;
+
+    // A broken file must not fail the compilation, the result is autotuned
+    // again instead.
+    std::string data;
+    Status status = tsl::ReadFileToString(env, path, &data);
+    if (status.ok()) status = LoadAutotuneResults(data);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to load the autotuning results from " << path
+                   << ": " << status;
+      continue;
+    }
+    known_files.insert(path);
+    ++num_loaded;
+  }
+  VLOG(1) << "Loaded " << num_loaded << " autotuning results from "
+          << version_dir << " for " << version_key;
+  return OkStatus();
+}
+
+Status SaveAutotuneResultsToDir(absl::string_view dir,
+                                absl::string_view version_key) {
+  TF_ASSIGN_OR_RETURN(std::string serialized, SerializeAutotuneResults());
+  AutotuneResults results;
+  TF_RET_CHECK(results.ParseFromString(serialized));
+
+  tsl::Env* env = tsl::Env::Default();
+  std::string version_dir = VersionDir(dir, version_key);
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(version_dir));
+
+  absl::MutexLock lock(&known_files_mu);
+  int64_t num_saved = 0;
+  auto save = [&](absl::string_view kind,
+                  const AutotuneResults::Entry& entry) -> Status {
+    std::string path =
+        tsl::io::JoinPath(version_dir, ResultFileName(kind, entry));
+    if (known_files.contains(path)) return OkStatus();
+    if (!env->FileExists(path).ok()) {
+      AutotuneResults file_results;
+      file_results.set_version(results.version());
+      if (kind == "dot") {
+        *file_results.add_dots() = entry;
+      } else {
+        *file_results.add_convs() = entry;
+      }
+      TF_RETURN_IF_ERROR(WriteResultFile(path, file_results));
+      ++num_saved;
+    }
+    known_files.insert(path);
+    return OkStatus();
+  };
+  for (const AutotuneResults::Entry& entry : results.dots()) {
+    TF_RETURN_IF_ERROR(save("dot", entry));
+  }
+  for (const AutotuneResults::Entry& entry : results.convs()) {
+    TF_RETURN_IF_ERROR(save("conv", entry));
+  }
+  VLOG(1) << "Saved " << num_saved << " autotuning results to " << version_dir
+          << " for " << version_key;
+  return OkStatus();
+}
+
+}  // namespace gpu
+}  // namespace xla
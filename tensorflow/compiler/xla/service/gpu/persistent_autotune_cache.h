@@ -0,0 +1,63 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_GPU_PERSISTENT_AUTOTUNE_CACHE_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_GPU_PERSISTENT_AUTOTUNE_CACHE_H_
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/compiler/xla/status.h"
+#include "tensorflow/compiler/xla/statusor.h"
+#include "tensorflow/compiler/xla/stream_executor/stream_executor.h"
+
+namespace xla {
+namespace gpu {
+
+// A cache of the GEMM and convolution autotuning results that is persisted in
+// a directory shared by many processes, e.g. all the jobs of a cluster, so
+// that each GEMM or convolution is autotuned only once per device type.
+//
+// The results are only valid for the GPU model and the versions of the driver,
+// cuDNN and cuBLAS they were measured with, so they are stored in a separate
+// subdirectory for each version key returned by GetAutotuneCacheVersionKey.
+//
+// Each result is stored in its own file, named after the fingerprint of its
+// device and HLO. A file is written to a unique temporary name first and then
+// renamed, so the readers never see partially written results, and the
+// concurrent writers of the same result just replace it with an identical one.
+// Hence the directory doesn't need any locking to be shared.
+
+// Returns the key identifying the device and library versions of
+// `stream_exec`, which the autotuning results depend on.
+StatusOr<std::string> GetAutotuneCacheVersionKey(
+    se::StreamExecutor* stream_exec);
+
+// Loads the autotuning results stored in `dir` for `version_key` into
+// GemmAlgorithmPicker and GpuConvAlgorithmPicker, so that they are used
+// instead of autotuning. The files that were already loaded by this process
+// are skipped.
+Status LoadAutotuneResultsFromDir(absl::string_view dir,
+                                  absl::string_view version_key);
+
+// Adds the autotuning results of GemmAlgorithmPicker and
+// GpuConvAlgorithmPicker that are not in `dir` yet for `version_key`.
+Status SaveAutotuneResultsToDir(absl::string_view dir,
+                                absl::string_view version_key);
+
+}  // namespace gpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_GPU_PERSISTENT_AUTOTUNE_CACHE_H_
@@ -0,0 +1,146 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/persistent_autotune_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/autotune_results.pb.h"
+#include "tensorflow/compiler/xla/service/gpu/gemm_algorithm_picker.h"
+#include "tensorflow/compiler/xla/service/gpu/gpu_conv_algorithm_picker.h"
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/path.h"
+#include "tensorflow/tsl/platform/test.h"
+
+namespace xla {
+namespace gpu {
+namespace {
+
+class PersistentAutotuneCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ClearAutotuneResults(); }
+  void TearDown() override { ClearAutotuneResults(); }
+
+  static void ClearAutotuneResults() {
+    GemmAlgorithmPicker::ClearAutotuneResults();
+    GpuConvAlgorithmPicker::ClearAutotuneResults();
+  }
+
+  // Fills the algorithm pickers with one GEMM and one convolution result.
+  static void PopulateAutotuneResults() {
+    AutotuneResults results;
+    auto* dot = results.add_dots();
+    dot->set_device("sm_8.0 with 42331013120B RAM");
+    dot->set_hlo("{\n  tmp_0 = f32[2,2]{1,0} parameter(0)\n}");
+    dot->mutable_result()->mutable_gemm()->set_algorithm(7);
+    auto* conv = results.add_convs();
+    conv->set_device("sm_8.0 with 42331013120B RAM");
+    conv->set_hlo("{\n  tmp_0 = f32[1,2,2,1]{3,2,1,0} parameter(0)\n}");
+    conv->mutable_result()->mutable_conv()->set_algorithm(3);
+    conv->mutable_result()->mutable_conv()->set_tensor_ops_enabled(true);
+    TF_ASSERT_OK(GemmAlgorithmPicker::LoadAutotuneResults(results));
+    TF_ASSERT_OK(GpuConvAlgorithmPicker::LoadAutotuneResults(results));
+  }
+
+  static AutotuneResults GetAutotuneResults() {
+    AutotuneResults results;
+    TF_CHECK_OK(GemmAlgorithmPicker::WriteAutotuneResults(&results));
+    TF_CHECK_OK(GpuConvAlgorithmPicker::WriteAutotuneResults(&results));
+    return results;
+  }
+
+  static std::string NewDir(const std::string& name) {
+    std::string dir = tsl::io::JoinPath(tsl::testing::TmpDir(), name);
+    TF_CHECK_OK(tsl::Env::Default()->RecursivelyCreateDir(dir));
+    return dir;
+  }
+
+  // Copies the cached files of `src` to `dst`, as if they were written by
+  // another process.
+  static void CopyDir(const std::string& src, const std::string& dst) {
+    tsl::Env* env = tsl::Env::Default();
+    std::vector<std::string> version_dirs;
+    TF_CHECK_OK(env->GetChildren(src, &version_dirs));
+    for (const std::string& version_dir : version_dirs) {
+      std::string src_dir = tsl::io::JoinPath(src, version_dir);
+      std::string dst_dir = tsl::io::JoinPath(dst, version_dir);
+      TF_CHECK_OK(env->RecursivelyCreateDir(dst_dir));
+      std::vector<std::string> files;
+      TF_CHECK_OK(env->GetChildren(src_dir, &files));
+      for (const std::string& file : files) {
+        TF_CHECK_OK(env->CopyFile(tsl::io::JoinPath(src_dir, file),
+                                  tsl::io::JoinPath(dst_dir, file)));
+      }
+    }
+  }
+};
+
+TEST_F(PersistentAutotuneCacheTest, SaveWritesOneFilePerResult) {
+  std::string dir = NewDir("save");
+  PopulateAutotuneResults();
+  TF_ASSERT_OK(SaveAutotuneResultsToDir(dir, "gpu; driver 1"));
+  // Saving again doesn't write anything new.
+  TF_ASSERT_OK(SaveAutotuneResultsToDir(dir, "gpu; driver 1"));
+
+  std::vector<std::string> version_dirs;
+  TF_ASSERT_OK(tsl::Env::Default()->GetChildren(dir, &version_dirs));
+  ASSERT_EQ(version_dirs.size(), 1);
+  std::vector<std::string> files;
+  TF_ASSERT_OK(tsl::Env::Default()->GetChildren(
+      tsl::io::JoinPath(dir, version_dirs[0]), &files));
+  EXPECT_EQ(files.size(), 2);
+}
+
+TEST_F(PersistentAutotuneCacheTest, LoadResultsSavedByAnotherProcess) {
+  std::string saved_dir = NewDir("saved");
+  PopulateAutotuneResults();
+  AutotuneResults expected = GetAutotuneResults();
+  TF_ASSERT_OK(SaveAutotuneResultsToDir(saved_dir, "gpu; driver 1"));
+
+  std::string shared_dir = NewDir("shared");
+  CopyDir(saved_dir, shared_dir);
+  ClearAutotuneResults();
+  TF_ASSERT_OK(LoadAutotuneResultsFromDir(shared_dir, "gpu; driver 1"));
+
+  EXPECT_EQ(GetAutotuneResults().SerializeAsString(),
+            expected.SerializeAsString());
+}
+
+TEST_F(PersistentAutotuneCacheTest, ResultsAreKeyedByVersion) {
+  std::string saved_dir = NewDir("saved_v1");
+  PopulateAutotuneResults();
+  TF_ASSERT_OK(SaveAutotuneResultsToDir(saved_dir, "gpu; driver 1"));
+
+  std::string shared_dir = NewDir("shared_v1");
+  CopyDir(saved_dir, shared_dir);
+  ClearAutotuneResults();
+  TF_ASSERT_OK(LoadAutotuneResultsFromDir(shared_dir, "gpu; driver 2"));
+
+  AutotuneResults results = GetAutotuneResults();
+  EXPECT_EQ(results.dots_size(), 0);
+  EXPECT_EQ(results.convs_size(), 0);
+}
+
+TEST_F(PersistentAutotuneCacheTest, LoadFromMissingDirIsNoop) {
+  TF_ASSERT_OK(LoadAutotuneResultsFromDir(
+      tsl::io::JoinPath(tsl::testing::TmpDir(), "missing"), "gpu; driver 1"));
+  EXPECT_EQ(GetAutotuneResults().dots_size(), 0);
+}
+
+}  // namespace
+}  // namespace gpu
+}  // namespace xla
@@ -0,0 +1,95 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/tests/gpu_codegen_test.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+
+namespace xla {
+namespace gpu {
+namespace {
+
+// Runs the independent thunks concurrently on several streams.
+class ConcurrentStreamsTest : public GpuCodegenTest {
+  DebugOptions GetDebugOptionsForTest() override {
+    DebugOptions debug_options = GpuCodegenTest::GetDebugOptionsForTest();
+    debug_options.set_xla_gpu_enable_xla_runtime_executable(false);
+    debug_options.set_xla_gpu_max_concurrent_streams(4);
+    return debug_options;
+  }
+};
+
+TEST_F(ConcurrentStreamsTest, IndependentGemms) {
+  // The GEMMs of batch 1 are independent, and then summed.
+  const char* hlo_text = R"(
+    HloModule IndependentGemms
+
+    ENTRY main {
+      x = f32[1,256]{1,0} parameter(0)
+      w0 = f32[256,256]{1,0} parameter(1)
+      w1 = f32[256,256]{1,0} parameter(2)
+      w2 = f32[256,256]{1,0} parameter(3)
+      d0 = f32[1,256]{1,0} dot(x, w0), lhs_contracting_dims={1},
+        rhs_contracting_dims={0}
+      d1 = f32[1,256]{1,0} dot(x, w1), lhs_contracting_dims={1},
+        rhs_contracting_dims={0}
+      d2 = f32[1,256]{1,0} dot(x, w2), lhs_contracting_dims={1},
+        rhs_contracting_dims={0}
+      s0 = f32[1,256]{1,0} add(d0, d1)
+      ROOT s1 = f32[1,256]{1,0} add(s0, d2)
+    }
+  )";
+
+  EXPECT_TRUE(RunAndCompare(hlo_text, ErrorSpec{1e-3, 1e-3}));
+}
+
+TEST_F(ConcurrentStreamsTest, IndependentKernelsInWhileLoopBody) {
+  const char* hlo_text = R"(
+    HloModule IndependentKernelsInWhileLoopBody
+
+    cond {
+      param = (s32[], f32[128]{0}, f32[128]{0}) parameter(0)
+      i = s32[] get-tuple-element(param), index=0
+      limit = s32[] constant(10)
+      ROOT lt = pred[] compare(i, limit), direction=LT
+    }
+
+    body {
+      param = (s32[], f32[128]{0}, f32[128]{0}) parameter(0)
+      i = s32[] get-tuple-element(param), index=0
+      one = s32[] constant(1)
+      next_i = s32[] add(i, one)
+      x = f32[128]{0} get-tuple-element(param), index=1
+      y = f32[128]{0} get-tuple-element(param), index=2
+      sin = f32[128]{0} sine(x)
+      cos = f32[128]{0} cosine(y)
+      ROOT tuple = (s32[], f32[128]{0}, f32[128]{0}) tuple(next_i, sin, cos)
+    }
+
+    ENTRY main {
+      zero = s32[] constant(0)
+      x = f32[128]{0} parameter(0)
+      y = f32[128]{0} parameter(1)
+      init = (s32[], f32[128]{0}, f32[128]{0}) tuple(zero, x, y)
+      ROOT while = (s32[], f32[128]{0}, f32[128]{0}) while(init),
+        condition=cond, body=body
+    }
+  )";
+
+  EXPECT_TRUE(RunAndCompare(hlo_text, ErrorSpec{1e-5, 1e-5}));
+}
+
+}  // namespace
+}  // namespace gpu
+}  // namespace xla
@@ -0,0 +1,94 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/tests/gpu_codegen_test.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+
+namespace xla {
+namespace gpu {
+namespace {
+
+// Runs the thunk sequences with CUDA graphs.
+class CudaGraphTest : public GpuCodegenTest {
+  DebugOptions GetDebugOptionsForTest() override {
+    DebugOptions debug_options = GpuCodegenTest::GetDebugOptionsForTest();
+    debug_options.set_xla_gpu_enable_xla_runtime_executable(false);
+    debug_options.set_xla_gpu_enable_cuda_graphs(true);
+    debug_options.set_xla_gpu_cuda_graph_min_graph_size(1);
+    return debug_options;
+  }
+};
+
+TEST_F(CudaGraphTest, KernelSequence) {
+  const char* hlo_text = R"(
+    HloModule KernelSequence
+
+    add_F32 {
+      lhs = f32[] parameter(0)
+      rhs = f32[] parameter(1)
+      ROOT add = f32[] add(lhs, rhs)
+    }
+
+    ENTRY main {
+      a = f32[128]{0} parameter(0)
+      b = f32[128]{0} parameter(1)
+      sum = f32[128]{0} add(a, b)
+      zero = f32[] constant(0)
+      reduce = f32[] reduce(sum, zero), dimensions={0}, to_apply=add_F32
+      broadcast = f32[128]{0} broadcast(reduce), dimensions={}
+      ROOT mul = f32[128]{0} multiply(broadcast, sum)
+    }
+  )";
+
+  EXPECT_TRUE(RunAndCompare(hlo_text, ErrorSpec{1e-5, 1e-5}));
+}
+
+TEST_F(CudaGraphTest, WhileLoopBody) {
+  // The body of the loop runs from a CUDA graph, while the condition reads the
+  // predicate back to the host.
+  const char* hlo_text = R"(
+    HloModule WhileLoopBody
+
+    cond {
+      param = (s32[], f32[128]{0}) parameter(0)
+      i = s32[] get-tuple-element(param), index=0
+      limit = s32[] constant(10)
+      ROOT lt = pred[] compare(i, limit), direction=LT
+    }
+
+    body {
+      param = (s32[], f32[128]{0}) parameter(0)
+      i = s32[] get-tuple-element(param), index=0
+      one = s32[] constant(1)
+      next_i = s32[] add(i, one)
+      x = f32[128]{0} get-tuple-element(param), index=1
+      sin = f32[128]{0} sine(x)
+      ROOT tuple = (s32[], f32[128]{0}) tuple(next_i, sin)
+    }
+
+    ENTRY main {
+      zero = s32[] constant(0)
+      x = f32[128]{0} parameter(0)
+      init = (s32[], f32[128]{0}) tuple(zero, x)
+      ROOT while = (s32[], f32[128]{0}) while(init), condition=cond, body=body
+    }
+  )";
+
+  EXPECT_TRUE(RunAndCompare(hlo_text, ErrorSpec{1e-5, 1e-5}));
+}
+
+}  // namespace
+}  // namespace gpu
+}  // namespace xla
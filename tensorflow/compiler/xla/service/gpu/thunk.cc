@@ -30,12 +30,21 @@ Thunk::ExecuteParams::ExecuteParams(
     : buffer_allocations(&buffer_allocations),
       stream(stream),
       async_comms_stream(async_comms_stream),
-      nccl_params(run_options, stream) {}
+      nccl_params(run_options, stream) {
+  const GpuExecutableRunOptions* gpu_options =
+      run_options.run_options().gpu_executable_run_options();
+  wait_for_parameters =
+      gpu_options && gpu_options->wait_for_parameters_callback()
+          ? &gpu_options->wait_for_parameters_callback()
+          : nullptr;
+}
 
 /*static*/ absl::string_view Thunk::KindToString(Thunk::Kind kind) {
   switch (kind) {
     case Thunk::kCholesky:
       return "kCholesky";
+    case Thunk::kConcurrent:
+      return "kConcurrent";
     case Thunk::kConditional:
       return "kConditional";
     case Thunk::kConvolution:
@@ -44,6 +53,8 @@ Thunk::ExecuteParams::ExecuteParams(
       return "kCopy";
     case Thunk::kCublasLtMatmul:
       return "kCublasLtMatmul";
+    case Thunk::kCudaGraph:
+      return "kCudaGraph";
     case Thunk::kCustomCall:
       return "kCustomCall";
     case Thunk::kNcclAllGather:
@@ -88,6 +99,8 @@ Thunk::ExecuteParams::ExecuteParams(
       return "kSequential";
     case Thunk::kTriangularSolve:
       return "kTriangularSolve";
+    case Thunk::kWaitForParameters:
+      return "kWaitForParameters";
     case Thunk::kWhile:
       return "kWhile";
   }
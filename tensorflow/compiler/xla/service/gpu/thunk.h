@@ -48,10 +48,12 @@ class Thunk {
  public:
   enum Kind {
     kCholesky,
+    kConcurrent,
     kConditional,
     kConvolution,
     kCopy,
     kCublasLtMatmul,
+    kCudaGraph,
     kCustomCall,
     kFft,
     kFor,
@@ -74,6 +76,7 @@ class Thunk {
     kPartitionId,
     kSequential,
     kTriangularSolve,
+    kWaitForParameters,
     kWhile,
   };
 
@@ -125,6 +128,7 @@ class Thunk {
     se::Stream* stream;
     se::Stream* async_comms_stream;
     NcclExecuteParams nccl_params;
+    const WaitForParametersCallback* wait_for_parameters;  // may be null
   };
 
   // Execute the kernel for the thunk on the given stream. This method must be
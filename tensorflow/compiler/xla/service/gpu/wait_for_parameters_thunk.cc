@@ -0,0 +1,158 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/wait_for_parameters_thunk.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "mlir/IR/BuiltinTypes.h"  // from @llvm-project
+#include "mlir/IR/Operation.h"  // from @llvm-project
+#include "tensorflow/compiler/xla/mlir_hlo/lhlo/IR/lhlo_ops.h"
+#include "tensorflow/compiler/xla/service/gpu/concurrent_thunk.h"
+#include "tensorflow/compiler/xla/service/gpu/ir_emission_utils.h"
+#include "tensorflow/compiler/xla/service/gpu/sequential_thunk.h"
+
+namespace xla {
+namespace gpu {
+
+WaitForParametersThunk::WaitForParametersThunk(
+    ThunkInfo thunk_info, std::vector<int64_t> parameter_numbers)
+    : Thunk(Kind::kWaitForParameters, thunk_info),
+      parameter_numbers_(std::move(parameter_numbers)) {}
+
+std::string WaitForParametersThunk::ToStringExtra(int indent) const {
+  return absl::StrCat(", parameters = {",
+                      absl::StrJoin(parameter_numbers_, ", "), "}");
+}
+
+Status WaitForParametersThunk::ExecuteOnStream(const ExecuteParams& params) {
+  if (params.wait_for_parameters != nullptr) {
+    (*params.wait_for_parameters)(parameter_numbers_, params.stream);
+  }
+  return OkStatus();
+}
+
+namespace {
+
+// Returns the entry computation parameters that `thunk` uses, or nullopt if
+// they can't be derived from its op.
+std::optional<absl::flat_hash_set<int64_t>> ParametersUsedBy(
+    const Thunk& thunk, absl::Span<const BufferAllocation> allocations) {
+  absl::flat_hash_set<int64_t> parameters;
+  auto add_thunks = [&](const ThunkSequence& thunks) {
+    for (const std::unique_ptr<Thunk>& sub_thunk : thunks) {
+      std::optional<absl::flat_hash_set<int64_t>> sub_thunk_parameters =
+          ParametersUsedBy(*sub_thunk, allocations);
+      if (!sub_thunk_parameters) return false;
+      parameters.insert(sub_thunk_parameters->begin(),
+                        sub_thunk_parameters->end());
+    }
+    return true;
+  };
+  if (thunk.kind() == Thunk::kConcurrent) {
+    if (!add_thunks(static_cast<const ConcurrentThunk&>(thunk).thunks())) {
+      return std::nullopt;
+    }
+    return parameters;
+  }
+  if (thunk.kind() == Thunk::kSequential) {
+    if (!add_thunks(static_cast<const SequentialThunk&>(thunk).thunks())) {
+      return std::nullopt;
+    }
+    return parameters;
+  }
+
+  // The const_cast is needed because the op of a thunk is only exposed through
+  // a non-const accessor.
+  mlir::Operation* op = const_cast<Thunk&>(thunk).op();
+  if (op == nullptr) return std::nullopt;
+
+  auto add_value = [&](mlir::Value value) {
+    if (!value.getType().isa<mlir::MemRefType>()) return true;
+    StatusOr<BufferAllocation::Slice> slice =
+        GetAllocationSlice(value, allocations);
+    if (!slice.ok()) return false;
+    if (slice->allocation()->is_entry_computation_parameter()) {
+      parameters.insert(slice->allocation()->parameter_number());
+    }
+    return true;
+  };
+  if (auto fusion = mlir::dyn_cast<mlir::lmhlo::FusionOp>(op)) {
+    for (mlir::Value value : fusion.getInputBuffers()) {
+      if (!add_value(value)) return std::nullopt;
+    }
+    for (mlir::Value value : fusion.getOutputBuffers()) {
+      if (!add_value(value)) return std::nullopt;
+    }
+    return parameters;
+  }
+  // The ops nested in the regions, e.g. of the control flow ops, may use any
+  // buffer.
+  if (op->getNumRegions() > 0) return std::nullopt;
+  for (mlir::Value value : op->getOperands()) {
+    if (!add_value(value)) return std::nullopt;
+  }
+  return parameters;
+}
+
+}  // namespace
+
+void InsertParameterWaits(ThunkSequence* thunk_sequence,
+                          absl::Span<const BufferAllocation> allocations) {
+  absl::flat_hash_set<int64_t> all_parameters;
+  for (const BufferAllocation& allocation : allocations) {
+    if (allocation.is_entry_computation_parameter()) {
+      all_parameters.insert(allocation.parameter_number());
+    }
+  }
+
+  ThunkSequence with_waits;
+  absl::flat_hash_set<int64_t> waited;
+  auto wait_for = [&](const absl::flat_hash_set<int64_t>& parameters) {
+    std::vector<int64_t> parameter_numbers;
+    for (int64_t parameter : parameters) {
+      if (waited.insert(parameter).second) {
+        parameter_numbers.push_back(parameter);
+      }
+    }
+    if (parameter_numbers.empty()) return;
+    absl::c_sort(parameter_numbers);
+    Thunk::ThunkInfo thunk_info(/*op=*/nullptr);
+    thunk_info.profile_annotation = "WaitForParameters";
+    with_waits.push_back(std::make_unique<WaitForParametersThunk>(
+        std::move(thunk_info), std::move(parameter_numbers)));
+  };
+
+  for (std::unique_ptr<Thunk>& thunk : *thunk_sequence) {
+    std::optional<absl::flat_hash_set<int64_t>> parameters =
+        ParametersUsedBy(*thunk, allocations);
+    wait_for(parameters ? *parameters : all_parameters);
+    with_waits.push_back(std::move(thunk));
+  }
+  wait_for(all_parameters);
+
+  *thunk_sequence = std::move(with_waits);
+}
+
+}  // namespace gpu
+}  // namespace xla
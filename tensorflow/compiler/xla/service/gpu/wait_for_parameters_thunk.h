@@ -0,0 +1,67 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_GPU_WAIT_FOR_PARAMETERS_THUNK_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_GPU_WAIT_FOR_PARAMETERS_THUNK_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/service/buffer_assignment.h"
+#include "tensorflow/compiler/xla/service/gpu/thunk.h"
+
+namespace xla {
+namespace gpu {
+
+// A thunk that makes the stream wait for the arguments of some entry
+// computation parameters to be defined, with the wait_for_parameters callback
+// of the GpuExecutableRunOptions. Does nothing if the callback isn't set, in
+// which case the caller has already waited for all the arguments.
+class WaitForParametersThunk : public Thunk {
+ public:
+  WaitForParametersThunk(ThunkInfo thunk_info,
+                         std::vector<int64_t> parameter_numbers);
+  WaitForParametersThunk(const WaitForParametersThunk&) = delete;
+  WaitForParametersThunk& operator=(const WaitForParametersThunk&) = delete;
+
+  const std::vector<int64_t>& parameter_numbers() const {
+    return parameter_numbers_;
+  }
+  std::string ToStringExtra(int indent) const override;
+
+  Status ExecuteOnStream(const ExecuteParams& params) override;
+
+ private:
+  const std::vector<int64_t> parameter_numbers_;
+};
+
+// Inserts a WaitForParametersThunk before each thunk of `thunk_sequence` that
+// is the first one to use some entry computation parameters, and one at the
+// end of the sequence for the parameters that no thunk uses, e.g. the
+// parameters that are passed through to the outputs.
+//
+// The parameters a thunk uses are derived from the buffer slices of its LMHLO
+// op, so this must run before the compile time info of the thunks is cleared.
+// The thunks whose uses can't be derived, e.g. the control flow thunks, wait
+// for all the parameters.
+void InsertParameterWaits(ThunkSequence* thunk_sequence,
+                          absl::Span<const BufferAllocation> allocations);
+
+}  // namespace gpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_GPU_WAIT_FOR_PARAMETERS_THUNK_H_
@@ -0,0 +1,187 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/gpu/wait_for_parameters_thunk.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "mlir/Dialect/Func/IR/FuncOps.h"  // from @llvm-project
+#include "mlir/IR/BuiltinOps.h"  // from @llvm-project
+#include "mlir/IR/Operation.h"  // from @llvm-project
+#include "mlir/Parser/Parser.h"  // from @llvm-project
+#include "tensorflow/compiler/xla/mlir_hlo/lhlo/IR/lhlo_ops.h"
+#include "tensorflow/compiler/xla/service/buffer_assignment.h"
+#include "tensorflow/compiler/xla/service/gpu/buffer_allocations.h"
+#include "tensorflow/compiler/xla/service/gpu/gpu_executable_run_options.h"
+#include "tensorflow/compiler/xla/service/gpu/sequential_thunk.h"
+#include "tensorflow/compiler/xla/service/service_executable_run_options.h"
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/platform/test.h"
+
+namespace xla {
+namespace gpu {
+namespace {
+
+using ::testing::ElementsAre;
+
+// A thunk for an op, which does nothing.
+class OpThunk : public Thunk {
+ public:
+  explicit OpThunk(mlir::Operation* op) : Thunk(Kind::kKernel, ThunkInfo(op)) {}
+
+  Status ExecuteOnStream(const ExecuteParams& params) override {
+    return OkStatus();
+  }
+};
+
+class InsertParameterWaitsTest : public ::testing::Test {
+ protected:
+  // The function of the module uses its arguments 0 and 1, which are entry
+  // computation parameters 0 and 1, and writes to its arguments 3 and 4. The
+  // entry computation parameter 2 isn't used.
+  InsertParameterWaitsTest() {
+    registry_.insert<mlir::lmhlo::LmhloDialect>();
+    registry_.insert<mlir::func::FuncDialect>();
+    context_ = std::make_unique<mlir::MLIRContext>(registry_);
+    module_ = mlir::parseSourceString<mlir::ModuleOp>(R"(
+      func.func @main(%arg0 : memref<4xf32>, %arg1 : memref<4xf32>,
+                      %arg2 : memref<4xf32>, %arg3 : memref<4xf32>,
+                      %arg4 : memref<4xf32>) {
+        "lmhlo.copy" (%arg0, %arg3) : (memref<4xf32>, memref<4xf32>) -> ()
+        "lmhlo.add" (%arg0, %arg1, %arg4) : (memref<4xf32>, memref<4xf32>, memref<4xf32>) -> ()
+        "lmhlo.terminator" () : () -> ()
+      }
+    )",
+                                                      context_.get());
+    CHECK(module_);
+    auto func = mlir::cast<mlir::func::FuncOp>(module_->lookupSymbol("main"));
+    for (mlir::Operation& op : func.getBody().front()) {
+      ops_.push_back(&op);
+    }
+
+    for (int i = 0; i < 5; ++i) {
+      allocations_.emplace_back(/*index=*/i, /*size=*/16, /*color=*/0);
+      if (i < 3) {
+        allocations_.back().set_entry_computation_parameter(
+            /*parameter_number=*/i, /*param_shape_index=*/{},
+            /*parameter_aliased_with_output=*/false);
+      }
+    }
+  }
+
+  mlir::Operation* copy_op() const { return ops_[0]; }
+  mlir::Operation* add_op() const { return ops_[1]; }
+
+  mlir::DialectRegistry registry_;
+  std::unique_ptr<mlir::MLIRContext> context_;
+  mlir::OwningOpRef<mlir::ModuleOp> module_;
+  std::vector<mlir::Operation*> ops_;
+  std::vector<BufferAllocation> allocations_;
+};
+
+// Returns the parameters `thunk` waits for, which must be a
+// WaitForParametersThunk.
+std::vector<int64_t> WaitedFor(const Thunk& thunk) {
+  CHECK_EQ(thunk.kind(), Thunk::kWaitForParameters);
+  return static_cast<const WaitForParametersThunk&>(thunk).parameter_numbers();
+}
+
+TEST_F(InsertParameterWaitsTest, WaitsBeforeFirstUse) {
+  ThunkSequence thunks;
+  thunks.push_back(std::make_unique<OpThunk>(copy_op()));
+  thunks.push_back(std::make_unique<OpThunk>(add_op()));
+  Thunk* copy_thunk = thunks[0].get();
+  Thunk* add_thunk = thunks[1].get();
+
+  InsertParameterWaits(&thunks, allocations_);
+
+  ASSERT_EQ(thunks.size(), 5);
+  EXPECT_THAT(WaitedFor(*thunks[0]), ElementsAre(0));
+  EXPECT_EQ(thunks[1].get(), copy_thunk);
+  EXPECT_THAT(WaitedFor(*thunks[2]), ElementsAre(1));
+  EXPECT_EQ(thunks[3].get(), add_thunk);
+  // The unused parameter is waited for at the end.
+  EXPECT_THAT(WaitedFor(*thunks[4]), ElementsAre(2));
+}
+
+TEST_F(InsertParameterWaitsTest, ThunkWithoutOpWaitsForAllParameters) {
+  ThunkSequence thunks;
+  thunks.push_back(std::make_unique<OpThunk>(/*op=*/nullptr));
+  thunks.push_back(std::make_unique<OpThunk>(add_op()));
+
+  InsertParameterWaits(&thunks, allocations_);
+
+  ASSERT_EQ(thunks.size(), 3);
+  EXPECT_THAT(WaitedFor(*thunks[0]), ElementsAre(0, 1, 2));
+  EXPECT_EQ(thunks[1]->kind(), Thunk::kKernel);
+  EXPECT_EQ(thunks[2]->kind(), Thunk::kKernel);
+}
+
+TEST_F(InsertParameterWaitsTest, SequentialThunkWaitsForItsThunks) {
+  ThunkSequence sub_thunks;
+  sub_thunks.push_back(std::make_unique<OpThunk>(copy_op()));
+  sub_thunks.push_back(std::make_unique<OpThunk>(add_op()));
+  ThunkSequence thunks;
+  thunks.push_back(std::make_unique<SequentialThunk>(
+      Thunk::ThunkInfo(/*op=*/nullptr), std::move(sub_thunks)));
+
+  InsertParameterWaits(&thunks, allocations_);
+
+  ASSERT_EQ(thunks.size(), 3);
+  EXPECT_THAT(WaitedFor(*thunks[0]), ElementsAre(0, 1));
+  EXPECT_EQ(thunks[1]->kind(), Thunk::kSequential);
+  EXPECT_THAT(WaitedFor(*thunks[2]), ElementsAre(2));
+}
+
+TEST(WaitForParametersThunkTest, CallsTheCallback) {
+  std::vector<int64_t> waited_for;
+  GpuExecutableRunOptions gpu_run_options;
+  gpu_run_options.set_wait_for_parameters_callback(
+      [&](absl::Span<const int64_t> parameter_numbers, se::Stream* stream) {
+        waited_for.insert(waited_for.end(), parameter_numbers.begin(),
+                          parameter_numbers.end());
+      });
+  ExecutableRunOptions run_options;
+  run_options.set_gpu_executable_run_options(&gpu_run_options);
+  ServiceExecutableRunOptions service_run_options(run_options);
+  BufferAllocations buffer_allocations(/*buffers=*/{}, /*device_ordinal=*/0,
+                                       /*memory_allocator=*/nullptr);
+  Thunk::ExecuteParams params(service_run_options, buffer_allocations,
+                              /*stream=*/nullptr,
+                              /*async_comms_stream=*/nullptr);
+
+  WaitForParametersThunk thunk(Thunk::ThunkInfo(/*op=*/nullptr), {1, 3});
+  TF_ASSERT_OK(thunk.ExecuteOnStream(params));
+  EXPECT_THAT(waited_for, ElementsAre(1, 3));
+}
+
+TEST(WaitForParametersThunkTest, DoesNothingWithoutCallback) {
+  ServiceExecutableRunOptions service_run_options;
+  BufferAllocations buffer_allocations(/*buffers=*/{}, /*device_ordinal=*/0,
+                                       /*memory_allocator=*/nullptr);
+  Thunk::ExecuteParams params(service_run_options, buffer_allocations,
+                              /*stream=*/nullptr,
+                              /*async_comms_stream=*/nullptr);
+
+  WaitForParametersThunk thunk(Thunk::ThunkInfo(/*op=*/nullptr), {0});
+  TF_EXPECT_OK(thunk.ExecuteOnStream(params));
+}
+
+}  // namespace
+}  // namespace gpu
+}  // namespace xla
@@ -0,0 +1,127 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/compiler/xla/service/hlo_computation_pass.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instruction.h"
+#include "tensorflow/compiler/xla/status_macros.h"
+#include "tensorflow/tsl/platform/blocking_counter.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/logging.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+
+namespace xla {
+
+StatusOr<bool> HloComputationPass::Run(
+    HloModule* module,
+    const absl::flat_hash_set<absl::string_view>& execution_threads) {
+  std::vector<HloComputation*> computations =
+      GetComputations(module, execution_threads);
+  if (thread_pool_ != nullptr && thread_pool_->NumThreads() > 1 &&
+      computations.size() > 1) {
+    return RunConcurrently(module, computations, execution_threads);
+  }
+  bool changed = false;
+  for (HloComputation* computation : computations) {
+    TF_ASSIGN_OR_RETURN(bool computation_changed,
+                        RunOnComputation(computation));
+    changed |= computation_changed;
+  }
+  return changed;
+}
+
+StatusOr<bool> HloComputationPass::RunConcurrently(
+    HloModule* module, const std::vector<HloComputation*>& computations,
+    const absl::flat_hash_set<absl::string_view>& execution_threads) {
+  // A computation is deeper than all the computations it calls, so none of the
+  // computations of a given depth calls another one.
+  absl::flat_hash_map<const HloComputation*, int> depths;
+  for (const HloComputation* computation :
+       module->MakeComputationPostOrder(execution_threads)) {
+    int depth = 0;
+    for (const HloInstruction* instruction : computation->instructions()) {
+      for (const HloComputation* callee : instruction->called_computations()) {
+        auto it = depths.find(callee);
+        if (it != depths.end()) depth = std::max(depth, it->second + 1);
+      }
+    }
+    depths[computation] = depth;
+  }
+
+  // The instructions with an id from `first_new_id` are added by the pass.
+  std::map<int, std::vector<int>> computations_by_depth;
+  int first_new_id = 0;
+  for (int i = 0; i < computations.size(); ++i) {
+    auto it = depths.find(computations[i]);
+    computations_by_depth[it == depths.end() ? 0 : it->second].push_back(i);
+    for (const HloInstruction* instruction : computations[i]->instructions()) {
+      first_new_id = std::max(first_new_id, instruction->unique_id() + 1);
+    }
+  }
+
+  std::vector<StatusOr<bool>> results(computations.size(), false);
+  module->set_defer_instruction_name_uniquing(true);
+  for (const auto& [depth, indices] : computations_by_depth) {
+    VLOG(2) << "Running " << name() << " on " << indices.size()
+            << " computations of depth " << depth;
+    tsl::BlockingCounter counter(indices.size());
+    for (int index : indices) {
+      thread_pool_->Schedule([&, index] {
+        results[index] = RunOnComputation(computations[index]);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    if (!absl::c_all_of(indices, [&](int i) { return results[i].ok(); })) {
+      break;
+    }
+  }
+  module->set_defer_instruction_name_uniquing(false);
+
+  // Assigns the ids and names of the added instructions in a deterministic
+  // order.
+  for (HloComputation* computation : computations) {
+    for (HloInstruction* instruction : computation->instructions()) {
+      if (instruction->unique_id() < first_new_id) continue;
+      instruction->ClearUniqueIdInternal();
+      instruction->SetUniqueId(module->NewUniqueInstructionId());
+      instruction->UniquifyName(&module->instruction_name_uniquer());
+    }
+  }
+
+  bool changed = false;
+  for (StatusOr<bool>& result : results) {
+    TF_RETURN_IF_ERROR(result.status());
+    changed |= *result;
+  }
+  return changed;
+}
+
+std::unique_ptr<tsl::thread::ThreadPool> CreateComputationThreadPool(
+    const HloModule& module) {
+  const int64_t num_threads =
+      module.config().debug_options().xla_hlo_pass_computation_threads();
+  if (num_threads <= 1) return nullptr;
+  return std::make_unique<tsl::thread::ThreadPool>(
+      tsl::Env::Default(), "xla_hlo_pass_computations", num_threads);
+}
+
+}  // namespace xla
@@ -0,0 +1,86 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_HLO_COMPUTATION_PASS_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_HLO_COMPUTATION_PASS_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_computation.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
+#include "tensorflow/compiler/xla/service/hlo_pass_interface.h"
+#include "tensorflow/compiler/xla/statusor.h"
+
+namespace xla {
+
+// Base class for module passes which run on each computation of the module on
+// its own. Given a thread pool with SetComputationThreadPool, the pass runs on
+// the computations concurrently: the computations are grouped by their depth in
+// the call graph, and the groups are run one after the other starting from the
+// computations which call no other computation, so that the computations called
+// by a computation have been run on before it.
+//
+// The result doesn't depend on the number of threads: the ids and the names of
+// the instructions added by the pass are assigned once all the computations
+// have been run on, in the order of GetComputations. It may differ from the
+// result of the sequential run if the pass depends on the order in which the
+// computations are run on.
+class HloComputationPass : public HloModulePass {
+ public:
+  using HloPassInterface::Run;
+  StatusOr<bool> Run(
+      HloModule* module,
+      const absl::flat_hash_set<absl::string_view>& execution_threads) override;
+
+  void SetComputationThreadPool(tsl::thread::ThreadPool* thread_pool) override {
+    thread_pool_ = thread_pool;
+  }
+
+ protected:
+  // Runs the pass on `computation` and returns whether it changed it. To be
+  // run concurrently on several computations, the pass must only change
+  // `computation` and only read it and the computations it calls. In
+  // particular it must not add or remove computations, change the schedule of
+  // the module or rename instructions with HloModule::SetAndUniquifyInstrName,
+  // and the state of the pass it changes must be thread-safe.
+  virtual StatusOr<bool> RunOnComputation(HloComputation* computation) = 0;
+
+  // Returns the computations to run the pass on. Defaults to the non-fusion
+  // computations in post order.
+  virtual std::vector<HloComputation*> GetComputations(
+      HloModule* module,
+      const absl::flat_hash_set<absl::string_view>& execution_threads) {
+    return module->MakeNonfusionComputations(execution_threads);
+  }
+
+ private:
+  StatusOr<bool> RunConcurrently(
+      HloModule* module, const std::vector<HloComputation*>& computations,
+      const absl::flat_hash_set<absl::string_view>& execution_threads);
+
+  tsl::thread::ThreadPool* thread_pool_ = nullptr;
+};
+
+// Returns the thread pool for the pipelines compiling `module` to run their
+// HloComputationPasses on, or null if xla_hlo_pass_computation_threads is not
+// greater than 1.
+std::unique_ptr<tsl::thread::ThreadPool> CreateComputationThreadPool(
+    const HloModule& module);
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_HLO_COMPUTATION_PASS_H_
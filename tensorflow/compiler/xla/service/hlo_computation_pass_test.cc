@@ -0,0 +1,194 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/compiler/xla/service/hlo_computation_pass.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_replace.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_computation.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instruction.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_opcode.h"
+#include "tensorflow/compiler/xla/service/hlo_module_config.h"
+#include "tensorflow/compiler/xla/literal_util.h"
+#include "tensorflow/compiler/xla/service/hlo_cse.h"
+#include "tensorflow/compiler/xla/service/hlo_pass_pipeline.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/compiler/xla/util.h"
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+
+namespace xla {
+namespace {
+
+class HloComputationPassTest : public HloTestBase {};
+
+// A pass which replaces negate(x) with subtract(0, x), and which fails on the
+// computations named 'fail'.
+class NegateToSubtractPass : public HloComputationPass {
+ public:
+  absl::string_view name() const override { return "negate-to-subtract"; }
+
+ protected:
+  StatusOr<bool> RunOnComputation(HloComputation* computation) override {
+    if (computation->name() == "fail") {
+      return InternalError("Failed on %s", computation->name());
+    }
+    bool changed = false;
+    for (HloInstruction* instruction :
+         computation->MakeInstructionPostOrder()) {
+      if (instruction->opcode() != HloOpcode::kNegate) continue;
+      const Shape& shape = instruction->shape();
+      HloInstruction* zero = computation->AddInstruction(
+          HloInstruction::CreateConstant(
+              LiteralUtil::Zero(shape.element_type())));
+      TF_RETURN_IF_ERROR(computation->ReplaceWithNewInstruction(
+          instruction,
+          HloInstruction::CreateBinary(shape, HloOpcode::kSubtract, zero,
+                                       instruction->mutable_operand(0))));
+      changed = true;
+    }
+    return changed;
+  }
+};
+
+constexpr char kModule[] = R"(
+HloModule test
+
+f0 {
+  p0 = f32[] parameter(0)
+  ROOT n0 = f32[] negate(p0)
+}
+
+f1 {
+  p1 = f32[] parameter(0)
+  n1 = f32[] negate(p1)
+  ROOT c1 = f32[] call(n1), to_apply=f0
+}
+
+f2 {
+  p2 = f32[] parameter(0)
+  n2 = f32[] negate(p2)
+  ROOT m2 = f32[] negate(n2)
+}
+
+f3 {
+  p3 = f32[] parameter(0)
+  ROOT e3 = f32[] exponential(p3)
+}
+
+ENTRY entry {
+  p = f32[] parameter(0)
+  a = f32[] call(p), to_apply=f1
+  b = f32[] call(p), to_apply=f2
+  c = f32[] call(p), to_apply=f3
+  n = f32[] negate(p)
+  ROOT t = (f32[], f32[], f32[], f32[]) tuple(a, b, c, n)
+}
+)";
+
+TEST_F(HloComputationPassTest, ConcurrentRunMatchesSequentialRun) {
+  TF_ASSERT_OK_AND_ASSIGN(auto expected_module,
+                          ParseAndReturnVerifiedModule(kModule));
+  NegateToSubtractPass sequential_pass;
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          RunHloPass(&sequential_pass, expected_module.get()));
+  EXPECT_TRUE(changed);
+
+  for (int num_threads : {2, 4, 8}) {
+    TF_ASSERT_OK_AND_ASSIGN(auto module, ParseAndReturnVerifiedModule(kModule));
+    tsl::thread::ThreadPool thread_pool(tsl::Env::Default(), "test",
+                                        num_threads);
+    NegateToSubtractPass pass;
+    pass.SetComputationThreadPool(&thread_pool);
+    TF_ASSERT_OK_AND_ASSIGN(changed, RunHloPass(&pass, module.get()));
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(module->ToString(), expected_module->ToString());
+    for (const HloComputation* computation : module->computations()) {
+      for (const HloInstruction* instruction : computation->instructions()) {
+        EXPECT_NE(instruction->opcode(), HloOpcode::kNegate);
+      }
+    }
+  }
+}
+
+TEST_F(HloComputationPassTest, ConcurrentRunReturnsError) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto module, ParseAndReturnVerifiedModule(absl::StrReplaceAll(
+                       kModule, {{"f2 {", "fail {"}, {"=f2", "=fail"}})));
+  tsl::thread::ThreadPool thread_pool(tsl::Env::Default(), "test", 4);
+  NegateToSubtractPass pass;
+  pass.SetComputationThreadPool(&thread_pool);
+  EXPECT_FALSE(pass.Run(module.get()).ok());
+}
+
+TEST_F(HloComputationPassTest, PipelineRunsCseConcurrently) {
+  constexpr char kCseModule[] = R"(
+HloModule test
+
+f0 {
+  p0 = f32[] parameter(0)
+  a0 = f32[] add(p0, p0)
+  b0 = f32[] add(p0, p0)
+  ROOT m0 = f32[] multiply(a0, b0)
+}
+
+f1 {
+  p1 = f32[] parameter(0)
+  a1 = f32[] exponential(p1)
+  b1 = f32[] exponential(p1)
+  ROOT m1 = f32[] multiply(a1, b1)
+}
+
+ENTRY entry {
+  p = f32[] parameter(0)
+  a = f32[] call(p), to_apply=f0
+  b = f32[] call(p), to_apply=f1
+  c = f32[] call(p), to_apply=f1
+  ROOT t = (f32[], f32[], f32[]) tuple(a, b, c)
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kCseModule));
+  tsl::thread::ThreadPool thread_pool(tsl::Env::Default(), "test", 4);
+  HloPassPipeline pipeline("cse");
+  pipeline.AddPass<HloCSE>(/*is_layout_sensitive=*/false);
+  pipeline.SetComputationThreadPool(&thread_pool);
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunHloPass(&pipeline, module.get()));
+  EXPECT_TRUE(changed);
+  EXPECT_EQ(FindComputation(module.get(), "f0")->instruction_count(), 3);
+  EXPECT_EQ(FindComputation(module.get(), "f1")->instruction_count(), 3);
+  EXPECT_EQ(module->entry_computation()->instruction_count(), 4);
+}
+
+TEST_F(HloComputationPassTest, CreatesThreadPoolFromDebugOptions) {
+  DebugOptions debug_options = GetDebugOptionsForTest();
+  HloModuleConfig config;
+  config.set_debug_options(debug_options);
+  EXPECT_EQ(CreateComputationThreadPool(HloModule("sequential", config)),
+            nullptr);
+
+  debug_options.set_xla_hlo_pass_computation_threads(3);
+  config.set_debug_options(debug_options);
+  std::unique_ptr<tsl::thread::ThreadPool> thread_pool =
+      CreateComputationThreadPool(HloModule("concurrent", config));
+  ASSERT_NE(thread_pool, nullptr);
+  EXPECT_EQ(thread_pool->NumThreads(), 3);
+}
+
+}  // namespace
+}  // namespace xla
@@ -16,16 +16,19 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_XLA_SERVICE_HLO_CSE_H_
 #define TENSORFLOW_COMPILER_XLA_SERVICE_HLO_CSE_H_
 
+#include <vector>
+
 #include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
-#include "tensorflow/compiler/xla/service/hlo_pass_interface.h"
+#include "tensorflow/compiler/xla/service/hlo_computation_pass.h"
 
 namespace xla {
 
 // A pass which performs common-subexpression elimination. Identical constants
 // and identical instructions with the same operands are commoned. The pass
 // iterates over the instructions in topological order which enables the pass to
-// find arbitrarily large common expressions.
-class HloCSE : public HloModulePass {
+// find arbitrarily large common expressions. The computations can be run on
+// concurrently, see HloComputationPass.
+class HloCSE : public HloComputationPass {
  public:
   // If is_layout_sensitive is true, then the simplifier preserves layout during
   // transformation. Otherwise, layout is ignored.
@@ -38,8 +41,11 @@ class HloCSE : public HloModulePass {
 
   // Run CSE on the given module. Returns whether the module was changed (common
   // subexpressions were found and eliminated).
-  using HloPassInterface::Run;
-  StatusOr<bool> Run(
+  using HloComputationPass::Run;
+
+ protected:
+  StatusOr<bool> RunOnComputation(HloComputation* computation) override;
+  std::vector<HloComputation*> GetComputations(
       HloModule* module,
       const absl::flat_hash_set<absl::string_view>& execution_threads) override;
 
@@ -24,6 +24,12 @@ limitations under the License.
 #include "tensorflow/compiler/xla/statusor.h"
 #include "tensorflow/compiler/xla/types.h"
 
+namespace tsl {
+namespace thread {
+class ThreadPool;
+}  // namespace thread
+}  // namespace tsl
+
 namespace xla {
 
 // Base class for HLO passes. These are used with the HloPassPipeline to
@@ -140,6 +146,11 @@ class HloPassInterface {
       const absl::flat_hash_set<absl::string_view>& execution_threads) = 0;
 
   virtual bool IsPassPipeline() { return false; }
+
+  // Sets the thread pool to run the pass on several computations concurrently,
+  // for the passes which support it (see HloComputationPass). The pool must
+  // outlive the runs of the pass. nullptr runs the pass sequentially.
+  virtual void SetComputationThreadPool(tsl::thread::ThreadPool* thread_pool) {}
 };
 
 // Base class for passes which are module-scoped.
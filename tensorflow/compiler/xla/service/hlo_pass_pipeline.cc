@@ -121,6 +121,30 @@ void SetInstructionMetadata(HloModuleGroup& module_group) {
   }
 }
 
+int64_t InstructionCount(const HloModule& module) {
+  return module.instruction_count();
+}
+
+int64_t InstructionCount(const HloModuleGroup& module_group) {
+  int64_t count = 0;
+  for (const HloModule* module : module_group.modules()) {
+    count += module->instruction_count();
+  }
+  return count;
+}
+
+void DumpPassStats(const HloModule& module, absl::string_view pipeline_name,
+                   absl::string_view json) {
+  DumpToFileInDirOrStdout(module, /*file_prefix=*/"",
+                          absl::StrCat(pipeline_name, ".hlo_pass_stats.json"),
+                          json);
+}
+
+void DumpPassStats(const HloModuleGroup& module_group,
+                   absl::string_view pipeline_name, absl::string_view json) {
+  DumpPassStats(module_group.module(0), pipeline_name, json);
+}
+
 }  // namespace
 
 template <typename HloT>
@@ -154,6 +178,11 @@ StatusOr<bool> HloPassPipeline::RunPassesInternal(
   // Copy string by value since debug options could get clobbered in an hlo
   // module group pass.
   std::string dump_regex = debug_options.xla_dump_hlo_pass_re();
+  const bool dump_pass_stats = debug_options.xla_dump_hlo_pass_stats();
+  if (dump_pass_stats && owned_compilation_stats_ != nullptr) {
+    owned_compilation_stats_ = CompilationStats::MakeStats();
+    compilation_stats_ = owned_compilation_stats_.get();
+  }
   static constexpr absl::string_view kPipelineStart = "pipeline-start";
   static constexpr absl::string_view kPipelineEnd = "pipeline-end";
   std::string pipeline_name = std::string(name());
@@ -178,9 +207,12 @@ StatusOr<bool> HloPassPipeline::RunPassesInternal(
     VLOG(1) << "  HLO pass " << pass_name;
     VLOG(2) << "  Module hash " << absl::HashOf(*hlo);
     if (!pass->IsPassPipeline()) {
-      compilation_stats_->StartPass(pass_name);
+      compilation_stats_->StartPass(pass_name, InstructionCount(*hlo));
     }
     RecordPassStartMetadata(*hlo, pass_name, pipeline_name);
+    if (computation_thread_pool_ != nullptr) {
+      pass->SetComputationThreadPool(computation_thread_pool_);
+    }
     // Embed RunHelper into lambda to enable recording of error statuses
     auto run_helper_lambda =
         [this, pass_name](
@@ -220,9 +252,13 @@ StatusOr<bool> HloPassPipeline::RunPassesInternal(
       TF_RETURN_IF_ERROR(run_invariant_checkers_lambda(hlo, pass_name));
     }
     if (!pass->IsPassPipeline()) {
-      compilation_stats_->EndPass(pass_name);
+      compilation_stats_->EndPass(pass_name, InstructionCount(*hlo));
     }
   }
+  if (dump_pass_stats) {
+    DumpPassStats(*hlo, pipeline_name,
+                  compilation_stats_->CompilationReportJson());
+  }
   return changed;
 }
 
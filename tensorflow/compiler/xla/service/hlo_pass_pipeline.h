@@ -39,8 +39,8 @@ class HloPassPipeline : public HloPassInterface {
                            CompilationStats* compilation_stats = nullptr)
       : name_(name), compilation_stats_(compilation_stats) {
     if (compilation_stats == nullptr) {
-      empty_compilation_stats_ = CompilationStats::MakeNoopStats();
-      compilation_stats_ = empty_compilation_stats_.get();
+      owned_compilation_stats_ = CompilationStats::MakeNoopStats();
+      compilation_stats_ = owned_compilation_stats_.get();
     }
   }
   absl::string_view name() const override { return name_; }
@@ -89,6 +89,12 @@ class HloPassPipeline : public HloPassInterface {
 
   bool IsPassPipeline() override { return true; }
 
+  // Sets the thread pool of all the passes of the pipeline, including those of
+  // the nested pipelines.
+  void SetComputationThreadPool(tsl::thread::ThreadPool* thread_pool) override {
+    computation_thread_pool_ = thread_pool;
+  }
+
   // Return size of passes_.
   int PassesSize() { return passes_.size(); }
   // Return reference to pass specified by index.
@@ -153,12 +159,14 @@ class HloPassPipeline : public HloPassInterface {
   const std::string name_;
   std::vector<std::unique_ptr<HloPassInterface>> passes_;
   std::vector<std::unique_ptr<HloPassInterface>> invariant_checkers_;
+  tsl::thread::ThreadPool* computation_thread_pool_ = nullptr;
   bool run_called_ = false;
 
   CompilationStats* compilation_stats_;
-  // Default stats instance for when one is not passed in the constructor.
-  // Use via compilation_stats_, not directly.
-  std::unique_ptr<CompilationStats> empty_compilation_stats_;
+  // Default stats instance for when one is not passed in the constructor. It
+  // collects the stats only when --xla_dump_hlo_pass_stats is set. Use via
+  // compilation_stats_, not directly.
+  std::unique_ptr<CompilationStats> owned_compilation_stats_;
 
   // Allow PhaseOrderPipeline to modify private passes_ member in order to
   // perform PhaseOrdering.
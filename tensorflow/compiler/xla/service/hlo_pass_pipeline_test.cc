@@ -22,11 +22,15 @@ limitations under the License.
 #include "tensorflow/compiler/xla/tests/hlo_test_base.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/path.h"
+#include "tensorflow/tsl/platform/test.h"
 
 namespace xla {
 namespace {
 
 using ::testing::ElementsAre;
+using ::testing::HasSubstr;
 using ::testing::SizeIs;
 using ::testing::StrEq;
 
@@ -176,6 +180,40 @@ ENTRY main {
   EXPECT_FALSE(changed);
 }
 
+TEST_F(HloPassPipelineTest, DumpsPassStats) {
+  const std::string module_str = R"(
+HloModule DumpsPassStats
+
+ENTRY main {
+  a = f32[] parameter(0)
+  b = f32[] parameter(1)
+  ROOT foo = f32[] multiply(a, b)
+}
+)";
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<VerifiedHloModule> module,
+                          ParseAndReturnVerifiedModule(module_str));
+  const std::string dump_dir =
+      tsl::io::JoinPath(tsl::testing::TmpDir(), TestName());
+  DebugOptions debug_options = module->config().debug_options();
+  debug_options.set_xla_dump_hlo_pass_stats(true);
+  debug_options.set_xla_dump_to(dump_dir);
+  module->config().set_debug_options(debug_options);
+  HloPassPipeline pipeline(TestName());
+  pipeline.AddPass<FooToBarModulePass>();
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, pipeline.Run(module.get()));
+  EXPECT_TRUE(changed);
+
+  std::vector<std::string> paths;
+  TF_ASSERT_OK(tsl::Env::Default()->GetMatchingPaths(
+      tsl::io::JoinPath(dump_dir, "*.hlo_pass_stats.json"), &paths));
+  ASSERT_THAT(paths, SizeIs(1));
+  std::string json;
+  TF_ASSERT_OK(tsl::ReadFileToString(tsl::Env::Default(), paths[0], &json));
+  EXPECT_THAT(json, HasSubstr("\"pass\": \"foo2bar\""));
+  EXPECT_THAT(json, HasSubstr("\"instructions_before\": 3"));
+  EXPECT_THAT(json, HasSubstr("\"instructions_after\": 3"));
+}
+
 TEST_F(HloPassPipelineTest, ModulePassChangedForParallelThread) {
   // Test an HLO module pass which changes a module.
   const std::string module_str = R"(
@@ -321,9 +359,9 @@ ENTRY main {
     Status status = pipeline.Run(module.get()).status();
     ASSERT_IS_NOT_OK(status);
     EXPECT_THAT(status.error_message(),
-                ::testing::HasSubstr("Module has instruction named bar"));
+                HasSubstr("Module has instruction named bar"));
     EXPECT_THAT(status.error_message(),
-                ::testing::HasSubstr("Failed after foo2bar"));
+                HasSubstr("Failed after foo2bar"));
   }
 
   {
@@ -334,9 +372,9 @@ ENTRY main {
     Status status = pipeline.Run(module.get()).status();
     ASSERT_IS_NOT_OK(status);
     EXPECT_THAT(status.error_message(),
-                ::testing::HasSubstr("Module has instruction named bar"));
+                HasSubstr("Module has instruction named bar"));
     EXPECT_THAT(status.error_message(),
-                ::testing::HasSubstr("Failed after pipeline-start"));
+                HasSubstr("Failed after pipeline-start"));
   }
 }
 
@@ -360,7 +398,7 @@ ENTRY main {
   ASSERT_IS_NOT_OK(status);
   EXPECT_THAT(
       status.error_message(),
-      ::testing::HasSubstr("Module group pass cannot be run on a module"));
+      HasSubstr("Module group pass cannot be run on a module"));
 }
 
 // Test that metadata is set when a module group goes through a pass pipeline.
@@ -0,0 +1,221 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/host_offloader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_computation.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_opcode.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_schedule.h"
+#include "tensorflow/compiler/xla/layout_util.h"
+#include "tensorflow/compiler/xla/service/hlo_alias_analysis.h"
+#include "tensorflow/compiler/xla/service/hlo_buffer.h"
+#include "tensorflow/compiler/xla/service/hlo_live_range.h"
+#include "tensorflow/compiler/xla/service/hlo_value.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/status_macros.h"
+
+namespace xla {
+
+namespace {
+
+// An idle interval of a value: the value isn't used by the instructions
+// strictly between the times 'last_use_before' and 'first_use_after' of the
+// schedule.
+struct IdleInterval {
+  int64_t last_use_before;
+  int64_t first_use_after;
+};
+
+// Returns whether 'value' can be offloaded: it is an array defined by the
+// entry computation which doesn't share its buffer, and it is only read by its
+// direct users.
+bool CanOffload(const HloValue& value, const HloAliasAnalysis& alias_analysis,
+                const HloComputation* entry, int64_t default_memory_space) {
+  const HloInstruction* instruction = value.defining_instruction();
+  if (instruction->parent() != entry || !value.defining_index().empty() ||
+      !value.shape().IsArray() || !LayoutUtil::HasLayout(value.shape()) ||
+      value.shape().layout().memory_space() != default_memory_space ||
+      value.positions().size() != 1 || alias_analysis.ValueLivesOut(value) ||
+      alias_analysis.GetBufferContainingValue(value).values().size() != 1) {
+    return false;
+  }
+  switch (instruction->opcode()) {
+    case HloOpcode::kParameter:
+    case HloOpcode::kConstant:
+    case HloOpcode::kCopyStart:
+    case HloOpcode::kCopyDone:
+      return false;
+    default:
+      break;
+  }
+  return absl::c_all_of(value.GetUses(), [&](const HloUse& use) {
+    return use.instruction->parent() == entry &&
+           use.instruction->operand(use.operand_number) == instruction;
+  });
+}
+
+}  // namespace
+
+StatusOr<bool> HostOffloader::Run(
+    HloModule* module,
+    const absl::flat_hash_set<absl::string_view>& execution_threads) {
+  TF_RET_CHECK(module->has_schedule());
+  HloComputation* entry = module->entry_computation();
+  if (!HloInstruction::IsThreadIncluded(entry->execution_thread(),
+                                        execution_threads)) {
+    return false;
+  }
+
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<HloAliasAnalysis> alias_analysis,
+                      HloAliasAnalysis::Run(module));
+  TF_ASSIGN_OR_RETURN(
+      std::unique_ptr<HloLiveRange> live_range,
+      HloLiveRange::Run(module->schedule(), *alias_analysis, entry,
+                        /*module_scoped_analysis=*/false));
+  const std::vector<HloInstruction*>& sequence =
+      module->schedule().sequence(entry).instructions();
+  const auto& instruction_schedule = live_range->instruction_schedule();
+
+  // elapsed[i] is the estimated run time of the first i instructions of the
+  // schedule.
+  std::vector<double> elapsed(sequence.size() + 1, 0.0);
+  for (int64_t i = 0; i < sequence.size(); ++i) {
+    elapsed[i + 1] =
+        elapsed[i] + options_.instruction_elapsed_seconds(*sequence[i]);
+  }
+  auto elapsed_between = [&](int64_t begin, int64_t end) {
+    return begin < end ? elapsed[end] - elapsed[begin] : 0.0;
+  };
+
+  std::vector<const HloValue*> values;
+  for (const auto& [value, time_bound] : live_range->buffer_live_ranges()) {
+    values.push_back(value);
+  }
+  absl::c_sort(values, HloValue::IdLessThan);
+
+  // The instructions to insert after each instruction of the schedule.
+  std::vector<std::vector<HloInstruction*>> inserted_after(sequence.size());
+  bool changed = false;
+  for (const HloValue* value : values) {
+    if (!CanOffload(*value, *alias_analysis, entry,
+                    Layout::kDefaultMemorySpace)) {
+      continue;
+    }
+    const int64_t size = options_.shape_size_bytes(value->shape());
+    if (size < options_.min_size_in_bytes) continue;
+    const HloLiveRange::TimeBound& time_bound =
+        live_range->buffer_live_ranges().at(value);
+
+    // Find the idle interval of the value with the longest run time.
+    std::vector<int64_t> use_times = {time_bound.start};
+    for (const HloUse& use : value->GetUses()) {
+      use_times.push_back(instruction_schedule.at(use.instruction));
+    }
+    absl::c_sort(use_times);
+    use_times.erase(std::unique(use_times.begin(), use_times.end()),
+                    use_times.end());
+    std::optional<IdleInterval> interval;
+    double interval_elapsed = 0.0;
+    for (int64_t i = 1; i < use_times.size(); ++i) {
+      const double interval_elapsed_i =
+          elapsed_between(use_times[i - 1] + 1, use_times[i]);
+      if (interval_elapsed_i > interval_elapsed) {
+        interval = IdleInterval{use_times[i - 1], use_times[i]};
+        interval_elapsed = interval_elapsed_i;
+      }
+    }
+    // Both transfers must be hidden by the instructions of the interval.
+    const double transfer_seconds = size / options_.host_bytes_per_second;
+    if (!interval.has_value() || interval_elapsed < 2 * transfer_seconds) {
+      continue;
+    }
+
+    // The offload completes once the instructions after the last use before
+    // the interval took the time of a transfer, and the prefetch starts when
+    // the instructions before the first use after the interval take the time
+    // of a transfer.
+    int64_t offload_done_after = interval->last_use_before + 1;
+    while (elapsed_between(interval->last_use_before + 1,
+                           offload_done_after + 1) < transfer_seconds) {
+      ++offload_done_after;
+    }
+    int64_t prefetch_start_after = interval->first_use_after - 1;
+    while (elapsed_between(prefetch_start_after + 1,
+                           interval->first_use_after) < transfer_seconds) {
+      --prefetch_start_after;
+    }
+    TF_RET_CHECK(offload_done_after <= prefetch_start_after);
+
+    HloInstruction* instruction = value->defining_instruction();
+    VLOG(1) << "Offloading " << instruction->name() << " (" << size
+            << " bytes) to the host between "
+            << sequence[interval->last_use_before]->name() << " and "
+            << sequence[interval->first_use_after]->name();
+    const Shape& device_shape = instruction->shape();
+    Shape host_shape = device_shape;
+    host_shape.mutable_layout()->set_memory_space(options_.host_memory_space);
+    const Shape context = ShapeUtil::MakeShape(U32, {});
+
+    HloInstruction* offload_start =
+        entry->AddInstruction(HloInstruction::CreateCopyStart(
+            ShapeUtil::MakeTupleShape({host_shape, device_shape, context}),
+            instruction));
+    HloInstruction* offload_done = entry->AddInstruction(
+        HloInstruction::CreateUnary(host_shape, HloOpcode::kCopyDone,
+                                    offload_start));
+    HloInstruction* prefetch_start =
+        entry->AddInstruction(HloInstruction::CreateCopyStart(
+            ShapeUtil::MakeTupleShape({device_shape, host_shape, context}),
+            offload_done));
+    HloInstruction* prefetch_done = entry->AddInstruction(
+        HloInstruction::CreateUnary(device_shape, HloOpcode::kCopyDone,
+                                    prefetch_start));
+    inserted_after[interval->last_use_before].push_back(offload_start);
+    inserted_after[offload_done_after].push_back(offload_done);
+    inserted_after[prefetch_start_after].push_back(prefetch_start);
+    inserted_after[interval->first_use_after - 1].push_back(prefetch_done);
+
+    for (HloInstruction* user :
+         std::vector<HloInstruction*>(instruction->users())) {
+      if (user != offload_start &&
+          instruction_schedule.at(user) >= interval->first_use_after) {
+        TF_RETURN_IF_ERROR(instruction->ReplaceUseWith(user, prefetch_done));
+      }
+    }
+    changed = true;
+  }
+
+  if (changed) {
+    HloInstructionSequence new_sequence;
+    for (int64_t i = 0; i < sequence.size(); ++i) {
+      new_sequence.push_back(sequence[i]);
+      for (HloInstruction* instruction : inserted_after[i]) {
+        new_sequence.push_back(instruction);
+      }
+    }
+    module->schedule().set_sequence(entry, std::move(new_sequence));
+  }
+  return changed;
+}
+
+}  // namespace xla
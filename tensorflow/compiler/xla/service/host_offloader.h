@@ -0,0 +1,74 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_HOST_OFFLOADER_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_HOST_OFFLOADER_H_
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instruction.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
+#include "tensorflow/compiler/xla/service/hlo_cost_analysis.h"
+#include "tensorflow/compiler/xla/service/hlo_pass_interface.h"
+
+namespace xla {
+
+// Offloads the long-lived values of the entry computation, e.g. the
+// activations of the forward pass used again by the backward pass, to the host
+// memory space, and prefetches them back before their next use.
+//
+// The pass runs on a scheduled module after layout assignment. For each value
+// whose live range has an idle interval long enough to hide both transfers at
+// the host bandwidth, it inserts
+//
+//   offload  = copy-start(value) / copy-done  (in the host memory space)
+//   prefetch = copy-start(offload) / copy-done (in the default memory space)
+//
+// and makes the uses after the interval read the prefetched value, so that the
+// value doesn't occupy device memory during the interval. The copies are
+// inserted in the schedule as early and as late as the bandwidth allows, and
+// can be rescheduled by the latency-hiding scheduler with
+// SchedulerConfig::schedule_copies.
+class HostOffloader : public HloModulePass {
+ public:
+  struct Options {
+    // The memory space of the (pinned) host memory in the layouts.
+    int64_t host_memory_space = 5;
+    // Smaller values aren't worth the transfers.
+    int64_t min_size_in_bytes = 1 << 20;
+    // Bandwidth of the transfers between the device and the host, in bytes/s.
+    double host_bytes_per_second;
+    HloCostAnalysis::ShapeSizeFunction shape_size_bytes;
+    // Returns the estimated run time of an instruction, in seconds.
+    std::function<double(const HloInstruction&)> instruction_elapsed_seconds;
+  };
+
+  explicit HostOffloader(Options options) : options_(std::move(options)) {}
+  absl::string_view name() const override { return "host-offloader"; }
+
+  using HloPassInterface::Run;
+  StatusOr<bool> Run(
+      HloModule* module,
+      const absl::flat_hash_set<absl::string_view>& execution_threads) override;
+
+ private:
+  Options options_;
+};
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_HOST_OFFLOADER_H_
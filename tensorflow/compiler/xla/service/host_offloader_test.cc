@@ -0,0 +1,132 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/host_offloader.h"
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instruction.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_module.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_schedule.h"
+#include "tensorflow/compiler/xla/service/hlo_matchers.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/tsl/platform/statusor.h"
+
+namespace xla {
+namespace {
+
+namespace op = xla::testing::opcode_matchers;
+
+constexpr int64_t kHostMemorySpace = 5;
+
+// The activation is used at the beginning and at the end of the schedule.
+constexpr char kHloModule[] = R"(
+HloModule module, is_scheduled=true
+
+ENTRY entry {
+  p0 = f32[1024]{0} parameter(0)
+  act = f32[1024]{0} exponential(p0)
+  fwd0 = f32[1024]{0} negate(act)
+  fwd1 = f32[1024]{0} negate(fwd0)
+  fwd2 = f32[1024]{0} negate(fwd1)
+  fwd3 = f32[1024]{0} negate(fwd2)
+  fwd4 = f32[1024]{0} negate(fwd3)
+  ROOT bwd = f32[1024]{0} multiply(fwd4, act)
+}
+)";
+
+class HostOffloaderTest : public HloTestBase {
+ protected:
+  // Each instruction takes a second, and each transfer of the activation takes
+  // 'transfer_seconds'.
+  static HostOffloader::Options GetOptions(double transfer_seconds) {
+    HostOffloader::Options options;
+    options.host_memory_space = kHostMemorySpace;
+    options.min_size_in_bytes = 0;
+    options.host_bytes_per_second = 4096 / transfer_seconds;
+    options.shape_size_bytes = [](const Shape& shape) {
+      return ShapeUtil::ByteSizeOf(shape, /*pointer_size=*/8);
+    };
+    options.instruction_elapsed_seconds = [](const HloInstruction&) {
+      return 1.0;
+    };
+    return options;
+  }
+
+  static std::vector<std::string> ScheduledNames(const HloModule& module) {
+    std::vector<std::string> names;
+    const HloInstructionSequence& sequence =
+        module.schedule().sequence(module.entry_computation());
+    for (const HloInstruction* instruction : sequence.instructions()) {
+      names.push_back(instruction->opcode() == HloOpcode::kCopyStart ||
+                              instruction->opcode() == HloOpcode::kCopyDone
+                          ? HloOpcodeString(instruction->opcode())
+                          : instruction->name());
+    }
+    return names;
+  }
+};
+
+TEST_F(HostOffloaderTest, OffloadsAndPrefetchesActivation) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kHloModule));
+  TF_ASSERT_OK_AND_ASSIGN(
+      bool changed,
+      HostOffloader(GetOptions(/*transfer_seconds=*/1.0)).Run(module.get()));
+  EXPECT_TRUE(changed);
+
+  const HloInstruction* root = module->entry_computation()->root_instruction();
+  EXPECT_THAT(root,
+              op::Multiply(op::Negate(),
+                           op::AsyncCopy(Layout::kDefaultMemorySpace,
+                                         kHostMemorySpace,
+                                         op::AsyncCopy(
+                                             kHostMemorySpace,
+                                             Layout::kDefaultMemorySpace,
+                                             op::Exp()))));
+  EXPECT_THAT(module->entry_computation()
+                  ->GetInstructionWithName("fwd0")
+                  ->operand(0),
+              op::Exp());
+  // Each transfer is hidden by one instruction.
+  EXPECT_THAT(ScheduledNames(*module),
+              ::testing::ElementsAre("p0", "act", "fwd0", "copy-start", "fwd1",
+                                     "copy-done", "fwd2", "fwd3", "copy-start",
+                                     "fwd4", "copy-done", "bwd"));
+}
+
+TEST_F(HostOffloaderTest, DoesNotOffloadIfTransfersCannotBeHidden) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kHloModule));
+  TF_ASSERT_OK_AND_ASSIGN(
+      bool changed,
+      HostOffloader(GetOptions(/*transfer_seconds=*/3.0)).Run(module.get()));
+  EXPECT_FALSE(changed);
+}
+
+TEST_F(HostOffloaderTest, DoesNotOffloadSmallValues) {
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(kHloModule));
+  HostOffloader::Options options = GetOptions(/*transfer_seconds=*/1.0);
+  options.min_size_in_bytes = 8192;
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          HostOffloader(options).Run(module.get()));
+  EXPECT_FALSE(changed);
+}
+
+}  // namespace
+}  // namespace xla
@@ -56,7 +56,8 @@ namespace xla {
 namespace {
 struct CanonicalAsyncOp {
   HloOpcode outer;  // kAsyncStart or kAsyncDone
-  HloOpcode inner;  // kAllReduce, kAllGather, kAllToAll, kCollectivePermute
+  HloOpcode inner;  // kAllReduce, kAllGather, kAllToAll, kCollectivePermute,
+                    // kCopy
 };
 
 CanonicalAsyncOp GetCanonicalAsyncOp(const HloInstruction& hlo) {
@@ -76,6 +77,10 @@ CanonicalAsyncOp GetCanonicalAsyncOp(const HloInstruction& hlo) {
       return {HloOpcode::kAsyncDone, HloOpcode::kAllGather};
     case HloOpcode::kCollectivePermuteDone:
       return {HloOpcode::kAsyncDone, HloOpcode::kCollectivePermute};
+    case HloOpcode::kCopyStart:
+      return {HloOpcode::kAsyncStart, HloOpcode::kCopy};
+    case HloOpcode::kCopyDone:
+      return {HloOpcode::kAsyncDone, HloOpcode::kCopy};
     default:
       return {hlo.opcode(), hlo.opcode()};
   }
@@ -130,6 +135,8 @@ bool AsyncTracker::IsSupportedAsyncDone(const HloInstruction& hlo) const {
       case HloOpcode::kAllReduce:
       case HloOpcode::kCollectivePermute:
         return true;
+      case HloOpcode::kCopy:
+        return config_.schedule_copies;
       default:
         return false;
     }
@@ -151,6 +158,8 @@ bool AsyncTracker::IsSupportedAsyncStart(const HloInstruction& hlo) const {
       case HloOpcode::kAllReduce:
       case HloOpcode::kCollectivePermute:
         return true;
+      case HloOpcode::kCopy:
+        return config_.schedule_copies;
       default:
         return false;
     }
@@ -161,7 +170,7 @@ bool AsyncTracker::IsSupportedAsyncStart(const HloInstruction& hlo) const {
 ResourcesVector AsyncTracker::GetResourcesFromInstruction(
     const HloInstruction& hlo) const {
   CanonicalAsyncOp op = GetCanonicalAsyncOp(hlo);
-  auto get_resource_for_op = [](HloOpcode op) -> ResourceType {
+  auto get_resource_for_op = [this](HloOpcode op) -> ResourceType {
     switch (op) {
       case HloOpcode::kAllReduce:
         return ResourceType::kAllReduce;
@@ -171,6 +180,9 @@ ResourcesVector AsyncTracker::GetResourcesFromInstruction(
         return ResourceType::kAllToAll;
       case HloOpcode::kCollectivePermute:
         return ResourceType::kCollectivePermute;
+      case HloOpcode::kCopy:
+        return config_.schedule_copies ? ResourceType::kCopy
+                                       : ResourceType::kNoResource;
       default:
         return ResourceType::kNoResource;
     }
@@ -1216,6 +1228,8 @@ DefaultSchedulerCore::ScheduleComputation(const HloComputation* computation) {
       config_.send_recv_host_overlap_limit;
   sched_state.max_concurrent_async[ResourceType::kRecvHost] =
       config_.send_recv_host_overlap_limit;
+  sched_state.max_concurrent_async[ResourceType::kCopy] =
+      config_.copy_overlap_limit;
   // Collect the bottom roots of the graph (nodes that don't have any
   // successor)
   // We are going to use them as starting point for scheduling.
@@ -45,7 +45,8 @@ enum class ResourceType {
   kSendRecv = 5,
   kSendHost = 6,
   kRecvHost = 7,
-  kNumResources = 8,
+  kCopy = 8,
+  kNumResources = 9,
 };
 
 enum class ResourceUsageType {
@@ -71,7 +72,11 @@ struct SchedulerConfig {
   int64_t all_reduce_overlap_limit = 1;
   int64_t send_recv_overlap_limit = 1;
   int64_t send_recv_host_overlap_limit = 1;
+  int64_t copy_overlap_limit = 1;
   bool schedule_send_recvs = false;
+  // Schedule the copy-starts and copy-dones, e.g. the transfers between memory
+  // spaces, as async ops.
+  bool schedule_copies = false;
   // Consider send recv as the same resource. Some platforms do not take well
   // overlapping the send/recv ops between themselves.
   bool force_send_recv_to_use_same_resource = false;
@@ -2445,4 +2445,37 @@ ENTRY %module {
                                         new_instruction_sequence, "ata1"));
 }
 
+TEST_F(LatencyHidingSchedulerTest, CopyStartDoneOverlapped) {
+  absl::string_view hlo_string = R"(
+HloModule module, is_scheduled=true
+
+ENTRY %module {
+  p0 = f32[16,256,256]{2,1,0} parameter(0)
+  p1 = f32[16,64,256]{2,1,0} parameter(1)
+  p2 = f32[16,64,256]{2,1,0} parameter(2)
+  cs = (f32[16,256,256]{2,1,0:S(5)}, f32[16,256,256]{2,1,0}, u32[])
+    copy-start(p0)
+  cd = f32[16,256,256]{2,1,0:S(5)} copy-done(cs)
+  c0 = f32[16,256,256]{2,1,0} convolution(p1, p2),
+    window={size=16 stride=15 lhs_dilate=16}, dim_labels=0fb_0io->0fb
+  ROOT t = (f32[16,256,256]{2,1,0:S(5)}, f32[16,256,256]{2,1,0}) tuple(cd, c0)
+}
+)";
+
+  TF_ASSERT_OK_AND_ASSIGN(auto hlo_module, ParseHloText(hlo_string));
+  HloSchedule& module_schedule = hlo_module->schedule();
+  HloComputation* entry_computation = hlo_module->entry_computation();
+  SchedulerConfig sched_config = GetDefaultSchedConfig();
+  sched_config.schedule_copies = true;
+  EXPECT_TRUE(RunScheduler(hlo_module.get(), sched_config).ok());
+  std::vector<HloInstruction*> new_instruction_sequence =
+      module_schedule.sequence(entry_computation).instructions();
+
+  // The copy is overlapped with the convolution.
+  EXPECT_LT(GetIndex(new_instruction_sequence, "cs"),
+            GetIndex(new_instruction_sequence, "c0"));
+  EXPECT_LT(GetIndex(new_instruction_sequence, "c0"),
+            GetIndex(new_instruction_sequence, "cd"));
+}
+
 }  // namespace xla
@@ -0,0 +1,121 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/profile_guided_latency_estimator.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "tensorflow/compiler/xla/hlo/ir/hlo_opcode.h"
+#include "tensorflow/tsl/platform/fingerprint.h"
+#include "tensorflow/tsl/platform/logging.h"
+
+namespace xla {
+
+namespace {
+
+bool IsAsyncDone(const HloInstruction& instr) {
+  switch (instr.opcode()) {
+    case HloOpcode::kAsyncDone:
+    case HloOpcode::kAllGatherDone:
+    case HloOpcode::kAllReduceDone:
+    case HloOpcode::kCollectivePermuteDone:
+    case HloOpcode::kSendDone:
+    case HloOpcode::kRecvDone:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+ProfileGuidedLatencyEstimator::ProfileGuidedLatencyEstimator(
+    std::unique_ptr<LatencyEstimator> latency_estimator,
+    const tensorflow::profiler::ProfiledInstructionsProto& proto)
+    : latency_estimator_(std::move(latency_estimator)) {
+  for (const auto& cost : proto.costs()) {
+    if (!cost.name().empty()) cost_by_name_[cost.name()] = cost.cost_us();
+    if (cost.fingerprint() != 0) {
+      cost_by_fingerprint_[cost.fingerprint()] = cost.cost_us();
+    }
+  }
+  for (const auto& latency : proto.latencies()) {
+    if (!latency.name().empty()) {
+      latency_by_name_[latency.name()] = latency.latency_us();
+    }
+    if (latency.fingerprint() != 0) {
+      latency_by_fingerprint_[latency.fingerprint()] = latency.latency_us();
+    }
+  }
+  VLOG(1) << "Loaded the profiled costs of "
+          << cost_by_name_.size() + cost_by_fingerprint_.size()
+          << " instructions and the profiled latencies of "
+          << latency_by_name_.size() + latency_by_fingerprint_.size()
+          << " async operations";
+}
+
+/*static*/ uint64_t ProfileGuidedLatencyEstimator::Fingerprint(
+    const HloInstruction& instr) {
+  return tsl::Fingerprint64(instr.ToString(HloPrintOptions::Fingerprint()));
+}
+
+std::optional<LatencyEstimator::TimeCost>
+ProfileGuidedLatencyEstimator::Lookup(
+    const HloInstruction& instr,
+    const absl::flat_hash_map<std::string, TimeCost>& by_name,
+    const absl::flat_hash_map<uint64_t, TimeCost>& by_fingerprint) const {
+  if (auto it = by_name.find(instr.name()); it != by_name.end()) {
+    return it->second;
+  }
+  if (!by_fingerprint.empty()) {
+    if (auto it = by_fingerprint.find(Fingerprint(instr));
+        it != by_fingerprint.end()) {
+      return it->second;
+    }
+  }
+  return std::nullopt;
+}
+
+LatencyEstimator::TimeCost ProfileGuidedLatencyEstimator::GetLatencyBetween(
+    const HloGraphNode& from, const HloGraphNode& target) const {
+  const HloInstruction& target_instr = target.GetInstr();
+  // The latency of an async operation is the time between its start and its
+  // done.
+  if (IsAsyncDone(target_instr) && target_instr.operand_count() > 0 &&
+      target_instr.operand(0) == &from.GetInstr()) {
+    if (std::optional<TimeCost> latency = Lookup(
+            from.GetInstr(), latency_by_name_, latency_by_fingerprint_)) {
+      VLOG(10) << "Profiled latency between " << from.GetInstr().name()
+               << " and " << target_instr.name() << ": " << *latency;
+      return *latency;
+    }
+  }
+  return latency_estimator_->GetLatencyBetween(from, target);
+}
+
+LatencyEstimator::TimeCost ProfileGuidedLatencyEstimator::NodeCost(
+    const HloInstruction* instr) const {
+  if (std::optional<TimeCost> cost =
+          Lookup(*instr, cost_by_name_, cost_by_fingerprint_)) {
+    VLOG(10) << "Profiled cost of " << instr->name() << ": " << *cost;
+    return *cost;
+  }
+  return latency_estimator_->NodeCost(instr);
+}
+
+}  // namespace xla
@@ -0,0 +1,70 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_PROFILE_GUIDED_LATENCY_ESTIMATOR_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_PROFILE_GUIDED_LATENCY_ESTIMATOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/latency_hiding_scheduler.h"
+#include "tensorflow/tsl/profiler/protobuf/profiled_instructions.pb.h"
+
+namespace xla {
+
+// Implementation of LatencyEstimator using a profile of a previous run of the
+// module. The profile gives the measured cost of the instructions and the
+// measured latency of the async operations, in microseconds. Instructions
+// missing from the profile are estimated by the wrapped latency estimator,
+// which is expected to use microseconds as well.
+class ProfileGuidedLatencyEstimator : public LatencyEstimator {
+ public:
+  ProfileGuidedLatencyEstimator(
+      std::unique_ptr<LatencyEstimator> latency_estimator,
+      const tensorflow::profiler::ProfiledInstructionsProto& proto);
+
+  TimeCost GetLatencyBetween(const HloGraphNode& from,
+                             const HloGraphNode& target) const override;
+  TimeCost NodeCost(const HloInstruction* instr) const override;
+  int CyclesPerMicrosecond() const override {
+    return latency_estimator_->CyclesPerMicrosecond();
+  }
+
+  // Returns the fingerprint identifying 'instr' in a profile, which doesn't
+  // depend on the names and ids of the instructions.
+  static uint64_t Fingerprint(const HloInstruction& instr);
+
+ private:
+  // Returns the profiled value of 'instr' in 'by_name' or else in
+  // 'by_fingerprint'.
+  std::optional<TimeCost> Lookup(
+      const HloInstruction& instr,
+      const absl::flat_hash_map<std::string, TimeCost>& by_name,
+      const absl::flat_hash_map<uint64_t, TimeCost>& by_fingerprint) const;
+
+  std::unique_ptr<LatencyEstimator> latency_estimator_;
+  absl::flat_hash_map<std::string, TimeCost> cost_by_name_;
+  absl::flat_hash_map<uint64_t, TimeCost> cost_by_fingerprint_;
+  absl::flat_hash_map<std::string, TimeCost> latency_by_name_;
+  absl::flat_hash_map<uint64_t, TimeCost> latency_by_fingerprint_;
+};
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_PROFILE_GUIDED_LATENCY_ESTIMATOR_H_
@@ -0,0 +1,154 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/profile_guided_latency_estimator.h"
+
+#include <memory>
+
+#include "absl/algorithm/container.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_computation.h"
+#include "tensorflow/compiler/xla/hlo/ir/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/latency_hiding_scheduler.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/tsl/profiler/protobuf/profiled_instructions.pb.h"
+
+namespace xla {
+namespace {
+
+constexpr char kHloModule[] = R"(
+HloModule module, is_scheduled=true
+
+add {
+  p0 = f32[] parameter(0)
+  p1 = f32[] parameter(1)
+  ROOT a = f32[] add(p0, p1)
+}
+
+ENTRY entry {
+  p0 = f32[16,64]{1,0} parameter(0)
+  p1 = f32[64,64]{1,0} parameter(1)
+  ar-start = f32[16,64]{1,0} all-reduce-start(p0), replica_groups={},
+    to_apply=add
+  ar-done = f32[16,64]{1,0} all-reduce-done(ar-start)
+  dot0 = f32[64,64]{1,0} dot(p1, p1), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+  dot1 = f32[64,64]{1,0} dot(dot0, p1), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+  ROOT t = (f32[16,64]{1,0}, f32[64,64]{1,0}) tuple(ar-done, dot1)
+}
+)";
+
+class ProfileGuidedLatencyEstimatorTest : public HloTestBase {
+ protected:
+  std::unique_ptr<ProfileGuidedLatencyEstimator> MakeEstimator(
+      const tensorflow::profiler::ProfiledInstructionsProto& profile) {
+    return std::make_unique<ProfileGuidedLatencyEstimator>(
+        std::make_unique<ApproximateLatencyEstimator>(), profile);
+  }
+};
+
+TEST_F(ProfileGuidedLatencyEstimatorTest, UsesProfiledCostsByName) {
+  auto module = ParseAndReturnVerifiedModule(kHloModule).value();
+  HloComputation* entry = module->entry_computation();
+  tensorflow::profiler::ProfiledInstructionsProto profile;
+  auto* cost = profile.add_costs();
+  cost->set_name("dot0");
+  cost->set_cost_us(42.0);
+  auto estimator = MakeEstimator(profile);
+
+  EXPECT_EQ(estimator->NodeCost(entry->GetInstructionWithName("dot0")), 42.0);
+  // dot1 isn't profiled and falls back to the approximate estimator.
+  EXPECT_EQ(estimator->NodeCost(entry->GetInstructionWithName("dot1")),
+            ApproximateLatencyEstimator().NodeCost(
+                entry->GetInstructionWithName("dot1")));
+}
+
+TEST_F(ProfileGuidedLatencyEstimatorTest, UsesProfiledCostsByFingerprint) {
+  auto module = ParseAndReturnVerifiedModule(kHloModule).value();
+  const HloInstruction* dot1 =
+      module->entry_computation()->GetInstructionWithName("dot1");
+  tensorflow::profiler::ProfiledInstructionsProto profile;
+  auto* cost = profile.add_costs();
+  cost->set_fingerprint(ProfileGuidedLatencyEstimator::Fingerprint(*dot1));
+  cost->set_cost_us(7.0);
+  auto estimator = MakeEstimator(profile);
+
+  EXPECT_EQ(estimator->NodeCost(dot1), 7.0);
+  // The fingerprint doesn't depend on the name of the instruction.
+  auto renamed = ParseAndReturnVerifiedModule(kHloModule).value();
+  HloInstruction* renamed_dot1 =
+      renamed->entry_computation()->GetInstructionWithName("dot1");
+  renamed_dot1->SetAndSanitizeName("dot1.renamed");
+  EXPECT_EQ(estimator->NodeCost(renamed_dot1), 7.0);
+}
+
+TEST_F(ProfileGuidedLatencyEstimatorTest, UsesProfiledAsyncLatencies) {
+  auto module = ParseAndReturnVerifiedModule(kHloModule).value();
+  HloComputation* entry = module->entry_computation();
+  tensorflow::profiler::ProfiledInstructionsProto profile;
+  auto* latency = profile.add_latencies();
+  latency->set_name("ar-start");
+  latency->set_latency_us(123.0);
+  auto estimator = MakeEstimator(profile);
+
+  HloGraphNode ar_start(entry->GetInstructionWithName("ar-start"), 0);
+  HloGraphNode ar_done(entry->GetInstructionWithName("ar-done"), 1);
+  HloGraphNode dot0(entry->GetInstructionWithName("dot0"), 2);
+  HloGraphNode dot1(entry->GetInstructionWithName("dot1"), 3);
+  EXPECT_EQ(estimator->GetLatencyBetween(ar_start, ar_done), 123.0);
+  EXPECT_EQ(estimator->GetLatencyBetween(dot0, dot1),
+            ApproximateLatencyEstimator().GetLatencyBetween(dot0, dot1));
+}
+
+TEST_F(ProfileGuidedLatencyEstimatorTest, SchedulesWithProfile) {
+  auto module = ParseAndReturnVerifiedModule(kHloModule).value();
+  tensorflow::profiler::ProfiledInstructionsProto profile;
+  auto* latency = profile.add_latencies();
+  latency->set_name("ar-start");
+  latency->set_latency_us(100.0);
+  for (const char* name : {"dot0", "dot1"}) {
+    auto* cost = profile.add_costs();
+    cost->set_name(name);
+    cost->set_cost_us(40.0);
+  }
+
+  SchedulerConfig config;
+  auto shape_size_bytes = [](const Shape& shape) {
+    return ShapeUtil::ByteSizeOf(shape, /*pointer_size=*/8);
+  };
+  std::unique_ptr<LatencyEstimator> latency_estimator = MakeEstimator(profile);
+  auto async_tracker = std::make_unique<AsyncTracker>(config);
+  auto scheduler_core = std::make_unique<DefaultSchedulerCore>(
+      shape_size_bytes, async_tracker.get(), latency_estimator.get(), config);
+  ASSERT_TRUE(LatencyHidingScheduler(std::move(latency_estimator),
+                                     std::move(async_tracker),
+                                     std::move(scheduler_core),
+                                     shape_size_bytes)
+                  .Run(module.get())
+                  .ok());
+
+  // Both dots are needed to hide the latency of the all-reduce.
+  HloComputation* entry = module->entry_computation();
+  const auto& sequence = module->schedule().sequence(entry).instructions();
+  auto position = [&](absl::string_view name) {
+    return absl::c_find(sequence, entry->GetInstructionWithName(name)) -
+           sequence.begin();
+  };
+  EXPECT_LT(position("ar-start"), position("dot0"));
+  EXPECT_LT(position("dot1"), position("ar-done"));
+}
+
+}  // namespace
+}  // namespace xla
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/stream_executor/gpu/gpu_cudamallocasync_allocator.h"
 
+#include <cstring>
 #include <map>
 #include <memory>
 #include <optional>
@@ -28,6 +29,7 @@ limitations under the License.
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
 #include "tensorflow/compiler/xla/stream_executor/device_id_utils.h"
 #include "tensorflow/compiler/xla/stream_executor/gpu/gpu_init.h"
 #include "tensorflow/compiler/xla/stream_executor/stream_executor.h"
@@ -35,6 +37,8 @@ limitations under the License.
 #include "tensorflow/tsl/framework/device_id.h"
 #include "tensorflow/tsl/platform/logging.h"
 #include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/profiler/lib/scoped_memory_debug_annotation.h"
+#include "tensorflow/tsl/profiler/lib/traceme.h"
 #include "tensorflow/tsl/util/env_var.h"
 
 namespace stream_executor {
@@ -107,11 +111,44 @@ void GpuCudaMallocAsyncAllocator::PrintAllocatorStatistics() {
   PrintAllocatorStatisticsNoLock();
 }
 
+void GpuCudaMallocAsyncAllocator::AddTraceMe(absl::string_view traceme_name,
+                                             const void* ptr, int64_t bytes) {
+  if (!stats_) return;
+  tsl::profiler::TraceMe::InstantActivity(
+      [this, traceme_name, ptr, bytes]() ABSL_NO_THREAD_SAFETY_ANALYSIS {
+        const auto& annotation =
+            tsl::profiler::ScopedMemoryDebugAnnotation::CurrentAnnotation();
+        const int64_t bytes_limit =
+            stats_->bytes_limit ? *stats_->bytes_limit : 0;
+        return tsl::profiler::TraceMeEncode(
+            traceme_name,
+            {{"allocator_name", name_},
+             {"bytes_reserved", stats_->bytes_reserved},
+             {"bytes_allocated", stats_->bytes_in_use},
+             {"bytes_available", bytes_limit - stats_->bytes_in_use},
+             {"fragmentation", 0},
+             {"peak_bytes_in_use", stats_->peak_bytes_in_use},
+             {"requested_bytes", bytes},
+             {"allocation_bytes", bytes},
+             {"addr", reinterpret_cast<uint64_t>(ptr)},
+             {"tf_op", annotation.pending_op_name ? annotation.pending_op_name
+                                                  : "(null)"},
+             {"id", annotation.pending_step_id},
+             {"region_type", annotation.pending_region_type
+                                 ? annotation.pending_region_type
+                                 : "(null)"},
+             {"data_type", annotation.pending_data_type},
+             {"shape", annotation.pending_shape_func()}});
+      },
+      /*level=*/tsl::profiler::TraceMeLevel::kInfo);
+}
+
 std::atomic<int> GpuCudaMallocAsyncAllocator::number_instantiated_(0);
 
 GpuCudaMallocAsyncAllocator::GpuCudaMallocAsyncAllocator(
     tsl::PlatformDeviceId platform_device_id, size_t pool_size,
-    bool reserve_memory, bool compute_stats)
+    bool reserve_memory, bool compute_stats, bool create_new_pool,
+    std::optional<size_t> release_threshold)
     : name_(absl::StrCat("gpu_async_", platform_device_id.value())),
       reserve_memory_(reserve_memory) {
   ++number_instantiated_;
@@ -176,17 +213,29 @@ GpuCudaMallocAsyncAllocator::GpuCudaMallocAsyncAllocator(
            "old, "
         << " OS not supported, CUDA version too old(request CUDA11.2+).";
 
-  if (auto status =
-          cuDeviceGetDefaultMemPool(&pool_, platform_device_id.value()))
+  if (create_new_pool) {
+    CUmemPoolProps pool_props;
+    memset(&pool_props, 0, sizeof(pool_props));
+    pool_props.allocType = CU_MEM_ALLOCATION_TYPE_PINNED;
+    pool_props.handleTypes = CU_MEM_HANDLE_TYPE_NONE;
+    pool_props.location.id = platform_device_id.value();
+    pool_props.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    if (auto status = cuMemPoolCreate(&pool_, &pool_props))
+      LOG(FATAL) <<  // Crash OK.
+          "Failed to create CUDA pool: " << GetCudaErrorMessage(status);
+    owns_pool_ = true;
+  } else if (auto status = cuDeviceGetDefaultMemPool(
+                 &pool_, platform_device_id.value())) {
     LOG(FATAL) <<  // Crash OK.
         "Failed to get default CUDA pool: " << GetCudaErrorMessage(status);
+  }
 
   VLOG(1) << Name() << " CudaMallocAsync initialized on platform: "
           << platform_device_id.value() << " with pool size of: " << pool_size
           << " this ptr: " << this;
-  uint64_t pool_size_64 = pool_size;
+  uint64_t release_threshold_64 = release_threshold.value_or(pool_size);
   if (auto status = cuMemPoolSetAttribute(
-          pool_, CU_MEMPOOL_ATTR_RELEASE_THRESHOLD, &pool_size_64))
+          pool_, CU_MEMPOOL_ATTR_RELEASE_THRESHOLD, &release_threshold_64))
     LOG(FATAL) <<  // Crash OK.
         "Failed to set CUDA pool attribute: " << GetCudaErrorMessage(status);
 
@@ -252,8 +301,9 @@ GpuCudaMallocAsyncAllocator::GpuCudaMallocAsyncAllocator(
 
     VLOG(2) << "Set access to the pool id: " << i
             << " location id: " << map.location.id;
-    if (auto status = cuDeviceCanAccessPeer(&canAccessPeer, i,
-                                            platform_device_id.value())) {
+    if (auto status =
+            cuDeviceCanAccessPeer(&canAccessPeer, (*all_ids_)[i].value(),
+                                  platform_device_id.value())) {
       pool_ = nullptr;
       LOG(FATAL)  // Crash OK.
           << "cuDeviceCanAccessPeer failed: " << GetCudaErrorMessage(status);
@@ -277,7 +327,18 @@ GpuCudaMallocAsyncAllocator::GpuCudaMallocAsyncAllocator(
 #endif  // TF_CUDA_MALLOC_ASYNC_SUPPORTED
 }
 
-GpuCudaMallocAsyncAllocator::~GpuCudaMallocAsyncAllocator() {}
+GpuCudaMallocAsyncAllocator::~GpuCudaMallocAsyncAllocator() {
+#if TF_CUDA_MALLOC_ASYNC_SUPPORTED
+  if (owns_pool_) {
+    cuda::ScopedActivateExecutorContext scoped_activation{stream_exec_};
+    if (cuda_stream_ != nullptr) cuStreamSynchronize(cuda_stream_);
+    if (auto status = cuMemPoolDestroy(pool_)) {
+      LOG(ERROR) << "Failed to destroy CUDA pool: "
+                 << GetCudaErrorMessage(status);
+    }
+  }
+#endif  // TF_CUDA_MALLOC_ASYNC_SUPPORTED
+}
 
 void* GpuCudaMallocAsyncAllocator::AllocateRaw(size_t alignment,
                                                size_t num_bytes) {
@@ -329,6 +390,7 @@ void* GpuCudaMallocAsyncAllocator::AllocateRaw(size_t alignment,
         std::max<std::size_t>(stats_->largest_alloc_size, num_bytes);
     bool ptr_inserted = size_map_.emplace(ptr, num_bytes).second;
     DCHECK(ptr_inserted);
+    AddTraceMe("MemoryAllocation", ptr, num_bytes);
   }
   VLOG(10) << Name() << " Allocated " << num_bytes << " at " << ptr;
   return ptr;
@@ -371,6 +433,7 @@ void GpuCudaMallocAsyncAllocator::DeallocateRaw(void* ptr) {
     size_t size = size_map_[ptr];
     stats_->bytes_in_use -= size;
     size_map_.erase(ptr);
+    AddTraceMe("MemoryDeallocation", ptr, size);
   }
 
   VLOG(10) << Name() << " Freed ptr: " << ptr;
@@ -396,7 +459,23 @@ size_t GpuCudaMallocAsyncAllocator::AllocatedSize(const void* ptr) const {
 std::optional<tsl::AllocatorStats> GpuCudaMallocAsyncAllocator::GetStats() {
   if (!stats_) return std::nullopt;
   tsl::mutex_lock l(lock_);
-  return *stats_;
+  tsl::AllocatorStats stats = *stats_;
+#if CUDA_VERSION >= 11030
+  // The memory the pool holds from the driver, which is shared with the
+  // other allocators of the GPU unless this one created its pool.
+  if (pool_ != nullptr) {
+    cuuint64_t reserved_current;
+    cuuint64_t reserved_high;
+    if (cuMemPoolGetAttribute(pool_, CU_MEMPOOL_ATTR_RESERVED_MEM_CURRENT,
+                              &reserved_current) == CUDA_SUCCESS &&
+        cuMemPoolGetAttribute(pool_, CU_MEMPOOL_ATTR_RESERVED_MEM_HIGH,
+                              &reserved_high) == CUDA_SUCCESS) {
+      stats.pool_bytes = static_cast<int64_t>(reserved_current);
+      stats.peak_pool_bytes = static_cast<int64_t>(reserved_high);
+    }
+  }
+#endif  // CUDA_VERSION >= 11030
+  return stats;
 }
 
 bool GpuCudaMallocAsyncAllocator::ClearStats() {
@@ -405,6 +484,15 @@ bool GpuCudaMallocAsyncAllocator::ClearStats() {
   stats_->num_allocs = 0;
   stats_->peak_bytes_in_use = stats_->bytes_in_use;
   stats_->largest_alloc_size = 0;
+#if CUDA_VERSION >= 11030
+  // The high watermarks of a pool can only be reset to zero, after which the
+  // driver sets them to the current values.
+  if (pool_ != nullptr) {
+    cuuint64_t zero = 0;
+    cuMemPoolSetAttribute(pool_, CU_MEMPOOL_ATTR_RESERVED_MEM_HIGH, &zero);
+    cuMemPoolSetAttribute(pool_, CU_MEMPOOL_ATTR_USED_MEM_HIGH, &zero);
+  }
+#endif  // CUDA_VERSION >= 11030
   return true;
 }
 
@@ -22,6 +22,7 @@ limitations under the License.
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "tensorflow/compiler/xla/stream_executor/stream_executor.h"
 #include "tensorflow/tsl/framework/allocator.h"
 #include "tensorflow/tsl/framework/device_id.h"
@@ -63,13 +64,22 @@ namespace stream_executor {
 //
 // Here, the pool_size isn't the absolute max as for [Gpu]BFCAllocator.
 // The pool can grow above that up to the total GPU memory.  But the
-// driver can return the excess memory to other processes.
+// driver can return the excess memory to other processes. The memory
+// kept can be lowered with `release_threshold`, so that the pool gives
+// back more of it to other processes at each synchronization.
+//
+// By default the allocator uses the default pool of the GPU, which it
+// shares with the other allocators of the GPU, e.g. of the virtual devices
+// on it. With `create_new_pool`, it uses a pool of its own, so that the
+// devices, each allocating on its own stream, don't contend for the same
+// pool and have their own release threshold and pool statistics.
 class GpuCudaMallocAsyncAllocator : public tsl::Allocator {
  public:
-  explicit GpuCudaMallocAsyncAllocator(tsl::PlatformDeviceId platform_device_id,
-                                       size_t pool_size,
-                                       bool reserve_memory = false,
-                                       bool compute_stats = true);
+  explicit GpuCudaMallocAsyncAllocator(
+      tsl::PlatformDeviceId platform_device_id, size_t pool_size,
+      bool reserve_memory = false, bool compute_stats = true,
+      bool create_new_pool = false,
+      std::optional<size_t> release_threshold = std::nullopt);
   ~GpuCudaMallocAsyncAllocator() override;
   std::string Name() override { return name_; }
   void* AllocateRaw(size_t alignment,
@@ -103,6 +113,11 @@ class GpuCudaMallocAsyncAllocator : public tsl::Allocator {
  private:
   void PrintAllocatorStatisticsNoLock() ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Adds a TraceMe event for the profiler's memory profile, as
+  // BFCAllocator does, if stats are computed.
+  void AddTraceMe(absl::string_view traceme_name, const void* ptr,
+                  int64_t bytes) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
 #if TF_CUDA_MALLOC_ASYNC_SUPPORTED
   StreamExecutor* stream_exec_;  // Not owned.
 
@@ -113,10 +128,12 @@ class GpuCudaMallocAsyncAllocator : public tsl::Allocator {
   // Not owned.
   CUstream cuda_stream_;
 
-  // Not owned. The default pool of the associated GPU.
+  // The default pool of the associated GPU, not owned, or the pool created
+  // for this allocator if `owns_pool_`.
   // If null, then the instanciation failed and the first allocation
   // will return an error.
   CUmemoryPool pool_;
+  bool owns_pool_ = false;
 #endif  // TF_CUDA_MALLOC_ASYNC_SUPPORTED
 
   // Just a counter for the number of time this class is instantiated.
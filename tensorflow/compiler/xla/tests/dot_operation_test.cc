@@ -1994,6 +1994,51 @@ ENTRY SmallIntegerDot {
   EXPECT_TRUE(RunAndCompare(hlo_string, ErrorSpec{0, 0}));
 }
 
+XLA_TEST_F(DotOperationTextTest, S8DotWithS32Result) {
+  absl::string_view hlo_string =
+      R"(
+HloModule MixedPrecisionIntegerDot
+
+ENTRY MixedPrecisionIntegerDot {
+  arg0 = s8[20,55] parameter(0)
+  arg1 = s8[55,20] parameter(1)
+  ROOT dot = s32[20,20] dot(arg0, arg1), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+}
+)";
+
+  EXPECT_TRUE(RunAndCompare(hlo_string, ErrorSpec{0, 0}));
+}
+
+XLA_TEST_F(DotOperationTextTest, S8DotWithConstantTransposedRhs) {
+  absl::string_view hlo_string =
+      R"(
+HloModule MixedPrecisionIntegerDot
+
+ENTRY MixedPrecisionIntegerDot {
+  arg0 = s8[20,4] parameter(0)
+  constant = s8[3,4] constant({{1, -2, 3, -4}, {5, 6, -7, 8}, {-9, 10, 11, 12}})
+  ROOT dot = s32[20,3] dot(arg0, constant), lhs_contracting_dims={1}, rhs_contracting_dims={1}
+}
+)";
+
+  EXPECT_TRUE(RunAndCompare(hlo_string, ErrorSpec{0, 0}));
+}
+
+XLA_TEST_F(DotOperationTextTest, BF16DotWithF32Result) {
+  absl::string_view hlo_string =
+      R"(
+HloModule MixedPrecisionDot
+
+ENTRY MixedPrecisionDot {
+  arg0 = bf16[20,55] parameter(0)
+  arg1 = bf16[55,20] parameter(1)
+  ROOT dot = f32[20,20] dot(arg0, arg1), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+}
+)";
+
+  EXPECT_TRUE(RunAndCompare(hlo_string, ErrorSpec{4e-3, 4e-3}));
+}
+
 XLA_TEST_F(DotOperationTextTest, GpuTransposeOutput) {
   absl::string_view hlo_string =
       R"(
@@ -813,6 +813,57 @@ XLA_TEST_F(ReduceTest, VectorizedReduce_BooleanOr) {
       [](bool a, bool b) { return a || b; }, false);
 }
 
+XLA_TEST_F(ReduceTest, VectorizedReduceOverMinorDimension) {
+  // The rows aren't a multiple of the vector width and the initial value isn't
+  // the identity of the reduction.
+  const int rows = 37, cols = 131;
+  XlaBuilder builder(TestName());
+  auto input = Parameter(&builder, 0, ShapeUtil::MakeShape(S32, {rows, cols}),
+                         "input");
+  Reduce(input, ConstantR0<int32_t>(&builder, 7),
+         CreateScalarAddComputation(S32, &builder),
+         /*dimensions_to_reduce=*/{1});
+
+  Array2D<int32_t> input_data(rows, cols);
+  input_data.FillUnique();
+  std::vector<int32_t> expected(rows, 7);
+  for (int64_t rowno = 0; rowno < rows; ++rowno) {
+    for (int64_t colno = 0; colno < cols; ++colno) {
+      expected[rowno] += input_data(rowno, colno);
+    }
+  }
+  std::unique_ptr<GlobalData> input_global_data =
+      client_->TransferToServer(LiteralUtil::CreateR2FromArray2D(input_data))
+          .value();
+  ComputeAndCompareR1<int32_t>(&builder, expected, {input_global_data.get()});
+}
+
+XLA_TEST_F(ReduceTest, VectorizedReduceOverMinorDimensions) {
+  const int64_t d0 = 5, d1 = 6, d2 = 35;
+  XlaBuilder builder(TestName());
+  auto input = Parameter(&builder, 0, ShapeUtil::MakeShape(F32, {d0, d1, d2}),
+                         "input");
+  Reduce(input, ConstantR0<float>(&builder, 1000.f),
+         CreateScalarMinComputation(F32, &builder),
+         /*dimensions_to_reduce=*/{1, 2});
+
+  Array3D<float> input_data(d0, d1, d2);
+  input_data.FillRandom(100.f);
+  std::vector<float> expected(d0, 1000.f);
+  for (int64_t i = 0; i < d0; ++i) {
+    for (int64_t j = 0; j < d1; ++j) {
+      for (int64_t k = 0; k < d2; ++k) {
+        expected[i] = std::min(expected[i], input_data(i, j, k));
+      }
+    }
+  }
+  std::unique_ptr<GlobalData> input_global_data =
+      client_->TransferToServer(LiteralUtil::CreateR3FromArray3D(input_data))
+          .value();
+  ComputeAndCompareR1<float>(&builder, expected, {input_global_data.get()},
+                             ErrorSpec(0));
+}
+
 class ReduceR3ToR2Test : public ReduceTest,
                          public ::testing::WithParamInterface<BoundsLayout> {};
 
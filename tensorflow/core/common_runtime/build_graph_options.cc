@@ -48,6 +48,13 @@ string BuildGraphOptions::DebugString() const {
       break;
   }
   strings::StrAppend(&rv, "\ncollective_order: ", collective_order_str);
+  if (specialized_batch_size > 0) {
+    strings::StrAppend(&rv,
+                       "\nspecialized_batch_size: ", specialized_batch_size);
+  }
+  if (keep_fed_placeholder_shapes) {
+    strings::StrAppend(&rv, "\nkeep_fed_placeholder_shapes: true");
+  }
   return rv;
 }
 
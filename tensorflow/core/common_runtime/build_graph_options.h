@@ -40,6 +40,14 @@ struct BuildGraphOptions {
   // edges, if `kAttrs` encode as attribute on collective op.
   GraphCollectiveOrder collective_order = GraphCollectiveOrder::kNone;
 
+  // If positive, the graph is optimized for feeds whose first dimension is
+  // `specialized_batch_size`. The feeds are checked to have it at run time.
+  int64_t specialized_batch_size = 0;
+
+  // If `true`, the _Arg nodes replacing the fed placeholders keep their fully
+  // defined shapes, for the static memory plan of their consumers.
+  bool keep_fed_placeholder_shapes = false;
+
   string DebugString() const;
 };
 
@@ -61,13 +61,27 @@ void CollectiveParamResolverLocal::CompleteGroupAsync(
 }
 
 namespace {
+// Returns true if a reduction over the group of `cp` is better done by
+// HierarchicalRingReduce than by a flat ring: the group spans several tasks,
+// e.g. hosts, with the same number of devices each, and a flat ring would
+// carry the traffic between the devices of a task over the links between
+// tasks.
+bool UseHierarchicalRingReduce(const CollectiveParams* cp) {
+  return cp->group.num_tasks > 1 &&
+         cp->group.group_size > cp->group.num_tasks &&
+         cp->group.same_num_devices_per_task &&
+         cp->instance.impl_details.communication_hint != "ring";
+}
+
 const char* GetCollectiveName(const CollectiveParams* cp, bool nccl) {
   switch (cp->instance.type) {
     case BROADCAST_COLLECTIVE:
       return nccl ? "NcclBroadcast" : "HierarchicalTreeBroadcast";
 
     case REDUCTION_COLLECTIVE:
-      return nccl ? "NcclReduce" : "RingReduce";
+      if (nccl) return "NcclReduce";
+      return UseHierarchicalRingReduce(cp) ? "HierarchicalRingReduce"
+                                           : "RingReduce";
 
     case GATHER_COLLECTIVE:
       return nccl ? "NcclGather" : "RingGather";
@@ -0,0 +1,55 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_COUNTING_ALLOCATOR_TEST_UTIL_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_COUNTING_ALLOCATOR_TEST_UTIL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#include "tensorflow/core/framework/allocator.h"
+
+namespace tensorflow {
+namespace test {
+
+// Allocates from the CPU allocator, and counts the allocations made and the
+// ones still alive, for the tests of the allocators and pools built on top of
+// another allocator.
+class CountingAllocator : public Allocator {
+ public:
+  std::string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocations_;
+    ++num_live_;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    --num_live_;
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocations() const { return num_allocations_; }
+  int num_live() const { return num_live_; }
+
+ private:
+  std::atomic<int> num_allocations_{0};
+  std::atomic<int> num_live_{0};
+};
+
+}  // namespace test
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_COUNTING_ALLOCATOR_TEST_UTIL_H_
@@ -20,6 +20,7 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
@@ -35,11 +36,13 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/common_runtime/graph_optimizer.h"
 #include "tensorflow/core/common_runtime/local_session_selection.h"
+#include "tensorflow/core/common_runtime/memory_planner.h"
 #include "tensorflow/core/common_runtime/memory_types.h"
 #include "tensorflow/core/common_runtime/optimization_registry.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
+#include "tensorflow/core/common_runtime/shape_refiner.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -98,13 +101,16 @@ Status NewThreadPoolFromThreadPoolOptions(
   if (num_threads == 0) {
     num_threads = NumInterOpThreadsFromSessionOptions(options);
   }
+  ThreadOptions thread_options;
+  thread_options.cpu_affinity.assign(thread_pool_options.cpu_affinity().begin(),
+                                     thread_pool_options.cpu_affinity().end());
   const string& name = thread_pool_options.global_name();
   if (name.empty()) {
     // Session-local threadpool.
     VLOG(1) << "Direct session inter op parallelism threads for pool "
             << pool_number << ": " << num_threads;
     *pool = new thread::ThreadPool(
-        options.env, ThreadOptions(), strings::StrCat("Compute", pool_number),
+        options.env, thread_options, strings::StrCat("Compute", pool_number),
         num_threads, !options.config.experimental().disable_thread_spinning(),
         /*allocator=*/nullptr);
     *owned = true;
@@ -121,7 +127,7 @@ Status NewThreadPoolFromThreadPoolOptions(
   if (mvalue->second == nullptr) {
     mvalue->first = thread_pool_options.num_threads();
     mvalue->second = new thread::ThreadPool(
-        options.env, ThreadOptions(), strings::StrCat("Compute", pool_number),
+        options.env, thread_options, strings::StrCat("Compute", pool_number),
         num_threads, !options.config.experimental().disable_thread_spinning(),
         /*allocator=*/nullptr);
   } else {
@@ -156,6 +162,34 @@ string GetRendezvousKey(const string& tensor_name,
                          frame_iter.frame_id, ":", frame_iter.iter_id);
 }
 
+// Plans the outputs of `graph` whose shapes are fully defined by shape
+// inference.
+Status PlanMemory(const Graph& graph, std::shared_ptr<const MemoryPlan>* plan) {
+  ShapeRefiner refiner(graph.versions(), graph.op_registry());
+  refiner.set_require_shape_inference_fns(false);
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  for (const Node* n : order) {
+    // The outputs of the nodes whose shapes can't be inferred, and of their
+    // consumers, are not planned.
+    refiner.AddNode(n).IgnoreError();
+  }
+  std::unique_ptr<const MemoryPlan> result;
+  TF_RETURN_IF_ERROR(MemoryPlan::Create(
+      graph,
+      [&refiner](const Node* n, int output_index) -> int64_t {
+        shape_inference::InferenceContext* c = refiner.GetContext(n);
+        if (c == nullptr || !c->FullyDefined(c->output(output_index))) {
+          return -1;
+        }
+        return c->Value(c->NumElements(c->output(output_index))) *
+               DataTypeSize(n->output_type(output_index));
+      },
+      &result));
+  *plan = std::move(result);
+  return OkStatus();
+}
+
 }  // namespace
 
 class DirectSessionFactory : public SessionFactory {
@@ -329,10 +363,23 @@ DirectSession::DirectSession(const SessionOptions& options,
     for (int i = 0; i < thread_pool_size; ++i) {
       thread::ThreadPool* pool = nullptr;
       bool owned = false;
+      const ThreadPoolOptionProto& pool_options =
+          options_.config.session_inter_op_thread_pool(i);
       init_error_.Update(NewThreadPoolFromThreadPoolOptions(
-          options_, options_.config.session_inter_op_thread_pool(i), i, &pool,
-          &owned));
+          options_, pool_options, i, &pool, &owned));
       thread_pools_.emplace_back(pool, owned);
+      if (pool_options.cpu_share() < 0.0f || pool_options.cpu_share() > 1.0f) {
+        init_error_.Update(errors::InvalidArgument(
+            "Invalid cpu_share for inter-op thread pool ", i, ": ",
+            pool_options.cpu_share(), ". It must be in (0, 1]."));
+      }
+      if (pool != nullptr && pool_options.cpu_share() > 0.0f &&
+          pool_options.cpu_share() <= 1.0f) {
+        thread_pool_quotas_.push_back(
+            std::make_shared<ThreadPoolQuota>(pool, pool_options.cpu_share()));
+      } else {
+        thread_pool_quotas_.push_back(nullptr);
+      }
     }
   } else if (options_.config.use_per_session_threads()) {
     thread_pools_.emplace_back(NewThreadPoolFromSessionOptions(options_),
@@ -355,6 +402,16 @@ DirectSession::DirectSession(const SessionOptions& options,
   if (!status.ok()) {
     LOG(ERROR) << status.error_message();
   }
+  const Status step_arena_status =
+      ReadBoolFromEnvVar("TF_ENABLE_STEP_ARENA", false, &use_step_arena_);
+  if (!step_arena_status.ok()) {
+    LOG(ERROR) << step_arena_status.error_message();
+  }
+  const Status memory_plan_status = ReadBoolFromEnvVar(
+      "TF_ENABLE_STATIC_MEMORY_PLAN", false, &use_memory_plan_);
+  if (!memory_plan_status.ok()) {
+    LOG(ERROR) << memory_plan_status.error_message();
+  }
   session_handle_ =
       strings::StrCat("direct", strings::FpToString(random::New64()));
   int devices_added = 0;
@@ -576,6 +633,8 @@ Status DirectSession::RunInternal(
 #endif
 
   thread::ThreadPool* pool;
+  // If set, limits the closures of this session running in `pool`.
+  ThreadPoolQuota* quota = nullptr;
   // Use std::unique_ptr to ensure garbage collection
   std::unique_ptr<thread::ThreadPool> threadpool_wrapper;
 
@@ -604,6 +663,9 @@ Status DirectSession::RunInternal(
     }
 
     pool = thread_pools_[run_options.inter_op_thread_pool()].first;
+    if (!thread_pool_quotas_.empty()) {
+      quota = thread_pool_quotas_[run_options.inter_op_thread_pool()].get();
+    }
   }
 
   const int64_t call_timeout = run_options.timeout_in_ms() > 0
@@ -618,14 +680,9 @@ Status DirectSession::RunInternal(
   if (ShouldUseRunHandlerPool(run_options) &&
       run_options.experimental().use_run_handler_pool()) {
     VLOG(1) << "Using RunHandler to scheduler inter-op closures.";
-    handler = GetOrCreateRunHandlerPool(options_)->Get(
+    TF_RETURN_IF_ERROR(GetOrCreateRunHandlerPool(options_)->Get(
         step_id, call_timeout,
-        run_options.experimental().run_handler_pool_options());
-    if (!handler) {
-      return errors::DeadlineExceeded(
-          "Could not obtain RunHandler for request after waiting for ",
-          call_timeout, "ms.");
-    }
+        run_options.experimental().run_handler_pool_options(), &handler));
   }
   auto* handler_ptr = handler.get();
 
@@ -637,6 +694,14 @@ Status DirectSession::RunInternal(
     default_runner = [handler_ptr](Executor::Args::Closure c) {
       handler_ptr->ScheduleInterOpClosure(std::move(c));
     };
+  } else if (quota != nullptr) {
+    // Steps queued behind the share of the session are dispatched in the
+    // priority order that the run handler pool would use.
+    const int64_t priority =
+        run_options.experimental().run_handler_pool_options().priority();
+    default_runner = [quota, priority](Executor::Args::Closure c) {
+      quota->Schedule(priority, std::move(c));
+    };
   } else {
     default_runner = [pool](Executor::Args::Closure c) {
       pool->Schedule(std::move(c));
@@ -665,6 +730,7 @@ Status DirectSession::RunInternal(
   args.tensor_store = &run_state.tensor_store;
   args.step_container = &run_state.step_container;
   args.sync_on_finish = sync_on_finish_;
+  args.use_step_arena = use_step_arena_;
   args.user_intra_op_threadpool = threadpool_options.intra_op_threadpool;
   args.run_all_kernels_inline = pool == nullptr;
   args.start_time_usecs = start_time_usecs;
@@ -869,6 +935,7 @@ Status DirectSession::Run(const RunOptions& run_options,
   RunStateArgs run_state_args(run_options.debug_options());
   run_state_args.collective_graph_key =
       run_options.experimental().collective_graph_key();
+  run_state_args.specialized_batch_size = SpecializedBatchSize(inputs);
 
   TF_RETURN_IF_ERROR(GetOrCreateExecutors(input_tensor_names, output_names,
                                           target_nodes, &executors_and_keys,
@@ -1019,6 +1086,7 @@ Status DirectSession::PRunSetup(const std::vector<string>& input_names,
     LogMemory::RecordStep(args.step_id, run_state_args.handle);
   }
   args.sync_on_finish = sync_on_finish_;
+  args.use_step_arena = use_step_arena_;
 
   if (options_.config.graph_options().build_cost_model()) {
     run_state->collector.reset(new StepStatsCollector(nullptr));
@@ -1315,6 +1383,8 @@ Status DirectSession::CreateExecutors(
   options.use_function_convention = !run_state_args->is_partial_run;
   options.collective_graph_key =
       callable_options.run_options().experimental().collective_graph_key();
+  options.specialized_batch_size = run_state_args->specialized_batch_size;
+  options.keep_fed_placeholder_shapes = use_memory_plan_;
   if (options_.config.experimental()
           .collective_deterministic_sequential_execution()) {
     options.collective_order = GraphCollectiveOrder::kEdges;
@@ -1429,6 +1499,10 @@ Status DirectSession::CreateExecutors(
                                          device->name(),
                                          partition_graph.get()));
 
+    if (use_memory_plan_ && device->device_type() == DEVICE_CPU) {
+      TF_RETURN_IF_ERROR(PlanMemory(*partition_graph, &params.memory_plan));
+    }
+
     item->executor = nullptr;
     item->device = device;
     auto executor_type = options_.config.experimental().executor_type();
@@ -1478,6 +1552,23 @@ Status DirectSession::CreateExecutors(
   return OkStatus();
 }
 
+int64_t DirectSession::SpecializedBatchSize(
+    const NamedTensorList& inputs) const {
+  const auto& batch_sizes =
+      options_.config.experimental().specialized_batch_sizes();
+  if (batch_sizes.empty() || inputs.empty()) return 0;
+  int64_t batch_size = -1;
+  for (const auto& input : inputs) {
+    const Tensor& tensor = input.second;
+    if (tensor.dtype() == DT_RESOURCE || tensor.dims() == 0 ||
+        (batch_size >= 0 && tensor.dim_size(0) != batch_size)) {
+      return 0;
+    }
+    batch_size = tensor.dim_size(0);
+  }
+  return absl::c_linear_search(batch_sizes, batch_size) ? batch_size : 0;
+}
+
 Status DirectSession::GetOrCreateExecutors(
     gtl::ArraySlice<string> inputs, gtl::ArraySlice<string> outputs,
     gtl::ArraySlice<string> target_nodes, ExecutorsAndKeys** executors_and_keys,
@@ -1494,10 +1585,14 @@ Status DirectSession::GetOrCreateExecutors(
   }
 
   // Fast lookup path, no sorting.
+  const string specialization =
+      run_state_args->specialized_batch_size > 0
+          ? strings::StrCat("/batch=", run_state_args->specialized_batch_size)
+          : "";
   const string key = strings::StrCat(
       absl::StrJoin(inputs, ","), "->", absl::StrJoin(outputs, ","), "/",
       absl::StrJoin(target_nodes, ","), "/", run_state_args->is_partial_run,
-      "/", debug_tensor_watches_summary);
+      "/", debug_tensor_watches_summary, specialization);
   // Set the handle, if it's needed to log memory or for partial run.
   if (handle_name_counter_value >= 0) {
     run_state_args->handle =
@@ -1530,7 +1625,8 @@ Status DirectSession::GetOrCreateExecutors(
   const string sorted_key = strings::StrCat(
       absl::StrJoin(inputs_sorted, ","), "->",
       absl::StrJoin(outputs_sorted, ","), "/", absl::StrJoin(tn_sorted, ","),
-      "/", run_state_args->is_partial_run, "/", debug_tensor_watches_summary);
+      "/", run_state_args->is_partial_run, "/", debug_tensor_watches_summary,
+      specialization);
   // Set the handle, if its needed to log memory or for partial run.
   if (handle_name_counter_value >= 0) {
     run_state_args->handle =
@@ -1769,6 +1865,22 @@ Status DirectSession::CreateGraphs(
   return OkStatus();
 }
 
+::tensorflow::Status DirectSession::SetInterOpCpuShare(int pool_index,
+                                                      float cpu_share) {
+  if (pool_index < 0 ||
+      pool_index >= static_cast<int>(thread_pool_quotas_.size()) ||
+      thread_pool_quotas_[pool_index] == nullptr) {
+    return errors::InvalidArgument("Inter-op thread pool ", pool_index,
+                                   " of the session has no cpu_share.");
+  }
+  if (cpu_share <= 0.0f || cpu_share > 1.0f) {
+    return errors::InvalidArgument("Invalid cpu_share ", cpu_share,
+                                   ". It must be in (0, 1].");
+  }
+  thread_pool_quotas_[pool_index]->SetCpuShare(cpu_share);
+  return OkStatus();
+}
+
 ::tensorflow::Status DirectSession::Close() {
   cancellation_manager_->StartCancel();
   {
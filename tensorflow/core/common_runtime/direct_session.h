@@ -32,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/process_function_library_runtime.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/common_runtime/session_factory.h"
+#include "tensorflow/core/common_runtime/thread_pool_quota.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -114,6 +115,11 @@ class DirectSession : public Session {
     return OkStatus();
   }
 
+  // Changes the share of the threads of the inter-op thread pool
+  // `session_inter_op_thread_pool(pool_index)` that the steps of this session
+  // may occupy at once. The pool must have been configured with a `cpu_share`.
+  ::tensorflow::Status SetInterOpCpuShare(int pool_index, float cpu_share);
+
   void ExportCostModels(CostModelManager::CostModelMap* cost_models) {
     cost_model_manager_.ExportCostModels(cost_models);
   }
@@ -236,8 +242,14 @@ class DirectSession : public Session {
     std::unique_ptr<Graph> graph;
     const DebugOptions& debug_options;
     int64_t collective_graph_key = BuildGraphOptions::kNoCollectiveGraphKey;
+    // See BuildGraphOptions::specialized_batch_size.
+    int64_t specialized_batch_size = 0;
   };
 
+  // Returns the batch size of `inputs` if the graph is specialized to it, see
+  // ConfigProto.Experimental.specialized_batch_sizes, or 0.
+  int64_t SpecializedBatchSize(const NamedTensorList& inputs) const;
+
   // Retrieves an already existing set of executors to run 'inputs' and
   // 'outputs', or creates and caches them for future use.
   ::tensorflow::Status GetOrCreateExecutors(
@@ -349,12 +361,22 @@ class DirectSession : public Session {
   // The thread-pools to use for running ops, with a bool indicating if the pool
   // is owned.
   std::vector<std::pair<thread::ThreadPool*, bool>> thread_pools_;
+  // For each pool in `thread_pools_`, the quota limiting the closures of this
+  // session running in it, or null if the pool has no `cpu_share`.
+  std::vector<std::shared_ptr<ThreadPoolQuota>> thread_pool_quotas_;
 
   Status init_error_;  // Set to an error if construction failed.
 
   // If true, blocks until device has finished all queued operations in a step.
   bool sync_on_finish_ = true;
 
+  // If true, CPU executors allocate short-lived tensors from a per-step arena.
+  bool use_step_arena_ = false;
+
+  // If true, CPU executors serve the outputs whose shapes are known when the
+  // executor is created from an arena planned ahead of time.
+  bool use_memory_plan_ = false;
+
   std::vector<std::unique_ptr<FunctionInfo>> functions_
       TF_GUARDED_BY(executor_lock_);
 
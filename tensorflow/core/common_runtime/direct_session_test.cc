@@ -801,6 +801,50 @@ TEST_F(DirectSessionMinusAXTest, UseRunHandlerPool) {
   EXPECT_FLOAT_EQ(5.0, mat(0, 0));
 }
 
+TEST_F(DirectSessionMinusAXTest, InterOpThreadPoolCpuShare) {
+  Initialize({1, 2, 3, 4});
+  SessionOptions options;
+  auto* pool_options = options.config.add_session_inter_op_thread_pool();
+  pool_options->set_num_threads(4);
+  pool_options->set_cpu_share(0.5);
+  options.config.add_session_inter_op_thread_pool()->set_num_threads(1);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  std::vector<string> output_names = {y_ + ":0"};
+  auto run = [&session, &output_names](int64_t priority) {
+    RunOptions run_options;
+    run_options.mutable_experimental()
+        ->mutable_run_handler_pool_options()
+        ->set_priority(priority);
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(
+        session->Run(run_options, {}, output_names, {}, &outputs, nullptr));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_FLOAT_EQ(3.0, outputs[0].matrix<float>()(0, 0));
+  };
+  run(/*priority=*/0);
+  run(/*priority=*/1);
+
+  auto* direct_session = static_cast<DirectSession*>(session.get());
+  TF_ASSERT_OK(direct_session->SetInterOpCpuShare(0, 0.25));
+  run(/*priority=*/0);
+  // Only pools configured with a share can be adjusted.
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(direct_session->SetInterOpCpuShare(1, 0.5)));
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(direct_session->SetInterOpCpuShare(0, 0.0)));
+}
+
+TEST(DirectSessionTest, InvalidInterOpThreadPoolCpuShare) {
+  SessionOptions options;
+  options.config.add_session_inter_op_thread_pool()->set_cpu_share(2.0);
+  std::unique_ptr<Session> session(NewSession(options));
+  GraphDef def;
+  EXPECT_TRUE(errors::IsInvalidArgument(session->Create(def)));
+}
+
 TEST(DirectSessionTest, KeepsStateAcrossRunsOfSession) {
   GraphDef def;
   Graph g(OpRegistry::Global());
@@ -840,6 +884,111 @@ TEST(DirectSessionTest, KeepsStateAcrossRunsOfSession) {
   EXPECT_EQ(20.0, outputs[0].flat<float>()(0));
 }
 
+TEST(DirectSessionTest, SpecializesGraphToBatchSize) {
+  Graph g(OpRegistry::Global());
+  Node* x;
+  TF_ASSERT_OK(NodeBuilder("x", "Placeholder")
+                   .Attr("dtype", DT_FLOAT)
+                   .Attr("shape", PartialTensorShape({-1, 2}))
+                   .Finalize(&g, &x));
+  Node* shape;
+  TF_ASSERT_OK(NodeBuilder("shape", "Shape").Input(x).Finalize(&g, &shape));
+  Node* y = test::graph::Identity(&g, x);
+  GraphDef def;
+  g.ToGraphDef(&def);
+
+  SessionOptions options = DefaultSessionOptions();
+  options.config.mutable_experimental()->add_specialized_batch_sizes(1);
+  options.config.mutable_experimental()->add_specialized_batch_sizes(8);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+
+  RunOptions run_options;
+  run_options.set_output_partition_graphs(true);
+  auto run = [&](int batch_size, bool expect_specialized) {
+    Tensor input(DT_FLOAT, TensorShape({batch_size, 2}));
+    input.flat<float>().setConstant(1);
+    std::vector<Tensor> outputs;
+    RunMetadata run_metadata;
+    TF_ASSERT_OK(session->Run(run_options, {{"x", input}},
+                              {"shape:0", y->name() + ":0"}, {}, &outputs,
+                              &run_metadata));
+    ASSERT_EQ(2, outputs.size());
+    test::ExpectTensorEqual<int32>(outputs[0],
+                                   test::AsTensor<int32>({batch_size, 2}));
+    test::ExpectTensorEqual<float>(outputs[1], input);
+    bool specialized = false;
+    for (const GraphDef& partition : run_metadata.partition_graphs()) {
+      for (const NodeDef& node : partition.node()) {
+        specialized |= node.op() == "EnsureShape";
+      }
+    }
+    EXPECT_EQ(expect_specialized, specialized) << batch_size;
+  };
+  run(8, /*expect_specialized=*/true);
+  run(3, /*expect_specialized=*/false);
+  run(1, /*expect_specialized=*/true);
+  run(8, /*expect_specialized=*/true);
+}
+
+TEST(DirectSessionTest, RunsWithStaticMemoryPlan) {
+  Graph g(OpRegistry::Global());
+  Node* x;
+  TF_ASSERT_OK(NodeBuilder("x", "Placeholder")
+                   .Attr("dtype", DT_FLOAT)
+                   .Attr("shape", PartialTensorShape({2, 2}))
+                   .Finalize(&g, &x));
+  Node* y = test::graph::Matmul(&g, x, x, false, false);
+  Node* z = test::graph::Matmul(&g, y, x, false, false);
+  GraphDef def;
+  g.ToGraphDef(&def);
+
+  for (bool use_memory_plan : {false, true}) {
+    SCOPED_TRACE(use_memory_plan);
+    // The session reads the variable when it is created.
+    setenv("TF_ENABLE_STATIC_MEMORY_PLAN", use_memory_plan ? "true" : "false",
+           /*overwrite=*/1);
+    std::unique_ptr<Session> session(NewSession(DefaultSessionOptions()));
+    unsetenv("TF_ENABLE_STATIC_MEMORY_PLAN");
+    ASSERT_TRUE(session != nullptr);
+    TF_ASSERT_OK(session->Create(def));
+
+    RunOptions run_options;
+    run_options.set_output_partition_graphs(true);
+    std::vector<Tensor> first_outputs;
+    RunMetadata run_metadata;
+    TF_ASSERT_OK(session->Run(
+        run_options,
+        {{"x", test::AsTensor<float>({1, 2, 3, 4}, TensorShape({2, 2}))}},
+        {z->name() + ":0"}, {}, &first_outputs, &run_metadata));
+    // The outputs of a step stay valid after the next step reuses its plan.
+    std::vector<Tensor> second_outputs;
+    TF_ASSERT_OK(session->Run(
+        {{"x", test::AsTensor<float>({0, 1, 1, 0}, TensorShape({2, 2}))}},
+        {z->name() + ":0"}, {}, &second_outputs));
+    ASSERT_EQ(1, first_outputs.size());
+    test::ExpectTensorEqual<float>(
+        first_outputs[0],
+        test::AsTensor<float>({37, 54, 81, 118}, TensorShape({2, 2})));
+    ASSERT_EQ(1, second_outputs.size());
+    test::ExpectTensorEqual<float>(
+        second_outputs[0],
+        test::AsTensor<float>({0, 1, 1, 0}, TensorShape({2, 2})));
+
+    // Only the static memory plan keeps the shape of the fed placeholder.
+    int num_args = 0;
+    for (const GraphDef& partition : run_metadata.partition_graphs()) {
+      for (const NodeDef& node : partition.node()) {
+        if (node.op() != "_Arg") continue;
+        ++num_args;
+        EXPECT_EQ(use_memory_plan, node.attr().contains("_output_shapes"));
+      }
+    }
+    EXPECT_EQ(1, num_args);
+  }
+}
+
 TEST(DirectSessionTest, MultipleFeedTest) {
   GraphDef def;
   Graph g(OpRegistry::Global());
@@ -149,6 +149,17 @@ class AttrBuilder : public AbstractOpAttrs {
 
   tensorflow::Fprint128 CacheKey(const StringPiece device);
 
+  // Returns the key computed by the last call to CacheKey for `device`, or
+  // nullopt if attributes were set since then or the key was computed for
+  // another device. Unlike CacheKey, never fingerprints the attributes.
+  absl::optional<tensorflow::Fprint128> CachedCacheKey(
+      const StringPiece device) const {
+    if (!cached_cache_key_ || device != device_for_cached_cache_key_) {
+      return absl::nullopt;
+    }
+    return cached_cache_key_;
+  }
+
   // Fill `m` with the attr-value pairs set via AttrBuilder::Set() so far, as
   // well as any default attr-value pairs from the associated op_def, if there
   // is one.
@@ -59,6 +59,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/session_mgr.h"
 #endif  // !IS_MOBILE_PLATFORM
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
 #include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/util/env_var.h"
@@ -92,6 +93,27 @@ auto* eager_context_created =
     monitoring::Gauge<bool, 0>::New("/tensorflow/core/eager_context_created",
                                     "True if an eager context was created.");
 
+auto* eager_kernel_cache_counter = monitoring::Counter<1>::New(
+    "/tensorflow/core/eager_kernel_cache",
+    "The number of hits, misses and evictions of the eager kernel cache.",
+    "result");
+
+// The default maximum number of kernels in the kernel cache of a context.
+constexpr int64_t kDefaultKernelCacheSize = 1 << 16;
+
+// Returns the maximum number of kernels in a shard of the kernel cache, or a
+// non-positive number if the cache is unbounded.
+int64_t KernelCacheShardCapacity(int num_shards) {
+  int64_t size;
+  if (!ReadInt64FromEnvVar("TF_EAGER_KERNEL_CACHE_SIZE",
+                           kDefaultKernelCacheSize, &size)
+           .ok()) {
+    size = kDefaultKernelCacheSize;
+  }
+  if (size <= 0) return 0;
+  return (size + num_shards - 1) / num_shards;
+}
+
 }  // namespace
 
 const int64_t EagerContext::kGlobalRendezvousId = -1;
@@ -163,6 +185,7 @@ EagerContext::EagerContext(
       rendezvous_(rendezvous),
       thread_pool_(NewThreadPoolFromSessionOptions(opts)),
       cluster_flr_(cluster_flr),
+      kernel_cache_shard_capacity_(KernelCacheShardCapacity(kNumCacheShards)),
       log_device_placement_(opts.config.log_device_placement()),
       allow_soft_placement_(opts.config.allow_soft_placement()),
       num_active_steps_(0),
@@ -489,14 +512,19 @@ void EagerContext::ClearCachesAndDefaultExecutor() {
     // during this time as well.
     mutex_lock ml(cache_mu_);
     default_executor_.WaitForAllPendingNodes().IgnoreError();
-    kernel_cache_.clear();
+    kernel_cache_generation_.fetch_add(1, std::memory_order_release);
+    for (KernelCacheShard& shard : kernel_cache_) {
+      mutex_lock sl(shard.mu);
+      shard.kernels.clear();
+      shard.lru.clear();
+    }
     for (auto& entry : registered_functions_) {
       entry.second->cached_kernel_keys->clear();
     }
   }
-  {
-    mutex_lock dl(device_cache_mu_);
-    device_cache_.clear();
+  for (DeviceCacheShard& shard : device_cache_) {
+    mutex_lock dl(shard.mu);
+    shard.devices.clear();
   }
   {
     mutex_lock ml(metadata_mu_);
@@ -1009,8 +1037,9 @@ Status EagerContext::RemoveFunction(const string& func) {
   }
   bool is_last_ref = registered_function->RefCountIsOne();
   if (is_last_ref) {
+    kernel_cache_generation_.fetch_add(1, std::memory_order_release);
     for (auto& key : *registered_function->cached_kernel_keys) {
-      kernel_cache_.erase(key);
+      RemoveKernelFromCache(key);
     }
     registered_functions_.erase(func);
   }
@@ -1078,29 +1107,72 @@ Status EagerContext::SyncExecutors() {
 
 core::RefCountPtr<KernelAndDevice> EagerContext::GetCachedKernel(
     Fprint128 cache_key) {
-  tf_shared_lock l(cache_mu_);
-  auto iter = kernel_cache_.find(cache_key);
-  if (iter == kernel_cache_.end()) {
+  KernelCacheShard& shard = GetKernelCacheShard(cache_key);
+  mutex_lock l(shard.mu);
+  auto iter = shard.kernels.find(cache_key);
+  if (iter == shard.kernels.end()) {
+    eager_kernel_cache_counter->GetCell("miss")->IncrementBy(1);
     return nullptr;
   }
-  core::RefCountPtr<KernelAndDevice> new_ref(iter->second.get());
+  eager_kernel_cache_counter->GetCell("hit")->IncrementBy(1);
+  shard.lru.splice(shard.lru.begin(), shard.lru, iter->second.lru_position);
+  core::RefCountPtr<KernelAndDevice> new_ref(iter->second.kernel.get());
   new_ref->Ref();
   return new_ref;
 }
 
+bool EagerContext::TouchCachedKernel(Fprint128 cache_key,
+                                     const KernelAndDevice* kernel) {
+  KernelCacheShard& shard = GetKernelCacheShard(cache_key);
+  mutex_lock l(shard.mu);
+  auto iter = shard.kernels.find(cache_key);
+  if (iter == shard.kernels.end() || iter->second.kernel.get() != kernel) {
+    return false;
+  }
+  eager_kernel_cache_counter->GetCell("hit")->IncrementBy(1);
+  shard.lru.splice(shard.lru.begin(), shard.lru, iter->second.lru_position);
+  return true;
+}
+
 Device* EagerContext::GetCachedDevice(Fprint128 device_cache_key) {
-  tf_shared_lock l(device_cache_mu_);
-  auto iter = device_cache_.find(device_cache_key);
-  if (iter == device_cache_.end()) return nullptr;
+  DeviceCacheShard& shard = GetDeviceCacheShard(device_cache_key);
+  tf_shared_lock l(shard.mu);
+  auto iter = shard.devices.find(device_cache_key);
+  if (iter == shard.devices.end()) return nullptr;
   return iter->second;
 }
 
 void EagerContext::AddKernelToCache(Fprint128 cache_key,
                                     KernelAndDevice* kernel) {
-  mutex_lock ml(cache_mu_);
   core::RefCountPtr<KernelAndDevice> new_ref(kernel);
   new_ref->Ref();
-  kernel_cache_[cache_key] = std::move(new_ref);
+  // The evicted kernels are released after the locks, as their destruction may
+  // be expensive, e.g. for functions.
+  std::vector<core::RefCountPtr<KernelAndDevice>> evicted;
+  mutex_lock ml(cache_mu_);
+  {
+    KernelCacheShard& shard = GetKernelCacheShard(cache_key);
+    mutex_lock sl(shard.mu);
+    auto [iter, inserted] = shard.kernels.try_emplace(cache_key);
+    if (inserted) {
+      shard.lru.push_front(cache_key);
+    } else {
+      shard.lru.splice(shard.lru.begin(), shard.lru,
+                       iter->second.lru_position);
+      evicted.push_back(std::move(iter->second.kernel));
+    }
+    iter->second.kernel = std::move(new_ref);
+    iter->second.lru_position = shard.lru.begin();
+    while (kernel_cache_shard_capacity_ > 0 &&
+           static_cast<int64_t>(shard.kernels.size()) >
+               kernel_cache_shard_capacity_) {
+      auto lru_iter = shard.kernels.find(shard.lru.back());
+      evicted.push_back(std::move(lru_iter->second.kernel));
+      shard.kernels.erase(lru_iter);
+      shard.lru.pop_back();
+      eager_kernel_cache_counter->GetCell("eviction")->IncrementBy(1);
+    }
+  }
   auto* registered_function =
       gtl::FindPtrOrNull(registered_functions_, kernel->name());
   // The kernel name can be either a primitive op or a function.
@@ -1109,10 +1181,20 @@ void EagerContext::AddKernelToCache(Fprint128 cache_key,
   }
 }
 
+void EagerContext::RemoveKernelFromCache(Fprint128 cache_key) {
+  KernelCacheShard& shard = GetKernelCacheShard(cache_key);
+  mutex_lock l(shard.mu);
+  auto iter = shard.kernels.find(cache_key);
+  if (iter == shard.kernels.end()) return;
+  shard.lru.erase(iter->second.lru_position);
+  shard.kernels.erase(iter);
+}
+
 void EagerContext::AddDeviceToCache(Fprint128 device_cache_key,
                                     Device* device) {
-  mutex_lock l(device_cache_mu_);
-  device_cache_[device_cache_key] = device;
+  DeviceCacheShard& shard = GetDeviceCacheShard(device_cache_key);
+  mutex_lock l(shard.mu);
+  shard.devices[device_cache_key] = device;
 }
 
 bool EagerContext::ShouldStoreGraphs() { return should_store_graphs_.load(); }
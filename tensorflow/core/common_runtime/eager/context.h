@@ -16,7 +16,10 @@ limitations under the License.
 #define TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_CONTEXT_H_
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstddef>
+#include <list>
 #include <map>
 #include <memory>
 #include <queue>
@@ -256,12 +259,27 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
 
   Status AsyncWait() override { return SyncExecutors(); }
 
+  // The kernel cache holds at most TF_EAGER_KERNEL_CACHE_SIZE kernels, and
+  // evicts the least recently used ones beyond that. A non-positive size
+  // makes it unbounded.
   core::RefCountPtr<KernelAndDevice> GetCachedKernel(Fprint128 cache_key);
+  // Returns whether `kernel` still is the kernel of `cache_key` in the kernel
+  // cache, and if so marks it as the most recently used, like
+  // GetCachedKernel. The kernels kept outside of the cache are only reused
+  // while it holds them.
+  bool TouchCachedKernel(Fprint128 cache_key, const KernelAndDevice* kernel);
   Device* GetCachedDevice(Fprint128 device_cache_key);
 
   void AddKernelToCache(Fprint128 cache_key, KernelAndDevice* kernel);
   void AddDeviceToCache(Fprint128 device_cache_key, Device* device);
 
+  // Returns a number that changes whenever the cached kernels may become
+  // invalid, e.g. when the caches are cleared or a function is removed. The
+  // kernels kept outside of the cache must not be reused across a change.
+  int64_t KernelCacheGeneration() const {
+    return kernel_cache_generation_.load(std::memory_order_acquire);
+  }
+
   bool LogDevicePlacement() const { return log_device_placement_; }
   void SetLogDevicePlacement(bool enable) override {
     log_device_placement_ = enable;
@@ -741,20 +759,56 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
 
   std::function<void(std::function<void()>)> runner_;
 
+  // The kernel and device caches are sharded by key, so that the threads
+  // dispatching ops only contend when they look up the same shard. When both
+  // are needed, `cache_mu_` is acquired before the mutex of a shard. The
+  // shards are picked by the high bits of the keys, as their low bits hash
+  // the keys in the shards.
+  static constexpr int kNumCacheShards = 16;
+  struct KernelCacheShard {
+    struct Entry {
+      core::RefCountPtr<KernelAndDevice> kernel;
+      // The position of the key in `lru`.
+      std::list<Fprint128>::iterator lru_position;
+    };
+
+    mutex mu;
+    absl::flat_hash_map<Fprint128, Entry, Fprint128Hasher> kernels
+        TF_GUARDED_BY(mu);
+    // The keys of `kernels`, from the most to the least recently used.
+    std::list<Fprint128> lru TF_GUARDED_BY(mu);
+  };
+  struct DeviceCacheShard {
+    mutex mu;
+    absl::flat_hash_map<Fprint128, Device*, Fprint128Hasher> devices
+        TF_GUARDED_BY(mu);
+  };
+
+  KernelCacheShard& GetKernelCacheShard(Fprint128 cache_key) {
+    return kernel_cache_[cache_key.high64 % kNumCacheShards];
+  }
+  DeviceCacheShard& GetDeviceCacheShard(Fprint128 device_cache_key) {
+    return device_cache_[device_cache_key.high64 % kNumCacheShards];
+  }
+  // Removes the kernel of `cache_key` from the kernel cache, if any.
+  void RemoveKernelFromCache(Fprint128 cache_key);
+
+  // Guards the registered functions, and the consistency of the kernel cache
+  // with them.
   mutex cache_mu_;
-  mutex device_cache_mu_;
   struct RegisteredFunction : public core::RefCounted {
     ~RegisteredFunction() override {}
 
     std::unique_ptr<std::vector<Fprint128>> cached_kernel_keys;
   };
-  std::unordered_map<Fprint128, core::RefCountPtr<KernelAndDevice>,
-                     Fprint128Hasher>
-      kernel_cache_ TF_GUARDED_BY(cache_mu_);
+  std::array<KernelCacheShard, kNumCacheShards> kernel_cache_;
+  // The maximum number of kernels in a shard of `kernel_cache_`, or a
+  // non-positive number if unbounded.
+  const int64_t kernel_cache_shard_capacity_;
   std::unordered_map<string, RegisteredFunction*> registered_functions_
       TF_GUARDED_BY(cache_mu_);
-  absl::flat_hash_map<Fprint128, Device*, Fprint128Hasher> device_cache_
-      TF_GUARDED_BY(device_cache_mu_);
+  std::array<DeviceCacheShard, kNumCacheShards> device_cache_;
+  std::atomic<int64_t> kernel_cache_generation_{0};
 
   // Whether we should compute RunMetadata.
   std::atomic<bool> should_store_graphs_{false};
@@ -15,9 +15,13 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/eager/context.h"
 
+#include <stdlib.h>
+
 #include "absl/types/span.h"
 #include "tensorflow/core/common_runtime/eager/context_distributed_manager.h"
+#include "tensorflow/core/common_runtime/eager/kernel_and_device.h"
 #include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/errors.h"
@@ -404,5 +408,80 @@ TEST_F(EagerContextTest, ReuseGlobalRendezvous) {
   TestGlobalRendezvous(context(), true);
 }
 
+TEST_F(EagerContextTest, KernelCacheEvictsLeastRecentlyUsedKernels) {
+  // 1 kernel per shard.
+  setenv("TF_EAGER_KERNEL_CACHE_SIZE", "16", /*overwrite=*/1);
+  InitContext(SessionOptions(), DEVICE_PLACEMENT_EXPLICIT);
+  unsetenv("TF_EAGER_KERNEL_CACHE_SIZE");
+
+  NodeDef ndef;
+  ndef.set_name("mul");
+  ndef.set_op("Mul");
+  ndef.add_input("x");
+  ndef.add_input("y");
+  AddNodeAttr("T", DT_FLOAT, &ndef);
+  auto create_kernel = [&]() {
+    core::RefCountPtr<KernelAndDevice> kernel(new KernelAndDeviceOp(
+        /*rendezvous=*/nullptr, /*log_memory=*/false,
+        context()->func_lib(context()->HostCPU()), context()->runner(),
+        /*collective_executor=*/nullptr, context()->HostCPU()));
+    TF_CHECK_OK(kernel->Init(/*log_device_placement=*/false, ndef,
+                             /*graph_collector=*/nullptr));
+    return kernel;
+  };
+
+  // The keys are in the same shard.
+  const Fprint128 first_key{/*low64=*/1, /*high64=*/0};
+  const Fprint128 second_key{/*low64=*/2, /*high64=*/16};
+  const Fprint128 other_shard_key{/*low64=*/3, /*high64=*/1};
+  context()->AddKernelToCache(first_key, create_kernel().get());
+  context()->AddKernelToCache(other_shard_key, create_kernel().get());
+  EXPECT_NE(context()->GetCachedKernel(first_key), nullptr);
+
+  context()->AddKernelToCache(second_key, create_kernel().get());
+  EXPECT_EQ(context()->GetCachedKernel(first_key), nullptr);
+  EXPECT_NE(context()->GetCachedKernel(second_key), nullptr);
+  EXPECT_NE(context()->GetCachedKernel(other_shard_key), nullptr);
+}
+
+TEST_F(EagerContextTest, TouchCachedKernel) {
+  // 2 kernels per shard.
+  setenv("TF_EAGER_KERNEL_CACHE_SIZE", "32", /*overwrite=*/1);
+  InitContext(SessionOptions(), DEVICE_PLACEMENT_EXPLICIT);
+  unsetenv("TF_EAGER_KERNEL_CACHE_SIZE");
+
+  NodeDef ndef;
+  ndef.set_name("mul");
+  ndef.set_op("Mul");
+  ndef.add_input("x");
+  ndef.add_input("y");
+  AddNodeAttr("T", DT_FLOAT, &ndef);
+  auto create_kernel = [&]() {
+    core::RefCountPtr<KernelAndDevice> kernel(new KernelAndDeviceOp(
+        /*rendezvous=*/nullptr, /*log_memory=*/false,
+        context()->func_lib(context()->HostCPU()), context()->runner(),
+        /*collective_executor=*/nullptr, context()->HostCPU()));
+    TF_CHECK_OK(kernel->Init(/*log_device_placement=*/false, ndef,
+                             /*graph_collector=*/nullptr));
+    return kernel;
+  };
+
+  // The keys are in the same shard.
+  const Fprint128 first_key{/*low64=*/1, /*high64=*/0};
+  const Fprint128 second_key{/*low64=*/2, /*high64=*/16};
+  const Fprint128 third_key{/*low64=*/3, /*high64=*/32};
+  core::RefCountPtr<KernelAndDevice> first_kernel = create_kernel();
+  core::RefCountPtr<KernelAndDevice> second_kernel = create_kernel();
+  context()->AddKernelToCache(first_key, first_kernel.get());
+  context()->AddKernelToCache(second_key, second_kernel.get());
+  EXPECT_FALSE(context()->TouchCachedKernel(first_key, second_kernel.get()));
+
+  // Touching the first kernel makes the second one the least recently used.
+  EXPECT_TRUE(context()->TouchCachedKernel(first_key, first_kernel.get()));
+  context()->AddKernelToCache(third_key, create_kernel().get());
+  EXPECT_TRUE(context()->TouchCachedKernel(first_key, first_kernel.get()));
+  EXPECT_FALSE(context()->TouchCachedKernel(second_key, second_kernel.get()));
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -15,7 +15,10 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/eager/eager_executor.h"
 
+#include <algorithm>
 #include <forward_list>
+#include <utility>
+#include <vector>
 
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
@@ -29,10 +32,19 @@ bool IsAsyncWaitForRemoteFunctionEnabled() {
                                  true, &enabled));
   return enabled;
 }
+
+int64_t MaxCoalescedNodes(int max_coalesced_nodes) {
+  if (max_coalesced_nodes > 0) return max_coalesced_nodes;
+  int64_t value = 1;
+  TF_CHECK_OK(ReadInt64FromEnvVar("TF_EAGER_ASYNC_MAX_COALESCED_NODES", 1,
+                                  &value));
+  return std::max<int64_t>(value, 1);
+}
 }  // namespace
 
 EagerExecutor::EagerExecutor(bool async, bool enable_streaming_enqueue,
-                             int in_flight_nodes_limit)
+                             int in_flight_nodes_limit,
+                             int max_coalesced_nodes)
     : next_node_id_(0),
       ok_(true),
       thread_(async ? tensorflow::Env::Default()->StartThread(
@@ -43,11 +55,16 @@ EagerExecutor::EagerExecutor(bool async, bool enable_streaming_enqueue,
       enable_async_wait_for_remote_function_(
           IsAsyncWaitForRemoteFunctionEnabled()),
       enable_streaming_enqueue_(enable_streaming_enqueue),
-      in_flight_nodes_limit_(in_flight_nodes_limit) {
+      in_flight_nodes_limit_(in_flight_nodes_limit),
+      max_coalesced_nodes_(MaxCoalescedNodes(max_coalesced_nodes)) {
   if (async && in_flight_nodes_limit_ > 0) {
     LOG(INFO) << "EagerExecutor InFlightNodes limit is set to "
               << in_flight_nodes_limit_;
   }
+  if (async && max_coalesced_nodes_ > 1) {
+    VLOG(1) << "EagerExecutor coalesces up to " << max_coalesced_nodes_
+            << " nodes";
+  }
 }
 
 EagerExecutor::~EagerExecutor() {
@@ -157,7 +174,7 @@ Status EagerExecutor::AddOrExecute(std::unique_ptr<EagerNode> node) {
     } else {
       status = status_;
       if (status.ok()) {
-        node_queue_.push(std::move(item));
+        node_queue_.push_back(std::move(item));
         // If there were no previous nodes pending, wake the run thread to
         // start processing requests again.
         if (node_queue_.size() == 1) {
@@ -253,7 +270,7 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
     if (from_queue) {
       // Since this was from the async queue, pop it from the front of the queue
       DCHECK(!node_queue_.empty() && item.get() == node_queue_.front().get());
-      node_queue_.pop();
+      node_queue_.pop_front();
     } else if (async) {
       // If it is an Async node then we will find the node in the unfinished
       // nodes list. However we only notify if we are at the front of the list
@@ -287,7 +304,7 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
       }
       while (!node_queue_.empty()) {
         items_to_destroy.push_front(std::move(node_queue_.front()));
-        node_queue_.pop();
+        node_queue_.pop_front();
       }
       for (auto& it : unfinished_nodes_) {
         items_to_destroy.push_front(std::move(it.second));
@@ -345,7 +362,7 @@ void EagerExecutor::Run() {
   auto thread_exited_notifier =
       gtl::MakeCleanup([this] { thread_exited_notification_.Notify(); });
   while (true) {
-    core::RefCountPtr<NodeItem> curr_item;
+    std::vector<core::RefCountPtr<NodeItem>> curr_items;
     {
       tensorflow::mutex_lock l(node_queue_mutex_);
       while (node_queue_.empty() || !status_.ok()) {
@@ -359,16 +376,64 @@ void EagerExecutor::Run() {
       // will then contain a nullptr. This can be a problem in
       // WaitForAllPendingNodes where we get the top EagerNode pointer
       // and register a notification for its completion.
-      curr_item.reset(node_queue_.front().get());
-      curr_item->Ref();
+      // The synchronous nodes that follow the front one are run along with it,
+      // up to max_coalesced_nodes_ of them.
+      for (const core::RefCountPtr<NodeItem>& item : node_queue_) {
+        if (!curr_items.empty() &&
+            (static_cast<int64_t>(curr_items.size()) >= max_coalesced_nodes_ ||
+             curr_items.front()->node->AsAsync() != nullptr ||
+             item->node->AsAsync() != nullptr)) {
+          break;
+        }
+        curr_items.emplace_back(item.get());
+        curr_items.back()->Ref();
+      }
     }
-    Status status = RunItem(std::move(curr_item), /*from_queue=*/true);
+    if (curr_items.size() > 1) {
+      RunCoalescedItems(std::move(curr_items));
+      continue;
+    }
+    Status status = RunItem(std::move(curr_items.front()), /*from_queue=*/true);
     if (!status.ok()) {
       VLOG(1) << "Failed to run item: " << status;
     }
   }
 }
 
+void EagerExecutor::RunCoalescedItems(
+    std::vector<core::RefCountPtr<NodeItem>> items) {
+  DVLOG(3) << "Running " << items.size() << " coalesced Nodes: [id "
+           << items.front()->id << " to " << items.back()->id << "]";
+  size_t num_done = 0;
+  Status status;
+  for (; num_done < items.size(); ++num_done) {
+    status = items[num_done]->node->Run();
+    if (!status.ok()) break;
+    items[num_done]->state = NodeState::kDONE;
+  }
+
+  if (num_done > 0) {
+    mutex_lock l(node_queue_mutex_);
+    // The queue has been cleared if another node failed in the meantime.
+    if (!status_.ok()) return;
+    for (size_t i = 0; i < num_done; ++i) {
+      DCHECK(!node_queue_.empty() &&
+             items[i].get() == node_queue_.front().get());
+      node_queue_.pop_front();
+    }
+    NotifyWaiters(items.front()->id);
+    // Notify AddOrExecute() some nodes have been done.
+    nodes_done_.notify_all();
+  }
+
+  if (!status.ok()) {
+    VLOG(1) << "Failed to run item: " << status;
+    NodeDone(items[num_done], status, /*from_queue=*/true);
+  }
+  // `items` are destructed here, while not holding node_queue_mutex_, see
+  // NodeDone().
+}
+
 Status EagerExecutor::RunItem(core::RefCountPtr<NodeItem> item,
                               bool from_queue) {
   DVLOG(3) << "Running Node: [id " << item->id << "] "
@@ -431,7 +496,7 @@ Status EagerExecutor::MoveToUnfinished(core::RefCountPtr<NodeItem> item,
 
   if (from_queue) {
     DCHECK(!node_queue_.empty() && item.get() == node_queue_.front().get());
-    node_queue_.pop();
+    node_queue_.pop_front();
   }
 
   DVLOG(3) << "Add Node: [id " << item->id << "] to unfinished map.";
@@ -17,9 +17,9 @@ limitations under the License.
 
 #include <algorithm>
 #include <cstddef>
+#include <deque>
 #include <map>
 #include <memory>
-#include <queue>
 #include <string>
 #include <vector>
 
@@ -111,8 +111,15 @@ class AsyncRemoteExecuteNode : public AsyncEagerNode {
 // TODO(agarwal): Implement optimizations over EagerNode traces.
 class EagerExecutor {
  public:
+  // In async mode, up to `max_coalesced_nodes` consecutive synchronous nodes
+  // of the queue are run back to back by the executor thread and completed
+  // together, which takes the queue lock and wakes up the waiters once per
+  // batch instead of once per node. If it is 0, it is read from the
+  // TF_EAGER_ASYNC_MAX_COALESCED_NODES environment variable, which defaults to
+  // 1, i.e. no coalescing.
   explicit EagerExecutor(bool async, bool enable_streaming_enqueue = true,
-                         int in_flight_nodes_limit = 0);
+                         int in_flight_nodes_limit = 0,
+                         int max_coalesced_nodes = 0);
 
   ~EagerExecutor();
 
@@ -207,6 +214,10 @@ class EagerExecutor {
   void Run();
 
   Status RunItem(core::RefCountPtr<NodeItem> item, bool from_queue);
+  // Runs `items`, consecutive synchronous nodes at the front of the queue, and
+  // removes the ones that succeeded from the queue at once. Stops at the first
+  // failure, which is handled by NodeDone().
+  void RunCoalescedItems(std::vector<core::RefCountPtr<NodeItem>> items);
   Status MoveToUnfinished(core::RefCountPtr<NodeItem> item, bool from_queue);
 
   // The impl of WaitForAllPendingNodes
@@ -226,7 +237,7 @@ class EagerExecutor {
   condition_variable nodes_done_ TF_GUARDED_BY(node_queue_mutex_);
 
   // Queue of pending NodeItems. Ordered by NodeItem::id.
-  std::queue<core::RefCountPtr<NodeItem>> node_queue_
+  std::deque<core::RefCountPtr<NodeItem>> node_queue_
       TF_GUARDED_BY(node_queue_mutex_);
 
   // Ordered by NodeItem::id.
@@ -273,6 +284,9 @@ class EagerExecutor {
   // async nodes reach this number, enqueuing to the eager async queue is
   // blocked.
   const int64_t in_flight_nodes_limit_;
+
+  // The maximum number of synchronous nodes run as one batch by `thread_`.
+  const int64_t max_coalesced_nodes_;
 };
 
 inline bool EagerExecutor::Async() const { return thread_ != nullptr; }
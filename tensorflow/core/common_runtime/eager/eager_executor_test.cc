@@ -16,6 +16,7 @@ limitations under the License.
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/status_matchers.h"
@@ -241,6 +242,44 @@ TEST(EagerExecutorTest, TestAsyncExecutorFailRun) {
   ASSERT_EQ(state->read_state(), TestState::State::kFailure);
 }
 
+TEST(EagerExecutorTest, TestAsyncExecutorWithCoalescedEagerNodes) {
+  auto async_executor = std::make_unique<EagerExecutor>(
+      /*async=*/true, /*enable_streaming_enqueue=*/true,
+      /*in_flight_nodes_limit=*/0, /*max_coalesced_nodes=*/4);
+
+  std::vector<std::unique_ptr<TestState>> states;
+  for (int i = 0; i < 10; ++i) {
+    states.push_back(std::make_unique<TestState>());
+    TF_ASSERT_OK(async_executor->AddOrExecute(
+        std::make_unique<TestEagerNode>(states.back().get())));
+  }
+  auto async_state = std::make_unique<TestState>();
+  TF_ASSERT_OK(async_executor->AddOrExecute(
+      std::make_unique<TestAsyncEagerNode>(async_state.get())));
+  TF_ASSERT_OK(async_executor->WaitForAllPendingNodes());
+  for (const auto& state : states) {
+    ASSERT_EQ(state->read_state(), TestState::State::kSuccess);
+  }
+  ASSERT_EQ(async_state->read_state(), TestState::State::kSuccess);
+}
+
+TEST(EagerExecutorTest, TestAsyncExecutorFailRunWithCoalescedEagerNodes) {
+  auto async_executor = std::make_unique<EagerExecutor>(
+      /*async=*/true, /*enable_streaming_enqueue=*/true,
+      /*in_flight_nodes_limit=*/0, /*max_coalesced_nodes=*/4);
+
+  auto state = std::make_unique<TestState>();
+  auto failed_state = std::make_unique<TestState>();
+  TF_ASSERT_OK(async_executor->AddOrExecute(
+      std::make_unique<TestEagerNode>(state.get())));
+  TF_ASSERT_OK(async_executor->AddOrExecute(std::make_unique<TestEagerNode>(
+      failed_state.get(), OkStatus(), errors::Internal("test"))));
+  auto status = async_executor->WaitForAllPendingNodes();
+  ASSERT_EQ(status.code(), tensorflow::error::INTERNAL);
+  ASSERT_EQ(state->read_state(), TestState::State::kSuccess);
+  ASSERT_EQ(failed_state->read_state(), TestState::State::kFailure);
+}
+
 TEST(EagerExecutorTest, TestAsyncExecutorFailPrepareWithAsyncNode) {
   auto async_executor = std::make_unique<EagerExecutor>(
       /*async=*/true, /*enable_streaming_enqueue=*/true);
@@ -340,6 +340,7 @@ Status EagerOperation::Reset(
         "registered in the binary running in this process.");
   }
   attrs_.Reset(op);
+  cached_kernel_.reset();
   stack_trace_.reset();
   is_function_ = is_function;
   cancellation_manager_ = nullptr;
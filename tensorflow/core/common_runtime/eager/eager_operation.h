@@ -216,6 +216,38 @@ class EagerOperation : public ImmediateExecutionOperation {
   // Op name recorded for memory debugging purpose.
   const char* op_name() const { return op_name_; }
 
+  // The kernel an op was last executed with, and what its lookup in the kernel
+  // cache depended on. When an op is executed again with only its inputs
+  // replaced, the kernel is reused without fingerprinting the op again.
+  struct CachedKernel {
+    // The input placement the kernel was looked up for.
+    struct Input {
+      TensorHandle::HandleType type;
+      class Device* device;
+      DataType dtype;
+    };
+
+    core::RefCountPtr<KernelAndDevice> kernel;
+    // The key of `kernel` in the kernel cache.
+    Fprint128 cache_key;
+    Fprint128 attrs_cache_key;
+    class Device* device;
+    int64_t kernel_cache_generation;
+    bool allow_soft_placement;
+    bool run_eager_op_as_function;
+    bool reuse_rendezvous_for_functions;
+    // Whether the kernel depends on the placement of the inputs, in which case
+    // it is only reused for inputs placed like `inputs`.
+    bool depends_on_inputs;
+    absl::InlinedVector<Input, 4> inputs;
+  };
+  const absl::optional<CachedKernel>& cached_kernel() const {
+    return cached_kernel_;
+  }
+  void SetCachedKernel(CachedKernel cached_kernel) {
+    cached_kernel_ = std::move(cached_kernel);
+  }
+
   // For LLVM style RTTI.
   static bool classof(const AbstractOperation* ptr) {
     return ptr->getKind() == kEager;
@@ -279,6 +311,8 @@ class EagerOperation : public ImmediateExecutionOperation {
 
   absl::optional<EagerFunctionParams> eager_func_params_;
 
+  absl::optional<CachedKernel> cached_kernel_;
+
   // Inference information
   const tensorflow::OpDef* op_def_;  // op definition from protobuf
   int inference_arg_idx_;  // arg definition index for the next input to be
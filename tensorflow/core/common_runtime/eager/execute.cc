@@ -1073,12 +1073,110 @@ Fprint128 GetDeviceCacheKey(EagerOperation* op, const EagerContext& ctx) {
   return device_cache_key;
 }
 
+// Returns the kernel `op` was last executed with if its lookup in the kernel
+// cache would return it again, or nullptr.
+core::RefCountPtr<KernelAndDevice> GetReusableKernel(const EagerOperation& op,
+                                                     EagerContext& ctx,
+                                                     Device* device) {
+  const absl::optional<EagerOperation::CachedKernel>& cached =
+      op.cached_kernel();
+  if (!cached.has_value() || device == nullptr || cached->device != device ||
+      cached->kernel_cache_generation != ctx.KernelCacheGeneration() ||
+      cached->allow_soft_placement != ctx.AllowSoftPlacement() ||
+      cached->run_eager_op_as_function != ctx.RunEagerOpAsFunction() ||
+      cached->reuse_rendezvous_for_functions !=
+          ctx.GetReuseRendezvousForFunctions()) {
+    return nullptr;
+  }
+  absl::optional<Fprint128> attrs_cache_key =
+      op.Attrs().CachedCacheKey(op.DeviceName());
+  if (!attrs_cache_key.has_value() ||
+      !(*attrs_cache_key == cached->attrs_cache_key)) {
+    return nullptr;
+  }
+  if (cached->depends_on_inputs) {
+    const absl::InlinedVector<TensorHandle*, 4>* inputs;
+    if (!op.TensorHandleInputs(&inputs).ok() ||
+        inputs->size() != cached->inputs.size()) {
+      return nullptr;
+    }
+    for (int i = 0, end = inputs->size(); i < end; ++i) {
+      const TensorHandle& input = *(*inputs)[i];
+      const EagerOperation::CachedKernel::Input& cached_input =
+          cached->inputs[i];
+      if (input.Type() != cached_input.type ||
+          input.device() != cached_input.device ||
+          input.dtype != cached_input.dtype) {
+        return nullptr;
+      }
+    }
+  }
+  // The kernel may have been evicted from the cache since, e.g. to make room
+  // for other kernels.
+  if (!ctx.TouchCachedKernel(cached->cache_key, cached->kernel.get())) {
+    return nullptr;
+  }
+  core::RefCountPtr<KernelAndDevice> kernel(cached->kernel.get());
+  kernel->Ref();
+  return kernel;
+}
+
+// Records `kernel`, cached with `cache_key` and looked up with
+// `attrs_cache_key`, as the kernel of the next executions of `op`.
+void SetReusableKernel(EagerOperation* op, const EagerContext& ctx,
+                       int64_t kernel_cache_generation, Device* device,
+                       const Fprint128& cache_key,
+                       const Fprint128& attrs_cache_key,
+                       KernelAndDevice* kernel) {
+  EagerOperation::CachedKernel cached;
+  cached.depends_on_inputs = op->is_function() || ctx.RunEagerOpAsFunction();
+  if (cached.depends_on_inputs) {
+    const absl::InlinedVector<TensorHandle*, 4>* inputs;
+    if (!op->TensorHandleInputs(&inputs).ok()) return;
+    for (const TensorHandle* input : *inputs) {
+      // The kernels of the functions also depend on the dtypes and shapes of
+      // the resource variables, which can't be checked cheaply.
+      if (input->dtype == DT_RESOURCE) return;
+      cached.inputs.push_back({input->Type(), input->device(), input->dtype});
+    }
+  }
+  kernel->Ref();
+  cached.kernel.reset(kernel);
+  cached.cache_key = cache_key;
+  cached.attrs_cache_key = attrs_cache_key;
+  cached.device = device;
+  cached.kernel_cache_generation = kernel_cache_generation;
+  cached.allow_soft_placement = ctx.AllowSoftPlacement();
+  cached.run_eager_op_as_function = ctx.RunEagerOpAsFunction();
+  cached.reuse_rendezvous_for_functions = ctx.GetReuseRendezvousForFunctions();
+  op->SetCachedKernel(std::move(cached));
+}
+
 Status GetOrCreateKernelAndDevice(
     EagerOperation* op, TensorHandle** retvals, int* num_retvals,
     core::RefCountPtr<KernelAndDevice>* out_kernel) {
   EagerContext& ctx = op->EagerContext();
   Device* device = absl::get<Device*>(op->Device());
 
+  // An op executed again with only its inputs replaced reuses its kernel.
+  core::RefCountPtr<KernelAndDevice> reusable_kernel =
+      GetReusableKernel(*op, ctx, device);
+  if (reusable_kernel != nullptr) {
+    int num_outputs = reusable_kernel->num_outputs();
+    if (num_outputs > *num_retvals) {
+      return errors::InvalidArgument("Expecting ", num_outputs,
+                                     " outputs, but *num_retvals is ",
+                                     *num_retvals);
+    }
+    *num_retvals = num_outputs;
+    *out_kernel = std::move(reusable_kernel);
+    return OkStatus();
+  }
+  EagerOperation* original_op = op;
+  // Read before the lookup, so that the kernel isn't reused if the cache is
+  // cleared after it.
+  const int64_t kernel_cache_generation = ctx.KernelCacheGeneration();
+
   // Set the EagerOperation's device prior to extracting the input_device_ptrs
   // to avoid any redundant H2D/D2H copies.
   if (device == nullptr && !op->is_function()) {
@@ -1116,12 +1214,14 @@ Status GetOrCreateKernelAndDevice(
         input_resource_variable_dtypes_and_shapes));
   }
 
+  const Fprint128 attrs_cache_key =
+      op->MutableAttrs()->CacheKey(op->DeviceName());
   TF_ASSIGN_OR_RETURN(
       Fprint128 cache_key,
-      GetKernelCacheKey(*op, op->MutableAttrs()->CacheKey(op->DeviceName()),
-                        input_device_ptrs,
+      GetKernelCacheKey(*op, attrs_cache_key, input_device_ptrs,
                         input_resource_variable_dtypes_and_shapes));
   core::RefCountPtr<KernelAndDevice> kernel = ctx.GetCachedKernel(cache_key);
+  bool kernel_is_cached = kernel != nullptr;
   AbstractOperationPtr wrapped_op_releaser;
   // We can eliminate some overhead by running simple functions using regular
   // CallOp kernel. However, it is tricky to figure out which functions should
@@ -1279,6 +1379,7 @@ Status GetOrCreateKernelAndDevice(
 
     if (op->is_function()) {
       ctx.AddKernelToCache(cache_key, kernel.get());
+      kernel_is_cached = true;
     } else {
       // Exclude tf.data op kernels from being cached. The reason for this is
       // that tf.data op kernels that accept a user-defined function will have a
@@ -1290,6 +1391,7 @@ Status GetOrCreateKernelAndDevice(
       TF_RETURN_IF_ERROR(OpDefForOp(op->Name().data(), &op_def));
       if (KernelCacheEnabled(*op_def)) {
         ctx.AddKernelToCache(cache_key, kernel.get());
+        kernel_is_cached = true;
       }
     }
   }
@@ -1302,6 +1404,13 @@ Status GetOrCreateKernelAndDevice(
   }
   *num_retvals = num_outputs;
 
+  // Only the kernels that are cached are reused, e.g. not those of the tf.data
+  // ops.
+  if (kernel_is_cached) {
+    SetReusableKernel(original_op, ctx, kernel_cache_generation, device,
+                      cache_key, attrs_cache_key, kernel.get());
+  }
+
   kernel->Ref();  // Ownership of reference is passed to out_kernel.
   out_kernel->reset(kernel.get());
   return OkStatus();
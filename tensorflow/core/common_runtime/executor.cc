@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -29,10 +30,12 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_view.h"
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
+#include "tensorflow/core/common_runtime/memory_planner.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
 #include "tensorflow/core/common_runtime/propagator_state.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
@@ -60,6 +63,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
@@ -77,6 +81,7 @@ limitations under the License.
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tensorflow/core/util/determinism.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/managed_stack_trace.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
 
@@ -138,13 +143,23 @@ struct KernelTimer {
   }
 };
 
+// The work-stealing worker run by the current thread, if any. Threads may run
+// workers of several steps, whose executors are nested.
+struct CurrentWorker {
+  const void* executor_state = nullptr;
+  int queue_index = -1;
+};
+thread_local CurrentWorker current_worker;
+
 // TODO(b/152925936): Re-evaluate these constants with current usage patterns.
 typedef gtl::InlinedVector<TensorValue, 4> TensorValueVec;
 typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
 
 class ExecutorImpl : public Executor {
  public:
-  explicit ExecutorImpl(const LocalExecutorParams& p) : immutable_state_(p) {}
+  explicit ExecutorImpl(const LocalExecutorParams& p,
+                        bool work_stealing = false)
+      : immutable_state_(p), work_stealing_(work_stealing) {}
 
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
@@ -167,11 +182,20 @@ class ExecutorImpl : public Executor {
       is_expensive_.resize(gview.num_nodes());
       cost_estimates_ =
           std::make_unique<std::atomic_uint_fast64_t[]>(gview.num_nodes());
+      timing_sample_period_ = ReadTimingSamplePeriod();
+      if (timing_sample_period_ > 0) {
+        timing_cells_ =
+            std::make_unique<monitoring::SamplerCell*[]>(gview.num_nodes());
+      }
       for (int32_t i = 0; i < gview.num_nodes(); ++i) {
         if (gview.node(i)) {
           is_expensive_[i] =
               gview.node(i)->kernel && gview.node(i)->kernel->IsExpensive();
           cost_estimates_[i] = kInitialCostEstimateCycles;
+          if (timing_cells_ != nullptr && gview.node(i)->kernel) {
+            timing_cells_[i] = metrics::GetKernelExecutionTimeCell(
+                gview.node(i)->kernel->type_string());
+          }
         }
       }
     }
@@ -207,7 +231,45 @@ class ExecutorImpl : public Executor {
       cost_estimate.store(new_estimate, std::memory_order_relaxed);
     }
 
+    // Returns true if the execution time of the next synchronous kernel run by
+    // the executor should be recorded, which is the case for one kernel out of
+    // every timing_sample_period_.
+    bool ShouldSampleTiming() {
+      if (timing_cells_ == nullptr) {
+        return false;
+      }
+      // N.B. Like the cost estimates, the countdown is atomic but unlocked, so
+      // concurrent kernels may be sampled slightly more or less often.
+      if (kernels_until_sample_.fetch_sub(1, std::memory_order_relaxed) > 1) {
+        return false;
+      }
+      kernels_until_sample_.store(timing_sample_period_,
+                                  std::memory_order_relaxed);
+      return true;
+    }
+
+    // Records a sampled execution time of the kernel of `node` in the
+    // histogram of its op type.
+    void RecordSampledTiming(const NodeItem& node, uint64 elapsed_cycles) {
+      timing_cells_[node.node_id]->Add(
+          elapsed_cycles * profile_utils::CpuUtils::GetMicroSecPerClock());
+    }
+
    private:
+    // Returns the number of synchronous kernels run by an executor between two
+    // timed ones, read from the environment variable
+    // TF_KERNEL_TIMING_SAMPLE_PERIOD when the executor is created. 0, the
+    // default, disables the sampling.
+    static int64_t ReadTimingSamplePeriod() {
+      int64_t period;
+      Status status =
+          ReadInt64FromEnvVar("TF_KERNEL_TIMING_SAMPLE_PERIOD", 0, &period);
+      if (!status.ok()) {
+        LOG(ERROR) << status;
+      }
+      return period;
+    }
+
     // Initial time (in CPU cycles) we expect an operation to take.  Used to
     // determine whether an operation should be place in a threadpool.
     // Operations start out "expensive".
@@ -218,10 +280,19 @@ class ExecutorImpl : public Executor {
     std::vector<bool> is_expensive_;
     // std::unique_ptr<std::atomic<bool>[]> is_expensive_;
     std::unique_ptr<std::atomic_uint_fast64_t[]> cost_estimates_;
+    int64_t timing_sample_period_ = 0;
+    // The number of synchronous kernels to run until the next timed one.
+    std::atomic<int64_t> kernels_until_sample_{0};
+    // The histograms of the op types of the nodes, or null if timings are not
+    // sampled.
+    std::unique_ptr<monitoring::SamplerCell*[]> timing_cells_;
   };
 
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
+  // If true, expensive ready nodes are scheduled on per-worker deques. See
+  // `ExecutorState::RunWorker()`.
+  const bool work_stealing_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(ExecutorImpl);
 };
@@ -280,7 +351,8 @@ class ExecutorState {
  public:
   ExecutorState(const Executor::Args& args,
                 const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+                ExecutorImpl::KernelStats* kernel_stats_,
+                bool work_stealing = false);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -342,6 +414,41 @@ class ExecutorState {
   template <typename Closure>
   void RunTask(Closure&& c, int sample_rate = 0);
 
+  // Work-stealing scheduling of the expensive ready nodes.
+  //
+  // Every worker owns a deque of nodes. The nodes made ready by a worker are
+  // pushed to the back of its own deque and popped from there, so that the
+  // consumers of a node tend to run right after it on the same thread, while
+  // its outputs are still in cache. Workers whose deques are empty steal from
+  // the front of the deques of the others, and exit when all of them are
+  // empty. Workers are closures passed to `runner_`, started when nodes are
+  // pushed while fewer workers than deques are running.
+  struct QueuedNode {
+    TaggedNode tagged_node;
+    int64_t scheduled_nsec;
+  };
+  struct WorkerQueue {
+    mutex mu;
+    std::deque<QueuedNode> nodes TF_GUARDED_BY(mu);
+  };
+
+  // Pushes `nodes` to the deque of the calling thread's worker, or to the next
+  // deque in round-robin order if the thread doesn't run a worker of this
+  // step, and starts workers to steal them.
+  void PushToWorkerQueue(const TaggedNodeSeq& nodes, int64_t scheduled_nsec);
+
+  // Increments `num_running_workers_` unless all the workers are running.
+  // Returns true if it was incremented.
+  bool TryReserveWorker();
+
+  // Runs the nodes of the deque at `queue_index`, and those stolen from the
+  // other deques, until they are all empty.
+  void RunWorker(int queue_index);
+
+  // Pops a node from the back of the deque at `queue_index`, or steals one
+  // from the front of another deque. Returns nullopt if all of them are empty.
+  absl::optional<QueuedNode> PopOrStealNode(int queue_index);
+
   // Clean up when this executor is done.
   void Finish();
   void ScheduleFinish();
@@ -393,6 +500,19 @@ class ExecutorState {
   Executor::Args::Runner runner_;
   bool sync_on_finish_;
   const bool run_all_kernels_inline_;
+  // If not null, serves the allocations of the kernels whose tensors are not
+  // expected to outlive the step. Released when the step is done.
+  StepArenaAllocator* step_arena_ = nullptr;
+  // If not null, serves the outputs planned by the memory plan of the
+  // executor. Unreferenced when the step is done.
+  PlannedStepMemory* step_memory_ = nullptr;
+
+  // The worker deques, if work stealing is enabled.
+  std::unique_ptr<WorkerQueue[]> worker_queues_;
+  int num_worker_queues_ = 0;
+  // The number of workers running. At most `num_worker_queues_`.
+  std::atomic<int> num_running_workers_{0};
+  std::atomic<uint32> next_worker_queue_{0};
 
   PropagatorStateType propagator_;
 
@@ -414,7 +534,7 @@ class ExecutorState {
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats, bool work_stealing)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -444,11 +564,25 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       run_all_kernels_inline_(args.run_all_kernels_inline),
       propagator_(immutable_state, step_id_, vlog_),
       num_outstanding_ops_(0) {
+  Device* device = immutable_state_.params().device;
   if (args.user_intra_op_threadpool != nullptr) {
-    Device* device = immutable_state_.params().device;
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (args.use_step_arena && device->device_type() == DEVICE_CPU) {
+    step_arena_ = new StepArenaAllocator(
+        device->GetAllocator(AllocatorAttributes()),
+        StepArenaAllocator::Options());
+  }
+  if (immutable_state_.params().memory_plan != nullptr) {
+    step_memory_ = new PlannedStepMemory(
+        immutable_state_.params().memory_plan,
+        device->GetAllocator(AllocatorAttributes()));
+  }
+  if (work_stealing && !run_all_kernels_inline_) {
+    num_worker_queues_ = port::MaxParallelism();
+    worker_queues_ = std::make_unique<WorkerQueue[]>(num_worker_queues_);
+  }
 }
 
 template <class PropagatorStateType>
@@ -457,6 +591,12 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
     device_context_->Unref();
   }
   delete slice_reader_cache_;
+  if (step_arena_) {
+    step_arena_->Release();
+  }
+  if (step_memory_) {
+    step_memory_->Unref();
+  }
 }
 
 template <class PropagatorStateType>
@@ -597,19 +737,29 @@ Status ExecutorState<PropagatorStateType>::ProcessSync(
         },
         profiler::GetTFTraceMeLevel(is_expensive));
     device->Compute(op_kernel, &ctx);
-  } else if (kernel_stats_->HasExpensiveMarker(item)) {
-    KernelTimer timer;
-    device->Compute(op_kernel, &ctx);
-    // For expensive kernels, always update the cost estimate. For inexpensive
-    // kernels, update the cost estimate with ~1/16 probability. This assumes
-    // that the last 4 bits of the CPU cycle count is uniformly distributed.
-    constexpr int kKernelExecutionTrackingInvocationSkipCount = 16;
-    if (is_expensive ||
-        timer.start_cycles % kKernelExecutionTrackingInvocationSkipCount == 0) {
-      kernel_stats_->UpdateCostEstimate(item, timer.ElapsedCycles());
-    }
   } else {
-    device->Compute(op_kernel, &ctx);
+    const bool sample_timing = kernel_stats_->ShouldSampleTiming();
+    if (sample_timing || kernel_stats_->HasExpensiveMarker(item)) {
+      KernelTimer timer;
+      device->Compute(op_kernel, &ctx);
+      const uint64 elapsed_cycles = timer.ElapsedCycles();
+      // For expensive kernels, always update the cost estimate. For
+      // inexpensive kernels, update the cost estimate with ~1/16 probability.
+      // This assumes that the last 4 bits of the CPU cycle count is uniformly
+      // distributed.
+      constexpr int kKernelExecutionTrackingInvocationSkipCount = 16;
+      if (kernel_stats_->HasExpensiveMarker(item) &&
+          (is_expensive ||
+           timer.start_cycles % kKernelExecutionTrackingInvocationSkipCount ==
+               0)) {
+        kernel_stats_->UpdateCostEstimate(item, elapsed_cycles);
+      }
+      if (sample_timing) {
+        kernel_stats_->RecordSampledTiming(item, elapsed_cycles);
+      }
+    } else {
+      device->Compute(op_kernel, &ctx);
+    }
   }
   nodestats::SetOpEnd(stats);
   if (outputs->size() < item.num_outputs) outputs->resize(item.num_outputs);
@@ -867,14 +1017,22 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
       params.is_input_dead = is_input_dead;
       params.output_attr_array = item.output_attrs();
       params.forward_from_array = item.forward_from();
+      params.step_arena_allocator =
+          item.may_use_step_arena ? step_arena_ : nullptr;
       params.outputs_required_array = item.outputs_required.get();
       params.inputs = inputs;
       params.input_alloc_attrs = input_alloc_attrs;
 
       if (item.kernel_is_async) {
+        params.planned_output_buffers = nullptr;
         ProcessAsync(item, params, tagged_node, first_input, stats,
                      activity_id);
         launched_asynchronously = true;
+      } else if (step_memory_ != nullptr) {
+        PlannedStepMemory::NodeOutputs planned_outputs(step_memory_, id);
+        params.planned_output_buffers = &planned_outputs;
+        s = ProcessSync(item, &params, &outputs, stats);
+        params.planned_output_buffers = nullptr;
       } else {
         s = ProcessSync(item, &params, &outputs, stats);
       }
@@ -1256,6 +1414,27 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
         inline_ready->push_back(tagged_node);
       }
     }
+  } else if (worker_queues_ != nullptr) {
+    TaggedNodeSeq expensive_nodes;
+    for (auto& tagged_node : *ready) {
+      if (inline_ready != nullptr &&
+          (tagged_node.get_is_dead() ||
+           !kernel_stats_->IsExpensive(*tagged_node.node_item))) {
+        // Inline this inexpensive node.
+        inline_ready->push_back(tagged_node);
+      } else {
+        expensive_nodes.push_back(tagged_node);
+      }
+    }
+    if (inline_ready != nullptr && inline_ready->empty()) {
+      // There is nothing else to run on this thread, so run the last expensive
+      // node inline instead of pushing it.
+      inline_ready->push_back(expensive_nodes.back());
+      expensive_nodes.pop_back();
+    }
+    if (!expensive_nodes.empty()) {
+      PushToWorkerQueue(expensive_nodes, scheduled_nsec);
+    }
   } else {
     const TaggedNode* curr_expensive_node = nullptr;
     TaggedNodeSeq expensive_nodes;
@@ -1333,6 +1512,97 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
   ready->clear();
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::PushToWorkerQueue(
+    const TaggedNodeSeq& nodes, int64_t scheduled_nsec) {
+  int queue_index = current_worker.queue_index;
+  if (current_worker.executor_state != this) {
+    queue_index = next_worker_queue_.fetch_add(1, std::memory_order_relaxed) %
+                  num_worker_queues_;
+  }
+  WorkerQueue& queue = worker_queues_[queue_index];
+  {
+    mutex_lock l(queue.mu);
+    for (const auto& tagged_node : nodes) {
+      queue.nodes.push_back({tagged_node, scheduled_nsec});
+    }
+  }
+  // Start workers to steal the nodes, which are otherwise run by the calling
+  // thread's worker once it's done with its current node. A running worker
+  // keeps this executor alive as if it were an outstanding op.
+  for (size_t i = 0; i < nodes.size() && TryReserveWorker(); ++i) {
+    num_outstanding_ops_.fetch_add(1, std::memory_order_relaxed);
+    const int worker_queue_index =
+        next_worker_queue_.fetch_add(1, std::memory_order_relaxed) %
+        num_worker_queues_;
+    RunTask([this, worker_queue_index]() { RunWorker(worker_queue_index); });
+  }
+}
+
+template <class PropagatorStateType>
+bool ExecutorState<PropagatorStateType>::TryReserveWorker() {
+  int num_running_workers = num_running_workers_.load();
+  while (num_running_workers < num_worker_queues_) {
+    if (num_running_workers_.compare_exchange_weak(num_running_workers,
+                                                   num_running_workers + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::RunWorker(int queue_index) {
+  const CurrentWorker parent_worker = current_worker;
+  current_worker = {this, queue_index};
+  while (true) {
+    while (absl::optional<QueuedNode> node = PopOrStealNode(queue_index)) {
+      Process(node->tagged_node, node->scheduled_nsec);
+    }
+    // A node may have been pushed after this worker found its deque empty, by
+    // a thread which didn't start a worker because it saw this one running.
+    // Keep running if so.
+    num_running_workers_.fetch_sub(1);
+    bool any_queued_node = false;
+    for (int i = 0; i < num_worker_queues_ && !any_queued_node; ++i) {
+      mutex_lock l(worker_queues_[i].mu);
+      any_queued_node = !worker_queues_[i].nodes.empty();
+    }
+    if (!any_queued_node || !TryReserveWorker()) {
+      break;
+    }
+  }
+  current_worker = parent_worker;
+  if (num_outstanding_ops_.fetch_sub(1) == 1) {
+    ScheduleFinish();
+  }
+}
+
+template <class PropagatorStateType>
+absl::optional<typename ExecutorState<PropagatorStateType>::QueuedNode>
+ExecutorState<PropagatorStateType>::PopOrStealNode(int queue_index) {
+  {
+    WorkerQueue& queue = worker_queues_[queue_index];
+    mutex_lock l(queue.mu);
+    if (!queue.nodes.empty()) {
+      QueuedNode node = queue.nodes.back();
+      queue.nodes.pop_back();
+      return node;
+    }
+  }
+  for (int i = 1; i < num_worker_queues_; ++i) {
+    WorkerQueue& queue =
+        worker_queues_[(queue_index + i) % num_worker_queues_];
+    mutex_lock l(queue.mu);
+    if (!queue.nodes.empty()) {
+      QueuedNode node = queue.nodes.front();
+      queue.nodes.pop_front();
+      return node;
+    }
+  }
+  return absl::nullopt;
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ScheduleFinish() {
   // Checks condition to decide if needs to invoke Finish(). If there are
@@ -1471,15 +1741,16 @@ void ExecutorState<PropagatorStateType>::Finish() {
 
 void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
   if (OpOrderDeterminismRequired()) {
-    (new ExecutorState<OrderedPropagatorState>(args, immutable_state_,
-                                               &kernel_stats_))
+    (new ExecutorState<OrderedPropagatorState>(
+         args, immutable_state_, &kernel_stats_, work_stealing_))
         ->RunAsync(std::move(done));
   } else if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_,
+                                        work_stealing_))
         ->RunAsync(std::move(done));
   } else {
     (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+                                              &kernel_stats_, work_stealing_))
         ->RunAsync(std::move(done));
   }
 }
@@ -1533,6 +1804,29 @@ class DefaultExecutorRegistrar {
 };
 static DefaultExecutorRegistrar registrar;
 
+// Registers the "WORK_STEALING" executor type, a local executor which
+// schedules expensive ready nodes on per-worker deques instead of passing each
+// of them to the runner.
+class WorkStealingExecutorRegistrar {
+ public:
+  WorkStealingExecutorRegistrar() {
+    ExecutorFactory::Register("WORK_STEALING", new Factory);
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      auto impl =
+          std::make_unique<ExecutorImpl>(params, /*work_stealing=*/true);
+      TF_RETURN_IF_ERROR(impl->Initialize(graph));
+      *out_executor = std::move(impl);
+      return OkStatus();
+    }
+  };
+};
+static WorkStealingExecutorRegistrar work_stealing_registrar;
+
 }  // namespace
 
 }  // namespace tensorflow
@@ -123,6 +123,12 @@ class Executor {
     // If true, all kernels will be treated as "inexpensive", and hence executed
     // on the scheduling thread.
     bool run_all_kernels_inline = false;
+
+    // If true and the executor runs on a CPU device, the tensors of the
+    // stateless kernels whose outputs aren't consumed by stateful ones are
+    // allocated from an arena released at the end of the step. See
+    // StepArenaAllocator.
+    bool use_step_arena = false;
   };
   typedef std::function<void(const Status&)> DoneCallback;
   virtual void RunAsync(const Args& args, DoneCallback done) = 0;
@@ -23,6 +23,7 @@ limitations under the License.
 
 #include "tensorflow/tsl/framework/bfc_allocator.h"
 #include "tensorflow/tsl/platform/logging.h"
+#include "tensorflow/tsl/util/env_var.h"
 
 namespace tensorflow {
 
@@ -80,6 +81,19 @@ bool GetGarbageCollectionValue() {
       << " Using the default value \"true\".";
   return true;
 }
+
+size_t GetPoolBytesSoftLimitValue() {
+  int64_t soft_limit_mb;
+  tsl::Status status = tsl::ReadInt64FromEnvVar(
+      "TF_GPU_ALLOCATOR_SOFT_LIMIT_MB", /*default_val=*/0, &soft_limit_mb);
+  if (!status.ok() || soft_limit_mb < 0) {
+    LOG(ERROR) << "The TF_GPU_ALLOCATOR_SOFT_LIMIT_MB environment variable is"
+               << " set but could not be parsed as a number of megabytes."
+               << " Using no soft limit.";
+    return 0;
+  }
+  return static_cast<size_t>(soft_limit_mb) << 20;
+}
 }  // anonymous namespace
 
 GPUBFCAllocator::GPUBFCAllocator(
@@ -95,6 +109,9 @@ GPUBFCAllocator::GPUBFCAllocator(
           o.garbage_collection = GetGarbageCollectionValue();
         }
         o.fragmentation_fraction = opts.fragmentation_fraction;
+        o.pool_bytes_soft_limit = opts.pool_bytes_soft_limit.has_value()
+                                      ? *opts.pool_bytes_soft_limit
+                                      : GetPoolBytesSoftLimitValue();
         return o;
       }()) {}
 
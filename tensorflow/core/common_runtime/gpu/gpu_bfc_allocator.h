@@ -46,6 +46,12 @@ class GPUBFCAllocator : public tsl::BFCAllocator {
 
     double fragmentation_fraction = 0;
     bool allow_retry_on_failure = true;
+
+    // If nullopt, defaults to TF_GPU_ALLOCATOR_SOFT_LIMIT_MB megabytes, or 0,
+    // i.e. no limit, if that envvar is not present. Processes sharing a GPU
+    // can set it to the memory they usually need, so that each gives back the
+    // memory of its peaks to the others.
+    std::optional<size_t> pool_bytes_soft_limit;
   };
 
   GPUBFCAllocator(std::unique_ptr<tsl::SubAllocator> sub_allocator,
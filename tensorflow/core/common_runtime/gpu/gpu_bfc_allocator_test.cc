@@ -40,6 +40,7 @@ limitations under the License.
 #include "tensorflow/tsl/platform/test_benchmark.h"
 #include "tensorflow/tsl/platform/threadpool.h"
 #include "tensorflow/tsl/platform/types.h"
+#include "tensorflow/tsl/profiler/lib/scoped_memory_debug_annotation.h"
 
 namespace tsl {
 namespace {
@@ -338,6 +339,152 @@ TEST_P(GPUBFCAllocatorTest, DISABLED_AllocatorReceivesZeroMemory) {
   b.DeallocateRaw(bmem);
 }
 
+TEST_P(GPUBFCAllocatorTest, ChunkCache) {
+  BFCAllocator::Options opts;
+  opts.chunk_cache_max_chunk_bytes = 4096;
+  opts.chunk_cache_bytes_per_thread = 4096;
+  BFCAllocator a(GetParam()(1ull << 32), 1 << 30, "GPU_0_bfc", opts);
+
+  void* p1 = a.AllocateRaw(1, 1000);
+  void* p2 = a.AllocateRaw(1, 2000);
+  CheckStats(&a, 2, 3072, 3072, 2048);
+
+  // The cached chunk is not in use, and is handed out again to the next
+  // allocation of the same size.
+  a.DeallocateRaw(p1);
+  CheckStats(&a, 2, 2048, 3072, 2048);
+  void* p3 = a.AllocateRaw(1, 1000);
+  EXPECT_EQ(p3, p1);
+  EXPECT_EQ(a.RequestedSize(p3), 1000);
+  CheckStats(&a, 3, 3072, 3072, 2048);
+  a.DeallocateRaw(p2);
+  a.DeallocateRaw(p3);
+  CheckStats(&a, 3, 0, 3072, 2048);
+
+  // Freeing more than the cache can hold returns chunks to the bins.
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 8; ++i) {
+    ptrs.push_back(a.AllocateRaw(1, 1000));
+  }
+  CheckStats(&a, 11, 8192, 8192, 2048);
+  for (void* ptr : ptrs) {
+    a.DeallocateRaw(ptr);
+  }
+  CheckStats(&a, 11, 0, 8192, 2048);
+
+  // Recording the memory map flushes the cache.
+  MemoryDump md = a.RecordMemoryMap();
+  EXPECT_EQ(md.stats().bytes_in_use(), 0);
+  for (const auto& chunk : md.chunk()) {
+    EXPECT_FALSE(chunk.in_use());
+  }
+  CheckStats(&a, 11, 0, 8192, 2048);
+}
+
+TEST_P(GPUBFCAllocatorTest, MemoryTimeline) {
+  BFCAllocator::Options opts;
+  opts.memory_timeline_size = 4;
+  opts.chunk_cache_max_chunk_bytes = 4096;
+  BFCAllocator a(GetParam()(1ull << 32), 1 << 30, "GPU_0_bfc", opts);
+
+  void* p1;
+  void* p2;
+  {
+    profiler::ScopedMemoryDebugAnnotation annotation("matmul", 7);
+    p1 = a.AllocateRaw(1, 1024);
+    p2 = a.AllocateRaw(1, 1024);
+  }
+  void* p3;
+  {
+    profiler::ScopedMemoryDebugAnnotation annotation("conv", 7);
+    p3 = a.AllocateRaw(1, 512);
+  }
+  a.DeallocateRaw(p1);
+
+  MemoryTimeline timeline = a.RecordMemoryTimeline();
+  EXPECT_EQ(timeline.allocator_name(), "GPU_0_bfc");
+  ASSERT_EQ(timeline.event_size(), 4);
+  EXPECT_EQ(timeline.num_dropped_events(), 0);
+  EXPECT_EQ(timeline.event(0).bytes(), 1024);
+  EXPECT_EQ(timeline.event(0).op_name(), "matmul");
+  EXPECT_EQ(timeline.event(0).step_id(), 7);
+  EXPECT_EQ(timeline.event(2).bytes(), 512);
+  EXPECT_EQ(timeline.event(2).bytes_in_use(), 2560);
+  EXPECT_EQ(timeline.event(2).op_name(), "conv");
+  // The deallocation, not served by the chunk cache, is attributed to the
+  // op that made the allocation and leaves a hole.
+  EXPECT_EQ(timeline.event(3).bytes(), -1024);
+  EXPECT_EQ(timeline.event(3).bytes_in_use(), 1536);
+  EXPECT_EQ(timeline.event(3).op_name(), "matmul");
+  EXPECT_GT(timeline.event(3).fragmentation_metric(), 0);
+  EXPECT_GT(timeline.event(3).largest_free_chunk(), 0);
+
+  EXPECT_EQ(timeline.peak_bytes_in_use(), 2560);
+  ASSERT_EQ(timeline.top_ops_at_peak_size(), 2);
+  EXPECT_EQ(timeline.top_ops_at_peak(0).op_name(), "matmul");
+  EXPECT_EQ(timeline.top_ops_at_peak(0).bytes_in_use(), 2048);
+  EXPECT_EQ(timeline.top_ops_at_peak(1).op_name(), "conv");
+  EXPECT_EQ(timeline.top_ops_at_peak(1).bytes_in_use(), 512);
+
+  // Older events are dropped, while the peak is kept.
+  a.DeallocateRaw(p2);
+  a.DeallocateRaw(p3);
+  timeline = a.RecordMemoryTimeline(/*max_top_ops=*/1);
+  ASSERT_EQ(timeline.event_size(), 4);
+  EXPECT_EQ(timeline.num_dropped_events(), 2);
+  EXPECT_EQ(timeline.event(0).bytes(), 512);
+  EXPECT_EQ(timeline.event(3).bytes_in_use(), 0);
+  EXPECT_EQ(timeline.peak_bytes_in_use(), 2560);
+  ASSERT_EQ(timeline.top_ops_at_peak_size(), 1);
+  EXPECT_EQ(timeline.top_ops_at_peak(0).op_name(), "matmul");
+
+  BFCAllocator b(GetParam()(1ull << 32), 1 << 30, "GPU_1_bfc", {});
+  b.DeallocateRaw(b.AllocateRaw(1, 1024));
+  EXPECT_EQ(b.RecordMemoryTimeline().event_size(), 0);
+}
+
+TEST_P(GPUBFCAllocatorTest, ReleaseFreeMemory) {
+  BFCAllocator a(GetParam()(1ull << 32), 1 << 30, "GPU_0_bfc", {});
+
+  // The pool grows by 2MiB, then by 4MiB.
+  void* p1 = a.AllocateRaw(1, 1 << 20);
+  void* p2 = a.AllocateRaw(1, 3 << 20);
+  EXPECT_EQ(*a.GetStats()->pool_bytes, 6 << 20);
+  EXPECT_EQ(a.ReleaseFreeMemory(), 0);
+
+  // Only the allocation the pool grew by last is free.
+  a.DeallocateRaw(p2);
+  EXPECT_EQ(a.ReleaseFreeMemory(), 4 << 20);
+  EXPECT_EQ(*a.GetStats()->pool_bytes, 2 << 20);
+
+  // The pool grows again as needed, by 8MiB.
+  p2 = a.AllocateRaw(1, 3 << 20);
+  ASSERT_NE(p2, nullptr);
+  a.DeallocateRaw(p1);
+  a.DeallocateRaw(p2);
+  EXPECT_EQ(a.ReleaseFreeMemory(/*max_pool_bytes=*/10 << 20), 0);
+  EXPECT_EQ(a.ReleaseFreeMemory(), 10 << 20);
+  EXPECT_EQ(*a.GetStats()->pool_bytes, 0);
+  EXPECT_NE(a.AllocateRaw(1, 1 << 20), nullptr);
+}
+
+TEST_P(GPUBFCAllocatorTest, PoolBytesSoftLimit) {
+  BFCAllocator::Options opts;
+  opts.pool_bytes_soft_limit = 2 << 20;
+  BFCAllocator a(GetParam()(1ull << 32), 1 << 30, "GPU_0_bfc", opts);
+
+  void* p1 = a.AllocateRaw(1, 1 << 20);
+  void* p2 = a.AllocateRaw(1, 3 << 20);
+  EXPECT_EQ(*a.GetStats()->pool_bytes, 6 << 20);
+
+  // The memory beyond the limit is released once it is free, but not the
+  // memory within it.
+  a.DeallocateRaw(p2);
+  EXPECT_EQ(*a.GetStats()->pool_bytes, 2 << 20);
+  a.DeallocateRaw(p1);
+  EXPECT_EQ(*a.GetStats()->pool_bytes, 2 << 20);
+}
+
 INSTANTIATE_TEST_SUITE_P(GPUBFCAllocatorTestSuite, GPUBFCAllocatorTest,
                          TestSuiteValues());
 
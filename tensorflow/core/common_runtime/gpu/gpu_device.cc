@@ -1884,6 +1884,9 @@ Status BaseGPUDeviceFactory::EnablePeerAccess(
       if (from->CanEnablePeerAccessTo(to)) {
         ++possible_peer_count;
         auto status = from->EnablePeerAccessTo(to);
+        if (i != j) {
+          GPUUtil::SetPeerAccess(platform_gpu_i, platform_gpu_j, status.ok());
+        }
         if (!status.ok()) {
           LOG(WARNING)
               << "Unable to enable peer access between device ordinals "
@@ -203,6 +203,48 @@ TEST_F(GPUDeviceTest, DISABLED_ON_GPU_ROCM(CudaMallocAsyncPreallocate)) {
   EXPECT_EQ(status.code(), error::OK);
 }
 
+TEST_F(GPUDeviceTest, DISABLED_ON_GPU_ROCM(CudaMallocAsyncPoolPerDevice)) {
+#if !defined(GOOGLE_CUDA) || CUDA_VERSION < 11030
+  return;
+#else
+  int driverVersion;
+  cuDriverGetVersion(&driverVersion);
+  if (driverVersion < 11030) {
+    LOG(INFO) << "Driver version too old, skipping this test: "
+              << driverVersion;
+    return;
+  }
+#endif
+
+  SessionOptions opts = MakeSessionOptions("0", 0, 1, {{100, 200}}, {}, {},
+                                           /*use_cuda_malloc_async=*/true);
+  auto* experimental =
+      opts.config.mutable_gpu_options()->mutable_experimental();
+  experimental->set_cuda_malloc_async_pool_per_device(true);
+  experimental->set_cuda_malloc_async_release_threshold_mb(16);
+  std::vector<std::unique_ptr<Device>> devices;
+  TF_ASSERT_OK(DeviceFactory::GetFactory("GPU")->CreateDevices(
+      opts, kDeviceNamePrefix, &devices));
+  ASSERT_THAT(devices, SizeIs(2));
+
+  AllocatorAttributes allocator_attributes;
+  allocator_attributes.set_gpu_compatible(true);
+  Allocator* allocator0 = devices[0]->GetAllocator(allocator_attributes);
+  Allocator* allocator1 = devices[1]->GetAllocator(allocator_attributes);
+  ASSERT_NE(allocator0, allocator1);
+  void* ptr = allocator0->AllocateRaw(Allocator::kAllocatorAlignment, 1 << 20);
+  ASSERT_NE(ptr, nullptr);
+
+  // Each device has its own pool, holding only its own memory.
+  std::optional<AllocatorStats> stats0 = allocator0->GetStats();
+  std::optional<AllocatorStats> stats1 = allocator1->GetStats();
+  ASSERT_TRUE(stats0.has_value() && stats1.has_value());
+  EXPECT_EQ(stats0->bytes_in_use, 1 << 20);
+  EXPECT_GE(stats0->pool_bytes.value_or(0), 1 << 20);
+  EXPECT_EQ(stats1->pool_bytes.value_or(0), 0);
+  allocator0->DeallocateRaw(ptr);
+}
+
 TEST_F(GPUDeviceTest, FailedToParseVisibleDeviceList) {
   SessionOptions opts = MakeSessionOptions("0,abc");
   std::vector<std::unique_ptr<Device>> devices;
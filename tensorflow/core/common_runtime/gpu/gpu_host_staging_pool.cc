@@ -0,0 +1,58 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/gpu/gpu_host_staging_pool.h"
+
+namespace tensorflow {
+
+GpuHostStagingPool::GpuHostStagingPool(Allocator* host_allocator,
+                                       size_t chunk_bytes,
+                                       int max_cached_chunks)
+    : host_allocator_(host_allocator),
+      chunk_bytes_(chunk_bytes),
+      max_cached_chunks_(max_cached_chunks) {}
+
+GpuHostStagingPool::~GpuHostStagingPool() {
+  mutex_lock l(mu_);
+  for (void* chunk : free_chunks_) {
+    host_allocator_->DeallocateRaw(chunk);
+  }
+}
+
+void* GpuHostStagingPool::GetChunk() {
+  {
+    mutex_lock l(mu_);
+    if (!free_chunks_.empty()) {
+      void* chunk = free_chunks_.back();
+      free_chunks_.pop_back();
+      return chunk;
+    }
+  }
+  return host_allocator_->AllocateRaw(Allocator::kAllocatorAlignment,
+                                      chunk_bytes_);
+}
+
+void GpuHostStagingPool::ReleaseChunk(void* chunk) {
+  {
+    mutex_lock l(mu_);
+    if (static_cast<int>(free_chunks_.size()) < max_cached_chunks_) {
+      free_chunks_.push_back(chunk);
+      return;
+    }
+  }
+  host_allocator_->DeallocateRaw(chunk);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,67 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_GPU_GPU_HOST_STAGING_POOL_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_GPU_GPU_HOST_STAGING_POOL_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// A pool of fixed-size chunks of pinned host memory staging the copies from
+// pageable host memory to the GPUs. Large copies are staged one chunk at a
+// time, so that filling a chunk overlaps with the DMA of the previous ones,
+// instead of staging the whole tensor before the first byte is transferred.
+//
+// Released chunks are cached for the next copies up to a maximum, and the
+// chunks beyond it are returned to the host allocator.
+//
+// This class is thread-safe.
+class GpuHostStagingPool {
+ public:
+  // `host_allocator` must allocate pinned memory and outlive the pool.
+  GpuHostStagingPool(Allocator* host_allocator, size_t chunk_bytes,
+                     int max_cached_chunks);
+  ~GpuHostStagingPool();
+
+  // Returns a chunk of `chunk_bytes()` bytes, or null if the host allocator
+  // is out of memory.
+  void* GetChunk() TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns a chunk obtained from GetChunk() to the pool.
+  void ReleaseChunk(void* chunk) TF_LOCKS_EXCLUDED(mu_);
+
+  size_t chunk_bytes() const { return chunk_bytes_; }
+
+ private:
+  Allocator* const host_allocator_;  // Not owned.
+  const size_t chunk_bytes_;
+  const int max_cached_chunks_;
+
+  mutex mu_;
+  std::vector<void*> free_chunks_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(GpuHostStagingPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_GPU_GPU_HOST_STAGING_POOL_H_
@@ -0,0 +1,57 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/gpu/gpu_host_staging_pool.h"
+
+#include "tensorflow/core/common_runtime/counting_allocator_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(GpuHostStagingPoolTest, ReusesReleasedChunks) {
+  test::CountingAllocator allocator;
+  {
+    GpuHostStagingPool pool(&allocator, /*chunk_bytes=*/1024,
+                            /*max_cached_chunks=*/2);
+    void* chunk = pool.GetChunk();
+    ASSERT_NE(chunk, nullptr);
+    pool.ReleaseChunk(chunk);
+    EXPECT_EQ(pool.GetChunk(), chunk);
+    EXPECT_EQ(allocator.num_allocations(), 1);
+    pool.ReleaseChunk(chunk);
+    EXPECT_EQ(allocator.num_live(), 1);
+  }
+  EXPECT_EQ(allocator.num_live(), 0);
+}
+
+TEST(GpuHostStagingPoolTest, CachesAtMostMaxChunks) {
+  test::CountingAllocator allocator;
+  GpuHostStagingPool pool(&allocator, /*chunk_bytes=*/1024,
+                          /*max_cached_chunks=*/2);
+  void* chunks[3];
+  for (void*& chunk : chunks) {
+    chunk = pool.GetChunk();
+    ASSERT_NE(chunk, nullptr);
+  }
+  EXPECT_EQ(allocator.num_live(), 3);
+  for (void* chunk : chunks) {
+    pool.ReleaseChunk(chunk);
+  }
+  EXPECT_EQ(allocator.num_live(), 2);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/gpu/gpu_process_state.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <optional>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
@@ -46,6 +49,9 @@ limitations under the License.
 
 namespace tensorflow {
 
+// The size of the chunks of the GpuHostStagingPool.
+static constexpr int64_t kGpuHostStagingChunkBytes = 4LL << 20;
+
 // NOLINTNEXTLINE(clang-diagnostic-unused-function)
 static bool UseCudaMallocAllocator() {
   const char* allocator_env = std::getenv("TF_GPU_ALLOCATOR");
@@ -230,8 +236,18 @@ Allocator* GPUProcessState::GetGPUAllocator(
       // compute-sanitizer.
       // TODO: **WARNING** probably will not work in a multi-gpu scenario
       gpu_bfc_allocator.reset();
-      gpu_allocator =
-          new se::GpuCudaMallocAsyncAllocator(platform_device_id, total_bytes);
+      std::optional<size_t> release_threshold;
+      if (options.experimental().cuda_malloc_async_release_threshold_mb() >
+          0) {
+        release_threshold =
+            options.experimental().cuda_malloc_async_release_threshold_mb()
+            << 20;
+      }
+      gpu_allocator = new se::GpuCudaMallocAsyncAllocator(
+          platform_device_id, total_bytes, /*reserve_memory=*/false,
+          /*compute_stats=*/true,
+          options.experimental().cuda_malloc_async_pool_per_device(),
+          release_threshold);
     }
 
     Allocator* recording_allocator = nullptr;
@@ -400,6 +416,39 @@ Allocator* GPUProcessState::GetGpuHostAllocator(const GPUOptions& options,
   }
 }
 
+GpuHostStagingPool* GPUProcessState::GetGpuHostStagingPool(
+    Allocator* host_allocator) {
+  if (!HasGPUDevice()) {
+    return nullptr;
+  }
+  {
+    tf_shared_lock lock(mu_);
+    auto it = gpu_host_staging_pools_.find(host_allocator);
+    if (it != gpu_host_staging_pools_.end()) {
+      return it->second.get();
+    }
+  }
+
+  mutex_lock lock(mu_);
+  std::unique_ptr<GpuHostStagingPool>& pool =
+      gpu_host_staging_pools_[host_allocator];
+  if (pool == nullptr) {
+    int64_t pool_mb = 0;
+    Status status = tsl::ReadInt64FromEnvVar(
+        "TF_GPU_HOST_STAGING_POOL_SIZE_IN_MB", 64, &pool_mb);
+    if (!status.ok()) {
+      LOG(ERROR) << "GetGpuHostStagingPool: " << status.error_message();
+    }
+    if (pool_mb > 0) {
+      const int64_t max_cached_chunks = std::max<int64_t>(
+          1, pool_mb * (1LL << 20) / kGpuHostStagingChunkBytes);
+      pool = std::make_unique<GpuHostStagingPool>(
+          host_allocator, kGpuHostStagingChunkBytes, max_cached_chunks);
+    }
+  }
+  return pool.get();
+}
+
 void GPUProcessState::AddGPUAllocVisitor(int bus_id,
                                          const SubAllocator::Visitor& visitor) {
 #if (defined(GOOGLE_CUDA) && GOOGLE_CUDA) || \
@@ -453,6 +502,8 @@ void GPUProcessState::TestOnlyReset() {
   {
     mutex_lock lock(mu_);
     gpu_device_enabled_ = false;
+    // The pool returns its chunks to the host allocators.
+    gpu_host_staging_pools_.clear();
     gpu_allocators_.clear();
     gpu_visitors_.clear();
     gpu_host_allocators_.clear();
@@ -22,6 +22,8 @@ limitations under the License.
 #include <unordered_map>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/common_runtime/gpu/gpu_host_staging_pool.h"
 #include "tensorflow/core/common_runtime/process_state.h"
 #include "tensorflow/core/common_runtime/shared_counter.h"
 #include "tensorflow/core/framework/allocator.h"
@@ -103,6 +105,15 @@ class GPUProcessState {
   virtual Allocator* GetGpuHostAllocator(const GPUOptions& options,
                                          int numa_node);
 
+  // Returns the pool of pinned buffers staging the copies from pageable host
+  // memory to the GPUs, whose chunks come from `host_allocator`, the host
+  // memory allocator of the device copied to. There is one pool per host
+  // allocator, so the chunks get the GPU options and NUMA node of the device.
+  // The memory cached by each pool is limited by the environment variable
+  // TF_GPU_HOST_STAGING_POOL_SIZE_IN_MB, 64 by default. Returns nullptr if no
+  // GPU device has been created or the limit is 0.
+  virtual GpuHostStagingPool* GetGpuHostStagingPool(Allocator* host_allocator);
+
   // Registers a Visitor to be invoked on new chunks of memory allocated by the
   // SubAllocator of every GPU proximate to the specified bus.  The AllocVisitor
   // is provided with a memory pointer, a GPU id, and the size of the area it
@@ -168,6 +179,10 @@ class GPUProcessState {
       TF_GUARDED_BY(mu_);
   std::vector<std::vector<SubAllocator::Visitor>> gpu_host_free_visitors_
       TF_GUARDED_BY(mu_);
+
+  // The staging pools by host allocator, null if the pools are disabled.
+  absl::flat_hash_map<Allocator*, std::unique_ptr<GpuHostStagingPool>>
+      gpu_host_staging_pools_ TF_GUARDED_BY(mu_);
 };
 
 }  // namespace tensorflow
@@ -17,11 +17,18 @@ limitations under the License.
 
 #include <algorithm>
 #include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
 
 #include "tensorflow/core/common_runtime/copy_tensor.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device/device_event_mgr.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/common_runtime/gpu/gpu_host_staging_pool.h"
+#include "tensorflow/core/common_runtime/gpu/gpu_id_manager.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_process_state.h"
 #include "tensorflow/core/common_runtime/gpu_device_context.h"
 #include "tensorflow/core/framework/log_memory.h"
@@ -35,9 +42,11 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/stream_executor.h"
 #include "tensorflow/core/platform/tensor_coding.h"
 #include "tensorflow/core/profiler/lib/scoped_annotation.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/util.h"
 
 // IMPLEMENTATION NOTE:
@@ -188,6 +197,171 @@ void GPUUtil::SetProtoFromGPU(const Tensor& tensor, Device* dev,
       });
 }
 
+namespace {
+
+// The pairs of platform GPU ids (from, to) such that `from` has peer access to
+// the memory of `to`.
+struct PeerAccessPairs {
+  mutex mu;
+  absl::flat_hash_set<std::pair<int, int>> pairs TF_GUARDED_BY(mu);
+};
+
+PeerAccessPairs* GetPeerAccessPairs() {
+  static PeerAccessPairs* peer_access_pairs = new PeerAccessPairs;
+  return peer_access_pairs;
+}
+
+bool RelayDeviceToDeviceCopies() {
+  static const bool relay = [] {
+    bool relay;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_GPU_RELAY_DEVICE_TO_DEVICE_COPIES",
+                                   /*default_val=*/false, &relay));
+    return relay;
+  }();
+  return relay;
+}
+
+// Enqueues the copy of `input` to `output` through the GPU `relay`, to which
+// both the sender, whose `send_stream` copies into the relay GPU, and the
+// receiver have peer access. Returns false without enqueuing anything if the
+// copy can't be relayed, e.g. because the relay GPU is out of memory.
+bool RelayDeviceToDeviceCopy(tsl::TfDeviceId relay, se::Stream* send_stream,
+                             DeviceContext* send_dev_context,
+                             DeviceContext* recv_dev_context, Device* dst,
+                             int dev_to_dev_stream_index, const Tensor* input,
+                             Tensor* output, const StatusCallback& done) {
+  const auto* recv_gpu_context =
+      static_cast<const GPUDeviceContext*>(recv_dev_context);
+  se::Stream* recv_stream = recv_gpu_context->stream();
+  se::Stream* recv_device_to_device_stream =
+      recv_gpu_context->device_to_device_stream(dev_to_dev_stream_index);
+  const DeviceBase::AcceleratorDeviceInfo* dst_info =
+      dst->tensorflow_accelerator_device_info();
+  Allocator* relay_allocator =
+      GPUProcessState::singleton()->GetGPUAllocator(relay);
+  if (recv_stream == nullptr || recv_device_to_device_stream == nullptr ||
+      dst_info == nullptr || relay_allocator == nullptr) {
+    return false;
+  }
+
+  auto chunk_copied_out =
+      std::make_shared<std::vector<std::unique_ptr<se::Event>>>();
+  for (int i = 0; i < 2; ++i) {
+    chunk_copied_out->push_back(
+        std::make_unique<se::Event>(recv_device_to_device_stream->parent()));
+    if (!chunk_copied_out->back()->Init()) return false;
+  }
+  const int64_t total_bytes = input->TotalBytes();
+  const int64_t chunk_bytes =
+      std::min(total_bytes, GPUUtil::kRelayChunkBytes);
+  char* staging = static_cast<char*>(relay_allocator->AllocateRaw(
+      Allocator::kAllocatorAlignment, 2 * chunk_bytes));
+  if (staging == nullptr) return false;
+  VLOG(2) << "Relaying a copy of " << total_bytes << " bytes to "
+          << dst->name() << " through GPU " << relay.value();
+
+  // Make sure that the memory of the output is truly free, as for a direct
+  // copy.
+  recv_device_to_device_stream->ThenWaitFor(recv_stream);
+  const char* src_ptr = static_cast<const char*>(GetBase(input));
+  char* dst_ptr = static_cast<char*>(GetBase(output));
+  const std::vector<GPUUtil::RelayChunk> chunks =
+      GPUUtil::RelayChunks(total_bytes);
+  for (int i = 0; i < chunks.size(); ++i) {
+    const GPUUtil::RelayChunk& chunk = chunks[i];
+    se::Event* copied_out = (*chunk_copied_out)[chunk.staging_index].get();
+    DeviceMemoryBase staged(staging + chunk.staging_index * chunk_bytes,
+                            chunk.bytes);
+    // The buffer still holds chunk i - 2 until it is copied out.
+    if (i >= 2) send_stream->ThenWaitFor(copied_out);
+    send_stream->ThenMemcpy(
+        &staged,
+        DeviceMemoryBase(const_cast<char*>(src_ptr) + chunk.offset,
+                         chunk.bytes),
+        chunk.bytes);
+    recv_device_to_device_stream->ThenWaitFor(send_stream);
+    DeviceMemoryBase gpu_dst_ptr(dst_ptr + chunk.offset, chunk.bytes);
+    recv_device_to_device_stream->ThenMemcpy(&gpu_dst_ptr, staged,
+                                             chunk.bytes);
+    recv_device_to_device_stream->ThenRecordEvent(copied_out);
+  }
+
+  // Use of input may outlive stack scope, so keep a ref.
+  TensorReference input_ref(*input);
+  dst_info->event_mgr->ThenExecute(
+      recv_device_to_device_stream,
+      [done, send_stream, recv_device_to_device_stream, relay_allocator,
+       staging, chunk_copied_out, input_ref]() {
+        input_ref.Unref();
+        if (!send_stream->ok() || !recv_device_to_device_stream->ok()) {
+          LOG(FATAL) << "GPU->GPU relayed Memcpy failed";
+        }
+        relay_allocator->DeallocateRaw(staging);
+        done(OkStatus());
+      });
+  send_dev_context->MaintainLifetimeOnStream(input, send_stream);
+  return true;
+}
+
+}  // namespace
+
+// static
+void GPUUtil::SetPeerAccess(tsl::PlatformDeviceId from,
+                            tsl::PlatformDeviceId to, bool enabled) {
+  PeerAccessPairs* peer_access_pairs = GetPeerAccessPairs();
+  mutex_lock lock(peer_access_pairs->mu);
+  if (enabled) {
+    peer_access_pairs->pairs.emplace(from.value(), to.value());
+  } else {
+    peer_access_pairs->pairs.erase({from.value(), to.value()});
+  }
+}
+
+// static
+bool GPUUtil::HasPeerAccess(tsl::PlatformDeviceId from,
+                            tsl::PlatformDeviceId to) {
+  PeerAccessPairs* peer_access_pairs = GetPeerAccessPairs();
+  mutex_lock lock(peer_access_pairs->mu);
+  return peer_access_pairs->pairs.contains({from.value(), to.value()});
+}
+
+// static
+std::optional<tsl::TfDeviceId> GPUUtil::FindRelayGPU(tsl::TfDeviceId src,
+                                                     tsl::TfDeviceId dst,
+                                                     int num_tf_gpus) {
+  tsl::PlatformDeviceId src_platform_id;
+  tsl::PlatformDeviceId dst_platform_id;
+  if (!GpuIdManager::TfToPlatformDeviceId(src, &src_platform_id).ok() ||
+      !GpuIdManager::TfToPlatformDeviceId(dst, &dst_platform_id).ok() ||
+      src_platform_id == dst_platform_id ||
+      HasPeerAccess(src_platform_id, dst_platform_id)) {
+    return std::nullopt;
+  }
+  for (int i = 0; i < num_tf_gpus; ++i) {
+    tsl::PlatformDeviceId platform_id;
+    if (!GpuIdManager::TfToPlatformDeviceId(tsl::TfDeviceId(i), &platform_id)
+             .ok() ||
+        platform_id == src_platform_id || platform_id == dst_platform_id) {
+      continue;
+    }
+    if (HasPeerAccess(src_platform_id, platform_id) &&
+        HasPeerAccess(dst_platform_id, platform_id)) {
+      return tsl::TfDeviceId(i);
+    }
+  }
+  return std::nullopt;
+}
+
+// static
+std::vector<GPUUtil::RelayChunk> GPUUtil::RelayChunks(int64_t total_bytes) {
+  std::vector<RelayChunk> chunks;
+  for (int64_t offset = 0; offset < total_bytes; offset += kRelayChunkBytes) {
+    chunks.push_back({offset, std::min(kRelayChunkBytes, total_bytes - offset),
+                      static_cast<int>(chunks.size() % 2)});
+  }
+  return chunks;
+}
+
 // static
 void GPUUtil::DeviceToDeviceCopy(
     DeviceContext* send_dev_context, DeviceContext* recv_dev_context,
@@ -214,6 +388,18 @@ void GPUUtil::DeviceToDeviceCopy(
   send_device_to_device_stream->ThenWaitFor(send_stream);
 
   const int64_t total_bytes = input->TotalBytes();
+  if (total_bytes > 0 && RelayDeviceToDeviceCopies()) {
+    std::optional<tsl::TfDeviceId> relay = FindRelayGPU(
+        tsl::TfDeviceId(src->parsed_name().id),
+        tsl::TfDeviceId(dst->parsed_name().id),
+        GPUProcessState::singleton()->NumGPUAllocators());
+    if (relay.has_value() &&
+        RelayDeviceToDeviceCopy(*relay, send_device_to_device_stream,
+                                send_dev_context, recv_dev_context, dst,
+                                dev_to_dev_stream_index, input, output, done)) {
+      return;
+    }
+  }
   if (total_bytes > 0) {
     void* src_ptr = GetBase(input);
     DeviceMemoryBase gpu_src_ptr(src_ptr, total_bytes);
@@ -343,6 +529,8 @@ void GPUUtil::CopyCPUTensorToGPU(const Tensor* cpu_tensor,
 
   bool do_staging = false;
   void* staging_buffer = nullptr;
+  GpuHostStagingPool* staging_pool = nullptr;
+  std::vector<void*> staging_chunks;
   Allocator* host_memory_allocator = device_context->host_memory_allocator();
 
   // Use of cpu_tensor may outlive stack scope, so keep a ref.
@@ -365,13 +553,44 @@ void GPUUtil::CopyCPUTensorToGPU(const Tensor* cpu_tensor,
     }
 
     if (do_staging) {
-      staging_buffer = host_memory_allocator->AllocateRaw(
-          tensorflow::Allocator::kAllocatorAlignment, total_bytes);
-      std::memcpy(staging_buffer, src_ptr, total_bytes);
+      staging_pool = GPUProcessState::singleton()->GetGpuHostStagingPool(
+          host_memory_allocator);
+      int64_t staged_bytes = 0;
+      if (staging_pool != nullptr &&
+          total_bytes > static_cast<int64_t>(staging_pool->chunk_bytes())) {
+        // Stage the tensor one chunk at a time, so that the copy of each
+        // chunk to the GPU overlaps with the staging of the next one.
+        const int64_t chunk_bytes = staging_pool->chunk_bytes();
+        while (staged_bytes < total_bytes) {
+          void* chunk = staging_pool->GetChunk();
+          if (chunk == nullptr) {
+            break;
+          }
+          const int64_t num_bytes =
+              std::min(chunk_bytes, total_bytes - staged_bytes);
+          std::memcpy(chunk, static_cast<char*>(src_ptr) + staged_bytes,
+                      num_bytes);
+          DeviceMemoryBase gpu_chunk_ptr(
+              static_cast<char*>(dst_ptr) + staged_bytes, num_bytes);
+          recv_host_to_device_stream->ThenMemcpy(&gpu_chunk_ptr, chunk,
+                                                 num_bytes);
+          staging_chunks.push_back(chunk);
+          staged_bytes += num_bytes;
+        }
+      }
+      if (staged_bytes < total_bytes) {
+        // Stage the rest of the tensor at once.
+        const int64_t num_bytes = total_bytes - staged_bytes;
+        staging_buffer = host_memory_allocator->AllocateRaw(
+            tensorflow::Allocator::kAllocatorAlignment, num_bytes);
+        std::memcpy(staging_buffer, static_cast<char*>(src_ptr) + staged_bytes,
+                    num_bytes);
+        DeviceMemoryBase gpu_rest_ptr(
+            static_cast<char*>(dst_ptr) + staged_bytes, num_bytes);
+        recv_host_to_device_stream->ThenMemcpy(&gpu_rest_ptr, staging_buffer,
+                                               num_bytes);
+      }
       input_ref.Unref();
-
-      recv_host_to_device_stream->ThenMemcpy(&gpu_dst_ptr, staging_buffer,
-                                             total_bytes);
     } else {
       recv_host_to_device_stream->ThenMemcpy(&gpu_dst_ptr, src_ptr,
                                              total_bytes);
@@ -381,9 +600,15 @@ void GPUUtil::CopyCPUTensorToGPU(const Tensor* cpu_tensor,
   dev_info->event_mgr->ThenExecute(
       recv_host_to_device_stream,
       [recv_host_to_device_stream, done, input_ref, do_staging, staging_buffer,
+       staging_pool, staging_chunks = std::move(staging_chunks),
        host_memory_allocator]() {
         if (do_staging) {
-          host_memory_allocator->DeallocateRaw(staging_buffer);
+          for (void* chunk : staging_chunks) {
+            staging_pool->ReleaseChunk(chunk);
+          }
+          if (staging_buffer != nullptr) {
+            host_memory_allocator->DeallocateRaw(staging_buffer);
+          }
         } else {
           input_ref.Unref();
         }
@@ -16,11 +16,16 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_GPU_GPU_UTIL_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_GPU_GPU_UTIL_H_
 
+#include <cstdint>
+#include <optional>
+#include <vector>
+
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/stream_executor.h"
+#include "tensorflow/tsl/framework/device_id.h"
 
 namespace tensorflow {
 
@@ -90,12 +95,47 @@ class GPUUtil {
                                  Device* gpu_device, Tensor* gpu_tensor,
                                  StatusCallback done, bool sync_dst_compute);
 
+  // If TF_GPU_RELAY_DEVICE_TO_DEVICE_COPIES is true and `src` has no peer
+  // access to `dst`, copies through a GPU that both have peer access to, if
+  // there is one, rather than letting the driver stage the copy in host
+  // memory.
   static void DeviceToDeviceCopy(
       DeviceContext* send_dev_context, DeviceContext* recv_dev_context,
       Device* src, Device* dst, AllocatorAttributes src_alloc_attr,
       AllocatorAttributes dst_alloc_attr, const Tensor* input, Tensor* output,
       int dev_to_dev_stream_index, StatusCallback done);
 
+  // Records whether the GPU `from` has peer access to the memory of the GPU
+  // `to`, as enabled when the GPU devices are created.
+  static void SetPeerAccess(tsl::PlatformDeviceId from,
+                            tsl::PlatformDeviceId to, bool enabled);
+  static bool HasPeerAccess(tsl::PlatformDeviceId from,
+                            tsl::PlatformDeviceId to);
+
+  // Returns the GPU among the TF GPUs 0 to `num_tf_gpus` - 1 through which
+  // DeviceToDeviceCopy() copies from the TF GPU `src` to the TF GPU `dst`,
+  // i.e. the first one that both have peer access to, if `src` has none to
+  // `dst`. Returns nullopt if the copy is direct.
+  static std::optional<tsl::TfDeviceId> FindRelayGPU(tsl::TfDeviceId src,
+                                                     tsl::TfDeviceId dst,
+                                                     int num_tf_gpus);
+
+  // A relayed copy is split into chunks of this size, staged alternately in
+  // two buffers of the relay GPU, so that copying a chunk into the relay GPU
+  // overlaps with copying the previous chunk out of it.
+  static constexpr int64_t kRelayChunkBytes = 4 << 20;
+
+  // The bytes [offset, offset + bytes) of a relayed copy, staged in the
+  // buffer `staging_index`, 0 or 1, of the relay GPU.
+  struct RelayChunk {
+    int64_t offset;
+    int64_t bytes;
+    int staging_index;
+  };
+
+  // Returns the chunks of a relayed copy of `total_bytes`, in copy order.
+  static std::vector<RelayChunk> RelayChunks(int64_t total_bytes);
+
   // Deep-copying of GPU tensor on the same device.
   // 'src_gpu_tensor''s and 'dst_gpu_tensor''s backing memory must be on
   // 'gpu_device' and 'dst_cpu_tensor' must be allocated to be of the same
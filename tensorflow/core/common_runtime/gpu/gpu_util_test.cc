@@ -0,0 +1,168 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/gpu/gpu_util.h"
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/gpu/gpu_id_manager.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/tsl/framework/device_id.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr int kNumGPUs = 4;
+
+class FindRelayGPUTest : public ::testing::Test {
+ protected:
+  // Maps the TF GPU i to the platform GPU kNumGPUs - 1 - i, so that the
+  // results show that the peer accesses are looked up by platform id.
+  FindRelayGPUTest() {
+    GpuIdManager::TestOnlyReset();
+    for (int i = 0; i < kNumGPUs; ++i) {
+      TF_CHECK_OK(GpuIdManager::InsertTfPlatformDeviceIdPair(
+          tsl::TfDeviceId(i), PlatformId(i)));
+    }
+  }
+
+  ~FindRelayGPUTest() override {
+    for (const auto& [from, to] : enabled_) {
+      GPUUtil::SetPeerAccess(PlatformId(from), PlatformId(to), false);
+    }
+    GpuIdManager::TestOnlyReset();
+  }
+
+  static tsl::PlatformDeviceId PlatformId(int tf_gpu) {
+    return tsl::PlatformDeviceId(kNumGPUs - 1 - tf_gpu);
+  }
+
+  // Enables the peer access of the TF GPU `from` to the TF GPU `to`.
+  void EnablePeerAccess(int from, int to) {
+    GPUUtil::SetPeerAccess(PlatformId(from), PlatformId(to), true);
+    enabled_.emplace_back(from, to);
+  }
+
+  static std::optional<tsl::TfDeviceId> FindRelayGPU(int src, int dst) {
+    return GPUUtil::FindRelayGPU(tsl::TfDeviceId(src), tsl::TfDeviceId(dst),
+                                 kNumGPUs);
+  }
+
+  std::vector<std::pair<int, int>> enabled_;
+};
+
+TEST_F(FindRelayGPUTest, NoRelayWithPeerAccess) {
+  EnablePeerAccess(0, 1);
+  EnablePeerAccess(0, 2);
+  EnablePeerAccess(1, 2);
+  EXPECT_EQ(FindRelayGPU(0, 1), std::nullopt);
+}
+
+TEST_F(FindRelayGPUTest, NoRelayToSameGPU) {
+  EXPECT_EQ(FindRelayGPU(1, 1), std::nullopt);
+}
+
+TEST_F(FindRelayGPUTest, NoRelayWithoutCommonPeer) {
+  EnablePeerAccess(0, 2);
+  EnablePeerAccess(1, 3);
+  EXPECT_EQ(FindRelayGPU(0, 1), std::nullopt);
+}
+
+TEST_F(FindRelayGPUTest, RelaysThroughCommonPeer) {
+  // Only the GPU 3 is accessible by both.
+  EnablePeerAccess(0, 2);
+  EnablePeerAccess(0, 3);
+  EnablePeerAccess(1, 3);
+  EXPECT_EQ(FindRelayGPU(0, 1), tsl::TfDeviceId(3));
+}
+
+TEST_F(FindRelayGPUTest, RelaysThroughFirstCommonPeer) {
+  for (int relay : {2, 3}) {
+    EnablePeerAccess(0, relay);
+    EnablePeerAccess(1, relay);
+  }
+  EXPECT_EQ(FindRelayGPU(0, 1), tsl::TfDeviceId(2));
+}
+
+TEST_F(FindRelayGPUTest, PeerAccessIsDirected) {
+  // The receiver needs access to the relay, not the other way around.
+  EnablePeerAccess(0, 2);
+  EnablePeerAccess(2, 1);
+  EXPECT_EQ(FindRelayGPU(0, 1), std::nullopt);
+  EnablePeerAccess(1, 2);
+  EXPECT_EQ(FindRelayGPU(0, 1), tsl::TfDeviceId(2));
+}
+
+TEST_F(FindRelayGPUTest, OnlyConsidersTheGivenGPUs) {
+  EnablePeerAccess(0, 3);
+  EnablePeerAccess(1, 3);
+  EXPECT_EQ(GPUUtil::FindRelayGPU(tsl::TfDeviceId(0), tsl::TfDeviceId(1),
+                                  /*num_tf_gpus=*/3),
+            std::nullopt);
+}
+
+TEST_F(FindRelayGPUTest, NoRelayForUnknownGPU) {
+  EXPECT_EQ(GPUUtil::FindRelayGPU(tsl::TfDeviceId(0),
+                                  tsl::TfDeviceId(kNumGPUs), kNumGPUs),
+            std::nullopt);
+}
+
+// Checks that `chunks` cover [0, total_bytes) in order with chunks of at most
+// kRelayChunkBytes staged alternately, and returns their sizes.
+std::vector<int64_t> CheckRelayChunks(
+    int64_t total_bytes, const std::vector<GPUUtil::RelayChunk>& chunks) {
+  std::vector<int64_t> sizes;
+  int64_t offset = 0;
+  for (int i = 0; i < chunks.size(); ++i) {
+    EXPECT_EQ(chunks[i].offset, offset);
+    EXPECT_GT(chunks[i].bytes, 0);
+    EXPECT_LE(chunks[i].bytes, GPUUtil::kRelayChunkBytes);
+    EXPECT_EQ(chunks[i].staging_index, i % 2);
+    offset += chunks[i].bytes;
+    sizes.push_back(chunks[i].bytes);
+  }
+  EXPECT_EQ(offset, total_bytes);
+  return sizes;
+}
+
+TEST(RelayChunksTest, ChunkBoundaries) {
+  constexpr int64_t kChunk = GPUUtil::kRelayChunkBytes;
+  const std::vector<std::pair<int64_t, std::vector<int64_t>>> cases = {
+      {1, {1}},
+      {kChunk - 1, {kChunk - 1}},
+      {kChunk, {kChunk}},
+      {kChunk + 1, {kChunk, 1}},
+      {2 * kChunk, {kChunk, kChunk}},
+      {3 * kChunk - 1, {kChunk, kChunk, kChunk - 1}},
+      {3 * kChunk + 1, {kChunk, kChunk, kChunk, 1}},
+  };
+  for (const auto& [total_bytes, expected_sizes] : cases) {
+    SCOPED_TRACE(total_bytes);
+    EXPECT_EQ(
+        CheckRelayChunks(total_bytes, GPUUtil::RelayChunks(total_bytes)),
+        expected_sizes);
+  }
+}
+
+TEST(RelayChunksTest, EmptyCopyHasNoChunks) {
+  EXPECT_TRUE(GPUUtil::RelayChunks(0).empty());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -193,7 +193,7 @@ void GpuVirtualMemAllocator::Free(void* ptr, size_t num_bytes) {
   }
 
   int num_mappings_to_free = 0;
-  int total_bytes = 0;
+  size_t total_bytes = 0;
   for (auto it = mapping_it; it != mappings_.end() && total_bytes < num_bytes;
        ++it) {
     ++num_mappings_to_free;
@@ -210,6 +210,11 @@ void GpuVirtualMemAllocator::Free(void* ptr, size_t num_bytes) {
 
   VLOG(1) << "Freeing " << num_mappings_to_free << " mappings for a total of "
           << total_bytes << " bytes";
+  if (!GpuDriver::SynchronizeContext(&gpu_context_)) {
+    LOG(ERROR) << "Could not synchronize GPU " << gpu_id_.value()
+               << " before freeing its vmem mappings";
+    return;
+  }
   for (auto it = mapping_it; it < mapping_it + num_mappings_to_free; ++it) {
     GpuDriver::UnmapMemory(&gpu_context_, it->va, it->physical.bytes);
     GpuDriver::ReleaseMemoryHandle(&gpu_context_, std::move(it->physical));
@@ -66,7 +66,9 @@ class GpuVirtualMemAllocator : public tsl::SubAllocator {
   // should be much larger than the max physical size of the allocator.
   //
   // In practice, since the BFC allocator coalesces adjacent AllocationRegions,
-  // this free function should never be invoked.
+  // this is only invoked when it releases free memory, which it does from the
+  // end of its regions. The device is synchronized first, as the memory may
+  // have been freed before the work using it completed.
   void Free(void* ptr, size_t num_bytes) override;
 
   bool SupportsCoalescing() const override { return true; }
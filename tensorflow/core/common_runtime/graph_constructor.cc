@@ -48,6 +48,7 @@ limitations under the License.
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/public/version.h"
 
 namespace tensorflow {
@@ -102,7 +103,9 @@ class GraphConstructor {
           importing(false),
           validate_nodes(in.validate_nodes),
           validate_colocation_constraints(false),
-          add_default_attributes(in.add_default_attributes) {}
+          add_default_attributes(in.add_default_attributes),
+          thread_pool(in.thread_pool),
+          prevalidated(in.prevalidated) {}
     Options(const ImportGraphDefOptions& in)  // NOLINT(runtime/explicit)
         : allow_internal_ops(false),
           expect_device_spec(false),
@@ -156,6 +159,14 @@ class GraphConstructor {
     // value to the Node when they are missing from the NodeDef.
     bool add_default_attributes = true;
 
+    // If not null, the nodes are built in parallel on this pool. Only used
+    // when not `importing`, since importing may rewrite a node depending on
+    // the nodes before it.
+    thread::ThreadPool* thread_pool = nullptr;
+    // If true, skips the validation of the node names and of the order of
+    // their inputs, and ValidateNodeDef().
+    bool prevalidated = false;
+
     string default_device;
   };
 
@@ -235,6 +246,12 @@ class GraphConstructor {
   Status IsNodeFullyMapped(const NodeDef& node_def, bool* is_node_mapped);
   Status ValidateColocationConstraints(const NodeDef& node_def);
   Status MakeNode(NodeDef&& node_def, Node** node);
+  // Builds the nodes of the GraphDef in parallel on opts_.thread_pool, in
+  // the order of the GraphDef. Consumes all the NodeDefs.
+  Status PrepareNodes(std::vector<Graph::PreparedNode>* prepared_nodes);
+  // Adds `node_def`'s attr defaults and validates it, as configured.
+  Status CompleteNodeDef(NodeDef* node_def);
+  void MaybeAssignDevice(Node* node);
   Status MakeEdge(Node* src, int output_index, Node* dst, int input_index);
   Status ValidateShape(Node* node);
   Status ModifyNodeDefForImport(NodeDef* node_def);
@@ -459,7 +476,9 @@ class NodeDefMovingGraphConstructor : public GraphConstructor {
   }
 
   GraphDef graph_def_;
-  std::vector<bool> is_consumed_;
+  // Not a std::vector<bool>, so that different nodes can be consumed
+  // concurrently.
+  std::vector<char> is_consumed_;
 };
 
 bool ForwardCompatibilityWindowPassed(const VersionDef& versions) {
@@ -649,7 +668,8 @@ Status GraphConstructor::BuildNodeIndex() {
   // Validate the node names and add them to gdef_nodes_ and gdef_prefixes_.
   for (int n = 0; n < node_def_count(); ++n) {
     const NodeDef& node_def = get_node_def(n);
-    if (!IsValidNodeName(node_def.name(), opts_.allow_internal_ops)) {
+    if (!opts_.prevalidated &&
+        !IsValidNodeName(node_def.name(), opts_.allow_internal_ops)) {
       return errors::InvalidArgument(
           "Node '", node_def.name(),
           "': Node name contains invalid characters");
@@ -673,7 +693,7 @@ Status GraphConstructor::BuildNodeIndex() {
     }
     // Validate control edges at end
     bool in_control_dependence = false;
-    for (int i = 0; i < node_def.input_size(); ++i) {
+    for (int i = 0; !opts_.prevalidated && i < node_def.input_size(); ++i) {
       StringPiece input_name = node_def.input(i);
       if (!input_name.empty() && absl::StartsWith(input_name, "^")) {
         in_control_dependence = true;
@@ -779,9 +799,55 @@ Status GraphConstructor::MakeNode(NodeDef&& node_def, Node** node) {
   Status status;
   *node = g_->AddNode(std::move(node_def), &status);
   if (!status.ok()) return status;
+  MaybeAssignDevice(*node);
+  return OkStatus();
+}
+
+void GraphConstructor::MaybeAssignDevice(Node* node) {
   if (opts_.expect_device_spec ||
-      (opts_.propagate_device_spec && !(*node)->def().device().empty())) {
-    (*node)->set_assigned_device_name((*node)->def().device());
+      (opts_.propagate_device_spec && !node->def().device().empty())) {
+    node->set_assigned_device_name(node->def().device());
+  }
+}
+
+Status GraphConstructor::CompleteNodeDef(NodeDef* node_def) {
+  const OpDef* op_def;
+  TF_RETURN_IF_ERROR(g_->op_registry()->LookUpOpDef(node_def->op(), &op_def));
+  if (opts_.add_default_attributes) {
+    AddDefaultsToNodeDef(*op_def, node_def);
+  }
+  if (opts_.validate_nodes && !opts_.prevalidated) {
+    TF_RETURN_IF_ERROR(ValidateNodeDef(*node_def, *op_def));
+  }
+  return OkStatus();
+}
+
+Status GraphConstructor::PrepareNodes(
+    std::vector<Graph::PreparedNode>* prepared_nodes) {
+  const int num_nodes = node_def_count();
+  prepared_nodes->resize(num_nodes);
+  std::vector<Status> statuses(num_nodes);
+  // A rough cost, in cycles, of looking up the op of a node, validating it and
+  // inferring its types.
+  constexpr int64_t kCostPerNode = 5000;
+  opts_.thread_pool->ParallelFor(
+      num_nodes, kCostPerNode, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          NodeDef node_def = consume_node_def(i);
+          statuses[i] = CompleteNodeDef(&node_def);
+          if (!statuses[i].ok()) continue;
+          StatusOr<Graph::PreparedNode> prepared =
+              g_->PrepareNode(std::move(node_def));
+          if (prepared.ok()) {
+            (*prepared_nodes)[i] = *std::move(prepared);
+          } else {
+            statuses[i] = prepared.status();
+          }
+        }
+      });
+  // Report the error of the first invalid node, like the sequential import.
+  for (const Status& status : statuses) {
+    TF_RETURN_IF_ERROR(status);
   }
   return OkStatus();
 }
@@ -1130,10 +1196,20 @@ Status GraphConstructor::Convert() {
     TF_RETURN_IF_ERROR(g_->AddFunctionLibrary(*library()));
   }
 
+  // Without the import options, a node doesn't depend on the nodes before it
+  // until it's wired, so the nodes can be built in parallel up front.
+  std::vector<Graph::PreparedNode> prepared_nodes;
+  const bool parallel = opts_.thread_pool != nullptr && !opts_.importing;
+  if (parallel) {
+    VLOG(1) << "Building " << node_def_count() << " nodes in parallel";
+    TF_RETURN_IF_ERROR(PrepareNodes(&prepared_nodes));
+  }
+
   std::vector<InputInfo> inputs;
   int processed = 0;
 
   std::vector<bool> input_already_exists;
+  NodeDef consumed_node_def;
 
   // Process the NodeDefs in topological order.
   // (InitFromEdges() sets this up by filling in ready_ with nodes that have no
@@ -1146,7 +1222,9 @@ Status GraphConstructor::Convert() {
     inputs.clear();
     bool has_data_back_edge = false;
 
-    NodeDef node_def = consume_node_def(o);
+    if (!parallel) consumed_node_def = consume_node_def(o);
+    NodeDef& node_def =
+        parallel ? prepared_nodes[o].props->node_def : consumed_node_def;
 
     // input_already_exists[i] is true iff the i-th input of the node we're
     // importing refers to a preexisting node in g_ (i.e. input[i] existed prior
@@ -1240,22 +1318,18 @@ Status GraphConstructor::Convert() {
       }
     }
 
-    if (opts_.importing) {
-      TF_RETURN_IF_ERROR(ModifyNodeDefForImport(&node_def));
+    if (parallel) {
+      node = g_->AddNode(std::move(prepared_nodes[o]));
+      MaybeAssignDevice(node);
     } else {
-      const OpDef* op_def;
-      TF_RETURN_IF_ERROR(
-          g_->op_registry()->LookUpOpDef(node_def.op(), &op_def));
-      if (opts_.add_default_attributes) {
-        AddDefaultsToNodeDef(*op_def, &node_def);
-      }
-      if (opts_.validate_nodes) {
-        TF_RETURN_IF_ERROR(ValidateNodeDef(node_def, *op_def));
+      if (opts_.importing) {
+        TF_RETURN_IF_ERROR(ModifyNodeDefForImport(&node_def));
+      } else {
+        TF_RETURN_IF_ERROR(CompleteNodeDef(&node_def));
       }
+      TF_RETURN_IF_ERROR(MakeNode(std::move(node_def), &node));
     }
 
-    TF_RETURN_IF_ERROR(MakeNode(std::move(node_def), &node));
-
     gdef_nodes_[node_name].node = node;
 
     // Remove duplicate control inputs before adding edges to the graph. It
@@ -1291,7 +1365,9 @@ Status GraphConstructor::Convert() {
                  << " NODES IN A CYCLE";
     for (int64_t i = 0; i < node_def_count(); i++) {
       if (pending_count_[i] != 0) {
-        LOG(WARNING) << "PENDING: " << SummarizeNodeDef(get_node_def(i))
+        const NodeDef& node_def = parallel ? prepared_nodes[i].props->node_def
+                                           : get_node_def(i);
+        LOG(WARNING) << "PENDING: " << SummarizeNodeDef(node_def)
                      << " WITH PENDING COUNT = " << pending_count_[i];
       }
     }
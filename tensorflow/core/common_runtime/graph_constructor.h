@@ -24,6 +24,10 @@ limitations under the License.
 namespace tensorflow {
 class ShapeRefiner;
 
+namespace thread {
+class ThreadPool;
+}  // namespace thread
+
 // Construct a Graph *g out of a GraphDef gdef. Returns non-OK on
 // error, in which case *g is left in an incomplete state.
 //
@@ -52,6 +56,16 @@ struct GraphConstructorOptions {
   // If true, GraphConstructor will add attributes with their default
   // value to the Node when they are missing from the NodeDef.
   bool add_default_attributes = true;
+
+  // If not null, the nodes are validated and built in parallel on this pool,
+  // and only their edges are added sequentially. Worth it for large graphs.
+  thread::ThreadPool* thread_pool = nullptr;
+
+  // If true, the GraphDef is trusted to be valid, e.g. because it was written
+  // by Graph::ToGraphDef(), so the checks of the node names and of the order
+  // of their inputs are skipped, as is ValidateNodeDef() regardless of
+  // `validate_nodes`. An invalid GraphDef may then build an invalid graph.
+  bool prevalidated = false;
 };
 extern Status ConvertGraphDefToGraph(const GraphConstructorOptions& opts,
                                      const GraphDef& gdef, Graph* g);
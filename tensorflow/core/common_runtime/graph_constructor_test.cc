@@ -30,11 +30,14 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/version.h"
+#include "tensorflow/core/util/equal_graph_def.h"
 
 // TODO(josh11b): Test InitCostModel().
 // TODO(josh11b): Test setting the "device" field of a NodeDef.
@@ -923,6 +926,97 @@ TEST_F(GraphConstructorTest, Error_ControlEdgeBeforeRealInput) {
       {"Node 't2': Control dependencies must come after regular dependencies"});
 }
 
+TEST_F(GraphConstructorTest, ParallelConvert) {
+  GraphDef gdef;
+  CHECK(protobuf::TextFormat::ParseFromString(
+      "node { name: 'W' op: 'TestParams' }"
+      "node { name: 'input' op: 'TestInput' input: [ '^W' ] }"
+      "node { name: 'd' op: 'TestDefaultAttr' }",
+      &gdef));
+  string previous = "input:1";
+  for (int i = 0; i < 1000; ++i) {
+    NodeDef* node = gdef.add_node();
+    node->set_name(strings::StrCat("t", i));
+    node->set_op("TestMul");
+    node->add_input("W");
+    node->add_input(previous);
+    if (i % 10 == 0) node->add_input("^d");
+    previous = node->name();
+  }
+
+  GraphConstructorOptions opts;
+  TF_ASSERT_OK(ConvertGraphDefToGraph(opts, gdef, &graph_));
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+  opts.thread_pool = &pool;
+  Graph parallel_graph(OpRegistry::Global());
+  TF_ASSERT_OK(ConvertGraphDefToGraph(opts, gdef, &parallel_graph));
+
+  GraphDef expected;
+  graph_.ToGraphDef(&expected);
+  GraphDef actual;
+  parallel_graph.ToGraphDef(&actual);
+  TF_EXPECT_GRAPH_EQ(expected, actual);
+  Node* d = nullptr;
+  for (Node* n : parallel_graph.nodes()) {
+    if (n->name() == "d") d = n;
+  }
+  ASSERT_NE(d, nullptr);
+  EXPECT_EQ(d->def().attr().at("default_int").i(), 31415);
+
+  // Same with the import that consumes the GraphDef.
+  Graph moved_graph(OpRegistry::Global());
+  TF_ASSERT_OK(ConvertGraphDefToGraph(opts, GraphDef(gdef), &moved_graph));
+  moved_graph.ToGraphDef(&actual);
+  TF_EXPECT_GRAPH_EQ(expected, actual);
+}
+
+TEST_F(GraphConstructorTest, ParallelConvertErrors) {
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+  GraphConstructorOptions opts;
+  opts.thread_pool = &pool;
+  const string original_graph_description = GraphDebugString();
+  GraphDef gdef;
+  CHECK(protobuf::TextFormat::ParseFromString(
+      "node { name: 'input' op: 'TestInput' }"
+      "node { name: 't1' op: 'TestMul' input: [ 'input:0', 't2' ] }"
+      "node { name: 't2' op: 'TestMul' input: [ 'input:1', 't1' ] }",
+      &gdef));
+  Status s = ConvertGraphDefToGraph(opts, gdef, &graph_);
+  EXPECT_TRUE(s.error_message().find("cycle") != string::npos) << s;
+  EXPECT_EQ(original_graph_description, GraphDebugString());
+
+  CHECK(protobuf::TextFormat::ParseFromString(
+      "node { name: 'input' op: 'TestInput' }"
+      "node { name: 'int' op: 'TestInt' input: [ 'input' ] }"
+      "node { name: 'bad' op: 'DoesNotExist' }",
+      &gdef));
+  s = ConvertGraphDefToGraph(opts, gdef, &graph_);
+  EXPECT_TRUE(s.error_message().find("DoesNotExist") != string::npos) << s;
+  EXPECT_EQ(original_graph_description, GraphDebugString());
+}
+
+TEST_F(GraphConstructorTest, PrevalidatedGraphDef) {
+  GraphDef gdef;
+  CHECK(protobuf::TextFormat::ParseFromString(
+      "node { name: 'W' op: 'TestParams' }"
+      "node { name: 'input' op: 'TestInput' }"
+      "node { name: '_t' op: 'TestMul' input: [ 'W', 'input:1' ] }"
+      "node { name: 'd' op: 'TestDefaultAttr' "
+      "       attr { key: 'unknown' value { i: 1 } } }",
+      &gdef));
+  GraphConstructorOptions opts;
+  opts.validate_nodes = true;
+  {
+    Graph graph(OpRegistry::Global());
+    EXPECT_FALSE(ConvertGraphDefToGraph(opts, gdef, &graph).ok());
+  }
+
+  // A prevalidated GraphDef is trusted.
+  opts.prevalidated = true;
+  TF_EXPECT_OK(ConvertGraphDefToGraph(opts, gdef, &graph_));
+  EXPECT_TRUE(HasEdge("input", 1, "_t", 1));
+}
+
 TEST_F(GraphConstructorTest, ImportGraphDef) {
   GraphDef def;
   ImportGraphDefOptions opts;
@@ -22,6 +22,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_join.h"
@@ -37,6 +38,7 @@ limitations under the License.
 #include "tensorflow/core/framework/graph_def_util.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/versions.pb.h"
@@ -499,6 +501,65 @@ Status GetFeedShapeAndTypeFromAttribute(const NodeDef& node,
   return OkStatus();
 }
 
+// Inserts an EnsureShape node between each of the `feeds` of `graph` which is
+// an output 0 with a known rank of at least 1 and its consumers, with the
+// first dimension set to `batch_size`. Grappler then optimizes the consumers
+// for that batch size, and the EnsureShape nodes check it at run time.
+void SpecializeFeedsToBatchSize(
+    const protobuf::RepeatedPtrField<string>& feeds, int64_t batch_size,
+    GraphDef* graph) {
+  absl::flat_hash_set<string> feed_nodes;
+  for (const string& feed : feeds) {
+    const TensorId id = ParseTensorName(feed);
+    if (id.index() == 0) feed_nodes.insert(string(id.node()));
+  }
+  absl::flat_hash_set<string> node_names;
+  for (const NodeDef& node : graph->node()) {
+    node_names.insert(node.name());
+  }
+
+  // The name of the EnsureShape node of each specialized feed node.
+  absl::flat_hash_map<string, string> specialized;
+  std::vector<NodeDef> ensure_shapes;
+  for (const NodeDef& node : graph->node()) {
+    if (!feed_nodes.contains(node.name())) continue;
+    PartialTensorShape shape;
+    DataType type;
+    if (!GetFeedShapeAndTypeFromAttribute(node, &shape, &type).ok() ||
+        shape.unknown_rank() || shape.dims() == 0 ||
+        (shape.dim_size(0) >= 0 && shape.dim_size(0) != batch_size)) {
+      continue;
+    }
+    shape.set_dim(0, batch_size);
+    NodeDef ensure_shape;
+    ensure_shape.set_name(
+        strings::StrCat(node.name(), "/_specialized_batch_", batch_size));
+    if (!node_names.insert(ensure_shape.name()).second) continue;
+    ensure_shape.set_op("EnsureShape");
+    ensure_shape.set_device(node.device());
+    ensure_shape.add_input(node.name());
+    AddNodeAttr("shape", shape, &ensure_shape);
+    AddNodeAttr("T", type, &ensure_shape);
+    specialized[node.name()] = ensure_shape.name();
+    ensure_shapes.push_back(std::move(ensure_shape));
+  }
+  if (specialized.empty()) return;
+
+  for (NodeDef& node : *graph->mutable_node()) {
+    for (string& input : *node.mutable_input()) {
+      const TensorId id = ParseTensorName(input);
+      if (id.index() != 0) continue;
+      auto it = specialized.find(id.node());
+      if (it != specialized.end()) input = it->second;
+    }
+  }
+  for (NodeDef& ensure_shape : ensure_shapes) {
+    VLOG(2) << "Specialize " << ensure_shape.input(0) << " to batch size "
+            << batch_size;
+    *graph->add_node() = std::move(ensure_shape);
+  }
+}
+
 }  // namespace
 
 Status GraphExecutionState::PruneGraph(
@@ -518,8 +579,8 @@ Status GraphExecutionState::PruneGraph(
       TF_RETURN_IF_ERROR(LookupDevice(*device_set_, feed,
                                       options.callable_options.feed_devices(),
                                       &device_info));
-      feed_rewrites.emplace_back(
-          new subgraph::ArgFeedRewrite(&feed, device_info, i));
+      feed_rewrites.emplace_back(new subgraph::ArgFeedRewrite(
+          &feed, device_info, i, options.keep_fed_placeholder_shapes));
       tensors_and_devices.push_back({ParseTensorName(feed), device_info});
     }
     if (!options.callable_options.fetch_devices().empty() &&
@@ -789,6 +850,10 @@ Status GraphExecutionState::OptimizeGraph(
 
     // Convert Graph to GraphDef and add it to the GrapplerItem.
     graph.ToGraphDef(&item.graph);
+    if (options.specialized_batch_size > 0) {
+      SpecializeFeedsToBatchSize(options.callable_options.feed(),
+                                 options.specialized_batch_size, &item.graph);
+    }
     // TODO(b/114748242): Add a unit test to test this bug fix.
     if (flib_def) {
       *item.graph.mutable_library() = flib_def->ToProto();
@@ -85,6 +85,8 @@ struct NodeItem {
                                     // node's input types.
   bool is_distributed_communication : 1;  // True iff the op is registered to
                                           // use distributed communication.
+  bool may_use_step_arena : 1;  // True iff neither the op nor the
+                                // destination of any output edge is stateful.
 
   // The kernel for this node.
   OpKernel* kernel = nullptr;
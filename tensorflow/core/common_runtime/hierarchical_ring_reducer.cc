@@ -0,0 +1,344 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/hierarchical_ring_reducer.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/collective_util.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace tensorflow {
+namespace {
+
+// Sets `*local_ring` to the group members on the task of the device of
+// `col_params`, and `*cross_ring` to the members with the same index on each
+// task, in the order in which the tasks first appear in the group.
+Status MakeRings(const CollectiveParams& col_params,
+                 std::vector<int>* local_ring, std::vector<int>* cross_ring) {
+  const std::vector<CollGroupMember>& members = col_params.group.members;
+  if (col_params.default_rank < 0 ||
+      col_params.default_rank >= static_cast<int>(members.size())) {
+    return errors::Internal("Invalid default rank ", col_params.default_rank,
+                            " in HierarchicalRingReduce");
+  }
+  std::unordered_map<string, int> task_index;
+  std::vector<std::vector<int>> task_members;
+  for (int i = 0; i < static_cast<int>(members.size()); ++i) {
+    const int next_index = task_members.size();
+    auto it = task_index.emplace(members[i].task, next_index).first;
+    if (it->second == next_index) task_members.emplace_back();
+    task_members[it->second].push_back(i);
+  }
+  for (const std::vector<int>& task : task_members) {
+    if (task.size() != task_members[0].size()) {
+      return errors::InvalidArgument(
+          "HierarchicalRingReduce requires the same number of devices on "
+          "every task in group ",
+          col_params.group.group_key);
+    }
+  }
+  *local_ring =
+      task_members[task_index[members[col_params.default_rank].task]];
+  const int local_index =
+      std::find(local_ring->begin(), local_ring->end(),
+                col_params.default_rank) -
+      local_ring->begin();
+  cross_ring->clear();
+  for (const std::vector<int>& task : task_members) {
+    cross_ring->push_back(task[local_index]);
+  }
+  return OkStatus();
+}
+
+// The BufRendezvous key of a chunk sent in a step of a phase by a member.
+string HierarchicalBufKey(const string& exec_key, int phase, int step,
+                          int chunk, int source_member) {
+  return strings::StrCat(exec_key, ":", phase, ":", step, ":", chunk, ":",
+                         source_member);
+}
+
+int Mod(int a, int n) { return ((a % n) + n) % n; }
+
+}  // namespace
+
+Status HierarchicalRingReducer::InitializeCollectiveParams(
+    CollectiveParams* col_params) {
+  if (col_params->instance.type != REDUCTION_COLLECTIVE ||
+      col_params->instance.impl_details.collective_name !=
+          "HierarchicalRingReduce") {
+    return errors::Internal("Unexpected collective ",
+                            col_params->instance.impl_details.collective_name,
+                            " for HierarchicalRingReducer");
+  }
+  std::vector<int> local_ring, cross_ring;
+  return MakeRings(*col_params, &local_ring, &cross_ring);
+}
+
+void HierarchicalRingReducer::Run(StatusCallback done) {
+  DCHECK(col_ctx_);
+  DCHECK(col_params_);
+  // Like RingReducer, this doesn't require non-overlapping collectives.
+  col_ctx_->col_exec->UnblockDependencies(*col_params_);
+
+  done_ = std::move(done);
+  group_size_ = col_params_->group.group_size;
+  Status s = MakeRings(*col_params_, &local_ring_, &cross_ring_);
+  if (!s.ok()) {
+    done_(s);
+    return;
+  }
+  local_rank_ = std::find(local_ring_.begin(), local_ring_.end(),
+                          col_params_->default_rank) -
+                local_ring_.begin();
+  cross_rank_ = std::find(cross_ring_.begin(), cross_ring_.end(),
+                          col_params_->default_rank) -
+                cross_ring_.begin();
+  VLOG(1) << "HierarchicalRingReducer::Run for device "
+          << col_ctx_->device_name << " default_rank "
+          << col_params_->default_rank << " local_rank " << local_rank_
+          << " cross_rank " << cross_rank_;
+
+  // Start by copying input to output if they're not already the same, i.e. if
+  // we're not computing in-place on the input tensor.
+  if ((col_ctx_->input != col_ctx_->output) &&
+      (DMAHelper::base(col_ctx_->input) != DMAHelper::base(col_ctx_->output))) {
+    // We are running in a blockable thread and the callback can't block so
+    // just wait here on the copy.
+    Notification note;
+    profiler::TraceMe activity("MemCpyAsync", profiler::TraceMeLevel::kInfo);
+    CollectiveRemoteAccessLocal::MemCpyAsync(
+        col_ctx_->op_ctx->op_device_context(),
+        col_ctx_->op_ctx->op_device_context(), col_ctx_->device,
+        col_ctx_->device, col_ctx_->op_ctx->input_alloc_attr(0),
+        col_ctx_->op_ctx->output_alloc_attr(0), col_ctx_->input,
+        col_ctx_->output, 0 /*dev_to_dev_stream_index*/,
+        [&note, &s](const Status& copy_status) {
+          s.Update(copy_status);
+          note.Notify();
+        });
+    note.WaitForNotification();
+    if (!s.ok()) {
+      done_(s);
+      return;
+    }
+  }
+
+  AllocatorAttributes attr = col_ctx_->op_ctx->output_alloc_attr(0);
+  ca_.reset(MakeCollectiveAdapter(col_ctx_->output,
+                                  local_ring_.size() * cross_ring_.size(),
+                                  col_ctx_->device->GetAllocator(attr)));
+  Finish(RunPhases());
+}
+
+bool HierarchicalRingReducer::RunPhases() {
+  const int num_local = local_ring_.size();
+  const int num_cross = cross_ring_.size();
+  // Chunk `c` of shard `s` is chunk s * num_cross + c of the adapter.
+  auto shard_chunks = [num_cross](int shard) {
+    std::vector<int> chunks(num_cross);
+    for (int c = 0; c < num_cross; ++c) chunks[c] = shard * num_cross + c;
+    return chunks;
+  };
+
+  // 1. Reduce-scatter within the task: shard s travels from local rank s
+  // around the ring, ending fully reduced on local rank s - 1.
+  for (int step = 0; step < num_local - 1; ++step) {
+    if (!RingStep(/*phase=*/1, step, local_ring_, local_rank_,
+                  shard_chunks(Mod(local_rank_ - step, num_local)),
+                  shard_chunks(Mod(local_rank_ - step - 1, num_local)),
+                  /*reduce=*/true)) {
+      return false;
+    }
+  }
+  const int shard = Mod(local_rank_ + 1, num_local);
+
+  // 2. All-reduce the shard across tasks by a ring reduce-scatter of its
+  // chunks, then a ring all-gather.
+  auto cross_chunk = [shard, num_cross](int c) {
+    return std::vector<int>{shard * num_cross + Mod(c, num_cross)};
+  };
+  for (int step = 0; step < num_cross - 1; ++step) {
+    if (!RingStep(/*phase=*/2, step, cross_ring_, cross_rank_,
+                  cross_chunk(cross_rank_ - step),
+                  cross_chunk(cross_rank_ - step - 1), /*reduce=*/true)) {
+      return false;
+    }
+  }
+  if (col_params_->final_op) {
+    Status s = FinalizeChunks(cross_chunk(cross_rank_ + 1));
+    if (!s.ok()) {
+      StartAbort(s);
+      return false;
+    }
+  }
+  for (int step = 0; step < num_cross - 1; ++step) {
+    if (!RingStep(/*phase=*/3, step, cross_ring_, cross_rank_,
+                  cross_chunk(cross_rank_ + 1 - step),
+                  cross_chunk(cross_rank_ - step), /*reduce=*/false)) {
+      return false;
+    }
+  }
+
+  // 3. All-gather within the task.
+  for (int step = 0; step < num_local - 1; ++step) {
+    if (!RingStep(/*phase=*/4, step, local_ring_, local_rank_,
+                  shard_chunks(Mod(local_rank_ + 1 - step, num_local)),
+                  shard_chunks(Mod(local_rank_ - step, num_local)),
+                  /*reduce=*/false)) {
+      return false;
+    }
+  }
+  VLOG(2) << this << " device=" << col_ctx_->device_name << " finish;"
+          << " final value " << TensorDebugString(ca_->Value());
+  return true;
+}
+
+bool HierarchicalRingReducer::RingStep(int phase, int step,
+                                       const std::vector<int>& ring, int rank,
+                                       const std::vector<int>& send_chunks,
+                                       const std::vector<int>& recv_chunks,
+                                       bool reduce) {
+  const int n = ring.size();
+  const int send_to = ring[Mod(rank + 1, n)];
+  const int recv_from = ring[Mod(rank - 1, n)];
+  const CollGroupMember& send_member = col_params_->group.members[send_to];
+  const CollGroupMember& recv_member = col_params_->group.members[recv_from];
+
+  // Empty tail chunks are neither sent nor received.
+  std::vector<int> sends, recvs;
+  for (int c : send_chunks) {
+    if (ca_->ChunkBytes(c) > 0) sends.push_back(c);
+  }
+  for (int c : recv_chunks) {
+    if (ca_->ChunkBytes(c) > 0) recvs.push_back(c);
+  }
+  std::vector<Tensor> send_tensors, recv_tensors, tmp_tensors;
+  send_tensors.reserve(sends.size());
+  recv_tensors.reserve(recvs.size());
+  tmp_tensors.reserve(recvs.size());
+  for (int c : sends) send_tensors.push_back(ca_->ChunkAlias(c));
+  for (int c : recvs) {
+    recv_tensors.push_back(ca_->ChunkAlias(c));
+    if (reduce) tmp_tensors.push_back(ca_->TempChunk(c));
+  }
+  const DeviceBase::AcceleratorDeviceInfo* gpu_info =
+      col_ctx_->device->tensorflow_accelerator_device_info();
+  if (reduce && !recvs.empty() && gpu_info) {
+    // As in RingReducer, the temp buffers are not guaranteed to be valid
+    // until the events queued on the compute stream complete.
+    Notification note;
+    Status s = gpu_info->default_context->ThenExecute(
+        col_ctx_->device, gpu_info->stream, [&note]() { note.Notify(); });
+    if (!s.ok()) {
+      StartAbort(errors::Internal(
+          "Failed to dispatch ThenExecute in HierarchicalRingReducer"));
+      return false;
+    }
+    note.WaitForNotification();
+  }
+
+  mutex mu;
+  Status step_status;
+  BlockingCounter pending(sends.size() + recvs.size());
+  auto transfer_done = [&mu, &step_status, &pending](const Status& s) {
+    {
+      mutex_lock l(mu);
+      step_status.Update(s);
+    }
+    pending.DecrementCount();
+  };
+  const int self = col_params_->default_rank;
+  for (int i = 0; i < sends.size(); ++i) {
+    col_ctx_->col_exec->remote_access()->PostToPeer(
+        send_member.device.name(), send_member.task,
+        HierarchicalBufKey(col_ctx_->exec_key, phase, step, sends[i], self),
+        col_ctx_->device, col_ctx_->op_ctx->op_device_context(),
+        col_ctx_->op_ctx->output_alloc_attr(0), &send_tensors[i],
+        col_ctx_->device_locality, col_ctx_->op_ctx->cancellation_manager(),
+        transfer_done);
+  }
+  for (int i = 0; i < recvs.size(); ++i) {
+    col_ctx_->col_exec->remote_access()->RecvFromPeer(
+        recv_member.device.name(), recv_member.task, recv_member.is_local,
+        HierarchicalBufKey(col_ctx_->exec_key, phase, step, recvs[i],
+                           recv_from),
+        col_ctx_->device, col_ctx_->op_ctx->op_device_context(),
+        col_ctx_->op_ctx->output_alloc_attr(0),
+        reduce ? &tmp_tensors[i] : &recv_tensors[i], col_ctx_->device_locality,
+        0 /*dev_to_dev_stream_index*/, col_ctx_->op_ctx->cancellation_manager(),
+        transfer_done);
+  }
+  pending.Wait();
+  if (!step_status.ok()) {
+    StartAbort(step_status);
+    return false;
+  }
+  if (reduce) {
+    for (int i = 0; i < recvs.size(); ++i) {
+      Status s = collective_util::ComputeBinOp(
+          col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+          col_params_->merge_op, &recv_tensors[i], &tmp_tensors[i]);
+      if (!s.ok()) {
+        StartAbort(s);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+Status HierarchicalRingReducer::FinalizeChunks(const std::vector<int>& chunks) {
+  Tensor group_size_val = ca_->Scalar(group_size_);
+  Tensor group_size_tensor = group_size_val;
+  if (col_params_->group.device_type != "CPU") {
+    group_size_tensor = ca_->Scalar(
+        col_ctx_->device->GetAllocator(col_ctx_->op_ctx->input_alloc_attr(0)),
+        AllocationAttributes());
+    TF_RETURN_IF_ERROR(
+        col_ctx_->op_ctx->op_device_context()->CopyCPUTensorToDeviceSync(
+            &group_size_val, col_ctx_->device, &group_size_tensor));
+  }
+  for (int c : chunks) {
+    if (ca_->ChunkBytes(c) == 0) continue;
+    Tensor chunk = ca_->ChunkAlias(c);
+    TF_RETURN_IF_ERROR(collective_util::ComputeBinOp(
+        col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+        col_params_->final_op, &chunk, &group_size_tensor));
+  }
+  return OkStatus();
+}
+
+namespace {
+REGISTER_COLLECTIVE(HierarchicalRingReduce, HierarchicalRingReducer);
+}  // namespace
+
+}  // namespace tensorflow
@@ -0,0 +1,79 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_RING_REDUCER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_RING_REDUCER_H_
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/ring_alg.h"
+#include "tensorflow/core/framework/collective.h"
+
+namespace tensorflow {
+
+// Hierarchical ring implementation of collective all-reduce, for groups
+// spanning several tasks with the same number of devices each.  With L
+// devices per task and T tasks, the tensor is split into L shards of T
+// chunks:
+//
+//  1. A ring over the devices of each task reduce-scatters the shards, so
+//     that each device holds the task's sum of one shard.
+//  2. A ring over the T devices holding the same shard, one per task,
+//     all-reduces the shard.
+//  3. A ring over the devices of each task all-gathers the shards.
+//
+// Compared to the flat ring of RingReducer, the data crossing tasks moves in
+// 2 * (T - 1) steps over L rings in parallel, rather than in 2 * (L * T - 1)
+// steps over a single ring.
+class HierarchicalRingReducer : public RingAlg {
+ public:
+  HierarchicalRingReducer()
+      : RingAlg(REDUCTION_COLLECTIVE, "HierarchicalReduce") {}
+  ~HierarchicalRingReducer() override {}
+
+  // Begins async execution of the hierarchical ring reduce algorithm.
+  // Must be called in a blockable thread.
+  void Run(StatusCallback done) override;
+
+  Status InitializeCollectiveParams(CollectiveParams* col_params) override;
+
+ private:
+  // Runs the three phases, returning false if aborted.
+  bool RunPhases();
+
+  // Runs one step of a ring over the group members `ring`, in which this
+  // device has rank `rank`: sends the chunks `send_chunks` to the next member
+  // and receives the chunks `recv_chunks` from the previous one, reducing
+  // them into the local values if `reduce`.  Returns false if aborted.
+  bool RingStep(int phase, int step, const std::vector<int>& ring, int rank,
+                const std::vector<int>& send_chunks,
+                const std::vector<int>& recv_chunks, bool reduce);
+
+  // Applies the final op to the chunks `chunks`.
+  Status FinalizeChunks(const std::vector<int>& chunks);
+
+  // The group members on the task of this device, and the members with the
+  // same index on each task, in task order, and the ranks of this device in
+  // them.
+  std::vector<int> local_ring_;
+  std::vector<int> cross_ring_;
+  int local_rank_ = -1;
+  int cross_rank_ = -1;
+
+  friend class HierarchicalRingReducerTest;
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_RING_REDUCER_H_
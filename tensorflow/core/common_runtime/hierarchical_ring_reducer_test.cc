@@ -0,0 +1,171 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/hierarchical_ring_reducer.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/collective_test_util.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+std::unique_ptr<OpKernel> GetBinOp(const string& op, DataType dtype,
+                                   const DeviceType& device_type,
+                                   DeviceBase* device) {
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder("bin_op", op)
+                  .Attr("T", dtype)
+                  .Input(FakeInput(dtype))
+                  .Input(FakeInput(dtype))
+                  .Finalize(&node_def));
+  Status status;
+  std::unique_ptr<OpKernel> k = CreateOpKernel(
+      device_type, device, device->GetAllocator(AllocatorAttributes()),
+      node_def, TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  return k;
+}
+
+}  // namespace
+
+class HierarchicalRingReducerTest : public ::testing::Test {
+ protected:
+  class DeviceInstance {
+   public:
+    DeviceInstance(int rank, DataType dtype, const TensorShape& shape,
+                   CollectiveTestEnv* test_env)
+        : test_env_(test_env), tensor_(dtype, shape) {
+      col_params_ =
+          CreateCollectiveParams(*test_env_, rank, "HierarchicalRingReduce",
+                                 REDUCTION_COLLECTIVE, dtype, shape);
+      const string& dev_name = col_params_->group.members[rank].device.name();
+      TF_CHECK_OK(test_env_->device_mgr->LookupDevice(dev_name, &device_));
+      merge_op_ = GetBinOp("Add", dtype, test_env_->device_type, device_);
+      final_op_ = GetBinOp("Div", dtype, test_env_->device_type, device_);
+      col_params_->merge_op = merge_op_.get();
+      col_params_->final_op = final_op_.get();
+    }
+
+    void DoReduce() {
+      status_ = RunCollective(test_env_, col_params_.get(), device_, &tensor_,
+                              &tensor_);
+    }
+
+    CollectiveTestEnv* test_env_;
+    Tensor tensor_;
+    Device* device_;
+    core::RefCountPtr<CollectiveParams> col_params_;
+    std::unique_ptr<OpKernel> merge_op_;
+    std::unique_ptr<OpKernel> final_op_;
+    Status status_;
+  };
+
+  void RunTest(int num_workers, int num_devices, int tensor_len,
+               int fail_after) {
+    test_env_ = CreateCollectiveTestEnv(num_workers, num_devices, DEVICE_CPU);
+    test_env_->remote_access->set_fail_after(fail_after);
+    std::vector<float> expected(tensor_len);
+    for (int rank = 0; rank < num_workers * num_devices; ++rank) {
+      instances_.push_back(std::make_unique<DeviceInstance>(
+          rank, DT_FLOAT, TensorShape({tensor_len}), test_env_.get()));
+      Tensor* t = &instances_.back()->tensor_;
+      for (int i = 0; i < tensor_len; ++i) {
+        // Small integers, so that the sums are exact in any order.
+        t->flat<float>()(i) = rank * 10 + i % 100;
+        expected[i] += t->flat<float>()(i);
+      }
+    }
+    std::atomic<int> done(0);
+    for (auto& instance : instances_) {
+      SchedClosure([&instance, &done] {
+        instance->DoReduce();
+        ++done;
+      });
+      if (fail_after > 0) {
+        // Stagger the op execution starts.
+        Env::Default()->SleepForMicroseconds(100);
+      }
+    }
+    while (done < static_cast<int>(instances_.size())) {
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+    if (fail_after > 0) {
+      for (const auto& instance : instances_) {
+        EXPECT_NE(instance->status_.error_message().find("Deliberate failure"),
+                  string::npos);
+      }
+      return;
+    }
+    for (float& value : expected) {
+      value /= num_workers * num_devices;
+    }
+    for (const auto& instance : instances_) {
+      TF_EXPECT_OK(instance->status_);
+      test::ExpectTensorEqual<float>(test::AsTensor<float>(expected),
+                                     instance->tensor_);
+    }
+  }
+
+  std::unique_ptr<CollectiveTestEnv> test_env_;
+  std::vector<std::unique_ptr<DeviceInstance>> instances_;
+};
+
+TEST_F(HierarchicalRingReducerTest, TwoWorkersTwoDevices) {
+  RunTest(/*num_workers=*/2, /*num_devices=*/2, /*tensor_len=*/1001,
+          /*fail_after=*/0);
+}
+
+TEST_F(HierarchicalRingReducerTest, ThreeWorkersFourDevices) {
+  RunTest(/*num_workers=*/3, /*num_devices=*/4, /*tensor_len=*/4095,
+          /*fail_after=*/0);
+}
+
+TEST_F(HierarchicalRingReducerTest, FewerElementsThanChunks) {
+  RunTest(/*num_workers=*/2, /*num_devices=*/8, /*tensor_len=*/7,
+          /*fail_after=*/0);
+}
+
+TEST_F(HierarchicalRingReducerTest, SingleWorker) {
+  RunTest(/*num_workers=*/1, /*num_devices=*/4, /*tensor_len=*/1001,
+          /*fail_after=*/0);
+}
+
+TEST_F(HierarchicalRingReducerTest, OneDevicePerWorker) {
+  RunTest(/*num_workers=*/4, /*num_devices=*/1, /*tensor_len=*/1001,
+          /*fail_after=*/0);
+}
+
+TEST_F(HierarchicalRingReducerTest, Aborts) {
+  RunTest(/*num_workers=*/2, /*num_devices=*/4, /*tensor_len=*/9408,
+          /*fail_after=*/5);
+}
+
+}  // namespace tensorflow
@@ -196,6 +196,17 @@ Status ImmutableExecutorState::Initialize(const Graph& graph) {
     item->is_recv_or_switch = IsRecv(n) || IsSwitch(n);
     item->is_next_iteration = IsNextIteration(n);
     item->is_distributed_communication = IsDistributedCommunication(n);
+    // The tensors allocated by stateful ops, or consumed by them, like sends,
+    // variable updates and function return values, are likely to outlive the
+    // step, so they are not allocated from the step arena.
+    item->may_use_step_arena =
+        !n->op_def().is_stateful() && !item->is_any_input_ref_typed;
+    for (const Node* consumer : n->out_nodes()) {
+      if (consumer->op_def().is_stateful()) {
+        item->may_use_step_arena = false;
+        break;
+      }
+    }
 
     // Compute the maximum values we'll store for this node in the
     // pending counts data structure, and allocate a handle in
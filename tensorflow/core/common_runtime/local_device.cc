@@ -125,7 +125,8 @@ LocalDevice::LocalDevice(const SessionOptions& options,
 
   if (use_global_threadpool_) {
     mutex_lock l(global_tp_mu_);
-    if (options.config.experimental().use_numa_affinity()) {
+    if (options.config.experimental().use_numa_affinity() ||
+        options.config.experimental().partition_graph_across_numa_nodes()) {
       int numa_node = attributes.locality().numa_node();
       int num_numa_nodes = port::NUMANumNodes();
       DCHECK_LT(numa_node, num_numa_nodes);
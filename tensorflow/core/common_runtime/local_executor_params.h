@@ -27,6 +27,7 @@ class Device;
 class StepStatsCollector;
 class SessionMetadata;
 class FunctionLibraryRuntime;
+class MemoryPlan;
 class NodeProperties;
 class OpKernel;
 using tsl::Status;
@@ -52,6 +53,11 @@ struct LocalExecutorParams {
 
   // Whether control flow nodes are allowed to be executed synchronously.
   bool allow_control_flow_sync_execution = false;
+
+  // If not null, the executor serves the outputs planned by `memory_plan`
+  // from an arena allocated once per step. The plan must be for the graph of
+  // the executor.
+  std::shared_ptr<const MemoryPlan> memory_plan;
 };
 
 }  // end namespace tensorflow
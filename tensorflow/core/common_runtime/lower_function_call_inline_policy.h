@@ -43,6 +43,10 @@ struct LowerFunctionalOpsConstants {
       "_lower_using_switch_merge";
   static constexpr const char* const kLowerAsMultiDeviceFunctionAttr =
       "_lower_as_multi_device_function";
+  // Set on the While nodes that are not lowered because their cond and body
+  // are small, for the While kernel to run them as a tight loop on the
+  // single-threaded executor.
+  static constexpr const char* const kSmallLoopAttr = "_small_loop";
 };
 
 // Inliner policy used in common runtime's lower function call op.
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/lower_functional_ops.h"
 
+#include <cstdint>
 #include <string>
 
 #include "absl/container/flat_hash_set.h"
@@ -29,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/graph_node_util.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -38,6 +40,8 @@ constexpr const char* const kLowerUsingSwitchMergeAttr =
     LowerFunctionalOpsConstants::kLowerUsingSwitchMergeAttr;
 constexpr const char* const kLowerAsMultiDeviceFunctionAttr =
     LowerFunctionalOpsConstants::kLowerAsMultiDeviceFunctionAttr;
+constexpr const char* const kSmallLoopAttr =
+    LowerFunctionalOpsConstants::kSmallLoopAttr;
 
 constexpr const char* const kTpuReplicateAttr = "_tpu_replicate";
 constexpr const char* const kXlaClusterAttr = "_xla_compile_id";
@@ -156,6 +160,13 @@ Status LowerFunctionalOpsPass::Run(
     return LowerUsingSwitchMergeIsOn(node) && !used_by_xla(node);
   };
 
+  // While loops whose cond and body have at most this many nodes are not
+  // lowered but run as a tight loop by the While kernel. 0 disables it.
+  int64_t small_loop_max_nodes;
+  TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("TF_SMALL_WHILE_LOOP_MAX_NODES",
+                                         /*default_val=*/0,
+                                         &small_loop_max_nodes));
+
   // Lower all If, Case, While ops that have the `kLowerUsingSwitchMergeAttr`
   // attr set and inline all function calls into the graph.
   // We start at `i` = 2 to skip the source and sink nodes.
@@ -187,6 +198,12 @@ Status LowerFunctionalOpsPass::Run(
       TF_RETURN_IF_ERROR(RewriteCaseNode(n, g, keep_lowered_nodes_fetchable));
 
     } else if (n->IsWhileNode() && lower_control_flow(n)) {
+      if (small_loop_max_nodes > 0 &&
+          IsSmallWhileLoop(n, *flib_def, small_loop_max_nodes)) {
+        VLOG(2) << "Not lowering small While node: " << SummarizeNode(*n);
+        n->AddAttr(kSmallLoopAttr, true);
+        continue;
+      }
       TF_RETURN_IF_ERROR(
           RewriteWhileNode(n, g, flib_def, keep_lowered_nodes_fetchable));
 
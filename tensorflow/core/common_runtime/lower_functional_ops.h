@@ -40,6 +40,8 @@ class LowerFunctionalOpsPass : public GraphOptimizationPass {
       LowerFunctionalOpsConstants::kLowerUsingSwitchMergeAttr;
   static constexpr const char* const kLowerAsMultiDeviceFunctionAttr =
       LowerFunctionalOpsConstants::kLowerAsMultiDeviceFunctionAttr;
+  static constexpr const char* const kSmallLoopAttr =
+      LowerFunctionalOpsConstants::kSmallLoopAttr;
 };
 
 }  // namespace tensorflow
@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/lower_while_op.h"
 
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/common_runtime/inline_function_utils.h"
+#include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/graph.h"
@@ -535,4 +537,37 @@ Status RewriteWhileNode(Node* n, Graph* g,
   return OkStatus();
 }
 
+bool IsSmallWhileLoop(const Node* n, const FunctionLibraryDefinition& flib_def,
+                      int64_t max_nodes) {
+  // Low level control flow is not supported by the single-threaded executor,
+  // see ValidateOpIsSafeForSyncExecution().
+  static const auto* const kControlFlowOps = new absl::flat_hash_set<string>(
+      {"Switch", "RefSwitch", "Merge", "RefMerge", "Enter", "RefEnter", "Exit",
+       "RefExit", "NextIteration", "RefNextIteration", "LoopCond"});
+  const auto is_small_function = [&](absl::string_view attr_name) {
+    const AttrValue* attr = n->attrs().Find(attr_name);
+    if (attr == nullptr) return false;
+    const FunctionDef* fdef = flib_def.Find(attr->func().name());
+    if (fdef == nullptr || fdef->node_def_size() > max_nodes) return false;
+    for (const NodeDef& node : fdef->node_def()) {
+      // Function calls and functional ops may hide arbitrarily large graphs,
+      // and explicitly placed ops may not run on the device of the loop.
+      if (flib_def.Find(node.op()) != nullptr || !node.device().empty()) {
+        return false;
+      }
+      for (const auto& node_attr : node.attr()) {
+        if (node_attr.second.has_func()) return false;
+      }
+      if (kControlFlowOps->contains(node.op())) return false;
+      const OpDef* op_def;
+      if (!flib_def.LookUpOpDef(node.op(), &op_def).ok()) return false;
+      for (const OpDef::ArgDef& output_arg : op_def->output_arg()) {
+        if (output_arg.is_ref()) return false;
+      }
+    }
+    return true;
+  };
+  return is_small_function("cond") && is_small_function("body");
+}
+
 }  // namespace tensorflow
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_LOWER_WHILE_OP_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_LOWER_WHILE_OP_H_
 
+#include <cstdint>
+
 #include "tensorflow/core/lib/core/status.h"
 
 namespace tensorflow {
@@ -30,6 +32,13 @@ Status RewriteWhileNode(Node* n, Graph* g,
                         const FunctionLibraryDefinition* flib_def,
                         bool keep_node_fetchable);
 
+// Returns true if the cond and body functions of While node `n` have at most
+// `max_nodes` nodes each and can run on the single-threaded executor. Such
+// loops run faster as a tight loop over their functions than lowered, as they
+// don't pay for the per-iteration bookkeeping of the lowered loop frames.
+bool IsSmallWhileLoop(const Node* n, const FunctionLibraryDefinition& flib_def,
+                      int64_t max_nodes);
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_COMMON_RUNTIME_LOWER_WHILE_OP_H_
@@ -13,6 +13,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "absl/strings/match.h"
 #include "tensorflow/cc/client/client_session.h"
 #include "tensorflow/cc/framework/ops.h"
@@ -587,5 +593,62 @@ TEST(LowerWhileOpTest, DoNotInlineLoweredFunctions) {
   }
 }
 
+TEST(LowerWhileOpTest, KeepsSmallLoopsFunctional) {
+  // Add test functions for cond and body.
+  FunctionDefLibrary f_lib_proto;
+  *f_lib_proto.add_function() = test::function::XTimesTwo();
+  *f_lib_proto.add_function() = test::function::LessThanOrEqualToN(8);
+
+  Scope root = Scope::NewRootScope().ExitOnError();
+  TF_ASSERT_OK(root.graph()->AddFunctionLibrary(f_lib_proto));
+  auto a = ops::Placeholder(root.WithOpName("A"), DT_INT32);
+  Node* while_node;
+  std::vector<NodeBuilder::NodeOut> inputs({NodeBuilder::NodeOut(a.node())});
+  AttrValue cond_func;
+  cond_func.mutable_func()->set_name("LessThanOrEqualToN");
+  AttrValue body_func;
+  body_func.mutable_func()->set_name("XTimesTwo");
+  TF_ASSERT_OK(
+      NodeBuilder("while", "While", &root.graph()->flib_def())
+          .Input(inputs)
+          .Attr("T", {DT_INT32})
+          .Attr("cond", cond_func)
+          .Attr("body", body_func)
+          .Attr("parallel_iterations", 100)
+          .Attr(LowerFunctionalOpsPass::kLowerUsingSwitchMergeAttr, true)
+          .Finalize(root.graph(), &while_node));
+  TF_ASSERT_OK(root.DoShapeInference(while_node));
+
+  const auto count_lowered_loops = [&](int64_t small_loop_max_nodes) {
+    setenv("TF_SMALL_WHILE_LOOP_MAX_NODES",
+           std::to_string(small_loop_max_nodes).c_str(), /*overwrite=*/1);
+    std::unique_ptr<Graph> graph(new Graph(OpRegistry::Global()));
+    TF_CHECK_OK(root.ToGraph(graph.get()));
+    TF_CHECK_OK(Rewrite(&graph));
+    int enter_count = 0;
+    for (const auto* op : graph->op_nodes()) {
+      if (op->IsEnter()) ++enter_count;
+      if (op->IsWhileNode()) {
+        EXPECT_TRUE(
+            op->attrs().Find(LowerFunctionalOpsPass::kSmallLoopAttr)->b());
+      }
+    }
+    return enter_count;
+  };
+  // The body has more than one node.
+  EXPECT_EQ(count_lowered_loops(1), 1);
+  EXPECT_EQ(count_lowered_loops(100), 0);
+
+  // Verify execution of the functional loop.
+  ClientSession session(root, SessionOptionsWithInlining());
+  ClientSession::FeedType feeds;
+  feeds.emplace(Output(a.node()), Input::Initializer(3));
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(session.Run(feeds, {Output(while_node)}, &out_tensors));
+  ASSERT_EQ(out_tensors.size(), 1);
+  EXPECT_EQ(out_tensors[0].scalar<int>()(), 12);
+  unsetenv("TF_SMALL_WHILE_LOOP_MAX_NODES");
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -0,0 +1,280 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/memory_planner.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace {
+
+size_t AlignedBytes(size_t num_bytes) {
+  const size_t alignment = Allocator::kAllocatorAlignment;
+  return (num_bytes + alignment - 1) & ~(alignment - 1);
+}
+
+// Returns true if the outputs of `n` may be planned.
+bool MayPlanOutputs(const Node* n) {
+  // Constants and identities don't allocate their outputs.
+  if (!n->IsOp() || n->IsConstant() || n->IsIdentity() ||
+      n->op_def().is_stateful()) {
+    return false;
+  }
+  for (DataType dtype : n->input_types()) {
+    if (IsRefType(dtype)) {
+      return false;
+    }
+  }
+  // The outputs consumed by stateful ops, like sends, variable updates and
+  // function return values, are likely to outlive the step.
+  for (const Node* consumer : n->out_nodes()) {
+    if (consumer->op_def().is_stateful()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// An output to plan, live from the position of its producer to the position
+// of its last consumer in the topological order.
+struct Interval {
+  int start;
+  int end;
+  size_t aligned_bytes;
+};
+
+bool LiveRangesOverlap(const Interval& a, const Interval& b) {
+  return a.start <= b.end && b.start <= a.end;
+}
+
+}  // namespace
+
+Status MemoryPlan::Create(const Graph& graph, const OutputBytesFn& output_bytes,
+                          std::unique_ptr<const MemoryPlan>* plan) {
+  plan->reset();
+  for (const Node* n : graph.op_nodes()) {
+    if (n->IsControlFlow()) {
+      return OkStatus();
+    }
+  }
+
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  std::vector<int> position(graph.num_node_ids(), -1);
+  for (int i = 0; i < order.size(); ++i) {
+    position[order[i]->id()] = i;
+  }
+
+  std::unique_ptr<MemoryPlan> result(new MemoryPlan);
+  std::vector<Interval> intervals;
+  for (const Node* n : order) {
+    if (!MayPlanOutputs(n)) {
+      continue;
+    }
+    for (int i = 0; i < n->num_outputs(); ++i) {
+      const DataType dtype = n->output_type(i);
+      if (IsRefType(dtype) || !DataTypeCanUseMemcpy(dtype)) {
+        continue;
+      }
+      const int64_t num_bytes = output_bytes(n, i);
+      if (num_bytes <= 0) {
+        continue;
+      }
+      Interval interval{position[n->id()], position[n->id()],
+                        AlignedBytes(num_bytes)};
+      for (const Edge* e : n->out_edges()) {
+        if (e->src_output() == i) {
+          interval.end = std::max(interval.end, position[e->dst()->id()]);
+        }
+      }
+      result->buffers_.push_back(
+          {n->id(), i, /*offset=*/0, static_cast<size_t>(num_bytes), {}});
+      intervals.push_back(interval);
+    }
+  }
+  if (result->buffers_.empty()) {
+    return OkStatus();
+  }
+
+  // Place the largest buffers first, each at the smallest gap between the
+  // buffers already placed with an overlapping live range that fits it.
+  std::vector<int> by_size(result->buffers_.size());
+  std::iota(by_size.begin(), by_size.end(), 0);
+  std::stable_sort(by_size.begin(), by_size.end(), [&](int a, int b) {
+    return intervals[a].aligned_bytes > intervals[b].aligned_bytes;
+  });
+  // The buffers placed so far, by increasing offset.
+  std::vector<int> placed;
+  for (int index : by_size) {
+    const Interval& interval = intervals[index];
+    size_t best_offset = 0;
+    size_t best_gap = std::numeric_limits<size_t>::max();
+    size_t gap_start = 0;
+    for (int other : placed) {
+      if (!LiveRangesOverlap(interval, intervals[other])) {
+        continue;
+      }
+      const size_t other_offset = result->buffers_[other].offset;
+      if (other_offset >= gap_start) {
+        const size_t gap = other_offset - gap_start;
+        if (gap >= interval.aligned_bytes && gap < best_gap) {
+          best_gap = gap;
+          best_offset = gap_start;
+        }
+      }
+      gap_start =
+          std::max(gap_start, other_offset + intervals[other].aligned_bytes);
+    }
+    if (best_gap == std::numeric_limits<size_t>::max()) {
+      best_offset = gap_start;
+    }
+    result->buffers_[index].offset = best_offset;
+    result->arena_bytes_ =
+        std::max(result->arena_bytes_, best_offset + interval.aligned_bytes);
+    placed.insert(std::upper_bound(placed.begin(), placed.end(), index,
+                                   [&](int a, int b) {
+                                     return result->buffers_[a].offset <
+                                            result->buffers_[b].offset;
+                                   }),
+                  index);
+  }
+
+  // Record the buffers sharing bytes, which by construction have disjoint
+  // live ranges.
+  for (int i = 0; i < placed.size(); ++i) {
+    Buffer& buffer = result->buffers_[placed[i]];
+    const size_t end = buffer.offset + intervals[placed[i]].aligned_bytes;
+    for (int j = i + 1; j < placed.size(); ++j) {
+      Buffer& other = result->buffers_[placed[j]];
+      if (other.offset >= end) {
+        break;
+      }
+      buffer.overlapping.push_back(placed[j]);
+      other.overlapping.push_back(placed[i]);
+    }
+  }
+
+  result->first_output_.resize(graph.num_node_ids(), -1);
+  for (int index = 0; index < result->buffers_.size(); ++index) {
+    const Buffer& buffer = result->buffers_[index];
+    int& first_output = result->first_output_[buffer.node_id];
+    if (first_output < 0) {
+      first_output = result->output_buffers_.size();
+      result->output_buffers_.resize(
+          first_output + graph.FindNodeId(buffer.node_id)->num_outputs(), -1);
+    }
+    result->output_buffers_[first_output + buffer.output_index] = index;
+  }
+
+  VLOG(1) << "Planned " << result->buffers_.size() << " outputs in an arena of "
+          << result->arena_bytes_ << " bytes";
+  *plan = std::move(result);
+  return OkStatus();
+}
+
+class PlannedStepMemory::PlannedBuffer : public TensorBuffer {
+ public:
+  PlannedBuffer(PlannedStepMemory* memory, int buffer_index, void* data,
+                size_t size)
+      : TensorBuffer(data),
+        memory_(memory),
+        buffer_index_(buffer_index),
+        size_(size) {
+    memory_->Ref();
+  }
+
+  ~PlannedBuffer() override {
+    memory_->ReleaseBuffer(buffer_index_);
+    memory_->Unref();
+  }
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("planned_step_memory");
+  }
+
+ private:
+  PlannedStepMemory* const memory_;
+  const int buffer_index_;
+  const size_t size_;
+};
+
+core::RefCountPtr<TensorBuffer> PlannedStepMemory::NodeOutputs::AllocateOutput(
+    int index, size_t num_bytes) {
+  const int buffer_index = memory_->plan().BufferIndex(node_id_, index);
+  if (buffer_index < 0) {
+    return nullptr;
+  }
+  return memory_->Allocate(buffer_index, num_bytes);
+}
+
+PlannedStepMemory::PlannedStepMemory(std::shared_ptr<const MemoryPlan> plan,
+                                     Allocator* base)
+    : plan_(std::move(plan)), base_(base), in_use_(plan_->num_buffers()) {}
+
+PlannedStepMemory::~PlannedStepMemory() {
+  if (arena_ != nullptr) {
+    base_->DeallocateRaw(arena_);
+  }
+}
+
+core::RefCountPtr<TensorBuffer> PlannedStepMemory::Allocate(int buffer_index,
+                                                            size_t num_bytes) {
+  const MemoryPlan::Buffer& buffer = plan_->buffer(buffer_index);
+  if (num_bytes != buffer.num_bytes) {
+    return nullptr;
+  }
+  mutex_lock l(mu_);
+  if (in_use_[buffer_index]) {
+    return nullptr;
+  }
+  for (int other : buffer.overlapping) {
+    if (in_use_[other]) {
+      return nullptr;
+    }
+  }
+  if (arena_ == nullptr) {
+    if (arena_allocation_failed_) {
+      return nullptr;
+    }
+    arena_ = static_cast<char*>(base_->AllocateRaw(
+        Allocator::kAllocatorAlignment, plan_->arena_bytes()));
+    if (arena_ == nullptr) {
+      // Don't retry for the other outputs of the step.
+      arena_allocation_failed_ = true;
+      return nullptr;
+    }
+  }
+  in_use_[buffer_index] = true;
+  return core::RefCountPtr<TensorBuffer>(new PlannedBuffer(
+      this, buffer_index, arena_ + buffer.offset, buffer.num_bytes));
+}
+
+void PlannedStepMemory::ReleaseBuffer(int buffer_index) {
+  mutex_lock l(mu_);
+  DCHECK(in_use_[buffer_index]);
+  in_use_[buffer_index] = false;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,161 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLANNER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLANNER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+class Graph;
+class Node;
+
+// A static assignment of the outputs of the nodes of a graph to ranges of an
+// arena allocated once per step, in the manner of XLA's HeapSimulator and
+// TFLite's ArenaPlanner.
+//
+// Only the outputs whose size is known ahead of time, and that are unlikely to
+// outlive the step, are planned: those of stateless nodes other than constants
+// and identities, without ref inputs, and whose consumers are stateless too.
+// Each output is live from its producer to its last consumer in a topological
+// order of the graph, and the outputs with overlapping live ranges get
+// disjoint ranges of the arena, assigned by decreasing size to the smallest
+// gap that fits.
+//
+// The executor may run the nodes in another order than the planned one, and
+// kernels may forward their input buffers to their outputs, so the range of
+// an output is only used if the outputs sharing bytes with it have released
+// theirs. See PlannedStepMemory.
+class MemoryPlan {
+ public:
+  struct Buffer {
+    int node_id;
+    int output_index;
+    size_t offset;
+    size_t num_bytes;
+    // The indices of the other buffers sharing bytes of the arena with this
+    // one.
+    std::vector<int> overlapping;
+  };
+
+  // Returns the size in bytes of output `output_index` of `node`, or -1 if it
+  // is not known ahead of time.
+  typedef std::function<int64_t(const Node* node, int output_index)>
+      OutputBytesFn;
+
+  // Plans the outputs of `graph` whose size `output_bytes` returns. Sets
+  // `*plan` to null if no output can be planned. Graphs with control flow are
+  // not planned, since the outputs of the nodes in loops have one live range
+  // per iteration.
+  static Status Create(const Graph& graph, const OutputBytesFn& output_bytes,
+                       std::unique_ptr<const MemoryPlan>* plan);
+
+  // Returns the index of the buffer planned for output `output_index` of the
+  // node with id `node_id`, or -1 if that output is not planned.
+  int BufferIndex(int node_id, int output_index) const {
+    if (node_id >= static_cast<int>(first_output_.size()) ||
+        first_output_[node_id] < 0) {
+      return -1;
+    }
+    return output_buffers_[first_output_[node_id] + output_index];
+  }
+
+  const Buffer& buffer(int index) const { return buffers_[index]; }
+  int num_buffers() const { return buffers_.size(); }
+
+  // Returns the size of the arena of each step.
+  size_t arena_bytes() const { return arena_bytes_; }
+
+ private:
+  MemoryPlan() = default;
+
+  std::vector<Buffer> buffers_;
+  // For each node id, the index in `output_buffers_` of the buffer index of
+  // its first output, or -1 if none of its outputs is planned.
+  std::vector<int> first_output_;
+  std::vector<int> output_buffers_;
+  size_t arena_bytes_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MemoryPlan);
+};
+
+// The memory of one step of an executor following a MemoryPlan. The arena is
+// allocated from a base allocator when the first planned output is, and
+// returned to it once the step and all the tensors using it have released
+// their references, so tensors that escape the step stay valid.
+//
+// The buffer of an output is only handed out if no buffer sharing bytes with
+// it is in use; otherwise the output is allocated as if it were unplanned.
+//
+// This class is thread-safe.
+class PlannedStepMemory : public core::RefCounted {
+ public:
+  // Serves the planned outputs of one node to its OpKernelContext.
+  class NodeOutputs : public PlannedOutputBuffers {
+   public:
+    NodeOutputs(PlannedStepMemory* memory, int node_id)
+        : memory_(memory), node_id_(node_id) {}
+
+    core::RefCountPtr<TensorBuffer> AllocateOutput(int index,
+                                                   size_t num_bytes) override;
+
+   private:
+    PlannedStepMemory* const memory_;  // Not owned.
+    const int node_id_;
+  };
+
+  // `base` must outlive this object.
+  PlannedStepMemory(std::shared_ptr<const MemoryPlan> plan, Allocator* base);
+
+  // Returns the buffer at `buffer_index` in the plan, or null if it is not
+  // `num_bytes` large, or it or a buffer sharing bytes with it is in use.
+  core::RefCountPtr<TensorBuffer> Allocate(int buffer_index, size_t num_bytes)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  const MemoryPlan& plan() const { return *plan_; }
+
+ private:
+  class PlannedBuffer;
+
+  ~PlannedStepMemory() override;
+
+  void ReleaseBuffer(int buffer_index) TF_LOCKS_EXCLUDED(mu_);
+
+  const std::shared_ptr<const MemoryPlan> plan_;
+  Allocator* const base_;
+
+  mutex mu_;
+  char* arena_ TF_GUARDED_BY(mu_) = nullptr;
+  bool arena_allocation_failed_ TF_GUARDED_BY(mu_) = false;
+  std::vector<bool> in_use_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PlannedStepMemory);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLANNER_H_
@@ -0,0 +1,176 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/memory_planner.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/counting_allocator_test_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr int64_t kOutputBytes = 1024;
+
+int64_t FixedOutputBytes(const Node* node, int output_index) {
+  return kOutputBytes;
+}
+
+// Builds a chain of `length` Neg nodes, and returns them in `chain`.
+void BuildChain(int length, Graph* g, std::vector<Node*>* chain) {
+  Node* v = test::graph::Constant(g, Tensor(DT_FLOAT, TensorShape({256})));
+  for (int i = 0; i < length; ++i) {
+    v = test::graph::Unary(g, "Neg", v);
+    chain->push_back(v);
+  }
+  FixupSourceAndSinkEdges(g);
+}
+
+TEST(MemoryPlanTest, ReusesBuffersOfDeadOutputs) {
+  Graph g(OpRegistry::Global());
+  std::vector<Node*> chain;
+  BuildChain(/*length=*/4, &g, &chain);
+  std::unique_ptr<const MemoryPlan> plan;
+  TF_ASSERT_OK(MemoryPlan::Create(g, FixedOutputBytes, &plan));
+  ASSERT_NE(plan, nullptr);
+  EXPECT_EQ(plan->num_buffers(), 4);
+  // At most two outputs of the chain are live at once.
+  EXPECT_EQ(plan->arena_bytes(), 2 * kOutputBytes);
+
+  const int first = plan->BufferIndex(chain[0]->id(), 0);
+  const int second = plan->BufferIndex(chain[1]->id(), 0);
+  const int third = plan->BufferIndex(chain[2]->id(), 0);
+  ASSERT_GE(first, 0);
+  ASSERT_GE(second, 0);
+  ASSERT_GE(third, 0);
+  EXPECT_NE(plan->buffer(first).offset, plan->buffer(second).offset);
+  EXPECT_EQ(plan->buffer(first).offset, plan->buffer(third).offset);
+  EXPECT_EQ(plan->buffer(first).overlapping.size(), 1);
+  EXPECT_EQ(plan->buffer(third).overlapping.size(), 1);
+  EXPECT_EQ(plan->buffer(first).overlapping[0], third);
+  // The constant is not planned.
+  EXPECT_EQ(plan->BufferIndex((*chain[0]->in_nodes().begin())->id(), 0), -1);
+}
+
+TEST(MemoryPlanTest, SkipsOutputsOfUnknownSize) {
+  Graph g(OpRegistry::Global());
+  std::vector<Node*> chain;
+  BuildChain(/*length=*/2, &g, &chain);
+  std::unique_ptr<const MemoryPlan> plan;
+  TF_ASSERT_OK(MemoryPlan::Create(
+      g, [](const Node* node, int output_index) -> int64_t { return -1; },
+      &plan));
+  EXPECT_EQ(plan, nullptr);
+}
+
+TEST(MemoryPlanTest, SkipsOutputsConsumedByStatefulOps) {
+  Graph g(OpRegistry::Global());
+  std::vector<Node*> chain;
+  BuildChain(/*length=*/2, &g, &chain);
+  test::graph::Retval(&g, 0, chain[1]);
+  std::unique_ptr<const MemoryPlan> plan;
+  TF_ASSERT_OK(MemoryPlan::Create(g, FixedOutputBytes, &plan));
+  ASSERT_NE(plan, nullptr);
+  EXPECT_GE(plan->BufferIndex(chain[0]->id(), 0), 0);
+  EXPECT_EQ(plan->BufferIndex(chain[1]->id(), 0), -1);
+}
+
+TEST(MemoryPlanTest, SkipsGraphsWithControlFlow) {
+  Graph g(OpRegistry::Global());
+  Node* x = test::graph::Constant(&g, Tensor(DT_FLOAT, TensorShape({256})));
+  Node* pred = test::graph::Constant(&g, Tensor(DT_BOOL, TensorShape({})));
+  test::graph::Unary(&g, "Neg", test::graph::Switch(&g, x, pred));
+  FixupSourceAndSinkEdges(&g);
+  std::unique_ptr<const MemoryPlan> plan;
+  TF_ASSERT_OK(MemoryPlan::Create(g, FixedOutputBytes, &plan));
+  EXPECT_EQ(plan, nullptr);
+}
+
+class PlannedStepMemoryTest : public ::testing::Test {
+ protected:
+  PlannedStepMemoryTest() : graph_(OpRegistry::Global()) {}
+
+  void SetUp() override {
+    BuildChain(/*length=*/4, &graph_, &chain_);
+    std::unique_ptr<const MemoryPlan> plan;
+    TF_ASSERT_OK(MemoryPlan::Create(graph_, FixedOutputBytes, &plan));
+    ASSERT_NE(plan, nullptr);
+    plan_ = std::move(plan);
+  }
+
+  int BufferIndex(int i) const {
+    return plan_->BufferIndex(chain_[i]->id(), 0);
+  }
+
+  test::CountingAllocator base_;
+  Graph graph_;
+  std::vector<Node*> chain_;
+  std::shared_ptr<const MemoryPlan> plan_;
+};
+
+TEST_F(PlannedStepMemoryTest, WaitsForOverlappingBuffersToBeReleased) {
+  auto* memory = new PlannedStepMemory(plan_, &base_);
+  core::RefCountPtr<TensorBuffer> first =
+      memory->Allocate(BufferIndex(0), kOutputBytes);
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(base_.num_live(), 1);
+  void* data = first->data();
+
+  // The third output shares its range with the first, which is still live.
+  EXPECT_EQ(memory->Allocate(BufferIndex(2), kOutputBytes), nullptr);
+  first.reset();
+  core::RefCountPtr<TensorBuffer> third =
+      memory->Allocate(BufferIndex(2), kOutputBytes);
+  ASSERT_NE(third, nullptr);
+  EXPECT_EQ(third->data(), data);
+  // The same arena serves all the outputs of the step.
+  EXPECT_EQ(base_.num_live(), 1);
+
+  third.reset();
+  memory->Unref();
+  EXPECT_EQ(base_.num_live(), 0);
+}
+
+TEST_F(PlannedStepMemoryTest, RejectsUnplannedSizes) {
+  auto* memory = new PlannedStepMemory(plan_, &base_);
+  EXPECT_EQ(memory->Allocate(BufferIndex(0), kOutputBytes / 2), nullptr);
+  PlannedStepMemory::NodeOutputs outputs(memory, chain_[1]->id());
+  EXPECT_EQ(outputs.AllocateOutput(0, kOutputBytes + 1), nullptr);
+  EXPECT_NE(outputs.AllocateOutput(0, kOutputBytes), nullptr);
+  memory->Unref();
+  EXPECT_EQ(base_.num_live(), 0);
+}
+
+TEST_F(PlannedStepMemoryTest, EscapingTensorsKeepArenaAlive) {
+  auto* memory = new PlannedStepMemory(plan_, &base_);
+  Tensor t(DT_FLOAT, TensorShape({256}),
+           memory->Allocate(BufferIndex(3), kOutputBytes));
+  ASSERT_TRUE(t.IsInitialized());
+  t.flat<float>().setZero();
+  memory->Unref();
+  EXPECT_EQ(base_.num_live(), 1);
+  EXPECT_EQ(t.flat<float>()(0), 0.0f);
+  t = Tensor();
+  EXPECT_EQ(base_.num_live(), 0);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,347 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/numa_placement_pass.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/match.h"
+#include "absl/strings/strip.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/common_runtime/shape_refiner.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/control_flow.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/device_name_utils.h"
+
+namespace tensorflow {
+namespace {
+
+using shape_inference::InferenceContext;
+using shape_inference::ShapeHandle;
+
+// The cost per device below which a graph stays on one device, since the
+// transfers and the scheduling across devices would cost more than they
+// save.
+constexpr int64_t kMinCostPerDevice = 1 << 24;
+
+// How far above its share of the cost a device may get.
+constexpr double kMaxImbalance = 1.1;
+
+constexpr int kMaxRefinementPasses = 8;
+
+// Returns the number of elements of `shape`, counting the unknown dimensions
+// as 1.
+int64_t NumElements(ShapeHandle shape) {
+  if (!InferenceContext::RankKnown(shape)) return 1;
+  int64_t num_elements = 1;
+  for (int i = 0; i < InferenceContext::Rank(shape); ++i) {
+    const int64_t dim =
+        InferenceContext::Value(InferenceContext::DimKnownRank(shape, i));
+    if (dim != InferenceContext::kUnknownDim) num_elements *= dim;
+  }
+  return num_elements;
+}
+
+bool IsContraction(const Node* node) {
+  return node->type_string() == "MatMul" ||
+         node->type_string() == "BatchMatMul" ||
+         node->type_string() == "BatchMatMulV2" ||
+         node->type_string() == "_FusedMatMul" ||
+         node->type_string() == "Conv2D" ||
+         node->type_string() == "_FusedConv2D";
+}
+
+// Returns the estimated cost of `node`: the multiply-adds of a contraction,
+// i.e. its output elements times the elements of its weights per output
+// channel, or the elements read and written by the other ops.
+int64_t NodeCost(const ShapeRefiner& refiner, const Node* node) {
+  InferenceContext* c = refiner.GetContext(node);
+  if (c == nullptr) return 1;
+  int64_t cost = 0;
+  if (IsContraction(node) && c->num_inputs() >= 2 && c->num_outputs() >= 1 &&
+      InferenceContext::RankKnown(c->output(0))) {
+    string data_format;
+    const bool channels_first =
+        TryGetNodeAttr(node->attrs(), "data_format", &data_format) &&
+        absl::StartsWith(data_format, "NC");
+    const int64_t channels = InferenceContext::Value(
+        c->Dim(c->output(0), channels_first ? 1 : -1));
+    if (channels > 0) {
+      cost = NumElements(c->output(0)) * NumElements(c->input(1)) / channels;
+    }
+  }
+  if (cost == 0) {
+    for (int i = 0; i < c->num_inputs(); ++i) {
+      cost += NumElements(c->input(i));
+    }
+    for (int i = 0; i < c->num_outputs(); ++i) {
+      cost += NumElements(c->output(i));
+    }
+  }
+  return std::max<int64_t>(1, cost);
+}
+
+// Returns the estimated bytes of output `port` of `node`.
+int64_t OutputBytes(const ShapeRefiner& refiner, const Node* node, int port) {
+  InferenceContext* c = refiner.GetContext(node);
+  const int64_t num_elements = c != nullptr && port < c->num_outputs()
+                                   ? NumElements(c->output(port))
+                                   : 1;
+  return num_elements *
+         std::max<int64_t>(1, DataTypeSize(node->output_type(port)));
+}
+
+bool HandlesResourcesOrReferences(const Node* node) {
+  for (DataType dtype : node->input_types()) {
+    if (dtype == DT_RESOURCE || IsRefType(dtype)) return true;
+  }
+  for (DataType dtype : node->output_types()) {
+    if (dtype == DT_RESOURCE || IsRefType(dtype)) return true;
+  }
+  return false;
+}
+
+// Returns true if `node` may be moved off the client device `client`.
+bool IsMovable(const Node* node, const Device* client) {
+  return node->assigned_device_name() == client->name() &&
+         node->requested_device().empty() && !node->IsArg() &&
+         !node->IsRetval() && !node->IsSend() && !node->IsRecv() &&
+         !node->op_def().is_stateful() && !HandlesResourcesOrReferences(node);
+}
+
+class UnionFind {
+ public:
+  explicit UnionFind(int size) : parent_(size) {
+    for (int i = 0; i < size; ++i) parent_[i] = i;
+  }
+
+  int Find(int i) {
+    while (parent_[i] != i) {
+      parent_[i] = parent_[parent_[i]];
+      i = parent_[i];
+    }
+    return i;
+  }
+
+  void Union(int a, int b) { parent_[Find(a)] = Find(b); }
+
+ private:
+  std::vector<int> parent_;
+};
+
+// The ops that stay on one device.
+struct Unit {
+  std::vector<Node*> nodes;
+  int64_t cost = 0;
+  // False if one of the nodes can't be moved.
+  bool movable = true;
+  // False if none of the nodes is on the client device.
+  bool on_client = false;
+  // Index of the device, or -1 if not on the client device.
+  int device = -1;
+  // Bytes exchanged with the other units on the client device, by unit.
+  absl::flat_hash_map<int, int64_t> traffic;
+};
+
+}  // namespace
+
+Status NumaPlacementPass::Run(const GraphOptimizationPassOptions& options) {
+  if (options.session_options == nullptr ||
+      !options.session_options->config.experimental()
+           .partition_graph_across_numa_nodes() ||
+      options.device_set == nullptr || options.graph == nullptr ||
+      options.is_function_graph) {
+    return OkStatus();
+  }
+  const Device* client = options.device_set->client_device();
+  if (client == nullptr || client->device_type() != DEVICE_CPU) {
+    return OkStatus();
+  }
+  // The client device comes first, so that the units that stay get its
+  // index 0.
+  std::vector<const Device*> devices = {client};
+  for (const Device* device : options.device_set->devices()) {
+    if (device != client && device->device_type() == DEVICE_CPU &&
+        DeviceNameUtils::IsSameAddressSpace(device->parsed_name(),
+                                            client->parsed_name())) {
+      devices.push_back(device);
+    }
+  }
+  const int num_devices = devices.size();
+  if (num_devices < 2) return OkStatus();
+  Graph* graph = options.graph->get();
+
+  // Group the ops into units.
+  std::vector<ControlFlowInfo> cf_info;
+  TF_RETURN_IF_ERROR(BuildControlFlowInfo(graph, &cf_info));
+  UnionFind union_find(graph->num_node_ids());
+  absl::flat_hash_map<string, int> colocation_groups;
+  for (Node* node : graph->op_nodes()) {
+    const Node* frame = cf_info[node->id()].frame;
+    if (frame != nullptr && !frame->IsSource()) {
+      union_find.Union(node->id(), frame->id());
+    }
+    std::vector<string> groups;
+    if (TryGetNodeAttr(node->attrs(), kColocationAttrName, &groups)) {
+      for (const string& group : groups) {
+        if (!absl::StartsWith(group, kColocationGroupPrefix)) continue;
+        auto it = colocation_groups.emplace(group, node->id()).first;
+        union_find.Union(node->id(), it->second);
+      }
+    }
+  }
+  // A group is also colocated with the op it is named after.
+  absl::flat_hash_map<string, Node*> nodes_by_name;
+  for (Node* node : graph->op_nodes()) {
+    nodes_by_name[node->name()] = node;
+  }
+  for (const auto& group : colocation_groups) {
+    auto it = nodes_by_name.find(
+        absl::StripPrefix(group.first, kColocationGroupPrefix));
+    if (it != nodes_by_name.end()) {
+      union_find.Union(it->second->id(), group.second);
+    }
+  }
+
+  // Estimate the costs, visiting the ops in a topological order which also
+  // orders the units.
+  std::vector<Node*> order;
+  GetReversePostOrder(*graph, &order, NodeComparatorName());
+  ShapeRefiner refiner(graph->versions(), graph->op_registry());
+  std::vector<Unit> units;
+  std::vector<int> unit_of_root(graph->num_node_ids(), -1);
+  std::vector<int> unit_of_node(graph->num_node_ids(), -1);
+  for (Node* node : order) {
+    if (!node->IsOp()) continue;
+    Status s = refiner.AddNode(node);
+    if (!s.ok()) {
+      VLOG(2) << "No shapes for " << node->name() << ": " << s;
+    }
+    int& unit = unit_of_root[union_find.Find(node->id())];
+    if (unit < 0) {
+      unit = units.size();
+      units.emplace_back();
+    }
+    unit_of_node[node->id()] = unit;
+    units[unit].nodes.push_back(node);
+    units[unit].cost += NodeCost(refiner, node);
+    units[unit].movable &= IsMovable(node, client);
+    units[unit].on_client |= node->assigned_device_name() == client->name();
+  }
+  int64_t total_cost = 0;
+  for (const Unit& unit : units) {
+    if (unit.on_client) total_cost += unit.cost;
+  }
+  if (total_cost < kMinCostPerDevice * num_devices) {
+    VLOG(1) << "Keeping the graph on " << client->name() << ", its cost "
+            << total_cost << " is too low";
+    return OkStatus();
+  }
+  for (const Edge* edge : graph->edges()) {
+    if (edge->IsControlEdge() || !edge->src()->IsOp() ||
+        !edge->dst()->IsOp()) {
+      continue;
+    }
+    const int src = unit_of_node[edge->src()->id()];
+    const int dst = unit_of_node[edge->dst()->id()];
+    if (src == dst || !units[src].on_client || !units[dst].on_client) {
+      continue;
+    }
+    const int64_t bytes =
+        OutputBytes(refiner, edge->src(), edge->src_output());
+    units[src].traffic[dst] += bytes;
+    units[dst].traffic[src] += bytes;
+  }
+
+  // Assign runs of units of equal cost to the devices.
+  const double target_cost = static_cast<double>(total_cost) / num_devices;
+  std::vector<int64_t> device_costs(num_devices, 0);
+  for (Unit& unit : units) {
+    if (unit.on_client && !unit.movable) {
+      unit.device = 0;
+      device_costs[0] += unit.cost;
+    }
+  }
+  int device = 0;
+  for (Unit& unit : units) {
+    if (!unit.on_client || !unit.movable) continue;
+    while (device + 1 < num_devices &&
+           device_costs[device] + unit.cost / 2 > target_cost) {
+      ++device;
+    }
+    unit.device = device;
+    device_costs[device] += unit.cost;
+  }
+
+  // Move the units to the device they exchange the most data with.
+  const double max_cost = kMaxImbalance * target_cost;
+  std::vector<int64_t> device_traffic(num_devices);
+  for (int pass = 0; pass < kMaxRefinementPasses; ++pass) {
+    bool moved = false;
+    for (Unit& unit : units) {
+      if (!unit.on_client || !unit.movable) continue;
+      std::fill(device_traffic.begin(), device_traffic.end(), 0);
+      for (const auto& traffic : unit.traffic) {
+        device_traffic[units[traffic.first].device] += traffic.second;
+      }
+      int best_device = unit.device;
+      for (int d = 0; d < num_devices; ++d) {
+        if (device_traffic[d] > device_traffic[best_device] &&
+            device_costs[d] + unit.cost <= max_cost) {
+          best_device = d;
+        }
+      }
+      if (best_device != unit.device) {
+        device_costs[unit.device] -= unit.cost;
+        device_costs[best_device] += unit.cost;
+        unit.device = best_device;
+        moved = true;
+      }
+    }
+    if (!moved) break;
+  }
+
+  int num_moved = 0;
+  for (const Unit& unit : units) {
+    if (unit.device <= 0) continue;
+    for (Node* node : unit.nodes) {
+      node->set_assigned_device_name(devices[unit.device]->name());
+      ++num_moved;
+    }
+  }
+  if (VLOG_IS_ON(1)) {
+    for (int d = 0; d < num_devices; ++d) {
+      VLOG(1) << "Estimated cost on " << devices[d]->name() << ": "
+              << device_costs[d];
+    }
+    VLOG(1) << "Moved " << num_moved << " ops off " << client->name();
+  }
+  return OkStatus();
+}
+
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::POST_PLACEMENT, 10,
+                      NumaPlacementPass);
+
+}  // namespace tensorflow
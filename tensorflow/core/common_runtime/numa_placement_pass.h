@@ -0,0 +1,56 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_NUMA_PLACEMENT_PASS_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_NUMA_PLACEMENT_PASS_H_
+
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+
+namespace tensorflow {
+
+// Spreads the ops of a graph over the CPU devices of the NUMA nodes of the
+// host when `partition_graph_across_numa_nodes` is set in the session config.
+//
+// The placer puts every op without a requested device on the client CPU
+// device. This pass moves some of them to the CPU devices of the other NUMA
+// nodes, each of which has its own thread pool and allocator, so that one
+// graph can use all the sockets of the host:
+//
+// 1. The ops are grouped into units that must stay on one device: the ops
+//    of a colocation group and the ops of a while loop. A unit with an op
+//    that is stateful, that handles resources or references, that was
+//    requested on a device, or that is not on the client device stays where
+//    the placer put it.
+//
+// 2. The cost of each op is estimated from its inferred shapes, as the
+//    multiply-adds of the contractions and the elements read and written
+//    by the others, and the traffic between two units as the bytes of the
+//    tensors they exchange.
+//
+// 3. The units are assigned to the devices in contiguous runs of a
+//    topological order of equal cost, then moved one at a time to the
+//    device they exchange the most data with, as long as no device gets
+//    more than 10% above its share of the cost.
+//
+// Graphs that cost too little to gain from more than one socket are left
+// unchanged.
+class NumaPlacementPass : public GraphOptimizationPass {
+ public:
+  Status Run(const GraphOptimizationPassOptions& options) override;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_NUMA_PLACEMENT_PASS_H_
@@ -0,0 +1,159 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/numa_placement_pass.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/cc/framework/scope.h"
+#include "tensorflow/cc/ops/array_ops.h"
+#include "tensorflow/cc/ops/math_ops.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kCpu0[] = "/job:localhost/replica:0/task:0/device:CPU:0";
+constexpr char kCpu1[] = "/job:localhost/replica:0/task:0/device:CPU:1";
+
+class FakeDevice : public Device {
+ public:
+  FakeDevice(const string& name, int numa_node)
+      : Device(nullptr, MakeAttributes(name, numa_node)) {}
+
+  Status Sync() override { return OkStatus(); }
+  Allocator* GetAllocator(AllocatorAttributes attr) override { return nullptr; }
+
+ private:
+  static DeviceAttributes MakeAttributes(const string& name, int numa_node) {
+    DeviceAttributes attributes;
+    attributes.set_name(name);
+    attributes.set_device_type(DEVICE_CPU);
+    attributes.mutable_locality()->set_numa_node(numa_node);
+    return attributes;
+  }
+};
+
+class NumaPlacementPassTest : public ::testing::Test {
+ protected:
+  NumaPlacementPassTest() : cpu0_(kCpu0, 0), cpu1_(kCpu1, 1) {
+    device_set_.AddDevice(&cpu0_);
+    device_set_.AddDevice(&cpu1_);
+    device_set_.set_client_device(&cpu0_);
+    session_options_.config.mutable_experimental()
+        ->set_partition_graph_across_numa_nodes(true);
+  }
+
+  // Builds `num_towers` independent chains of `depth` MatMuls of `size` by
+  // `size` matrices, the ops of tower t being named "tower<t>/...".
+  void BuildTowers(int num_towers, int depth, int size) {
+    Scope root = Scope::NewRootScope();
+    for (int t = 0; t < num_towers; ++t) {
+      Scope tower = root.NewSubScope(strings::StrCat("tower", t));
+      auto x = ops::Placeholder(tower.WithOpName("x"), DT_FLOAT,
+                                ops::Placeholder::Shape({size, size}));
+      auto w = ops::Placeholder(tower.WithOpName("w"), DT_FLOAT,
+                                ops::Placeholder::Shape({size, size}));
+      Output y = x;
+      for (int i = 0; i < depth; ++i) {
+        y = ops::MatMul(tower.WithOpName(strings::StrCat("matmul_", i)), y, w);
+      }
+      ops::Identity(tower.WithOpName("y"), y);
+    }
+    graph_ = std::make_unique<Graph>(OpRegistry::Global());
+    TF_ASSERT_OK(root.ToGraph(graph_.get()));
+    // As placed by the placer.
+    for (Node* node : graph_->op_nodes()) {
+      node->set_assigned_device_name(kCpu0);
+    }
+  }
+
+  Status RunPass() {
+    GraphOptimizationPassOptions options;
+    options.session_options = &session_options_;
+    options.device_set = &device_set_;
+    options.graph = &graph_;
+    NumaPlacementPass pass;
+    return pass.Run(options);
+  }
+
+  // Returns the devices of the ops of `tower`.
+  std::set<string> TowerDevices(int tower) {
+    std::set<string> devices;
+    for (Node* node : graph_->op_nodes()) {
+      if (absl::StartsWith(node->name(), strings::StrCat("tower", tower))) {
+        devices.insert(node->assigned_device_name());
+      }
+    }
+    return devices;
+  }
+
+  FakeDevice cpu0_;
+  FakeDevice cpu1_;
+  DeviceSet device_set_;
+  SessionOptions session_options_;
+  std::unique_ptr<Graph> graph_;
+};
+
+TEST_F(NumaPlacementPassTest, SplitsIndependentTowers) {
+  BuildTowers(/*num_towers=*/2, /*depth=*/4, /*size=*/512);
+  TF_ASSERT_OK(RunPass());
+  // Each tower runs on one device, with no tensor crossing the sockets.
+  const std::set<string> tower0 = TowerDevices(0);
+  const std::set<string> tower1 = TowerDevices(1);
+  ASSERT_EQ(tower0.size(), 1);
+  ASSERT_EQ(tower1.size(), 1);
+  EXPECT_NE(*tower0.begin(), *tower1.begin());
+}
+
+TEST_F(NumaPlacementPassTest, KeepsSmallGraphs) {
+  BuildTowers(/*num_towers=*/2, /*depth=*/4, /*size=*/8);
+  TF_ASSERT_OK(RunPass());
+  EXPECT_EQ(TowerDevices(0), std::set<string>({kCpu0}));
+  EXPECT_EQ(TowerDevices(1), std::set<string>({kCpu0}));
+}
+
+TEST_F(NumaPlacementPassTest, KeepsRequestedOps) {
+  BuildTowers(/*num_towers=*/2, /*depth=*/4, /*size=*/512);
+  for (Node* node : graph_->op_nodes()) {
+    node->set_requested_device(kCpu0);
+  }
+  TF_ASSERT_OK(RunPass());
+  EXPECT_EQ(TowerDevices(0), std::set<string>({kCpu0}));
+  EXPECT_EQ(TowerDevices(1), std::set<string>({kCpu0}));
+}
+
+TEST_F(NumaPlacementPassTest, DisabledByDefault) {
+  session_options_.config.mutable_experimental()
+      ->set_partition_graph_across_numa_nodes(false);
+  BuildTowers(/*num_towers=*/2, /*depth=*/4, /*size=*/512);
+  TF_ASSERT_OK(RunPass());
+  EXPECT_EQ(TowerDevices(0), std::set<string>({kCpu0}));
+  EXPECT_EQ(TowerDevices(1), std::set<string>({kCpu0}));
+}
+
+}  // namespace
+}  // namespace tensorflow
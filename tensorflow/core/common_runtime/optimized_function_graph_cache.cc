@@ -0,0 +1,204 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/optimized_function_graph_cache.h"
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+OptimizedFunctionGraphCache::OptimizedFunctionGraphCache(int64_t capacity,
+                                                         std::string cache_dir,
+                                                         Env* env)
+    : capacity_(capacity), cache_dir_(std::move(cache_dir)), env_(env) {
+  if (!cache_dir_.empty()) {
+    Status status = env_->RecursivelyCreateDir(cache_dir_);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to create the optimized function graph cache "
+                   << "directory " << cache_dir_ << ": " << status;
+    }
+  }
+}
+
+OptimizedFunctionGraphCache* OptimizedFunctionGraphCache::Global() {
+  static OptimizedFunctionGraphCache* cache = []() {
+    int64_t capacity = 0;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_OPTIMIZED_FUNCTION_GRAPH_CACHE_SIZE",
+                                    0, &capacity));
+    if (capacity <= 0) {
+      return static_cast<OptimizedFunctionGraphCache*>(nullptr);
+    }
+    std::string cache_dir;
+    TF_CHECK_OK(ReadStringFromEnvVar("TF_OPTIMIZED_FUNCTION_GRAPH_CACHE_DIR",
+                                     "", &cache_dir));
+    VLOG(1) << "Caching up to " << capacity << " optimized function graphs"
+            << (cache_dir.empty() ? "" : " in ") << cache_dir;
+    return new OptimizedFunctionGraphCache(capacity, std::move(cache_dir));
+  }();
+  return cache;
+}
+
+StatusOr<std::optional<std::string>> OptimizedFunctionGraphCache::Key(
+    const string& function_name, AttrSlice attrs,
+    const FunctionLibraryRuntime::InstantiateOptions& options,
+    const DeviceSet& dev_set, const FunctionLibraryDefinition* input_lib_def,
+    const std::vector<CompositeDevice*>& composite_devices, Device* cpu_device,
+    Device* default_device) {
+  // The collected graphs would be missing on a cache hit.
+  if (options.graph_collector != nullptr) return std::optional<std::string>();
+
+  const FunctionLibraryDefinition* lib_def =
+      options.lib_def == nullptr ? input_lib_def : options.lib_def;
+  const FunctionDef* fdef = lib_def->Find(function_name);
+  // Leaves the error to OptimizeFunctionGraph().
+  if (fdef == nullptr) return std::optional<std::string>();
+
+  // The library is keyed by its contents rather than by its address.
+  FunctionLibraryRuntime::InstantiateOptions canonical_options = options;
+  canonical_options.lib_def = nullptr;
+  std::string key = Canonicalize(function_name, attrs, canonical_options);
+
+  std::string serialized;
+  if (!SerializeToStringDeterministic(*fdef, &serialized)) {
+    return errors::Internal("Failed to serialize function ", function_name);
+  }
+  absl::StrAppend(&key, "|", serialized);
+  if (!SerializeToStringDeterministic(
+          lib_def->ReachableDefinitions(*fdef).ToProto(), &serialized)) {
+    return errors::Internal("Failed to serialize the library of function ",
+                            function_name);
+  }
+  absl::StrAppend(&key, "|", serialized);
+
+  absl::StrAppend(&key, "|component=", options.is_component_function,
+                  "|xla=", options.xla_compile_device_type,
+                  "|tfe_shapes=", options.shape_inference_on_tfe_dialect_import,
+                  "|optimize_graph_fn=", options.optimize_graph_fn != nullptr);
+  absl::StrAppend(&key, "|devices=");
+  for (const Device* device : dev_set.devices()) {
+    absl::StrAppend(&key, device->name(), ",");
+  }
+  absl::StrAppend(&key, "|composite_devices=");
+  for (const CompositeDevice* device : composite_devices) {
+    absl::StrAppend(&key, device->name(), "(");
+    for (const string& underlying_device : *device->underlying_devices()) {
+      absl::StrAppend(&key, underlying_device, ",");
+    }
+    absl::StrAppend(&key, ")");
+  }
+  absl::StrAppend(&key, "|cpu=", cpu_device ? cpu_device->name() : "",
+                  "|default=", default_device ? default_device->name() : "");
+
+  const Fprint128 fingerprint = Fingerprint128(key);
+  return std::optional<std::string>(absl::StrCat(
+      absl::Hex(fingerprint.high64, absl::kZeroPad16),
+      absl::Hex(fingerprint.low64, absl::kZeroPad16)));
+}
+
+std::optional<OptimizedFunctionGraphInfo> OptimizedFunctionGraphCache::Lookup(
+    const std::string& key) {
+  OptimizedFunctionGraph proto;
+  bool found = false;
+  {
+    mutex_lock l(mu_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      proto = it->second;
+      found = true;
+    }
+  }
+  if (!found && !cache_dir_.empty()) {
+    const std::string path = FilePath(key);
+    if (env_->FileExists(path).ok()) {
+      Status status = ReadBinaryProto(env_, path, &proto);
+      if (status.ok()) {
+        found = true;
+        mutex_lock l(mu_);
+        InsertLocked(key, proto);
+      } else {
+        LOG(WARNING) << "Failed to read the optimized function graph " << path
+                     << ": " << status;
+      }
+    }
+  }
+  if (!found) return std::nullopt;
+
+  StatusOr<OptimizedFunctionGraphInfo> info =
+      OptimizedFunctionGraphInfo::FromProto(proto);
+  if (!info.ok()) {
+    LOG(WARNING) << "Failed to restore the cached optimized function graph "
+                 << proto.name() << ": " << info.status();
+    return std::nullopt;
+  }
+  VLOG(2) << "Found the optimized function graph of " << proto.name()
+          << " in the cache";
+  return std::move(info).value();
+}
+
+void OptimizedFunctionGraphCache::Insert(
+    const std::string& key, const OptimizedFunctionGraphInfo& info) {
+  OptimizedFunctionGraph proto = OptimizedFunctionGraphInfo::ToProto(info);
+  if (!cache_dir_.empty()) {
+    // Writes to a temporary file first, so that the readers of other
+    // processes never see a partially written entry.
+    const std::string path = FilePath(key);
+    std::string tmp_path = path;
+    Status status = errors::Internal("Failed to create a temporary file name");
+    if (env_->CreateUniqueFileName(&tmp_path, ".tmp")) {
+      status = WriteBinaryProto(env_, tmp_path, proto);
+      if (status.ok()) status = env_->RenameFile(tmp_path, path);
+    }
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to write the optimized function graph " << path
+                   << ": " << status;
+    }
+  }
+  mutex_lock l(mu_);
+  InsertLocked(key, std::move(proto));
+}
+
+void OptimizedFunctionGraphCache::InsertLocked(const std::string& key,
+                                               OptimizedFunctionGraph proto) {
+  if (capacity_ <= 0 || entries_.contains(key)) return;
+  if (static_cast<int64_t>(entries_.size()) >= capacity_) {
+    entries_.erase(insertion_order_.front());
+    insertion_order_.pop_front();
+  }
+  insertion_order_.push_back(key);
+  entries_.emplace(key, std::move(proto));
+}
+
+int64_t OptimizedFunctionGraphCache::size() const {
+  mutex_lock l(mu_);
+  return entries_.size();
+}
+
+std::string OptimizedFunctionGraphCache::FilePath(
+    const std::string& key) const {
+  return io::JoinPath(cache_dir_, absl::StrCat(key, ".pb"));
+}
+
+}  // namespace tensorflow
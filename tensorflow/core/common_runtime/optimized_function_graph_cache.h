@@ -0,0 +1,102 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_OPTIMIZED_FUNCTION_GRAPH_CACHE_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_OPTIMIZED_FUNCTION_GRAPH_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/common_runtime/composite_device.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/common_runtime/optimized_function_graph_info.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/optimized_function_graph.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// A process-wide cache of the results of OptimizeFunctionGraph(), so that the
+// instantiations of the same function by different
+// ProcessFunctionLibraryRuntimes, e.g. by the sessions of a model or by the
+// iterators of a tf.data pipeline, optimize it only once.
+//
+// The entries are keyed by a fingerprint of the function, of the functions it
+// reaches, and of everything OptimizeFunctionGraph() depends on, and are held
+// as OptimizedFunctionGraph protos. When a cache directory is set, the entries
+// are also written to it, and the entries missing from memory are read from
+// it, which makes the cache survive the process.
+class OptimizedFunctionGraphCache {
+ public:
+  // `capacity` is the maximum number of entries held in memory, the oldest
+  // entries are evicted beyond it. `cache_dir` is the directory the entries
+  // are persisted to, no persistence happens if it's empty.
+  OptimizedFunctionGraphCache(int64_t capacity, std::string cache_dir,
+                              Env* env = Env::Default());
+
+  // Returns the process-wide cache, or nullptr if it is disabled. It holds
+  // TF_OPTIMIZED_FUNCTION_GRAPH_CACHE_SIZE entries, 0 by default which
+  // disables it, and is persisted to TF_OPTIMIZED_FUNCTION_GRAPH_CACHE_DIR.
+  static OptimizedFunctionGraphCache* Global();
+
+  // Returns the key of the result of OptimizeFunctionGraph() with the same
+  // arguments, or nullopt if the result can't be cached, e.g. because the
+  // options collect the intermediate graphs.
+  static StatusOr<std::optional<std::string>> Key(
+      const string& function_name, AttrSlice attrs,
+      const FunctionLibraryRuntime::InstantiateOptions& options,
+      const DeviceSet& dev_set, const FunctionLibraryDefinition* input_lib_def,
+      const std::vector<CompositeDevice*>& composite_devices,
+      Device* cpu_device, Device* default_device);
+
+  // Returns the optimized function graph cached for `key`, or nullopt if there
+  // is none.
+  std::optional<OptimizedFunctionGraphInfo> Lookup(const std::string& key);
+
+  // Caches `info` for `key`.
+  void Insert(const std::string& key, const OptimizedFunctionGraphInfo& info);
+
+  // Returns the number of entries held in memory.
+  int64_t size() const;
+
+ private:
+  std::string FilePath(const std::string& key) const;
+
+  // Inserts `proto` into the in-memory cache, evicting the oldest entry if it
+  // is full.
+  void InsertLocked(const std::string& key, OptimizedFunctionGraph proto)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64_t capacity_;
+  const std::string cache_dir_;
+  Env* const env_;
+
+  mutable mutex mu_;
+  absl::flat_hash_map<std::string, OptimizedFunctionGraph> entries_
+      TF_GUARDED_BY(mu_);
+  // The keys of `entries_`, from the oldest to the newest.
+  std::list<std::string> insertion_order_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_OPTIMIZED_FUNCTION_GRAPH_CACHE_H_
@@ -0,0 +1,146 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/optimized_function_graph_cache.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+
+namespace tensorflow {
+namespace {
+
+FunctionDefLibrary TestLibrary() {
+  FunctionDefLibrary proto;
+  *proto.add_function() = test::function::XTimesTwo();
+  *proto.add_function() = test::function::XTimesFour();
+  return proto;
+}
+
+StatusOr<std::optional<std::string>> Key(
+    const string& function_name, const FunctionLibraryDefinition& lib_def,
+    DataType dtype,
+    const FunctionLibraryRuntime::InstantiateOptions& options = {}) {
+  DeviceSet dev_set;
+  return OptimizedFunctionGraphCache::Key(
+      function_name, test::function::Attrs({{"T", dtype}}), options, dev_set,
+      &lib_def, /*composite_devices=*/{}, /*cpu_device=*/nullptr,
+      /*default_device=*/nullptr);
+}
+
+OptimizedFunctionGraphInfo TestGraphInfo(const string& name) {
+  return OptimizedFunctionGraphInfo{
+      name,
+      std::make_unique<Graph>(OpRegistry::Global()),
+      FunctionLibraryDefinition(OpRegistry::Global(), TestLibrary()),
+      /*node_name_to_control_ret=*/{},
+      /*ret_types=*/{DT_FLOAT},
+      /*num_return_nodes=*/1};
+}
+
+TEST(OptimizedFunctionGraphCacheTest, KeyDependsOnFunctionAndAttrs) {
+  FunctionLibraryDefinition lib_def(OpRegistry::Global(), TestLibrary());
+  TF_ASSERT_OK_AND_ASSIGN(std::optional<std::string> key,
+                          Key("XTimesTwo", lib_def, DT_FLOAT));
+  ASSERT_TRUE(key.has_value());
+
+  // The key doesn't depend on the address of the library.
+  FunctionLibraryDefinition same_lib_def(OpRegistry::Global(), TestLibrary());
+  TF_ASSERT_OK_AND_ASSIGN(std::optional<std::string> same_key,
+                          Key("XTimesTwo", same_lib_def, DT_FLOAT));
+  EXPECT_EQ(key, same_key);
+
+  TF_ASSERT_OK_AND_ASSIGN(std::optional<std::string> other_attrs_key,
+                          Key("XTimesTwo", lib_def, DT_DOUBLE));
+  EXPECT_NE(key, other_attrs_key);
+  TF_ASSERT_OK_AND_ASSIGN(std::optional<std::string> other_function_key,
+                          Key("XTimesFour", lib_def, DT_FLOAT));
+  EXPECT_NE(key, other_function_key);
+
+  // Nor does it match a function of the same name with another body.
+  FunctionDefLibrary modified_library = TestLibrary();
+  (*modified_library.mutable_function(0)->mutable_attr())["_noinline"].set_b(
+      true);
+  FunctionLibraryDefinition modified_lib_def(OpRegistry::Global(),
+                                             modified_library);
+  TF_ASSERT_OK_AND_ASSIGN(std::optional<std::string> modified_key,
+                          Key("XTimesTwo", modified_lib_def, DT_FLOAT));
+  EXPECT_NE(key, modified_key);
+}
+
+TEST(OptimizedFunctionGraphCacheTest, NoKeyWhenCollectingGraphs) {
+  FunctionLibraryDefinition lib_def(OpRegistry::Global(), TestLibrary());
+  GraphCollector collector;
+  FunctionLibraryRuntime::InstantiateOptions options;
+  options.graph_collector = &collector;
+  TF_ASSERT_OK_AND_ASSIGN(std::optional<std::string> key,
+                          Key("XTimesTwo", lib_def, DT_FLOAT, options));
+  EXPECT_FALSE(key.has_value());
+
+  TF_ASSERT_OK_AND_ASSIGN(key, Key("Missing", lib_def, DT_FLOAT));
+  EXPECT_FALSE(key.has_value());
+}
+
+TEST(OptimizedFunctionGraphCacheTest, LookupReturnsInsertedGraph) {
+  OptimizedFunctionGraphCache cache(/*capacity=*/2, /*cache_dir=*/"");
+  EXPECT_FALSE(cache.Lookup("a").has_value());
+
+  cache.Insert("a", TestGraphInfo("a"));
+  std::optional<OptimizedFunctionGraphInfo> info = cache.Lookup("a");
+  ASSERT_TRUE(info.has_value());
+  EXPECT_EQ(info->name, "a");
+  EXPECT_EQ(info->ret_types, DataTypeVector({DT_FLOAT}));
+  EXPECT_EQ(info->num_return_nodes, 1u);
+  EXPECT_NE(info->lib_def.Find("XTimesTwo"), nullptr);
+}
+
+TEST(OptimizedFunctionGraphCacheTest, EvictsOldestEntries) {
+  OptimizedFunctionGraphCache cache(/*capacity=*/2, /*cache_dir=*/"");
+  cache.Insert("a", TestGraphInfo("a"));
+  cache.Insert("b", TestGraphInfo("b"));
+  cache.Insert("c", TestGraphInfo("c"));
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_FALSE(cache.Lookup("a").has_value());
+  EXPECT_TRUE(cache.Lookup("b").has_value());
+  EXPECT_TRUE(cache.Lookup("c").has_value());
+}
+
+TEST(OptimizedFunctionGraphCacheTest, PersistsEntriesToCacheDir) {
+  const std::string cache_dir =
+      io::JoinPath(testing::TmpDir(), "optimized_function_graph_cache");
+  {
+    OptimizedFunctionGraphCache cache(/*capacity=*/2, cache_dir);
+    cache.Insert("a", TestGraphInfo("a"));
+  }
+
+  // A new cache, e.g. of another process, reads the entry back.
+  OptimizedFunctionGraphCache cache(/*capacity=*/2, cache_dir);
+  EXPECT_EQ(cache.size(), 0);
+  std::optional<OptimizedFunctionGraphInfo> info = cache.Lookup("a");
+  ASSERT_TRUE(info.has_value());
+  EXPECT_EQ(info->name, "a");
+  EXPECT_EQ(cache.size(), 1);
+}
+
+}  // namespace
+}  // namespace tensorflow
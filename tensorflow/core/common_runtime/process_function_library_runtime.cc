@@ -18,6 +18,7 @@ limitations under the License.
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -31,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/function_optimization_registry.h"
 #include "tensorflow/core/common_runtime/optimization_registry.h"
 #include "tensorflow/core/common_runtime/optimize_function_graph_utils.h"
+#include "tensorflow/core/common_runtime/optimized_function_graph_cache.h"
 #include "tensorflow/core/common_runtime/partitioning_utils.h"
 #include "tensorflow/core/common_runtime/placer.h"
 #include "tensorflow/core/common_runtime/rendezvous_util.h"
@@ -412,6 +414,36 @@ Status FunctionRetsToTensors(const std::vector<FunctionRet>* function_rets,
   }
   return OkStatus();
 }
+
+// Like OptimizeFunctionGraph(), but returns the optimized function graph cached
+// in the process-wide OptimizedFunctionGraphCache if there is one, e.g. because
+// another runtime of the process has instantiated the same function before.
+StatusOr<OptimizedFunctionGraphInfo> OptimizeFunctionGraphOrReadFromCache(
+    const string& function_name, AttrSlice attrs,
+    const FunctionLibraryRuntime::InstantiateOptions& options,
+    const DeviceSet& dev_set, const FunctionLibraryDefinition* input_lib_def,
+    const std::vector<CompositeDevice*>& composite_devices, Device* cpu_device,
+    Device* default_device, Env* env) {
+  OptimizedFunctionGraphCache* cache = OptimizedFunctionGraphCache::Global();
+  std::optional<std::string> key;
+  if (cache != nullptr) {
+    TF_ASSIGN_OR_RETURN(
+        key, OptimizedFunctionGraphCache::Key(
+                 function_name, attrs, options, dev_set, input_lib_def,
+                 composite_devices, cpu_device, default_device));
+  }
+  if (key) {
+    std::optional<OptimizedFunctionGraphInfo> cached = cache->Lookup(*key);
+    if (cached) return std::move(*cached);
+  }
+  TF_ASSIGN_OR_RETURN(
+      auto optimized_graph_info,
+      OptimizeFunctionGraph(function_name, attrs, options, dev_set,
+                            input_lib_def, composite_devices, cpu_device,
+                            default_device, env));
+  if (key) cache->Insert(*key, optimized_graph_info);
+  return optimized_graph_info;
+}
 }  // namespace
 
 ProcessFunctionLibraryRuntime::AsyncAttributes::Summary
@@ -557,10 +589,11 @@ Status ProcessFunctionLibraryRuntime::InstantiateMultiDevice(
   TF_RETURN_IF_ERROR(device_mgr_->LookupDevice("CPU:0", &cpu_device));
 
   const uint64 optimization_start_time_usecs = Env::Default()->NowMicros();
-  TF_ASSIGN_OR_RETURN(auto optimized_graph_info,
-                      OptimizeFunctionGraph(
-                          function_name, attrs, options, *dev_set, lib_def_,
-                          composite_devices, cpu_device, default_device, env_));
+  TF_ASSIGN_OR_RETURN(
+      auto optimized_graph_info,
+      OptimizeFunctionGraphOrReadFromCache(
+          function_name, attrs, options, *dev_set, lib_def_, composite_devices,
+          cpu_device, default_device, env_));
 
   auto& graph = optimized_graph_info.function_graph;
   graph->mutable_flib_def()->set_default_registry(
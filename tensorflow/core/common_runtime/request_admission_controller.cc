@@ -0,0 +1,207 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/request_admission_controller.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+RequestAdmissionController::RequestAdmissionController(Env* env,
+                                                       const Options& options)
+    : env_(env), options_(options) {}
+
+void RequestAdmissionController::SetBudget(absl::string_view tenant,
+                                           const Budget& budget) {
+  absl::MutexLock lock(&mu_);
+  budgets_[tenant] = budget;
+  credited_.SignalAll();
+}
+
+absl::Duration RequestAdmissionController::PredictCost(
+    absl::string_view model, absl::string_view signature,
+    int64_t input_bytes) const {
+  absl::MutexLock lock(&mu_);
+  auto it = cost_models_.find(
+      std::make_pair(std::string(model), std::string(signature)));
+  if (it == cost_models_.end()) return absl::ZeroDuration();
+  return Predict(it->second, input_bytes);
+}
+
+Status RequestAdmissionController::Admit(absl::string_view tenant,
+                                         absl::string_view model,
+                                         absl::string_view signature,
+                                         int64_t input_bytes,
+                                         absl::Duration* predicted_cost) {
+  absl::MutexLock lock(&mu_);
+  auto it = cost_models_.find(
+      std::make_pair(std::string(model), std::string(signature)));
+  const absl::Duration cost = it == cost_models_.end()
+                                  ? absl::ZeroDuration()
+                                  : Predict(it->second, input_bytes);
+  *predicted_cost = cost;
+  const Budget& budget = BudgetOf(tenant);
+  if (budget.cost_per_second == absl::InfiniteDuration() ||
+      cost <= absl::ZeroDuration()) {
+    return OkStatus();
+  }
+
+  TokenBucket& bucket = buckets_[tenant];
+  Refill(budget, bucket);
+  const double cost_nanos = absl::ToDoubleNanoseconds(cost);
+  bucket.tokens -= cost_nanos;
+  if (bucket.tokens >= 0) return OkStatus();
+
+  // The request waits for the budget to pay off the deficit it leaves.
+  const double rate = absl::ToDoubleSeconds(budget.cost_per_second);
+  const absl::Duration wait = rate > 0
+                                  ? absl::Nanoseconds(-bucket.tokens / rate)
+                                  : absl::InfiniteDuration();
+  if (wait > options_.max_defer) {
+    bucket.tokens += cost_nanos;
+    return errors::ResourceExhausted(
+        "Request to signature ", signature, " of model ", model,
+        " with a predicted cost of ", absl::FormatDuration(cost),
+        " exceeds the budget of tenant ", tenant);
+  }
+  VLOG(2) << "Deferring a request of tenant " << tenant << " by up to "
+          << wait;
+
+  // The request is admitted as soon as the deficit is paid off, which the
+  // releases of the tenant may do before the predicted wait is over. The
+  // bucket and the budget are looked up again after each wait, since the maps
+  // may have changed in the meantime.
+  const double credited_target = bucket.credited - bucket.tokens;
+  const uint64_t deadline_micros =
+      env_->NowMicros() + absl::ToInt64Microseconds(wait);
+  while (true) {
+    const Budget& current_budget = BudgetOf(tenant);
+    if (current_budget.cost_per_second == absl::InfiniteDuration()) {
+      return OkStatus();
+    }
+    TokenBucket& current_bucket = buckets_[tenant];
+    Refill(current_budget, current_bucket);
+    if (current_bucket.credited >= credited_target) return OkStatus();
+    const uint64_t now_micros = env_->NowMicros();
+    // Admitted once the predicted wait is over, even if the requests of the
+    // tenant since cost more than predicted.
+    if (now_micros >= deadline_micros) return OkStatus();
+    credited_.WaitWithTimeout(
+        &mu_, absl::Microseconds(deadline_micros - now_micros));
+  }
+}
+
+void RequestAdmissionController::RecordCost(absl::string_view tenant,
+                                            absl::string_view model,
+                                            absl::string_view signature,
+                                            int64_t input_bytes,
+                                            absl::Duration predicted_cost,
+                                            absl::Duration cost) {
+  absl::MutexLock lock(&mu_);
+  CostModel& cost_model = cost_models_[std::make_pair(std::string(model),
+                                                      std::string(signature))];
+  const double bytes = static_cast<double>(input_bytes);
+  const double cost_nanos = absl::ToDoubleNanoseconds(cost);
+  const double decay = cost_model.empty ? 1.0 : options_.cost_model_decay;
+  auto update = [decay](double& mean, double value) {
+    mean += decay * (value - mean);
+  };
+  update(cost_model.mean_bytes, bytes);
+  update(cost_model.mean_cost, cost_nanos);
+  update(cost_model.mean_bytes_squared, bytes * bytes);
+  update(cost_model.mean_bytes_cost, bytes * cost_nanos);
+  cost_model.empty = false;
+
+  const Budget& budget = BudgetOf(tenant);
+  if (budget.cost_per_second == absl::InfiniteDuration()) return;
+  TokenBucket& bucket = buckets_[tenant];
+  Refill(budget, bucket);
+  const double tokens = std::min(
+      bucket.tokens - absl::ToDoubleNanoseconds(cost - predicted_cost),
+      absl::ToDoubleNanoseconds(budget.burst));
+  bucket.credited += tokens - bucket.tokens;
+  if (tokens > bucket.tokens) credited_.SignalAll();
+  bucket.tokens = tokens;
+}
+
+void RequestAdmissionController::RecordCost(absl::string_view tenant,
+                                            absl::string_view model,
+                                            absl::string_view signature,
+                                            int64_t input_bytes,
+                                            absl::Duration predicted_cost,
+                                            const RequestCost& request_cost) {
+  absl::Duration cost;
+  for (const auto& entry : request_cost.GetCosts()) cost += entry.second;
+  RecordCost(tenant, model, signature, input_bytes, predicted_cost, cost);
+}
+
+/*static*/ absl::Duration RequestAdmissionController::Predict(
+    const CostModel& model, int64_t input_bytes) {
+  if (model.empty) return absl::ZeroDuration();
+  const double bytes = static_cast<double>(input_bytes);
+  const double variance =
+      model.mean_bytes_squared - model.mean_bytes * model.mean_bytes;
+  double slope = 0;
+  double intercept = model.mean_cost;
+  if (variance > 1e-6 * std::max(1.0, model.mean_bytes * model.mean_bytes)) {
+    const double covariance =
+        model.mean_bytes_cost - model.mean_bytes * model.mean_cost;
+    slope = std::max(0.0, covariance / variance);
+    intercept = std::max(0.0, model.mean_cost - slope * model.mean_bytes);
+  } else if (model.mean_bytes > 0) {
+    // All the requests had the same size, which gives no fixed cost.
+    slope = model.mean_cost / model.mean_bytes;
+    intercept = 0;
+  }
+  return absl::Nanoseconds(intercept + slope * bytes);
+}
+
+void RequestAdmissionController::Refill(const Budget& budget,
+                                        TokenBucket& bucket) {
+  const uint64_t now_micros = env_->NowMicros();
+  const double burst_nanos = absl::ToDoubleNanoseconds(budget.burst);
+  if (!bucket.initialized) {
+    bucket.tokens = burst_nanos;
+    bucket.last_refill_micros = now_micros;
+    bucket.initialized = true;
+    return;
+  }
+  if (now_micros <= bucket.last_refill_micros) return;
+  const double elapsed_nanos =
+      (now_micros - bucket.last_refill_micros) * 1000.0;
+  const double tokens =
+      std::min(burst_nanos, bucket.tokens +
+                                elapsed_nanos *
+                                    absl::ToDoubleSeconds(
+                                        budget.cost_per_second));
+  bucket.credited += tokens - bucket.tokens;
+  bucket.tokens = tokens;
+  bucket.last_refill_micros = now_micros;
+}
+
+const RequestAdmissionController::Budget& RequestAdmissionController::BudgetOf(
+    absl::string_view tenant) const {
+  auto it = budgets_.find(tenant);
+  return it == budgets_.end() ? options_.default_budget : it->second;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,143 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_REQUEST_ADMISSION_CONTROLLER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_REQUEST_ADMISSION_CONTROLLER_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "tensorflow/core/common_runtime/request_cost.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+
+// RequestAdmissionController admits requests to a model by their predicted
+// cost, so that a tenant sending more work than its budget gets its requests
+// deferred or rejected, instead of overloading the server for everybody.
+//
+// The cost of a request to a signature of a model is predicted from the size
+// of its inputs by a linear model fitted to the costs recorded for the
+// earlier requests to the signature. Each tenant spends its predicted costs
+// from a token bucket refilled at its budget, and is charged the difference
+// with the actual cost once the request is done.
+//
+// It's thread-safe.
+class RequestAdmissionController {
+ public:
+  struct Budget {
+    // The cost a tenant may spend per second.
+    absl::Duration cost_per_second = absl::InfiniteDuration();
+    // The cost a tenant may spend at once after being idle.
+    absl::Duration burst = absl::Seconds(1);
+  };
+
+  struct Options {
+    // The budget of the tenants without a budget of their own.
+    Budget default_budget;
+    // How long a request over the budget of its tenant waits for the budget to
+    // refill, instead of being rejected.
+    absl::Duration max_defer = absl::ZeroDuration();
+    // The weight of the latest request in the moving averages of the cost
+    // models, in (0, 1].
+    double cost_model_decay = 0.1;
+  };
+
+  RequestAdmissionController(Env* env, const Options& options);
+
+  // Sets the budget of `tenant`.
+  void SetBudget(absl::string_view tenant, const Budget& budget);
+
+  // Returns the predicted cost of a request of `input_bytes` to `signature`
+  // of `model`, or zero while no cost is recorded for the signature.
+  absl::Duration PredictCost(absl::string_view model,
+                             absl::string_view signature,
+                             int64_t input_bytes) const;
+
+  // Admits a request of `tenant`, waiting up to `max_defer` for its budget,
+  // and sets `predicted_cost` to the cost it is charged. Returns
+  // ResourceExhausted right away if the budget would not refill in time. A
+  // deferred request is admitted early when the requests of its tenant turn
+  // out cheaper than predicted, or when its tenant gets a new budget.
+  Status Admit(absl::string_view tenant, absl::string_view model,
+               absl::string_view signature, int64_t input_bytes,
+               absl::Duration* predicted_cost);
+
+  // Records the actual `cost` of a request admitted with `predicted_cost`,
+  // to charge its tenant the difference and update the cost model.
+  void RecordCost(absl::string_view tenant, absl::string_view model,
+                  absl::string_view signature, int64_t input_bytes,
+                  absl::Duration predicted_cost, absl::Duration cost);
+
+  // Same as above, with the sum of the costs of `request_cost`.
+  void RecordCost(absl::string_view tenant, absl::string_view model,
+                  absl::string_view signature, int64_t input_bytes,
+                  absl::Duration predicted_cost,
+                  const RequestCost& request_cost);
+
+ private:
+  // Moving averages of the input size and cost of the requests to a
+  // signature, fitting their cost as a linear function of their input size.
+  struct CostModel {
+    double mean_bytes = 0;
+    double mean_cost = 0;
+    double mean_bytes_squared = 0;
+    double mean_bytes_cost = 0;
+    bool empty = true;
+  };
+
+  struct TokenBucket {
+    // In nanoseconds of cost, negative while deferred requests wait.
+    double tokens = 0;
+    // The total of the tokens ever added, by refills and by requests costing
+    // less than predicted. A deferred request waits for it to pay off the
+    // deficit the request left.
+    double credited = 0;
+    uint64_t last_refill_micros = 0;
+    bool initialized = false;
+  };
+
+  // Returns the cost of a request of `input_bytes` predicted by `model`.
+  static absl::Duration Predict(const CostModel& model, int64_t input_bytes);
+
+  // Adds the tokens earned since the last refill of `bucket`.
+  void Refill(const Budget& budget, TokenBucket& bucket)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  const Budget& BudgetOf(absl::string_view tenant) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Env* const env_;  // Not owned.
+  const Options options_;
+
+  mutable absl::Mutex mu_;
+  // Cost models by model and signature.
+  absl::flat_hash_map<std::pair<std::string, std::string>, CostModel>
+      cost_models_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, Budget> budgets_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, TokenBucket> buckets_ ABSL_GUARDED_BY(mu_);
+  // Signaled when tokens are given back or budgets change, which may admit
+  // deferred requests before their predicted wait is over.
+  absl::CondVar credited_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_REQUEST_ADMISSION_CONTROLLER_H_
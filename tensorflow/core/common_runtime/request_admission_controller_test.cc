@@ -0,0 +1,160 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/request_admission_controller.h"
+
+#include "absl/time/time.h"
+#include <memory>
+
+#include "tensorflow/core/common_runtime/request_cost.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/fake_clock_env.h"
+
+namespace tensorflow {
+namespace {
+
+using Budget = RequestAdmissionController::Budget;
+using Options = RequestAdmissionController::Options;
+
+TEST(RequestAdmissionControllerTest, PredictsCostFromInputSize) {
+  RequestAdmissionController controller(Env::Default(), Options());
+  EXPECT_EQ(controller.PredictCost("model", "serve", 100),
+            absl::ZeroDuration());
+
+  // Requests cost 1ms plus 1us per byte.
+  for (int bytes : {100, 200, 300, 400}) {
+    controller.RecordCost("tenant", "model", "serve", bytes,
+                          absl::ZeroDuration(),
+                          absl::Milliseconds(1) + absl::Microseconds(bytes));
+  }
+  EXPECT_LT(absl::AbsDuration(controller.PredictCost("model", "serve", 1000) -
+                              absl::Microseconds(2000)),
+            absl::Microseconds(100));
+  EXPECT_EQ(controller.PredictCost("model", "other", 1000),
+            absl::ZeroDuration());
+}
+
+TEST(RequestAdmissionControllerTest, ScalesCostOfEqualSizes) {
+  RequestAdmissionController controller(Env::Default(), Options());
+  RequestCost request_cost;
+  request_cost.RecordCost({{"cpu", absl::Milliseconds(3)},
+                           {"tpu", absl::Milliseconds(1)}});
+  controller.RecordCost("tenant", "model", "serve", 10, absl::ZeroDuration(),
+                        request_cost);
+  EXPECT_EQ(controller.PredictCost("model", "serve", 10),
+            absl::Milliseconds(4));
+  EXPECT_EQ(controller.PredictCost("model", "serve", 20),
+            absl::Milliseconds(8));
+}
+
+TEST(RequestAdmissionControllerTest, RejectsRequestsOverBudget) {
+  FakeClockEnv env(Env::Default());
+  Options options;
+  options.default_budget.cost_per_second = absl::Milliseconds(100);
+  options.default_budget.burst = absl::Milliseconds(20);
+  RequestAdmissionController controller(&env, options);
+  controller.RecordCost("a", "model", "serve", 1, absl::ZeroDuration(),
+                        absl::Milliseconds(10));
+
+  // The recorded request spent half of the burst, which leaves room for one
+  // more.
+  absl::Duration cost;
+  TF_EXPECT_OK(controller.Admit("a", "model", "serve", 1, &cost));
+  EXPECT_EQ(cost, absl::Milliseconds(10));
+  Status status = controller.Admit("a", "model", "serve", 1, &cost);
+  EXPECT_TRUE(errors::IsResourceExhausted(status)) << status;
+
+  // Other tenants have budgets of their own.
+  TF_EXPECT_OK(controller.Admit("b", "model", "serve", 1, &cost));
+
+  // 100ms later, the budget has refilled by 10ms.
+  env.AdvanceByMicroseconds(100000);
+  TF_EXPECT_OK(controller.Admit("a", "model", "serve", 1, &cost));
+  EXPECT_FALSE(controller.Admit("a", "model", "serve", 1, &cost).ok());
+}
+
+TEST(RequestAdmissionControllerTest, ChargesActualCost) {
+  FakeClockEnv env(Env::Default());
+  RequestAdmissionController controller(&env, Options());
+  controller.SetBudget("a", Budget{absl::Milliseconds(100),
+                                   absl::Milliseconds(20)});
+  controller.RecordCost("a", "model", "serve", 1, absl::ZeroDuration(),
+                        absl::Milliseconds(10));
+
+  absl::Duration cost;
+  TF_ASSERT_OK(controller.Admit("a", "model", "serve", 1, &cost));
+  // The request turned out to cost 20ms, which overdraws the budget.
+  controller.RecordCost("a", "model", "serve", 1, cost,
+                        absl::Milliseconds(20));
+  EXPECT_FALSE(controller.Admit("a", "model", "serve", 1, &cost).ok());
+
+  // Tenants without a budget of their own have no limit by default.
+  for (int i = 0; i < 10; ++i) {
+    TF_EXPECT_OK(controller.Admit("b", "model", "serve", 1, &cost));
+  }
+}
+
+TEST(RequestAdmissionControllerTest, DefersRequestsWithinMaxDefer) {
+  Options options;
+  options.default_budget.cost_per_second = absl::Seconds(1);
+  options.default_budget.burst = absl::Milliseconds(1);
+  options.max_defer = absl::Milliseconds(100);
+  RequestAdmissionController controller(Env::Default(), options);
+  controller.RecordCost("a", "model", "serve", 1, absl::ZeroDuration(),
+                        absl::Milliseconds(1));
+
+  // The recorded request spent the burst, so the next one waits about 1ms
+  // for the budget to refill.
+  absl::Duration cost;
+  const absl::Time start = absl::Now();
+  TF_EXPECT_OK(controller.Admit("a", "model", "serve", 1, &cost));
+  EXPECT_GE(absl::Now() - start, absl::Microseconds(500));
+}
+
+TEST(RequestAdmissionControllerTest, AdmitsDeferredRequestsOnRelease) {
+  FakeClockEnv env(Env::Default());
+  Options options;
+  options.default_budget.cost_per_second = absl::Milliseconds(1);
+  options.default_budget.burst = absl::Milliseconds(20);
+  options.max_defer = absl::Hours(1);
+  RequestAdmissionController controller(&env, options);
+  controller.RecordCost("a", "model", "serve", 1, absl::ZeroDuration(),
+                        absl::Milliseconds(10));
+  absl::Duration cost;
+  TF_ASSERT_OK(controller.Admit("a", "model", "serve", 1, &cost));
+
+  // The next request waits 10s of the clock, which does not advance.
+  Notification admitted;
+  std::unique_ptr<Thread> thread(Env::Default()->StartThread(
+      ThreadOptions(), "deferred", [&controller, &admitted] {
+        absl::Duration deferred_cost;
+        TF_EXPECT_OK(
+            controller.Admit("a", "model", "serve", 1, &deferred_cost));
+        admitted.Notify();
+      }));
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  EXPECT_FALSE(admitted.HasBeenNotified());
+
+  // The admitted request turns out to be free, which pays off the deficit.
+  controller.RecordCost("a", "model", "serve", 1, cost, absl::ZeroDuration());
+  EXPECT_TRUE(WaitForNotificationWithTimeout(&admitted, 10 * 1000 * 1000));
+}
+
+}  // namespace
+}  // namespace tensorflow
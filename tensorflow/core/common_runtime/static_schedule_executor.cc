@@ -0,0 +1,685 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_schedule_executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/common_runtime/entry.h"
+#include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
+#include "tensorflow/core/common_runtime/renamed_device.h"
+#include "tensorflow/core/common_runtime/single_threaded_executor.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace {
+
+typedef gtl::InlinedVector<TensorValue, 4> TensorValueVec;
+typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
+
+static const string& kStaticScheduleExecutor =
+    *new string("STATIC_SCHEDULE_EXECUTOR");
+
+class StaticScheduleExecutorImpl : public Executor {
+ public:
+  StaticScheduleExecutorImpl(const LocalExecutorParams& params,
+                             const StaticScheduleExecutorOptions& options)
+      : params_(params), options_(options) {}
+
+  ~StaticScheduleExecutorImpl() override {
+    for (const KernelState& kernel_state : kernels_) {
+      params_.delete_kernel(kernel_state.kernel);
+    }
+  }
+
+  Status Initialize(const Graph& graph) {
+    if (options_.num_warmup_steps <= 0) {
+      return errors::InvalidArgument(
+          "Static schedule executor requires at least one warm-up step, got ",
+          options_.num_warmup_steps);
+    }
+
+    // Topologicially sort `graph` to get a sequence of OpKernels.
+    std::vector<Node*> ordered_nodes;
+    ordered_nodes.reserve(graph.num_nodes());
+    GetReversePostOrder(graph, &ordered_nodes);
+    int ordered_nodes_size = ordered_nodes.size();
+    if (ordered_nodes_size != graph.num_nodes()) {
+      return errors::InvalidArgument("Graph had ", graph.num_nodes(),
+                                     " but reverse post-order had ",
+                                     ordered_nodes.size());
+    }
+
+    // We reserve two less nodes because we do not need to create kernels for
+    // the _SOURCE and _SINK nodes.
+    kernels_.reserve(ordered_nodes.size() - 2);
+    std::vector<Node*> nodes_with_kernels;
+    nodes_with_kernels.reserve(ordered_nodes.size() - 2);
+    absl::flat_hash_map<const Node*, int> node_to_index_map;
+
+    // Create the kernel and input-related structures for each node in `graph`.
+    // Unlike the single-threaded executor, arguments and constants are not
+    // specialized, so that every node is a kernel of the schedule.
+    for (Node* n : ordered_nodes) {
+      if (n->IsSource() || n->IsSink()) {
+        continue;
+      }
+      TF_RETURN_IF_ERROR(ValidateOpIsSafeForSyncExecution(
+          *n, /*allow_control_flow_sync_execution=*/false));
+
+      OpKernel* kernel;
+      TF_RETURN_IF_ERROR(params_.create_kernel(n->properties(), &kernel));
+      const int kernel_index = kernels_.size();
+      kernels_.push_back({});
+      nodes_with_kernels.push_back(n);
+      KernelState& kernel_state = kernels_[kernel_index];
+      kernel_state.kernel = kernel;
+      kernel_state.num_inputs = n->num_inputs();
+      kernel_state.num_outputs = n->num_outputs();
+      node_to_index_map[n] = kernel_index;
+      if (kernel_index == 0) {
+        kernel_state.input_start_index = 0;
+      } else {
+        const KernelState& previous_kernel_state = kernels_[kernel_index - 1];
+        kernel_state.input_start_index =
+            previous_kernel_state.input_start_index +
+            previous_kernel_state.num_inputs;
+      }
+    }
+
+    for (size_t i = 0; i < kernels_.size(); ++i) {
+      Node* n = nodes_with_kernels[i];
+      KernelState& kernel_state = kernels_[i];
+
+      // Build the mapping from each node output to the input slot for the
+      // corresponding destination node.
+      kernel_state.output_locations.resize(kernel_state.num_outputs);
+      for (const Edge* e : n->out_edges()) {
+        if (!e->IsControlEdge()) {
+          kernel_state.output_locations[e->src_output()].push_back(
+              kernels_[node_to_index_map[e->dst()]].input_start_index +
+              e->dst_input());
+        }
+      }
+
+      // Collect the kernels that must run before this one, through data or
+      // control edges.
+      for (const Edge* e : n->in_edges()) {
+        if (!e->src()->IsSource()) {
+          kernel_state.predecessors.push_back(node_to_index_map[e->src()]);
+        }
+      }
+      std::sort(kernel_state.predecessors.begin(),
+                kernel_state.predecessors.end());
+      kernel_state.predecessors.erase(
+          std::unique(kernel_state.predecessors.begin(),
+                      kernel_state.predecessors.end()),
+          kernel_state.predecessors.end());
+
+      // Compute allocator attributes for each node output, and corresponding
+      // node input.
+      kernel_state.output_alloc_attrs.resize(kernel_state.num_outputs);
+      AllocatorAttributes* attrs = kernel_state.output_alloc_attrs.data();
+
+      OpKernel* op_kernel = kernel_state.kernel;
+      for (int out = 0; out < n->num_outputs(); out++) {
+        DCHECK_LT(out, op_kernel->output_memory_types().size());
+        bool on_host = op_kernel->output_memory_types()[out] == HOST_MEMORY;
+        if (on_host) {
+          AllocatorAttributes h;
+          h.set_on_host(on_host);
+          attrs[out].Merge(h);
+        }
+      }
+    }
+
+    if (!kernels_.empty()) {
+      const KernelState& last_kernel_state = kernels_.back();
+      total_num_inputs_ =
+          last_kernel_state.input_start_index + last_kernel_state.num_inputs;
+      input_alloc_attrs_.resize(total_num_inputs_);
+      for (size_t i = 0; i < kernels_.size(); ++i) {
+        for (size_t j = 0; j < kernels_[i].output_locations.size(); ++j) {
+          for (size_t output_location : kernels_[i].output_locations[j]) {
+            input_alloc_attrs_[output_location] =
+                kernels_[i].output_alloc_attrs[j];
+          }
+        }
+      }
+    } else {
+      total_num_inputs_ = 0;
+    }
+
+    mutex_lock l(mu_);
+    total_cost_nsec_.resize(kernels_.size(), 0);
+    return OkStatus();
+  }
+
+  Status Run(const Args& args) override {
+    std::shared_ptr<const Schedule> schedule = GetSchedule();
+    if (schedule == nullptr || args.run_all_kernels_inline) {
+      return RunSequential(args, /*record_costs=*/schedule == nullptr);
+    }
+    return Executor::Run(args);
+  }
+
+  void RunAsync(const Args& args, DoneCallback done) override;
+
+ private:
+  class StepState;
+
+  // Represents cached graph structure state for each kernel.
+  struct KernelState {
+    // The kernel object. Not owned.
+    //
+    // This pointer is managed by `params_.create_kernel()` and
+    // `params_.delete_kernel()`.
+    OpKernel* kernel;
+
+    // These fields determine the range of elements in `inputs` that corresponds
+    // to the inputs of `kernel`.
+    size_t input_start_index;
+    size_t num_inputs;
+
+    size_t num_outputs;
+
+    // For the `j`th output of `kernel`, `output_locations[j]` contains the
+    // locations in the flat `inputs` vector to which that output must be
+    // copied.
+    std::vector<std::vector<size_t>>
+        output_locations;  // Length = `num_outputs`.
+
+    // Memory space information for each output of `kernel`.
+    std::vector<AllocatorAttributes>
+        output_alloc_attrs;  // Length = `num_outputs`.
+
+    // The indices of the kernels that produce an input of `kernel`, or have a
+    // control edge to it. They all precede it in `kernels_`.
+    std::vector<int> predecessors;
+  };
+
+  // A partitioning of the kernels into sequences that are executed
+  // concurrently. Immutable once computed.
+  struct Schedule {
+    // The kernels of each partition, in topological order.
+    std::vector<std::vector<int>> partitions;
+
+    // For each kernel, its partition and its position in that partition.
+    std::vector<int> partition;
+    std::vector<int> position;
+
+    // For each kernel, the number of its predecessors in other partitions.
+    std::vector<int> num_remote_predecessors;
+
+    // For each kernel, its successors in other partitions.
+    std::vector<std::vector<int>> remote_successors;
+  };
+
+  std::shared_ptr<const Schedule> GetSchedule() const TF_LOCKS_EXCLUDED(mu_) {
+    tf_shared_lock l(mu_);
+    return schedule_;
+  }
+
+  // Prepares the parameters that are the same for all kernels of a step. The
+  // caller takes the reference on `params->op_device_context`, if any.
+  void PrepareParams(const Args& args, Device* device, Args::Runner* runner,
+                     OpKernelContext::Params* params) const {
+    params->step_id = args.step_id;
+    params->device = device;
+    params->log_memory = false;
+    params->rendezvous = args.rendezvous;
+    params->session_state = args.session_state;
+    params->session_metadata = params_.session_metadata;
+    params->tensor_store = args.tensor_store;
+    params->cancellation_manager = args.cancellation_manager;
+    params->call_frame = args.call_frame;
+    params->function_library = params_.function_library;
+    params->resource_manager = device->resource_manager();
+    params->step_container = args.step_container;
+    params->collective_executor = args.collective_executor;
+    params->stack_trace = args.stack_trace;
+    params->slice_reader_cache = nullptr;
+    params->runner = runner;
+    params->run_all_kernels_inline = args.run_all_kernels_inline;
+    params->stats_collector = args.stats_collector;
+    params->executor_type = &kStaticScheduleExecutor;
+
+    // NOTE: The graph is loopless and condless.
+    params->frame_iter = FrameAndIter(0, 0);
+    params->is_input_dead = false;
+    params->forward_from_array = nullptr;
+
+    device->TryGetDeviceContext(&params->op_device_context).IgnoreError();
+  }
+
+  // Executes `kernels_[i]` on the inputs that were forwarded to it in
+  // `inputs`, frees them, and forwards its outputs to the inputs of its
+  // consumers.
+  Status RunKernel(int i, Device* device, OpKernelContext::Params* params,
+                   std::vector<Entry>* inputs) const {
+    const KernelState& kernel_state = kernels_[i];
+    const size_t input_start_index = kernel_state.input_start_index;
+    const size_t num_inputs = kernel_state.num_inputs;
+    const size_t num_outputs = kernel_state.num_outputs;
+
+    TensorValueVec node_inputs(num_inputs);
+    AllocatorAttributeVec input_alloc_attrs(num_inputs);
+    for (size_t j = 0; j < num_inputs; ++j) {
+      Entry& input = (*inputs)[input_start_index + j];
+      DCHECK(input.state == Entry::State::HAS_VALUE)
+          << "Input did not have a valid value.";
+      node_inputs[j].tensor = input.val.get();
+      input_alloc_attrs[j] = input_alloc_attrs_[input_start_index + j];
+    }
+    params->inputs = node_inputs;
+    params->input_alloc_attrs = input_alloc_attrs;
+    params->op_kernel = kernel_state.kernel;
+    params->output_attr_array = kernel_state.output_alloc_attrs.data();
+    OpKernelContext ctx(params, num_outputs);
+
+    device->Compute(kernel_state.kernel, &ctx);
+    TF_RETURN_IF_ERROR(ctx.status());
+
+    // Free the inputs to the current kernel.
+    for (size_t j = 0; j < num_inputs; ++j) {
+      (*inputs)[input_start_index + j].ClearVal();
+    }
+
+    // Forward the outputs of the kernel to the inputs of subsequent kernels.
+    for (size_t j = 0; j < num_outputs; ++j) {
+      TensorValue val = ctx.release_output(j);
+      const size_t num_destinations = kernel_state.output_locations[j].size();
+      if (num_destinations > 0) {
+        for (size_t k = 0; k < num_destinations - 1; ++k) {
+          Entry& input = (*inputs)[kernel_state.output_locations[j][k]];
+          input.state = Entry::State::HAS_VALUE;
+          if (val.tensor != nullptr) {
+            input.val.Init(*val.tensor);
+          } else {
+            input.val.Init(Tensor(kernel_state.kernel->output_type(j)));
+          }
+        }
+        // Move `val` to the last consumer to avoid the cost of copying it.
+        Entry& input =
+            (*inputs)[kernel_state.output_locations[j][num_destinations - 1]];
+        input.state = Entry::State::HAS_VALUE;
+        if (val.tensor != nullptr) {
+          input.val.Init(std::move(*val.tensor));
+        } else {
+          input.val.Init(Tensor(kernel_state.kernel->output_type(j)));
+        }
+      }
+      delete val.tensor;
+    }
+    return OkStatus();
+  }
+
+  // Executes the kernels one at a time in topological order on the calling
+  // thread. If `record_costs` is true, the step is a warm-up step and the cost
+  // of each kernel is recorded.
+  Status RunSequential(const Args& args, bool record_costs) {
+    // Override intra op thread pool if requested.
+    Device* device = params_.device;
+    std::unique_ptr<Device> user_device;
+    if (args.user_intra_op_threadpool != nullptr) {
+      user_device = RenamedDevice::NewRenamedDevice(
+          device->name(), device, /*owns_underlying=*/false,
+          /*isolate_session_state=*/false, args.user_intra_op_threadpool);
+      device = user_device.get();
+    }
+
+    Args::Runner runner_copy = args.runner;
+    OpKernelContext::Params params;
+    PrepareParams(args, device, &runner_copy, &params);
+    auto context_cleanup = gtl::MakeCleanup([&params] {
+      if (params.op_device_context != nullptr) {
+        params.op_device_context->Unref();
+      }
+    });
+
+    std::vector<Entry> inputs(total_num_inputs_);
+    std::vector<int64_t> costs_nsec;
+    if (record_costs) {
+      costs_nsec.reserve(kernels_.size());
+    }
+    Env* env = Env::Default();
+    for (size_t i = 0; i < kernels_.size(); ++i) {
+      const uint64 start_nsec = record_costs ? env->NowNanos() : 0;
+      TF_RETURN_IF_ERROR(RunKernel(i, device, &params, &inputs));
+      if (record_costs) {
+        costs_nsec.push_back(env->NowNanos() - start_nsec);
+      }
+    }
+    if (record_costs) {
+      RecordWarmupStep(costs_nsec);
+    }
+    return OkStatus();
+  }
+
+  // Accumulates the kernel costs measured by a warm-up step, and computes the
+  // schedule once enough steps have been measured.
+  void RecordWarmupStep(const std::vector<int64_t>& costs_nsec)
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    if (schedule_ != nullptr) {
+      // Concurrent warm-up steps have already computed it.
+      return;
+    }
+    for (size_t i = 0; i < kernels_.size(); ++i) {
+      total_cost_nsec_[i] += costs_nsec[i];
+    }
+    if (++num_warmup_steps_ < options_.num_warmup_steps) {
+      return;
+    }
+    std::vector<int64_t> average_cost_nsec(kernels_.size());
+    for (size_t i = 0; i < kernels_.size(); ++i) {
+      // Every kernel takes some time, so that empty partitions can be told
+      // apart below.
+      average_cost_nsec[i] = std::max<int64_t>(
+          total_cost_nsec_[i] / options_.num_warmup_steps, 1);
+    }
+    schedule_ = ComputeSchedule(average_cost_nsec);
+    VLOG(1) << "Static schedule executor partitioned " << kernels_.size()
+            << " kernels into " << schedule_->partitions.size()
+            << " partitions.";
+  }
+
+  // Partitions the kernels by list scheduling: in topological order, each
+  // kernel goes to the partition in which it can start the earliest, given the
+  // estimated finish times of its predecessors and of the kernels already in
+  // the partition, and the cost of handing over between partitions.
+  std::shared_ptr<const Schedule> ComputeSchedule(
+      const std::vector<int64_t>& cost_nsec) const {
+    const int max_num_partitions = options_.max_num_partitions > 0
+                                       ? options_.max_num_partitions
+                                       : port::MaxParallelism();
+    const int num_kernels = kernels_.size();
+    auto schedule = std::make_shared<Schedule>();
+    schedule->partition.resize(num_kernels);
+    schedule->position.resize(num_kernels);
+    schedule->num_remote_predecessors.resize(num_kernels, 0);
+    schedule->remote_successors.resize(num_kernels);
+
+    std::vector<int64_t> finish_nsec(num_kernels);
+    std::vector<int64_t> available_nsec(max_num_partitions, 0);
+    for (int i = 0; i < num_kernels; ++i) {
+      int best_partition = -1;
+      int64_t best_start_nsec = 0;
+      for (int p = 0; p < max_num_partitions; ++p) {
+        int64_t start_nsec = available_nsec[p];
+        for (int predecessor : kernels_[i].predecessors) {
+          const int64_t handover_nsec =
+              schedule->partition[predecessor] == p
+                  ? 0
+                  : options_.cross_partition_cost_nsec;
+          start_nsec =
+              std::max(start_nsec, finish_nsec[predecessor] + handover_nsec);
+        }
+        if (best_partition == -1 || start_nsec < best_start_nsec) {
+          best_partition = p;
+          best_start_nsec = start_nsec;
+        }
+        if (available_nsec[p] == 0) {
+          // Partitions are filled in order, so this one and the following ones
+          // are empty, and equivalent.
+          break;
+        }
+      }
+      schedule->partition[i] = best_partition;
+      finish_nsec[i] = best_start_nsec + cost_nsec[i];
+      available_nsec[best_partition] = finish_nsec[i];
+    }
+
+    for (int i = 0; i < num_kernels; ++i) {
+      const int p = schedule->partition[i];
+      if (p >= static_cast<int>(schedule->partitions.size())) {
+        schedule->partitions.resize(p + 1);
+      }
+      schedule->position[i] = schedule->partitions[p].size();
+      schedule->partitions[p].push_back(i);
+      for (int predecessor : kernels_[i].predecessors) {
+        if (schedule->partition[predecessor] != p) {
+          ++schedule->num_remote_predecessors[i];
+          schedule->remote_successors[predecessor].push_back(i);
+        }
+      }
+    }
+    return schedule;
+  }
+
+  const LocalExecutorParams params_;
+  const StaticScheduleExecutorOptions options_;
+
+  // All following members are read-only after Initialize().
+
+  // The sum of the number of inputs for each node in the graph. This determines
+  // the length of the flat `inputs` vector.
+  size_t total_num_inputs_;
+
+  // The kernels in topological order.
+  std::vector<KernelState> kernels_;
+
+  // Memory space information for each input. This information is stored in the
+  // same order as the flat `inputs` vector.
+  std::vector<AllocatorAttributes>
+      input_alloc_attrs_;  // Length = `total_num_inputs_`.
+
+  mutable mutex mu_;
+  // The costs measured by the warm-up steps so far, and their number.
+  std::vector<int64_t> total_cost_nsec_ TF_GUARDED_BY(mu_);
+  int num_warmup_steps_ TF_GUARDED_BY(mu_) = 0;
+  // Null until the warm-up steps are done.
+  std::shared_ptr<const Schedule> schedule_ TF_GUARDED_BY(mu_);
+};
+
+// The state of a step executed according to a schedule. Each partition is
+// executed by one thread at a time, from the position at which it last
+// stopped. A partition reaching a kernel with remote predecessors that have
+// not run yet stops, and is resumed through the runner by the last of them.
+// The step is done once no partition is running anymore.
+class StaticScheduleExecutorImpl::StepState {
+ public:
+  StepState(const StaticScheduleExecutorImpl* impl, const Args& args,
+            std::shared_ptr<const Schedule> schedule, DoneCallback done)
+      : impl_(impl),
+        schedule_(std::move(schedule)),
+        runner_(args.runner),
+        done_(std::move(done)),
+        inputs_(impl->total_num_inputs_),
+        pending_(new std::atomic<int>[impl->kernels_.size()]) {
+    device_ = impl_->params_.device;
+    if (args.user_intra_op_threadpool != nullptr) {
+      user_device_ = RenamedDevice::NewRenamedDevice(
+          device_->name(), device_, /*owns_underlying=*/false,
+          /*isolate_session_state=*/false, args.user_intra_op_threadpool);
+      device_ = user_device_.get();
+    }
+    impl_->PrepareParams(args, device_, &runner_, &params_);
+
+    // Each counter also counts the partition of the kernel reaching it, so
+    // that whichever of the partition and the remote predecessors decrements
+    // it last runs the kernel.
+    for (size_t i = 0; i < impl_->kernels_.size(); ++i) {
+      const int num_remote_predecessors = schedule_->num_remote_predecessors[i];
+      if (num_remote_predecessors > 0) {
+        pending_[i].store(num_remote_predecessors + 1,
+                          std::memory_order_relaxed);
+      }
+    }
+  }
+
+  ~StepState() {
+    if (params_.op_device_context != nullptr) {
+      params_.op_device_context->Unref();
+    }
+  }
+
+  void Start() {
+    const int num_partitions = schedule_->partitions.size();
+    if (num_partitions == 0) {
+      Finish();
+      return;
+    }
+    num_running_.store(num_partitions, std::memory_order_relaxed);
+    for (int p = 1; p < num_partitions; ++p) {
+      runner_([this, p]() { RunPartition(p, 0); });
+    }
+    RunPartition(0, 0);
+  }
+
+ private:
+  // Executes the kernels of `partition` from `position`, until it is done or
+  // reaches a kernel that is not ready.
+  void RunPartition(int partition, int position) {
+    const std::vector<int>& kernels = schedule_->partitions[partition];
+    OpKernelContext::Params params = params_;
+    for (; position < static_cast<int>(kernels.size()); ++position) {
+      if (aborted_.load(std::memory_order_relaxed)) {
+        break;
+      }
+      const int i = kernels[position];
+      if (schedule_->num_remote_predecessors[i] > 0 &&
+          pending_[i].fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        // The last remote predecessor to run resumes this partition.
+        break;
+      }
+      Status s = impl_->RunKernel(i, device_, &params, &inputs_);
+      if (!s.ok()) {
+        {
+          mutex_lock l(mu_);
+          status_.Update(s);
+        }
+        aborted_.store(true, std::memory_order_relaxed);
+        break;
+      }
+      for (int successor : schedule_->remote_successors[i]) {
+        if (pending_[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          // This partition is still running, so the step can't be done before
+          // the resumed one is counted.
+          num_running_.fetch_add(1, std::memory_order_relaxed);
+          const int successor_partition = schedule_->partition[successor];
+          const int successor_position = schedule_->position[successor];
+          runner_([this, successor_partition, successor_position]() {
+            RunPartition(successor_partition, successor_position);
+          });
+        }
+      }
+    }
+    if (num_running_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Finish();
+    }
+  }
+
+  void Finish() {
+    Status status;
+    {
+      mutex_lock l(mu_);
+      status = status_;
+    }
+    DoneCallback done = std::move(done_);
+    delete this;
+    done(status);
+  }
+
+  const StaticScheduleExecutorImpl* const impl_;
+  const std::shared_ptr<const Schedule> schedule_;
+  Args::Runner runner_;
+  DoneCallback done_;
+
+  Device* device_;
+  std::unique_ptr<Device> user_device_;
+  // The parameters that are the same for all kernels. Each running partition
+  // has its own copy, which is safe since this one is never used to construct
+  // a context, and so never owns an `eigen_gpu_device`.
+  OpKernelContext::Params params_;
+
+  // The flat vector of the inputs of all the kernels, as in the single-threaded
+  // executor. Each element is written by the producer and read by the consumer
+  // after the partitions or counters have synchronized them.
+  std::vector<Entry> inputs_;
+
+  // For each kernel with remote predecessors, the number of them that have
+  // not run yet, plus one until its partition reaches it.
+  std::unique_ptr<std::atomic<int>[]> pending_;
+
+  std::atomic<int> num_running_{0};
+  std::atomic<bool> aborted_{false};
+
+  mutex mu_;
+  Status status_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepState);
+};
+
+void StaticScheduleExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
+  std::shared_ptr<const Schedule> schedule = GetSchedule();
+  if (schedule == nullptr || args.run_all_kernels_inline) {
+    // As in the single-threaded executor, execute all operations in a thread
+    // of the runner when asynchronous execution is requested.
+    const bool record_costs = schedule == nullptr;
+    args.runner([this, args, done, record_costs]() {
+      done(RunSequential(args, record_costs));
+    });
+    return;
+  }
+  (new StepState(this, args, std::move(schedule), std::move(done)))->Start();
+}
+
+class StaticScheduleExecutorRegistrar {
+ public:
+  StaticScheduleExecutorRegistrar() {
+    ExecutorFactory::Register(kStaticScheduleExecutor, new Factory());
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      Executor* ret;
+      TF_RETURN_IF_ERROR(NewStaticScheduleExecutor(
+          params, StaticScheduleExecutorOptions(), graph, &ret));
+      out_executor->reset(ret);
+      return OkStatus();
+    }
+  };
+};
+static StaticScheduleExecutorRegistrar registrar;
+
+}  // namespace
+
+Status NewStaticScheduleExecutor(const LocalExecutorParams& params,
+                                 const StaticScheduleExecutorOptions& options,
+                                 const Graph& graph, Executor** executor) {
+  auto impl = std::make_unique<StaticScheduleExecutorImpl>(params, options);
+  TF_RETURN_IF_ERROR(impl->Initialize(graph));
+  *executor = impl.release();
+  return OkStatus();
+}
+
+}  // namespace tensorflow
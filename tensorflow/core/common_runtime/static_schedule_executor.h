@@ -0,0 +1,62 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_SCHEDULE_EXECUTOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_SCHEDULE_EXECUTOR_H_
+
+#include <cstdint>
+
+#include "tensorflow/core/common_runtime/executor.h"
+
+namespace tensorflow {
+
+struct StaticScheduleExecutorOptions {
+  // The number of steps executed sequentially on the caller thread, while
+  // measuring the cost of each kernel, before the schedule is computed.
+  int num_warmup_steps = 10;
+
+  // The maximum number of partitions of the schedule, i.e. of kernel sequences
+  // executed concurrently. If not positive, `port::MaxParallelism()` is used.
+  int max_num_partitions = 0;
+
+  // The estimated cost of handing over from a kernel to a consumer in another
+  // partition. Consumers are only placed in other partitions than their
+  // producers when that makes them start earlier than this.
+  int64_t cross_partition_cost_nsec = 20000;
+};
+
+// Creates a new `Executor` for executing `graph` according to a schedule
+// computed ahead of time, for graphs whose dataflow is identical at each step.
+//
+// The first `options.num_warmup_steps` steps execute the kernels one at a time
+// in topological order on the caller thread, like the single-threaded
+// executor, and measure their costs. The kernels are then partitioned into
+// sequences by list scheduling on the measured costs. Subsequent steps run each
+// sequence on its own thread, in order, and only synchronize on the edges
+// between sequences: each kernel with producers in other sequences has an
+// atomic counter, and the sequence waiting on it is resumed by the producer
+// that decrements it to zero. There are no pending counts or ready queues.
+//
+// The executor has the same limitations as the single-threaded executor (see
+// `NewSingleThreadedExecutor()`), and in particular does not support control
+// flow or reference-typed tensors. If the step sets `run_all_kernels_inline`,
+// the kernels are executed sequentially on the caller thread.
+Status NewStaticScheduleExecutor(const LocalExecutorParams& params,
+                                 const StaticScheduleExecutorOptions& options,
+                                 const Graph& graph, Executor** executor);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_SCHEDULE_EXECUTOR_H_
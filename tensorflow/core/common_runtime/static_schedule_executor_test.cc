@@ -0,0 +1,248 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_schedule_executor.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <set>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/versions.pb.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace {
+
+class ScheduleMockOp : public OpKernel {
+ public:
+  using OpKernel::OpKernel;
+
+  void SetCompute(std::function<void(OpKernelContext*)> compute) {
+    compute_ = std::move(compute);
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    OP_REQUIRES(ctx, compute_ != nullptr,
+                errors::FailedPrecondition("Compute() is not set"));
+    compute_(ctx);
+  }
+
+ private:
+  std::function<void(OpKernelContext* ctx)> compute_;
+};
+REGISTER_OP("ScheduleMock")
+    .Input("x: float")
+    .Output("y: float")
+    .SetIsStateful();
+REGISTER_KERNEL_BUILDER(Name("ScheduleMock").Device(DEVICE_CPU),
+                        ScheduleMockOp);
+
+class StaticScheduleExecutorTest : public ::testing::Test {
+ protected:
+  StaticScheduleExecutorTest()
+      : device_(DeviceFactory::NewDevice("CPU", {},
+                                         "/job:localhost/replica:0/task:0")),
+        thread_pool_(Env::Default(), "test", /*num_threads=*/4) {
+    options_.num_warmup_steps = 2;
+    options_.max_num_partitions = 4;
+  }
+
+  // Resets exec_ with a new executor for `graph`.
+  Status Create(std::unique_ptr<const Graph> graph,
+                std::function<void(OpKernelContext*)> mock_fn = nullptr) {
+    const int version = graph->versions().producer();
+    LocalExecutorParams params;
+    params.device = device_.get();
+    params.create_kernel =
+        [this, mock_fn = std::move(mock_fn), version](
+            const std::shared_ptr<const NodeProperties>& props,
+            OpKernel** kernel) {
+          TF_RETURN_IF_ERROR(CreateNonCachedKernel(device_.get(), nullptr,
+                                                   props, version, kernel));
+          if ((*kernel)->type_string_view() == "ScheduleMock") {
+            down_cast<ScheduleMockOp*>(*kernel)->SetCompute(mock_fn);
+          }
+          return OkStatus();
+        };
+    params.delete_kernel = [](OpKernel* kernel) {
+      DeleteNonCachedKernel(kernel);
+    };
+    Executor* exec;
+    TF_RETURN_IF_ERROR(
+        NewStaticScheduleExecutor(params, options_, *graph, &exec));
+    exec_.reset(exec);
+    return OkStatus();
+  }
+
+  Status Run(CallFrameInterface* call_frame) {
+    Executor::Args args;
+    args.call_frame = call_frame;
+    args.runner = [this](const std::function<void()>& fn) {
+      thread_pool_.Schedule(fn);
+    };
+    return exec_->Run(args);
+  }
+
+  StaticScheduleExecutorOptions options_;
+  std::unique_ptr<Device> device_;
+  thread::ThreadPool thread_pool_;
+  std::unique_ptr<Executor> exec_;
+};
+
+// A float val -> Tensor<float>
+Tensor V(const float val) {
+  Tensor tensor(DT_FLOAT, TensorShape({}));
+  tensor.scalar<float>()() = val;
+  return tensor;
+}
+
+// Tensor<float> -> a float val.
+float V(const Tensor& tensor) {
+  CHECK_EQ(tensor.dtype(), DT_FLOAT);
+  CHECK(TensorShapeUtils::IsScalar(tensor.shape()));
+  return tensor.scalar<float>()();
+}
+
+// Builds a graph computing `num_branches` functions of its argument, each as a
+// chain of `branch_length` mock kernels.
+void BuildBranches(int num_branches, int branch_length, Graph* g) {
+  Node* arg = test::graph::Arg(g, 0, DT_FLOAT);
+  for (int i = 0; i < num_branches; ++i) {
+    Node* v = arg;
+    for (int j = 0; j < branch_length; ++j) {
+      TF_CHECK_OK(NodeBuilder(g->NewName("n"), "ScheduleMock")
+                      .Input(v)
+                      .Finalize(g, &v));
+    }
+    test::graph::Retval(g, i, v);
+  }
+  FixupSourceAndSinkEdges(g);
+}
+
+// Passes its input plus one to its output.
+void AddOne(OpKernelContext* ctx) {
+  ctx->set_output(0, V(V(ctx->input(0)) + 1.0));
+}
+
+TEST_F(StaticScheduleExecutorTest, ResultsMatchBeforeAndAfterWarmup) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildBranches(/*num_branches=*/8, /*branch_length=*/4, g.get());
+  TF_ASSERT_OK(Create(std::move(g), AddOne));
+  for (int step = 0; step < 5; ++step) {
+    FunctionCallFrame call_frame({DT_FLOAT}, DataTypeVector(8, DT_FLOAT));
+    TF_ASSERT_OK(call_frame.SetArgs({V(step)}));
+    TF_ASSERT_OK(Run(&call_frame));
+    std::vector<Tensor> retvals;
+    TF_ASSERT_OK(call_frame.ConsumeRetvals(&retvals, false));
+    for (const Tensor& retval : retvals) {
+      EXPECT_EQ(step + 4.0, V(retval));
+    }
+  }
+}
+
+TEST_F(StaticScheduleExecutorTest, ExpensiveBranchesRunConcurrently) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildBranches(/*num_branches=*/4, /*branch_length=*/1, g.get());
+  mutex mu;
+  std::set<std::thread::id> thread_ids;
+  TF_ASSERT_OK(Create(std::move(g), [&](OpKernelContext* ctx) {
+    Env::Default()->SleepForMicroseconds(10000);
+    {
+      mutex_lock l(mu);
+      thread_ids.insert(std::this_thread::get_id());
+    }
+    AddOne(ctx);
+  }));
+  for (int step = 0; step < options_.num_warmup_steps; ++step) {
+    FunctionCallFrame call_frame({DT_FLOAT}, DataTypeVector(4, DT_FLOAT));
+    TF_ASSERT_OK(call_frame.SetArgs({V(1.0)}));
+    TF_ASSERT_OK(Run(&call_frame));
+  }
+  // The warm-up steps execute the kernels on the caller thread.
+  EXPECT_EQ(thread_ids.size(), 1);
+
+  thread_ids.clear();
+  FunctionCallFrame call_frame({DT_FLOAT}, DataTypeVector(4, DT_FLOAT));
+  TF_ASSERT_OK(call_frame.SetArgs({V(1.0)}));
+  TF_ASSERT_OK(Run(&call_frame));
+  // Each branch costs much more than a handover, so each has its partition.
+  EXPECT_GT(thread_ids.size(), 1);
+  std::vector<Tensor> retvals;
+  TF_ASSERT_OK(call_frame.ConsumeRetvals(&retvals, false));
+  for (const Tensor& retval : retvals) {
+    EXPECT_EQ(2.0, V(retval));
+  }
+}
+
+TEST_F(StaticScheduleExecutorTest, ErrorAfterWarmup) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildBranches(/*num_branches=*/4, /*branch_length=*/4, g.get());
+  std::atomic<bool> fail{false};
+  TF_ASSERT_OK(Create(std::move(g), [&](OpKernelContext* ctx) {
+    Env::Default()->SleepForMicroseconds(1000);
+    OP_REQUIRES(ctx, !fail, errors::Internal("Failed"));
+    AddOne(ctx);
+  }));
+  for (int step = 0; step < options_.num_warmup_steps + 2; ++step) {
+    FunctionCallFrame call_frame({DT_FLOAT}, DataTypeVector(4, DT_FLOAT));
+    TF_ASSERT_OK(call_frame.SetArgs({V(1.0)}));
+    fail = step == options_.num_warmup_steps;
+    Status s = Run(&call_frame);
+    if (fail) {
+      EXPECT_TRUE(errors::IsInternal(s)) << s;
+    } else {
+      TF_EXPECT_OK(s);
+    }
+  }
+}
+
+TEST_F(StaticScheduleExecutorTest, RejectsControlFlow) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* arg = test::graph::Arg(g.get(), 0, DT_FLOAT);
+  Node* pred = test::graph::Arg(g.get(), 1, DT_BOOL);
+  Node* switch_node = test::graph::Switch(g.get(), arg, pred);
+  test::graph::Retval(g.get(), 0, switch_node, 0);
+  FixupSourceAndSinkEdges(g.get());
+  EXPECT_TRUE(errors::IsFailedPrecondition(Create(std::move(g))));
+}
+
+TEST_F(StaticScheduleExecutorTest, RequiresWarmupSteps) {
+  options_.num_warmup_steps = 0;
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildBranches(/*num_branches=*/1, /*branch_length=*/1, g.get());
+  EXPECT_TRUE(errors::IsInvalidArgument(Create(std::move(g))));
+}
+
+}  // namespace
+}  // namespace tensorflow
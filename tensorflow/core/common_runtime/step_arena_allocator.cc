@@ -0,0 +1,123 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <algorithm>
+#include <string>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+StepArenaAllocator::StepArenaAllocator(Allocator* base, const Options& options)
+    : base_(base), options_(options) {
+  DCHECK_LE(options_.max_allocation_bytes, options_.block_bytes);
+}
+
+StepArenaAllocator::~StepArenaAllocator() {
+  for (const Block& block : blocks_) {
+    base_->DeallocateRaw(block.base);
+  }
+}
+
+void StepArenaAllocator::Release() {
+  {
+    mutex_lock l(mu_);
+    DCHECK(!released_);
+    released_ = true;
+    if (num_live_allocations_ > 0) {
+      return;
+    }
+  }
+  delete this;
+}
+
+std::string StepArenaAllocator::Name() { return "step_arena"; }
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  alignment = std::max(alignment, Allocator::kAllocatorAlignment);
+  {
+    mutex_lock l(mu_);
+    DCHECK(!released_);
+    ++num_live_allocations_;
+    if (num_bytes <= options_.max_allocation_bytes &&
+        alignment <= Allocator::kAllocatorAlignment) {
+      // Empty allocations take a byte, so that their pointers are within a
+      // block.
+      const size_t bytes = std::max<size_t>(num_bytes, 1);
+      size_t offset = (offset_ + alignment - 1) & ~(alignment - 1);
+      if (blocks_.empty() || offset + bytes > blocks_.back().size) {
+        if (arena_bytes_ + options_.block_bytes <= options_.max_arena_bytes) {
+          char* block = static_cast<char*>(base_->AllocateRaw(
+              Allocator::kAllocatorAlignment, options_.block_bytes));
+          if (block != nullptr) {
+            blocks_.push_back({block, options_.block_bytes});
+            arena_bytes_ += options_.block_bytes;
+            offset = 0;
+          }
+        }
+      }
+      if (!blocks_.empty() && offset + bytes <= blocks_.back().size) {
+        offset_ = offset + bytes;
+        return blocks_.back().base + offset;
+      }
+    }
+  }
+  void* ptr = base_->AllocateRaw(alignment, num_bytes);
+  if (ptr == nullptr) {
+    mutex_lock l(mu_);
+    --num_live_allocations_;
+  }
+  return ptr;
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  bool in_arena;
+  bool delete_this;
+  {
+    mutex_lock l(mu_);
+    in_arena = InArena(ptr);
+    --num_live_allocations_;
+    DCHECK_GE(num_live_allocations_, 0);
+    delete_this = released_ && num_live_allocations_ == 0;
+  }
+  if (!in_arena) {
+    base_->DeallocateRaw(ptr);
+  }
+  if (delete_this) {
+    delete this;
+  }
+}
+
+size_t StepArenaAllocator::arena_bytes() const {
+  mutex_lock l(mu_);
+  return arena_bytes_;
+}
+
+bool StepArenaAllocator::InArena(const void* ptr) const {
+  const char* p = static_cast<const char*>(ptr);
+  // Most deallocations are of recent allocations, so search from the end.
+  for (auto it = blocks_.rbegin(); it != blocks_.rend(); ++it) {
+    if (p >= it->base && p < it->base + it->size) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,100 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// A bump allocator for the tensors allocated during one step. It carves
+// allocations out of large blocks obtained from a base allocator, and returns
+// the blocks to it all at once, instead of deallocating the tensors one by one.
+//
+// Memory is never reused within a step: deallocating only decrements the count
+// of live allocations. The blocks are returned to the base allocator once the
+// step has called `Release()` and all the allocations have been deallocated, so
+// tensors that escape the step, e.g. because they are fetched or stored in a
+// resource, stay valid and keep the blocks alive until they are deallocated.
+//
+// Allocations that are too large, or that would grow the arena past its limit,
+// are forwarded to the base allocator.
+//
+// This class is thread-safe.
+class StepArenaAllocator : public Allocator {
+ public:
+  struct Options {
+    // The size of the blocks allocated from the base allocator.
+    size_t block_bytes = 1 << 20;
+    // Allocations larger than this are forwarded to the base allocator.
+    size_t max_allocation_bytes = 64 << 10;
+    // The maximum number of bytes of blocks allocated for one step. Once it
+    // is reached, allocations are forwarded to the base allocator, so that
+    // steps running long loops don't accumulate their temporaries.
+    size_t max_arena_bytes = 64 << 20;
+  };
+
+  // `base` must outlive this allocator.
+  StepArenaAllocator(Allocator* base, const Options& options);
+
+  // Signals the end of the step. Deletes this allocator once all its
+  // allocations have been deallocated, possibly immediately. This must be
+  // called exactly once, and the allocator must not be used afterwards other
+  // than to deallocate.
+  void Release() TF_LOCKS_EXCLUDED(mu_);
+
+  std::string Name() override;
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override
+      TF_LOCKS_EXCLUDED(mu_);
+  void DeallocateRaw(void* ptr) override TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of bytes of blocks allocated from the base allocator.
+  size_t arena_bytes() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Block {
+    char* base;
+    size_t size;
+  };
+
+  ~StepArenaAllocator() override;
+
+  // Returns true if `ptr` was carved out of one of the blocks.
+  bool InArena(const void* ptr) const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Allocator* const base_;
+  const Options options_;
+
+  mutable mutex mu_;
+  std::vector<Block> blocks_ TF_GUARDED_BY(mu_);
+  // Offset of the first free byte of the last block.
+  size_t offset_ TF_GUARDED_BY(mu_) = 0;
+  size_t arena_bytes_ TF_GUARDED_BY(mu_) = 0;
+  // Allocations not deallocated yet, including the forwarded ones.
+  int64_t num_live_allocations_ TF_GUARDED_BY(mu_) = 0;
+  bool released_ TF_GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaAllocator);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
@@ -0,0 +1,108 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/counting_allocator_test_util.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+StepArenaAllocator::Options SmallArenaOptions() {
+  StepArenaAllocator::Options options;
+  options.block_bytes = 1024;
+  options.max_allocation_bytes = 256;
+  options.max_arena_bytes = 4096;
+  return options;
+}
+
+TEST(StepArenaAllocatorTest, AllocatesFromBlocks) {
+  test::CountingAllocator base;
+  auto* arena = new StepArenaAllocator(&base, SmallArenaOptions());
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 12; ++i) {
+    void* ptr = arena->AllocateRaw(Allocator::kAllocatorAlignment, 100);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % Allocator::kAllocatorAlignment,
+              0);
+    ptrs.push_back(ptr);
+  }
+  // Each 1KB block holds 8 allocations of 100 bytes aligned to 64 bytes.
+  EXPECT_EQ(base.num_allocations(), 2);
+  EXPECT_EQ(arena->arena_bytes(), 2048);
+  for (void* ptr : ptrs) {
+    arena->DeallocateRaw(ptr);
+  }
+  // The blocks are only returned once the step is done.
+  EXPECT_EQ(base.num_live(), 2);
+  arena->Release();
+  EXPECT_EQ(base.num_live(), 0);
+}
+
+TEST(StepArenaAllocatorTest, ForwardsLargeAllocations) {
+  test::CountingAllocator base;
+  auto* arena = new StepArenaAllocator(&base, SmallArenaOptions());
+  void* ptr = arena->AllocateRaw(Allocator::kAllocatorAlignment, 512);
+  EXPECT_EQ(base.num_allocations(), 1);
+  EXPECT_EQ(arena->arena_bytes(), 0);
+  arena->DeallocateRaw(ptr);
+  EXPECT_EQ(base.num_live(), 0);
+  arena->Release();
+}
+
+TEST(StepArenaAllocatorTest, ForwardsAllocationsPastLimit) {
+  test::CountingAllocator base;
+  auto* arena = new StepArenaAllocator(&base, SmallArenaOptions());
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 5 * 4; ++i) {
+    ptrs.push_back(arena->AllocateRaw(Allocator::kAllocatorAlignment, 256));
+  }
+  // Four blocks of four allocations, and four forwarded allocations.
+  EXPECT_EQ(arena->arena_bytes(), 4096);
+  EXPECT_EQ(base.num_allocations(), 8);
+  for (void* ptr : ptrs) {
+    arena->DeallocateRaw(ptr);
+  }
+  EXPECT_EQ(base.num_live(), 4);
+  arena->Release();
+  EXPECT_EQ(base.num_live(), 0);
+}
+
+TEST(StepArenaAllocatorTest, EscapingTensorOutlivesStep) {
+  test::CountingAllocator base;
+  auto* arena = new StepArenaAllocator(&base, SmallArenaOptions());
+  Tensor escaping(arena, DT_FLOAT, TensorShape({4}));
+  {
+    Tensor temp(arena, DT_FLOAT, TensorShape({4}));
+    temp.flat<float>().setConstant(1.0);
+  }
+  escaping.flat<float>().setConstant(2.0);
+  arena->Release();
+  // The tensor is still backed by the arena block.
+  EXPECT_EQ(base.num_live(), 1);
+  test::ExpectTensorEqual<float>(
+      escaping, test::AsTensor<float>({2.0, 2.0, 2.0, 2.0}));
+  escaping = Tensor();
+  EXPECT_EQ(base.num_live(), 0);
+}
+
+}  // namespace
+}  // namespace tensorflow
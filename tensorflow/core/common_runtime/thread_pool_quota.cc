@@ -0,0 +1,96 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/thread_pool_quota.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+ThreadPoolQuota::ThreadPoolQuota(thread::ThreadPool* pool, float cpu_share)
+    : pool_(pool) {
+  mutex_lock l(mu_);
+  max_running_ = MaxRunning(cpu_share);
+}
+
+int ThreadPoolQuota::MaxRunning(float cpu_share) const {
+  DCHECK_GT(cpu_share, 0.0f);
+  DCHECK_LE(cpu_share, 1.0f);
+  const int num_threads = pool_->NumThreads();
+  return std::min(
+      num_threads,
+      std::max(1, static_cast<int>(std::round(cpu_share * num_threads))));
+}
+
+void ThreadPoolQuota::SetCpuShare(float cpu_share) {
+  std::vector<std::function<void()>> dispatched;
+  {
+    mutex_lock l(mu_);
+    max_running_ = MaxRunning(cpu_share);
+    while (num_running_ < max_running_ && !queue_.empty()) {
+      dispatched.push_back(
+          std::move(const_cast<QueuedClosure&>(queue_.top()).fn));
+      queue_.pop();
+      ++num_running_;
+    }
+  }
+  for (auto& fn : dispatched) {
+    Run(std::move(fn));
+  }
+}
+
+void ThreadPoolQuota::Schedule(int64_t priority, std::function<void()> fn) {
+  {
+    mutex_lock l(mu_);
+    if (num_running_ >= max_running_) {
+      queue_.push({priority, next_sequence_number_++, std::move(fn)});
+      return;
+    }
+    ++num_running_;
+  }
+  Run(std::move(fn));
+}
+
+int ThreadPoolQuota::max_running() const {
+  mutex_lock l(mu_);
+  return max_running_;
+}
+
+void ThreadPoolQuota::Run(std::function<void()> fn) {
+  pool_->Schedule([quota = shared_from_this(), fn = std::move(fn)]() {
+    fn();
+    // Run the queued closures on this thread, rather than scheduling them,
+    // while the share allows it.
+    while (true) {
+      std::function<void()> next;
+      {
+        mutex_lock l(quota->mu_);
+        if (quota->queue_.empty() ||
+            quota->num_running_ > quota->max_running_) {
+          --quota->num_running_;
+          return;
+        }
+        next = std::move(const_cast<QueuedClosure&>(quota->queue_.top()).fn);
+        quota->queue_.pop();
+      }
+      next();
+    }
+  });
+}
+
+}  // namespace tensorflow
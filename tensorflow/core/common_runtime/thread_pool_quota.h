@@ -0,0 +1,95 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_THREAD_POOL_QUOTA_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_THREAD_POOL_QUOTA_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+
+// Limits the number of closures of one client, e.g. a session, running at once
+// in a thread pool shared with other clients to a share of the threads of the
+// pool. Closures beyond the share are queued, and dispatched to the pool by
+// decreasing priority, then in order of scheduling, as the running ones finish.
+//
+// Closures that block on each other can deadlock if the share is too small
+// for all of them to run, as they can in a pool with too few threads.
+//
+// The quota must be created with `std::make_shared`, since each closure keeps a
+// reference on it until it is done. This class is thread-safe.
+class ThreadPoolQuota : public std::enable_shared_from_this<ThreadPoolQuota> {
+ public:
+  // `pool` must outlive the closures scheduled through this quota. `cpu_share`
+  // must be in (0, 1].
+  ThreadPoolQuota(thread::ThreadPool* pool, float cpu_share);
+
+  // Changes the share of the threads of the pool. Queued closures are
+  // dispatched if the new share allows it, and running closures beyond it
+  // finish normally.
+  void SetCpuShare(float cpu_share) TF_LOCKS_EXCLUDED(mu_);
+
+  // Schedules `fn` on the pool, or queues it if the share is used up.
+  void Schedule(int64_t priority, std::function<void()> fn)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of closures that may run at once.
+  int max_running() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct QueuedClosure {
+    int64_t priority;
+    int64_t sequence_number;
+    std::function<void()> fn;
+
+    // Orders the closures by increasing priority, then by decreasing
+    // sequence number, so that the top of the queue is the next one to run.
+    bool operator<(const QueuedClosure& other) const {
+      if (priority != other.priority) {
+        return priority < other.priority;
+      }
+      return sequence_number > other.sequence_number;
+    }
+  };
+
+  // Returns the number of threads of the pool corresponding to `cpu_share`.
+  int MaxRunning(float cpu_share) const;
+
+  // Schedules `fn` on the pool. Once it is done, its thread runs the queued
+  // closures for as long as the share allows. `fn` must already be counted in
+  // `num_running_`.
+  void Run(std::function<void()> fn);
+
+  thread::ThreadPool* const pool_;
+
+  mutable mutex mu_;
+  int max_running_ TF_GUARDED_BY(mu_);
+  int num_running_ TF_GUARDED_BY(mu_) = 0;
+  int64_t next_sequence_number_ TF_GUARDED_BY(mu_) = 0;
+  std::priority_queue<QueuedClosure> queue_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ThreadPoolQuota);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_THREAD_POOL_QUOTA_H_
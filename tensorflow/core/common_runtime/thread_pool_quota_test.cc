@@ -0,0 +1,111 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/thread_pool_quota.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(ThreadPoolQuotaTest, MaxRunning) {
+  thread::ThreadPool pool(Env::Default(), "test", /*num_threads=*/4);
+  EXPECT_EQ(std::make_shared<ThreadPoolQuota>(&pool, 1.0f)->max_running(), 4);
+  EXPECT_EQ(std::make_shared<ThreadPoolQuota>(&pool, 0.5f)->max_running(), 2);
+  // Each quota has at least one thread.
+  EXPECT_EQ(std::make_shared<ThreadPoolQuota>(&pool, 0.01f)->max_running(), 1);
+}
+
+TEST(ThreadPoolQuotaTest, LimitsConcurrency) {
+  thread::ThreadPool pool(Env::Default(), "test", /*num_threads=*/4);
+  auto quota = std::make_shared<ThreadPoolQuota>(&pool, 0.5f);
+  mutex mu;
+  int num_running = 0;
+  int max_num_running = 0;
+  BlockingCounter counter(16);
+  for (int i = 0; i < 16; ++i) {
+    quota->Schedule(/*priority=*/0, [&]() {
+      {
+        mutex_lock l(mu);
+        ++num_running;
+        max_num_running = std::max(max_num_running, num_running);
+      }
+      Env::Default()->SleepForMicroseconds(2000);
+      {
+        mutex_lock l(mu);
+        --num_running;
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  EXPECT_LE(max_num_running, 2);
+}
+
+TEST(ThreadPoolQuotaTest, DispatchesByPriority) {
+  thread::ThreadPool pool(Env::Default(), "test", /*num_threads=*/4);
+  auto quota = std::make_shared<ThreadPoolQuota>(&pool, 0.25f);
+  Notification blocked;
+  Notification unblock;
+  quota->Schedule(/*priority=*/0, [&]() {
+    blocked.Notify();
+    unblock.WaitForNotification();
+  });
+  blocked.WaitForNotification();
+
+  mutex mu;
+  std::vector<int> order;
+  BlockingCounter counter(4);
+  for (int priority : {1, 3, 2, 3}) {
+    quota->Schedule(priority, [&, priority]() {
+      {
+        mutex_lock l(mu);
+        order.push_back(priority);
+      }
+      counter.DecrementCount();
+    });
+  }
+  unblock.Notify();
+  counter.Wait();
+  EXPECT_EQ(order, std::vector<int>({3, 3, 2, 1}));
+}
+
+TEST(ThreadPoolQuotaTest, SetCpuShareDispatchesQueuedClosures) {
+  thread::ThreadPool pool(Env::Default(), "test", /*num_threads=*/2);
+  auto quota = std::make_shared<ThreadPoolQuota>(&pool, 0.5f);
+  Notification unblock;
+  Notification done;
+  quota->Schedule(/*priority=*/0, [&]() { unblock.WaitForNotification(); });
+  quota->Schedule(/*priority=*/0, [&]() { done.Notify(); });
+  EXPECT_FALSE(
+      WaitForNotificationWithTimeout(&done, /*timeout_in_us=*/10000));
+
+  // The queued closure runs while the first one is still blocked.
+  quota->SetCpuShare(1.0f);
+  EXPECT_EQ(quota->max_running(), 2);
+  done.WaitForNotification();
+  unblock.Notify();
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -14,8 +14,10 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/captured_function.h"
 
+#include <optional>
 #include <utility>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/time/clock.h"
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
@@ -47,6 +49,10 @@ namespace {
 constexpr char kAllowSmallFunctionOptimizations[] =
     "allow_small_function_optimizations";
 
+// The maximum number of nodes of a lightweight function, see
+// `IsLightweightFunction`.
+constexpr int kMaxLightweightFunctionNodes = 16;
+
 // Simplistic implementation of the `StepStatsCollectorInterface` that only
 // cares about collecting the CPU time needed to execute a captured function.
 class SimpleStepStatsCollector : public StepStatsCollectorInterface {
@@ -377,6 +383,48 @@ class BorrowedArgsCallFrame : public CallFrameBase {
 
 }  // namespace
 
+bool IsLightweightFunction(const FunctionDef& fdef,
+                           const FunctionLibraryDefinition& lib_def) {
+  static const auto* const kControlFlowOps = new absl::flat_hash_set<string>(
+      {"Enter", "Exit", "LoopCond", "Merge", "NextIteration", "Switch"});
+  if (fdef.node_def_size() > kMaxLightweightFunctionNodes ||
+      fdef.control_ret_size() > 0) {
+    return false;
+  }
+  auto is_lightweight_type = [](DataType dtype) {
+    return dtype != DT_RESOURCE && dtype != DT_VARIANT && !IsRefType(dtype);
+  };
+  for (const auto& arg : fdef.signature().input_arg()) {
+    if (!is_lightweight_type(arg.type())) return false;
+  }
+  for (const auto& arg : fdef.signature().output_arg()) {
+    if (!is_lightweight_type(arg.type())) return false;
+  }
+  for (const NodeDef& node : fdef.node_def()) {
+    // Function calls and ops with function attributes, e.g. control flow v2,
+    // may run arbitrary computations.
+    if (lib_def.Contains(node.op()) || kControlFlowOps->contains(node.op()) ||
+        !node.device().empty()) {
+      return false;
+    }
+    const OpDef* op_def;
+    if (!lib_def.LookUpOpDef(node.op(), &op_def).ok() ||
+        op_def->is_stateful()) {
+      return false;
+    }
+    for (const auto& attr : node.attr()) {
+      if (attr.second.has_func() || attr.second.list().func_size() > 0) {
+        return false;
+      }
+      if (attr.second.value_case() == AttrValue::kType &&
+          !is_lightweight_type(attr.second.type())) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 Status MakeIteratorFromInputElement(
     IteratorContext* ctx, const IteratorBase* parent,
     const std::vector<Tensor>& input_element, int64_t thread_index,
@@ -450,6 +498,8 @@ Status FunctionMetadata::Create(
   const FunctionDef* fdef;
   TF_RETURN_IF_ERROR(LookupFunction(*(*out_metadata)->lib_def(),
                                     (*out_metadata)->func().name(), &fdef));
+  (*out_metadata)->is_lightweight_ =
+      IsLightweightFunction(*fdef, *(*out_metadata)->lib_def());
 
   auto attr = fdef->attr().find(FunctionLibraryDefinition::kIntsOnDeviceAttr);
   if (attr != fdef->attr().end() && attr->second.b()) {
@@ -547,10 +597,16 @@ Status CapturedFunction::Instantiate(
   inst_opts.default_device_to_target = metadata_->use_default_device();
   inst_opts.config_proto =
       lib->config_proto() ? *lib->config_proto() : ConfigProto();
+  // The kernels of a lightweight function are run back to back by the
+  // single-threaded executor on CPU, where that is cheaper than scheduling
+  // them.
+  const bool is_lightweight = metadata_->is_lightweight() &&
+                              lib->device() != nullptr &&
+                              lib->device()->device_type() == DEVICE_CPU;
   if (GetExperiments().contains(kAllowSmallFunctionOptimizations)) {
     inst_opts.allow_small_function_optimizations = true;
   } else {
-    if (!metadata_->use_inter_op_parallelism()) {
+    if (!metadata_->use_inter_op_parallelism() || is_lightweight) {
       inst_opts.executor_type = "SINGLE_THREADED_EXECUTOR";
     }
   }
@@ -678,7 +734,8 @@ Status CapturedFunction::Instantiate(
   TF_RETURN_IF_ERROR(IsMultiDevice(lib, &is_multi_device));
   *instantiated_captured_function = absl::WrapUnique(
       new InstantiatedCapturedFunction(lib, f_handle, std::move(ret_types),
-                                       *params.runner, this, is_multi_device));
+                                       *params.runner, this, is_multi_device,
+                                       is_lightweight));
   return OkStatus();
 }
 
@@ -771,13 +828,15 @@ Status CapturedFunction::IsMultiDevice(FunctionLibraryRuntime* flr,
 InstantiatedCapturedFunction::InstantiatedCapturedFunction(
     FunctionLibraryRuntime* lib, FunctionLibraryRuntime::Handle f_handle,
     DataTypeVector ret_types, std::function<void(std::function<void()>)> runner,
-    CapturedFunction* captured_func, bool is_multi_device)
+    CapturedFunction* captured_func, bool is_multi_device,
+    bool is_lightweight)
     : lib_(lib),
       f_handle_(f_handle),
       ret_types_(std::move(ret_types)),
       captured_runner_(std::move(runner)),
       captured_func_(captured_func),
-      is_multi_device_(is_multi_device) {}
+      is_multi_device_(is_multi_device),
+      is_lightweight_(is_lightweight) {}
 
 Status InstantiatedCapturedFunction::Run(IteratorContext* ctx,
                                          std::vector<Tensor>&& args,
@@ -794,15 +853,22 @@ Status InstantiatedCapturedFunction::Run(
   }
 
   FunctionLibraryRuntime::Options f_opts;
-  ScopedStepContainer step_container(
-      f_opts.step_id, [this](const string& name) {
-        lib_->device()->resource_manager()->Cleanup(name).IgnoreError();
-      });
-  f_opts.step_container = &step_container;
+  std::optional<ScopedStepContainer> step_container;
+  std::optional<CancellationManager> cancellation_manager;
+  if (is_lightweight_) {
+    // The stateless ops of the function neither use step resources nor
+    // register cancellation callbacks.
+    f_opts.cancellation_manager = ctx->cancellation_manager();
+  } else {
+    step_container.emplace(f_opts.step_id, [this](const string& name) {
+      lib_->device()->resource_manager()->Cleanup(name).IgnoreError();
+    });
+    f_opts.step_container = &*step_container;
+    cancellation_manager.emplace(ctx->cancellation_manager());
+    f_opts.cancellation_manager = &*cancellation_manager;
+  }
   f_opts.runner = ctx->runner();
   f_opts.create_rendezvous = ShouldCreateRendezvous();
-  CancellationManager cancellation_manager(ctx->cancellation_manager());
-  f_opts.cancellation_manager = &cancellation_manager;
   f_opts.collective_executor = ctx->collective_executor();
 
   std::shared_ptr<SimpleStepStatsCollector> stats_collector;
@@ -857,15 +923,22 @@ Status InstantiatedCapturedFunction::RunWithBorrowedArgs(
   }
 
   FunctionLibraryRuntime::Options f_opts;
-  ScopedStepContainer step_container(
-      f_opts.step_id, [this](const string& name) {
-        lib_->device()->resource_manager()->Cleanup(name).IgnoreError();
-      });
-  f_opts.step_container = &step_container;
+  std::optional<ScopedStepContainer> step_container;
+  std::optional<CancellationManager> cancellation_manager;
+  if (is_lightweight_) {
+    // The stateless ops of the function neither use step resources nor
+    // register cancellation callbacks.
+    f_opts.cancellation_manager = ctx->cancellation_manager();
+  } else {
+    step_container.emplace(f_opts.step_id, [this](const string& name) {
+      lib_->device()->resource_manager()->Cleanup(name).IgnoreError();
+    });
+    f_opts.step_container = &*step_container;
+    cancellation_manager.emplace(ctx->cancellation_manager());
+    f_opts.cancellation_manager = &*cancellation_manager;
+  }
   f_opts.runner = ctx->runner();
   f_opts.create_rendezvous = ShouldCreateRendezvous();
-  CancellationManager cancellation_manager(ctx->cancellation_manager());
-  f_opts.cancellation_manager = &cancellation_manager;
   f_opts.collective_executor = ctx->collective_executor();
 
   std::shared_ptr<SimpleStepStatsCollector> stats_collector;
@@ -912,15 +985,19 @@ Status InstantiatedCapturedFunction::RunInstantiated(
   }
 
   FunctionLibraryRuntime::Options f_opts;
-  ScopedStepContainer step_container(
-      f_opts.step_id, [this](const string& name) {
-        lib_->device()->resource_manager()->Cleanup(name).IgnoreError();
-      });
-  f_opts.step_container = &step_container;
-  f_opts.runner = &captured_runner_;
-  f_opts.create_rendezvous = ShouldCreateRendezvous();
+  std::optional<ScopedStepContainer> step_container;
+  if (!is_lightweight_) {
+    step_container.emplace(f_opts.step_id, [this](const string& name) {
+      lib_->device()->resource_manager()->Cleanup(name).IgnoreError();
+    });
+    f_opts.step_container = &*step_container;
+  }
+  // There is no iterator context to borrow a cancellation manager from, and
+  // the kernels may assume that there is one.
   CancellationManager cancellation_manager;
   f_opts.cancellation_manager = &cancellation_manager;
+  f_opts.runner = &captured_runner_;
+  f_opts.create_rendezvous = ShouldCreateRendezvous();
 
   BorrowedArgsCallFrame frame(args, &captured_func_->captured_inputs(),
                               ret_types_);
@@ -958,17 +1035,23 @@ void InstantiatedCapturedFunction::RunAsync(
       std::move(args), &captured_func_->captured_inputs(), ret_types_);
 
   FunctionLibraryRuntime::Options f_opts;
-  ResourceMgr* resource_mgr = lib_->device()->resource_manager();
-  ScopedStepContainer* step_container = new ScopedStepContainer(
-      f_opts.step_id, [resource_mgr](const string& name) {
-        resource_mgr->Cleanup(name).IgnoreError();
-      });
-  f_opts.step_container = step_container;
+  ScopedStepContainer* step_container = nullptr;
+  std::unique_ptr<CancellationManager> cancellation_manager;
+  if (is_lightweight_) {
+    f_opts.cancellation_manager = ctx->cancellation_manager();
+  } else {
+    ResourceMgr* resource_mgr = lib_->device()->resource_manager();
+    step_container = new ScopedStepContainer(
+        f_opts.step_id, [resource_mgr](const string& name) {
+          resource_mgr->Cleanup(name).IgnoreError();
+        });
+    f_opts.step_container = step_container;
+    cancellation_manager =
+        std::make_unique<CancellationManager>(ctx->cancellation_manager());
+    f_opts.cancellation_manager = cancellation_manager.get();
+  }
   f_opts.runner = ctx->runner();
   f_opts.create_rendezvous = ShouldCreateRendezvous();
-  auto cancellation_manager =
-      std::make_unique<CancellationManager>(ctx->cancellation_manager());
-  f_opts.cancellation_manager = cancellation_manager.get();
   f_opts.collective_executor = ctx->collective_executor();
 
   std::shared_ptr<SimpleStepStatsCollector> stats_collector;
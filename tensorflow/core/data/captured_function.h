@@ -63,6 +63,14 @@ Status MakeIteratorFromInputElement(
 // function passed to `interleave` or `flat_map`.
 IteratorContext MakeNestedIteratorContext(IteratorContext* ctx);
 
+// Returns true if `fdef` is a small straight-line function of stateless ops,
+// e.g. a cast or a reshape, whose per-element cost is dominated by the
+// overhead of running a function. Such functions need neither a step container
+// nor their own cancellation manager, and don't benefit from inter-op
+// parallelism.
+bool IsLightweightFunction(const FunctionDef& fdef,
+                           const FunctionLibraryDefinition& lib_def);
+
 struct ShortCircuitInfo {
   std::vector<int> indices;
   std::vector<bool> can_move;
@@ -111,6 +119,10 @@ class FunctionMetadata {
   // Indicates whether the function should a multi-device function backend.
   bool use_multi_device_function() const { return use_multi_device_function_; }
 
+  // Indicates whether the function is a small straight-line function of
+  // stateless ops, which is run with less per-call setup.
+  bool is_lightweight() const { return is_lightweight_; }
+
  private:
   FunctionMetadata(NameAttrList&& func, Params params)
       : func_(std::move(func)),
@@ -123,6 +135,7 @@ class FunctionMetadata {
   bool use_default_device_ = true;
   bool use_inter_op_parallelism_ = true;
   bool use_multi_device_function_ = true;
+  bool is_lightweight_ = false;
 };
 
 // Constructs and stores the parameters for the CapturedFunction Instantiate
@@ -299,7 +312,8 @@ class InstantiatedCapturedFunction {
       FunctionLibraryRuntime* lib, FunctionLibraryRuntime::Handle f_handle,
       DataTypeVector ret_types,
       std::function<void(std::function<void()>)> runner,
-      CapturedFunction* captured_func, bool is_multi_device);
+      CapturedFunction* captured_func, bool is_multi_device,
+      bool is_lightweight);
 
   // Determines whether a rendezvous object should be created when running the
   // instantiated function.
@@ -313,6 +327,9 @@ class InstantiatedCapturedFunction {
   std::function<void(std::function<void()>)> captured_runner_;
   CapturedFunction* const captured_func_;  // Not owned.
   const bool is_multi_device_;
+  // Whether the function is lightweight and runs on CPU, in which case it is
+  // run without a step container and a cancellation manager of its own.
+  const bool is_lightweight_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(InstantiatedCapturedFunction);
 };
@@ -0,0 +1,90 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/captured_function.h"
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using FDH = FunctionDefHelper;
+
+// Returns whether `fdef` is lightweight in a library of `fdef` and `others`.
+bool IsLightweight(const FunctionDef& fdef,
+                   const std::vector<FunctionDef>& others = {}) {
+  FunctionDefLibrary library;
+  *library.add_function() = fdef;
+  for (const FunctionDef& other : others) {
+    *library.add_function() = other;
+  }
+  FunctionLibraryDefinition lib_def(OpRegistry::Global(), library);
+  return IsLightweightFunction(fdef, lib_def);
+}
+
+TEST(IsLightweightFunctionTest, StatelessOps) {
+  EXPECT_TRUE(IsLightweight(test::function::XTimesTwo()));
+  EXPECT_TRUE(IsLightweight(test::function::XAddX()));
+}
+
+TEST(IsLightweightFunctionTest, StatefulOp) {
+  EXPECT_FALSE(IsLightweight(test::function::RandomUniform()));
+}
+
+TEST(IsLightweightFunctionTest, NestedCall) {
+  EXPECT_FALSE(IsLightweight(test::function::XTimesFour(),
+                             {test::function::XTimesTwo()}));
+}
+
+TEST(IsLightweightFunctionTest, ControlFlow) {
+  EXPECT_FALSE(IsLightweight(test::function::ControlFlow()));
+}
+
+TEST(IsLightweightFunctionTest, ResourceArgument) {
+  EXPECT_FALSE(IsLightweight(test::function::ResourceIdentity()));
+}
+
+TEST(IsLightweightFunctionTest, ControlOutput) {
+  FunctionDef fdef = FDH::Create(
+      "XIdentityWithControlOutput", {"x: float"}, {"y: float"}, {},
+      {{{"id"}, "Identity", {"x"}, {{"T", DT_FLOAT}}}}, {{"y", "id:output:0"}},
+      {{"must_run", "id"}});
+  EXPECT_FALSE(IsLightweight(fdef));
+}
+
+TEST(IsLightweightFunctionTest, ManyNodes) {
+  std::vector<FDH::Node> nodes;
+  std::string input = "x";
+  for (int i = 0; i < 32; ++i) {
+    const std::string name = strings::StrCat("id", i);
+    nodes.push_back({{name}, "Identity", {input}, {{"T", DT_FLOAT}}});
+    input = strings::StrCat(name, ":output:0");
+  }
+  FunctionDef fdef = FDH::Create("IdentityChain", {"x: float"}, {"y: float"},
+                                 {}, nodes, {{"y", input}});
+  EXPECT_FALSE(IsLightweight(fdef));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
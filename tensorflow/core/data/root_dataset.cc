@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/framework/model.pb.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/platform/stringprintf.h"
 
@@ -41,6 +42,7 @@ constexpr char kExperiments[] = "experiments";
 constexpr char kInjectPrefetchEligibleOpt[] = "inject_prefetch_eligible";
 constexpr char kIntraOpParallelism[] = "intra_op_parallelism";
 constexpr char kMemBandwidth[] = "mem_bw_used_megabytes_per_sec";
+constexpr char kNumaNode[] = "numa_node";
 constexpr char kPrivateThreadpoolSize[] = "threadpool_size";
 constexpr char kRamBudget[] = "ram_budget_megabytes";
 constexpr char kRamUsage[] = "ram_usage_megabytes";
@@ -60,6 +62,9 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
     params->private_threadpool_size =
         options.threading_options().private_threadpool_size();
   }
+  if (ShouldPinToNumaNode(options)) {
+    params->numa_node = options.threading_options().numa_node();
+  }
   params->autotune = ShouldUseAutotuning(options);
   if (params->autotune) {
     params->autotune_algorithm = model::AutotuneAlgorithm::DEFAULT;
@@ -106,6 +111,11 @@ void AddTraceMetadata(const RootDataset::Params& params,
                                     params.private_threadpool_size, 0,
                                     port::MaxParallelism())))));
   }
+  if (params.numa_node != port::kNUMANoAffinity) {
+    trace_metadata->push_back(std::make_pair(
+        kNumaNode, strings::Printf("%lld", static_cast<long long>(
+                                               params.numa_node))));
+  }
   auto experiments = GetExperiments();
   if (!experiments.empty()) {
     trace_metadata->push_back(
@@ -148,12 +158,33 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
           value_or_default(dataset()->params_.max_intra_op_parallelism, 0,
                            port::MaxParallelism());
     }
-    if (dataset()->params_.private_threadpool_size >= 0) {
-      threadpool_size_ =
-          value_or_default(dataset()->params_.private_threadpool_size, 0,
-                           port::MaxParallelism());
+    const int64_t numa_node = dataset()->params_.numa_node;
+    if (numa_node != port::kNUMANoAffinity) {
+      if (port::NUMAEnabled() && numa_node >= 0 &&
+          numa_node < port::NUMANumNodes()) {
+        numa_node_ = numa_node;
+      } else {
+        LOG(WARNING) << "Ignoring tf.data NUMA node " << numa_node
+                     << " since NUMA is not enabled or the node does not "
+                        "exist on this host.";
+      }
+    }
+    if (dataset()->params_.private_threadpool_size >= 0 ||
+        numa_node_ != port::kNUMANoAffinity) {
+      ThreadOptions thread_options;
+      if (numa_node_ != port::kNUMANoAffinity) {
+        thread_options.numa_node = numa_node_;
+        threadpool_size_ =
+            value_or_default(std::max<int64_t>(
+                                 dataset()->params_.private_threadpool_size, 0),
+                             0, port::MaxParallelism(numa_node_));
+      } else {
+        threadpool_size_ =
+            value_or_default(dataset()->params_.private_threadpool_size, 0,
+                             port::MaxParallelism());
+      }
       thread_pool_ = std::make_unique<thread::ThreadPool>(
-          Env::Default(), ThreadOptions{}, "data_private_threadpool",
+          Env::Default(), thread_options, "data_private_threadpool",
           threadpool_size_);
     }
     cancellation_manager_ = std::make_unique<CancellationManager>();
@@ -247,12 +278,26 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     if (dataset()->params_.autotune) {
       params.model = model_;
     }
-    if (dataset()->params_.private_threadpool_size >= 0) {
+    if (thread_pool_ != nullptr) {
       params.runner = [pool = thread_pool_.get()](std::function<void()> c) {
         pool->Schedule(std::move(c));
       };
       params.runner_threadpool_size = threadpool_size_;
     }
+    if (numa_node_ != port::kNUMANoAffinity) {
+      // Host tensors produced by the pipeline are allocated on the same NUMA
+      // node as the threads that produce them.
+      params.allocator_getter =
+          [numa_node = numa_node_,
+           allocator_getter = params.allocator_getter](AllocatorAttributes attrs) {
+            Allocator* allocator = allocator_getter(attrs);
+            if (allocator->GetMemoryType() ==
+                AllocatorMemoryType::kHostPageable) {
+              return cpu_allocator(numa_node);
+            }
+            return allocator;
+          };
+    }
     if (dataset()->params_.max_intra_op_parallelism >= 0) {
       params.runner =
           RunnerWithMaxParallelism(params.runner, max_intra_op_parallelism_);
@@ -285,6 +330,7 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
   std::unique_ptr<Thread> model_thread_ TF_GUARDED_BY(mu_);
   int64_t max_intra_op_parallelism_;
   int64_t threadpool_size_;
+  int64_t numa_node_ = port::kNUMANoAffinity;
   std::unique_ptr<thread::ThreadPool> thread_pool_;
 
   // The end time of the previous `GetNextInternal` call.
@@ -30,6 +30,7 @@ limitations under the License.
 #include "absl/strings/substitute.h"
 #include "absl/time/time.h"
 #include "tensorflow/core/data/service/client/common.h"
+#include "tensorflow/core/data/service/client/utils.h"
 #include "tensorflow/core/data/service/client/validate_utils.h"
 #include "tensorflow/core/data/service/common.h"
 #include "tensorflow/core/data/service/common.pb.h"
@@ -54,6 +55,22 @@ namespace tensorflow {
 namespace data {
 namespace {
 
+// Maximum number of concurrent requests to a task.
+constexpr int64_t kMaxRequestsPerTask = 8;
+// Maximum number of elements and bytes returned by a batched request.
+constexpr int64_t kMaxElementsPerRequest = 64;
+constexpr int64_t kMaxBytesPerRequest = 16 * (int64_t{1} << 20);  // 16MB
+// Weight of the latest measurement in moving averages.
+constexpr double kMovingAverageWeight = 0.1;
+
+template <typename T>
+T MovingAverage(std::optional<T> average, T value) {
+  if (!average.has_value()) {
+    return value;
+  }
+  return *average * (1 - kMovingAverageWeight) + value * kMovingAverageWeight;
+}
+
 bool IsColocatedTask(const TaskInfo& task) {
   return absl::c_any_of(task.worker_tags(), [](std::string_view worker_tag) {
     return absl::AsciiStrToUpper(worker_tag) == kColocatedWorkerTag;
@@ -123,6 +140,10 @@ StatusOr<GetNextResult> DataServiceClient::GetNext(
     DataServiceContextFactory context_factory) TF_LOCKS_EXCLUDED(mu_) {
   VLOG(3) << "Getting the next element from tf.data service client.";
   mutex_lock l(mu_);
+  if (last_get_next_time_.has_value()) {
+    get_next_interval_ =
+        MovingAverage(get_next_interval_, absl::Now() - *last_get_next_time_);
+  }
   if (ctx_ == nullptr) {
     ctx_ = context_factory();
   }
@@ -165,6 +186,7 @@ StatusOr<GetNextResult> DataServiceClient::GetNext(
             << get_next_index_++;
   }
   next.tensors.swap(result->element);
+  last_get_next_time_ = absl::Now();
   return next;
 }
 
@@ -313,6 +335,13 @@ Status DataServiceClient::AddTask(const TaskInfo& task_info)
                           params_.data_transfer_protocol));
   tasks_.push_back(std::make_shared<Task>(task_info, std::move(worker)));
   worker_thread_cv_.notify_one();
+  if (locality_.empty() && !task_info.worker_locality().empty() &&
+      LocalWorkers::Get(task_info.worker_address()) != nullptr) {
+    // The client shares the locality of its colocated worker.
+    locality_ = task_info.worker_locality();
+    VLOG(1) << "tf.data service client prefers workers in locality "
+            << locality_;
+  }
   if (IsCoordinatedRead()) {
     VLOG(1) << "Consumer " << params_.consumer_index.value() << " adding task "
             << task_info.task_id() << " to read from worker "
@@ -464,8 +493,10 @@ void DataServiceClient::UpdateBufferSize() TF_LOCKS_EXCLUDED(mu_) {
 
 void DataServiceClient::UpdateWorkerThreads() TF_LOCKS_EXCLUDED(mu_) {
   mutex_lock l(mu_);
-  const int64_t max_num_threads =
-      std::min<int64_t>(tasks_.size(), max_outstanding_requests_);
+  const int64_t max_requests_per_task =
+      IsCoordinatedRead() ? 1 : kMaxRequestsPerTask;
+  const int64_t max_num_threads = std::min<int64_t>(
+      tasks_.size() * max_requests_per_task, max_outstanding_requests_);
   while (num_running_worker_threads_ < max_num_threads && !cancelled_ &&
          status_.ok()) {
     num_running_worker_threads_++;
@@ -489,13 +520,14 @@ void DataServiceClient::RunWorkerThread(std::function<void()> done)
   });
   VLOG(1) << "Starting worker thread";
   std::shared_ptr<Task> task_to_process;
+  int64_t max_elements = 1;
   while (true) {
     std::shared_ptr<Result> result;
     {
       mutex_lock l(mu_);
       if (task_to_process) {
-        task_to_process->in_use = false;
-        --outstanding_requests_;
+        --task_to_process->num_requests;
+        outstanding_requests_ -= max_elements;
         task_to_process = nullptr;
         worker_thread_cv_.notify_one();
       }
@@ -512,8 +544,9 @@ void DataServiceClient::RunWorkerThread(std::function<void()> done)
         worker_thread_cv_.wait(l);
       }
       DCHECK(task_to_process != nullptr);
-      task_to_process->in_use = true;
-      ++outstanding_requests_;
+      ++task_to_process->num_requests;
+      max_elements = GetMaxElementsPerRequest(*task_to_process);
+      outstanding_requests_ += max_elements;
       if (IsCoordinatedRead()) {
         // Reserve a spot in the results_ queue.
         results_.push(std::make_shared<Result>());
@@ -526,15 +559,15 @@ void DataServiceClient::RunWorkerThread(std::function<void()> done)
       VLOG(3) << "Processing task " << task_to_process->info.task_id();
     }
     int64_t deadline_micros = kint64max;
-    Status s =
-        GetElementTraced(task_to_process.get(), deadline_micros,
-                         /*enqueue_result=*/!IsCoordinatedRead(), result);
+    Status s = GetElementTraced(task_to_process.get(), deadline_micros,
+                                /*enqueue_result=*/!IsCoordinatedRead(),
+                                max_elements, result);
     if (!s.ok()) {
       mutex_lock l(mu_);
       VLOG(1) << "Failed to get element from worker "
               << task_to_process->info.worker_address() << ": " << s;
-      task_to_process->in_use = false;
-      --outstanding_requests_;
+      --task_to_process->num_requests;
+      outstanding_requests_ -= max_elements;
       status_ = errors::CreateWithUpdatedMessage(
           s, absl::StrCat("Failed to get element from worker ",
                           task_to_process->info.worker_address(), ": ",
@@ -566,25 +599,36 @@ std::shared_ptr<DataServiceClient::Task> DataServiceClient::GetTaskToProcess()
   if (!ShouldProcessTask()) {
     return nullptr;
   }
+  if (!IsCoordinatedRead()) {
+    // Tasks in the client's locality are read first to avoid cross-rack and
+    // cross-zone transfers. Other tasks are read while those are busy.
+    std::shared_ptr<Task> task = GetSameLocalityTaskToProcess();
+    if (task) {
+      return task;
+    }
+  }
 
   for (int i = 0; i < tasks_.size(); ++i) {
     std::shared_ptr<Task>& task = tasks_[next_task_index_];
     if (IsCoordinatedRead() &&
-        (task->in_use ||
+        (task->num_requests > 0 ||
          current_round_ >= round_robin_round_limit_.value_or(
                                std::numeric_limits<int64_t>::max()))) {
-      VLOG(4) << "No round robin task found. in_use: " << task->in_use
+      VLOG(4) << "No round robin task found. num_requests: "
+              << task->num_requests
               << ". current_round: " << current_round_
               << ". round_robin_round_limit: "
               << round_robin_round_limit_.value_or(-1);
       return nullptr;
     }
-    if (current_round_ < task->info.starting_round() || task->in_use ||
-        task->end_of_sequence || task->removed) {
+    if (current_round_ < task->info.starting_round() ||
+        task->num_requests >= task->max_requests || task->end_of_sequence ||
+        task->removed) {
       VLOG(3) << "Skipping task " << next_task_index_
               << ". starting round: " << task->info.starting_round()
               << ". current round: " << current_round_
-              << ". task->in_use: " << task->in_use
+              << ". task->num_requests: " << task->num_requests
+              << ". task->max_requests: " << task->max_requests
               << ". end_of_sequence: " << task->end_of_sequence
               << ". task->removed: " << task->removed;
       AdvanceTaskIndex();
@@ -597,6 +641,25 @@ std::shared_ptr<DataServiceClient::Task> DataServiceClient::GetTaskToProcess()
   return nullptr;
 }
 
+std::shared_ptr<DataServiceClient::Task>
+DataServiceClient::GetSameLocalityTaskToProcess()
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (locality_.empty()) {
+    return nullptr;
+  }
+  for (int i = 0; i < tasks_.size(); ++i) {
+    std::shared_ptr<Task>& task =
+        tasks_[(next_task_index_ + i) % tasks_.size()];
+    if (task->info.worker_locality() == locality_ &&
+        task->num_requests < task->max_requests && !task->end_of_sequence &&
+        !task->removed) {
+      task->round = current_round_;
+      return task;
+    }
+  }
+  return nullptr;
+}
+
 // Increments the next task index, starting over if all tasks have been
 // processed.
 void DataServiceClient::AdvanceTaskIndex() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -607,11 +670,37 @@ void DataServiceClient::AdvanceTaskIndex() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   }
 }
 
-Status DataServiceClient::TryGetElement(const Task& task,
+int64_t DataServiceClient::GetMaxElementsPerRequest(const Task& task) const
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  // Elements of coordinated reads are placed in reserved spots of `results_`.
+  if (IsCoordinatedRead()) {
+    return 1;
+  }
+  // Shares the buffer between the requests which may be in flight.
+  const int64_t share =
+      max_outstanding_requests_ / (NumUnfinishedTasks() * task.max_requests);
+  const int64_t available = max_outstanding_requests_ -
+                            static_cast<int64_t>(results_.size()) -
+                            outstanding_requests_;
+  return std::clamp<int64_t>(std::min(share, available), 1,
+                             kMaxElementsPerRequest);
+}
+
+int64_t DataServiceClient::NumUnfinishedTasks() const
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  return std::max<int64_t>(
+      static_cast<int64_t>(tasks_.size()) - finished_tasks_, 1);
+}
+
+Status DataServiceClient::TryGetElement(const Task& task, int64_t max_elements,
                                         GetElementResult& result) {
   GetElementRequest req;
   req.set_task_id(task.info.task_id());
   req.set_skipped_previous_round(task.skipped_previous_round);
+  if (max_elements > 1) {
+    req.set_max_elements(max_elements);
+    req.set_max_bytes(kMaxBytesPerRequest);
+  }
   if (IsCoordinatedRead()) {
     req.set_consumer_index(params_.consumer_index.value());
     req.set_round_index(task.round);
@@ -625,7 +714,8 @@ Status DataServiceClient::TryGetElement(const Task& task,
 
 void DataServiceClient::ProcessGetElementResponse(
     bool enqueue_result, GetElementResult& get_element_result,
-    std::shared_ptr<Result> result, Task& task) TF_LOCKS_EXCLUDED(mu_) {
+    std::shared_ptr<Result> result, Task& task, absl::Duration latency)
+    TF_LOCKS_EXCLUDED(mu_) {
   mutex_lock l(mu_);
   result->ready = true;
   result->end_of_sequence = get_element_result.end_of_sequence;
@@ -637,19 +727,64 @@ void DataServiceClient::ProcessGetElementResponse(
     result->task_id = task.info.task_id();
   } else if (get_element_result.skip) {
     task.skipped_previous_round = true;
-  } else {
+  } else if (!task.end_of_sequence) {
+    // Concurrent requests to the task may all return end of sequence.
     task.end_of_sequence = true;
     finished_tasks_++;
   }
   if (enqueue_result && !result->end_of_sequence) {
     ctx_->RecordBufferEnqueue(result->element);
     results_.push(std::move(result));
+    EnqueueAdditionalResults(get_element_result, task);
+  }
+  if (!IsCoordinatedRead()) {
+    UpdateMaxRequests(task, latency,
+                      1 + get_element_result.additional_results.size());
   }
   get_next_cv_.notify_all();
 }
 
+void DataServiceClient::EnqueueAdditionalResults(
+    GetElementResult& get_element_result, const Task& task)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  for (GetElementResult& additional_result :
+       get_element_result.additional_results) {
+    auto result = std::make_shared<Result>();
+    result->ready = true;
+    result->element = std::move(additional_result.components);
+    result->element_index = additional_result.element_index;
+    result->task_id = task.info.task_id();
+    ctx_->RecordBufferEnqueue(result->element);
+    results_.push(std::move(result));
+  }
+}
+
+void DataServiceClient::UpdateMaxRequests(Task& task, absl::Duration latency,
+                                          int64_t num_elements)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  task.latency = MovingAverage(task.latency, latency);
+  task.elements_per_request = MovingAverage(
+      task.elements_per_request, static_cast<double>(num_elements));
+  // Concurrent requests to a task may return its elements out of order. This
+  // is only allowed when reading from multiple tasks, where the order of the
+  // elements is already nondeterministic.
+  if (!get_next_interval_.has_value() || tasks_.size() <= 1) {
+    task.max_requests = 1;
+    return;
+  }
+  // The consumer reads from the unfinished tasks in turn.
+  const int64_t max_requests = EstimateRequestsInFlight(
+      *task.latency, *get_next_interval_ * NumUnfinishedTasks(),
+      *task.elements_per_request, kMaxRequestsPerTask);
+  if (max_requests > task.max_requests) {
+    worker_thread_cv_.notify_all();
+  }
+  task.max_requests = max_requests;
+}
+
 Status DataServiceClient::GetElementTraced(Task* task, int64_t deadline_micros,
                                            bool enqueue_result,
+                                           int64_t max_elements,
                                            std::shared_ptr<Result> result)
     TF_LOCKS_EXCLUDED(mu_) {
   VLOG(3) << "Getting an element for task id " << task->info.task_id();
@@ -667,7 +802,8 @@ Status DataServiceClient::GetElementTraced(Task* task, int64_t deadline_micros,
            {"round_index", task->round}});
     });
   }
-  Status s = GetElement(task, deadline_micros, enqueue_result, result);
+  Status s =
+      GetElement(task, deadline_micros, enqueue_result, max_elements, result);
   mutex_lock l(mu_);
   VLOG(3) << "Got an element for task id " << task->info.task_id();
   return s;
@@ -704,12 +840,15 @@ Status DataServiceClient::MaybeRemoveTask(Task& task, int64_t deadline_micros,
 }
 
 Status DataServiceClient::GetElement(Task* task, int64_t deadline_micros,
-                                     bool enqueue_result,
+                                     bool enqueue_result, int64_t max_elements,
                                      std::shared_ptr<Result> result)
     TF_LOCKS_EXCLUDED(mu_) {
   GetElementResult get_element_result;
+  absl::Duration latency;
   for (int num_retries = 0;; ++num_retries) {
-    Status s = TryGetElement(*task, get_element_result);
+    const absl::Time start_time = absl::Now();
+    Status s = TryGetElement(*task, max_elements, get_element_result);
+    latency = absl::Now() - start_time;
     if (s.ok()) break;
     // Retry all errors that could indicate preemption.
     if (!IsPreemptedError(s)) {
@@ -748,7 +887,8 @@ Status DataServiceClient::GetElement(Task* task, int64_t deadline_micros,
             << (backoff_until - now_micros) << " microseconds";
     Env::Default()->SleepForMicroseconds(backoff_until - now_micros);
   }
-  ProcessGetElementResponse(enqueue_result, get_element_result, result, *task);
+  ProcessGetElementResponse(enqueue_result, get_element_result, result, *task,
+                            latency);
   return OkStatus();
 }
 
@@ -24,6 +24,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/client/common.h"
 #include "tensorflow/core/data/service/common.h"
 #include "tensorflow/core/data/service/common.pb.h"
@@ -94,8 +95,18 @@ class DataServiceClient {
     // deleted from `tasks_` on the next dispatcher heartbeat.
     bool removed = false;
     bool skipped_previous_round = false;
-    // Indicates whether a worker thread is currently processing the task.
-    bool in_use TF_GUARDED_BY(&DataServiceClient::mu_) = false;
+    // The number of worker threads currently processing the task.
+    int64_t num_requests TF_GUARDED_BY(&DataServiceClient::mu_) = 0;
+    // The number of worker threads which may process the task at once. It is
+    // autotuned from the observed request latency when reading from multiple
+    // tasks, and always 1 for coordinated reads.
+    int64_t max_requests TF_GUARDED_BY(&DataServiceClient::mu_) = 1;
+    // Moving averages of the request latency and of the number of elements
+    // returned per request, once a request has completed.
+    std::optional<absl::Duration> latency
+        TF_GUARDED_BY(&DataServiceClient::mu_);
+    std::optional<double> elements_per_request
+        TF_GUARDED_BY(&DataServiceClient::mu_);
     // Indicates whether the worker has returned end_of_sequence for the task.
     bool end_of_sequence TF_GUARDED_BY(&DataServiceClient::mu_) = false;
   };
@@ -149,16 +160,34 @@ class DataServiceClient {
   // Searches for a task to process, visiting tasks in-order and giving every
   // task a chance to proceed.
   std::shared_ptr<Task> GetTaskToProcess();
+  // Returns a task on a worker in `locality_` which can process a request, or
+  // nullptr if there is none.
+  std::shared_ptr<Task> GetSameLocalityTaskToProcess();
   void AdvanceTaskIndex();
-  Status TryGetElement(const Task& task, GetElementResult& result);
+  // Returns how many elements the next request to `task` may return.
+  int64_t GetMaxElementsPerRequest(const Task& task) const;
+  // Returns the number of tasks which have not reached end of sequence, or 1
+  // if there are none.
+  int64_t NumUnfinishedTasks() const;
+  Status TryGetElement(const Task& task, int64_t max_elements,
+                       GetElementResult& result);
   void ProcessGetElementResponse(bool enqueue_result,
                                  GetElementResult& get_element_result,
-                                 std::shared_ptr<Result> result, Task& task);
+                                 std::shared_ptr<Result> result, Task& task,
+                                 absl::Duration latency);
+  // Enqueues the additional elements returned by a batched request.
+  void EnqueueAdditionalResults(GetElementResult& get_element_result,
+                                const Task& task);
+  // Updates `task.max_requests` after a request which returned `num_elements`
+  // elements after `latency`.
+  void UpdateMaxRequests(Task& task, absl::Duration latency,
+                         int64_t num_elements);
   Status GetElementTraced(Task* task, int64_t deadline_micros,
-                          bool enqueue_result, std::shared_ptr<Result> result);
+                          bool enqueue_result, int64_t max_elements,
+                          std::shared_ptr<Result> result);
   Status MaybeRemoveTask(Task& task, int64_t deadline_micros, Result& result);
   Status GetElement(Task* task, int64_t deadline_micros, bool enqueue_result,
-                    std::shared_ptr<Result> result);
+                    int64_t max_elements, std::shared_ptr<Result> result);
   bool ResultReady() const;
   std::shared_ptr<Result> PopNextResult();
   bool IsCoordinatedRead() const;
@@ -173,7 +202,7 @@ class DataServiceClient {
 
   bool cancelled_ TF_GUARDED_BY(mu_) = false;
 
-  // Number of outstanding requests.
+  // Number of elements requested by outstanding requests.
   int64_t outstanding_requests_ TF_GUARDED_BY(mu_) = 0;
 
   // max_outstanding_requests controls how many elements may be held in memory
@@ -193,6 +222,10 @@ class DataServiceClient {
   // List of tasks to read from.
   std::vector<std::shared_ptr<Task>> tasks_ TF_GUARDED_BY(mu_);
 
+  // The locality of the worker colocated with the client, if any. Tasks on
+  // workers in the same locality are preferred.
+  std::string locality_ TF_GUARDED_BY(mu_);
+
   // The current round robin round we are engaged in. A round involves reading
   // from each task once.
   int64_t current_round_ TF_GUARDED_BY(mu_) = 0;
@@ -223,6 +256,11 @@ class DataServiceClient {
 
   int64_t get_next_index_ TF_GUARDED_BY(mu_) = 0;
 
+  // When `GetNext` last returned, and a moving average of the time the
+  // consumer spends between `GetNext` calls, if it has been measured.
+  std::optional<absl::Time> last_get_next_time_ TF_GUARDED_BY(mu_);
+  std::optional<absl::Duration> get_next_interval_ TF_GUARDED_BY(mu_);
+
   bool iteration_finished_ TF_GUARDED_BY(mu_) = false;
   bool should_finish_iteration_ TF_GUARDED_BY(mu_) = true;
 
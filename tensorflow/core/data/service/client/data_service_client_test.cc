@@ -152,6 +152,28 @@ TEST(DataServiceClientTest, DynamicSharding) {
   client.Cancel();
 }
 
+TEST(DataServiceClientTest, DrainWorkerWithDynamicSharding) {
+  TestCluster test_cluster(/*num_workers=*/3);
+  TF_ASSERT_OK(test_cluster.Initialize());
+  DatasetClient<int64_t> test_dataset(test_cluster);
+  TF_ASSERT_OK_AND_ASSIGN(std::string dataset_id,
+                          test_dataset.RegisterDataset(RangeDataset(100)));
+
+  DataServiceParams params = GetDataServiceParams(
+      dataset_id, test_cluster.DispatcherAddress(), ProcessingModeDef::DYNAMIC);
+  DataServiceClient client(params);
+  TF_ASSERT_OK(client.Initialize());
+  TF_ASSERT_OK_AND_ASSIGN(int64_t first_element, GetNext<int64_t>(client));
+
+  // The drained worker leaves its remaining splits to the other workers.
+  test_cluster.DrainWorker(/*index=*/0);
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> results,
+                          GetResults<int64_t>(client));
+  results.push_back(first_element);
+  EXPECT_THAT(results, UnorderedElementsAreArray(Range(100)));
+  client.Cancel();
+}
+
 TEST(DataServiceClientTest, StaticSharding) {
   TestCluster test_cluster(/*num_workers=*/3);
   TF_ASSERT_OK(test_cluster.Initialize());
@@ -169,6 +191,38 @@ TEST(DataServiceClientTest, StaticSharding) {
   client.Cancel();
 }
 
+TEST(DataServiceClientTest, BatchedRequestsPreserveTaskOrder) {
+  TestCluster test_cluster(/*num_workers=*/1);
+  TF_ASSERT_OK(test_cluster.Initialize());
+  DatasetClient<int64_t> test_dataset(test_cluster);
+  TF_ASSERT_OK_AND_ASSIGN(std::string dataset_id,
+                          test_dataset.RegisterDataset(RangeDataset(1000)));
+
+  DataServiceParams params = GetDataServiceParams(
+      dataset_id, test_cluster.DispatcherAddress(), ProcessingModeDef::OFF);
+  DataServiceClient client(params);
+  TF_ASSERT_OK(client.Initialize());
+  EXPECT_THAT(GetResults<int64_t>(client),
+              IsOkAndHolds(ElementsAreArray(Range(1000))));
+  client.Cancel();
+}
+
+TEST(DataServiceClientTest, ConcurrentRequestsToMultipleTasks) {
+  TestCluster test_cluster(/*num_workers=*/3);
+  TF_ASSERT_OK(test_cluster.Initialize());
+  DatasetClient<int64_t> test_dataset(test_cluster);
+  TF_ASSERT_OK_AND_ASSIGN(std::string dataset_id,
+                          test_dataset.RegisterDataset(RangeDataset(1000)));
+
+  DataServiceParams params = GetDataServiceParams(
+      dataset_id, test_cluster.DispatcherAddress(), ProcessingModeDef::DYNAMIC);
+  DataServiceClient client(params);
+  TF_ASSERT_OK(client.Initialize());
+  EXPECT_THAT(GetResults<int64_t>(client),
+              IsOkAndHolds(UnorderedElementsAreArray(Range(1000))));
+  client.Cancel();
+}
+
 TEST(DataServiceClientTest, RecordBufferEvents) {
   TestCluster test_cluster(/*num_workers=*/1);
   TF_ASSERT_OK(test_cluster.Initialize());
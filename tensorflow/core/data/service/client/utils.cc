@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/client/utils.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <string>
 
@@ -114,5 +116,23 @@ int64_t EstimateCardinality(const ProcessingModeDef& processing_mode,
   }
   return kUnknownCardinality;
 }
+
+int64_t EstimateRequestsInFlight(absl::Duration latency,
+                                 absl::Duration consume_interval,
+                                 double elements_per_request,
+                                 int64_t max_requests) {
+  if (latency <= absl::ZeroDuration() || elements_per_request <= 0) {
+    return 1;
+  }
+  if (consume_interval <= absl::ZeroDuration()) {
+    return max_requests;
+  }
+  // By Little's law, this many requests are in progress when requests are
+  // issued at the rate elements are consumed.
+  const double requests = absl::FDivDuration(latency, consume_interval) /
+                          elements_per_request;
+  return std::clamp<int64_t>(static_cast<int64_t>(std::ceil(requests)), 1,
+                             max_requests);
+}
 }  // namespace data
 }  // namespace tensorflow
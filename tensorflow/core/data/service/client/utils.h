@@ -18,6 +18,7 @@ limitations under the License.
 #include <cstdint>
 #include <string>
 
+#include "absl/time/time.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/protobuf/data_service.pb.h"
 
@@ -43,6 +44,15 @@ int64_t EstimateCardinality(const ProcessingModeDef& processing_mode,
                             const DataServiceMetadata& metadata,
                             bool is_coordinated_read);
 
+// Estimates how many `GetElement` requests to keep in flight to a task so that
+// they hide the request `latency`, when the consumer asks for an element of the
+// task every `consume_interval` and each request returns `elements_per_request`
+// elements. Returns a value between 1 and `max_requests`.
+int64_t EstimateRequestsInFlight(absl::Duration latency,
+                                 absl::Duration consume_interval,
+                                 double elements_per_request,
+                                 int64_t max_requests);
+
 }  // namespace data
 }  // namespace tensorflow
 
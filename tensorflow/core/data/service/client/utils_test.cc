@@ -17,6 +17,7 @@ limitations under the License.
 #include <optional>
 #include <string>
 
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/dispatcher_client.h"
 #include "tensorflow/core/data/service/test_cluster.h"
 #include "tensorflow/core/data/service/test_util.h"
@@ -127,6 +128,43 @@ TEST(UtilsTest, EstimateCardinalityUnknownCardinality) {
                                 /*is_coordinated_read=*/false),
             kUnknownCardinality);
 }
+
+TEST(UtilsTest, EstimateRequestsInFlight) {
+  // One request covers 10ms of consumption.
+  EXPECT_EQ(EstimateRequestsInFlight(
+                /*latency=*/absl::Milliseconds(10),
+                /*consume_interval=*/absl::Milliseconds(1),
+                /*elements_per_request=*/10, /*max_requests=*/8),
+            1);
+  EXPECT_EQ(EstimateRequestsInFlight(
+                /*latency=*/absl::Milliseconds(10),
+                /*consume_interval=*/absl::Milliseconds(1),
+                /*elements_per_request=*/4, /*max_requests=*/8),
+            3);
+  EXPECT_EQ(EstimateRequestsInFlight(
+                /*latency=*/absl::Milliseconds(100),
+                /*consume_interval=*/absl::Milliseconds(1),
+                /*elements_per_request=*/1, /*max_requests=*/8),
+            8);
+  EXPECT_EQ(EstimateRequestsInFlight(
+                /*latency=*/absl::Milliseconds(1),
+                /*consume_interval=*/absl::Milliseconds(100),
+                /*elements_per_request=*/1, /*max_requests=*/8),
+            1);
+}
+
+TEST(UtilsTest, EstimateRequestsInFlightEdgeCases) {
+  EXPECT_EQ(EstimateRequestsInFlight(
+                /*latency=*/absl::ZeroDuration(),
+                /*consume_interval=*/absl::Milliseconds(1),
+                /*elements_per_request=*/1, /*max_requests=*/8),
+            1);
+  EXPECT_EQ(EstimateRequestsInFlight(
+                /*latency=*/absl::Milliseconds(1),
+                /*consume_interval=*/absl::ZeroDuration(),
+                /*elements_per_request=*/1, /*max_requests=*/8),
+            8);
+}
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -15,15 +15,19 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_CROSS_TRAINER_CACHE_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_CROSS_TRAINER_CACHE_H_
 
+#include <algorithm>
 #include <cstddef>
 #include <deque>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/logging_utils.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/platform/errors.h"
@@ -46,6 +50,13 @@ namespace data {
 // collected when the cache becomes full. Consequently, trainers read from a
 // sliding window through the dataset and may not read the full dataset.
 //
+// Optionally, the cache holds back eviction for lagging trainers: it does not
+// evict elements that an active trainer has not read, and the trainer extending
+// the cache waits instead. A trainer stops holding back the cache once it lags
+// by more than `max_trainer_lag`, measured as the time since it last read or
+// since the next element it reads was cached. This lets trainers of similar
+// speeds share all elements, while slow or departed trainers skip data.
+//
 // The `CrossTrainerCache` class is thread-safe.
 //
 // Example usage:
@@ -98,9 +109,12 @@ class CrossTrainerCache {
   // Creates a `CrossTrainerCache` with `max_cache_size_bytes` of memory budget.
   // The cache should be able to hold at least one element, i.e.:
   // REQUIRES: `max_cache_size_bytes >= max(GetElementSizeBytes(*))`
+  // If `max_trainer_lag` is positive, elements are not evicted before trainers
+  // lagging by at most `max_trainer_lag` have read them.
   explicit CrossTrainerCache(
       size_t max_cache_size_bytes,
-      std::unique_ptr<CachableSequence<ElementType>> cachable_sequence);
+      std::unique_ptr<CachableSequence<ElementType>> cachable_sequence,
+      absl::Duration max_trainer_lag = absl::ZeroDuration());
   virtual ~CrossTrainerCache() = default;
   CrossTrainerCache(const CrossTrainerCache&) = delete;
   CrossTrainerCache& operator=(const CrossTrainerCache&) = delete;
@@ -126,6 +140,13 @@ class CrossTrainerCache {
     bool cache_hit;
   };
 
+  struct TrainerState {
+    // The absolute index of the next element to read.
+    size_t element_index = 0;
+    // When the trainer last read an element.
+    absl::Time last_read_time = absl::InfinitePast();
+  };
+
   // Returns the next element and metrics about this query.
   StatusOr<CacheQueryResult> GetCacheQueryResult(const std::string& trainer_id);
 
@@ -145,16 +166,35 @@ class CrossTrainerCache {
   // Reads a new element and writes it into the cache.
   Status ExtendCache();
 
+  // Returns the number of old elements to free before inserting a new element
+  // of `new_element_size_bytes`.
+  size_t NumElementsToFree(size_t new_element_size_bytes) const;
+
+  // Returns the time until which trainers lagging by at most `max_trainer_lag_`
+  // need the elements before absolute index `end_index`, or `std::nullopt` if
+  // no such trainer needs them.
+  std::optional<absl::Time> LaggingTrainersDeadline(size_t end_index,
+                                                    absl::Time now) const;
+
+  // Waits until freeing space for an element of `new_element_size_bytes` only
+  // evicts elements not needed by lagging trainers, or the cache is cancelled.
+  Status WaitForLaggingTrainers(size_t new_element_size_bytes,
+                                mutex_lock& lock);
+
   // Frees old elements to keep the cache size below `max_cache_size_bytes_`.
   // `new_element_size_bytes` is the size of the new element being inserted.
   void FreeSpace(size_t new_element_size_bytes);
 
-  // Records the cache hit rate and cache size.
-  void RecordMetrics(const CacheQueryResult& result);
+  // Records the cache hit rate, cache size, and the lag of `trainer_id`.
+  void RecordMetrics(const std::string& trainer_id,
+                     const CacheQueryResult& result);
 
   // Maximum cache size in bytes.
   const size_t max_cache_size_bytes_;
 
+  // Maximum lag of trainers for which eviction is held back.
+  const absl::Duration max_trainer_lag_;
+
   // The element sequence over which the sliding window cache operates.
   std::unique_ptr<CachableSequence<ElementType>> cachable_sequence_;
 
@@ -165,26 +205,29 @@ class CrossTrainerCache {
   // return this status.
   Status status_ TF_GUARDED_BY(mu_) = OkStatus();
 
-  // `cache_` stores the cached elements.
+  // `cache_` stores the cached elements, and `cache_times_` when each of them
+  // was cached.
   std::deque<std::shared_ptr<const ElementType>> cache_ TF_GUARDED_BY(mu_);
+  std::deque<absl::Time> cache_times_ TF_GUARDED_BY(mu_);
   size_t cache_size_bytes_ TF_GUARDED_BY(mu_) = 0;
   size_t cache_start_index_ TF_GUARDED_BY(mu_) = 0;
 
   // True if one thread is extending the cache.
   bool extending_cache_ TF_GUARDED_BY(mu_) = false;
 
-  // Maps trainer IDs to element indices. The indices are absolute indices
+  // Maps trainer IDs to their state. The element indices are absolute indices
   // within the dataset. The actual index to use with `cache_` would be
-  // `trainer_to_element_index_map_[trainer_id] - cache_start_index_`.
-  absl::flat_hash_map<std::string, size_t> trainer_to_element_index_map_
-      TF_GUARDED_BY(mu_);
+  // `trainers_[trainer_id].element_index - cache_start_index_`.
+  absl::flat_hash_map<std::string, TrainerState> trainers_ TF_GUARDED_BY(mu_);
 };
 
 template <class ElementType>
 CrossTrainerCache<ElementType>::CrossTrainerCache(
     size_t max_cache_size_bytes,
-    std::unique_ptr<CachableSequence<ElementType>> cachable_sequence)
+    std::unique_ptr<CachableSequence<ElementType>> cachable_sequence,
+    absl::Duration max_trainer_lag)
     : max_cache_size_bytes_(max_cache_size_bytes),
+      max_trainer_lag_(max_trainer_lag),
       cachable_sequence_(std::move(cachable_sequence)) {
   DCHECK_GT(max_cache_size_bytes, 0)
       << "CrossTrainerCache size must be greater than 0.";
@@ -202,7 +245,7 @@ CrossTrainerCache<ElementType>::Get(const std::string& trainer_id)
   }
 
   TF_ASSIGN_OR_RETURN(CacheQueryResult result, GetCacheQueryResult(trainer_id));
-  RecordMetrics(result);
+  RecordMetrics(trainer_id, result);
   return result.element;
 }
 
@@ -263,14 +306,20 @@ CrossTrainerCache<ElementType>::GetElement(const std::string& trainer_id)
 
   std::shared_ptr<const ElementType> result =
       cache_[element_index - cache_start_index_];
-  trainer_to_element_index_map_[trainer_id] = element_index + 1;
+  TrainerState& trainer = trainers_[trainer_id];
+  trainer.element_index = element_index + 1;
+  trainer.last_read_time = absl::Now();
+  if (max_trainer_lag_ > absl::ZeroDuration()) {
+    // Wakes up a trainer waiting for this one to read the element.
+    cv_.notify_all();
+  }
   return result;
 }
 
 template <class ElementType>
 size_t CrossTrainerCache<ElementType>::GetElementIndex(
     const std::string& trainer_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  size_t element_index = trainer_to_element_index_map_[trainer_id];
+  size_t element_index = trainers_[trainer_id].element_index;
   if (element_index < cache_start_index_) {
     element_index = cache_start_index_;
   }
@@ -291,25 +340,108 @@ Status CrossTrainerCache<ElementType>::ExtendCache() TF_LOCKS_EXCLUDED(mu_) {
 
   mutex_lock l(mu_);
   TF_RETURN_IF_ERROR(status_);
+  TF_RETURN_IF_ERROR(WaitForLaggingTrainers(new_element_size_bytes, l));
   FreeSpace(new_element_size_bytes);
   cache_.push_back(std::make_shared<ElementType>(std::move(element)));
+  cache_times_.push_back(absl::Now());
   cache_size_bytes_ += new_element_size_bytes;
   return OkStatus();
 }
 
+template <class ElementType>
+size_t CrossTrainerCache<ElementType>::NumElementsToFree(
+    size_t new_element_size_bytes) const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  size_t num_elements = 0;
+  size_t cache_size_bytes = cache_size_bytes_;
+  while (num_elements < cache_.size() &&
+         cache_size_bytes + new_element_size_bytes > max_cache_size_bytes_) {
+    cache_size_bytes -=
+        cachable_sequence_->GetElementSizeBytes(*cache_[num_elements]);
+    ++num_elements;
+  }
+  return num_elements;
+}
+
+template <class ElementType>
+std::optional<absl::Time>
+CrossTrainerCache<ElementType>::LaggingTrainersDeadline(size_t end_index,
+                                                        absl::Time now) const
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  std::optional<absl::Time> deadline;
+  for (const auto& [trainer_id, trainer] : trainers_) {
+    const size_t element_index =
+        std::max(trainer.element_index, cache_start_index_);
+    if (element_index >= end_index) {
+      continue;
+    }
+    // The trainer lags by the time since it last read, or since its next
+    // element was cached, whichever is longer.
+    const absl::Time trainer_deadline =
+        std::min(trainer.last_read_time,
+                 cache_times_[element_index - cache_start_index_]) +
+        max_trainer_lag_;
+    if (trainer_deadline > now &&
+        (!deadline.has_value() || trainer_deadline > *deadline)) {
+      deadline = trainer_deadline;
+    }
+  }
+  return deadline;
+}
+
+template <class ElementType>
+Status CrossTrainerCache<ElementType>::WaitForLaggingTrainers(
+    size_t new_element_size_bytes, mutex_lock& lock)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (max_trainer_lag_ <= absl::ZeroDuration()) {
+    return OkStatus();
+  }
+  while (status_.ok()) {
+    const size_t num_elements = NumElementsToFree(new_element_size_bytes);
+    const absl::Time now = absl::Now();
+    std::optional<absl::Time> deadline =
+        LaggingTrainersDeadline(cache_start_index_ + num_elements, now);
+    if (!deadline.has_value()) {
+      return OkStatus();
+    }
+    VLOG(3) << "Waiting up to " << *deadline - now << " for lagging trainers "
+            << "to read from the tf.data service cross-trainer cache.";
+    cv_.wait_for(lock, absl::ToChronoMicroseconds(*deadline - now));
+  }
+  return status_;
+}
+
 template <class ElementType>
 void CrossTrainerCache<ElementType>::FreeSpace(size_t new_element_size_bytes)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  // Elements before the slowest trainer's next element have been read by all
+  // trainers. Evicting later elements makes trainers skip data.
+  size_t slowest_trainer_index = std::numeric_limits<size_t>::max();
+  for (const auto& [trainer_id, trainer] : trainers_) {
+    slowest_trainer_index =
+        std::min(slowest_trainer_index, trainer.element_index);
+  }
   size_t num_elements_discarded = 0;
+  size_t num_unread_elements_discarded = 0;
   while (!cache_.empty() &&
          cache_size_bytes_ + new_element_size_bytes > max_cache_size_bytes_) {
     size_t free_bytes =
         cachable_sequence_->GetElementSizeBytes(*cache_.front());
     cache_.pop_front();
+    cache_times_.pop_front();
     cache_size_bytes_ -= free_bytes;
+    if (cache_start_index_ >= slowest_trainer_index) {
+      ++num_unread_elements_discarded;
+    }
     ++cache_start_index_;
     ++num_elements_discarded;
   }
+  if (num_elements_discarded > 0) {
+    metrics::RecordTFDataServiceCrossTrainerCacheEvictions(
+        num_elements_discarded - num_unread_elements_discarded,
+        /*read_by_all_trainers=*/true);
+    metrics::RecordTFDataServiceCrossTrainerCacheEvictions(
+        num_unread_elements_discarded, /*read_by_all_trainers=*/false);
+  }
 
   VLOG(3) << "Freed " << num_elements_discarded << " element(s) from "
           << "tf.data service cross-trainer cache. Memory usage: "
@@ -338,14 +470,20 @@ bool CrossTrainerCache<ElementType>::IsCancelled() const
 
 template <class ElementType>
 void CrossTrainerCache<ElementType>::RecordMetrics(
-    const CacheQueryResult& result) {
+    const std::string& trainer_id, const CacheQueryResult& result) {
   metrics::RecordTFDataServiceCrossTrainerCacheQuery(result.cache_hit);
   size_t cache_size_bytes = 0;
+  size_t trainer_lag = 0;
   {
     mutex_lock l(mu_);
     cache_size_bytes = cache_size_bytes_;
+    // The number of cached elements the trainer has not read.
+    trainer_lag = cache_start_index_ + cache_.size() -
+                  std::max(trainers_[trainer_id].element_index,
+                           cache_start_index_);
   }
   metrics::RecordTFDataServiceCrossTrainerCacheSizeBytes(cache_size_bytes);
+  metrics::RecordTFDataServiceCrossTrainerCacheTrainerLag(trainer_lag);
 }
 
 }  // namespace data
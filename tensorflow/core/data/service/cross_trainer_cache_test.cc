@@ -42,6 +42,7 @@ namespace data {
 namespace {
 
 using ::tensorflow::monitoring::testing::CellReader;
+using ::tensorflow::monitoring::testing::Histogram;
 using ::tensorflow::testing::IsOkAndHolds;
 using ::tensorflow::testing::StatusIs;
 using ::testing::Gt;
@@ -285,6 +286,107 @@ TEST(CrossTrainerCacheTest, CacheSizeMetrics) {
   }
 }
 
+TEST(CrossTrainerCacheTest, EvictionMetrics) {
+  CellReader<int64_t> cell_reader(
+      "/tensorflow/data/service/cross_trainer_cache_evictions");
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/5 * sizeof(int64_t),
+      std::make_unique<InfiniteRange>());
+  for (size_t i = 0; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Trainer 1"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_EQ(cell_reader.Delta("true"), 5);
+  EXPECT_EQ(cell_reader.Delta("false"), 0);
+
+  // Trainer 2 skips the elements evicted while it is not reading.
+  EXPECT_THAT(cache.Get("Trainer 2"), IsOkAndHolds(Pointee(5)));
+  for (size_t i = 10; i < 20; ++i) {
+    EXPECT_THAT(cache.Get("Trainer 1"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_EQ(cell_reader.Delta("true"), 1);
+  EXPECT_EQ(cell_reader.Delta("false"), 9);
+}
+
+TEST(CrossTrainerCacheTest, TrainerLagMetrics) {
+  CellReader<Histogram> cell_reader(
+      "/tensorflow/data/service/cross_trainer_cache_trainer_lag");
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/5 * sizeof(int64_t),
+      std::make_unique<InfiniteRange>());
+  for (size_t i = 0; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  Histogram lag = cell_reader.Delta();
+  EXPECT_FLOAT_EQ(lag.num(), 10.0);
+  EXPECT_FLOAT_EQ(lag.sum(), 0.0);
+
+  // The cache holds elements 5 to 9, so the slow trainer lags by 4 to 0.
+  for (size_t i = 5; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  lag = cell_reader.Delta();
+  EXPECT_FLOAT_EQ(lag.num(), 5.0);
+  EXPECT_FLOAT_EQ(lag.sum(), 10.0);
+}
+
+TEST(CrossTrainerCacheTest, LaggingTrainersReadAllData) {
+  const size_t num_elements_to_read = 200;
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/3 * sizeof(int64_t),
+      std::make_unique<InfiniteRange>(),
+      /*max_trainer_lag=*/absl::Minutes(1));
+  EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(0)));
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(0)));
+
+  std::vector<int64_t> fast_trainer_result, slow_trainer_result;
+  std::unique_ptr<Thread> fast_trainer(Env::Default()->StartThread(
+      /*thread_options=*/{}, /*name=*/"Fast trainer",
+      [&cache, &fast_trainer_result]() {
+        for (size_t i = 1; i < num_elements_to_read; ++i) {
+          TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<const int64_t> next,
+                                  cache.Get("Fast trainer"));
+          fast_trainer_result.push_back(*next);
+        }
+      }));
+  std::unique_ptr<Thread> slow_trainer(Env::Default()->StartThread(
+      /*thread_options=*/{}, /*name=*/"Slow trainer",
+      [&cache, &slow_trainer_result]() {
+        for (size_t i = 1; i < num_elements_to_read; ++i) {
+          Env::Default()->SleepForMicroseconds(100);
+          TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<const int64_t> next,
+                                  cache.Get("Slow trainer"));
+          slow_trainer_result.push_back(*next);
+        }
+      }));
+  fast_trainer.reset();
+  slow_trainer.reset();
+
+  // The fast trainer waits for the slow trainer instead of evicting elements
+  // it has not read.
+  std::vector<int64_t> expected_result;
+  for (size_t i = 1; i < num_elements_to_read; ++i) {
+    expected_result.push_back(i);
+  }
+  EXPECT_EQ(fast_trainer_result, expected_result);
+  EXPECT_EQ(slow_trainer_result, expected_result);
+}
+
+TEST(CrossTrainerCacheTest, TrainersLaggingTooMuchSkipData) {
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/5 * sizeof(int64_t),
+      std::make_unique<InfiniteRange>(),
+      /*max_trainer_lag=*/absl::Milliseconds(100));
+  EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(0)));
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(0)));
+
+  // The fast trainer waits for up to 100ms, after which the slow trainer no
+  // longer holds back the cache.
+  for (int i = 1; i < 20; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(Gt(14))));
+}
+
 TEST(CrossTrainerCacheTest, ConcurrentReaders) {
   size_t num_trainers = 10;
   size_t num_elements_to_read = 200;
@@ -61,6 +61,10 @@ GetElementResult GetElementResult::Copy() const {
   copy.element_index = element_index;
   copy.end_of_sequence = end_of_sequence;
   copy.skip = skip;
+  copy.additional_results.reserve(additional_results.size());
+  for (const GetElementResult& result : additional_results) {
+    copy.additional_results.push_back(result.Copy());
+  }
   return copy;
 }
 
@@ -81,6 +85,9 @@ size_t GetElementResult::EstimatedMemoryUsageBytes() const {
       size_bytes += compressed->SpaceUsedLong();
     }
   }
+  for (const GetElementResult& result : additional_results) {
+    size_bytes += result.EstimatedMemoryUsageBytes();
+  }
   return size_bytes;
 }
 
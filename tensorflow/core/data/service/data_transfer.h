@@ -60,6 +60,10 @@ struct GetElementResult {
   // reading from the worker. This is used for load balancing when doing round
   // robin reads.
   bool skip = false;
+  // Elements following this one in the task, returned by batched requests (see
+  // `GetElementRequest.max_elements`). These are never end of sequence or
+  // skipped.
+  std::vector<GetElementResult> additional_results;
 };
 
 // Client for communicating with the tf.data service transfer server.
@@ -334,6 +334,18 @@ Status DataServiceDispatcherClient::GetWorkers(
   return OkStatus();
 }
 
+Status DataServiceDispatcherClient::GetWorkloadStatus(
+    GetWorkloadStatusResponse& response) {
+  TF_RETURN_IF_ERROR(EnsureInitialized());
+  GetWorkloadStatusRequest request;
+  grpc::ClientContext ctx;
+  grpc::Status s = stub_->GetWorkloadStatus(&ctx, request, &response);
+  if (!s.ok()) {
+    return grpc_util::WrapError("Failed to get workload status", s);
+  }
+  return OkStatus();
+}
+
 Status DataServiceDispatcherClient::GetDataServiceMetadata(
     const std::string& dataset_id, DataServiceMetadata& metadata) {
   TF_RETURN_IF_ERROR(EnsureInitialized());
@@ -122,6 +122,10 @@ class DataServiceDispatcherClient : public DataServiceClientBase {
   // stored in `workers`.
   Status GetWorkers(std::vector<WorkerInfo>& workers);
 
+  // Queries the dispatcher for whether the consumers are starved or the
+  // workers are saturated, and for the load of each worker.
+  Status GetWorkloadStatus(GetWorkloadStatusResponse& response);
+
   // Returns data service metadata for the registered dataset.
   Status GetDataServiceMetadata(const std::string& dataset_id,
                                 DataServiceMetadata& metadata);
@@ -183,6 +183,43 @@ TEST_F(DispatcherClientTest, SnapshotsInHeartbeat) {
   }
 }
 
+TEST_F(DispatcherClientTest, GetWorkloadStatus) {
+  TF_ASSERT_OK(SetUpTfDataService(/*num_workers=*/1));
+  GetWorkloadStatusResponse response;
+  TF_ASSERT_OK(dispatcher_client_->GetWorkloadStatus(response));
+  EXPECT_EQ(response.status(), GetWorkloadStatusResponse::BALANCED);
+
+  WorkerHeartbeatRequest worker_heartbeat_request;
+  worker_heartbeat_request.set_worker_address("localhost:12345");
+  TaskLoad* task_load = worker_heartbeat_request.add_task_loads();
+  task_load->set_buffer_occupancy(0.0);
+  TF_ASSERT_OK(
+      dispatcher_client_->WorkerHeartbeat(worker_heartbeat_request).status());
+  TF_ASSERT_OK(dispatcher_client_->GetWorkloadStatus(response));
+  EXPECT_EQ(response.status(), GetWorkloadStatusResponse::STARVED);
+
+  task_load->set_buffer_occupancy(1.0);
+  TF_ASSERT_OK(
+      dispatcher_client_->WorkerHeartbeat(worker_heartbeat_request).status());
+  TF_ASSERT_OK(dispatcher_client_->GetWorkloadStatus(response));
+  EXPECT_EQ(response.status(), GetWorkloadStatusResponse::SATURATED);
+
+  // The loads of draining workers are reported but not aggregated.
+  worker_heartbeat_request.set_draining(true);
+  TF_ASSERT_OK(
+      dispatcher_client_->WorkerHeartbeat(worker_heartbeat_request).status());
+  TF_ASSERT_OK(dispatcher_client_->GetWorkloadStatus(response));
+  EXPECT_EQ(response.status(), GetWorkloadStatusResponse::BALANCED);
+  bool found_draining_worker = false;
+  for (const WorkerLoad& worker_load : response.worker_loads()) {
+    if (worker_load.worker_address() == "localhost:12345") {
+      EXPECT_TRUE(worker_load.draining());
+      found_draining_worker = true;
+    }
+  }
+  EXPECT_TRUE(found_draining_worker);
+}
+
 TEST_F(DispatcherClientTest, GetSnapshotSplit) {
   TF_ASSERT_OK(SetUpTfDataService(/*num_workers=*/1));
   TF_ASSERT_OK_AND_ASSIGN(absl::flat_hash_set<std::string> paths,
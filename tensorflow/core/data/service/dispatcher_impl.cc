@@ -90,6 +90,11 @@ constexpr int64_t kDefaultIterationGcTimeoutMs = 5 * 60 * 1000;  // 5 minutes.
 constexpr int64_t kDefaultClientTimeoutMs = 2 * 60 * 1000;       // 2 minutes.
 constexpr int64_t kDefaultWorkerTimeoutMs = 1 * 60 * 1000;       // 1 minute.
 
+// Average task buffer occupancies below which the consumers are considered
+// starved, and above which the workers are considered saturated.
+constexpr double kStarvedBufferOccupancy = 0.1;
+constexpr double kSaturatedBufferOccupancy = 0.9;
+
 constexpr std::array<const char*, 8> kNodeNameSharingOps = {
     "HashTable",
     "HashTableV2",
@@ -356,6 +361,15 @@ Status DataServiceDispatcherImpl::WorkerHeartbeat(
   const std::string& worker_address = request->worker_address();
   latest_worker_heartbeats_time_[worker_address] =
       absl::FromUnixMicros(env_->NowMicros());
+  WorkerLoad& worker_load = worker_loads_[worker_address];
+  worker_load.set_worker_address(worker_address);
+  *worker_load.mutable_task_loads() = request->task_loads();
+  worker_load.set_cpu_utilization(request->cpu_utilization());
+  if (request->draining() && !worker_load.draining()) {
+    LOG(INFO) << "Worker " << worker_address << " is draining. No new tasks "
+              << "will be assigned to it.";
+  }
+  worker_load.set_draining(request->draining());
   // Assigned tasks from the perspective of the dispatcher.
   std::vector<std::shared_ptr<const Task>> assigned_tasks;
   Status s = state_.TasksForWorker(worker_address, assigned_tasks);
@@ -371,6 +385,8 @@ Status DataServiceDispatcherImpl::WorkerHeartbeat(
         request->transfer_address());
     *update.mutable_register_worker()->mutable_worker_tags() =
         request->worker_tags();
+    update.mutable_register_worker()->set_worker_locality(
+        request->worker_locality());
     update.mutable_register_worker()->set_worker_uid(request->worker_uid());
     TF_RETURN_IF_ERROR(Apply(update));
     TF_RETURN_IF_ERROR(CreateTasksForWorker(worker_address));
@@ -800,7 +816,8 @@ Status DataServiceDispatcherImpl::CreateTasksForWorker(
   std::vector<std::shared_ptr<const Iteration>> iterations =
       state_.ListIterations();
   for (const auto& iteration : iterations) {
-    if (iteration->finished) {
+    if (iteration->finished ||
+        !ShouldCreateTask(*iteration->job, worker_address)) {
       continue;
     }
     if (iteration->job->num_consumers.has_value()) {
@@ -836,6 +853,9 @@ Status DataServiceDispatcherImpl::CreateTasksForIteration(
   tasks.clear();
   tasks.reserve(workers.size());
   for (const auto& worker : workers) {
+    if (!ShouldCreateTask(*iteration->job, worker->address)) {
+      continue;
+    }
     std::shared_ptr<const Task> task;
     TF_RETURN_IF_ERROR(CreateTask(iteration, worker->address, task));
     tasks.push_back(task);
@@ -843,6 +863,17 @@ Status DataServiceDispatcherImpl::CreateTasksForIteration(
   return OkStatus();
 }
 
+bool DataServiceDispatcherImpl::ShouldCreateTask(
+    const Job& job, const std::string& worker_address) const
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  // Statically sharded jobs need a task on every worker to read all shards.
+  if (IsStaticShard(job.processing_mode)) {
+    return true;
+  }
+  auto it = worker_loads_.find(worker_address);
+  return it == worker_loads_.end() || !it->second.draining();
+}
+
 Status DataServiceDispatcherImpl::CreatePendingTask(
     std::shared_ptr<const Iteration> iteration,
     const std::string& worker_address) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -859,6 +890,7 @@ Status DataServiceDispatcherImpl::CreatePendingTask(
   create_task->set_transfer_address(worker->transfer_address);
   *create_task->mutable_worker_tags() = {worker->tags.begin(),
                                          worker->tags.end()};
+  create_task->set_worker_locality(worker->locality);
   create_task->set_worker_uid(worker->uid);
   TF_RETURN_IF_ERROR(Apply(update));
   return OkStatus();
@@ -879,6 +911,7 @@ Status DataServiceDispatcherImpl::CreateTask(
   create_task->set_transfer_address(worker->transfer_address);
   *create_task->mutable_worker_tags() = {worker->tags.begin(),
                                          worker->tags.end()};
+  create_task->set_worker_locality(worker->locality);
   create_task->set_worker_uid(worker->uid);
   TF_RETURN_IF_ERROR(Apply(update));
   TF_RETURN_IF_ERROR(state_.TaskFromId(task_id, task));
@@ -1031,6 +1064,7 @@ Status DataServiceDispatcherImpl::ClientHeartbeat(
     task_info->set_transfer_address(task->transfer_address);
     *task_info->mutable_worker_tags() = {task->worker_tags.begin(),
                                          task->worker_tags.end()};
+    task_info->set_worker_locality(task->worker_locality);
     task_info->set_task_id(task->task_id);
     task_info->set_iteration_id(iteration->iteration_id);
     task_info->set_worker_uid(task->worker_uid);
@@ -1059,6 +1093,44 @@ Status DataServiceDispatcherImpl::GetWorkers(const GetWorkersRequest* request,
   return OkStatus();
 }
 
+Status DataServiceDispatcherImpl::GetWorkloadStatus(
+    const GetWorkloadStatusRequest* request,
+    GetWorkloadStatusResponse* response) {
+  TF_RETURN_IF_ERROR(CheckStarted());
+  mutex_lock l(mu_);
+  double total_buffer_occupancy = 0.0;
+  int64_t num_tasks = 0;
+  for (const auto& [worker_address, worker_load] : worker_loads_) {
+    if (!latest_worker_heartbeats_time_.contains(worker_address)) {
+      continue;
+    }
+    *response->add_worker_loads() = worker_load;
+    // Draining workers are about to be removed, so their tasks do not reflect
+    // the capacity of the remaining workers.
+    if (worker_load.draining()) {
+      continue;
+    }
+    for (const TaskLoad& task_load : worker_load.task_loads()) {
+      total_buffer_occupancy += task_load.buffer_occupancy();
+      ++num_tasks;
+    }
+  }
+
+  response->set_status(GetWorkloadStatusResponse::BALANCED);
+  if (num_tasks > 0) {
+    const double buffer_occupancy = total_buffer_occupancy / num_tasks;
+    if (buffer_occupancy < kStarvedBufferOccupancy) {
+      response->set_status(GetWorkloadStatusResponse::STARVED);
+    } else if (buffer_occupancy > kSaturatedBufferOccupancy) {
+      response->set_status(GetWorkloadStatusResponse::SATURATED);
+    }
+  }
+  VLOG(3) << "Returning workload status "
+          << GetWorkloadStatusResponse::WorkloadStatus_Name(response->status())
+          << " for " << num_tasks << " tasks";
+  return OkStatus();
+}
+
 Status DataServiceDispatcherImpl::Snapshot(const SnapshotRequest* request,
                                            SnapshotResponse* response) {
   TF_RETURN_IF_ERROR(CheckStarted());
@@ -1230,6 +1302,7 @@ void DataServiceDispatcherImpl::DetectMissingWorkers()
         it->second + absl::Milliseconds(config_.worker_timeout_ms())) {
       // TODO(mpcallanan): Alert snapshot manager.
       LOG(INFO) << "Lost worker " << it->first << " due to timeout";
+      worker_loads_.erase(it->first);
       latest_worker_heartbeats_time_.erase(it++);
     } else {
       ++it;
@@ -175,6 +175,8 @@ class DataServiceDispatcherImpl {
                          ClientHeartbeatResponse* response);
   Status GetWorkers(const GetWorkersRequest* request,
                     GetWorkersResponse* response);
+  Status GetWorkloadStatus(const GetWorkloadStatusRequest* request,
+                           GetWorkloadStatusResponse* response);
   Status Snapshot(const SnapshotRequest* request, SnapshotResponse* response);
   Status GetSnapshotSplit(const GetSnapshotSplitRequest* request,
                           GetSnapshotSplitResponse* response);
@@ -251,13 +253,19 @@ class DataServiceDispatcherImpl {
   Status AcquireIterationClientId(
       const std::shared_ptr<const DispatcherState::Iteration>& iteration,
       int64_t& iteration_client_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
-  // Creates one task for each worker, for the given iteration. The created
+  // Creates one task for each worker, for the given iteration, skipping
+  // draining workers unless the iteration is statically sharded. The created
   // tasks are stored in `tasks`. This method only updates dispatcher metadata
   // with the new tasks, but doesn't assign the tasks to the workers.
   Status CreateTasksForIteration(
       std::shared_ptr<const DispatcherState::Iteration> iteration,
       std::vector<std::shared_ptr<const DispatcherState::Task>>& tasks)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Returns false if no task of `job` should be created on the worker, because
+  // the worker is draining.
+  bool ShouldCreateTask(const DispatcherState::Job& job,
+                        const std::string& worker_address) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   // Creates a new task for an iteration. The created task may be either
   // pending or active.
@@ -352,6 +360,9 @@ class DataServiceDispatcherImpl {
   // Map from worker address to the time of the worker's last heartbeat.
   absl::flat_hash_map<std::string, absl::Time> latest_worker_heartbeats_time_
       TF_GUARDED_BY(mu_);
+  // Map from worker address to the load sent in the worker's last heartbeat.
+  // This is not journaled. Workers resend their loads after a restart.
+  absl::flat_hash_map<std::string, WorkerLoad> worker_loads_ TF_GUARDED_BY(mu_);
 
   // Managers for all snapshot processes created or recovered during the
   // lifetime of this dispatcher instance.
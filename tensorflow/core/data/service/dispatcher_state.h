@@ -92,11 +92,13 @@ class DispatcherState {
           transfer_address(register_worker.transfer_address()),
           tags(register_worker.worker_tags().begin(),
                register_worker.worker_tags().end()),
+          locality(register_worker.worker_locality()),
           uid(register_worker.worker_uid()) {}
 
     const std::string address;
     const std::string transfer_address;
     const std::vector<std::string> tags;
+    const std::string locality;
     const int64_t uid;
   };
 
@@ -210,6 +212,7 @@ class DispatcherState {
           transfer_address(create_task_update.transfer_address()),
           worker_tags(create_task_update.worker_tags().begin(),
                       create_task_update.worker_tags().end()),
+          worker_locality(create_task_update.worker_locality()),
           worker_uid(create_task_update.worker_uid()) {}
 
     const int64_t task_id;
@@ -217,6 +220,7 @@ class DispatcherState {
     const std::string worker_address;
     const std::string transfer_address;
     const std::vector<std::string> worker_tags;
+    const std::string worker_locality;
     const int64_t worker_uid;
     int64_t starting_round = 0;
     bool finished = false;
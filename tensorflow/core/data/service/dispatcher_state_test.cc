@@ -295,6 +295,18 @@ TEST(DispatcherState, RegisterWorker) {
   EXPECT_EQ(worker->address, address);
 }
 
+TEST(DispatcherState, RegisterWorkerWithLocality) {
+  DispatcherState state;
+  std::string address = "test_worker_address";
+  Update update;
+  update.mutable_register_worker()->set_worker_address(address);
+  update.mutable_register_worker()->set_worker_locality("rack_1");
+  TF_EXPECT_OK(state.Apply(update));
+  std::shared_ptr<const Worker> worker;
+  TF_EXPECT_OK(state.WorkerFromAddress(address, worker));
+  EXPECT_EQ(worker->locality, "rack_1");
+}
+
 TEST(DispatcherState, RegisterWorkerInFixedWorkerSet) {
   experimental::DispatcherConfig config;
   config.add_worker_addresses("/worker/task/0");
@@ -465,6 +477,25 @@ TEST(DispatcherState, CreateTask) {
   }
 }
 
+TEST(DispatcherState, CreateTaskWithWorkerLocality) {
+  std::string dataset_id = "dataset_id";
+  int64_t iteration_id = 3;
+  DispatcherState state;
+  int64_t task_id = state.NextAvailableTaskId();
+  TF_EXPECT_OK(RegisterDataset(dataset_id, state));
+  TF_EXPECT_OK(CreateIteration(iteration_id, dataset_id, state));
+  Update update;
+  CreateTaskUpdate* create_task = update.mutable_create_task();
+  create_task->set_task_id(task_id);
+  create_task->set_iteration_id(iteration_id);
+  create_task->set_worker_address("test_worker_address");
+  create_task->set_worker_locality("rack_1");
+  TF_EXPECT_OK(state.Apply(update));
+  std::shared_ptr<const Task> task;
+  TF_EXPECT_OK(state.TaskFromId(task_id, task));
+  EXPECT_EQ(task->worker_locality, "rack_1");
+}
+
 TEST(DispatcherState, CreateTasksForSameIteration) {
   std::string dataset_id = "dataset_id";
   int64_t iteration_id = 3;
@@ -51,6 +51,9 @@ class GrpcWorkerImpl : public WorkerService::Service {
     };
   }
 
+  // Starts draining the worker. See `DataServiceWorkerImpl::Drain`.
+  void Drain() { impl_->Drain(); }
+
   WorkerStateExport ExportState() const;
 
 #define HANDLER(method)                                 \
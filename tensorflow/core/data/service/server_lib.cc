@@ -215,6 +215,8 @@ Status WorkerGrpcDataServer::SnapshotTaskProgresses(
   return OkStatus();
 }
 
+void WorkerGrpcDataServer::Drain() { service_->Drain(); }
+
 ServerStateExport WorkerGrpcDataServer::ExportState() const {
   ServerStateExport server_state_export;
   *server_state_export.mutable_worker_state_export() = service_->ExportState();
@@ -139,6 +139,12 @@ class WorkerGrpcDataServer : public GrpcDataServerBase {
   Status SnapshotTaskProgresses(
       std::vector<SnapshotTaskProgressWrapper>* snapshot_task_progresses);
 
+  // Starts draining the worker before it is removed. The dispatcher stops
+  // assigning new tasks to the worker, and dynamically sharded tasks hand
+  // their remaining splits off to the other workers. The worker can be stopped
+  // without losing elements once `NumTasks` returns 0.
+  void Drain();
+
   ServerStateExport ExportState() const override;
 
  protected:
@@ -0,0 +1,796 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/data/service/shm_data_transfer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "grpcpp/create_channel.h"
+#include "grpcpp/security/credentials.h"
+#include "grpcpp/security/server_credentials.h"
+#include "grpcpp/server.h"
+#include "grpcpp/server_builder.h"
+#include "grpcpp/support/channel_arguments.h"
+#include "grpcpp/support/status.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/grpc_util.h"
+#include "tensorflow/core/data/service/shm_transfer.grpc.pb.h"
+#include "tensorflow/core/data/service/shm_transfer.pb.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "Shared memory rings require lock-free atomics.");
+
+constexpr size_t kCacheLineBytes = 64;
+constexpr uint64_t kSegmentMagic = 0x7466646174617368;  // "tfdatash"
+// Prefix of the names of the segments created by clients. Workers refuse to
+// open segments with other names.
+constexpr char kSegmentNamePrefix[] = "/tf_data_shm_";
+// Requests are small, whereas responses carry whole elements. Elements larger
+// than the response ring are streamed through it.
+constexpr size_t kRequestRingCapacityBytes = 1 << 20;
+constexpr size_t kResponseRingCapacityBytes = 64 << 20;
+// Bounds the size of the protos read from a ring.
+constexpr uint64_t kMaxFrameBytes = 1 << 30;
+// Number of busy polls before a waiting ring operation blocks.
+constexpr int kSpinIterations = 1000;
+// Without futexes, a blocked ring operation polls at this interval.
+constexpr int64_t kPollIntervalMicros = 100;
+// A blocked ring operation checks that the other process is alive at this
+// interval, in case it exited without closing the segment.
+constexpr int64_t kLivenessCheckIntervalMicros = 100 * 1000;
+// The bytes of the segment locked by the process which created it and by the
+// one which opened it, for as long as they map it.
+constexpr off_t kCreatorLockByte = 0;
+constexpr off_t kOpenerLockByte = 1;
+
+size_t RoundUpToCacheLine(size_t size) {
+  return (size + kCacheLineBytes - 1) / kCacheLineBytes * kCacheLineBytes;
+}
+
+// Blocks until `*word` may no longer be `value`, i.e. until a `FutexWakeAll`
+// on it, possibly from another process mapping it, or for at most
+// `timeout_micros`.
+void FutexWait(std::atomic<uint32_t>* word, uint32_t value,
+               int64_t timeout_micros) {
+#if defined(__linux__)
+  struct timespec timeout;
+  timeout.tv_sec = timeout_micros / 1000000;
+  timeout.tv_nsec = timeout_micros % 1000000 * 1000;
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, value,
+          &timeout, nullptr, 0);
+#else
+  Env::Default()->SleepForMicroseconds(kPollIntervalMicros);
+#endif
+}
+
+void FutexWakeAll(std::atomic<uint32_t>* word) {
+#if defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX,
+          nullptr, nullptr, 0);
+#endif
+}
+
+// Locks `byte` of the file `fd` until the file is closed. Open file description
+// locks are used, since unlike process locks they tell apart the two ends of a
+// segment mapped twice by the same process.
+bool LockByte(int fd, off_t byte) {
+#if defined(F_OFD_SETLK)
+  struct flock lock = {};
+  lock.l_type = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = byte;
+  lock.l_len = 1;
+  return fcntl(fd, F_OFD_SETLK, &lock) == 0;
+#else
+  return false;
+#endif
+}
+
+// Returns false if nobody else locks `byte` of the file `fd`.
+bool IsByteLocked(int fd, off_t byte) {
+#if defined(F_OFD_GETLK)
+  struct flock lock = {};
+  lock.l_type = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = byte;
+  lock.l_len = 1;
+  if (fcntl(fd, F_OFD_GETLK, &lock) != 0) return true;
+  return lock.l_type != F_UNLCK;
+#else
+  return true;
+#endif
+}
+
+// Writes `bytes` to `ring`, prefixed by its length.
+Status WriteFrame(SharedMemoryRing& ring, const std::string& bytes) {
+  const uint64_t size = bytes.size();
+  TF_RETURN_IF_ERROR(ring.Write(&size, sizeof(size)));
+  return ring.Write(bytes.data(), bytes.size());
+}
+
+// Reads bytes written by `WriteFrame` from `ring`.
+Status ReadFrame(SharedMemoryRing& ring, std::string* bytes) {
+  uint64_t size;
+  TF_RETURN_IF_ERROR(ring.Read(&size, sizeof(size)));
+  if (size > kMaxFrameBytes) {
+    return errors::DataLoss("Invalid frame of ", size,
+                            " bytes in shared memory segment.");
+  }
+  bytes->resize(size);
+  return ring.Read(bytes->data(), size);
+}
+
+}  // namespace
+
+struct SharedMemoryRing::Header {
+  // Total number of bytes written to and read from the ring. They are on
+  // separate cache lines since they are updated by different processes.
+  alignas(kCacheLineBytes) std::atomic<uint64_t> write_offset;
+  // Incremented after `write_offset` advances. A blocked consumer waits on it.
+  std::atomic<uint32_t> write_event;
+  alignas(kCacheLineBytes) std::atomic<uint64_t> read_offset;
+  // Incremented after `read_offset` advances. A blocked producer waits on it.
+  std::atomic<uint32_t> read_event;
+  // Number of blocked consumers and producers, which the other end wakes.
+  alignas(kCacheLineBytes) std::atomic<uint32_t> num_blocked_readers;
+  std::atomic<uint32_t> num_blocked_writers;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "Futexes require plain 32-bit atomics.");
+
+size_t SharedMemoryRing::MemorySize(size_t capacity) {
+  return RoundUpToCacheLine(sizeof(Header) + capacity);
+}
+
+void SharedMemoryRing::Initialize(void* memory) {
+  Header* header = new (memory) Header;
+  header->write_offset.store(0, std::memory_order_relaxed);
+  header->write_event.store(0, std::memory_order_relaxed);
+  header->read_offset.store(0, std::memory_order_relaxed);
+  header->read_event.store(0, std::memory_order_relaxed);
+  header->num_blocked_readers.store(0, std::memory_order_relaxed);
+  header->num_blocked_writers.store(0, std::memory_order_relaxed);
+}
+
+SharedMemoryRing::SharedMemoryRing(void* memory, size_t capacity,
+                                   const std::atomic<uint32_t>* closed,
+                                   std::function<bool()> peer_alive)
+    : header_(static_cast<Header*>(memory)),
+      data_(static_cast<char*>(memory) + sizeof(Header)),
+      capacity_(capacity),
+      closed_(closed),
+      peer_alive_(std::move(peer_alive)) {}
+
+template <typename Predicate>
+Status SharedMemoryRing::WaitUntil(Predicate ready,
+                                   std::atomic<uint32_t>& event,
+                                   std::atomic<uint32_t>& num_blocked) const {
+  int64_t last_liveness_check_micros = 0;
+  for (int i = 0; !ready(); ++i) {
+    if (closed_->load(std::memory_order_acquire)) {
+      return errors::Cancelled("The shared memory segment has been closed.");
+    }
+    if (i < kSpinIterations) continue;
+    const int64_t now_micros = Env::Default()->NowMicros();
+    if (last_liveness_check_micros == 0) {
+      last_liveness_check_micros = now_micros;
+    } else if (now_micros - last_liveness_check_micros >=
+               kLivenessCheckIntervalMicros) {
+      if (peer_alive_ && !peer_alive_()) {
+        return errors::Unavailable(
+            "The other process of the shared memory segment is gone.");
+      }
+      last_liveness_check_micros = now_micros;
+    }
+    // The event is read before checking `ready` again, so that a signal in
+    // between makes `FutexWait` return right away instead of being missed.
+    num_blocked.fetch_add(1, std::memory_order_seq_cst);
+    const uint32_t value = event.load(std::memory_order_seq_cst);
+    if (!ready() && !closed_->load(std::memory_order_acquire)) {
+      FutexWait(&event, value, kLivenessCheckIntervalMicros);
+    }
+    num_blocked.fetch_sub(1, std::memory_order_seq_cst);
+  }
+  return OkStatus();
+}
+
+void SharedMemoryRing::Signal(std::atomic<uint32_t>& event,
+                              const std::atomic<uint32_t>& num_blocked) {
+  event.fetch_add(1, std::memory_order_seq_cst);
+  if (num_blocked.load(std::memory_order_seq_cst) > 0) {
+    FutexWakeAll(&event);
+  }
+}
+
+void SharedMemoryRing::WakeAll() {
+  Signal(header_->write_event, header_->num_blocked_readers);
+  Signal(header_->read_event, header_->num_blocked_writers);
+}
+
+Status SharedMemoryRing::Write(const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  uint64_t write_offset = header_->write_offset.load(std::memory_order_relaxed);
+  while (size > 0) {
+    uint64_t read_offset;
+    TF_RETURN_IF_ERROR(WaitUntil(
+        [&]() {
+          read_offset = header_->read_offset.load(std::memory_order_acquire);
+          return write_offset - read_offset < capacity_;
+        },
+        header_->read_event, header_->num_blocked_writers));
+    const size_t position = write_offset % capacity_;
+    const size_t n = std::min({size, capacity_ - (write_offset - read_offset),
+                               capacity_ - position});
+    std::memcpy(data_ + position, bytes, n);
+    bytes += n;
+    size -= n;
+    write_offset += n;
+    header_->write_offset.store(write_offset, std::memory_order_release);
+    Signal(header_->write_event, header_->num_blocked_readers);
+  }
+  return OkStatus();
+}
+
+Status SharedMemoryRing::Read(void* data, size_t size) {
+  char* bytes = static_cast<char*>(data);
+  uint64_t read_offset = header_->read_offset.load(std::memory_order_relaxed);
+  while (size > 0) {
+    uint64_t write_offset;
+    TF_RETURN_IF_ERROR(WaitUntil(
+        [&]() {
+          write_offset = header_->write_offset.load(std::memory_order_acquire);
+          return write_offset > read_offset;
+        },
+        header_->write_event, header_->num_blocked_readers));
+    const size_t position = read_offset % capacity_;
+    const size_t n =
+        std::min({size, static_cast<size_t>(write_offset - read_offset),
+                  capacity_ - position});
+    std::memcpy(bytes, data_ + position, n);
+    bytes += n;
+    size -= n;
+    read_offset += n;
+    header_->read_offset.store(read_offset, std::memory_order_release);
+    Signal(header_->read_event, header_->num_blocked_writers);
+  }
+  return OkStatus();
+}
+
+namespace {
+
+// Header of a shared memory segment, followed by the request ring and the
+// response ring.
+struct SegmentHeader {
+  uint64_t magic;
+  uint64_t request_capacity;
+  uint64_t response_capacity;
+  std::atomic<uint32_t> closed;
+  // Set once the creator, resp. the opener, of the segment locks its byte of
+  // it. The liveness of a process which did not is never checked.
+  uint32_t creator_locked;
+  std::atomic<uint32_t> opener_locked;
+};
+
+size_t SegmentHeaderSize() { return RoundUpToCacheLine(sizeof(SegmentHeader)); }
+
+size_t SegmentSize(size_t request_capacity, size_t response_capacity) {
+  return SegmentHeaderSize() + SharedMemoryRing::MemorySize(request_capacity) +
+         SharedMemoryRing::MemorySize(response_capacity);
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<SharedMemorySegment>> SharedMemorySegment::Create(
+    const std::string& name, size_t request_capacity,
+    size_t response_capacity) {
+  if (request_capacity == 0 || response_capacity == 0) {
+    return errors::InvalidArgument(
+        "Shared memory rings must have a positive capacity, got ",
+        request_capacity, " and ", response_capacity, " bytes.");
+  }
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    return errors::IOError(absl::StrCat("Failed to create ", name), errno);
+  }
+  const size_t size = SegmentSize(request_capacity, response_capacity);
+  void* memory = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  const int error = errno;
+  if (memory == MAP_FAILED) {
+    close(fd);
+    shm_unlink(name.c_str());
+    return errors::IOError(absl::StrCat("Failed to map ", name), error);
+  }
+
+  SegmentHeader* header = new (memory) SegmentHeader;
+  header->magic = kSegmentMagic;
+  header->request_capacity = request_capacity;
+  header->response_capacity = response_capacity;
+  header->closed.store(0, std::memory_order_relaxed);
+  header->creator_locked = LockByte(fd, kCreatorLockByte);
+  header->opener_locked.store(0, std::memory_order_relaxed);
+  char* rings = static_cast<char*>(memory) + SegmentHeaderSize();
+  SharedMemoryRing::Initialize(rings);
+  SharedMemoryRing::Initialize(rings +
+                               SharedMemoryRing::MemorySize(request_capacity));
+  return absl::WrapUnique(
+      new SharedMemorySegment(memory, size, fd, /*creator=*/true));
+}
+
+StatusOr<std::unique_ptr<SharedMemorySegment>> SharedMemorySegment::Open(
+    const std::string& name) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    return errors::IOError(absl::StrCat("Failed to open ", name), errno);
+  }
+  struct stat info;
+  size_t size = 0;
+  void* memory = MAP_FAILED;
+  if (fstat(fd, &info) == 0) {
+    size = info.st_size;
+  }
+  if (size >= SegmentHeaderSize()) {
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  const int error = errno;
+  if (memory == MAP_FAILED) {
+    close(fd);
+    return errors::IOError(absl::StrCat("Failed to map ", name), error);
+  }
+
+  SegmentHeader* header = static_cast<SegmentHeader*>(memory);
+  // The capacities are bounded by the size first, so that computing the
+  // segment size from them cannot overflow.
+  if (header->magic != kSegmentMagic || header->request_capacity == 0 ||
+      header->response_capacity == 0 || header->request_capacity > size ||
+      header->response_capacity > size ||
+      SegmentSize(header->request_capacity, header->response_capacity) !=
+          size) {
+    munmap(memory, size);
+    close(fd);
+    return errors::InvalidArgument(name,
+                                   " is not a tf.data shared memory segment.");
+  }
+  if (LockByte(fd, kOpenerLockByte)) {
+    header->opener_locked.store(1, std::memory_order_release);
+  }
+  return absl::WrapUnique(
+      new SharedMemorySegment(memory, size, fd, /*creator=*/false));
+}
+
+Status SharedMemorySegment::Unlink(const std::string& name) {
+  if (shm_unlink(name.c_str()) != 0) {
+    return errors::IOError(absl::StrCat("Failed to unlink ", name), errno);
+  }
+  return OkStatus();
+}
+
+SharedMemorySegment::SharedMemorySegment(void* memory, size_t size, int fd,
+                                         bool creator)
+    : memory_(memory),
+      size_(size),
+      fd_(fd),
+      creator_(creator),
+      closed_(&static_cast<SegmentHeader*>(memory)->closed) {
+  const SegmentHeader* header = static_cast<const SegmentHeader*>(memory);
+  char* rings = static_cast<char*>(memory) + SegmentHeaderSize();
+  requests_ = std::make_unique<SharedMemoryRing>(
+      rings, header->request_capacity, closed_,
+      [this]() { return IsPeerAlive(); });
+  responses_ = std::make_unique<SharedMemoryRing>(
+      rings + SharedMemoryRing::MemorySize(header->request_capacity),
+      header->response_capacity, closed_, [this]() { return IsPeerAlive(); });
+}
+
+SharedMemorySegment::~SharedMemorySegment() {
+  munmap(memory_, size_);
+  // Releases the lock of this process.
+  close(fd_);
+}
+
+bool SharedMemorySegment::IsPeerAlive() const {
+  const SegmentHeader* header = static_cast<const SegmentHeader*>(memory_);
+  if (creator_) {
+    // The other process may not have opened the segment yet.
+    return !header->opener_locked.load(std::memory_order_acquire) ||
+           IsByteLocked(fd_, kOpenerLockByte);
+  }
+  return !header->creator_locked || IsByteLocked(fd_, kCreatorLockByte);
+}
+
+void SharedMemorySegment::Close() {
+  closed_->store(1, std::memory_order_release);
+  requests_->WakeAll();
+  responses_->WakeAll();
+}
+
+bool SharedMemorySegment::IsClosed() const {
+  return closed_->load(std::memory_order_acquire);
+}
+
+namespace {
+
+// Writes the result of a `GetElement` call to `ring`. Tensors of types which
+// can be copied with `memcpy` are written as is, others as `TensorProto`s.
+Status WriteResponse(const Status& status, const GetElementResult& result,
+                     SharedMemoryRing& ring) {
+  SharedMemoryElementHeader header;
+  std::vector<std::string> serialized(result.components.size());
+  if (!status.ok()) {
+    header.set_error_code(static_cast<int32>(status.code()));
+    header.set_error_message(status.error_message());
+  } else {
+    header.set_end_of_sequence(result.end_of_sequence);
+    header.set_skip(result.skip);
+    header.set_element_index(result.element_index);
+    for (int i = 0; i < result.components.size(); ++i) {
+      const Tensor& tensor = result.components[i];
+      SharedMemoryElementHeader::Component* component =
+          header.add_components();
+      component->set_dtype(tensor.dtype());
+      tensor.shape().AsProto(component->mutable_shape());
+      if (DataTypeCanUseMemcpy(tensor.dtype())) {
+        component->set_num_bytes(tensor.tensor_data().size());
+      } else {
+        TensorProto proto;
+        tensor.AsProtoTensorContent(&proto);
+        serialized[i] = proto.SerializeAsString();
+        component->set_serialized(true);
+        component->set_num_bytes(serialized[i].size());
+      }
+    }
+  }
+  TF_RETURN_IF_ERROR(WriteFrame(ring, header.SerializeAsString()));
+  for (int i = 0; i < header.components_size(); ++i) {
+    if (header.components(i).serialized()) {
+      TF_RETURN_IF_ERROR(
+          ring.Write(serialized[i].data(), serialized[i].size()));
+    } else {
+      StringPiece data = result.components[i].tensor_data();
+      TF_RETURN_IF_ERROR(ring.Write(data.data(), data.size()));
+    }
+  }
+  return OkStatus();
+}
+
+// Reads a response written by `WriteResponse` from `ring` into `result`, and
+// the status of the `GetElement` call into `element_status`.
+Status ReadResponse(SharedMemoryRing& ring, GetElementResult& result,
+                    Status& element_status) {
+  std::string header_bytes;
+  TF_RETURN_IF_ERROR(ReadFrame(ring, &header_bytes));
+  SharedMemoryElementHeader header;
+  if (!header.ParseFromString(header_bytes)) {
+    return errors::DataLoss("Failed to parse element header.");
+  }
+  result.end_of_sequence = header.end_of_sequence();
+  result.skip = header.skip();
+  result.element_index = header.element_index();
+  result.components.clear();
+  result.components.reserve(header.components_size());
+  for (const auto& component : header.components()) {
+    TensorShape shape;
+    TF_RETURN_IF_ERROR(
+        TensorShape::BuildTensorShape(component.shape(), &shape));
+    if (!component.serialized()) {
+      Tensor tensor(component.dtype(), shape);
+      StringPiece data = tensor.tensor_data();
+      if (data.size() != component.num_bytes()) {
+        return errors::DataLoss("Expected ", data.size(), " bytes but got ",
+                                component.num_bytes(), ".");
+      }
+      // Reads the tensor contents directly into its buffer.
+      TF_RETURN_IF_ERROR(
+          ring.Read(const_cast<char*>(data.data()), data.size()));
+      result.components.push_back(std::move(tensor));
+      continue;
+    }
+    if (component.num_bytes() > kMaxFrameBytes) {
+      return errors::DataLoss("Invalid component of ", component.num_bytes(),
+                              " bytes.");
+    }
+    std::string bytes(component.num_bytes(), '\0');
+    TF_RETURN_IF_ERROR(ring.Read(bytes.data(), bytes.size()));
+    TensorProto proto;
+    result.components.emplace_back();
+    if (!proto.ParseFromString(bytes) ||
+        !result.components.back().FromProto(proto)) {
+      return errors::Internal("Failed to parse tensor.");
+    }
+  }
+  if (header.error_code() != 0) {
+    element_status = Status(static_cast<error::Code>(header.error_code()),
+                            header.error_message());
+  }
+  return OkStatus();
+}
+
+class SharedMemoryDataTransferServer
+    : public DataTransferServer,
+      public SharedMemoryTransferService::Service {
+ public:
+  explicit SharedMemoryDataTransferServer(
+      DataTransferServer::GetElementT get_element)
+      : get_element_(std::move(get_element)) {}
+
+  ~SharedMemoryDataTransferServer() override {
+    if (server_) {
+      server_->Shutdown();
+    }
+    std::vector<std::unique_ptr<Connection>> connections;
+    {
+      mutex_lock l(mu_);
+      for (auto& connection : connections_) {
+        if (connection->segment) connection->segment->Close();
+      }
+      connections.swap(connections_);
+    }
+    // Joins the serving threads, which lock `mu_` as they stop.
+    connections.clear();
+  }
+
+  Status Start() override {
+    ::grpc::ServerBuilder builder;
+    // The control channel only carries the names of segments on the worker's
+    // host, which the worker validates before opening them. It only listens on
+    // the loopback interface, since clients run on the same host.
+    builder.AddListeningPort("localhost:0", ::grpc::InsecureServerCredentials(),
+                             &port_);
+    builder.RegisterService(this);
+    server_ = builder.BuildAndStart();
+    if (!server_) {
+      return errors::Internal(
+          "Could not start the shared memory data transfer server.");
+    }
+    return OkStatus();
+  }
+
+  int get_port() override { return port_; }
+
+  ::grpc::Status Connect(::grpc::ServerContext* ctx, const ConnectRequest* req,
+                         ConnectResponse* resp) override {
+    const std::string& name = req->segment_name();
+    if (!absl::StartsWith(name, kSegmentNamePrefix) ||
+        name.find('/', 1) != std::string::npos) {
+      return ToGrpcStatus(errors::InvalidArgument(
+          "Invalid shared memory segment name: ", name));
+    }
+    StatusOr<std::unique_ptr<SharedMemorySegment>> segment =
+        SharedMemorySegment::Open(name);
+    if (!segment.ok()) {
+      return ToGrpcStatus(errors::FailedPrecondition(
+          "Failed to open the shared memory segment of the client. The "
+          "shared memory data transfer protocol requires clients to run on "
+          "the same host as the worker: ",
+          segment.status().ToString()));
+    }
+
+    mutex_lock l(mu_);
+    // Removes the connections whose client is gone.
+    connections_.erase(
+        std::remove_if(connections_.begin(), connections_.end(),
+                       [](const std::unique_ptr<Connection>& connection) {
+                         return connection->done.load();
+                       }),
+        connections_.end());
+    auto connection = std::make_unique<Connection>();
+    connection->segment = *std::move(segment);
+    Connection* connection_ptr = connection.get();
+    connection->thread = absl::WrapUnique(Env::Default()->StartThread(
+        {}, "tf_data_shm_transfer",
+        [this, connection_ptr]() { Serve(*connection_ptr); }));
+    connections_.push_back(std::move(connection));
+    return ::grpc::Status::OK;
+  }
+
+ private:
+  struct Connection {
+    // Released when `thread` stops serving it. Guarded by the `mu_` of the
+    // server.
+    std::unique_ptr<SharedMemorySegment> segment;
+    std::unique_ptr<Thread> thread;
+    // Set when `thread` has stopped serving the segment.
+    std::atomic<bool> done{false};
+  };
+
+  // Serves the requests written to the segment of `connection` until it is
+  // closed, or the client is gone.
+  void Serve(Connection& connection) {
+    SharedMemorySegment* segment_ptr;
+    {
+      mutex_lock l(mu_);
+      segment_ptr = connection.segment.get();
+    }
+    SharedMemorySegment& segment = *segment_ptr;
+    while (true) {
+      std::string request_bytes;
+      if (!ReadFrame(segment.requests(), &request_bytes).ok()) break;
+      GetElementRequest request;
+      GetElementResult result;
+      Status status;
+      if (request.ParseFromString(request_bytes)) {
+        status = get_element_(&request, &result);
+      } else {
+        status = errors::DataLoss("Failed to parse GetElementRequest.");
+      }
+      if (!WriteResponse(status, result, segment.responses()).ok()) break;
+    }
+    VLOG(2) << "Stopped serving a shared memory data transfer client.";
+    // Unmaps the segment right away, instead of when the connection is
+    // removed.
+    mutex_lock l(mu_);
+    connection.segment->Close();
+    connection.segment.reset();
+    connection.done = true;
+  }
+
+  const DataTransferServer::GetElementT get_element_;
+  int port_ = 0;
+  std::unique_ptr<::grpc::Server> server_;
+
+  mutex mu_;
+  std::vector<std::unique_ptr<Connection>> connections_ TF_GUARDED_BY(mu_);
+};
+
+class SharedMemoryDataTransferClient : public DataTransferClient {
+ public:
+  static StatusOr<std::unique_ptr<DataTransferClient>> Create(
+      const std::string& address) {
+    const std::string name =
+        absl::StrCat(kSegmentNamePrefix, Env::Default()->GetProcessId(), "_",
+                     random::New64());
+    TF_ASSIGN_OR_RETURN(
+        std::unique_ptr<SharedMemorySegment> segment,
+        SharedMemorySegment::Create(name, kRequestRingCapacityBytes,
+                                    kResponseRingCapacityBytes));
+
+    // The server only listens on the loopback interface of the worker's host,
+    // which is the client's.
+    const size_t port_start = address.rfind(':');
+    if (port_start == std::string::npos) {
+      return errors::InvalidArgument(
+          "Invalid shared memory data transfer server address: ", address);
+    }
+    const std::string local_address =
+        absl::StrCat("localhost", address.substr(port_start));
+    grpc::ChannelArguments args;
+    auto channel = grpc::CreateCustomChannel(
+        local_address, grpc::InsecureChannelCredentials(), args);
+    auto stub = SharedMemoryTransferService::NewStub(channel);
+    grpc::ClientContext ctx;
+    ConnectRequest req;
+    req.set_segment_name(name);
+    ConnectResponse resp;
+    grpc::Status s = stub->Connect(&ctx, req, &resp);
+    // Both processes have mapped the segment, or the worker failed to, so its
+    // name is no longer needed.
+    TF_RETURN_IF_ERROR(SharedMemorySegment::Unlink(name));
+    if (!s.ok()) {
+      return grpc_util::WrapError(
+          absl::StrCat("Failed to connect to shared memory data transfer "
+                       "server at ",
+                       address),
+          s);
+    }
+    VLOG(2) << "Created SharedMemoryDataTransferClient for worker " << address
+            << ".";
+    return absl::WrapUnique<DataTransferClient>(
+        new SharedMemoryDataTransferClient(std::move(segment)));
+  }
+
+  ~SharedMemoryDataTransferClient() override { segment_->Close(); }
+
+  Status GetElement(const GetElementRequest& req,
+                    GetElementResult& result) override {
+    VLOG(3) << "GetElement for task " << req.task_id()
+            << " through shared memory.";
+    mutex_lock l(mu_);
+    if (segment_->IsClosed()) {
+      return errors::Cancelled("Client was cancelled.");
+    }
+    Status status = WriteFrame(segment_->requests(), req.SerializeAsString());
+    Status element_status;
+    if (status.ok()) {
+      status = ReadResponse(segment_->responses(), result, element_status);
+    }
+    if (!status.ok()) {
+      // The rings may hold a partial frame, e.g. if the worker is gone, so
+      // they cannot be used anymore.
+      segment_->Close();
+      return status;
+    }
+    return element_status;
+  }
+
+  void TryCancel() override {
+    VLOG(2) << "Cancel SharedMemoryDataTransferClient.";
+    segment_->Close();
+  }
+
+ private:
+  explicit SharedMemoryDataTransferClient(
+      std::unique_ptr<SharedMemorySegment> segment)
+      : segment_(std::move(segment)) {}
+
+  const std::unique_ptr<SharedMemorySegment> segment_;
+  // Serializes requests, since each ring has a single producer and consumer.
+  mutex mu_;
+};
+
+class SharedMemoryTransferRegistrar {
+ public:
+  SharedMemoryTransferRegistrar() {
+    DataTransferServer::Register(
+        kSharedMemoryTransferProtocol,
+        [](DataTransferServer::GetElementT get_element) {
+          return std::make_shared<SharedMemoryDataTransferServer>(
+              std::move(get_element));
+        });
+    DataTransferClient::Register(
+        kSharedMemoryTransferProtocol,
+        [](DataTransferClient::Config config,
+           std::unique_ptr<DataTransferClient>* out) {
+          TF_ASSIGN_OR_RETURN(
+              *out, SharedMemoryDataTransferClient::Create(config.address));
+          return OkStatus();
+        });
+  }
+};
+static SharedMemoryTransferRegistrar shm_transfer_registrar;
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
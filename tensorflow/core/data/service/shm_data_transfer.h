@@ -0,0 +1,154 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+
+// Data transfer protocol for clients running on the same host as the worker.
+//
+// A client creates a shared memory segment holding two rings, one for requests
+// and one for responses, and asks the worker to attach to it through the
+// `SharedMemoryTransferService` gRPC service. gRPC is only used for this
+// handshake: requests and uncompressed elements are then exchanged through the
+// segment, without serializing tensor buffers.
+constexpr const char kSharedMemoryTransferProtocol[] = "shm";
+
+// A lock-free byte ring with a single producer and a single consumer, which may
+// run in different processes. The ring does not own its memory.
+//
+// SharedMemoryRing is thread-compatible: `Write` and `Read` may be called
+// concurrently, but not `Write` (resp. `Read`) from several threads.
+class SharedMemoryRing {
+ public:
+  // Returns the number of bytes of memory needed by a ring buffering up to
+  // `capacity` bytes.
+  static size_t MemorySize(size_t capacity);
+
+  // Initializes a ring in `memory`, which must hold `MemorySize(capacity)`
+  // bytes aligned to a cache line.
+  static void Initialize(void* memory);
+
+  // Accesses a ring initialized in `memory`. `closed` is checked while waiting
+  // for the other end of the ring; once it is set, waiting calls return a
+  // `Cancelled` error. `peer_alive`, if set, is called periodically while
+  // blocked; once it returns false, waiting calls return an `Unavailable`
+  // error.
+  SharedMemoryRing(void* memory, size_t capacity,
+                   const std::atomic<uint32_t>* closed,
+                   std::function<bool()> peer_alive = nullptr);
+
+  // Writes `size` bytes to the ring, waiting for the consumer to make room.
+  Status Write(const void* data, size_t size);
+
+  // Reads `size` bytes from the ring, waiting for the producer to write them.
+  Status Read(void* data, size_t size);
+
+  // Wakes the blocked `Write` and `Read` calls of both processes, e.g. for
+  // them to see that the ring was closed.
+  void WakeAll();
+
+ private:
+  struct Header;
+
+  // Waits until `ready` returns true, the ring is closed or the other end is
+  // gone. Spins for a while, then blocks until the other end signals `event`,
+  // counting itself in `num_blocked` meanwhile.
+  template <typename Predicate>
+  Status WaitUntil(Predicate ready, std::atomic<uint32_t>& event,
+                   std::atomic<uint32_t>& num_blocked) const;
+
+  // Signals `event`, waking the `num_blocked` waiters, if any.
+  static void Signal(std::atomic<uint32_t>& event,
+                     const std::atomic<uint32_t>& num_blocked);
+
+  Header* const header_;
+  char* const data_;
+  const size_t capacity_;
+  const std::atomic<uint32_t>* const closed_;
+  const std::function<bool()> peer_alive_;
+};
+
+// A shared memory segment holding a request ring and a response ring. The
+// segment is unmapped when the object is destroyed.
+//
+// The processes which created and opened the segment each lock a byte of it
+// while they map it, so that the ring operations of one fail with an
+// `Unavailable` error once the other is gone, even if it crashed without
+// closing the segment.
+class SharedMemorySegment {
+ public:
+  // Creates a segment named `name` whose rings buffer up to
+  // `request_capacity` and `response_capacity` bytes respectively.
+  static StatusOr<std::unique_ptr<SharedMemorySegment>> Create(
+      const std::string& name, size_t request_capacity,
+      size_t response_capacity);
+
+  // Opens a segment created by `Create`.
+  static StatusOr<std::unique_ptr<SharedMemorySegment>> Open(
+      const std::string& name);
+
+  // Removes the name of the segment. The memory is released once every process
+  // has unmapped it.
+  static Status Unlink(const std::string& name);
+
+  ~SharedMemorySegment();
+  SharedMemorySegment(const SharedMemorySegment&) = delete;
+  SharedMemorySegment& operator=(const SharedMemorySegment&) = delete;
+
+  // Ring carrying requests from the client to the worker.
+  SharedMemoryRing& requests() { return *requests_; }
+  // Ring carrying responses from the worker to the client.
+  SharedMemoryRing& responses() { return *responses_; }
+
+  // Closes the segment, causing pending and future ring operations of both
+  // processes to fail.
+  void Close();
+  bool IsClosed() const;
+
+  // Returns false if the other process mapping the segment is gone.
+  bool IsPeerAlive() const;
+
+ private:
+  SharedMemorySegment(void* memory, size_t size, int fd, bool creator);
+
+  void* const memory_;
+  const size_t size_;
+  // Holds the lock of this process.
+  const int fd_;
+  // Whether this process created the segment, rather than opened it.
+  const bool creator_;
+  // Shared by both processes.
+  std::atomic<uint32_t>* const closed_;
+  std::unique_ptr<SharedMemoryRing> requests_;
+  std::unique_ptr<SharedMemoryRing> responses_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
@@ -0,0 +1,247 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_data_transfer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+std::string TestSegmentName() {
+  return absl::StrCat("/tf_data_shm_test_", Env::Default()->GetProcessId(),
+                      "_", random::New64());
+}
+
+TEST(SharedMemoryRingTest, WrapsAround) {
+  const std::string name = TestSegmentName();
+  // Rings much smaller than the data written to them.
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> writer,
+                          SharedMemorySegment::Create(name, 7, 13));
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> reader,
+                          SharedMemorySegment::Open(name));
+  TF_ASSERT_OK(SharedMemorySegment::Unlink(name));
+
+  std::string data(10000, '\0');
+  for (int i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(i % 251);
+  }
+  std::unique_ptr<Thread> thread(Env::Default()->StartThread(
+      ThreadOptions(), "writer", [&writer, &data]() {
+        for (int i = 0; i < data.size(); i += 10) {
+          TF_ASSERT_OK(writer->responses().Write(data.data() + i, 10));
+        }
+      }));
+  std::string read(data.size(), '\0');
+  for (int i = 0; i < read.size(); i += 25) {
+    TF_ASSERT_OK(reader->responses().Read(read.data() + i, 25));
+  }
+  thread.reset();
+  EXPECT_EQ(read, data);
+}
+
+TEST(SharedMemoryRingTest, ReadFromClosedSegment) {
+  const std::string name = TestSegmentName();
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> segment,
+                          SharedMemorySegment::Create(name, 16, 16));
+  TF_ASSERT_OK(SharedMemorySegment::Unlink(name));
+  segment->Close();
+  EXPECT_TRUE(segment->IsClosed());
+  char byte;
+  EXPECT_TRUE(errors::IsCancelled(segment->requests().Read(&byte, 1)));
+}
+
+TEST(SharedMemoryRingTest, BlockedReadWakesOnWrite) {
+  const std::string name = TestSegmentName();
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> segment,
+                          SharedMemorySegment::Create(name, 16, 16));
+  TF_ASSERT_OK(SharedMemorySegment::Unlink(name));
+  char byte = 0;
+  std::unique_ptr<Thread> reader(Env::Default()->StartThread(
+      ThreadOptions(), "reader", [&segment, &byte]() {
+        TF_ASSERT_OK(segment->requests().Read(&byte, 1));
+      }));
+  // Lets the reader block on the empty ring.
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  const char written = 42;
+  TF_ASSERT_OK(segment->requests().Write(&written, 1));
+  reader.reset();
+  EXPECT_EQ(byte, written);
+}
+
+TEST(SharedMemoryRingTest, BlockedReadWakesOnClose) {
+  const std::string name = TestSegmentName();
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> segment,
+                          SharedMemorySegment::Create(name, 16, 16));
+  TF_ASSERT_OK(SharedMemorySegment::Unlink(name));
+  Status status;
+  std::unique_ptr<Thread> reader(Env::Default()->StartThread(
+      ThreadOptions(), "reader", [&segment, &status]() {
+        char byte;
+        status = segment->requests().Read(&byte, 1);
+      }));
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  segment->Close();
+  reader.reset();
+  EXPECT_TRUE(errors::IsCancelled(status)) << status;
+}
+
+#if defined(F_OFD_GETLK)
+TEST(SharedMemoryRingTest, BlockedReadFailsOnceThePeerIsGone) {
+  const std::string name = TestSegmentName();
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> client,
+                          SharedMemorySegment::Create(name, 16, 16));
+  // The worker has not opened the segment yet.
+  EXPECT_TRUE(client->IsPeerAlive());
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemorySegment> worker,
+                          SharedMemorySegment::Open(name));
+  TF_ASSERT_OK(SharedMemorySegment::Unlink(name));
+  EXPECT_TRUE(client->IsPeerAlive());
+  EXPECT_TRUE(worker->IsPeerAlive());
+
+  // E.g. the client crashed without closing the segment.
+  client.reset();
+  EXPECT_FALSE(worker->IsPeerAlive());
+  char byte;
+  EXPECT_TRUE(errors::IsUnavailable(worker->requests().Read(&byte, 1)));
+}
+#endif  // defined(F_OFD_GETLK)
+
+TEST(SharedMemorySegmentTest, OpenMissingSegment) {
+  EXPECT_FALSE(SharedMemorySegment::Open(TestSegmentName()).ok());
+}
+
+TEST(SharedMemorySegmentTest, CreateRejectsZeroCapacity) {
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      SharedMemorySegment::Create(TestSegmentName(), 0, 16).status()));
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      SharedMemorySegment::Create(TestSegmentName(), 16, 0).status()));
+}
+
+TEST(SharedMemorySegmentTest, OpenRejectsZeroCapacity) {
+  // A segment with a valid magic number but rings of no capacity.
+  const std::string name = TestSegmentName();
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  ASSERT_GE(fd, 0);
+  std::vector<uint64_t> header(512, 0);
+  header[0] = 0x7466646174617368;  // "tfdatash"
+  const size_t size = header.size() * sizeof(uint64_t);
+  ASSERT_EQ(write(fd, header.data(), size), size);
+  close(fd);
+
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(SharedMemorySegment::Open(name).status()));
+  TF_ASSERT_OK(SharedMemorySegment::Unlink(name));
+}
+
+class SharedMemoryDataTransferTest : public ::testing::Test {
+ protected:
+  void StartServer(DataTransferServer::GetElementT get_element) {
+    TF_ASSERT_OK(DataTransferServer::Build(kSharedMemoryTransferProtocol,
+                                           std::move(get_element), &server_));
+    TF_ASSERT_OK(server_->Start());
+    TF_ASSERT_OK(DataTransferClient::Build(
+        kSharedMemoryTransferProtocol,
+        {kSharedMemoryTransferProtocol,
+         absl::StrCat("localhost:", server_->get_port())},
+        &client_));
+  }
+
+  std::shared_ptr<DataTransferServer> server_;
+  std::unique_ptr<DataTransferClient> client_;
+};
+
+TEST_F(SharedMemoryDataTransferTest, GetElements) {
+  StartServer([](const GetElementRequest* request, GetElementResult* result) {
+    result->components.push_back(
+        test::AsTensor<int64_t>({request->task_id(), 2, 3}, {3}));
+    result->components.push_back(test::AsScalar<tstring>("element"));
+    result->element_index = request->task_id();
+    return OkStatus();
+  });
+
+  for (int64_t i = 0; i < 10; ++i) {
+    GetElementRequest request;
+    request.set_task_id(i);
+    GetElementResult result;
+    TF_ASSERT_OK(client_->GetElement(request, result));
+    EXPECT_EQ(result.element_index, i);
+    EXPECT_FALSE(result.end_of_sequence);
+    ASSERT_EQ(result.components.size(), 2);
+    test::ExpectEqual(result.components[0],
+                      test::AsTensor<int64_t>({i, 2, 3}, {3}));
+    test::ExpectEqual(result.components[1],
+                      test::AsScalar<tstring>("element"));
+  }
+}
+
+TEST_F(SharedMemoryDataTransferTest, EndOfSequence) {
+  StartServer([](const GetElementRequest*, GetElementResult* result) {
+    result->end_of_sequence = true;
+    return OkStatus();
+  });
+
+  GetElementResult result;
+  TF_ASSERT_OK(client_->GetElement(GetElementRequest(), result));
+  EXPECT_TRUE(result.end_of_sequence);
+  EXPECT_TRUE(result.components.empty());
+}
+
+TEST_F(SharedMemoryDataTransferTest, PropagatesErrors) {
+  StartServer([](const GetElementRequest*, GetElementResult*) {
+    return errors::FailedPrecondition("Worker error.");
+  });
+
+  GetElementResult result;
+  Status status = client_->GetElement(GetElementRequest(), result);
+  EXPECT_TRUE(errors::IsFailedPrecondition(status));
+  EXPECT_EQ(status.error_message(), "Worker error.");
+}
+
+TEST_F(SharedMemoryDataTransferTest, Cancel) {
+  StartServer([](const GetElementRequest*, GetElementResult*) {
+    return OkStatus();
+  });
+
+  client_->TryCancel();
+  GetElementResult result;
+  EXPECT_TRUE(
+      errors::IsCancelled(client_->GetElement(GetElementRequest(), result)));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -37,6 +37,7 @@ constexpr const char kSplitsDirectoryName[] = "splits";
 constexpr const char kCheckpointsDirectoryName[] = "checkpoints";
 constexpr const char kCommittedChunksDirectoryName[] = "chunks";
 constexpr const char kUncommittedChunksDirectoryName[] = "uncommitted_chunks";
+constexpr const char kChunkIndicesDirectoryName[] = "chunk_indices";
 
 }  // namespace
 
@@ -116,6 +117,16 @@ std::string CommittedChunksDirectory(absl::string_view snapshot_path) {
   return tsl::io::JoinPath(snapshot_path, kCommittedChunksDirectoryName);
 }
 
+std::string ChunkIndicesDirectory(absl::string_view snapshot_path) {
+  return tsl::io::JoinPath(snapshot_path, kChunkIndicesDirectoryName);
+}
+
+std::string ChunkIndexFilePath(absl::string_view snapshot_path,
+                               absl::string_view chunk_filename) {
+  return tsl::io::JoinPath(ChunkIndicesDirectory(snapshot_path),
+                           chunk_filename);
+}
+
 std::string UncommittedChunksDirectory(absl::string_view snapshot_path,
                                        int64_t stream_index) {
   return tsl::io::JoinPath(StreamDirectory(snapshot_path, stream_index),
@@ -70,6 +70,13 @@ std::string CheckpointsDirectory(absl::string_view snapshot_path,
 // Returns the directory path for committed chunks.
 std::string CommittedChunksDirectory(absl::string_view snapshot_path);
 
+// Returns the directory path for the indices of committed chunks.
+std::string ChunkIndicesDirectory(absl::string_view snapshot_path);
+
+// Returns the path of the index of the committed chunk `chunk_filename`.
+std::string ChunkIndexFilePath(absl::string_view snapshot_path,
+                               absl::string_view chunk_filename);
+
 // Returns the directory path for uncommitted chunks.
 std::string UncommittedChunksDirectory(absl::string_view snapshot_path,
                                        int64_t stream_index);
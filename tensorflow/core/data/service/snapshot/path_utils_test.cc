@@ -110,6 +110,16 @@ TEST(PathUtilsTest, CommittedChunksDirectory) {
               MatchesRegex("/path/to/snapshot.chunks"));
 }
 
+TEST(PathUtilsTest, ChunkIndicesDirectory) {
+  EXPECT_THAT(ChunkIndicesDirectory("/path/to/snapshot"),
+              MatchesRegex("/path/to/snapshot.chunk_indices"));
+}
+
+TEST(PathUtilsTest, ChunkIndexFilePath) {
+  EXPECT_THAT(ChunkIndexFilePath("/path/to/snapshot", "chunk_0_1"),
+              MatchesRegex("/path/to/snapshot.chunk_indices.chunk_0_1"));
+}
+
 TEST(PathUtilsTest, UncommittedChunksDirectory) {
   EXPECT_THAT(
       UncommittedChunksDirectory("/path/to/snapshot", /*stream_index=*/0),
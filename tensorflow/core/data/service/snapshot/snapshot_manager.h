@@ -42,6 +42,8 @@ namespace data {
 //   - dataset_def.proto
 //   - chunks
 //     - chunk_<stream_index>_<chunk_index>
+//   - chunk_indices
+//     - chunk_<stream_index>_<chunk_index>
 //   - streams
 //     - stream_0
 //       - DONE
@@ -14,12 +14,17 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/snapshot/snapshot_reader.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "tensorflow/core/data/service/common.h"
+#include "tensorflow/core/data/service/snapshot/path_utils.h"
 #include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
 #include "tensorflow/tsl/platform/env.h"
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/path.h"
@@ -28,6 +33,21 @@ limitations under the License.
 
 namespace tensorflow {
 namespace data {
+namespace {
+
+// Returns the paths of the committed chunks of the snapshot.
+StatusOr<std::vector<std::string>> GetCommittedChunkFiles(
+    const SnapshotReaderParams& params) {
+  std::string chunks_directory = params.CommittedChunksDirectory();
+  std::vector<string> chunk_files;
+  TF_RETURN_IF_ERROR(params.env->GetChildren(chunks_directory, &chunk_files));
+  for (std::string& chunk_file : chunk_files) {
+    chunk_file = tsl::io::JoinPath(chunks_directory, chunk_file);
+  }
+  return chunk_files;
+}
+
+}  // namespace
 
 SnapshotReader::SnapshotReader(const SnapshotReaderParams& params)
     : params_(params) {}
@@ -63,13 +83,7 @@ Status SnapshotReader::EnsureInitialized() {
 }
 
 StatusOr<std::vector<std::string>> SnapshotReader::GetChunkFiles() {
-  std::string chunks_directory = params_.CommittedChunksDirectory();
-  std::vector<string> chunk_files;
-  TF_RETURN_IF_ERROR(params_.env->GetChildren(chunks_directory, &chunk_files));
-  for (std::string& chunk_file : chunk_files) {
-    chunk_file = tsl::io::JoinPath(chunks_directory, chunk_file);
-  }
-  return chunk_files;
+  return GetCommittedChunkFiles(params_);
 }
 
 Status SnapshotReader::InitializeNextRecordReader() {
@@ -88,5 +102,75 @@ Status SnapshotReader::InitializeNextRecordReader() {
   return OkStatus();
 }
 
+SnapshotRandomAccessReader::SnapshotRandomAccessReader(
+    const SnapshotReaderParams& params)
+    : params_(params) {}
+
+Status SnapshotRandomAccessReader::Initialize() {
+  TF_ASSIGN_OR_RETURN(std::vector<std::string> chunk_files,
+                      GetCommittedChunkFiles(params_));
+  std::sort(chunk_files.begin(), chunk_files.end());
+
+  chunks_.clear();
+  cumulative_num_elements_.clear();
+  int64_t num_elements = 0;
+  for (std::string& chunk_file : chunk_files) {
+    std::string index_file_path = ChunkIndexFilePath(
+        params_.snapshot_path, tsl::io::Basename(chunk_file));
+    experimental::DistributedSnapshotChunkIndex index;
+    Status status = ReadBinaryProto(params_.env, index_file_path, &index);
+    if (!status.ok()) {
+      return errors::NotFound(
+          "Failed to read the index of distributed tf.data snapshot chunk ",
+          chunk_file, ": ", status.error_message(),
+          ". The snapshot may have been written without chunk indices.");
+    }
+    num_elements += index.element_offsets_size();
+    chunks_.push_back(
+        {std::move(chunk_file),
+         std::vector<uint64_t>(index.element_offsets().begin(),
+                               index.element_offsets().end())});
+    cumulative_num_elements_.push_back(num_elements);
+  }
+  current_chunk_index_ = -1;
+  tfrecord_reader_ = nullptr;
+  return OkStatus();
+}
+
+int64_t SnapshotRandomAccessReader::Cardinality() const {
+  return cumulative_num_elements_.empty() ? 0
+                                          : cumulative_num_elements_.back();
+}
+
+StatusOr<std::vector<Tensor>> SnapshotRandomAccessReader::Get(int64_t index) {
+  if (index < 0 || index >= Cardinality()) {
+    return errors::OutOfRange("Element index ", index,
+                              " is out of range for distributed tf.data "
+                              "snapshot ",
+                              params_.DebugString(), " with ", Cardinality(),
+                              " elements.");
+  }
+
+  const int64_t chunk_index =
+      std::upper_bound(cumulative_num_elements_.begin(),
+                       cumulative_num_elements_.end(), index) -
+      cumulative_num_elements_.begin();
+  const Chunk& chunk = chunks_[chunk_index];
+  if (chunk_index != current_chunk_index_) {
+    tfrecord_reader_ = std::make_unique<snapshot_util::TFRecordReader>(
+        chunk.file_path, params_.metadata.compression(), params_.output_types);
+    current_chunk_index_ = -1;
+    TF_RETURN_IF_ERROR(tfrecord_reader_->Initialize(params_.env));
+    current_chunk_index_ = chunk_index;
+  }
+
+  const int64_t index_in_chunk =
+      index - (chunk_index == 0 ? 0 : cumulative_num_elements_[chunk_index - 1]);
+  tfrecord_reader_->Seek(chunk.element_offsets[index_in_chunk]);
+  std::vector<Tensor> element;
+  TF_RETURN_IF_ERROR(tfrecord_reader_->ReadTensors(&element));
+  return element;
+}
+
 }  // namespace data
 }  // namespace tensorflow
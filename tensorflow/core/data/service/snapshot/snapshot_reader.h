@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/common.h"
 #include "tensorflow/core/data/service/snapshot/path_utils.h"
 #include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/protobuf/snapshot.pb.h"
 #include "tensorflow/tsl/platform/env.h"
@@ -95,6 +96,47 @@ class SnapshotReader {
   std::unique_ptr<snapshot_util::TFRecordReader> tfrecord_reader_;
 };
 
+// Reads the elements of a distributed tf.data snapshot by index, using the
+// chunk indices written by `SnapshotStreamWriter`. Element indices follow the
+// committed chunks sorted by file name, and the order of the elements within
+// each chunk. Seeking is constant time for uncompressed snapshots.
+// This class is not thread-safe.
+class SnapshotRandomAccessReader {
+ public:
+  explicit SnapshotRandomAccessReader(const SnapshotReaderParams& params);
+  virtual ~SnapshotRandomAccessReader() = default;
+  SnapshotRandomAccessReader(const SnapshotRandomAccessReader&) = delete;
+  SnapshotRandomAccessReader& operator=(const SnapshotRandomAccessReader&) =
+      delete;
+
+  // Reads the chunk indices. Returns NotFound if a committed chunk does not
+  // have an index.
+  Status Initialize();
+
+  // Returns the number of elements in the snapshot.
+  int64_t Cardinality() const;
+
+  // Reads the element at `index`. Returns OutOfRange if `index` is not in
+  // [0, `Cardinality()`).
+  StatusOr<std::vector<Tensor>> Get(int64_t index);
+
+ private:
+  struct Chunk {
+    std::string file_path;
+    std::vector<uint64_t> element_offsets;
+  };
+
+  const SnapshotReaderParams params_;
+
+  std::vector<Chunk> chunks_;
+  // The number of elements in `chunks_[0]` to `chunks_[i]`.
+  std::vector<int64_t> cumulative_num_elements_;
+
+  // The reader of the last chunk read from.
+  int64_t current_chunk_index_ = -1;
+  std::unique_ptr<snapshot_util::TFRecordReader> tfrecord_reader_;
+};
+
 }  // namespace data
 }  // namespace tensorflow
 
@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/task_runner.h"
 #include "tensorflow/core/data/service/test_util.h"
 #include "tensorflow/core/data/standalone.h"
+#include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/protobuf/snapshot.pb.h"
@@ -45,6 +46,7 @@ namespace {
 using ::testing::ElementsAre;
 using ::testing::IsEmpty;
 using ::testing::UnorderedElementsAre;
+using ::testing::ValuesIn;
 using ::tsl::testing::IsOkAndHolds;
 using ::tsl::testing::StatusIs;
 
@@ -149,6 +151,70 @@ TEST(SnapshotReaderTest, SnapshotDoesNotExist) {
               StatusIs(error::NOT_FOUND));
 }
 
+class SnapshotRandomAccessReaderTest
+    : public ::testing::TestWithParam<std::string> {
+ public:
+  std::string Compression() const { return GetParam(); }
+};
+
+TEST_P(SnapshotRandomAccessReaderTest, ReadElementsByIndex) {
+  int64_t range = 10;
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<StandaloneTaskIterator> iterator,
+                          TestIterator(testing::RangeDataset(range)));
+  TF_ASSERT_OK_AND_ASSIGN(std::string snapshot_path, CreateSnapshotDirectory());
+  SnapshotWriterParams writer_params{snapshot_path, /*stream_index=*/0,
+                                     Compression(), Env::Default(),
+                                     /*max_chunk_size_bytes=*/250};
+  SnapshotStreamWriter snapshot_writer(writer_params, std::move(iterator));
+  EXPECT_THAT(snapshot_writer.Wait(), IsOkAndHolds(true));
+
+  experimental::DistributedSnapshotMetadata metadata;
+  metadata.set_compression(Compression());
+  SnapshotReaderParams params{snapshot_path, metadata, DataTypeVector{DT_INT64},
+                              Env::Default()};
+  SnapshotRandomAccessReader reader(params);
+  TF_ASSERT_OK(reader.Initialize());
+  ASSERT_EQ(reader.Cardinality(), range);
+
+  std::vector<int64_t> forward, backward;
+  for (int64_t i = 0; i < range; ++i) {
+    TF_ASSERT_OK_AND_ASSIGN(std::vector<Tensor> element, reader.Get(i));
+    forward.push_back(element[0].unaligned_flat<int64_t>().data()[0]);
+  }
+  for (int64_t i = range - 1; i >= 0; --i) {
+    TF_ASSERT_OK_AND_ASSIGN(std::vector<Tensor> element, reader.Get(i));
+    backward.insert(backward.begin(),
+                    element[0].unaligned_flat<int64_t>().data()[0]);
+  }
+  EXPECT_THAT(forward, UnorderedElementsAre(0, 1, 2, 3, 4, 5, 6, 7, 8, 9));
+  EXPECT_EQ(forward, backward);
+}
+
+TEST_P(SnapshotRandomAccessReaderTest, IndexOutOfRange) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<StandaloneTaskIterator> iterator,
+                          TestIterator(testing::RangeDataset(10)));
+  TF_ASSERT_OK_AND_ASSIGN(std::string snapshot_path, CreateSnapshotDirectory());
+  SnapshotWriterParams writer_params{snapshot_path, /*stream_index=*/0,
+                                     Compression(), Env::Default()};
+  SnapshotStreamWriter snapshot_writer(writer_params, std::move(iterator));
+  EXPECT_THAT(snapshot_writer.Wait(), IsOkAndHolds(true));
+
+  experimental::DistributedSnapshotMetadata metadata;
+  metadata.set_compression(Compression());
+  SnapshotReaderParams params{snapshot_path, metadata, DataTypeVector{DT_INT64},
+                              Env::Default()};
+  SnapshotRandomAccessReader reader(params);
+  TF_ASSERT_OK(reader.Initialize());
+  EXPECT_THAT(reader.Get(-1), StatusIs(error::OUT_OF_RANGE));
+  EXPECT_THAT(reader.Get(10), StatusIs(error::OUT_OF_RANGE));
+}
+
+INSTANTIATE_TEST_SUITE_P(Compression, SnapshotRandomAccessReaderTest,
+                         ValuesIn<std::string>({tsl::io::compression::kNone,
+                                                tsl::io::compression::kGzip,
+                                                tsl::io::compression::kSnappy,
+                                                tsl::io::compression::kZlib}));
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
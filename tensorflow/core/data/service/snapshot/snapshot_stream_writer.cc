@@ -15,8 +15,10 @@ limitations under the License.
 #include "tensorflow/core/data/service/snapshot/snapshot_stream_writer.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
@@ -24,6 +26,8 @@ limitations under the License.
 #include <vector>
 
 #include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/snapshot/file_utils.h"
 #include "tensorflow/core/data/service/snapshot/path_utils.h"
 #include "tensorflow/core/data/service/snapshot/utils.h"
@@ -32,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
 #include "tensorflow/tsl/platform/env.h"
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/mutex.h"
@@ -61,6 +66,135 @@ StatusOr<int64_t> GetFileIndex(const std::string& filename,
 
 constexpr int64_t SnapshotWriterParams::kDefaultMaxChunkSizeBytes;
 
+// Writes the elements of one chunk on a separate thread, so compressing and
+// writing several chunks happen in parallel with producing the elements.
+class SnapshotStreamWriter::ChunkWriter {
+ public:
+  ChunkWriter(const SnapshotWriterParams& params, std::string file_path)
+      : params_(params),
+        writer_(std::move(file_path), params.compression) {}
+
+  ~ChunkWriter() { Close().IgnoreError(); }
+
+  // Creates the chunk file and starts the writer thread.
+  Status Initialize() {
+    TF_RETURN_IF_ERROR(writer_.Initialize(params_.env));
+    thread_ = absl::WrapUnique(params_.env->StartThread(
+        /*thread_options=*/{}, /*name=*/"tf_data_service_snapshot_chunk_writer",
+        [this]() { WriteElements(); }));
+    return OkStatus();
+  }
+
+  // Buffers `element` to be written. Blocks while the buffer is full.
+  Status Write(std::vector<Tensor> element) TF_LOCKS_EXCLUDED(mu_) {
+    const int64_t size_bytes = EstimatedSizeBytes(element);
+    mutex_lock l(mu_);
+    while (status_.ok() && buffered_bytes_ > kMaxBufferedBytes) {
+      cv_.wait(l);
+    }
+    TF_RETURN_IF_ERROR(status_);
+    buffer_.push_back({std::move(element), size_bytes});
+    buffered_bytes_ += size_bytes;
+    size_bytes_ += size_bytes;
+    cv_.notify_all();
+    return OkStatus();
+  }
+
+  // Waits for the buffered elements to be written and closes the file.
+  Status Close() TF_LOCKS_EXCLUDED(mu_) {
+    {
+      mutex_lock l(mu_);
+      closed_ = true;
+      cv_.notify_all();
+    }
+    thread_.reset();
+    mutex_lock l(mu_);
+    return status_;
+  }
+
+  // The number of bytes not written yet.
+  int64_t buffered_bytes() const TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    return buffered_bytes_;
+  }
+
+  // The number of bytes written to the chunk, including buffered bytes.
+  int64_t size_bytes() const TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    return size_bytes_;
+  }
+
+  // The time spent writing to the file.
+  absl::Duration write_time() const TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    return write_time_;
+  }
+
+  // The offsets of the elements written to the chunk.
+  experimental::DistributedSnapshotChunkIndex index() const
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    return index_;
+  }
+
+ private:
+  // Maximum number of bytes buffered before `Write` blocks.
+  static constexpr int64_t kMaxBufferedBytes = 64 * (int64_t{1} << 20);  // 64MB
+
+  void WriteElements() TF_LOCKS_EXCLUDED(mu_) {
+    while (true) {
+      std::pair<std::vector<Tensor>, int64_t> element;
+      bool failed = false;
+      {
+        mutex_lock l(mu_);
+        while (buffer_.empty() && !closed_) {
+          cv_.wait(l);
+        }
+        if (buffer_.empty()) {
+          break;
+        }
+        element = std::move(buffer_.front());
+        buffer_.pop_front();
+        failed = !status_.ok();
+      }
+
+      // Drops the remaining elements after an error.
+      const absl::Time start_time = absl::Now();
+      const uint64_t offset = writer_.offset();
+      Status status = failed ? OkStatus() : writer_.WriteTensors(element.first);
+      mutex_lock l(mu_);
+      write_time_ += absl::Now() - start_time;
+      if (!failed && status.ok()) {
+        index_.add_element_offsets(offset);
+      }
+      buffered_bytes_ -= element.second;
+      status_.Update(status);
+      cv_.notify_all();
+    }
+
+    const absl::Time start_time = absl::Now();
+    Status status = writer_.Close();
+    mutex_lock l(mu_);
+    write_time_ += absl::Now() - start_time;
+    status_.Update(status);
+  }
+
+  const SnapshotWriterParams& params_;
+  snapshot_util::TFRecordWriter writer_;
+
+  mutable mutex mu_;
+  condition_variable cv_;
+  std::deque<std::pair<std::vector<Tensor>, int64_t>> buffer_
+      TF_GUARDED_BY(mu_);
+  int64_t buffered_bytes_ TF_GUARDED_BY(mu_) = 0;
+  int64_t size_bytes_ TF_GUARDED_BY(mu_) = 0;
+  absl::Duration write_time_ TF_GUARDED_BY(mu_);
+  experimental::DistributedSnapshotChunkIndex index_ TF_GUARDED_BY(mu_);
+  bool closed_ TF_GUARDED_BY(mu_) = false;
+  Status status_ TF_GUARDED_BY(mu_);
+  std::unique_ptr<Thread> thread_;
+};
+
 SnapshotStreamWriter::SnapshotStreamWriter(
     const SnapshotWriterParams& params, std::unique_ptr<TaskIterator> iterator)
     : params_(params), iterator_(std::move(iterator)) {
@@ -101,7 +235,7 @@ Status SnapshotStreamWriter::WriteSnapshot() TF_LOCKS_EXCLUDED(mu_) {
   TF_RETURN_IF_ERROR(InitializeDirectories());
   TF_RETURN_IF_ERROR(Restore());
   while (ShouldWriteChunk()) {
-    TF_RETURN_IF_ERROR(WriteChunk());
+    TF_RETURN_IF_ERROR(WriteChunks());
   }
   mutex_lock l(mu_);
   return completed_.status();
@@ -118,6 +252,8 @@ Status SnapshotStreamWriter::InitializeDirectories() {
       params_.env->RecursivelyCreateDir(params_.UncommittedChunksDirectory()));
   TF_RETURN_IF_ERROR(
       params_.env->RecursivelyCreateDir(params_.CheckpointsDirectory()));
+  TF_RETURN_IF_ERROR(
+      params_.env->RecursivelyCreateDir(params_.ChunkIndicesDirectory()));
   return OkStatus();
 }
 
@@ -126,60 +262,153 @@ bool SnapshotStreamWriter::ShouldWriteChunk() const TF_LOCKS_EXCLUDED(mu_) {
   return !end_of_sequence_ && completed_.ok();
 }
 
-Status SnapshotStreamWriter::WriteChunk() {
+Status SnapshotStreamWriter::WriteChunks() {
   LOG(INFO) << "Writing distributed tf.data snapshot stream "
-            << params_.stream_index << ", chunk " << chunk_index_ << ".";
-  std::string chunk_file_path = GetChunkFilePath();
-  snapshot_util::TFRecordWriter writer(chunk_file_path, params_.compression);
-  TF_RETURN_IF_ERROR(writer.Initialize(params_.env));
-  while (ShouldWriteRecord()) {
-    TF_RETURN_IF_ERROR(WriteRecord(writer));
+            << params_.stream_index << ", chunk " << chunk_index_
+            << ", parallel chunks: " << num_parallel_chunks_ << ".";
+  std::vector<std::unique_ptr<ChunkWriter>> chunk_writers;
+  absl::Duration produce_time;
+  Status status;
+  while (status.ok() && ShouldWriteRecord() && HasChunkWriter(chunk_writers)) {
+    const absl::Time start_time = absl::Now();
+    std::vector<Tensor> element;
+    status = iterator_->GetNext(element, end_of_sequence_);
+    produce_time += absl::Now() - start_time;
+    if (!status.ok() || end_of_sequence_) {
+      break;
+    }
+    StatusOr<ChunkWriter*> chunk_writer = GetChunkWriter(chunk_writers);
+    status = chunk_writer.status();
+    if (!status.ok()) {
+      break;
+    }
+    DCHECK(*chunk_writer != nullptr);
+    status = (*chunk_writer)->Write(std::move(element));
   }
-  TF_RETURN_IF_ERROR(writer.Close());
-  return CommitChunk();
+  if (status.ok() && chunk_writers.empty()) {
+    // Writes an empty chunk if the stream ends at a chunk boundary.
+    StatusOr<ChunkWriter*> chunk_writer = GetChunkWriter(chunk_writers);
+    status = chunk_writer.status();
+  }
+
+  // Waits for all chunks to be written, even on errors, before the files are
+  // deleted or retried.
+  absl::Duration write_time;
+  int64_t size_bytes = 0;
+  for (std::unique_ptr<ChunkWriter>& chunk_writer : chunk_writers) {
+    status.Update(chunk_writer->Close());
+    write_time += chunk_writer->write_time();
+    size_bytes += chunk_writer->size_bytes();
+  }
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(WriteChunkIndices(chunk_writers));
+  UpdateNumParallelChunks(produce_time, write_time);
+  return CommitChunks(chunk_writers.size(), size_bytes);
+}
+
+bool SnapshotStreamWriter::HasChunkWriter(
+    const std::vector<std::unique_ptr<ChunkWriter>>& chunk_writers) const {
+  if (static_cast<int64_t>(chunk_writers.size()) < num_parallel_chunks_) {
+    return true;
+  }
+  for (const std::unique_ptr<ChunkWriter>& chunk_writer : chunk_writers) {
+    if (chunk_writer->size_bytes() < params_.max_chunk_size_bytes) {
+      return true;
+    }
+  }
+  return false;
+}
+
+StatusOr<SnapshotStreamWriter::ChunkWriter*>
+SnapshotStreamWriter::GetChunkWriter(
+    std::vector<std::unique_ptr<ChunkWriter>>& chunk_writers) {
+  ChunkWriter* least_busy_writer = nullptr;
+  for (std::unique_ptr<ChunkWriter>& chunk_writer : chunk_writers) {
+    if (chunk_writer->size_bytes() >= params_.max_chunk_size_bytes) {
+      continue;
+    }
+    if (least_busy_writer == nullptr ||
+        chunk_writer->buffered_bytes() < least_busy_writer->buffered_bytes()) {
+      least_busy_writer = chunk_writer.get();
+    }
+  }
+  if ((least_busy_writer == nullptr ||
+       least_busy_writer->buffered_bytes() > 0) &&
+      static_cast<int64_t>(chunk_writers.size()) < num_parallel_chunks_) {
+    auto chunk_writer = std::make_unique<ChunkWriter>(
+        params_, GetChunkFilePath(chunk_index_ + chunk_writers.size()));
+    TF_RETURN_IF_ERROR(chunk_writer->Initialize());
+    chunk_writers.push_back(std::move(chunk_writer));
+    return chunk_writers.back().get();
+  }
+  return least_busy_writer;
 }
 
-Status SnapshotStreamWriter::CommitChunk() {
-  // Writes the checkpoint before committing the chunk. If the worker fails in
+Status SnapshotStreamWriter::WriteChunkIndices(
+    const std::vector<std::unique_ptr<ChunkWriter>>& chunk_writers) {
+  // The indices are written before the checkpoint, so committed chunks always
+  // have an index, including chunks committed when restoring the checkpoint.
+  for (size_t i = 0; i < chunk_writers.size(); ++i) {
+    std::string index_file_path = ChunkIndexFilePath(
+        params_.snapshot_path,
+        tsl::io::Basename(GetCommittedChunkFilePath(chunk_index_ + i)));
+    TF_RETURN_IF_ERROR(AtomicallyWriteBinaryProto(
+        index_file_path, chunk_writers[i]->index(), params_.env));
+  }
+  return OkStatus();
+}
+
+Status SnapshotStreamWriter::CommitChunks(int64_t num_chunks,
+                                          int64_t size_bytes) {
+  // The checkpoint is named after the last chunk. Chunks up to and including
+  // that chunk are committed after restoring from the checkpoint.
+  const int64_t first_chunk_index = chunk_index_;
+  chunk_index_ += num_chunks - 1;
+  chunk_size_bytes_ = size_bytes;
+
+  // Writes the checkpoint before committing the chunks. If the worker fails in
   // between, the restarted worker will synchronize the checkpoint with the
   // committed chunks.
   if (ShouldSave()) {
     TF_RETURN_IF_ERROR(Save());
   }
-  TF_RETURN_IF_ERROR(
-      params_.env->RenameFile(GetChunkFilePath(), GetCommittedChunkFilePath()));
+  for (int64_t i = first_chunk_index; i <= chunk_index_; ++i) {
+    TF_RETURN_IF_ERROR(params_.env->RenameFile(GetChunkFilePath(i),
+                                               GetCommittedChunkFilePath(i)));
+  }
   ++chunk_index_;
   chunk_size_bytes_ = 0;
   return OkStatus();
 }
 
-std::string SnapshotStreamWriter::GetChunkFilePath() const {
+void SnapshotStreamWriter::UpdateNumParallelChunks(absl::Duration produce_time,
+                                                   absl::Duration write_time) {
+  // Writing `n` chunks in parallel keeps up with the iterator if each chunk
+  // takes at most `produce_time` to write, i.e. `write_time / n`.
+  int64_t num_parallel_chunks = params_.max_parallel_chunks;
+  if (produce_time > absl::ZeroDuration()) {
+    num_parallel_chunks = static_cast<int64_t>(
+        std::ceil(absl::FDivDuration(write_time, produce_time)));
+  }
+  num_parallel_chunks_ = std::clamp<int64_t>(
+      num_parallel_chunks, 1, std::max<int64_t>(params_.max_parallel_chunks, 1));
+}
+
+std::string SnapshotStreamWriter::GetChunkFilePath(int64_t chunk_index) const {
   return tsl::io::JoinPath(params_.UncommittedChunksDirectory(),
-                           absl::StrCat("chunk_", chunk_index_));
+                           absl::StrCat("chunk_", chunk_index));
 }
 
-std::string SnapshotStreamWriter::GetCommittedChunkFilePath() const {
+std::string SnapshotStreamWriter::GetCommittedChunkFilePath(
+    int64_t chunk_index) const {
   return tsl::io::JoinPath(
       params_.CommittedChunksDirectory(),
-      absl::StrCat("chunk_", params_.stream_index, "_", chunk_index_));
+      absl::StrCat("chunk_", params_.stream_index, "_", chunk_index));
 }
 
 bool SnapshotStreamWriter::ShouldWriteRecord() const TF_LOCKS_EXCLUDED(mu_) {
   mutex_lock l(mu_);
-  return chunk_size_bytes_ < params_.max_chunk_size_bytes &&
-         !end_of_sequence_ && completed_.ok();
-}
-
-Status SnapshotStreamWriter::WriteRecord(
-    snapshot_util::TFRecordWriter& writer) {
-  std::vector<Tensor> element;
-  TF_RETURN_IF_ERROR(iterator_->GetNext(element, end_of_sequence_));
-  if (end_of_sequence_) {
-    return writer.Close();
-  }
-  TF_RETURN_IF_ERROR(writer.WriteTensors(element));
-  chunk_size_bytes_ += EstimatedSizeBytes(element);
-  return OkStatus();
+  return !end_of_sequence_ && completed_.ok();
 }
 
 Status SnapshotStreamWriter::FinalizeStream(Status status) {
@@ -345,9 +574,8 @@ Status SnapshotStreamWriter::SyncCheckpointWithChunks(
         params_.UncommittedChunksDirectory(), uncommitted_chunk);
     TF_ASSIGN_OR_RETURN(int64_t chunk_index,
                         GetFileIndex(uncommitted_chunk, "chunk"));
-    std::string committed_chunk_filename = tsl::io::JoinPath(
-        params_.CommittedChunksDirectory(),
-        absl::StrCat("chunk_", params_.stream_index, "_", chunk_index));
+    std::string committed_chunk_filename =
+        GetCommittedChunkFilePath(chunk_index);
     if (chunk_index <= checkpoint_index) {
       TF_RETURN_IF_ERROR(params_.env->RenameFile(uncommitted_chunk_filename,
                                                  committed_chunk_filename));
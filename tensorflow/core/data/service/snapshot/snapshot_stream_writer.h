@@ -19,8 +19,10 @@ limitations under the License.
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "absl/strings/substitute.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/snapshot/path_utils.h"
 #include "tensorflow/core/data/service/task_runner.h"
@@ -57,6 +59,11 @@ struct SnapshotWriterParams {
   // snapshot. Used only for unit testing.
   bool test_only_keep_temp_files = false;
 
+  // The maximum number of chunks written in parallel. The writer tunes the
+  // number of parallel chunks between 1 and this value, depending on how long
+  // writing to the file system takes compared to producing the elements.
+  int64_t max_parallel_chunks = 1;
+
   std::string StreamDirectory() const {
     return tensorflow::data::StreamDirectory(snapshot_path, stream_index);
   }
@@ -65,6 +72,10 @@ struct SnapshotWriterParams {
     return tensorflow::data::CommittedChunksDirectory(snapshot_path);
   }
 
+  std::string ChunkIndicesDirectory() const {
+    return tensorflow::data::ChunkIndicesDirectory(snapshot_path);
+  }
+
   std::string UncommittedChunksDirectory() const {
     return tensorflow::data::UncommittedChunksDirectory(snapshot_path,
                                                         stream_index);
@@ -94,6 +105,8 @@ struct SnapshotWriterParams {
 //   - dataset_def.proto
 //   - chunks
 //     - chunk_<stream_index>_<chunk_index>
+//   - chunk_indices
+//     - chunk_<stream_index>_<chunk_index>
 //   - streams
 //     - stream_0
 //       - LEASE
@@ -151,22 +164,43 @@ class SnapshotStreamWriter {
   // cancelled.
   bool ShouldWriteChunk() const;
 
-  // Writes the next chunk.
-  Status WriteChunk();
+  // Writes one chunk file on a separate thread.
+  class ChunkWriter;
 
-  // Commits the current chunk.
-  Status CommitChunk();
+  // Writes the next `num_parallel_chunks_` chunks in parallel.
+  Status WriteChunks();
 
-  // Returns the path of the current chunk.
-  std::string GetChunkFilePath() const;
-  std::string GetCommittedChunkFilePath() const;
+  // Returns whether a chunk can take another record: a chunk that is not full,
+  // or room for a new chunk. Checked before taking the record from the
+  // iterator, so that no record is dropped for lack of a chunk.
+  bool HasChunkWriter(
+      const std::vector<std::unique_ptr<ChunkWriter>>& chunk_writers) const;
 
-  // Returns true if the writer should write the next record to the current
-  // chunk.
-  bool ShouldWriteRecord() const;
+  // Returns the writer to write the next record to, creating a new chunk if
+  // the existing ones are busy. Returns nullptr if all the chunks are full.
+  StatusOr<ChunkWriter*> GetChunkWriter(
+      std::vector<std::unique_ptr<ChunkWriter>>& chunk_writers);
 
-  // Writes the next record to the current chunk.
-  Status WriteRecord(snapshot_util::TFRecordWriter& writer);
+  // Writes the element offsets of the chunks starting from the current chunk,
+  // before the chunks are committed.
+  Status WriteChunkIndices(
+      const std::vector<std::unique_ptr<ChunkWriter>>& chunk_writers);
+
+  // Commits the `num_chunks` chunks starting from the current chunk, which
+  // contain `size_bytes` in total.
+  Status CommitChunks(int64_t num_chunks, int64_t size_bytes);
+
+  // Sets the number of chunks to write in parallel, based on the time spent
+  // producing the elements and writing them to the last chunks.
+  void UpdateNumParallelChunks(absl::Duration produce_time,
+                               absl::Duration write_time);
+
+  // Returns the path of the chunk with index `chunk_index`.
+  std::string GetChunkFilePath(int64_t chunk_index) const;
+  std::string GetCommittedChunkFilePath(int64_t chunk_index) const;
+
+  // Returns true if the writer should write the next record.
+  bool ShouldWriteRecord() const;
 
   // Writes a DONE file when the stream is finished. Writes an ERROR file if it
   // failed.
@@ -204,8 +238,10 @@ class SnapshotStreamWriter {
 
   // Index of the current chunk.
   int64_t chunk_index_ = 0;
-  // Size of the current chunk.
+  // Size of the current chunks.
   int64_t chunk_size_bytes_ = 0;
+  // Number of chunks to write in parallel.
+  int64_t num_parallel_chunks_ = 1;
 
   // True if the dataset is exhausted.
   bool end_of_sequence_ = false;
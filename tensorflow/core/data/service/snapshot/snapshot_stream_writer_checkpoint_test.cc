@@ -38,6 +38,7 @@ namespace data {
 namespace {
 
 using ::testing::UnorderedElementsAre;
+using ::testing::UnorderedElementsAreArray;
 using ::testing::ValuesIn;
 using ::tsl::testing::IsOkAndHolds;
 
@@ -92,6 +93,30 @@ TEST_P(SnapshotStreamWriterParameterizedTest, SaveAndRestoreFromCheckpoints) {
               IsOkAndHolds(UnorderedElementsAre(6, 7, 8, 9)));
 }
 
+TEST_P(SnapshotStreamWriterParameterizedTest, WriteParallelChunks) {
+  const int64_t range = 100;
+  const std::string compression = GetParam();
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<StandaloneTaskIterator> iterator,
+                          testing::TestIterator(testing::RangeDataset(range)));
+  TF_ASSERT_OK_AND_ASSIGN(std::string snapshot_path, CreateSnapshotDirectory());
+  SnapshotWriterParams writer_params{snapshot_path,
+                                     /*stream_index=*/0,
+                                     compression,
+                                     Env::Default(),
+                                     /*max_chunk_size_bytes=*/20,
+                                     /*test_only_keep_temp_files=*/false,
+                                     /*max_parallel_chunks=*/4};
+  SnapshotStreamWriter snapshot_writer(writer_params, std::move(iterator));
+  EXPECT_THAT(snapshot_writer.Wait(), IsOkAndHolds(true));
+
+  std::vector<int64_t> expected;
+  for (int64_t i = 0; i < range; ++i) {
+    expected.push_back(i);
+  }
+  EXPECT_THAT(testing::ReadSnapshot<int64_t>(snapshot_path, compression),
+              IsOkAndHolds(UnorderedElementsAreArray(expected)));
+}
+
 INSTANTIATE_TEST_SUITE_P(Compression, SnapshotStreamWriterParameterizedTest,
                          ValuesIn<std::string>({tsl::io::compression::kNone,
                                                 tsl::io::compression::kGzip,
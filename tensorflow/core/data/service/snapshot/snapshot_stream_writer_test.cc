@@ -14,9 +14,11 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/snapshot/snapshot_stream_writer.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
@@ -130,6 +132,25 @@ StatusOr<std::vector<T>> ReadSnapshot(const std::string& snapshot_path,
   return result;
 }
 
+// Reads all the single-tensor elements of a chunk.
+template <class T>
+StatusOr<std::vector<T>> ReadChunkElements(const std::string& chunk_path,
+                                           const std::string& compression) {
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<snapshot_util::Reader> reader,
+                      CreateSnapshotReader(chunk_path, /*num_elements=*/1,
+                                           compression, Env::Default()));
+  std::vector<T> result;
+  while (true) {
+    std::vector<Tensor> tensors;
+    Status status = reader->ReadTensors(&tensors);
+    if (errors::IsOutOfRange(status)) {
+      return result;
+    }
+    TF_RETURN_IF_ERROR(status);
+    result.push_back(tensors[0].unaligned_flat<T>().data()[0]);
+  }
+}
+
 StatusOr<std::string> ReadStringFromFile(const std::string& filename) {
   std::string data;
   TF_RETURN_IF_ERROR(ReadFileToString(Env::Default(), filename, &data));
@@ -218,6 +239,41 @@ TEST_P(SnapshotStreamWriterParameterizedTest, WriteSnapshotChunks) {
   }
 }
 
+TEST_P(SnapshotStreamWriterParameterizedTest, WriteParallelChunks) {
+  int64_t range = 1000;
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<StandaloneTaskIterator> iterator,
+                          TestIterator(testing::RangeDataset(range)));
+
+  std::string compression = GetParam();
+  TF_ASSERT_OK_AND_ASSIGN(std::string snapshot_path, CreateSnapshotDirectory());
+  SnapshotWriterParams writer_params{snapshot_path, /*stream_index=*/0,
+                                     compression, Env::Default(),
+                                     /*max_chunk_size_bytes=*/64};
+  writer_params.max_parallel_chunks = 4;
+  SnapshotStreamWriter snapshot_writer(writer_params, std::move(iterator));
+  EXPECT_THAT(snapshot_writer.Wait(), IsOkAndHolds(true));
+
+  // Every element is in exactly one chunk, whichever chunk took it.
+  std::vector<std::string> chunks;
+  TF_ASSERT_OK(Env::Default()->GetChildren(
+      writer_params.CommittedChunksDirectory(), &chunks));
+  EXPECT_GT(chunks.size(), 1);
+  std::vector<int64_t> elements;
+  for (const std::string& chunk : chunks) {
+    TF_ASSERT_OK_AND_ASSIGN(
+        std::vector<int64_t> chunk_elements,
+        ReadChunkElements<int64_t>(
+            tsl::io::JoinPath(writer_params.CommittedChunksDirectory(), chunk),
+            compression));
+    elements.insert(elements.end(), chunk_elements.begin(),
+                    chunk_elements.end());
+  }
+  std::sort(elements.begin(), elements.end());
+  std::vector<int64_t> expected(range);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_EQ(elements, expected);
+}
+
 TEST_P(SnapshotStreamWriterParameterizedTest, WriteDoneFile) {
   int64_t range = 10;
   TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<StandaloneTaskIterator> iterator,
@@ -16,9 +16,11 @@ limitations under the License.
 
 #include <algorithm>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/common.h"
 #include "tensorflow/core/data/service/cross_trainer_cache.h"
 #include "tensorflow/core/data/service/data_transfer.h"
@@ -46,6 +48,7 @@ namespace {
 constexpr int64_t kWaitBeforeSkipUs = 100 * 1000;  // 100ms.
 constexpr size_t kDefaultCrossTrainerCacheSizeBytes =
     10 * (size_t{1} << 30);  // 10GB
+constexpr size_t kDefaultPrefetchBufferSize = 1;
 
 }  // namespace
 
@@ -91,17 +94,22 @@ Status TaskRunner::Create(const experimental::WorkerConfig& worker_config,
         worker_config.cross_trainer_cache_size_bytes() > 0
             ? worker_config.cross_trainer_cache_size_bytes()
             : kDefaultCrossTrainerCacheSizeBytes;
-    out = std::make_unique<CachingTaskRunner>(std::move(iterator),
-                                              max_cache_size_bytes);
+    out = std::make_unique<CachingTaskRunner>(
+        std::move(iterator), max_cache_size_bytes,
+        absl::Milliseconds(worker_config.cross_trainer_cache_max_lag_ms()));
   } else {
-    out = std::make_unique<FirstComeFirstServedTaskRunner>(std::move(iterator));
+    const size_t buffer_size = worker_config.prefetch_buffer_size() > 0
+                                   ? worker_config.prefetch_buffer_size()
+                                   : kDefaultPrefetchBufferSize;
+    out = std::make_unique<FirstComeFirstServedTaskRunner>(std::move(iterator),
+                                                           buffer_size);
   }
   return OkStatus();
 }
 
 FirstComeFirstServedTaskRunner::FirstComeFirstServedTaskRunner(
-    std::unique_ptr<TaskIterator> iterator)
-    : iterator_(std::move(iterator)), buffer_(/*buffer_size=*/1) {
+    std::unique_ptr<TaskIterator> iterator, size_t buffer_size)
+    : iterator_(std::move(iterator)), buffer_(buffer_size) {
   RunPrefetchThread();
 }
 
@@ -109,7 +117,26 @@ FirstComeFirstServedTaskRunner::~FirstComeFirstServedTaskRunner() { Cancel(); }
 
 Status FirstComeFirstServedTaskRunner::GetNext(const GetElementRequest& req,
                                                GetElementResult& result) {
-  return GetNext(result);
+  TF_RETURN_IF_ERROR(GetNext(result));
+  if (result.end_of_sequence) {
+    return OkStatus();
+  }
+  // Batched requests are answered with the elements which are already
+  // prefetched, so they never wait for more than the first element.
+  int64_t num_bytes = result.EstimatedMemoryUsageBytes();
+  while (static_cast<int64_t>(result.additional_results.size()) + 1 <
+             req.max_elements() &&
+         (req.max_bytes() <= 0 || num_bytes < req.max_bytes())) {
+    std::optional<GetElementResult> next = buffer_.TryPop();
+    // An end of sequence is dropped rather than returned as an additional
+    // element. The input iterator keeps producing it for the next request.
+    if (!next.has_value() || next->end_of_sequence) {
+      break;
+    }
+    num_bytes += next->EstimatedMemoryUsageBytes();
+    result.additional_results.push_back(*std::move(next));
+  }
+  return OkStatus();
 }
 
 Status FirstComeFirstServedTaskRunner::GetNext(GetElementResult& result) {
@@ -160,11 +187,17 @@ void FirstComeFirstServedTaskRunner::Cancel() {
   buffer_.Cancel(errors::Cancelled("tf.data service FCFS task is cancelled."));
 }
 
+double FirstComeFirstServedTaskRunner::BufferOccupancy() {
+  return static_cast<double>(buffer_.size()) / buffer_.buffer_size();
+}
+
 CachingTaskRunner::CachingTaskRunner(std::unique_ptr<TaskIterator> iterator,
-                                     size_t max_cache_size_bytes)
+                                     size_t max_cache_size_bytes,
+                                     absl::Duration max_trainer_lag)
     : fcfs_task_runner_(std::move(iterator)),
       cache_(max_cache_size_bytes,
-             std::make_unique<GetElementResultSequence>(fcfs_task_runner_)) {
+             std::make_unique<GetElementResultSequence>(fcfs_task_runner_),
+             max_trainer_lag) {
   LOG(INFO) << "Initialized tf.data service cross-trainer cache with "
             << FormatBytes(max_cache_size_bytes) << " of memory.";
 }
@@ -209,6 +242,10 @@ void CachingTaskRunner::Cancel() {
   fcfs_task_runner_.Cancel();
 }
 
+double CachingTaskRunner::BufferOccupancy() {
+  return fcfs_task_runner_.BufferOccupancy();
+}
+
 RoundRobinTaskRunner::RoundRobinTaskRunner(
     std::unique_ptr<TaskIterator> iterator, int64_t num_consumers,
     string worker_address)
@@ -343,6 +380,10 @@ void RoundRobinTaskRunner::Cancel() {
   new_round_cv_.notify_all();
 }
 
+double RoundRobinTaskRunner::BufferOccupancy() {
+  return prefetch_thread_.BufferOccupancy();
+}
+
 PrefetchThread::PrefetchThread(std::unique_ptr<TaskIterator> iterator,
                                int64_t round_size)
     : iterator_(std::move(iterator)), round_size_(round_size) {
@@ -424,5 +465,10 @@ Status PrefetchThread::GetStatus() {
   mutex_lock l(mu_);
   return status_;
 }
+
+double PrefetchThread::BufferOccupancy() {
+  mutex_lock l(mu_);
+  return static_cast<double>(buffer_.size()) / round_size_;
+}
 }  // namespace data
 }  // namespace tensorflow
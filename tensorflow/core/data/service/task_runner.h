@@ -18,6 +18,7 @@ limitations under the License.
 #include <memory>
 #include <vector>
 
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/cross_trainer_cache.h"
 #include "tensorflow/core/data/service/data_transfer.h"
@@ -95,23 +96,31 @@ class TaskRunner {
                          GetElementResult& result) = 0;
   // Cancels in-progress `GetNext` requests.
   virtual void Cancel() = 0;
+  // Returns the fraction of the prefetch buffer holding elements ready to be
+  // served, in [0, 1].
+  virtual double BufferOccupancy() = 0;
 };
 
 // A task runner which provides elements on a first-come first-served basis.
 // It does not consider which consumer is making the request.
 class FirstComeFirstServedTaskRunner : public TaskRunner {
  public:
+  // Prefetches up to `buffer_size` elements from `iterator`.
   explicit FirstComeFirstServedTaskRunner(
-      std::unique_ptr<TaskIterator> iterator);
+      std::unique_ptr<TaskIterator> iterator, size_t buffer_size = 1);
   ~FirstComeFirstServedTaskRunner() override;
 
-  // Gets the next element. It may block if the element is not ready yet.
+  // Gets the next element. It may block if the element is not ready yet. If
+  // `req.max_elements()` is greater than 1, also returns prefetched elements
+  // in `result.additional_results`.
   Status GetNext(const GetElementRequest& req,
                  GetElementResult& result) override;
   Status GetNext(GetElementResult& result);
 
   void Cancel() override;
 
+  double BufferOccupancy() override;
+
  private:
   // Function to continually prefetch the next element. Returns an error if the
   // task has been cancelled.
@@ -140,8 +149,9 @@ class FirstComeFirstServedTaskRunner : public TaskRunner {
 // read the full dataset.
 class CachingTaskRunner : public TaskRunner {
  public:
-  explicit CachingTaskRunner(std::unique_ptr<TaskIterator> iterator,
-                             size_t max_cache_size_bytes);
+  explicit CachingTaskRunner(
+      std::unique_ptr<TaskIterator> iterator, size_t max_cache_size_bytes,
+      absl::Duration max_trainer_lag = absl::ZeroDuration());
   ~CachingTaskRunner() override;
 
   // Gets the next element from the cross-trainer cache, blocking if the data is
@@ -154,6 +164,9 @@ class CachingTaskRunner : public TaskRunner {
   // return a Cancelled status.
   void Cancel() override;
 
+  // Returns the occupancy of the prefetch buffer which fills the cache.
+  double BufferOccupancy() override;
+
  private:
   // The `GetElementResultSequence` generates a sequence of elements from the
   // `FirstComeFirstServedTaskRunner`. It is used for the `CrossTrainerCache` to
@@ -202,6 +215,8 @@ class PrefetchThread {
                     std::vector<std::unique_ptr<Element>>& out);
   // Returns the status for any failures encountered by the prefetch thread.
   Status GetStatus();
+  // Returns the fraction of the next round which is already prefetched.
+  double BufferOccupancy();
 
  private:
   const std::unique_ptr<TaskIterator> iterator_;
@@ -246,6 +261,7 @@ class RoundRobinTaskRunner : public TaskRunner {
   Status GetNext(const GetElementRequest& req,
                  GetElementResult& result) override;
   void Cancel() override;
+  double BufferOccupancy() override;
 
  private:
   // Prepares a full round of data. `wait_us` indicates how long to wait before
@@ -234,6 +234,23 @@ TEST(FirstComeFirstServedTaskRunnerTest, Cancel) {
   }
 }
 
+TEST(FirstComeFirstServedTaskRunnerTest, BufferOccupancy) {
+  FirstComeFirstServedTaskRunner runner(
+      std::make_unique<RangeIterator>(/*range=*/10, /*repeat=*/false),
+      /*buffer_size=*/4);
+  // The prefetch thread fills the buffer while no element is read.
+  while (runner.BufferOccupancy() < 1.0) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  EXPECT_EQ(runner.BufferOccupancy(), 1.0);
+
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<int64_t> output,
+      GetTaskRunnerOutput<int64_t>(runner, GetElementRequest()));
+  EXPECT_THAT(output, ElementsAreArray(GetRange(10)));
+  EXPECT_LE(runner.BufferOccupancy(), 1.0);
+}
+
 TEST(FirstComeFirstServedTaskRunnerTest, ConcurrentReaders) {
   size_t range = 1000;
   size_t num_readers = 10;
@@ -302,6 +319,46 @@ TEST(FirstComeFirstServedTaskRunnerTest, Error) {
               testing::StatusIs(error::ABORTED));
 }
 
+TEST(FirstComeFirstServedTaskRunnerTest, BatchedGetNext) {
+  size_t range = 10;
+  FirstComeFirstServedTaskRunner runner(
+      std::make_unique<RangeIterator>(range, /*repeat=*/false),
+      /*buffer_size=*/range);
+  GetElementRequest request;
+  request.set_max_elements(4);
+
+  std::vector<int64_t> output;
+  while (true) {
+    GetElementResult result;
+    TF_ASSERT_OK(runner.GetNext(request, result));
+    if (result.end_of_sequence) {
+      break;
+    }
+    EXPECT_LE(result.additional_results.size(), 3);
+    output.push_back(result.components[0].scalar<int64_t>()());
+    for (const GetElementResult& additional : result.additional_results) {
+      EXPECT_FALSE(additional.end_of_sequence);
+      output.push_back(additional.components[0].scalar<int64_t>()());
+    }
+  }
+  EXPECT_THAT(output, ElementsAreArray(GetRange(range)));
+}
+
+TEST(FirstComeFirstServedTaskRunnerTest, BatchedGetNextMaxBytes) {
+  FirstComeFirstServedTaskRunner runner(
+      std::make_unique<InfiniteRangeIterator>(), /*buffer_size=*/10);
+  GetElementRequest request;
+  request.set_max_elements(10);
+  request.set_max_bytes(1);
+
+  for (int64_t i = 0; i < 10; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(runner.GetNext(request, result));
+    test::ExpectEqual(result.components[0], Tensor(i));
+    EXPECT_THAT(result.additional_results, SizeIs(0));
+  }
+}
+
 TEST(CachingTaskRunnerTest, GetNext) {
   size_t range = 10;
   CachingTaskRunner runner(std::make_unique<InfiniteRangeIterator>(),
@@ -98,6 +98,12 @@ std::string TestCluster::WorkerAddress(int index) const {
   return worker_addresses_[index];
 }
 
+void TestCluster::DrainWorker(size_t index) {
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, worker_addresses_.size());
+  workers_[index]->Drain();
+}
+
 void TestCluster::StopWorker(size_t index) {
   DCHECK_GE(index, 0);
   DCHECK_LT(index, worker_addresses_.size());
@@ -81,6 +81,8 @@ class TestCluster {
   // workers in the cluster.
   std::string WorkerAddress(int index) const;
 
+  // Starts draining one worker.
+  void DrainWorker(size_t index);
   // Stops one worker.
   void StopWorker(size_t index);
   // Stops all workers.
@@ -16,6 +16,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_DATA_SERVICE_THREAD_SAFE_BUFFER_H_
 
 #include <deque>
+#include <optional>
 #include <utility>
 
 #include "tensorflow/core/platform/macros.h"
@@ -38,6 +39,11 @@ class ThreadSafeBuffer final {
   // a non-OK status was pushed or the buffer has been cancelled.
   StatusOr<T> Pop();
 
+  // Gets the next element without blocking. Returns `std::nullopt` if the
+  // buffer is empty, has been cancelled, or the next value is an error, which
+  // is then left for the next `Pop` call.
+  std::optional<T> TryPop();
+
   // Writes the next element. Blocks if the buffer is full. Returns an error if
   // the buffer has been cancelled.
   Status Push(StatusOr<T> value);
@@ -47,6 +53,12 @@ class ThreadSafeBuffer final {
   // REQUIRES: !status.ok()
   void Cancel(Status status);
 
+  // Returns the number of buffered elements.
+  size_t size();
+
+  // Returns the maximum number of buffered elements.
+  size_t buffer_size() const { return buffer_size_; }
+
  private:
   const size_t buffer_size_;
 
@@ -82,6 +94,18 @@ StatusOr<T> ThreadSafeBuffer<T>::Pop() {
   return result;
 }
 
+template <class T>
+std::optional<T> ThreadSafeBuffer<T>::TryPop() {
+  mutex_lock l(mu_);
+  if (!status_.ok() || results_.empty() || !results_.front().ok()) {
+    return std::nullopt;
+  }
+  T result = *std::move(results_.front());
+  results_.pop_front();
+  ready_to_push_.notify_one();
+  return result;
+}
+
 template <class T>
 Status ThreadSafeBuffer<T>::Push(StatusOr<T> value) {
   mutex_lock l(mu_);
@@ -106,6 +130,12 @@ void ThreadSafeBuffer<T>::Cancel(Status status) {
   ready_to_pop_.notify_all();
 }
 
+template <class T>
+size_t ThreadSafeBuffer<T>::size() {
+  mutex_lock l(mu_);
+  return results_.size();
+}
+
 }  // namespace data
 }  // namespace tensorflow
 
@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/thread_safe_buffer.h"
 
 #include <memory>
+#include <optional>
 #include <tuple>
 #include <vector>
 
@@ -180,6 +181,44 @@ TEST_P(ThreadSafeBufferTest, BlockWriterWhenBufferIsFull) {
   EXPECT_LE(pop_time, push_time);
 }
 
+TEST_P(ThreadSafeBufferTest, TryPop) {
+  ThreadSafeBuffer<int> buffer(GetBufferSize());
+  EXPECT_EQ(buffer.TryPop(), std::nullopt);
+
+  for (int i = 0; i < GetBufferSize(); ++i) {
+    ASSERT_THAT(buffer.Push(i), IsOk());
+  }
+  for (int i = 0; i < GetBufferSize(); ++i) {
+    EXPECT_EQ(buffer.TryPop(), i);
+  }
+  EXPECT_EQ(buffer.TryPop(), std::nullopt);
+}
+
+TEST_P(ThreadSafeBufferTest, Size) {
+  ThreadSafeBuffer<int> buffer(GetBufferSize());
+  EXPECT_EQ(buffer.buffer_size(), GetBufferSize());
+  EXPECT_EQ(buffer.size(), 0);
+
+  for (int i = 0; i < GetBufferSize(); ++i) {
+    ASSERT_THAT(buffer.Push(i), IsOk());
+    EXPECT_EQ(buffer.size(), i + 1);
+  }
+  for (int i = 0; i < GetBufferSize(); ++i) {
+    ASSERT_THAT(buffer.Pop(), IsOk());
+    EXPECT_EQ(buffer.size(), GetBufferSize() - i - 1);
+  }
+}
+
+TEST_P(ThreadSafeBufferTest, TryPopLeavesErrors) {
+  ThreadSafeBuffer<int> buffer(GetBufferSize());
+  ASSERT_THAT(buffer.Push(errors::Aborted("Aborted")), IsOk());
+  EXPECT_EQ(buffer.TryPop(), std::nullopt);
+  EXPECT_THAT(buffer.Pop(), StatusIs(error::ABORTED));
+
+  buffer.Cancel(errors::Cancelled("Cancelled"));
+  EXPECT_EQ(buffer.TryPop(), std::nullopt);
+}
+
 TEST_P(ThreadSafeBufferTest, CancelReaders) {
   ThreadSafeBuffer<int> buffer(GetBufferSize());
   std::vector<std::unique_ptr<Thread>> threads;
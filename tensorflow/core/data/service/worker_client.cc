@@ -64,6 +64,11 @@ CreateDataServiceWorkerClient(const std::string& address,
 Status DataServiceWorkerClient::GetElement(const GetElementRequest& req,
                                            GetElementResult& result) {
   TF_RETURN_IF_ERROR(EnsureInitialized());
+  if (req.max_elements() > 1 && !supports_batched_requests_) {
+    GetElementRequest single_element_req = req;
+    single_element_req.clear_max_elements();
+    return client_->GetElement(single_element_req, result);
+  }
   return client_->GetElement(req, result);
 }
 
@@ -72,8 +77,11 @@ Status DataServiceWorkerClient::EnsureInitialized() {
   if (client_) {
     return OkStatus();
   }
+  const std::string transfer_protocol = GetDataTransferProtocol();
   TF_RETURN_IF_ERROR(DataTransferClient::Build(
-      GetDataTransferProtocol(), {protocol_, address_}, &client_));
+      transfer_protocol, {protocol_, address_}, &client_));
+  supports_batched_requests_ = transfer_protocol == kGrpcTransferProtocol ||
+                               transfer_protocol == kLocalTransferProtocol;
   return OkStatus();
 }
 
@@ -87,6 +95,35 @@ std::string DataServiceWorkerClient::GetDataTransferProtocol() const {
 
 void DataServiceWorkerClient::TryCancel() { client_->TryCancel(); }
 
+namespace {
+
+// Moves the element of `resp`, which is a `GetElementResponse` or a
+// `BatchedElement`, to `result`.
+template <typename ResponseT>
+Status MoveElementFromResponse(ResponseT& resp, GetElementResult& result) {
+  switch (resp.element_case()) {
+    case ResponseT::kCompressed: {
+      Tensor tensor(DT_VARIANT, TensorShape{});
+      tensor.scalar<Variant>()() = std::move(*resp.mutable_compressed());
+      result.components.push_back(tensor);
+      break;
+    }
+    case ResponseT::kUncompressed:
+      for (const auto& component : resp.uncompressed().components()) {
+        result.components.emplace_back();
+        if (!result.components.back().FromProto(component)) {
+          return errors::Internal("Failed to parse tensor.");
+        }
+      }
+      break;
+    case ResponseT::ELEMENT_NOT_SET:
+      break;
+  }
+  return OkStatus();
+}
+
+}  // namespace
+
 class GrpcDataTransferClient : public DataTransferClient {
  public:
   GrpcDataTransferClient(std::shared_ptr<grpc::ChannelCredentials> credentials,
@@ -125,23 +162,14 @@ class GrpcDataTransferClient : public DataTransferClient {
     }
     result.end_of_sequence = resp.end_of_sequence();
     result.skip = resp.skip_task();
-    switch (resp.element_case()) {
-      case GetElementResponse::kCompressed: {
-        Tensor tensor(DT_VARIANT, TensorShape{});
-        tensor.scalar<Variant>()() = std::move(resp.compressed());
-        result.components.push_back(tensor);
-        break;
-      }
-      case GetElementResponse::kUncompressed:
-        for (const auto& component : resp.uncompressed().components()) {
-          result.components.emplace_back();
-          if (!result.components.back().FromProto(component)) {
-            return errors::Internal("Failed to parse tensor.");
-          }
-        }
-        break;
-      case GetElementResponse::ELEMENT_NOT_SET:
-        break;
+    result.element_index = resp.element_index();
+    TF_RETURN_IF_ERROR(MoveElementFromResponse(resp, result));
+    result.additional_results.reserve(resp.additional_elements_size());
+    for (auto& element : *resp.mutable_additional_elements()) {
+      GetElementResult& additional_result =
+          result.additional_results.emplace_back();
+      additional_result.element_index = element.element_index();
+      TF_RETURN_IF_ERROR(MoveElementFromResponse(element, additional_result));
     }
     return OkStatus();
   }
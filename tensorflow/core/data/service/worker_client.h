@@ -41,7 +41,9 @@ class DataServiceWorkerClient : public DataServiceClientBase {
       : DataServiceClientBase(address, protocol),
         transfer_protocol_(transfer_protocol) {}
 
-  // Fetches an element from the worker.
+  // Fetches an element from the worker. Batched requests are only sent with
+  // the gRPC and local transfer protocols, other protocols fetch one element
+  // per request.
   Status GetElement(const GetElementRequest& req, GetElementResult& result);
 
   // Makes a best effort to cancel all outstanding calls in progress for the
@@ -61,6 +63,9 @@ class DataServiceWorkerClient : public DataServiceClientBase {
   // Initialization is guarded by `mu_`, but using the stub does not require
   // holding `mu_`
   std::unique_ptr<DataTransferClient> client_;
+  // Whether the data transfer protocol returns the additional elements of
+  // batched requests.
+  bool supports_batched_requests_ = false;
 };
 
 // Creates and initializes a new tf.data service worker client.
@@ -14,6 +14,10 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/worker_impl.h"
 
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <string>
@@ -53,6 +57,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/io/zlib_outputbuffer.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/host_info.h"
@@ -72,14 +77,50 @@ namespace {
 constexpr absl::Duration kRetryInterval = absl::Seconds(5);
 constexpr absl::Duration kDefaultHeartBeatInterval = absl::Seconds(30);
 constexpr absl::Duration kDefaultDispatcherTimeout = absl::Hours(1);
+constexpr int64_t kDefaultSnapshotMaxParallelChunks = 8;
 
 using WorkerConfig = experimental::WorkerConfig;
 
-// Moves the element into the response. If the tensor contains a single
-// CompressedElement variant, the move will be zero-copy. Otherwise, the tensor
-// data will be serialized as TensorProtos.
+// Returns end of splits once the worker starts draining, so that the task
+// finishes after producing the elements of the splits it already has. The
+// remaining splits are read by the tasks on the other workers.
+class DrainableSplitProvider : public SplitProvider {
+ public:
+  DrainableSplitProvider(std::unique_ptr<SplitProvider> split_provider,
+                         const std::atomic<bool>& draining)
+      : split_provider_(std::move(split_provider)), draining_(draining) {}
+
+  Status GetNext(Tensor* split, bool* end_of_splits) override {
+    if (draining_) {
+      *end_of_splits = true;
+      return OkStatus();
+    }
+    return split_provider_->GetNext(split, end_of_splits);
+  }
+
+  Status Reset() override { return split_provider_->Reset(); }
+
+  Status Save(std::function<std::string(std::string)> full_name,
+              IteratorStateWriter* writer) override {
+    return split_provider_->Save(std::move(full_name), writer);
+  }
+
+  Status Restore(std::function<std::string(std::string)> full_name,
+                 IteratorStateReader* reader) override {
+    return split_provider_->Restore(std::move(full_name), reader);
+  }
+
+ private:
+  const std::unique_ptr<SplitProvider> split_provider_;
+  const std::atomic<bool>& draining_;
+};
+
+// Moves the element into `resp`, a `GetElementResponse` or a `BatchedElement`.
+// If the tensor contains a single CompressedElement variant, the move will be
+// zero-copy. Otherwise, the tensor data will be serialized as TensorProtos.
+template <typename ResponseT>
 Status MoveElementToResponse(std::vector<Tensor>&& element,
-                             GetElementResponse& resp) {
+                             ResponseT& resp) {
   if (element.size() != 1 || element[0].dtype() != DT_VARIANT ||
       !TensorShapeUtils::IsScalar(element[0].shape())) {
     for (const auto& component : element) {
@@ -110,6 +151,10 @@ WorkerConfig ApplyWorkerDefaults(const WorkerConfig& config) {
     new_config.set_dispatcher_timeout_ms(
         absl::ToInt64Milliseconds(kDefaultDispatcherTimeout));
   }
+  if (new_config.snapshot_max_parallel_chunks() == 0) {
+    new_config.set_snapshot_max_parallel_chunks(
+        kDefaultSnapshotMaxParallelChunks);
+  }
   return new_config;
 }
 
@@ -214,6 +259,12 @@ void DataServiceWorkerImpl::Stop() {
                                        1000);
 }
 
+void DataServiceWorkerImpl::Drain() {
+  LOG(INFO) << "Draining tf.data service worker " << worker_address_
+            << ". Dynamically sharded tasks finish after their current splits.";
+  draining_ = true;
+}
+
 Status DataServiceWorkerImpl::ValidateWorkerConfig() const {
   const bool any_tag_is_empty = absl::c_any_of(
       config_.worker_tags(),
@@ -279,6 +330,9 @@ Status DataServiceWorkerImpl::GetElementResult(
     VLOG(3) << "Reached end_of_sequence for task " << request->task_id();
     pending_completed_tasks_.insert(request->task_id());
     task_completion_cv_.notify_one();
+  } else if (!result->skip) {
+    task->num_elements_served.fetch_add(1 + result->additional_results.size(),
+                                        std::memory_order_relaxed);
   }
   return OkStatus();
 }
@@ -384,9 +438,11 @@ DataServiceWorkerImpl::MakeDatasetIterator(standalone::Dataset& dataset,
     std::vector<std::unique_ptr<SplitProvider>> split_providers;
     split_providers.reserve(task_def.num_split_providers());
     for (int i = 0; i < task_def.num_split_providers(); ++i) {
-      split_providers.push_back(std::make_unique<DataServiceSplitProvider>(
-          config_.dispatcher_address(), config_.protocol(),
-          task_def.iteration_id(), i, config_.dispatcher_timeout_ms()));
+      split_providers.push_back(std::make_unique<DrainableSplitProvider>(
+          std::make_unique<DataServiceSplitProvider>(
+              config_.dispatcher_address(), config_.protocol(),
+              task_def.iteration_id(), i, config_.dispatcher_timeout_ms()),
+          draining_));
     }
     TF_RETURN_IF_ERROR(
         dataset.MakeIterator(std::move(split_providers), &iterator));
@@ -421,7 +477,15 @@ Status DataServiceWorkerImpl::GetElement(const GetElementRequest* request,
   if (!response->end_of_sequence() && !response->skip_task()) {
     TF_RETURN_IF_ERROR(
         MoveElementToResponse(std::move(result.components), *response));
-    VLOG(3) << "Producing an element for task " << request->task_id();
+    response->set_element_index(result.element_index);
+    for (auto& additional_result : result.additional_results) {
+      BatchedElement* element = response->add_additional_elements();
+      TF_RETURN_IF_ERROR(MoveElementToResponse(
+          std::move(additional_result.components), *element));
+      element->set_element_index(additional_result.element_index);
+    }
+    VLOG(3) << "Producing " << 1 + result.additional_results.size()
+            << " elements for task " << request->task_id();
   }
   return OkStatus();
 }
@@ -526,6 +590,7 @@ void DataServiceWorkerImpl::HeartbeatThread() TF_LOCKS_EXCLUDED(mu_) {
 
 Status DataServiceWorkerImpl::Heartbeat() {
   WorkerHeartbeatRequest request = BuildWorkerHeartbeatRequest();
+  AddLoads(request);
   TF_ASSIGN_OR_RETURN(WorkerHeartbeatResponse response,
                       dispatcher_->WorkerHeartbeat(request));
   UpdateTasks(response);
@@ -546,6 +611,7 @@ WorkerHeartbeatRequest DataServiceWorkerImpl::BuildWorkerHeartbeatRequest()
   request.set_worker_address(worker_address_);
   request.set_transfer_address(transfer_address_);
   *request.mutable_worker_tags() = config_.worker_tags();
+  request.set_worker_locality(config_.worker_locality());
   request.set_worker_uid(worker_uid_);
   *request.mutable_current_tasks() = {current_tasks.begin(),
                                       current_tasks.end()};
@@ -557,6 +623,50 @@ WorkerHeartbeatRequest DataServiceWorkerImpl::BuildWorkerHeartbeatRequest()
   return request;
 }
 
+void DataServiceWorkerImpl::AddLoads(WorkerHeartbeatRequest& request)
+    TF_LOCKS_EXCLUDED(mu_) {
+  request.set_draining(draining_);
+  const absl::Time now = absl::Now();
+  const std::clock_t cpu_clock = std::clock();
+  std::vector<std::pair<std::shared_ptr<Task>, int64_t>> tasks;
+  double elapsed_seconds = 0.0;
+  {
+    mutex_lock l(mu_);
+    if (last_load_time_ != absl::InfinitePast()) {
+      elapsed_seconds = absl::ToDoubleSeconds(now - last_load_time_);
+    }
+    if (elapsed_seconds > 0.0) {
+      const double cpu_seconds =
+          static_cast<double>(cpu_clock - last_cpu_clock_) / CLOCKS_PER_SEC;
+      request.set_cpu_utilization(
+          std::min(1.0, cpu_seconds / elapsed_seconds /
+                            port::NumSchedulableCPUs()));
+    }
+    last_load_time_ = now;
+    last_cpu_clock_ = cpu_clock;
+    for (const auto& [task_id, task] : tasks_) {
+      const int64_t num_elements_served =
+          task->num_elements_served.load(std::memory_order_relaxed);
+      tasks.push_back(
+          {task, num_elements_served - task->num_elements_reported});
+      task->num_elements_reported = num_elements_served;
+    }
+  }
+
+  for (const auto& [task, num_elements] : tasks) {
+    TaskLoad* task_load = request.add_task_loads();
+    task_load->set_task_id(task->task_def.task_id());
+    if (elapsed_seconds > 0.0) {
+      task_load->set_elements_per_second(num_elements / elapsed_seconds);
+    }
+    // Skips tasks being initialized rather than waiting for them.
+    mutex_lock l(task->mu, std::try_to_lock);
+    if (l && task->task_runner) {
+      task_load->set_buffer_occupancy(task->task_runner->BufferOccupancy());
+    }
+  }
+}
+
 std::vector<SnapshotTaskProgress>
 DataServiceWorkerImpl::GetSnapshotTaskProgress() const {
   std::vector<SnapshotTaskProgress> snapshot_task_progress;
@@ -627,13 +737,13 @@ Status DataServiceWorkerImpl::UpdateSnapshotWriters(
         &dataset_def));
     TF_ASSIGN_OR_RETURN(std::unique_ptr<StandaloneTaskIterator> iterator,
                         MakeSnapshotTaskIterator(snapshot_task, dataset_def));
-    snapshot_writers_.emplace(
-        snapshot_task_key,
-        std::make_unique<SnapshotStreamWriter>(
-            SnapshotWriterParams{
-                snapshot_task.base_path(), snapshot_task.stream_index(),
-                snapshot_task.metadata().compression(), Env::Default()},
-            std::move(iterator)));
+    SnapshotWriterParams writer_params{
+        snapshot_task.base_path(), snapshot_task.stream_index(),
+        snapshot_task.metadata().compression(), Env::Default()};
+    writer_params.max_parallel_chunks = config_.snapshot_max_parallel_chunks();
+    snapshot_writers_.emplace(snapshot_task_key,
+                              std::make_unique<SnapshotStreamWriter>(
+                                  writer_params, std::move(iterator)));
   }
 
   // Cancel writers for snapshots that are no longer assigned by the dispatcher.
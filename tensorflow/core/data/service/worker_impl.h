@@ -15,7 +15,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_WORKER_IMPL_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_WORKER_IMPL_H_
 
+#include <atomic>
 #include <cstdint>
+#include <ctime>
 #include <memory>
 #include <string>
 #include <utility>
@@ -25,6 +27,7 @@ limitations under the License.
 #include "absl/container/flat_hash_set.h"
 #include "absl/hash/hash.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/dispatcher.grpc.pb.h"
@@ -64,6 +67,13 @@ class DataServiceWorkerImpl {
   // and waiting for outstanding requests to complete.
   void Stop();
 
+  // Starts draining the worker before it is removed. The dispatcher stops
+  // assigning new tasks to the worker, and dynamically sharded tasks finish
+  // after producing the elements of their current splits, leaving the
+  // remaining splits to other workers. Tasks without dynamic sharding run to
+  // completion.
+  void Drain();
+
   // Serves a GetElement request, storing the result in `*result`. See
   // worker.proto for GetElement API documentation.
   Status GetElementResult(const GetElementRequest* request,
@@ -100,6 +110,12 @@ class DataServiceWorkerImpl {
     mutex mu;
     bool initialized TF_GUARDED_BY(mu) = false;
     int64_t outstanding_requests TF_GUARDED_BY(&DataServiceWorkerImpl::mu_) = 0;
+    // Number of elements served, and the number when the last load was sent
+    // to the dispatcher. `num_elements_served` is updated by every request
+    // for the task, so it does not take the worker-wide `mu_`.
+    std::atomic<int64_t> num_elements_served = 0;
+    int64_t num_elements_reported TF_GUARDED_BY(&DataServiceWorkerImpl::mu_) =
+        0;
     std::unique_ptr<TaskRunner> task_runner;
   };
 
@@ -143,6 +159,9 @@ class DataServiceWorkerImpl {
   // Builds a heartbeat request.
   WorkerHeartbeatRequest BuildWorkerHeartbeatRequest() const
       TF_LOCKS_EXCLUDED(mu_);
+  // Adds the task loads and CPU utilization since the last heartbeat to
+  // `request`.
+  void AddLoads(WorkerHeartbeatRequest& request) TF_LOCKS_EXCLUDED(mu_);
   // Updates the tasks according to the heartbeat response.
   void UpdateTasks(const WorkerHeartbeatResponse& response)
       TF_LOCKS_EXCLUDED(mu_);
@@ -187,6 +206,11 @@ class DataServiceWorkerImpl {
   bool cancelled_ TF_GUARDED_BY(mu_) = false;
   // Whether the worker has registered with the dispatcher yet.
   bool registered_ TF_GUARDED_BY(mu_) = false;
+  // Whether the worker is draining. Read by the split providers of the tasks.
+  std::atomic<bool> draining_{false};
+  // The time and process CPU clock when the last load was sent.
+  absl::Time last_load_time_ TF_GUARDED_BY(mu_) = absl::InfinitePast();
+  std::clock_t last_cpu_clock_ TF_GUARDED_BY(mu_) = 0;
   condition_variable task_completion_cv_ TF_GUARDED_BY(mu_);
   condition_variable heartbeat_cv_ TF_GUARDED_BY(mu_);
   CancellationManager cancellation_manager_;
@@ -143,9 +143,13 @@ Status TFRecordWriter::WriteTensors(const std::vector<Tensor>& tensors) {
         *proto_buffer,
         [proto_buffer](absl::string_view) { delete proto_buffer; });
     TF_RETURN_IF_ERROR(record_writer_->WriteRecord(proto_serialized));
+    offset_ += proto_serialized.size();
 #else   // TF_CORD_SUPPORT
-    TF_RETURN_IF_ERROR(record_writer_->WriteRecord(proto.SerializeAsString()));
+    std::string proto_serialized = proto.SerializeAsString();
+    TF_RETURN_IF_ERROR(record_writer_->WriteRecord(proto_serialized));
+    offset_ += proto_serialized.size();
 #endif  // TF_CORD_SUPPORT
+    offset_ += io::RecordWriter::kHeaderSize + io::RecordWriter::kFooterSize;
   }
   return OkStatus();
 }
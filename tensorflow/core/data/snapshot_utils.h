@@ -112,12 +112,17 @@ class TFRecordWriter : public Writer {
 
   ~TFRecordWriter() override;
 
+  // Returns the offset of the next record in the uncompressed stream. It can be
+  // passed to `TFRecordReader::Seek` to read the tensors written next.
+  uint64 offset() const { return offset_; }
+
  private:
   const std::string filename_;
   const std::string compression_type_;
 
   std::unique_ptr<WritableFile> dest_;
   std::unique_ptr<io::RecordWriter> record_writer_;
+  uint64 offset_ = 0;
 };
 
 // Writes snapshot with a custom (legacy) file format.
@@ -246,6 +251,12 @@ class TFRecordReader : public Reader {
   // end of file, or an error status if there is an error.
   Status ReadTensors(std::vector<Tensor>* read_tensors) override;
 
+  // Positions the reader at `offset`, as returned by `TFRecordWriter::offset`.
+  // The next `ReadTensors` reads the tensors written at that offset. Seeking is
+  // constant time for uncompressed files. For compressed files, the reader
+  // decompresses the stream up to `offset`.
+  void Seek(uint64 offset) { offset_ = offset; }
+
   ~TFRecordReader() override = default;
 
  private:
@@ -24,6 +24,8 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/call_options.h"
 #include "tensorflow/core/distributed_runtime/cancellable_call.h"
 #include "tensorflow/core/distributed_runtime/request_id.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -56,6 +58,23 @@ class RecvBufCall : public CancellableCall {
     req_.set_src_incarnation(server_attributes.incarnation());
     req_.set_dst_device(to_device->name());
     req_.set_request_id(GetUniqueRequestId());
+    // Collective buffers have no tensor names to opt in to the lossy
+    // compression.
+    RecvTensorCompressionFromEnv("", req_.mutable_compression());
+    // A sender in another process of this host may write to a shared memory
+    // segment of this call instead of sending the content.
+    SharedMemoryTransport* transport = SharedMemoryTransport::Global();
+    if (transport != nullptr && to_tensor->TotalBytes() > 0) {
+      StatusOr<std::unique_ptr<SharedMemoryRecvBuf>> shm_buf =
+          transport->CreateRecvBuf(to_tensor->TotalBytes());
+      if (shm_buf.ok()) {
+        shm_buf_ = std::move(shm_buf).value();
+        req_.mutable_transport_options()->PackFrom(shm_buf_->options());
+      } else {
+        VLOG(1) << "Receiving the buffer in the response: "
+                << shm_buf.status();
+      }
+    }
   }
 
   ~RecvBufCall() override {}
@@ -66,6 +85,8 @@ class RecvBufCall : public CancellableCall {
 
   RecvBufRequest req_;
   RecvBufResponse resp_;
+  // The segment the sender may write to, released with the call.
+  std::unique_ptr<SharedMemoryRecvBuf> shm_buf_;
 };
 
 void PopulateTensorFromExtra(const RecvBufRespExtra& extra,
@@ -79,6 +100,7 @@ void PopulateTensorFromExtra(const RecvBufRespExtra& extra,
 }
 
 Status PopulateTensorFromResponse(const RecvBufResponse& response,
+                                  const SharedMemoryRecvBuf* shm_buf,
                                   Tensor* cpu_tensor) {
   const bool has_transport_options = response.has_transport_options();
 
@@ -86,6 +108,25 @@ Status PopulateTensorFromResponse(const RecvBufResponse& response,
   // copied into request.buf_ptr.
   if (!has_transport_options) return OkStatus();
 
+  if (response.transport_options().Is<SharedMemoryRecvBufOptions>()) {
+    SharedMemoryRecvBufOptions options;
+    response.transport_options().UnpackTo(&options);
+    if (shm_buf == nullptr ||
+        options.segment_name() != shm_buf->options().segment_name()) {
+      return errors::Internal("RecvBufResponse names a shared memory segment ",
+                              options.segment_name(),
+                              " not created for the request");
+    }
+    return shm_buf->CopyTo(DMAHelper::base(cpu_tensor),
+                           cpu_tensor->TotalBytes());
+  }
+
+  if (response.transport_options().Is<CompressedTensorContent>()) {
+    CompressedTensorContent content;
+    response.transport_options().UnpackTo(&content);
+    return DecompressTensorContent(content, /*pool=*/nullptr, cpu_tensor);
+  }
+
   const int64_t total_bytes = cpu_tensor->TotalBytes();
   int64_t num_bytes = 0;
   RecvBufRespExtra extra;
@@ -171,20 +212,22 @@ void CollectiveRemoteAccessDistributed::RecvFromPeer(
       [this, state, to_device, to_alloc_attr, to_device_ctx, to_tensor, cpu_dev,
        dev_to_dev_stream_index, dst_tensor, done](const Status& s) {
         if (s.ok()) {
-          // In this generic implementation the bytes come back in one of 2
+          // In this generic implementation the bytes come back in one of 3
           // ways:
           // 1. In the response protobuf transport_options field (OR)
           // 2. It has already been copied over into RecvBufCall::req_.buf_ptr()
           // provided in request. buf_ptr is set to dst_tensor and points to
           // either the temporary cpu_tensor in case to_device is a GPU device
-          // OR directly to to_tensor if to_device is not a GPU device.
+          // OR directly to to_tensor if to_device is not a GPU device. (OR)
+          // 3. In the shared memory segment of the call, if the response
+          // transport_options names it.
           //
-          // PopulateTensorFromResponse handles both cases.
+          // PopulateTensorFromResponse handles all cases.
           // (NOP in 2nd case) In case the final to_tensor is on GPU, buf_ptr
           // points to a tmp CPU buffer and needs to be copied over to
           // to_tensor.
-          Status status =
-              PopulateTensorFromResponse(state->call->resp_, dst_tensor);
+          Status status = PopulateTensorFromResponse(
+              state->call->resp_, state->call->shm_buf_.get(), dst_tensor);
           if (!status.ok()) {
             done(status);
             delete state;
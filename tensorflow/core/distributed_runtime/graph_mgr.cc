@@ -43,6 +43,8 @@ limitations under the License.
 #include "tensorflow/core/graph/graph_partition.h"
 #include "tensorflow/core/graph/validate.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
@@ -65,6 +67,11 @@ GraphMgr::GraphMgr(const WorkerEnv* worker_env, const DeviceMgr* device_mgr)
   if (!status.ok()) {
     LOG(ERROR) << status.error_message();
   }
+  status = ReadBoolFromEnvVar("TF_GRAPH_MGR_REUSE_IDENTICAL_GRAPHS", false,
+                              &reuse_identical_graphs_);
+  if (!status.ok()) {
+    LOG(ERROR) << status.error_message();
+  }
 }
 
 GraphMgr::~GraphMgr() {
@@ -301,6 +308,32 @@ Status GraphMgr::Register(const string& handle, const GraphDef& gdef,
                           int64_t collective_graph_key, WorkerSession* session,
                           DistributedFunctionLibraryRuntime* cluster_flr,
                           string* graph_handle) {
+  std::optional<Fprint128> fingerprint;
+  if (reuse_identical_graphs_) {
+    string serialized = strings::StrCat(handle, ",", collective_graph_key);
+    const protobuf::MessageLite* messages[] = {&gdef, &graph_options,
+                                               &debug_options, &config_proto};
+    for (const protobuf::MessageLite* message : messages) {
+      string serialized_message;
+      if (!SerializeToStringDeterministic(*message, &serialized_message)) {
+        return errors::InvalidArgument("Failed to serialize the graph");
+      }
+      strings::StrAppend(&serialized, ",", serialized_message.size(), ":",
+                         serialized_message);
+    }
+    fingerprint = Fingerprint128(serialized);
+
+    mutex_lock l(mu_);
+    auto iter = items_by_fingerprint_.find(*fingerprint);
+    if (iter != items_by_fingerprint_.end()) {
+      Item* item = iter->second;
+      item->Ref();
+      *graph_handle = AddItemLocked(item);
+      VLOG(1) << "Reusing graph " << item->handle << " as " << *graph_handle;
+      return OkStatus();
+    }
+  }
+
   Item* item = new Item;
   Status s = InitItem(handle, gdef, graph_options, debug_options, config_proto,
                       collective_graph_key, session, cluster_flr, item);
@@ -312,14 +345,26 @@ Status GraphMgr::Register(const string& handle, const GraphDef& gdef,
   // Inserts one item into table_.
   {
     mutex_lock l(mu_);
-    *graph_handle =
-        strings::Printf("%016llx", static_cast<long long>(++next_id_));
+    *graph_handle = AddItemLocked(item);
     item->handle = *graph_handle;
-    CHECK(table_.insert({*graph_handle, item}).second);
+    // An identical graph may have been registered concurrently, in which case
+    // this one isn't reused.
+    if (fingerprint.has_value() &&
+        items_by_fingerprint_.insert({*fingerprint, item}).second) {
+      item->fingerprint = fingerprint;
+    }
   }
   return OkStatus();
 }
 
+string GraphMgr::AddItemLocked(Item* item) {
+  string graph_handle =
+      strings::Printf("%016llx", static_cast<long long>(++next_id_));
+  CHECK(table_.insert({graph_handle, item}).second);
+  ++item->num_handles;
+  return graph_handle;
+}
+
 Status GraphMgr::Deregister(const string& handle) {
   Item* item = nullptr;
   // Removes one item from table_.
@@ -332,6 +377,9 @@ Status GraphMgr::Deregister(const string& handle) {
     }
     item = iter->second;
     table_.erase(iter);
+    if (--item->num_handles == 0 && item->fingerprint.has_value()) {
+      items_by_fingerprint_.erase(*item->fingerprint);
+    }
   }
   item->Unref();
   return OkStatus();
@@ -346,6 +394,7 @@ Status GraphMgr::DeregisterAll() {
       items.push_back(entry.second);
     }
     table_.clear();
+    items_by_fingerprint_.clear();
   }
   for (auto item : items) {
     item->Unref();
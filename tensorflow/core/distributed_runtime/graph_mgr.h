@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_GRAPH_MGR_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_GRAPH_MGR_H_
 
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -29,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/framework/cost_graph.pb.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -78,6 +80,12 @@ class GraphMgr {
 
   // Registers a graph. Fills in "handle". The registered graph retains a
   // reference to cluster_flr to do cross process function calls.
+  //
+  // If TF_GRAPH_MGR_REUSE_IDENTICAL_GRAPHS is true, registering a graph that
+  // is identical to a registered one, with the same options, e.g. a partition
+  // unaffected by a new feed or fetch signature of the session, returns a new
+  // handle to the executors of the registered graph instead of building new
+  // ones. The kernels, and thus their internal state, are then shared.
   Status Register(const string& handle, const GraphDef& gdef,
                   const GraphOptions& graph_options,
                   const DebugOptions& debug_options,
@@ -112,6 +120,8 @@ class GraphMgr {
   Status DeregisterAll();
 
  private:
+  friend class GraphMgrTest;
+
   typedef GraphMgr ME;
 
   struct ExecutionUnit {
@@ -148,6 +158,14 @@ class GraphMgr {
     GraphMgr* graph_mgr;
 
     int64_t collective_graph_key;
+
+    // The fingerprint of the registration if identical registrations reuse
+    // this item, i.e. it is in items_by_fingerprint_.
+    std::optional<Fprint128> fingerprint;
+
+    // The number of graph handles referring to this item. Guarded by
+    // GraphMgr::mu_.
+    int num_handles = 0;
   };
 
   const WorkerEnv* worker_env_;  // Not owned.
@@ -162,6 +180,9 @@ class GraphMgr {
   // If true, blocks until device has finished all queued operations in a step.
   bool sync_on_finish_ = true;
 
+  // If true, identical registrations reuse the same item.
+  bool reuse_identical_graphs_ = false;
+
   // Table mapping graph handles to registered graphs.
   //
   // TODO(zhifengc): If the client does not call Deregister, we'll
@@ -169,6 +190,14 @@ class GraphMgr {
   // mechanism to gc these graphs.
   std::unordered_map<string, Item*> table_;
 
+  // Maps the fingerprints of registrations to their items, if
+  // reuse_identical_graphs_ is true. The items are owned by table_.
+  std::unordered_map<Fprint128, Item*, Fprint128Hasher> items_by_fingerprint_
+      TF_GUARDED_BY(mu_);
+
+  // Adds `item` to table_ under a new handle.
+  string AddItemLocked(Item* item) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   void StartParallelExecutors(
       const string& handle, int64_t step_id, Item* item, Rendezvous* rendezvous,
       CollectiveExecutor::Handle* ce_handle, StepStatsCollector* collector,
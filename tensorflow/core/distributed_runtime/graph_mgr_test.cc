@@ -0,0 +1,183 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/graph_mgr.h"
+
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/distributed_runtime/worker_env.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+
+constexpr char kTaskName[] = "/job:localhost/replica:0/task:0";
+
+class GraphMgrTest : public ::testing::Test {
+ protected:
+  GraphMgrTest() {
+    SessionOptions options;
+    (*options.config.mutable_device_count())["CPU"] = 2;
+    std::vector<std::unique_ptr<Device>> devices;
+    TF_CHECK_OK(DeviceFactory::AddDevices(options, kTaskName, &devices));
+    device_mgr_ = std::make_unique<StaticDeviceMgr>(std::move(devices));
+    worker_env_.env = Env::Default();
+    worker_env_.device_mgr = device_mgr_.get();
+  }
+
+  // Returns a graph manager that reuses identical registrations if
+  // `reuse_identical_graphs` is true. The option is only read on
+  // construction, so the environment is restored right away.
+  std::unique_ptr<GraphMgr> NewGraphMgr(bool reuse_identical_graphs) {
+    if (reuse_identical_graphs) {
+      setenv("TF_GRAPH_MGR_REUSE_IDENTICAL_GRAPHS", "true", /*overwrite=*/1);
+    }
+    auto graph_mgr =
+        std::make_unique<GraphMgr>(&worker_env_, device_mgr_.get());
+    unsetenv("TF_GRAPH_MGR_REUSE_IDENTICAL_GRAPHS");
+    return graph_mgr;
+  }
+
+  // Returns a graph holding a constant `value` placed on CPU `device_id`.
+  static GraphDef ConstantGraph(float value, int device_id = 0) {
+    Graph graph(OpRegistry::Global());
+    Node* node = test::graph::Constant(&graph, test::AsScalar<float>(value));
+    node->set_requested_device(
+        strings::StrCat(kTaskName, "/device:CPU:", device_id));
+    GraphDef gdef;
+    graph.ToGraphDef(&gdef);
+    return gdef;
+  }
+
+  static Status Register(GraphMgr* graph_mgr, const GraphDef& gdef,
+                         string* graph_handle) {
+    return graph_mgr->Register("session", gdef, GraphOptions(),
+                               DebugOptions(), ConfigProto(),
+                               /*collective_graph_key=*/0,
+                               /*session=*/nullptr, /*cluster_flr=*/nullptr,
+                               graph_handle);
+  }
+
+  // Returns the item registered under `graph_handle`, or nullptr.
+  static const void* ItemFor(GraphMgr* graph_mgr, const string& graph_handle) {
+    mutex_lock l(graph_mgr->mu_);
+    auto iter = graph_mgr->table_.find(graph_handle);
+    return iter == graph_mgr->table_.end() ? nullptr : iter->second;
+  }
+
+  static int NumHandles(GraphMgr* graph_mgr, const string& graph_handle) {
+    mutex_lock l(graph_mgr->mu_);
+    return graph_mgr->table_.at(graph_handle)->num_handles;
+  }
+
+  std::unique_ptr<DeviceMgr> device_mgr_;
+  WorkerEnv worker_env_;
+};
+
+namespace {
+
+TEST_F(GraphMgrTest, IdenticalGraphsAreNotReusedByDefault) {
+  std::unique_ptr<GraphMgr> graph_mgr =
+      NewGraphMgr(/*reuse_identical_graphs=*/false);
+  string h1, h2;
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h1));
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h2));
+  EXPECT_NE(h1, h2);
+  EXPECT_NE(ItemFor(graph_mgr.get(), h1), ItemFor(graph_mgr.get(), h2));
+}
+
+TEST_F(GraphMgrTest, IdenticalGraphsAreReused) {
+  std::unique_ptr<GraphMgr> graph_mgr =
+      NewGraphMgr(/*reuse_identical_graphs=*/true);
+  string h1, h2;
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h1));
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h2));
+  EXPECT_NE(h1, h2);
+  ASSERT_NE(ItemFor(graph_mgr.get(), h1), nullptr);
+  EXPECT_EQ(ItemFor(graph_mgr.get(), h1), ItemFor(graph_mgr.get(), h2));
+  EXPECT_EQ(NumHandles(graph_mgr.get(), h1), 2);
+}
+
+TEST_F(GraphMgrTest, DifferentAttrIsNotReused) {
+  std::unique_ptr<GraphMgr> graph_mgr =
+      NewGraphMgr(/*reuse_identical_graphs=*/true);
+  string h1, h2;
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h1));
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(2.0f), &h2));
+  EXPECT_NE(ItemFor(graph_mgr.get(), h1), ItemFor(graph_mgr.get(), h2));
+}
+
+TEST_F(GraphMgrTest, DifferentDeviceIsNotReused) {
+  std::unique_ptr<GraphMgr> graph_mgr =
+      NewGraphMgr(/*reuse_identical_graphs=*/true);
+  string h1, h2;
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f, 0), &h1));
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f, 1), &h2));
+  EXPECT_NE(ItemFor(graph_mgr.get(), h1), ItemFor(graph_mgr.get(), h2));
+}
+
+TEST_F(GraphMgrTest, DeregisterKeepsSharedItem) {
+  std::unique_ptr<GraphMgr> graph_mgr =
+      NewGraphMgr(/*reuse_identical_graphs=*/true);
+  string h1, h2;
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h1));
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h2));
+  const void* item = ItemFor(graph_mgr.get(), h1);
+
+  TF_ASSERT_OK(graph_mgr->Deregister(h1));
+  EXPECT_EQ(ItemFor(graph_mgr.get(), h1), nullptr);
+  EXPECT_EQ(ItemFor(graph_mgr.get(), h2), item);
+  EXPECT_EQ(NumHandles(graph_mgr.get(), h2), 1);
+
+  // The remaining handle still makes the item available for reuse.
+  string h3;
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h3));
+  EXPECT_EQ(ItemFor(graph_mgr.get(), h3), item);
+
+  TF_ASSERT_OK(graph_mgr->Deregister(h2));
+  TF_ASSERT_OK(graph_mgr->Deregister(h3));
+  EXPECT_EQ(ItemFor(graph_mgr.get(), h3), nullptr);
+}
+
+TEST_F(GraphMgrTest, ReregisterAfterDeregisteringAllHandles) {
+  std::unique_ptr<GraphMgr> graph_mgr =
+      NewGraphMgr(/*reuse_identical_graphs=*/true);
+  string h1;
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h1));
+  TF_ASSERT_OK(graph_mgr->Deregister(h1));
+
+  string h2, h3;
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h2));
+  TF_ASSERT_OK(Register(graph_mgr.get(), ConstantGraph(1.0f), &h3));
+  EXPECT_NE(h1, h2);
+  EXPECT_EQ(ItemFor(graph_mgr.get(), h2), ItemFor(graph_mgr.get(), h3));
+  EXPECT_EQ(NumHandles(graph_mgr.get(), h2), 2);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,127 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/rdma_transport.h"
+
+#include <utility>
+
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/common_runtime/process_state.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+namespace {
+
+RdmaMemoryRegistry* global_registry = nullptr;
+
+}  // namespace
+
+RdmaMemoryRegistry::RdmaMemoryRegistry(std::unique_ptr<RdmaTransport> transport,
+                                       int64_t min_tensor_bytes)
+    : transport_(std::move(transport)), min_tensor_bytes_(min_tensor_bytes) {}
+
+/* static */
+RdmaMemoryRegistry* RdmaMemoryRegistry::Global() { return global_registry; }
+
+void RdmaMemoryRegistry::RegisterMemory(void* base, size_t num_bytes) {
+  uint64 remote_key;
+  Status s = transport_->RegisterMemory(base, num_bytes, &remote_key);
+  if (!s.ok()) {
+    LOG(WARNING) << "Could not register " << num_bytes
+                 << " bytes for RDMA: " << s;
+    return;
+  }
+  mutex_lock l(mu_);
+  regions_[reinterpret_cast<uintptr_t>(base)] = {num_bytes, remote_key};
+}
+
+void RdmaMemoryRegistry::DeregisterMemory(void* base, size_t num_bytes) {
+  {
+    mutex_lock l(mu_);
+    if (regions_.erase(reinterpret_cast<uintptr_t>(base)) == 0) return;
+  }
+  transport_->DeregisterMemory(base, num_bytes);
+}
+
+bool RdmaMemoryRegistry::DescribeTensor(const Tensor& tensor,
+                                        RdmaTensorBuffer* buffer) const {
+  const int64_t num_bytes = tensor.TotalBytes();
+  if (!DataTypeCanUseMemcpy(tensor.dtype()) || num_bytes == 0 ||
+      num_bytes < min_tensor_bytes_) {
+    return false;
+  }
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(DMAHelper::base(&tensor));
+  uint64 remote_key;
+  {
+    mutex_lock l(mu_);
+    // The region starting at or before `addr`, if any, is the only one that
+    // can contain it.
+    auto it = regions_.upper_bound(addr);
+    if (it == regions_.begin()) return false;
+    --it;
+    if (addr + num_bytes > it->first + it->second.num_bytes) return false;
+    remote_key = it->second.remote_key;
+  }
+  buffer->set_address(transport_->address());
+  buffer->set_remote_addr(addr);
+  buffer->set_remote_key(remote_key);
+  buffer->set_num_bytes(num_bytes);
+  return true;
+}
+
+void RdmaMemoryRegistry::ReadTensorAsync(const RdmaTensorBuffer& buffer,
+                                         const Tensor& tensor,
+                                         StatusCallback done) const {
+  if (buffer.num_bytes() != tensor.TotalBytes()) {
+    done(errors::Internal("RDMA tensor buffer has ", buffer.num_bytes(),
+                          " bytes but the tensor has ", tensor.TotalBytes()));
+    return;
+  }
+  // The tensor was just allocated for the content, which its copy shares.
+  Tensor dst = tensor;
+  transport_->ReadAsync(buffer.address(), buffer.remote_addr(),
+                        buffer.remote_key(), DMAHelper::base(&dst),
+                        buffer.num_bytes(), std::move(done));
+}
+
+namespace rdma_transport_registration {
+
+RdmaTransportRegistration::RdmaTransportRegistration(
+    std::unique_ptr<RdmaTransport> transport) {
+  CHECK(global_registry == nullptr)  // Crash OK
+      << "Only one RDMA transport can be registered";
+  int64_t min_tensor_bytes;
+  TF_CHECK_OK(ReadInt64FromEnvVar("TF_RDMA_MIN_TENSOR_BYTES",
+                                  /*default_val=*/64 << 10,
+                                  &min_tensor_bytes));
+  global_registry =
+      new RdmaMemoryRegistry(std::move(transport), min_tensor_bytes);
+  ProcessState::singleton()->AddCPUAllocVisitor(
+      [](void* ptr, int numa_node, size_t num_bytes) {
+        global_registry->RegisterMemory(ptr, num_bytes);
+      });
+  ProcessState::singleton()->AddCPUFreeVisitor(
+      [](void* ptr, int numa_node, size_t num_bytes) {
+        global_registry->DeregisterMemory(ptr, num_bytes);
+      });
+}
+
+}  // namespace rdma_transport_registration
+
+}  // namespace tensorflow
@@ -0,0 +1,138 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RDMA_TRANSPORT_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RDMA_TRANSPORT_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/transport_options.pb.h"
+
+namespace tensorflow {
+
+// An RDMA NIC, through which the RecvTensor RPCs move large tensors by
+// one-sided reads, the RPC only carrying their metadata.
+//
+// A library implementing the transport, e.g. over ibverbs, registers it with
+// REGISTER_RDMA_TRANSPORT. Then:
+//
+// * The host memory of the CPU allocators is registered with the NIC as the
+//   allocators get it from the system, through the visitors of their
+//   SubAllocator.
+//
+// * A receiver on the host sets a RecvTensorRdmaOptions in its
+//   RecvTensorRequest. If the tensor is large enough and in registered
+//   memory, the sender answers with an RdmaTensorBuffer instead of the
+//   content and keeps the tensor until the receiver, having read it with
+//   ReadAsync, acks with a MarkRecvFinishedRequest.
+class RdmaTransport {
+ public:
+  virtual ~RdmaTransport() {}
+
+  // Returns the address of this process, which the peers pass to ReadAsync.
+  virtual string address() const = 0;
+
+  // Registers the host memory [base, base + num_bytes) for remote reads and
+  // returns its key in `*remote_key`.
+  virtual Status RegisterMemory(void* base, size_t num_bytes,
+                                uint64* remote_key) = 0;
+
+  // Deregisters memory registered with RegisterMemory.
+  virtual void DeregisterMemory(void* base, size_t num_bytes) = 0;
+
+  // Reads the `num_bytes` at `remote_addr`, in memory registered with
+  // `remote_key` by the process at `peer_address`, into `dst`, then calls
+  // `done`. `dst` need not be registered.
+  virtual void ReadAsync(const string& peer_address, uint64 remote_addr,
+                         uint64 remote_key, void* dst, size_t num_bytes,
+                         StatusCallback done) = 0;
+};
+
+// The memory registered with an RdmaTransport, and the tensors in it.
+class RdmaMemoryRegistry {
+ public:
+  // Tensors of fewer than `min_tensor_bytes` bytes are sent in the RPCs
+  // rather than read by RDMA.
+  RdmaMemoryRegistry(std::unique_ptr<RdmaTransport> transport,
+                     int64_t min_tensor_bytes);
+
+  // Returns the registry of the transport registered with
+  // REGISTER_RDMA_TRANSPORT, or null if there is none.
+  static RdmaMemoryRegistry* Global();
+
+  RdmaTransport* transport() const { return transport_.get(); }
+
+  // Registers or deregisters memory with the transport. Failures are logged,
+  // the tensors in the memory then being sent in the RPCs.
+  void RegisterMemory(void* base, size_t num_bytes);
+  void DeregisterMemory(void* base, size_t num_bytes);
+
+  // Returns true and describes in `*buffer` where the content of `tensor`
+  // can be read from, if it is large enough and in registered memory.
+  bool DescribeTensor(const Tensor& tensor, RdmaTensorBuffer* buffer) const;
+
+  // Reads the content described by `buffer` into the buffer of `tensor`,
+  // which must have the same number of bytes, then calls `done`.
+  void ReadTensorAsync(const RdmaTensorBuffer& buffer, const Tensor& tensor,
+                       StatusCallback done) const;
+
+ private:
+  struct Region {
+    size_t num_bytes;
+    uint64 remote_key;
+  };
+
+  const std::unique_ptr<RdmaTransport> transport_;
+  const int64_t min_tensor_bytes_;
+
+  mutable mutex mu_;
+  // The registered regions by base address.
+  std::map<uintptr_t, Region> regions_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RdmaMemoryRegistry);
+};
+
+namespace rdma_transport_registration {
+
+// Makes `transport` the RDMA transport of the process. It must be registered
+// before the first host allocation, so that all the host memory is.
+class RdmaTransportRegistration {
+ public:
+  explicit RdmaTransportRegistration(std::unique_ptr<RdmaTransport> transport);
+};
+
+}  // namespace rdma_transport_registration
+
+#define REGISTER_RDMA_TRANSPORT(transport_class) \
+  REGISTER_RDMA_TRANSPORT_UNIQ_HELPER(__COUNTER__, transport_class)
+#define REGISTER_RDMA_TRANSPORT_UNIQ_HELPER(ctr, transport_class) \
+  REGISTER_RDMA_TRANSPORT_UNIQ(ctr, transport_class)
+#define REGISTER_RDMA_TRANSPORT_UNIQ(ctr, transport_class)                   \
+  static ::tensorflow::rdma_transport_registration::                         \
+      RdmaTransportRegistration register_rdma_transport_##ctr(               \
+          ::std::unique_ptr<::tensorflow::RdmaTransport>(new transport_class))
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RDMA_TRANSPORT_H_
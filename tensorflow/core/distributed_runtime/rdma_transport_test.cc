@@ -0,0 +1,139 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/rdma_transport.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Reads the memory of this process, checking the keys.
+class LoopbackTransport : public RdmaTransport {
+ public:
+  string address() const override { return "loopback"; }
+
+  Status RegisterMemory(void* base, size_t num_bytes,
+                        uint64* remote_key) override {
+    *remote_key = next_key_++;
+    keys_[*remote_key] = base;
+    return OkStatus();
+  }
+
+  void DeregisterMemory(void* base, size_t num_bytes) override {}
+
+  void ReadAsync(const string& peer_address, uint64 remote_addr,
+                 uint64 remote_key, void* dst, size_t num_bytes,
+                 StatusCallback done) override {
+    auto it = keys_.find(remote_key);
+    if (peer_address != address() || it == keys_.end() ||
+        remote_addr < reinterpret_cast<uintptr_t>(it->second)) {
+      done(errors::InvalidArgument("Bad RDMA read"));
+      return;
+    }
+    std::memcpy(dst, reinterpret_cast<const void*>(remote_addr), num_bytes);
+    done(OkStatus());
+  }
+
+ private:
+  uint64 next_key_ = 1;
+  std::map<uint64, void*> keys_;
+};
+
+class RdmaMemoryRegistryTest : public ::testing::Test {
+ protected:
+  RdmaMemoryRegistryTest()
+      : registry_(std::make_unique<LoopbackTransport>(),
+                  /*min_tensor_bytes=*/64) {}
+
+  // Returns a float tensor of `num_elements` elements, in memory registered
+  // with the registry.
+  Tensor RegisteredTensor(int num_elements) {
+    Tensor tensor(DT_FLOAT, TensorShape({num_elements}));
+    for (int i = 0; i < num_elements; ++i) {
+      tensor.flat<float>()(i) = i;
+    }
+    registry_.RegisterMemory(DMAHelper::base(&tensor), tensor.TotalBytes());
+    return tensor;
+  }
+
+  RdmaMemoryRegistry registry_;
+};
+
+TEST_F(RdmaMemoryRegistryTest, ReadsRegisteredTensors) {
+  Tensor src = RegisteredTensor(100);
+  RdmaTensorBuffer buffer;
+  ASSERT_TRUE(registry_.DescribeTensor(src, &buffer));
+  EXPECT_EQ(buffer.address(), "loopback");
+  EXPECT_EQ(buffer.num_bytes(), 400);
+
+  Tensor dst(DT_FLOAT, TensorShape({100}));
+  Status read_status = errors::Unknown("Not read");
+  registry_.ReadTensorAsync(buffer, dst,
+                            [&](const Status& s) { read_status = s; });
+  TF_ASSERT_OK(read_status);
+  test::ExpectTensorEqual<float>(dst, src);
+}
+
+TEST_F(RdmaMemoryRegistryTest, DescribesTensorsInsideRegions) {
+  Tensor region = RegisteredTensor(100);
+  Tensor slice = region.Slice(10, 90);
+  RdmaTensorBuffer buffer;
+  ASSERT_TRUE(registry_.DescribeTensor(slice, &buffer));
+  EXPECT_EQ(buffer.remote_addr(),
+            reinterpret_cast<uintptr_t>(DMAHelper::base(&region)) + 40);
+  EXPECT_EQ(buffer.num_bytes(), 320);
+}
+
+TEST_F(RdmaMemoryRegistryTest, SendsOtherTensorsInTheRpcs) {
+  RdmaTensorBuffer buffer;
+  // Too small.
+  EXPECT_FALSE(registry_.DescribeTensor(RegisteredTensor(8), &buffer));
+  // Not registered.
+  EXPECT_FALSE(registry_.DescribeTensor(Tensor(DT_FLOAT, TensorShape({100})),
+                                        &buffer));
+  // Deregistered.
+  Tensor tensor = RegisteredTensor(100);
+  registry_.DeregisterMemory(DMAHelper::base(&tensor), tensor.TotalBytes());
+  EXPECT_FALSE(registry_.DescribeTensor(tensor, &buffer));
+  // Not memcpy-able.
+  Tensor strings(DT_STRING, TensorShape({100}));
+  registry_.RegisterMemory(DMAHelper::base(&strings), strings.TotalBytes());
+  EXPECT_FALSE(registry_.DescribeTensor(strings, &buffer));
+}
+
+TEST_F(RdmaMemoryRegistryTest, RejectsMismatchedTensors) {
+  Tensor src = RegisteredTensor(100);
+  RdmaTensorBuffer buffer;
+  ASSERT_TRUE(registry_.DescribeTensor(src, &buffer));
+  Tensor dst(DT_FLOAT, TensorShape({50}));
+  Status read_status;
+  registry_.ReadTensorAsync(buffer, dst,
+                            [&](const Status& s) { read_status = s; });
+  EXPECT_TRUE(errors::IsInternal(read_status)) << read_status;
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -21,11 +21,13 @@ limitations under the License.
 #include "grpcpp/grpcpp.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/distributed_runtime/call_options.h"
+#include "tensorflow/core/distributed_runtime/rdma_transport.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_client_cq_tag.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_state.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/distributed_runtime/worker_cache_logger.h"
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -66,6 +68,7 @@ class GrpcRemoteWorker : public WorkerInterface {
         instancesource_(Method(GrpcWorkerMethod::kCompleteInstance)),
         getstepsequence_(Method(GrpcWorkerMethod::kGetStepSequence)),
         markrecvfinished_(Method(GrpcWorkerMethod::kMarkRecvFinished)),
+        recvtensors_(Method(GrpcWorkerMethod::kRecvTensors)),
         logger_(logger),
         target_(target) {}
 
@@ -202,8 +205,8 @@ class GrpcRemoteWorker : public WorkerInterface {
     // Type-specialized logging for this method.
     bool logging_active = logger_->LoggingActive() || VLOG_IS_ON(2);
 
-    auto callback = [this, request, response, done, start_usec,
-                     logging_active](Status s) {
+    auto finish = [this, request, response, done, start_usec,
+                   logging_active](Status s) {
       if (logging_active) {
         if (logger_->LoggingActive()) {
           int64_t end_usec = Env::Default()->NowMicros();
@@ -252,10 +255,42 @@ class GrpcRemoteWorker : public WorkerInterface {
       }
       done(s);
     };
+    // If the sender answered with where the content is, read it by RDMA
+    // before acking. If it answered with the content compressed, decompress
+    // it.
+    auto callback = [this, response, finish = std::move(finish)](Status s) {
+      const auto& transport_options = response->metadata().transport_options();
+      if (s.ok() && transport_options.Is<CompressedTensorContent>()) {
+        CompressedTensorContent content;
+        transport_options.UnpackTo(&content);
+        // The tensor was just allocated for the content, which its copy
+        // shares.
+        Tensor tensor = response->tensor();
+        finish(DecompressTensorContent(content, callback_threadpool_,
+                                       &tensor));
+        return;
+      }
+      RdmaMemoryRegistry* rdma = RdmaMemoryRegistry::Global();
+      if (!s.ok() || rdma == nullptr ||
+          !transport_options.Is<RdmaTensorBuffer>()) {
+        finish(s);
+        return;
+      }
+      RdmaTensorBuffer buffer;
+      transport_options.UnpackTo(&buffer);
+      rdma->ReadTensorAsync(buffer, response->tensor(), finish);
+    };
 
     IssueRequest(request, response, recvtensor_, callback, call_opts);
   }
 
+  void RecvTensorsAsync(CallOptions* call_opts,
+                        const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override {
+    IssueRequest(request, response, recvtensors_, std::move(done), call_opts);
+  }
+
   void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
                     StatusCallback done) override {
     IssueRequest(request, response, logging_, done);
@@ -331,6 +366,7 @@ class GrpcRemoteWorker : public WorkerInterface {
   const ::grpc::string instancesource_;
   const ::grpc::string getstepsequence_;
   const ::grpc::string markrecvfinished_;
+  const ::grpc::string recvtensors_;
 
   // Support for logging.
   WorkerCacheLogger* logger_;
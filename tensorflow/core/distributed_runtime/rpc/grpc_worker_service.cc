@@ -32,11 +32,14 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/distributed_runtime/graph_mgr.h"
+#include "tensorflow/core/distributed_runtime/rdma_transport.h"
 #include "tensorflow/core/distributed_runtime/rendezvous_mgr_interface.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_response_cache.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_session.h"
@@ -146,6 +149,7 @@ class GrpcWorkerServiceThread {
     SETUP_FOR_REQUEST(CompleteInstance, 10, true);
     SETUP_FOR_REQUEST(GetStepSequence, 10, true);
     SETUP_FOR_REQUEST(RecvBuf, 500, true);
+    SETUP_FOR_REQUEST(RecvTensors, 100, true);
     SETUP_FOR_REQUEST(RunGraph, 100, true);
     SETUP_FOR_REQUEST(CleanupGraph, 100, false);
     SETUP_FOR_REQUEST(MarkRecvFinished, 10, false);
@@ -236,6 +240,7 @@ class GrpcWorkerServiceThread {
       WorkerCall<MarkRecvFinishedRequest, MarkRecvFinishedResponse>* call) {
     VLOG(3) << "Clean cache entry for request " << call->request.request_id();
     worker_->RemoveCacheEntryForId(call->request.request_id());
+    worker_->ReleaseRdmaTensor(call->request.request_id());
     call->SendResponse(::grpc::Status::OK);
     ENQUEUE_REQUEST(MarkRecvFinished, false);
   }
@@ -302,6 +307,25 @@ class GrpcWorkerServiceThread {
     ENQUEUE_REQUEST(RecvBuf, true);
   }
 
+  void RecvTensorsHandler(
+      WorkerCall<RecvTensorsRequest, RecvTensorsResponse>* call) {
+    Schedule([this, call]() {
+      CallOptions* call_opts = new CallOptions;
+      call->SetCancelCallback([call_opts]() { call_opts->StartCancel(); });
+      worker_->RecvTensorsAsync(
+          call_opts, &call->request, &call->response,
+          [call, call_opts](const Status& s) {
+            call->ClearCancelCallback();
+            delete call_opts;
+            if (!s.ok()) {
+              VLOG(3) << "Bad response from RecvTensors:" << s;
+            }
+            call->SendResponse(ToGrpcStatus(s));
+          });
+    });
+    ENQUEUE_REQUEST(RecvTensors, true);
+  }
+
   void CompleteGroupHandler(
       WorkerCall<CompleteGroupRequest, CompleteGroupResponse>* call) {
     Schedule([this, call]() {
@@ -448,11 +472,21 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
   const int64_t step_id = request->step_id();
 
   bool cache_enabled = (response_cache_ != nullptr && request_id != 0);
-
-  auto do_response = [response, done, cache_enabled](const Tensor& tensor,
-                                                     bool is_dead,
-                                                     const Status& status) {
-    if (status.ok()) {
+  // The receiver acks an RDMA read with the request id.
+  const bool rdma_ok =
+      request_id != 0 &&
+      request->transport_options().Is<RecvTensorRdmaOptions>() &&
+      RdmaMemoryRegistry::Global() != nullptr;
+
+  auto do_response = [this, response, done, cache_enabled, rdma_ok, request_id,
+                      step_id, compression = request->compression()](
+                         const Tensor& tensor, bool is_dead,
+                         const Status& status) {
+    if (status.ok() &&
+        !(rdma_ok && !is_dead &&
+          EncodeRdmaTensor(request_id, step_id, tensor, response)) &&
+        !(!is_dead && EncodeCompressedTensor(compression, tensor,
+                                             cache_enabled, response))) {
       grpc::EncodeTensorToByteBuffer(is_dead, tensor, cache_enabled, response);
     }
     done(status);
@@ -591,6 +625,24 @@ void SetTensorInRecvBufResp(int64_t max_chunk_bytes, const Tensor* tensor,
   }
   response->mutable_transport_options()->PackFrom(extra);
 }
+
+// Writes the content of `tensor` to the shared memory segment described by
+// `options` of a receiver in another process of this host, if `transport` is
+// non-null and can, and returns whether it did.
+bool WriteRecvBufToPeer(SharedMemoryTransport* transport,
+                        const SharedMemoryRecvBufOptions& options,
+                        const Tensor& tensor) {
+  if (transport == nullptr || tensor.TotalBytes() == 0) {
+    return false;
+  }
+  Status s = transport->WriteRecvBuf(options, DMAHelper::base(&tensor),
+                                     tensor.TotalBytes());
+  if (!s.ok()) {
+    VLOG(1) << "Sending the buffer in the response instead: " << s;
+    return false;
+  }
+  return true;
+}
 }  // namespace
 
 void GrpcWorker::RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
@@ -599,11 +651,30 @@ void GrpcWorker::RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
   const int64_t step_id = request->step_id();
   bool cache_enabled = (response_cache_ != nullptr && request_id != 0);
 
-  auto do_response = [this, response, done, cache_enabled](
-                         const Tensor& tensor, bool is_dead,
-                         const Status& status) {
+  // A receiver in another process of this host may have created a shared
+  // memory segment for the buffer.
+  SharedMemoryTransport* shm_transport = nullptr;
+  SharedMemoryRecvBufOptions shm_options;
+  if (request->transport_options().Is<SharedMemoryRecvBufOptions>() &&
+      request->transport_options().UnpackTo(&shm_options)) {
+    shm_transport = SharedMemoryTransport::Global();
+  }
+
+  auto do_response = [this, response, done, cache_enabled,
+                      compression = request->compression(), shm_transport,
+                      shm_options](const Tensor& tensor, bool is_dead,
+                                   const Status& status) {
     if (status.ok()) {
-      SetTensorInRecvBufResp(recv_buf_max_chunk_, &tensor, response);
+      CompressedTensorContent content;
+      if (WriteRecvBufToPeer(shm_transport, shm_options, tensor)) {
+        // The content written to the receiver's segment is not sent.
+        response->mutable_transport_options()->PackFrom(shm_options);
+      } else if (CompressTensorContent(tensor, compression,
+                                       env_->compute_pool, &content)) {
+        response->mutable_transport_options()->PackFrom(content);
+      } else {
+        SetTensorInRecvBufResp(recv_buf_max_chunk_, &tensor, response);
+      }
     }
     response->set_send_start_micros(env_->env->NowMicros());
     response->set_require_ack(cache_enabled);
@@ -746,9 +817,57 @@ void GrpcWorker::CleanupGraphAsync(const CleanupGraphRequest* request,
     // a worker crashes before acking a request.
     response_cache_->CleanEntriesForStep(request->step_id());
   }
+  {
+    // Likewise for the tensors read by RDMA.
+    mutex_lock l(rdma_mu_);
+    for (auto it = rdma_tensors_.begin(); it != rdma_tensors_.end();) {
+      if (it->second.step_id == request->step_id()) {
+        it = rdma_tensors_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
   Worker::CleanupGraphAsync(request, response, done);
 }
 
+bool GrpcWorker::EncodeRdmaTensor(int64_t request_id, int64_t step_id,
+                                  const Tensor& tensor,
+                                  ::grpc::ByteBuffer* response) {
+  RdmaTensorBuffer buffer;
+  if (!RdmaMemoryRegistry::Global()->DescribeTensor(tensor, &buffer)) {
+    return false;
+  }
+  RecvTensorResponse proto;
+  proto.mutable_tensor()->set_dtype(tensor.dtype());
+  tensor.shape().AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  proto.set_send_start_micros(Env::Default()->NowMicros());
+  proto.mutable_transport_options()->PackFrom(buffer);
+  proto.set_require_ack(true);
+  grpc::EncodeRecvTensorResponseToByteBuffer(proto, response);
+  mutex_lock l(rdma_mu_);
+  rdma_tensors_[request_id] = {step_id, tensor};
+  return true;
+}
+
+bool GrpcWorker::EncodeCompressedTensor(const TensorCompression& compression,
+                                        const Tensor& tensor, bool require_ack,
+                                        ::grpc::ByteBuffer* response) {
+  CompressedTensorContent content;
+  if (!CompressTensorContent(tensor, compression, env_->compute_pool,
+                             &content)) {
+    return false;
+  }
+  RecvTensorResponse proto;
+  proto.mutable_tensor()->set_dtype(tensor.dtype());
+  tensor.shape().AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  proto.set_send_start_micros(Env::Default()->NowMicros());
+  proto.mutable_transport_options()->PackFrom(content);
+  proto.set_require_ack(require_ack);
+  grpc::EncodeRecvTensorResponseToByteBuffer(proto, response);
+  return true;
+}
+
 WorkerEnv* GrpcWorker::env() { return env_; }
 
 void GrpcWorker::RemoveCacheEntryForId(int64_t request_id) {
@@ -757,6 +876,11 @@ void GrpcWorker::RemoveCacheEntryForId(int64_t request_id) {
   }
 }
 
+void GrpcWorker::ReleaseRdmaTensor(int64_t request_id) {
+  mutex_lock l(rdma_mu_);
+  rdma_tensors_.erase(request_id);
+}
+
 std::unique_ptr<GrpcWorker> NewGrpcWorker(WorkerEnv* env,
                                           const ConfigProto& config) {
   return std::unique_ptr<GrpcWorker>(new GrpcWorker(env, config));
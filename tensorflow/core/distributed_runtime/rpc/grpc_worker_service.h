@@ -23,6 +23,9 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_response_cache.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
 #include "tensorflow/tsl/distributed_runtime/rpc/async_service_interface.h"
 
@@ -67,9 +70,33 @@ class GrpcWorker : public Worker {
 
   void RemoveCacheEntryForId(int64_t request_id);
 
+  // Releases the tensor of `request_id` that the receiver read by RDMA.
+  void ReleaseRdmaTensor(int64_t request_id);
+
  private:
+  // Encodes the metadata of `tensor` into `response`, for the receiver to
+  // read its content by RDMA, and keeps it until ReleaseRdmaTensor. Returns
+  // false if it is to be sent in the response instead.
+  bool EncodeRdmaTensor(int64_t request_id, int64_t step_id,
+                        const Tensor& tensor, ::grpc::ByteBuffer* response);
+
+  // Encodes `tensor` into `response` with its content compressed as
+  // `compression` asks. Returns false if it is to be sent uncompressed.
+  bool EncodeCompressedTensor(const TensorCompression& compression,
+                              const Tensor& tensor, bool require_ack,
+                              ::grpc::ByteBuffer* response);
+
   std::unique_ptr<GrpcResponseCache> response_cache_;
   const int32 recv_buf_max_chunk_;
+
+  struct RdmaTensor {
+    int64_t step_id;
+    Tensor tensor;
+  };
+  mutex rdma_mu_;
+  // The tensors being read by RDMA, by request id.
+  std::unordered_map<int64_t, RdmaTensor> rdma_tensors_
+      TF_GUARDED_BY(rdma_mu_);
 };
 
 std::unique_ptr<GrpcWorker> NewGrpcWorker(WorkerEnv* worker_env,
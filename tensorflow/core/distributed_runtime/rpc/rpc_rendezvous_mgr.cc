@@ -15,12 +15,21 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/distributed_runtime/rdma_transport.h"
 #include "tensorflow/core/distributed_runtime/request_id.h"
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
 #include "tensorflow/core/framework/types.h"
@@ -31,15 +40,28 @@ limitations under the License.
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/transport_options.pb.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
 namespace {
 
+// A recv waiting for its batch to be sent.
+struct BatchedRecv {
+  Rendezvous::ParsedKey parsed;
+  Rendezvous::Args recv_args;
+  Device* dst_device;
+  Rendezvous::DoneCallback done;
+};
+
 class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  public:
-  RpcRemoteRendezvous(const WorkerEnv* env, int64_t step_id)
-      : BaseRemoteRendezvous(env, step_id) {}
+  RpcRemoteRendezvous(const WorkerEnv* env, int64_t step_id,
+                      int64_t batch_size, int64_t batch_wait_micros)
+      : BaseRemoteRendezvous(env, step_id),
+        batch_size_(batch_size),
+        batch_wait_micros_(batch_wait_micros) {}
 
  protected:
   void RecvFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
@@ -49,6 +71,39 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  private:
   ~RpcRemoteRendezvous() override {}
 
+  // Receives the tensor with its own RecvTensor RPC.
+  void RecvOneFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
+                              const Rendezvous::Args& args, DoneCallback done);
+
+  // Returns whether the recv may be batched with others from the same worker
+  // into a RecvTensors RPC, setting its source worker and destination device.
+  bool MayBatch(const Rendezvous::ParsedKey& parsed,
+                const Rendezvous::Args& args, string* src_worker,
+                Device** dst_device);
+
+  // Sends the recvs waiting for `src_worker`, if any.
+  void FlushBatch(const string& src_worker) TF_LOCKS_EXCLUDED(batch_mu_);
+
+  // Receives the tensors of `recvs` from `src_worker` in one RPC.
+  void RecvBatchFromRemoteAsync(const string& src_worker,
+                                std::vector<BatchedRecv> recvs);
+
+  // Fails the recvs of a batch with `s`, except those cancelled by the
+  // cancellation manager of another recv, which are received on their own.
+  void FailBatch(const Status& s, std::vector<BatchedRecv>* recvs);
+
+  // The maximum number of tensors in a RecvTensors RPC, batching being
+  // disabled if less than 2, and how long a recv waits for others to join
+  // its batch, and then the sender for the other tensors once one is
+  // produced.
+  const int64_t batch_size_;
+  const int64_t batch_wait_micros_;
+
+  mutex batch_mu_;
+  // The recvs waiting for their batch to be sent, by source worker.
+  absl::flat_hash_map<string, std::vector<BatchedRecv>> batches_
+      TF_GUARDED_BY(batch_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRemoteRendezvous);
 };
 
@@ -57,7 +112,8 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
  public:
   RpcRecvTensorCall() : wi_(nullptr), dst_device_(nullptr) {}
 
-  void Init(WorkerInterface* wi, int64_t step_id, StringPiece key,
+  void Init(WorkerInterface* wi, int64_t step_id,
+            const Rendezvous::ParsedKey& parsed,
             AllocatorAttributes alloc_attrs, Device* dst_device,
             const Rendezvous::Args& recv_args, Rendezvous::DoneCallback done) {
     wi_ = wi;
@@ -66,8 +122,23 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     recv_args_ = recv_args;
     done_ = std::move(done);
     req_.set_step_id(step_id);
+    const StringPiece key = parsed.FullKey();
     req_.set_rendezvous_key(key.data(), key.size());
     req_.set_request_id(GetUniqueRequestId());
+    const bool on_host = alloc_attrs.on_host() ||
+                         dst_device->attributes().device_type() == DEVICE_CPU;
+    // Large tensors received on the host may be read by RDMA.
+    RdmaMemoryRegistry* rdma = RdmaMemoryRegistry::Global();
+    if (rdma != nullptr && on_host) {
+      RecvTensorRdmaOptions rdma_options;
+      rdma_options.set_address(rdma->transport()->address());
+      req_.mutable_transport_options()->PackFrom(rdma_options);
+    }
+    // Or sent compressed, the receiver decompressing them in host memory.
+    if (on_host) {
+      RecvTensorCompressionFromEnv(parsed.edge_name,
+                                   req_.mutable_compression());
+    }
   }
 
   void Reset() {
@@ -228,10 +299,272 @@ static RpcRecvTensorFreeList* get_call_freelist() {
   return call_freelist;
 }
 
+// Used to retrieve a batch of tensors from a remote process.
+class RpcRecvTensorsCall : public BaseRecvTensorCall {
+ public:
+  RpcRecvTensorsCall(WorkerInterface* wi, const string& src_worker,
+                     int64_t step_id, int64_t wait_micros,
+                     std::vector<BatchedRecv> recvs)
+      : wi_(wi), src_worker_(src_worker), recvs_(std::move(recvs)) {
+    req_.set_wait_micros(wait_micros);
+    for (const BatchedRecv& recv : recvs_) {
+      RecvTensorRequest* req = req_.add_requests();
+      req->set_step_id(step_id);
+      const StringPiece key = recv.parsed.FullKey();
+      req->set_rendezvous_key(key.data(), key.size());
+    }
+  }
+
+  ~RpcRecvTensorsCall() override {
+    CHECK_EQ(static_cast<WorkerInterface*>(nullptr), wi_)
+        << "Leaking WorkerInterface in RpcRecvTensorsCall destructor.";
+  }
+
+  // Starts the RecvTensors call, checking for an async abort as
+  // RpcRecvTensorCall does. The RPC may complete synchronously, e.g. if the
+  // worker does not support it, so `recv_done` runs after whichever of the
+  // RPC and the abort check finishes last, which may destroy this call.
+  void Start(std::function<void()> recv_done) override {
+    auto num_pending = std::make_shared<std::atomic<int>>(2);
+    auto shared_recv_done =
+        std::make_shared<std::function<void()>>(std::move(recv_done));
+    auto cb = [this, num_pending, shared_recv_done](const Status& s) {
+      if (!s.ok()) {
+        mutex_lock l(mu_);
+        status_.Update(s);
+      }
+      if (num_pending->fetch_sub(1) == 1) (*shared_recv_done)();
+    };
+    wi_->RecvTensorsAsync(&opts_, &req_, &resp_, std::move(cb));
+    Status s;
+    {
+      mutex_lock l(mu_);
+      s = status_;
+    }
+    if (!s.ok()) {
+      opts_.StartCancel();
+    }
+    if (num_pending->fetch_sub(1) == 1) (*shared_recv_done)();
+  }
+
+  void StartAbort(const Status& s) override {
+    {
+      mutex_lock l(mu_);
+      status_.Update(s);
+    }
+    opts_.StartCancel();
+  }
+
+  Status status() const override {
+    mutex_lock l(mu_);
+    return status_;
+  }
+
+  void ReleaseWorker(WorkerCacheInterface* worker_cache) {
+    worker_cache->ReleaseWorker(src_worker_, wi_);
+    wi_ = nullptr;
+  }
+
+  std::vector<BatchedRecv>* recvs() { return &recvs_; }
+  const RecvTensorsResponse& response() const { return resp_; }
+
+ private:
+  WorkerInterface* wi_;  // Not owned.
+  const string src_worker_;
+  std::vector<BatchedRecv> recvs_;
+  CallOptions opts_;
+  RecvTensorsRequest req_;
+  RecvTensorsResponse resp_;
+
+  mutable mutex mu_;
+  Status status_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RpcRecvTensorsCall);
+};
+
 void RpcRemoteRendezvous::RecvFromRemoteAsync(
     const Rendezvous::ParsedKey& parsed, const Rendezvous::Args& recv_args,
     DoneCallback done) {
   CHECK(is_initialized());
+  string src_worker;
+  Device* dst_device;
+  if (batch_size_ < 2 ||
+      !MayBatch(parsed, recv_args, &src_worker, &dst_device)) {
+    RecvOneFromRemoteAsync(parsed, recv_args, std::move(done));
+    return;
+  }
+
+  std::vector<BatchedRecv> full_batch;
+  bool start_timer = false;
+  {
+    mutex_lock l(batch_mu_);
+    std::vector<BatchedRecv>& batch = batches_[src_worker];
+    batch.push_back({parsed, recv_args, dst_device, std::move(done)});
+    if (static_cast<int64_t>(batch.size()) >= batch_size_) {
+      full_batch.swap(batch);
+    } else {
+      start_timer = batch.size() == 1;
+    }
+  }
+  if (!full_batch.empty()) {
+    RecvBatchFromRemoteAsync(src_worker, std::move(full_batch));
+  } else if (start_timer) {
+    // The timer may flush a later batch early, which is harmless.
+    Ref();
+    env_->env->SchedClosureAfter(batch_wait_micros_, [this, src_worker]() {
+      FlushBatch(src_worker);
+      Unref();
+    });
+  }
+}
+
+bool RpcRemoteRendezvous::MayBatch(const Rendezvous::ParsedKey& parsed,
+                                   const Rendezvous::Args& args,
+                                   string* src_worker, Device** dst_device) {
+  string src_rel_device;
+  if (!DeviceNameUtils::SplitDeviceName(parsed.src_device, src_worker,
+                                        &src_rel_device) ||
+      !session()->device_mgr()->LookupDevice(parsed.dst_device, dst_device)
+           .ok()) {
+    return false;
+  }
+  // The tensors of a batch are sent as protos and parsed on the host, so
+  // the tensors that may be read by RDMA or compressed are left out.
+  TensorCompression compression;
+  return (args.alloc_attrs.on_host() ||
+          (*dst_device)->attributes().device_type() == DEVICE_CPU) &&
+         RdmaMemoryRegistry::Global() == nullptr &&
+         !RecvTensorCompressionFromEnv(parsed.edge_name, &compression);
+}
+
+void RpcRemoteRendezvous::FlushBatch(const string& src_worker) {
+  std::vector<BatchedRecv> batch;
+  {
+    mutex_lock l(batch_mu_);
+    auto it = batches_.find(src_worker);
+    if (it == batches_.end()) return;
+    batch.swap(it->second);
+  }
+  if (!batch.empty()) {
+    RecvBatchFromRemoteAsync(src_worker, std::move(batch));
+  }
+}
+
+void RpcRemoteRendezvous::RecvBatchFromRemoteAsync(
+    const string& src_worker, std::vector<BatchedRecv> recvs) {
+  if (recvs.size() == 1) {
+    RecvOneFromRemoteAsync(recvs[0].parsed, recvs[0].recv_args,
+                           std::move(recvs[0].done));
+    return;
+  }
+  WorkerSession* sess = session();
+  std::shared_ptr<WorkerCacheInterface> worker_cache =
+      sess->GetSharedWorkerCache();
+  WorkerInterface* rwi = worker_cache->GetOrCreateWorker(src_worker);
+  if (rwi == nullptr) {
+    Status s = errors::Internal("No worker known as ", src_worker);
+    for (BatchedRecv& recv : recvs) {
+      recv.done(s, Args(), recv.recv_args, Tensor{}, false);
+    }
+    return;
+  }
+  // The recvs may have different cancellation managers, e.g. those of the
+  // functions of the step, any of which aborts the call.
+  std::vector<Rendezvous::Args> cancellation_args;
+  for (const BatchedRecv& recv : recvs) {
+    if (std::none_of(cancellation_args.begin(), cancellation_args.end(),
+                     [&recv](const Rendezvous::Args& args) {
+                       return args.cancellation_manager ==
+                              recv.recv_args.cancellation_manager;
+                     })) {
+      cancellation_args.push_back(recv.recv_args);
+    }
+  }
+  auto* call =
+      new RpcRecvTensorsCall(rwi, src_worker, step_id_, batch_wait_micros_,
+                             std::move(recvs));
+  for (const Rendezvous::Args& args : cancellation_args) {
+    RegisterCall(call, args);
+  }
+  if (!call->status().ok()) {
+    for (const Rendezvous::Args& args : cancellation_args) {
+      DeregisterCall(call, args);
+    }
+    call->ReleaseWorker(sess->worker_cache());
+    FailBatch(call->status(), call->recvs());
+    delete call;
+    return;
+  }
+
+  Ref();
+  call->Start([this, call, cancellation_args = std::move(cancellation_args),
+               worker_cache]() {
+    for (const Rendezvous::Args& args : cancellation_args) {
+      DeregisterCall(call, args);
+    }
+    Status s = call->status();
+    call->ReleaseWorker(session()->worker_cache());
+    std::vector<BatchedRecv>& recvs = *call->recvs();
+    if (errors::IsUnimplemented(s)) {
+      // The sender does not support RecvTensors.
+      for (BatchedRecv& recv : recvs) {
+        RecvOneFromRemoteAsync(recv.parsed, recv.recv_args,
+                               std::move(recv.done));
+      }
+    } else if (!s.ok()) {
+      FailBatch(s, &recvs);
+    } else {
+      const RecvTensorsResponse& response = call->response();
+      std::vector<bool> pending(recvs.size(), false);
+      for (int index : response.pending()) {
+        if (index >= 0 && index < static_cast<int>(pending.size())) {
+          pending[index] = true;
+        }
+      }
+      for (int i = 0; i < static_cast<int>(recvs.size()); ++i) {
+        BatchedRecv& recv = recvs[i];
+        if (pending[i] || i >= response.responses_size()) {
+          // Not produced in time: received on its own.
+          RecvOneFromRemoteAsync(recv.parsed, recv.recv_args,
+                                 std::move(recv.done));
+          continue;
+        }
+        const RecvTensorResponse& tensor_response = response.responses(i);
+        Tensor tensor;
+        Status parse_status;
+        if (!tensor_response.is_dead() &&
+            !tensor.FromProto(
+                recv.dst_device->GetAllocator(recv.recv_args.alloc_attrs),
+                tensor_response.tensor())) {
+          parse_status = errors::Internal("Cannot parse the tensor of ",
+                                          recv.parsed.FullKey());
+        }
+        recv.done(parse_status, Args(), recv.recv_args, tensor,
+                  tensor_response.is_dead());
+      }
+    }
+    delete call;
+    Unref();
+  });
+}
+
+void RpcRemoteRendezvous::FailBatch(const Status& s,
+                                    std::vector<BatchedRecv>* recvs) {
+  for (BatchedRecv& recv : *recvs) {
+    CancellationManager* cm = recv.recv_args.cancellation_manager;
+    if (errors::IsCancelled(s) && (cm == nullptr || !cm->IsCancelled())) {
+      // Its own RPC is aborted right away if the rendezvous was.
+      RecvOneFromRemoteAsync(recv.parsed, recv.recv_args,
+                             std::move(recv.done));
+    } else {
+      recv.done(s, Args(), recv.recv_args, Tensor(), false);
+    }
+  }
+}
+
+void RpcRemoteRendezvous::RecvOneFromRemoteAsync(
+    const Rendezvous::ParsedKey& parsed, const Rendezvous::Args& recv_args,
+    DoneCallback done) {
   Status s;
 
   // Prepare a RecvTensor call that can handle being aborted.
@@ -267,7 +600,7 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
     return;
   }
 
-  call->Init(rwi, step_id_, parsed.FullKey(), recv_args.alloc_attrs, dst_device,
+  call->Init(rwi, step_id_, parsed, recv_args.alloc_attrs, dst_device,
              recv_args, std::move(done));
 
   // Record "call" in calls_ so that it can be aborted cleanly.
@@ -306,11 +639,17 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
 }  // namespace
 
 RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env)
-    : BaseRendezvousMgr(env) {}
+    : BaseRendezvousMgr(env) {
+  TF_CHECK_OK(
+      ReadInt64FromEnvVar("TF_RECV_TENSOR_BATCH_SIZE", 0, &batch_size_));
+  TF_CHECK_OK(ReadInt64FromEnvVar("TF_RECV_TENSOR_BATCH_WAIT_MICROS", 100,
+                                  &batch_wait_micros_));
+}
 
 BaseRemoteRendezvous* RpcRendezvousMgr::Create(int64_t step_id,
                                                const WorkerEnv* worker_env) {
-  return new RpcRemoteRendezvous(worker_env, step_id);
+  return new RpcRemoteRendezvous(worker_env, step_id, batch_size_,
+                                 batch_wait_micros_);
 }
 
 }  // end namespace tensorflow
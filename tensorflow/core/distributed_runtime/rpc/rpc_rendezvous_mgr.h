@@ -42,6 +42,11 @@ class DeviceMgr;
 //
 // Tensors sent and recved through rendezvous managed by this
 // RendezvousMgr must have keys generated by Rendezvous::CreateKey.
+//
+// If the environment variable TF_RECV_TENSOR_BATCH_SIZE is at least 2, the
+// recvs from the same worker to the host issued within
+// TF_RECV_TENSOR_BATCH_WAIT_MICROS (100 by default) of each other are batched
+// into RecvTensors RPCs of up to that many tensors.
 class RpcRendezvousMgr : public BaseRendezvousMgr {
  public:
   explicit RpcRendezvousMgr(const WorkerEnv* env);
@@ -50,6 +55,9 @@ class RpcRendezvousMgr : public BaseRendezvousMgr {
   BaseRemoteRendezvous* Create(int64_t step_id, const WorkerEnv* worker_env);
 
  private:
+  int64_t batch_size_;
+  int64_t batch_wait_micros_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRendezvousMgr);
 };
 
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
@@ -66,6 +67,36 @@ class DummyWorker : public TestWorkerInterface {
       done(OkStatus());
     });
   }
+
+  // Sends each tensor as its key, except that of the last request, which is
+  // left pending.
+  void RecvTensorsAsync(CallOptions* opts, const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override {
+    {
+      mutex_lock l(mu_);
+      batch_sizes_.push_back(request->requests_size());
+    }
+    for (int i = 0; i < request->requests_size(); ++i) {
+      RecvTensorResponse* tensor_response = response->add_responses();
+      if (i + 1 < request->requests_size()) {
+        V(request->requests(i).rendezvous_key())
+            .AsProtoTensorContent(tensor_response->mutable_tensor());
+      } else {
+        response->add_pending(i);
+      }
+    }
+    SchedClosure([done = std::move(done)]() { done(OkStatus()); });
+  }
+
+  std::vector<int> batch_sizes() {
+    mutex_lock l(mu_);
+    return batch_sizes_;
+  }
+
+ private:
+  mutex mu_;
+  std::vector<int> batch_sizes_ TF_GUARDED_BY(mu_);
 };
 
 // Fake cache implementation for WorkerEnv.
@@ -95,6 +126,9 @@ class DummyWorkerCache : public WorkerCacheInterface {
   void GetDeviceLocalityAsync(const string& device, DeviceLocality* locality,
                               StatusCallback done) override {}
 
+ public:
+  DummyWorker* dummy_remote_worker() { return dummy_remote_worker_; }
+
  private:
   DummyWorker* dummy_remote_worker_ = nullptr;
 };
@@ -104,7 +138,9 @@ static Device* CreateDevice(const char* type, const char* name) {
    public:
     explicit FakeDevice(const DeviceAttributes& attr) : Device(nullptr, attr) {}
     Status Sync() override { return OkStatus(); }
-    Allocator* GetAllocator(AllocatorAttributes) override { return nullptr; }
+    Allocator* GetAllocator(AllocatorAttributes) override {
+      return cpu_allocator();
+    }
   };
   DeviceAttributes attr;
   attr.set_name(name);
@@ -350,4 +386,107 @@ TEST_F(RpcRendezvousMgrTest, RemoteRecvAsyncMany) {
   rmgr_.Cleanup(step_id);
 }
 
+TEST_F(RpcRendezvousMgrTest, RemoteRecvBatched) {
+  setenv("TF_RECV_TENSOR_BATCH_SIZE", "4", /*overwrite=*/1);
+  setenv("TF_RECV_TENSOR_BATCH_WAIT_MICROS", "1000", /*overwrite=*/1);
+  RpcRendezvousMgr rmgr(&env);
+  unsetenv("TF_RECV_TENSOR_BATCH_SIZE");
+  unsetenv("TF_RECV_TENSOR_BATCH_WAIT_MICROS");
+
+  const int64_t step_id = 123;
+  const int num_requests = 8;
+  std::vector<string> keys;
+  for (int i = 0; i < num_requests; ++i) {
+    keys.push_back(Rendezvous::CreateKey(
+        "/job:worker/replica:1/task:2/cpu:0", 7890,
+        "/job:mnist/replica:1/task:2/cpu:1", strings::StrCat("foo", i),
+        FrameAndIter(0, 0)));
+  }
+  std::vector<Tensor> vals(num_requests);
+  {
+    RemoteRendezvous* rendez = rmgr.Find(step_id);
+    TF_ASSERT_OK(rendez->Initialize(&worker_session_));
+    core::ScopedUnref unref(rendez);
+    Rendezvous::Args args;
+    mutex mu;
+    Status status = OkStatus();
+    BlockingCounter counter(num_requests);
+    for (int i = 0; i < num_requests; ++i) {
+      rendez->RecvAsync(
+          MakeKey(keys[i]), args,
+          [&mu, &status, &counter, &vals, i](
+              const Status& s, const Rendezvous::Args&,
+              const Rendezvous::Args&, const Tensor& val, const bool) {
+            {
+              mutex_lock l(mu);
+              status.Update(s);
+              vals[i] = val;
+            }
+            counter.DecrementCount();
+          });
+    }
+    counter.Wait();
+    TF_ASSERT_OK(status);
+  }
+  // Lets the flush timers expire.
+  Env::Default()->SleepForMicroseconds(100 * 1000);
+  rmgr.Cleanup(step_id);
+
+  EXPECT_EQ(cache_->dummy_remote_worker()->batch_sizes(),
+            std::vector<int>({4, 4}));
+  // The last tensor of each batch is received on its own from the dummy
+  // worker, which sends nothing.
+  for (int i = 0; i < num_requests; ++i) {
+    if (i % 4 != 3) EXPECT_EQ(V(vals[i]), keys[i]);
+  }
+}
+
+TEST_F(RpcRendezvousMgrTest, RemoteRecvBatchedCancelledForOneRecv) {
+  setenv("TF_RECV_TENSOR_BATCH_SIZE", "2", /*overwrite=*/1);
+  setenv("TF_RECV_TENSOR_BATCH_WAIT_MICROS", "100000", /*overwrite=*/1);
+  RpcRendezvousMgr rmgr(&env);
+  unsetenv("TF_RECV_TENSOR_BATCH_SIZE");
+  unsetenv("TF_RECV_TENSOR_BATCH_WAIT_MICROS");
+
+  const int64_t step_id = 123;
+  // The recvs of the batch have different cancellation managers, only one of
+  // which is cancelled.
+  CancellationManager cancelled_cm;
+  cancelled_cm.StartCancel();
+  CancellationManager cm;
+  std::vector<Status> statuses(2);
+  {
+    RemoteRendezvous* rendez = rmgr.Find(step_id);
+    TF_ASSERT_OK(rendez->Initialize(&worker_session_));
+    core::ScopedUnref unref(rendez);
+    BlockingCounter counter(2);
+    for (int i = 0; i < 2; ++i) {
+      Rendezvous::Args args;
+      args.cancellation_manager = i == 0 ? &cancelled_cm : &cm;
+      rendez->RecvAsync(
+          MakeKey(Rendezvous::CreateKey(
+              "/job:worker/replica:1/task:2/cpu:0", 7890,
+              "/job:mnist/replica:1/task:2/cpu:1", strings::StrCat("foo", i),
+              FrameAndIter(0, 0))),
+          args,
+          [&statuses, &counter, i](const Status& s, const Rendezvous::Args&,
+                                   const Rendezvous::Args&, const Tensor&,
+                                   const bool) {
+            statuses[i] = s;
+            counter.DecrementCount();
+          });
+    }
+    counter.Wait();
+  }
+  // Lets the flush timer expire.
+  Env::Default()->SleepForMicroseconds(200 * 1000);
+  rmgr.Cleanup(step_id);
+
+  // The batch was aborted before its RPC was sent, and the recv that was not
+  // cancelled was received on its own.
+  EXPECT_TRUE(cache_->dummy_remote_worker()->batch_sizes().empty());
+  EXPECT_TRUE(errors::IsCancelled(statuses[0])) << statuses[0];
+  TF_EXPECT_OK(statuses[1]);
+}
+
 }  // namespace tensorflow
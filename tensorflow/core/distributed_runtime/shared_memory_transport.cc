@@ -0,0 +1,234 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+namespace {
+
+constexpr char kSegmentNamePrefix[] = "/tf_collective_";
+constexpr uint64 kSegmentMagic = 0x5446434f4c4c4246ULL;  // "TFCOLLBF"
+
+// The header of a segment, followed by the buffer at kHeaderSize.
+struct RecvBufHeader {
+  uint64 magic;
+  // The nonce of the request.
+  uint64 nonce;
+  // 0, then ~nonce while a sender writes the buffer, then nonce.
+  std::atomic<uint64> written_nonce;
+  uint64 num_bytes;
+};
+
+// Keeps the buffer aligned to a cache line.
+constexpr size_t kHeaderSize = 64;
+static_assert(sizeof(RecvBufHeader) <= kHeaderSize, "");
+
+#if defined(__linux__)
+// Returns an id of the host of this process: segments are only shared by the
+// processes of the same boot of a host.
+string LocalHostId() {
+  string boot_id;
+  if (!ReadFileToString(Env::Default(), "/proc/sys/kernel/random/boot_id",
+                        &boot_id)
+           .ok()) {
+    return "";
+  }
+  str_util::StripTrailingWhitespace(&boot_id);
+  return strings::StrCat(port::Hostname(), "/", boot_id);
+}
+#endif
+
+}  // namespace
+
+SharedMemoryRecvBuf::SharedMemoryRecvBuf(SharedMemoryRecvBufOptions options,
+                                         void* memory, size_t size)
+    : options_(std::move(options)), memory_(memory), size_(size) {}
+
+SharedMemoryRecvBuf::~SharedMemoryRecvBuf() {
+#if defined(__linux__)
+  // A sender that already opened the segment keeps writing to its own
+  // mapping, which no longer is memory of this process.
+  shm_unlink(options_.segment_name().c_str());
+  munmap(memory_, size_);
+#endif
+}
+
+Status SharedMemoryRecvBuf::CopyTo(void* dst, size_t num_bytes) const {
+  const RecvBufHeader* header = static_cast<const RecvBufHeader*>(memory_);
+  if (num_bytes != header->num_bytes) {
+    return errors::Internal("Shared memory buffer size mismatch: ", num_bytes,
+                            " bytes requested, ", header->num_bytes,
+                            " bytes in ", options_.segment_name());
+  }
+  if (header->written_nonce.load(std::memory_order_acquire) !=
+      options_.nonce()) {
+    return errors::Internal("The sender did not write the shared memory "
+                            "buffer ",
+                            options_.segment_name());
+  }
+  std::memcpy(dst, static_cast<const char*>(memory_) + kHeaderSize,
+              num_bytes);
+  return OkStatus();
+}
+
+SharedMemoryTransport::SharedMemoryTransport(string host_id)
+    : host_id_(std::move(host_id)) {}
+
+/* static */
+SharedMemoryTransport* SharedMemoryTransport::Global() {
+  static SharedMemoryTransport* transport = []() -> SharedMemoryTransport* {
+#if defined(__linux__)
+    bool enabled;
+    TF_CHECK_OK(
+        ReadBoolFromEnvVar("TF_SHARED_MEMORY_COLLECTIVES", false, &enabled));
+    if (!enabled) return nullptr;
+    string host_id = LocalHostId();
+    if (host_id.empty()) return nullptr;
+    return new SharedMemoryTransport(std::move(host_id));
+#else
+    return nullptr;
+#endif
+  }();
+  return transport;
+}
+
+StatusOr<std::unique_ptr<SharedMemoryRecvBuf>>
+SharedMemoryTransport::CreateRecvBuf(size_t num_bytes) const {
+#if defined(__linux__)
+  SharedMemoryRecvBufOptions options;
+  options.set_host_id(host_id_);
+  options.set_segment_name(strings::StrCat(kSegmentNamePrefix,
+                                           Env::Default()->GetProcessId(), "_",
+                                           random::New64()));
+  uint64 nonce = 0;
+  while (nonce == 0) nonce = random::New64();
+  options.set_nonce(nonce);
+
+  const string& name = options.segment_name();
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    return errors::IOError(strings::StrCat("Failed to create ", name), errno);
+  }
+  const size_t size = kHeaderSize + num_bytes;
+  void* memory = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  const int error = errno;
+  close(fd);
+  if (memory == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    return errors::IOError(strings::StrCat("Failed to map ", name), error);
+  }
+
+  RecvBufHeader* header = new (memory) RecvBufHeader;
+  header->magic = kSegmentMagic;
+  header->nonce = nonce;
+  header->written_nonce.store(0, std::memory_order_relaxed);
+  header->num_bytes = num_bytes;
+  return absl::WrapUnique(
+      new SharedMemoryRecvBuf(std::move(options), memory, size));
+#else
+  return errors::Unimplemented("No shared memory transport on this platform");
+#endif
+}
+
+Status SharedMemoryTransport::WriteRecvBuf(
+    const SharedMemoryRecvBufOptions& options, const void* src,
+    size_t num_bytes) const {
+#if defined(__linux__)
+  const string& name = options.segment_name();
+  if (options.host_id() != host_id_) {
+    return errors::FailedPrecondition("The receiver is on another host");
+  }
+  // Only the segments of the receivers may be opened.
+  if (!absl::StartsWith(name, kSegmentNamePrefix) ||
+      name.find('/', 1) != string::npos) {
+    return errors::InvalidArgument("Invalid shared memory segment name: ",
+                                   name);
+  }
+  int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    // E.g. the receiver was cancelled and released its segment.
+    return errors::Unavailable(
+        strings::StrCat("Failed to open ", name, ": ", strerror(errno)));
+  }
+  struct stat info;
+  void* memory = MAP_FAILED;
+  const size_t size = kHeaderSize + num_bytes;
+  Status status;
+  if (fstat(fd, &info) != 0) {
+    status = errors::IOError(strings::StrCat("Failed to stat ", name), errno);
+  } else if (info.st_uid != geteuid()) {
+    status = errors::PermissionDenied(name, " is owned by another user");
+  } else if (static_cast<size_t>(info.st_size) != size) {
+    status = errors::InvalidArgument(name, " has ", info.st_size,
+                                     " bytes, expected ", size);
+  } else {
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+      status = errors::IOError(strings::StrCat("Failed to map ", name), errno);
+    }
+  }
+  close(fd);
+  TF_RETURN_IF_ERROR(status);
+
+  RecvBufHeader* header = static_cast<RecvBufHeader*>(memory);
+  uint64 unwritten = 0;
+  if (header->magic != kSegmentMagic || options.nonce() == 0 ||
+      header->nonce != options.nonce() || header->num_bytes != num_bytes) {
+    status =
+        errors::PermissionDenied(name, " was not created for this request");
+  } else if (!header->written_nonce.compare_exchange_strong(
+                 unwritten, ~options.nonce(), std::memory_order_acquire)) {
+    // E.g. a retry of the request.
+    status = errors::FailedPrecondition(name, " was already written");
+  } else {
+    std::memcpy(static_cast<char*>(memory) + kHeaderSize, src, num_bytes);
+    header->written_nonce.store(options.nonce(), std::memory_order_release);
+  }
+  munmap(memory, size);
+  return status;
+#else
+  return errors::Unimplemented("No shared memory transport on this platform");
+#endif
+}
+
+}  // namespace tensorflow
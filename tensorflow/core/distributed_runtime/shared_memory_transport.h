@@ -0,0 +1,101 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_TRANSPORT_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_TRANSPORT_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/transport_options.pb.h"
+
+namespace tensorflow {
+
+// A shared memory segment created by the receiver of a collective buffer for
+// a sender in another process of the same host to write the buffer to. The
+// segment exists for the lifetime of this object: the receiver owns it for
+// the duration of its RecvBufRequest, and a sender writing after it is
+// destroyed writes to no memory of the receiver.
+class SharedMemoryRecvBuf {
+ public:
+  ~SharedMemoryRecvBuf();
+
+  // Describes the segment to the sender, in the RecvBufRequest.
+  const SharedMemoryRecvBufOptions& options() const { return options_; }
+
+  // Copies the `num_bytes` bytes written by the sender to `dst`. Fails if no
+  // sender has marked the segment as written.
+  Status CopyTo(void* dst, size_t num_bytes) const;
+
+ private:
+  friend class SharedMemoryTransport;
+
+  SharedMemoryRecvBuf(SharedMemoryRecvBufOptions options, void* memory,
+                      size_t size);
+
+  const SharedMemoryRecvBufOptions options_;
+  void* const memory_;
+  const size_t size_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedMemoryRecvBuf);
+};
+
+// Moves the collective buffers between processes of the same host through
+// shared memory, instead of through the loopback network stack.
+//
+// A receiver creates a SharedMemoryRecvBuf and describes it in the
+// SharedMemoryRecvBufOptions of its RecvBufRequest. A sender in another
+// process with the same host id writes the tensor content to the segment,
+// and answers with the options instead of the content. The receiver then
+// copies the content out of its segment.
+//
+// The segments are only accessible to the user who created them, and start
+// with a random nonce that is only sent in the request. A sender only writes
+// to a segment of its own user holding the nonce of the request, once, and a
+// receiver only reads a segment in which a sender has marked the nonce as
+// written. No address of the receiver is ever sent.
+class SharedMemoryTransport {
+ public:
+  // `host_id` identifies the host of this process.
+  explicit SharedMemoryTransport(string host_id);
+
+  // Returns the transport of this process, or null if the platform has none
+  // or TF_SHARED_MEMORY_COLLECTIVES is false (default false).
+  static SharedMemoryTransport* Global();
+
+  // Creates a segment for a buffer of `num_bytes` bytes.
+  StatusOr<std::unique_ptr<SharedMemoryRecvBuf>> CreateRecvBuf(
+      size_t num_bytes) const;
+
+  // Writes the `num_bytes` at `src` to the segment described by `options`,
+  // which must have been created by a receiver in another process of this
+  // host for a buffer of `num_bytes` bytes, and not been written yet.
+  Status WriteRecvBuf(const SharedMemoryRecvBufOptions& options,
+                      const void* src, size_t num_bytes) const;
+
+ private:
+  const string host_id_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedMemoryTransport);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_TRANSPORT_H_
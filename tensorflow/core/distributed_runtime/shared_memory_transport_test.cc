@@ -0,0 +1,115 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(SharedMemoryTransportTest, DisabledByDefault) {
+  EXPECT_EQ(SharedMemoryTransport::Global(), nullptr);
+}
+
+#if defined(__linux__)
+std::vector<char> Content(size_t num_bytes) {
+  std::vector<char> content(num_bytes);
+  for (size_t i = 0; i < content.size(); ++i) content[i] = i % 251;
+  return content;
+}
+
+TEST(SharedMemoryTransportTest, WritesToSegmentOfReceiver) {
+  SharedMemoryTransport transport("host");
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemoryRecvBuf> recv_buf,
+                          transport.CreateRecvBuf(1 << 20));
+  EXPECT_EQ(recv_buf->options().host_id(), "host");
+  EXPECT_NE(recv_buf->options().nonce(), 0);
+
+  const std::vector<char> src = Content(1 << 20);
+  std::vector<char> dst(src.size(), 0);
+  EXPECT_TRUE(errors::IsInternal(recv_buf->CopyTo(dst.data(), dst.size())));
+  TF_ASSERT_OK(
+      transport.WriteRecvBuf(recv_buf->options(), src.data(), src.size()));
+  TF_ASSERT_OK(recv_buf->CopyTo(dst.data(), dst.size()));
+  EXPECT_EQ(std::memcmp(src.data(), dst.data(), src.size()), 0);
+}
+
+TEST(SharedMemoryTransportTest, WritesSegmentOnce) {
+  SharedMemoryTransport transport("host");
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemoryRecvBuf> recv_buf,
+                          transport.CreateRecvBuf(16));
+  const std::vector<char> src = Content(16);
+  TF_ASSERT_OK(
+      transport.WriteRecvBuf(recv_buf->options(), src.data(), src.size()));
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      transport.WriteRecvBuf(recv_buf->options(), src.data(), src.size())));
+}
+
+TEST(SharedMemoryTransportTest, RejectsSegmentsNotCreatedForTheRequest) {
+  SharedMemoryTransport transport("host");
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemoryRecvBuf> recv_buf,
+                          transport.CreateRecvBuf(16));
+  const std::vector<char> src = Content(32);
+
+  SharedMemoryRecvBufOptions options = recv_buf->options();
+  options.set_nonce(options.nonce() + 1);
+  EXPECT_TRUE(errors::IsPermissionDenied(
+      transport.WriteRecvBuf(options, src.data(), 16)));
+
+  // The size must match the segment.
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      transport.WriteRecvBuf(recv_buf->options(), src.data(), 32)));
+
+  options = recv_buf->options();
+  options.set_host_id("other_host");
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      transport.WriteRecvBuf(options, src.data(), 16)));
+
+  // Only the segments of receivers may be opened.
+  options = recv_buf->options();
+  options.set_segment_name("/other_segment");
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      transport.WriteRecvBuf(options, src.data(), 16)));
+  options.set_segment_name("/tf_collective_/../other_segment");
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      transport.WriteRecvBuf(options, src.data(), 16)));
+
+  // The segment was left unwritten.
+  std::vector<char> dst(16);
+  EXPECT_TRUE(errors::IsInternal(recv_buf->CopyTo(dst.data(), dst.size())));
+}
+
+TEST(SharedMemoryTransportTest, DoesNotWriteReleasedSegments) {
+  SharedMemoryTransport transport("host");
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<SharedMemoryRecvBuf> recv_buf,
+                          transport.CreateRecvBuf(16));
+  const SharedMemoryRecvBufOptions options = recv_buf->options();
+  // E.g. the receiver was cancelled.
+  recv_buf.reset();
+  const std::vector<char> src = Content(16);
+  EXPECT_TRUE(
+      errors::IsUnavailable(transport.WriteRecvBuf(options, src.data(), 16)));
+}
+#endif  // defined(__linux__)
+
+}  // namespace
+}  // namespace tensorflow
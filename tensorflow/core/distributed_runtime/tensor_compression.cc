@@ -0,0 +1,276 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "re2/re2.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/bfloat16.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+namespace {
+
+// The wire content is compressed in chunks of this many bytes, one task
+// each.
+constexpr int64_t kChunkBytes = 1 << 20;
+
+// Casting costs about this many cycles per element.
+constexpr int64_t kCastCostPerElement = 2;
+
+// Compressing or uncompressing costs about this many cycles per byte.
+constexpr int64_t kSnappyCostPerByte = 4;
+
+struct EnvCompression {
+  TensorCompression compression;
+  std::unique_ptr<RE2> lossy_pattern;
+};
+
+const EnvCompression& GetEnvCompression() {
+  static const EnvCompression* env_compression = [] {
+    auto* env = new EnvCompression;
+    int64_t min_bytes;
+    bool lossless;
+    string lossy, lossy_pattern;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_RECV_TENSOR_COMPRESSION_MIN_BYTES",
+                                    /*default_val=*/0, &min_bytes));
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_RECV_TENSOR_LOSSLESS_COMPRESSION",
+                                   /*default_val=*/true, &lossless));
+    TF_CHECK_OK(ReadStringFromEnvVar("TF_RECV_TENSOR_LOSSY_COMPRESSION",
+                                     /*default_val=*/"", &lossy));
+    TF_CHECK_OK(
+        ReadStringFromEnvVar("TF_RECV_TENSOR_LOSSY_COMPRESSION_PATTERN",
+                             /*default_val=*/"", &lossy_pattern));
+    env->compression.set_min_bytes(std::max<int64_t>(0, min_bytes));
+    env->compression.set_lossless(lossless);
+    if (lossy == "bfloat16") {
+      env->compression.set_lossy_dtype(DT_BFLOAT16);
+    } else if (lossy == "float16") {
+      env->compression.set_lossy_dtype(DT_HALF);
+    } else if (!lossy.empty()) {
+      LOG(ERROR) << "Ignoring TF_RECV_TENSOR_LOSSY_COMPRESSION=" << lossy
+                 << ", which must be bfloat16 or float16";
+    }
+    if (env->compression.lossy_dtype() != DT_INVALID &&
+        !lossy_pattern.empty()) {
+      env->lossy_pattern = std::make_unique<RE2>(lossy_pattern);
+      if (!env->lossy_pattern->ok()) {
+        LOG(ERROR) << "Ignoring TF_RECV_TENSOR_LOSSY_COMPRESSION_PATTERN="
+                   << lossy_pattern << ": " << env->lossy_pattern->error();
+        env->lossy_pattern.reset();
+      }
+    }
+    return env;
+  }();
+  return *env_compression;
+}
+
+bool IsLossyDtype(DataType dtype) {
+  return dtype == DT_BFLOAT16 || dtype == DT_HALF;
+}
+
+// Runs fn(start, limit) over [0, total), in parallel if `pool` is not null.
+void ParallelFor(thread::ThreadPool* pool, int64_t total,
+                 int64_t cost_per_unit,
+                 const std::function<void(int64_t, int64_t)>& fn) {
+  if (pool == nullptr) {
+    fn(0, total);
+  } else {
+    pool->ParallelFor(total, cost_per_unit, fn);
+  }
+}
+
+// Casts the floats of `src` to `dtype` into `dst`, or back with `to_float`.
+void CastFloats(bool to_float, DataType dtype, int64_t num_elements,
+                thread::ThreadPool* pool, const void* src, void* dst) {
+  ParallelFor(
+      pool, num_elements, kCastCostPerElement,
+      [&](int64_t start, int64_t limit) {
+        const int64_t n = limit - start;
+        if (dtype == DT_BFLOAT16 && to_float) {
+          BFloat16ToFloat(static_cast<const bfloat16*>(src) + start,
+                          static_cast<float*>(dst) + start, n);
+        } else if (dtype == DT_BFLOAT16) {
+          RoundFloatToBFloat16(static_cast<const float*>(src) + start,
+                               static_cast<bfloat16*>(dst) + start, n);
+        } else if (to_float) {
+          const Eigen::half* in = static_cast<const Eigen::half*>(src);
+          float* out = static_cast<float*>(dst);
+          for (int64_t i = start; i < limit; ++i) {
+            out[i] = static_cast<float>(in[i]);
+          }
+        } else {
+          const float* in = static_cast<const float*>(src);
+          Eigen::half* out = static_cast<Eigen::half*>(dst);
+          for (int64_t i = start; i < limit; ++i) {
+            out[i] = static_cast<Eigen::half>(in[i]);
+          }
+        }
+      });
+}
+
+}  // namespace
+
+bool RecvTensorCompressionFromEnv(StringPiece tensor_name,
+                                  TensorCompression* compression) {
+  const EnvCompression& env = GetEnvCompression();
+  if (env.compression.min_bytes() == 0) return false;
+  *compression = env.compression;
+  if (env.lossy_pattern == nullptr || tensor_name.empty() ||
+      !RE2::FullMatch(re2::StringPiece(tensor_name.data(), tensor_name.size()),
+                      *env.lossy_pattern)) {
+    compression->clear_lossy_dtype();
+  }
+  return compression->lossless() ||
+         compression->lossy_dtype() != DT_INVALID;
+}
+
+bool CompressTensorContent(const Tensor& tensor,
+                           const TensorCompression& compression,
+                           thread::ThreadPool* pool,
+                           CompressedTensorContent* content) {
+  const int64_t num_bytes = tensor.TotalBytes();
+  if (compression.min_bytes() <= 0 || num_bytes < compression.min_bytes() ||
+      !DataTypeCanUseMemcpy(tensor.dtype())) {
+    return false;
+  }
+  const bool cast =
+      tensor.dtype() == DT_FLOAT && IsLossyDtype(compression.lossy_dtype());
+  if (!cast && !compression.lossless()) return false;
+
+  StringPiece wire(static_cast<const char*>(DMAHelper::base(&tensor)),
+                   num_bytes);
+  string cast_buffer;
+  if (cast) {
+    cast_buffer.resize(tensor.NumElements() *
+                       DataTypeSize(compression.lossy_dtype()));
+    CastFloats(/*to_float=*/false, compression.lossy_dtype(),
+               tensor.NumElements(), pool, wire.data(), &cast_buffer[0]);
+    wire = cast_buffer;
+  }
+
+  content->Clear();
+  const int64_t num_chunks = (wire.size() + kChunkBytes - 1) / kChunkBytes;
+  for (int64_t i = 0; i < num_chunks; ++i) content->add_chunks();
+  auto chunk = [&wire](int64_t i) {
+    return wire.substr(i * kChunkBytes, kChunkBytes);
+  };
+  bool snappy = compression.lossless();
+  if (snappy) {
+    std::atomic<bool> compressed{true};
+    ParallelFor(pool, num_chunks, kSnappyCostPerByte * kChunkBytes,
+                [&](int64_t start, int64_t limit) {
+                  for (int64_t i = start; i < limit; ++i) {
+                    const StringPiece in = chunk(i);
+                    if (!port::Snappy_Compress(in.data(), in.size(),
+                                               content->mutable_chunks(i))) {
+                      compressed = false;
+                    }
+                  }
+                });
+    int64_t compressed_bytes = 0;
+    for (const string& c : content->chunks()) compressed_bytes += c.size();
+    // Without snappy in the build, or for incompressible content, only the
+    // cast remains.
+    snappy = compressed && compressed_bytes < static_cast<int64_t>(wire.size());
+    if (!snappy && !cast) return false;
+  }
+  if (!snappy) {
+    for (int64_t i = 0; i < num_chunks; ++i) {
+      const StringPiece in = chunk(i);
+      content->mutable_chunks(i)->assign(in.data(), in.size());
+    }
+  }
+  content->set_snappy(snappy);
+  if (cast) content->set_wire_dtype(compression.lossy_dtype());
+  return true;
+}
+
+Status DecompressTensorContent(const CompressedTensorContent& content,
+                               thread::ThreadPool* pool, Tensor* tensor) {
+  const bool cast = content.wire_dtype() != DT_INVALID;
+  if (cast && (tensor->dtype() != DT_FLOAT ||
+               !IsLossyDtype(content.wire_dtype()))) {
+    return errors::InvalidArgument("Cannot decompress ",
+                                   DataTypeString(content.wire_dtype()),
+                                   " content into a ",
+                                   DataTypeString(tensor->dtype()), " tensor");
+  }
+  const int64_t wire_bytes =
+      cast ? tensor->NumElements() * DataTypeSize(content.wire_dtype())
+           : tensor->TotalBytes();
+
+  // The offsets of the uncompressed chunks.
+  const int num_chunks = content.chunks_size();
+  std::vector<int64_t> offsets(num_chunks + 1, 0);
+  for (int i = 0; i < num_chunks; ++i) {
+    const string& chunk = content.chunks(i);
+    size_t chunk_bytes = chunk.size();
+    if (content.snappy() &&
+        !port::Snappy_GetUncompressedLength(chunk.data(), chunk.size(),
+                                            &chunk_bytes)) {
+      return errors::DataLoss("Corrupt compressed tensor chunk");
+    }
+    offsets[i + 1] = offsets[i] + chunk_bytes;
+  }
+  if (offsets[num_chunks] != wire_bytes) {
+    return errors::Internal("Compressed tensor has ", offsets[num_chunks],
+                            " bytes, expected ", wire_bytes);
+  }
+
+  string cast_buffer;
+  char* wire = static_cast<char*>(DMAHelper::base(tensor));
+  if (cast) {
+    cast_buffer.resize(wire_bytes);
+    wire = &cast_buffer[0];
+  }
+  std::atomic<bool> uncompressed{true};
+  ParallelFor(pool, num_chunks, kSnappyCostPerByte * kChunkBytes,
+              [&](int64_t start, int64_t limit) {
+                for (int64_t i = start; i < limit; ++i) {
+                  const string& chunk = content.chunks(i);
+                  if (!content.snappy()) {
+                    std::memcpy(wire + offsets[i], chunk.data(), chunk.size());
+                  } else if (!port::Snappy_Uncompress(
+                                 chunk.data(), chunk.size(),
+                                 wire + offsets[i])) {
+                    uncompressed = false;
+                  }
+                }
+              });
+  if (!uncompressed) {
+    return errors::DataLoss("Corrupt compressed tensor chunk");
+  }
+  if (cast) {
+    CastFloats(/*to_float=*/true, content.wire_dtype(), tensor->NumElements(),
+               pool, wire, DMAHelper::base(tensor));
+  }
+  return OkStatus();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,66 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_COMPRESSION_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_COMPRESSION_H_
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/protobuf/transport_options.pb.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+
+namespace tensorflow {
+
+// Compression of the tensors sent by RecvTensor and RecvBuf, which trades CPU
+// for bandwidth on slow links. The content is optionally cast from float to a
+// 16-bit type, then split into chunks compressed with snappy in parallel.
+
+// Returns true and sets `*compression` to the compression the receiver asks
+// for the tensor `tensor_name`, as configured by the environment:
+//
+//   TF_RECV_TENSOR_COMPRESSION_MIN_BYTES: tensors of at least these many
+//     bytes are compressed. Zero, the default, disables compression.
+//   TF_RECV_TENSOR_LOSSLESS_COMPRESSION: whether the content is compressed
+//     with snappy. Defaults to true.
+//   TF_RECV_TENSOR_LOSSY_COMPRESSION: "bfloat16" or "float16" to also cast
+//     float tensors to that type. Empty by default.
+//   TF_RECV_TENSOR_LOSSY_COMPRESSION_PATTERN: a regular expression which the
+//     names of the tensors that are cast must fully match, e.g.
+//     ".*gradients.*". Tensors opt in to the lossy compression this way
+//     only.
+//
+// `tensor_name` is empty for tensors that can't opt in.
+bool RecvTensorCompressionFromEnv(StringPiece tensor_name,
+                                  TensorCompression* compression);
+
+// Compresses the content of `tensor` as `compression` asks into `*content`,
+// using `pool` for large tensors if not null. Returns false if the tensor is
+// to be sent uncompressed, e.g. because it is too small, not memcpy-able or
+// does not compress.
+bool CompressTensorContent(const Tensor& tensor,
+                           const TensorCompression& compression,
+                           thread::ThreadPool* pool,
+                           CompressedTensorContent* content);
+
+// Decompresses `content` into the buffer of `tensor`, which has the type and
+// shape of the compressed tensor, using `pool` if not null.
+Status DecompressTensorContent(const CompressedTensorContent& content,
+                               thread::ThreadPool* pool, Tensor* tensor);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_COMPRESSION_H_
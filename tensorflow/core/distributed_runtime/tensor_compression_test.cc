@@ -0,0 +1,137 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns a float tensor of `num_elements` elements in a few distinct
+// values, so that it compresses well.
+Tensor CompressibleTensor(int num_elements) {
+  Tensor tensor(DT_FLOAT, TensorShape({num_elements}));
+  for (int i = 0; i < num_elements; ++i) {
+    tensor.flat<float>()(i) = (i % 7) * 0.25f;
+  }
+  return tensor;
+}
+
+bool SnappyAvailable() {
+  string compressed;
+  return port::Snappy_Compress("x", 1, &compressed);
+}
+
+class TensorCompressionTest : public ::testing::Test {
+ protected:
+  TensorCompressionTest() : pool_(Env::Default(), "test", 4) {}
+
+  thread::ThreadPool pool_;
+};
+
+TEST_F(TensorCompressionTest, LosslessRoundTrip) {
+  if (!SnappyAvailable()) GTEST_SKIP() << "Snappy is not available";
+  // More than one chunk.
+  Tensor src = CompressibleTensor(600000);
+  TensorCompression compression;
+  compression.set_min_bytes(1024);
+  compression.set_lossless(true);
+  CompressedTensorContent content;
+  ASSERT_TRUE(CompressTensorContent(src, compression, &pool_, &content));
+  EXPECT_TRUE(content.snappy());
+  EXPECT_EQ(content.wire_dtype(), DT_INVALID);
+  EXPECT_EQ(content.chunks_size(), 3);
+
+  Tensor dst(DT_FLOAT, src.shape());
+  TF_ASSERT_OK(DecompressTensorContent(content, &pool_, &dst));
+  test::ExpectTensorEqual<float>(dst, src);
+}
+
+TEST_F(TensorCompressionTest, LossyRoundTrip) {
+  Tensor src = CompressibleTensor(1000);
+  for (DataType lossy_dtype : {DT_BFLOAT16, DT_HALF}) {
+    TensorCompression compression;
+    compression.set_min_bytes(1024);
+    compression.set_lossy_dtype(lossy_dtype);
+    CompressedTensorContent content;
+    ASSERT_TRUE(CompressTensorContent(src, compression, /*pool=*/nullptr,
+                                      &content));
+    EXPECT_FALSE(content.snappy());
+    EXPECT_EQ(content.wire_dtype(), lossy_dtype);
+    ASSERT_EQ(content.chunks_size(), 1);
+    EXPECT_EQ(content.chunks(0).size(), 2000);
+
+    // The values are exact in either 16-bit type.
+    Tensor dst(DT_FLOAT, src.shape());
+    TF_ASSERT_OK(DecompressTensorContent(content, &pool_, &dst));
+    test::ExpectTensorEqual<float>(dst, src);
+  }
+}
+
+TEST_F(TensorCompressionTest, CastsFloatTensorsOnly) {
+  Tensor src(DT_INT32, TensorShape({1000}));
+  src.flat<int32>().setZero();
+  TensorCompression compression;
+  compression.set_min_bytes(1024);
+  compression.set_lossy_dtype(DT_BFLOAT16);
+  CompressedTensorContent content;
+  EXPECT_FALSE(CompressTensorContent(src, compression, &pool_, &content));
+}
+
+TEST_F(TensorCompressionTest, SendsSmallTensorsUncompressed) {
+  TensorCompression compression;
+  compression.set_min_bytes(1024);
+  compression.set_lossless(true);
+  compression.set_lossy_dtype(DT_BFLOAT16);
+  CompressedTensorContent content;
+  EXPECT_FALSE(CompressTensorContent(CompressibleTensor(100), compression,
+                                     &pool_, &content));
+  // Disabled.
+  compression.set_min_bytes(0);
+  EXPECT_FALSE(CompressTensorContent(CompressibleTensor(1000), compression,
+                                     &pool_, &content));
+}
+
+TEST_F(TensorCompressionTest, RejectsMismatchedTensors) {
+  Tensor src = CompressibleTensor(1000);
+  TensorCompression compression;
+  compression.set_min_bytes(1024);
+  compression.set_lossy_dtype(DT_HALF);
+  CompressedTensorContent content;
+  ASSERT_TRUE(CompressTensorContent(src, compression, &pool_, &content));
+
+  Tensor smaller(DT_FLOAT, TensorShape({500}));
+  EXPECT_TRUE(errors::IsInternal(
+      DecompressTensorContent(content, &pool_, &smaller)));
+  Tensor halves(DT_HALF, src.shape());
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      DecompressTensorContent(content, &pool_, &halves)));
+}
+
+TEST(RecvTensorCompressionFromEnvTest, DisabledByDefault) {
+  TensorCompression compression;
+  EXPECT_FALSE(RecvTensorCompressionFromEnv("gradients/x", &compression));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -15,7 +15,13 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/worker.h"
 
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
 #include "tensorflow/core/common_runtime/collective_executor_mgr.h"
+#include "tensorflow/core/common_runtime/copy_tensor.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
@@ -499,4 +505,197 @@ void Worker::RecvTensorAsync(CallOptions* opts,
   done(errors::Unimplemented("Worker::RecvTensorAsync()"));
 }
 
+namespace {
+
+// The state of a RecvTensors call, shared by the recvs of its tensors.
+class RecvTensorsState
+    : public std::enable_shared_from_this<RecvTensorsState> {
+ public:
+  // Holds a reference to the rendezvous of each step in `step_ids`.
+  RecvTensorsState(WorkerEnv* env, const std::set<int64_t>& step_ids,
+                   CallOptions* opts, const RecvTensorsRequest* request,
+                   RecvTensorsResponse* response, StatusCallback done)
+      : env_(env),
+        wait_micros_(request->wait_micros()),
+        opts_(opts),
+        response_(response),
+        done_(std::move(done)),
+        received_(request->requests_size(), false) {
+    for (int i = 0; i < request->requests_size(); ++i) {
+      response_->add_responses();
+    }
+    for (int64_t step_id : step_ids) {
+      rendezvous_[step_id] = env_->rendezvous_mgr->Find(step_id);
+    }
+  }
+
+  ~RecvTensorsState() {
+    for (const auto& step_rendezvous : rendezvous_) {
+      step_rendezvous.second->Unref();
+    }
+  }
+
+  // Called with the tensor `val` of request `index`, or its copy on the host
+  // `host_val`. If the response has already been sent, the tensor is sent
+  // again to the rendezvous of its step, for a later RecvTensor to get it.
+  // Once the step is cleaned up, its aborted rendezvous drops the tensor.
+  void Received(int index, int64_t step_id,
+                const Rendezvous::ParsedKey& parsed,
+                const Rendezvous::Args& send_args, const Tensor& val,
+                const Tensor& host_val, bool is_dead, const Status& status)
+      TF_LOCKS_EXCLUDED(mu_) {
+    std::function<void()> respond;
+    bool put_back = false;
+    {
+      mutex_lock l(mu_);
+      if (responded_) {
+        put_back = status.ok();
+      } else if (!status.ok()) {
+        respond = RespondLocked(status);
+      } else {
+        RecvTensorResponse* response = response_->mutable_responses(index);
+        response->set_is_dead(is_dead);
+        response->set_send_start_micros(Env::Default()->NowMicros());
+        if (!is_dead) {
+          host_val.AsProtoTensorContent(response->mutable_tensor());
+        }
+        received_[index] = true;
+        ++num_received_;
+        if (num_received_ == static_cast<int>(received_.size()) ||
+            wait_micros_ <= 0) {
+          respond = RespondLocked(OkStatus());
+        } else if (num_received_ == 1) {
+          // Waits a little for the other tensors, which are likely to be
+          // produced at about the same time.
+          env_->env->SchedClosureAfter(wait_micros_,
+                                       [self = shared_from_this()]() {
+                                         self->RespondIfPending();
+                                       });
+        }
+      }
+    }
+    if (put_back) {
+      // Not found again in the rendezvous manager, which would create a new
+      // rendezvous for a step already cleaned up.
+      Status s = rendezvous_.at(step_id)->Send(parsed, send_args, val, is_dead);
+      if (!s.ok()) {
+        VLOG(1) << "Failed to return " << parsed.FullKey()
+                << " to its rendezvous: " << s;
+      }
+    }
+    if (respond) respond();
+  }
+
+ private:
+  void RespondIfPending() TF_LOCKS_EXCLUDED(mu_) {
+    std::function<void()> respond;
+    {
+      mutex_lock l(mu_);
+      if (!responded_) respond = RespondLocked(OkStatus());
+    }
+    if (respond) respond();
+  }
+
+  // Completes the response, returning the closure that sends it.
+  std::function<void()> RespondLocked(const Status& status)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    responded_ = true;
+    for (int i = 0; i < received_.size(); ++i) {
+      if (!received_[i]) response_->add_pending(i);
+    }
+    response_ = nullptr;
+    return [opts = opts_, done = std::move(done_), status]() {
+      opts->ClearCancelCallback();
+      done(status);
+    };
+  }
+
+  WorkerEnv* const env_;  // Not owned.
+  const int64_t wait_micros_;
+  // The rendezvous of each step of the request.
+  std::map<int64_t, RemoteRendezvous*> rendezvous_;
+  mutex mu_;
+  CallOptions* opts_ TF_GUARDED_BY(mu_);
+  RecvTensorsResponse* response_ TF_GUARDED_BY(mu_);
+  StatusCallback done_ TF_GUARDED_BY(mu_);
+  std::vector<bool> received_ TF_GUARDED_BY(mu_);
+  int num_received_ TF_GUARDED_BY(mu_) = 0;
+  bool responded_ TF_GUARDED_BY(mu_) = false;
+};
+
+}  // namespace
+
+void Worker::RecvTensorsAsync(CallOptions* opts,
+                              const RecvTensorsRequest* request,
+                              RecvTensorsResponse* response,
+                              StatusCallback done) {
+  const int num_tensors = request->requests_size();
+  std::vector<Rendezvous::ParsedKey> parsed(num_tensors);
+  std::vector<Device*> src_devs(num_tensors, nullptr);
+  std::vector<int64_t> step_id_of(num_tensors);
+  std::set<int64_t> step_ids;
+  for (int i = 0; i < num_tensors; ++i) {
+    const RecvTensorRequest& r = request->requests(i);
+    Status s = Rendezvous::ParseKey(r.rendezvous_key(), &parsed[i]);
+    if (s.ok()) {
+      s = PrepareRecvTensor(parsed[i], &src_devs[i]);
+    }
+    if (!s.ok()) {
+      done(s);
+      return;
+    }
+    step_id_of[i] = r.step_id();
+    step_ids.insert(r.step_id());
+  }
+  if (num_tensors == 0) {
+    done(OkStatus());
+    return;
+  }
+
+  auto state = std::make_shared<RecvTensorsState>(
+      env_, step_ids, opts, request, response, std::move(done));
+  // As for RecvTensor, a cancellation while waiting aborts the steps.
+  opts->SetCancelCallback([this, step_ids]() {
+    for (int64_t step_id : step_ids) {
+      LOG(WARNING) << "RecvTensors cancelled for " << step_id;
+      AbortStep(step_id);
+    }
+  });
+  // The request and the response may be deleted as soon as the last recv
+  // is done.
+  for (int i = 0; i < num_tensors; ++i) {
+    const int64_t step_id = step_id_of[i];
+    Device* src_dev = src_devs[i];
+    env_->rendezvous_mgr->RecvLocalAsync(
+        step_id, parsed[i],
+        [state, i, step_id, parsed = parsed[i], src_dev](
+            const Status& status, const Rendezvous::Args& send_args,
+            const Rendezvous::Args& recv_args, const Tensor& val,
+            const bool is_dead) {
+          if (status.ok() && !is_dead &&
+              src_dev->tensorflow_accelerator_device_info() &&
+              !send_args.alloc_attrs.on_host()) {
+            // Copies the tensor to the host to send it as a proto.
+            AllocatorAttributes alloc_attrs;
+            alloc_attrs.set_gpu_compatible(true);
+            alloc_attrs.set_on_host(true);
+            Allocator* alloc = src_dev->GetAllocator(alloc_attrs);
+            Tensor* copy = new Tensor(alloc, val.dtype(), val.shape());
+            CopyDeviceToHost(
+                &val, alloc, alloc, parsed.FullKey(), src_dev, copy,
+                send_args.device_context,
+                [state, i, step_id, parsed, send_args, val,
+                 copy](const Status& s) {
+                  state->Received(i, step_id, parsed, send_args, val, *copy,
+                                  false, s);
+                  delete copy;
+                });
+            return;
+          }
+          state->Received(i, step_id, parsed, send_args, val, val, is_dead,
+                          status);
+        });
+  }
+}
+
 }  // namespace tensorflow
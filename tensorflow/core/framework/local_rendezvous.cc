@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/refcount.h"
@@ -30,6 +31,20 @@ limitations under the License.
 
 namespace tensorflow {
 
+namespace {
+
+// The states of a Slot that don't hold an item.
+constexpr uintptr_t kEmptySlot = 0;
+constexpr uintptr_t kTableSlot = 1;
+// Tags the Recv items held by a Slot.
+constexpr uintptr_t kRecvItemBit = 2;
+
+Status RecvCancelledStatus() {
+  return StatusGroup::MakeDerived(errors::Cancelled("RecvAsync is cancelled."));
+}
+
+}  // namespace
+
 // Represents a blocked Send() or Recv() call in the rendezvous.
 struct LocalRendezvous::Item {
   enum Type { kSend = 0, kRecv = 1 };
@@ -85,6 +100,22 @@ struct LocalRendezvous::Item {
   }
 };
 
+// A key with at most one pending Send() or Recv(), matched without locks.
+// `state` is kEmptySlot, the pending item, tagged with kRecvItemBit if it is a
+// Recv item, or kTableSlot once the key uses the table. The type of a pending
+// item is read from its tag, since another thread may match and delete it as
+// soon as it is in the slot.
+struct LocalRendezvous::Slot {
+  // Returns the item held in `state`.
+  static Item* ItemOf(uintptr_t state) {
+    return reinterpret_cast<Item*>(state & ~kRecvItemBit);
+  }
+
+  // The hash of the key owning the slot, or 0 if the slot is free.
+  std::atomic<uint64> key_hash{0};
+  std::atomic<uintptr_t> state{kEmptySlot};
+};
+
 void LocalRendezvous::ItemQueue::push_back(Item* item) {
   if (TF_PREDICT_TRUE(head == nullptr)) {
     // The queue is empty.
@@ -97,9 +128,19 @@ void LocalRendezvous::ItemQueue::push_back(Item* item) {
   }
 }
 
+LocalRendezvous::LocalRendezvous(Rendezvous* owner, int num_shards)
+    : rc_owner_(owner),
+      table_buckets_(num_shards > 0 ? num_shards : 1) {}
+
 LocalRendezvous::~LocalRendezvous() {
   // Before destroying this rendezvous instance, make sure all the done-callback
   // calls have finished and the tensors have been released from the queue.
+  {
+    mutex_lock l(slot_callbacks_mu_);
+    while (pending_slot_callbacks_.load(std::memory_order_acquire) != 0) {
+      slot_callbacks_cond_var_.wait(l);
+    }
+  }
   bool table_not_empty = false;
   for (int i = 0; i < table_buckets_.size(); ++i) {
     auto& bucket = table_buckets_[i];
@@ -114,19 +155,125 @@ LocalRendezvous::~LocalRendezvous() {
       table_not_empty = true;
     }
   }
+  Slot* slots = slots_.load(std::memory_order_acquire);
+  for (int i = 0; slots != nullptr && i < kNumSlots; ++i) {
+    if (slots[i].state.load(std::memory_order_acquire) > kTableSlot) {
+      table_not_empty = true;
+    }
+  }
   if (table_not_empty) {
     StartAbort(errors::Cancelled("LocalRendezvous deleted"));
   }
+  delete[] slots;
 }
 
-namespace {
-uint64 KeyHash(const StringPiece& k) { return Hash64(k.data(), k.size()); }
-}  // namespace
+LocalRendezvous::Slot* LocalRendezvous::FindSlot(uint64 key_hash) {
+  if (TF_PREDICT_FALSE(key_hash == 0)) {
+    // 0 marks the free slots.
+    return nullptr;
+  }
+  Slot* slots = slots_.load(std::memory_order_acquire);
+  if (TF_PREDICT_FALSE(slots == nullptr)) {
+    Slot* new_slots = new Slot[kNumSlots];
+    if (slots_.compare_exchange_strong(slots, new_slots,
+                                       std::memory_order_acq_rel)) {
+      slots = new_slots;
+    } else {
+      // Another thread allocated them first.
+      delete[] new_slots;
+    }
+  }
+  Slot* slot = &slots[key_hash % kNumSlots];
+  uint64 owner = slot->key_hash.load(std::memory_order_acquire);
+  if (owner == 0 && slot->key_hash.compare_exchange_strong(
+                        owner, key_hash, std::memory_order_acq_rel)) {
+    return slot;
+  }
+  return owner == key_hash ? slot : nullptr;
+}
+
+void LocalRendezvous::MoveSlotToTable(Slot* slot, uint64 key_hash,
+                                      TableBucket* bucket) {
+  const uintptr_t state =
+      slot->state.exchange(kTableSlot, std::memory_order_acq_rel);
+  if (state == kEmptySlot || state == kTableSlot) {
+    return;
+  }
+  // The key did not use the table until now, so its queue is empty.
+  ItemQueue* queue = &bucket->table[key_hash];
+  DCHECK(queue->head == nullptr);
+  queue->push_back(Slot::ItemOf(state));
+}
+
+template <typename Fn>
+void LocalRendezvous::RunSlotCallback(Fn fn) {
+  pending_slot_callbacks_.fetch_add(1, std::memory_order_relaxed);
+  // As for the callbacks of the table, make sure the ref-count of the
+  // rendezvous won't reach 0 while the callback is running.
+  core::RefCountPtr<const Rendezvous> rc_owner_ref;
+  if (rc_owner_) {
+    rc_owner_ref.reset(rc_owner_);
+    rc_owner_->Ref();
+  }
+  fn();
+  int pending = pending_slot_callbacks_.load(std::memory_order_relaxed);
+  while (pending > 1) {
+    if (pending_slot_callbacks_.compare_exchange_weak(
+            pending, pending - 1, std::memory_order_release,
+            std::memory_order_relaxed)) {
+      return;
+    }
+  }
+  // This may be the last callback, which the destructor may be waiting for.
+  mutex_lock l(slot_callbacks_mu_);
+  if (pending_slot_callbacks_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    slot_callbacks_cond_var_.notify_all();
+  }
+}
+
+bool LocalRendezvous::SendToSlot(Slot* slot, uint64 key_hash,
+                                 const Rendezvous::Args& send_args,
+                                 const Tensor& val, bool is_dead) {
+  std::unique_ptr<Item> send_item;
+  uintptr_t state = slot->state.load(std::memory_order_acquire);
+  while (true) {
+    if (state == kEmptySlot) {
+      if (send_item == nullptr) {
+        send_item.reset(new Item(send_args, val, is_dead));
+      }
+      if (slot->state.compare_exchange_weak(
+              state, reinterpret_cast<uintptr_t>(send_item.get()),
+              std::memory_order_acq_rel)) {
+        send_item.release();
+        return true;
+      }
+    } else if (state == kTableSlot) {
+      return false;
+    } else if (state & kRecvItemBit) {
+      if (slot->state.compare_exchange_weak(state, kEmptySlot,
+                                            std::memory_order_acq_rel)) {
+        Item* item = Slot::ItemOf(state);
+        RunSlotCallback([&] {
+          (*item->recv_state.waiter)(OkStatus(), send_args, item->args, val,
+                                     is_dead);
+          delete item;
+        });
+        return true;
+      }
+    } else {
+      // Another message is pending, so queue this one behind it in the table.
+      auto& bucket = table_buckets_[key_hash % table_buckets_.size()];
+      mutex_lock l(bucket.mu);
+      MoveSlotToTable(slot, key_hash, &bucket);
+      return false;
+    }
+  }
+}
 
 Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
                              const Rendezvous::Args& send_args,
                              const Tensor& val, const bool is_dead) {
-  uint64 key_hash = KeyHash(key.FullKey());
+  uint64 key_hash = key.KeyHash();
   DVLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
 
   if (is_dead) {
@@ -141,6 +288,11 @@ Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
 
   TF_RETURN_IF_ERROR(status());
 
+  Slot* slot = FindSlot(key_hash);
+  if (slot != nullptr && SendToSlot(slot, key_hash, send_args, val, is_dead)) {
+    return OkStatus();
+  }
+
   int bucket_index = key_hash % table_buckets_.size();
   auto& bucket = table_buckets_[bucket_index];
   bucket.mu.lock();
@@ -196,10 +348,213 @@ Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
   return OkStatus();
 }
 
+Rendezvous::DoneCallback LocalRendezvous::DeregisterBeforeDone(
+    CancellationManager* cm, CancellationToken token,
+    Rendezvous::DoneCallback done) {
+  // NOTE(mrry): We must wrap `done` with code that deregisters the
+  // cancellation callback before calling the `done` callback, because the
+  // cancellation manager may no longer be live after `done` is called.
+  return [this, cm, token, done = std::move(done)](
+             const Status& s, const Rendezvous::Args& send_args,
+             const Rendezvous::Args& recv_args, const Tensor& v, bool dead) {
+    // TryDeregisterCallback returns true when the cancellation callback
+    // is successfully deregistered. If it fails because the CM already
+    // StartAbort, Unref will happen inside the cancellation callback
+    // when called by the CM.
+    if (cm->TryDeregisterCallback(token)) {
+      // Unref case (3)
+      if (this->rc_owner_) this->rc_owner_->Unref();
+    }
+    done(s, send_args, recv_args, v, dead);
+  };
+}
+
+void LocalRendezvous::CancelQueuedRecv(Slot* slot, uint64 key_hash,
+                                       CancellationToken token) {
+  auto& bucket = table_buckets_[key_hash % table_buckets_.size()];
+  Item* item = nullptr;
+  {
+    mutex_lock l(bucket.mu);
+    if (slot != nullptr) {
+      MoveSlotToTable(slot, key_hash, &bucket);
+    }
+    auto it = bucket.table.insert({key_hash, ItemQueue()}).first;
+    ItemQueue* queue = &it->second;
+    // Find an item in the queue with a cancellation token that matches
+    // `token`, and remove it.
+    if (queue->head != nullptr && queue->head->type == Item::kRecv) {
+      for (Item *prev = nullptr, *curr = queue->head; curr != nullptr;
+           prev = curr, curr = curr->next) {
+        if (curr->recv_state.cancellation_token == token) {
+          item = curr;
+          if (queue->head->next == nullptr) {
+            // We have a single-element queue, so we can erase it from
+            // the table.
+            bucket.table.erase(it);
+          } else {
+            // Remove the current item from the queue.
+            if (curr == queue->head) {
+              DCHECK_EQ(prev, nullptr);
+              queue->head = curr->next;
+            } else {
+              DCHECK_NE(prev, nullptr);
+              prev->next = curr->next;
+            }
+            if (queue->tail == curr) {
+              queue->tail = prev;
+            }
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  if (item != nullptr) {
+    (*item->recv_state.waiter)(RecvCancelledStatus(), Rendezvous::Args(),
+                               item->args, Tensor(), /*is_dead=*/false);
+    delete item;
+  }
+}
+
+LocalRendezvous::Item* LocalRendezvous::NewSlotRecvItem(
+    Slot* slot, uint64 key_hash, const Rendezvous::Args& recv_args,
+    Rendezvous::DoneCallback done) {
+  CancellationManager* cm = recv_args.cancellation_manager;
+  if (cm == nullptr) {
+    return new Item(recv_args, std::move(done),
+                    CancellationManager::kInvalidToken);
+  }
+  // The reference is dropped as in the cases of RecvAsync().
+  if (rc_owner_) rc_owner_->Ref();
+  CancellationToken token = cm->get_cancellation_token();
+  const bool already_cancelled =
+      !cm->RegisterCallback(token, [this, slot, key_hash, token] {
+        CancelQueuedRecv(slot, key_hash, token);
+        // Unref case (1) and (4)
+        if (rc_owner_) rc_owner_->Unref();
+      });
+  if (already_cancelled) {
+    // Unref case (2)
+    if (rc_owner_) rc_owner_->Unref();
+    done(RecvCancelledStatus(), Rendezvous::Args(), recv_args, Tensor(),
+         /*is_dead=*/false);
+    return nullptr;
+  }
+  return new Item(recv_args, DeregisterBeforeDone(cm, token, std::move(done)),
+                  token);
+}
+
+void LocalRendezvous::RecvFromTable(Slot* slot, uint64 key_hash, Item* item) {
+  auto& bucket = table_buckets_[key_hash % table_buckets_.size()];
+  bucket.mu.lock();
+  MoveSlotToTable(slot, key_hash, &bucket);
+  auto it = bucket.table.insert({key_hash, ItemQueue()}).first;
+  ItemQueue* queue = &it->second;
+  if (queue->head != nullptr && queue->head->type == Item::kSend) {
+    Item* send_item = queue->head;
+    if (send_item->next == nullptr) {
+      bucket.table.erase(it);
+    } else {
+      queue->head = send_item->next;
+    }
+    bucket.pending_callback_counter++;
+    bucket.mu.unlock();
+
+    core::RefCountPtr<const Rendezvous> rc_owner_ref;
+    if (rc_owner_) {
+      rc_owner_ref.reset(rc_owner_);
+      rc_owner_->Ref();
+    }
+    (*item->recv_state.waiter)(OkStatus(), send_item->args, item->args,
+                               *send_item->send_state.value,
+                               send_item->send_state.is_dead);
+    delete send_item;
+    delete item;
+    {
+      mutex_lock l(bucket.mu);
+      bucket.pending_callback_counter--;
+      if (bucket.pending_callback_counter == 0) {
+        bucket.pending_callback_cond_var.notify_all();
+      }
+    }
+    return;
+  }
+
+  // The cancellation callback of `item` may have run before the item was
+  // queued, in which case it did not find it.
+  CancellationManager* cm = item->args.cancellation_manager;
+  if (cm != nullptr && (cm->IsCancelling() || cm->IsCancelled())) {
+    if (queue->head == nullptr) {
+      bucket.table.erase(it);
+    }
+    bucket.mu.unlock();
+    (*item->recv_state.waiter)(RecvCancelledStatus(), Rendezvous::Args(),
+                               item->args, Tensor(), /*is_dead=*/false);
+    delete item;
+    return;
+  }
+  queue->push_back(item);
+  bucket.mu.unlock();
+}
+
+bool LocalRendezvous::RecvFromSlot(Slot* slot, uint64 key_hash,
+                                   const Rendezvous::Args& recv_args,
+                                   Rendezvous::DoneCallback* done) {
+  // Built once the slot is found empty, after which `*done` is moved into it.
+  Item* recv_item = nullptr;
+  uintptr_t state = slot->state.load(std::memory_order_acquire);
+  while (true) {
+    if (state == kEmptySlot) {
+      if (recv_item == nullptr) {
+        recv_item =
+            NewSlotRecvItem(slot, key_hash, recv_args, std::move(*done));
+        if (recv_item == nullptr) {
+          // The recv was cancelled.
+          return true;
+        }
+      }
+      if (slot->state.compare_exchange_weak(
+              state, reinterpret_cast<uintptr_t>(recv_item) | kRecvItemBit,
+              std::memory_order_acq_rel)) {
+        return true;
+      }
+    } else if (state == kTableSlot || (state & kRecvItemBit)) {
+      if (recv_item != nullptr) {
+        RecvFromTable(slot, key_hash, recv_item);
+        return true;
+      }
+      if (state != kTableSlot) {
+        // Another waiter is pending, so queue this one behind it in the table.
+        auto& bucket = table_buckets_[key_hash % table_buckets_.size()];
+        mutex_lock l(bucket.mu);
+        MoveSlotToTable(slot, key_hash, &bucket);
+      }
+      return false;
+    } else if (slot->state.compare_exchange_weak(state, kEmptySlot,
+                                                 std::memory_order_acq_rel)) {
+      Item* item = Slot::ItemOf(state);
+      RunSlotCallback([&] {
+        if (recv_item == nullptr) {
+          (*done)(OkStatus(), item->args, recv_args, *item->send_state.value,
+                  item->send_state.is_dead);
+        } else {
+          (*recv_item->recv_state.waiter)(
+              OkStatus(), item->args, recv_item->args,
+              *item->send_state.value, item->send_state.is_dead);
+          delete recv_item;
+        }
+        delete item;
+      });
+      return true;
+    }
+  }
+}
+
 void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
                                 const Rendezvous::Args& recv_args,
                                 Rendezvous::DoneCallback done) {
-  uint64 key_hash = KeyHash(key.FullKey());
+  uint64 key_hash = key.KeyHash();
   DVLOG(2) << "Recv " << this << " " << key_hash << " " << key.FullKey();
 
   auto s = status();
@@ -209,6 +564,11 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
     return;
   }
 
+  Slot* slot = FindSlot(key_hash);
+  if (slot != nullptr && RecvFromSlot(slot, key_hash, recv_args, &done)) {
+    return;
+  }
+
   int bucket_index = key_hash % table_buckets_.size();
   auto& bucket = table_buckets_[bucket_index];
   bucket.mu.lock();
@@ -237,61 +597,19 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
       //     unref in the cancellation callback.
       if (rc_owner_) rc_owner_->Ref();
       token = cm->get_cancellation_token();
-      already_cancelled = !cm->RegisterCallback(token, [this, token, key_hash,
-                                                        &bucket] {
-        Item* item = nullptr;
-        {
-          mutex_lock l(bucket.mu);
-          auto it = bucket.table.insert({key_hash, ItemQueue()}).first;
-          ItemQueue* queue = &it->second;
-          // Find an item in the queue with a cancellation token that matches
-          // `token`, and remove it.
-          if (queue->head != nullptr && queue->head->type == Item::kRecv) {
-            for (Item *prev = nullptr, *curr = queue->head; curr != nullptr;
-                 prev = curr, curr = curr->next) {
-              if (curr->recv_state.cancellation_token == token) {
-                item = curr;
-                if (queue->head->next == nullptr) {
-                  // We have a single-element queue, so we can erase it from
-                  // the table.
-                  bucket.table.erase(it);
-                } else {
-                  // Remove the current item from the queue.
-                  if (curr == queue->head) {
-                    DCHECK_EQ(prev, nullptr);
-                    queue->head = curr->next;
-                  } else {
-                    DCHECK_NE(prev, nullptr);
-                    prev->next = curr->next;
-                  }
-                  if (queue->tail == curr) {
-                    queue->tail = prev;
-                  }
-                }
-                break;
-              }
-            }
-          }
-        }
-
-        if (item != nullptr) {
-          (*item->recv_state.waiter)(
-              StatusGroup::MakeDerived(
-                  errors::Cancelled("RecvAsync is cancelled.")),
-              Rendezvous::Args(), item->args, Tensor(), /*is_dead=*/false);
-          delete item;
-        }
-        // Unref case (1) and (4)
-        if (rc_owner_) rc_owner_->Unref();
-      });
+      already_cancelled =
+          !cm->RegisterCallback(token, [this, token, key_hash] {
+            CancelQueuedRecv(/*slot=*/nullptr, key_hash, token);
+            // Unref case (1) and (4)
+            if (rc_owner_) rc_owner_->Unref();
+          });
     }
     if (already_cancelled) {
       bucket.mu.unlock();
       // Unref case (2)
       if (rc_owner_) rc_owner_->Unref();
-      done(StatusGroup::MakeDerived(
-               errors::Cancelled("RecvAsync is cancelled.")),
-           Rendezvous::Args(), recv_args, Tensor(), /*is_dead=*/false);
+      done(RecvCancelledStatus(), Rendezvous::Args(), recv_args, Tensor(),
+           /*is_dead=*/false);
       return;
     }
 
@@ -300,25 +618,8 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
     // TODO(b/143786186): Investigate moving the allocation of `Item` outside
     // the lock.
     if (cm != nullptr) {
-      // NOTE(mrry): We must wrap `done` with code that deregisters the
-      // cancellation callback before calling the `done` callback, because the
-      // cancellation manager may no longer be live after `done` is called.
       queue->push_back(new Item(
-          recv_args,
-          [this, cm, token, done = std::move(done)](
-              const Status& s, const Rendezvous::Args& send_args,
-              const Rendezvous::Args& recv_args, const Tensor& v, bool dead) {
-            // TryDeregisterCallback returns true when the cancellation callback
-            // is successfully deregistered. If it fails because the CM already
-            // StartAbort, Unref will happen inside the cancellation callback
-            // when called by the CM.
-            if (cm->TryDeregisterCallback(token)) {
-              // Unref case (3)
-              if (this->rc_owner_) this->rc_owner_->Unref();
-            }
-            done(s, send_args, recv_args, v, dead);
-          },
-          token));
+          recv_args, DeregisterBeforeDone(cm, token, std::move(done)), token));
     } else {
       queue->push_back(new Item(recv_args, std::move(done), token));
     }
@@ -391,6 +692,24 @@ void LocalRendezvous::StartAbort(const Status& status) {
       }
     }
   }
+  Slot* slots = slots_.load(std::memory_order_acquire);
+  for (int i = 0; slots != nullptr && i < kNumSlots; ++i) {
+    Slot& slot = slots[i];
+    uintptr_t state = slot.state.load(std::memory_order_acquire);
+    while (state > kTableSlot &&
+           !slot.state.compare_exchange_weak(state, kEmptySlot,
+                                             std::memory_order_acq_rel)) {
+    }
+    if (state <= kTableSlot) {
+      continue;
+    }
+    Item* item = Slot::ItemOf(state);
+    if (state & kRecvItemBit) {
+      (*item->recv_state.waiter)(status, Rendezvous::Args(),
+                                 Rendezvous::Args(), Tensor(), false);
+    }
+    delete item;
+  }
 }
 
 Status LocalRendezvous::status() {
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_LOCAL_RENDEZVOUS_H_
 #define TENSORFLOW_CORE_FRAMEWORK_LOCAL_RENDEZVOUS_H_
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #include "tensorflow/core/framework/rendezvous.h"
@@ -41,8 +43,7 @@ class LocalRendezvous {
   // Rendezvous), pass in its pointer in constructor so the LocalRendezvous
   // can make sure it outlives the async recv requests.
   // Pass in nullptr if the wrapping class is not refcounted.
-  explicit LocalRendezvous(Rendezvous* owner, int num_shards)
-      : rc_owner_(owner), table_buckets_(num_shards > 0 ? num_shards : 1) {}
+  explicit LocalRendezvous(Rendezvous* owner, int num_shards);
   ~LocalRendezvous();
 
   Status Send(const Rendezvous::ParsedKey& key,
@@ -54,8 +55,12 @@ class LocalRendezvous {
   void StartAbort(const Status& status);
   Status status();
 
+  // The number of slots of the lock-free path. See `Slot`.
+  static constexpr int kNumSlots = 256;
+
  private:
   struct Item;
+  struct Slot;
 
   // By invariant, the item queue under each key is of the form
   //   [item.type == kSend]* meaning each item is a sent message.
@@ -70,9 +75,6 @@ class LocalRendezvous {
 
   typedef gtl::FlatMap<uint64, ItemQueue> Table;
 
-  // Pointer to the owner class of this LocalRendezvous if it is refcounted.
-  const Rendezvous* rc_owner_;
-
   struct TableBucket {
     mutex mu;
     Table table TF_GUARDED_BY(mu);
@@ -82,8 +84,73 @@ class LocalRendezvous {
     condition_variable pending_callback_cond_var TF_GUARDED_BY(mu);
   };
 
+  // Returns the slot of the key with hash `key_hash`, claiming it if no key
+  // owns it yet, or null if another key owns it. Allocates the slots on first
+  // use.
+  Slot* FindSlot(uint64 key_hash);
+
+  // Makes the key of `slot` use the table for the rest of the life of the
+  // rendezvous, moving the item pending in the slot, if any, to its queue.
+  void MoveSlotToTable(Slot* slot, uint64 key_hash, TableBucket* bucket)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(bucket->mu);
+
+  // Returns a Recv item calling `done`, or null if the cancellation manager
+  // of `recv_args` is already cancelled, in which case `done` has been
+  // called. The item waits in `slot`, or in the table after the cancellation
+  // manager is cancelled.
+  Item* NewSlotRecvItem(Slot* slot, uint64 key_hash,
+                        const Rendezvous::Args& recv_args,
+                        Rendezvous::DoneCallback done);
+
+  // Matches `item`, a Recv item which could not wait in `slot`, with the
+  // first message queued under `key_hash`, or queues it.
+  void RecvFromTable(Slot* slot, uint64 key_hash, Item* item);
+
+  // Sends the message through `slot`. Returns false if the key uses the table
+  // instead.
+  bool SendToSlot(Slot* slot, uint64 key_hash,
+                  const Rendezvous::Args& send_args, const Tensor& val,
+                  bool is_dead);
+
+  // Receives the message through `slot`. Returns false, without calling
+  // `*done`, if the key uses the table instead.
+  bool RecvFromSlot(Slot* slot, uint64 key_hash,
+                    const Rendezvous::Args& recv_args,
+                    Rendezvous::DoneCallback* done);
+
+  // Calls `fn`, counted in `pending_slot_callbacks_`.
+  template <typename Fn>
+  void RunSlotCallback(Fn fn);
+
+  // Cancels the Recv item with `token` queued under `key_hash`, if any. If
+  // `slot` is not null, the item may be waiting in it and is first moved to
+  // the table.
+  void CancelQueuedRecv(Slot* slot, uint64 key_hash, CancellationToken token);
+
+  // Returns a callback that deregisters `token` from `cm` before calling
+  // `done`.
+  Rendezvous::DoneCallback DeregisterBeforeDone(CancellationManager* cm,
+                                                CancellationToken token,
+                                                Rendezvous::DoneCallback done);
+
+  // Pointer to the owner class of this LocalRendezvous if it is refcounted.
+  const Rendezvous* rc_owner_;
+
   // Immutable vector.
   std::vector<TableBucket> table_buckets_;
+
+  // Lock-free path for the keys with one pending Send or Recv at a time,
+  // which is the common case of the Send/Recv pairs of partitioned graphs.
+  // An array of `kNumSlots` slots, allocated by the first Send or Recv so that
+  // the rendezvous which are never used don't pay for it.
+  std::atomic<Slot*> slots_{nullptr};
+  // The number of done-callbacks of items taken from the slots that are
+  // running. Only decremented to 0 under `slot_callbacks_mu_`, by the last
+  // callback, which then signals `slot_callbacks_cond_var_`.
+  std::atomic<int> pending_slot_callbacks_{0};
+  mutex slot_callbacks_mu_;
+  condition_variable slot_callbacks_cond_var_;
+
   mutex mu_;
   Status status_ TF_GUARDED_BY(mu_);
 
@@ -49,6 +49,15 @@ auto* graph_pending_queue_length_histogram = tsl::monitoring::Sampler<0>::New(
     // Power of 1.5 with bucket count 30 (> 191k)
     {tsl::monitoring::Buckets::Exponential(1, 1.5, 30)});
 
+auto* kernel_execution_time_usecs_histogram =
+    tsl::monitoring::Sampler<1>::New(
+        {"/tensorflow/core/kernel_execution_time_usecs_histogram",
+         "A sample of the execution times of the synchronous kernels of "
+         "graphs in microseconds.",
+         "op_type"},
+        // Power of 2 with bucket count 24 (> 16 seconds)
+        {tsl::monitoring::Buckets::Exponential(1, 2, 24)});
+
 auto* graph_run_input_tensor_bytes = tsl::monitoring::Sampler<0>::New(
     {"/tensorflow/core/graph_run_input_tensor_bytes",
      "The size of input tensors in bytes."},
@@ -173,6 +182,21 @@ auto* tf_data_service_cross_trainer_cache_size_bytes =
         "/tensorflow/data/service/cross_trainer_cache_size_bytes",
         "tf.data service cross-trainer cache memory usage in bytes.");
 
+auto* tf_data_service_cross_trainer_cache_evictions_counter =
+    tsl::monitoring::Counter<1>::New(
+        "/tensorflow/data/service/cross_trainer_cache_evictions",
+        "Number of elements evicted from the tf.data service cross-trainer "
+        "cache. Elements not read by all trainers are skipped by some trainer.",
+        "read_by_all_trainers");
+
+auto* tf_data_service_cross_trainer_cache_trainer_lag =
+    tsl::monitoring::Sampler<0>::New(
+        {"/tensorflow/data/service/cross_trainer_cache_trainer_lag",
+         "Number of cached elements a trainer has not read from the tf.data "
+         "service cross-trainer cache, sampled at each of its reads."},
+        // Power of 2 with bucket count 20 (> 500k elements)
+        {tsl::monitoring::Buckets::Exponential(1, 2, 20)});
+
 auto* tf_data_filename_counter = tsl::monitoring::Counter<2>::New(
     "/tensorflow/data/filename", "The file name read by a tf.data Dataset.",
     "name", "filename");
@@ -416,6 +440,20 @@ void RecordTFDataServiceCrossTrainerCacheSizeBytes(size_t bytes) {
       static_cast<int64_t>(bytes));
 }
 
+void RecordTFDataServiceCrossTrainerCacheEvictions(int64_t num_elements,
+                                                   bool read_by_all_trainers) {
+  std::string read_by_all_trainers_str =
+      read_by_all_trainers ? "true" : "false";
+  tf_data_service_cross_trainer_cache_evictions_counter
+      ->GetCell(read_by_all_trainers_str)
+      ->IncrementBy(num_elements);
+}
+
+void RecordTFDataServiceCrossTrainerCacheTrainerLag(size_t num_elements) {
+  tf_data_service_cross_trainer_cache_trainer_lag->GetCell()->Add(
+      static_cast<double>(num_elements));
+}
+
 void RecordTFDataFilename(const string& name, const string& filename) {
   tf_data_filename_counter->GetCell(name, filename)->IncrementBy(1);
 }
@@ -490,6 +528,10 @@ void UpdateGraphExecTime(const uint64 running_time_usecs) {
   }
 }
 
+monitoring::SamplerCell* GetKernelExecutionTimeCell(const string& op_type) {
+  return kernel_execution_time_usecs_histogram->GetCell(op_type);
+}
+
 void UpdateGraphPendingQueueLength(uint64 len) {
   static auto* graph_pending_queue_length_cell =
       graph_pending_queue_length_histogram->GetCell();
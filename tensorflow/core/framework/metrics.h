@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset_options.pb.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/types.h"
@@ -131,6 +132,16 @@ void RecordTFDataServiceCrossTrainerCacheQuery(bool cache_hit);
 // Records tf.data service cross-trainer cache memory usage in bytes.
 void RecordTFDataServiceCrossTrainerCacheSizeBytes(size_t bytes);
 
+// Records `num_elements` evicted from the tf.data service cross-trainer cache.
+// `read_by_all_trainers` is false if some trainer skips the evicted elements.
+void RecordTFDataServiceCrossTrainerCacheEvictions(int64_t num_elements,
+                                                   bool read_by_all_trainers);
+
+// Records the number of cached elements a trainer reading from the tf.data
+// service cross-trainer cache has not read yet. The metric isn't labelled by
+// trainer, since the trainer IDs are chosen by the clients and unbounded.
+void RecordTFDataServiceCrossTrainerCacheTrainerLag(size_t num_elements);
+
 // Records the file name read by a tf.data Dataset.
 //
 // The `name` argument identifies the Dataset type (e.g. "TFRecordDataset").
@@ -176,6 +187,10 @@ void RecordTPUXlaSpmdCoresPerReplica(int64_t cores_per_replica);
 void UpdateGraphExecTime(const uint64 running_time_usecs);
 void UpdateGraphPendingQueueLength(uint64 len);
 
+// Returns the cell of the histogram of the sampled execution times, in
+// microseconds, of the kernels of type `op_type`.
+monitoring::SamplerCell* GetKernelExecutionTimeCell(const string& op_type);
+
 // Records that one output of an op of type `op_name` was unused.
 void RecordUnusedOutput(const string& op_name);
 
@@ -1961,14 +1961,10 @@ void Node::TotalBufferedBytesHelper(Node::NodeValues* total_bytes) const
     return;
   }
 
-  double result = 0;
-  auto* parameter = gtl::FindOrNull(parameters_, kBufferSize);
-  if (!parameter) {
-    parameter = gtl::FindOrNull(parameters_, kParallelism);
-  }
-  if (parameter) {
-    result = buffered_bytes_;
-  }
+  // Bytes held by every node are counted, including nodes whose buffers are
+  // not tunable (e.g. shuffle buffers or partially built batches), since they
+  // count against the RAM budget just the same.
+  double result = buffered_bytes_;
   for (auto& input : inputs_) {
     result += total_bytes->at(input->long_name());
   }
@@ -1990,7 +1986,9 @@ void Node::TotalMaximumBufferedBytesHelper(Node::NodeValues* total_bytes) const
 }
 
 double Node::MaximumBufferedBytes() const TF_SHARED_LOCKS_REQUIRED(mu_) {
-  return 0;
+  // Nodes without a tunable buffer do not grow their buffers in response to
+  // autotuning, so their current usage is the best estimate of their maximum.
+  return buffered_bytes_;
 }
 
 Status Node::ToProto(ModelProto::Node* node_proto) const {
@@ -2209,6 +2207,11 @@ void Model::Optimize(AutotuneAlgorithm algorithm, int64_t cpu_budget,
   if (experiment_ == "autotune_buffer_optimization") {
     OptimizeBuffers(snapshot, optimization_params.ram_budget());
   }
+  // The RAM budget is a hard ceiling, so buffers grown by the algorithms above
+  // or by earlier optimization rounds are shrunk if the pipeline exceeds it.
+  if (DownsizeBuffersToRamBudget(snapshot, optimization_params.ram_budget())) {
+    ResetBufferWatermarks();
+  }
 }
 
 void Model::RemoveNode(std::shared_ptr<Node> node) {
@@ -2652,6 +2655,60 @@ bool Model::UpsizeBuffers(std::shared_ptr<Node> snapshot, int64_t ram_budget) {
   return upsized;
 }
 
+bool Model::DownsizeBuffersToRamBudget(std::shared_ptr<Node> snapshot,
+                                       int64_t ram_budget) {
+  const double excess_bytes =
+      TotalMaximumBufferedBytes(snapshot) - static_cast<double>(ram_budget);
+  if (excess_bytes <= 0) {
+    return false;
+  }
+  absl::flat_hash_map<std::string, std::shared_ptr<Node>> nodes_by_name;
+  for (auto& node : snapshot->CollectNodes(TraversalOrder::BFS, IsAsyncNode)) {
+    nodes_by_name[node->long_name()] = node;
+  }
+  nodes_by_name[snapshot->long_name()] = snapshot;
+
+  // Compute the memory used by all tunable buffers if they were full.
+  std::vector<std::pair<Node*, Parameter*>> buffers;
+  double buffers_bytes = 0;
+  for (auto& [node_name, parameter] : snapshot->CollectTunableParameters()) {
+    auto it = nodes_by_name.find(node_name);
+    if (parameter->name != kBufferSize || it == nodes_by_name.end() ||
+        it->second->buffered_elements() == 0) {
+      continue;
+    }
+    Node* node = it->second.get();
+    buffers.emplace_back(node, parameter.get());
+    buffers_bytes += static_cast<double>(node->buffered_bytes()) /
+                     static_cast<double>(node->buffered_elements()) *
+                     parameter->value;
+  }
+  if (buffers_bytes <= 0) {
+    return false;
+  }
+
+  const double scaling_factor = std::max(0.0, 1.0 - excess_bytes / buffers_bytes);
+  bool downsized = false;
+  for (auto& [node, parameter] : buffers) {
+    double old_value = parameter->value;
+    parameter->value = std::max(
+        parameter->min, std::floor(parameter->value * scaling_factor));
+    VLOG(2) << "Downsize buffer " << node->long_name() << "::"
+            << parameter->name << " from " << old_value << " to "
+            << parameter->value << " to respect the RAM budget of "
+            << ram_budget << " bytes";
+    if (parameter->value != parameter->state->value) {
+      {
+        mutex_lock l(*parameter->state->mu);
+        parameter->state->value = parameter->value;
+        parameter->state->cond_var->notify_all();
+      }
+      downsized = true;
+    }
+  }
+  return downsized;
+}
+
 void Model::ResetBufferWatermarks() {
   Node::NodeVector nodes =
       output()->CollectNodes(TraversalOrder::BFS, IsAsyncNode);
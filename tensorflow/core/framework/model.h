@@ -658,9 +658,10 @@ class Node {
       TF_SHARED_LOCKS_REQUIRED(mu_);
 
   // Compute and return the maximum buffered bytes on the node itself. By
-  // default non-tunable nodes are assumed not to buffer any bytes, so the
-  // tunable nodes as subclasses are expected to override this method to ensure
-  // that the optimization algorithm respects the memory budget.
+  // default non-tunable nodes are assumed to keep buffering the bytes they
+  // currently buffer, so the tunable nodes as subclasses are expected to
+  // override this method to ensure that the optimization algorithm respects
+  // the memory budget.
   virtual double MaximumBufferedBytes() const TF_SHARED_LOCKS_REQUIRED(mu_);
 
   // Restores node from the proto. Note that this is not done recursively, i.e.
@@ -825,6 +826,13 @@ class Model {
   // watermarks of all nodes are reset to the buffered elements.
   void OptimizeBuffers(std::shared_ptr<Node> snapshot, int64_t ram_budget);
 
+  // Shrinks the tunable buffers in the pipeline rooted at `snapshot` so that
+  // the maximum number of bytes buffered by the pipeline does not exceed
+  // `ram_budget`. Buffers are shrunk by a uniform factor but never below their
+  // minimum value. Returns true if any buffer is downsized.
+  bool DownsizeBuffersToRamBudget(std::shared_ptr<Node> snapshot,
+                                  int64_t ram_budget);
+
   // Collects the output time and if `gradients` is not `nullptr`, the output
   // time gradient w.r.t. tunable parameters of the subtree rooted in the given
   // node.
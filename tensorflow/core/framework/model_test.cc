@@ -2385,6 +2385,90 @@ TEST_F(BufferSizeTest, OptimizeBuffers_TightMemory) {
   EXPECT_EQ(4, node_4->buffered_elements_high());
 }
 
+TEST_F(BufferSizeTest, DownsizeBuffersToRamBudget) {
+  ReadModel(R"pb(
+    nodes: {
+      key: 1
+      value: {
+        id: 1
+        name: "Prefetch"
+        autotune: true
+        bytes_produced: 10000
+        num_elements: 100
+        processing_time: 2000
+        node_class: ASYNC_KNOWN_RATIO
+        inputs: 2
+        ratio: 1
+        parameters: {
+          name: "buffer_size"
+          value: 10
+          state_value: 10
+          min: 1
+          max: 10
+          tunable: true
+        }
+      }
+    }
+    nodes: {
+      key: 2
+      value: {
+        id: 2
+        name: "Prefetch"
+        autotune: true
+        bytes_produced: 10000
+        num_elements: 100
+        processing_time: 2000
+        node_class: ASYNC_KNOWN_RATIO
+        ratio: 1
+        parameters: {
+          name: "buffer_size"
+          value: 10
+          state_value: 10
+          min: 4
+          max: 10
+          tunable: true
+        }
+      }
+    }
+    output: 1
+  )pb");
+
+  std::shared_ptr<Node> node_1 = GetNode(1);
+  std::shared_ptr<Node> node_2 = GetNode(2);
+  node_1->record_buffer_event(100, 1);
+  node_2->record_buffer_event(100, 1);
+  EXPECT_DOUBLE_EQ(2000, node_1->TotalMaximumBufferedBytes());
+
+  // Within budget, nothing changes.
+  EXPECT_FALSE(model_->DownsizeBuffersToRamBudget(node_1->Snapshot(), 2000));
+  EXPECT_EQ(10, node_1->parameter_value(kBufferSize));
+  EXPECT_EQ(10, node_2->parameter_value(kBufferSize));
+
+  // Over budget, buffers are shrunk uniformly but not below their minimum.
+  EXPECT_TRUE(model_->DownsizeBuffersToRamBudget(node_1->Snapshot(), 600));
+  EXPECT_EQ(3, node_1->parameter_value(kBufferSize));
+  EXPECT_EQ(4, node_2->parameter_value(kBufferSize));
+}
+
+TEST(BufferedBytesTest, NonTunableNodes) {
+  std::shared_ptr<Node> node = model::MakeAsyncKnownRatioNode(
+      {1, "Prefetch", nullptr}, 1,
+      {model::MakeParameter(
+          "buffer_size",
+          std::make_shared<SharedState>(/*value=*/2, nullptr, nullptr),
+          /*min=*/1, /*max=*/8)});
+  std::shared_ptr<Node> shuffle =
+      model::MakeKnownRatioNode({2, "Shuffle", node}, 1);
+  node->add_input(shuffle);
+
+  node->record_buffer_event(10, 1);
+  shuffle->record_buffer_event(1000, 100);
+  // The bytes held by the non-tunable shuffle buffer are counted against both
+  // the current and the maximum buffered bytes.
+  EXPECT_EQ(1010, node->TotalBufferedBytes());
+  EXPECT_EQ(1020, node->TotalMaximumBufferedBytes());
+}
+
 TEST_F(ModelTimingTest, OptimizeStageBased_OneStage) {
   BuildModelFromProto(R"pb(
     nodes: {
@@ -378,6 +378,8 @@ Allocator* OpKernelContext::get_allocator(AllocatorAttributes attr) {
   if (TF_PREDICT_FALSE(attr.scope_id > 0)) {
     allocator = params_->device->GetScopedAllocator(attr, step_id());
     CHECK(allocator);
+  } else if (params_->step_arena_allocator != nullptr && attr.value == 0) {
+    allocator = params_->step_arena_allocator;
   } else {
     allocator = params_->device->GetAllocator(attr);
   }
@@ -809,7 +811,19 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
       op_kernel().name_view().data(), step_id(), "output", type,
       [&shape]() { return shape.DebugString(); });
   auto output_tensor = MakeUnique<Tensor>();
-  Status s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  core::RefCountPtr<TensorBuffer> planned_buffer;
+  if (params_->planned_output_buffers != nullptr && attr.value == 0 &&
+      attr.scope_id == 0 && !params_->track_allocations &&
+      !params_->log_memory) {
+    planned_buffer = params_->planned_output_buffers->AllocateOutput(
+        index, shape.num_elements() * DataTypeSize(type));
+  }
+  Status s;
+  if (planned_buffer) {
+    *output_tensor = Tensor(type, shape, std::move(planned_buffer));
+  } else {
+    s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  }
   if (s.ok()) {
     outputs_[index] = TensorValue(output_tensor.release());
     *output = outputs_[index].tensor;
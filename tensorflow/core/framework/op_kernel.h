@@ -560,6 +560,18 @@ struct GraphCollector {
   }
 };
 
+// Serves the buffers that the executor planned ahead of time for the outputs
+// of one op kernel invocation. See OpKernelContext::Params.
+class PlannedOutputBuffers {
+ public:
+  virtual ~PlannedOutputBuffers() = default;
+
+  // Returns a buffer of `num_bytes` bytes for output `index`, or null if no
+  // buffer of that size is planned for it or the planned one is not available.
+  virtual core::RefCountPtr<TensorBuffer> AllocateOutput(int index,
+                                                         size_t num_bytes) = 0;
+};
+
 class OpKernelContext {
  public:
   // The first element of a WrappedAllocator is a "base" Allocator and
@@ -675,6 +687,17 @@ class OpKernelContext {
     // TensorSliceReaderCache support.
     checkpoint::TensorSliceReaderCacheWrapper* slice_reader_cache = nullptr;
 
+    // If not null, serves the allocations of this op kernel invocation that
+    // use the default allocator attributes, in place of the device allocator.
+    // Set by the executor for the kernels whose tensors are not expected to
+    // outlive the step.
+    Allocator* step_arena_allocator = nullptr;
+
+    // If not null, serves the outputs of this op kernel invocation that are
+    // allocated with the default allocator attributes and match the size
+    // planned for them. Set by the executor for graphs with a memory plan.
+    PlannedOutputBuffers* planned_output_buffers = nullptr;
+
     // Support for forwarding reservations (used by ScopedAllocator).
     static constexpr int kNeverForward = -2;
     static constexpr int kNoReservation = -1;
@@ -47,9 +47,17 @@ Rendezvous::ParsedKey& Rendezvous::ParsedKey::operator=(const ParsedKey& b) {
   dst = b.dst;
   edge_name = StringPiece(buf_.data() + (b.edge_name.data() - b_base),
                           b.edge_name.size());
+  key_hash_ = b.key_hash_;
   return *this;
 }
 
+uint64 Rendezvous::ParsedKey::KeyHash() const {
+  if (TF_PREDICT_TRUE(key_hash_ != 0)) {
+    return key_hash_;
+  }
+  return Hash64(buf_.data(), buf_.size());
+}
+
 /*  static */
 string Rendezvous::CreateKey(const string& src_device, uint64 src_incarnation,
                              const string& dst_device, const string& name,
@@ -95,6 +103,7 @@ Status Rendezvous::ParseKey(StringPiece key, ParsedKey* out) {
     // for the lifetime of the ParsedKey object.
     out->buf_.assign(key.data(), key.size());
   }
+  out->key_hash_ = 0;
   StringPiece s(out->buf_);
   StringPiece parts[5];
   for (int i = 0; i < 5; i++) {
@@ -109,6 +118,7 @@ Status Rendezvous::ParseKey(StringPiece key, ParsedKey* out) {
     out->src_device = StringPiece(parts[0].data(), parts[0].size());
     out->dst_device = StringPiece(parts[2].data(), parts[2].size());
     out->edge_name = StringPiece(parts[3].data(), parts[3].size());
+    out->key_hash_ = Hash64(out->buf_.data(), out->buf_.size());
     return OkStatus();
   }
   return errors::InvalidArgument("Invalid  rendezvous key: ", key);
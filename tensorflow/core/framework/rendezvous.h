@@ -70,11 +70,17 @@ class RendezvousInterface {
     ParsedKey& operator=(const ParsedKey& b);
     StringPiece FullKey() const { return buf_; }
 
+    // Returns the hash of FullKey(). It is computed once by ParseKey(), which
+    // the Send and Recv kernels outside loops call when they are created.
+    uint64 KeyHash() const;
+
    private:
     friend class Rendezvous;
     friend class SendOp;
     friend class RecvOp;
     std::string buf_;
+    // The hash of `buf_`, or 0 if it is not computed.
+    uint64 key_hash_ = 0;
   };
 
   // The caller is a tensor producer and it sends a message (a tensor
@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/framework/rendezvous.h"
 
+#include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/local_rendezvous.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_types.h"
@@ -355,6 +358,113 @@ TEST_F(LocalRendezvousTest, MultiSends) {
   }
 }
 
+TEST_F(LocalRendezvousTest, QueuedSendsStayInOrder) {
+  // The second message moves the key from its slot to the table.
+  Rendezvous::Args args;
+  for (int i = 0; i < 3; ++i) {
+    TF_ASSERT_OK(rendez_->Send(KeyFoo(), args, V(strings::StrCat(i)), false));
+  }
+  for (int i = 0; i < 3; ++i) {
+    Tensor val(DT_STRING);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(KeyFoo(), args, &val, &is_dead));
+    EXPECT_EQ(strings::StrCat(i), V(val));
+  }
+}
+
+TEST_F(LocalRendezvousTest, QueuedRecvsStayInOrder) {
+  Rendezvous::Args args;
+  std::vector<string> received;
+  for (int i = 0; i < 3; ++i) {
+    rendez_->RecvAsync(KeyFoo(), args,
+                       [&received](const Status& s, const Rendezvous::Args&,
+                                   const Rendezvous::Args&, const Tensor& v,
+                                   bool) {
+                         TF_EXPECT_OK(s);
+                         received.push_back(V(v));
+                       });
+  }
+  for (int i = 0; i < 3; ++i) {
+    TF_ASSERT_OK(rendez_->Send(KeyFoo(), args, V(strings::StrCat(i)), false));
+  }
+  EXPECT_EQ(received, std::vector<string>({"0", "1", "2"}));
+}
+
+TEST_F(LocalRendezvousTest, SendRecvAfterCancelledRecv) {
+  auto* cm = new CancellationManager();
+  Rendezvous::Args args;
+  args.cancellation_manager = cm;
+  Notification n;
+  Status status;
+  rendez_->RecvAsync(KeyFoo(), args,
+                     [&n, &status](const Status& s, const Rendezvous::Args&,
+                                   const Rendezvous::Args&, const Tensor&,
+                                   bool) {
+                       status = s;
+                       n.Notify();
+                     });
+  cm->StartCancel();
+  n.WaitForNotification();
+  EXPECT_TRUE(errors::IsCancelled(status));
+  delete cm;
+
+  // The key keeps working once cancellation has moved it to the table.
+  Rendezvous::Args plain_args;
+  TF_ASSERT_OK(rendez_->Send(KeyFoo(), plain_args, V("hello"), false));
+  Tensor val(DT_STRING);
+  bool is_dead = false;
+  TF_ASSERT_OK(rendez_->Recv(KeyFoo(), plain_args, &val, &is_dead));
+  EXPECT_EQ("hello", V(val));
+}
+
+TEST_F(LocalRendezvousTest, MoreKeysThanSlots) {
+  // Some of the keys share a slot and use the table.
+  const int kNumKeys = 2 * LocalRendezvous::kNumSlots;
+  std::vector<Rendezvous::ParsedKey> keys;
+  for (int i = 0; i < kNumKeys; ++i) {
+    keys.push_back(MakeKey(strings::StrCat("key", i)));
+  }
+  Rendezvous::Args args;
+  for (int i = 0; i < kNumKeys; ++i) {
+    TF_ASSERT_OK(rendez_->Send(keys[i], args, V(strings::StrCat(i)), false));
+  }
+  for (int i = kNumKeys - 1; i >= 0; --i) {
+    Tensor val(DT_STRING);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(keys[i], args, &val, &is_dead));
+    EXPECT_EQ(strings::StrCat(i), V(val));
+  }
+}
+
+TEST_F(LocalRendezvousTest, DestructorWaitsForRunningCallbacks) {
+  auto* rendez = new LocalRendezvous(/*owner=*/nullptr, /*num_shards=*/1);
+  Notification callback_started;
+  Notification callback_may_finish;
+  bool callback_finished = false;
+  rendez->RecvAsync(MakeKey("foo"), Rendezvous::Args(),
+                    [&](const Status& s, const Rendezvous::Args&,
+                        const Rendezvous::Args&, const Tensor&, bool) {
+                      callback_started.Notify();
+                      callback_may_finish.WaitForNotification();
+                      callback_finished = true;
+                    });
+  // The Send runs the callback of the pending Recv.
+  SchedClosure([rendez]() {
+    TF_EXPECT_OK(
+        rendez->Send(MakeKey("foo"), Rendezvous::Args(), V("hello"), false));
+  });
+  callback_started.WaitForNotification();
+  Notification deleted;
+  SchedClosure([rendez, &deleted]() {
+    delete rendez;
+    deleted.Notify();
+  });
+  EXPECT_FALSE(WaitForNotificationWithTimeout(&deleted, 10000));
+  callback_may_finish.Notify();
+  deleted.WaitForNotification();
+  EXPECT_TRUE(callback_finished);
+}
+
 TEST_F(LocalRendezvousTest, RecvAbort) {
   rendez_->Ref();
   SchedClosure([this]() {
@@ -15,7 +15,12 @@ limitations under the License.
 
 #include "tensorflow/core/framework/resource_var.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "tensorflow/core/framework/resource_handle.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
 
 namespace tensorflow {
@@ -37,4 +42,142 @@ Status Var::AsGraphDef(GraphDefBuilder* builder, Node** out) const {
       ops::UnaryOp("Identity", var, builder->opts().WithControlInput(assign));
   return OkStatus();
 }
+
+std::atomic<bool> Var::dirty_rows_tracked_{false};
+
+void Var::DirtyRows::Mark(int64_t row) {
+  if (all_rows_dirty_ || row < 0) return;
+  if (row >= static_cast<int64_t>(dirty_rows_.size())) {
+    dirty_rows_.resize(row + 1);
+  }
+  dirty_rows_[row] = true;
+}
+
+void Var::DirtyRows::MarkAll() {
+  all_rows_dirty_ = true;
+  dirty_rows_.clear();
+}
+
+std::vector<int64_t> Var::DirtyRows::Take(int64_t num_rows, bool* all_rows) {
+  std::vector<int64_t> rows;
+  *all_rows = all_rows_dirty_;
+  if (!all_rows_dirty_) {
+    const int64_t end = std::min<int64_t>(num_rows, dirty_rows_.size());
+    for (int64_t row = 0; row < end; ++row) {
+      if (dirty_rows_[row]) rows.push_back(row);
+    }
+  }
+  all_rows_dirty_ = false;
+  dirty_rows_.clear();
+  return rows;
+}
+
+void Var::MarkRowsDirty(const Tensor& indices) {
+  const bool track_checkpoint =
+      track_dirty_rows_.load(std::memory_order_relaxed);
+  const bool track_snapshot =
+      track_snapshot_rows_.load(std::memory_order_relaxed);
+  if (!track_checkpoint && !track_snapshot) return;
+  mutex_lock l(dirty_rows_mu_);
+  auto mark = [&](int64_t row) TF_EXCLUSIVE_LOCKS_REQUIRED(dirty_rows_mu_) {
+    if (track_checkpoint) checkpoint_rows_.Mark(row);
+    if (track_snapshot) snapshot_rows_.Mark(row);
+  };
+  if (indices.dtype() == DT_INT32) {
+    const auto rows = indices.flat<int32>();
+    for (int64_t i = 0; i < rows.size(); ++i) mark(rows(i));
+  } else if (indices.dtype() == DT_INT64) {
+    const auto rows = indices.flat<int64_t>();
+    for (int64_t i = 0; i < rows.size(); ++i) mark(rows(i));
+  } else {
+    checkpoint_rows_.MarkAll();
+    snapshot_rows_.MarkAll();
+  }
+}
+
+void Var::MarkAllRowsDirty() {
+  if (!track_dirty_rows_.load(std::memory_order_relaxed) &&
+      !track_snapshot_rows_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  mutex_lock l(dirty_rows_mu_);
+  checkpoint_rows_.MarkAll();
+  snapshot_rows_.MarkAll();
+}
+
+std::vector<int64_t> Var::TakeDirtyRows(int64_t num_rows) {
+  dirty_rows_tracked_.store(true, std::memory_order_relaxed);
+  track_dirty_rows_.store(true, std::memory_order_relaxed);
+  mutex_lock l(dirty_rows_mu_);
+  bool all_rows;
+  std::vector<int64_t> rows = checkpoint_rows_.Take(num_rows, &all_rows);
+  if (all_rows) {
+    rows.resize(num_rows);
+    for (int64_t row = 0; row < num_rows; ++row) rows[row] = row;
+  }
+  return rows;
+}
+
+Status Var::ReadSnapshot(Allocator* allocator, Tensor* snapshot) {
+  if (!DataTypeCanUseMemcpy(tensor_.dtype())) {
+    return errors::InvalidArgument("Can't snapshot a variable of type ",
+                                   DataTypeString(tensor_.dtype()));
+  }
+  mutex_lock l(read_snapshot_mu_);
+  dirty_rows_tracked_.store(true, std::memory_order_relaxed);
+  track_snapshot_rows_.store(true, std::memory_order_relaxed);
+  const int64_t num_rows = tensor_.dims() > 0 ? tensor_.dim_size(0) : 1;
+  bool all_rows;
+  std::vector<int64_t> rows;
+  {
+    mutex_lock dl(dirty_rows_mu_);
+    rows = snapshot_rows_.Take(num_rows, &all_rows);
+  }
+  const size_t total_bytes = tensor_.TotalBytes();
+
+  // The snapshot can be refreshed in place unless a reader still aliases it.
+  const bool reuse = read_snapshot_.IsInitialized() &&
+                     read_snapshot_.RefCountIsOne() &&
+                     read_snapshot_.dtype() == tensor_.dtype() &&
+                     read_snapshot_.shape() == tensor_.shape() &&
+                     read_snapshot_source_ == tensor_.data();
+  if (!reuse) {
+    Tensor copy(allocator, tensor_.dtype(), tensor_.shape());
+    if (!copy.IsInitialized()) {
+      return errors::ResourceExhausted("OOM when allocating a snapshot of ",
+                                       tensor_.shape().DebugString(), " ",
+                                       DataTypeString(tensor_.dtype()));
+    }
+    read_snapshot_ = std::move(copy);
+    read_snapshot_source_ = tensor_.data();
+    all_rows = true;
+  }
+  if (total_bytes > 0) {
+    char* dst = static_cast<char*>(read_snapshot_.data());
+    const char* src = static_cast<const char*>(tensor_.data());
+    if (all_rows) {
+      std::memcpy(dst, src, total_bytes);
+    } else {
+      const size_t row_bytes = total_bytes / num_rows;
+      for (const int64_t row : rows) {
+        std::memcpy(dst + row * row_bytes, src + row * row_bytes, row_bytes);
+      }
+    }
+  }
+  VLOG(2) << "Read snapshot of variable " << DebugString() << ": copied "
+          << (all_rows ? num_rows : rows.size()) << " of " << num_rows
+          << " rows";
+  *snapshot = read_snapshot_;
+  return OkStatus();
+}
+
+void Var::ReleaseReadSnapshot() {
+  mutex_lock l(read_snapshot_mu_);
+  read_snapshot_ = Tensor();
+  read_snapshot_source_ = nullptr;
+  track_snapshot_rows_.store(false, std::memory_order_relaxed);
+  mutex_lock dl(dirty_rows_mu_);
+  snapshot_rows_.MarkAll();
+}
+
 }  //  end namespace tensorflow
@@ -16,9 +16,14 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_RESOURCE_VAR_H_
 #define TENSORFLOW_CORE_FRAMEWORK_RESOURCE_VAR_H_
 
+#include <atomic>
+#include <vector>
+
 #include "tensorflow/core/framework/resource_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 // Forward declarations to avoid introducing a dependency on headers in
 // "tensorflow/core/graph/...".
@@ -79,10 +84,43 @@ class Var : public ResourceBase {
     // move frees the buffer of the tensor after unused goes out of scope.
     Tensor unused = std::move(tensor_);
     is_initialized = false;
+    ReleaseReadSnapshot();
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override;
 
+  // Tracking of the rows written since the last TakeDirtyRows(), so that a
+  // delta checkpoint saves only those. Tracking starts at the first call to
+  // TakeDirtyRows(), and the Mark functions cost nothing until then.
+  //
+  // Ops writing the variable must mark the rows they write: its sparse
+  // updates mark `indices`, a vector of int32 or int64 row indices on the
+  // host, and its other writes mark all rows.
+  void MarkRowsDirty(const Tensor& indices);
+  void MarkAllRowsDirty();
+  // Returns the rows of the first `num_rows` written since the last call,
+  // in increasing order, all of them on the first call, and clears them.
+  std::vector<int64_t> TakeDirtyRows(int64_t num_rows);
+  // Returns whether any variable of the process tracks its rows.
+  static bool DirtyRowsTracked() {
+    return dirty_rows_tracked_.load(std::memory_order_relaxed);
+  }
+
+  // Dense reads in copy-on-read mode must return a copy of the variable. With
+  // read snapshots, the variable keeps the copy returned by the previous read,
+  // and refreshes it by copying only the rows written since, if no reader
+  // aliases it anymore. This trades the memory of a copy for not copying the
+  // whole variable on each read, and relies on the writers marking the rows
+  // they write, like delta checkpoints.
+  //
+  // Sets `*snapshot` to the value of the variable, allocating from
+  // `allocator` if the snapshot can't be reused. The caller must hold mu(),
+  // possibly shared, and the variable must be in copy-on-read mode, in host
+  // memory and of a type that can be memcpy'd.
+  Status ReadSnapshot(Allocator* allocator, Tensor* snapshot);
+  // Frees the snapshot and stops tracking its rows.
+  void ReleaseReadSnapshot();
+
   std::string DebugString() const override {
     return strings::StrCat(DataTypeString(tensor_.dtype()), "/",
                            tensor_.shape().DebugString());
@@ -107,6 +145,36 @@ class Var : public ResourceBase {
   mutex mu_;
   Tensor tensor_;
 
+  // The rows written since the last Take(), initially all of them.
+  class DirtyRows {
+   public:
+    void Mark(int64_t row);
+    void MarkAll();
+    // Returns the dirty rows of the first `num_rows` in increasing order, or
+    // sets `*all_rows` if all are dirty, and clears them.
+    std::vector<int64_t> Take(int64_t num_rows, bool* all_rows);
+
+   private:
+    bool all_rows_dirty_ = true;
+    std::vector<bool> dirty_rows_;
+  };
+
+  static std::atomic<bool> dirty_rows_tracked_;
+  // Whether the rows are tracked for delta checkpoints, resp. for the read
+  // snapshot.
+  std::atomic<bool> track_dirty_rows_{false};
+  std::atomic<bool> track_snapshot_rows_{false};
+  mutex dirty_rows_mu_;
+  DirtyRows checkpoint_rows_ TF_GUARDED_BY(dirty_rows_mu_);
+  DirtyRows snapshot_rows_ TF_GUARDED_BY(dirty_rows_mu_);
+
+  mutex read_snapshot_mu_;
+  Tensor read_snapshot_ TF_GUARDED_BY(read_snapshot_mu_);
+  // The buffer of `tensor_` that `read_snapshot_` is a copy of, since the
+  // writers replacing the buffer may not mark its rows.
+  const void* read_snapshot_source_ TF_GUARDED_BY(read_snapshot_mu_) =
+      nullptr;
+
   ~Var() override {}
   TF_DISALLOW_COPY_AND_ASSIGN(Var);
 };
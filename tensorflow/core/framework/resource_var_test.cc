@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/framework/resource_var.h"
 
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
 
@@ -34,5 +37,66 @@ TEST(ResourceVarTest, Uninitialize) {
   EXPECT_FALSE(var->is_initialized);
   EXPECT_TRUE(var->tensor()->data() == nullptr);
 }
+
+TEST(ResourceVarTest, TracksDirtyRows) {
+  RefCountPtr<Var> var{new Var(DT_FLOAT)};
+  Tensor indices(DT_INT64, TensorShape({3}));
+  indices.vec<int64_t>()(0) = 7;
+  indices.vec<int64_t>()(1) = 2;
+  indices.vec<int64_t>()(2) = 7;
+
+  // All rows are dirty until tracking starts.
+  var->MarkRowsDirty(indices);
+  EXPECT_THAT(var->TakeDirtyRows(4), ::testing::ElementsAre(0, 1, 2, 3));
+  EXPECT_TRUE(Var::DirtyRowsTracked());
+  EXPECT_TRUE(var->TakeDirtyRows(4).empty());
+
+  var->MarkRowsDirty(indices);
+  EXPECT_THAT(var->TakeDirtyRows(10), ::testing::ElementsAre(2, 7));
+  // Rows past `num_rows` are dropped.
+  var->MarkRowsDirty(indices);
+  EXPECT_THAT(var->TakeDirtyRows(5), ::testing::ElementsAre(2));
+
+  var->MarkRowsDirty(indices);
+  var->MarkAllRowsDirty();
+  EXPECT_THAT(var->TakeDirtyRows(3), ::testing::ElementsAre(0, 1, 2));
+}
+
+TEST(ResourceVarTest, ReadSnapshotCopiesWrittenRows) {
+  RefCountPtr<Var> var{new Var(DT_FLOAT)};
+  *var->tensor() = test::AsTensor<float>({1, 2, 3, 4, 5, 6}, {3, 2});
+  var->is_initialized = true;
+  var->copy_on_read_mode.store(true);
+  auto matrix = var->tensor()->matrix<float>();
+
+  Tensor first;
+  TF_ASSERT_OK(var->ReadSnapshot(cpu_allocator(), &first));
+  EXPECT_NE(first.data(), var->tensor()->data());
+  test::ExpectTensorEqual<float>(*var->tensor(), first);
+  const void* first_buffer = first.data();
+  first = Tensor();
+
+  // Only the rows marked dirty are copied to the snapshot.
+  matrix(1, 0) = 30;
+  matrix(2, 1) = 60;
+  var->MarkRowsDirty(test::AsTensor<int64_t>({1}));
+  Tensor second;
+  TF_ASSERT_OK(var->ReadSnapshot(cpu_allocator(), &second));
+  EXPECT_EQ(second.data(), first_buffer);
+  test::ExpectTensorEqual<float>(
+      second, test::AsTensor<float>({1, 2, 30, 4, 5, 6}, {3, 2}));
+
+  // An aliased snapshot isn't modified.
+  var->MarkAllRowsDirty();
+  Tensor third;
+  TF_ASSERT_OK(var->ReadSnapshot(cpu_allocator(), &third));
+  EXPECT_NE(third.data(), second.data());
+  test::ExpectTensorEqual<float>(*var->tensor(), third);
+  test::ExpectTensorEqual<float>(
+      second, test::AsTensor<float>({1, 2, 30, 4, 5, 6}, {3, 2}));
+
+  var->ReleaseReadSnapshot();
+  test::ExpectTensorEqual<float>(*var->tensor(), third);
+}
 }  // namespace core
 }  // namespace tensorflow
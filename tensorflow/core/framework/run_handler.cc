@@ -19,8 +19,10 @@ limitations under the License.
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <list>
 #include <memory>
+#include <utility>
 
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/run_handler_util.h"
@@ -28,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/context.h"
 #include "tensorflow/core/platform/denormal.h"
+#include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/setround.h"
@@ -41,6 +44,16 @@ namespace {
 static constexpr int32_t kMaxConcurrentHandlers = 128;
 // LINT.ThenChange(//tensorflow/core/framework/run_handler_test.cc)
 
+// The deadline of the requests without a timeout.
+static constexpr uint64 kNoDeadline = std::numeric_limits<uint64>::max();
+
+// The number of requests that must have completed before their run times are
+// used to shed the requests unlikely to meet their deadline.
+static constexpr int64_t kMinCompletedRequestsForShedding = 100;
+
+// The payload key marking the statuses of the shed requests.
+constexpr char kRunHandlerShedPayloadKey[] = "tensorflow.RunHandlerShed";
+
 typedef typename internal::RunHandlerEnvironment::Task Task;
 typedef Eigen::RunQueue<Task, 1024> Queue;
 
@@ -740,7 +753,7 @@ class RunHandler::Impl {
   void ScheduleInterOpClosure(std::function<void()> fn);
   void ScheduleIntraOpClosure(std::function<void()> fn);
 
-  void Reset(int64_t step_id,
+  void Reset(int64_t step_id, uint64 deadline_us,
              const RunOptions::Experimental::RunHandlerPoolOptions& options);
 
   RunHandlerPool::Impl* pool_impl() { return pool_impl_; }
@@ -749,6 +762,10 @@ class RunHandler::Impl {
 
   int64_t priority() { return options_.priority(); }
 
+  // Time in microseconds since unix epoch by which the request should be done,
+  // or kNoDeadline.
+  uint64 deadline_us() const { return deadline_us_; }
+
  private:
   class ThreadPoolInterfaceWrapper : public thread::ThreadPoolInterface {
    public:
@@ -765,6 +782,7 @@ class RunHandler::Impl {
 
   RunHandlerPool::Impl* pool_impl_;  // NOT OWNED.
   uint64 start_time_us_;
+  uint64 deadline_us_;
   int64_t step_id_;
   std::unique_ptr<thread::ThreadPoolInterface> thread_pool_interface_;
   internal::ThreadWorkSource tws_;
@@ -776,8 +794,9 @@ class RunHandler::Impl {
 // This class is thread safe.
 class RunHandlerPool::Impl {
  public:
-  explicit Impl(int num_inter_op_threads, int num_intra_op_threads)
-      : max_handlers_(static_cast<int32>(ParamFromEnvWithDefault(
+  Impl(int num_inter_op_threads, int num_intra_op_threads, Env* env)
+      : env_(env),
+        max_handlers_(static_cast<int32>(ParamFromEnvWithDefault(
             "TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS", kMaxConcurrentHandlers))),
         waiters_mu_(
             ParamFromEnvWithDefault("TF_RUN_HANDLER_NUM_SUB_THREAD_POOL", 2)),
@@ -826,14 +845,16 @@ class RunHandlerPool::Impl {
     return run_handler_thread_pool_.get();
   }
 
+  // The clock of the start times and deadlines of the requests.
+  Env* env() const { return env_; }
+
   bool has_free_handler() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
     return !free_handlers_.empty();
   }
 
-  std::unique_ptr<RunHandler> Get(
-      int64_t step_id, int64_t timeout_in_ms,
-      const RunOptions::Experimental::RunHandlerPoolOptions& options)
-      TF_LOCKS_EXCLUDED(mu_) {
+  Status Get(int64_t step_id, int64_t timeout_in_ms,
+             const RunOptions::Experimental::RunHandlerPoolOptions& options,
+             std::unique_ptr<RunHandler>* handler) TF_LOCKS_EXCLUDED(mu_) {
     thread_local std::unique_ptr<
         Eigen::MaxSizeVector<internal::ThreadWorkSource*>>
         thread_work_sources =
@@ -845,6 +866,9 @@ class RunHandlerPool::Impl {
     uint64 version;
     int num_active_requests;
     RunHandler::Impl* handler_impl;
+    const uint64 deadline_us =
+        timeout_in_ms > 0 ? env_->NowMicros() + timeout_in_ms * 1000
+                          : kNoDeadline;
     {
       mutex_lock l(mu_);
       if (!has_free_handler()) {
@@ -860,16 +884,43 @@ class RunHandlerPool::Impl {
                             timeout_in_ms));
         if (timeout_in_ms == 0) {
           mu_.Await(Condition(this, &Impl::has_free_handler));
-        } else if (!mu_.AwaitWithDeadline(
-                       Condition(this, &Impl::has_free_handler),
-                       EnvTime::NowNanos() + timeout_in_ms * 1000 * 1000)) {
-          return nullptr;
+        }
+        // The deadline is on the clock of `env_`, which may not be the one of
+        // the mutex, so it is checked again after each wait.
+        while (!has_free_handler()) {
+          const uint64 now_us = env_->NowMicros();
+          if (deadline_us == kNoDeadline || now_us >= deadline_us) {
+            return errors::DeadlineExceeded(
+                "Could not obtain RunHandler for request after waiting for ",
+                timeout_in_ms, "ms.");
+          }
+          mu_.AwaitWithDeadline(Condition(this, &Impl::has_free_handler),
+                                EnvTime::NowNanos() +
+                                    (deadline_us - now_us) * 1000);
         }
       }
-      // Remove the last entry from free_handlers_ and add to the end of
-      // sorted_active_handlers_.
+      if (options.shed_requests_unlikely_to_meet_deadline() &&
+          deadline_us != kNoDeadline &&
+          num_completed_requests_ >= kMinCompletedRequestsForShedding) {
+        const uint64 now_us = env_->NowMicros();
+        const double remaining_ms =
+            now_us < deadline_us ? (deadline_us - now_us) / 1000.0 : 0.0;
+        const double median_ms = time_hist_.Median();
+        if (remaining_ms < median_ms) {
+          Status status = errors::Unavailable(
+              "RunHandler request with step_id=", step_id,
+              " was shed: it has ", remaining_ms,
+              "ms left before its deadline, but requests take ", median_ms,
+              "ms at the median.");
+          status.SetPayload(kRunHandlerShedPayloadKey, "");
+          return status;
+        }
+      }
+      // Remove the last entry from free_handlers_ and insert it in
+      // sorted_active_handlers_ before the handlers with a lower priority, or
+      // the same priority and a later deadline.
       handler_impl = free_handlers_.back();
-      handler_impl->Reset(step_id, options);
+      handler_impl->Reset(step_id, deadline_us, options);
       free_handlers_.pop_back();
 
       num_active_requests = sorted_active_handlers_.size() + 1;
@@ -878,8 +929,11 @@ class RunHandlerPool::Impl {
       auto it = sorted_active_handlers_.cbegin();
       bool new_handler_inserted = false;
       for (int i = 0; i < num_active_requests; ++i) {
-        if (!new_handler_inserted && (it == sorted_active_handlers_.cend() ||
-                                      priority > (*it)->priority())) {
+        if (!new_handler_inserted &&
+            (it == sorted_active_handlers_.cend() ||
+             priority > (*it)->priority() ||
+             (priority == (*it)->priority() &&
+              deadline_us < (*it)->deadline_us()))) {
           sorted_active_handlers_.insert(it, handler_impl);
           new_handler_inserted = true;
           // Point to the newly added handler.
@@ -891,7 +945,8 @@ class RunHandlerPool::Impl {
       version = ++version_;
     }
     RecomputePoolStats(num_active_requests, version, *thread_work_sources);
-    return WrapUnique<RunHandler>(new RunHandler(handler_impl));
+    *handler = WrapUnique<RunHandler>(new RunHandler(handler_impl));
+    return OkStatus();
   }
 
   void ReleaseHandler(RunHandler::Impl* handler) TF_LOCKS_EXCLUDED(mu_) {
@@ -901,9 +956,10 @@ class RunHandlerPool::Impl {
     CHECK_EQ(handler->tws()->TaskQueueSize(true), 0);   // Crash OK.
     CHECK_EQ(handler->tws()->TaskQueueSize(false), 0);  // Crash OK.
 
-    uint64 now = tensorflow::EnvTime::NowMicros();
+    uint64 now = env_->NowMicros();
     double elapsed = (now - handler->start_time_us()) / 1000.0;
     time_hist_.Add(elapsed);
+    ++num_completed_requests_;
 
     // Erase from and update sorted_active_handlers_. Add it to the end of
     // free_handlers_.
@@ -935,6 +991,16 @@ class RunHandlerPool::Impl {
     return ret;
   }
 
+  std::vector<int64_t> GetActiveHandlerStepIdsForTesting()
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    std::vector<int64_t> ret;
+    for (const auto& handler_impl : sorted_active_handlers_) {
+      ret.push_back(handler_impl->step_id());
+    }
+    return ret;
+  }
+
  private:
   void RecomputePoolStats(
       int num_active_requests, uint64 version,
@@ -943,6 +1009,8 @@ class RunHandlerPool::Impl {
 
   void LogInfo() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  Env* const env_;  // Not owned.
+
   // Maximum number of handlers pre-created during pool construction time. The
   // number has been chosen expecting each handler might at least want 1
   // inter-op thread for execution (during compute intensive workloads like
@@ -954,8 +1022,7 @@ class RunHandlerPool::Impl {
 
   std::unique_ptr<internal::RunHandlerThreadPool> run_handler_thread_pool_;
   // Thread compatible part used only by lock under RunHandlerPool.
-  // Handlers are sorted by start time.
-  // TODO(azaks): sort by the remaining latency budget.
+  // Handlers are sorted by priority, then deadline, then start time.
   // TODO(chaox): Consider other data structure for maintaining the sorted
   // active handlers if the searching overhead(currently O(n)) becomes the
   // bottleneck.
@@ -965,6 +1032,8 @@ class RunHandlerPool::Impl {
 
   // Histogram of elapsed runtime of every handler (in ms).
   histogram::Histogram time_hist_ TF_GUARDED_BY(mu_);
+  // The number of values in `time_hist_`.
+  int64_t num_completed_requests_ TF_GUARDED_BY(mu_) = 0;
 
   int64_t iterations_ TF_GUARDED_BY(mu_);
   mutex mu_;
@@ -1021,7 +1090,7 @@ void RunHandlerPool::Impl::LogInfo() {
     int num_active_requests = sorted_active_handlers_.size();
     VLOG(1) << "Printing time histogram: " << time_hist_.ToString();
     VLOG(1) << "Active session runs: " << num_active_requests;
-    uint64 now = tensorflow::Env::Default()->NowMicros();
+    uint64 now = env_->NowMicros();
     string times_str = "";
     string ids_str = "";
     auto it = sorted_active_handlers_.cbegin();
@@ -1060,7 +1129,7 @@ void RunHandler::Impl::ThreadPoolInterfaceWrapper::Schedule(
 RunHandler::Impl::Impl(RunHandlerPool::Impl* pool_impl)
     : pool_impl_(pool_impl) {
   thread_pool_interface_.reset(new ThreadPoolInterfaceWrapper(this));
-  Reset(0, RunOptions::Experimental::RunHandlerPoolOptions());
+  Reset(0, kNoDeadline, RunOptions::Experimental::RunHandlerPoolOptions());
 }
 
 void RunHandler::Impl::ScheduleInterOpClosure(std::function<void()> fn) {
@@ -1076,27 +1145,47 @@ void RunHandler::Impl::ScheduleIntraOpClosure(std::function<void()> fn) {
 }
 
 void RunHandler::Impl::Reset(
-    int64_t step_id,
+    int64_t step_id, uint64 deadline_us,
     const RunOptions::Experimental::RunHandlerPoolOptions& options) {
-  start_time_us_ = tensorflow::Env::Default()->NowMicros();
+  start_time_us_ = pool_impl_->env()->NowMicros();
+  deadline_us_ = deadline_us;
   step_id_ = step_id;
   options_ = options;
   tws_.SetTracemeId(step_id);
 }
 
 RunHandlerPool::RunHandlerPool(int num_inter_op_threads)
-    : impl_(new Impl(num_inter_op_threads, 0)) {}
+    : RunHandlerPool(num_inter_op_threads, 0) {}
 
 RunHandlerPool::RunHandlerPool(int num_inter_op_threads,
                                int num_intra_op_threads)
-    : impl_(new Impl(num_inter_op_threads, num_intra_op_threads)) {}
+    : RunHandlerPool(num_inter_op_threads, num_intra_op_threads,
+                     Env::Default()) {}
+
+RunHandlerPool::RunHandlerPool(int num_inter_op_threads,
+                               int num_intra_op_threads, Env* env)
+    : impl_(new Impl(num_inter_op_threads, num_intra_op_threads, env)) {}
 
 RunHandlerPool::~RunHandlerPool() {}
 
 std::unique_ptr<RunHandler> RunHandlerPool::Get(
     int64_t step_id, int64_t timeout_in_ms,
     const RunOptions::Experimental::RunHandlerPoolOptions& options) {
-  return impl_->Get(step_id, timeout_in_ms, options);
+  std::unique_ptr<RunHandler> handler;
+  impl_->Get(step_id, timeout_in_ms, options, &handler).IgnoreError();
+  return handler;
+}
+
+Status RunHandlerPool::Get(
+    int64_t step_id, int64_t timeout_in_ms,
+    const RunOptions::Experimental::RunHandlerPoolOptions& options,
+    std::unique_ptr<RunHandler>* handler) {
+  return impl_->Get(step_id, timeout_in_ms, options, handler);
+}
+
+bool IsRunHandlerShed(const Status& status) {
+  return errors::IsUnavailable(status) &&
+         status.GetPayload(kRunHandlerShedPayloadKey).has_value();
 }
 
 std::vector<int64_t> RunHandlerPool::GetActiveHandlerPrioritiesForTesting()
@@ -1104,6 +1193,11 @@ std::vector<int64_t> RunHandlerPool::GetActiveHandlerPrioritiesForTesting()
   return impl_->GetActiveHandlerPrioritiesForTesting();
 }
 
+std::vector<int64_t> RunHandlerPool::GetActiveHandlerStepIdsForTesting()
+    const {
+  return impl_->GetActiveHandlerStepIdsForTesting();
+}
+
 RunHandler::RunHandler(Impl* impl) : impl_(impl) {}
 
 void RunHandler::ScheduleInterOpClosure(std::function<void()> fn) {
@@ -53,6 +53,9 @@ class RunHandlerPool {
   explicit RunHandlerPool(int num_inter_op_threads);
 
   RunHandlerPool(int num_inter_op_threads, int num_intra_op_threads);
+  // `env` is the clock of the deadlines and run times of the requests, and
+  // must outlive the pool.
+  RunHandlerPool(int num_inter_op_threads, int num_intra_op_threads, Env* env);
   ~RunHandlerPool();
 
   // Returns an inactive RunHandler from the pool.
@@ -68,10 +71,25 @@ class RunHandlerPool {
       const RunOptions::Experimental::RunHandlerPoolOptions& options =
           RunOptions::Experimental::RunHandlerPoolOptions());
 
+  // Like Get(), but returns an error instead of a null handler. If
+  // `timeout_in_ms` is positive, it is also the deadline of the request:
+  // within a priority, the inter-op work of the requests with the earliest
+  // deadlines is preferred. If `shed_requests_unlikely_to_meet_deadline` is set
+  // in `options`, requests whose remaining time is less than the median run
+  // time of the requests of the pool so far are shed with an error for which
+  // IsRunHandlerShed() holds, rather than slowing down the other requests.
+  Status Get(int64_t step_id, int64_t timeout_in_ms,
+             const RunOptions::Experimental::RunHandlerPoolOptions& options,
+             std::unique_ptr<RunHandler>* handler);
+
   // Get the priorities for active handlers. The return result is with the same
   // order of the active handler list.
   std::vector<int64_t> GetActiveHandlerPrioritiesForTesting() const;
 
+  // Get the step ids of the active handlers, in the order of the active
+  // handler list.
+  std::vector<int64_t> GetActiveHandlerStepIdsForTesting() const;
+
  private:
   class Impl;
   friend class RunHandler;
@@ -79,10 +97,14 @@ class RunHandlerPool {
   std::unique_ptr<Impl> impl_;
 };
 
+// Returns true if `status` was returned by RunHandlerPool::Get() for a request
+// that was shed because it was unlikely to meet its deadline.
+bool IsRunHandlerShed(const Status& status);
+
 // RunHandler can be used to schedule inter/intra-op closures to run on a global
 // pool shared across all Session::Run(s). The closures are enqueued to a
 // handler specific queue, from which the work is stolen in a priority order
-// (time of the Get() call).
+// (priority of the request, then deadline, then time of the Get() call).
 //
 // It can only be created via RunHandlerPool::Get().
 //
@@ -28,13 +28,17 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/fake_clock_env.h"
 
 namespace tensorflow {
 namespace {
@@ -113,6 +117,87 @@ TEST(RunHandlerUtilTest, PrioritySchedulingTest) {
   EXPECT_EQ(sorted_active_list[3], 1);
 }
 
+TEST(RunHandlerUtilTest, PriorityTakesPrecedenceOverDeadline) {
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(2, 2));
+
+  RunOptions::Experimental::RunHandlerPoolOptions options;
+  std::unique_ptr<RunHandler> handler1, handler2, handler3;
+  options.set_priority(1);
+  TF_ASSERT_OK(pool->Get(/*step_id=*/1, /*timeout_in_ms=*/10, options,
+                         &handler1));
+  options.set_priority(2);
+  TF_ASSERT_OK(pool->Get(/*step_id=*/2, /*timeout_in_ms=*/100000, options,
+                         &handler2));
+  options.set_priority(1);
+  TF_ASSERT_OK(pool->Get(/*step_id=*/3, /*timeout_in_ms=*/0, options,
+                         &handler3));
+
+  // The priority is compared before the deadline.
+  std::vector<int64_t> sorted_active_list =
+      pool->GetActiveHandlerPrioritiesForTesting();
+  ASSERT_EQ(sorted_active_list.size(), 3);
+  EXPECT_EQ(sorted_active_list[0], 2);
+  EXPECT_EQ(sorted_active_list[1], 1);
+  EXPECT_EQ(sorted_active_list[2], 1);
+}
+
+TEST(RunHandlerUtilTest, EarliestDeadlineFirstWithinPriority) {
+  FakeClockEnv env(Env::Default());
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(2, 2, &env));
+
+  RunOptions::Experimental::RunHandlerPoolOptions options;
+  std::vector<std::unique_ptr<RunHandler>> handlers(6);
+  TF_ASSERT_OK(pool->Get(/*step_id=*/1, /*timeout_in_ms=*/1000, options,
+                         &handlers[0]));
+  TF_ASSERT_OK(pool->Get(/*step_id=*/2, /*timeout_in_ms=*/100, options,
+                         &handlers[1]));
+  env.AdvanceByMicroseconds(500 * 1000);
+  TF_ASSERT_OK(pool->Get(/*step_id=*/3, /*timeout_in_ms=*/1000, options,
+                         &handlers[2]));
+  TF_ASSERT_OK(pool->Get(/*step_id=*/4, /*timeout_in_ms=*/0, options,
+                         &handlers[3]));
+  TF_ASSERT_OK(pool->Get(/*step_id=*/5, /*timeout_in_ms=*/200, options,
+                         &handlers[4]));
+  TF_ASSERT_OK(pool->Get(/*step_id=*/6, /*timeout_in_ms=*/0, options,
+                         &handlers[5]));
+
+  // The deadlines are 1000ms, 100ms, 1500ms, none, 700ms and none. The
+  // requests without a deadline keep their arrival order.
+  EXPECT_EQ(pool->GetActiveHandlerStepIdsForTesting(),
+            std::vector<int64_t>({2, 5, 1, 3, 4, 6}));
+}
+
+TEST(RunHandlerUtilTest, ShedRequestsUnlikelyToMeetDeadline) {
+  FakeClockEnv env(Env::Default());
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(1, 1, &env));
+
+  RunOptions::Experimental::RunHandlerPoolOptions options;
+  options.set_shed_requests_unlikely_to_meet_deadline(true);
+  std::unique_ptr<RunHandler> handler;
+  // Requests are not shed before enough of them have completed, even if they
+  // take twice their timeout.
+  for (int i = 0; i < 100; ++i) {
+    TF_ASSERT_OK(pool->Get(i, /*timeout_in_ms=*/1000, options, &handler));
+    env.AdvanceByMicroseconds(2000000);
+    handler.reset();
+  }
+
+  // The requests take 2s at the median.
+  Status s = pool->Get(100, /*timeout_in_ms=*/1000, options, &handler);
+  EXPECT_TRUE(IsRunHandlerShed(s)) << s;
+  EXPECT_EQ(handler.get(), nullptr);
+
+  // Requests with enough time left, or without a deadline, are admitted.
+  TF_ASSERT_OK(pool->Get(101, /*timeout_in_ms=*/100000, options, &handler));
+  handler.reset();
+  TF_ASSERT_OK(pool->Get(102, /*timeout_in_ms=*/0, options, &handler));
+  handler.reset();
+
+  // Shedding is opt-in.
+  options.set_shed_requests_unlikely_to_meet_deadline(false);
+  TF_ASSERT_OK(pool->Get(103, /*timeout_in_ms=*/1000, options, &handler));
+}
+
 TEST(RunHandlerThreadPool, EnqueueTask) {
   Eigen::MaxSizeVector<mutex> waiters_mu(2);
   waiters_mu.resize(2);
@@ -794,6 +879,12 @@ TEST_F(RunHandlerTest, TestWaitTimeout) {
   // nullptr.
   auto null_handle = pool->Get(128, 1);
   EXPECT_EQ(null_handle.get(), nullptr);
+  std::unique_ptr<RunHandler> handle;
+  Status s = pool->Get(128, 1,
+                       RunOptions::Experimental::RunHandlerPoolOptions(),
+                       &handle);
+  EXPECT_TRUE(errors::IsDeadlineExceeded(s)) << s;
+  EXPECT_FALSE(IsRunHandlerShed(s));
 
   // A subsequent request with no timeout will succeed once the blocking handle
   // is returned.
@@ -811,5 +902,36 @@ TEST_F(RunHandlerTest, TestWaitTimeout) {
   EXPECT_NE(next_handle.get(), nullptr);
 }
 
+TEST_F(RunHandlerTest, TestWaitTimeoutOnTheClockOfThePool) {
+  FakeClockEnv env(Env::Default());
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(1, 1, &env));
+
+  std::vector<std::unique_ptr<RunHandler>> blocking_handles;
+  const int32_t kMaxConcurrentHandlers = 128;  // Copied from run_handler.cc.
+  blocking_handles.reserve(kMaxConcurrentHandlers);
+  for (int i = 0; i < kMaxConcurrentHandlers; ++i) {
+    blocking_handles.push_back(pool->Get(i));
+  }
+
+  // The request only times out once the clock of the pool passes its
+  // deadline.
+  auto tp = std::make_unique<thread::ThreadPool>(Env::Default(), "test", 1);
+  Notification done;
+  Status s;
+  tp->Schedule([&pool, &done, &s]() {
+    std::unique_ptr<RunHandler> handle;
+    s = pool->Get(128, /*timeout_in_ms=*/10,
+                  RunOptions::Experimental::RunHandlerPoolOptions(), &handle);
+    done.Notify();
+  });
+  // The timeout has passed on the real clock only.
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  EXPECT_FALSE(done.HasBeenNotified());
+  while (!WaitForNotificationWithTimeout(&done, 10 * 1000)) {
+    env.AdvanceByMicroseconds(1000 * 1000);
+  }
+  EXPECT_TRUE(errors::IsDeadlineExceeded(s)) << s;
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -15,12 +15,130 @@ limitations under the License.
 
 #include "tensorflow/core/framework/variant.h"
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/variant_encode_decode.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
 
 namespace tensorflow {
 
+namespace variant_internal {
+namespace {
+
+// The heap values are rounded up to a multiple of kSizeClassBytes, and up to
+// kMaxCachedBlocks blocks of each of the kNumSizeClasses smallest sizes are
+// cached per thread.
+constexpr size_t kSizeClassBytes = 64;
+constexpr int kNumSizeClasses = 8;
+constexpr int kMaxCachedBlocks = 32;
+
+std::atomic<int64_t> num_allocated_blocks{0};
+std::atomic<int64_t> num_freed_blocks{0};
+
+int SizeClass(size_t size) {
+  return size == 0 ? 0 : static_cast<int>((size - 1) / kSizeClassBytes);
+}
+
+size_t BlockBytes(int size_class) {
+  return (size_class + 1) * kSizeClassBytes;
+}
+
+void* AllocateBlock(size_t bytes) {
+  num_allocated_blocks.fetch_add(1, std::memory_order_relaxed);
+  return ::operator new(bytes);
+}
+
+void FreeBlock(void* ptr, size_t bytes) {
+  num_freed_blocks.fetch_add(1, std::memory_order_relaxed);
+  ::operator delete(ptr, bytes);
+}
+
+// Set when the cache of the thread is destroyed. The values freed afterwards,
+// e.g. by the destructors of other thread-locals, bypass the cache.
+thread_local bool cache_destroyed = false;
+
+class HeapValueCache {
+ public:
+  HeapValueCache() = default;
+  HeapValueCache(const HeapValueCache&) = delete;
+  HeapValueCache& operator=(const HeapValueCache&) = delete;
+
+  ~HeapValueCache() {
+    cache_destroyed = true;
+    for (int size_class = 0; size_class < kNumSizeClasses; ++size_class) {
+      while (void* ptr = Pop(size_class)) {
+        FreeBlock(ptr, BlockBytes(size_class));
+      }
+    }
+  }
+
+  void* Pop(int size_class) {
+    CachedBlock* block = free_blocks_[size_class];
+    if (block == nullptr) return nullptr;
+    free_blocks_[size_class] = block->next;
+    --num_free_blocks_[size_class];
+    return block;
+  }
+
+  // Returns false if the cache is full.
+  bool Push(int size_class, void* ptr) {
+    if (num_free_blocks_[size_class] == kMaxCachedBlocks) return false;
+    CachedBlock* block = static_cast<CachedBlock*>(ptr);
+    block->next = free_blocks_[size_class];
+    free_blocks_[size_class] = block;
+    ++num_free_blocks_[size_class];
+    return true;
+  }
+
+ private:
+  struct CachedBlock {
+    CachedBlock* next;
+  };
+
+  CachedBlock* free_blocks_[kNumSizeClasses] = {};
+  int num_free_blocks_[kNumSizeClasses] = {};
+};
+
+HeapValueCache* ThreadCache() {
+  if (cache_destroyed) return nullptr;
+  thread_local HeapValueCache cache;
+  return &cache;
+}
+
+}  // namespace
+
+void* AllocateHeapValue(size_t size) {
+  const int size_class = SizeClass(size);
+  if (size_class >= kNumSizeClasses) return AllocateBlock(size);
+  if (HeapValueCache* cache = ThreadCache()) {
+    if (void* ptr = cache->Pop(size_class)) return ptr;
+  }
+  return AllocateBlock(BlockBytes(size_class));
+}
+
+void FreeHeapValue(void* ptr, size_t size) {
+  const int size_class = SizeClass(size);
+  if (size_class >= kNumSizeClasses) return FreeBlock(ptr, size);
+  HeapValueCache* cache = ThreadCache();
+  if (cache == nullptr || !cache->Push(size_class, ptr)) {
+    FreeBlock(ptr, BlockBytes(size_class));
+  }
+}
+
+HeapValueStats GetHeapValueStats() {
+  HeapValueStats stats;
+  stats.num_allocated_blocks =
+      num_allocated_blocks.load(std::memory_order_relaxed);
+  stats.num_freed_blocks = num_freed_blocks.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace variant_internal
+
 Variant::~Variant() { ResetMemory(); }
 
 bool Variant::Decode(VariantTensorData data) {
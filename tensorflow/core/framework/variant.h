@@ -16,9 +16,12 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_VARIANT_H_
 #define TENSORFLOW_CORE_FRAMEWORK_VARIANT_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <new>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -37,6 +40,25 @@ std::string TypeNameVariant(const T& value);
 template <typename T>
 std::string DebugStringVariant(const T& value);
 
+namespace variant_internal {
+
+// Allocate and free the memory of the values too large to be stored inline in
+// a Variant, e.g. a RaggedTensorVariant. Loops over TensorLists and ragged
+// tensors create and destroy such values at a high rate, so the small blocks
+// are recycled by a per-thread cache instead of going to the system allocator.
+void* AllocateHeapValue(size_t size);
+void FreeHeapValue(void* ptr, size_t size);
+
+struct HeapValueStats {
+  // The numbers of blocks obtained from, resp. returned to, the system
+  // allocator, over all the threads.
+  int64_t num_allocated_blocks = 0;
+  int64_t num_freed_blocks = 0;
+};
+HeapValueStats GetHeapValueStats();
+
+}  // namespace variant_internal
+
 // Allows for specializations of Variant Decoding.  `data` may be modified in
 // the process of decoding to `value`.
 template <typename T>
@@ -334,6 +356,25 @@ class Variant {
     // build `alignof(Variant<void*>)`.
     ~Value() final = default;
 
+    // The values stored on the heap use the recycling allocator, except the
+    // overaligned ones. The inline values are constructed in place.
+    static void* operator new(size_t size) {
+      return variant_internal::AllocateHeapValue(size);
+    }
+    static void* operator new(size_t size, std::align_val_t alignment) {
+      return ::operator new(size, alignment);
+    }
+    static void* operator new(size_t /*size*/, void* ptr) noexcept {
+      return ptr;
+    }
+    static void operator delete(void* ptr, size_t size) {
+      variant_internal::FreeHeapValue(ptr, size);
+    }
+    static void operator delete(void* ptr, size_t size,
+                                std::align_val_t alignment) {
+      ::operator delete(ptr, size, alignment);
+    }
+
     TypeIndex TypeId() const final {
       const TypeIndex value_type_index =
           TypeIndex::Make<typename std::decay<T>::type>();
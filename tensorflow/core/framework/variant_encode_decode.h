@@ -95,7 +95,7 @@ bool DecodeVariantImpl(VariantTensorData data,
                        TypeResolver<T, false /* is_pod */, true /* Tensor */,
                                     false /* protobuf */>,
                        T* value) {
-  *value = data.tensors(0);
+  *value = std::move((*data.mutable_tensors())[0]);
   return true;
 }
 
@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/framework/variant_tensor_data.h"
+
+#include <utility>
+
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/lib/strings/strcat.h"
@@ -34,6 +37,8 @@ const std::vector<Tensor>& VariantTensorData::tensors() const {
   return tensors_;
 }
 
+std::vector<Tensor>* VariantTensorData::mutable_tensors() { return &tensors_; }
+
 Tensor* VariantTensorData::add_tensors() {
   tensors_.emplace_back();
   return &(tensors_[tensors_.size() - 1]);
@@ -52,10 +57,11 @@ bool VariantTensorData::FromProto(VariantTensorDataProto proto) {
   // TODO(ebrevdo): Do this lazily.
   set_type_name(proto.type_name());
   set_metadata(proto.metadata());
+  tensors_.reserve(tensors_.size() + proto.tensors_size());
   for (const auto& tensor : proto.tensors()) {
     Tensor tmp;
     if (!tmp.FromProto(tensor)) return false;
-    tensors_.push_back(tmp);
+    tensors_.push_back(std::move(tmp));
   }
   return true;
 }
@@ -63,10 +69,11 @@ bool VariantTensorData::FromProto(VariantTensorDataProto proto) {
 bool VariantTensorData::FromConstProto(const VariantTensorDataProto& proto) {
   set_type_name(proto.type_name());
   set_metadata(proto.metadata());
+  tensors_.reserve(tensors_.size() + proto.tensors_size());
   for (const auto& tensor : proto.tensors()) {
     Tensor tmp;
     if (!tmp.FromProto(tensor)) return false;
-    tensors_.push_back(tmp);
+    tensors_.push_back(std::move(tmp));
   }
   return true;
 }
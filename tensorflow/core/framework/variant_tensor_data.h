@@ -70,6 +70,8 @@ class VariantTensorData {
   int tensors_size() const;
   const Tensor& tensors(int index) const;
   const std::vector<Tensor>& tensors() const;
+  // Allows the decoders to move the tensors out.
+  std::vector<Tensor>* mutable_tensors();
   Tensor* add_tensors();
 
   // A more general version of add_tensors. Parameters are perfectly forwarded
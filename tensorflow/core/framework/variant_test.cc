@@ -444,6 +444,20 @@ TEST(VariantTest, ClearDeletesOnHeap) { TestClearDeletes</*BIG=*/true>(); }
 
 TEST(VariantTest, ClearDeletesOnStack) { TestClearDeletes</*BIG=*/false>(); }
 
+TEST(VariantTest, HeapValuesAreRecycled) {
+  const variant_internal::HeapValueStats before =
+      variant_internal::GetHeapValueStats();
+  for (int i = 0; i < 1000; ++i) {
+    Variant x = Int<true>{i};
+    Variant y = x;
+    EXPECT_EQ(y.get<Int<true>>()->value, i);
+  }
+  const variant_internal::HeapValueStats after =
+      variant_internal::GetHeapValueStats();
+  // Each iteration reuses the blocks of the values of the previous one.
+  EXPECT_LE(after.num_allocated_blocks - before.num_allocated_blocks, 2);
+}
+
 TEST(VariantTest, Tensor) {
   Variant x;
   Tensor t(DT_FLOAT, {});
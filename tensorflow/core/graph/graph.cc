@@ -493,22 +493,23 @@ StatusOr<Node*> Graph::AddNode(NodeDef node_def) {
 }
 
 Node* Graph::AddNode(NodeDef node_def, Status* status) {
+  StatusOr<PreparedNode> prepared = PrepareNode(std::move(node_def));
+  if (!prepared.ok()) {
+    status->Update(prepared.status());
+    return nullptr;
+  }
+  return AddNode(*std::move(prepared));
+}
+
+StatusOr<Graph::PreparedNode> Graph::PrepareNode(NodeDef node_def) const {
   const OpRegistrationData* op_reg_data;
-  status->Update(ops_.LookUp(node_def.op(), &op_reg_data));
-  if (!status->ok()) return nullptr;
+  TF_RETURN_IF_ERROR(ops_.LookUp(node_def.op(), &op_reg_data));
 
   DataTypeVector inputs;
   DataTypeVector outputs;
-  status->Update(
-      InOutTypesForNode(node_def, op_reg_data->op_def, &inputs, &outputs));
-  if (!status->ok()) {
-    *status = AttachDef(*status, node_def);
-    return nullptr;
-  }
-
-  Node::NodeClass node_class = op_reg_data->is_function_op
-                                   ? Node::NC_FUNCTION_OP
-                                   : Node::GetNodeClassForOp(node_def.op());
+  Status status =
+      InOutTypesForNode(node_def, op_reg_data->op_def, &inputs, &outputs);
+  if (!status.ok()) return AttachDef(status, node_def);
 
   if (node_def.has_experimental_type()) {
     VLOG(3) << "AddNode: node has type set, skipping type constructor "
@@ -520,21 +521,29 @@ Node* Graph::AddNode(NodeDef node_def, Status* status) {
           full_type::SpecializeType(AttrSlice(node_def), op_reg_data->op_def,
                                     *(node_def.mutable_experimental_type()));
       if (!s.ok()) {
-        *status = errors::InvalidArgument("type error: ", s.ToString());
         VLOG(3) << "AddNode: type inference failed for " << node_def.name()
                 << ": " << s;
-        return nullptr;
+        return errors::InvalidArgument("type error: ", s.ToString());
       }
     } else {
       VLOG(3) << "AddNode: no type constructor for " << node_def.name();
     }
   }
 
-  Node* node = AllocateNode(
-      std::make_shared<NodeProperties>(&op_reg_data->op_def,
-                                       std::move(node_def), inputs, outputs),
-      nullptr, node_class);
-  return node;
+  PreparedNode prepared;
+  prepared.props = std::make_shared<NodeProperties>(
+      &op_reg_data->op_def, std::move(node_def), std::move(inputs),
+      std::move(outputs));
+  prepared.is_function_op = op_reg_data->is_function_op;
+  return prepared;
+}
+
+Node* Graph::AddNode(PreparedNode prepared) {
+  Node::NodeClass node_class =
+      prepared.is_function_op
+          ? Node::NC_FUNCTION_OP
+          : Node::GetNodeClassForOp(prepared.props->node_def.op());
+  return AllocateNode(std::move(prepared.props), nullptr, node_class);
 }
 
 Node* Graph::CopyNode(const Node* node) {
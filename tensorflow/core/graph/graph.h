@@ -553,6 +553,22 @@ class Graph {
   // Same as above, but using StatusOr. This method is always preferred.
   StatusOr<Node*> AddNode(NodeDef node_def);
 
+  // A node built for a NodeDef by PrepareNode(), but not yet added to the
+  // graph.
+  struct PreparedNode {
+    std::shared_ptr<NodeProperties> props;
+    bool is_function_op = false;
+  };
+
+  // Does the work of AddNode() that doesn't modify the graph: looks up the Op
+  // and infers the input/output and full types of the node. Unlike AddNode(),
+  // this may be called concurrently, so that the nodes of a large graph can be
+  // prepared in parallel and then added in order.
+  StatusOr<PreparedNode> PrepareNode(NodeDef node_def) const;
+
+  // Adds a node prepared by PrepareNode() to this graph, and returns it.
+  Node* AddNode(PreparedNode prepared);
+
   // Copies *node, which may belong to another graph, to a new node,
   // which is returned.  Does not copy any edges.  *this owns the
   // returned instance.
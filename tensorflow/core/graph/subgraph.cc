@@ -222,13 +222,21 @@ Status ArgFeedRewrite::AddNode(Graph* g, NodeBuilder::NodeOut feed_tensor,
   // name, because _Arg is a "stateful" kernel and therefore
   // its name must uniquely identify a kernel instance across all
   // graphs in the same session.
-  TF_RETURN_IF_ERROR(
-      NodeBuilder(strings::StrCat("_arg_", feed_tensor.node->name(), "_",
-                                  feed_tensor.index, "_", arg_index_),
-                  "_Arg")
-          .Attr("T", BaseType(feed_tensor.node->output_type(feed_tensor.index)))
-          .Attr("index", arg_index_)
-          .Finalize(g, out_node, /*consume=*/true));
+  NodeBuilder builder(strings::StrCat("_arg_", feed_tensor.node->name(), "_",
+                                     feed_tensor.index, "_", arg_index_),
+                      "_Arg");
+  builder.Attr("T", BaseType(feed_tensor.node->output_type(feed_tensor.index)))
+      .Attr("index", arg_index_);
+  // Keep the fully defined shape of a fed placeholder, so that the shapes of
+  // its consumers can still be inferred to plan their memory.
+  PartialTensorShape shape;
+  if (keep_placeholder_shape_ &&
+      feed_tensor.node->type_string() == "Placeholder" &&
+      GetNodeAttr(feed_tensor.node->attrs(), "shape", &shape).ok() &&
+      shape.IsFullyDefined()) {
+    builder.Attr("_output_shapes", {shape});
+  }
+  TF_RETURN_IF_ERROR(builder.Finalize(g, out_node, /*consume=*/true));
   (*out_node)->set_assigned_device_name(device_info().name());
   return OkStatus();
 }
@@ -116,17 +116,23 @@ Status RewriteGraphForExecution(
 // Custom rewrite actions for fed and fetched tensors. //
 /////////////////////////////////////////////////////////
 
-// A rewrite action that adds an _Arg node for a fed tensor.
+// A rewrite action that adds an _Arg node for a fed tensor. If
+// `keep_placeholder_shape` is true, the _Arg node replacing a placeholder with
+// a fully defined shape has that shape in its `_output_shapes` attr.
 class ArgFeedRewrite : public PruneRewrite {
  public:
   ArgFeedRewrite(const string* endpoint_name,
-                 const DeviceAttributes* device_info, int32_t arg_index)
-      : PruneRewrite(endpoint_name, device_info), arg_index_(arg_index) {}
+                 const DeviceAttributes* device_info, int32_t arg_index,
+                 bool keep_placeholder_shape = false)
+      : PruneRewrite(endpoint_name, device_info),
+        arg_index_(arg_index),
+        keep_placeholder_shape_(keep_placeholder_shape) {}
   Status AddNode(Graph* g, NodeBuilder::NodeOut feed_tensor,
                  Node** out_node) override;
 
  private:
   const int32 arg_index_;
+  const bool keep_placeholder_shape_;
 };
 
 // A rewrite action that adds a client-terminated _Recv node for a fed tensor.
@@ -16,6 +16,9 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "absl/strings/match.h"
 #include "third_party/eigen3/Eigen/Core"
 #include "tensorflow/core/framework/attr_value.pb.h"
@@ -26,7 +29,10 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/utils.h"
 #include "tensorflow/core/grappler/costs/op_context.h"
 #include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/overflow.h"
 
 namespace tensorflow {
@@ -122,12 +128,32 @@ constexpr char kReadVariablesOp[] = "_ReadVariablesOp";
 constexpr char kAssignVariableOp[] = "AssignVariableOp";
 constexpr char kAssignAddVariableOp[] = "AssignAddVariableOp";
 constexpr char kAssignSubVariableOp[] = "AssignSubVariableOp";
+// The calibration family of the elementwise ops.
+constexpr char kElementwiseFamily[] = "Elementwise";
 
 static const Costs::Duration kMinComputeTime(1);
 static const int64_t kMinComputeOp = 1;
 
 namespace {
 
+// Returns the calibration table of the file named by
+// TF_GRAPPLER_COST_CALIBRATION_FILE, or null if there is none.
+const OpCalibrationTable* CalibrationTableFromEnv() {
+  string path;
+  Status status =
+      ReadStringFromEnvVar("TF_GRAPPLER_COST_CALIBRATION_FILE", "", &path);
+  if (!status.ok() || path.empty()) return nullptr;
+  auto* table = new OpCalibrationTable;
+  status = ReadTextOrBinaryProto(Env::Default(), path, table);
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to read the cost calibration table " << path
+                 << ": " << status;
+    delete table;
+    return nullptr;
+  }
+  return table;
+}
+
 std::string GetDataFormat(const OpInfo& op_info) {
   std::string data_format = "NHWC";  // Default format.
   if (op_info.attr().find("data_format") != op_info.attr().end()) {
@@ -646,6 +672,126 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
 
   // By default, use sum of memory_time and compute_time for execution_time.
   compute_memory_overlap_ = false;
+
+  // The table of the environment is read once per process.
+  static const OpCalibrationTable* const env_calibration_table =
+      CalibrationTableFromEnv();
+  if (env_calibration_table != nullptr) {
+    Status status = SetCalibrationTable(*env_calibration_table);
+    if (!status.ok()) {
+      LOG(WARNING) << "Ignoring the cost calibration table: " << status;
+    }
+  }
+}
+
+Status OpLevelCostEstimator::SetCalibrationTable(
+    const OpCalibrationTable& table) {
+  std::map<string, std::vector<std::pair<int64_t, double>>> calibration;
+  for (const auto& entry : table.entries()) {
+    if (entry.op().empty() || entry.bytes_accessed() < 0 ||
+        entry.execution_time_ns() < 0) {
+      return errors::InvalidArgument("Invalid calibration entry: ",
+                                     entry.ShortDebugString());
+    }
+    calibration[entry.op()].emplace_back(entry.bytes_accessed(),
+                                         entry.execution_time_ns());
+  }
+  for (auto& op_and_points : calibration) {
+    std::sort(op_and_points.second.begin(), op_and_points.second.end());
+  }
+  calibration_ = std::move(calibration);
+  calibration_device_type_ = table.device().type();
+  return OkStatus();
+}
+
+OpCalibrationTable OpLevelCostEstimator::BuildCalibrationTable(
+    const OpPerformanceList& measurements) const {
+  OpCalibrationTable table;
+  if (measurements.op_performance_size() == 0) return table;
+  *table.mutable_device() = measurements.op_performance(0).op().device();
+
+  // The total bytes accessed and execution time of the measurements of each
+  // op, or family, and power of two of bytes accessed.
+  struct Bucket {
+    double bytes_accessed = 0;
+    double execution_time_ns = 0;
+    int count = 0;
+  };
+  std::map<std::pair<string, int>, Bucket> buckets;
+  for (const auto& measurement : measurements.op_performance()) {
+    const OpInfo& op_info = measurement.op();
+    if (op_info.device().type() != table.device().type()) continue;
+    bool unknown_shapes = false;
+    const int64_t bytes_accessed =
+        CalculateInputSize(op_info, &unknown_shapes) +
+        CalculateOutputSize(op_info, &unknown_shapes);
+    if (unknown_shapes || measurement.compute_cost() <= 0) continue;
+    const int bucket = Log2Floor64(bytes_accessed);
+    std::vector<string> keys = {op_info.op()};
+    if (elementwise_ops_.find(op_info.op()) != elementwise_ops_.end()) {
+      keys.push_back(kElementwiseFamily);
+    }
+    for (const string& key : keys) {
+      Bucket& totals = buckets[{key, bucket}];
+      totals.bytes_accessed += bytes_accessed;
+      totals.execution_time_ns += measurement.compute_cost();
+      ++totals.count;
+    }
+  }
+  for (const auto& key_and_bucket : buckets) {
+    const Bucket& totals = key_and_bucket.second;
+    auto* entry = table.add_entries();
+    entry->set_op(key_and_bucket.first.first);
+    entry->set_bytes_accessed(
+        std::llround(totals.bytes_accessed / totals.count));
+    entry->set_execution_time_ns(
+        std::llround(totals.execution_time_ns / totals.count));
+  }
+  return table;
+}
+
+bool OpLevelCostEstimator::CalibratedExecutionTime(
+    const OpInfo& op_info, Costs::NanoSeconds* execution_time) const {
+  if (calibration_.empty()) return false;
+  if (!calibration_device_type_.empty() &&
+      op_info.device().type() != calibration_device_type_) {
+    return false;
+  }
+  auto it = calibration_.find(op_info.op());
+  if (it == calibration_.end() &&
+      elementwise_ops_.find(op_info.op()) != elementwise_ops_.end()) {
+    it = calibration_.find(kElementwiseFamily);
+  }
+  if (it == calibration_.end()) return false;
+  bool unknown_shapes = false;
+  const int64_t bytes_accessed = CalculateInputSize(op_info, &unknown_shapes) +
+                                 CalculateOutputSize(op_info, &unknown_shapes);
+  if (unknown_shapes) return false;
+
+  // Below the smallest measurement, the time is the fixed overhead of the op;
+  // above the largest, it grows with the bytes accessed.
+  const std::vector<std::pair<int64_t, double>>& points = it->second;
+  auto upper = std::lower_bound(
+      points.begin(), points.end(), bytes_accessed,
+      [](const std::pair<int64_t, double>& point, int64_t bytes) {
+        return point.first < bytes;
+      });
+  double time_ns;
+  if (upper == points.begin()) {
+    time_ns = upper->second;
+  } else if (upper == points.end()) {
+    const auto& last = points.back();
+    time_ns = last.first > 0 ? last.second * bytes_accessed / last.first
+                          : last.second;
+  } else {
+    const auto& lower = *(upper - 1);
+    const double fraction = static_cast<double>(bytes_accessed - lower.first) /
+                            (upper->first - lower.first);
+    time_ns = lower.second + fraction * (upper->second - lower.second);
+  }
+  *execution_time =
+      std::max(Costs::NanoSeconds(std::ceil(time_ns)), kMinComputeTime);
+  return true;
 }
 
 Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
@@ -673,6 +819,17 @@ Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
       costs = PredictOpCountBasedCost(
           node_costs.num_compute_ops, node_costs.num_total_read_bytes(),
           node_costs.num_total_write_bytes(), op_context.op_info);
+      Costs::NanoSeconds calibrated_time;
+      if (CalibratedExecutionTime(op_context.op_info, &calibrated_time)) {
+        // Keep the split of the modeled time between compute and memory.
+        const double scale = SafeDiv(calibrated_time.count(),
+                                     costs.execution_time.count());
+        costs.compute_time =
+            Costs::NanoSeconds(costs.compute_time.count() * scale);
+        costs.memory_time =
+            Costs::NanoSeconds(costs.memory_time.count() * scale);
+        costs.execution_time = calibrated_time;
+      }
     }
     VLOG(1) << "Operation " << op_context.op_info.op() << " takes "
             << costs.execution_time.count() << " ns.";
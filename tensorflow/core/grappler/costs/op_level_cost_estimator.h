@@ -16,7 +16,10 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_OP_LEVEL_COST_ESTIMATOR_H_
 #define TENSORFLOW_CORE_GRAPPLER_COSTS_OP_LEVEL_COST_ESTIMATOR_H_
 
+#include <map>
 #include <numeric>
+#include <utility>
+#include <vector>
 
 #include "tensorflow/core/grappler/costs/cost_estimator.h"
 #include "tensorflow/core/grappler/costs/op_context.h"
@@ -98,6 +101,21 @@ class OpLevelCostEstimator {
   // Returns basic device performance info.
   virtual DeviceInfo GetDeviceInfo(const DeviceProperties& device) const;
 
+  // Calibrates the estimates with measured execution times: the execution
+  // time of the ops of `table`, or of their family, is interpolated from the
+  // measurements instead of derived from the nominal device peaks. A table
+  // can also be loaded from the file named by the
+  // TF_GRAPPLER_COST_CALIBRATION_FILE environment variable.
+  Status SetCalibrationTable(const OpCalibrationTable& table);
+
+  // Builds a calibration table from measured op performance, such as the
+  // RunMetadata of op microbenchmarks converted by
+  // CostGraphToOpPerformanceData(). The measurements are averaged per op and
+  // per power of two of bytes accessed; the elementwise ops are also averaged
+  // together as the "Elementwise" family.
+  OpCalibrationTable BuildCalibrationTable(
+      const OpPerformanceList& measurements) const;
+
  protected:
   // TODO(dyoon): Consider to remove PredictOpCountBasedCosts() with OpInfo.
   // Naive cost estimate based on the given operations count and total
@@ -311,6 +329,11 @@ class OpLevelCostEstimator {
                                         bool* found_unknown_shapes,
                                         NodeCosts* node_costs);
 
+  // Returns the execution time of the op interpolated from the calibration
+  // table, or false if the op isn't calibrated.
+  bool CalibratedExecutionTime(const OpInfo& op_info,
+                               Costs::NanoSeconds* execution_time) const;
+
  protected:
   std::map<string, int> elementwise_ops_;
   typedef std::function<Status(const OpContext& op_context, NodeCosts*)>
@@ -320,6 +343,11 @@ class OpLevelCostEstimator {
   // compute_time and memory_time, instead of sum of those two.
   bool compute_memory_overlap_;
   std::set<string> persistent_ops_;
+  // The calibration points, as (bytes accessed, execution time in ns)
+  // sorted by bytes, of each op or op family.
+  std::map<string, std::vector<std::pair<int64_t, double>>> calibration_;
+  // The device type the calibration applies to, or empty for all.
+  string calibration_device_type_;
 
  private:
   friend class OpLevelCostEstimatorTest;
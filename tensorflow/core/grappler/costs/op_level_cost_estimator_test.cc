@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
 
+#include <tuple>
 #include <unordered_set>
+#include <vector>
 
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/attr_value_util.h"
@@ -24,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/status_matchers.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/device_properties.pb.h"
@@ -2364,5 +2367,80 @@ TEST_F(OpLevelCostEstimatorTest, CropAndResizeExecutionTime) {
   }
 }
 
+TEST_F(OpLevelCostEstimatorTest, CalibratedExecutionTime) {
+  OpCalibrationTable table;
+  table.mutable_device()->set_type("CPU");
+  auto add_entry = [&table](const string& op, int64_t bytes, int64_t ns) {
+    auto* entry = table.add_entries();
+    entry->set_op(op);
+    entry->set_bytes_accessed(bytes);
+    entry->set_execution_time_ns(ns);
+  };
+  add_entry("Relu", 16000, 300);
+  add_entry("Relu", 8000, 100);
+  add_entry("Elementwise", 8000, 50);
+  TF_ASSERT_OK(estimator_.SetCalibrationTable(table));
+
+  // A Relu of n floats accesses 8n bytes.
+  EXPECT_EQ(Costs::Duration(100),
+            PredictCosts(DescribeUnaryOp("Relu", 500)).execution_time);
+  EXPECT_EQ(Costs::Duration(200),
+            PredictCosts(DescribeUnaryOp("Relu", 1500)).execution_time);
+  EXPECT_EQ(Costs::Duration(600),
+            PredictCosts(DescribeUnaryOp("Relu", 4000)).execution_time);
+  // The other elementwise ops use the measurements of their family.
+  EXPECT_EQ(Costs::Duration(50),
+            PredictCosts(DescribeUnaryOp("Tanh", 1000)).execution_time);
+  // The split between compute and memory time is kept.
+  const Costs costs = PredictCosts(DescribeUnaryOp("Relu", 1000));
+  EXPECT_GT(costs.memory_time, Costs::Duration::zero());
+  EXPECT_NEAR(costs.execution_time.count(),
+              (costs.compute_time + costs.memory_time).count(), 1);
+
+  // The ops without measurements, and the ops of other devices, keep the
+  // estimates of the model.
+  OpLevelCostEstimator uncalibrated;
+  const OpContext matmul = DescribeMatMul(10, 10, 10, 10);
+  EXPECT_EQ(uncalibrated.PredictCosts(matmul).execution_time,
+            PredictCosts(matmul).execution_time);
+  OpContext gpu_relu = DescribeUnaryOp("Relu", 1000);
+  gpu_relu.op_info.mutable_device()->set_type("GPU");
+  EXPECT_EQ(uncalibrated.PredictCosts(gpu_relu).execution_time,
+            PredictCosts(gpu_relu).execution_time);
+
+  add_entry("", 10, 10);
+  EXPECT_FALSE(estimator_.SetCalibrationTable(table).ok());
+}
+
+TEST_F(OpLevelCostEstimatorTest, BuildCalibrationTable) {
+  OpPerformanceList measurements;
+  auto add_measurement = [&measurements](const string& op, int size,
+                                         int64_t ns) {
+    auto* measurement = measurements.add_op_performance();
+    *measurement->mutable_op() = DescribeUnaryOp(op, size).op_info;
+    measurement->set_compute_cost(ns);
+  };
+  add_measurement("Relu", 1000, 90);
+  add_measurement("Relu", 1000, 110);
+  add_measurement("Relu", 2000, 300);
+  add_measurement("MatMul", 2000, 1000);
+
+  const OpCalibrationTable table =
+      estimator_.BuildCalibrationTable(measurements);
+  EXPECT_EQ("CPU", table.device().type());
+  std::vector<std::tuple<string, int64_t, int64_t>> entries;
+  for (const auto& entry : table.entries()) {
+    entries.emplace_back(entry.op(), entry.bytes_accessed(),
+                         entry.execution_time_ns());
+  }
+  EXPECT_THAT(entries,
+              ::testing::ElementsAre(
+                  std::make_tuple("Elementwise", 8000, 100),
+                  std::make_tuple("Elementwise", 16000, 300),
+                  std::make_tuple("MatMul", 16000, 1000),
+                  std::make_tuple("Relu", 8000, 100),
+                  std::make_tuple("Relu", 16000, 300)));
+}
+
 }  // end namespace grappler
 }  // end namespace tensorflow
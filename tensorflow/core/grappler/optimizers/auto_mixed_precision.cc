@@ -2310,6 +2310,14 @@ Status AutoMixedPrecision::Optimize(Cluster* cluster, const GrapplerItem& item,
                  << " graph optimizer configured for BFloat16 on CPUs";
   }
 
+  if (mode_ == AutoMixedPrecisionMode::BF16 &&
+      AutoMixedPrecisionListsMkl::GetCpuBf16Support() <
+          AutoMixedPrecisionListsMkl::CpuBf16Support::kAvx512Bf16) {
+    LOG(WARNING) << "This CPU has no native BFloat16 support: " << name()
+                 << " graph optimizer only converts the ops added to its "
+                    "allow list";
+  }
+
   // Optimize the output graph in-place.
   AutoMixedPrecisionImpl optimizer(cluster, item.NodesToPreserve(), output,
                                    item.id, mode_);
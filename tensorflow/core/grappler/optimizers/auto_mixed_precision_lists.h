@@ -20,6 +20,7 @@ limitations under the License.
 
 #include "tensorflow/core/lib/gtl/flatset.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
@@ -362,24 +363,81 @@ class AutoMixedPrecisionListsCuda : public AutoMixedPrecisionLists {
 
 class AutoMixedPrecisionListsMkl : public AutoMixedPrecisionLists {
  public:
-  AutoMixedPrecisionListsMkl() {}
+  // The bfloat16 support of the CPU, from the least to the most.
+  enum class CpuBf16Support {
+    // No AVX512: oneDNN has no bfloat16 kernels.
+    kNone,
+    // AVX512 without AVX512_BF16: the bfloat16 kernels of oneDNN emulate the
+    // bfloat16 arithmetic and are slower than the float32 ones.
+    kEmulated,
+    // AVX512_BF16: the dot products of oneDNN are native in bfloat16.
+    kAvx512Bf16,
+    // AMX_BF16: the matrix products of oneDNN run on the bfloat16 tiles.
+    kAmx,
+  };
+
+  // Returns the bfloat16 support of this CPU. The
+  // TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_CPU_BF16_SUPPORT environment
+  // variable overrides it with NONE, EMULATED, AVX512_BF16 or AMX_BF16.
+  static CpuBf16Support GetCpuBf16Support() {
+    string support;
+    TF_CHECK_OK(ReadStringFromEnvVar(
+        "TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_CPU_BF16_SUPPORT", "",
+        &support));
+    support = str_util::Uppercase(support);
+    if (support == "NONE") return CpuBf16Support::kNone;
+    if (support == "EMULATED") return CpuBf16Support::kEmulated;
+    if (support == "AVX512_BF16") return CpuBf16Support::kAvx512Bf16;
+    if (support == "AMX_BF16") return CpuBf16Support::kAmx;
+    if (port::TestCPUFeature(port::CPUFeature::AMX_BF16)) {
+      return CpuBf16Support::kAmx;
+    }
+    if (port::TestCPUFeature(port::CPUFeature::AVX512_BF16)) {
+      return CpuBf16Support::kAvx512Bf16;
+    }
+    if (port::TestCPUFeature(port::CPUFeature::AVX512F)) {
+      return CpuBf16Support::kEmulated;
+    }
+    return CpuBf16Support::kNone;
+  }
+
+  AutoMixedPrecisionListsMkl()
+      : AutoMixedPrecisionListsMkl(GetCpuBf16Support()) {}
+  explicit AutoMixedPrecisionListsMkl(CpuBf16Support cpu_support)
+      : cpu_support_(cpu_support) {}
 
   // Only ops which are supported by MKL in bfloat16 should be added to the
   // allow list, infer list, or clear list.
+  //
+  // The allow list only has the ops whose bfloat16 kernels are faster than
+  // the float32 ones on this CPU, since elsewhere the casts are pure
+  // overhead. The fused ops of the remapper are allowed too, so that a
+  // fused graph does not cast between the contraction and its epilogue.
   gtl::FlatSet<string> AllowList() override {
-    auto list = gtl::FlatSet<string>{"Conv2D",
-                                     "Conv2DBackpropFilter",
-                                     "Conv2DBackpropInput",
-                                     "Conv3D",
-                                     "Conv3DBackpropFilterV2",
-                                     "Conv3DBackpropInputV2",
-                                     "DepthwiseConv2dNative",
-                                     "DepthwiseConv2dNativeBackpropFilter",
-                                     "DepthwiseConv2dNativeBackpropInput",
-                                     "MatMul",
-                                     "BatchMatMul",
-                                     "BatchMatMulV2",
-                                     "Einsum"};
+    gtl::FlatSet<string> list;
+    if (cpu_support_ >= CpuBf16Support::kAvx512Bf16) {
+      list = {"Conv2D",
+              "Conv2DBackpropFilter",
+              "Conv2DBackpropInput",
+              "Conv3D",
+              "Conv3DBackpropFilterV2",
+              "Conv3DBackpropInputV2",
+              "DepthwiseConv2dNative",
+              "DepthwiseConv2dNativeBackpropFilter",
+              "DepthwiseConv2dNativeBackpropInput",
+              "MatMul",
+              "_FusedConv2D",
+              "_FusedConv3D",
+              "_FusedDepthwiseConv2dNative",
+              "_FusedMatMul"};
+    }
+    // The batched products are mostly small, like those of attention, and
+    // only pay for their casts with the throughput of AMX.
+    if (cpu_support_ >= CpuBf16Support::kAmx) {
+      for (const char* op : {"BatchMatMul", "BatchMatMulV2", "Einsum"}) {
+        list.insert(op);
+      }
+    }
 
     UpdateList("ALLOWLIST", &list);
     // For backwards compatibility, keeping the original env variable here.
@@ -432,7 +490,7 @@ class AutoMixedPrecisionListsMkl : public AutoMixedPrecisionLists {
                                      "Sqrt",
                                      "Square",
                                      "SquaredDifference",
-                                     "Sum"
+                                     "Sum",
                                      "Tanh",
                                      "TanhGrad"};
     UpdateList("INFERLIST", &list);
@@ -559,6 +617,9 @@ class AutoMixedPrecisionListsMkl : public AutoMixedPrecisionLists {
     UpdateList("CLEARLIST", &list);
     return list;
   }
+
+ private:
+  CpuBf16Support cpu_support_;
 };
 
 }  // end namespace grappler
@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
 #include "tensorflow/core/grappler/devices.h"
 #include "tensorflow/core/grappler/graph_view.h"
+#include "tensorflow/core/grappler/optimizers/auto_mixed_precision_lists.h"
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/random.h"
@@ -1464,8 +1465,14 @@ class AutoMixedPrecisionMklTest : public GrapplerTest {
   void SetUp() override {
     virtual_cluster_.reset(new SingleMachine(/* timeout_s = */ 10, 1, 0));
     TF_CHECK_OK(virtual_cluster_->Provision());
+    // Convert as on a CPU with AMX, whatever CPU the test runs on.
+    setenv("TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_CPU_BF16_SUPPORT",
+           "AMX_BF16", 1 /* replace */);
+  }
+  void TearDown() override {
+    unsetenv("TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_CPU_BF16_SUPPORT");
+    TF_CHECK_OK(virtual_cluster_->Shutdown());
   }
-  void TearDown() override { TF_CHECK_OK(virtual_cluster_->Shutdown()); }
 
   std::unique_ptr<Cluster> virtual_cluster_;
 };
@@ -1719,6 +1726,55 @@ TEST_F(AutoMixedPrecisionMklTest, InferFollowUpStreamDeny) {
     test::ExpectClose(tensors_expected[i], tensors[i]);
   }
 }
+
+TEST_F(AutoMixedPrecisionMklTest, NoConversionWithoutNativeBf16) {
+  setenv("TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_CPU_BF16_SUPPORT", "EMULATED",
+         1 /* replace */);
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/job:localhost/replica:0/task:0/device:CPU:0");
+  Output input = ops::Const(s.WithOpName("input"), 1.f / 32, {32, 32});
+  Output allow1 = ops::MatMul(s.WithOpName("allow1"), input, input);
+  Output infer1 = ops::Tanh(s.WithOpName("infer1"), allow1);
+  Output fetch = ops::Identity(s.WithOpName("fetch"), infer1);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  AutoMixedPrecision optimizer{AutoMixedPrecisionMode::BF16};
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(virtual_cluster_.get(), item, &output));
+
+  GraphView output_view(&output);
+  EXPECT_EQ(output.node_size(), item.graph.node_size());
+  EXPECT_EQ(output_view.GetNode("allow1")->attr().at("T").type(), DT_FLOAT);
+  EXPECT_EQ(output_view.GetNode("infer1")->attr().at("T").type(), DT_FLOAT);
+}
+
+TEST(AutoMixedPrecisionListsMklTest, AllowListFollowsCpuSupport) {
+  using CpuBf16Support = AutoMixedPrecisionListsMkl::CpuBf16Support;
+  EXPECT_TRUE(
+      AutoMixedPrecisionListsMkl(CpuBf16Support::kNone).AllowList().empty());
+  EXPECT_TRUE(AutoMixedPrecisionListsMkl(CpuBf16Support::kEmulated)
+                  .AllowList()
+                  .empty());
+
+  auto avx512_bf16 =
+      AutoMixedPrecisionListsMkl(CpuBf16Support::kAvx512Bf16).AllowList();
+  EXPECT_EQ(avx512_bf16.count("MatMul"), 1);
+  EXPECT_EQ(avx512_bf16.count("_FusedMatMul"), 1);
+  EXPECT_EQ(avx512_bf16.count("BatchMatMulV2"), 0);
+
+  auto amx = AutoMixedPrecisionListsMkl(CpuBf16Support::kAmx).AllowList();
+  EXPECT_EQ(amx.count("Conv2D"), 1);
+  EXPECT_EQ(amx.count("BatchMatMulV2"), 1);
+  EXPECT_EQ(amx.count("Einsum"), 1);
+
+  // Both are inferred rather than merged into a single "SumTanh".
+  auto infer = AutoMixedPrecisionListsMkl(CpuBf16Support::kAmx).InferList();
+  EXPECT_EQ(infer.count("Sum"), 1);
+  EXPECT_EQ(infer.count("Tanh"), 1);
+}
 #endif  // INTEL_MKL
 
 }  // namespace
@@ -0,0 +1,290 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/collective_bucketing.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kCollectiveReduceV2[] = "CollectiveReduceV2";
+
+// A CollectiveReduceV2 node that may be fused.
+struct Candidate {
+  NodeDef* node;
+  // Position of the node in topological order.
+  int position;
+  PartialTensorShape shape;
+  int64_t bytes;
+};
+
+// Returns the key of the nodes that may share a fused collective: those
+// reducing over the same group in the same way on the same device.
+string BucketKey(const NodeDef& node) {
+  string key = absl::StrCat(node.device(), "|", node.input(1), "|",
+                            node.input(2));
+  std::map<string, string> attrs;
+  for (const auto& attr : node.attr()) {
+    attrs[attr.first] = SummarizeAttrValue(attr.second);
+  }
+  for (const auto& attr : attrs) {
+    absl::StrAppend(&key, "|", attr.first, "=", attr.second);
+  }
+  return key;
+}
+
+// Returns whether `node` is a CollectiveReduceV2 that may be fused, and if so
+// sets the static shape and size of its input.
+bool IsFusibleReduce(const NodeDef& node, const GraphProperties& properties,
+                     PartialTensorShape* shape, int64_t* bytes) {
+  if (node.op() != kCollectiveReduceV2 || node.input_size() < 4 ||
+      IsControlInput(node.input(3))) {
+    return false;
+  }
+  // Collectives chained by ordering tokens are left alone.
+  const auto& attr = node.attr();
+  auto it = attr.find("Nordering_token");
+  if (it != attr.end() && it->second.i() != 0) return false;
+  for (int i = 4; i < node.input_size(); ++i) {
+    if (!IsControlInput(node.input(i))) return false;
+  }
+  if (!properties.HasOutputProperties(node.name())) return false;
+  const auto& outputs = properties.GetOutputProperties(node.name());
+  if (outputs.empty()) return false;
+  *shape = PartialTensorShape(outputs[0].shape());
+  if (!shape->IsFullyDefined()) return false;
+  *bytes = shape->num_elements() * DataTypeSize(outputs[0].dtype());
+  return *bytes > 0;
+}
+
+class BucketRewriter {
+ public:
+  explicit BucketRewriter(GraphDef* graph) : graph_(graph) {
+    for (const NodeDef& node : graph_->node()) names_.insert(node.name());
+  }
+
+  // Replaces the collectives `bucket` by a single collective of their
+  // concatenated inputs, turning each of them into a slice of its result.
+  void Rewrite(const std::vector<Candidate>& bucket) {
+    const NodeDef& first = *bucket[0].node;
+    const string prefix = absl::StrCat(first.name(), "/CollectiveBucket");
+    const string& device = first.device();
+    const DataType dtype = first.attr().at("T").type();
+    const int num_members = bucket.size();
+
+    Tensor flat_shape(DT_INT32, TensorShape({1}));
+    flat_shape.vec<int32>()(0) = -1;
+    const string flat_shape_name =
+        AddConst(absl::StrCat(prefix, "/flat_shape"), device, flat_shape);
+    Tensor axis(DT_INT32, TensorShape({}));
+    axis.scalar<int32>()() = 0;
+    const string axis_name =
+        AddConst(absl::StrCat(prefix, "/axis"), device, axis);
+
+    NodeDef* concat =
+        AddNode(absl::StrCat(prefix, "/concat"), "ConcatV2", device);
+    SetAttrValue(dtype, &(*concat->mutable_attr())["T"]);
+    SetAttrValue(DT_INT32, &(*concat->mutable_attr())["Tidx"]);
+    SetAttrValue(num_members, &(*concat->mutable_attr())["N"]);
+    Tensor size_splits(DT_INT64, TensorShape({num_members}));
+    for (int i = 0; i < num_members; ++i) {
+      NodeDef* flat =
+          AddNode(absl::StrCat(prefix, "/flat_", i), "Reshape", device);
+      SetAttrValue(dtype, &(*flat->mutable_attr())["T"]);
+      SetAttrValue(DT_INT32, &(*flat->mutable_attr())["Tshape"]);
+      flat->add_input(bucket[i].node->input(0));
+      flat->add_input(flat_shape_name);
+      concat->add_input(flat->name());
+      size_splits.vec<int64_t>()(i) = bucket[i].shape.num_elements();
+    }
+    concat->add_input(axis_name);
+
+    NodeDef* reduce =
+        AddNode(absl::StrCat(prefix, "/reduce"), kCollectiveReduceV2, device);
+    *reduce->mutable_attr() = first.attr();
+    reduce->add_input(concat->name());
+    for (int i = 1; i < 4; ++i) reduce->add_input(first.input(i));
+    // The control dependencies of the members hold back the fused collective.
+    absl::flat_hash_set<string> control_inputs;
+    for (const Candidate& member : bucket) {
+      for (int i = 4; i < member.node->input_size(); ++i) {
+        if (control_inputs.insert(member.node->input(i)).second) {
+          reduce->add_input(member.node->input(i));
+        }
+      }
+    }
+
+    const string size_splits_name = AddConst(
+        absl::StrCat(prefix, "/size_splits"), device, size_splits);
+    NodeDef* split = AddNode(absl::StrCat(prefix, "/split"), "SplitV", device);
+    SetAttrValue(dtype, &(*split->mutable_attr())["T"]);
+    SetAttrValue(DT_INT64, &(*split->mutable_attr())["Tlen"]);
+    SetAttrValue(num_members, &(*split->mutable_attr())["num_split"]);
+    split->add_input(reduce->name());
+    split->add_input(size_splits_name);
+    split->add_input(axis_name);
+
+    // The members keep their names, so that their consumers are unchanged.
+    for (int i = 0; i < num_members; ++i) {
+      NodeDef* member = bucket[i].node;
+      Tensor shape(DT_INT64, TensorShape({bucket[i].shape.dims()}));
+      for (int d = 0; d < bucket[i].shape.dims(); ++d) {
+        shape.vec<int64_t>()(d) = bucket[i].shape.dim_size(d);
+      }
+      const string shape_name =
+          AddConst(absl::StrCat(prefix, "/shape_", i), device, shape);
+      member->set_op("Reshape");
+      member->clear_input();
+      member->add_input(i == 0 ? split->name()
+                               : absl::StrCat(split->name(), ":", i));
+      member->add_input(shape_name);
+      member->clear_attr();
+      SetAttrValue(dtype, &(*member->mutable_attr())["T"]);
+      SetAttrValue(DT_INT64, &(*member->mutable_attr())["Tshape"]);
+    }
+  }
+
+ private:
+  NodeDef* AddNode(const string& name, const string& op,
+                   const string& device) {
+    string unique_name = name;
+    for (int i = 1; !names_.insert(unique_name).second; ++i) {
+      unique_name = absl::StrCat(name, "_", i);
+    }
+    NodeDef* node = graph_->add_node();
+    node->set_name(unique_name);
+    node->set_op(op);
+    node->set_device(device);
+    return node;
+  }
+
+  string AddConst(const string& name, const string& device,
+                  const Tensor& value) {
+    NodeDef* node = AddNode(name, "Const", device);
+    SetAttrValue(value.dtype(), &(*node->mutable_attr())["dtype"]);
+    value.AsProtoTensorContent(
+        (*node->mutable_attr())["value"].mutable_tensor());
+    return node->name();
+  }
+
+  GraphDef* graph_;
+  absl::flat_hash_set<string> names_;
+};
+
+}  // namespace
+
+Status CollectiveBucketing::Optimize(Cluster* /*cluster*/,
+                                     const GrapplerItem& item,
+                                     GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(false));
+
+  std::vector<const NodeDef*> topo_order;
+  TF_RETURN_IF_ERROR(ComputeTopologicalOrder(*optimized_graph, &topo_order));
+  absl::flat_hash_map<string, int> position;
+  for (int i = 0; i < topo_order.size(); ++i) {
+    position[topo_order[i]->name()] = i;
+  }
+  absl::flat_hash_set<string> feeds;
+  for (const auto& feed : item.feed) feeds.insert(NodeName(feed.first));
+
+  // The candidates, per bucket key in the order of their first appearance,
+  // and for each node the last candidate it depends on, or -1.
+  std::vector<std::vector<Candidate>> groups;
+  absl::flat_hash_map<string, int> group_of_key;
+  std::vector<bool> is_candidate(topo_order.size(), false);
+  std::vector<int> last_dependency(topo_order.size(), -1);
+  for (int i = 0; i < topo_order.size(); ++i) {
+    const NodeDef& node = *topo_order[i];
+    for (const string& input : node.input()) {
+      auto it = position.find(NodeName(input));
+      if (it == position.end()) continue;
+      const int p = it->second;
+      last_dependency[i] = std::max(
+          {last_dependency[i], last_dependency[p], is_candidate[p] ? p : -1});
+    }
+    Candidate candidate;
+    if (feeds.contains(node.name()) ||
+        !IsFusibleReduce(node, properties, &candidate.shape,
+                         &candidate.bytes) ||
+        candidate.bytes > bucket_bytes_) {
+      continue;
+    }
+    is_candidate[i] = true;
+    // The topological order points into the graph being optimized.
+    candidate.node = const_cast<NodeDef*>(&node);
+    candidate.position = i;
+    auto inserted = group_of_key.emplace(BucketKey(node), groups.size());
+    if (inserted.second) groups.emplace_back();
+    groups[inserted.first->second].push_back(candidate);
+  }
+
+  // Each bucket takes consecutive candidates of a group while they fit and
+  // none of them depends on a collective of the bucket. Since the members of
+  // a bucket only depend on candidates before it, the fused collectives
+  // cannot form a cycle.
+  BucketRewriter rewriter(optimized_graph);
+  int num_buckets = 0;
+  for (const std::vector<Candidate>& group : groups) {
+    std::vector<Candidate> bucket;
+    int64_t bucket_bytes = 0;
+    auto flush = [&]() {
+      if (bucket.size() > 1) {
+        rewriter.Rewrite(bucket);
+        ++num_buckets;
+      }
+      bucket.clear();
+      bucket_bytes = 0;
+    };
+    for (const Candidate& candidate : group) {
+      if (!bucket.empty() &&
+          (bucket_bytes + candidate.bytes > bucket_bytes_ ||
+           last_dependency[candidate.position] >= bucket[0].position)) {
+        flush();
+      }
+      bucket.push_back(candidate);
+      bucket_bytes += candidate.bytes;
+    }
+    flush();
+  }
+  if (num_buckets == 0) {
+    return errors::Aborted("Nothing to do.");
+  }
+  VLOG(1) << "Fused collectives into " << num_buckets << " buckets";
+  return OkStatus();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
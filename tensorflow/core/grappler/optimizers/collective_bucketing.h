@@ -0,0 +1,62 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_COLLECTIVE_BUCKETING_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_COLLECTIVE_BUCKETING_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Fuses the small all-reduces of a graph, e.g. of the gradients of a model,
+// into buckets of up to `bucket_bytes` bytes.
+//
+// The CollectiveReduceV2 nodes that reduce over the same group with the same
+// attributes on the same device are taken in topological order, i.e. in the
+// order backprop produces their inputs, and consecutive ones are fused into a
+// single CollectiveReduceV2 of the concatenation of their flattened inputs,
+// whose result is split back. Each bucket thus starts as soon as the last of
+// its inputs is ready, overlapping the communication with the rest of
+// backprop, rather than each tensor paying the latency of its own collective.
+// A node does not join a bucket whose collectives it depends on.
+//
+// The fused collective takes the instance key of the first node of its
+// bucket, so every worker must run the optimizer on the same graph.
+class CollectiveBucketing : public GraphOptimizer {
+ public:
+  // Buckets of this many bytes by default, as in PyTorch DDP.
+  static constexpr int64_t kDefaultBucketBytes = 25 << 20;
+
+  explicit CollectiveBucketing(int64_t bucket_bytes = 0)
+      : bucket_bytes_(bucket_bytes > 0 ? bucket_bytes : kDefaultBucketBytes) {}
+  ~CollectiveBucketing() override {}
+
+  string name() const override { return "collective_bucketing"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+ private:
+  const int64_t bucket_bytes_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_COLLECTIVE_BUCKETING_H_
@@ -0,0 +1,160 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/collective_bucketing.h"
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using test::function::NDef;
+
+constexpr char kDevice[] = "/job:worker/replica:0/task:0/device:CPU:0";
+
+NodeDef Input(const string& name, const TensorShape& shape) {
+  return NDef(name, "Placeholder", {},
+              {{"dtype", DT_FLOAT}, {"shape", shape}}, kDevice);
+}
+
+NodeDef Key(const string& name, int value) {
+  return NDef(name, "Const", {},
+              {{"dtype", DT_INT32},
+               {"value", test::AsScalar<int32>(value)}},
+              kDevice);
+}
+
+NodeDef Reduce(const string& name, const string& input,
+               const string& group_key, const string& instance_key) {
+  return NDef(name, "CollectiveReduceV2",
+              {input, "group_size", group_key, instance_key},
+              {{"T", DT_FLOAT},
+               {"merge_op", "Add"},
+               {"final_op", "Div"},
+               {"communication_hint", "auto"},
+               {"timeout_seconds", 0.0f},
+               {"Nordering_token", 0},
+               {"max_subdivs_per_device", -1}},
+              kDevice);
+}
+
+int CountOp(const GraphDef& graph, const string& op) {
+  int count = 0;
+  for (const NodeDef& node : graph.node()) {
+    if (node.op() == op) ++count;
+  }
+  return count;
+}
+
+class CollectiveBucketingTest : public GrapplerTest {
+ protected:
+  // Returns a graph all-reducing tensors of 24, 16 and 4 bytes.
+  GrapplerItem MakeItem() {
+    GrapplerItem item;
+    item.graph = test::function::GDef({
+        Key("group_size", 2), Key("group_key", 1), Key("instance_0", 10),
+        Key("instance_1", 11), Key("instance_2", 12),
+        Input("x0", TensorShape({2, 3})), Input("x1", TensorShape({4})),
+        Input("x2", TensorShape({})),
+        Reduce("r0", "x0", "group_key", "instance_0"),
+        Reduce("r1", "x1", "group_key", "instance_1"),
+        Reduce("r2", "x2", "group_key", "instance_2")});
+    item.fetch = {"r0", "r1", "r2"};
+    return item;
+  }
+};
+
+TEST_F(CollectiveBucketingTest, FusesSmallReduces) {
+  GrapplerItem item = MakeItem();
+  CollectiveBucketing optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(CountOp(output, "CollectiveReduceV2"), 1);
+  EXPECT_EQ(CountOp(output, "SplitV"), 1);
+  NodeMap node_map(&output);
+  const NodeDef* reduce = node_map.GetNode("r0/CollectiveBucket/reduce");
+  ASSERT_NE(reduce, nullptr);
+  EXPECT_EQ(reduce->input(0), "r0/CollectiveBucket/concat");
+  EXPECT_EQ(reduce->input(3), "instance_0");
+  EXPECT_EQ(reduce->device(), kDevice);
+  const NodeDef* concat = node_map.GetNode("r0/CollectiveBucket/concat");
+  ASSERT_NE(concat, nullptr);
+  EXPECT_EQ(concat->attr().at("N").i(), 3);
+
+  const char* const members[] = {"r0", "r1", "r2"};
+  for (int i = 0; i < 3; ++i) {
+    const NodeDef* member = node_map.GetNode(members[i]);
+    ASSERT_NE(member, nullptr);
+    EXPECT_EQ(member->op(), "Reshape");
+    EXPECT_EQ(member->input(0),
+              i == 0 ? "r0/CollectiveBucket/split"
+                     : absl::StrCat("r0/CollectiveBucket/split:", i));
+  }
+}
+
+TEST_F(CollectiveBucketingTest, RespectsBucketBytes) {
+  GrapplerItem item = MakeItem();
+  CollectiveBucketing optimizer(/*bucket_bytes=*/40);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // r0 and r1 fill the first bucket, and r2 is left alone.
+  EXPECT_EQ(CountOp(output, "CollectiveReduceV2"), 2);
+  NodeMap node_map(&output);
+  EXPECT_EQ(node_map.GetNode("r1")->op(), "Reshape");
+  EXPECT_EQ(node_map.GetNode("r2")->op(), "CollectiveReduceV2");
+}
+
+TEST_F(CollectiveBucketingTest, DoesNotFuseDependentReduces) {
+  GrapplerItem item;
+  item.graph = test::function::GDef({
+      Key("group_size", 2), Key("group_key", 1), Key("instance_0", 10),
+      Key("instance_1", 11), Input("x0", TensorShape({4})),
+      Reduce("r0", "x0", "group_key", "instance_0"),
+      NDef("x1", "Neg", {"r0"}, {{"T", DT_FLOAT}}, kDevice),
+      Reduce("r1", "x1", "group_key", "instance_1")});
+  item.fetch = {"r1"};
+  CollectiveBucketing optimizer;
+  GraphDef output;
+  EXPECT_TRUE(errors::IsAborted(optimizer.Optimize(nullptr, item, &output)));
+}
+
+TEST_F(CollectiveBucketingTest, DoesNotFuseAcrossGroups) {
+  GrapplerItem item;
+  item.graph = test::function::GDef({
+      Key("group_size", 2), Key("group_key", 1), Key("other_group_key", 2),
+      Key("instance_0", 10), Key("instance_1", 11),
+      Input("x0", TensorShape({4})), Input("x1", TensorShape({4})),
+      Reduce("r0", "x0", "group_key", "instance_0"),
+      Reduce("r1", "x1", "other_group_key", "instance_1")});
+  item.fetch = {"r0", "r1"};
+  CollectiveBucketing optimizer;
+  GraphDef output;
+  EXPECT_TRUE(errors::IsAborted(optimizer.Optimize(nullptr, item, &output)));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
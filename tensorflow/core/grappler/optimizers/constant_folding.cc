@@ -51,6 +51,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/setround.h"
 #include "tensorflow/core/platform/tensor_coding.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/public/version.h"
 #include "tensorflow/core/util/bcast.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
@@ -189,21 +190,25 @@ float QuantizedTypeMaxAsFloat(DataType data_type) {
 ConstantFolding::ConstantFolding(RewriterConfig::Toggle opt_level,
                                  DeviceBase* cpu_device,
                                  bool disable_compressed_tensor_optimization,
-                                 bool fold_quantization_emulation)
+                                 bool fold_quantization_emulation,
+                                 int num_threads, int64_t budget_bytes)
     : opt_level_(opt_level),
       cpu_device_(cpu_device),
       disable_compressed_tensor_optimization_(
           disable_compressed_tensor_optimization),
-      fold_quantization_emulation_(fold_quantization_emulation) {
+      fold_quantization_emulation_(fold_quantization_emulation),
+      num_threads_(num_threads),
+      budget_bytes_(budget_bytes) {
   resource_mgr_.reset(new ResourceMgr());
 }
 
 ConstantFolding::ConstantFolding(DeviceBase* cpu_device,
                                  bool disable_compressed_tensor_optimization,
-                                 bool fold_quantization_ops)
+                                 bool fold_quantization_ops, int num_threads,
+                                 int64_t budget_bytes)
     : ConstantFolding(RewriterConfig::ON, cpu_device,
                       disable_compressed_tensor_optimization,
-                      fold_quantization_ops) {}
+                      fold_quantization_ops, num_threads, budget_bytes) {}
 
 // static
 string ConstantFolding::AddControlDependency(const string& input_name,
@@ -1503,16 +1508,74 @@ Status ConstantFolding::FoldMergeNode(NodeDef* node, GraphDef* output_graph) {
   return OkStatus();
 }
 
+void ConstantFolding::EvaluateFoldables(absl::Span<NodeDef* const> nodes,
+                                        thread::ThreadPool* pool,
+                                        std::vector<EvaluatedNode>* evaluated) {
+  evaluated->clear();
+  evaluated->resize(nodes.size());
+  // Evaluating a node takes at least a kernel construction and launch.
+  constexpr int64_t kCostPerNode = 10000;
+  pool->ParallelFor(
+      nodes.size(), kCostPerNode, [&](int64_t begin, int64_t end) {
+        // Evaluate with the floating point environment of Optimize().
+        port::ScopedFlushDenormal flush;
+        port::ScopedSetRound round(FE_TONEAREST);
+        for (int64_t i = begin; i < end; ++i) {
+          EvaluatedNode& e = (*evaluated)[i];
+          e.status = EvaluateOneFoldable(*nodes[i], &e.const_nodes,
+                                         &e.result_too_large);
+        }
+      });
+}
+
+int64_t ConstantFolding::FoldedBytesAdded(
+    const NodeDef& node, const std::vector<NodeDef>& const_nodes) const {
+  int64_t bytes_added = 0;
+  for (const NodeDef& const_node : const_nodes) {
+    if (const_node.name().empty()) continue;
+    bytes_added += const_node.attr().at("value").tensor().ByteSizeLong();
+  }
+  for (const string& input : node.input()) {
+    if (IsControlInput(input)) break;
+    const NodeDef* input_node = node_map_->GetNode(input);
+    if (input_node == nullptr || input_node->attr().count("value") == 0) {
+      continue;
+    }
+    bytes_added -= input_node->attr().at("value").tensor().ByteSizeLong();
+  }
+  return bytes_added;
+}
+
 Status ConstantFolding::FoldNode(NodeDef* node, GraphDef* output_graph,
-                                 bool* result_too_large) {
+                                 bool* result_too_large,
+                                 EvaluatedNode* evaluated) {
   *result_too_large = false;
   if (IsMerge(*node)) {
     return FoldMergeNode(node, output_graph);
   }
 
   std::vector<NodeDef> const_nodes;
-  TF_RETURN_IF_ERROR(
-      EvaluateOneFoldable(*node, &const_nodes, result_too_large));
+  if (evaluated != nullptr) {
+    *result_too_large = evaluated->result_too_large;
+    TF_RETURN_IF_ERROR(evaluated->status);
+    const_nodes = std::move(evaluated->const_nodes);
+  } else {
+    TF_RETURN_IF_ERROR(
+        EvaluateOneFoldable(*node, &const_nodes, result_too_large));
+  }
+  if (budget_bytes_ > 0) {
+    // Folds that shrink the constants are always worth it, the others are
+    // charged to the budget.
+    const int64_t bytes_added = FoldedBytesAdded(*node, const_nodes);
+    if (bytes_added > 0 && bytes_added_ + bytes_added > budget_bytes_) {
+      *result_too_large = true;
+      return errors::ResourceExhausted(
+          "Folding ", node->name(), " would add ", bytes_added,
+          " bytes of constants, over the budget of ", budget_bytes_,
+          " bytes of which ", bytes_added_, " are used");
+    }
+    bytes_added_ += std::max<int64_t>(bytes_added, 0);
+  }
   VLOG(2) << "Folded node: " << SummarizeNodeDef(*node);
 
   NodeDef* constant_output = nullptr;
@@ -1643,9 +1706,42 @@ Status ConstantFolding::FoldGraph(
       queue.push_back(graph_->mutable_node(i));
     }
   }
+  // The nodes in the queue were foldable when they were queued, so all their
+  // inputs are constants, which folding the other nodes doesn't change. Hence
+  // the nodes in the queue can be evaluated in parallel, before being folded
+  // one at a time in the same order as when evaluating them sequentially.
+  std::unique_ptr<thread::ThreadPool> pool;
+  if (num_threads_ > 1) {
+    pool = std::make_unique<thread::ThreadPool>(
+        Env::Default(), "constant_folding", num_threads_);
+  }
+  absl::flat_hash_map<const NodeDef*, int> evaluated_index;
+  std::vector<EvaluatedNode> evaluated;
   while (!queue.empty()) {
+    if (pool != nullptr && evaluated_index.empty()) {
+      std::vector<NodeDef*> to_evaluate;
+      for (NodeDef* node : queue) {
+        if (!IsMerge(*node) && !processed_nodes.contains(node->name()) &&
+            evaluated_index.emplace(node, to_evaluate.size()).second) {
+          to_evaluate.push_back(node);
+        }
+      }
+      if (to_evaluate.size() > 1) {
+        EvaluateFoldables(to_evaluate, pool.get(), &evaluated);
+      } else {
+        evaluated_index.clear();
+      }
+    }
     NodeDef* node = queue.front();
     queue.pop_front();
+    EvaluatedNode* node_evaluated = nullptr;
+    if (!evaluated_index.empty()) {
+      auto it = evaluated_index.find(node);
+      if (it != evaluated_index.end()) {
+        node_evaluated = &evaluated[it->second];
+        evaluated_index.erase(it);
+      }
+    }
     if (processed_nodes.count(node->name())) {
       continue;
     }
@@ -1654,7 +1750,8 @@ Status ConstantFolding::FoldGraph(
     std::vector<NodeDef*> fanout =
         node_map_->GetOutputsOrderedByNodeName(node->name());
     bool result_too_large = false;
-    Status s = FoldNode(node, optimized_graph, &result_too_large);
+    Status s =
+        FoldNode(node, optimized_graph, &result_too_large, node_evaluated);
     processed_nodes.insert(node->name());
     if (!s.ok()) {
       VLOG(1) << "Failed to fold node " << node->DebugString()
@@ -4028,6 +4125,7 @@ Status ConstantFolding::Optimize(Cluster* cluster, const GrapplerItem& item,
   port::ScopedFlushDenormal flush;
   port::ScopedSetRound round(FE_TONEAREST);
   nodes_to_preserve_ = item.NodesToPreserve();
+  bytes_added_ = 0;
   for (const auto& feed : item.feed) {
     feed_nodes_.insert(NodeName(feed.first));
   }
@@ -45,12 +45,19 @@ class ConstantFolding : public GraphOptimizer {
   static string AddControlDependency(const string& input_name, GraphDef* graph,
                                      NodeMap* node_map);
 
+  // If `num_threads` is greater than 1, the independent foldable nodes are
+  // evaluated in parallel on that many threads. If `budget_bytes` is positive,
+  // the constants created by folding may be larger than the constants they are
+  // folded from by at most that many bytes in total, while folds that don't
+  // grow the graph are not limited.
   explicit ConstantFolding(DeviceBase* cpu_device,
                            bool disable_compressed_tensor_optimization = false,
-                           bool fold_quantization_emulation = true);
+                           bool fold_quantization_emulation = true,
+                           int num_threads = 1, int64_t budget_bytes = 0);
   ConstantFolding(RewriterConfig::Toggle opt_level, DeviceBase* cpu_device,
                   bool disable_compressed_tensor_optimization = false,
-                  bool fold_quantization_emulation = true);
+                  bool fold_quantization_emulation = true, int num_threads = 1,
+                  int64_t budget_bytes = 0);
 
   ~ConstantFolding() override {}
 
@@ -95,9 +102,26 @@ class ConstantFolding : public GraphOptimizer {
   Status EvaluateOneFoldable(const NodeDef& node, std::vector<NodeDef>* outputs,
                              bool* result_too_large);
 
+  // The constants a foldable node evaluates to, by EvaluateOneFoldable().
+  struct EvaluatedNode {
+    Status status;
+    std::vector<NodeDef> const_nodes;
+    bool result_too_large = false;
+  };
+  // Evaluates the foldable non-Merge `nodes` in parallel on `pool`.
+  void EvaluateFoldables(absl::Span<NodeDef* const> nodes,
+                         thread::ThreadPool* pool,
+                         std::vector<EvaluatedNode>* evaluated);
+  // Returns approximately how many bytes larger the constants `const_nodes`
+  // that `node` evaluates to are than its constant inputs.
+  int64_t FoldedBytesAdded(const NodeDef& node,
+                           const std::vector<NodeDef>& const_nodes) const;
+
   Status FoldMergeNode(NodeDef* node, GraphDef* output_graph);
+  // Folds `node`, evaluating it unless `evaluated` is not null, in which case
+  // it holds the result of EvaluateFoldables() for `node`.
   Status FoldNode(NodeDef* node, GraphDef* output_graph,
-                  bool* result_too_large);
+                  bool* result_too_large, EvaluatedNode* evaluated = nullptr);
 
   bool IsOnes(const NodeDef& node) const;
   bool IsZeros(const NodeDef& node) const;
@@ -340,6 +364,10 @@ class ConstantFolding : public GraphOptimizer {
   bool graph_contains_assign_or_inplace_op_;
   bool disable_compressed_tensor_optimization_;
   bool fold_quantization_emulation_;
+  const int num_threads_;
+  const int64_t budget_bytes_;
+  // The bytes by which the folds so far grew the constants of the graph.
+  int64_t bytes_added_ = 0;
 };
 
 }  // end namespace grappler
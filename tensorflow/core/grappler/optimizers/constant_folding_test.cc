@@ -2929,6 +2929,75 @@ TEST_F(ConstantFoldingTest, LargeConstantNoSizeIncrease) {
   EXPECT_LT(output.ByteSizeLong(), sizeof(float) * large_constant_size + 500);
 }
 
+TEST_F(ConstantFoldingTest, ParallelFolding) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  GrapplerItem item;
+  for (int i = 0; i < 20; ++i) {
+    Output c = ops::Const(s.WithOpName(strings::StrCat("c", i)),
+                          static_cast<float>(i), {2});
+    Output add = ops::AddN(s.WithOpName(strings::StrCat("add", i)), {c, c});
+    Output mul = ops::Mul(s.WithOpName(strings::StrCat("mul", i)), add, c);
+    item.fetch.push_back(strings::StrCat("mul", i));
+  }
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ConstantFolding sequential_optimizer(/*cpu_device=*/nullptr);
+  GraphDef expected;
+  TF_EXPECT_OK(
+      sequential_optimizer.Optimize(/*cluster=*/nullptr, item, &expected));
+  ConstantFolding parallel_optimizer(
+      /*cpu_device=*/nullptr, /*disable_compressed_tensor_optimization=*/false,
+      /*fold_quantization_emulation=*/true, /*num_threads=*/4);
+  GraphDef output;
+  TF_EXPECT_OK(parallel_optimizer.Optimize(/*cluster=*/nullptr, item, &output));
+
+  EXPECT_EQ(output.node_size(), 20);
+  for (const NodeDef& node : output.node()) {
+    EXPECT_EQ(node.op(), "Const") << node.name();
+  }
+  CompareGraphs(expected, output);
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+  auto tensors = EvaluateNodes(output, item.fetch);
+  ASSERT_EQ(tensors.size(), tensors_expected.size());
+  for (int i = 0; i < tensors.size(); ++i) {
+    test::ExpectTensorEqual<float>(tensors_expected[i], tensors[i]);
+  }
+}
+
+TEST_F(ConstantFoldingTest, FoldingBudget) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  // Folding `range` adds about 4000 bytes of constants, while folding `sum`
+  // doesn't add any.
+  Output range = ops::Range(s.WithOpName("range"), 0.0f, 1000.0f, 1.0f);
+  Output values = ops::Const(s.WithOpName("values"), 2.0f, {1000});
+  Output sum = ops::Sum(s.WithOpName("sum"), values, 0);
+
+  GrapplerItem item;
+  item.fetch = {"range", "sum"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  for (int64_t budget_bytes : {100, 10000}) {
+    ConstantFolding optimizer(
+        /*cpu_device=*/nullptr,
+        /*disable_compressed_tensor_optimization=*/false,
+        /*fold_quantization_emulation=*/true, /*num_threads=*/1, budget_bytes);
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(/*cluster=*/nullptr, item, &output));
+    for (const NodeDef& node : output.node()) {
+      if (node.name() == "range") {
+        EXPECT_EQ(node.op(), budget_bytes == 100 ? "Range" : "Const");
+      } else if (node.name() == "sum") {
+        EXPECT_EQ(node.op(), "Const");
+      }
+    }
+    auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+    auto tensors = EvaluateNodes(output, item.fetch);
+    ASSERT_EQ(tensors.size(), 2);
+    test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+    test::ExpectTensorEqual<float>(tensors_expected[1], tensors[1]);
+  }
+}
+
 TEST_F(ConstantFoldingTest, MaterializeBroadcastGradientArgs) {
   tensorflow::Scope s = tensorflow::Scope::NewRootScope();
   Output a =
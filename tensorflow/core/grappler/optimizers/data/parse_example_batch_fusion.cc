@@ -0,0 +1,294 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/parse_example_batch_fusion.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/gtl/map_util.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kBatchDataset[] = "BatchDataset";
+constexpr char kBatchDatasetV2[] = "BatchDatasetV2";
+constexpr char kParallelBatchDataset[] = "ParallelBatchDataset";
+constexpr char kMapDataset[] = "MapDataset";
+constexpr char kParallelMapDataset[] = "ParallelMapDataset";
+constexpr char kParallelMapDatasetV2[] = "ParallelMapDatasetV2";
+constexpr char kParseExampleV2[] = "ParseExampleV2";
+constexpr char kOutputShapes[] = "_output_shapes";
+
+using FunctionNodes = absl::flat_hash_map<StringPiece, const NodeDef*>;
+
+bool IsBatch(const NodeDef& node) {
+  return node.op() == kBatchDataset || node.op() == kBatchDatasetV2 ||
+         node.op() == kParallelBatchDataset;
+}
+
+bool IsMap(const NodeDef& node) {
+  return node.op() == kMapDataset || node.op() == kParallelMapDataset ||
+         node.op() == kParallelMapDatasetV2;
+}
+
+// Returns true if the elements of `dataset` are scalar strings.
+bool ProducesScalarStrings(const NodeDef& dataset) {
+  DataTypeVector output_types;
+  if (!graph_utils::GetDatasetOutputTypesAttr(dataset, &output_types).ok() ||
+      output_types.size() != 1 || output_types[0] != DT_STRING) {
+    return false;
+  }
+  const auto* output_shapes = gtl::FindOrNull(dataset.attr(), "output_shapes");
+  if (output_shapes == nullptr || output_shapes->list().shape_size() != 1) {
+    return false;
+  }
+  const auto& shape = output_shapes->list().shape(0);
+  return !shape.unknown_rank() && shape.dim_size() == 0;
+}
+
+// Returns the name of the node producing `tensor` in a function body. Function
+// inputs are referred to by their name and node outputs as
+// "node:output_name:index".
+StringPiece GetNodeName(StringPiece tensor) {
+  return tensor.substr(0, tensor.find(':'));
+}
+
+// Follows the chain of `Identity` ops producing `tensor` and returns the tensor
+// they forward.
+string SkipIdentities(const FunctionNodes& nodes, string tensor) {
+  auto it = nodes.find(GetNodeName(tensor));
+  while (it != nodes.end() && it->second->op() == "Identity") {
+    tensor = it->second->input(0);
+    it = nodes.find(GetNodeName(tensor));
+  }
+  return tensor;
+}
+
+// Returns true if `tensor` is produced by a `Const` op of no elements.
+bool IsEmptyConstant(const FunctionNodes& nodes, StringPiece tensor) {
+  const NodeDef* const* node = gtl::FindOrNull(nodes, GetNodeName(tensor));
+  if (node == nullptr || (*node)->op() != "Const") return false;
+  const auto* value = gtl::FindOrNull((*node)->attr(), "value");
+  return value != nullptr &&
+         PartialTensorShape(value->tensor().tensor_shape()).num_elements() == 0;
+}
+
+// Returns true if `function` consists of a single `ParseExampleV2` op applied
+// to the first function input, whose outputs are fixed-length dense features
+// returned by the function. For such a function, parsing a batch of serialized
+// protos produces the same result as batching the parsed protos.
+bool IsFusableParseFunction(const FunctionDef& function) {
+  const auto& signature = function.signature();
+  if (signature.input_arg_size() < 1 ||
+      signature.input_arg(0).type() != DT_STRING) {
+    return false;
+  }
+
+  const NodeDef* parse_node = nullptr;
+  FunctionNodes nodes;
+  for (const NodeDef& node : function.node_def()) {
+    if (node.op() == kParseExampleV2) {
+      if (parse_node != nullptr) return false;
+      parse_node = &node;
+    } else if (node.op() != "Const" && node.op() != "Identity") {
+      return false;
+    }
+    nodes[node.name()] = &node;
+  }
+  if (parse_node == nullptr) return false;
+
+  // Sparse and ragged features are laid out differently when parsed as a batch.
+  const auto* num_sparse = gtl::FindOrNull(parse_node->attr(), "num_sparse");
+  const auto* ragged_value_types =
+      gtl::FindOrNull(parse_node->attr(), "ragged_value_types");
+  const auto* dense_shapes =
+      gtl::FindOrNull(parse_node->attr(), "dense_shapes");
+  if (num_sparse == nullptr || num_sparse->i() != 0 ||
+      ragged_value_types == nullptr ||
+      ragged_value_types->list().type_size() != 0 || dense_shapes == nullptr) {
+    return false;
+  }
+  // Variable-length dense features are padded to the longest element when
+  // parsed as a batch, whereas batching them fails if their lengths differ.
+  for (const auto& shape : dense_shapes->list().shape()) {
+    if (!PartialTensorShape(shape).IsFullyDefined()) return false;
+  }
+
+  // Only the `serialized` input may depend on the element being parsed.
+  const string& element = signature.input_arg(0).name();
+  for (int i = 0; i < parse_node->input_size(); ++i) {
+    if (IsControlInput(parse_node->input(i))) continue;
+    bool is_element = SkipIdentities(nodes, parse_node->input(i)) == element;
+    if (is_element != (i == 0)) return false;
+  }
+  // The `names` of the protos must be empty: the names of a single proto are
+  // not those of a batch, which ParseExampleV2 rejects as an InvalidArgument.
+  if (parse_node->input_size() < 2 ||
+      !IsEmptyConstant(nodes, SkipIdentities(nodes, parse_node->input(1)))) {
+    return false;
+  }
+
+  // All outputs of the function must be parsed dense features.
+  const string dense_values = strings::StrCat(parse_node->name(),
+                                              ":dense_values:");
+  for (const auto& output : signature.output_arg()) {
+    const auto* ret = gtl::FindOrNull(function.ret(), output.name());
+    if (ret == nullptr ||
+        !absl::StartsWith(SkipIdentities(nodes, *ret), dense_values)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Copies `function` into `library` under a new name and removes the shape
+// annotations that assume it is applied to scalar serialized protos.
+const FunctionDef* AddBatchedParseFunction(const FunctionDef& function,
+                                           FunctionDefLibrary* library) {
+  FunctionDef* batched_function = library->add_function();
+  *batched_function = function;
+  graph_utils::SetUniqueGraphFunctionName(
+      strings::StrCat(function.signature().name(), "_batched"), library,
+      batched_function);
+  auto it = batched_function->mutable_arg_attr()->find(0);
+  if (it != batched_function->mutable_arg_attr()->end()) {
+    it->second.mutable_attr()->erase(kOutputShapes);
+  }
+  for (NodeDef& node : *batched_function->mutable_node_def()) {
+    node.mutable_attr()->erase(kOutputShapes);
+  }
+  return batched_function;
+}
+
+// Returns the size of the batch dimension produced by `batch_node`, or -1 if it
+// is unknown.
+int64_t GetBatchDimension(const NodeDef& batch_node) {
+  const auto* output_shapes =
+      gtl::FindOrNull(batch_node.attr(), "output_shapes");
+  if (output_shapes == nullptr || output_shapes->list().shape_size() == 0) {
+    return -1;
+  }
+  const auto& shape = output_shapes->list().shape(0);
+  if (shape.unknown_rank() || shape.dim_size() == 0) return -1;
+  return shape.dim(0).size();
+}
+
+// Makes a batch node identical to `batch_node` which batches the input of
+// `map_node`, i.e. the serialized protos.
+NodeDef MakeBatchNode(const NodeDef& map_node, const NodeDef& batch_node,
+                      MutableGraphView* graph) {
+  NodeDef new_node = batch_node;
+  graph_utils::SetUniqueGraphNodeName(batch_node.op(), graph->graph(),
+                                      &new_node);
+  new_node.set_input(0, map_node.input(0));
+
+  AttrValue output_types;
+  output_types.mutable_list()->add_type(DT_STRING);
+  (*new_node.mutable_attr())["output_types"] = std::move(output_types);
+  AttrValue output_shapes;
+  PartialTensorShape({GetBatchDimension(batch_node)})
+      .AsProto(output_shapes.mutable_list()->add_shape());
+  (*new_node.mutable_attr())["output_shapes"] = std::move(output_shapes);
+  return new_node;
+}
+
+// Makes a map node identical to `map_node` which applies `function` to the
+// output of `new_batch_node` and produces the elements of `batch_node`.
+NodeDef MakeMapNode(const NodeDef& map_node, const NodeDef& batch_node,
+                    const NodeDef& new_batch_node, const FunctionDef& function,
+                    MutableGraphView* graph) {
+  NodeDef new_node = map_node;
+  graph_utils::SetUniqueGraphNodeName(map_node.op(), graph->graph(),
+                                      &new_node);
+  new_node.set_input(0, new_batch_node.name());
+  (*new_node.mutable_attr())["f"].mutable_func()->set_name(
+      function.signature().name());
+  graph_utils::CopyShapesAndTypesAttrs(batch_node, &new_node);
+  return new_node;
+}
+
+}  // namespace
+
+Status ParseExampleBatchFusion::OptimizeAndCollectStats(
+    Cluster* cluster, const GrapplerItem& item, GraphDef* output,
+    OptimizationStats* stats) {
+  *output = item.graph;
+  MutableGraphView graph(output);
+  absl::flat_hash_set<string> nodes_to_delete;
+  FunctionLibraryDefinition function_library(OpRegistry::Global(),
+                                             item.graph.library());
+
+  for (const NodeDef& node : item.graph.node()) {
+    if (!IsBatch(node)) continue;
+
+    // Use a more descriptive variable name now that we know the node type.
+    const NodeDef& batch_node = node;
+    NodeDef* input_node = graph_utils::GetInputNode(batch_node, graph);
+    if (input_node == nullptr || !IsMap(*input_node)) continue;
+    // The parsed elements must not be consumed by anything but the batch.
+    if (graph.NumFanouts(*input_node, /*include_controlled_nodes=*/true) != 1) {
+      continue;
+    }
+    const NodeDef map_node = *input_node;
+    NodeDef* dataset_node = graph_utils::GetInputNode(map_node, graph);
+    if (dataset_node == nullptr || !ProducesScalarStrings(*dataset_node)) {
+      continue;
+    }
+
+    const auto* f = gtl::FindOrNull(map_node.attr(), "f");
+    if (f == nullptr) continue;
+    const FunctionDef* function = function_library.Find(f->func().name());
+    if (function == nullptr || !IsFusableParseFunction(*function)) continue;
+
+    const FunctionDef* batched_function =
+        AddBatchedParseFunction(*function, output->mutable_library());
+    TF_RETURN_IF_ERROR(function_library.AddFunctionDef(*batched_function));
+
+    NodeDef* new_batch_node =
+        graph.AddNode(MakeBatchNode(map_node, batch_node, &graph));
+    NodeDef* new_map_node = graph.AddNode(MakeMapNode(
+        map_node, batch_node, *new_batch_node, *batched_function, &graph));
+    TF_RETURN_IF_ERROR(
+        graph.UpdateFanouts(batch_node.name(), new_map_node->name()));
+
+    // Mark the original `Map` and `Batch` nodes for removal.
+    nodes_to_delete.insert(map_node.name());
+    nodes_to_delete.insert(batch_node.name());
+    stats->num_changes++;
+  }
+
+  TF_RETURN_IF_ERROR(graph.DeleteNodes(nodes_to_delete));
+  return OkStatus();
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(ParseExampleBatchFusion,
+                            "parse_example_batch_fusion");
+
+}  // namespace grappler
+}  // namespace tensorflow
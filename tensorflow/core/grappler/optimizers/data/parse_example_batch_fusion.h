@@ -0,0 +1,60 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_PARSE_EXAMPLE_BATCH_FUSION_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_PARSE_EXAMPLE_BATCH_FUSION_H_
+
+#include "tensorflow/core/grappler/optimizers/data/optimizer_base.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// This optimization moves the parsing of `tf.Example` protos across a batch
+// transformation, rewriting
+//
+//   input.map(parse_fn).batch(batch_size)
+//
+// into
+//
+//   input.batch(batch_size).map(parse_fn)
+//
+// so that `ParseExampleV2` parses a whole batch of serialized protos at once
+// instead of one proto at a time. The rewrite is only applied when `parse_fn`
+// consists of a single `ParseExampleV2` op applied to its input with no
+// `names` and returning fixed-length dense features, for which parsing a batch
+// produces the same result as batching the parsed elements.
+class ParseExampleBatchFusion : public TFDataOptimizerBase {
+ public:
+  ParseExampleBatchFusion() = default;
+  ~ParseExampleBatchFusion() override = default;
+
+  string name() const override { return "parse_example_batch_fusion"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(
+      const tensorflow::RewriterConfig_CustomGraphOptimizer* config) override {
+    return OkStatus();
+  }
+
+  Status OptimizeAndCollectStats(Cluster* cluster, const GrapplerItem& item,
+                                 GraphDef* output,
+                                 OptimizationStats* stats) override;
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_PARSE_EXAMPLE_BATCH_FUSION_H_
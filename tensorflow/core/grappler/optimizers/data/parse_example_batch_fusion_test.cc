@@ -0,0 +1,171 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/parse_example_batch_fusion.h"
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_test_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using graph_tests_utils::MakeBatchV2Node;
+using graph_tests_utils::MakeMapNode;
+using test::function::NDef;
+
+// Returns a function parsing a single feature of shape `dense_shape` from a
+// serialized `tf.Example` proto named `names`, along with `num_sparse` sparse
+// features.
+FunctionDef ParseFunction(const PartialTensorShape& dense_shape,
+                          int64_t num_sparse,
+                          const Tensor& names = Tensor(DT_STRING,
+                                                       TensorShape({0}))) {
+  const Tensor empty(DT_STRING, TensorShape({0}));
+  return FunctionDefHelper::Create(
+      "ParseFn", {"serialized: string"}, {"dense: float"}, {},
+      {{{"names"}, "Const", {}, {{"value", names}, {"dtype", DT_STRING}}},
+       {{"sparse_keys"}, "Const", {}, {{"value", empty}, {"dtype", DT_STRING}}},
+       {{"dense_keys"},
+        "Const",
+        {},
+        {{"value", test::AsTensor<tstring>({"feature"})},
+         {"dtype", DT_STRING}}},
+       {{"ragged_keys"}, "Const", {}, {{"value", empty}, {"dtype", DT_STRING}}},
+       {{"dense_default"},
+        "Const",
+        {},
+        {{"value", Tensor(DT_FLOAT, TensorShape({0}))}, {"dtype", DT_FLOAT}}},
+       {{"serialized_identity"}, "Identity", {"serialized"}, {{"T", DT_STRING}}},
+       {{"parse"},
+        "ParseExampleV2",
+        {"serialized_identity:output:0", "names:output:0",
+         "sparse_keys:output:0", "dense_keys:output:0", "ragged_keys:output:0",
+         "dense_default:output:0"},
+        {{"Tdense", DataTypeSlice{DT_FLOAT}},
+         {"num_sparse", num_sparse},
+         {"sparse_types", DataTypeSlice{}},
+         {"ragged_value_types", DataTypeSlice{}},
+         {"ragged_split_types", DataTypeSlice{}},
+         {"dense_shapes", gtl::ArraySlice<PartialTensorShape>{dense_shape}}}}},
+      {{"dense", "parse:dense_values:0"}});
+}
+
+GraphDef MakeGraph(const FunctionDef& function) {
+  return test::function::GDef(
+      {NDef("records", "Const", {},
+            {{"value", test::AsTensor<tstring>({"a", "b"})},
+             {"dtype", DT_STRING}}),
+       NDef("slices", "TensorSliceDataset", {"records"},
+            {{"Toutput_types", DataTypeSlice{DT_STRING}},
+             {"output_shapes", gtl::ArraySlice<TensorShape>{TensorShape({})}}}),
+       MakeMapNode("map", "slices", function.signature().name()),
+       NDef("batch_size", "Const", {}, {{"value", 5}, {"dtype", DT_INT64}}),
+       NDef("drop_remainder", "Const", {},
+            {{"value", false}, {"dtype", DT_BOOL}}),
+       MakeBatchV2Node("batch", "map", "batch_size", "drop_remainder",
+                       /*parallel_copy=*/false),
+       NDef("Sink", "Identity", {"batch"}, {})},
+      {function});
+}
+
+TEST(ParseExampleBatchFusionTest, MoveParseAcrossBatch) {
+  GrapplerItem item;
+  item.graph = MakeGraph(ParseFunction(PartialTensorShape({2}), 0));
+
+  ParseExampleBatchFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("batch", output));
+
+  // The serialized protos are batched first.
+  int batch_index = graph_utils::FindGraphNodeWithOp("BatchDatasetV2", output);
+  ASSERT_GE(batch_index, 0);
+  const NodeDef& batch_node = output.node(batch_index);
+  EXPECT_EQ(batch_node.input(0), "slices");
+  EXPECT_EQ(batch_node.input(1), "batch_size");
+  EXPECT_EQ(batch_node.input(2), "drop_remainder");
+  ASSERT_EQ(batch_node.attr().at("output_types").list().type_size(), 1);
+  EXPECT_EQ(batch_node.attr().at("output_types").list().type(0), DT_STRING);
+
+  // The whole batch is then parsed at once.
+  int map_index = graph_utils::FindGraphNodeWithOp("MapDataset", output);
+  ASSERT_GE(map_index, 0);
+  const NodeDef& map_node = output.node(map_index);
+  EXPECT_EQ(map_node.input(0), batch_node.name());
+  const string& function_name = map_node.attr().at("f").func().name();
+  EXPECT_NE(function_name, "ParseFn");
+  EXPECT_TRUE(
+      graph_utils::ContainsGraphFunctionWithName(function_name, output.library()));
+
+  int sink_index = graph_utils::FindGraphNodeWithName("Sink", output);
+  EXPECT_EQ(output.node(sink_index).input(0), map_node.name());
+}
+
+TEST(ParseExampleBatchFusionTest, DoNotMoveSparseParseAcrossBatch) {
+  GrapplerItem item;
+  item.graph = MakeGraph(ParseFunction(PartialTensorShape({2}), 1));
+
+  ParseExampleBatchFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+}
+
+TEST(ParseExampleBatchFusionTest, DoNotMoveVariableLengthParseAcrossBatch) {
+  GrapplerItem item;
+  item.graph = MakeGraph(ParseFunction(PartialTensorShape({-1}), 0));
+
+  ParseExampleBatchFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+}
+
+TEST(ParseExampleBatchFusionTest, DoNotMoveNamedParseAcrossBatch) {
+  GrapplerItem item;
+  item.graph = MakeGraph(ParseFunction(PartialTensorShape({2}), 0,
+                                       test::AsScalar<tstring>("record")));
+
+  ParseExampleBatchFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+}
+
+TEST(ParseExampleBatchFusionTest, DoNotMoveOtherFunctionsAcrossBatch) {
+  GrapplerItem item;
+  item.graph = MakeGraph(test::function::XTimesTwo());
+
+  ParseExampleBatchFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
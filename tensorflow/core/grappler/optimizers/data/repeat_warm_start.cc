@@ -0,0 +1,351 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/repeat_warm_start.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "absl/algorithm/container.h"
+#include "absl/strings/match.h"
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/function_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kCacheDataset[] = "CacheDataset";
+constexpr char kRepeatDataset[] = "RepeatDataset";
+
+// The most memory an epoch of the input may take to be cached.
+constexpr int64_t kMaxCachedBytes = int64_t{256} << 20;
+
+// Datasets which produce the same elements in every epoch as long as their
+// inputs do and the functions they apply are stateless.
+constexpr std::array<const char*, 20> kPureDatasets = {
+    "BatchDataset",
+    "ConcatenateDataset",
+    "FilterDataset",
+    "FlatMapDataset",
+    "InterleaveDataset",
+    "MapAndBatchDataset",
+    "MapDataset",
+    "PaddedBatchDataset",
+    "ParallelBatchDataset",
+    "ParallelInterleaveDataset",
+    "ParallelMapDataset",
+    "PrefetchDataset",
+    "RangeDataset",
+    "SkipDataset",
+    "SparseTensorSliceDataset",
+    "TakeDataset",
+    "TensorDataset",
+    "TensorSliceDataset",
+    "UnbatchDataset",
+    "ZipDataset",
+};
+
+// Conservatively treats any op mentioning datasets as a dataset.
+bool IsDataset(const NodeDef& node) {
+  return absl::StrContains(node.op(), "Dataset");
+}
+
+bool IsPureDataset(const NodeDef& node) {
+  return absl::c_any_of(kPureDatasets, [&node](const char* dataset) {
+    return data::MatchesAnyVersion(dataset, node.op());
+  });
+}
+
+// Returns true if `node` passes resources to its functions, e.g. a lookup
+// table or a variable, whose contents may change between epochs.
+bool CapturesResources(const NodeDef& node) {
+  for (const auto& attr : node.attr()) {
+    for (int type : attr.second.list().type()) {
+      if (type == DT_RESOURCE) return true;
+    }
+  }
+  return false;
+}
+
+bool IsPureFunction(const FunctionLibraryDefinition& library,
+                    const string& function_name);
+
+// Returns true if the functions in the attributes of `node` are pure.
+bool HasPureFunctions(const FunctionLibraryDefinition& library,
+                      const NodeDef& node) {
+  for (const auto& attr : node.attr()) {
+    if (attr.second.has_func() &&
+        !IsPureFunction(library, attr.second.func().name())) {
+      return false;
+    }
+    for (const auto& func : attr.second.list().func()) {
+      if (!IsPureFunction(library, func.name())) return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if `function` is stateless and only creates pure datasets, e.g.
+// in the function of a `flat_map`.
+bool IsPureFunction(const FunctionLibraryDefinition& library,
+                    const string& function_name) {
+  const FunctionDef* function = library.Find(function_name);
+  if (function == nullptr ||
+      function_utils::IsFunctionStateful(library, *function)) {
+    return false;
+  }
+  for (const auto& arg : function->signature().input_arg()) {
+    if (arg.type() == DT_RESOURCE) return false;
+  }
+  for (const NodeDef& node : function->node_def()) {
+    if (IsDataset(node) && (!IsPureDataset(node) || CapturesResources(node))) {
+      return false;
+    }
+    if (!HasPureFunctions(library, node)) return false;
+  }
+  return true;
+}
+
+// Returns true if the dataset produced by `node` produces the same elements in
+// every epoch.
+bool IsPureInput(const FunctionLibraryDefinition& library,
+                 const MutableGraphView& graph, const NodeDef& node) {
+  if (!IsPureDataset(node) || CapturesResources(node) ||
+      !HasPureFunctions(library, node)) {
+    return false;
+  }
+  for (const string& input : node.input()) {
+    if (IsControlInput(input)) continue;
+    const NodeDef* input_node = graph.GetNode(NodeName(input));
+    if (input_node == nullptr) return false;
+    if (IsDataset(*input_node)) {
+      if (!IsPureInput(library, graph, *input_node)) return false;
+    } else if (function_utils::IsNodeStateful(library, *input_node)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads the scalar constant input `index` of `node` into `value`.
+bool GetConstInput(const MutableGraphView& graph, const NodeDef& node,
+                   int index, int64_t* value) {
+  const NodeDef* input = graph_utils::GetInputNode(node, graph, index);
+  return input != nullptr &&
+         graph_utils::GetScalarConstNodeValue(*input, value).ok();
+}
+
+// Returns an upper bound of the number of elements of the pure dataset
+// produced by `node`, or data::kUnknownCardinality if it is not known
+// statically.
+int64_t MaxCardinality(const MutableGraphView& graph, const NodeDef& node) {
+  const string& op = node.op();
+  auto input_cardinality = [&graph, &node](int index) {
+    const NodeDef* input = graph_utils::GetInputNode(node, graph, index);
+    return input == nullptr ? data::kUnknownCardinality
+                            : MaxCardinality(graph, *input);
+  };
+  int64_t value;
+  if (op == "TensorDataset") return 1;
+  if (op == "TensorSliceDataset") {
+    const NodeDef* component = graph_utils::GetInputNode(node, graph, 0);
+    if (component == nullptr || component->op() != "Const" ||
+        !component->attr().contains("value")) {
+      return data::kUnknownCardinality;
+    }
+    const TensorShapeProto& shape =
+        component->attr().at("value").tensor().tensor_shape();
+    return shape.dim_size() > 0 ? shape.dim(0).size()
+                                : data::kUnknownCardinality;
+  }
+  if (op == "RangeDataset") {
+    int64_t start, stop, step;
+    if (!GetConstInput(graph, node, 0, &start) ||
+        !GetConstInput(graph, node, 1, &stop) ||
+        !GetConstInput(graph, node, 2, &step) || step == 0) {
+      return data::kUnknownCardinality;
+    }
+    const int64_t size = step > 0 ? (stop - start + step - 1) / step
+                                  : (start - stop - step - 1) / -step;
+    return std::max<int64_t>(size, 0);
+  }
+  if (data::MatchesAnyVersion("MapDataset", op) ||
+      data::MatchesAnyVersion("ParallelMapDataset", op) ||
+      data::MatchesAnyVersion("FilterDataset", op) ||
+      data::MatchesAnyVersion("PrefetchDataset", op)) {
+    return input_cardinality(0);
+  }
+  if (data::MatchesAnyVersion("BatchDataset", op) ||
+      data::MatchesAnyVersion("PaddedBatchDataset", op) ||
+      data::MatchesAnyVersion("ParallelBatchDataset", op) ||
+      data::MatchesAnyVersion("MapAndBatchDataset", op)) {
+    // The batch size of MapAndBatchDataset follows the captured inputs of its
+    // function, and precedes num_parallel_calls and drop_remainder.
+    const int batch_size_index =
+        data::MatchesAnyVersion("MapAndBatchDataset", op)
+            ? NumNonControlInputs(node) - 3
+            : 1;
+    const int64_t cardinality = input_cardinality(0);
+    if (cardinality < 0 ||
+        !GetConstInput(graph, node, batch_size_index, &value) || value <= 0) {
+      return data::kUnknownCardinality;
+    }
+    return (cardinality + value - 1) / value;
+  }
+  if (data::MatchesAnyVersion("TakeDataset", op)) {
+    const int64_t cardinality = input_cardinality(0);
+    if (!GetConstInput(graph, node, 1, &value)) return cardinality;
+    if (value < 0) return cardinality;
+    return cardinality < 0 ? value : std::min(cardinality, value);
+  }
+  if (data::MatchesAnyVersion("SkipDataset", op)) {
+    const int64_t cardinality = input_cardinality(0);
+    if (cardinality < 0 || !GetConstInput(graph, node, 1, &value)) {
+      return data::kUnknownCardinality;
+    }
+    return value < 0 ? 0 : std::max<int64_t>(cardinality - value, 0);
+  }
+  if (data::MatchesAnyVersion("ZipDataset", op)) {
+    int64_t cardinality = data::kUnknownCardinality;
+    for (int i = 0; i < NumNonControlInputs(node); ++i) {
+      const int64_t input = input_cardinality(i);
+      if (input >= 0 && (cardinality < 0 || input < cardinality)) {
+        cardinality = input;
+      }
+    }
+    return cardinality;
+  }
+  if (data::MatchesAnyVersion("ConcatenateDataset", op)) {
+    const int64_t first = input_cardinality(0);
+    const int64_t second = input_cardinality(1);
+    return first < 0 || second < 0 ? data::kUnknownCardinality
+                                   : first + second;
+  }
+  return data::kUnknownCardinality;
+}
+
+// Returns the number of bytes of an element of the dataset produced by `node`,
+// or -1 if its components are not of fixed sizes, e.g. strings.
+int64_t ElementBytes(const NodeDef& node) {
+  if (!node.attr().contains("output_shapes") ||
+      !node.attr().contains("output_types")) {
+    return -1;
+  }
+  const auto& shapes = node.attr().at("output_shapes").list().shape();
+  const auto& types = node.attr().at("output_types").list().type();
+  if (shapes.size() != types.size()) return -1;
+  int64_t bytes = 0;
+  for (int i = 0; i < shapes.size(); ++i) {
+    const PartialTensorShape shape(shapes[i]);
+    const DataType type = static_cast<DataType>(types[i]);
+    if (!shape.IsFullyDefined() || !DataTypeCanUseMemcpy(type)) return -1;
+    bytes += shape.num_elements() * DataTypeSize(type);
+  }
+  return bytes;
+}
+
+// Makes a node caching the output of `input_name` in memory.
+NodeDef MakeCacheNode(string input_name, const NodeDef& repeat_node,
+                      MutableGraphView* graph) {
+  NodeDef cache_node;
+  graph_utils::SetUniqueGraphNodeName(
+      strings::StrCat("repeat_warm_start/cache_", input_name), graph->graph(),
+      &cache_node);
+  cache_node.set_op(kCacheDataset);
+  cache_node.add_input(input_name);
+  // An empty filename caches the elements in memory.
+  cache_node.add_input(
+      graph_utils::AddScalarConstNode(StringPiece(""), graph)->name());
+  graph_utils::CopyShapesAndTypesAttrs(repeat_node, &cache_node);
+  return cache_node;
+}
+
+}  // namespace
+
+Status RepeatWarmStart::OptimizeAndCollectStats(Cluster* cluster,
+                                                const GrapplerItem& item,
+                                                GraphDef* output,
+                                                OptimizationStats* stats) {
+  *output = item.graph;
+  MutableGraphView graph(output);
+
+  // If the GrapplerItem is derived from a FunctionDef, we don't optimize it,
+  // since its datasets are recreated whenever the function is called.
+  if (graph_utils::IsItemDerivedFromFunctionDef(item, graph)) {
+    return OkStatus();
+  }
+
+  FunctionLibraryDefinition function_library(OpRegistry::Global(),
+                                             item.graph.library());
+  for (const NodeDef& node : item.graph.node()) {
+    if (node.op() != kRepeatDataset) continue;
+
+    // Use a more descriptive variable name now that we know the node type.
+    const NodeDef& repeat_node = node;
+    // Caching only pays off if the input is iterated more than once.
+    const NodeDef* count_node = graph.GetNode(NodeName(repeat_node.input(1)));
+    int64_t count;
+    if (count_node != nullptr &&
+        graph_utils::GetScalarConstNodeValue(*count_node, &count).ok() &&
+        count >= 0 && count <= 1) {
+      continue;
+    }
+    const NodeDef* input_node = graph_utils::GetInputNode(repeat_node, graph);
+    if (input_node == nullptr ||
+        !IsPureInput(function_library, graph, *input_node)) {
+      continue;
+    }
+    // The whole epoch is held in memory, so it has to be small enough.
+    const int64_t cardinality = MaxCardinality(graph, *input_node);
+    const int64_t element_bytes = ElementBytes(repeat_node);
+    if (cardinality < 0 || element_bytes < 0 ||
+        cardinality > kMaxCachedBytes / std::max<int64_t>(element_bytes, 1)) {
+      VLOG(2) << "Not caching the input of " << repeat_node.name()
+              << " of cardinality " << cardinality << " and elements of "
+              << element_bytes << " bytes";
+      continue;
+    }
+
+    NodeDef cache_node =
+        MakeCacheNode(input_node->name(), repeat_node, &graph);
+    TF_RETURN_IF_ERROR(
+        graph_utils::SetMetadataName(cache_node.name(), &cache_node));
+    NodeDef* added_node = graph.AddNode(std::move(cache_node));
+    TF_RETURN_IF_ERROR(graph.UpdateRegularFaninByPort(
+        repeat_node.name(), 0, {added_node->name(), 0}));
+    stats->num_changes++;
+  }
+  return OkStatus();
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(RepeatWarmStart, "repeat_warm_start");
+
+}  // namespace grappler
+}  // namespace tensorflow
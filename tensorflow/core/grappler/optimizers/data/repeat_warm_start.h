@@ -0,0 +1,60 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_REPEAT_WARM_START_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_REPEAT_WARM_START_H_
+
+#include "tensorflow/core/grappler/optimizers/data/optimizer_base.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// This optimization caches the input of a repeat transformation in memory when
+// every epoch of the input produces the same elements, rewriting
+//
+//   input.repeat(count)
+//
+// into
+//
+//   input.cache().repeat(count)
+//
+// so that the input is only computed once. The rewrite is only applied when
+// the input is built from in-memory sources and transformations applying
+// stateless functions which capture no resources, e.g. `range`, `map` and
+// `batch`, is not already cached, and an epoch of it is known statically to
+// take at most 256MiB.
+class RepeatWarmStart : public TFDataOptimizerBase {
+ public:
+  RepeatWarmStart() = default;
+  ~RepeatWarmStart() override = default;
+
+  string name() const override { return "repeat_warm_start"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(
+      const tensorflow::RewriterConfig_CustomGraphOptimizer* config) override {
+    return OkStatus();
+  }
+
+  Status OptimizeAndCollectStats(Cluster* cluster, const GrapplerItem& item,
+                                 GraphDef* output,
+                                 OptimizationStats* stats) override;
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_REPEAT_WARM_START_H_
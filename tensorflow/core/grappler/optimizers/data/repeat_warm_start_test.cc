@@ -0,0 +1,152 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/repeat_warm_start.h"
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_test_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using graph_tests_utils::MakeMapNode;
+using test::function::NDef;
+
+NodeDef MakeScalarNode(StringPiece name, int64_t value) {
+  return NDef(name, "Const", {},
+              {{"value", test::AsScalar<int64_t>(value)}, {"dtype", DT_INT64}});
+}
+
+// Returns an item for `range(stop).map(function).repeat(count)`.
+GrapplerItem MakeItem(const FunctionDef& function, int64_t count,
+                      int64_t stop = 10) {
+  GrapplerItem item;
+  item.graph = test::function::GDef(
+      {MakeScalarNode("start", 0), MakeScalarNode("stop", stop),
+       MakeScalarNode("step", 1),
+       NDef("range", "RangeDataset", {"start", "stop", "step"}, {}),
+       MakeMapNode("map", "range", function.signature().name()),
+       MakeScalarNode("count", count),
+       NDef("repeat", "RepeatDataset", {"map", "count"},
+            {{"output_shapes", gtl::ArraySlice<TensorShape>{{}}},
+             {"output_types", gtl::ArraySlice<DataType>{DT_INT64}}}),
+       NDef("Sink", "Identity", {"repeat"}, {})},
+      {function});
+  item.fetch.push_back("Sink");
+  return item;
+}
+
+TEST(RepeatWarmStartTest, CachePureInput) {
+  GrapplerItem item = MakeItem(test::function::XTimesTwo(), /*count=*/-1);
+
+  RepeatWarmStart optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  int cache_index = graph_utils::FindGraphNodeWithOp("CacheDataset", output);
+  ASSERT_GE(cache_index, 0);
+  const NodeDef& cache_node = output.node(cache_index);
+  EXPECT_EQ(cache_node.input(0), "map");
+  int filename_index =
+      graph_utils::FindGraphNodeWithName(cache_node.input(1), output);
+  ASSERT_GE(filename_index, 0);
+  const TensorProto& filename =
+      output.node(filename_index).attr().at("value").tensor();
+  ASSERT_EQ(filename.string_val_size(), 1);
+  EXPECT_EQ(filename.string_val(0), "");
+
+  int repeat_index = graph_utils::FindGraphNodeWithName("repeat", output);
+  EXPECT_EQ(output.node(repeat_index).input(0), cache_node.name());
+}
+
+TEST(RepeatWarmStartTest, DoNotCacheStatefulInput) {
+  GrapplerItem item = MakeItem(test::function::RandomUniform(), /*count=*/-1);
+
+  RepeatWarmStart optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_FALSE(graph_utils::ContainsNodeWithOp("CacheDataset", output));
+}
+
+TEST(RepeatWarmStartTest, DoNotCacheSingleEpoch) {
+  GrapplerItem item = MakeItem(test::function::XTimesTwo(), /*count=*/1);
+
+  RepeatWarmStart optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_FALSE(graph_utils::ContainsNodeWithOp("CacheDataset", output));
+}
+
+TEST(RepeatWarmStartTest, DoNotCacheLargeInput) {
+  // An epoch of 8GiB.
+  GrapplerItem item = MakeItem(test::function::XTimesTwo(), /*count=*/-1,
+                               /*stop=*/int64_t{1} << 30);
+
+  RepeatWarmStart optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_FALSE(graph_utils::ContainsNodeWithOp("CacheDataset", output));
+}
+
+TEST(RepeatWarmStartTest, DoNotCacheResourceCaptures) {
+  GrapplerItem item = MakeItem(test::function::XTimesTwo(), /*count=*/-1);
+  // E.g. a lookup table whose contents may change between epochs.
+  *item.graph.add_node() =
+      NDef("table", "Placeholder", {}, {{"dtype", DT_RESOURCE}});
+  const int map_index = graph_utils::FindGraphNodeWithName("map", item.graph);
+  NodeDef* map_node = item.graph.mutable_node(map_index);
+  map_node->add_input("table");
+  (*map_node->mutable_attr())["Targuments"].mutable_list()->add_type(
+      DT_RESOURCE);
+
+  RepeatWarmStart optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_FALSE(graph_utils::ContainsNodeWithOp("CacheDataset", output));
+}
+
+TEST(RepeatWarmStartTest, DoNotCacheShuffledInput) {
+  GrapplerItem item;
+  item.graph = test::function::GDef(
+      {NDef("start", "Const", {}, {{"value", 0}, {"dtype", DT_INT32}}),
+       NDef("stop", "Const", {}, {{"value", 10}, {"dtype", DT_INT32}}),
+       NDef("step", "Const", {}, {{"value", 1}, {"dtype", DT_INT32}}),
+       NDef("range", "RangeDataset", {"start", "stop", "step"}, {}),
+       NDef("buffer_size", "Const", {}, {{"value", 10}, {"dtype", DT_INT64}}),
+       NDef("seed", "Const", {}, {{"value", 0}, {"dtype", DT_INT64}}),
+       NDef("shuffle", "ShuffleDataset",
+            {"range", "buffer_size", "seed", "seed"},
+            {{"reshuffle_each_iteration", true}}),
+       NDef("count", "Const", {}, {{"value", -1}, {"dtype", DT_INT64}}),
+       NDef("repeat", "RepeatDataset", {"shuffle", "count"}, {}),
+       NDef("Sink", "Identity", {"repeat"}, {})},
+      {});
+  item.fetch.push_back("Sink");
+
+  RepeatWarmStart optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_FALSE(graph_utils::ContainsNodeWithOp("CacheDataset", output));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -22,6 +22,8 @@ limitations under the License.
 #include <unordered_set>
 #include <vector>
 
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/common_runtime/device.h"
@@ -546,6 +548,110 @@ Status RemoveStackOps(const std::unordered_set<string>& nodes_to_preserve,
   return OkStatus();
 }
 
+// Returns whether the op updates the TensorList of its first input in place
+// when it has the only reference to it, and copies it otherwise.
+bool IsTensorListMutator(const NodeDef& node) {
+  static const auto* const kOps = new absl::flat_hash_set<string>(
+      {"TensorListPopBack", "TensorListPushBack", "TensorListSetItem",
+       "TensorListScatterIntoExistingList"});
+  return kOps->contains(node.op());
+}
+
+// Returns whether the op only reads the TensorList of its first input.
+bool IsTensorListReader(const NodeDef& node) {
+  static const auto* const kOps = new absl::flat_hash_set<string>(
+      {"TensorListConcat", "TensorListConcatV2", "TensorListElementShape",
+       "TensorListGather", "TensorListGetItem", "TensorListLength",
+       "TensorListStack"});
+  return kOps->contains(node.op());
+}
+
+// Adds control dependencies so that the ops that mutate a TensorList run after
+// the other consumers of the list if these only read it. The executor drops
+// the references of the readers to the list once they ran, so the mutator
+// then updates the list in place instead of copying it. This matters in while
+// loops whose body reads and writes a list at each iteration, since the copy
+// is linear in the length of the list.
+Status OrderTensorListReadsBeforeWrites(GraphDef* optimized_graph) {
+  const int num_nodes = optimized_graph->node_size();
+  absl::flat_hash_map<string, int> node_index;
+  for (int i = 0; i < num_nodes; ++i) {
+    node_index[optimized_graph->node(i).name()] = i;
+  }
+  // The fanouts of each node, and the data consumers of each tensor.
+  std::vector<std::vector<int>> fanouts(num_nodes);
+  absl::flat_hash_map<string, std::vector<int>> consumers;
+  for (int i = 0; i < num_nodes; ++i) {
+    for (const string& input : optimized_graph->node(i).input()) {
+      const TensorId tensor = ParseTensorName(input);
+      auto it = node_index.find(tensor.node());
+      if (it == node_index.end()) continue;
+      fanouts[it->second].push_back(i);
+      if (!IsControlInput(input)) {
+        consumers[tensor.ToString()].push_back(i);
+      }
+    }
+  }
+
+  // Returns whether `target` depends on `source` within a loop iteration.
+  std::vector<bool> visited(num_nodes);
+  const auto depends_on = [&](int target, int source) {
+    std::fill(visited.begin(), visited.end(), false);
+    std::vector<int> stack = {source};
+    visited[source] = true;
+    while (!stack.empty()) {
+      const int node = stack.back();
+      stack.pop_back();
+      if (node == target) return true;
+      if (IsNextIteration(optimized_graph->node(node))) continue;
+      for (int fanout : fanouts[node]) {
+        if (!visited[fanout]) {
+          visited[fanout] = true;
+          stack.push_back(fanout);
+        }
+      }
+    }
+    return false;
+  };
+
+  for (int i = 0; i < num_nodes; ++i) {
+    if (!IsTensorListMutator(optimized_graph->node(i)) ||
+        optimized_graph->node(i).input_size() == 0) {
+      continue;
+    }
+    const string list =
+        ParseTensorName(optimized_graph->node(i).input(0)).ToString();
+    std::vector<int> readers;
+    bool has_other_consumers = false;
+    for (int consumer : consumers[list]) {
+      if (consumer == i) continue;
+      const NodeDef& consumer_node = optimized_graph->node(consumer);
+      if (!IsTensorListReader(consumer_node) ||
+          ParseTensorName(consumer_node.input(0)).ToString() != list) {
+        has_other_consumers = true;
+        break;
+      }
+      readers.push_back(consumer);
+    }
+    // Another reference to the list would force the copy anyway.
+    if (has_other_consumers) continue;
+    for (int reader : readers) {
+      // Running the reader first would create a cycle if it depends on the
+      // mutator, e.g. through the index of TensorListGetItem.
+      if (depends_on(reader, i)) continue;
+      const string control_input =
+          AsControlDependency(optimized_graph->node(reader));
+      NodeDef* mutator = optimized_graph->mutable_node(i);
+      if (absl::c_linear_search(mutator->input(), control_input)) continue;
+      VLOG(1) << "Running " << optimized_graph->node(reader).name()
+              << " before " << mutator->name();
+      mutator->add_input(control_input);
+      fanouts[reader].push_back(i);
+    }
+  }
+  return OkStatus();
+}
+
 bool IsSimpleBinaryOperator(const NodeDef& node) {
   return (IsLess(node) || IsLessEqual(node) || IsGreater(node) ||
           IsGreaterEqual(node) || IsEqual(node));
@@ -733,7 +839,8 @@ Status LoopOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                                GraphDef* optimized_graph) {
   if (!options_.enable_loop_invariant_node_motion &&
       !options_.enable_stack_push_removal &&
-      !options_.enable_dead_branch_removal) {
+      !options_.enable_dead_branch_removal &&
+      !options_.enable_tensor_list_forwarding) {
     return errors::Aborted("Nothing to do.");
   }
   *optimized_graph = item.graph;
@@ -754,6 +861,9 @@ Status LoopOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
     TF_RETURN_IF_ERROR(RemoveDeadBranches(item.NodesToPreserve(), node_map,
                                           feed_nodes, optimized_graph));
   }
+  if (options_.enable_tensor_list_forwarding) {
+    TF_RETURN_IF_ERROR(OrderTensorListReadsBeforeWrites(optimized_graph));
+  }
 
   return OkStatus();
 }
@@ -70,11 +70,18 @@ class LoopOptimizerTest : public GrapplerTest {
     optimizer->options_.enable_stack_push_removal = true;
   }
 
+  void EnableOnlyTensorListForwarding(LoopOptimizer* optimizer) {
+    DisableAllStages(optimizer);
+    optimizer->options_.enable_dead_branch_removal = false;
+    optimizer->options_.enable_tensor_list_forwarding = true;
+  }
+
  private:
   void DisableAllStages(LoopOptimizer* optimizer) {
     LoopOptimizer::LoopOptimizerOptions options;
     options.enable_loop_invariant_node_motion = false;
     options.enable_stack_push_removal = false;
+    options.enable_tensor_list_forwarding = false;
     optimizer->options_ = options;
   }
 };
@@ -749,6 +756,36 @@ TEST_F(LoopOptimizerTest, RemovePushWithoutMatchingPop) {
   }
 }
 
+TEST_F(LoopOptimizerTest, OrderTensorListReadsBeforeWrites) {
+  GrapplerItem item;
+  GraphDef& graph = item.graph;
+  AddSimpleNode("c", "Const", {}, &graph);
+  AddSimpleNode("list", "TensorListReserve", {"c", "c"}, &graph);
+  AddSimpleNode("id", "Identity", {"list"}, &graph);
+  AddSimpleNode("length", "TensorListLength", {"id"}, &graph);
+  AddSimpleNode("get", "TensorListGetItem", {"id", "c", "c"}, &graph);
+  AddSimpleNode("set", "TensorListSetItem", {"id", "c", "get"}, &graph);
+  // The index of this read depends on the write.
+  AddSimpleNode("set2", "TensorListSetItem", {"set", "c", "c"}, &graph);
+  AddSimpleNode("length2", "TensorListLength", {"set2"}, &graph);
+  AddSimpleNode("get2", "TensorListGetItem", {"set", "length2", "c"}, &graph);
+  // The list is also passed on, so the write copies it anyway.
+  AddSimpleNode("set3", "TensorListSetItem", {"list", "c", "c"}, &graph);
+  AddSimpleNode("length3", "TensorListLength", {"list"}, &graph);
+
+  LoopOptimizer optimizer;
+  EnableOnlyTensorListForwarding(&optimizer);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  ASSERT_EQ(node_map.GetNode("set")->input_size(), 5);
+  EXPECT_EQ(node_map.GetNode("set")->input(3), "^length");
+  EXPECT_EQ(node_map.GetNode("set")->input(4), "^get");
+  ASSERT_EQ(node_map.GetNode("set2")->input_size(), 3);
+  ASSERT_EQ(node_map.GetNode("set3")->input_size(), 3);
+}
+
 TEST_F(LoopOptimizerTest, RemoveDeadBranchesConstantCondition) {
   Scope scope = Scope::NewRootScope();
   Output v_in = ops::Const<float>(scope.WithOpName("v_in"), {123.0}, {});
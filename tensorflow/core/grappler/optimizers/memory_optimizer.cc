@@ -440,6 +440,18 @@ void RecomputeSubgraph(
   }
 }
 
+// Returns true if `node` is a node whose inputs we may want to recompute. This
+// matches node names that contain `recomputation_targets_name_scope` as a name
+// scope, meaning it either begins with or contains the name scope. Defaults to
+// "gradients/" which will match any node names that begins with "gradients/"
+// or contains "/gradients/".
+bool IsRecomputationTarget(const NodeDef& node,
+                           const string& recomputation_targets_name_scope) {
+  return absl::StartsWith(node.name(), recomputation_targets_name_scope) ||
+         static_cast<int>(node.name().find(
+             "/" + recomputation_targets_name_scope)) != -1;
+}
+
 void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
                                 const string& recomputation_targets_name_scope,
                                 GraphDef* graph, const GrapplerItem& item) {
@@ -461,15 +473,7 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
   }
   std::function<bool(const NodeDef&)> is_target =
       [&recomputation_targets_name_scope](const NodeDef& node) {
-        // Nodes whose inputs we may want to recompute. This matches node names
-        // that contain recomputation_targets_name_scope as a name scope,
-        // meaning it either begins with or contains the name scope.
-        // Defaults to "gradients/" which will match any node names that begins
-        // with "gradients/" or contains "/gradients/".
-        return absl::StartsWith(node.name(),
-                                recomputation_targets_name_scope) ||
-               static_cast<int>(node.name().find(
-                   "/" + recomputation_targets_name_scope)) != -1;
+        return IsRecomputationTarget(node, recomputation_targets_name_scope);
       };
 
   if (optimization_level == RewriterConfig::RECOMPUTATION_HEURISTICS ||
@@ -512,6 +516,192 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
   }
 }
 
+// Returns the number of bytes of the output `port` of `node`, or -1 if its
+// shape or type is not known.
+int64_t OutputBytes(const GraphProperties& properties, const string& node,
+                    int port) {
+  if (!properties.HasOutputProperties(node)) return -1;
+  const auto& outputs = properties.GetOutputProperties(node);
+  if (port < 0 || port >= static_cast<int>(outputs.size())) return -1;
+  const OpInfo::TensorProperties& output = outputs[port];
+  if (!PartialTensorShape(output.shape()).IsFullyDefined() ||
+      output.dtype() == DT_INVALID) {
+    return -1;
+  }
+  return CalculateTensorSize(output);
+}
+
+// Chooses, among the tensors live at the peak memory usage of each device
+// over its budget, the outputs of cheap forward nodes which are consumed by
+// the recomputation targets, and recomputes them right before the targets run
+// instead of keeping them alive. The peak memory usage is estimated by the
+// virtual scheduler. A node is recomputed only if the bytes its output frees
+// at the peak exceed the bytes of its inputs which are not live at the peak
+// already, and the nodes freeing the most bytes are chosen first until the
+// device fits its budget. The budget of a device is `memory_budget_bytes`, or
+// its memory size if that is not set.
+bool RematerializationPass(Cluster* cluster, int64_t memory_budget_bytes,
+                           const string& recomputation_targets_name_scope,
+                           std::unique_ptr<GraphMemory>* memory_ptr,
+                           GrapplerItem* item) {
+  if ((*memory_ptr) == nullptr) {
+    memory_ptr->reset(new GraphMemory(*item));
+    Status s = (*memory_ptr)->InferStatically(cluster->GetDevices());
+    if (!s.ok()) {
+      memory_ptr->reset();
+      VLOG(1) << "Failed to infer memory usage: " << s.error_message();
+      return false;
+    }
+  }
+  const GraphMemory& memory = **memory_ptr;
+
+  struct Device {
+    const GraphMemory::MemoryUsage* usage;
+    int64_t required_savings;
+  };
+  std::vector<Device> devices_over_budget;
+  for (const auto& device : cluster->GetDevices()) {
+    const int64_t budget = memory_budget_bytes > 0
+                               ? memory_budget_bytes
+                               : device.second.memory_size();
+    if (budget <= 0) {
+      VLOG(1) << "Available memory unknown for device " << device.first;
+      continue;
+    }
+    const GraphMemory::MemoryUsage& usage =
+        memory.GetPeakMemoryUsage(device.first);
+    if (usage.used_memory > budget) {
+      devices_over_budget.push_back({&usage, usage.used_memory - budget});
+    }
+  }
+  if (devices_over_budget.empty()) {
+    return false;
+  }
+
+  // The NodeDef pointers collected below must outlive the topological sort.
+  if (!TopologicalSort(&item->graph).ok()) {
+    return false;
+  }
+  GraphProperties properties(*item);
+  Status s = properties.InferStatically(/*assume_valid_feeds=*/false,
+                                        /*aggressive_shape_inference=*/false,
+                                        /*include_tensor_values=*/false);
+  if (!s.ok()) {
+    VLOG(1) << "Failed to infer shapes: " << s.error_message();
+    return false;
+  }
+  NodeMap node_map(&item->graph);
+  std::unordered_set<string> feeds;
+  for (const auto& feed : item->feed) {
+    feeds.insert(NodeName(feed.first));
+  }
+  const std::unordered_set<string> cheap_to_recompute_ops =
+      GetCheapToRecomputeOps();
+  auto is_target = [&recomputation_targets_name_scope](const NodeDef& node) {
+    return IsRecomputationTarget(node, recomputation_targets_name_scope);
+  };
+
+  std::unordered_set<const NodeDef*> recomputed_nodes;
+  std::vector<RecomputedSubGraph> recomputed_subgraphs;
+  for (const Device& device : devices_over_budget) {
+    std::unordered_set<string> live_at_peak;
+    for (const auto& live : device.usage->live_tensors) {
+      live_at_peak.insert(strings::StrCat(live.node, ":", live.output_id));
+    }
+
+    struct Candidate {
+      const NodeDef* node;
+      std::unordered_set<NodeDef*> targets;
+      int64_t savings;
+    };
+    std::vector<Candidate> candidates;
+    for (const auto& live : device.usage->live_tensors) {
+      const NodeDef* node = node_map.GetNode(live.node);
+      if (node == nullptr || recomputed_nodes.count(node) > 0 ||
+          is_target(*node) || feeds.count(node->name()) > 0 ||
+          (cheap_to_recompute_ops.count(node->op()) == 0 &&
+           node->attr().count(kRecomputeHint) == 0)) {
+        continue;
+      }
+      // Skip the nodes recomputed by the previous passes, and their copies.
+      if (absl::StartsWith(node->name(),
+                           strings::StrCat(kRecomputedNodePrefix, "/")) ||
+          node_map.GetNode(AddPrefixToNodeName(
+              node->name(), kRecomputedNodePrefix)) != nullptr) {
+        continue;
+      }
+      Candidate candidate{node, {}, static_cast<int64_t>(live.memory_used)};
+      for (NodeDef* output : node_map.GetOutputs(node->name())) {
+        if (is_target(*output)) {
+          candidate.targets.insert(output);
+        }
+      }
+      if (candidate.targets.empty()) {
+        continue;
+      }
+      for (const string& input : node->input()) {
+        if (IsControlInput(input)) continue;
+        int port;
+        const string input_node = ParseNodeName(input, &port);
+        if (live_at_peak.count(strings::StrCat(input_node, ":", port)) > 0) {
+          continue;
+        }
+        const int64_t input_bytes = OutputBytes(properties, input_node, port);
+        if (input_bytes < 0) {
+          candidate.savings = 0;
+          break;
+        }
+        candidate.savings -= input_bytes;
+      }
+      if (candidate.savings > 0) {
+        candidates.push_back(std::move(candidate));
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) {
+                return a.savings > b.savings ||
+                       (a.savings == b.savings &&
+                        a.node->name() < b.node->name());
+              });
+
+    int64_t required_savings = device.required_savings;
+    for (const Candidate& candidate : candidates) {
+      if (required_savings <= 0) break;
+      // A node whose input or output is recomputed as well would keep the
+      // other alive, so the nodes are recomputed one at a time.
+      bool adjacent = false;
+      for (const string& input : candidate.node->input()) {
+        adjacent |= recomputed_nodes.count(node_map.GetNode(input)) > 0;
+      }
+      for (const NodeDef* output :
+           node_map.GetOutputs(candidate.node->name())) {
+        adjacent |= recomputed_nodes.count(output) > 0;
+      }
+      if (adjacent) continue;
+      VLOG(1) << "Rematerializing " << candidate.node->name() << " to save "
+              << candidate.savings << " bytes";
+      recomputed_nodes.insert(candidate.node);
+      recomputed_subgraphs.push_back({{candidate.node}, candidate.targets});
+      required_savings -= candidate.savings;
+    }
+  }
+  if (recomputed_subgraphs.empty()) {
+    return false;
+  }
+
+  std::unordered_map<const NodeDef*, int> topological_numbering;
+  for (int node_number = 0; node_number < item->graph.node_size();
+       ++node_number) {
+    topological_numbering[item->graph.mutable_node(node_number)] =
+        item->graph.node_size() - node_number - 1;
+  }
+  for (const RecomputedSubGraph& subgraph : recomputed_subgraphs) {
+    RecomputeSubgraph(subgraph.recomputed_source_nodes, subgraph.target_nodes,
+                      node_map, topological_numbering, &item->graph);
+  }
+  return true;
+}
+
 bool SchedulingPass(Cluster* cluster, std::unique_ptr<GraphMemory>* memory_ptr,
                     GrapplerItem* item) {
   // Look for AddN nodes (and equivalent) and record input names.
@@ -1422,6 +1612,17 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
         }
       }
 
+      GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+      if (optimization_level_ == RewriterConfig::REMATERIALIZATION_HEURISTICS) {
+        if (RematerializationPass(cluster, memory_budget_bytes_,
+                                  recomputation_targets_name_scope_, &memory,
+                                  &optimized_item)) {
+          // Reset the inferred memory usage since the graph changed.
+          memory.reset();
+          updated_graph = true;
+        }
+      }
+
       GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
       if ((optimization_level_ == RewriterConfig::DEFAULT_MEM_OPT ||
            optimization_level_ == RewriterConfig::SWAPPING_HEURISTICS ||
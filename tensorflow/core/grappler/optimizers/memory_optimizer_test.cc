@@ -393,6 +393,59 @@ TEST_F(MemoryOptimizerTest, UnswappableInputs) {
 #endif
 }
 
+TEST_F(MemoryOptimizerTest, RematerializationHeuristics) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output v =
+      ops::Variable(s.WithOpName("v").WithDevice("/cpu:0"), {1, 128}, DT_FLOAT);
+  Output multiples = ops::Const(s.WithOpName("multiples"), {128, 1});
+  // The output of "a" is much larger than its inputs, and is kept alive by
+  // the gradients through the peak memory usage.
+  Output a = ops::Tile(s.WithOpName("a").WithDevice("/cpu:0"), v, multiples);
+  Output b = ops::Exp(s.WithOpName("b").WithDevice("/cpu:0"), a);
+  Output c = ops::Exp(s.WithOpName("c").WithDevice("/cpu:0"), b);
+  Output d = ops::AddN(s.WithOpName("gradients/d").WithDevice("/cpu:0"), {c});
+  Output e =
+      ops::AddN(s.WithOpName("gradients/e").WithDevice("/cpu:0"), {d, a});
+
+  Output constant = ops::Const(s.WithOpName("constant"), 1.0f, {1, 128});
+  Output init = ops::Assign(s.WithOpName("init"), v, constant);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"gradients/e"};
+  item.init_ops = {init.name()};
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+
+  // The graph fits the memory of the devices.
+  MemoryOptimizer fitting_optimizer(
+      RewriterConfig::REMATERIALIZATION_HEURISTICS);
+  GraphDef output;
+  TF_EXPECT_OK(fitting_optimizer.Optimize(cluster.get(), item, &output));
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+
+  MemoryOptimizer optimizer(RewriterConfig::REMATERIALIZATION_HEURISTICS,
+                            "gradients/", /*memory_budget_bytes=*/1);
+  TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+  NodeMap node_map(&output);
+  EXPECT_EQ(item.graph.node_size() + 2, output.node_size());
+  const NodeDef* recomputed_a = node_map.GetNode("Recomputed/a");
+  ASSERT_NE(recomputed_a, nullptr);
+  EXPECT_EQ("Tile", recomputed_a->op());
+  EXPECT_EQ("^RecomputeTrigger/a", recomputed_a->input(2));
+  const NodeDef* trigger = node_map.GetNode("RecomputeTrigger/a");
+  ASSERT_NE(trigger, nullptr);
+  EXPECT_EQ("^gradients/d", trigger->input(0));
+  const NodeDef* new_e = node_map.GetNode("gradients/e");
+  EXPECT_EQ("gradients/d", new_e->input(0));
+  EXPECT_EQ("Recomputed/a", new_e->input(1));
+
+  auto tensors_expected = EvaluateFetchNodes(item);
+  GrapplerItem optimized = item.WithGraph(std::move(output));
+  auto tensors = EvaluateFetchNodes(optimized);
+  test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
+}
+
 TEST_F(MemoryOptimizerTest, AccumulationRewrites) {
   tensorflow::Scope s = tensorflow::Scope::NewRootScope();
   Output a = ops::RandomNormal(s.WithOpName("a").WithDevice("/cpu:0"),
@@ -17,9 +17,15 @@ limitations under the License.
 
 #include <algorithm>
 #include <functional>
+#include <map>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
@@ -33,9 +39,12 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/graph_view.h"
 #include "tensorflow/core/grappler/optimizers/arithmetic_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/auto_mixed_precision.h"
 #include "tensorflow/core/grappler/optimizers/auto_parallel.h"
+#include "tensorflow/core/grappler/optimizers/collective_bucketing.h"
 #include "tensorflow/core/grappler/optimizers/common_subgraph_elimination.h"
 #include "tensorflow/core/grappler/optimizers/constant_folding.h"
 #include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
@@ -51,6 +60,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 #include "tensorflow/core/grappler/optimizers/scoped_allocator_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/shape_optimizer.h"
+#include "tensorflow/core/grappler/utils.h"
 #include "tensorflow/core/grappler/utils/canonicalizer.h"
 #include "tensorflow/core/grappler/utils/colocation.h"
 #include "tensorflow/core/grappler/utils/functions.h"
@@ -59,7 +69,15 @@ limitations under the License.
 #include "tensorflow/core/grappler/verifiers/structure_verifier.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/public/version.h"
 #include "tensorflow/core/util/dump_graph.h"
 #include "tensorflow/core/util/ptr_util.h"
 #include "tensorflow/core/util/util.h"
@@ -78,8 +96,49 @@ namespace {
 
 constexpr int kDefaultNumberOfIterations = 2;
 constexpr int kDefaultMinGraphNodes = 4;
+// The number of functions to optimize in a pass over the function library
+// from which they are optimized in parallel.
+constexpr int kMinFunctionsToOptimizeInParallel = 16;
 constexpr char kGrapplerCategory[] = "Grappler";
 
+// Forwards to a VirtualCluster, one Run at a time: Run estimates the costs
+// with the estimator of the cluster, which is not thread-safe. The rest of a
+// VirtualCluster is immutable, and Initialize does nothing, so the functions
+// of the library may be optimized in parallel against it.
+class SerializedVirtualCluster : public Cluster {
+ public:
+  explicit SerializedVirtualCluster(Cluster* cluster)
+      : Cluster(/*timeout_s=*/0), cluster_(cluster) {
+    DCHECK_EQ(cluster->type(), "virtual");
+    devices_ = cluster->GetDevices();
+    DisableDetailedStats(!cluster->DetailedStatsEnabled());
+    SetNumWarmupSteps(cluster->NumWarmupSteps());
+  }
+
+  string type() const override { return cluster_->type(); }
+  Status Provision() override { return OkStatus(); }
+  const DeviceSet* GetDeviceSet() const override {
+    return cluster_->GetDeviceSet();
+  }
+  Status Initialize(const GrapplerItem& item) override {
+    return cluster_->Initialize(item);
+  }
+  Status Run(const GraphDef& graph_def,
+             const std::vector<std::pair<string, Tensor>>& feed,
+             const std::vector<string>& fetch, RunMetadata* metadata) override {
+    mutex_lock lock(mu_);
+    return cluster_->Run(graph_def, feed, fetch, metadata);
+  }
+  Status Run(const GrapplerItem& item, RunMetadata* metadata) override {
+    mutex_lock lock(mu_);
+    return cluster_->Run(item, metadata);
+  }
+
+ private:
+  Cluster* const cluster_;
+  mutex mu_;
+};
+
 int64_t NumEdges(const GraphDef& graph) {
   int64_t num_edges = 0;
   for (const auto& node : graph.node()) {
@@ -184,6 +243,481 @@ Status GetGraphDevice(const GraphDef& g_def, std::set<std::string>* devices) {
   return OkStatus();
 }
 
+// Returns the path of the file caching, in `cache_dir`, the graph optimized
+// from `item` with `cfg` on the devices of `cluster`. Everything the
+// optimizers may read is part of the key, but for the id of `item`, which is
+// unique to each session, and the cache directory itself.
+string OptimizedGraphCachePath(const string& cache_dir,
+                               const GrapplerItem& item, const ConfigProto& cfg,
+                               const Cluster* cluster) {
+  string key = TF_VERSION_STRING;
+  const auto append = [&key](absl::string_view value) {
+    absl::StrAppend(&key, value.size(), ":", value);
+  };
+  const auto append_proto = [&append](const protobuf::MessageLite& proto) {
+    string serialized;
+    SerializeToStringDeterministic(proto, &serialized);
+    append(serialized);
+  };
+
+  append_proto(item.graph);
+  for (const auto& feed : item.feed) {
+    append(feed.first);
+    append(DataTypeString(feed.second.dtype()));
+    append(feed.second.shape().DebugString());
+  }
+  for (const auto* nodes : {&item.fetch, &item.init_ops, &item.keep_ops}) {
+    append(absl::StrJoin(*nodes, ","));
+  }
+  append(item.save_op);
+  append(item.restore_op);
+  append(item.save_restore_loc_tensor);
+  for (const QueueRunnerDef& queue_runner : item.queue_runners) {
+    append_proto(queue_runner);
+  }
+  const GrapplerItem::OptimizationOptions& options =
+      item.optimization_options();
+  append(absl::StrCat(options.allow_non_differentiable_rewrites,
+                      options.allow_pruning_stateful_and_dataset_ops,
+                      options.optimize_function_library,
+                      options.is_eager_mode));
+
+  ConfigProto config = cfg;
+  config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->clear_meta_optimizer_cache_dir();
+  append_proto(config);
+
+  std::vector<string> devices(item.devices().begin(), item.devices().end());
+  std::sort(devices.begin(), devices.end());
+  append(absl::StrJoin(devices, ","));
+  if (cluster != nullptr) {
+    std::map<string, DeviceProperties> cluster_devices(
+        cluster->GetDevices().begin(), cluster->GetDevices().end());
+    for (const auto& device : cluster_devices) {
+      append(device.first);
+      append_proto(device.second);
+    }
+  }
+
+  const Fprint128 fingerprint = Fingerprint128(key);
+  return io::JoinPath(
+      cache_dir, absl::StrCat(absl::Hex(fingerprint.high64, absl::kZeroPad16),
+                              absl::Hex(fingerprint.low64, absl::kZeroPad16),
+                              ".graph.pb"));
+}
+
+// Reads the optimized graph cached at `path`. Returns false if there is none,
+// or if it can not be read.
+bool ReadOptimizedGraphFromCache(const string& path, GraphDef* graph) {
+  Env* env = Env::Default();
+  if (!env->FileExists(path).ok()) return false;
+  const Status status = ReadBinaryProto(env, path, graph);
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to read the optimized graph cached at " << path
+                 << ": " << status;
+    graph->Clear();
+    return false;
+  }
+  VLOG(1) << "Read the optimized graph cached at " << path;
+  return true;
+}
+
+// Caches `graph` at `path`. The graph is written to a temporary file first,
+// so that concurrent writers and readers of the cache never see a partial
+// graph. Failures are only logged: the cache is an optimization.
+void WriteOptimizedGraphToCache(const string& cache_dir, const string& path,
+                                const GraphDef& graph) {
+  Env* env = Env::Default();
+  string temp_path = path;
+  Status status = env->RecursivelyCreateDir(cache_dir);
+  if (status.ok() && !env->CreateUniqueFileName(&temp_path, ".tmp")) {
+    status = errors::Internal("Failed to create a temporary file name");
+  }
+  if (status.ok()) status = WriteBinaryProto(env, temp_path, graph);
+  if (status.ok()) status = env->RenameFile(temp_path, path);
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to cache the optimized graph at " << path << ": "
+                 << status;
+    if (!temp_path.empty()) env->DeleteFile(temp_path).IgnoreError();
+    return;
+  }
+  VLOG(1) << "Cached the optimized graph at " << path;
+}
+
+using OutputPropertiesMap =
+    absl::flat_hash_map<string, std::vector<OpInfo::TensorProperties>>;
+
+// The prefix of the placeholders standing for the inputs of a region of a
+// graph re-optimized by MetaOptimizer::OptimizeIncrementally().
+constexpr char kRegionInputPrefix[] = "IncrementalOptimization/input/";
+
+string SerializeDeterministic(const protobuf::MessageLite& proto) {
+  string serialized;
+  SerializeToStringDeterministic(proto, &serialized);
+  return serialized;
+}
+
+// Returns whether everything the optimizers read of `previous` and `item`,
+// but the nodes of their graphs, is the same.
+bool SameOptimizationInterface(const GrapplerItem& previous,
+                               const GrapplerItem& item) {
+  if (previous.feed.size() != item.feed.size()) return false;
+  for (size_t i = 0; i < item.feed.size(); ++i) {
+    const auto& previous_feed = previous.feed[i];
+    const auto& feed = item.feed[i];
+    if (previous_feed.first != feed.first ||
+        previous_feed.second.dtype() != feed.second.dtype() ||
+        previous_feed.second.shape() != feed.second.shape()) {
+      return false;
+    }
+  }
+  const GrapplerItem::OptimizationOptions& previous_options =
+      previous.optimization_options();
+  const GrapplerItem::OptimizationOptions& options =
+      item.optimization_options();
+  return previous.fetch == item.fetch && previous.init_ops == item.init_ops &&
+         previous.keep_ops == item.keep_ops &&
+         previous.save_op == item.save_op &&
+         previous.restore_op == item.restore_op &&
+         previous.save_restore_loc_tensor == item.save_restore_loc_tensor &&
+         previous.queue_runners.empty() && item.queue_runners.empty() &&
+         previous_options.allow_non_differentiable_rewrites ==
+             options.allow_non_differentiable_rewrites &&
+         previous_options.allow_pruning_stateful_and_dataset_ops ==
+             options.allow_pruning_stateful_and_dataset_ops &&
+         previous_options.optimize_function_library ==
+             options.optimize_function_library &&
+         previous_options.is_eager_mode == options.is_eager_mode &&
+         previous.devices() == item.devices() &&
+         SerializeDeterministic(previous.graph.versions()) ==
+             SerializeDeterministic(item.graph.versions()) &&
+         SerializeDeterministic(previous.graph.library()) ==
+             SerializeDeterministic(item.graph.library());
+}
+
+bool SameOutputProperties(const OutputPropertiesMap& previous,
+                          const OutputPropertiesMap& current,
+                          const string& node) {
+  const auto* previous_properties = gtl::FindOrNull(previous, node);
+  const auto* properties = gtl::FindOrNull(current, node);
+  if (previous_properties == nullptr || properties == nullptr ||
+      previous_properties->size() != properties->size()) {
+    return false;
+  }
+  for (size_t i = 0; i < properties->size(); ++i) {
+    if (SerializeDeterministic((*previous_properties)[i]) !=
+        SerializeDeterministic((*properties)[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Finds the `region` of `item` to re-optimize after the edits since the
+// optimization recorded in `state`, and the `stale_nodes` of the previous
+// optimized graph that the optimized region replaces. Returns false if the
+// region is too large to be worth it.
+bool FindIncrementalRegion(const IncrementalOptimizationState& state,
+                           const GrapplerItem& item,
+                           const OutputPropertiesMap& output_properties,
+                           absl::flat_hash_set<string>* region,
+                           absl::flat_hash_set<string>* stale_nodes) {
+  const GraphDef& previous_graph = state.item->graph;
+  absl::flat_hash_map<string, const NodeDef*> previous_nodes;
+  for (const NodeDef& node : previous_graph.node()) {
+    previous_nodes.emplace(node.name(), &node);
+  }
+  absl::flat_hash_map<string, const NodeDef*> previous_optimized_nodes;
+  for (const NodeDef& node : state.optimized_graph.node()) {
+    previous_optimized_nodes.emplace(node.name(), &node);
+  }
+  absl::flat_hash_set<string> nodes;
+  for (const NodeDef& node : item.graph.node()) nodes.insert(node.name());
+
+  // The nodes that the edits affect, directly or through the inferred
+  // properties of their inputs, and the halo around them.
+  std::vector<string> frontier;
+  for (const NodeDef& node : item.graph.node()) {
+    const NodeDef* previous = gtl::FindPtrOrNull(previous_nodes, node.name());
+    if (previous == nullptr ||
+        SerializeDeterministic(*previous) != SerializeDeterministic(node) ||
+        !SameOutputProperties(state.output_properties, output_properties,
+                              node.name())) {
+      region->insert(node.name());
+      frontier.push_back(node.name());
+    }
+  }
+  GraphView graph_view(&item.graph);
+  for (int hop = 0; hop < state.halo && !frontier.empty(); ++hop) {
+    std::vector<string> next_frontier;
+    for (const string& name : frontier) {
+      const NodeDef& node = *graph_view.GetNode(name);
+      for (const auto& fanin : graph_view.GetFanins(node, true)) {
+        if (region->insert(fanin.node->name()).second) {
+          next_frontier.push_back(fanin.node->name());
+        }
+      }
+      for (const auto& fanout : graph_view.GetFanouts(node, true)) {
+        if (region->insert(fanout.node->name()).second) {
+          next_frontier.push_back(fanout.node->name());
+        }
+      }
+    }
+    frontier.swap(next_frontier);
+  }
+
+  // The nodes that the previous optimization rewrote, removed or created,
+  // clustered by the edges between them. The nodes of a cluster may have been
+  // rewritten together, so a cluster is either reused or re-optimized whole.
+  absl::flat_hash_map<string, string> parents;
+  for (const NodeDef& node : previous_graph.node()) {
+    const NodeDef* optimized =
+        gtl::FindPtrOrNull(previous_optimized_nodes, node.name());
+    if (optimized == nullptr ||
+        SerializeDeterministic(*optimized) != SerializeDeterministic(node)) {
+      parents.emplace(node.name(), node.name());
+    }
+  }
+  for (const NodeDef& node : state.optimized_graph.node()) {
+    if (!previous_nodes.contains(node.name())) {
+      parents.emplace(node.name(), node.name());
+    }
+  }
+  const auto find_root = [&parents](const string& name) {
+    string root = name;
+    while (parents[root] != root) root = parents[root];
+    for (string current = name; current != root;) {
+      string parent = parents[current];
+      parents[current] = root;
+      current = std::move(parent);
+    }
+    return root;
+  };
+  for (const GraphDef* graph : {&previous_graph, &state.optimized_graph}) {
+    for (const NodeDef& node : graph->node()) {
+      if (!parents.contains(node.name())) continue;
+      for (const string& input : node.input()) {
+        const string producer(ParseTensorName(input).node());
+        if (!parents.contains(producer)) continue;
+        const string root = find_root(producer);
+        parents[find_root(node.name())] = root;
+      }
+    }
+  }
+  std::vector<string> clustered_nodes;
+  for (const auto& node_and_parent : parents) {
+    clustered_nodes.push_back(node_and_parent.first);
+  }
+  absl::flat_hash_map<string, std::vector<string>> clusters;
+  for (const string& name : clustered_nodes) {
+    clusters[find_root(name)].push_back(name);
+  }
+
+  // Re-optimizes the clusters that touch the region, or that have nodes the
+  // edits deleted, until the region is closed.
+  bool region_grew = true;
+  while (region_grew) {
+    region_grew = false;
+    absl::flat_hash_set<string> touching = *region;
+    for (const GraphDef* graph : {&item.graph, &state.optimized_graph}) {
+      for (const NodeDef& node : graph->node()) {
+        const bool in_region = region->contains(node.name());
+        for (const string& input : node.input()) {
+          const string producer(ParseTensorName(input).node());
+          if (in_region) {
+            touching.insert(producer);
+          } else if (region->contains(producer)) {
+            touching.insert(node.name());
+          }
+        }
+      }
+    }
+    for (auto it = clusters.begin(); it != clusters.end();) {
+      const std::vector<string>& members = it->second;
+      const bool stale = absl::c_any_of(members, [&](const string& member) {
+        return touching.contains(member) ||
+               (previous_nodes.contains(member) && !nodes.contains(member));
+      });
+      if (!stale) {
+        ++it;
+        continue;
+      }
+      for (const string& member : members) {
+        stale_nodes->insert(member);
+        if (nodes.contains(member)) region->insert(member);
+      }
+      region_grew = true;
+      clusters.erase(it++);
+    }
+  }
+  return region->size() <=
+         state.max_region_fraction * item.graph.node_size();
+}
+
+// Makes the `region_item` of the `region` nodes of `item`. The inputs of the
+// region from the other nodes are fed by placeholders, which `region_inputs`
+// maps to the inputs they stand for, and the nodes of the region used by the
+// other nodes are preserved. Returns false if the properties of an input are
+// unknown.
+bool MakeRegionItem(const GrapplerItem& item,
+                    const OutputPropertiesMap& output_properties,
+                    const absl::flat_hash_set<string>& region,
+                    GrapplerItem* region_item,
+                    absl::flat_hash_map<string, string>* region_inputs) {
+  absl::flat_hash_map<string, const NodeDef*> nodes;
+  for (const NodeDef& node : item.graph.node()) {
+    nodes.emplace(node.name(), &node);
+  }
+  GraphDef graph;
+  *graph.mutable_versions() = item.graph.versions();
+  *graph.mutable_library() = item.graph.library();
+  std::vector<string> preserved_nodes;
+  absl::flat_hash_set<string> region_outputs;
+  for (const NodeDef& node : item.graph.node()) {
+    if (region.contains(node.name())) {
+      *graph.add_node() = node;
+      continue;
+    }
+    for (const string& input : node.input()) {
+      const string producer(ParseTensorName(input).node());
+      if (region.contains(producer) && region_outputs.insert(producer).second) {
+        preserved_nodes.push_back(producer);
+      }
+    }
+  }
+
+  std::vector<NodeDef> placeholders;
+  for (NodeDef& node : *graph.mutable_node()) {
+    for (string& input : *node.mutable_input()) {
+      const TensorId tensor = ParseTensorName(input);
+      if (region.contains(tensor.node())) continue;
+      const NodeDef* producer = gtl::FindPtrOrNull(nodes, tensor.node());
+      if (producer == nullptr) return false;
+      const bool is_control = tensor.index() == Graph::kControlSlot;
+      const string name =
+          is_control
+              ? absl::StrCat(kRegionInputPrefix, tensor.node(), "/control")
+              : absl::StrCat(kRegionInputPrefix, tensor.node(), "/",
+                             tensor.index());
+      if (region_inputs->emplace(name, input).second) {
+        NodeDef placeholder;
+        placeholder.set_name(name);
+        placeholder.set_device(producer->device());
+        if (is_control) {
+          placeholder.set_op("NoOp");
+        } else {
+          const auto* properties =
+              gtl::FindOrNull(output_properties, producer->name());
+          if (properties == nullptr ||
+              tensor.index() >= static_cast<int>(properties->size())) {
+            return false;
+          }
+          const OpInfo::TensorProperties& output =
+              (*properties)[tensor.index()];
+          if (output.dtype() == DT_INVALID || IsRefType(output.dtype())) {
+            return false;
+          }
+          placeholder.set_op("Placeholder");
+          (*placeholder.mutable_attr())["dtype"].set_type(output.dtype());
+          *(*placeholder.mutable_attr())["shape"].mutable_shape() =
+              output.shape();
+        }
+        placeholders.push_back(std::move(placeholder));
+        preserved_nodes.push_back(name);
+      }
+      input = is_control ? AsControlDependency(name) : name;
+    }
+  }
+  for (NodeDef& placeholder : placeholders) {
+    graph.add_node()->Swap(&placeholder);
+  }
+
+  *region_item = item.WithGraph(std::move(graph));
+  const auto outside_region = [&region](const string& tensor) {
+    return !region.contains(NodeName(tensor));
+  };
+  for (auto* names : {&region_item->fetch, &region_item->init_ops,
+                      &region_item->keep_ops}) {
+    names->erase(std::remove_if(names->begin(), names->end(), outside_region),
+                 names->end());
+  }
+  region_item->feed.erase(
+      std::remove_if(region_item->feed.begin(), region_item->feed.end(),
+                     [&](const std::pair<string, Tensor>& feed) {
+                       return outside_region(feed.first);
+                     }),
+      region_item->feed.end());
+  for (string* node : {&region_item->save_op, &region_item->restore_op,
+                       &region_item->save_restore_loc_tensor}) {
+    if (!node->empty() && outside_region(*node)) node->clear();
+  }
+  region_item->keep_ops.insert(region_item->keep_ops.end(),
+                               preserved_nodes.begin(), preserved_nodes.end());
+  return true;
+}
+
+// Splices the `optimized_region` into the previous optimized graph of
+// `state`, in place of the nodes of the region, the `stale_nodes` and the
+// nodes deleted from `item`. Returns false if they do not fit together.
+bool SpliceOptimizedRegion(
+    const IncrementalOptimizationState& state, const GrapplerItem& item,
+    const absl::flat_hash_set<string>& region,
+    const absl::flat_hash_set<string>& stale_nodes,
+    const absl::flat_hash_map<string, string>& region_inputs,
+    const GraphDef& optimized_region, GraphDef* optimized_graph) {
+  absl::flat_hash_set<string> nodes;
+  for (const NodeDef& node : item.graph.node()) nodes.insert(node.name());
+  absl::flat_hash_set<string> previous_nodes;
+  for (const NodeDef& node : state.item->graph.node()) {
+    previous_nodes.insert(node.name());
+  }
+
+  GraphDef graph;
+  *graph.mutable_versions() = state.optimized_graph.versions();
+  *graph.mutable_library() = state.optimized_graph.library();
+  absl::flat_hash_set<string> names;
+  for (const NodeDef& node : state.optimized_graph.node()) {
+    const bool deleted =
+        previous_nodes.contains(node.name()) && !nodes.contains(node.name());
+    if (deleted || region.contains(node.name()) ||
+        stale_nodes.contains(node.name())) {
+      continue;
+    }
+    *graph.add_node() = node;
+    names.insert(node.name());
+  }
+  for (const NodeDef& node : optimized_region.node()) {
+    if (region_inputs.contains(node.name())) continue;
+    if (!names.insert(node.name()).second) return false;
+    NodeDef* spliced = graph.add_node();
+    *spliced = node;
+    for (string& input : *spliced->mutable_input()) {
+      const auto it = region_inputs.find(ParseTensorName(input).node());
+      if (it == region_inputs.end()) continue;
+      input = IsControlInput(input) ? AsControlDependency(NodeName(it->second))
+                                    : it->second;
+    }
+  }
+  for (const NodeDef& node : graph.node()) {
+    for (const string& input : node.input()) {
+      if (!names.contains(NodeName(input))) return false;
+    }
+  }
+
+  absl::flat_hash_set<string> functions;
+  for (const FunctionDef& function : graph.library().function()) {
+    functions.insert(function.signature().name());
+  }
+  for (const FunctionDef& function : optimized_region.library().function()) {
+    if (functions.insert(function.signature().name()).second) {
+      *graph.mutable_library()->add_function() = function;
+    }
+  }
+  optimized_graph->Swap(&graph);
+  return true;
+}
+
 }  // namespace
 
 #define MK_OPT(NAME, CONFIG, VALUE)                                    \
@@ -216,11 +750,13 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
          new ConstantFolding(
              cpu_device_,
              cfg_.experimental_disable_compressed_tensor_optimization(),
-             !cfg_.experimental_disable_folding_quantization_emulation()));
+             !cfg_.experimental_disable_folding_quantization_emulation(),
+             cfg_.constant_folding_num_threads(),
+             cfg_.constant_folding_budget_bytes()));
   MK_OPT("shape", "shape_optimization", new ShapeOptimizer());
   MK_OPT("remap", "remapping",
          new Remapper(cfg_.remapping(), cfg_.cpu_layout_conversion(),
-                      xla_auto_clustering_on_));
+                      xla_auto_clustering_on_, cfg_.remapping_profile_path()));
   MK_OPT("layout", "layout_optimizer",
          new GenericLayoutOptimizer(
              /*optimization level*/ cfg_.layout_optimizer(),
@@ -256,6 +792,8 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
                                       cfg_.scoped_allocator_opts()));
   MK_OPT("pin_to_host", "pin_to_host_optimization",
          new PinToHostOptimizer(cfg_.pin_to_host_optimization()));
+  MK_OPT("collective_bucketing", "collective_bucketing",
+         new CollectiveBucketing(cfg_.collective_bucket_bytes()));
 
   return std::unique_ptr<GraphOptimizer>();
 }
@@ -356,7 +894,9 @@ Status MetaOptimizer::InitializeOptimizers(
       optimizers->push_back(MakeUnique<ConstantFolding>(
           cfg_.constant_folding(), cpu_device_,
           cfg_.experimental_disable_compressed_tensor_optimization(),
-          !cfg_.experimental_disable_folding_quantization_emulation()));
+          !cfg_.experimental_disable_folding_quantization_emulation(),
+          cfg_.constant_folding_num_threads(),
+          cfg_.constant_folding_budget_bytes()));
     }
   }
   if (BOTH_NOT_OFF(shape_optimization)) {
@@ -437,9 +977,9 @@ Status MetaOptimizer::InitializeOptimizers(
 #endif
     }
     if (enable_grappler_pass) {
-      optimizers->push_back(MakeUnique<Remapper>(cfg_.remapping(),
-                                                 cfg_.cpu_layout_conversion(),
-                                                 xla_auto_clustering_on_));
+      optimizers->push_back(MakeUnique<Remapper>(
+          cfg_.remapping(), cfg_.cpu_layout_conversion(),
+          xla_auto_clustering_on_, cfg_.remapping_profile_path()));
     }
   }
   if (BOTH_NOT_OFF(loop_optimization)) {
@@ -466,11 +1006,13 @@ Status MetaOptimizer::InitializeOptimizers(
     if (cfg_.memory_optimizer_target_node_name_scope().empty()) {
       optimizers->push_back(
           // Use the default target node name prefix "gradients/"
-          MakeUnique<MemoryOptimizer>(cfg_.memory_optimization()));
+          MakeUnique<MemoryOptimizer>(cfg_.memory_optimization(), "gradients/",
+                                      cfg_.memory_optimizer_budget_bytes()));
     } else {
       optimizers->push_back(MakeUnique<MemoryOptimizer>(
           cfg_.memory_optimization(),
-          cfg_.memory_optimizer_target_node_name_scope()));
+          cfg_.memory_optimizer_target_node_name_scope(),
+          cfg_.memory_optimizer_budget_bytes()));
     }
   }
   if (cfg_.auto_parallel().enable() && PLUGIN_IS_ON(auto_parallel)) {
@@ -478,6 +1020,12 @@ Status MetaOptimizer::InitializeOptimizers(
         MakeUnique<AutoParallel>(cfg_.auto_parallel().num_replicas()));
   }
 
+  if (USER_IS_ON(collective_bucketing) &&
+      PLUGIN_NOT_OFF(collective_bucketing)) {
+    optimizers->push_back(
+        MakeUnique<CollectiveBucketing>(cfg_.collective_bucket_bytes()));
+  }
+
 #ifndef ENABLE_MKL
   if (BOTH_ARE_ON(scoped_allocator_optimization)) {
     optimizers->push_back(MakeUnique<ScopedAllocatorOptimizer>(
@@ -630,6 +1178,7 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
     PRINT_CFG(loop_optimization)
     PRINT_CFG(dependency_optimization)
     PRINT_CFG(scoped_allocator_optimization)
+    PRINT_CFG(collective_bucketing)
 #undef PRINT_CFG
     user_cfg.toggle_config["auto_mixed_precision"] =
         AutoMixedPrecisionEnabled(cfg_.auto_mixed_precision())
@@ -685,6 +1234,7 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
       PRINT_CFG("memory", "memory_optimization")
       PRINT_CFG("autoparallel", "auto_parallel")
       PRINT_CFG("scoped_allocator", "scoped_allocator_optimization")
+      PRINT_CFG("collective_bucketing", "collective_bucketing")
 #undef PRINT_CFG
     }
   }
@@ -719,7 +1269,8 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
         pair.first == "auto_mixed_precision_mkl" ||
         pair.first == "auto_mixed_precision_cpu" ||
         pair.first == "pin_to_host_optimization" ||
-        pair.first == "scoped_allocator_optimization") {
+        pair.first == "scoped_allocator_optimization" ||
+        pair.first == "collective_bucketing") {
       // These optimizers are turned off by default.
       // TODO(penporn): Remove the hard-coded length and change it to max length
       // of all option strings.
@@ -877,7 +1428,10 @@ Status MetaOptimizer::OptimizeGraph(
                                    }) != optimization_result.results.end();
 
   // Record graph optimization result.
-  optimization_results_.push_back(optimization_result);
+  {
+    mutex_lock lock(optimization_results_mu_);
+    optimization_results_.push_back(optimization_result);
+  }
 
   if (is_optimized) {
     TF_RETURN_IF_ERROR(TopologicalSort(optimized_graph));
@@ -1152,15 +1706,51 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   // True if this is a TPU graph using the old bridge.
   bool is_tpu_graph = IsLegacyTPUBridgeGraphDef(*optimized_graph);
 
+  // Optimizes the body of the function of `func_item` into
+  // `optimized_func_graph` against `func_cluster`. May run concurrently for
+  // different functions.
+  const auto optimize_function_body = [&](Cluster* func_cluster,
+                                          const GrapplerFunctionItem& func_item,
+                                          GraphDef* optimized_func_graph) {
+    GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+    if (is_tpu_graph) {
+      // Skip optimizing functions if this is a TPU graph. Currently, Grappler
+      // passes do not handle TPU functions correctly in a variety of ways
+      // (Note that due to the pre-placement TPU graph rewriting passes, the
+      // TPU-related ops are encapsulated away into functions). For example,
+      // TPU graphs contain TPUReplicateMetadata node that carries relevant
+      // TPU metadata and Grappler passes could prune that away. Grappler
+      // passes could also cause issues around shape inference. Since the
+      // desired and existing behavior is to not optimize TPU functions with
+      // Grappler, this check preserves that. The only exception is
+      // implementation selector what is required to swap in some TPU specific
+      // lowering code and is verified the work correctly on TPUs.
+      ImplementationSelector implementation_selector;
+
+      // Implementation selector needs to have access to valid function
+      // signature and attributes, and it doesn't need actual function body.
+      GrapplerFunctionItem func_item_copy = func_item;
+      std::unique_ptr<FunctionDefLibrary> func_item_function_library(
+          func_item_copy.graph.release_library());
+      *func_item_copy.graph.mutable_library() =
+          GetFunctionDefLibraryStub(*func_item_function_library);
+
+      return implementation_selector.Optimize(func_cluster, func_item_copy,
+                                              optimized_func_graph);
+    }
+    GrapplerFunctionItem func_item_copy = func_item;
+    return OptimizeGraph(func_cluster, std::move(func_item_copy),
+                         optimized_func_graph);
+  };
+
   // Optimize each function only once.
   absl::flat_hash_set<string> optimized_funcs;
   while (optimize_function_library) {
     optimize_function_library = false;
 
-    int function_idx = 0;
+    // The functions to optimize in this pass, in the order of the library.
+    std::vector<const FunctionDef*> funcs_to_optimize;
     for (const FunctionDef& func : optimized_graph->library().function()) {
-      GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
-
       const string& func_name = func.signature().name();
 
       // Skip functions that are not reachable from the optimized graph.
@@ -1180,87 +1770,123 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
       // and in function instantiation.
       if (data::IsTFDataFunction(func)) continue;
 
-      VLOG(3) << "Optimize function: function=" << func_name << " ["
-              << function_idx++ << " of "
-              << optimized_graph->library().function_size() << "]";
-
       // Function optimization might specialize nested function calls, so we
       // have to reset the flag and do at least one more pass over the library.
       optimize_function_library = true;
       optimized_funcs.insert(func_name);
+      funcs_to_optimize.push_back(&func);
+    }
 
-      // Make a GrapplerItem from a FunctionDef.
-      GrapplerFunctionItem func_item;
-      TF_RETURN_IF_ERROR(
-          MakeGrapplerFunctionItem(func, flib, producer, &func_item));
-
-      // If we need to compute the gradient of optimized function at runtime, we
-      // can't perform non-differentiable rewrites.
-      func_item.optimization_options().allow_non_differentiable_rewrites =
-          !differentiable_functions.contains(func_name);
-
-      // Device set available to the function is defined only by the runtime,
-      // when we instantiate and execute the function. We can't use all devices
-      // available to the main graph, because after partitioning the function
-      // call node might execute on a remote worker.
-      if (!func_item.devices().empty()) {
-        return errors::Internal("GrapplerFunctionItem devices must be empty.");
+    // With many functions, the functions of the pass are optimized in
+    // parallel, all against the library as it was at the start of the pass,
+    // and merged back in the order of the library, so they don't see the
+    // functions optimized, or the specializations created, by the other
+    // functions of the pass, but only by the earlier passes. Otherwise each
+    // function sees the functions optimized before it. The result depends on
+    // which of the two is used, but not on the number of threads.
+    //
+    // The optimizers may measure on `cluster`, which is not thread-safe. The
+    // runs of a VirtualCluster are serialized, and the functions are optimized
+    // one at a time against any other cluster, which runs the graphs it is
+    // initialized with.
+    const bool can_optimize_in_parallel =
+        cluster == nullptr || cluster->type() == "virtual";
+    const int num_funcs = funcs_to_optimize.size();
+    const bool optimize_in_parallel =
+        can_optimize_in_parallel &&
+        num_funcs >= kMinFunctionsToOptimizeInParallel;
+    const int batch_size =
+        optimize_in_parallel ? num_funcs : std::min(num_funcs, 1);
+    for (int batch_start = 0; batch_start < num_funcs;
+         batch_start += batch_size) {
+
+      const int batch_limit = std::min(num_funcs, batch_start + batch_size);
+      std::vector<GrapplerFunctionItem> func_items(batch_limit - batch_start);
+      for (int i = batch_start; i < batch_limit; ++i) {
+        const FunctionDef& func = *funcs_to_optimize[i];
+        const string& func_name = func.signature().name();
+        VLOG(3) << "Optimize function: function=" << func_name << " [" << i
+                << " of " << optimized_graph->library().function_size() << "]";
+
+        // Make a GrapplerItem from a FunctionDef.
+        GrapplerFunctionItem& func_item = func_items[i - batch_start];
+        TF_RETURN_IF_ERROR(
+            MakeGrapplerFunctionItem(func, flib, producer, &func_item));
+
+        // If we need to compute the gradient of optimized function at runtime,
+        // we can't perform non-differentiable rewrites.
+        func_item.optimization_options().allow_non_differentiable_rewrites =
+            !differentiable_functions.contains(func_name);
+
+        // Device set available to the function is defined only by the
+        // runtime, when we instantiate and execute the function. We can't use
+        // all devices available to the main graph, because after partitioning
+        // the function call node might execute on a remote worker.
+        if (!func_item.devices().empty()) {
+          return errors::Internal(
+              "GrapplerFunctionItem devices must be empty.");
+        }
+
+        // We are not allowed to prune certain types of ops from the graph
+        // instantiated by the function definition, because we must guarantee
+        // function execution semantics wrt side effects (see
+        // function_optimizer.cc).
+        func_item.optimization_options()
+            .allow_pruning_stateful_and_dataset_ops = false;
       }
 
-      // We are not allowed to prune certain types of ops from the graph
-      // instantiated by the function definition, because we must guarantee
-      // function execution semantics wrt side effects (see
-      // function_optimizer.cc).
-      func_item.optimization_options().allow_pruning_stateful_and_dataset_ops =
-          false;
-
-      // Optimize function body graph.
-      GraphDef optimized_func_graph;
-      if (is_tpu_graph) {
-        // Skip optimizing functions if this is a TPU graph. Currently, Grappler
-        // passes do not handle TPU functions correctly in a variety of ways
-        // (Note that due to the pre-placement TPU graph rewriting passes, the
-        // TPU-related ops are encapsulated away into functions). For example,
-        // TPU graphs contain TPUReplicateMetadata node that carries relevant
-        // TPU metadata and Grappler passes could prune that away. Grappler
-        // passes could also cause issues around shape inference. Since the
-        // desired and existing behavior is to not optimize TPU functions with
-        // Grappler, this check preserves that. The only exception is
-        // implementation selector what is required to swap in some TPU specific
-        // lowering code and is verified the work correctly on TPUs.
-        ImplementationSelector implementation_selector;
-
-        // Implementation selector needs to have access to valid function
-        // signature and attributes, and it doesn't need actual function body.
-        std::unique_ptr<FunctionDefLibrary> func_item_function_library(
-            func_item.graph.release_library());
-        *func_item.graph.mutable_library() =
-            GetFunctionDefLibraryStub(*func_item_function_library);
-
-        TF_RETURN_IF_ERROR(implementation_selector.Optimize(
-            cluster, func_item, &optimized_func_graph));
+      // Optimize function body graphs.
+      const int num_items = func_items.size();
+      std::vector<GraphDef> optimized_func_graphs(num_items);
+      if (num_items == 1) {
+        TF_RETURN_IF_ERROR(optimize_function_body(cluster, func_items[0],
+                                                  &optimized_func_graphs[0]));
       } else {
-        GrapplerFunctionItem func_item_copy = func_item;
-        TF_RETURN_IF_ERROR(OptimizeGraph(cluster, std::move(func_item_copy),
-                                         &optimized_func_graph));
+        std::unique_ptr<Cluster> func_cluster;
+        if (cluster != nullptr) {
+          func_cluster = std::make_unique<SerializedVirtualCluster>(cluster);
+        }
+        std::vector<Status> statuses(num_items);
+        thread::ThreadPool pool(Env::Default(),
+                                "meta_optimizer_function_library",
+                                std::min(port::MaxParallelism(), num_items));
+        BlockingCounter counter(num_items);
+        for (int i = 0; i < num_items; ++i) {
+          pool.Schedule([&, i]() {
+            statuses[i] = optimize_function_body(
+                func_cluster.get(), func_items[i], &optimized_func_graphs[i]);
+            counter.DecrementCount();
+          });
+        }
+        counter.Wait();
+        for (const Status& status : statuses) {
+          TF_RETURN_IF_ERROR(status);
+        }
       }
 
-      // Function body optimization might have created new specialized
-      // functions for each instantiation context. Add them to the library.
-      for (const FunctionDef& func_def :
-           optimized_func_graph.library().function()) {
-        if (flib.Find(func_def.signature().name()) == nullptr) {
-          TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
+      for (int i = 0; i < num_items; ++i) {
+        GrapplerFunctionItem& func_item = func_items[i];
+        GraphDef& optimized_func_graph = optimized_func_graphs[i];
+
+        // Function body optimization might have created new specialized
+        // functions for each instantiation context. Add them to the library.
+        for (const FunctionDef& func_def :
+             optimized_func_graph.library().function()) {
+          if (flib.Find(func_def.signature().name()) == nullptr) {
+            TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
+          }
         }
-      }
 
-      // Convert optimized graph back to FunctionDef.
-      FunctionDef optimized_func;
-      func_item.SwapFunctionBody(std::move(optimized_func_graph));
-      TF_RETURN_IF_ERROR(MakeFunctionDef(func_item, flib, &optimized_func));
+        // Convert optimized graph back to FunctionDef.
+        FunctionDef optimized_func;
+        func_item.SwapFunctionBody(std::move(optimized_func_graph));
+        TF_RETURN_IF_ERROR(MakeFunctionDef(func_item, flib, &optimized_func));
 
-      // Replace optimized function with a new FunctionDef.
-      TF_RETURN_IF_ERROR(flib.ReplaceFunction(func_name, optimized_func));
+        // Replace optimized function with a new FunctionDef.
+        TF_RETURN_IF_ERROR(flib.ReplaceFunction(
+            funcs_to_optimize[batch_start + i]->signature().name(),
+            optimized_func));
+      }
     }
 
     // If optimized at least one function, update the graph library.
@@ -1307,6 +1933,55 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   return OkStatus();
 }
 
+Status MetaOptimizer::OptimizeIncrementally(
+    Cluster* cluster, GrapplerItem&& item, IncrementalOptimizationState* state,
+    GraphDef* optimized_graph) {
+  OutputPropertiesMap output_properties;
+  GraphProperties properties(item);
+  if (properties.InferStatically(/*assume_valid_feeds=*/false).ok()) {
+    for (const NodeDef& node : item.graph.node()) {
+      output_properties.emplace(node.name(),
+                                properties.GetOutputProperties(node.name()));
+    }
+  }
+
+  bool incremental = false;
+  if (state->item != nullptr && !output_properties.empty() &&
+      SameOptimizationInterface(*state->item, item)) {
+    absl::flat_hash_set<string> region;
+    absl::flat_hash_set<string> stale_nodes;
+    GrapplerItem region_item;
+    absl::flat_hash_map<string, string> region_inputs;
+    if (FindIncrementalRegion(*state, item, output_properties, &region,
+                              &stale_nodes) &&
+        MakeRegionItem(item, output_properties, region, &region_item,
+                       &region_inputs)) {
+      VLOG(1) << "Re-optimizing " << region.size() << " of "
+              << item.graph.node_size() << " nodes of " << item.id;
+      GraphDef optimized_region;
+      if (!region.empty()) {
+        TF_RETURN_IF_ERROR(OptimizeConsumeItem(cluster, std::move(region_item),
+                                               &optimized_region));
+      }
+      incremental =
+          SpliceOptimizedRegion(*state, item, region, stale_nodes,
+                                region_inputs, optimized_region,
+                                optimized_graph);
+    }
+  }
+  if (!incremental) {
+    GrapplerItem copy(item);
+    TF_RETURN_IF_ERROR(
+        OptimizeConsumeItem(cluster, std::move(copy), optimized_graph));
+  }
+
+  state->item = std::make_unique<GrapplerItem>(std::move(item));
+  state->optimized_graph = *optimized_graph;
+  state->output_properties = std::move(output_properties);
+  state->incremental = incremental;
+  return OkStatus();
+}
+
 string MetaOptimizer::GetResultString() const {
   std::string result_string;
   for (const GraphOptimizationResult& graph_result : optimization_results_) {
@@ -1345,6 +2020,7 @@ bool MetaOptimizerEnabled(const ConfigProto& cfg) {
          rewrite_cfg.scoped_allocator_optimization() == RewriterConfig::ON ||
 #endif
          rewrite_cfg.pin_to_host_optimization() == RewriterConfig::ON ||
+         rewrite_cfg.collective_bucketing() == RewriterConfig::ON ||
          AutoMixedPrecisionEnabled(rewrite_cfg.auto_mixed_precision()) ||
          AutoMixedPrecisionEnabled(
              rewrite_cfg.auto_mixed_precision_onednn_bfloat16()) ||
@@ -1357,11 +2033,25 @@ bool MetaOptimizerEnabled(const ConfigProto& cfg) {
 Status RunMetaOptimizer(GrapplerItem&& item, const ConfigProto& cfg,
                         DeviceBase* cpu_device, Cluster* cluster,
                         GraphDef* optimized_graph) {
+  const string& cache_dir =
+      cfg.graph_options().rewrite_options().meta_optimizer_cache_dir();
+  string cache_path;
+  if (!cache_dir.empty()) {
+    cache_path = OptimizedGraphCachePath(cache_dir, item, cfg, cluster);
+    if (ReadOptimizedGraphFromCache(cache_path, optimized_graph)) {
+      return OkStatus();
+    }
+  }
+
   MetaOptimizer optimizer(cpu_device, cfg);
   optimizer.set_deadline_usec(
       DeadlineMicroSeconds(cfg.graph_options().rewrite_options()));
-  return optimizer.OptimizeConsumeItem(cluster, std::move(item),
-                                       optimized_graph);
+  Status status =
+      optimizer.OptimizeConsumeItem(cluster, std::move(item), optimized_graph);
+  if (status.ok() && !cache_path.empty()) {
+    WriteOptimizedGraphToCache(cache_dir, cache_path, *optimized_graph);
+  }
+  return status;
 }
 
 Status OptimizeGraph(
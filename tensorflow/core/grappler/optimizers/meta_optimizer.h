@@ -16,14 +16,20 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_H_
 #define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_H_
 
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/common_runtime/device_set.h"
 #include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
 #include "tensorflow/core/grappler/verifiers/graph_verifier.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 #include "tensorflow/core/protobuf/verifier_config.pb.h"
@@ -31,6 +37,27 @@ limitations under the License.
 namespace tensorflow {
 namespace grappler {
 
+// The last graph optimized by MetaOptimizer::OptimizeIncrementally(), from
+// which the next call re-optimizes only the nodes that the edits of the graph
+// may affect.
+struct IncrementalOptimizationState {
+  // The number of hops around the affected nodes that are re-optimized with
+  // them, so that the rewrites matching several nodes see them all.
+  int halo = 2;
+  // The whole graph is re-optimized when the region to re-optimize has more
+  // than this fraction of its nodes.
+  double max_region_fraction = 0.5;
+
+  // Set by OptimizeIncrementally().
+  std::unique_ptr<GrapplerItem> item;
+  GraphDef optimized_graph;
+  // The statically inferred output properties of the nodes of `item`.
+  absl::flat_hash_map<string, std::vector<OpInfo::TensorProperties>>
+      output_properties;
+  // Whether the last call re-optimized only a region of the graph.
+  bool incremental = false;
+};
+
 // Run the other grappler optimizers based on the specified rewriter config.
 class MetaOptimizer : public GraphOptimizer {
  public:
@@ -50,6 +77,18 @@ class MetaOptimizer : public GraphOptimizer {
   Status OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
                              GraphDef* optimized_graph);
 
+  // Optimizes `item`, an edited version of the graph of `state`, reusing the
+  // previous optimized graph for the nodes the edits can not affect. Only the
+  // affected region is re-optimized: the edited nodes, the nodes whose
+  // inferred output properties changed, a halo around them, and the nodes
+  // that the previous optimization rewrote together with any of these. The
+  // whole graph is optimized instead on the first call, when anything but
+  // the nodes of the graph changed, or when the region is large. Updates
+  // `state` for the next call.
+  Status OptimizeIncrementally(Cluster* cluster, GrapplerItem&& item,
+                               IncrementalOptimizationState* state,
+                               GraphDef* optimized_graph);
+
   string GetResultString() const;
 
   void PrintResult();
@@ -118,6 +157,9 @@ class MetaOptimizer : public GraphOptimizer {
                       GrapplerItem* optimized_item, GraphDef* optimized_graph,
                       GraphOptimizationResult* optimization_result);
 
+  // Guards optimization_results_ while the functions of the library are
+  // optimized in parallel.
+  mutex optimization_results_mu_;
   std::vector<GraphOptimizationResult> optimization_results_;
 };
 
@@ -16,14 +16,18 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/meta_optimizer.h"
 
 #include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
 
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/function_testlib.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/inputs/trivial_test_graph_input_yielder.h"
 #include "tensorflow/core/grappler/optimizers/custom_graph_optimizer.h"
@@ -32,6 +36,9 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/config.pb.h"
@@ -129,6 +136,61 @@ gtl::FlatMap<string, GrapplerItem::OptimizationOptions>*
 
 REGISTER_GRAPH_OPTIMIZER(GrapplerItemPropertiesAccumulator);
 
+// Record the cluster, and the thread, of the GrapplerItems passed for
+// optimization.
+class ClusterAccumulator : public CustomGraphOptimizer {
+ public:
+  struct OptimizeCall {
+    string cluster_type;
+    int num_devices = 0;
+    std::thread::id thread_id;
+  };
+
+  static void SetOptimizeCalls(gtl::FlatMap<string, OptimizeCall>* calls) {
+    mutex_lock lock(mu_);
+    calls_ = calls;
+  }
+  static void ResetOptimizeCalls() {
+    mutex_lock lock(mu_);
+    calls_ = nullptr;
+  }
+
+  string name() const override { return "cluster_accumulator"; }
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(
+      const tensorflow::RewriterConfig_CustomGraphOptimizer* config) override {
+    return OkStatus();
+  }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override {
+    *optimized_graph = item.graph;
+    OptimizeCall call;
+    if (cluster != nullptr) {
+      call.cluster_type = cluster->type();
+      call.num_devices = cluster->GetDevices().size();
+      RunMetadata metadata;
+      TF_RETURN_IF_ERROR(cluster->Initialize(item));
+      TF_RETURN_IF_ERROR(cluster->Run(item, &metadata));
+    }
+    call.thread_id = std::this_thread::get_id();
+    mutex_lock lock(mu_);
+    if (calls_) calls_->insert({item.id, call});
+    return OkStatus();
+  }
+
+ private:
+  static mutex mu_;
+  static gtl::FlatMap<string, OptimizeCall>* calls_ TF_GUARDED_BY(mu_);
+};
+
+mutex ClusterAccumulator::mu_(LINKER_INITIALIZED);
+gtl::FlatMap<string, ClusterAccumulator::OptimizeCall>*
+    ClusterAccumulator::calls_;
+
+REGISTER_GRAPH_OPTIMIZER(ClusterAccumulator);
+
 class MetaOptimizerTest : public GrapplerTest {};
 
 TEST_F(MetaOptimizerTest, RunsCustomOptimizer) {
@@ -420,6 +482,142 @@ TEST_F(MetaOptimizerTest, OptimizeFunctionLibrary) {
   test::ExpectTensorEqual<int>(tensors_expected[1], tensors[1]);
 }
 
+TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryInParallel) {
+  using test::function::NDef;
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.set_min_graph_nodes(-1);
+
+  MetaOptimizer optimizer(nullptr, config_proto);
+
+  // Enough functions to be optimized in parallel, each computing x * (2 * 2)
+  // and called once by the graph:
+  //
+  //   *MyFunc_i(x) = x * (2 * 2)
+  //
+  //  * - marked as noinline
+  constexpr int kNumFunctions = 40;
+  std::vector<FunctionDef> funcs;
+  std::vector<NodeDef> nodes = {
+      NDef("x", "Placeholder", {}, {{"dtype", DT_FLOAT}}, kDevice)};
+  GrapplerItem item;
+  item.id = "tf_graph";
+  for (int i = 0; i < kNumFunctions; ++i) {
+    const string func_name = absl::StrCat("MyFunc_", i);
+    funcs.push_back(FunctionDefHelper::Create(
+        func_name, {"x:float"}, {"z:float"}, {},
+        {{{"two"},
+          "Const",
+          {},
+          {{"value", test::AsScalar<float>(2)}, {"dtype", DT_FLOAT}}},
+         {{"four"}, "Mul", {"two:output:0", "two:output:0"}, {{"T", DT_FLOAT}}},
+         {{"mul"}, "Mul", {"x", "four:z:0"}, {{"T", DT_FLOAT}}}},
+        /*ret_def=*/
+        {{"z", "mul:z:0"}}));
+    (*funcs.back().mutable_attr())["_noinline"].set_b(true);
+    const string call = absl::StrCat("call_", i);
+    nodes.push_back(NDef(call, func_name, {"x"}, {}, kDevice));
+    nodes.push_back(NDef(absl::StrCat("out_", i), "Identity", {call},
+                         {{"T", DT_FLOAT}}, kDevice));
+    item.fetch.push_back(absl::StrCat("out_", i));
+  }
+  item.graph = test::function::GDef(nodes, funcs);
+
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // Constant folding ran on the body of every function.
+  FunctionLibraryDefinition optimized_flib(OpRegistry::Global(),
+                                           output.library());
+  for (int i = 0; i < kNumFunctions; ++i) {
+    const FunctionDef* func =
+        optimized_flib.Find(absl::StrCat("MyFunc_", i));
+    ASSERT_NE(func, nullptr);
+    int found = 0;
+    for (const NodeDef& node : func->node_def()) {
+      if (node.name() == "four") {
+        EXPECT_EQ(node.op(), "Const");
+        found++;
+      }
+    }
+    EXPECT_EQ(found, 1);
+  }
+
+  item.feed.emplace_back("x", test::AsScalar<float>(3));
+  auto tensors_expected = EvaluateFetchNodes(item);
+  GrapplerItem optimized = item.WithGraph(std::move(output));
+  auto tensors = EvaluateFetchNodes(optimized);
+  ASSERT_EQ(tensors.size(), kNumFunctions);
+  ASSERT_EQ(tensors_expected.size(), kNumFunctions);
+  for (int i = 0; i < kNumFunctions; ++i) {
+    test::ExpectTensorEqual<float>(tensors[i], tensors_expected[i]);
+  }
+}
+
+TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryInParallelWithVirtualCluster) {
+  using test::function::NDef;
+
+  gtl::FlatMap<string, ClusterAccumulator::OptimizeCall> calls;
+  ClusterAccumulator::SetOptimizeCalls(&calls);
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.add_optimizers("ClusterAccumulator");
+  rewriter_config.set_min_graph_nodes(-1);
+
+  MetaOptimizer optimizer(nullptr, config_proto);
+
+  // Enough functions to be optimized in parallel:
+  //
+  //   *MyFunc_i(x) = x * x
+  //
+  //  * - marked as noinline
+  constexpr int kNumFunctions = 40;
+  std::vector<FunctionDef> funcs;
+  std::vector<NodeDef> nodes = {
+      NDef("x", "Placeholder", {}, {{"dtype", DT_FLOAT}}, kDevice)};
+  GrapplerItem item;
+  item.id = "tf_graph";
+  for (int i = 0; i < kNumFunctions; ++i) {
+    const string func_name = absl::StrCat("MyFunc_", i);
+    funcs.push_back(FunctionDefHelper::Create(
+        func_name, {"x:float"}, {"z:float"}, {},
+        {{{"mul"}, "Mul", {"x", "x"}, {{"T", DT_FLOAT}}}},
+        /*ret_def=*/
+        {{"z", "mul:z:0"}}));
+    (*funcs.back().mutable_attr())["_noinline"].set_b(true);
+    const string call = absl::StrCat("call_", i);
+    nodes.push_back(NDef(call, func_name, {"x"}, {}, kDevice));
+    item.fetch.push_back(call);
+  }
+  item.graph = test::function::GDef(nodes, funcs);
+
+  DeviceProperties cpu_device;
+  cpu_device.set_type("CPU");
+  VirtualCluster cluster({{kDevice, cpu_device}});
+  TF_ASSERT_OK(cluster.Provision());
+
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(&cluster, item, &output));
+  ClusterAccumulator::ResetOptimizeCalls();
+
+  // The functions were optimized on the threads of the function library,
+  // against the devices of the cluster.
+  ASSERT_EQ(calls.size(), kNumFunctions + 1);
+  const std::thread::id thread_id = std::this_thread::get_id();
+  EXPECT_EQ(calls["tf_graph"].thread_id, thread_id);
+  for (int i = 0; i < kNumFunctions; ++i) {
+    const ClusterAccumulator::OptimizeCall& call =
+        calls[absl::StrCat("MyFunc_", i)];
+    EXPECT_EQ(call.cluster_type, "virtual");
+    EXPECT_EQ(call.num_devices, 1);
+    EXPECT_NE(call.thread_id, thread_id);
+  }
+}
+
 TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryPruneUnusedOutputs) {
   using test::function::NDef;
 
@@ -792,6 +990,57 @@ TEST_F(MetaOptimizerTest, OptimizerDoesNotTimeOut) {
   EXPECT_EQ(original_node_size + 2, output.node_size());
 }
 
+TEST_F(MetaOptimizerTest, CachesOptimizedGraph) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {kDevice});
+  GrapplerItem item;
+  ASSERT_TRUE(fake_input.NextItem(&item));
+
+  Env* env = Env::Default();
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "meta_optimizer_cache");
+  if (env->FileExists(cache_dir).ok()) {
+    int64_t undeleted_files, undeleted_dirs;
+    TF_ASSERT_OK(
+        env->DeleteRecursively(cache_dir, &undeleted_files, &undeleted_dirs));
+  }
+  ConfigProto config;
+  RewriterConfig& rewriter_config =
+      *config.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.set_min_graph_nodes(-1);
+  rewriter_config.set_meta_optimizer_cache_dir(cache_dir);
+
+  GraphDef output;
+  TF_ASSERT_OK(RunMetaOptimizer(GrapplerItem(item), config, nullptr, nullptr,
+                                &output));
+  std::vector<string> files;
+  TF_ASSERT_OK(env->GetChildren(cache_dir, &files));
+  ASSERT_EQ(files.size(), 1);
+  GraphDef cached;
+  TF_ASSERT_OK(
+      ReadBinaryProto(env, io::JoinPath(cache_dir, files[0]), &cached));
+  CompareGraphs(output, cached);
+
+  // The graph is read from the cache rather than optimized again: replace it
+  // to tell them apart.
+  GraphDef replaced;
+  replaced.add_node()->set_name("replaced");
+  TF_ASSERT_OK(
+      WriteBinaryProto(env, io::JoinPath(cache_dir, files[0]), replaced));
+  TF_ASSERT_OK(RunMetaOptimizer(GrapplerItem(item), config, nullptr, nullptr,
+                                &output));
+  CompareGraphs(replaced, output);
+
+  // Another config does not match the cached graph.
+  rewriter_config.set_constant_folding(RewriterConfig::OFF);
+  output.Clear();
+  TF_ASSERT_OK(RunMetaOptimizer(GrapplerItem(item), config, nullptr, nullptr,
+                                &output));
+  EXPECT_GT(output.node_size(), 1);
+  files.clear();
+  TF_ASSERT_OK(env->GetChildren(cache_dir, &files));
+  EXPECT_EQ(files.size(), 2);
+}
+
 TEST_F(MetaOptimizerTest, RunPostOptimizationVerifiersOnValidGraph) {
   TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {kDevice});
   GrapplerItem item;
@@ -977,6 +1226,77 @@ TEST_F(MetaOptimizerTest, RunInterOptimizerVerifiersOnInvalidGraph) {
       "NodeDef expected inputs 'float' do not match 3 inputs specified"));
 }
 
+TEST_F(MetaOptimizerTest, OptimizesIncrementally) {
+  const auto make_item = [](float scale_value) {
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+    Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                                ops::Placeholder::Shape({2, 2}));
+    // The body of the model, which the optimizers leave alone.
+    Output body = x;
+    for (int i = 0; i < 10; ++i) {
+      body = ops::Tanh(s.WithOpName(absl::StrCat("body_", i)), body);
+    }
+    // The head, whose weights are folded.
+    Output scale = ops::Const(s.WithOpName("scale"), scale_value, {2, 2});
+    Output two = ops::Const(s.WithOpName("two"), 2.0f, {2, 2});
+    Output weights = ops::Mul(s.WithOpName("weights"), scale, two);
+    ops::Mul(s.WithOpName("head"), body, weights);
+
+    GrapplerItem item;
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    item.fetch = {"head"};
+    item.feed = {
+        {"x", test::AsTensor<float>({1, 2, 3, 4}, TensorShape({2, 2}))}};
+    return item;
+  };
+  ConfigProto config;
+  RewriterConfig& rewriter_config =
+      *config.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.set_min_graph_nodes(-1);
+  IncrementalOptimizationState state;
+  const auto optimize = [&](GrapplerItem item, GraphDef* output) {
+    MetaOptimizer optimizer(/*cpu_device=*/nullptr, config);
+    TF_EXPECT_OK(optimizer.OptimizeIncrementally(/*cluster=*/nullptr,
+                                                 std::move(item), &state,
+                                                 output));
+  };
+
+  GraphDef output;
+  optimize(make_item(3.0f), &output);
+  EXPECT_FALSE(state.incremental);
+
+  // Without edits, the optimized graph is reused as is.
+  GraphDef reused;
+  optimize(make_item(3.0f), &reused);
+  EXPECT_TRUE(state.incremental);
+  CompareGraphs(output, reused);
+
+  // Only the head is re-optimized after an edit of its weights.
+  GrapplerItem edited = make_item(5.0f);
+  GraphDef expected;
+  {
+    MetaOptimizer optimizer(/*cpu_device=*/nullptr, config);
+    TF_ASSERT_OK(optimizer.Optimize(/*cluster=*/nullptr, edited, &expected));
+  }
+  optimize(edited, &output);
+  EXPECT_TRUE(state.incremental);
+  for (const NodeDef& node : output.node()) {
+    EXPECT_FALSE(absl::StartsWith(node.name(), "IncrementalOptimization/"))
+        << node.name();
+  }
+  auto tensors = EvaluateNodes(output, edited.fetch, edited.feed);
+  auto tensors_expected = EvaluateNodes(expected, edited.fetch, edited.feed);
+  ASSERT_EQ(tensors.size(), 1);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-6);
+  EXPECT_EQ(output.node_size(), expected.node_size());
+
+  // The whole graph is optimized again when the fetches change.
+  edited.fetch.push_back("body_3");
+  optimize(edited, &output);
+  EXPECT_FALSE(state.incremental);
+}
+
 TEST_F(MetaOptimizerTest, CompressConstants) {
   tensorflow::Scope scope = tensorflow::Scope::NewRootScope();
   Tensor zeros_t(DT_FLOAT, TensorShape({64}));
@@ -16,15 +16,20 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 
 #include <algorithm>
+#include <functional>
 #include <map>
+#include <memory>
 #include <set>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
 #include "tensorflow/core/grappler/graph_view.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/op_types.h"
@@ -35,7 +40,9 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/symbolic_shapes.h"
 #include "tensorflow/core/grappler/utils/topological_sort.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 #include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/use_cudnn.h"
@@ -67,6 +74,9 @@ namespace grappler {
 //
 // Sigmoid + Mul -> _MklSwish  // This fusion only works on Intel CPU.
 //
+// CropAndResize + ... -> CropResizeAndNormalize:
+//   (1) CropAndResize + Sub + {Mul, RealDiv} + <Transpose to NCHW>
+//
 //
 // In all cases, the supported activation functions are Relu, Relu6, and Elu.
 //
@@ -81,6 +91,7 @@ constexpr char kFusedDepthwiseConv2dNative[] = "_FusedDepthwiseConv2dNative";
 constexpr char kFusedBatchNormEx[] = "_FusedBatchNormEx";
 constexpr char kFusedBatchNormGradEx[] = "_FusedBatchNormGradEx";
 constexpr char kTensorToHashBucket[] = "_TensorToHashBucketFast";
+constexpr char kCropResizeAndNormalize[] = "CropResizeAndNormalize";
 
 constexpr char kDataFormat[] = "data_format";
 constexpr char kIsTraining[] = "is_training";
@@ -90,6 +101,9 @@ constexpr char kFill[] = "fill";
 
 constexpr int kMissingIndex = -1;
 
+// The mean measured costs of nodes, by node name and op.
+using MeasuredCosts = absl::flat_hash_map<std::pair<string, string>, double>;
+
 struct RemapperContext {
   explicit RemapperContext(GrapplerItem* item, Status* status,
                            RewriterConfig::CpuLayout cpu_layout_conversion,
@@ -107,6 +121,9 @@ struct RemapperContext {
   bool inferred_graph_properties;
   RewriterConfig::CpuLayout cpu_layout_conversion;
   bool xla_auto_clustering_on;
+  // The mean measured cost of the nodes in the profile of the remapper, if
+  // any, by node name and op.
+  std::shared_ptr<const MeasuredCosts> measured_costs;
 };
 
 // FusedBatchNorm that can be replaced with a cheaper set of primitives.
@@ -151,6 +168,35 @@ struct TensorToHashBucket {
   int string_to_hash_bucket = kMissingIndex;
 };
 
+// SparseSegment{Sum,Mean,SqrtN}[WithNumSegments] of the rows gathered at the
+// unique ids, as produced by tf.nn.embedding_lookup_sparse, that can reduce
+// the rows at the ids themselves instead.
+struct SparseSegmentReductionOfUniqueGather {
+  SparseSegmentReductionOfUniqueGather() = default;
+  SparseSegmentReductionOfUniqueGather(int unique, int gather,
+                                       int sparse_segment_reduction)
+      : unique(unique),
+        gather(gather),
+        sparse_segment_reduction(sparse_segment_reduction) {}
+
+  int unique = kMissingIndex;
+  int gather = kMissingIndex;
+  int sparse_segment_reduction = kMissingIndex;
+};
+
+// Bilinear CropAndResize followed by the normalization of the crops by
+// constants, (crops - offset) * scale or (crops - offset) / stddev, and
+// optionally by their transpose to NCHW.
+struct CropResizeAndNormalize {
+  int crop_and_resize = kMissingIndex;
+  int sub = kMissingIndex;
+  // The Mul or the RealDiv.
+  int scale = kMissingIndex;
+  // The input port of the constant scale of the Mul or the RealDiv.
+  int scale_port = kMissingIndex;
+  int transpose = kMissingIndex;
+};
+
 // Pad followed by Conv3D/FusedConv3D
 struct PadWithConv3D {
   PadWithConv3D() = default;
@@ -276,6 +322,91 @@ bool IsInPreserveSet(const RemapperContext& ctx, const NodeDef* node) {
   return ctx.nodes_to_preserve.count(node->name()) > 0;
 }
 
+// Reads the mean cost of each node of the OpPerformanceList at `path` into
+// `measured_costs`. The costs are read again only once the file is modified,
+// since the remapper runs on every function of every graph.
+Status ReadMeasuredCosts(const string& path,
+                         std::shared_ptr<const MeasuredCosts>* measured_costs) {
+  struct CachedCosts {
+    int64_t mtime_nsec;
+    std::shared_ptr<const MeasuredCosts> costs;
+  };
+  static mutex* mu = new mutex;
+  static auto* cache = new absl::flat_hash_map<string, CachedCosts>;
+
+  FileStatistics stat;
+  TF_RETURN_IF_ERROR(Env::Default()->Stat(path, &stat));
+  {
+    mutex_lock lock(*mu);
+    auto it = cache->find(path);
+    if (it != cache->end() && it->second.mtime_nsec == stat.mtime_nsec) {
+      *measured_costs = it->second.costs;
+      return OkStatus();
+    }
+  }
+
+  OpPerformanceList profile;
+  TF_RETURN_IF_ERROR(ReadTextOrBinaryProto(Env::Default(), path, &profile));
+  auto costs = std::make_shared<MeasuredCosts>();
+  absl::flat_hash_map<std::pair<string, string>, int> num_runs;
+  for (const OpPerformance& perf : profile.op_performance()) {
+    if (perf.node().empty() || perf.compute_cost() <= 0) continue;
+    const auto key = std::make_pair(perf.node(), perf.op().op());
+    (*costs)[key] += perf.compute_cost();
+    ++num_runs[key];
+  }
+  for (auto& cost : *costs) {
+    cost.second /= num_runs[cost.first];
+  }
+  VLOG(1) << "Read the measured costs of " << costs->size()
+          << " nodes from " << path;
+
+  mutex_lock lock(*mu);
+  (*cache)[path] = CachedCosts{stat.mtime_nsec, costs};
+  *measured_costs = std::move(costs);
+  return OkStatus();
+}
+
+// Returns false if the profile of the remapper shows that the `nodes` ran
+// faster than the `fused_op` named `fused_name` that replaces them. Without
+// the costs of all of them, the fusion is assumed to pay.
+bool FusionPays(const RemapperContext& ctx, const string& fused_op,
+                const string& fused_name, const std::vector<int>& nodes) {
+  if (ctx.measured_costs == nullptr) return true;
+  const MeasuredCosts& measured_costs = *ctx.measured_costs;
+  const auto fused_cost =
+      measured_costs.find(std::make_pair(fused_name, fused_op));
+  if (fused_cost == measured_costs.end()) return true;
+  double unfused_cost = 0;
+  for (int node_index : nodes) {
+    const NodeDef* node = ctx.graph_view.GetNode(node_index)->node();
+    const auto cost =
+        measured_costs.find(std::make_pair(node->name(), node->op()));
+    if (cost == measured_costs.end()) return true;
+    unfused_cost += cost->second;
+  }
+  if (fused_cost->second < unfused_cost) return true;
+  VLOG(2) << "Do not fuse into " << fused_op << " " << fused_name
+          << ": the profile measured " << fused_cost->second
+          << "ns fused and " << unfused_cost << "ns unfused";
+  return false;
+}
+
+// Returns the nodes replaced by the fusion of MatMul + BiasAdd + Gelu into
+// `output`.
+std::vector<int> GeluFusionNodes(int output,
+                                 const std::set<int>& remove_node_indices) {
+  std::vector<int> nodes(remove_node_indices.begin(),
+                         remove_node_indices.end());
+  nodes.push_back(output);
+  return nodes;
+}
+
+// Returns the op contraction `node_index` fuses into.
+string FusedContractionOp(const RemapperContext& ctx, int node_index) {
+  return absl::StrCat("_Fused", ctx.graph_view.GetNode(node_index)->GetOp());
+}
+
 bool HaveSameDataType(const NodeDef* lhs, const NodeDef* rhs,
                       const string& type_attr = "T") {
   DataType lhs_attr = GetDataTypeFromAttr(*lhs, type_attr);
@@ -2319,6 +2450,263 @@ bool FindTensorToHashBucket(const RemapperContext& ctx, int node_index,
   return true;
 }
 
+bool IsSparseSegmentReduction(const NodeDef& node) {
+  const auto& op = node.op();
+  return op == "SparseSegmentSum" || op == "SparseSegmentMean" ||
+         op == "SparseSegmentSqrtN" ||
+         op == "SparseSegmentSumWithNumSegments" ||
+         op == "SparseSegmentMeanWithNumSegments" ||
+         op == "SparseSegmentSqrtNWithNumSegments";
+}
+
+bool FindSparseSegmentReductionOfUniqueGather(
+    const RemapperContext& ctx, int node_index,
+    SparseSegmentReductionOfUniqueGather* matched) {
+  // Root of the pattern must be a SparseSegment reduction.
+  const auto* node_view = ctx.graph_view.GetNode(node_index);
+  const auto* node_def = node_view->node();
+  if (!IsSparseSegmentReduction(*node_def) ||
+      node_view->NumRegularFanins() < 3) {
+    return false;
+  }
+
+  // The data of the reduction must be Gather(params, Unique(ids).y) along the
+  // first axis, and its indices Unique(ids).idx.
+  const auto& data_fanin = node_view->GetRegularFanin(0);
+  const auto* gather_node_view = data_fanin.node_view();
+  const auto* gather_node_def = gather_node_view->node();
+  if ((gather_node_def->op() != "Gather" &&
+       gather_node_def->op() != "GatherV2") ||
+      HasControlFaninOrFanout(*gather_node_view) ||
+      !HasAtMostOneFanoutAtPort0(*gather_node_view) ||
+      IsInPreserveSet(ctx, gather_node_def) ||
+      gather_node_view->NumRegularFanins() < 2) {
+    return false;
+  }
+  if (gather_node_def->op() == "GatherV2") {
+    int batch_dims = 0;
+    if (TryGetNodeAttr(*gather_node_def, "batch_dims", &batch_dims) &&
+        batch_dims != 0) {
+      return false;
+    }
+    if (gather_node_view->NumRegularFanins() < 3) return false;
+    const auto& axis_fanin = gather_node_view->GetRegularFanin(2);
+    const auto* axis_node_def = axis_fanin.node_view()->node();
+    Tensor axis;
+    if (!IsConstant(*axis_node_def) ||
+        !axis.FromProto(axis_node_def->attr().at("value").tensor()) ||
+        axis.NumElements() != 1) {
+      return false;
+    }
+    const int64_t axis_value = axis.dtype() == DT_INT32
+                                   ? axis.flat<int32>()(0)
+                                   : axis.flat<int64_t>()(0);
+    if (axis_value != 0) return false;
+  }
+
+  const auto& ids_fanin = gather_node_view->GetRegularFanin(1);
+  const auto& idx_fanin = node_view->GetRegularFanin(1);
+  const auto* unique_node_view = ids_fanin.node_view();
+  const auto* unique_node_def = unique_node_view->node();
+  if (!IsUnique(*unique_node_def) || ids_fanin.index() != 0 ||
+      idx_fanin.node_view() != unique_node_view || idx_fanin.index() != 1 ||
+      HasControlFaninOrFanout(*unique_node_view) ||
+      !HasAtMostOneFanoutAtPort0(*unique_node_view) ||
+      unique_node_view->GetRegularFanout(1).size() != 1 ||
+      IsInPreserveSet(ctx, unique_node_def) ||
+      unique_node_view->NumRegularFanins() < 1) {
+    return false;
+  }
+
+  // The ids become the indices of the reduction.
+  if (!HasDataType(unique_node_def, DT_INT32) &&
+      !HasDataType(unique_node_def, DT_INT64)) {
+    return false;
+  }
+
+  *matched = SparseSegmentReductionOfUniqueGather(
+      unique_node_view->node_index(), gather_node_view->node_index(),
+      node_index);
+  return true;
+}
+
+// Returns true if the `port` fanin of `node_view` is a float constant with at
+// most one dimension, with its value in `value` if not null.
+bool IsFloatVectorConstantFanin(const utils::MutableNodeView& node_view,
+                                int port, Tensor* value = nullptr) {
+  if (node_view.NumRegularFanins() <= port) return false;
+  const auto& fanin = node_view.GetRegularFanin(port);
+  const NodeDef* const_node_def = fanin.node_view()->node();
+  Tensor tensor;
+  if (!IsConstant(*const_node_def) || fanin.index() != 0 ||
+      !HasDataType(const_node_def, DT_FLOAT, "dtype") ||
+      !tensor.FromProto(const_node_def->attr().at("value").tensor()) ||
+      tensor.dims() > 1) {
+    return false;
+  }
+  if (value != nullptr) *value = std::move(tensor);
+  return true;
+}
+
+// Returns true if `node_view` can be fused with the node it feeds.
+bool IsFusableIntermediate(const RemapperContext& ctx,
+                           const utils::MutableNodeView& node_view) {
+  return !HasControlFaninOrFanout(node_view) &&
+         HasAtMostOneFanoutAtPort0(node_view) &&
+         !IsInPreserveSet(ctx, node_view.node());
+}
+
+bool FindCropResizeAndNormalize(const RemapperContext& ctx, int node_index,
+                                CropResizeAndNormalize* matched) {
+  CropResizeAndNormalize pattern;
+  const auto* node_view = ctx.graph_view.GetNode(node_index);
+
+  // The root of the pattern is an optional Transpose to NCHW.
+  if (IsTranspose(*node_view->node())) {
+    if (HasControlFaninOrFanout(*node_view) ||
+        !HasDataType(node_view->node(), DT_FLOAT) ||
+        node_view->NumRegularFanins() != 2) {
+      return false;
+    }
+    const NodeDef* perm_node_def =
+        node_view->GetRegularFanin(1).node_view()->node();
+    Tensor perm;
+    if (!IsConstant(*perm_node_def) ||
+        !perm.FromProto(perm_node_def->attr().at("value").tensor()) ||
+        perm.dims() != 1 || perm.NumElements() != 4) {
+      return false;
+    }
+    constexpr int64_t kNHWCToNCHW[] = {0, 3, 1, 2};
+    for (int i = 0; i < 4; ++i) {
+      const int64_t dim = perm.dtype() == DT_INT32 ? perm.vec<int32>()(i)
+                                                   : perm.vec<int64_t>()(i);
+      if (dim != kNHWCToNCHW[i]) return false;
+    }
+    pattern.transpose = node_index;
+    node_view = node_view->GetRegularFanin(0).node_view();
+    if (!IsFusableIntermediate(ctx, *node_view)) return false;
+  }
+
+  // Then the scaling of the normalization by a constant.
+  const NodeDef* scale_node_def = node_view->node();
+  if ((!IsMul(*scale_node_def) && !IsRealDiv(*scale_node_def)) ||
+      HasControlFaninOrFanout(*node_view) ||
+      !HasDataType(scale_node_def, DT_FLOAT) ||
+      node_view->NumRegularFanins() != 2) {
+    return false;
+  }
+  // Mul is commutative, so its constant scale may come first.
+  int sub_port = 0;
+  if (IsMul(*scale_node_def) &&
+      !IsSub(*node_view->GetRegularFanin(0).node_view()->node())) {
+    sub_port = 1;
+  }
+  if (!IsFloatVectorConstantFanin(*node_view, 1 - sub_port)) return false;
+  pattern.scale = node_view->node_index();
+  pattern.scale_port = 1 - sub_port;
+
+  // Then its offset by a constant.
+  const auto& sub_fanin = node_view->GetRegularFanin(sub_port);
+  const auto* sub_node_view = sub_fanin.node_view();
+  if (!IsSub(*sub_node_view->node()) || sub_fanin.index() != 0 ||
+      !IsFusableIntermediate(ctx, *sub_node_view) ||
+      !IsFloatVectorConstantFanin(*sub_node_view, 1)) {
+    return false;
+  }
+  pattern.sub = sub_node_view->node_index();
+
+  // And finally the bilinear CropAndResize of the crops.
+  const auto& crop_fanin = sub_node_view->GetRegularFanin(0);
+  const auto* crop_node_view = crop_fanin.node_view();
+  const NodeDef* crop_node_def = crop_node_view->node();
+  string method;
+  if (crop_node_def->op() != "CropAndResize" || crop_fanin.index() != 0 ||
+      !IsFusableIntermediate(ctx, *crop_node_view) ||
+      crop_node_view->NumRegularFanins() != 4 ||
+      !TryGetNodeAttr(*crop_node_def, "method", &method) ||
+      method != "bilinear") {
+    return false;
+  }
+  pattern.crop_and_resize = crop_node_view->node_index();
+
+  *matched = pattern;
+  return true;
+}
+
+Status AddCropResizeAndNormalizeNode(RemapperContext* ctx,
+                                     const CropResizeAndNormalize& matched,
+                                     std::vector<bool>* invalidated_nodes,
+                                     std::vector<bool>* nodes_to_delete) {
+  const GraphDef* graph = ctx->graph_view.graph();
+  const NodeDef& crop_and_resize = graph->node(matched.crop_and_resize);
+  const NodeDef& sub = graph->node(matched.sub);
+  const NodeDef& scale = graph->node(matched.scale);
+  const int root = matched.transpose != kMissingIndex ? matched.transpose
+                                                      : matched.scale;
+  const NodeDef& root_node = graph->node(root);
+  VLOG(2) << "Fuse " << crop_and_resize.op() << " with Sub and " << scale.op()
+          << (matched.transpose != kMissingIndex ? " and Transpose" : "")
+          << ": crop_and_resize=" << crop_and_resize.name()
+          << " root=" << root_node.name();
+
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  string scale_input = scale.input(matched.scale_port);
+  if (IsRealDiv(scale)) {
+    // The crops are divided by the stddev, so they are scaled by its
+    // reciprocal, which is a copy of the constant with the reciprocal values.
+    Tensor stddev;
+    const auto* scale_view = ctx->graph_view.GetNode(matched.scale);
+    if (!IsFloatVectorConstantFanin(*scale_view, matched.scale_port,
+                                    &stddev)) {
+      return errors::Internal("The stddev of ", scale.name(),
+                              " is not a constant");
+    }
+    auto stddev_values = stddev.flat<float>();
+    for (int64_t i = 0; i < stddev_values.size(); ++i) {
+      stddev_values(i) = 1.0f / stddev_values(i);
+    }
+    NodeDef reciprocal =
+        *scale_view->GetRegularFanin(matched.scale_port).node_view()->node();
+    reciprocal.set_name(AddPrefixToNodeName("reciprocal_stddev",
+                                            root_node.name()));
+    stddev.AsProtoTensorContent(
+        (*reciprocal.mutable_attr())["value"].mutable_tensor());
+    scale_input = reciprocal.name();
+    mutation->AddNode(std::move(reciprocal), &status);
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  NodeDef fused_op;
+  fused_op.set_name(root_node.name());
+  fused_op.set_op(kCropResizeAndNormalize);
+  fused_op.set_device(crop_and_resize.device());
+  for (int i = 0; i < 4; ++i) {
+    fused_op.add_input(crop_and_resize.input(i));  // image, boxes, box_ind,
+                                                   // crop_size
+  }
+  fused_op.add_input(sub.input(1));  // offset
+  fused_op.add_input(scale_input);   // scale
+
+  auto* attr = fused_op.mutable_attr();
+  (*attr)["T"] = crop_and_resize.attr().at("T");
+  (*attr)["extrapolation_value"] =
+      crop_and_resize.attr().at("extrapolation_value");
+  SetAttrValue(matched.transpose != kMissingIndex ? "NCHW" : "NHWC",
+               &(*attr)[kDataFormat]);
+
+  mutation->AddNode(std::move(fused_op), &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(mutation->Apply());
+
+  (*invalidated_nodes)[root] = true;
+  (*nodes_to_delete)[matched.crop_and_resize] = true;
+  (*nodes_to_delete)[matched.sub] = true;
+  if (root != matched.scale) (*nodes_to_delete)[matched.scale] = true;
+
+  return OkStatus();
+}
+
 bool FindFusedBatchMatMul(RemapperContext* ctx, int node_index,
                           std::map<string, int>* matched_nodes_map,
                           std::set<int>* remove_node_indices) {
@@ -3543,6 +3931,37 @@ Status AddTensorToHashBucketNode(RemapperContext* ctx,
   return OkStatus();
 }
 
+Status AddSparseSegmentReductionOfIdsNode(
+    RemapperContext* ctx, const SparseSegmentReductionOfUniqueGather& matched,
+    std::vector<bool>* invalidated_nodes, std::vector<bool>* nodes_to_delete) {
+  const GraphDef* graph = ctx->graph_view.graph();
+  const NodeDef& unique = graph->node(matched.unique);
+  const NodeDef& gather = graph->node(matched.gather);
+  const NodeDef& reduction = graph->node(matched.sparse_segment_reduction);
+  VLOG(2) << "Fuse Unique and " << gather.op() << " into " << reduction.op()
+          << ": unique=" << unique.name() << " gather=" << gather.name()
+          << " reduction=" << reduction.name();
+
+  // The rows at the ids are the rows of the unique ids at their indices, so
+  // the reduction reads the params at the ids directly.
+  const string params = gather.input(0);
+  const string ids = unique.input(0);
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  auto* reduction_view =
+      ctx->graph_view.GetNode(matched.sparse_segment_reduction);
+  mutation->AddOrUpdateRegularFanin(reduction_view, 0,
+                                    ParseTensorName(params));
+  mutation->AddOrUpdateRegularFanin(reduction_view, 1, ParseTensorName(ids));
+  mutation->AddOrUpdateNodeAttr(reduction_view, "Tidx", unique.attr().at("T"));
+  TF_RETURN_IF_ERROR(mutation->Apply());
+
+  (*invalidated_nodes)[matched.sparse_segment_reduction] = true;
+  (*nodes_to_delete)[matched.gather] = true;
+  (*nodes_to_delete)[matched.unique] = true;
+
+  return OkStatus();
+}
+
 Status AddFusedBatchMatMul(RemapperContext* ctx,
                            const std::map<string, int>& matched_nodes_map,
                            const std::set<int>& remove_node_indices,
@@ -3896,6 +4315,362 @@ bool RequiresInferredShapes(const RemapperContext& ctx, int node_index,
          is_matmul_gelu_exact_fusion_candidate() ||
          is_act_biasadd_matmul_candidate();
 }
+
+// Picks the members of each group of candidate nodes to fuse: in topological
+// order, the candidates accepted by `accept` that are not reachable from a
+// member picked before them through regular or control edges. As a node comes
+// after the nodes it is reachable from, no member of a group is then
+// reachable from another. The groups of the members each node is reachable
+// from are propagated in one pass over the graph, rather than searching the
+// graph for every pair of candidates. The members are sorted by node index.
+Status PickIndependentMembers(
+    const utils::MutableGraphView& graph_view,
+    const std::vector<std::vector<int>>& groups,
+    const std::function<bool(int group, int node_index)>& accept,
+    std::vector<std::vector<int>>* members) {
+  std::vector<int> group_of(graph_view.NumNodes(), -1);
+  for (size_t group = 0; group < groups.size(); ++group) {
+    for (int node_index : groups[group]) group_of[node_index] = group;
+  }
+  std::vector<const NodeDef*> topo_order;
+  TF_RETURN_IF_ERROR(ComputeTopologicalOrder(*graph_view.graph(), &topo_order));
+
+  // The groups of the members each node is reachable from.
+  std::vector<absl::flat_hash_set<int>> reached_from(graph_view.NumNodes());
+  members->assign(groups.size(), {});
+  for (const NodeDef* node : topo_order) {
+    const auto* node_view = graph_view.GetNode(node->name());
+    const int index = node_view->node_index();
+    absl::flat_hash_set<int> reached = std::move(reached_from[index]);
+    const int group = group_of[index];
+    if (group >= 0 && !reached.contains(group) && accept(group, index)) {
+      (*members)[group].push_back(index);
+      reached.insert(group);
+    }
+    if (reached.empty()) continue;
+    auto propagate = [&](const utils::MutableFaninView& fanout) {
+      reached_from[fanout.node_index()].insert(reached.begin(), reached.end());
+    };
+    for (const auto& port_fanouts : node_view->GetRegularFanouts()) {
+      for (const auto& fanout : port_fanouts) propagate(fanout);
+    }
+    for (const auto& fanout : node_view->GetControlledFanouts()) {
+      propagate(fanout);
+    }
+  }
+  for (std::vector<int>& group_members : *members) {
+    std::sort(group_members.begin(), group_members.end());
+  }
+  return OkStatus();
+}
+
+// Fuses the ResourceApplyAdam ops on CPU that share their scalar inputs and
+// attributes, typically the updates of all the variables of a model by one
+// optimizer, into _ResourceApplyAdamMulti ops. A model with many small
+// variables otherwise pays the cost of scheduling one kernel per variable.
+// The fused op takes the name of the first op of its group, and the others
+// become NoOps depending on it so that their control fanouts still wait for
+// the updates.
+Status AddResourceApplyAdamMultiNodes(RemapperContext* ctx) {
+  constexpr int kNumScalars = 6;
+  utils::MutableGraphView* graph_view = &ctx->graph_view;
+  std::map<std::vector<string>, std::vector<int>> groups;
+  for (int i = 0; i < graph_view->NumNodes(); ++i) {
+    const NodeDef* node = graph_view->GetNode(i)->node();
+    if (node->op() != "ResourceApplyAdam" || !NodeIsOnCpu(node) ||
+        IsInPreserveSet(*ctx, node) ||
+        graph_view->GetNode(i)->NumRegularFanins() != 3 + kNumScalars + 1) {
+      continue;
+    }
+    const DataType dtype = GetDataTypeFromAttr(*node, "T");
+    if (dtype != DT_HALF && dtype != DT_BFLOAT16 && dtype != DT_FLOAT &&
+        dtype != DT_DOUBLE) {
+      continue;
+    }
+    const auto& attrs = node->attr();
+    const bool use_locking =
+        attrs.count("use_locking") > 0 && attrs.at("use_locking").b();
+    const bool use_nesterov =
+        attrs.count("use_nesterov") > 0 && attrs.at("use_nesterov").b();
+    std::vector<string> key = {node->device(), DataTypeString(dtype),
+                               use_locking ? "1" : "0",
+                               use_nesterov ? "1" : "0"};
+    for (int j = 3; j < 3 + kNumScalars; ++j) key.push_back(node->input(j));
+    groups[std::move(key)].push_back(i);
+  }
+
+  if (groups.empty()) return OkStatus();
+
+  // A candidate reachable from another, or updating the same variables as
+  // another, is left alone: fusing them would create a cycle or a race.
+  std::vector<std::vector<int>> candidates;
+  for (auto& group : groups) candidates.push_back(std::move(group.second));
+  std::vector<absl::flat_hash_set<string>> variables(candidates.size());
+  std::vector<std::vector<int>> groups_members;
+  TF_RETURN_IF_ERROR(PickIndependentMembers(
+      *graph_view, candidates,
+      [&](int group, int node_index) {
+        const NodeDef* node = graph_view->GetNode(node_index)->node();
+        for (int j = 0; j < 3; ++j) {
+          if (variables[group].contains(node->input(j))) return false;
+        }
+        for (int j = 0; j < 3; ++j) variables[group].insert(node->input(j));
+        return true;
+      },
+      &groups_members));
+
+  utils::Mutation* mutation = graph_view->GetMutationBuilder();
+  bool fused_any = false;
+  for (const std::vector<int>& members : groups_members) {
+    if (members.size() < 2) continue;
+
+    const NodeDef* first = graph_view->GetNode(members[0])->node();
+    const int num_vars = members.size();
+    NodeDef fused_op;
+    fused_op.set_name(first->name());
+    fused_op.set_op("_ResourceApplyAdamMulti");
+    fused_op.set_device(first->device());
+    for (int j = 0; j < 3; ++j) {
+      for (int member : members) {
+        fused_op.add_input(graph_view->GetNode(member)->node()->input(j));
+      }
+    }
+    for (int j = 3; j < 3 + kNumScalars; ++j) {
+      fused_op.add_input(first->input(j));
+    }
+    for (int member : members) {
+      const NodeDef* node = graph_view->GetNode(member)->node();
+      fused_op.add_input(node->input(3 + kNumScalars));
+    }
+    // The control inputs of all the members, but for the nodes that are
+    // already regular inputs.
+    absl::flat_hash_set<string> fanin_nodes;
+    for (const string& input : fused_op.input()) {
+      fanin_nodes.insert(string(ParseTensorName(input).node()));
+    }
+    for (int member : members) {
+      for (const auto& control : graph_view->GetNode(member)
+                                     ->GetControllingFanins()) {
+        const string& name = control.node_view()->GetName();
+        if (fanin_nodes.insert(name).second) {
+          fused_op.add_input(AsControlDependency(name));
+        }
+      }
+    }
+    auto* attrs = fused_op.mutable_attr();
+    SetAttrValue(num_vars, &(*attrs)["N"]);
+    (*attrs)["T"] = first->attr().at("T");
+    SetAttrValue(first->attr().count("use_locking") > 0 &&
+                     first->attr().at("use_locking").b(),
+                 &(*attrs)["use_locking"]);
+    SetAttrValue(first->attr().count("use_nesterov") > 0 &&
+                     first->attr().at("use_nesterov").b(),
+                 &(*attrs)["use_nesterov"]);
+
+    const string fused_name = fused_op.name();
+    std::vector<NodeDef> no_ops;
+    for (int m = 1; m < num_vars; ++m) {
+      const NodeDef* node = graph_view->GetNode(members[m])->node();
+      NodeDef no_op;
+      no_op.set_name(node->name());
+      no_op.set_op("NoOp");
+      no_op.set_device(node->device());
+      no_op.add_input(AsControlDependency(fused_name));
+      no_ops.push_back(std::move(no_op));
+    }
+
+    VLOG(2) << "Fuse " << num_vars << " ResourceApplyAdam ops into "
+            << fused_name;
+    Status status;
+    mutation->AddNode(std::move(fused_op), &status);
+    TF_RETURN_IF_ERROR(status);
+    for (NodeDef& no_op : no_ops) {
+      mutation->AddNode(std::move(no_op), &status);
+      TF_RETURN_IF_ERROR(status);
+    }
+    fused_any = true;
+  }
+  if (!fused_any) return OkStatus();
+  return mutation->Apply();
+}
+
+// Batches the independent MatMuls with the same static shapes and attributes,
+// such as the identical branches of a multi-tower model, into one
+// BatchMatMulV2 of their stacked operands. Only small MatMuls are batched:
+// their operands are copied into the stacks every step, which pays off only
+// when the launch of each kernel dominates its computation. Each MatMul is
+// replaced by an Identity of its slice of the batched product, which keeps
+// its name and fanouts.
+Status AddBatchedMatMulNodes(RemapperContext* ctx) {
+  constexpr int kMinMatMulsToBatch = 4;
+  constexpr int64_t kMaxMatMulSizeToBatch = 1 << 20;
+  utils::MutableGraphView* graph_view = &ctx->graph_view;
+  std::vector<int> matmuls;
+  for (int i = 0; i < graph_view->NumNodes(); ++i) {
+    const NodeDef* node = graph_view->GetNode(i)->node();
+    if (node->op() != "MatMul" ||
+        IsInPreserveSet(*ctx, node) ||
+        graph_view->GetNode(i)->NumRegularFanins() != 2) {
+      continue;
+    }
+    const DataType dtype = GetDataTypeFromAttr(*node, "T");
+    if (dtype == DT_HALF || dtype == DT_BFLOAT16 || dtype == DT_FLOAT ||
+        dtype == DT_DOUBLE) {
+      matmuls.push_back(i);
+    }
+  }
+  if (static_cast<int>(matmuls.size()) < kMinMatMulsToBatch) {
+    return OkStatus();
+  }
+  if (!ctx->inferred_graph_properties) {
+    TF_RETURN_IF_ERROR(ctx->graph_properties.InferStatically(
+        /*assume_valid_feeds=*/true,
+        /*aggressive_shape_inference=*/false,
+        /*include_input_tensor_values=*/false,
+        /*include_output_tensor_values=*/false));
+    ctx->inferred_graph_properties = true;
+  }
+
+  std::map<std::vector<string>, std::vector<int>> groups;
+  for (int i : matmuls) {
+    const NodeDef* node = graph_view->GetNode(i)->node();
+    const auto& props = ctx->graph_properties.GetInputProperties(node->name());
+    if (props.size() != 2) continue;
+    const PartialTensorShape a_shape(props[0].shape());
+    const PartialTensorShape b_shape(props[1].shape());
+    if (!a_shape.IsFullyDefined() || a_shape.dims() != 2 ||
+        !b_shape.IsFullyDefined() || b_shape.dims() != 2) {
+      continue;
+    }
+    const bool transpose_a = node->attr().count("transpose_a") > 0 &&
+                             node->attr().at("transpose_a").b();
+    const bool transpose_b = node->attr().count("transpose_b") > 0 &&
+                             node->attr().at("transpose_b").b();
+    const int64_t size = a_shape.dim_size(transpose_a ? 1 : 0) *
+                         a_shape.dim_size(transpose_a ? 0 : 1) *
+                         b_shape.dim_size(transpose_b ? 0 : 1);
+    if (size > kMaxMatMulSizeToBatch) continue;
+    std::vector<string> key = {
+        node->device(), DataTypeString(GetDataTypeFromAttr(*node, "T")),
+        transpose_a ? "1" : "0", transpose_b ? "1" : "0",
+        a_shape.DebugString(), b_shape.DebugString()};
+    groups[std::move(key)].push_back(i);
+  }
+
+  // A MatMul reachable from another is left alone: batching them would
+  // create a cycle.
+  std::vector<std::vector<int>> candidates;
+  for (auto& group : groups) {
+    if (static_cast<int>(group.second.size()) >= kMinMatMulsToBatch) {
+      candidates.push_back(std::move(group.second));
+    }
+  }
+  if (candidates.empty()) return OkStatus();
+  std::vector<std::vector<int>> groups_members;
+  TF_RETURN_IF_ERROR(PickIndependentMembers(
+      *graph_view, candidates, [](int, int) { return true; },
+      &groups_members));
+
+  utils::Mutation* mutation = graph_view->GetMutationBuilder();
+  bool batched_any = false;
+  for (const std::vector<int>& members : groups_members) {
+    if (static_cast<int>(members.size()) < kMinMatMulsToBatch) continue;
+
+    const NodeDef* first = graph_view->GetNode(members[0])->node();
+    const string prefix = absl::StrCat(first->name(), "/batched");
+    const string lhs_name = absl::StrCat(prefix, "/lhs");
+    const string rhs_name = absl::StrCat(prefix, "/rhs");
+    const string product_name = absl::StrCat(prefix, "/product");
+    const string slices_name = absl::StrCat(prefix, "/slices");
+    if (graph_view->GetNode(lhs_name) != nullptr ||
+        graph_view->GetNode(rhs_name) != nullptr ||
+        graph_view->GetNode(product_name) != nullptr ||
+        graph_view->GetNode(slices_name) != nullptr) {
+      continue;
+    }
+    const int num_matmuls = members.size();
+    const AttrValue& dtype = first->attr().at("T");
+
+    auto pack = [&](const string& name, int input) {
+      NodeDef node;
+      node.set_name(name);
+      node.set_op("Pack");
+      node.set_device(first->device());
+      for (int member : members) {
+        node.add_input(graph_view->GetNode(member)->node()->input(input));
+      }
+      auto* attrs = node.mutable_attr();
+      SetAttrValue(num_matmuls, &(*attrs)["N"]);
+      (*attrs)["T"] = dtype;
+      SetAttrValue(0, &(*attrs)["axis"]);
+      return node;
+    };
+    NodeDef lhs = pack(lhs_name, 0);
+    NodeDef rhs = pack(rhs_name, 1);
+
+    NodeDef product;
+    product.set_name(product_name);
+    product.set_op("BatchMatMulV2");
+    product.set_device(first->device());
+    product.add_input(lhs_name);
+    product.add_input(rhs_name);
+    // The control inputs of all the members, which the product waits for.
+    absl::flat_hash_set<string> control_inputs;
+    for (int member : members) {
+      for (const auto& control :
+           graph_view->GetNode(member)->GetControllingFanins()) {
+        const string& name = control.node_view()->GetName();
+        if (control_inputs.insert(name).second) {
+          product.add_input(AsControlDependency(name));
+        }
+      }
+    }
+    auto* product_attrs = product.mutable_attr();
+    (*product_attrs)["T"] = dtype;
+    SetAttrValue(first->attr().count("transpose_a") > 0 &&
+                     first->attr().at("transpose_a").b(),
+                 &(*product_attrs)["adj_x"]);
+    SetAttrValue(first->attr().count("transpose_b") > 0 &&
+                     first->attr().at("transpose_b").b(),
+                 &(*product_attrs)["adj_y"]);
+
+    NodeDef slices;
+    slices.set_name(slices_name);
+    slices.set_op("Unpack");
+    slices.set_device(first->device());
+    slices.add_input(product_name);
+    auto* slices_attrs = slices.mutable_attr();
+    SetAttrValue(num_matmuls, &(*slices_attrs)["num"]);
+    (*slices_attrs)["T"] = dtype;
+    SetAttrValue(0, &(*slices_attrs)["axis"]);
+
+    std::vector<NodeDef> identities;
+    for (int m = 0; m < num_matmuls; ++m) {
+      const NodeDef* node = graph_view->GetNode(members[m])->node();
+      NodeDef identity;
+      identity.set_name(node->name());
+      identity.set_op("Identity");
+      identity.set_device(node->device());
+      identity.add_input(absl::StrCat(slices_name, ":", m));
+      (*identity.mutable_attr())["T"] = dtype;
+      identities.push_back(std::move(identity));
+    }
+
+    VLOG(2) << "Batch " << num_matmuls << " MatMul ops into " << product_name;
+    Status status;
+    for (NodeDef* node : {&lhs, &rhs, &product, &slices}) {
+      mutation->AddNode(std::move(*node), &status);
+      TF_RETURN_IF_ERROR(status);
+    }
+    for (NodeDef& identity : identities) {
+      mutation->AddNode(std::move(identity), &status);
+      TF_RETURN_IF_ERROR(status);
+    }
+    batched_any = true;
+  }
+  if (!batched_any) return OkStatus();
+  return mutation->Apply();
+}
 }  // namespace
 
 Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
@@ -3905,6 +4680,9 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
   RemapperContext ctx(&mutable_item, &status, cpu_layout_conversion_,
                       xla_auto_clustering_on_);
   TF_RETURN_IF_ERROR(status);
+  if (!profile_path_.empty()) {
+    TF_RETURN_IF_ERROR(ReadMeasuredCosts(profile_path_, &ctx.measured_costs));
+  }
   // Processing graph in reverse-topological sorted order allows to remap
   // longer chains of dependent ops in one pass.
   TF_RETURN_IF_ERROR(
@@ -4046,7 +4824,9 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
     std::set<int> remove_node_indices;
     bool is_gelu_approximate = false;
     if (FindMatMulBiasAddAndGelu(&ctx, i, cluster, &matched_nodes_map,
-                                 &remove_node_indices, &is_gelu_approximate)) {
+                                 &remove_node_indices, &is_gelu_approximate) &&
+        FusionPays(ctx, "_FusedMatMul", ctx.graph_view.GetNode(i)->GetName(),
+                   GeluFusionNodes(i, remove_node_indices))) {
       TF_RETURN_IF_ERROR(AddFusedMatMulBiasAddAndGelu(
           &ctx, matched_nodes_map, remove_node_indices, &invalidated_nodes,
           &nodes_to_delete, is_gelu_approximate));
@@ -4057,7 +4837,11 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
     // _Fused{Conv2D,DepthwiseConv2dNative,MatMul}
     ContractionWithBiasAdd contract_with_bias;
     if (allow_non_differentiable_rewrites &&
-        FindContractionWithBias(ctx, i, &contract_with_bias)) {
+        FindContractionWithBias(ctx, i, &contract_with_bias) &&
+        FusionPays(ctx, FusedContractionOp(ctx, contract_with_bias.contraction),
+                   ctx.graph_view.GetNode(i)->GetName(),
+                   {contract_with_bias.contraction,
+                    contract_with_bias.bias_add})) {
       TF_RETURN_IF_ERROR(AddFusedContractionNode(
           &ctx, contract_with_bias, &invalidated_nodes, &nodes_to_delete));
       continue;
@@ -4068,7 +4852,14 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
     ContractionWithBiasAddAndActivation contract_with_bias_and_activation;
     if (allow_non_differentiable_rewrites &&
         FindContractionWithBiasAndActivation(
-            ctx, cluster, i, &contract_with_bias_and_activation)) {
+            ctx, cluster, i, &contract_with_bias_and_activation) &&
+        FusionPays(ctx,
+                   FusedContractionOp(
+                       ctx, contract_with_bias_and_activation.contraction),
+                   ctx.graph_view.GetNode(i)->GetName(),
+                   {contract_with_bias_and_activation.contraction,
+                    contract_with_bias_and_activation.bias_add,
+                    contract_with_bias_and_activation.activation})) {
       TF_RETURN_IF_ERROR(
           AddFusedContractionNode(&ctx, contract_with_bias_and_activation,
                                   &invalidated_nodes, &nodes_to_delete));
@@ -4140,6 +4931,29 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
       continue;
     }
 
+    // Remap SparseSegmentSum(Gather(params, Unique(ids).y), Unique(ids).idx)
+    // and the other SparseSegment reductions into a reduction of the params at
+    // the ids, skipping the deduplication and the materialized gather.
+    SparseSegmentReductionOfUniqueGather sparse_segment_reduction;
+    if (FindSparseSegmentReductionOfUniqueGather(ctx, i,
+                                                 &sparse_segment_reduction)) {
+      TF_RETURN_IF_ERROR(AddSparseSegmentReductionOfIdsNode(
+          &ctx, sparse_segment_reduction, &invalidated_nodes,
+          &nodes_to_delete));
+      continue;
+    }
+
+    // Remap CropAndResize+Sub+{Mul,RealDiv}+<Transpose> into the
+    // CropResizeAndNormalize that computes the normalized crops directly.
+    CropResizeAndNormalize crop_resize_and_normalize;
+    if (allow_non_differentiable_rewrites &&
+        FindCropResizeAndNormalize(ctx, i, &crop_resize_and_normalize)) {
+      TF_RETURN_IF_ERROR(AddCropResizeAndNormalizeNode(
+          &ctx, crop_resize_and_normalize, &invalidated_nodes,
+          &nodes_to_delete));
+      continue;
+    }
+
     // During inference, most of the inputs to FusedBatchNorm are constant, and
     // we can therefore replace the op with a much cheaper set of primitives.
     FusedBatchNorm fused_batch_norm;
@@ -4158,6 +4972,16 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
   }
   TF_RETURN_IF_ERROR(mutation->Apply());
 
+  // Fuse the updates of the variables by the same Adam optimizer, which are
+  // independent of each other, once the rest of the graph is remapped.
+  TF_RETURN_IF_ERROR(AddResourceApplyAdamMultiNodes(&ctx));
+
+  // Batching the small MatMuls of identical branches relies on their inferred
+  // shapes, so it is only done when feeds are assumed to match them.
+  if (opt_level_ == RewriterConfig::AGGRESSIVE) {
+    TF_RETURN_IF_ERROR(AddBatchedMatMulNodes(&ctx));
+  }
+
   *optimized_graph = std::move(mutable_item.graph);
 
   return OkStatus();
@@ -29,10 +29,12 @@ class Remapper : public GraphOptimizer {
   explicit Remapper(RewriterConfig::Toggle opt_level,
                     RewriterConfig::CpuLayout cpu_layout_conversion =
                         RewriterConfig::NO_CONVERSION_ON_CPU,
-                    bool xla_auto_clustering_on = false)
+                    bool xla_auto_clustering_on = false,
+                    const string& profile_path = "")
       : opt_level_(opt_level),
         cpu_layout_conversion_(cpu_layout_conversion),
-        xla_auto_clustering_on_(xla_auto_clustering_on) {}
+        xla_auto_clustering_on_(xla_auto_clustering_on),
+        profile_path_(profile_path) {}
 
   ~Remapper() override {}
 
@@ -47,6 +49,8 @@ class Remapper : public GraphOptimizer {
   RewriterConfig::Toggle opt_level_;
   RewriterConfig::CpuLayout cpu_layout_conversion_;
   bool xla_auto_clustering_on_;
+  // The OpPerformanceList deciding which fusions pay, if not empty.
+  string profile_path_;
 };
 
 }  // end namespace grappler
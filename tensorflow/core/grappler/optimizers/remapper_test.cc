@@ -15,15 +15,21 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 
+#include <set>
+
 #include "tensorflow/cc/ops/nn_ops_internal.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
 #include "tensorflow/core/grappler/devices.h"
 #include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/util/util.h"
 
@@ -1414,6 +1420,359 @@ TEST_F(RemapperTensorToHashBucketTest, I32) { RunTest<DT_INT32>(); }
 
 TEST_F(RemapperTensorToHashBucketTest, I64) { RunTest<DT_INT64>(); }
 
+TEST_F(RemapperTest, SparseSegmentReductionOfUniqueGather) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  auto params = ops::Placeholder(s.WithOpName("params"), DT_FLOAT,
+                                 ops::Placeholder::Shape({16, 8}));
+  auto ids = ops::Placeholder(s.WithOpName("ids"), DT_INT64,
+                              ops::Placeholder::Shape({6}));
+  auto segment_ids =
+      ops::Const(s.WithOpName("segment_ids"), {0, 0, 1, 3, 3, 3}, {6});
+  auto unique = ops::Unique(s.WithOpName("unique"), ids);
+  auto axis = ops::Const(s.WithOpName("axis"), 0);
+  auto gather = ops::GatherV2(s.WithOpName("gather"), params, unique.y, axis);
+  auto reduction = ops::SparseSegmentMean(s.WithOpName("reduction"), gather,
+                                          unique.idx, segment_ids);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), reduction);
+
+  auto params_t = GenerateRandomTensor<DT_FLOAT>({16, 8});
+  auto ids_t = test::AsTensor<int64_t>({3, 7, 3, 15, 0, 7});
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.feed = {{"params", params_t}, {"ids", ids_t}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.name(), "unique");
+    EXPECT_NE(node.name(), "gather");
+    if (node.name() == "reduction") {
+      EXPECT_EQ(node.op(), "SparseSegmentMean");
+      ASSERT_EQ(node.input_size(), 3);
+      EXPECT_EQ(node.input(0), "params");
+      EXPECT_EQ(node.input(1), "ids");
+      EXPECT_EQ(node.input(2), "segment_ids");
+      EXPECT_EQ(node.attr().at("Tidx").type(), DT_INT64);
+      found++;
+    }
+  }
+  EXPECT_EQ(found, 1);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-6);
+}
+
+TEST_F(RemapperTest, CropResizeAndNormalize) {
+  for (bool divide_and_transpose : {false, true}) {
+    tensorflow::Scope s =
+        tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+    auto image = ops::Placeholder(s.WithOpName("image"), DT_UINT8,
+                                  ops::Placeholder::Shape({2, 16, 12, 3}));
+    auto boxes = ops::Const(s.WithOpName("boxes"),
+                            {0.1f, 0.2f, 0.9f, 0.7f, -0.1f, 0.0f, 0.5f, 1.2f},
+                            {2, 4});
+    auto box_ind = ops::Const(s.WithOpName("box_ind"), {1, 0}, {2});
+    auto crop_size = ops::Const(s.WithOpName("crop_size"), {5, 7}, {2});
+    auto crops = ops::CropAndResize(s.WithOpName("crops"), image, boxes,
+                                    box_ind, crop_size);
+    auto mean =
+        ops::Const(s.WithOpName("mean"), {120.0f, 115.0f, 100.0f}, {3});
+    auto centered = ops::Sub(s.WithOpName("centered"), crops, mean);
+    Output normalized;
+    if (divide_and_transpose) {
+      auto stddev = ops::Const(s.WithOpName("stddev"), {58.0f, 57.0f, 57.5f},
+                               {3});
+      auto divided = ops::RealDiv(s.WithOpName("divided"), centered, stddev);
+      normalized = ops::Transpose(s.WithOpName("normalized"), divided,
+                                  ops::Const(s.WithOpName("perm"),
+                                             {0, 3, 1, 2}, {4}));
+    } else {
+      normalized =
+          ops::Mul(s.WithOpName("normalized"),
+                   ops::Const(s.WithOpName("scale"), 1.0f / 255), centered);
+    }
+    auto fetch = ops::Identity(s.WithOpName("fetch"), normalized);
+
+    auto image_t = GenerateRandomTensor<DT_UINT8>({2, 16, 12, 3});
+    GrapplerItem item;
+    item.fetch = {"fetch"};
+    item.feed = {{"image", image_t}};
+    TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+    Remapper optimizer(RewriterConfig::ON);
+    GraphDef output;
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+    int found = 0;
+    for (const NodeDef& node : output.node()) {
+      EXPECT_NE(node.name(), "crops");
+      EXPECT_NE(node.name(), "centered");
+      EXPECT_NE(node.name(), "divided");
+      if (node.name() == "normalized") {
+        EXPECT_EQ(node.op(), "CropResizeAndNormalize");
+        ASSERT_EQ(node.input_size(), 6);
+        EXPECT_EQ(node.input(0), "image");
+        EXPECT_EQ(node.input(3), "crop_size");
+        EXPECT_EQ(node.input(4), "mean");
+        EXPECT_EQ(node.input(5), divide_and_transpose
+                                     ? "normalized/reciprocal_stddev"
+                                     : "scale");
+        EXPECT_EQ(node.attr().at("data_format").s(),
+                  divide_and_transpose ? "NCHW" : "NHWC");
+        found++;
+      }
+    }
+    EXPECT_EQ(found, 1);
+
+    auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+    ASSERT_EQ(tensors_expected.size(), 1);
+    auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+    ASSERT_EQ(tensors.size(), 1);
+    test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-5);
+  }
+}
+
+TEST_F(RemapperTest, ResourceApplyAdamMulti) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  auto scalar = [&](const string& name) {
+    return ops::Placeholder(s.WithOpName(name), DT_FLOAT,
+                            ops::Placeholder::Shape({}));
+  };
+  auto beta1_power = scalar("beta1_power");
+  auto beta2_power = scalar("beta2_power");
+  auto lr = scalar("lr");
+  auto other_lr = scalar("other_lr");
+  auto beta1 = scalar("beta1");
+  auto beta2 = scalar("beta2");
+  auto epsilon = scalar("epsilon");
+  auto apply = [&](const string& name, Input lr, const TensorShape& shape) {
+    auto handle = [&](const string& suffix) {
+      return ops::VarHandleOp(s.WithOpName(name + suffix), DT_FLOAT, shape);
+    };
+    auto grad = ops::Placeholder(s.WithOpName(name + "/grad"), DT_FLOAT,
+                                 ops::Placeholder::Shape(shape));
+    return ops::ResourceApplyAdam(s.WithOpName(name), handle("/var"),
+                                  handle("/m"), handle("/v"), beta1_power,
+                                  beta2_power, lr, beta1, beta2, epsilon, grad);
+  };
+  auto apply_0 = apply("apply_0", lr, {4, 3});
+  auto apply_1 = apply("apply_1", lr, {7});
+  auto apply_2 = apply("apply_2", lr, {});
+  // Uses another learning rate, so is not fused with the others.
+  auto apply_3 = apply("apply_3", other_lr, {2});
+  auto train = ops::NoOp(s.WithOpName("train").WithControlDependencies(
+      {apply_0, apply_1, apply_2, apply_3}));
+
+  GrapplerItem item;
+  item.fetch = {"train"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // The fused op takes the name of one of the ops it replaces, which
+  // become NoOps.
+  const NodeDef* fused = nullptr;
+  for (const NodeDef& node : output.node()) {
+    if (node.op() == "_ResourceApplyAdamMulti") {
+      EXPECT_EQ(fused, nullptr);
+      fused = &node;
+    }
+  }
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(fused->attr().at("N").i(), 3);
+  EXPECT_EQ(fused->attr().at("T").type(), DT_FLOAT);
+  ASSERT_EQ(fused->input_size(), 3 * 3 + 6 + 3);
+  std::set<string> fused_names;
+  for (int i = 0; i < 3; ++i) {
+    const string name = fused->input(i).substr(0, fused->input(i).find('/'));
+    fused_names.insert(name);
+    EXPECT_EQ(fused->input(i), name + "/var");
+    EXPECT_EQ(fused->input(3 + i), name + "/m");
+    EXPECT_EQ(fused->input(6 + i), name + "/v");
+    EXPECT_EQ(fused->input(15 + i), name + "/grad");
+  }
+  EXPECT_EQ(fused_names, std::set<string>({"apply_0", "apply_1", "apply_2"}));
+  EXPECT_EQ(fused->input(11), "lr");
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "apply_3") {
+      EXPECT_EQ(node.op(), "ResourceApplyAdam");
+      found++;
+    } else if (fused_names.count(node.name()) && &node != fused) {
+      EXPECT_EQ(node.op(), "NoOp");
+      ASSERT_EQ(node.input_size(), 1);
+      EXPECT_EQ(node.input(0), AsControlDependency(fused->name()));
+      found++;
+    }
+  }
+  EXPECT_EQ(found, 3);
+}
+
+TEST_F(RemapperTest, ResourceApplyAdamMultiSkipsDependentUpdates) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  auto scalar = ops::Placeholder(s.WithOpName("scalar"), DT_FLOAT,
+                                 ops::Placeholder::Shape({}));
+  auto apply = [&](const string& name, const Scope& scope) {
+    auto handle = [&](const string& suffix) {
+      return ops::VarHandleOp(s.WithOpName(name + suffix), DT_FLOAT, {2});
+    };
+    auto grad = ops::Placeholder(s.WithOpName(name + "/grad"), DT_FLOAT,
+                                 ops::Placeholder::Shape({2}));
+    return ops::ResourceApplyAdam(scope.WithOpName(name), handle("/var"),
+                                  handle("/m"), handle("/v"), scalar, scalar,
+                                  scalar, scalar, scalar, scalar, grad);
+  };
+  auto apply_0 = apply("apply_0", s);
+  // Runs after apply_0, so fusing them would create a cycle.
+  auto apply_1 = apply("apply_1", s.WithControlDependencies({apply_0}));
+  auto train = ops::NoOp(
+      s.WithOpName("train").WithControlDependencies({apply_0, apply_1}));
+
+  GrapplerItem item;
+  item.fetch = {"train"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.op(), "_ResourceApplyAdamMulti");
+  }
+}
+
+TEST_F(RemapperTest, ResourceApplyAdamMultiFusesIndependentUpdates) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  auto scalar = ops::Placeholder(s.WithOpName("scalar"), DT_FLOAT,
+                                 ops::Placeholder::Shape({}));
+  auto apply = [&](const string& name, const Scope& scope) {
+    auto handle = [&](const string& suffix) {
+      return ops::VarHandleOp(s.WithOpName(name + suffix), DT_FLOAT, {2});
+    };
+    auto grad = ops::Placeholder(s.WithOpName(name + "/grad"), DT_FLOAT,
+                                 ops::Placeholder::Shape({2}));
+    return ops::ResourceApplyAdam(scope.WithOpName(name), handle("/var"),
+                                  handle("/m"), handle("/v"), scalar, scalar,
+                                  scalar, scalar, scalar, scalar, grad);
+  };
+  auto apply_0 = apply("apply_0", s);
+  auto apply_1 = apply("apply_1", s.WithControlDependencies({apply_0}));
+  // Independent of both apply_0 and apply_1, so it is fused with apply_0.
+  auto apply_2 = apply("apply_2", s);
+  auto train = ops::NoOp(s.WithOpName("train").WithControlDependencies(
+      {apply_0, apply_1, apply_2}));
+
+  GrapplerItem item;
+  item.fetch = {"train"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "apply_0") {
+      EXPECT_EQ(node.op(), "_ResourceApplyAdamMulti");
+      EXPECT_EQ(node.attr().at("N").i(), 2);
+      found++;
+    } else if (node.name() == "apply_1") {
+      EXPECT_EQ(node.op(), "ResourceApplyAdam");
+      found++;
+    } else if (node.name() == "apply_2") {
+      EXPECT_EQ(node.op(), "NoOp");
+      found++;
+    }
+  }
+  EXPECT_EQ(found, 3);
+}
+
+TEST_F(RemapperTest, BatchIdenticalMatMuls) {
+  using ::tensorflow::ops::Placeholder;
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  constexpr int kNumBranches = 5;
+  auto input = Placeholder(s.WithOpName("input"), DT_FLOAT,
+                           ops::Placeholder::Shape({8, 16}));
+  std::vector<Output> branches;
+  GrapplerItem item;
+  for (int i = 0; i < kNumBranches; ++i) {
+    const string branch = strings::StrCat("branch_", i);
+    auto weights = Placeholder(s.WithOpName(branch + "/weights"), DT_FLOAT,
+                               ops::Placeholder::Shape({16, 4}));
+    branches.push_back(ops::Relu(s.WithOpName(branch + "/relu"),
+                                 ops::MatMul(s.WithOpName(branch + "/matmul"),
+                                             input, weights)));
+    item.feed.emplace_back(branch + "/weights",
+                           GenerateRandomTensor<DT_FLOAT>({16, 4}));
+  }
+  // A MatMul with the same shapes that depends on the first branch, so it can
+  // not be batched with it.
+  auto zero = ops::Const(s.WithOpName("zero"), 0);
+  auto dependent = ops::MatMul(
+      s.WithOpName("dependent"), input,
+      ops::Concat(s.WithOpName("stacked"), {branches[0], branches[0]}, zero));
+  auto axis = ops::Const(s.WithOpName("axis"), 1);
+  branches.push_back(dependent);
+  auto fetch = ops::Concat(s.WithOpName("fetch"), branches, axis);
+
+  item.fetch = {"fetch"};
+  item.feed.emplace_back("input", GenerateRandomTensor<DT_FLOAT>({8, 16}));
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  Remapper default_optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(default_optimizer.Optimize(nullptr, item, &output));
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.op(), "BatchMatMulV2");
+  }
+
+  Remapper optimizer(RewriterConfig::AGGRESSIVE);
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  NodeMap node_map(&output);
+  int num_batched = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.op() != "BatchMatMulV2") continue;
+    ++num_batched;
+    const NodeDef* lhs = node_map.GetNode(node.input(0));
+    const NodeDef* rhs = node_map.GetNode(node.input(1));
+    ASSERT_NE(lhs, nullptr);
+    ASSERT_NE(rhs, nullptr);
+    EXPECT_EQ(lhs->op(), "Pack");
+    EXPECT_EQ(rhs->op(), "Pack");
+    EXPECT_EQ(rhs->input_size(), kNumBranches);
+  }
+  EXPECT_EQ(num_batched, 1);
+  for (int i = 0; i < kNumBranches; ++i) {
+    const NodeDef* matmul =
+        node_map.GetNode(strings::StrCat("branch_", i, "/matmul"));
+    ASSERT_NE(matmul, nullptr);
+    EXPECT_EQ(matmul->op(), "Identity");
+  }
+  EXPECT_EQ(node_map.GetNode("dependent")->op(), "MatMul");
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectClose(tensors[0], tensors_expected[0], 1e-6);
+}
+
 class RemapperFuseMatMulWithBiasTest : public RemapperTest {
  public:
   template <DataType DTYPE>
@@ -1509,6 +1868,61 @@ TEST_F(RemapperFuseMatMulWithBiasTest, Bf16) {
   RunTest<DT_BFLOAT16>();  // NOLINT
 }
 
+TEST_F(RemapperTest, ProfileVetoesSlowerFusion) {
+  using ::tensorflow::ops::Placeholder;
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto lhs = Placeholder(s.WithOpName("lhs"), DT_FLOAT,
+                         ops::Placeholder::Shape({8, 32}));
+  auto rhs = Placeholder(s.WithOpName("rhs"), DT_FLOAT,
+                         ops::Placeholder::Shape({32, 64}));
+  auto bias = Placeholder(s.WithOpName("bias"), DT_FLOAT,
+                          ops::Placeholder::Shape({64}));
+  auto matmul = ops::MatMul(s.WithOpName("matmul"), lhs, rhs);
+  auto bias_add = ops::BiasAdd(s.WithOpName("bias_add"), matmul, bias);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), bias_add);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  // Returns the op of "bias_add" after remapping with a profile in which the
+  // fused node took `fused_cost`, and MatMul and BiasAdd 10 each.
+  auto remap_with_profile = [&](int64_t fused_cost) -> string {
+    OpPerformanceList profile;
+    for (const auto& node_op :
+         std::vector<std::pair<string, string>>{{"matmul", "MatMul"},
+                                                {"bias_add", "BiasAdd"},
+                                                {"bias_add", "_FusedMatMul"}}) {
+      OpPerformance* perf = profile.add_op_performance();
+      perf->set_node(node_op.first);
+      perf->mutable_op()->set_op(node_op.second);
+      perf->set_compute_cost(node_op.second == "_FusedMatMul" ? fused_cost
+                                                              : 10);
+    }
+    // The remapper reads a profile again only once it is modified.
+    const string path = io::JoinPath(
+        testing::TmpDir(),
+        strings::StrCat("remapper_profile_", fused_cost, ".pb"));
+    TF_CHECK_OK(WriteBinaryProto(Env::Default(), path, profile));
+
+    Remapper optimizer(RewriterConfig::ON, RewriterConfig::NO_CONVERSION_ON_CPU,
+                       /*xla_auto_clustering_on=*/false, path);
+    GraphDef output;
+    TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+    for (const NodeDef& node : output.node()) {
+      if (node.name() == "bias_add") return node.op();
+    }
+    return "";
+  };
+
+  EXPECT_EQ(remap_with_profile(/*fused_cost=*/15), "_FusedMatMul");
+  EXPECT_EQ(remap_with_profile(/*fused_cost=*/25), "BiasAdd");
+}
+
 // TODO(b/161005848): Fix flaky test.
 TEST_F(RemapperTest, DISABLED_FuseConv2DWithBiasAndActivationOnGPU) {
 #if !(GOOGLE_CUDA)
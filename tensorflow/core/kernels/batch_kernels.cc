@@ -248,6 +248,11 @@ BatchFunctionKernel::BatchFunctionKernel(OpKernelConstruction* c)
   OP_REQUIRES_OK(c, c->GetAttr("f", &func_));
   flib_ = c->function_library();
 
+  if (c->HasAttr("length_buckets")) {
+    OP_REQUIRES_OK(c, c->GetAttr("length_buckets", &length_buckets_));
+    OP_REQUIRES_OK(c, c->GetAttr("length_dim", &length_dim_));
+  }
+
   if (c->HasAttr("enable_large_batch_splitting")) {
     OP_REQUIRES_OK(c, c->GetAttr("enable_large_batch_splitting",
                                  &enable_large_batch_splitting_));
@@ -333,6 +338,8 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
           adaptive_shared_batch_scheduler_options, max_batch_size_,
           batch_timeout_micros_, max_enqueued_batches_, allowed_batch_sizes_,
           handle, flib_, &new_resource));
+      TF_RETURN_IF_ERROR(
+          new_resource->EnableLengthBuckets(length_dim_, length_buckets_));
       *r = new_resource.release();
       return OkStatus();
     };
@@ -343,6 +350,8 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
           num_batch_threads_, max_batch_size_, batch_timeout_micros_,
           max_enqueued_batches_, allowed_batch_sizes_, handle, flib_,
           enable_large_batch_splitting_, &new_resource));
+      TF_RETURN_IF_ERROR(
+          new_resource->EnableLengthBuckets(length_dim_, length_buckets_));
       *r = new_resource.release();
       return OkStatus();
     };
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/batching_util/batch_resource_base.h"
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "absl/strings/str_cat.h"
@@ -225,6 +227,7 @@ BatchResourceBase::BatchTask::CreateSplitTask(
   task->status = this->status;
   task->is_partial = true;
   task->start_time = this->start_time;
+  task->task_priority = this->task_priority;
   task->request_cost = this->request_cost;
 
   return task;
@@ -336,12 +339,122 @@ Status BatchResourceBase::RegisterInput(
     batch_components->request_cost = request_cost_accessor->GetRequestCost();
   }
 
+  string queue_name = batcher_queue_name;
+  if (!length_buckets_.empty()) {
+    const Tensor& first_input = batch_components->inputs[0];
+    if (first_input.dims() <= length_dim_) {
+      return errors::InvalidArgument(
+          "Batching input tensors must have more than length_dim=",
+          length_dim_, " dimensions to be bucketed by length; got shape ",
+          first_input.shape().DebugString());
+    }
+    const int64_t length = first_input.dim_size(length_dim_);
+    auto bucket = std::lower_bound(length_buckets_.begin(),
+                                   length_buckets_.end(), length);
+    if (bucket == length_buckets_.end()) {
+      return errors::InvalidArgument("Batching input length ", length,
+                                     " is longer than the last length bucket ",
+                                     length_buckets_.back());
+    }
+    TF_RETURN_IF_ERROR(PadSequencesToLength(length_dim_, length, *bucket,
+                                            &batch_components->inputs));
+    absl::StrAppend(&queue_name, "/length_bucket_", *bucket);
+  }
+
   BatcherQueueT* batcher_queue;
-  TF_RETURN_IF_ERROR(
-      LookupOrCreateBatcherQueue(batcher_queue_name, &batcher_queue));
+  TF_RETURN_IF_ERROR(LookupOrCreateBatcherQueue(queue_name, &batcher_queue));
   return batcher_queue->Schedule(&batch_components);
 }
 
+Status BatchResourceBase::EnableLengthBuckets(
+    int length_dim, std::vector<int64_t> length_buckets) {
+  if (length_buckets.empty()) return OkStatus();
+  if (length_dim < 1) {
+    return errors::InvalidArgument("length_dim must be at least 1; was ",
+                                   length_dim);
+  }
+  for (size_t i = 0; i < length_buckets.size(); ++i) {
+    if (length_buckets[i] <= 0 ||
+        (i > 0 && length_buckets[i] <= length_buckets[i - 1])) {
+      return errors::InvalidArgument(
+          "length_buckets entries must be positive and monotonically "
+          "increasing");
+    }
+  }
+  length_dim_ = length_dim;
+  length_buckets_ = std::move(length_buckets);
+  return OkStatus();
+}
+
+/*static*/ Status BatchResourceBase::PadToLength(const Tensor& input, int dim,
+                                                 int64_t length,
+                                                 Tensor* output) {
+  if (dim < 0 || dim >= input.dims()) {
+    return errors::InvalidArgument("Cannot pad dimension ", dim,
+                                   " of a tensor of shape ",
+                                   input.shape().DebugString());
+  }
+  if (input.dim_size(dim) > length) {
+    return errors::InvalidArgument(
+        "Batching input tensor of shape ", input.shape().DebugString(),
+        " is longer than ", length, " along dimension ", dim);
+  }
+  TensorShape shape = input.shape();
+  shape.set_dim(dim, length);
+  *output = Tensor(input.dtype(), shape);
+  if (output->NumElements() == 0) return OkStatus();
+
+  // The input is a sequence of `num_rows` rows, each of which becomes the
+  // beginning of a longer row of the output.
+  int64_t num_rows = 1;
+  for (int i = 0; i < dim; ++i) num_rows *= input.dim_size(i);
+  const int64_t input_row_size = input.NumElements() / num_rows;
+  const int64_t output_row_size = output->NumElements() / num_rows;
+  if (DataTypeCanUseMemcpy(input.dtype())) {
+    const size_t element_size = DataTypeSize(input.dtype());
+    const char* src = input.tensor_data().data();
+    char* dst = const_cast<char*>(output->tensor_data().data());
+    for (int64_t row = 0; row < num_rows; ++row) {
+      char* dst_row = dst + row * output_row_size * element_size;
+      if (input_row_size > 0) {
+        memcpy(dst_row, src + row * input_row_size * element_size,
+               input_row_size * element_size);
+      }
+      memset(dst_row + input_row_size * element_size, 0,
+             (output_row_size - input_row_size) * element_size);
+    }
+  } else if (input.dtype() == DT_STRING) {
+    const auto src = input.flat<tstring>();
+    auto dst = output->flat<tstring>();
+    for (int64_t row = 0; row < num_rows; ++row) {
+      for (int64_t i = 0; i < input_row_size; ++i) {
+        dst(row * output_row_size + i) = src(row * input_row_size + i);
+      }
+    }
+  } else {
+    return errors::Unimplemented("Cannot pad batching input tensors of type ",
+                                 DataTypeString(input.dtype()));
+  }
+  return OkStatus();
+}
+
+/*static*/ Status BatchResourceBase::PadSequencesToLength(
+    int dim, int64_t sequence_length, int64_t length,
+    std::vector<Tensor>* inputs) {
+  if (sequence_length == length) return OkStatus();
+  for (Tensor& input : *inputs) {
+    // The other inputs, e.g. features of the whole sequence, are passed as
+    // they are.
+    if (input.dims() <= dim || input.dim_size(dim) != sequence_length) {
+      continue;
+    }
+    Tensor padded;
+    TF_RETURN_IF_ERROR(PadToLength(input, dim, length, &padded));
+    input = std::move(padded);
+  }
+  return OkStatus();
+}
+
 /*static*/ BatchResourceBase::BatcherT::QueueOptions
 BatchResourceBase::GetBatcherQueueOptions(
     int32_t num_batch_threads, int32_t max_batch_size,
@@ -352,6 +465,7 @@ BatchResourceBase::GetBatcherQueueOptions(
   batcher_queue_options.input_batch_size_limit = max_batch_size;
   batcher_queue_options.max_enqueued_batches = max_enqueued_batches;
   batcher_queue_options.batch_timeout_micros = batch_timeout_micros;
+  batcher_queue_options.allowed_batch_sizes = allowed_batch_sizes;
   batcher_queue_options.enable_large_batch_splitting =
       enable_large_batch_splitting;
   if (enable_large_batch_splitting) {
@@ -465,6 +579,12 @@ Status BatchResourceBase::ConcatInputTensors(
 
   // Process each input one at a time (the typical case has just one).
   for (int i = 0; i < num_inputs; ++i) {
+    // A batch of a single task without padding takes its input as is.
+    if (batch.num_tasks() == 1 && padding_amount == 0) {
+      concatenated_tensors->push_back(batch.task(0).inputs.at(i));
+      continue;
+    }
+
     // Concatenate the tasks ith input tensors into a big output tensor.
     std::vector<Tensor> to_concatenate;
     to_concatenate.reserve(batch.num_tasks());
@@ -519,6 +639,10 @@ Status BatchResourceBase::ConcatInputTensors(
        op_kernel_context = input_task.context, status = shared_status]() {
         const int num_output = op_kernel_context->num_outputs();
         for (int i = 0; i < num_output; ++i) {
+          if (output->size() == 1) {
+            op_kernel_context->set_output(i, std::move((*output)[0][i]));
+            continue;
+          }
           Tensor output_tensor;
 
           // Concat would memcpy each input tensor to one output tensor.
@@ -597,6 +721,31 @@ Status BatchResourceBase::ConcatInputTensors(
   return OkStatus();
 }
 
+/*static*/ Status BatchResourceBase::SliceOutputTensor(
+    const Tensor& output, absl::Span<const int64_t> sizes,
+    std::vector<Tensor>* slices) {
+  if (output.dims() == 0) {
+    return errors::InvalidArgument("Cannot split a zero-dimensional tensor");
+  }
+  int64_t total_size = 0;
+  for (int64_t size : sizes) total_size += size;
+  if (total_size != output.dim_size(0)) {
+    return errors::InvalidArgument(
+        "The values in 'sizes' do not sum to the zeroth-dimension size of "
+        "'output'");
+  }
+  slices->reserve(sizes.size());
+  int64_t start = 0;
+  for (int64_t size : sizes) {
+    Tensor slice = output.Slice(start, start + size);
+    // Kernels may require aligned inputs, which a slice is not always.
+    slices->push_back(slice.IsAligned() ? std::move(slice)
+                                        : tensor::DeepCopy(slice));
+    start += size;
+  }
+  return OkStatus();
+}
+
 Status BatchResourceBase::SplitOutputTensors(
     const std::vector<Tensor>& combined_outputs, BatchT* batch) const {
   DCHECK_GE(batch->num_tasks(), 1);
@@ -640,7 +789,7 @@ Status BatchResourceBase::SplitOutputTensors(
     }
 
     std::vector<Tensor> split_tensor;
-    const Status split_status = tensor::Split(
+    const Status split_status = SliceOutputTensor(
         output_tensor, task_sizes_plus_optional_padding, &split_tensor);
     DCHECK(split_status.ok()) << split_status.ToString();
     if (!split_status.ok()) {
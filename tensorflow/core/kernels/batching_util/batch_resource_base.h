@@ -52,6 +52,17 @@ class BatchResourceBase : public ResourceBase {
                        const string& batcher_queue_name,
                        AsyncOpKernel::DoneCallback done_callback);
 
+  // Makes RegisterInput() route the invocations by the size of dimension
+  // `length_dim` of their first input into a batcher queue per bucket of
+  // `length_buckets`, the smallest one at least that long, after padding
+  // their inputs of the same length along `length_dim` to the bucket length.
+  // The batches then only hold sequences of about the same length, and the
+  // batcher round-robins over the buckets, so that the small ones do not
+  // starve. Does nothing if `length_buckets` is empty. Must be called before
+  // RegisterInput().
+  Status EnableLengthBuckets(int length_dim,
+                             std::vector<int64_t> length_buckets);
+
  public:
   // One task to be batched, corresponds to a `slice` of input from one batch-op
   // invocation.
@@ -93,8 +104,15 @@ class BatchResourceBase : public ResourceBase {
 
     uint64 start_time;
 
+    // The latency class of the invocation, which subclasses may set in
+    // CreateBatchTask(). With a SharedBatchScheduler, low priority tasks fill
+    // the padding of the batches of high priority ones.
+    BatchTaskPriority task_priority = BatchTaskPriority::kHigh;
+
     size_t size() const override { return inputs[0].shape().dim_size(0); }
 
+    BatchTaskPriority priority() const override { return task_priority; }
+
     // Create a split task from this one. The caller needs to setup the inputs
     // of the new task
     std::unique_ptr<BatchTask> CreateSplitTask(
@@ -177,6 +195,26 @@ class BatchResourceBase : public ResourceBase {
       int max_batch_size,
       std::vector<std::unique_ptr<BatchTask>>* output_tasks);
 
+  // Pads `input` with zeros (or empty strings) along dimension `dim` to
+  // `length`, into `output`.
+  static Status PadToLength(const Tensor& input, int dim, int64_t length,
+                            Tensor* output);
+
+  // Pads the `inputs` of `sequence_length` along dimension `dim`, those of
+  // the sequence being bucketed, to `length`. The others are left as they
+  // are.
+  static Status PadSequencesToLength(int dim, int64_t sequence_length,
+                                     int64_t length,
+                                     std::vector<Tensor>* inputs);
+
+  // Splits `output` along the 0th dimension into `slices` of `sizes` rows.
+  // The slices alias the buffer of `output` rather than copying it, except
+  // for the ones which would not be aligned; the buffer then lives as long as
+  // any of them.
+  static Status SliceOutputTensor(const Tensor& output,
+                                  absl::Span<const int64_t> sizes,
+                                  std::vector<Tensor>* slices);
+
   // Splits the batch costs to each task.
   //
   // Inputs:
@@ -261,6 +299,10 @@ class BatchResourceBase : public ResourceBase {
       TF_GUARDED_BY(batcher_queues_mu_);
 
   std::vector<int32> allowed_batch_sizes_;
+  // The length buckets the inputs are padded to, if any, and their dimension
+  // holding the length.
+  std::vector<int64_t> length_buckets_;
+  int length_dim_ = 1;
   // A concatenated string of <allowed_batch_sizes_>, separated by ",". This is
   // used to record batching parameter.
   string allowed_batch_sizes_str_;
@@ -19,6 +19,8 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/cost_measurement.h"
 #include "tensorflow/core/common_runtime/cost_measurement_registry.h"
 #include "tensorflow/core/common_runtime/no_op_cost_measurement.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -190,6 +192,90 @@ TEST(SplitBatchCostTest, SplitOnlyNonZeroCostTypes) {
                            Pair("test_tpu_no_smear", absl::Milliseconds(45))));
 }
 
+TEST(SliceOutputTensorTest, AliasesAlignedSlices) {
+  // Rows of 64 floats start at aligned offsets.
+  Tensor output(DT_FLOAT, TensorShape({4, 64}));
+  test::FillIota<float>(&output, 0);
+  std::vector<Tensor> slices;
+  TF_ASSERT_OK(
+      BatchResourceBase::SliceOutputTensor(output, {1, 3, 0}, &slices));
+  ASSERT_EQ(slices.size(), 3);
+  EXPECT_EQ(slices[0].shape(), TensorShape({1, 64}));
+  EXPECT_EQ(slices[1].shape(), TensorShape({3, 64}));
+  EXPECT_EQ(slices[2].shape(), TensorShape({0, 64}));
+  EXPECT_EQ(slices[0].tensor_data().data(), output.tensor_data().data());
+  EXPECT_EQ(slices[1].tensor_data().data(),
+            output.tensor_data().data() + 64 * sizeof(float));
+  EXPECT_EQ(slices[1].matrix<float>()(0, 0), 64);
+}
+
+TEST(SliceOutputTensorTest, CopiesUnalignedSlices) {
+  Tensor output = test::AsTensor<float>({1, 2, 3}, TensorShape({3, 1}));
+  std::vector<Tensor> slices;
+  TF_ASSERT_OK(BatchResourceBase::SliceOutputTensor(output, {1, 2}, &slices));
+  ASSERT_EQ(slices.size(), 2);
+  EXPECT_TRUE(slices[1].IsAligned());
+  test::ExpectTensorEqual<float>(
+      slices[0], test::AsTensor<float>({1}, TensorShape({1, 1})));
+  test::ExpectTensorEqual<float>(
+      slices[1], test::AsTensor<float>({2, 3}, TensorShape({2, 1})));
+}
+
+TEST(SliceOutputTensorTest, ChecksSizes) {
+  Tensor output(DT_FLOAT, TensorShape({3, 1}));
+  std::vector<Tensor> slices;
+  EXPECT_FALSE(
+      BatchResourceBase::SliceOutputTensor(output, {1, 1}, &slices).ok());
+  EXPECT_FALSE(BatchResourceBase::SliceOutputTensor(Tensor(1.0f), {1}, &slices)
+                   .ok());
+}
+
+TEST(PadToLengthTest, PadsNumericTensors) {
+  Tensor input =
+      test::AsTensor<int32>({1, 2, 3, 4, 5, 6}, TensorShape({2, 3, 1}));
+  Tensor padded;
+  TF_ASSERT_OK(BatchResourceBase::PadToLength(input, /*dim=*/1,
+                                              /*length=*/4, &padded));
+  test::ExpectTensorEqual<int32>(
+      padded, test::AsTensor<int32>({1, 2, 3, 0, 4, 5, 6, 0},
+                                    TensorShape({2, 4, 1})));
+}
+
+TEST(PadToLengthTest, PadsStringTensors) {
+  Tensor input = test::AsTensor<tstring>({"a", "b"}, TensorShape({2, 1}));
+  Tensor padded;
+  TF_ASSERT_OK(BatchResourceBase::PadToLength(input, /*dim=*/1,
+                                              /*length=*/2, &padded));
+  test::ExpectTensorEqual<tstring>(
+      padded, test::AsTensor<tstring>({"a", "", "b", ""}, TensorShape({2, 2})));
+}
+
+TEST(PadToLengthTest, ChecksLength) {
+  Tensor input(DT_FLOAT, TensorShape({2, 3}));
+  Tensor padded;
+  EXPECT_FALSE(BatchResourceBase::PadToLength(input, /*dim=*/1,
+                                              /*length=*/2, &padded)
+                   .ok());
+  EXPECT_FALSE(BatchResourceBase::PadToLength(input, /*dim=*/2,
+                                              /*length=*/4, &padded)
+                   .ok());
+}
+
+TEST(PadToLengthTest, PadsOnlySequencesOfTheSameLength) {
+  std::vector<Tensor> inputs = {
+      test::AsTensor<int32>({1, 2, 3}, TensorShape({1, 3})),
+      test::AsTensor<int32>({4, 5}, TensorShape({1, 2})),
+      test::AsTensor<int32>({6}, TensorShape({1}))};
+  TF_ASSERT_OK(BatchResourceBase::PadSequencesToLength(
+      /*dim=*/1, /*sequence_length=*/3, /*length=*/4, &inputs));
+  test::ExpectTensorEqual<int32>(
+      inputs[0], test::AsTensor<int32>({1, 2, 3, 0}, TensorShape({1, 4})));
+  test::ExpectTensorEqual<int32>(
+      inputs[1], test::AsTensor<int32>({4, 5}, TensorShape({1, 2})));
+  test::ExpectTensorEqual<int32>(
+      inputs[2], test::AsTensor<int32>({6}, TensorShape({1})));
+}
+
 }  // namespace
 }  // namespace serving
 }  // namespace tensorflow
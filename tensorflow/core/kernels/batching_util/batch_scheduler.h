@@ -57,6 +57,16 @@ namespace serving {
 // Items (b), (c) and (d) are typically non-owned pointers to data homed
 // elsewhere, because a task's ownership gets transferred to a BatchScheduler
 // (see below) and it may be deleted as soon as it is done executing.
+// The latency classes of tasks sharing a batcher.
+enum class BatchTaskPriority {
+  // Tasks waiting on their batch within the batch timeout, e.g. interactive
+  // requests.
+  kHigh,
+  // Tasks that may wait longer, e.g. offline scoring, to fill the room left in
+  // the batches of high priority tasks. Only some schedulers tell them apart.
+  kLow,
+};
+
 class BatchTask {
  public:
   virtual ~BatchTask() = default;
@@ -64,6 +74,11 @@ class BatchTask {
   // Returns the size of the task, in terms of how much it contributes to the
   // size of a batch. (A batch's size is the sum of its task sizes.)
   virtual size_t size() const = 0;
+
+  // Returns the latency class of the task.
+  virtual BatchTaskPriority priority() const {
+    return BatchTaskPriority::kHigh;
+  }
 };
 
 // A thread-safe collection of BatchTasks, to be executed together in some
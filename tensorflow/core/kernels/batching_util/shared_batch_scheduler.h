@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <deque>
 #include <functional>
 #include <list>
@@ -218,6 +219,28 @@ class SharedBatchScheduler
     // submit batches whose size is in a small set of allowed sizes, that can be
     // done by adding padding in the process-batch callback.
     size_t max_execution_batch_size = 1000;
+
+    // If positive, the queue adjusts its batch timeout and its maximum batch
+    // size as the traffic changes, to keep the 99th percentile latency of its
+    // tasks (their queueing delay plus the processing time of their batch)
+    // under this target. The timeout then starts at `batch_timeout_micros` and
+    // stays under the target, and the batches stay under the maximum batch
+    // size above. See internal::LatencyTargetController.
+    int64_t latency_target_micros = 0;
+
+    // The sizes the process-batch callback pads the batches to, in increasing
+    // order, if it pads them.
+    std::vector<int32> allowed_batch_sizes;
+
+    // Tasks of low priority (see BatchTask::priority()) wait in a lane of their
+    // own, and only take the room the high priority tasks leave in their
+    // batches, up to the next allowed batch size (or the maximum batch size),
+    // filling padding with work. A low priority task that waited this long
+    // (in microseconds, or `batch_timeout_micros` if 0) without finding room
+    // goes in a batch of low priority tasks instead, so that neither class
+    // starves. Tasks larger than a batch, and queues with
+    // `enable_lazy_split`, have no such lane.
+    int64_t low_priority_batch_timeout_micros = 0;
   };
   Status AddQueue(const QueueOptions& options,
                   std::function<void(std::unique_ptr<Batch<TaskType>>)>
@@ -279,6 +302,56 @@ class SharedBatchScheduler
 
 namespace internal {
 
+// Adjusts the batch timeout and the maximum batch size of a queue to keep the
+// 99th percentile latency of its tasks under a target as the traffic changes,
+// instead of closing batches on static settings that only suit one load.
+//
+// The latency is estimated as the sum of the 99th percentiles of the queueing
+// delay of the batches (from their first task to their processing) and of
+// their processing time, over windows of kWindowSize batches. After each
+// window, the controller
+//  - halves the timeout if the latency is over the target, and also shrinks
+//    the batches by a quarter if their processing takes half the target;
+//  - if the latency is under 3/4 of the target, lengthens the timeout by a
+//    quarter of the headroom, and grows the batches by as many tasks as half
+//    the headroom takes to process at the cost per task of the window.
+// The timeout stays between 0 and the target, and the batch size between 1
+// and the configured maximum.
+//
+// Not thread-safe.
+class LatencyTargetController {
+ public:
+  static constexpr int kWindowSize = 64;
+
+  LatencyTargetController(int64_t latency_target_micros,
+                          int64_t batch_timeout_micros, size_t max_batch_size);
+
+  int64_t batch_timeout_micros() const { return batch_timeout_micros_; }
+  size_t max_batch_size() const { return max_batch_size_; }
+
+  // Records that a batch waited `micros` in the queue before its processing.
+  void RecordQueueDelay(int64_t micros);
+
+  // Records that a batch of `batch_size` tasks took `micros` to process.
+  void RecordProcessing(size_t batch_size, int64_t micros);
+
+ private:
+  // Adjusts the settings to the window of batches recorded, and starts the
+  // next window.
+  void Adjust();
+
+  const int64_t latency_target_micros_;
+  const size_t batch_size_limit_;
+
+  int64_t batch_timeout_micros_;
+  size_t max_batch_size_;
+
+  // The window of the batches recorded since the last adjustment.
+  std::vector<int64_t> queue_delays_micros_;
+  std::vector<int64_t> processing_micros_;
+  int64_t num_window_tasks_ = 0;
+};
+
 // A task queue for SharedBatchScheduler. Accepts tasks and accumulates them
 // into batches, and dispenses those batches to be processed via a "pull"
 // interface. The queue's behavior is governed by maximum batch size, timeout
@@ -322,6 +395,9 @@ class Queue {
   // processed by `Queue<TaskType>::ProcessBatch`
   Status ScheduleWithoutOrEagerSplit(std::unique_ptr<TaskType>* task);
 
+  // Enqueue `task` in the lane of the low priority tasks.
+  Status ScheduleLowPriority(std::unique_ptr<TaskType>* task);
+
   // Enqueue `task` along with the batch queue metadata.
   // Batches are formed by the time `ScheduleWithLazySplit` returns; and each
   // batch in the deque could evaluate to a batch to be processed after it's
@@ -421,6 +497,37 @@ class Queue {
   // Returns the number of enqueued batches.
   int64 num_enqueued_batches() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // The batch timeout and the maximum batch size in effect, which
+  // `latency_controller_` adjusts if the queue has a latency target.
+  int64_t batch_timeout_micros() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  size_t current_max_execution_batch_size() const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // The task capacity left in the open batch.
+  int64_t open_batch_remaining_slot() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Records the queueing delay of the front batch, about to be dequeued.
+  void RecordQueueDelayOfFrontBatch() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the size `batch_size` is padded to: the next allowed batch size,
+  // or else the maximum batch size.
+  size_t PaddedBatchSize(size_t batch_size) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns `batch`, closed, with the low priority tasks that fit in the room
+  // left up to its padded size.
+  std::unique_ptr<Batch<TaskType>> FillWithLowPriorityTasks(
+      std::unique_ptr<Batch<TaskType>> batch) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Determines whether the oldest low priority task waited long enough for a
+  // batch of its own.
+  bool IsLowPriorityBatchSchedulable() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Removes the oldest low priority tasks that fit in a batch, and returns
+  // them in a closed batch.
+  std::unique_ptr<Batch<TaskType>> TakeLowPriorityBatch()
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   const typename SharedBatchScheduler<TaskType>::QueueOptions options_;
 
   // The environment to use.
@@ -469,6 +576,25 @@ class Queue {
   // in 'batches_'. Valid iff that batch contains at least one task.
   uint64 open_batch_start_time_micros_ TF_GUARDED_BY(mu_);
 
+  // The controller of the batch timeout and size, if the queue has a latency
+  // target.
+  std::unique_ptr<LatencyTargetController> latency_controller_
+      TF_GUARDED_BY(mu_);
+
+  // The times at which the first task was added to the closed batches, in the
+  // order of the queue. Only kept for `latency_controller_`.
+  std::deque<uint64> closed_batch_start_times_micros_ TF_GUARDED_BY(mu_);
+
+  // A task of low priority waiting for room in a batch.
+  struct LowPriorityTask {
+    std::unique_ptr<TaskType> task;
+    uint64 enqueue_time_micros;
+  };
+
+  // The low priority tasks, oldest first, and the sum of their sizes.
+  std::deque<LowPriorityTask> low_priority_tasks_ TF_GUARDED_BY(mu_);
+  size_t low_priority_tasks_size_ TF_GUARDED_BY(mu_) = 0;
+
   // Whether this queue contains a batch that is eligible to be scheduled.
   // Used to keep track of when to call 'schedulable_batch_callback_'.
   bool schedulable_batch_ TF_GUARDED_BY(mu_) = false;
@@ -588,6 +714,16 @@ Status SharedBatchScheduler<TaskType>::AddQueueAfterRewritingOptions(
         "max_enqueued_batches must be positive; was ",
         options.max_enqueued_batches);
   }
+  if (options.low_priority_batch_timeout_micros < 0) {
+    return errors::InvalidArgument(
+        "low_priority_batch_timeout_micros must be non-negative; was ",
+        options.low_priority_batch_timeout_micros);
+  }
+  if (options.latency_target_micros < 0) {
+    return errors::InvalidArgument(
+        "latency_target_micros must be non-negative; was ",
+        options.latency_target_micros);
+  }
 
   if (options.enable_large_batch_splitting &&
       options.split_input_task_func == nullptr) {
@@ -752,6 +888,71 @@ void SharedBatchScheduler<TaskType>::ThreadLogic() {
 
 namespace internal {
 
+inline LatencyTargetController::LatencyTargetController(
+    int64_t latency_target_micros, int64_t batch_timeout_micros,
+    size_t max_batch_size)
+    : latency_target_micros_(latency_target_micros),
+      batch_size_limit_(std::max<size_t>(1, max_batch_size)),
+      batch_timeout_micros_(
+          std::min(std::max<int64_t>(0, batch_timeout_micros),
+                   latency_target_micros)),
+      max_batch_size_(batch_size_limit_) {
+  queue_delays_micros_.reserve(kWindowSize);
+  processing_micros_.reserve(kWindowSize);
+}
+
+inline void LatencyTargetController::RecordQueueDelay(int64_t micros) {
+  if (queue_delays_micros_.size() < kWindowSize) {
+    queue_delays_micros_.push_back(micros);
+  }
+}
+
+inline void LatencyTargetController::RecordProcessing(size_t batch_size,
+                                                      int64_t micros) {
+  processing_micros_.push_back(micros);
+  num_window_tasks_ += batch_size;
+  if (processing_micros_.size() >= kWindowSize) Adjust();
+}
+
+inline void LatencyTargetController::Adjust() {
+  auto percentile_99 = [](std::vector<int64_t>* samples) -> int64_t {
+    if (samples->empty()) return 0;
+    auto it = samples->begin() + (samples->size() - 1) * 99 / 100;
+    std::nth_element(samples->begin(), it, samples->end());
+    return *it;
+  };
+  int64_t total_processing_micros = 0;
+  for (int64_t micros : processing_micros_) total_processing_micros += micros;
+  const int64_t processing_p99 = percentile_99(&processing_micros_);
+  const int64_t latency_p99 =
+      percentile_99(&queue_delays_micros_) + processing_p99;
+
+  if (latency_p99 > latency_target_micros_) {
+    batch_timeout_micros_ /= 2;
+    if (2 * processing_p99 >= latency_target_micros_) {
+      max_batch_size_ = std::max<size_t>(1, max_batch_size_ * 3 / 4);
+    }
+  } else if (4 * latency_p99 < 3 * latency_target_micros_) {
+    const int64_t headroom_micros = latency_target_micros_ - latency_p99;
+    batch_timeout_micros_ = std::min(
+        latency_target_micros_,
+        batch_timeout_micros_ + std::max<int64_t>(1, headroom_micros / 4));
+    const int64_t micros_per_task = std::max<int64_t>(
+        1, total_processing_micros / std::max<int64_t>(1, num_window_tasks_));
+    const int64_t num_more_tasks =
+        std::max<int64_t>(1, headroom_micros / 2 / micros_per_task);
+    max_batch_size_ = std::min<size_t>(batch_size_limit_,
+                                       max_batch_size_ + num_more_tasks);
+  }
+  VLOG(2) << "Latency p99 " << latency_p99 << "us for a target of "
+          << latency_target_micros_ << "us; batch timeout now "
+          << batch_timeout_micros_ << "us, max batch size " << max_batch_size_;
+
+  queue_delays_micros_.clear();
+  processing_micros_.clear();
+  num_window_tasks_ = 0;
+}
+
 template <typename TaskType>
 Queue<TaskType>::Queue(
     const typename SharedBatchScheduler<TaskType>::QueueOptions& options,
@@ -762,6 +963,11 @@ Queue<TaskType>::Queue(
       max_execution_batch_size_(GetMaxExecutionBatchSize(options_)),
       process_batch_callback_(process_batch_callback),
       schedulable_batch_callback_(schedulable_batch_callback) {
+  if (options_.latency_target_micros > 0) {
+    latency_controller_ = std::make_unique<LatencyTargetController>(
+        options_.latency_target_micros, options_.batch_timeout_micros,
+        max_execution_batch_size_);
+  }
   // Set the higher 32 bits of traceme_context_id_counter_ to be the creation
   // time of the queue. This prevents the batches in different queues to have
   // the same traceme_context_id_counter_.
@@ -799,9 +1005,40 @@ Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
   if (options_.enable_lazy_split) {
     return ScheduleWithLazySplit(std::move(task));
   }
+  if ((*task)->priority() == BatchTaskPriority::kLow &&
+      (*task)->size() <= max_execution_batch_size_) {
+    return ScheduleLowPriority(task);
+  }
   return ScheduleWithoutOrEagerSplit(std::move(task));
 }
 
+template <typename TaskType>
+Status Queue<TaskType>::ScheduleLowPriority(std::unique_ptr<TaskType>* task) {
+  profiler::TraceMe trace_me([task] {
+    return profiler::TraceMeEncode(
+        "ScheduleLowPriority", {{"batching_input_task_size", (*task)->size()}});
+  });
+  mutex_lock l(mu_);
+
+  DCHECK(!closed_);
+
+  // The lane holds up to as many tasks as the batches of the queue.
+  const size_t capacity =
+      options_.max_enqueued_batches * max_execution_batch_size_;
+  if (low_priority_tasks_size_ + (*task)->size() > capacity) {
+    return errors::Unavailable(
+        "The low priority lane of the batch scheduling queue to which this "
+        "task was submitted is full; task size is ",
+        (*task)->size(), " but ", low_priority_tasks_size_, " of ", capacity,
+        " are taken");
+  }
+  low_priority_tasks_size_ += (*task)->size();
+  low_priority_tasks_.push_back({std::move(*task), env_->NowMicros()});
+  // The batch threads poll the queue for the low priority batches which
+  // become schedulable as time passes.
+  return OkStatus();
+}
+
 template <typename TaskType>
 Status Queue<TaskType>::ScheduleWithLazySplit(std::unique_ptr<TaskType>* task) {
   profiler::TraceMe trace_me([task] {
@@ -809,9 +1046,6 @@ Status Queue<TaskType>::ScheduleWithLazySplit(std::unique_ptr<TaskType>* task) {
         "ScheduleWithLazySplit",
         {{"batching_input_task_size", (*task)->size()}});
   });
-  // The max size to be enqueued.
-  const int max_execution_batch_size = options_.max_execution_batch_size;
-
   bool notify_of_schedulable_batch = false;
   {
     mutex_lock l(mu_);
@@ -820,8 +1054,9 @@ Status Queue<TaskType>::ScheduleWithLazySplit(std::unique_ptr<TaskType>* task) {
 
     TF_RETURN_IF_ERROR(ValidateBatchTaskQueueCapacity((*task).get()));
 
-    const int64 open_batch_capacity =
-        max_execution_batch_size - this->tail_batch_task_size();
+    // The max size to be enqueued.
+    const int max_execution_batch_size = current_max_execution_batch_size();
+    const int64 open_batch_capacity = open_batch_remaining_slot();
 
     auto input_batch = std::make_shared<BatchInputTask<TaskType>>(
         std::move(*task), open_batch_capacity, max_execution_batch_size,
@@ -832,7 +1067,7 @@ Status Queue<TaskType>::ScheduleWithLazySplit(std::unique_ptr<TaskType>* task) {
 
     for (int i = 0; i < task_handles.size(); ++i) {
       if (task_handle_batches_.back()->size() + task_handles[i]->size() >
-          options_.max_execution_batch_size) {
+          max_execution_batch_size) {
         StartNewBatch();
       }
       if (task_handle_batches_.back()->empty()) {
@@ -891,14 +1126,11 @@ Status Queue<TaskType>::ScheduleWithoutOrEagerSplit(
     // use up all queue capacity.
     TF_RETURN_IF_ERROR(ValidateBatchTaskQueueCapacity((*task).get()));
 
-    const int64_t open_batch_remaining_slot =
-        max_execution_batch_size() - batches_.back()->size();
-
     const int64_t input_task_size = (*task)->size();
 
     std::vector<std::unique_ptr<TaskType>> output_tasks;
 
-    if (input_task_size <= open_batch_remaining_slot ||
+    if (input_task_size <= open_batch_remaining_slot() ||
         !large_batch_splitting) {
       // This is the fast path when input doesn't need to be split.
       output_tasks.push_back(std::move(*task));
@@ -908,7 +1140,7 @@ Status Queue<TaskType>::ScheduleWithoutOrEagerSplit(
 
     for (int i = 0; i < output_tasks.size(); ++i) {
       if (batches_.back()->size() + output_tasks[i]->size() >
-          max_execution_batch_size()) {
+          current_max_execution_batch_size()) {
         StartNewBatch();
       }
       if (batches_.back()->empty()) {
@@ -953,7 +1185,7 @@ size_t Queue<TaskType>::NumEnqueuedTasks() const {
   for (const auto& batch : batches_) {
     num_enqueued_tasks += batch->num_tasks();
   }
-  return num_enqueued_tasks;
+  return num_enqueued_tasks + low_priority_tasks_.size();
 }
 
 template <typename TaskType>
@@ -967,9 +1199,8 @@ size_t Queue<TaskType>::SchedulingCapacityInternal() const {
   const int64 num_new_batches_schedulable =
       static_cast<int64_t>(options_.max_enqueued_batches) -
       this->num_enqueued_batches();
-  const int64 execution_batch_size_limit = max_execution_batch_size();
-  const int64 open_batch_capacity =
-      execution_batch_size_limit - this->tail_batch_task_size();
+  const int64 execution_batch_size_limit = current_max_execution_batch_size();
+  const int64 open_batch_capacity = open_batch_remaining_slot();
   // Note the returned value is guaranteed to be not negative, since
   // enqueue operation could only happen if queue has enough capacity.
   return (num_new_batches_schedulable * execution_batch_size_limit) +
@@ -991,7 +1222,8 @@ Status Queue<TaskType>::ValidateBatchTaskQueueCapacity(TaskType* task) const {
           " (num_enqueued_batches=", num_enqueued_batches(),
           ", max_enqueued_batches=", options_.max_enqueued_batches,
           ", open_batch_size=", tail_batch_task_size(),
-          ", max_execution_batch_size=", max_execution_batch_size(), ")");
+          ", max_execution_batch_size=", current_max_execution_batch_size(),
+          ")");
     }
     return OkStatus();
   }
@@ -1035,8 +1267,16 @@ Queue<TaskType>::ScheduleBatchWithEagerSplit() {
     if (batches_.size() >= 2) {
       // There is at least one closed batch that is ready to be scheduled.
       ++num_batches_being_processed_;
+      RecordQueueDelayOfFrontBatch();
       batch_to_schedule = std::move(batches_.front());
       batches_.pop_front();
+      if (!low_priority_tasks_.empty()) {
+        batch_to_schedule =
+            FillWithLowPriorityTasks(std::move(batch_to_schedule));
+      }
+    } else if (IsLowPriorityBatchSchedulable()) {
+      ++num_batches_being_processed_;
+      batch_to_schedule = TakeLowPriorityBatch();
     } else {
       schedulable_batch_ = false;
     }
@@ -1067,6 +1307,7 @@ Queue<TaskType>::ScheduleBatch() {
     if (task_handle_batches_.size() >= 2) {
       // There is at least one closed batch that is ready to be scheduled.
       ++num_batches_being_processed_;
+      RecordQueueDelayOfFrontBatch();
       task_handles_to_schedule = std::move(task_handle_batches_.front());
       task_handle_batches_.pop_front();
     } else {
@@ -1087,10 +1328,17 @@ void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch) {
       },
       profiler::ContextType::kSharedBatchScheduler,
       batch->traceme_context_id());
+  const bool has_latency_target = options_.latency_target_micros > 0;
+  const size_t batch_size = batch->size();
+  const uint64 start_time_micros = has_latency_target ? env_->NowMicros() : 0;
   process_batch_callback_(std::move(batch));
 
   {
     mutex_lock l(mu_);
+    if (has_latency_target) {
+      latency_controller_->RecordProcessing(
+          batch_size, env_->NowMicros() - start_time_micros);
+    }
     --num_batches_being_processed_;
     if (empty_notification_ != nullptr && IsEmptyInternal()) {
       empty_notification_->Notify();
@@ -1128,11 +1376,17 @@ bool Queue<TaskType>::IsEmptyInternal() const {
            task_handle_batches_.back()->empty();
   }
   return num_batches_being_processed_ == 0 && batches_.size() == 1 &&
-         batches_.back()->empty();
+         batches_.back()->empty() && low_priority_tasks_.empty();
 }
 
 template <typename TaskType>
 void Queue<TaskType>::StartNewBatch() {
+  if (latency_controller_ != nullptr) {
+    // An empty batch is closed as soon as it starts.
+    closed_batch_start_times_micros_.push_back(
+        tail_batch_task_size() > 0 ? open_batch_start_time_micros_
+                                   : env_->NowMicros());
+  }
   if (options_.enable_lazy_split) {
     task_handle_batches_.back()->Close();
     task_handle_batches_.emplace_back(new Batch<BatchInputTaskHandle<TaskType>>(
@@ -1147,11 +1401,9 @@ template <typename TaskType>
 Status Queue<TaskType>::SplitInputBatchIntoSubtasks(
     std::unique_ptr<TaskType>* input_task,
     std::vector<std::unique_ptr<TaskType>>* output_tasks) {
-  const int open_batch_remaining_slot =
-      max_execution_batch_size() - this->tail_batch_task_size();
   return options_.split_input_task_func(
-      std::move(input_task), open_batch_remaining_slot,
-      max_execution_batch_size(), std::move(output_tasks));
+      std::move(input_task), open_batch_remaining_slot(),
+      current_max_execution_batch_size(), std::move(output_tasks));
 }
 
 template <typename TaskType>
@@ -1160,9 +1412,9 @@ bool Queue<TaskType>::IsOpenBatchSchedulableAfterEagerSplit() const {
   if (open_batch->empty()) {
     return false;
   }
-  return closed_ || open_batch->size() >= max_execution_batch_size() ||
+  return closed_ || open_batch->size() >= current_max_execution_batch_size() ||
          env_->NowMicros() >=
-             open_batch_start_time_micros_ + options_.batch_timeout_micros;
+             open_batch_start_time_micros_ + batch_timeout_micros();
 }
 
 template <typename TaskType>
@@ -1175,9 +1427,9 @@ bool Queue<TaskType>::IsOpenBatchSchedulable() const {
   if (open_batch->empty()) {
     return false;
   }
-  return closed_ || open_batch->size() >= max_execution_batch_size() ||
+  return closed_ || open_batch->size() >= current_max_execution_batch_size() ||
          env_->NowMicros() >=
-             open_batch_start_time_micros_ + options_.batch_timeout_micros;
+             open_batch_start_time_micros_ + batch_timeout_micros();
 }
 
 template <typename TaskType>
@@ -1197,6 +1449,109 @@ int64 Queue<TaskType>::num_enqueued_batches() const {
   return batches_.size();
 }
 
+template <typename TaskType>
+int64_t Queue<TaskType>::batch_timeout_micros() const {
+  if (latency_controller_ != nullptr) {
+    return latency_controller_->batch_timeout_micros();
+  }
+  return options_.batch_timeout_micros;
+}
+
+template <typename TaskType>
+size_t Queue<TaskType>::current_max_execution_batch_size() const {
+  if (latency_controller_ != nullptr) {
+    return latency_controller_->max_batch_size();
+  }
+  return max_execution_batch_size_;
+}
+
+template <typename TaskType>
+int64_t Queue<TaskType>::open_batch_remaining_slot() const {
+  // The open batch may exceed a maximum batch size lowered since it filled.
+  return std::max<int64_t>(
+      0, static_cast<int64_t>(current_max_execution_batch_size()) -
+             static_cast<int64_t>(tail_batch_task_size()));
+}
+
+template <typename TaskType>
+void Queue<TaskType>::RecordQueueDelayOfFrontBatch() {
+  if (latency_controller_ == nullptr) return;
+  const uint64 start_time_micros = closed_batch_start_times_micros_.front();
+  closed_batch_start_times_micros_.pop_front();
+  const uint64 now_micros = env_->NowMicros();
+  latency_controller_->RecordQueueDelay(
+      now_micros > start_time_micros ? now_micros - start_time_micros : 0);
+}
+
+template <typename TaskType>
+size_t Queue<TaskType>::PaddedBatchSize(size_t batch_size) const {
+  const size_t max_batch_size = current_max_execution_batch_size();
+  for (int32 allowed_batch_size : options_.allowed_batch_sizes) {
+    if (static_cast<size_t>(allowed_batch_size) >= batch_size) {
+      return std::min<size_t>(allowed_batch_size, max_batch_size);
+    }
+  }
+  return max_batch_size;
+}
+
+template <typename TaskType>
+std::unique_ptr<Batch<TaskType>> Queue<TaskType>::FillWithLowPriorityTasks(
+    std::unique_ptr<Batch<TaskType>> batch) {
+  const size_t padded_size = PaddedBatchSize(batch->size());
+  if (batch->size() >= padded_size) return batch;
+  size_t room = padded_size - batch->size();
+
+  // A closed batch takes no more tasks, so they move to a new one.
+  auto filled_batch =
+      std::make_unique<Batch<TaskType>>(batch->traceme_context_id());
+  for (auto& task : batch->RemoveAllTasks()) {
+    filled_batch->AddTask(std::move(task));
+  }
+  // The oldest tasks that fit go first; the others keep their order.
+  std::deque<LowPriorityTask> waiting_tasks;
+  for (LowPriorityTask& low_priority_task : low_priority_tasks_) {
+    const size_t size = low_priority_task.task->size();
+    if (size <= room) {
+      room -= size;
+      low_priority_tasks_size_ -= size;
+      filled_batch->AddTask(std::move(low_priority_task.task));
+    } else {
+      waiting_tasks.push_back(std::move(low_priority_task));
+    }
+  }
+  low_priority_tasks_.swap(waiting_tasks);
+  filled_batch->Close();
+  return filled_batch;
+}
+
+template <typename TaskType>
+bool Queue<TaskType>::IsLowPriorityBatchSchedulable() const {
+  if (low_priority_tasks_.empty()) return false;
+  const int64_t timeout_micros =
+      options_.low_priority_batch_timeout_micros > 0
+          ? options_.low_priority_batch_timeout_micros
+          : options_.batch_timeout_micros;
+  return closed_ ||
+         env_->NowMicros() >=
+             low_priority_tasks_.front().enqueue_time_micros + timeout_micros;
+}
+
+template <typename TaskType>
+std::unique_ptr<Batch<TaskType>> Queue<TaskType>::TakeLowPriorityBatch() {
+  auto batch =
+      std::make_unique<Batch<TaskType>>(++traceme_context_id_counter_);
+  const size_t max_batch_size = current_max_execution_batch_size();
+  while (!low_priority_tasks_.empty()) {
+    const size_t size = low_priority_tasks_.front().task->size();
+    if (!batch->empty() && batch->size() + size > max_batch_size) break;
+    low_priority_tasks_size_ -= size;
+    batch->AddTask(std::move(low_priority_tasks_.front().task));
+    low_priority_tasks_.pop_front();
+  }
+  batch->Close();
+  return batch;
+}
+
 template <typename TaskType>
 QueueHandle<TaskType>::QueueHandle(
     std::shared_ptr<SharedBatchScheduler<TaskType>> scheduler,
@@ -44,14 +44,19 @@ using ::testing::HasSubstr;
 
 class FakeTask : public BatchTask {
  public:
-  explicit FakeTask(size_t size) : size_(size) {}
+  explicit FakeTask(size_t size,
+                    BatchTaskPriority priority = BatchTaskPriority::kHigh)
+      : size_(size), priority_(priority) {}
 
   ~FakeTask() override = default;
 
   size_t size() const override { return size_; }
 
+  BatchTaskPriority priority() const override { return priority_; }
+
  private:
   const size_t size_;
+  const BatchTaskPriority priority_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(FakeTask);
 };
@@ -74,6 +79,16 @@ Status ScheduleTask(size_t task_size, BatchScheduler<FakeTask>* scheduler) {
   return status;
 }
 
+// Schedules a low priority FakeTask of size 'task_size'.
+Status ScheduleLowPriorityTask(size_t task_size,
+                               BatchScheduler<FakeTask>* scheduler) {
+  std::unique_ptr<FakeTask> task(
+      new FakeTask(task_size, BatchTaskPriority::kLow));
+  Status status = scheduler->Schedule(&task);
+  CHECK_EQ(status.ok(), task == nullptr);
+  return status;
+}
+
 // Creates a thread that waits on 'start' and then advances the fake clock in
 // 'env' in a loop until 'stop' is notified. Useful for allowing objects that
 // use the clock to be destroyed.
@@ -793,6 +808,226 @@ TEST_P(SharedBatchSchedulerTest, ZeroQueueRewrittenToOneQueue) {
   }
 }
 
+TEST_P(SharedBatchSchedulerTest, InvalidLatencyTarget) {
+  auto callback = [](std::unique_ptr<Batch<FakeTask>> batch) {
+    // do nothing.
+  };
+
+  auto scheduler = CreateSharedBatchScheduler(2);
+
+  QueueOptions queue_options = CreateQueueOptions(
+      10 /* max_execution_batch_size */, 10 /* input_batch_size_limit */,
+      100 /* batch_timeout_micros */, 2 /* max_enqueued_batches */);
+  queue_options.latency_target_micros = -1;
+  std::unique_ptr<Queue> queue;
+  EXPECT_THAT(scheduler->AddQueue(queue_options, callback, &queue),
+              testing::StatusIs(error::INVALID_ARGUMENT,
+                                "latency_target_micros must be non-negative; "
+                                "was -1"));
+}
+
+TEST_P(SharedBatchSchedulerTest, ProcessesBatchesWithLatencyTarget) {
+  mutex mu;
+  int num_processed_tasks = 0;
+  auto callback = [&mu, &num_processed_tasks](
+                      std::unique_ptr<Batch<FakeTask>> batch) {
+    ASSERT_TRUE(batch->IsClosed());
+    mutex_lock l(mu);
+    num_processed_tasks += batch->num_tasks();
+  };
+
+  auto scheduler = CreateSharedBatchScheduler(2);
+  QueueOptions queue_options = CreateQueueOptions(
+      4 /* max_execution_batch_size */, 4 /* input_batch_size_limit */,
+      100 /* batch_timeout_micros */, INT_MAX /* max_enqueued_batches */);
+  queue_options.latency_target_micros = 1000;
+  {
+    std::unique_ptr<Queue> queue =
+        CreateQueue(scheduler, queue_options, callback);
+    for (int i = 0; i < 500; ++i) {
+      TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    }
+  }
+  mutex_lock l(mu);
+  EXPECT_EQ(num_processed_tasks, 500);
+}
+
+TEST(SharedBatchSchedulerPriorityTest, LowPriorityTasksFillPadding) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  {
+    mutex mu;
+    std::vector<std::vector<std::pair<size_t, BatchTaskPriority>>> batches;
+    auto callback = [&mu, &batches](std::unique_ptr<Batch<FakeTask>> batch) {
+      ASSERT_TRUE(batch->IsClosed());
+      std::vector<std::pair<size_t, BatchTaskPriority>> tasks;
+      for (int i = 0; i < batch->num_tasks(); ++i) {
+        tasks.emplace_back(batch->task(i).size(), batch->task(i).priority());
+      }
+      mutex_lock l(mu);
+      batches.push_back(std::move(tasks));
+    };
+    auto num_batches = [&mu, &batches]() {
+      mutex_lock l(mu);
+      return batches.size();
+    };
+
+    auto scheduler = CreateSharedBatchScheduler(1, &env);
+    QueueOptions options = CreateQueueOptions(
+        8 /* max_execution_batch_size */, 8 /* input_batch_size_limit */,
+        10 /* batch_timeout_micros */, 2 /* max_enqueued_batches */,
+        false /* enable_large_batch_splitting */,
+        false /* enable_lazy_split */, nullptr /* no func */);
+    options.allowed_batch_sizes = {4, 8};
+    options.low_priority_batch_timeout_micros = 1000;
+    auto queue = CreateQueue(scheduler, options, callback);
+
+    TF_ASSERT_OK(ScheduleLowPriorityTask(2, queue.get()));
+    TF_ASSERT_OK(ScheduleLowPriorityTask(4, queue.get()));
+    TF_ASSERT_OK(ScheduleLowPriorityTask(1, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(5, queue.get()));
+    EXPECT_EQ(queue->NumEnqueuedTasks(), 4);
+
+    // The high priority batch, padded to 8, takes the low priority tasks that
+    // fit in its padding.
+    env.AdvanceByMicroseconds(10);
+    while (num_batches() < 1) Env::Default()->SleepForMicroseconds(100);
+    // The low priority task left waits for its timeout.
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    EXPECT_EQ(num_batches(), 1);
+    env.AdvanceByMicroseconds(990);
+    while (num_batches() < 2) Env::Default()->SleepForMicroseconds(100);
+
+    mutex_lock l(mu);
+    using Tasks = std::vector<std::pair<size_t, BatchTaskPriority>>;
+    EXPECT_EQ(batches[0], Tasks({{5, BatchTaskPriority::kHigh},
+                                 {2, BatchTaskPriority::kLow},
+                                 {1, BatchTaskPriority::kLow}}));
+    EXPECT_EQ(batches[1], Tasks({{4, BatchTaskPriority::kLow}}));
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(SharedBatchSchedulerPriorityTest, LowPriorityLaneIsBounded) {
+  auto callback = [](std::unique_ptr<Batch<FakeTask>> batch) {
+    // do nothing.
+  };
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  {
+    auto scheduler = CreateSharedBatchScheduler(1, &env);
+    QueueOptions options = CreateQueueOptions(
+        4 /* max_execution_batch_size */, 4 /* input_batch_size_limit */,
+        10 /* batch_timeout_micros */, 2 /* max_enqueued_batches */,
+        false /* enable_large_batch_splitting */,
+        false /* enable_lazy_split */, nullptr /* no func */);
+    options.low_priority_batch_timeout_micros = 1000;
+    auto queue = CreateQueue(scheduler, options, callback);
+
+    TF_ASSERT_OK(ScheduleLowPriorityTask(4, queue.get()));
+    TF_ASSERT_OK(ScheduleLowPriorityTask(3, queue.get()));
+    EXPECT_THAT(ScheduleLowPriorityTask(2, queue.get()),
+                testing::StatusIs(error::UNAVAILABLE,
+                                  HasSubstr("low priority lane")));
+    // The high priority tasks have a capacity of their own.
+    TF_EXPECT_OK(ScheduleTask(4, queue.get()));
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+// Records a window of batches of `batch_size` tasks with the given queueing
+// delay and processing time.
+void RecordWindow(internal::LatencyTargetController* controller,
+                  size_t batch_size, int64_t queue_delay_micros,
+                  int64_t processing_micros) {
+  for (int i = 0; i < internal::LatencyTargetController::kWindowSize; ++i) {
+    controller->RecordQueueDelay(queue_delay_micros);
+    controller->RecordProcessing(batch_size, processing_micros);
+  }
+}
+
+TEST(LatencyTargetControllerTest, StartsFromQueueOptions) {
+  internal::LatencyTargetController controller(
+      /*latency_target_micros=*/1000, /*batch_timeout_micros=*/5000,
+      /*max_batch_size=*/100);
+  // The timeout is capped by the target.
+  EXPECT_EQ(controller.batch_timeout_micros(), 1000);
+  EXPECT_EQ(controller.max_batch_size(), 100);
+  // Nothing changes within a window.
+  for (int i = 1; i < internal::LatencyTargetController::kWindowSize; ++i) {
+    controller.RecordQueueDelay(5000);
+    controller.RecordProcessing(100, 5000);
+  }
+  EXPECT_EQ(controller.batch_timeout_micros(), 1000);
+  EXPECT_EQ(controller.max_batch_size(), 100);
+}
+
+TEST(LatencyTargetControllerTest, ShortensTimeoutOverTarget) {
+  internal::LatencyTargetController controller(
+      /*latency_target_micros=*/1000, /*batch_timeout_micros=*/800,
+      /*max_batch_size=*/100);
+  RecordWindow(&controller, 10, /*queue_delay_micros=*/900,
+               /*processing_micros=*/300);
+  EXPECT_EQ(controller.batch_timeout_micros(), 400);
+  EXPECT_EQ(controller.max_batch_size(), 100);
+}
+
+TEST(LatencyTargetControllerTest, ShrinksSlowBatches) {
+  internal::LatencyTargetController controller(
+      /*latency_target_micros=*/1000, /*batch_timeout_micros=*/800,
+      /*max_batch_size=*/100);
+  RecordWindow(&controller, 100, /*queue_delay_micros=*/500,
+               /*processing_micros=*/600);
+  EXPECT_EQ(controller.batch_timeout_micros(), 400);
+  EXPECT_EQ(controller.max_batch_size(), 75);
+  RecordWindow(&controller, 75, /*queue_delay_micros=*/400,
+               /*processing_micros=*/700);
+  EXPECT_EQ(controller.batch_timeout_micros(), 200);
+  EXPECT_EQ(controller.max_batch_size(), 56);
+}
+
+TEST(LatencyTargetControllerTest, GrowsUnderTarget) {
+  internal::LatencyTargetController controller(
+      /*latency_target_micros=*/1000, /*batch_timeout_micros=*/100,
+      /*max_batch_size=*/100);
+  RecordWindow(&controller, 100, /*queue_delay_micros=*/500,
+               /*processing_micros=*/600);
+  EXPECT_EQ(controller.batch_timeout_micros(), 50);
+  EXPECT_EQ(controller.max_batch_size(), 75);
+
+  // 850us of headroom, at 4us per task.
+  RecordWindow(&controller, 25, /*queue_delay_micros=*/50,
+               /*processing_micros=*/100);
+  EXPECT_EQ(controller.batch_timeout_micros(), 50 + 850 / 4);
+  EXPECT_EQ(controller.max_batch_size(), 100);
+
+  // Close enough to the target.
+  RecordWindow(&controller, 100, /*queue_delay_micros=*/400,
+               /*processing_micros=*/400);
+  EXPECT_EQ(controller.batch_timeout_micros(), 50 + 850 / 4);
+  EXPECT_EQ(controller.max_batch_size(), 100);
+}
+
+TEST(LatencyTargetControllerTest, GrowsBatchesByHeadroom) {
+  internal::LatencyTargetController controller(
+      /*latency_target_micros=*/1000, /*batch_timeout_micros=*/0,
+      /*max_batch_size=*/1000);
+  RecordWindow(&controller, 1000, /*queue_delay_micros=*/0,
+               /*processing_micros=*/2000);
+  EXPECT_EQ(controller.max_batch_size(), 750);
+  // 900us of headroom at 1us per task fit 450 more tasks, up to the maximum.
+  RecordWindow(&controller, 100, /*queue_delay_micros=*/0,
+               /*processing_micros=*/100);
+  EXPECT_EQ(controller.batch_timeout_micros(), 225);
+  EXPECT_EQ(controller.max_batch_size(), 1000);
+}
+
 // TODO(b/161857471):
 // Add test coverage when input-split and no-split returns differently.
 INSTANTIATE_TEST_SUITE_P(
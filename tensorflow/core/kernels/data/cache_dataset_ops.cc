@@ -14,24 +14,39 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#ifndef _MSC_VER
+#include <sys/mman.h>  // for madvise
+#endif
+
+#include <algorithm>
+#include <deque>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/dataset_options.pb.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/kernels/data/cache_ops.h"
 #include "tensorflow/core/kernels/data/iterator_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
@@ -64,12 +79,50 @@ constexpr char kCacheCompleted[] = "cache_completed";
 constexpr char kIndex[] = "index";
 constexpr char kImpl[] = "Impl";
 constexpr char kCacheDataset[] = "CacheDataset";
+constexpr char kFileCacheZeroCopyReads[] = "file_cache_zero_copy_reads";
+// Tensors smaller than this are copied out of the memory-mapped cache files
+// rather than aliased, since the bookkeeping outweighs the saved memcpy.
+constexpr uint64 kMinZeroCopyBytes = 4096;
+constexpr char kCompressedMemoryCache[] = "compressed_memory_cache";
 constexpr char kIncompleteCacheErrorMessage[] =
     "The calling iterator did not fully read the dataset being cached. In "
     "order to avoid unexpected truncation of the dataset, the partially cached "
     "contents of the dataset  will be discarded. This can happen if you have "
     "an input pipeline similar to `dataset.cache().take(k).repeat()`. You "
     "should use `dataset.take(k).cache().repeat()` instead.";
+
+// A `TensorBuffer` that aliases a range of a memory-mapped cache data file.
+// It keeps the mapping alive for as long as any tensor refers to it. Since the
+// mapping is read-only, the buffer reports that it does not own its memory,
+// which prevents kernels from forwarding it as an output buffer.
+class MappedCacheTensorBuffer : public TensorBuffer {
+ public:
+  MappedCacheTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                          const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("MappedCacheFile");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
+// Returns whether `element` is a single `CompressedElement` produced by a
+// `MemoryWriterIterator` running in compressed mode.
+bool IsCompressedElement(const std::vector<Tensor>& element) {
+  return element.size() == 1 && element[0].dtype() == DT_VARIANT &&
+         TensorShapeUtils::IsScalar(element[0].shape()) &&
+         element[0].scalar<Variant>()().get<CompressedElement>() != nullptr;
+}
 }  // namespace
 
 class PartialCache {
@@ -144,7 +197,8 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
         item_index_padding_size_(StringPaddingSize(kMaxItems)),
         tensor_format_string_(strings::Printf(kKeyStrFormat,
                                               item_index_padding_size_,
-                                              tensor_index_padding_size_)) {
+                                              tensor_index_padding_size_)),
+        zero_copy_reads_(GetExperiments().contains(kFileCacheZeroCopyReads)) {
     input_->Ref();
     DCHECK_EQ(item_index_padding_size_, 7);
   }
@@ -438,11 +492,22 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
         }
         filename_ = strings::StrCat(dataset()->filename_, "_", shard_id_);
         lockfile_ = strings::StrCat(filename_, kLockFileSuffix);
-        writer_ = std::make_unique<BundleWriter>(dataset()->env_, filename_);
+        writer_ = std::make_unique<BundleWriter>(dataset()->env_, filename_,
+                                                 WriterOptions());
         return OkStatus();
       }
 
      private:
+      BundleWriter::Options WriterOptions() const {
+        BundleWriter::Options options;
+        if (dataset()->zero_copy_reads_) {
+          // Aligns tensor data so that large tensors can later be aliased
+          // directly from the memory-mapped data files.
+          options.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+        }
+        return options;
+      }
+
       Status EnsureLockFileExists(bool* end_of_sequence)
           TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
         if (iteration_completed_) {
@@ -500,7 +565,8 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
         // conditions are not met since BundleWriter's constructor creates
         // new temp files which can delete the temp files created by a
         // BundleWriter in another Session.
-        writer_ = std::make_unique<BundleWriter>(dataset()->env_, filename_);
+        writer_ = std::make_unique<BundleWriter>(dataset()->env_, filename_,
+                                                 WriterOptions());
         lockfile_created_ = true;
         return OkStatus();
       }
@@ -555,7 +621,21 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
           : DatasetIterator<FileDatasetBase>(params),
             cur_index_(0),
             reader_(dataset()->env_, dataset()->filename_),
-            iterator_restored_(false) {}
+            iterator_restored_(false) {
+        // Upon construction `reader_` is positioned at the header entry, which
+        // describes how the data files may be mapped.
+        if (dataset()->zero_copy_reads_ && reader_.status().ok() &&
+            reader_.Valid() && reader_.key() == kHeaderEntryKey) {
+          BundleHeaderProto header;
+          if (ParseProtoUnlimited(&header, reader_.value())) {
+            num_shards_ = header.num_shards();
+            const bool need_to_swap_bytes =
+                (header.endianness() == BundleHeaderProto::BIG) ==
+                port::kLittleEndian;
+            can_alias_ = !need_to_swap_bytes;
+          }
+        }
+      }
 
       Status GetNextInternal(IteratorContext* ctx,
                              std::vector<Tensor>* out_tensors,
@@ -586,7 +666,7 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
           }
           StringPiece key = reader_.key();
           DCHECK_EQ(key, dataset()->FormatName(cur_index_, i));
-          TF_RETURN_IF_ERROR(reader_.ReadCurrent(&(*out_tensors)[i]));
+          TF_RETURN_IF_ERROR(ReadCurrent(&(*out_tensors)[i]));
           TF_RETURN_IF_ERROR(reader_.status());
         }
         cur_index_++;
@@ -632,10 +712,110 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
       }
 
      private:
+      // Reads the tensor at the current position of `reader_`, aliasing the
+      // memory-mapped data file where possible.
+      Status ReadCurrent(Tensor* val) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (can_alias_) {
+          bool aliased = false;
+          TF_RETURN_IF_ERROR(MaybeReadCurrentAliased(val, &aliased));
+          if (aliased) {
+            return OkStatus();
+          }
+        }
+        return reader_.ReadCurrent(val);
+      }
+
+      // Sets `*aliased` to true and makes `val` point into the mapped data
+      // file if the current entry is a large, suitably aligned tensor of a
+      // memcpy-able type. Otherwise leaves `val` untouched.
+      Status MaybeReadCurrentAliased(Tensor* val, bool* aliased)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        *aliased = false;
+        BundleEntryProto entry;
+        if (!ParseProtoUnlimited(&entry, reader_.value())) {
+          return errors::DataLoss("Unable to parse cache entry for key ",
+                                  reader_.key());
+        }
+        if (!DataTypeCanUseMemcpy(entry.dtype()) || entry.slices_size() > 0 ||
+            entry.size() < kMinZeroCopyBytes ||
+            entry.offset() % EIGEN_MAX_ALIGN_BYTES != 0 ||
+            !TensorShape::IsValid(entry.shape())) {
+          return OkStatus();
+        }
+        std::shared_ptr<ReadOnlyMemoryRegion> region;
+        TF_RETURN_IF_ERROR(GetMappedShard(entry.shard_id(), &region));
+        if (region == nullptr) {
+          return OkStatus();
+        }
+        const TensorShape shape(entry.shape());
+        if (entry.size() != shape.num_elements() * DataTypeSize(entry.dtype())) {
+          return errors::DataLoss("Invalid size in cache entry: key ",
+                                  reader_.key(), "; stored size ",
+                                  entry.size());
+        }
+        if (entry.offset() + entry.size() > region->length()) {
+          return errors::DataLoss("Cache entry for key ", reader_.key(),
+                                  " extends past the end of its data file");
+        }
+        const char* data =
+            static_cast<const char*>(region->data()) + entry.offset();
+        const uint32 actual_crc32c = crc32c::Value(data, entry.size());
+        if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+          return errors::DataLoss(
+              "Checksum does not match: stored ",
+              strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+              " vs. calculated on the restored bytes ", actual_crc32c);
+        }
+        auto* buffer = new MappedCacheTensorBuffer(region, data, entry.size());
+        *val = Tensor(entry.dtype(), shape, buffer);
+        buffer->Unref();
+        *aliased = true;
+        return OkStatus();
+      }
+
+      // Returns the memory-mapped data file for `shard_id`, mapping it on
+      // first use. Sets `*region` to nullptr if the file system does not
+      // support memory-mapping, in which case reads fall back to copying.
+      Status GetMappedShard(int32_t shard_id,
+                            std::shared_ptr<ReadOnlyMemoryRegion>* region)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        auto it = mapped_shards_.find(shard_id);
+        if (it != mapped_shards_.end()) {
+          *region = it->second;
+          return OkStatus();
+        }
+        std::unique_ptr<ReadOnlyMemoryRegion> mapped;
+        Status s = dataset()->env_->NewReadOnlyMemoryRegionFromFile(
+            DataFilename(dataset()->filename_, shard_id, num_shards_),
+            &mapped);
+        if (errors::IsUnimplemented(s)) {
+          VLOG(1) << "Memory-mapping is not supported for cache "
+                  << dataset()->filename_ << "; falling back to copying reads.";
+          can_alias_ = false;
+          *region = nullptr;
+          return OkStatus();
+        }
+        TF_RETURN_IF_ERROR(s);
+#ifndef _MSC_VER
+        // The cache is read front to back, so ask the kernel to read ahead
+        // aggressively. This is only a hint and failures are ignored.
+        madvise(const_cast<void*>(mapped->data()), mapped->length(),
+                MADV_SEQUENTIAL);
+#endif
+        *region = std::shared_ptr<ReadOnlyMemoryRegion>(std::move(mapped));
+        mapped_shards_[shard_id] = *region;
+        return OkStatus();
+      }
+
       mutex mu_;
       size_t cur_index_ TF_GUARDED_BY(mu_);
       BundleReader reader_ TF_GUARDED_BY(mu_);
       bool iterator_restored_ TF_GUARDED_BY(mu_);
+      // Whether tensors may be aliased from memory-mapped data files.
+      bool can_alias_ TF_GUARDED_BY(mu_) = false;
+      int32_t num_shards_ TF_GUARDED_BY(mu_) = 1;
+      absl::flat_hash_map<int32_t, std::shared_ptr<ReadOnlyMemoryRegion>>
+          mapped_shards_ TF_GUARDED_BY(mu_);
     };  // FileReaderIterator
 
     Status InitializeIterator(IteratorContext* ctx)
@@ -675,6 +855,10 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
   static constexpr size_t kMaxItems = 10000000;  // 10 million
   const size_t item_index_padding_size_;
   const string tensor_format_string_;
+  // If true, the cache is written with tensor data aligned for aliasing, and
+  // `FileReaderIterator` returns tensors that point into the memory-mapped
+  // cache files instead of copying them out.
+  const bool zero_copy_reads_;
 };  // FileDatasetBase
 
 class CacheDatasetOp::FileDataset : public CacheDatasetOp::FileDatasetBase {
@@ -727,7 +911,12 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              std::shared_ptr<MemoryCache> cache)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
-        cache_(std::move(cache)) {
+        cache_(std::move(cache)),
+        // An element that consists of a single variant could be confused with
+        // a compressed element, so such datasets are always cached as is.
+        compress_(GetExperiments().contains(kCompressedMemoryCache) &&
+                  !(input->output_dtypes().size() == 1 &&
+                    input->output_dtypes()[0] == DT_VARIANT)) {
     input_->Ref();
   }
 
@@ -876,8 +1065,18 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
           }
           return OkStatus();
         }
-        RecordBufferEnqueue(ctx, *out_tensors);
-        temp_cache_.emplace_back(*out_tensors);
+        if (dataset()->compress_) {
+          CompressedElement compressed;
+          TF_RETURN_IF_ERROR(CompressElement(*out_tensors, &compressed));
+          Tensor compressed_tensor(DT_VARIANT, TensorShape({}));
+          compressed_tensor.scalar<Variant>()() = std::move(compressed);
+          std::vector<Tensor> cached_element = {std::move(compressed_tensor)};
+          RecordBufferEnqueue(ctx, cached_element);
+          temp_cache_.push_back(std::move(cached_element));
+        } else {
+          RecordBufferEnqueue(ctx, *out_tensors);
+          temp_cache_.emplace_back(*out_tensors);
+        }
         if (temp_cache_.size() == dataset()->input_->Cardinality()) {
           VLOG(2) << "Finalizing the cache because its size matches the "
                      "expected input cardinality.";
@@ -946,6 +1145,12 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         mutex_lock l(mu_);
         if (index_ < cache_->size()) {
           const std::vector<Tensor>& cache_tensors = cache_->at(index_);
+          if (IsCompressedElement(cache_tensors)) {
+            TF_RETURN_IF_ERROR(GetNextUncompressed(ctx, out_tensors));
+            index_++;
+            *end_of_sequence = false;
+            return OkStatus();
+          }
           out_tensors->insert(out_tensors->begin(), cache_tensors.begin(),
                               cache_tensors.end());
           index_++;
@@ -983,13 +1188,57 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
           }
           index_ = static_cast<size_t>(temp);
         }
+        uncompressed_.clear();
         return OkStatus();
       }
 
      private:
+      // Moves the uncompressed element at `index_` into `out_tensors`. If no
+      // uncompressed elements are buffered, uncompresses the next window of
+      // elements in parallel using the iterator's runner.
+      Status GetNextUncompressed(IteratorContext* ctx,
+                                 std::vector<Tensor>* out_tensors)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (uncompressed_.empty()) {
+          const size_t window =
+              std::min<size_t>(std::max(ctx->runner_threadpool_size(), 1),
+                               cache_->size() - index_);
+          std::vector<std::vector<Tensor>> elements(window);
+          std::vector<Status> statuses(window);
+          BlockingCounter counter(window);
+          for (size_t i = 0; i < window; ++i) {
+            const std::vector<Tensor>& compressed = cache_->at(index_ + i);
+            (*ctx->runner())([&compressed, &elements, &statuses, &counter, i]() {
+              if (IsCompressedElement(compressed)) {
+                statuses[i] = UncompressElement(
+                    *compressed[0].scalar<Variant>()().get<CompressedElement>(),
+                    &elements[i]);
+              } else {
+                elements[i] = compressed;
+              }
+              counter.DecrementCount();
+            });
+          }
+          counter.Wait();
+          for (size_t i = 0; i < window; ++i) {
+            TF_RETURN_IF_ERROR(statuses[i]);
+            uncompressed_.push_back(std::move(elements[i]));
+          }
+        }
+        std::vector<Tensor>& element = uncompressed_.front();
+        out_tensors->insert(out_tensors->begin(),
+                            std::make_move_iterator(element.begin()),
+                            std::make_move_iterator(element.end()));
+        uncompressed_.pop_front();
+        return OkStatus();
+      }
+
       mutex mu_;
       MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
       size_t index_ TF_GUARDED_BY(mu_);
+      // Uncompressed elements for indices [index_, index_ + size), when the
+      // cache holds compressed elements.
+      std::deque<std::vector<Tensor>> uncompressed_ TF_GUARDED_BY(mu_);
     };  // MemoryReaderIterator
 
     Status InitializeIterator(IteratorContext* ctx)
@@ -1017,6 +1266,9 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
   mutable mutex mu_;
   const DatasetBase* const input_;
   const std::shared_ptr<MemoryCache> cache_;
+  // If true, elements are stored in the cache as snappy-compressed
+  // `CompressedElement`s and uncompressed when read.
+  const bool compress_;
   mutable std::unique_ptr<PartialCache> partial_cache_ TF_GUARDED_BY(mu_);
 };  // MemoryDatasetBase
 
@@ -11,13 +11,17 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <cstdlib>
+#include <functional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
 #include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/util/tensor_bundle/naming.h"
 
 namespace tensorflow {
 namespace data {
@@ -26,6 +30,11 @@ namespace {
 constexpr char kNodeName[] = "cache_dataset";
 constexpr char kFileDatasetPrefix[] = "File";
 constexpr char kMemoryDatasetPrefix[] = "Memory";
+constexpr char kCompressedMemoryCache[] = "compressed_memory_cache";
+constexpr char kFileCacheZeroCopyReads[] = "file_cache_zero_copy_reads";
+// The number of int64 values of each element read from a memory-mapped
+// cache, large enough for the element to be aliased.
+constexpr int64_t kZeroCopyElementSize = 1024;
 
 class CacheDatasetParams : public DatasetParams {
  public:
@@ -370,6 +379,271 @@ INSTANTIATE_TEST_CASE_P(CacheDatasetOpTest,
                         ParameterizedIteratorSaveAndRestoreTest,
                         ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
 
+// Caches 3 elements large enough to be aliased by memory-mapped reads.
+CacheDatasetParams ZeroCopyCacheDatasetParams() {
+  std::vector<int64_t> values(3 * kZeroCopyElementSize);
+  for (size_t i = 0; i < values.size(); ++i) values[i] = i;
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(
+          TensorShape{3, kZeroCopyElementSize}, values)},
+      /*node_name=*/"tensor_slice");
+  return CacheDatasetParams(
+      std::move(tensor_slice_dataset_params),
+      /*filename=*/io::JoinPath(testing::TmpDir(), "zero_copy_cache_data"),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({kZeroCopyElementSize})},
+      kNodeName);
+}
+
+std::vector<Tensor> ZeroCopyCacheExpectedOutputs() {
+  std::vector<Tensor> outputs;
+  for (int64_t i = 0; i < 3; ++i) {
+    std::vector<int64_t> values(kZeroCopyElementSize);
+    for (int64_t j = 0; j < kZeroCopyElementSize; ++j) {
+      values[j] = i * kZeroCopyElementSize + j;
+    }
+    outputs.push_back(
+        CreateTensor<int64_t>(TensorShape({kZeroCopyElementSize}), values));
+  }
+  return outputs;
+}
+
+// Opts the test into the tf.data experiment `experiment`.
+class CacheDatasetExperimentTest : public CacheDatasetOpTest {
+ protected:
+  explicit CacheDatasetExperimentTest(string experiment)
+      : experiment_(std::move(experiment)) {}
+
+  void SetUp() override {
+    setenv("TF_JOB_NAME", "test_job", /*overwrite=*/1);
+    setenv("TF_TASK_ID", "0", /*overwrite=*/1);
+    setenv("TF_DATA_EXPERIMENT_OPT_IN", experiment_.c_str(), /*overwrite=*/1);
+    ASSERT_TRUE(GetExperiments().contains(experiment_));
+  }
+
+  void TearDown() override {
+    unsetenv("TF_DATA_EXPERIMENT_OPT_IN");
+    unsetenv("TF_TASK_ID");
+    unsetenv("TF_JOB_NAME");
+  }
+
+  // Reads from `iterator_` until it fails or reaches the end of the
+  // sequence. Writes the cache in the first pass.
+  Status ReadToEnd() {
+    bool end_of_sequence = false;
+    std::vector<Tensor> out_tensors;
+    while (!end_of_sequence) {
+      TF_RETURN_IF_ERROR(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                            &end_of_sequence));
+    }
+    return OkStatus();
+  }
+
+  // Saves `iterator_` and restores it from the checkpoint.
+  Status SaveAndRestoreIterator(const DatasetParams& dataset_params) {
+    std::unique_ptr<SerializationContext> serialization_ctx;
+    TF_RETURN_IF_ERROR(CreateSerializationContext(&serialization_ctx));
+    VariantTensorDataWriter writer;
+    TF_RETURN_IF_ERROR(iterator_->Save(serialization_ctx.get(), &writer));
+    std::vector<const VariantTensorData*> data;
+    writer.GetData(&data);
+    VariantTensorDataReader reader(data);
+    return RestoreIterator(iterator_ctx_.get(), &reader,
+                           dataset_params.iterator_prefix(), *dataset_,
+                           &iterator_);
+  }
+
+ private:
+  const string experiment_;
+};
+
+class CacheDatasetZeroCopyReadsTest : public CacheDatasetExperimentTest {
+ protected:
+  CacheDatasetZeroCopyReadsTest()
+      : CacheDatasetExperimentTest(kFileCacheZeroCopyReads) {}
+
+  // Returns the name of the data file of the written cache.
+  string DataFile() const { return DataFilename(cache_filename_, 0, 1); }
+
+  // Rewrites the data file of the written cache with `update` applied.
+  Status UpdateDataFile(const std::function<void(string*)>& update) {
+    string content;
+    TF_RETURN_IF_ERROR(ReadFileToString(device_->env(), DataFile(), &content));
+    update(&content);
+    return WriteStringToFile(device_->env(), DataFile(), content);
+  }
+};
+
+TEST_F(CacheDatasetZeroCopyReadsTest, ReadsBackAliasedTensors) {
+  auto dataset_params = ZeroCopyCacheDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(ReadToEnd());
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  for (const Tensor& expected : ZeroCopyCacheExpectedOutputs()) {
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+    ASSERT_FALSE(end_of_sequence);
+    ASSERT_EQ(out_tensors.size(), 1);
+    TF_EXPECT_OK(ExpectEqual(out_tensors[0], expected));
+    // The tensor points into the mapped data file instead of owning a copy.
+    EXPECT_FALSE(out_tensors[0].RefCountIsOne());
+  }
+  TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                  &end_of_sequence));
+  EXPECT_TRUE(end_of_sequence);
+}
+
+TEST_F(CacheDatasetZeroCopyReadsTest, CorruptDataFile) {
+  auto dataset_params = ZeroCopyCacheDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(ReadToEnd());
+  TF_ASSERT_OK(UpdateDataFile([](string* content) { (*content)[0] ^= 1; }));
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  EXPECT_TRUE(errors::IsDataLoss(ReadToEnd()));
+}
+
+TEST_F(CacheDatasetZeroCopyReadsTest, TruncatedDataFile) {
+  auto dataset_params = ZeroCopyCacheDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(ReadToEnd());
+  TF_ASSERT_OK(UpdateDataFile(
+      [](string* content) { content->resize(content->size() / 2); }));
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  EXPECT_TRUE(errors::IsDataLoss(ReadToEnd()));
+}
+
+TEST_F(CacheDatasetZeroCopyReadsTest, SaveAndRestoreInTheMiddleOfARead) {
+  auto dataset_params = ZeroCopyCacheDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(ReadToEnd());
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  const std::vector<Tensor> expected_outputs = ZeroCopyCacheExpectedOutputs();
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                  &end_of_sequence));
+  ASSERT_FALSE(end_of_sequence);
+  TF_EXPECT_OK(ExpectEqual(out_tensors[0], expected_outputs[0]));
+
+  TF_ASSERT_OK(SaveAndRestoreIterator(dataset_params));
+
+  // The tensor read before saving stays valid after the restore.
+  TF_EXPECT_OK(ExpectEqual(out_tensors[0], expected_outputs[0]));
+  std::vector<Tensor> restored_tensors;
+  for (size_t i = 1; i < expected_outputs.size(); ++i) {
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &restored_tensors,
+                                    &end_of_sequence));
+    ASSERT_FALSE(end_of_sequence);
+    TF_EXPECT_OK(ExpectEqual(restored_tensors[0], expected_outputs[i]));
+  }
+  TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &restored_tensors,
+                                  &end_of_sequence));
+  EXPECT_TRUE(end_of_sequence);
+}
+
+// Caches elements of an int64 and a string component in memory.
+CacheDatasetParams CompressedMemoryCacheDatasetParams() {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(TensorShape{3, 2},
+                                            {0, 1, 2, 3, 4, 5}),
+                      CreateTensor<tstring>(
+                          TensorShape{3}, {"", "a", string(1000, 'b')})},
+      /*node_name=*/"tensor_slice");
+  return CacheDatasetParams(
+      std::move(tensor_slice_dataset_params),
+      /*filename=*/"",
+      /*output_dtypes=*/{DT_INT64, DT_STRING},
+      /*output_shapes=*/{PartialTensorShape({2}), PartialTensorShape({})},
+      kNodeName);
+}
+
+std::vector<std::vector<Tensor>> CompressedMemoryCacheExpectedOutputs() {
+  return {{CreateTensor<int64_t>(TensorShape({2}), {0, 1}),
+           CreateTensor<tstring>(TensorShape({}), {""})},
+          {CreateTensor<int64_t>(TensorShape({2}), {2, 3}),
+           CreateTensor<tstring>(TensorShape({}), {"a"})},
+          {CreateTensor<int64_t>(TensorShape({2}), {4, 5}),
+           CreateTensor<tstring>(TensorShape({}), {string(1000, 'b')})}};
+}
+
+class CacheDatasetCompressedMemoryTest : public CacheDatasetExperimentTest {
+ protected:
+  CacheDatasetCompressedMemoryTest()
+      : CacheDatasetExperimentTest(kCompressedMemoryCache) {}
+
+  // Reads the next element from `iterator_` and expects it to be `expected`.
+  void ExpectNextElement(const std::vector<Tensor>& expected) {
+    bool end_of_sequence = false;
+    std::vector<Tensor> out_tensors;
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+    ASSERT_FALSE(end_of_sequence);
+    ASSERT_EQ(out_tensors.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      TF_EXPECT_OK(ExpectEqual(out_tensors[i], expected[i]));
+    }
+  }
+
+  void ExpectEndOfSequence() {
+    bool end_of_sequence = false;
+    std::vector<Tensor> out_tensors;
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+    EXPECT_TRUE(end_of_sequence);
+  }
+};
+
+TEST_F(CacheDatasetCompressedMemoryTest, ReadsBackElements) {
+  auto dataset_params = CompressedMemoryCacheDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  const std::vector<std::vector<Tensor>> expected_outputs =
+      CompressedMemoryCacheExpectedOutputs();
+  // The elements are passed through while the cache is written...
+  for (const std::vector<Tensor>& expected : expected_outputs) {
+    ExpectNextElement(expected);
+  }
+  ExpectEndOfSequence();
+
+  // ...and uncompressed when it is read.
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  for (const std::vector<Tensor>& expected : expected_outputs) {
+    ExpectNextElement(expected);
+  }
+  ExpectEndOfSequence();
+}
+
+TEST_F(CacheDatasetCompressedMemoryTest, SaveAndRestoreInTheMiddleOfARead) {
+  auto dataset_params = CompressedMemoryCacheDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(ReadToEnd());
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  const std::vector<std::vector<Tensor>> expected_outputs =
+      CompressedMemoryCacheExpectedOutputs();
+  ExpectNextElement(expected_outputs[0]);
+
+  // The restored iterator uncompresses the remaining elements again.
+  TF_ASSERT_OK(SaveAndRestoreIterator(dataset_params));
+  for (size_t i = 1; i < expected_outputs.size(); ++i) {
+    ExpectNextElement(expected_outputs[i]);
+  }
+  ExpectEndOfSequence();
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -0,0 +1,338 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks of the per-element overhead of the tf.data transformations,
+// i.e. of `GetNext()` on their iterators, including the tracing and the
+// autotuning model bookkeeping that comes with it. The inputs are scalar and
+// the functions trivial, so that the overhead dominates.
+//
+// Besides the time per element, the benchmarks report the number of tensor
+// allocations per element made by the CPU allocator.
+//
+// To run them:
+//   bazel run -c opt //tensorflow/core/kernels/data:dataset_ops_benchmark_test
+//     -- --benchmark_filter=all
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/kernels/data/parallel_map_dataset_op.h"
+#include "tensorflow/core/kernels/data/prefetch_dataset_op.h"
+#include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// The range never runs out during a benchmark.
+constexpr int64_t kRangeStop = int64_t{1} << 62;
+constexpr int64_t kBatchSize = 32;
+constexpr int kNumParallelCalls = 4;
+constexpr int64_t kBufferSize = 16;
+
+class PrefetchDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  PrefetchDatasetParams(T input_dataset_params, int64_t buffer_size)
+      : DatasetParams(input_dataset_params.output_dtypes(),
+                      input_dataset_params.output_shapes(),
+                      "prefetch_dataset"),
+        buffer_size_(buffer_size) {
+    input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
+    iterator_prefix_ =
+        name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
+                                   input_dataset_params.iterator_prefix());
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    return {CreateTensor<int64_t>(TensorShape({}), {buffer_size_})};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {PrefetchDatasetOp::kInputDataset,
+                    PrefetchDatasetOp::kBufferSize};
+    return OkStatus();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {{"output_types", output_dtypes_},
+                    {"output_shapes", output_shapes_},
+                    {"slack_period", 0},
+                    {"legacy_autotune", true},
+                    {"buffer_size_min", 0},
+                    {"metadata", ""}};
+    return OkStatus();
+  }
+
+  string dataset_type() const override {
+    return PrefetchDatasetOp::kDatasetType;
+  }
+
+ private:
+  int64_t buffer_size_;
+};
+
+class ShuffleDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  ShuffleDatasetParams(T input_dataset_params, int64_t buffer_size)
+      : DatasetParams(input_dataset_params.output_dtypes(),
+                      input_dataset_params.output_shapes(),
+                      "shuffle_dataset"),
+        buffer_size_(buffer_size) {
+    input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
+    iterator_prefix_ =
+        name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
+                                   input_dataset_params.iterator_prefix());
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    return {CreateTensor<int64_t>(TensorShape({}), {buffer_size_}),
+            CreateTensor<int64_t>(TensorShape({}), {1}),
+            CreateTensor<int64_t>(TensorShape({}), {2})};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {
+        ShuffleDatasetOpBase::kInputDataset, ShuffleDatasetOpBase::kBufferSize,
+        ShuffleDatasetOpBase::kSeed, ShuffleDatasetOpBase::kSeed2};
+    return OkStatus();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {{"output_types", output_dtypes_},
+                    {"output_shapes", output_shapes_},
+                    {"reshuffle_each_iteration", false},
+                    {"metadata", ""}};
+    return OkStatus();
+  }
+
+  string dataset_type() const override {
+    return ShuffleDatasetOp::kDatasetType;
+  }
+
+ private:
+  int64_t buffer_size_;
+};
+
+class ParallelMapDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  ParallelMapDatasetParams(T input_dataset_params, int64_t num_parallel_calls)
+      : DatasetParams(input_dataset_params.output_dtypes(),
+                      input_dataset_params.output_shapes(),
+                      "parallel_map_dataset"),
+        num_parallel_calls_(num_parallel_calls) {
+    input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
+    op_version_ = 2;
+    name_utils::IteratorPrefixParams params;
+    params.op_version = op_version_;
+    iterator_prefix_ = name_utils::IteratorPrefix(
+        input_dataset_params.dataset_type(),
+        input_dataset_params.iterator_prefix(), params);
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    return {CreateTensor<int64_t>(TensorShape({}), {num_parallel_calls_})};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {ParallelMapDatasetOp::kInputDataset,
+                    ParallelMapDatasetOp::kNumParallelCalls};
+    return OkStatus();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {
+        {"f", FunctionDefHelper::FunctionRef("XTimesTwo", {{"T", DT_INT64}})},
+        {"Targuments", DataTypeVector{}},
+        {"output_shapes", output_shapes_},
+        {"output_types", output_dtypes_},
+        {"use_inter_op_parallelism", true},
+        {"deterministic", "true"},
+        {"preserve_cardinality", true},
+        {"metadata", ""}};
+    return OkStatus();
+  }
+
+  string dataset_type() const override {
+    return ParallelMapDatasetOp::kDatasetType;
+  }
+
+  std::vector<FunctionDef> func_lib() const override {
+    return {test::function::XTimesTwo()};
+  }
+
+ private:
+  int64_t num_parallel_calls_;
+};
+
+RangeDatasetParams Range() {
+  return RangeDatasetParams(/*start=*/0, /*stop=*/kRangeStop, /*step=*/1);
+}
+
+template <typename T>
+MapDatasetParams Map(T input_dataset_params) {
+  return MapDatasetParams(
+      std::move(input_dataset_params),
+      /*other_arguments=*/{},
+      /*func=*/FunctionDefHelper::FunctionRef("XTimesTwo", {{"T", DT_INT64}}),
+      /*func_lib=*/{test::function::XTimesTwo()},
+      /*type_arguments=*/{},
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({})},
+      /*use_inter_op_parallelism=*/true,
+      /*preserve_cardinality=*/true,
+      /*node_name=*/"map_dataset");
+}
+
+template <typename T>
+BatchDatasetParams Batch(T input_dataset_params) {
+  return BatchDatasetParams(
+      std::move(input_dataset_params), kBatchSize,
+      /*drop_remainder=*/true,
+      /*parallel_copy=*/false,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({kBatchSize})},
+      /*node_name=*/"batch_dataset");
+}
+
+// Iterates over a dataset, with or without an autotuning model attached to
+// the iterator context.
+class DatasetBenchmark : public DatasetOpsTestBase {
+ public:
+  void TestBody() override {}
+
+  Status Initialize(const DatasetParams& dataset_params, bool autotune) {
+    TF_RETURN_IF_ERROR(DatasetOpsTestBase::Initialize(dataset_params));
+    if (autotune) {
+      // Recreates the iterator, so that its nodes are added to the model.
+      IteratorContext::Params params(iterator_ctx_.get());
+      params.model = std::make_shared<model::Model>();
+      iterator_ctx_ = std::make_unique<IteratorContext>(params);
+      iterator_.reset();
+      TF_RETURN_IF_ERROR(
+          dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                 dataset_params.iterator_prefix(), &iterator_));
+    }
+    return OkStatus();
+  }
+
+  Status GetNext(std::vector<Tensor>* out_tensors) {
+    bool end_of_sequence = false;
+    TF_RETURN_IF_ERROR(
+        iterator_->GetNext(iterator_ctx_.get(), out_tensors, &end_of_sequence));
+    if (end_of_sequence) {
+      return errors::OutOfRange("The benchmarked dataset ran out of elements");
+    }
+    return OkStatus();
+  }
+};
+
+int64_t NumCpuAllocations() {
+  std::optional<AllocatorStats> stats = cpu_allocator()->GetStats();
+  return stats ? stats->num_allocs : 0;
+}
+
+// Reports the time and the allocations per element of `dataset_params`,
+// where an element is one of the elements produced by its range.
+void RunBenchmark(::testing::benchmark::State& state,
+                  const DatasetParams& dataset_params, bool autotune,
+                  int64_t elements_per_output = 1) {
+  EnableCPUAllocatorStats();
+  DatasetBenchmark benchmark;
+  TF_CHECK_OK(benchmark.Initialize(dataset_params, autotune));
+  std::vector<Tensor> out_tensors;
+  // Warms up buffers, thread pools and function instantiations.
+  for (int i = 0; i < 100; ++i) {
+    TF_CHECK_OK(benchmark.GetNext(&out_tensors));
+  }
+
+  const int64_t num_allocs = NumCpuAllocations();
+  for (auto s : state) {
+    out_tensors.clear();
+    TF_CHECK_OK(benchmark.GetNext(&out_tensors));
+  }
+  const int64_t num_elements = state.iterations() * elements_per_output;
+  state.SetItemsProcessed(num_elements);
+  state.counters["allocs_per_element"] = ::benchmark::Counter(
+      static_cast<double>(NumCpuAllocations() - num_allocs) / num_elements);
+}
+
+void BM_Range(::testing::benchmark::State& state) {
+  RunBenchmark(state, Range(), /*autotune=*/false);
+}
+BENCHMARK(BM_Range);
+
+void BM_Map(::testing::benchmark::State& state) {
+  RunBenchmark(state, Map(Range()), /*autotune=*/state.range(0));
+}
+BENCHMARK(BM_Map)->Arg(0)->Arg(1);
+
+void BM_ParallelMap(::testing::benchmark::State& state) {
+  const bool autotune = state.range(0);
+  RunBenchmark(state,
+               ParallelMapDatasetParams(
+                   Range(), autotune ? model::kAutotune : kNumParallelCalls),
+               autotune);
+}
+BENCHMARK(BM_ParallelMap)->Arg(0)->Arg(1)->UseRealTime();
+
+void BM_Batch(::testing::benchmark::State& state) {
+  RunBenchmark(state, Batch(Range()), /*autotune=*/state.range(0),
+               kBatchSize);
+}
+BENCHMARK(BM_Batch)->Arg(0)->Arg(1);
+
+void BM_Prefetch(::testing::benchmark::State& state) {
+  const bool autotune = state.range(0);
+  RunBenchmark(state,
+               PrefetchDatasetParams(
+                   Range(), autotune ? model::kAutotune : kBufferSize),
+               autotune);
+}
+BENCHMARK(BM_Prefetch)->Arg(0)->Arg(1)->UseRealTime();
+
+void BM_Shuffle(::testing::benchmark::State& state) {
+  RunBenchmark(state, ShuffleDatasetParams(Range(), state.range(1)),
+               /*autotune=*/state.range(0));
+}
+BENCHMARK(BM_Shuffle)->ArgPair(0, 1024)->ArgPair(1, 1024);
+
+// A typical input pipeline, in which the tuning knobs are autotuned if and
+// only if autotuning is on.
+void BM_Pipeline(::testing::benchmark::State& state) {
+  const bool autotune = state.range(0);
+  RunBenchmark(
+      state,
+      PrefetchDatasetParams(
+          Batch(ParallelMapDatasetParams(
+              ShuffleDatasetParams(Range(), /*buffer_size=*/1024),
+              autotune ? model::kAutotune : kNumParallelCalls)),
+          autotune ? model::kAutotune : kBufferSize),
+      autotune, kBatchSize);
+}
+BENCHMARK(BM_Pipeline)->Arg(0)->Arg(1)->UseRealTime();
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
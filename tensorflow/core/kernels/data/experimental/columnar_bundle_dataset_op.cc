@@ -0,0 +1,446 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/columnar_bundle_dataset_op.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/split_utils.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/byte_order.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/protobuf/tensor_bundle.pb.h"
+#include "tensorflow/core/util/tensor_bundle/naming.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+/* static */ constexpr const char* const ColumnarBundleDatasetOp::kDatasetType;
+/* static */ constexpr const char* const ColumnarBundleDatasetOp::kFileNames;
+/* static */ constexpr const char* const ColumnarBundleDatasetOp::kBatchSize;
+/* static */ constexpr const char* const ColumnarBundleDatasetOp::kColumns;
+/* static */ constexpr const char* const ColumnarBundleDatasetOp::kOutputTypes;
+/* static */ constexpr const char* const ColumnarBundleDatasetOp::kOutputShapes;
+
+namespace {
+
+// Location of one column of a bundle.
+struct ColumnChunk {
+  int32 shard_id;
+  int64_t offset;
+  int64_t size;
+  TensorShape shape;
+  // Whether ranges of rows can be read directly from the data file, which is
+  // the case for fixed-size types stored in the byte order of the host.
+  bool direct_reads;
+};
+
+// A bundle holding one tensor per column, all with the same number of rows.
+struct ColumnarFile {
+  std::string prefix;
+  int32 num_shards;
+  int64_t num_rows;
+  // Index of the first row group of this file across all files.
+  int64_t first_row_group;
+  std::vector<ColumnChunk> columns;
+};
+
+Status ReadEntry(BundleReader* reader, StringPiece key,
+                 protobuf::MessageLite* entry) {
+  reader->Seek(key);
+  if (!reader->Valid() || reader->key() != key) {
+    return errors::NotFound("Key ", key, " not found in tensor bundle.");
+  }
+  if (!ParseProtoUnlimited(entry, reader->value())) {
+    return errors::DataLoss("Unable to parse the entry of key ", key);
+  }
+  return OkStatus();
+}
+
+// Reads the location and shape of `columns` in the bundle at `prefix`.
+Status ReadColumnarFile(Env* env, const std::string& prefix,
+                        const std::vector<std::string>& columns,
+                        const DataTypeVector& output_types,
+                        const std::vector<PartialTensorShape>& output_shapes,
+                        ColumnarFile* file) {
+  BundleReader reader(env, prefix);
+  TF_RETURN_IF_ERROR(reader.status());
+  BundleHeaderProto header;
+  TF_RETURN_IF_ERROR(ReadEntry(&reader, kHeaderEntryKey, &header));
+  const bool host_byte_order =
+      (header.endianness() == BundleHeaderProto::LITTLE) == port::kLittleEndian;
+
+  file->prefix = prefix;
+  file->num_shards = header.num_shards();
+  file->num_rows = 0;
+  file->columns.clear();
+  for (int i = 0; i < columns.size(); ++i) {
+    BundleEntryProto entry;
+    TF_RETURN_IF_ERROR(ReadEntry(&reader, columns[i], &entry));
+    if (entry.slices_size() > 0) {
+      return errors::Unimplemented("Column ", columns[i], " of ", prefix,
+                                   " is partitioned, which is not supported.");
+    }
+    if (entry.dtype() != output_types[i]) {
+      return errors::InvalidArgument(
+          "Column ", columns[i], " of ", prefix, " has type ",
+          DataTypeString(entry.dtype()), " but ",
+          DataTypeString(output_types[i]), " was expected.");
+    }
+    ColumnChunk chunk;
+    TF_RETURN_IF_ERROR(
+        TensorShape::BuildTensorShape(entry.shape(), &chunk.shape));
+    if (chunk.shape.dims() == 0) {
+      return errors::InvalidArgument("Column ", columns[i], " of ", prefix,
+                                     " is a scalar, but columns must have a "
+                                     "leading dimension indexing the rows.");
+    }
+    PartialTensorShape batch_shape(chunk.shape.dim_sizes());
+    batch_shape.set_dim(0, -1);
+    if (!output_shapes[i].IsCompatibleWith(batch_shape)) {
+      return errors::InvalidArgument(
+          "Column ", columns[i], " of ", prefix, " has shape ",
+          chunk.shape.DebugString(), " which is incompatible with ",
+          output_shapes[i].DebugString());
+    }
+    if (i == 0) {
+      file->num_rows = chunk.shape.dim_size(0);
+    } else if (chunk.shape.dim_size(0) != file->num_rows) {
+      return errors::InvalidArgument("Column ", columns[i], " of ", prefix,
+                                     " has ", chunk.shape.dim_size(0),
+                                     " rows but column ", columns[0], " has ",
+                                     file->num_rows, " rows.");
+    }
+    chunk.shard_id = entry.shard_id();
+    chunk.offset = entry.offset();
+    chunk.size = entry.size();
+    chunk.direct_reads =
+        host_byte_order && DataTypeCanUseMemcpy(entry.dtype()) &&
+        chunk.size == chunk.shape.num_elements() * DataTypeSize(entry.dtype());
+    file->columns.push_back(std::move(chunk));
+  }
+  return OkStatus();
+}
+
+}  // namespace
+
+class ColumnarBundleDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, std::vector<ColumnarFile> files,
+          int64_t batch_size, const std::vector<std::string>& columns,
+          const DataTypeVector& output_types,
+          const std::vector<PartialTensorShape>& output_shapes)
+      : DatasetBase(DatasetContext(ctx)),
+        files_(std::move(files)),
+        batch_size_(batch_size),
+        columns_(columns),
+        output_types_(output_types),
+        output_shapes_(output_shapes) {
+    num_row_groups_ = 0;
+    for (auto& file : files_) {
+      file.first_row_group = num_row_groups_;
+      num_row_groups_ += (file.num_rows + batch_size_ - 1) / batch_size_;
+    }
+  }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return std::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  // Row groups are the unit of sharding, e.g. by the tf.data service.
+  Status MakeSplitProviders(std::vector<std::unique_ptr<SplitProvider>>*
+                                split_providers) const override {
+    split_providers->push_back(
+        std::make_unique<IndexSplitProvider>(num_row_groups_));
+    return OkStatus();
+  }
+
+  const DataTypeVector& output_dtypes() const override { return output_types_; }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return output_shapes_;
+  }
+
+  string DebugString() const override {
+    return name_utils::DatasetDebugString(kDatasetType);
+  }
+
+  int64_t CardinalityInternal() const override { return num_row_groups_; }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    return num_row_groups_;
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    return OkStatus();
+  }
+
+  Status CheckExternalState() const override { return OkStatus(); }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    std::vector<tstring> prefixes;
+    prefixes.reserve(files_.size());
+    for (const auto& file : files_) {
+      prefixes.push_back(file.prefix);
+    }
+    Node* filenames = nullptr;
+    TF_RETURN_IF_ERROR(b->AddVector(prefixes, &filenames));
+    Node* batch_size = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(batch_size_, &batch_size));
+    AttrValue columns;
+    b->BuildAttrValue(columns_, &columns);
+    TF_RETURN_IF_ERROR(b->AddDataset(this, {filenames, batch_size},
+                                     {{kColumns, columns}}, output));
+    return OkStatus();
+  }
+
+ private:
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params) {}
+
+    bool SymbolicCheckpointCompatible() const override { return true; }
+
+    Status Initialize(IteratorContext* ctx) override {
+      if (ctx->split_providers().empty()) {
+        split_provider_ =
+            std::make_shared<IndexSplitProvider>(dataset()->num_row_groups_);
+      } else {
+        TF_ASSIGN_OR_RETURN(split_provider_,
+                            GetSingleSplitProvider(ctx, dataset()));
+      }
+      return OkStatus();
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      Tensor split;
+      TF_RETURN_IF_ERROR(split_provider_->GetNext(&split, end_of_sequence));
+      if (*end_of_sequence) {
+        return OkStatus();
+      }
+      const int64_t row_group = split.scalar<int64_t>()();
+      const auto& files = dataset()->files_;
+      auto it = std::upper_bound(
+          files.begin(), files.end(), row_group,
+          [](int64_t row_group, const ColumnarFile& file) {
+            return row_group < file.first_row_group;
+          });
+      if (it == files.begin()) {
+        return errors::InvalidArgument("Invalid row group ", row_group);
+      }
+      const ColumnarFile& file = *(--it);
+      const int64_t start =
+          (row_group - file.first_row_group) * dataset()->batch_size_;
+      const int64_t num_rows =
+          std::min(dataset()->batch_size_, file.num_rows - start);
+
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(OpenFile(ctx, it - files.begin()));
+      const int num_columns = file.columns.size();
+      out_tensors->clear();
+      out_tensors->reserve(num_columns);
+      std::vector<Status> statuses(num_columns);
+      BlockingCounter counter(num_columns);
+      for (int i = 0; i < num_columns; ++i) {
+        const ColumnChunk& chunk = file.columns[i];
+        if (!chunk.direct_reads) {
+          out_tensors->push_back(tensor::DeepCopy(
+              full_columns_[i].Slice(start, start + num_rows)));
+          counter.DecrementCount();
+          continue;
+        }
+        TensorShape shape = chunk.shape;
+        shape.set_dim(0, num_rows);
+        out_tensors->emplace_back(ctx->allocator({}),
+                                  dataset()->output_types_[i], shape);
+        Tensor* out = &out_tensors->back();
+        RandomAccessFile* data_file = data_files_[chunk.shard_id].get();
+        (*ctx->runner())([&, i, out, data_file]() {
+          statuses[i] = ReadRows(*data_file, file, file.columns[i], start,
+                                 num_rows, out);
+          counter.DecrementCount();
+        });
+      }
+      counter.Wait();
+      for (const Status& status : statuses) {
+        TF_RETURN_IF_ERROR(status);
+      }
+      return OkStatus();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeSourceNode(std::move(args));
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      return split_provider_->Save(
+          [this](const std::string& key) { return full_name(key); }, writer);
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      return split_provider_->Restore(
+          [this](const std::string& key) { return full_name(key); }, reader);
+    }
+
+   private:
+    // Opens the data files of the file at `file_index` and reads the columns
+    // which cannot be read one row group at a time.
+    Status OpenFile(IteratorContext* ctx, int64_t file_index)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (file_index == current_file_index_) {
+        return OkStatus();
+      }
+      current_file_index_ = -1;
+      data_files_.clear();
+      full_columns_.clear();
+      const ColumnarFile& file = dataset()->files_[file_index];
+      std::unique_ptr<BundleReader> reader;
+      full_columns_.resize(file.columns.size());
+      for (int i = 0; i < file.columns.size(); ++i) {
+        const ColumnChunk& chunk = file.columns[i];
+        if (chunk.direct_reads) {
+          if (!data_files_.contains(chunk.shard_id)) {
+            TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
+                DataFilename(file.prefix, chunk.shard_id, file.num_shards),
+                &data_files_[chunk.shard_id]));
+          }
+          continue;
+        }
+        // Strings and tensors stored in a foreign byte order are decoded by
+        // the bundle reader, so the whole column is read at once.
+        if (reader == nullptr) {
+          reader = std::make_unique<BundleReader>(ctx->env(), file.prefix);
+          TF_RETURN_IF_ERROR(reader->status());
+        }
+        TF_RETURN_IF_ERROR(
+            reader->Lookup(dataset()->columns_[i], &full_columns_[i]));
+      }
+      current_file_index_ = file_index;
+      return OkStatus();
+    }
+
+    // Reads `num_rows` rows of `chunk` starting at row `start` into `out`.
+    // Checksums cover whole columns, so they are not verified here.
+    static Status ReadRows(const RandomAccessFile& data_file,
+                           const ColumnarFile& file, const ColumnChunk& chunk,
+                           int64_t start, int64_t num_rows, Tensor* out) {
+      if (num_rows == 0) return OkStatus();
+      const int64_t row_bytes = chunk.size / file.num_rows;
+      const int64_t bytes = row_bytes * num_rows;
+      char* buffer = const_cast<char*>(out->tensor_data().data());
+      StringPiece result;
+      TF_RETURN_IF_ERROR(data_file.Read(chunk.offset + start * row_bytes,
+                                        bytes, &result, buffer));
+      if (result.size() != bytes) {
+        return errors::DataLoss("Requested ", bytes, " bytes from ",
+                                file.prefix, " but read ", result.size(),
+                                " bytes.");
+      }
+      if (result.data() != buffer) {
+        std::memcpy(buffer, result.data(), bytes);
+      }
+      return OkStatus();
+    }
+
+    std::shared_ptr<SplitProvider> split_provider_;
+
+    mutex mu_;
+    int64_t current_file_index_ TF_GUARDED_BY(mu_) = -1;
+    absl::flat_hash_map<int32, std::unique_ptr<RandomAccessFile>> data_files_
+        TF_GUARDED_BY(mu_);
+    std::vector<Tensor> full_columns_ TF_GUARDED_BY(mu_);
+  };
+
+  std::vector<ColumnarFile> files_;
+  const int64_t batch_size_;
+  const std::vector<std::string> columns_;
+  const DataTypeVector output_types_;
+  const std::vector<PartialTensorShape> output_shapes_;
+  int64_t num_row_groups_;
+};
+
+ColumnarBundleDatasetOp::ColumnarBundleDatasetOp(OpKernelConstruction* ctx)
+    : DatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kColumns, &columns_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputTypes, &output_types_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputShapes, &output_shapes_));
+  OP_REQUIRES(ctx,
+              columns_.size() == output_types_.size() &&
+                  columns_.size() == output_shapes_.size(),
+              errors::InvalidArgument(
+                  "`columns`, `output_types` and `output_shapes` must have the "
+                  "same length."));
+}
+
+void ColumnarBundleDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                          DatasetBase** output) {
+  const Tensor* filenames_tensor;
+  OP_REQUIRES_OK(ctx, ctx->input(kFileNames, &filenames_tensor));
+  OP_REQUIRES(
+      ctx, filenames_tensor->dims() <= 1,
+      errors::InvalidArgument("`filenames` must be a scalar or a vector."));
+  int64_t batch_size;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, kBatchSize, &batch_size));
+  OP_REQUIRES(ctx, batch_size > 0,
+              errors::InvalidArgument("`batch_size` must be greater than 0."));
+
+  std::vector<ColumnarFile> files(filenames_tensor->NumElements());
+  for (int i = 0; i < files.size(); ++i) {
+    OP_REQUIRES_OK(ctx, ReadColumnarFile(ctx->env(),
+                                         filenames_tensor->flat<tstring>()(i),
+                                         columns_, output_types_,
+                                         output_shapes_, &files[i]));
+  }
+  *output = new Dataset(ctx, std::move(files), batch_size, columns_,
+                        output_types_, output_shapes_);
+}
+
+namespace {
+
+REGISTER_KERNEL_BUILDER(Name("ColumnarBundleDataset").Device(DEVICE_CPU),
+                        ColumnarBundleDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,185 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/columnar_bundle_dataset_op.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kNodeName[] = "columnar_bundle_dataset";
+
+class ColumnarBundleDatasetParams : public DatasetParams {
+ public:
+  ColumnarBundleDatasetParams(std::vector<tstring> filenames,
+                              int64_t batch_size,
+                              std::vector<std::string> columns,
+                              DataTypeVector output_types,
+                              std::vector<PartialTensorShape> output_shapes,
+                              string node_name)
+      : DatasetParams(std::move(output_types), std::move(output_shapes),
+                      std::move(node_name)),
+        filenames_(std::move(filenames)),
+        batch_size_(batch_size),
+        columns_(std::move(columns)) {}
+
+  std::vector<Tensor> GetInputTensors() const override {
+    int num_files = filenames_.size();
+    return {CreateTensor<tstring>(TensorShape({num_files}), filenames_),
+            CreateTensor<int64_t>(TensorShape({}), {batch_size_})};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {ColumnarBundleDatasetOp::kFileNames,
+                    ColumnarBundleDatasetOp::kBatchSize};
+    return OkStatus();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {{ColumnarBundleDatasetOp::kColumns, columns_},
+                    {ColumnarBundleDatasetOp::kOutputTypes, output_dtypes_},
+                    {ColumnarBundleDatasetOp::kOutputShapes, output_shapes_},
+                    {"metadata", ""}};
+    return OkStatus();
+  }
+
+  string dataset_type() const override {
+    return ColumnarBundleDatasetOp::kDatasetType;
+  }
+
+ private:
+  std::vector<tstring> filenames_;
+  int64_t batch_size_;
+  std::vector<std::string> columns_;
+};
+
+class ColumnarBundleDatasetOpTest : public DatasetOpsTestBase {};
+
+Status WriteBundle(const std::string& prefix,
+                   const std::vector<std::pair<std::string, Tensor>>& columns) {
+  BundleWriter writer(Env::Default(), prefix);
+  for (const auto& column : columns) {
+    TF_RETURN_IF_ERROR(writer.Add(column.first, column.second));
+  }
+  return writer.Finish();
+}
+
+// Two bundles of 3 and 2 rows, read in batches of 2 rows. The `unused` column
+// is not projected.
+ColumnarBundleDatasetParams TwoBundlesParams() {
+  std::vector<tstring> filenames = {
+      io::JoinPath(testing::TmpDir(), "columnar_bundle_0"),
+      io::JoinPath(testing::TmpDir(), "columnar_bundle_1")};
+  Status status = WriteBundle(
+      filenames[0],
+      {{"id", CreateTensor<int64_t>(TensorShape({3}), {1, 2, 3})},
+       {"name", CreateTensor<tstring>(TensorShape({3}), {"a", "b", "c"})},
+       {"unused", CreateTensor<int32>(TensorShape({1}), {0})},
+       {"value",
+        CreateTensor<float>(TensorShape({3, 2}), {1, 2, 3, 4, 5, 6})}});
+  status.Update(WriteBundle(
+      filenames[1],
+      {{"id", CreateTensor<int64_t>(TensorShape({2}), {4, 5})},
+       {"name", CreateTensor<tstring>(TensorShape({2}), {"d", "e"})},
+       {"value", CreateTensor<float>(TensorShape({2, 2}), {7, 8, 9, 10})}}));
+  if (!status.ok()) {
+    VLOG(WARNING) << "Failed to create the test files: " << status;
+  }
+  return ColumnarBundleDatasetParams(
+      filenames, /*batch_size=*/2, /*columns=*/{"value", "id", "name"},
+      /*output_types=*/{DT_FLOAT, DT_INT64, DT_STRING},
+      /*output_shapes=*/
+      {PartialTensorShape({-1, 2}), PartialTensorShape({-1}),
+       PartialTensorShape({-1})},
+      kNodeName);
+}
+
+ColumnarBundleDatasetParams WrongTypeParams() {
+  std::vector<tstring> filenames = {
+      io::JoinPath(testing::TmpDir(), "columnar_bundle_wrong_type")};
+  Status status =
+      WriteBundle(filenames[0],
+                  {{"id", CreateTensor<int64_t>(TensorShape({3}), {1, 2, 3})}});
+  if (!status.ok()) {
+    VLOG(WARNING) << "Failed to create the test files: " << status;
+  }
+  return ColumnarBundleDatasetParams(
+      filenames, /*batch_size=*/2, /*columns=*/{"id"},
+      /*output_types=*/{DT_INT32}, /*output_shapes=*/{PartialTensorShape({-1})},
+      kNodeName);
+}
+
+std::vector<Tensor> TwoBundlesOutputs() {
+  return {CreateTensor<float>(TensorShape({2, 2}), {1, 2, 3, 4}),
+          CreateTensor<int64_t>(TensorShape({2}), {1, 2}),
+          CreateTensor<tstring>(TensorShape({2}), {"a", "b"}),
+          CreateTensor<float>(TensorShape({1, 2}), {5, 6}),
+          CreateTensor<int64_t>(TensorShape({1}), {3}),
+          CreateTensor<tstring>(TensorShape({1}), {"c"}),
+          CreateTensor<float>(TensorShape({2, 2}), {7, 8, 9, 10}),
+          CreateTensor<int64_t>(TensorShape({2}), {4, 5}),
+          CreateTensor<tstring>(TensorShape({2}), {"d", "e"})};
+}
+
+std::vector<GetNextTestCase<ColumnarBundleDatasetParams>> GetNextTestCases() {
+  return {{/*dataset_params=*/TwoBundlesParams(),
+           /*expected_outputs=*/TwoBundlesOutputs()}};
+}
+
+ITERATOR_GET_NEXT_TEST_P(ColumnarBundleDatasetOpTest,
+                         ColumnarBundleDatasetParams, GetNextTestCases())
+
+TEST_F(ColumnarBundleDatasetOpTest, DatasetTypeString) {
+  auto dataset_params = TwoBundlesParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetTypeString(
+      name_utils::OpName(ColumnarBundleDatasetOp::kDatasetType)));
+}
+
+TEST_F(ColumnarBundleDatasetOpTest, Cardinality) {
+  auto dataset_params = TwoBundlesParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetCardinality(3));
+}
+
+TEST_F(ColumnarBundleDatasetOpTest, WrongColumnType) {
+  auto dataset_params = WrongTypeParams();
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            tensorflow::error::INVALID_ARGUMENT);
+}
+
+std::vector<IteratorSaveAndRestoreTestCase<ColumnarBundleDatasetParams>>
+IteratorSaveAndRestoreTestCases() {
+  return {{/*dataset_params=*/TwoBundlesParams(),
+           /*breakpoints=*/{0, 1, 4},
+           /*expected_outputs=*/TwoBundlesOutputs()}};
+}
+
+ITERATOR_SAVE_AND_RESTORE_TEST_P(ColumnarBundleDatasetOpTest,
+                                 ColumnarBundleDatasetParams,
+                                 IteratorSaveAndRestoreTestCases())
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,288 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/global_shuffle_dataset_op.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/random_seed_ops.h"
+#include "tensorflow/core/kernels/random_index_shuffle.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// Constants declared in global_shuffle_dataset_op.h and used both here and in
+// test cases.
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kDatasetType;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kInputDataset;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kSeed;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kSeed2;
+/* static */ constexpr const char* const
+    GlobalShuffleDatasetOp::kReshuffleEachIteration;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kOutputTypes;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kOutputShapes;
+
+namespace {
+
+constexpr char kNextIndex[] = "next_index";
+constexpr char kIterationSeed[] = "iteration_seed";
+constexpr char kIterationSeed2[] = "iteration_seed2";
+
+// The number of rounds of the Feistel network used by `index_shuffle`, as
+// recommended by its documentation.
+constexpr int32_t kShuffleRounds = 8;
+
+// Returns the position of `index` in the permutation of [0, cardinality)
+// determined by `seed` and `seed2`.
+int64_t ShuffleIndex(int64_t index, int64_t seed, int64_t seed2,
+                     int64_t cardinality) {
+  const std::array<uint32_t, 3> key = {
+      static_cast<uint32_t>(seed), static_cast<uint32_t>(seed2),
+      static_cast<uint32_t>((seed >> 32) ^ (seed2 >> 32))};
+  return static_cast<int64_t>(random::index_shuffle(
+      static_cast<uint64_t>(index), key,
+      static_cast<uint64_t>(cardinality - 1), kShuffleRounds));
+}
+
+}  // namespace
+
+class GlobalShuffleDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, const DatasetBase* input, RandomSeeds&& seeds,
+          bool reshuffle_each_iteration)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        seeds_(std::move(seeds)),
+        reshuffle_each_iteration_(reshuffle_each_iteration) {
+    if (reshuffle_each_iteration_) {
+      seed_generator_ = std::make_unique<RandomSeedGenerator>(seeds_);
+    } else {
+      seed_generator_ = std::make_unique<FixedSeedGenerator>(seeds_);
+    }
+    input_->Ref();
+  }
+
+  ~Dataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return std::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return input_->output_shapes();
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.set_args(seeds_.seed(), seeds_.seed2());
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    return input_->Cardinality(options);
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return OkStatus();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+  // Returns the element at `index` of the permutation determined by the
+  // dataset seeds. Iterators that reshuffle each iteration use other seeds.
+  Status Get(OpKernelContext* ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
+    const int64_t cardinality = RandomAccessCardinality();
+    return input_->Get(
+        ctx, ShuffleIndex(index, seeds_.seed(), seeds_.seed2(), cardinality),
+        out_tensors);
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_graph_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+    Node* seed_node = nullptr;
+    Node* seed2_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(seeds_.input_seed(), &seed_node));
+    TF_RETURN_IF_ERROR(b->AddScalar(seeds_.input_seed2(), &seed2_node));
+    AttrValue reshuffle_each_iteration;
+    b->BuildAttrValue(reshuffle_each_iteration_, &reshuffle_each_iteration);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this, {input_graph_node, seed_node, seed2_node},  // Inputs
+        {std::make_pair(kReshuffleEachIteration,
+                        reshuffle_each_iteration)},  // Attrs
+        output));
+    return OkStatus();
+  }
+
+ private:
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params) {}
+
+    bool SymbolicCheckpointCompatible() const override { return true; }
+
+    Status Initialize(IteratorContext* ctx) override {
+      cardinality_ = dataset()->RandomAccessCardinality();
+      if (cardinality_ == kInfiniteCardinality ||
+          cardinality_ == kUnknownCardinality) {
+        return errors::FailedPrecondition(
+            "Global shuffling requires an input dataset with a known, finite "
+            "cardinality. Got ",
+            dataset()->input_->DebugString(), " with ",
+            cardinality_ == kInfiniteCardinality ? "infinite" : "unknown",
+            " cardinality.");
+      }
+      mutex_lock l(mu_);
+      dataset()->seed_generator_->GenerateSeeds(&seed_, &seed2_);
+      return OkStatus();
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      if (next_index_ >= cardinality_) {
+        *end_of_sequence = true;
+        return OkStatus();
+      }
+      // Random access takes an `OpKernelContext`, of which the datasets
+      // supporting it only use the function library and the runner.
+      OpKernelContext::Params params;
+      params.device = ctx->flr()->device();
+      params.function_library = ctx->flr();
+      params.runner = ctx->runner();
+      OpKernelContext op_ctx(&params, /*num_outputs=*/0);
+      Status s = dataset()->input_->Get(
+          &op_ctx, ShuffleIndex(next_index_, seed_, seed2_, cardinality_),
+          out_tensors);
+      if (errors::IsUnimplemented(s)) {
+        return errors::Unimplemented(
+            "Global shuffling requires an input dataset that supports random "
+            "access, but ",
+            dataset()->input_->DebugString(), " does not: ", s.error_message());
+      }
+      TF_RETURN_IF_ERROR(s);
+      ++next_index_;
+      *end_of_sequence = false;
+      return OkStatus();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeSourceNode(std::move(args));
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kNextIndex), next_index_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kIterationSeed), seed_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kIterationSeed2), seed2_));
+      return OkStatus();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kNextIndex), &next_index_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kIterationSeed), &seed_));
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kIterationSeed2), &seed2_));
+      return OkStatus();
+    }
+
+   private:
+    int64_t cardinality_ = 0;
+
+    mutex mu_;
+    // Position of the next element in the permutation of the input.
+    int64_t next_index_ TF_GUARDED_BY(mu_) = 0;
+    // Seeds determining the permutation of this iteration.
+    int64_t seed_ TF_GUARDED_BY(mu_) = 0;
+    int64_t seed2_ TF_GUARDED_BY(mu_) = 0;
+  };
+
+  // Returns the cardinality of the input, computed the same way as random
+  // access does.
+  int64_t RandomAccessCardinality() const {
+    CardinalityOptions options;
+    options.set_compute_level(CardinalityOptions::CARDINALITY_COMPUTE_MODERATE);
+    return Cardinality(options);
+  }
+
+  const DatasetBase* const input_;
+  const RandomSeeds seeds_;
+  const bool reshuffle_each_iteration_;
+  std::unique_ptr<SeedGenerator> seed_generator_;
+};
+
+GlobalShuffleDatasetOp::GlobalShuffleDatasetOp(OpKernelConstruction* ctx)
+    : UnaryDatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(
+      ctx, ctx->GetAttr(kReshuffleEachIteration, &reshuffle_each_iteration_));
+}
+
+void GlobalShuffleDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                         DatasetBase* input,
+                                         DatasetBase** output) {
+  int64_t seed;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kSeed, &seed));
+  int64_t seed2;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kSeed2, &seed2));
+  *output = new Dataset(ctx, input, RandomSeeds(seed, seed2),
+                        reshuffle_each_iteration_);
+}
+
+namespace {
+
+REGISTER_KERNEL_BUILDER(Name("GlobalShuffleDataset").Device(DEVICE_CPU),
+                        GlobalShuffleDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
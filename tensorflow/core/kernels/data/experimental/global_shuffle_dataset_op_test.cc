@@ -0,0 +1,210 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/global_shuffle_dataset_op.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kNodeName[] = "global_shuffle_dataset";
+
+class GlobalShuffleDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  GlobalShuffleDatasetParams(T input_dataset_params, int64_t seed,
+                             int64_t seed2, bool reshuffle_each_iteration,
+                             DataTypeVector output_dtypes,
+                             std::vector<PartialTensorShape> output_shapes,
+                             string node_name)
+      : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
+                      std::move(node_name)),
+        seed_(seed),
+        seed2_(seed2),
+        reshuffle_each_iteration_(reshuffle_each_iteration) {
+    input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
+    iterator_prefix_ =
+        name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
+                                   input_dataset_params.iterator_prefix());
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    return {CreateTensor<int64_t>(TensorShape({}), {seed_}),
+            CreateTensor<int64_t>(TensorShape({}), {seed2_})};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {GlobalShuffleDatasetOp::kInputDataset,
+                    GlobalShuffleDatasetOp::kSeed,
+                    GlobalShuffleDatasetOp::kSeed2};
+    return OkStatus();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {{GlobalShuffleDatasetOp::kReshuffleEachIteration,
+                     reshuffle_each_iteration_},
+                    {GlobalShuffleDatasetOp::kOutputTypes, output_dtypes_},
+                    {GlobalShuffleDatasetOp::kOutputShapes, output_shapes_},
+                    {"metadata", ""}};
+    return OkStatus();
+  }
+
+  string dataset_type() const override {
+    return GlobalShuffleDatasetOp::kDatasetType;
+  }
+
+ private:
+  int64_t seed_;
+  int64_t seed2_;
+  bool reshuffle_each_iteration_;
+};
+
+class GlobalShuffleDatasetOpTest : public DatasetOpsTestBase {
+ protected:
+  // Reads all the elements from `iterator` as integers.
+  StatusOr<std::vector<int64_t>> GetAll(IteratorBase* iterator) {
+    std::vector<int64_t> result;
+    bool end_of_sequence = false;
+    while (true) {
+      std::vector<Tensor> out_tensors;
+      TF_RETURN_IF_ERROR(iterator->GetNext(iterator_ctx_.get(), &out_tensors,
+                                           &end_of_sequence));
+      if (end_of_sequence) {
+        return result;
+      }
+      result.push_back(out_tensors[0].scalar<int64_t>()());
+    }
+  }
+};
+
+GlobalShuffleDatasetParams ShuffleRangeParams(bool reshuffle_each_iteration) {
+  return GlobalShuffleDatasetParams(
+      /*input_dataset_params=*/RangeDatasetParams(0, 100, 1),
+      /*seed=*/42,
+      /*seed2=*/7,
+      /*reshuffle_each_iteration=*/reshuffle_each_iteration,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({})},
+      /*node_name=*/kNodeName);
+}
+
+std::vector<int64_t> Range(int64_t n) {
+  std::vector<int64_t> range(n);
+  for (int64_t i = 0; i < n; ++i) {
+    range[i] = i;
+  }
+  return range;
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, ProducesPermutation) {
+  auto dataset_params = ShuffleRangeParams(/*reshuffle_each_iteration=*/false);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> elements,
+                          GetAll(iterator_.get()));
+  EXPECT_NE(elements, Range(100));
+  std::sort(elements.begin(), elements.end());
+  EXPECT_EQ(elements, Range(100));
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, FixedSeedsRepeatPermutation) {
+  auto dataset_params = ShuffleRangeParams(/*reshuffle_each_iteration=*/false);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> first, GetAll(iterator_.get()));
+
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator));
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> second,
+                          GetAll(iterator.get()));
+  EXPECT_EQ(first, second);
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, ReshuffleEachIteration) {
+  auto dataset_params = ShuffleRangeParams(/*reshuffle_each_iteration=*/true);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> first, GetAll(iterator_.get()));
+
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator));
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> second,
+                          GetAll(iterator.get()));
+  EXPECT_NE(first, second);
+  std::sort(second.begin(), second.end());
+  EXPECT_EQ(second, Range(100));
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, RandomAccess) {
+  auto dataset_params = ShuffleRangeParams(/*reshuffle_each_iteration=*/false);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> elements,
+                          GetAll(iterator_.get()));
+  for (int64_t i = 0; i < 100; ++i) {
+    std::vector<Tensor> out_tensors;
+    TF_ASSERT_OK(dataset_->Get(dataset_ctx_.get(), i, &out_tensors));
+    EXPECT_EQ(out_tensors[0].scalar<int64_t>()(), elements[i]);
+  }
+  std::vector<Tensor> out_tensors;
+  EXPECT_TRUE(errors::IsOutOfRange(
+      dataset_->Get(dataset_ctx_.get(), /*index=*/100, &out_tensors)));
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, SaveAndRestore) {
+  auto dataset_params = ShuffleRangeParams(/*reshuffle_each_iteration=*/true);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  for (int i = 0; i < 30; ++i) {
+    std::vector<Tensor> out_tensors;
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+  }
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> remaining,
+                          GetAll(iterator_.get()));
+  EXPECT_EQ(remaining.size(), 70);
+
+  // The restored iterator continues the permutation of the saved one, even
+  // though a new iterator would be given another permutation.
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                               dataset_params.iterator_prefix(), *dataset_,
+                               &iterator));
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> restored_remaining,
+                          GetAll(iterator.get()));
+  EXPECT_EQ(restored_remaining, remaining);
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -69,6 +69,11 @@ class PrefetchAutotuner {
   // Tells the autotuner that the buffer is empty. This may trigger the
   // autotuner to increase its buffer limit.
   void RecordEmpty() { RecordConsumption(0, port::GetMemoryInfo().free); }
+  // Same as above, but bounds the buffer limit by `free_memory_bytes` rather
+  // than the free host memory, e.g. when the buffer resides in device memory.
+  void RecordEmpty(std::optional<int64_t> free_memory_bytes) {
+    RecordConsumption(0, free_memory_bytes);
+  }
 
  private:
   // PrefetchAutotuner operates as a state machine.
@@ -138,6 +138,21 @@ TEST(PrefetchAutotunerTest, MemoryConsumption) {
   EXPECT_EQ(16, t.buffer_limit());
 }
 
+TEST(PrefetchAutotunerTest, RecordEmptyWithFreeMemory) {
+  PrefetchAutotuner t(model::kAutotune, 0);
+  t.RecordElementSize(10);
+  t.RecordConsumption(1);
+  t.RecordEmpty(/*free_memory_bytes=*/40);  // Expect buffer limit to increase.
+  EXPECT_EQ(2, t.buffer_limit());
+  t.RecordConsumption(2);
+  t.RecordEmpty(/*free_memory_bytes=*/40);  // Expect buffer limit to increase.
+  EXPECT_EQ(4, t.buffer_limit());
+  t.RecordConsumption(4);
+  t.RecordEmpty(/*free_memory_bytes=*/40);  // Expect buffer limit to stay the
+                                            // same. No memory left.
+  EXPECT_EQ(4, t.buffer_limit());
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -17,11 +17,13 @@ limitations under the License.
 #include <algorithm>
 #include <deque>
 #include <limits>
+#include <optional>
 
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/stats_utils.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/device.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -60,6 +62,16 @@ constexpr char kSizeSuffix[] = ".size";
 constexpr char kCodeSuffix[] = ".code";
 constexpr char kErrorMessageSuffix[] = ".error_message";
 
+// Returns the number of bytes `allocator` can still allocate, or std::nullopt
+// if the allocator does not track its limit.
+std::optional<int64_t> FreeAllocatorBytes(Allocator* allocator) {
+  std::optional<AllocatorStats> stats = allocator->GetStats();
+  if (!stats.has_value() || !stats->bytes_limit.has_value()) {
+    return std::nullopt;
+  }
+  return std::max(int64_t{0}, *stats->bytes_limit - stats->bytes_in_use);
+}
+
 }  // namespace
 
 class PrefetchDatasetOp::Dataset : public DatasetBase {
@@ -172,6 +184,13 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       if (buffer_size_->value == model::kAutotune) {
         buffer_size_->value = buffer_size_min_;
       }
+      // When the prefetch runs on an accelerator, e.g. as part of
+      // `prefetch_to_device`, the buffered elements reside in device memory,
+      // so the buffer is sized against the memory left on the device.
+      Device* device = ctx->flr() != nullptr ? ctx->flr()->device() : nullptr;
+      if (device != nullptr && device->device_type() != DEVICE_CPU) {
+        device_allocator_ = device->GetAllocator(AllocatorAttributes());
+      }
       cancellation_manager_ = std::make_unique<CancellationManager>();
       TF_RETURN_IF_ERROR(RegisterCancellationCallback(
           ctx->cancellation_manager(), [this]() { CancelThreads(); },
@@ -197,7 +216,11 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         while (buffer_.empty() && !prefetch_thread_finished_ &&
                buffer_limit() != 0) {
           if (legacy_autotune_) {
-            auto_tuner_.RecordEmpty();
+            if (device_allocator_ != nullptr) {
+              auto_tuner_.RecordEmpty(FreeAllocatorBytes(device_allocator_));
+            } else {
+              auto_tuner_.RecordEmpty();
+            }
             buffer_size_->value = auto_tuner_.buffer_limit();
           }
           RecordStop(ctx);
@@ -596,6 +619,9 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     const std::shared_ptr<condition_variable> cond_var_;
     const int64_t buffer_size_min_;
     PrefetchAutotuner auto_tuner_ TF_GUARDED_BY(*mu_);
+    // Allocator of the device holding the buffered elements, if they are not
+    // held in host memory.
+    Allocator* device_allocator_ = nullptr;
     std::deque<BufferElement> buffer_ TF_GUARDED_BY(*mu_);
     bool cancelled_ TF_GUARDED_BY(*mu_) = false;
     bool prefetch_thread_finished_ TF_GUARDED_BY(*mu_) = false;
@@ -32,10 +32,12 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/random_seed_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/stringprintf.h"
 
 namespace tensorflow {
@@ -61,6 +63,8 @@ namespace data {
 
 const int64_t kLogIntervalMicros = 10 * 1000000;  // 10 seconds.
 const int64_t kMaxEpochsInBuffer = 3;
+// Maximum number of input elements read ahead by the background fill thread.
+const int64_t kMaxStagedElements = 256;
 
 constexpr char kNumRandomSamples[] = "num_random_samples";
 constexpr char kDataProduced[] = "data_produced";
@@ -72,6 +76,11 @@ constexpr char kSlicesStart[] = "slices_start";
 constexpr char kSlicesEnd[] = "slices_end";
 constexpr char kSeedGenerator[] = "SeedGenerator";
 constexpr char kEpochNumRandomSamples[] = "epoch_num_random_samples";
+constexpr char kStagedElements[] = "::staged_elements";
+constexpr char kStagedEndOfSequence[] = "staged_end_of_sequence";
+constexpr char kFillErrorCode[] = "fill_error_code";
+constexpr char kFillErrorMessage[] = "fill_error_message";
+constexpr char kShuffleBackgroundFill[] = "shuffle_background_fill";
 constexpr char kShuffleDatasetV1[] = "ShuffleDataset";
 constexpr char kShuffleDatasetV2[] = "ShuffleDatasetV2";
 constexpr char kShuffleDatasetV3[] = "ShuffleDatasetV3";
@@ -93,6 +102,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         buffer_size_(buffer_size),
         seed_generator_(std::move(seed_generator)),
         count_(count),
+        background_fill_(GetExperiments().contains(kShuffleBackgroundFill)),
         traceme_metadata_(
             {{"buffer_size",
               strings::Printf("%lld", static_cast<long long>(buffer_size))}}) {
@@ -202,10 +212,20 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           params.dataset->buffer_size_);
     }
 
+    ~Iterator() override {
+      CancelThreads();
+      if (deregister_fn_) deregister_fn_();
+    }
+
     Status Initialize(IteratorContext* ctx) override {
       mutex_lock l(mu_);
       seed_generator_->GenerateSeeds(&seed_, &seed2_);
       ResetRngs();
+      if (dataset()->background_fill_) {
+        TF_RETURN_IF_ERROR(RegisterCancellationCallback(
+            ctx->cancellation_manager(), [this]() { CancelThreads(); },
+            &deregister_fn_));
+      }
       return OkStatus();
     }
 
@@ -255,6 +275,16 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     Status SaveInternal(SerializationContext* ctx,
                         IteratorStateWriter* writer) override {
       mutex_lock l(mu_);
+      // Wait for an in-flight read of the fill thread so that the input
+      // iterator state is consistent with the staged elements. The fill
+      // thread starts no further read until the checkpoint is written, so
+      // this waits for one read at most.
+      num_pending_checkpoints_++;
+      auto cleanup = gtl::MakeCleanup(
+          [this]() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+            num_pending_checkpoints_--;
+          });
+      mu_.Await(Condition(this, &Iterator::NoFetchInFlight));
       // Save state needed to restore the random number generators.
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(full_name(kEpochNumRandomSamples),
@@ -272,6 +302,31 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       } else {
         TF_RETURN_IF_ERROR(this->SaveInput(ctx, writer, input_impl_));
       }
+      if (!staged_.empty()) {
+        // Elements read ahead by the fill thread have already been consumed
+        // from the input iterator, so they are saved alongside its state.
+        std::vector<std::vector<Tensor>> staged_values;
+        for (const StagedElement& element : staged_) {
+          if (!element.end_of_sequence) {
+            staged_values.push_back(element.value);
+          }
+        }
+        TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+            writer, absl::StrCat(prefix(), kStagedElements), staged_values));
+        // The end of the input is staged last.
+        if (staged_.back().end_of_sequence) {
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(this->full_name(kStagedEndOfSequence), ""));
+        }
+      }
+      if (!fill_status_.ok()) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(this->full_name(kFillErrorCode),
+                                static_cast<int64_t>(fill_status_.code())));
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(this->full_name(kFillErrorMessage),
+                                fill_status_.error_message()));
+      }
 
       // Save the epoch counter, buffer, and buffer slices.
       TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kEpoch), epoch_));
@@ -300,6 +355,15 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     Status RestoreInternal(IteratorContext* ctx,
                            IteratorStateReader* reader) override {
       mutex_lock l(mu_);
+      num_pending_checkpoints_++;
+      auto cleanup = gtl::MakeCleanup(
+          [this]() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+            num_pending_checkpoints_--;
+          });
+      mu_.Await(Condition(this, &Iterator::NoFetchInFlight));
+      staged_.clear();
+      input_exhausted_ = false;
+      fill_status_ = OkStatus();
       // Restore the random number generators.
       int64_t num_random_samples;
       TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kEpochNumRandomSamples),
@@ -320,6 +384,32 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       } else {
         input_impl_.reset();
       }
+      const std::string staged_prefix = absl::StrCat(prefix(), kStagedElements);
+      if (reader->Contains(staged_prefix, kNumElements)) {
+        std::vector<std::vector<Tensor>> staged_values;
+        TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(ctx, reader, staged_prefix,
+                                                      &staged_values));
+        for (auto& value : staged_values) {
+          StagedElement element;
+          element.value = std::move(value);
+          staged_.push_back(std::move(element));
+        }
+      }
+      if (reader->Contains(this->full_name(kStagedEndOfSequence))) {
+        StagedElement element;
+        element.end_of_sequence = true;
+        staged_.push_back(std::move(element));
+        input_exhausted_ = true;
+      }
+      if (reader->Contains(this->full_name(kFillErrorCode))) {
+        int64_t code;
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(this->full_name(kFillErrorCode), &code));
+        tstring error_message;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            this->full_name(kFillErrorMessage), &error_message));
+        fill_status_ = Status(static_cast<error::Code>(code), error_message);
+      }
 
       // Restore the epoch counter, buffer, and buffer slices.
       TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kEpoch), &epoch_));
@@ -374,6 +464,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       int64_t end;
     };
 
+    // An input element read ahead by the background fill thread.
+    struct StagedElement {
+      std::vector<Tensor> value;
+      bool end_of_sequence = false;
+    };
+
     random::SingleSampleAdapter<random::PhiloxRandom>::ResultType Random()
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       num_random_samples_++;
@@ -398,7 +494,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         std::vector<Tensor> input_element;
         bool end_of_input_sequence = false;
         TF_RETURN_IF_ERROR(
-            input_impl_->GetNext(ctx, &input_element, &end_of_input_sequence));
+            GetNextFromInput(ctx, &input_element, &end_of_input_sequence));
         if (!end_of_input_sequence) {
           AddToShuffleBuffer(ctx, std::move(input_element));
           continue;
@@ -448,10 +544,101 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       }
       TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
           ctx, this, this->prefix(), &input_impl_));
+      input_exhausted_ = false;
       epoch_++;
       return OkStatus();
     }
 
+    // Reads the next element of `input_impl_`. With background fill enabled,
+    // the element is taken from the elements staged by the fill thread. Since
+    // staged elements are consumed in input order, the output sequence is the
+    // same as when reading the input directly.
+    Status GetNextFromInput(IteratorContext* ctx, std::vector<Tensor>* element,
+                            bool* end_of_sequence)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!dataset()->background_fill_) {
+        return input_impl_->GetNext(ctx, element, end_of_sequence);
+      }
+      if (!fill_thread_) {
+        auto new_ctx = std::make_shared<IteratorContext>(*ctx);
+        fill_thread_ = ctx->StartThread(
+            "tf_data_shuffle_fill", [this, new_ctx]() { FillThread(new_ctx); });
+      }
+      mu_.Await(Condition(this, &Iterator::StagedElementAvailable));
+      if (cancelled_) {
+        return errors::Cancelled("Iterator was cancelled");
+      }
+      // The elements read before an input error are returned first. Reading
+      // resumes once the error is returned, as when reading the input
+      // directly.
+      if (staged_.empty()) {
+        Status status = fill_status_;
+        fill_status_ = OkStatus();
+        return status;
+      }
+      StagedElement staged = std::move(staged_.front());
+      staged_.pop_front();
+      *element = std::move(staged.value);
+      *end_of_sequence = staged.end_of_sequence;
+      return OkStatus();
+    }
+
+    // Reads ahead from the input iterator of the current epoch. The thread
+    // stops reading at the end of the input until the next epoch's iterator
+    // is created by `PrepareNextEpoch`, and at an input error until the error
+    // is returned by `GetNextFromInput`.
+    void FillThread(const std::shared_ptr<IteratorContext>& ctx) {
+      RecordStart(ctx.get());
+      auto cleanup = gtl::MakeCleanup([this, ctx] { RecordStop(ctx.get()); });
+      while (true) {
+        IteratorBase* input;
+        {
+          mutex_lock l(mu_);
+          RecordStop(ctx.get());
+          mu_.Await(Condition(this, &Iterator::ShouldFetch));
+          RecordStart(ctx.get());
+          if (cancelled_) {
+            return;
+          }
+          fetch_in_flight_ = true;
+          input = input_impl_.get();
+        }
+        StagedElement element;
+        Status status =
+            input->GetNext(ctx.get(), &element.value, &element.end_of_sequence);
+        mutex_lock l(mu_);
+        fetch_in_flight_ = false;
+        if (!status.ok()) {
+          fill_status_ = status;
+          continue;
+        }
+        if (element.end_of_sequence) {
+          input_exhausted_ = true;
+        }
+        staged_.push_back(std::move(element));
+      }
+    }
+
+    void CancelThreads() TF_LOCKS_EXCLUDED(mu_) {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+    }
+
+    bool NoFetchInFlight() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return !fetch_in_flight_;
+    }
+
+    bool ShouldFetch() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return cancelled_ ||
+             (input_impl_ != nullptr && !input_exhausted_ &&
+              fill_status_.ok() && staged_.size() < kMaxStagedElements &&
+              num_pending_checkpoints_ == 0);
+    }
+
+    bool StagedElementAvailable() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return cancelled_ || !staged_.empty() || !fill_status_.ok();
+    }
+
     void AddToShuffleBuffer(IteratorContext* ctx, std::vector<Tensor>&& element)
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       data_produced_ = true;
@@ -500,6 +687,23 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         TF_GUARDED_BY(mu_);
     int64_t num_random_samples_ TF_GUARDED_BY(mu_) = 0;
     bool data_produced_ TF_GUARDED_BY(mu_) = false;
+    // Input elements read ahead by `fill_thread_`, in input order.
+    std::deque<StagedElement> staged_ TF_GUARDED_BY(mu_);
+    // Whether `fill_thread_` has reached the end of `input_impl_`.
+    bool input_exhausted_ TF_GUARDED_BY(mu_) = false;
+    // The error of `input_impl_` read by `fill_thread_`, returned once the
+    // elements staged before it are consumed. No further elements are read
+    // until then.
+    Status fill_status_ TF_GUARDED_BY(mu_);
+    // Whether `fill_thread_` is reading from `input_impl_` without holding
+    // `mu_`. While set, `input_impl_` must not be modified or saved.
+    bool fetch_in_flight_ TF_GUARDED_BY(mu_) = false;
+    // The number of saves and restores waiting for `fetch_in_flight_` to be
+    // cleared. `fill_thread_` starts no read while positive.
+    int64_t num_pending_checkpoints_ TF_GUARDED_BY(mu_) = 0;
+    bool cancelled_ TF_GUARDED_BY(mu_) = false;
+    std::function<void()> deregister_fn_;
+    std::unique_ptr<Thread> fill_thread_ TF_GUARDED_BY(mu_);
   };
 
   const DatasetBase* const input_;
@@ -509,6 +713,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   // fuse shuffle and repeat together, and make the shuffle dataset op
   // responsible for repeating as well.
   const int64_t count_;
+  // If true, a background thread reads ahead from the input while shuffled
+  // elements are consumed, overlapping buffer refills with downstream work.
+  const bool background_fill_;
   const TraceMeMetadata traceme_metadata_;
   mutable mutex mu_;
   mutable std::vector<std::int64_t> shuffled_indices_ TF_GUARDED_BY(mu_);
@@ -514,9 +514,12 @@ IteratorSaveAndRestoreTestCases() {
 class ParameterizedIteratorSaveAndRestoreTest
     : public ShuffleDatasetOpTest,
       public ::testing::WithParamInterface<
-          IteratorSaveAndRestoreTestCase<ShuffleDatasetParams>> {};
+          IteratorSaveAndRestoreTestCase<ShuffleDatasetParams>> {
+ protected:
+  void CheckIteratorSaveAndRestore();
+};
 
-TEST_P(ParameterizedIteratorSaveAndRestoreTest, IteratorSaveAndRestore) {
+void ParameterizedIteratorSaveAndRestoreTest::CheckIteratorSaveAndRestore() {
   auto test_case = GetParam();
   TF_ASSERT_OK(Initialize(test_case.dataset_params));
 
@@ -550,10 +553,42 @@ TEST_P(ParameterizedIteratorSaveAndRestoreTest, IteratorSaveAndRestore) {
                            /*compare_order=*/true));
 }
 
+TEST_P(ParameterizedIteratorSaveAndRestoreTest, IteratorSaveAndRestore) {
+  CheckIteratorSaveAndRestore();
+}
+
 INSTANTIATE_TEST_CASE_P(ShuffleDatasetOpTest,
                         ParameterizedIteratorSaveAndRestoreTest,
                         ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
 
+// Runs the save and restore tests with the background fill thread, which
+// reads ahead, possibly to the end of the input, while the iterator is saved.
+class ParameterizedBackgroundFillSaveAndRestoreTest
+    : public ParameterizedIteratorSaveAndRestoreTest {
+ protected:
+  void SetUp() override {
+    setenv("TF_JOB_NAME", "test_job", /*overwrite=*/1);
+    setenv("TF_TASK_ID", "0", /*overwrite=*/1);
+    setenv("TF_DATA_EXPERIMENT_OPT_IN", "shuffle_background_fill",
+           /*overwrite=*/1);
+  }
+
+  void TearDown() override {
+    unsetenv("TF_JOB_NAME");
+    unsetenv("TF_TASK_ID");
+    unsetenv("TF_DATA_EXPERIMENT_OPT_IN");
+  }
+};
+
+TEST_P(ParameterizedBackgroundFillSaveAndRestoreTest, IteratorSaveAndRestore) {
+  ASSERT_TRUE(GetExperiments().contains("shuffle_background_fill"));
+  CheckIteratorSaveAndRestore();
+}
+
+INSTANTIATE_TEST_CASE_P(ShuffleDatasetOpTest,
+                        ParameterizedBackgroundFillSaveAndRestoreTest,
+                        ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
+
 TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   std::vector<ShuffleDatasetParams> dataset_params_vec(
       {ShuffleDatasetParamsWithInvalidBufferSize(),
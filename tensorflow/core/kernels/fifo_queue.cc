@@ -51,6 +51,28 @@ void FIFOQueue::DequeueLocked(OpKernelContext* ctx, Tuple* tuple) {
 void FIFOQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
                            DoneCallback callback) {
   CancellationManager* cm = ctx->cancellation_manager();
+  // Enqueue right away if there is room and no earlier enqueue is waiting,
+  // without registering an attempt and a cancellation callback for it.
+  bool enqueued = false;
+  bool has_dequeue_attempts = false;
+  {
+    mutex_lock l(mu_);
+    if (!closed_ && enqueue_attempts_.empty() && !cm->IsCancelled() &&
+        queues_[0].size() < static_cast<size_t>(capacity_)) {
+      for (int i = 0; i < num_components(); ++i) {
+        queues_[i].push_back(tuple[i]);
+      }
+      enqueued = true;
+      has_dequeue_attempts = !dequeue_attempts_.empty();
+    }
+  }
+  if (enqueued) {
+    // Let the waiting dequeues take the new element.
+    if (has_dequeue_attempts) FlushUnlocked();
+    callback();
+    return;
+  }
+
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
   {
@@ -154,6 +176,25 @@ void FIFOQueue::TryEnqueueMany(const Tuple& tuple, OpKernelContext* ctx,
 
 void FIFOQueue::TryDequeue(OpKernelContext* ctx, CallbackWithTuple callback) {
   CancellationManager* cm = ctx->cancellation_manager();
+  // Dequeue right away if the queue isn't empty and no earlier dequeue is
+  // waiting, as in TryEnqueue().
+  Tuple tuple;
+  bool has_enqueue_attempts = false;
+  {
+    mutex_lock l(mu_);
+    if (dequeue_attempts_.empty() && !cm->IsCancelled() &&
+        !queues_[0].empty()) {
+      DequeueLocked(ctx, &tuple);
+      has_enqueue_attempts = !enqueue_attempts_.empty();
+    }
+  }
+  if (!tuple.empty()) {
+    // Let the waiting enqueues take the freed slot.
+    if (has_enqueue_attempts) FlushUnlocked();
+    callback(tuple);
+    return;
+  }
+
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
   {
@@ -245,6 +286,65 @@ void FIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
   }
 
   CancellationManager* cm = ctx->cancellation_manager();
+  // Dequeue right away if the queue has enough elements and no earlier
+  // dequeue is waiting, as in TryDequeue(). The batch is allocated before
+  // dequeuing, so that the elements stay in the queue if that fails, and the
+  // elements are copied into it after releasing the lock.
+  auto can_dequeue_now = [this, cm, num_elements]()
+                             TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return dequeue_attempts_.empty() && !cm->IsCancelled() &&
+           queues_[0].size() >= static_cast<size_t>(num_elements);
+  };
+  bool try_dequeue_now;
+  {
+    mutex_lock l(mu_);
+    try_dequeue_now = can_dequeue_now();
+  }
+  if (try_dequeue_now) {
+    Tuple tuple;
+    tuple.reserve(num_components());
+    for (int i = 0; i < num_components(); ++i) {
+      Tensor batch;
+      Status status = ctx->allocate_temp(
+          component_dtypes_[i], ManyOutShape(i, num_elements), &batch);
+      if (!status.ok()) {
+        ctx->SetStatus(status);
+        callback(Tuple());
+        return;
+      }
+      tuple.emplace_back(std::move(batch));
+    }
+    std::vector<Tuple> elements;
+    bool has_enqueue_attempts = false;
+    {
+      mutex_lock l(mu_);
+      // Another dequeue may have taken the elements in the meantime.
+      if (can_dequeue_now()) {
+        elements.resize(num_elements);
+        for (Tuple& element : elements) {
+          DequeueLocked(ctx, &element);
+        }
+        has_enqueue_attempts = !enqueue_attempts_.empty();
+      }
+    }
+    if (!elements.empty()) {
+      if (has_enqueue_attempts) FlushUnlocked();
+      for (int i = 0; i < num_components(); ++i) {
+        for (int64_t index = 0; index < num_elements; ++index) {
+          Status status = batch_util::CopyElementToSlice(
+              std::move(elements[index][i]), &tuple[i], index);
+          if (!status.ok()) {
+            ctx->SetStatus(status);
+            callback(Tuple());
+            return;
+          }
+        }
+      }
+      callback(tuple);
+      return;
+    }
+  }
+
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
   {
@@ -0,0 +1,161 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/fifo_queue.h"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+// An allocator that fails every allocation.
+class NoMemoryAllocator : public Allocator {
+ public:
+  string Name() override { return "no_memory"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    return nullptr;
+  }
+  void DeallocateRaw(void* ptr) override {}
+};
+
+// A CPU device whose allocations can be made to fail.
+class TestDevice : public DeviceBase {
+ public:
+  TestDevice() : DeviceBase(Env::Default()) {}
+
+  Allocator* GetAllocator(AllocatorAttributes) override {
+    return fail_allocations_ ? &no_memory_allocator_ : cpu_allocator();
+  }
+
+  void set_fail_allocations(bool fail) { fail_allocations_ = fail; }
+
+ private:
+  NoMemoryAllocator no_memory_allocator_;
+  bool fail_allocations_ = false;
+};
+
+class FIFOQueueTest : public ::testing::Test {
+ protected:
+  FIFOQueueTest()
+      : queue_(new FIFOQueue(/*capacity=*/10, {DT_INT32}, {TensorShape({})},
+                             "test_queue")) {
+    TF_CHECK_OK(queue_->Initialize());
+    NodeDef node_def;
+    TF_CHECK_OK(NodeDefBuilder("op", "NoOp").Finalize(&node_def));
+    Status status;
+    kernel_ = CreateOpKernel(DEVICE_CPU, &device_, cpu_allocator(), node_def,
+                             TF_GRAPH_DEF_VERSION, &status);
+    TF_CHECK_OK(status);
+    params_.device = &device_;
+    params_.op_kernel = kernel_.get();
+    params_.cancellation_manager = &cancellation_manager_;
+  }
+
+  ~FIFOQueueTest() override { queue_->Unref(); }
+
+  Status Enqueue(int32_t value) {
+    OpKernelContext ctx(&params_);
+    queue_->TryEnqueue({test::AsScalar<int32>(value)}, &ctx, []() {});
+    return ctx.status();
+  }
+
+  // Dequeues `num_elements`. Returns the batch if the dequeue finished, or
+  // nullopt if it waits for elements.
+  std::optional<Tensor> DequeueMany(int num_elements, Status* status) {
+    OpKernelContext ctx(&params_);
+    std::optional<Tensor> batch;
+    queue_->TryDequeueMany(num_elements, &ctx, /*allow_small_batch=*/false,
+                           [&batch](const QueueInterface::Tuple& tuple) {
+                             batch = tuple.empty() ? Tensor() : tuple[0];
+                           });
+    *status = ctx.status();
+    return batch;
+  }
+
+  TestDevice device_;
+  std::unique_ptr<OpKernel> kernel_;
+  CancellationManager cancellation_manager_;
+  OpKernelContext::Params params_;
+  FIFOQueue* queue_;
+};
+
+TEST_F(FIFOQueueTest, DequeueManyAvailableElements) {
+  for (int i = 0; i < 5; ++i) TF_ASSERT_OK(Enqueue(i));
+
+  Status status;
+  std::optional<Tensor> batch = DequeueMany(3, &status);
+  TF_ASSERT_OK(status);
+  ASSERT_TRUE(batch.has_value());
+  test::ExpectTensorEqual<int32>(*batch, test::AsTensor<int32>({0, 1, 2}));
+  EXPECT_EQ(queue_->size(), 2);
+
+  batch = DequeueMany(2, &status);
+  TF_ASSERT_OK(status);
+  ASSERT_TRUE(batch.has_value());
+  test::ExpectTensorEqual<int32>(*batch, test::AsTensor<int32>({3, 4}));
+  EXPECT_EQ(queue_->size(), 0);
+}
+
+TEST_F(FIFOQueueTest, DequeueManyKeepsElementsIfAllocationFails) {
+  for (int i = 0; i < 3; ++i) TF_ASSERT_OK(Enqueue(i));
+
+  device_.set_fail_allocations(true);
+  Status status;
+  std::optional<Tensor> batch = DequeueMany(2, &status);
+  EXPECT_TRUE(errors::IsResourceExhausted(status)) << status;
+  EXPECT_EQ(queue_->size(), 3);
+
+  device_.set_fail_allocations(false);
+  batch = DequeueMany(2, &status);
+  TF_ASSERT_OK(status);
+  ASSERT_TRUE(batch.has_value());
+  test::ExpectTensorEqual<int32>(*batch, test::AsTensor<int32>({0, 1}));
+  EXPECT_EQ(queue_->size(), 1);
+}
+
+TEST_F(FIFOQueueTest, DequeueManyWaitsForElements) {
+  TF_ASSERT_OK(Enqueue(0));
+
+  OpKernelContext ctx(&params_);
+  std::optional<Tensor> batch;
+  queue_->TryDequeueMany(2, &ctx, /*allow_small_batch=*/false,
+                         [&batch](const QueueInterface::Tuple& tuple) {
+                           batch = tuple.empty() ? Tensor() : tuple[0];
+                         });
+  EXPECT_FALSE(batch.has_value());
+
+  TF_ASSERT_OK(Enqueue(1));
+  TF_ASSERT_OK(ctx.status());
+  ASSERT_TRUE(batch.has_value());
+  test::ExpectTensorEqual<int32>(*batch, test::AsTensor<int32>({0, 1}));
+  EXPECT_EQ(queue_->size(), 0);
+}
+
+}  // namespace
+}  // namespace tensorflow
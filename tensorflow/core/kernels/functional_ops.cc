@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
@@ -44,13 +45,19 @@ Status Instantiate(FunctionLibraryRuntime* lib, const NameAttrList& func,
 }
 
 Status Instantiate(OpKernelContext* ctx, const NameAttrList& func,
-                   FunctionLibraryRuntime::Handle* handle) {
+                   FunctionLibraryRuntime::Handle* handle,
+                   const string& executor_type) {
   FunctionLibraryRuntime::InstantiateOptions opts;
-  opts.executor_type = ctx->executor_type();
+  opts.executor_type = executor_type;
   return ctx->function_library()->Instantiate(
       func.name(), AttrSlice(&func.attr()), opts, handle);
 }
 
+Status Instantiate(OpKernelContext* ctx, const NameAttrList& func,
+                   FunctionLibraryRuntime::Handle* handle) {
+  return Instantiate(ctx, func, handle, ctx->executor_type());
+}
+
 // If "t" is a scalar of a supported type, returns t != 0 in "*v".
 Status ToBool(gtl::ArraySlice<Tensor> t, bool* v) {
   if (t.size() != 1) {
@@ -359,12 +366,21 @@ class WhileOp : public AsyncOpKernel {
   explicit WhileOp(OpKernelConstruction* ctx) : AsyncOpKernel(ctx) {
     OP_REQUIRES_OK(ctx, ctx->GetAttr("cond", &cond_func_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("body", &body_func_));
+    // Set by LowerFunctionalOpsPass on the loops it doesn't lower because
+    // their cond and body are small, see
+    // LowerFunctionalOpsConstants::kSmallLoopAttr. On CPU, these run as a
+    // tight synchronous loop over their functions on the single-threaded
+    // executor, which avoids the per-iteration cost of the default executor.
+    bool small_loop = false;
+    if (TryGetNodeAttr(ctx->def(), "_small_loop", &small_loop)) {
+      small_loop_ = small_loop && ctx->device_type() == DEVICE_CPU;
+    }
   }
 
   ~WhileOp() override {}
 
   void ComputeAsync(OpKernelContext* ctx, DoneCallback done) override {
-    if (ctx->run_all_kernels_inline()) {
+    if (ctx->run_all_kernels_inline() || small_loop_) {
       // Use the non-callback-based implementation when kernels (and function
       // callbacks) execute inline to avoid stack overflow.
       OP_REQUIRES_OK_ASYNC(ctx, DoComputeSync(ctx), done);
@@ -394,6 +410,7 @@ class WhileOp : public AsyncOpKernel {
  private:
   NameAttrList cond_func_;
   NameAttrList body_func_;
+  bool small_loop_ = false;
 
   mutex mu_;
   std::unordered_map<FunctionLibraryRuntime*, std::pair<FHandle, FHandle>>
@@ -685,8 +702,12 @@ class WhileOp : public AsyncOpKernel {
         *cond_handle = iter->second.first;
         *body_handle = iter->second.second;
       } else {
-        TF_RETURN_IF_ERROR(Instantiate(ctx, cond_func_, cond_handle));
-        TF_RETURN_IF_ERROR(Instantiate(ctx, body_func_, body_handle));
+        const string executor_type =
+            small_loop_ ? "SINGLE_THREADED_EXECUTOR" : ctx->executor_type();
+        TF_RETURN_IF_ERROR(
+            Instantiate(ctx, cond_func_, cond_handle, executor_type));
+        TF_RETURN_IF_ERROR(
+            Instantiate(ctx, body_func_, body_handle, executor_type));
         handles_[lib] = {*cond_handle, *body_handle};
       }
     }
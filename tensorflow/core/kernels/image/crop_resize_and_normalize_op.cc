@@ -0,0 +1,309 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/image_ops.cc
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/kernels/image/crop_resize_and_normalize_op.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+typedef Eigen::GpuDevice GPUDevice;
+
+namespace functor {
+
+template <typename T>
+struct CropResizeAndNormalize<CPUDevice, T> {
+  void operator()(const OpKernelContext* context,
+                  typename TTypes<T, 4>::ConstTensor image,
+                  typename TTypes<float, 2>::ConstTensor boxes,
+                  typename TTypes<int32, 1>::ConstTensor box_ind,
+                  typename TTypes<float>::ConstFlat offset,
+                  typename TTypes<float>::ConstFlat scale,
+                  float extrapolation_value, TensorFormat data_format,
+                  int crop_height, int crop_width, float* crops) {
+    const int image_height = image.dimension(1);
+    const int image_width = image.dimension(2);
+    const int depth = image.dimension(3);
+    const int num_boxes = boxes.dimension(0);
+    const bool nchw = data_format == FORMAT_NCHW;
+
+    // The normalization of each channel, and of the extrapolated pixels.
+    std::vector<float> offsets(depth);
+    std::vector<float> scales(depth);
+    std::vector<float> extrapolated(depth);
+    for (int d = 0; d < depth; ++d) {
+      offsets[d] = offset(offset.size() == 1 ? 0 : d);
+      scales[d] = scale(scale.size() == 1 ? 0 : d);
+      extrapolated[d] = (extrapolation_value - offsets[d]) * scales[d];
+    }
+
+    // The horizontal taps of a row, as offsets in the image row, shared by
+    // all rows of a box.
+    struct Tap {
+      int64_t left;
+      int64_t right;
+      float lerp;
+      bool valid;
+    };
+
+    // Sharding across the rows of the crops.
+    auto CropRows = [&](int64_t start_row, int64_t limit_row) {
+      std::vector<Tap> xs(crop_width);
+      std::vector<float> row(static_cast<int64_t>(crop_width) * depth);
+      int taps_box = -1;
+      for (int64_t r = start_row; r < limit_row; ++r) {
+        const int b = r / crop_height;
+        const int y = r % crop_height;
+        const float y1 = boxes(b, 0);
+        const float x1 = boxes(b, 1);
+        const float y2 = boxes(b, 2);
+        const float x2 = boxes(b, 3);
+        const int32_t b_in = box_ind(b);
+
+        if (b != taps_box) {
+          const float width_scale =
+              (crop_width > 1)
+                  ? (x2 - x1) * (image_width - 1) / (crop_width - 1)
+                  : 0;
+          for (int x = 0; x < crop_width; ++x) {
+            const float in_x = (crop_width > 1)
+                                   ? x1 * (image_width - 1) + x * width_scale
+                                   : 0.5 * (x1 + x2) * (image_width - 1);
+            Tap& tap = xs[x];
+            tap.valid = in_x >= 0 && in_x <= image_width - 1;
+            if (!tap.valid) continue;
+            const int left_x_index = floorf(in_x);
+            tap.left = static_cast<int64_t>(left_x_index) * depth;
+            tap.right = static_cast<int64_t>(ceilf(in_x)) * depth;
+            tap.lerp = in_x - left_x_index;
+          }
+          taps_box = b;
+        }
+
+        const float height_scale =
+            (crop_height > 1)
+                ? (y2 - y1) * (image_height - 1) / (crop_height - 1)
+                : 0;
+        const float in_y = (crop_height > 1)
+                               ? y1 * (image_height - 1) + y * height_scale
+                               : 0.5 * (y1 + y2) * (image_height - 1);
+        float* out = row.data();
+        if (in_y < 0 || in_y > image_height - 1) {
+          for (int x = 0; x < crop_width; ++x) {
+            for (int d = 0; d < depth; ++d) *out++ = extrapolated[d];
+          }
+        } else {
+          const int top_y_index = floorf(in_y);
+          const int bottom_y_index = ceilf(in_y);
+          const float y_lerp = in_y - top_y_index;
+          const T* top_row = &image(b_in, top_y_index, 0, 0);
+          const T* bottom_row = &image(b_in, bottom_y_index, 0, 0);
+          for (int x = 0; x < crop_width; ++x) {
+            const Tap& tap = xs[x];
+            if (!tap.valid) {
+              for (int d = 0; d < depth; ++d) *out++ = extrapolated[d];
+              continue;
+            }
+            const T* top_left = top_row + tap.left;
+            const T* top_right = top_row + tap.right;
+            const T* bottom_left = bottom_row + tap.left;
+            const T* bottom_right = bottom_row + tap.right;
+            for (int d = 0; d < depth; ++d) {
+              const float tl = static_cast<float>(top_left[d]);
+              const float tr = static_cast<float>(top_right[d]);
+              const float bl = static_cast<float>(bottom_left[d]);
+              const float br = static_cast<float>(bottom_right[d]);
+              const float top = tl + (tr - tl) * tap.lerp;
+              const float bottom = bl + (br - bl) * tap.lerp;
+              *out++ = (top + (bottom - top) * y_lerp - offsets[d]) * scales[d];
+            }
+          }
+        }
+
+        // The row is computed interleaved, then written in the data format.
+        if (!nchw) {
+          std::copy(row.begin(), row.end(),
+                    crops + r * static_cast<int64_t>(crop_width) * depth);
+          continue;
+        }
+        for (int d = 0; d < depth; ++d) {
+          float* channel_row =
+              crops + ((static_cast<int64_t>(b) * depth + d) * crop_height +
+                       y) *
+                          crop_width;
+          for (int x = 0; x < crop_width; ++x) {
+            channel_row[x] = row[static_cast<int64_t>(x) * depth + d];
+          }
+        }
+      }
+    };
+
+    // A rough estimate of the cost of a row: 4 loads, 3 lerps and the
+    // normalization per element.
+    const int64_t cost_per_row = static_cast<int64_t>(crop_width) * depth * 20;
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *(context->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          static_cast<int64_t>(num_boxes) * crop_height, cost_per_row,
+          CropRows);
+  }
+};
+
+}  // namespace functor
+
+template <typename Device, typename T>
+class CropResizeAndNormalizeOp : public OpKernel {
+ public:
+  explicit CropResizeAndNormalizeOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("extrapolation_value",
+                                             &extrapolation_value_));
+    string data_format;
+    OP_REQUIRES_OK(context, context->GetAttr("data_format", &data_format));
+    OP_REQUIRES(context, FormatFromString(data_format, &data_format_),
+                errors::InvalidArgument("Invalid data format ", data_format));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& image = context->input(0);
+    const Tensor& boxes = context->input(1);
+    const Tensor& box_index = context->input(2);
+    const Tensor& crop_size = context->input(3);
+    const Tensor& offset = context->input(4);
+    const Tensor& scale = context->input(5);
+
+    OP_REQUIRES(context, image.dims() == 4,
+                errors::InvalidArgument("input image must be 4-D",
+                                        image.shape().DebugString()));
+    const int batch_size = image.dim_size(0);
+    const int image_height = image.dim_size(1);
+    const int image_width = image.dim_size(2);
+    const int depth = image.dim_size(3);
+    OP_REQUIRES(context, image_height > 0 && image_width > 0,
+                errors::InvalidArgument("image dimensions must be positive"));
+    OP_REQUIRES(context,
+                boxes.dims() == 2 && boxes.dim_size(1) == 4,
+                errors::InvalidArgument("boxes must be 2-D [num_boxes, 4]: ",
+                                        boxes.shape().DebugString()));
+    const int num_boxes = boxes.dim_size(0);
+    OP_REQUIRES(context,
+                box_index.dims() == 1 && box_index.dim_size(0) == num_boxes,
+                errors::InvalidArgument("box_index must be 1-D [num_boxes]: ",
+                                        box_index.shape().DebugString()));
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsVector(crop_size.shape()) &&
+                    crop_size.NumElements() == 2,
+                errors::InvalidArgument("crop_size must be 1-D with 2 "
+                                        "elements, got shape ",
+                                        crop_size.shape().DebugString()));
+    const int crop_height = crop_size.vec<int32>()(0);
+    const int crop_width = crop_size.vec<int32>()(1);
+    OP_REQUIRES(context, crop_height > 0 && crop_width > 0,
+                errors::InvalidArgument("crop dimensions must be positive"));
+    for (const Tensor* normalization : {&offset, &scale}) {
+      OP_REQUIRES(context,
+                  normalization->dims() <= 1 &&
+                      (normalization->NumElements() == 1 ||
+                       normalization->NumElements() == depth),
+                  errors::InvalidArgument(
+                      "offset and scale must have 1 or ", depth,
+                      " elements, got shape ",
+                      normalization->shape().DebugString()));
+    }
+
+    Tensor* crops = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0,
+                       ShapeFromFormat(data_format_, num_boxes, crop_height,
+                                       crop_width, depth),
+                       &crops));
+    if (num_boxes == 0) return;
+
+    if (std::is_same<Device, CPUDevice>::value) {
+      const auto boxes_tensor = boxes.tensor<float, 2>();
+      const Eigen::Tensor<bool, 0, Eigen::RowMajor> only_finite_elements =
+          boxes_tensor.isfinite().all();
+      OP_REQUIRES(context, only_finite_elements(),
+                  errors::InvalidArgument(
+                      "Boxes contains at least one element that is not "
+                      "finite"));
+      const auto box_index_vec = box_index.vec<int32>();
+      for (int b = 0; b < num_boxes; ++b) {
+        OP_REQUIRES(context, FastBoundsCheck(box_index_vec(b), batch_size),
+                    errors::OutOfRange("box_index has values outside [0, ",
+                                       batch_size, ")"));
+      }
+    }
+
+    functor::CropResizeAndNormalize<Device, T>()(
+        context, image.tensor<T, 4>(), boxes.tensor<float, 2>(),
+        box_index.vec<int32>(), offset.flat<float>(), scale.flat<float>(),
+        extrapolation_value_, data_format_, crop_height, crop_width,
+        crops->flat<float>().data());
+  }
+
+ private:
+  float extrapolation_value_;
+  TensorFormat data_format_;
+};
+
+#define REGISTER_KERNEL(T)                                         \
+  REGISTER_KERNEL_BUILDER(Name("CropResizeAndNormalize")           \
+                              .Device(DEVICE_CPU)                  \
+                              .TypeConstraint<T>("T")              \
+                              .HostMemory("crop_size"),            \
+                          CropResizeAndNormalizeOp<CPUDevice, T>);
+
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_KERNEL);
+
+#undef REGISTER_KERNEL
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+
+#define REGISTER_KERNEL(T)                                         \
+  REGISTER_KERNEL_BUILDER(Name("CropResizeAndNormalize")           \
+                              .Device(DEVICE_GPU)                  \
+                              .TypeConstraint<T>("T")              \
+                              .HostMemory("crop_size"),            \
+                          CropResizeAndNormalizeOp<GPUDevice, T>);
+
+TF_CALL_half(REGISTER_KERNEL);
+TF_CALL_float(REGISTER_KERNEL);
+TF_CALL_double(REGISTER_KERNEL);
+
+#undef REGISTER_KERNEL
+
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+
+}  // namespace tensorflow
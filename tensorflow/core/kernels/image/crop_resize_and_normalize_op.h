@@ -0,0 +1,47 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_IMAGE_CROP_RESIZE_AND_NORMALIZE_OP_H_
+#define TENSORFLOW_CORE_KERNELS_IMAGE_CROP_RESIZE_AND_NORMALIZE_OP_H_
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/util/tensor_format.h"
+
+namespace tensorflow {
+namespace functor {
+
+// Computes CropAndResize with the bilinear method, then (crop - offset) *
+// scale, with `offset` and `scale` of either 1 or depth elements, in
+// `data_format`. Each output pixel is interpolated from the image directly.
+template <typename Device, typename T>
+struct CropResizeAndNormalize {
+  // We assume that the tensor sizes are correct and, on CPU, that the box
+  // indices are valid.
+  void operator()(const OpKernelContext* context,
+                  typename TTypes<T, 4>::ConstTensor image,
+                  typename TTypes<float, 2>::ConstTensor boxes,
+                  typename TTypes<int32, 1>::ConstTensor box_ind,
+                  typename TTypes<float>::ConstFlat offset,
+                  typename TTypes<float>::ConstFlat scale,
+                  float extrapolation_value, TensorFormat data_format,
+                  int crop_height, int crop_width, float* crops);
+};
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_IMAGE_CROP_RESIZE_AND_NORMALIZE_OP_H_
@@ -0,0 +1,172 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/image_ops.cc.
+
+#if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
+
+#define EIGEN_USE_GPU
+
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/kernels/image/crop_resize_and_normalize_op.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/gpu_kernel_helper.h"
+
+namespace tensorflow {
+
+typedef Eigen::GpuDevice GPUDevice;
+
+namespace {
+
+template <typename T>
+__global__ void CropResizeAndNormalizeKernel(
+    const int32 nthreads, const T* __restrict__ image_ptr,
+    const float* __restrict__ boxes_ptr, const int32* __restrict__ box_ind_ptr,
+    const float* __restrict__ offset_ptr, int offset_size,
+    const float* __restrict__ scale_ptr, int scale_size, int batch,
+    int image_height, int image_width, int crop_height, int crop_width,
+    int depth, float extrapolation_value, bool nchw,
+    float* __restrict__ crops_ptr) {
+  const float height_scale_factor =
+      crop_height > 1 ? (image_height - 1) / static_cast<float>(crop_height - 1)
+                      : 0;
+  const float width_scale_factor =
+      crop_width > 1 ? (image_width - 1) / static_cast<float>(crop_width - 1)
+                     : 0;
+  float image_height_minus_one = image_height - 1;
+  float image_width_minus_one = image_width - 1;
+
+  GPU_1D_KERNEL_LOOP(out_idx, nthreads) {
+    // out_idx = x + crop_width * (y + crop_height * (d + depth * b)) in NCHW,
+    // and d + depth * (x + crop_width * (y + crop_height * b)) in NHWC.
+    uint32_t idx = out_idx;
+    uint32_t d, x, y, b;
+    if (nchw) {
+      x = idx % crop_width;
+      idx /= crop_width;
+      y = idx % crop_height;
+      idx /= crop_height;
+      d = idx % depth;
+      b = idx / depth;
+    } else {
+      d = idx % depth;
+      idx /= depth;
+      x = idx % crop_width;
+      idx /= crop_width;
+      y = idx % crop_height;
+      b = idx / crop_height;
+    }
+    const float offset = offset_ptr[offset_size == 1 ? 0 : d];
+    const float scale = scale_ptr[scale_size == 1 ? 0 : d];
+
+    const float y1 = boxes_ptr[b * 4];
+    const float x1 = boxes_ptr[b * 4 + 1];
+    const float y2 = boxes_ptr[b * 4 + 2];
+    const float x2 = boxes_ptr[b * 4 + 3];
+
+    // The box indices are not validated on the GPU, so the crops of invalid
+    // ones are extrapolated.
+    const int32 b_in = box_ind_ptr[b];
+    const float in_y =
+        (crop_height > 1)
+            ? y1 * image_height_minus_one + y * (y2 - y1) * height_scale_factor
+            : 0.5f * (y1 + y2) * image_height_minus_one;
+    const float in_x =
+        (crop_width > 1)
+            ? x1 * image_width_minus_one + x * (x2 - x1) * width_scale_factor
+            : 0.5f * (x1 + x2) * image_width_minus_one;
+    if (b_in < 0 || b_in >= batch || !(in_y >= 0) ||
+        in_y > image_height_minus_one || !(in_x >= 0) ||
+        in_x > image_width_minus_one) {
+      crops_ptr[out_idx] = (extrapolation_value - offset) * scale;
+      continue;
+    }
+
+    const int top_y_index = floorf(in_y);
+    const int bottom_y_index = ceilf(in_y);
+    const float y_lerp = in_y - top_y_index;
+    const int left_x_index = floorf(in_x);
+    const int right_x_index = ceilf(in_x);
+    const float x_lerp = in_x - left_x_index;
+
+    const int64_t top_row =
+        (static_cast<int64_t>(b_in) * image_height + top_y_index) * image_width;
+    const int64_t bottom_row =
+        (static_cast<int64_t>(b_in) * image_height + bottom_y_index) *
+        image_width;
+    const float top_left(
+        static_cast<float>(image_ptr[(top_row + left_x_index) * depth + d]));
+    const float top_right(
+        static_cast<float>(image_ptr[(top_row + right_x_index) * depth + d]));
+    const float bottom_left(static_cast<float>(
+        image_ptr[(bottom_row + left_x_index) * depth + d]));
+    const float bottom_right(static_cast<float>(
+        image_ptr[(bottom_row + right_x_index) * depth + d]));
+    const float top = top_left + (top_right - top_left) * x_lerp;
+    const float bottom = bottom_left + (bottom_right - bottom_left) * x_lerp;
+    crops_ptr[out_idx] = (top + (bottom - top) * y_lerp - offset) * scale;
+  }
+}
+
+}  // namespace
+
+namespace functor {
+
+template <typename T>
+struct CropResizeAndNormalize<GPUDevice, T> {
+  void operator()(const OpKernelContext* context,
+                  typename TTypes<T, 4>::ConstTensor image,
+                  typename TTypes<float, 2>::ConstTensor boxes,
+                  typename TTypes<int32, 1>::ConstTensor box_ind,
+                  typename TTypes<float>::ConstFlat offset,
+                  typename TTypes<float>::ConstFlat scale,
+                  float extrapolation_value, TensorFormat data_format,
+                  int crop_height, int crop_width, float* crops) {
+    const int batch = image.dimension(0);
+    const int image_height = image.dimension(1);
+    const int image_width = image.dimension(2);
+    const int depth = image.dimension(3);
+    const int num_boxes = boxes.dimension(0);
+
+    const int total_count = num_boxes * crop_height * crop_width * depth;
+    const GPUDevice& d = context->eigen_device<GPUDevice>();
+    if (total_count > 0) {
+      GpuLaunchConfig config = GetGpuLaunchConfig(total_count, d);
+      TF_CHECK_OK(GpuLaunchKernel(
+          CropResizeAndNormalizeKernel<T>, config.block_count,
+          config.thread_per_block, 0, d.stream(), config.virtual_thread_count,
+          image.data(), boxes.data(), box_ind.data(), offset.data(),
+          static_cast<int>(offset.size()), scale.data(),
+          static_cast<int>(scale.size()), batch, image_height, image_width,
+          crop_height, crop_width, depth, extrapolation_value,
+          data_format == FORMAT_NCHW, crops));
+    }
+  }
+};
+
+#define DEFINE_GPU_SPECS(T) \
+  template struct CropResizeAndNormalize<GPUDevice, T>;
+
+TF_CALL_half(DEFINE_GPU_SPECS);
+TF_CALL_float(DEFINE_GPU_SPECS);
+TF_CALL_double(DEFINE_GPU_SPECS);
+
+#undef DEFINE_GPU_SPECS
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
@@ -0,0 +1,125 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class CropResizeAndNormalizeOpTest : public OpsTestBase {
+ protected:
+  template <typename T>
+  void MakeOp(float extrapolation_value, const string& data_format) {
+    TF_ASSERT_OK(NodeDefBuilder("crop_op", "CropResizeAndNormalize")
+                     .Input(FakeInput(DataTypeToEnum<T>::value))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_FLOAT))
+                     .Attr("extrapolation_value", extrapolation_value)
+                     .Attr("data_format", data_format)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // A 2x2 image whose second channel is 10 times the first one, cropped in
+  // full to 3x3.
+  template <typename T>
+  void AddCropOfImage() {
+    AddInputFromArray<T>(TensorShape({1, 2, 2, 2}),
+                         {1, 10, 2, 20, 3, 30, 4, 40});
+    AddInputFromArray<float>(TensorShape({1, 4}), {0, 0, 1, 1});
+    AddInputFromArray<int32>(TensorShape({1}), {0});
+    AddInputFromArray<int32>(TensorShape({2}), {3, 3});
+  }
+};
+
+TEST_F(CropResizeAndNormalizeOpTest, NHWC) {
+  MakeOp<uint8>(0, "NHWC");
+  AddCropOfImage<uint8>();
+  AddInputFromArray<float>(TensorShape({2}), {1, 10});
+  AddInputFromArray<float>(TensorShape({2}), {2, 0.1});
+  TF_ASSERT_OK(RunOpKernel());
+
+  // CropAndResize gives [[1, 1.5, 2], [2, 2.5, 3], [3, 3.5, 4]] for the first
+  // channel, and 10 times that for the second one.
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({1, 3, 3, 2}));
+  test::FillValues<float>(&expected, {0, 0, 1, 0.5, 2, 1,    //
+                                      2, 1, 3, 1.5, 4, 2,    //
+                                      4, 2, 5, 2.5, 6, 3});  //
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-5);
+}
+
+TEST_F(CropResizeAndNormalizeOpTest, NCHW) {
+  MakeOp<float>(0, "NCHW");
+  AddCropOfImage<float>();
+  AddInputFromArray<float>(TensorShape({2}), {1, 10});
+  AddInputFromArray<float>(TensorShape({2}), {2, 0.1});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({1, 2, 3, 3}));
+  test::FillValues<float>(&expected, {0, 1, 2, 2, 3, 4, 4, 5, 6,  //
+                                      0, 0.5, 1, 1, 1.5, 2, 2, 2.5, 3});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-5);
+}
+
+TEST_F(CropResizeAndNormalizeOpTest, NormalizesExtrapolatedPixels) {
+  MakeOp<float>(5, "NHWC");
+  AddInputFromArray<float>(TensorShape({1, 2, 2, 2}),
+                           {1, 10, 2, 20, 3, 30, 4, 40});
+  AddInputFromArray<float>(TensorShape({1, 4}), {0, 0, 2, 2});
+  AddInputFromArray<int32>(TensorShape({1}), {0});
+  AddInputFromArray<int32>(TensorShape({2}), {2, 2});
+  AddInputFromArray<float>(TensorShape({}), {1});
+  AddInputFromArray<float>(TensorShape({1}), {1});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({1, 2, 2, 2}));
+  test::FillValues<float>(&expected, {0, 9, 4, 4, 4, 4, 4, 4});
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(CropResizeAndNormalizeOpTest, FailsForInvalidBoxIndex) {
+  MakeOp<float>(0, "NHWC");
+  AddInputFromArray<float>(TensorShape({1, 2, 2, 1}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({1, 4}), {0, 0, 1, 1});
+  AddInputFromArray<int32>(TensorShape({1}), {1});
+  AddInputFromArray<int32>(TensorShape({2}), {2, 2});
+  AddInputFromArray<float>(TensorShape({1}), {0});
+  AddInputFromArray<float>(TensorShape({1}), {1});
+  EXPECT_TRUE(errors::IsOutOfRange(RunOpKernel()));
+}
+
+TEST_F(CropResizeAndNormalizeOpTest, FailsForInvalidNormalization) {
+  MakeOp<float>(0, "NHWC");
+  AddInputFromArray<float>(TensorShape({1, 2, 2, 1}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({1, 4}), {0, 0, 1, 1});
+  AddInputFromArray<int32>(TensorShape({1}), {0});
+  AddInputFromArray<int32>(TensorShape({2}), {2, 2});
+  AddInputFromArray<float>(TensorShape({3}), {0, 0, 0});
+  AddInputFromArray<float>(TensorShape({1}), {1});
+  EXPECT_TRUE(errors::IsInvalidArgument(RunOpKernel()));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,245 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/image_ops.cc
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns the largest DCT scaling denominator, of 1, 2, 4 and 8, at which a
+// `width`x`height` image is decoded to at least `out_width`x`out_height`, so
+// that it is only ever downscaled from there.
+int DctScaleDenominator(int width, int height, int out_width,
+                        int out_height) {
+  for (int ratio : {8, 4, 2}) {
+    // libjpeg rounds the scaled sizes up.
+    if ((width + ratio - 1) / ratio >= out_width &&
+        (height + ratio - 1) / ratio >= out_height) {
+      return ratio;
+    }
+  }
+  return 1;
+}
+
+struct Interpolation {
+  int64_t lower;
+  int64_t upper;
+  float lerp;
+};
+
+// Computes the bilinear interpolation weights with half pixel centers, as
+// ResizeBilinear computes them.
+std::vector<Interpolation> ComputeInterpolation(int64_t out_size,
+                                                int64_t in_size,
+                                                int64_t stride) {
+  const float scale = static_cast<float>(in_size) / out_size;
+  std::vector<Interpolation> interpolation(out_size);
+  for (int64_t i = 0; i < out_size; ++i) {
+    const float in = (static_cast<float>(i) + 0.5f) * scale - 0.5f;
+    const float in_floor = std::floor(in);
+    interpolation[i].lower =
+        std::max(static_cast<int64_t>(in_floor), int64_t{0}) * stride;
+    interpolation[i].upper =
+        std::min(static_cast<int64_t>(std::ceil(in)), in_size - 1) * stride;
+    interpolation[i].lerp = in - in_floor;
+  }
+  return interpolation;
+}
+
+// Bilinearly resizes the `in_width`x`in_height` image `in` to `out`.
+void ResizeImage(const uint8* in, int64_t in_height, int64_t in_width,
+                 int64_t out_height, int64_t out_width, int channels,
+                 float* out) {
+  if (in_height == out_height && in_width == out_width) {
+    std::copy_n(in, out_height * out_width * channels, out);
+    return;
+  }
+  const std::vector<Interpolation> ys =
+      ComputeInterpolation(out_height, in_height, in_width * channels);
+  const std::vector<Interpolation> xs =
+      ComputeInterpolation(out_width, in_width, channels);
+  for (int64_t y = 0; y < out_height; ++y) {
+    const uint8* top = in + ys[y].lower;
+    const uint8* bottom = in + ys[y].upper;
+    const float y_lerp = ys[y].lerp;
+    for (int64_t x = 0; x < out_width; ++x) {
+      const float x_lerp = xs[x].lerp;
+      for (int c = 0; c < channels; ++c) {
+        const float top_left = top[xs[x].lower + c];
+        const float top_right = top[xs[x].upper + c];
+        const float bottom_left = bottom[xs[x].lower + c];
+        const float bottom_right = bottom[xs[x].upper + c];
+        const float top_value = top_left + (top_right - top_left) * x_lerp;
+        const float bottom_value =
+            bottom_left + (bottom_right - bottom_left) * x_lerp;
+        *out++ = top_value + (bottom_value - top_value) * y_lerp;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+// Decodes a batch of JPEG images and resizes them to the same size. Each
+// image is decoded at the smallest DCT scale that is at least as large as the
+// output, and the images are decoded in parallel.
+class DecodeAndResizeJpegBatchOp : public OpKernel {
+ public:
+  explicit DecodeAndResizeJpegBatchOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("channels", &channels_));
+    OP_REQUIRES(context, channels_ == 1 || channels_ == 3,
+                errors::InvalidArgument("channels must be 1 or 3, got ",
+                                        channels_));
+    flags_.components = channels_;
+    OP_REQUIRES_OK(context, context->GetAttr("fancy_upscaling",
+                                             &flags_.fancy_upscaling));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("try_recover_truncated",
+                                    &flags_.try_recover_truncated_jpeg));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("acceptable_fraction",
+                                    &flags_.min_acceptable_fraction));
+    string dct_method;
+    OP_REQUIRES_OK(context, context->GetAttr("dct_method", &dct_method));
+    OP_REQUIRES(
+        context,
+        (dct_method.empty() || dct_method == "INTEGER_FAST" ||
+         dct_method == "INTEGER_ACCURATE"),
+        errors::InvalidArgument("dct_method must be one of "
+                                "{'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}"));
+    flags_.dct_method =
+        dct_method == "INTEGER_ACCURATE" ? JDCT_ISLOW : JDCT_IFAST;
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& contents = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(contents.shape()),
+                errors::InvalidArgument("contents must be 1-D, got shape ",
+                                        contents.shape().DebugString()));
+    const Tensor& size = context->input(1);
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsVector(size.shape()) &&
+                    size.NumElements() == 2,
+                errors::InvalidArgument("size must be 1-D with 2 elements, "
+                                        "got shape ",
+                                        size.shape().DebugString()));
+    const int out_height = size.vec<int32>()(0);
+    const int out_width = size.vec<int32>()(1);
+    OP_REQUIRES(context, out_height > 0 && out_width > 0,
+                errors::InvalidArgument("size must be positive, got [",
+                                        out_height, ", ", out_width, "]"));
+
+    const int64_t batch_size = contents.NumElements();
+    Tensor* images = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({batch_size, out_height, out_width,
+                                       channels_}),
+                       &images));
+    if (batch_size == 0) return;
+    const auto inputs = contents.vec<tstring>();
+    float* const output = images->flat<float>().data();
+    const int64_t image_size =
+        static_cast<int64_t>(out_height) * out_width * channels_;
+
+    std::vector<Status> statuses(batch_size);
+    auto decode = [&](int64_t start, int64_t limit) {
+      std::unique_ptr<uint8[]> buffer;
+      int64_t buffer_size = 0;
+      for (int64_t i = start; i < limit; ++i) {
+        statuses[i] = DecodeAndResize(inputs(i), out_height, out_width,
+                                      &buffer, &buffer_size,
+                                      output + i * image_size);
+      }
+    };
+    // Decoding an image takes milliseconds, so each one can be a shard.
+    const int64_t cost_per_image = 1000000;
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
+          cost_per_image, decode);
+    for (int64_t i = 0; i < batch_size; ++i) {
+      OP_REQUIRES_OK(context, statuses[i]);
+    }
+  }
+
+ private:
+  // Decodes `input` into `*buffer`, growing it as needed, and resizes it into
+  // `output`.
+  Status DecodeAndResize(const tstring& input, int out_height, int out_width,
+                         std::unique_ptr<uint8[]>* buffer,
+                         int64_t* buffer_size, float* output) const {
+    if (input.size() > std::numeric_limits<int>::max()) {
+      return errors::InvalidArgument("JPEG contents are too large for int: ",
+                                     input.size());
+    }
+    int width, height, components;
+    if (!jpeg::GetImageInfo(input.data(), input.size(), &width, &height,
+                            &components)) {
+      return errors::InvalidArgument("Invalid JPEG data, size ",
+                                     input.size());
+    }
+    jpeg::UncompressFlags flags = flags_;
+    flags.ratio = DctScaleDenominator(width, height, out_width, out_height);
+
+    int decoded_width = 0;
+    int decoded_height = 0;
+    uint8* decoded = jpeg::Uncompress(
+        input.data(), input.size(), flags, /*nwarn=*/nullptr,
+        [&](int scaled_width, int scaled_height, int channels) -> uint8* {
+          DCHECK_EQ(channels, channels_);
+          decoded_width = scaled_width;
+          decoded_height = scaled_height;
+          const int64_t size =
+              static_cast<int64_t>(scaled_width) * scaled_height * channels;
+          if (size > *buffer_size) {
+            buffer->reset(new uint8[size]);
+            *buffer_size = size;
+          }
+          return buffer->get();
+        });
+    if (decoded == nullptr) {
+      return errors::InvalidArgument(
+          "jpeg::Uncompress failed. Invalid JPEG data.");
+    }
+    ResizeImage(decoded, decoded_height, decoded_width, out_height, out_width,
+                channels_, output);
+    return OkStatus();
+  }
+
+  int channels_;
+  jpeg::UncompressFlags flags_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("DecodeAndResizeJpegBatch").Device(DEVICE_CPU),
+                        DecodeAndResizeJpegBatchOp);
+
+}  // namespace tensorflow
@@ -0,0 +1,131 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+#include <vector>
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+
+// Returns a JPEG of a gradient whose red channel is 4 * x, whose green
+// channel is 4 * y, and whose blue channel is `blue`.
+tstring GradientJpeg(uint8 blue) {
+  std::vector<uint8> pixels;
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      pixels.push_back(4 * x);
+      pixels.push_back(4 * y);
+      pixels.push_back(blue);
+    }
+  }
+  jpeg::CompressFlags flags;
+  flags.format = jpeg::FORMAT_RGB;
+  return jpeg::Compress(pixels.data(), kWidth, kHeight, flags);
+}
+
+class DecodeAndResizeJpegBatchOpTest : public OpsTestBase {
+ protected:
+  void MakeOp() {
+    TF_ASSERT_OK(NodeDefBuilder("decode_op", "DecodeAndResizeJpegBatch")
+                     .Input(FakeInput(DT_STRING))
+                     .Input(FakeInput(DT_INT32))
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Expects `image` to be the gradient with `blue`, resized.
+  void ExpectGradient(const Tensor& images, int index, uint8 blue) {
+    const auto image = images.tensor<float, 4>();
+    const int out_height = images.dim_size(1);
+    const int out_width = images.dim_size(2);
+    for (int y = 0; y < out_height; ++y) {
+      for (int x = 0; x < out_width; ++x) {
+        // The center of the output pixel in the input.
+        const float in_x = (x + 0.5f) * kWidth / out_width - 0.5f;
+        const float in_y = (y + 0.5f) * kHeight / out_height - 0.5f;
+        EXPECT_NEAR(image(index, y, x, 0), 4 * in_x, 12) << y << ", " << x;
+        EXPECT_NEAR(image(index, y, x, 1), 4 * in_y, 12) << y << ", " << x;
+        EXPECT_NEAR(image(index, y, x, 2), blue, 12) << y << ", " << x;
+      }
+    }
+  }
+};
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, DecodesAtDctScale) {
+  MakeOp();
+  AddInputFromArray<tstring>(TensorShape({2}),
+                             {GradientJpeg(0), GradientJpeg(200)});
+  // A quarter of the size of the images, decoded without resizing.
+  AddInputFromArray<int32>(TensorShape({2}), {kHeight / 4, kWidth / 4});
+  TF_ASSERT_OK(RunOpKernel());
+
+  const Tensor& images = *GetOutput(0);
+  EXPECT_EQ(images.shape(), TensorShape({2, kHeight / 4, kWidth / 4, 3}));
+  ExpectGradient(images, 0, 0);
+  ExpectGradient(images, 1, 200);
+}
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, ResizesFromDctScale) {
+  MakeOp();
+  AddInputFromArray<tstring>(TensorShape({1}), {GradientJpeg(100)});
+  // Decoded at half the size, then resized.
+  AddInputFromArray<int32>(TensorShape({2}), {10, 20});
+  TF_ASSERT_OK(RunOpKernel());
+
+  const Tensor& images = *GetOutput(0);
+  EXPECT_EQ(images.shape(), TensorShape({1, 10, 20, 3}));
+  ExpectGradient(images, 0, 100);
+}
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, Upscales) {
+  MakeOp();
+  AddInputFromArray<tstring>(TensorShape({1}), {GradientJpeg(100)});
+  AddInputFromArray<int32>(TensorShape({2}), {2 * kHeight, kWidth});
+  TF_ASSERT_OK(RunOpKernel());
+
+  const Tensor& images = *GetOutput(0);
+  EXPECT_EQ(images.shape(), TensorShape({1, 2 * kHeight, kWidth, 3}));
+  ExpectGradient(images, 0, 100);
+}
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, FailsForInvalidJpeg) {
+  MakeOp();
+  AddInputFromArray<tstring>(TensorShape({2}),
+                             {GradientJpeg(0), "not a jpeg"});
+  AddInputFromArray<int32>(TensorShape({2}), {8, 8});
+  EXPECT_TRUE(errors::IsInvalidArgument(RunOpKernel()));
+}
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, FailsForInvalidSize) {
+  MakeOp();
+  AddInputFromArray<tstring>(TensorShape({1}), {GradientJpeg(0)});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 8});
+  EXPECT_TRUE(errors::IsInvalidArgument(RunOpKernel()));
+}
+
+}  // namespace
+}  // namespace tensorflow
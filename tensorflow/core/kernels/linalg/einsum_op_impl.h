@@ -313,50 +313,117 @@ struct EinsumHelper {
     return OkStatus();
   }
 
-  // Returns true if the input dimensions are already sorted in the order
-  // [batch, contract, free, reduce]. Used to implement an optimization to avoid
-  // an extra transpose and instead uses (adj_x and adj_y) in BatchMatMul.
-  static bool ShouldSwapFreeAndContract(
-      const Labels& labels,
+  // Returns the permutation that transposes an operand with the given labels
+  // to the order [broadcasting, batch, free, contract, reduce] of
+  // EinsumDimensionType, or [broadcasting, batch, contract, free, reduce] if
+  // swap_free_and_contract is true, which BatchMatMul handles with its
+  // transpose flags. The order of the batch and contract dimensions must be
+  // the same for all operands, so the batch dimensions are sorted by label and
+  // the contract dimensions follow contract_labels. The free and reduce
+  // dimensions keep their order in the operand, so that they need not be
+  // transposed. Repeated labels are kept adjacent.
+  static std::vector<int> OperandPermutation(
+      const Labels& labels, const std::vector<EinsumDimensionType>& label_types,
+      const Labels& contract_labels, bool swap_free_and_contract) {
+    const int free_group = swap_free_and_contract ? 3 : 2;
+    std::vector<std::pair<int, int>> keys(labels.size());
+    for (int i = 0; i < labels.size(); ++i) {
+      const int label = labels[i];
+      switch (label_types[label]) {
+        case EinsumDimensionType::kBroadcasting:
+        case EinsumDimensionType::kBatch:
+          keys[i] = {label_types[label], label};
+          break;
+        case EinsumDimensionType::kFree:
+        case EinsumDimensionType::kReduce:
+          keys[i] = {label_types[label] == EinsumDimensionType::kFree
+                         ? free_group
+                         : EinsumDimensionType::kReduce,
+                     std::find(labels.begin(), labels.end(), label) -
+                         labels.begin()};
+          break;
+        case EinsumDimensionType::kContract:
+          keys[i] = {5 - free_group,
+                     std::find(contract_labels.begin(), contract_labels.end(),
+                               label) -
+                         contract_labels.begin()};
+          break;
+      }
+    }
+    std::vector<int> permutation(labels.size());
+    absl::c_iota(permutation, 0);
+    absl::c_stable_sort(permutation,
+                        [&](int i, int j) { return keys[i] < keys[j]; });
+    return permutation;
+  }
+
+  // Returns whether an operand needs to be transposed when its contract
+  // dimensions are ordered as contract_labels.
+  static bool OperandNeedsTranspose(
+      const TensorShape& shape, const Labels& labels,
+      const std::vector<EinsumDimensionType>& label_types,
+      const Labels& contract_labels) {
+    return ShouldTranspose(shape, OperandPermutation(labels, label_types,
+                                                     contract_labels, false)) &&
+           ShouldTranspose(shape, OperandPermutation(labels, label_types,
+                                                     contract_labels, true));
+  }
+
+  // Returns the order of the contract dimensions in the operands once they are
+  // transposed for BatchMatMul. It is their order in one of the operands,
+  // picked so that the fewest elements are transposed.
+  static Labels ChooseContractLabels(
+      const OpInputList& inputs, const OperandLabels& input_labels,
       const std::vector<EinsumDimensionType>& label_types) {
-    // Check that ordering is according to dimension type, with the role of
-    // free and contract dimensions swapped.
-    gtl::InlinedVector<int, 5> remap = {0, 1, 3, 2, 4};
-    for (int i = 0; i + 1 < labels.size(); ++i) {
-      const int dimtype_a = remap[label_types[labels[i]]];
-      const int dimtype_b = remap[label_types[labels[i + 1]]];
-      if (dimtype_a > dimtype_b ||
-          (dimtype_a == dimtype_b && labels[i] > labels[i + 1])) {
-        return false;
+    Labels best_contract_labels;
+    int64_t best_transposed_elements = -1;
+    for (int i = 0; i < inputs.size(); ++i) {
+      Labels contract_labels;
+      for (int label : input_labels[i]) {
+        if (label_types[label] == EinsumDimensionType::kContract &&
+            !absl::c_linear_search(contract_labels, label)) {
+          contract_labels.push_back(label);
+        }
+      }
+      int64_t transposed_elements = 0;
+      for (int j = 0; j < inputs.size(); ++j) {
+        if (OperandNeedsTranspose(inputs[j].shape(), input_labels[j],
+                                  label_types, contract_labels)) {
+          transposed_elements += inputs[j].NumElements();
+        }
+      }
+      if (best_transposed_elements < 0 ||
+          transposed_elements < best_transposed_elements) {
+        best_contract_labels = contract_labels;
+        best_transposed_elements = transposed_elements;
       }
     }
-    return true;
+    return best_contract_labels;
   }
 
   template <typename Device, typename T>
   static Status ReduceOperand(
       OpKernelContext* ctx, const Tensor& input,
       const std::vector<EinsumDimensionType>& label_types,
-      const LabelCounts& label_counts, Labels* labels, Labels* free_labels,
-      bool* swap_free_and_contract, Tensor* output) {
+      const LabelCounts& label_counts, const Labels& contract_labels,
+      Labels* labels, Labels* free_labels, bool* swap_free_and_contract,
+      Tensor* output) {
     // Find the permutation to transpose the input dimensions in the order of
     // EinsumDimensionType; i.e. batch, free, contract and reduce dimensions.
     // This makes it more convenient to invoke Reduce/Contract operations.
-    std::vector<int> permutation(input.dims());
-    absl::c_iota(permutation, 0);
+    std::vector<int> permutation =
+        OperandPermutation(*labels, label_types, contract_labels, false);
     Tensor input_transposed;
     // Check if we can avoid the transpose. We need to flip the adj_x (or adj_y)
     // flag during BatchMatMul. This is an extra optimization not necessary for
     // correctness.
-    if (ShouldSwapFreeAndContract(*labels, label_types)) {
-      *swap_free_and_contract = true;
-    } else {
-      absl::c_sort(permutation, [&](int i, int j) {
-        int label_i = (*labels)[i];
-        int label_j = (*labels)[j];
-        return std::tie(label_types[label_i], label_i) <
-               std::tie(label_types[label_j], label_j);
-      });
+    if (ShouldTranspose(input.shape(), permutation)) {
+      std::vector<int> swapped_permutation =
+          OperandPermutation(*labels, label_types, contract_labels, true);
+      if (!ShouldTranspose(input.shape(), swapped_permutation)) {
+        *swap_free_and_contract = true;
+        permutation.swap(swapped_permutation);
+      }
     }
     // Transpose the input so that EinsumDimensionTypes are in order.
     TF_RETURN_IF_ERROR(TransposeOperand<Device, T>(ctx, input, permutation,
@@ -427,7 +494,9 @@ struct EinsumHelper {
 
   // Contracts the inputs along the last axis (or the second last if the
   // corresponding value of swap_free_and_contract is true). The batch
-  // dimensions are broadcast to the output shape.
+  // dimensions are broadcast to the output shape. If swap_operands is true, the
+  // free dimension of the second input precedes that of the first one in the
+  // output, i.e. the output is transposed by swapping the BatchMatMul operands.
   // TODO(anudhyan): BatchMatMul might devolve into a component-wise
   // multiplication when the matrix shape is [1,1]; in this case BatchMatMul
   // functor would be very inefficient. The functor should detect if this is the
@@ -436,29 +505,31 @@ struct EinsumHelper {
   static Status ContractOperands(OpKernelContext* ctx,
                                  absl::Span<const Tensor> inputs,
                                  absl::Span<const bool> swap_free_and_contract,
-                                 Tensor* output) {
+                                 bool swap_operands, Tensor* output) {
     if (inputs.size() == 1)
       return CopyFrom(inputs[0], inputs[0].shape(), output);
-    MatMulBCast bcast(inputs[0].shape().dim_sizes(),
-                      inputs[1].shape().dim_sizes());
+    const int x = swap_operands ? 1 : 0;
+    const int y = 1 - x;
+    MatMulBCast bcast(inputs[x].shape().dim_sizes(),
+                      inputs[y].shape().dim_sizes());
     if (!bcast.IsValid()) {
       return errors::InvalidArgument(
-          "Invalid broadcasting dimensions: ", inputs[0].shape().DebugString(),
-          " vs. ", inputs[1].shape().DebugString());
+          "Invalid broadcasting dimensions: ", inputs[x].shape().DebugString(),
+          " vs. ", inputs[y].shape().DebugString());
     }
     Tensor lhs;
-    TF_RETURN_IF_ERROR(ReshapeToRank3(inputs[0], bcast.x_batch_size(), &lhs));
+    TF_RETURN_IF_ERROR(ReshapeToRank3(inputs[x], bcast.x_batch_size(), &lhs));
     Tensor rhs;
-    TF_RETURN_IF_ERROR(ReshapeToRank3(inputs[1], bcast.y_batch_size(), &rhs));
+    TF_RETURN_IF_ERROR(ReshapeToRank3(inputs[y], bcast.y_batch_size(), &rhs));
     TensorShape output_shape = bcast.output_batch_shape();
-    for (int i = 0; i < inputs.size(); ++i) {
+    for (int i : {x, y}) {
       const int64_t free_axis =
           inputs[i].dims() - (swap_free_and_contract[i] ? 1 : 2);
       TF_RETURN_IF_ERROR(
           output_shape.AddDimWithStatus(inputs[i].dim_size(free_axis)));
     }
-    bool trans_x = swap_free_and_contract[0];
-    bool trans_y = !swap_free_and_contract[1];
+    bool trans_x = swap_free_and_contract[x];
+    bool trans_y = !swap_free_and_contract[y];
     TF_RETURN_IF_ERROR(
         ctx->allocate_temp(DataTypeToEnum<T>::value, output_shape, output));
     if (lhs.NumElements() == 0 || rhs.NumElements() == 0) {
@@ -511,45 +582,71 @@ class EinsumOp : public OpKernel {
     // where F and C denote the total (compacted) size of free and contract
     // dimensions, respectively.
     const int num_inputs = inputs.size();
+    const Labels contract_labels =
+        EinsumHelper::ChooseContractLabels(inputs, input_labels, label_types);
     OperandLabels free_labels(num_inputs);
     gtl::InlinedVector<Tensor, 2> inputs_reduced(num_inputs);
     gtl::InlinedVector<bool, 2> swap_free_and_contract(num_inputs);
     for (int i = 0; i < num_inputs; ++i) {
-      OP_REQUIRES_OK(ctx,
-                     EinsumHelper::ReduceOperand<Device, T>(
-                         ctx, inputs[i], label_types, input_label_counts[i],
-                         &input_labels[i], &free_labels[i],
-                         &swap_free_and_contract[i], &inputs_reduced[i]));
+      OP_REQUIRES_OK(ctx, EinsumHelper::ReduceOperand<Device, T>(
+                              ctx, inputs[i], label_types,
+                              input_label_counts[i], contract_labels,
+                              &input_labels[i], &free_labels[i],
+                              &swap_free_and_contract[i], &inputs_reduced[i]));
     }
 
+    int num_labels = label_types.size();
+    // Returns the labels of the contraction result, which has all the batch
+    // dimensions, first the broadcasting ones, then the named ones, followed
+    // by the free dimensions of the operands in the order they are contracted.
+    auto get_result_labels = [&](bool swap_operands) {
+      Labels result_labels;
+      for (int label = 0; label < num_labels; ++label) {
+        if (label_types[label] == EinsumDimensionType::kBroadcasting)
+          result_labels.push_back(label);
+      }
+      for (int label = 0; label < num_labels; ++label) {
+        if (label_types[label] == EinsumDimensionType::kBatch)
+          result_labels.push_back(label);
+      }
+      for (int i = 0; i < num_inputs; ++i) {
+        const int operand = swap_operands ? num_inputs - 1 - i : i;
+        result_labels.insert(result_labels.end(), free_labels[operand].begin(),
+                             free_labels[operand].end());
+      }
+      return result_labels;
+    };
+    auto inflate_labels = [&](const Labels& labels) {
+      Labels inflated_labels;
+      for (int label : labels) {
+        inflated_labels.insert(inflated_labels.end(),
+                               output_label_counts[label], label);
+      }
+      return inflated_labels;
+    };
+    // Contract the operands in the other order if this lays out the result
+    // as the output, so that it needn't be transposed.
+    const bool swap_operands =
+        num_inputs == 2 &&
+        inflate_labels(get_result_labels(false)) != output_labels &&
+        inflate_labels(get_result_labels(true)) == output_labels;
+
     // After reduction, the inputs should be reshaped to Tensors suitable for
     // contraction. If num_inputs is 1, the reduced input is simply forwarded to
     // the output.
     Tensor contraction_output_reshaped;
     OP_REQUIRES_OK(ctx, EinsumHelper::ContractOperands<Device, T>(
                             ctx, inputs_reduced, swap_free_and_contract,
-                            &contraction_output_reshaped));
+                            swap_operands, &contraction_output_reshaped));
 
     // Copy the batch labels from the contraction output. Recover the batch
     // shape, which may have been broadcasted.
     TensorShape result_shape = contraction_output_reshaped.shape();
     result_shape.RemoveLastDims(2);
 
-    int num_labels = label_types.size();
-    Labels result_labels;
-    // All batch dimensions should be present in the contracted result. First
-    // the broadcasting dimensions, then the named batch dimensions.
-    for (int label = 0; label < num_labels; ++label) {
-      if (label_types[label] == EinsumDimensionType::kBroadcasting)
-        result_labels.push_back(label);
-    }
-    for (int label = 0; label < num_labels; ++label) {
-      if (label_types[label] == EinsumDimensionType::kBatch)
-        result_labels.push_back(label);
-    }
-    for (int i = 0; i < num_inputs; ++i) {
-      for (int label : free_labels[i]) {
-        result_labels.push_back(label);
+    Labels result_labels = get_result_labels(swap_operands);
+    for (int label : result_labels) {
+      if (label_types[label] == EinsumDimensionType::kFree) {
         OP_REQUIRES_OK(
             ctx, result_shape.AddDimWithStatus(label_to_dim_sizes[label]));
       }
@@ -573,12 +670,7 @@ class EinsumOp : public OpKernel {
                  true /* should_inflate */, &output_inflated));
     if (output_inflated.dims() > contraction_output.dims()) {
       // We inflated the output. Modify result labels accordingly.
-      Labels inflated_labels;
-      for (int label : result_labels) {
-        inflated_labels.insert(inflated_labels.end(),
-                               output_label_counts[label], label);
-      }
-      result_labels.swap(inflated_labels);
+      result_labels = inflate_labels(result_labels);
     }
     // Find the permutation to map the result labels to the output labels. Note
     // that both the result and the final output may have the repeated labels,
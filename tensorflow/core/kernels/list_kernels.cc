@@ -121,6 +121,9 @@ Status ForwardInputOrCreateNewList(OpKernelContext* c, int32_t input_index,
 
   // If forwarding is not possible allocate a new output tensor and copy
   // the `input_list` to it.
+  VLOG(2) << c->op_kernel().name() << " copies a TensorList of "
+          << input_list.tensors().size()
+          << " elements because its input is shared";
   AllocatorAttributes attr;
   attr.set_on_host(true);
   TF_RETURN_IF_ERROR(
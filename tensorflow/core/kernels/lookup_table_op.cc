@@ -16,9 +16,13 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+#include <functional>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
@@ -26,7 +30,9 @@ limitations under the License.
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/prefetch.h"
 #include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace lookup {
@@ -36,7 +42,15 @@ std::string UniqueNodeName(const std::string& base) {
   return strings::StrCat(base, "/", counter.fetch_add(1), "/", random::New64());
 }
 
-// Lookup table that wraps an unordered_map, where the key and value data type
+// Returns the threads on which a table of `ctx` may import or export its
+// shards.
+thread::ThreadPool* TableWorkers(OpKernelContext* ctx) {
+  const DeviceBase::CpuWorkerThreads* worker_threads =
+      ctx->device()->tensorflow_cpu_worker_threads();
+  return worker_threads == nullptr ? nullptr : worker_threads->workers;
+}
+
+// Lookup table that wraps a ShardedHashMap, where the key and value data type
 // is specified. Each individual value must be a scalar. If vector values are
 // required, use MutableHashTableOfTensors.
 //
@@ -55,10 +69,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
  public:
   MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {}
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
               const Tensor& default_value) override {
@@ -70,69 +81,61 @@ class MutableHashTableOfScalars final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
+    table_.Find(key_values, [&](int64_t i, const V* value) {
       // is_full_size_default is true:
       //   Each key has an independent default value, key_values(i)
       //   corresponding uses default_flat(i) as its default value.
       //
       // is_full_size_default is false:
       //   All keys will share the default_flat(0) as default value.
-      value_values(i) = gtl::FindWithDefault(
-          table_, SubtleMustCopyIfIntegral(key_values(i)),
-          is_full_size_default ? default_flat(i) : default_flat(0));
-    }
+      if (value != nullptr) {
+        value_values(i) = *value;
+      } else {
+        value_values(i) =
+            is_full_size_default ? default_flat(i) : default_flat(0);
+      }
+    });
 
     return OkStatus();
   }
 
-  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values) {
+  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values,
+                  thread::ThreadPool* workers) {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat<V>();
 
-    mutex_lock l(mu_);
-    if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
-                          SubtleMustCopyIfIntegral(value_values(i)));
-    }
+    table_.Insert(
+        key_values, clear,
+        [&](int64_t i) { return SubtleMustCopyIfIntegral(value_values(i)); },
+        workers);
     return OkStatus();
   }
 
   Status Insert(OpKernelContext* ctx, const Tensor& keys,
                 const Tensor& values) override {
-    return DoInsert(false, keys, values);
+    return DoInsert(false, keys, values, /*workers=*/nullptr);
   }
 
   Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
-    const auto key_values = keys.flat<K>();
-
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.Remove(keys.flat<K>());
     return OkStatus();
   }
 
   Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
                       const Tensor& values) override {
-    return DoInsert(true, keys, values);
+    return DoInsert(true, keys, values, TableWorkers(ctx));
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-
     Tensor* keys;
     Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("values", TensorShape({size}), &values));
-    ExportKeysAndValues(keys, values);
-    return OkStatus();
+    return ExportKeysAndValues(
+        [&](int64_t size) {
+          TF_RETURN_IF_ERROR(
+              ctx->allocate_output("keys", TensorShape({size}), &keys));
+          return ctx->allocate_output("values", TensorShape({size}), &values);
+        },
+        &keys, &values, TableWorkers(ctx));
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -144,25 +147,21 @@ class MutableHashTableOfScalars final : public LookupInterface {
   TensorShape value_shape() const override { return TensorShape(); }
 
   int64_t MemoryUsed() const override {
-    int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
-      }
-    }
-    return sizeof(MutableHashTableOfScalars) + ret;
+    return sizeof(MutableHashTableOfScalars) + table_.MemoryUsed();
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    Tensor keys(key_dtype(), TensorShape({size}));
-    Tensor values(value_dtype(), TensorShape({size}));
-    ExportKeysAndValues(&keys, &values);
+    Tensor keys;
+    Tensor values;
+    Tensor* keys_ptr = &keys;
+    Tensor* values_ptr = &values;
+    TF_RETURN_IF_ERROR(ExportKeysAndValues(
+        [&](int64_t size) {
+          keys = Tensor(key_dtype(), TensorShape({size}));
+          values = Tensor(value_dtype(), TensorShape({size}));
+          return OkStatus();
+        },
+        &keys_ptr, &values_ptr, /*workers=*/nullptr));
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableV2 kernel. This means that the lifetime
@@ -195,24 +194,30 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
-    auto keys_data = keys->flat<K>();
-    auto values_data = values->flat<V>();
-    int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      keys_data(i) = it->first;
-      values_data(i) = it->second;
-    }
+  // Calls `allocate(size)` to set `*keys` and `*values` to tensors of the size
+  // of the table, and writes all keys and values into them.
+  Status ExportKeysAndValues(const std::function<Status(int64_t)>& allocate,
+                             Tensor** keys, Tensor** values,
+                             thread::ThreadPool* workers) const {
+    return table_.Export(
+        allocate,
+        [keys, values](int64_t offset,
+                       const typename ShardedHashMap<K, V>::Map& map) {
+          auto keys_data = (*keys)->flat<K>();
+          auto values_data = (*values)->flat<V>();
+          int64_t i = offset;
+          for (auto it = map.begin(); it != map.end(); ++it, ++i) {
+            keys_data(i) = it->first;
+            values_data(i) = it->second;
+          }
+        },
+        workers);
   }
 
-  mutable mutex mu_;
-  std::unordered_map<K, V> table_ TF_GUARDED_BY(mu_);
+  ShardedHashMap<K, V> table_;
 };
 
-// Lookup table that wraps an unordered_map. Behaves identical to
+// Lookup table that wraps a ShardedHashMap. Behaves identical to
 // MutableHashTableOfScalars except that each value must be a vector.
 template <class K, class V>
 class MutableHashTableOfTensors final : public LookupInterface {
@@ -226,10 +231,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
                                 value_shape_.DebugString()));
   }
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
               const Tensor& default_value) override {
@@ -242,10 +244,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      ValueArray* value_vec =
-          gtl::FindOrNull(table_, SubtleMustCopyIfIntegral(key_values(i)));
+    table_.Find(key_values, [&](int64_t i, const ValueArray* value_vec) {
       if (value_vec != nullptr) {
         for (int64_t j = 0; j < value_dim; j++) {
           value_values(i, j) = value_vec->at(j);
@@ -262,65 +261,59 @@ class MutableHashTableOfTensors final : public LookupInterface {
               is_full_size_default ? default_flat(i, j) : default_flat(0, j);
         }
       }
-    }
+    });
 
     return OkStatus();
   }
 
-  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values) {
+  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values,
+                  thread::ThreadPool* workers) {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat_inner_dims<V, 2>();
     int64_t value_dim = value_shape_.dim_size(0);
 
-    mutex_lock l(mu_);
-    if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      ValueArray value_vec;
-      for (int64_t j = 0; j < value_dim; j++) {
-        V value = value_values(i, j);
-        value_vec.push_back(value);
-      }
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
-                          value_vec);
-    }
+    table_.Insert(
+        key_values, clear,
+        [&](int64_t i) {
+          ValueArray value_vec;
+          for (int64_t j = 0; j < value_dim; j++) {
+            V value = value_values(i, j);
+            value_vec.push_back(value);
+          }
+          return value_vec;
+        },
+        workers);
     return OkStatus();
   }
 
   Status Insert(OpKernelContext* ctx, const Tensor& keys,
                 const Tensor& values) override {
-    return DoInsert(false, keys, values);
+    return DoInsert(false, keys, values, /*workers=*/nullptr);
   }
 
   Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
-    const auto key_values = keys.flat<K>();
-
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.Remove(keys.flat<K>());
     return OkStatus();
   }
 
   Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
                       const Tensor& values) override {
-    return DoInsert(true, keys, values);
+    return DoInsert(true, keys, values, TableWorkers(ctx));
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
     int64_t value_dim = value_shape_.dim_size(0);
 
     Tensor* keys;
     Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(ctx->allocate_output(
-        "values", TensorShape({size, value_dim}), &values));
-    ExportKeysAndValues(keys, values);
-    return OkStatus();
+    return ExportKeysAndValues(
+        [&](int64_t size) {
+          TF_RETURN_IF_ERROR(
+              ctx->allocate_output("keys", TensorShape({size}), &keys));
+          return ctx->allocate_output(
+              "values", TensorShape({size, value_dim}), &values);
+        },
+        &keys, &values, TableWorkers(ctx));
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -332,25 +325,22 @@ class MutableHashTableOfTensors final : public LookupInterface {
   TensorShape value_shape() const override { return value_shape_; }
 
   int64_t MemoryUsed() const override {
-    int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
-      }
-    }
-    return sizeof(MutableHashTableOfTensors) + ret;
+    return sizeof(MutableHashTableOfTensors) + table_.MemoryUsed();
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    Tensor keys(key_dtype(), TensorShape({size}));
-    Tensor values(value_dtype(), TensorShape({size, value_shape_.dim_size(0)}));
-    ExportKeysAndValues(&keys, &values);
+    Tensor keys;
+    Tensor values;
+    Tensor* keys_ptr = &keys;
+    Tensor* values_ptr = &values;
+    TF_RETURN_IF_ERROR(ExportKeysAndValues(
+        [&](int64_t size) {
+          keys = Tensor(key_dtype(), TensorShape({size}));
+          values = Tensor(value_dtype(),
+                          TensorShape({size, value_shape_.dim_size(0)}));
+          return OkStatus();
+        },
+        &keys_ptr, &values_ptr, /*workers=*/nullptr));
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableOfTensorsV2 kernel. This means that the
@@ -384,28 +374,35 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  typedef gtl::InlinedVector<V, 4> ValueArray;
+
+  // Calls `allocate(size)` to set `*keys` and `*values` to tensors of the size
+  // of the table, and writes all keys and values into them.
+  Status ExportKeysAndValues(const std::function<Status(int64_t)>& allocate,
+                             Tensor** keys, Tensor** values,
+                             thread::ThreadPool* workers) const {
     int64_t value_dim = value_shape_.dim_size(0);
-    auto keys_data = keys->flat<K>();
-    auto values_data = values->matrix<V>();
-    int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      K key = it->first;
-      ValueArray value = it->second;
-      keys_data(i) = key;
-      for (int64_t j = 0; j < value_dim; j++) {
-        values_data(i, j) = value[j];
-      }
-    }
+    return table_.Export(
+        allocate,
+        [keys, values, value_dim](
+            int64_t offset,
+            const typename ShardedHashMap<K, ValueArray>::Map& map) {
+          auto keys_data = (*keys)->flat<K>();
+          auto values_data = (*values)->matrix<V>();
+          int64_t i = offset;
+          for (auto it = map.begin(); it != map.end(); ++it, ++i) {
+            keys_data(i) = it->first;
+            const ValueArray& value = it->second;
+            for (int64_t j = 0; j < value_dim; j++) {
+              values_data(i, j) = value[j];
+            }
+          }
+        },
+        workers);
   }
 
   TensorShape value_shape_;
-  mutable mutex mu_;
-  typedef gtl::InlinedVector<V, 4> ValueArray;
-  std::unordered_map<K, ValueArray> table_ TF_GUARDED_BY(mu_);
+  ShardedHashMap<K, ValueArray> table_;
 };
 
 namespace {
@@ -431,6 +428,13 @@ TensorShape MaybeVectorizeShape(const TensorShape& shape) {
 template <class K, class V>
 class MutableDenseHashTable final : public LookupInterface {
  public:
+  // The tags of the empty and deleted buckets. The tags of the used buckets
+  // have their high bit set.
+  static constexpr uint8 kEmptyBucket = 0;
+  static constexpr uint8 kDeletedBucket = 1;
+  // How many keys ahead of the probed one Find() prefetches the buckets of.
+  static constexpr int64_t kFindPrefetchDistance = 8;
+
   MutableDenseHashTable(OpKernelContext* ctx, OpKernel* kernel) {
     OP_REQUIRES_OK(
         ctx, GetNodeAttr(kernel->def(), "max_load_factor", &max_load_factor_));
@@ -511,16 +515,14 @@ class MutableDenseHashTable final : public LookupInterface {
     const auto key_matrix = key.shaped<K, 2>({num_elements, key_size});
     auto value_matrix = value->shaped<V, 2>({num_elements, value_size});
     const auto default_flat = default_value.flat<V>();
-
-    tf_shared_lock l(mu_);
-    const auto key_buckets_matrix = key_buckets_.template matrix<K>();
-    const auto value_buckets_matrix = value_buckets_.template matrix<V>();
     const auto empty_key_matrix =
         empty_key_.template shaped<K, 2>({1, key_size});
     const auto deleted_key_matrix =
         deleted_key_.template shaped<K, 2>({1, key_size});
-    const int64_t bit_mask = num_buckets_ - 1;
-    // TODO(andreasst): parallelize using work_sharder
+
+    // Hash the whole batch up front, so that the buckets of the keys a few
+    // positions ahead can be prefetched while probing for the current one.
+    std::vector<uint64> key_hashes(num_elements);
     for (int64_t i = 0; i < num_elements; ++i) {
       const uint64 key_hash = HashKey(key_matrix, i);
       if (empty_key_hash_ == key_hash &&
@@ -533,10 +535,26 @@ class MutableDenseHashTable final : public LookupInterface {
         return errors::InvalidArgument(
             "Using the deleted_key as a table key is not allowed");
       }
+      key_hashes[i] = key_hash;
+    }
+
+    tf_shared_lock l(mu_);
+    const auto key_buckets_matrix = key_buckets_.template matrix<K>();
+    const auto value_buckets_matrix = value_buckets_.template matrix<V>();
+    const int64_t bit_mask = num_buckets_ - 1;
+    // TODO(andreasst): parallelize using work_sharder
+    for (int64_t i = 0; i < num_elements; ++i) {
+      if (i + kFindPrefetchDistance < num_elements) {
+        PrefetchBucket(key_hashes[i + kFindPrefetchDistance] & bit_mask);
+      }
+      const uint64 key_hash = key_hashes[i];
+      const uint8 tag = BucketTag(key_hash);
       int64_t bucket_index = key_hash & bit_mask;
       int64_t num_probes = 0;
       while (true) {
-        if (IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
+        const uint8 bucket_tag = bucket_tags_[bucket_index];
+        if (bucket_tag == tag &&
+            IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
           for (int64_t j = 0; j < value_size; ++j) {
             // TODO(andreasst): check if we can get rid of SubtleMustCopy
             // here and elsewhere in this file.
@@ -545,7 +563,7 @@ class MutableDenseHashTable final : public LookupInterface {
           }
           break;
         }
-        if (IsEqualKey(key_buckets_matrix, bucket_index, empty_key_matrix, 0)) {
+        if (bucket_tag == kEmptyBucket) {
           for (int64_t j = 0; j < value_size; ++j) {
             value_matrix(i, j) = SubtleMustCopyIfIntegral(default_flat(j));
           }
@@ -617,11 +635,18 @@ class MutableDenseHashTable final : public LookupInterface {
     const auto deleted_key_tensor =
         deleted_key_.template shaped<K, 2>({1, key_shape_.num_elements()});
     const auto key_buckets_tensor = key_buckets_.template matrix<K>();
+    const auto keys_matrix = keys.template matrix<K>();
+    bucket_tags_.assign(num_buckets_, kEmptyBucket);
     for (int64_t i = 0; i < num_buckets_; ++i) {
-      if (!IsEqualKey(key_buckets_tensor, i, empty_key_tensor, 0) &&
-          !IsEqualKey(key_buckets_tensor, i, deleted_key_tensor, 0)) {
-        ++num_entries_;
+      if (IsEqualKey(key_buckets_tensor, i, empty_key_tensor, 0)) {
+        continue;
       }
+      if (IsEqualKey(key_buckets_tensor, i, deleted_key_tensor, 0)) {
+        bucket_tags_[i] = kDeletedBucket;
+        continue;
+      }
+      bucket_tags_[i] = BucketTag(HashKey(keys_matrix, i));
+      ++num_entries_;
     }
     return OkStatus();
   }
@@ -669,7 +694,8 @@ class MutableDenseHashTable final : public LookupInterface {
   int64_t MemoryUsed() const override TF_LOCKS_EXCLUDED(mu_) {
     tf_shared_lock l(mu_);
     return sizeof(MutableDenseHashTable) + key_buckets_.AllocatedBytes() +
-           value_buckets_.AllocatedBytes() + empty_key_.AllocatedBytes();
+           value_buckets_.AllocatedBytes() + empty_key_.AllocatedBytes() +
+           bucket_tags_.capacity();
   }
 
  private:
@@ -707,20 +733,22 @@ class MutableDenseHashTable final : public LookupInterface {
         return errors::InvalidArgument(
             "Using the deleted_key as a table key is not allowed");
       }
+      const uint8 tag = BucketTag(key_hash);
       int64_t bucket_index = key_hash & bit_mask;
       int64_t num_probes = 0;
       while (true) {
-        if (IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
+        const uint8 bucket_tag = bucket_tags_[bucket_index];
+        if (bucket_tag == tag &&
+            IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
           for (int64_t j = 0; j < value_size; ++j) {
             value_buckets_matrix(bucket_index, j) =
                 SubtleMustCopyIfIntegral(value_matrix(i, j));
           }
           break;
         }
-        if (IsEqualKey(key_buckets_matrix, bucket_index, empty_key_tensor, 0) ||
-            IsEqualKey(key_buckets_matrix, bucket_index, deleted_key_tensor,
-                       0)) {
+        if (bucket_tag == kEmptyBucket || bucket_tag == kDeletedBucket) {
           ++num_entries_;
+          bucket_tags_[bucket_index] = tag;
           for (int64_t j = 0; j < key_size; ++j) {
             key_buckets_matrix(bucket_index, j) =
                 SubtleMustCopyIfIntegral(key_matrix(i, j));
@@ -768,18 +796,22 @@ class MutableDenseHashTable final : public LookupInterface {
         return errors::InvalidArgument(
             "Using the deleted_key as a table key is not allowed");
       }
+      const uint8 tag = BucketTag(key_hash);
       int64_t bucket_index = key_hash & bit_mask;
       int64_t num_probes = 0;
       while (true) {
-        if (IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
+        const uint8 bucket_tag = bucket_tags_[bucket_index];
+        if (bucket_tag == tag &&
+            IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
           --num_entries_;
+          bucket_tags_[bucket_index] = kDeletedBucket;
           for (int64_t j = 0; j < key_size; ++j) {
             key_buckets_matrix(bucket_index, j) =
                 SubtleMustCopyIfIntegral(deleted_key_flat(j));
           }
           break;
         }
-        if (IsEqualKey(key_buckets_matrix, bucket_index, empty_key_tensor, 0)) {
+        if (bucket_tag == kEmptyBucket) {
           break;
         }
         ++num_probes;
@@ -815,6 +847,7 @@ class MutableDenseHashTable final : public LookupInterface {
         key_buckets_matrix(i, j) = empty_key_flat(j);
       }
     }
+    bucket_tags_.assign(num_buckets_, kEmptyBucket);
 
     const int64_t value_size = value_shape_.num_elements();
 
@@ -840,6 +873,23 @@ class MutableDenseHashTable final : public LookupInterface {
     return DoInsert(ctx, old_key_buckets, old_value_buckets, true);
   }
 
+  // The tag of a bucket holding a key with hash `key_hash`. HashScalar is the
+  // identity for integers, so the hash is mixed before taking its top bits.
+  static uint8 BucketTag(uint64 key_hash) {
+    return 0x80 | static_cast<uint8>((key_hash * 0x9E3779B97F4A7C15ULL) >> 57);
+  }
+
+  void PrefetchBucket(int64_t bucket_index) const
+      TF_SHARED_LOCKS_REQUIRED(mu_) {
+    port::prefetch<port::PREFETCH_HINT_T0>(&bucket_tags_[bucket_index]);
+    port::prefetch<port::PREFETCH_HINT_T0>(
+        key_buckets_.template flat<K>().data() +
+        bucket_index * key_shape_.num_elements());
+    port::prefetch<port::PREFETCH_HINT_T0>(
+        value_buckets_.template flat<V>().data() +
+        bucket_index * value_shape_.num_elements());
+  }
+
   uint64 HashKey(typename TTypes<K>::ConstMatrix key, int64_t index) const {
     if (key_shape_.num_elements() == 1) {
       return HashScalar(key(index, 0));
@@ -872,6 +922,10 @@ class MutableDenseHashTable final : public LookupInterface {
   int64_t num_buckets_ TF_GUARDED_BY(mu_);
   Tensor key_buckets_ TF_GUARDED_BY(mu_);
   Tensor value_buckets_ TF_GUARDED_BY(mu_);
+  // One byte per bucket, probed before the key of the bucket is compared:
+  // kEmptyBucket, kDeletedBucket, or BucketTag() of the hash of its key. The
+  // tags are derived from key_buckets_ and are not exported.
+  std::vector<uint8> bucket_tags_ TF_GUARDED_BY(mu_);
   Tensor empty_key_;
   uint64 empty_key_hash_;
   Tensor deleted_key_;
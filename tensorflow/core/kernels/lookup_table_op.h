@@ -16,6 +16,12 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_LOOKUP_TABLE_OP_H_
 #define TENSORFLOW_CORE_KERNELS_LOOKUP_TABLE_OP_H_
 
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/lookup_interface.h"
@@ -30,7 +36,9 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 
@@ -200,6 +208,267 @@ inline const ResourceHandle& SubtleMustCopyIfIntegral(
 // Returns a unique node name starting with "base".
 std::string UniqueNodeName(const std::string& base);
 
+// A hash map split into shards guarded by their own lock, so that the
+// lookups and updates of keys of different shards don't contend. The batch
+// operations sort the keys by shard first, and then hold the locks of all the
+// shards the keys fall into for the whole batch, so that the batches are
+// atomic: a lookup or an export sees either none or all of an update. The
+// locks are always taken in shard order, which keeps the batches free of
+// deadlocks.
+template <class K, class V>
+class ShardedHashMap {
+ public:
+  typedef std::unordered_map<K, V> Map;
+
+  static constexpr int kNumShardBits = 4;
+  static constexpr int kNumShards = 1 << kNumShardBits;
+
+  // The tables with at least this many entries are imported and exported
+  // one shard per thread.
+  static constexpr int64_t kMinParallelEntries = 1 << 16;
+
+  size_t size() const {
+    size_t size = 0;
+    for (const Shard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      size += shard.map.size();
+    }
+    return size;
+  }
+
+  int64_t MemoryUsed() const {
+    int64_t ret = 0;
+    for (const Shard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      for (unsigned i = 0; i < shard.map.bucket_count(); ++i) {
+        size_t bucket_size = shard.map.bucket_size(i);
+        if (bucket_size == 0) {
+          ret++;
+        } else {
+          ret += bucket_size;
+        }
+      }
+    }
+    return ret;
+  }
+
+  // Calls `fn(i, value)` for each key `keys(i)`, where `value` is the value of
+  // the key or null if it is not in the map.
+  template <typename Fn>
+  void Find(typename TTypes<K>::ConstFlat keys, Fn fn) const {
+    const Batch batch(keys);
+    LockShared(batch);
+    for (int s = 0; s < kNumShards; ++s) {
+      const Map& map = ShardMap(s);
+      for (int64_t j = batch.begin(s); j < batch.end(s); ++j) {
+        fn(batch.index(j), gtl::FindOrNull(map, batch.key(keys, j)));
+      }
+    }
+    UnlockShared(batch);
+  }
+
+  // Maps each key `keys(i)` to `value_fn(i)`, replacing the current value of
+  // the key if any. The later keys win over the earlier equal ones. If
+  // `clear`, the map is first cleared, atomically with the update. Shards are
+  // updated in parallel on `workers` if it is not null.
+  template <typename Fn>
+  void Insert(typename TTypes<K>::ConstFlat keys, bool clear, Fn value_fn,
+              thread::ThreadPool* workers) {
+    const Batch batch(keys);
+    if (clear) {
+      // Don't let readers see the map partially cleared.
+      LockAll();
+      ForEachShard(workers, keys.size(), [&](int s) {
+        InsertIntoShard(s, batch, keys, /*clear=*/true, value_fn);
+      });
+      UnlockAll();
+      return;
+    }
+    Lock(batch);
+    for (int s = 0; s < kNumShards; ++s) {
+      InsertIntoShard(s, batch, keys, /*clear=*/false, value_fn);
+    }
+    Unlock(batch);
+  }
+
+  // Removes the keys `keys(i)` from the map, if present.
+  void Remove(typename TTypes<K>::ConstFlat keys) {
+    const Batch batch(keys);
+    Lock(batch);
+    for (int s = 0; s < kNumShards; ++s) {
+      Map& map = MutableShardMap(s);
+      for (int64_t j = batch.begin(s); j < batch.end(s); ++j) {
+        map.erase(batch.key(keys, j));
+      }
+    }
+    Unlock(batch);
+  }
+
+  // Calls `allocate(size)` with the number of entries of the map, then, if it
+  // succeeds, `export_shard(offset, map)` for each shard, where `offset` is
+  // the number of entries of the shards before it. The map doesn't change in
+  // between. Shards are exported in parallel on `workers` if it is not null.
+  Status Export(const std::function<Status(int64_t)>& allocate,
+                const std::function<void(int64_t, const Map&)>& export_shard,
+                thread::ThreadPool* workers) const {
+    LockAllShared();
+    int64_t offsets[kNumShards + 1];
+    offsets[0] = 0;
+    for (int s = 0; s < kNumShards; ++s) {
+      offsets[s + 1] = offsets[s] + ShardMap(s).size();
+    }
+    Status status = allocate(offsets[kNumShards]);
+    if (status.ok()) {
+      ForEachShard(workers, offsets[kNumShards],
+                   [&](int s) { export_shard(offsets[s], ShardMap(s)); });
+    }
+    UnlockAllShared();
+    return status;
+  }
+
+ private:
+  struct Shard {
+    mutable mutex mu;
+    Map map TF_GUARDED_BY(mu);
+  };
+
+  // The indices of a batch of keys, sorted by shard.
+  class Batch {
+   public:
+    explicit Batch(typename TTypes<K>::ConstFlat keys) : indices_(keys.size()) {
+      std::vector<uint8> shards(keys.size());
+      if (std::is_integral<K>::value) {
+        copies_.reserve(keys.size());
+      }
+      int64_t counts[kNumShards] = {};
+      for (int64_t i = 0; i < keys.size(); ++i) {
+        const K& key = SubtleMustCopyIfIntegral(keys(i));
+        shards[i] = ShardOf(key);
+        ++counts[shards[i]];
+        if (std::is_integral<K>::value) {
+          // Shard the keys of integral type on a copy, since the tensor may
+          // be updated asynchronously.
+          copies_.push_back(key);
+        }
+      }
+      begins_[0] = 0;
+      for (int s = 0; s < kNumShards; ++s) {
+        begins_[s + 1] = begins_[s] + counts[s];
+      }
+      int64_t next[kNumShards];
+      std::copy(begins_, begins_ + kNumShards, next);
+      for (int64_t i = 0; i < keys.size(); ++i) {
+        indices_[next[shards[i]]++] = i;
+      }
+    }
+
+    bool empty(int shard) const { return begin(shard) == end(shard); }
+    int64_t begin(int shard) const { return begins_[shard]; }
+    int64_t end(int shard) const { return begins_[shard + 1]; }
+
+    // Returns the index of the `j`-th key in shard order.
+    int64_t index(int64_t j) const { return indices_[j]; }
+
+    // Returns the `j`-th key in shard order.
+    const K& key(typename TTypes<K>::ConstFlat keys, int64_t j) const {
+      const int64_t i = indices_[j];
+      return copies_.empty() ? keys(i) : copies_[i];
+    }
+
+   private:
+    std::vector<int64_t> indices_;
+    std::vector<K> copies_;
+    int64_t begins_[kNumShards + 1];
+  };
+
+  static int ShardOf(const K& key) {
+    // Mix the hash, which is the identity for integers, so that the shards
+    // don't depend on the same bits as the buckets of the maps.
+    const uint64 hash = static_cast<uint64>(std::hash<K>()(key));
+    return (hash * 0x9E3779B97F4A7C15ULL) >> (64 - kNumShardBits);
+  }
+
+  // Calls `fn(shard)` for each shard, in parallel on `workers` if it is not
+  // null and the map has at least `kMinParallelEntries` entries.
+  template <typename Fn>
+  static void ForEachShard(thread::ThreadPool* workers, int64_t num_entries,
+                           Fn fn) {
+    if (workers == nullptr || num_entries < kMinParallelEntries) {
+      for (int s = 0; s < kNumShards; ++s) {
+        fn(s);
+      }
+      return;
+    }
+    workers->ParallelFor(kNumShards,
+                         /*cost_per_unit=*/num_entries / kNumShards * 100,
+                         [&fn](int64_t begin, int64_t end) {
+                           for (int64_t s = begin; s < end; ++s) {
+                             fn(s);
+                           }
+                         });
+  }
+
+  // Inserts the keys of `batch` falling into shard `s`, whose lock must be
+  // held.
+  template <typename Fn>
+  void InsertIntoShard(int s, const Batch& batch,
+                       typename TTypes<K>::ConstFlat keys, bool clear,
+                       Fn& value_fn) TF_NO_THREAD_SAFETY_ANALYSIS {
+    Map& map = shards_[s].map;
+    if (clear) {
+      map.clear();
+    }
+    for (int64_t j = batch.begin(s); j < batch.end(s); ++j) {
+      gtl::InsertOrUpdate(&map, batch.key(keys, j), value_fn(batch.index(j)));
+    }
+  }
+
+  const Map& ShardMap(int s) const TF_NO_THREAD_SAFETY_ANALYSIS {
+    return shards_[s].map;
+  }
+  Map& MutableShardMap(int s) TF_NO_THREAD_SAFETY_ANALYSIS {
+    return shards_[s].map;
+  }
+
+  // Locks the shards the keys of `batch` fall into, in order.
+  void Lock(const Batch& batch) TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int s = 0; s < kNumShards; ++s) {
+      if (!batch.empty(s)) shards_[s].mu.lock();
+    }
+  }
+  void Unlock(const Batch& batch) TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int s = kNumShards - 1; s >= 0; --s) {
+      if (!batch.empty(s)) shards_[s].mu.unlock();
+    }
+  }
+  void LockShared(const Batch& batch) const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int s = 0; s < kNumShards; ++s) {
+      if (!batch.empty(s)) shards_[s].mu.lock_shared();
+    }
+  }
+  void UnlockShared(const Batch& batch) const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int s = kNumShards - 1; s >= 0; --s) {
+      if (!batch.empty(s)) shards_[s].mu.unlock_shared();
+    }
+  }
+
+  // Locks all the shards, in order.
+  void LockAll() TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (Shard& shard : shards_) shard.mu.lock();
+  }
+  void UnlockAll() TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (Shard& shard : shards_) shard.mu.unlock();
+  }
+  void LockAllShared() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (const Shard& shard : shards_) shard.mu.lock_shared();
+  }
+  void UnlockAllShared() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (const Shard& shard : shards_) shard.mu.unlock_shared();
+  }
+
+  Shard shards_[kNumShards];
+};
+
 // Lookup table that wraps an flat_hash_map, where the key and value data type
 // is specified.
 //
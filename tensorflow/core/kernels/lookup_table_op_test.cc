@@ -0,0 +1,206 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/lookup_table_op.h"
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+using Map = ShardedHashMap<int64_t, int64_t>;
+
+Tensor Range(int64_t begin, int64_t end) {
+  Tensor keys(DT_INT64, TensorShape({end - begin}));
+  for (int64_t i = begin; i < end; ++i) {
+    keys.flat<int64_t>()(i - begin) = i;
+  }
+  return keys;
+}
+
+// Returns the value of each key of `keys`, or -1 for the missing keys.
+std::vector<int64_t> Find(const Map& map, const Tensor& keys) {
+  std::vector<int64_t> values(keys.NumElements());
+  map.Find(keys.flat<int64_t>(), [&values](int64_t i, const int64_t* value) {
+    values[i] = value == nullptr ? -1 : *value;
+  });
+  return values;
+}
+
+void Insert(Map& map, const Tensor& keys, int64_t value_offset,
+            bool clear = false, thread::ThreadPool* workers = nullptr) {
+  auto keys_flat = keys.flat<int64_t>();
+  map.Insert(
+      keys_flat, clear,
+      [&keys_flat, value_offset](int64_t i) {
+        return keys_flat(i) + value_offset;
+      },
+      workers);
+}
+
+// Returns the entries of `map`, checking that the shards are exported at
+// consecutive offsets.
+std::map<int64_t, int64_t> Export(const Map& map,
+                                  thread::ThreadPool* workers = nullptr) {
+  std::map<int64_t, int64_t> entries;
+  int64_t size = -1;
+  std::vector<int64_t> shard_offsets;
+  std::vector<int64_t> shard_sizes;
+  mutex mu;
+  TF_CHECK_OK(map.Export(
+      [&size](int64_t s) {
+        size = s;
+        return OkStatus();
+      },
+      [&](int64_t offset, const Map::Map& shard) {
+        mutex_lock l(mu);
+        shard_offsets.push_back(offset);
+        shard_sizes.push_back(shard.size());
+        entries.insert(shard.begin(), shard.end());
+      },
+      workers));
+  EXPECT_EQ(shard_offsets.size(), Map::kNumShards);
+  std::map<int64_t, int64_t> shard_size_at;
+  for (int i = 0; i < shard_offsets.size(); ++i) {
+    shard_size_at[shard_offsets[i]] += shard_sizes[i];
+  }
+  int64_t offset = 0;
+  for (const auto& [shard_offset, shard_size] : shard_size_at) {
+    EXPECT_EQ(shard_offset, offset);
+    offset += shard_size;
+  }
+  EXPECT_EQ(offset, size);
+  EXPECT_EQ(entries.size(), size);
+  return entries;
+}
+
+TEST(ShardedHashMapTest, InsertFindRemove) {
+  Map map;
+  const Tensor keys = Range(0, 1000);
+  Insert(map, keys, /*value_offset=*/10);
+  EXPECT_EQ(map.size(), 1000);
+
+  std::vector<int64_t> values = Find(map, Range(-5, 1005));
+  for (int64_t i = 0; i < values.size(); ++i) {
+    const int64_t key = i - 5;
+    EXPECT_EQ(values[i], key >= 0 && key < 1000 ? key + 10 : -1);
+  }
+
+  const Tensor removed = Range(0, 500);
+  map.Remove(removed.flat<int64_t>());
+  EXPECT_EQ(map.size(), 500);
+  values = Find(map, keys);
+  for (int64_t i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(values[i], i < 500 ? -1 : i + 10);
+  }
+}
+
+TEST(ShardedHashMapTest, LaterKeysWin) {
+  Map map;
+  const Tensor keys = test::AsTensor<int64_t>({7, 3, 7, 7});
+  map.Insert(
+      keys.flat<int64_t>(), /*clear=*/false,
+      [](int64_t i) { return i; }, /*workers=*/nullptr);
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_EQ(Find(map, test::AsTensor<int64_t>({3, 7})),
+            std::vector<int64_t>({1, 3}));
+}
+
+TEST(ShardedHashMapTest, InsertAndClear) {
+  Map map;
+  Insert(map, Range(0, 100), /*value_offset=*/0);
+  Insert(map, Range(50, 60), /*value_offset=*/1, /*clear=*/true);
+  EXPECT_EQ(map.size(), 10);
+  std::map<int64_t, int64_t> entries = Export(map);
+  ASSERT_EQ(entries.size(), 10);
+  for (const auto& [key, value] : entries) {
+    EXPECT_GE(key, 50);
+    EXPECT_LT(key, 60);
+    EXPECT_EQ(value, key + 1);
+  }
+}
+
+TEST(ShardedHashMapTest, ExportInParallel) {
+  thread::ThreadPool workers(Env::Default(), "test", 4);
+  const int64_t size = Map::kMinParallelEntries * 2;
+  Map map;
+  Insert(map, Range(0, size), /*value_offset=*/3, /*clear=*/true, &workers);
+  const std::map<int64_t, int64_t> entries = Export(map, &workers);
+  ASSERT_EQ(entries.size(), size);
+  for (const auto& [key, value] : entries) {
+    EXPECT_EQ(value, key + 3);
+  }
+}
+
+// Writers insert and remove the same keys with different values, while
+// readers check that they always see whole batches.
+TEST(ShardedHashMapTest, ConcurrentBatchesAreAtomic) {
+  constexpr int kNumKeys = 64;
+  constexpr int kNumWriters = 2;
+  constexpr int kNumIterations = 2000;
+  const Tensor keys = Range(0, kNumKeys);
+  Map map;
+  std::atomic<int> num_writers_done(0);
+  std::atomic<int64_t> num_partial_batches(0);
+  {
+    thread::ThreadPool threads(Env::Default(), "test", kNumWriters + 2);
+    for (int w = 0; w < kNumWriters; ++w) {
+      threads.Schedule([&, w]() {
+        for (int i = 0; i < kNumIterations; ++i) {
+          Insert(map, keys, /*value_offset=*/(w + 1) * kNumKeys * 10 + i);
+          if (i % 2 == 0) map.Remove(keys.flat<int64_t>());
+        }
+        ++num_writers_done;
+      });
+    }
+    threads.Schedule([&]() {
+      while (num_writers_done < kNumWriters) {
+        const std::vector<int64_t> values = Find(map, keys);
+        for (int i = 0; i < kNumKeys; ++i) {
+          const bool same_batch =
+              values[i] == -1 ? values[0] == -1 : values[i] - i == values[0];
+          if (!same_batch) ++num_partial_batches;
+        }
+      }
+    });
+    threads.Schedule([&]() {
+      while (num_writers_done < kNumWriters) {
+        const std::map<int64_t, int64_t> entries = Export(map);
+        if (entries.empty()) continue;
+        if (entries.size() != kNumKeys) ++num_partial_batches;
+        const int64_t offset = entries.begin()->second;
+        for (const auto& [key, value] : entries) {
+          if (value - key != offset) ++num_partial_batches;
+        }
+      }
+    });
+  }
+  EXPECT_EQ(num_partial_batches, 0);
+  EXPECT_EQ(map.size(), kNumKeys);
+}
+
+}  // namespace
+}  // namespace lookup
+}  // namespace tensorflow
@@ -0,0 +1,253 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/nn_ops.cc.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/gtl/top_n.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+namespace {
+
+// The queries are scored against the database one block of kBlockRows rows
+// at a time, kQueryTile queries at a time, so that the scores of a block stay
+// in cache while they are selected and the full score matrix never exists.
+constexpr int64_t kBlockRows = 1024;
+constexpr int64_t kQueryTile = 32;
+
+struct Candidate {
+  float score;
+  int32 index;
+};
+
+// Orders the candidates by decreasing score, then increasing index. NaN
+// scores come after all the others.
+struct BetterCandidate {
+  bool operator()(const Candidate& a, const Candidate& b) const {
+    const bool a_is_nan = std::isnan(a.score);
+    const bool b_is_nan = std::isnan(b.score);
+    if (a_is_nan != b_is_nan) return b_is_nan;
+    if (!a_is_nan && a.score != b.score) return a.score > b.score;
+    return a.index < b.index;
+  }
+};
+
+// Returns the `num_values` values at `block` as floats, converted into
+// `buffer` unless they are floats already.
+template <typename T>
+const float* BlockAsFloat(const T* block, int64_t num_values,
+                          std::vector<float>* buffer) {
+  buffer->resize(num_values);
+  std::transform(block, block + num_values, buffer->begin(),
+                 [](const T value) { return static_cast<float>(value); });
+  return buffer->data();
+}
+
+template <>
+const float* BlockAsFloat<float>(const float* block, int64_t num_values,
+                                 std::vector<float>* buffer) {
+  return block;
+}
+
+}  // namespace
+
+template <typename T>
+class MaxInnerProductTopKOp : public OpKernel {
+ public:
+  explicit MaxInnerProductTopKOp(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& queries = context->input(0);
+    const Tensor& database = context->input(1);
+    const Tensor& k_in = context->input(2);
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(queries.shape()),
+                errors::InvalidArgument("queries must be a matrix but has "
+                                        "shape ",
+                                        queries.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(database.shape()),
+                errors::InvalidArgument("database must be a matrix but has "
+                                        "shape ",
+                                        database.shape().DebugString()));
+    OP_REQUIRES(context, queries.dim_size(1) == database.dim_size(1),
+                errors::InvalidArgument(
+                    "queries and database must have the same number of "
+                    "columns, but have ",
+                    queries.dim_size(1), " and ", database.dim_size(1)));
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(k_in.shape()),
+                errors::InvalidArgument("k must be scalar, got shape ",
+                                        k_in.shape().DebugString()));
+    const int64_t num_queries = queries.dim_size(0);
+    const int64_t num_rows = database.dim_size(0);
+    const int64_t depth = queries.dim_size(1);
+    const int k = k_in.scalar<int32>()();
+    OP_REQUIRES(context, k >= 0,
+                errors::InvalidArgument("Need k >= 0, got ", k));
+    OP_REQUIRES(context, k <= num_rows,
+                errors::InvalidArgument("database must have at least k=", k,
+                                        " rows, but has ", num_rows));
+    OP_REQUIRES(context, num_rows <= std::numeric_limits<int32>::max(),
+                errors::InvalidArgument(
+                    "database must have at most 2^31 - 1 rows, but has ",
+                    num_rows));
+
+    Tensor* scores = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape({num_queries, k}), &scores));
+    Tensor* indices = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                1, TensorShape({num_queries, k}), &indices));
+    if (k == 0 || num_queries == 0) return;
+
+    // The work is split into tiles of queries times partitions of the blocks
+    // of the database. Each unit of work selects the top k of each of its
+    // queries among the rows of its partition, and the candidates of the
+    // partitions are merged afterwards. With few queries, the database is
+    // split into partitions so that all the threads have work.
+    const auto& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    const int64_t num_tiles = (num_queries + kQueryTile - 1) / kQueryTile;
+    const int64_t num_blocks = (num_rows + kBlockRows - 1) / kBlockRows;
+    const int64_t num_partitions = std::max<int64_t>(
+        1, std::min(num_blocks, worker_threads.num_threads / num_tiles));
+    // The candidates of query q in partition p.
+    std::vector<std::vector<Candidate>> candidates(num_queries *
+                                                   num_partitions);
+
+    const float* queries_data = queries.matrix<float>().data();
+    const T* database_data = database.matrix<T>().data();
+    auto SelectInPartition = [&](int64_t start_unit, int64_t limit_unit) {
+      using ConstMatrix =
+          Eigen::TensorMap<Eigen::Tensor<const float, 2, Eigen::RowMajor>>;
+      using Matrix = Eigen::TensorMap<Eigen::Tensor<float, 2, Eigen::RowMajor>>;
+      const Eigen::array<Eigen::IndexPair<Eigen::DenseIndex>, 1>
+          contract_dims = {Eigen::IndexPair<Eigen::DenseIndex>(1, 1)};
+      const BetterCandidate better;
+      const size_t filter_size = k;
+      std::vector<float> block_buffer;
+      std::vector<float> block_scores(kQueryTile * kBlockRows);
+      std::vector<gtl::TopN<Candidate, BetterCandidate>> filters;
+      for (int64_t unit = start_unit; unit < limit_unit; ++unit) {
+        const int64_t tile = unit / num_partitions;
+        const int64_t partition = unit % num_partitions;
+        const int64_t query_start = tile * kQueryTile;
+        const int64_t tile_size =
+            std::min(kQueryTile, num_queries - query_start);
+        const int64_t row_start =
+            num_blocks * partition / num_partitions * kBlockRows;
+        const int64_t row_limit =
+            std::min(num_rows, num_blocks * (partition + 1) / num_partitions *
+                                   kBlockRows);
+
+        filters.clear();
+        for (int64_t q = 0; q < tile_size; ++q) {
+          filters.emplace_back(filter_size, better);
+        }
+        // The worst candidate of each full filter, which the scores of the
+        // next rows must beat.
+        std::vector<Candidate> bottoms(tile_size);
+        ConstMatrix tile_queries(queries_data + query_start * depth, tile_size,
+                                 depth);
+        for (int64_t start = row_start; start < row_limit;
+             start += kBlockRows) {
+          const int64_t block_size = std::min(kBlockRows, row_limit - start);
+          ConstMatrix block(
+              BlockAsFloat(database_data + start * depth, block_size * depth,
+                           &block_buffer),
+              block_size, depth);
+          Matrix tile_scores(block_scores.data(), tile_size, block_size);
+          tile_scores = tile_queries.contract(block, contract_dims);
+          for (int64_t q = 0; q < tile_size; ++q) {
+            gtl::TopN<Candidate, BetterCandidate>& filter = filters[q];
+            const float* row_scores = block_scores.data() + q * block_size;
+            for (int64_t r = 0; r < block_size; ++r) {
+              const Candidate candidate{row_scores[r],
+                                        static_cast<int32>(start + r)};
+              if (filter.size() == filter_size &&
+                  !better(candidate, bottoms[q])) {
+                continue;
+              }
+              filter.push(candidate);
+              if (filter.size() == filter_size) {
+                bottoms[q] = filter.peek_bottom();
+              }
+            }
+          }
+        }
+        for (int64_t q = 0; q < tile_size; ++q) {
+          std::unique_ptr<std::vector<Candidate>> top_k(
+              filters[q].ExtractUnsorted());
+          candidates[(query_start + q) * num_partitions + partition] =
+              std::move(*top_k);
+        }
+      }
+    };
+    const int64_t rows_per_partition = num_rows / num_partitions + 1;
+    const int64_t unit_cost = rows_per_partition *
+                              std::min(kQueryTile, num_queries) *
+                              (2 * depth + 4);
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          num_tiles * num_partitions, unit_cost, SelectInPartition);
+
+    auto scores_matrix = scores->matrix<float>();
+    auto indices_matrix = indices->matrix<int32>();
+    auto MergePartitions = [&](int64_t start_query, int64_t limit_query) {
+      std::vector<Candidate> merged;
+      for (int64_t q = start_query; q < limit_query; ++q) {
+        merged.clear();
+        for (int64_t p = 0; p < num_partitions; ++p) {
+          const std::vector<Candidate>& partial =
+              candidates[q * num_partitions + p];
+          merged.insert(merged.end(), partial.begin(), partial.end());
+        }
+        std::partial_sort(merged.begin(), merged.begin() + k, merged.end(),
+                          BetterCandidate());
+        for (int i = 0; i < k; ++i) {
+          scores_matrix(q, i) = merged[i].score;
+          indices_matrix(q, i) = merged[i].index;
+        }
+      }
+    };
+    Shard(worker_threads.num_threads, worker_threads.workers, num_queries,
+          num_partitions * k * 20, MergePartitions);
+  }
+};
+
+#define REGISTER_KERNELS(T)                                  \
+  REGISTER_KERNEL_BUILDER(Name("MaxInnerProductTopK")        \
+                              .Device(DEVICE_CPU)            \
+                              .TypeConstraint<T>("T"),       \
+                          MaxInnerProductTopKOp<T>)
+
+TF_CALL_float(REGISTER_KERNELS);
+TF_CALL_bfloat16(REGISTER_KERNELS);
+TF_CALL_half(REGISTER_KERNELS);
+#undef REGISTER_KERNELS
+
+}  // namespace tensorflow
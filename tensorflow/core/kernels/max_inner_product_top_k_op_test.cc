@@ -0,0 +1,147 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class MaxInnerProductTopKOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(DataType database_type) {
+    TF_ASSERT_OK(NodeDefBuilder("mips", "MaxInnerProductTopK")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(database_type))
+                     .Input(FakeInput(DT_INT32))
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Checks the op against TopKV2(MatMul(queries, database^T), k) on small
+  // integers, whose inner products are exact and often tied.
+  template <typename T>
+  void RunAndCheck(int num_queries, int num_rows, int depth, int k) {
+    std::vector<float> queries(num_queries * depth);
+    std::vector<float> database(num_rows * depth);
+    for (int i = 0; i < num_queries * depth; ++i) {
+      queries[i] = (i * 7 + 3) % 5 - 2;
+    }
+    for (int i = 0; i < num_rows * depth; ++i) {
+      database[i] = (i * 13 + i / depth) % 7 - 3;
+    }
+    std::vector<T> database_values(database.begin(), database.end());
+    AddInputFromArray<float>(TensorShape({num_queries, depth}), queries);
+    AddInputFromArray<T>(TensorShape({num_rows, depth}), database_values);
+    AddInputFromArray<int32>(TensorShape({}), {k});
+    TF_ASSERT_OK(RunOpKernel());
+
+    Tensor expected_scores(DT_FLOAT, TensorShape({num_queries, k}));
+    Tensor expected_indices(DT_INT32, TensorShape({num_queries, k}));
+    std::vector<float> scores(num_rows);
+    std::vector<int32> order(num_rows);
+    for (int q = 0; q < num_queries; ++q) {
+      for (int r = 0; r < num_rows; ++r) {
+        scores[r] = 0;
+        for (int d = 0; d < depth; ++d) {
+          scores[r] += queries[q * depth + d] * database[r * depth + d];
+        }
+      }
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](int32 a, int32 b) {
+        return scores[a] > scores[b];
+      });
+      for (int i = 0; i < k; ++i) {
+        expected_scores.matrix<float>()(q, i) = scores[order[i]];
+        expected_indices.matrix<int32>()(q, i) = order[i];
+      }
+    }
+    test::ExpectTensorEqual<float>(*GetOutput(0), expected_scores);
+    test::ExpectTensorEqual<int32>(*GetOutput(1), expected_indices);
+  }
+};
+
+TEST_F(MaxInnerProductTopKOpTest, FewQueries) {
+  MakeOp(DT_FLOAT);
+  // The database spans several blocks, which are split across the threads.
+  RunAndCheck<float>(/*num_queries=*/3, /*num_rows=*/5000, /*depth=*/16,
+                     /*k=*/50);
+}
+
+TEST_F(MaxInnerProductTopKOpTest, ManyQueries) {
+  MakeOp(DT_FLOAT);
+  RunAndCheck<float>(/*num_queries=*/70, /*num_rows=*/2100, /*depth=*/8,
+                     /*k=*/10);
+}
+
+TEST_F(MaxInnerProductTopKOpTest, AllRows) {
+  MakeOp(DT_FLOAT);
+  RunAndCheck<float>(/*num_queries=*/2, /*num_rows=*/30, /*depth=*/4,
+                     /*k=*/30);
+}
+
+TEST_F(MaxInnerProductTopKOpTest, BFloat16Database) {
+  MakeOp(DT_BFLOAT16);
+  RunAndCheck<bfloat16>(/*num_queries=*/5, /*num_rows=*/3000, /*depth=*/16,
+                        /*k=*/20);
+}
+
+TEST_F(MaxInnerProductTopKOpTest, HalfDatabase) {
+  MakeOp(DT_HALF);
+  RunAndCheck<Eigen::half>(/*num_queries=*/5, /*num_rows=*/3000,
+                           /*depth=*/16, /*k=*/20);
+}
+
+TEST_F(MaxInnerProductTopKOpTest, ZeroK) {
+  MakeOp(DT_FLOAT);
+  RunAndCheck<float>(/*num_queries=*/2, /*num_rows=*/10, /*depth=*/4,
+                     /*k=*/0);
+}
+
+TEST_F(MaxInnerProductTopKOpTest, KLargerThanDatabase) {
+  MakeOp(DT_FLOAT);
+  AddInputFromArray<float>(TensorShape({1, 2}), {1, 2});
+  AddInputFromArray<float>(TensorShape({3, 2}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<int32>(TensorShape({}), {4});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(absl::StrContains(s.ToString(),
+                                "database must have at least k=4 rows"))
+      << s;
+}
+
+TEST_F(MaxInnerProductTopKOpTest, MismatchedDepth) {
+  MakeOp(DT_FLOAT);
+  AddInputFromArray<float>(TensorShape({1, 2}), {1, 2});
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<int32>(TensorShape({}), {1});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(absl::StrContains(
+      s.ToString(), "queries and database must have the same number of"))
+      << s;
+}
+
+}  // namespace
+}  // namespace tensorflow
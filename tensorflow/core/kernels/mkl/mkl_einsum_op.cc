@@ -214,15 +214,17 @@ class MklEinsum : public OpKernel {
     // where F and C denote the total (compacted) size of free and contract
     // dimensions, respectively.
     const int num_inputs = inputs.size();
+    const Labels contract_labels =
+        EinsumHelper::ChooseContractLabels(inputs, input_labels, label_types);
     OperandLabels free_labels(num_inputs);
     gtl::InlinedVector<Tensor, 2> inputs_reduced(num_inputs);
     gtl::InlinedVector<bool, 2> swap_free_and_contract(num_inputs);
     for (int i = 0; i < num_inputs; ++i) {
-      OP_REQUIRES_OK(ctx,
-                     EinsumHelper::ReduceOperand<Device, T>(
-                         ctx, inputs[i], label_types, input_label_counts[i],
-                         &input_labels[i], &free_labels[i],
-                         &swap_free_and_contract[i], &inputs_reduced[i]));
+      OP_REQUIRES_OK(ctx, EinsumHelper::ReduceOperand<Device, T>(
+                              ctx, inputs[i], label_types,
+                              input_label_counts[i], contract_labels,
+                              &input_labels[i], &free_labels[i],
+                              &swap_free_and_contract[i], &inputs_reduced[i]));
     }
 
     // After reduction, the inputs should be reshaped to Tensors suitable for
@@ -0,0 +1,395 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Kernels that compute over the rows of a ragged tensor, given by its values
+// and row_splits, without padding it to a dense tensor first. The rows are
+// independent and are computed in parallel.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/util/work_sharder.h"
+#include "tensorflow/tsl/platform/errors.h"
+
+namespace tensorflow {
+
+using errors::InvalidArgument;
+
+namespace {
+
+// Half-precision values are accumulated in float.
+template <typename T>
+struct Accumulator {
+  using type = T;
+};
+template <>
+struct Accumulator<Eigen::half> {
+  using type = float;
+};
+template <>
+struct Accumulator<bfloat16> {
+  using type = float;
+};
+
+// Checks that `row_splits` partitions `num_values` values into rows.
+template <typename SPLITS_TYPE>
+Status ValidateRowSplits(const Tensor& row_splits_in, int64_t num_values) {
+  if (row_splits_in.dims() != 1 || row_splits_in.NumElements() == 0) {
+    return InvalidArgument("rt_row_splits must be a non-empty vector, got ",
+                           row_splits_in.shape().DebugString());
+  }
+  const auto row_splits = row_splits_in.vec<SPLITS_TYPE>();
+  if (row_splits(0) != 0) {
+    return InvalidArgument("rt_row_splits must start with 0, got ",
+                           row_splits(0));
+  }
+  for (int64_t i = 1; i < row_splits.size(); ++i) {
+    if (row_splits(i) < row_splits(i - 1)) {
+      return InvalidArgument("rt_row_splits must be sorted, but ",
+                             row_splits(i), " follows ", row_splits(i - 1));
+    }
+  }
+  if (row_splits(row_splits.size() - 1) != num_values) {
+    return InvalidArgument("rt_row_splits must end with the number of values ",
+                           num_values, ", got ",
+                           row_splits(row_splits.size() - 1));
+  }
+  return OkStatus();
+}
+
+// Calls `work(start_row, end_row)` on shards of the `nrows` rows of a ragged
+// tensor with `num_values` values of `inner_size` elements.
+void ShardRows(OpKernelContext* context, int64_t nrows, int64_t num_values,
+               int64_t inner_size, int64_t cost_per_element,
+               const std::function<void(int64_t, int64_t)>& work) {
+  if (nrows == 0) return;
+  const int64_t cost_per_row = std::max<int64_t>(
+      1, num_values / nrows * inner_size * cost_per_element);
+  auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads->num_threads, worker_threads->workers, nrows,
+        cost_per_row, work);
+}
+
+}  // namespace
+
+template <typename T, typename SPLITS_TYPE>
+class RaggedReduceOp : public OpKernel {
+ public:
+  explicit RaggedReduceOp(OpKernelConstruction* context) : OpKernel(context) {
+    std::string reduction;
+    OP_REQUIRES_OK(context, context->GetAttr("reduction", &reduction));
+    if (reduction == "sum") {
+      reduction_ = Reduction::kSum;
+    } else if (reduction == "mean") {
+      reduction_ = Reduction::kMean;
+    } else if (reduction == "max") {
+      reduction_ = Reduction::kMax;
+    } else if (reduction == "min") {
+      reduction_ = Reduction::kMin;
+    } else {
+      context->CtxFailure(InvalidArgument("Unknown reduction ", reduction));
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    using Acc = typename Accumulator<T>::type;
+    const Tensor& values_in = context->input(0);
+    const Tensor& row_splits_in = context->input(1);
+    OP_REQUIRES(context, values_in.dims() >= 1,
+                InvalidArgument("rt_dense_values must have rank >= 1"));
+    const int64_t num_values = values_in.dim_size(0);
+    OP_REQUIRES_OK(context,
+                   ValidateRowSplits<SPLITS_TYPE>(row_splits_in, num_values));
+    const auto row_splits = row_splits_in.vec<SPLITS_TYPE>();
+    const int64_t nrows = row_splits.size() - 1;
+
+    TensorShape output_shape = values_in.shape();
+    output_shape.set_dim(0, nrows);
+    Tensor* output_out = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, output_shape, &output_out));
+    if (output_shape.num_elements() == 0) return;
+    const int64_t inner_size = output_shape.num_elements() / nrows;
+    const T* values = values_in.flat<T>().data();
+    T* output = output_out->flat<T>().data();
+
+    Acc init;
+    switch (reduction_) {
+      case Reduction::kMax:
+        init = Eigen::NumTraits<Acc>::lowest();
+        break;
+      case Reduction::kMin:
+        init = Eigen::NumTraits<Acc>::highest();
+        break;
+      default:
+        init = Acc(0);
+    }
+    const Reduction reduction = reduction_;
+    auto work = [&](int64_t start_row, int64_t end_row) {
+      std::vector<Acc> acc(inner_size);
+      for (int64_t row = start_row; row < end_row; ++row) {
+        std::fill(acc.begin(), acc.end(), init);
+        const int64_t begin = row_splits(row);
+        const int64_t end = row_splits(row + 1);
+        for (int64_t i = begin; i < end; ++i) {
+          const T* value = values + i * inner_size;
+          for (int64_t j = 0; j < inner_size; ++j) {
+            const Acc v = static_cast<Acc>(value[j]);
+            switch (reduction) {
+              case Reduction::kMax:
+                acc[j] = std::max(acc[j], v);
+                break;
+              case Reduction::kMin:
+                acc[j] = std::min(acc[j], v);
+                break;
+              default:
+                acc[j] += v;
+            }
+          }
+        }
+        if (reduction == Reduction::kMean && end > begin) {
+          const Acc count = static_cast<Acc>(end - begin);
+          for (Acc& a : acc) a /= count;
+        }
+        T* output_row = output + row * inner_size;
+        for (int64_t j = 0; j < inner_size; ++j) {
+          output_row[j] = static_cast<T>(acc[j]);
+        }
+      }
+    };
+    ShardRows(context, nrows, num_values, inner_size, /*cost_per_element=*/2,
+              work);
+  }
+
+ private:
+  enum class Reduction { kSum, kMean, kMax, kMin };
+  Reduction reduction_;
+};
+
+#define REGISTER_CPU_KERNEL_WITH_SPLITS(value_type, splits_type)       \
+  REGISTER_KERNEL_BUILDER(Name("RaggedReduce")                         \
+                              .Device(DEVICE_CPU)                      \
+                              .TypeConstraint<value_type>("T")         \
+                              .TypeConstraint<splits_type>("Tsplits"), \
+                          RaggedReduceOp<value_type, splits_type>);
+#define REGISTER_CPU_KERNEL(value_type)               \
+  REGISTER_CPU_KERNEL_WITH_SPLITS(value_type, int32); \
+  REGISTER_CPU_KERNEL_WITH_SPLITS(value_type, int64_t);
+TF_CALL_bfloat16(REGISTER_CPU_KERNEL);
+TF_CALL_half(REGISTER_CPU_KERNEL);
+TF_CALL_float(REGISTER_CPU_KERNEL);
+TF_CALL_double(REGISTER_CPU_KERNEL);
+TF_CALL_int32(REGISTER_CPU_KERNEL);
+TF_CALL_int64(REGISTER_CPU_KERNEL);
+#undef REGISTER_CPU_KERNEL
+#undef REGISTER_CPU_KERNEL_WITH_SPLITS
+
+// Each element of the inner dimensions is normalized independently over the
+// values of its row.
+template <typename T, typename SPLITS_TYPE>
+class RaggedSoftmaxOp : public OpKernel {
+ public:
+  using OpKernel::OpKernel;
+
+  void Compute(OpKernelContext* context) override {
+    using Acc = typename Accumulator<T>::type;
+    const Tensor& values_in = context->input(0);
+    const Tensor& row_splits_in = context->input(1);
+    OP_REQUIRES(context, values_in.dims() >= 1,
+                InvalidArgument("rt_dense_values must have rank >= 1"));
+    const int64_t num_values = values_in.dim_size(0);
+    OP_REQUIRES_OK(context,
+                   ValidateRowSplits<SPLITS_TYPE>(row_splits_in, num_values));
+    const auto row_splits = row_splits_in.vec<SPLITS_TYPE>();
+    const int64_t nrows = row_splits.size() - 1;
+
+    Tensor* output_out = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, values_in.shape(),
+                                                     &output_out));
+    if (values_in.NumElements() == 0) return;
+    const int64_t inner_size = values_in.NumElements() / num_values;
+    const T* values = values_in.flat<T>().data();
+    T* output = output_out->flat<T>().data();
+
+    auto work = [&](int64_t start_row, int64_t end_row) {
+      std::vector<Acc> max(inner_size);
+      std::vector<Acc> sum(inner_size);
+      for (int64_t row = start_row; row < end_row; ++row) {
+        const int64_t begin = row_splits(row);
+        const int64_t end = row_splits(row + 1);
+        std::fill(max.begin(), max.end(), Eigen::NumTraits<Acc>::lowest());
+        std::fill(sum.begin(), sum.end(), Acc(0));
+        for (int64_t i = begin; i < end; ++i) {
+          const T* value = values + i * inner_size;
+          for (int64_t j = 0; j < inner_size; ++j) {
+            max[j] = std::max(max[j], static_cast<Acc>(value[j]));
+          }
+        }
+        for (int64_t i = begin; i < end; ++i) {
+          const T* value = values + i * inner_size;
+          T* output_value = output + i * inner_size;
+          for (int64_t j = 0; j < inner_size; ++j) {
+            const Acc e = std::exp(static_cast<Acc>(value[j]) - max[j]);
+            sum[j] += e;
+            output_value[j] = static_cast<T>(e);
+          }
+        }
+        for (int64_t i = begin; i < end; ++i) {
+          T* output_value = output + i * inner_size;
+          for (int64_t j = 0; j < inner_size; ++j) {
+            output_value[j] =
+                static_cast<T>(static_cast<Acc>(output_value[j]) / sum[j]);
+          }
+        }
+      }
+    };
+    ShardRows(context, nrows, num_values, inner_size, /*cost_per_element=*/20,
+              work);
+  }
+};
+
+#define REGISTER_CPU_KERNEL_WITH_SPLITS(value_type, splits_type)       \
+  REGISTER_KERNEL_BUILDER(Name("RaggedSoftmax")                        \
+                              .Device(DEVICE_CPU)                      \
+                              .TypeConstraint<value_type>("T")         \
+                              .TypeConstraint<splits_type>("Tsplits"), \
+                          RaggedSoftmaxOp<value_type, splits_type>);
+#define REGISTER_CPU_KERNEL(value_type)               \
+  REGISTER_CPU_KERNEL_WITH_SPLITS(value_type, int32); \
+  REGISTER_CPU_KERNEL_WITH_SPLITS(value_type, int64_t);
+TF_CALL_bfloat16(REGISTER_CPU_KERNEL);
+TF_CALL_half(REGISTER_CPU_KERNEL);
+TF_CALL_float(REGISTER_CPU_KERNEL);
+TF_CALL_double(REGISTER_CPU_KERNEL);
+#undef REGISTER_CPU_KERNEL
+#undef REGISTER_CPU_KERNEL_WITH_SPLITS
+
+// Combines the embeddings of the ids of each row, like embedding_lookup_sparse
+// but without the SparseTensor and the gather of all the embeddings.
+template <typename T, typename INDEX_TYPE, typename SPLITS_TYPE>
+class RaggedEmbeddingLookupOp : public OpKernel {
+ public:
+  explicit RaggedEmbeddingLookupOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    std::string combiner;
+    OP_REQUIRES_OK(context, context->GetAttr("combiner", &combiner));
+    if (combiner == "sum") {
+      combiner_ = Combiner::kSum;
+    } else if (combiner == "mean") {
+      combiner_ = Combiner::kMean;
+    } else if (combiner == "sqrtn") {
+      combiner_ = Combiner::kSqrtn;
+    } else {
+      context->CtxFailure(InvalidArgument("Unknown combiner ", combiner));
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    using Acc = typename Accumulator<T>::type;
+    const Tensor& params_in = context->input(0);
+    const Tensor& ids_in = context->input(1);
+    const Tensor& row_splits_in = context->input(2);
+    OP_REQUIRES(context, params_in.dims() >= 1,
+                InvalidArgument("params must have rank >= 1"));
+    OP_REQUIRES(context, ids_in.dims() == 1,
+                InvalidArgument("ids must be a vector, got ",
+                                ids_in.shape().DebugString()));
+    const int64_t num_ids = ids_in.NumElements();
+    OP_REQUIRES_OK(context,
+                   ValidateRowSplits<SPLITS_TYPE>(row_splits_in, num_ids));
+    const auto row_splits = row_splits_in.vec<SPLITS_TYPE>();
+    const int64_t nrows = row_splits.size() - 1;
+    const int64_t vocab_size = params_in.dim_size(0);
+    const auto ids = ids_in.vec<INDEX_TYPE>();
+    for (int64_t i = 0; i < num_ids; ++i) {
+      OP_REQUIRES(context, ids(i) >= 0 && ids(i) < vocab_size,
+                  InvalidArgument("ids[", i, "] = ", ids(i),
+                                  " is not in [0, ", vocab_size, ")"));
+    }
+
+    TensorShape output_shape = params_in.shape();
+    output_shape.set_dim(0, nrows);
+    Tensor* output_out = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, output_shape, &output_out));
+    if (output_shape.num_elements() == 0) return;
+    const int64_t inner_size = output_shape.num_elements() / nrows;
+    const T* params = params_in.flat<T>().data();
+    T* output = output_out->flat<T>().data();
+
+    const Combiner combiner = combiner_;
+    auto work = [&](int64_t start_row, int64_t end_row) {
+      std::vector<Acc> acc(inner_size);
+      for (int64_t row = start_row; row < end_row; ++row) {
+        std::fill(acc.begin(), acc.end(), Acc(0));
+        const int64_t begin = row_splits(row);
+        const int64_t end = row_splits(row + 1);
+        for (int64_t i = begin; i < end; ++i) {
+          const T* embedding = params + ids(i) * inner_size;
+          for (int64_t j = 0; j < inner_size; ++j) {
+            acc[j] += static_cast<Acc>(embedding[j]);
+          }
+        }
+        if (combiner != Combiner::kSum && end > begin) {
+          const Acc count = static_cast<Acc>(end - begin);
+          const Acc scale = combiner == Combiner::kMean
+                                ? Acc(1) / count
+                                : Acc(1) / std::sqrt(count);
+          for (Acc& a : acc) a *= scale;
+        }
+        T* output_row = output + row * inner_size;
+        for (int64_t j = 0; j < inner_size; ++j) {
+          output_row[j] = static_cast<T>(acc[j]);
+        }
+      }
+    };
+    ShardRows(context, nrows, num_ids, inner_size, /*cost_per_element=*/2,
+              work);
+  }
+
+ private:
+  enum class Combiner { kSum, kMean, kSqrtn };
+  Combiner combiner_;
+};
+
+#define REGISTER_CPU_KERNEL_WITH_TYPES(value_type, index_type, splits_type) \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("RaggedEmbeddingLookup")                                         \
+          .Device(DEVICE_CPU)                                               \
+          .TypeConstraint<value_type>("T")                                  \
+          .TypeConstraint<index_type>("Tindices")                           \
+          .TypeConstraint<splits_type>("Tsplits"),                          \
+      RaggedEmbeddingLookupOp<value_type, index_type, splits_type>);
+#define REGISTER_CPU_KERNEL(value_type)                       \
+  REGISTER_CPU_KERNEL_WITH_TYPES(value_type, int32, int32);   \
+  REGISTER_CPU_KERNEL_WITH_TYPES(value_type, int32, int64_t); \
+  REGISTER_CPU_KERNEL_WITH_TYPES(value_type, int64_t, int32); \
+  REGISTER_CPU_KERNEL_WITH_TYPES(value_type, int64_t, int64_t);
+TF_CALL_bfloat16(REGISTER_CPU_KERNEL);
+TF_CALL_half(REGISTER_CPU_KERNEL);
+TF_CALL_float(REGISTER_CPU_KERNEL);
+TF_CALL_double(REGISTER_CPU_KERNEL);
+#undef REGISTER_CPU_KERNEL
+#undef REGISTER_CPU_KERNEL_WITH_TYPES
+
+}  // namespace tensorflow
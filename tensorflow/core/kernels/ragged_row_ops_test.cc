@@ -0,0 +1,171 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/shape_inference_testutil.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class RaggedRowOpsTest : public ::tensorflow::OpsTestBase {
+ protected:
+  void BuildRaggedReduceGraph(const std::string& reduction) {
+    TF_ASSERT_OK(NodeDefBuilder("tested_op", "RaggedReduce")
+                     .Input(FakeInput(DT_FLOAT))  // rt_dense_values
+                     .Input(FakeInput(DT_INT64))  // rt_row_splits
+                     .Attr("reduction", reduction)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  void BuildRaggedSoftmaxGraph() {
+    TF_ASSERT_OK(NodeDefBuilder("tested_op", "RaggedSoftmax")
+                     .Input(FakeInput(DT_FLOAT))  // rt_dense_values
+                     .Input(FakeInput(DT_INT32))  // rt_row_splits
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  void BuildRaggedEmbeddingLookupGraph(const std::string& combiner) {
+    TF_ASSERT_OK(NodeDefBuilder("tested_op", "RaggedEmbeddingLookup")
+                     .Input(FakeInput(DT_FLOAT))  // params
+                     .Input(FakeInput(DT_INT32))  // ids
+                     .Input(FakeInput(DT_INT64))  // rt_row_splits
+                     .Attr("combiner", combiner)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+TEST_F(RaggedRowOpsTest, ReduceSum) {
+  BuildRaggedReduceGraph("sum");
+  // rt = [[[1, 2], [3, 4]], [], [[5, 6]]]
+  AddInputFromArray<float>(TensorShape({3, 2}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<int64_t>(TensorShape({4}), {0, 2, 2, 3});
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<float>(
+      *GetOutput(0),
+      test::AsTensor<float>({4, 6, 0, 0, 5, 6}, TensorShape({3, 2})));
+}
+
+TEST_F(RaggedRowOpsTest, ReduceMean) {
+  BuildRaggedReduceGraph("mean");
+  AddInputFromArray<float>(TensorShape({3, 2}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<int64_t>(TensorShape({4}), {0, 2, 2, 3});
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<float>(
+      *GetOutput(0),
+      test::AsTensor<float>({2, 3, 0, 0, 5, 6}, TensorShape({3, 2})));
+}
+
+TEST_F(RaggedRowOpsTest, ReduceMax) {
+  BuildRaggedReduceGraph("max");
+  AddInputFromArray<float>(TensorShape({4}), {1, -2, 3, -4});
+  AddInputFromArray<int64_t>(TensorShape({4}), {0, 3, 3, 4});
+  TF_ASSERT_OK(RunOpKernel());
+  // Like unsorted_segment_max, the empty rows are the lowest value.
+  test::ExpectTensorEqual<float>(
+      *GetOutput(0),
+      test::AsTensor<float>({3, std::numeric_limits<float>::lowest(), -4}));
+}
+
+TEST_F(RaggedRowOpsTest, ReduceInvalidRowSplits) {
+  BuildRaggedReduceGraph("sum");
+  AddInputFromArray<float>(TensorShape({3}), {1, 2, 3});
+  AddInputFromArray<int64_t>(TensorShape({3}), {0, 2, 1});
+  EXPECT_TRUE(absl::StrContains(RunOpKernel().error_message(),
+                                "rt_row_splits must be sorted"));
+}
+
+TEST_F(RaggedRowOpsTest, ReduceRowSplitsDontMatchValues) {
+  BuildRaggedReduceGraph("sum");
+  AddInputFromArray<float>(TensorShape({3}), {1, 2, 3});
+  AddInputFromArray<int64_t>(TensorShape({3}), {0, 2, 4});
+  EXPECT_TRUE(absl::StrContains(RunOpKernel().error_message(),
+                                "must end with the number of values"));
+}
+
+TEST_F(RaggedRowOpsTest, Softmax) {
+  BuildRaggedSoftmaxGraph();
+  // rt = [[0, log(3)], [], [7]]
+  AddInputFromArray<float>(TensorShape({3}), {0, std::log(3.0f), 7});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 2, 2, 3});
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0), test::AsTensor<float>({0.25, 0.75, 1}), 1e-6);
+}
+
+TEST_F(RaggedRowOpsTest, EmbeddingLookupMean) {
+  BuildRaggedEmbeddingLookupGraph("mean");
+  AddInputFromArray<float>(TensorShape({3, 2}), {1, 2, 3, 4, 5, 6});
+  // ids = [[0, 2, 2], [], [1]]
+  AddInputFromArray<int32>(TensorShape({4}), {0, 2, 2, 1});
+  AddInputFromArray<int64_t>(TensorShape({4}), {0, 3, 3, 4});
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0),
+      test::AsTensor<float>({11.0f / 3, 14.0f / 3, 0, 0, 3, 4},
+                            TensorShape({3, 2})),
+      1e-6);
+}
+
+TEST_F(RaggedRowOpsTest, EmbeddingLookupSqrtn) {
+  BuildRaggedEmbeddingLookupGraph("sqrtn");
+  AddInputFromArray<float>(TensorShape({2, 1}), {3, 5});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 1, 0, 1});
+  AddInputFromArray<int64_t>(TensorShape({2}), {0, 4});
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorNear<float>(
+      *GetOutput(0), test::AsTensor<float>({8}, TensorShape({1, 1})), 1e-6);
+}
+
+TEST_F(RaggedRowOpsTest, EmbeddingLookupInvalidId) {
+  BuildRaggedEmbeddingLookupGraph("sum");
+  AddInputFromArray<float>(TensorShape({2, 1}), {3, 5});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 2});
+  AddInputFromArray<int64_t>(TensorShape({2}), {0, 2});
+  EXPECT_TRUE(absl::StrContains(RunOpKernel().error_message(),
+                                "ids[1] = 2 is not in [0, 2)"));
+}
+
+TEST(RaggedRowOpsShapeFnTest, RaggedReduce) {
+  ShapeInferenceTestOp op("RaggedReduce");
+  INFER_OK(op, "[?,2,3];[5]", "[4,d0_1,d0_2]");
+  INFER_OK(op, "?;?", "?");
+  INFER_ERROR("must be at least rank 1", op, "[];[5]");
+  INFER_ERROR("must be rank 1", op, "[3];[5,1]");
+}
+
+TEST(RaggedRowOpsShapeFnTest, RaggedEmbeddingLookup) {
+  ShapeInferenceTestOp op("RaggedEmbeddingLookup");
+  INFER_OK(op, "[100,8];[?];[5]", "[4,d0_1]");
+  INFER_ERROR("must be rank 1", op, "[100,8];[3,2];[5]");
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -20,6 +20,8 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/ragged_tensor_variant.h"
 
+#include <utility>
+
 namespace tensorflow {
 
 string RaggedTensorVariant::TypeName() const { return "RaggedTensorVariant"; }
@@ -40,13 +42,14 @@ void RaggedTensorVariant::Encode(VariantTensorData* data) const {
   *data->add_tensors() = values_;
 }
 
-bool RaggedTensorVariant::Decode(const VariantTensorData& data) {
-  if (data.tensors_size() < 1) {
+bool RaggedTensorVariant::Decode(VariantTensorData data) {
+  std::vector<Tensor>& tensors = *data.mutable_tensors();
+  if (tensors.empty()) {
     return false;
   }
-  nested_splits_.assign(data.tensors().begin(),
-                        std::prev(data.tensors().end()));
-  values_ = data.tensors().back();
+  values_ = std::move(tensors.back());
+  tensors.pop_back();
+  nested_splits_ = std::move(tensors);
   return true;
 }
 
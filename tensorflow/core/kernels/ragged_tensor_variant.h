@@ -44,7 +44,7 @@ class RaggedTensorVariant {
   string TypeName() const;
   string DebugString() const;
   void Encode(VariantTensorData* data) const;
-  bool Decode(const VariantTensorData& data);
+  bool Decode(VariantTensorData data);
 
   // The flat_values of the RaggedTensor.
   const Tensor& values() const { return values_; }
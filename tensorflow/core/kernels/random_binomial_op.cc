@@ -397,6 +397,7 @@ class RandomBinomialOp : public OpKernel {
     OP_REQUIRES_OK(ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &var));
 
     Tensor* var_tensor = var->tensor();
+    var->MarkAllRowsDirty();
     OP_REQUIRES(
         ctx, var_tensor->dtype() == STATE_ELEMENT_DTYPE,
         errors::InvalidArgument("dtype of RNG state variable must be ",
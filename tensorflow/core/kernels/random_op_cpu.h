@@ -21,6 +21,7 @@ limitations under the License.
 #include <algorithm>
 #include <cmath>
 #include <memory>
+#include <type_traits>
 
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -72,6 +73,33 @@ struct FillPhiloxRandom {
   }
 };
 
+// A generator that returns the same groups of random numbers as the
+// PhiloxRandom it wraps, but generates them kBatchSize at a time with
+// PhiloxRandom::GenerateBatch, which the compiler vectorizes. The wrapped
+// generator is ahead of this one, except after multiples of kBatchSize calls.
+template <int kBatchSize>
+class BatchedPhiloxRandom {
+ public:
+  using ResultType = PhiloxRandom::ResultType;
+  using ResultElementType = PhiloxRandom::ResultElementType;
+  static constexpr int kResultElementCount = PhiloxRandom::kResultElementCount;
+
+  explicit BatchedPhiloxRandom(PhiloxRandom* gen) : gen_(gen) {}
+
+  ResultType operator()() {
+    if (next_ == kBatchSize) {
+      gen_->GenerateBatch<kBatchSize>(batch_);
+      next_ = 0;
+    }
+    return batch_[next_++];
+  }
+
+ private:
+  PhiloxRandom* gen_;
+  ResultType batch_[kBatchSize];
+  int next_ = kBatchSize;
+};
+
 // A class to fill a specified range of random groups
 template <class Distribution, bool VariableSamplesPerOutput>
 struct FillPhiloxRandomTask;
@@ -81,6 +109,12 @@ struct FillPhiloxRandomTask;
 template <class Distribution>
 struct FillPhiloxRandomTask<Distribution, false> {
   typedef typename Distribution::ResultElementType T;
+  // The number of groups generated at once, for the distributions that can
+  // take their samples from a BatchedPhiloxRandom.
+  static constexpr int kBatchSize = 16;
+  static constexpr bool kCanBatch =
+      std::is_invocable_v<Distribution&, BatchedPhiloxRandom<kBatchSize>*>;
+
   static void Run(random::PhiloxRandom gen, T* data, int64_t size,
                   int64_t start_group, int64_t limit_group, Distribution dist) {
     const int kGroupSize = Distribution::kResultElementCount;
@@ -88,9 +122,21 @@ struct FillPhiloxRandomTask<Distribution, false> {
     gen.Skip(start_group);
     int64_t offset = start_group * kGroupSize;
 
-    // First fill all the full-size groups
+    // First fill all the full-size groups, whole batches of them at a time if
+    // possible.
     int64_t limit_group_full = std::min(limit_group, size / kGroupSize);
-    for (int64_t index = start_group; index < limit_group_full; ++index) {
+    int64_t index = start_group;
+    if constexpr (kCanBatch) {
+      BatchedPhiloxRandom<kBatchSize> batched_gen(&gen);
+      for (; index + kBatchSize <= limit_group_full; index += kBatchSize) {
+        for (int i = 0; i < kBatchSize; ++i) {
+          auto samples = dist(&batched_gen);
+          std::copy(&samples[0], &samples[0] + kGroupSize, data + offset);
+          offset += kGroupSize;
+        }
+      }
+    }
+    for (; index < limit_group_full; ++index) {
       auto samples = dist(&gen);
       std::copy(&samples[0], &samples[0] + kGroupSize, data + offset);
       offset += kGroupSize;
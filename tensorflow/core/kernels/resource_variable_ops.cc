@@ -53,6 +53,7 @@ limitations under the License.
 #include "tensorflow/core/platform/stream_executor.h"
 #endif
 
+#include <algorithm>
 #include <memory>
 #include <type_traits>
 #include <vector>
@@ -82,6 +83,7 @@ limitations under the License.
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/determinism.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/util.h"
 
 namespace tensorflow {
@@ -133,6 +135,34 @@ Status CopyVariable(int output_idx, OpKernelContext* ctx, const Tensor* t) {
   return OkStatus();
 }
 
+// Whether the dense reads of variables in copy-on-read mode return read
+// snapshots (see Var::ReadSnapshot()) instead of full copies.
+bool UseReadSnapshots() {
+  static const bool use_read_snapshots = [] {
+    bool value;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_RESOURCE_VARIABLE_READ_SNAPSHOTS",
+                                   /*default_val=*/false, &value));
+    return value;
+  }();
+  return use_read_snapshots;
+}
+
+// Sets the output `output_idx` to the value of `variable`, which is in
+// copy-on-read mode and locked.
+Status ReadCopyOnReadVariable(int output_idx, OpKernelContext* ctx,
+                              Var* variable) {
+  const Tensor* t = variable->tensor();
+  if (UseReadSnapshots() && ctx->op_device_context() == nullptr &&
+      DataTypeCanUseMemcpy(t->dtype())) {
+    Tensor snapshot;
+    TF_RETURN_IF_ERROR(variable->ReadSnapshot(
+        ctx->get_allocator(AllocatorAttributes()), &snapshot));
+    ctx->set_output(output_idx, snapshot);
+    return OkStatus();
+  }
+  return CopyVariable(output_idx, ctx, t);
+}
+
 }  // namespace
 
 void ReadVariableOp::Compute(OpKernelContext* ctx) {
@@ -160,7 +190,7 @@ void ReadVariableOp::Compute(OpKernelContext* ctx) {
             DataTypeString(dtype_), " got ", DataTypeString(t->dtype())));
     ctx->set_output(0, *t);
   } else {
-    OP_REQUIRES_OK(ctx, CopyVariable(0, ctx, t));
+    OP_REQUIRES_OK(ctx, ReadCopyOnReadVariable(0, ctx, variable.get()));
   }
 }
 
@@ -208,7 +238,7 @@ void ReadVariablesOp::Compute(OpKernelContext* ctx) {
                     " with wrong dtype. Expected ", DataTypeString(dtypes_[i]),
                     " got ", DataTypeString(variables[i]->tensor()->dtype())));
     if (variables[i]->copy_on_read_mode.load()) {
-      OP_REQUIRES_OK(ctx, CopyVariable(i, ctx, variables[i]->tensor()));
+      OP_REQUIRES_OK(ctx, ReadCopyOnReadVariable(i, ctx, variables[i].get()));
     } else {
       const Tensor& t = *variables[i]->tensor();
       ctx->set_output(i, t);
@@ -373,6 +403,7 @@ void DisableCopyOnReadOp::Compute(OpKernelContext* ctx) {
     // Obtain an exclusive lock on the variable and change the access mode
     mutex_lock ml(*variable->mu());
     variable->copy_on_read_mode.store(false);
+    variable->ReleaseReadSnapshot();
   }
 }
 
@@ -462,6 +493,7 @@ class AssignVariableOp : public OpKernel {
       *variable->tensor() = value;
     }
     variable->is_initialized = true;
+    variable->MarkAllRowsDirty();
   }
 
  private:
@@ -516,6 +548,7 @@ class AssignVariableOp<Device, Variant> : public OpKernel {
                     DataTypeString(variable->tensor()->dtype()), " got ",
                     DataTypeString(DT_VARIANT)));
     variable->is_initialized = true;
+    variable->MarkAllRowsDirty();
     *variable->tensor() = Tensor(DT_VARIANT, value.shape());
 
     if (input_alias) {
@@ -601,6 +634,7 @@ class AssignUpdateVariableOp : public OpKernel {
     functor::DenseUpdate<Device, T, Op> update_functor;
     update_functor(context->eigen_device<Device>(), var_tensor->flat<T>(),
                    value.flat<T>());
+    variable->MarkAllRowsDirty();
   }
 };
 
@@ -666,6 +700,44 @@ REGISTER_KERNEL_BUILDER(Name("VarIsInitializedOp")
                             .HostMemory("is_initialized"),
                         VarIsInitializedOp);
 
+class VariableDirtyRowsOp : public OpKernel {
+ public:
+  explicit VariableDirtyRowsOp(OpKernelConstruction* c) : OpKernel(c) {}
+
+  void Compute(OpKernelContext* context) override {
+    core::RefCountPtr<Var> variable;
+    OP_REQUIRES_OK(context,
+                   LookupResource(context, HandleFromInput(context, 0),
+                                  &variable));
+    int64_t num_rows;
+    {
+      tf_shared_lock ml(*variable->mu());
+      const Tensor& t = *variable->tensor();
+      OP_REQUIRES(context, t.dims() > 0,
+                  errors::InvalidArgument(
+                      "Variable of shape ", t.shape().DebugString(),
+                      " has no rows"));
+      num_rows = t.dim_size(0);
+    }
+    const std::vector<int64_t> rows = variable->TakeDirtyRows(num_rows);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({static_cast<int64_t>(rows.size())}),
+                       &output));
+    std::copy(rows.begin(), rows.end(), output->vec<int64_t>().data());
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("VariableDirtyRows").Device(DEVICE_CPU),
+                        VariableDirtyRowsOp);
+
+REGISTER_KERNEL_BUILDER(Name("VariableDirtyRows")
+                            .Device(DEVICE_DEFAULT)
+                            .HostMemory("resource")
+                            .HostMemory("rows"),
+                        VariableDirtyRowsOp);
+
 template <typename Device, typename T, typename Index>
 class ResourceGatherOp : public OpKernel {
  public:
@@ -1132,6 +1204,12 @@ class ResourceScatterUpdateOp : public OpKernel {
     if (N > 0) {
       OP_REQUIRES_OK(
           c, DoScatter<Device, T, Index, op>(c, params, indices, updates, N));
+      // The indices of the device kernels are in device memory.
+      if (isCPUDevice<Device>()) {
+        v->MarkRowsDirty(indices);
+      } else {
+        v->MarkAllRowsDirty();
+      }
     }
   }
 };
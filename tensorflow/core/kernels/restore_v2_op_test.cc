@@ -31,9 +31,11 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/public/version.h"
+#include "tensorflow/core/util/tensor_bundle/async_bundle_writer.h"
 
 namespace tensorflow {
 namespace {
@@ -356,5 +358,37 @@ TEST_F(RestoreV2OpTest, RestoreAfterSaveV2) { RunTest("SaveV2"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveSlicesV1) { RunTest("SaveSlices"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveV1) { RunTest("Save"); }
 
+TEST_F(RestoreV2OpTest, RestoreFromSeveralDataFiles) {
+  const string prefix = io::JoinPath(testing::TmpDir(), "several_data_files");
+  const int kNumTensors = 8;
+  std::vector<AsyncBundleWriter::Entry> entries(kNumTensors);
+  std::vector<tstring> names;
+  for (int i = 0; i < kNumTensors; ++i) {
+    entries[i].key = strings::StrCat("tensor_", i);
+    entries[i].tensor = MakeInput<float>(
+        TensorShape({i + 1}), [i](int x) -> float { return i * 100 + x; });
+    names.push_back(entries[i].key);
+  }
+  // Spreads the tensors over 3 data files.
+  TF_ASSERT_OK(AsyncBundleWriter::Write(Env::Default(), prefix, entries,
+                                        /*num_writers=*/3));
+
+  TF_ASSERT_OK(NodeDefBuilder("myop", "RestoreV2")
+                   .Input(FakeInput())
+                   .Input(FakeInput())
+                   .Input(FakeInput())
+                   .Attr("dtypes", DataTypeVector(kNumTensors, DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<tstring>(TensorShape({}), {prefix});
+  AddInputFromArray<tstring>(TensorShape({kNumTensors}), names);
+  AddInputFromArray<tstring>(TensorShape({kNumTensors}),
+                             std::vector<tstring>(kNumTensors, ""));
+  TF_ASSERT_OK(RunOpKernel());
+  for (int i = 0; i < kNumTensors; ++i) {
+    test::ExpectTensorEqual<float>(*GetOutput(i), entries[i].tensor);
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
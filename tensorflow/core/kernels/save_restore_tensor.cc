@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/save_restore_tensor.h"
 
+#include <map>
 #include <memory>
 #include <numeric>
 #include <unordered_map>
@@ -33,6 +34,8 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
+#include "tensorflow/core/util/tensor_bundle/shared_tensor_store.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -250,6 +253,20 @@ namespace {
 // Tensors larger than this threshold will be restored from a thread-pool.
 const int64_t kLargeShapeThreshold = 16 << 20;  // 16M
 
+// Whether full tensors are restored with BundleReader::LookupMapped(), i.e.
+// refer to the data files mapped into memory when they can, which the
+// processes restoring the same checkpoint share.  Set TF_MMAP_RESTORED_TENSORS
+// only for checkpoints whose tensors are not updated in place once restored,
+// like the variables of a model for inference: an update copies them first.
+bool MapRestoredTensors() {
+  static const bool map_restored_tensors = [] {
+    bool map;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_MMAP_RESTORED_TENSORS", false, &map));
+    return map;
+  }();
+  return map_restored_tensors;
+}
+
 // A restore operation for a single tensor.  Small tensors may be restored
 // directly from the op thread to improve read locality.  Large tensors can be
 // restored from a thread pool: this requires creating a separate BundleReader
@@ -272,6 +289,9 @@ struct RestoreOp {
   RestoreOp& operator=(RestoreOp&&) = default;
 
   bool should_run_in_pool(BundleReader* reader) const {
+    // Mapping a tensor reads none of it.
+    if (shape_and_slice.empty() && MapRestoredTensors()) return false;
+
     TensorShape restored_full_shape;
 
     // Ignore status here; we'll catch the error later.
@@ -301,7 +321,23 @@ struct RestoreOp {
     VLOG(1) << "Restoring tensor " << idx << " : " << tensor_name << " : "
             << restored_full_shape.num_elements();
     Tensor* restored_tensor;
-    if (shape_and_slice.empty()) {
+    SharedTensorStore* shared_store = SharedTensorStore::Global();
+    if (shape_and_slice.empty() && MapRestoredTensors()) {
+      // Lookup the full tensor, referring to its mapped data file if possible.
+      Tensor restored;
+      TF_RETURN_IF_ERROR(reader->LookupMapped(tensor_name, &restored));
+      context->set_output(idx, restored);
+      restored_tensor = context->mutable_output(idx);
+    } else if (shape_and_slice.empty() && shared_store != nullptr) {
+      // Lookup the full tensor, and output the one of the same contents other
+      // restores of the process hold, if any.
+      Tensor restored;
+      TF_RETURN_IF_ERROR(
+          context->allocate_temp(dtype, restored_full_shape, &restored));
+      TF_RETURN_IF_ERROR(reader->Lookup(tensor_name, &restored));
+      context->set_output(idx, shared_store->Intern(restored));
+      restored_tensor = context->mutable_output(idx);
+    } else if (shape_and_slice.empty()) {
       // Lookup the full tensor.
       TF_RETURN_IF_ERROR(
           context->allocate_output(idx, restored_full_shape, &restored_tensor));
@@ -412,16 +448,49 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     }
   }
 
+  // The small tensors of all but the first data file are restored from the
+  // thread pool too, with a reader per data file, so that the data files are
+  // read in parallel, each one sequentially.
+  std::map<int, std::vector<RestoreOp*>> shard_restore_ops;
+  std::vector<RestoreOp*> thread_restore_ops;
+  int first_shard_id = -1;
+  for (RestoreOp* op : direct_restore_ops) {
+    int shard_id;
+    TF_RETURN_IF_ERROR(
+        default_reader.LookupShardId(op->tensor_name, &shard_id));
+    if (first_shard_id < 0) first_shard_id = shard_id;
+    // Partitioned tensors stay on the op thread.
+    if (shard_id < 0 || shard_id == first_shard_id) {
+      thread_restore_ops.push_back(op);
+    } else {
+      shard_restore_ops[shard_id].push_back(op);
+    }
+  }
+  direct_restore_ops.swap(thread_restore_ops);
+  std::vector<Status> shard_statuses(shard_restore_ops.size());
+
   {
     // Schedule any threaded operations first, skipping thread pool creation if
     // we don't have any expensive operations.
     std::unique_ptr<thread::ThreadPool> reader_pool;
-    if (!pool_restore_ops.empty()) {
+    if (!pool_restore_ops.empty() || !shard_restore_ops.empty()) {
       reader_pool.reset(
           new thread::ThreadPool(Env::Default(), "restore_tensors", 8));
       for (auto* op : pool_restore_ops) {
         reader_pool->Schedule([op]() { op->run_with_new_reader(); });
       }
+      int i = 0;
+      for (const auto& shard : shard_restore_ops) {
+        const std::vector<RestoreOp*>* ops = &shard.second;
+        Status* status = &shard_statuses[i++];
+        reader_pool->Schedule([&prefix_string, ops, status]() {
+          BundleReader reader(Env::Default(), prefix_string);
+          *status = reader.status();
+          for (auto it = ops->begin(); status->ok() && it != ops->end(); ++it) {
+            *status = (*it)->run(&reader);
+          }
+        });
+      }
     }
 
     // Read small tensors from the op thread
@@ -434,6 +503,9 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
   for (auto* op : pool_restore_ops) {
     TF_RETURN_IF_ERROR(op->status);
   }
+  for (const Status& status : shard_statuses) {
+    TF_RETURN_IF_ERROR(status);
+  }
 
   for (const RestoreOp& restore_op : restore_ops) {
     if (restore_op.dtype != context->mutable_output(restore_op.idx)->dtype()) {
@@ -15,6 +15,7 @@ limitations under the License.
 
 // See docs in ../ops/io_ops.cc.
 
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -22,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/checkpoint_callback_manager.h"
@@ -31,7 +33,9 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
+#include "tensorflow/core/util/tensor_bundle/async_bundle_writer.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 
@@ -90,9 +94,29 @@ void ValidateInputs(bool is_save_op, OpKernelContext* context,
 }  // namespace
 
 // Saves a list of named tensors using the tensor bundle library.
+//
+// With TF_CHECKPOINT_WRITERS set, the tensors are written by as many writers
+// in parallel, to a bundle of as many data files. With TF_ASYNC_CHECKPOINT
+// set, the op returns once it has a snapshot of the tensors, which are
+// written in the background: WaitForSaveV2, RestoreV2 and MergeV2Checkpoints
+// wait for the save to their prefix, and a save fails with the error of an
+// earlier one. The checkpoint callbacks run once the checkpoint is written.
+// With TF_CHECKPOINT_DATA_ALIGNMENT set, the tensors are aligned to as many
+// bytes in the data files, e.g. for RestoreV2 to map them into memory.
 class SaveV2 : public OpKernel {
  public:
-  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {}
+  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context,
+                   ReadBoolFromEnvVar("TF_ASYNC_CHECKPOINT", false, &async_));
+    OP_REQUIRES_OK(context, ReadInt64FromEnvVar("TF_CHECKPOINT_WRITERS", 1,
+                                                &num_writers_));
+    OP_REQUIRES_OK(context, ReadInt64FromEnvVar("TF_CHECKPOINT_DATA_ALIGNMENT",
+                                                1, &data_alignment_));
+    OP_REQUIRES(context, data_alignment_ >= 1,
+                errors::InvalidArgument(
+                    "TF_CHECKPOINT_DATA_ALIGNMENT must be at least 1, got ",
+                    data_alignment_));
+  }
 
   void Compute(OpKernelContext* context) override {
     const Tensor& prefix = context->input(0);
@@ -108,15 +132,22 @@ class SaveV2 : public OpKernel {
     const auto& tensor_names_flat = tensor_names.flat<tstring>();
     const auto& shape_and_slices_flat = shape_and_slices.flat<tstring>();
 
-    BundleWriter writer(Env::Default(), prefix_string);
-    OP_REQUIRES_OK(context, writer.status());
     VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
 
+    std::vector<AsyncBundleWriter::Entry> entries(num_tensors);
     for (int i = 0; i < num_tensors; ++i) {
       const string& tensor_name = tensor_names_flat(i);
       const Tensor& tensor = context->input(i + kFixedInputs);
       VLOG(2) << "Starting save of " << tensor_name;
 
+      AsyncBundleWriter::Entry* entry = &entries[i];
+      entry->key = tensor_name;
+      // A tensor only referred to by this op, e.g. one copied from a device,
+      // cannot change under a background save, others may.
+      entry->tensor = async_ && !tensor.RefCountIsOne()
+                          ? tensor::DeepCopy(tensor)
+                          : tensor;
+
       if (!shape_and_slices_flat(i).empty()) {
         const string& shape_spec = shape_and_slices_flat(i);
         TensorShape shape;
@@ -132,10 +163,9 @@ class SaveV2 : public OpKernel {
                                             shape_spec, ", tensor: ",
                                             tensor.shape().DebugString()));
 
-        OP_REQUIRES_OK(context,
-                       writer.AddSlice(tensor_name, shape, slice, tensor));
-      } else {
-        OP_REQUIRES_OK(context, writer.Add(tensor_name, tensor));
+        entry->is_slice = true;
+        entry->full_shape = shape;
+        entry->slice = slice;
       }
 
       if (VLOG_IS_ON(5)) {
@@ -157,12 +187,10 @@ class SaveV2 : public OpKernel {
 
       VLOG(2) << "Done save of " << tensor_name;
     }
-    OP_REQUIRES_OK(context, writer.Finish());
-    VLOG(1) << "Done BundleWriter, prefix_string: " << prefix_string;
-
+    checkpoint::CheckpointCallbackManager* checkpoint_callback_manager =
+        nullptr;
     ResourceMgr* resource_manager = context->resource_manager();
     if (resource_manager != nullptr) {
-      checkpoint::CheckpointCallbackManager* checkpoint_callback_manager;
       OP_REQUIRES_OK(
           context,
           resource_manager
@@ -175,13 +203,171 @@ class SaveV2 : public OpKernel {
                     *out = new checkpoint::CheckpointCallbackManager();
                     return OkStatus();
                   }));
-      checkpoint_callback_manager->Save(prefix_string);
+    }
+
+    if (async_) {
+      // The callbacks save the state that goes with the checkpoint, once the
+      // checkpoint is written.
+      auto done = [prefix_string,
+                   checkpoint_callback_manager](const Status& status) {
+        if (checkpoint_callback_manager == nullptr) return;
+        if (status.ok()) checkpoint_callback_manager->Save(prefix_string);
+        checkpoint_callback_manager->Unref();
+      };
+      Status status = AsyncBundleWriter::Global()->Schedule(
+          prefix_string, std::move(entries), num_writers_, data_alignment_,
+          done);
+      if (!status.ok() && checkpoint_callback_manager != nullptr) {
+        checkpoint_callback_manager->Unref();
+      }
+      OP_REQUIRES_OK(context, status);
+      return;
+    }
+
+    Status status = AsyncBundleWriter::Write(Env::Default(), prefix_string,
+                                             entries, num_writers_,
+                                             data_alignment_);
+    VLOG(1) << "Done BundleWriter, prefix_string: " << prefix_string;
+    if (checkpoint_callback_manager != nullptr) {
+      if (status.ok()) checkpoint_callback_manager->Save(prefix_string);
       checkpoint_callback_manager->Unref();
     }
+    OP_REQUIRES_OK(context, status);
   }
+
+  // Flushes the checkpoints still being written, e.g. when the session is
+  // closed.
+  ~SaveV2() override {
+    if (!async_) return;
+    Status status = AsyncBundleWriter::Global()->Flush();
+    if (!status.ok()) LOG(ERROR) << status;
+  }
+
+ private:
+  // Whether to write the tensors in the background.
+  bool async_;
+  // The number of writers writing the tensors in parallel.
+  int64_t num_writers_;
+  // The alignment of the tensors in the data files, in bytes.
+  int64_t data_alignment_;
 };
 REGISTER_KERNEL_BUILDER(Name("SaveV2").Device(DEVICE_CPU), SaveV2);
 
+// Waits for the checkpoint that SaveV2 writes to a prefix in the background,
+// e.g. before recording it in the checkpoint state.
+class WaitForSaveV2 : public OpKernel {
+ public:
+  explicit WaitForSaveV2(OpKernelConstruction* context) : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& prefix = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(prefix.shape()),
+                errors::InvalidArgument(
+                    "Input prefix should be a scalar, got shape ",
+                    prefix.shape().DebugString()));
+    OP_REQUIRES_OK(context, AsyncBundleWriter::Global()->Wait(
+                                prefix.scalar<tstring>()()));
+  }
+};
+REGISTER_KERNEL_BUILDER(Name("WaitForSaveV2").Device(DEVICE_CPU),
+                        WaitForSaveV2);
+
+// Saves the rows `rows` of a list of named tensors as a delta of the bundle
+// at `base_prefix`, e.g. the rows returned by VariableDirtyRows. A tensor all
+// rows of which are saved is saved in full.
+class SaveDeltaV2 : public OpKernel {
+ public:
+  explicit SaveDeltaV2(OpKernelConstruction* context) : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& prefix = context->input(0);
+    const Tensor& base_prefix = context->input(1);
+    const Tensor& tensor_names = context->input(2);
+    OpInputList rows;
+    OP_REQUIRES_OK(context, context->input_list("rows", &rows));
+    OpInputList tensors;
+    OP_REQUIRES_OK(context, context->input_list("tensors", &tensors));
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsScalar(prefix.shape()) &&
+                    TensorShapeUtils::IsScalar(base_prefix.shape()),
+                errors::InvalidArgument(
+                    "Inputs prefix and base_prefix should be scalars, got ",
+                    prefix.shape().DebugString(), " and ",
+                    base_prefix.shape().DebugString(), " instead."));
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsVector(tensor_names.shape()) &&
+                    tensor_names.NumElements() == rows.size() &&
+                    tensor_names.NumElements() == tensors.size(),
+                errors::InvalidArgument(
+                    "Got tensor names of shape ",
+                    tensor_names.shape().DebugString(), " for ", rows.size(),
+                    " row indices and ", tensors.size(), " tensors."));
+
+    const string& prefix_string = prefix.scalar<tstring>()();
+    BundleWriter::Options options;
+    options.base_prefix = base_prefix.scalar<tstring>()();
+    OP_REQUIRES(context, !options.base_prefix.empty(),
+                errors::InvalidArgument("Empty base_prefix"));
+    // The base bundle may still be written in the background.
+    OP_REQUIRES_OK(context,
+                   AsyncBundleWriter::Global()->Wait(options.base_prefix));
+    const auto& tensor_names_flat = tensor_names.flat<tstring>();
+
+    VLOG(1) << "BundleWriter, prefix_string: " << prefix_string
+            << ", base_prefix: " << options.base_prefix;
+    BundleWriter writer(Env::Default(), prefix_string, options);
+    OP_REQUIRES_OK(context, writer.status());
+    for (int i = 0; i < tensors.size(); ++i) {
+      const string& tensor_name = tensor_names_flat(i);
+      const Tensor& tensor = tensors[i];
+      const Tensor& tensor_rows = rows[i];
+      OP_REQUIRES(context,
+                  tensor.dims() > 0 &&
+                      TensorShapeUtils::IsVector(tensor_rows.shape()),
+                  errors::InvalidArgument(
+                      "Got row indices of shape ",
+                      tensor_rows.shape().DebugString(), " for tensor ",
+                      tensor_name, " of shape ", tensor.shape().DebugString()));
+      const int64_t num_rows = tensor_rows.NumElements();
+      if (num_rows == tensor.dim_size(0)) {
+        OP_REQUIRES_OK(context, writer.Add(tensor_name, tensor));
+        continue;
+      }
+      OP_REQUIRES(context, DataTypeCanUseMemcpy(tensor.dtype()),
+                  errors::InvalidArgument("Cannot save rows of tensor ",
+                                          tensor_name, " of type ",
+                                          DataTypeString(tensor.dtype())));
+
+      // Gathers the rows.
+      TensorShape values_shape = tensor.shape();
+      values_shape.set_dim(0, num_rows);
+      Tensor values(tensor.dtype(), values_shape);
+      const size_t row_bytes =
+          tensor.dim_size(0) > 0 ? tensor.TotalBytes() / tensor.dim_size(0)
+                                 : 0;
+      const char* data = tensor.tensor_data().data();
+      char* values_data = const_cast<char*>(values.tensor_data().data());
+      const auto rows_vec = tensor_rows.vec<int64_t>();
+      for (int64_t j = 0; j < num_rows; ++j) {
+        const int64_t row = rows_vec(j);
+        OP_REQUIRES(context, FastBoundsCheck(row, tensor.dim_size(0)),
+                    errors::InvalidArgument("Row ", row, " of tensor ",
+                                            tensor_name, " of shape ",
+                                            tensor.shape().DebugString(),
+                                            " is out of range"));
+        memcpy(values_data + j * row_bytes, data + row * row_bytes, row_bytes);
+      }
+      OP_REQUIRES_OK(context, writer.AddRows(tensor_name, tensor.shape(),
+                                             tensor_rows, values));
+      VLOG(2) << "Saved " << num_rows << " of " << tensor.dim_size(0)
+              << " rows of " << tensor_name;
+    }
+    OP_REQUIRES_OK(context, writer.Finish());
+    VLOG(1) << "Done BundleWriter, prefix_string: " << prefix_string;
+  }
+};
+REGISTER_KERNEL_BUILDER(Name("SaveDeltaV2").Device(DEVICE_CPU), SaveDeltaV2);
+
 // Restores a list of named tensors from a tensor bundle (V2 checkpoint format).
 class RestoreV2 : public OpKernel {
  public:
@@ -202,6 +388,7 @@ class RestoreV2 : public OpKernel {
     if (!context->status().ok()) return;
 
     const string& prefix_string = prefix.scalar<tstring>()();
+    OP_REQUIRES_OK(context, AsyncBundleWriter::Global()->Wait(prefix_string));
 
     // Intention: we plan to use the RestoreV2 op as a backward-compatible
     // reader as we upgrade to the V2 format.  This allows transparent upgrade.
@@ -281,6 +468,9 @@ class MergeV2Checkpoints : public OpKernel {
         gtl::ArraySlice<tstring>(checkpoint_prefixes.flat<tstring>());
     Env* env = Env::Default();
     const string& merged_prefix = destination_prefix.scalar<tstring>()();
+    for (const string& input_prefix : input_prefixes) {
+      OP_REQUIRES_OK(context, AsyncBundleWriter::Global()->Wait(input_prefix));
+    }
     OP_REQUIRES_OK(context,
                    tensorflow::MergeBundles(env, input_prefixes, merged_prefix,
                                             allow_missing_files_));
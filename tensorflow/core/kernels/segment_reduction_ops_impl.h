@@ -18,7 +18,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_SEGMENT_REDUCTION_OPS_IMPL_H_
 #define TENSORFLOW_CORE_KERNELS_SEGMENT_REDUCTION_OPS_IMPL_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <vector>
 
 #include "tensorflow/core/framework/op_requires.h"
 #include "tensorflow/core/platform/types.h"
@@ -40,8 +42,10 @@ limitations under the License.
 #include "tensorflow/core/kernels/segment_reduction_ops.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/determinism.h"
 #include "tensorflow/core/util/util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 #include "tensorflow/core/common_runtime/gpu/gpu_event_mgr.h"
@@ -371,9 +375,13 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
     // output row, the row only fills with InitialValueF() will keep 0.
     // Length of non-zero elements is `num_reductions`.
     std::vector<Index> row_counter(num_segments, 0);
+    // `row_segment` holds the validated segment id of each input row, so that
+    // the ids are only read once.
+    std::vector<Index> row_segment(N);
 
     for (int64_t i = 0; i < N; ++i) {
       Index j = internal::SubtleMustCopy(segment_ids(i));
+      row_segment[i] = j;
       if (j < 0) {
         --num_real_segment;
         continue;
@@ -389,8 +397,71 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
     // Nothing to reduce. All output values equal to `InitialValueF()`.
     if (num_reductions == 0) return;
 
-    // Parallelize by `num_segments`. It's simple, efficient and safe
-    // (no data dependency):
+    // Reduction functors includes Sum, Max, Min, etc. Simply consider it
+    // will cost 5 cycles per operation.
+    const int64_t row_cycles = 5 * inner_dim;
+    const int64_t row_bytes = sizeof(T) * inner_dim;
+    const int64_t num_threads = cpu_device.numThreads();
+
+    // With fewer output rows than threads, parallelizing by segment leaves
+    // most threads idle. Instead each worker reduces a range of the input
+    // into its own copy of the output, and the copies are reduced into the
+    // output at the end. This changes the order in which the rows of a
+    // segment are reduced, so it is skipped when determinism is required.
+    const int64_t num_partials =
+        std::min(num_threads, num_real_segment / kMinRowsPerPartial);
+    if (num_reductions < num_threads && num_partials > 1 &&
+        num_partials * num_segments <= num_real_segment &&
+        !OpDeterminismRequired()) {
+      Tensor partials;
+      OP_REQUIRES_OK(ctx, ctx->allocate_temp(
+                              DataTypeToEnum<T>::value,
+                              TensorShape({(num_partials - 1) * num_segments,
+                                           inner_dim}),
+                              &partials));
+      auto partials_matrix = partials.matrix<T>();
+      auto partial_worker = [&](int64_t begin, int64_t end) -> void {
+        for (int64_t p = begin; p < end; ++p) {
+          // The first worker reduces into the output itself.
+          typename TTypes<T, 2>::Tensor partial(
+              p == 0 ? output.data()
+                     : &partials_matrix((p - 1) * num_segments, 0),
+              num_segments, inner_dim);
+          if (p > 0) {
+            partial.setConstant(InitialValueF()());
+          }
+          for (int64_t i = N * p / num_partials;
+               i < N * (p + 1) / num_partials; ++i) {
+            const Index j = row_segment[i];
+            if (j >= 0) {
+              reduction(data.template chip<0>(i), partial.template chip<0>(j));
+            }
+          }
+        }
+      };
+      const int64_t rows_per_partial = num_real_segment / num_partials;
+      const Eigen::TensorOpCost partial_cost(
+          row_bytes * rows_per_partial, row_bytes * rows_per_partial,
+          row_cycles * rows_per_partial);
+      cpu_device.parallelFor(num_partials, partial_cost, partial_worker);
+
+      for (int64_t p = 1; p < num_partials; ++p) {
+        typename TTypes<T, 2>::ConstTensor partial(
+            &partials_matrix((p - 1) * num_segments, 0), num_segments,
+            inner_dim);
+        for (int64_t j = 0; j < num_segments; ++j) {
+          if (row_counter[j] > 0) {
+            reduction(partial.template chip<0>(j), output.template chip<0>(j));
+          }
+        }
+      }
+      return;
+    }
+
+    // Otherwise parallelize by segment. The input rows are first sorted by
+    // segment, keeping their order within each segment, so each worker only
+    // visits the rows of its own segments: the rows of segment `j` are
+    // `sorted_rows[offsets[j], offsets[j + 1])`.
     //
     //   input   segment_ids                 num_segments  operation
     //   | a0 |  | 0 |            worker 1:  |0|           f(a0, a1)
@@ -398,28 +469,56 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
     // N | c0 |  | 2 |       -->  worker 3:  |2|           f(c0)
     //   | b1 |  | 1 |
     //   | a1 |  | 0 |
-    //
-    // TODO(intel-tf): Balance workload in `row_counter` to make parallelism
-    //                 more efficient.
+    std::vector<int64_t> offsets(num_segments + 1, 0);
+    for (int64_t j = 0; j < num_segments; ++j) {
+      offsets[j + 1] = offsets[j] + row_counter[j];
+    }
+    std::vector<int64_t> sorted_rows(num_real_segment);
+    {
+      std::vector<int64_t> next_row(offsets.begin(), offsets.end() - 1);
+      for (int64_t i = 0; i < N; ++i) {
+        const Index j = row_segment[i];
+        if (j >= 0) {
+          sorted_rows[next_row[j]++] = i;
+        }
+      }
+    }
+
+    // Split the segments into blocks of about the same number of input rows,
+    // so that a few large segments don't leave the other workers idle.
+    const int64_t num_blocks =
+        std::min<int64_t>(num_reductions, kBlocksPerThread * num_threads);
+    std::vector<int64_t> block_starts(num_blocks + 1, num_segments);
+    for (int64_t b = 0; b < num_blocks; ++b) {
+      block_starts[b] =
+          std::lower_bound(offsets.begin(), offsets.end(),
+                           num_real_segment * b / num_blocks) -
+          offsets.begin();
+    }
+
     auto reductionWorker = [&](int64_t begin, int64_t end) -> void {
-      for (int64_t i = 0; i < N; i++) {
-        Index j = internal::SubtleMustCopy(segment_ids(i));
-        // If `j` is in work scope of this worker, do the reduction.
-        if (j >= begin && j < end) {
-          reduction(data.template chip<0>(i), output.template chip<0>(j));
+      for (int64_t b = begin; b < end; ++b) {
+        for (int64_t j = block_starts[b]; j < block_starts[b + 1]; ++j) {
+          for (int64_t k = offsets[j]; k < offsets[j + 1]; ++k) {
+            reduction(data.template chip<0>(sorted_rows[k]),
+                      output.template chip<0>(j));
+          }
         }
       }
     };
 
-    // Reduction functors includes Sum, Max, Min, etc. Simply consider it
-    // will cost 5 cycles per operation.
-    const int64_t kAverTaskSize = num_real_segment / num_segments;
-    const int64_t compute_cycles = 5 * inner_dim * kAverTaskSize;
-    const int64_t input_bytes = sizeof(T) * inner_dim * kAverTaskSize;
-    const int64_t output_bytes = sizeof(T) * inner_dim * kAverTaskSize;
-    const Eigen::TensorOpCost cost(input_bytes, output_bytes, compute_cycles);
-    cpu_device.parallelFor(num_segments, cost, reductionWorker);
+    const int64_t rows_per_block = num_real_segment / num_blocks + 1;
+    const Eigen::TensorOpCost cost(row_bytes * rows_per_block,
+                                   row_bytes * rows_per_block,
+                                   row_cycles * rows_per_block);
+    cpu_device.parallelFor(num_blocks, cost, reductionWorker);
   }
+
+ private:
+  // The minimum number of input rows each copy of the output reduces.
+  static constexpr int64_t kMinRowsPerPartial = 1024;
+  // The number of blocks of segments per thread, to even out the blocks.
+  static constexpr int64_t kBlocksPerThread = 4;
 };
 
 template <typename T>
@@ -596,12 +695,13 @@ class SparseSegmentReductionOpBase : public OpKernel {
     }
     auto temp_flat = temp.flat_outer_dims<float>();
 
-    int64_t start = 0, end = 1;
-    // Index from which the output is not initialized.
-    SegmentId uninitialized_index = 0;
-    SegmentId out_index = internal::SubtleMustCopy(segment_vec(start));
-
-    while (true) {
+    // Find the segments, each a run of indices with the same segment id.
+    // Segment `s` reduces the indices in [segment_starts[s],
+    // segment_starts[s + 1]) into row segment_rows[s] of the output.
+    std::vector<int64_t> segment_starts = {0};
+    std::vector<SegmentId> segment_rows;
+    SegmentId out_index = internal::SubtleMustCopy(segment_vec(0));
+    for (int64_t end = 1; end <= num_indices; ++end) {
       // We initialize next_index to 0 to avoid "warning: 'next_index' may be
       // used uninitialized in this function" in the Mac build (since the
       // compiler isn't smart enough to realize the code is safe).
@@ -609,7 +709,6 @@ class SparseSegmentReductionOpBase : public OpKernel {
       if (end < num_indices) {
         next_index = internal::SubtleMustCopy(segment_vec(end));
         if (out_index == next_index) {
-          ++end;
           continue;
         }
         // We have a new segment here.  Verify that the segment ids are growing.
@@ -622,35 +721,61 @@ class SparseSegmentReductionOpBase : public OpKernel {
           errors::InvalidArgument(
               "Segment id ", out_index, " out of range [0, ", output_rows,
               "), possibly because 'segment_ids' input is not sorted."));
-
-      // If there is a gap between two indices, we need to set that gap to the
-      // default value.
-      if (out_index > uninitialized_index) {
-        Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
-            out_index - uninitialized_index, num_col);
-        Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>, Eigen::Unaligned>
-            gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
-        gap_slice.setConstant(default_value_);
-      }
-
-      auto out = output_flat.template chip<0>(out_index);
-      auto temp = temp_flat.template chip<0>(out_index);
-      const int bad_offset = Reduce<T, Index>(input_flat, indices_vec, start,
-                                              end - start, out, temp);
-      OP_REQUIRES(context, bad_offset < 0,
-                  errors::InvalidArgument(
-                      "Bad: indices[", start + bad_offset,
-                      "] == ", indices_vec(start + bad_offset),
-                      " out of range [0, ", input_flat.dimension(0), ")"));
-
-      start = end;
-      ++end;
-      uninitialized_index = out_index + 1;
+      segment_rows.push_back(out_index);
+      segment_starts.push_back(end);
       out_index = next_index;
-      if (end > num_indices) break;
     }
 
+    // Reduce the segments in parallel. Each segment writes its own row of the
+    // output, and the gap of default rows before it.
+    const int64_t num_segments = segment_rows.size();
+    mutex mu;
+    // The position of the first out of range index found, if any.
+    int64_t bad_position = num_indices;
+    auto reduce_segments = [&](int64_t first_segment, int64_t last_segment) {
+      for (int64_t s = first_segment; s < last_segment; ++s) {
+        const SegmentId out_index = segment_rows[s];
+        // If there is a gap between two indices, we need to set that gap to
+        // the default value.
+        const SegmentId uninitialized_index =
+            s == 0 ? 0 : segment_rows[s - 1] + 1;
+        if (out_index > uninitialized_index) {
+          Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
+              out_index - uninitialized_index, num_col);
+          Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>,
+                           Eigen::Unaligned>
+              gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
+          gap_slice.setConstant(default_value_);
+        }
+
+        auto out = output_flat.template chip<0>(out_index);
+        auto temp_row = temp_flat.template chip<0>(out_index);
+        const int64_t start = segment_starts[s];
+        const int bad_offset =
+            Reduce<T, Index>(input_flat, indices_vec, start,
+                             segment_starts[s + 1] - start, out, temp_row);
+        if (bad_offset >= 0) {
+          mutex_lock l(mu);
+          bad_position = std::min(bad_position, start + bad_offset);
+          return;
+        }
+      }
+    };
+    // Each index of a segment costs about one load and one add per column.
+    const int64_t cost_per_segment =
+        (num_indices / num_segments + 1) * num_col *
+        (Eigen::TensorOpCost::AddCost<T>() + sizeof(T));
+    auto* worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_segments,
+          cost_per_segment, reduce_segments);
+    OP_REQUIRES(context, bad_position == num_indices,
+                errors::InvalidArgument(
+                    "Bad: indices[", bad_position,
+                    "] == ", indices_vec(bad_position), " out of range [0, ",
+                    input_flat.dimension(0), ")"));
+
     // Fill the gap at the end with the default value.
+    const SegmentId uninitialized_index = segment_rows.back() + 1;
     if (uninitialized_index < output_rows) {
       Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
           output_rows - uninitialized_index, num_col);
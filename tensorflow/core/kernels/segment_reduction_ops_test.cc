@@ -13,9 +13,14 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#define EIGEN_USE_THREADS
+
 #include <functional>
+#include <limits>
+#include <random>
 #include <vector>
 
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
@@ -31,12 +36,174 @@ limitations under the License.
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/public/version.h"
 
 namespace tensorflow {
+namespace {
+
+// The number of threads the unsorted segment reductions are tested with, more
+// than the number of output rows of some tests, so that they reduce into
+// private copies of the output.
+constexpr int kNumThreads = 8;
+
+// A CPU device whose Eigen device has kNumThreads threads, so that the tests
+// take the same parallel paths on any machine.
+class FixedThreadsCPUDevice : public DeviceBase {
+ public:
+  FixedThreadsCPUDevice()
+      : DeviceBase(Env::Default()),
+        pool_(Env::Default(), "segment_reduction_ops_test", kNumThreads),
+        eigen_device_(pool_.AsEigenThreadPool(), kNumThreads) {
+    set_eigen_cpu_device(&eigen_device_);
+  }
+
+  Allocator* GetAllocator(AllocatorAttributes) override {
+    return cpu_allocator();
+  }
+
+ private:
+  thread::ThreadPool pool_;
+  Eigen::ThreadPoolDevice eigen_device_;
+};
+
+// Runs the unsorted segment reduction `op` of `data`, a matrix with a row per
+// segment id.
+Tensor RunUnsortedSegmentReduction(const string& op, Tensor data,
+                                   const std::vector<int32>& segment_ids,
+                                   int32_t num_segments) {
+  FixedThreadsCPUDevice device;
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder(op, op)
+                  .Input(FakeInput(DT_FLOAT))
+                  .Input(FakeInput(DT_INT32))
+                  .Input(FakeInput(DT_INT32))
+                  .Finalize(&node_def));
+  Status status;
+  std::unique_ptr<OpKernel> kernel(CreateOpKernel(DEVICE_CPU, &device,
+                                                  cpu_allocator(), node_def,
+                                                  TF_GRAPH_DEF_VERSION,
+                                                  &status));
+  TF_CHECK_OK(status);
+
+  Tensor ids = test::AsTensor<int32>(segment_ids);
+  Tensor num_segments_tensor = test::AsScalar<int32>(num_segments);
+  gtl::InlinedVector<TensorValue, 4> inputs = {
+      {nullptr, &data}, {nullptr, &ids}, {nullptr, &num_segments_tensor}};
+  OpKernelContext::Params params;
+  params.device = &device;
+  params.frame_iter = FrameAndIter(0, 0);
+  params.inputs = inputs;
+  params.op_kernel = kernel.get();
+  std::vector<AllocatorAttributes> attrs;
+  test::SetOutputAttrs(&params, &attrs);
+  OpKernelContext ctx(&params);
+  kernel->Compute(&ctx);
+  TF_CHECK_OK(ctx.status());
+  return *ctx.mutable_output(0);
+}
+
+// Reduces the rows of `data` sequentially, in input order.
+template <typename ReductionF>
+Tensor ReferenceUnsortedSegmentReduction(
+    const Tensor& data, const std::vector<int32>& segment_ids,
+    int32_t num_segments, float initial_value, ReductionF reduction) {
+  const int64_t inner_dim = data.dim_size(1);
+  Tensor output(DT_FLOAT, TensorShape({num_segments, inner_dim}));
+  auto output_matrix = output.matrix<float>();
+  output_matrix.setConstant(initial_value);
+  auto data_matrix = data.matrix<float>();
+  for (int64_t i = 0; i < segment_ids.size(); ++i) {
+    if (segment_ids[i] < 0) continue;
+    for (int64_t k = 0; k < inner_dim; ++k) {
+      output_matrix(segment_ids[i], k) =
+          reduction(output_matrix(segment_ids[i], k), data_matrix(i, k));
+    }
+  }
+  return output;
+}
+
+// Checks UnsortedSegmentSum and UnsortedSegmentMax against a sequential
+// reduction. The values are small integers, so that the sums are exact in
+// any order.
+void CheckUnsortedSegmentReductions(const std::vector<int32>& segment_ids,
+                                    int32_t num_segments, int64_t inner_dim) {
+  Tensor data(DT_FLOAT,
+              TensorShape({static_cast<int64_t>(segment_ids.size()),
+                           inner_dim}));
+  test::FillFn<float>(&data, [](int i) { return (i * 7) % 13 - 6.0f; });
+
+  test::ExpectTensorEqual<float>(
+      RunUnsortedSegmentReduction("UnsortedSegmentSum", data, segment_ids,
+                                  num_segments),
+      ReferenceUnsortedSegmentReduction(
+          data, segment_ids, num_segments, 0.0f,
+          [](float a, float b) { return a + b; }));
+  test::ExpectTensorEqual<float>(
+      RunUnsortedSegmentReduction("UnsortedSegmentMax", data, segment_ids,
+                                  num_segments),
+      ReferenceUnsortedSegmentReduction(
+          data, segment_ids, num_segments,
+          std::numeric_limits<float>::lowest(),
+          [](float a, float b) { return std::max(a, b); }));
+}
+
+TEST(UnsortedSegmentReductionTest, FewSegmentsReduceIntoPrivateCopies) {
+  // 4 non-empty segments for 8 threads, one empty segment, and dropped rows.
+  std::vector<int32> segment_ids(16384);
+  for (int i = 0; i < segment_ids.size(); ++i) {
+    segment_ids[i] = i % 10 == 9 ? -1 : i % 4;
+  }
+  CheckUnsortedSegmentReductions(segment_ids, /*num_segments=*/5,
+                                 /*inner_dim=*/4);
+}
+
+TEST(UnsortedSegmentReductionTest, PrivateCopiesOfUnevenInputRanges) {
+  // The rows aren't a multiple of the number of copies.
+  std::mt19937 rng(/*seed=*/1);
+  std::vector<int32> segment_ids(10007);
+  for (int32& id : segment_ids) {
+    id = std::uniform_int_distribution<int32>(0, 2)(rng);
+  }
+  CheckUnsortedSegmentReductions(segment_ids, /*num_segments=*/3,
+                                 /*inner_dim=*/3);
+}
+
+TEST(UnsortedSegmentReductionTest, SkewedSegmentsAreSplitIntoBlocks) {
+  // Half the rows go to one segment, and many segments are empty, so the
+  // blocks of segments are uneven.
+  std::mt19937 rng(/*seed=*/2);
+  std::vector<int32> segment_ids(20001);
+  for (int i = 0; i < segment_ids.size(); ++i) {
+    segment_ids[i] =
+        i % 2 == 0 ? 7 : std::uniform_int_distribution<int32>(0, 499)(rng) * 2;
+  }
+  CheckUnsortedSegmentReductions(segment_ids, /*num_segments=*/1000,
+                                 /*inner_dim=*/5);
+}
+
+TEST(UnsortedSegmentReductionTest, MoreSegmentsThanRows) {
+  std::mt19937 rng(/*seed=*/3);
+  std::vector<int32> segment_ids(100);
+  for (int32& id : segment_ids) {
+    id = std::uniform_int_distribution<int32>(-1, 4999)(rng);
+  }
+  CheckUnsortedSegmentReductions(segment_ids, /*num_segments=*/5000,
+                                 /*inner_dim=*/2);
+}
+
+TEST(UnsortedSegmentReductionTest, FewRows) {
+  // Fewer segments than threads, but too few rows for private copies.
+  CheckUnsortedSegmentReductions({0, 2, 1, 0, -1, 2, 2, 0, 1, 1},
+                                 /*num_segments=*/3, /*inner_dim=*/7);
+}
+
+}  // namespace
 
 static void BM_UnsortedSegmentReduction(::testing::benchmark::State& state,
                                         const string& reduction, int num_rows,
@@ -105,6 +272,8 @@ static void BM_UnsortedSegmentReduction(::testing::benchmark::State& state,
 
 BM_UnsortedReduce_Arg(4096, 1024, 1);
 BM_UnsortedReduce_Arg(4096, 1024, 128);
+BM_UnsortedReduce_Arg(65536, 128, 4);
+BM_UnsortedReduce_Arg(65536, 128, 16384);
 
 template <typename Index>
 static void BM_SegmentReduction(::testing::benchmark::State& state,
@@ -290,4 +459,44 @@ BENCHMARK(BM_SparseSegmentMeanGrad_High_FP16)
     ->Arg(1000)
     ->Arg(100000);
 
+// Reduces `num_indices` rows of a [vocab_size, 64] table into segments of
+// `ids_per_segment` rows, as in a sparse embedding lookup.
+static void BM_SparseSegmentSum(::testing::benchmark::State& state) {
+  const int num_indices = state.range(0);
+  const int ids_per_segment = state.range(1);
+  const int kVocabSize = 100000;
+  const int kDim = 64;
+  Graph* g = new Graph(OpRegistry::Global());
+
+  Tensor input(DT_FLOAT, TensorShape({kVocabSize, kDim}));
+  input.flat<float>().setRandom();
+  Tensor indices(DT_INT64, TensorShape({num_indices}));
+  auto indices_flat = indices.flat<int64_t>();
+  Tensor segments(DT_INT32, TensorShape({num_indices}));
+  auto segments_flat = segments.flat<int32>();
+  for (int i = 0; i < num_indices; ++i) {
+    indices_flat(i) = (i * 7919) % kVocabSize;
+    segments_flat(i) = i / ids_per_segment;
+  }
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "SparseSegmentSum")
+                  .Input(test::graph::Constant(g, input))
+                  .Input(test::graph::Constant(g, indices))
+                  .Input(test::graph::Constant(g, segments))
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+
+  test::Benchmark("cpu", g, /*old_benchmark_api*/ false).Run(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_indices * kDim * sizeof(float));
+}
+
+BENCHMARK(BM_SparseSegmentSum)
+    ->UseRealTime()
+    ->ArgPair(1000, 1)
+    ->ArgPair(1000, 10)
+    ->ArgPair(100000, 1)
+    ->ArgPair(100000, 10);
+
 }  // namespace tensorflow
@@ -66,7 +66,9 @@ struct SparseReorderFunctor<CPUDevice, T> {
                      sparse::SparseTensor::Create(tensor::DeepCopy(input_ind),
                                                   tensor::DeepCopy(input_val),
                                                   input_shape, &reordered_sp));
-      reordered_sp.Reorder<T>(std_order);
+      reordered_sp.Reorder<T>(
+          std_order,
+          context->device()->tensorflow_cpu_worker_threads()->workers);
       context->set_output(0, reordered_sp.indices());
       context->set_output(1, reordered_sp.values());
     }
@@ -19,11 +19,15 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/sparse_tensor_dense_matmul_op.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/kernels/fill_functor.h"
 #include "tensorflow/core/platform/bfloat16.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -321,6 +325,136 @@ Status SparseTensorDenseMatMulImpl(
   }
   return OkStatus();
 }
+
+// Products with at least this many multiply-adds, nnz * rhs_right, are
+// computed by SparseTensorDenseMatMulCsrImpl.
+constexpr int64_t kMinCsrMultiplyAdds = 1 << 20;
+// The number of blocks of rows of the output per thread, to balance blocks
+// with the same number of nonzeros but rows of B of different cost to read.
+constexpr int64_t kCsrBlocksPerThread = 4;
+
+// Computes the same product as SparseTensorDenseMatMulImpl in parallel. A is
+// converted to a CSR matrix, keeping the order of the nonzeros within each
+// row. The rows of the output are then split into blocks of about the same
+// number of nonzeros, and each block accumulates its nonzeros into its rows,
+// each as a contiguous axpy of a row of B. Each output element sums its terms
+// in the same order as the sequential implementation, whatever the number of
+// threads.
+template <typename T, typename Tsum, typename Tindices, bool ADJ_A, bool ADJ_B>
+Status SparseTensorDenseMatMulCsrImpl(
+    OpKernelContext* ctx, typename TTypes<Tsum>::Matrix out,
+    typename TTypes<Tindices>::ConstMatrix a_indices,
+    typename TTypes<T>::ConstVec a_values, typename TTypes<T>::ConstMatrix b) {
+  const std::size_t nnz = a_values.size();
+  const std::size_t rhs_right = (ADJ_B ? b.dimension(0) : b.dimension(1));
+  const std::size_t lhs_right = (ADJ_B ? b.dimension(1) : b.dimension(0));
+  const int64_t out_rows = out.dimension(0);
+  const int lhs_index_a = ADJ_A ? 1 : 0;
+  const int rhs_index_a = ADJ_A ? 0 : 1;
+
+  // row_offsets[m] is the position in the CSR arrays of the first nonzero of
+  // output row m.
+  std::vector<int64_t> row_offsets(out_rows + 1, 0);
+  for (std::size_t i = 0; i < nnz; ++i) {
+    const Tindices m = internal::SubtleMustCopy(a_indices(i, lhs_index_a));
+    const Tindices k = internal::SubtleMustCopy(a_indices(i, rhs_index_a));
+    if (!FastBoundsCheck(k, lhs_right)) {
+      return KOutOfBoundsError(k, i, rhs_index_a, lhs_right);
+    }
+    if (!FastBoundsCheck(m, out_rows)) {
+      return MOutOfBoundsError(m, i, lhs_index_a, out_rows);
+    }
+    ++row_offsets[m + 1];
+  }
+  for (int64_t m = 0; m < out_rows; ++m) {
+    row_offsets[m + 1] += row_offsets[m];
+  }
+  std::vector<Tindices> csr_columns(nnz);
+  std::vector<T> csr_values(nnz);
+  {
+    std::vector<int64_t> next(row_offsets.begin(), row_offsets.end() - 1);
+    for (std::size_t i = 0; i < nnz; ++i) {
+      // The indices are read again, so check them again.
+      const Tindices m = internal::SubtleMustCopy(a_indices(i, lhs_index_a));
+      const Tindices k = internal::SubtleMustCopy(a_indices(i, rhs_index_a));
+      if (!FastBoundsCheck(k, lhs_right)) {
+        return KOutOfBoundsError(k, i, rhs_index_a, lhs_right);
+      }
+      if (!FastBoundsCheck(m, out_rows)) {
+        return MOutOfBoundsError(m, i, lhs_index_a, out_rows);
+      }
+      if (next[m] == row_offsets[m + 1]) {
+        return errors::InvalidArgument("a_indices changed while being read");
+      }
+      csr_columns[next[m]] = k;
+      csr_values[next[m]] = ADJ_A ? MaybeConj(a_values(i)) : a_values(i);
+      ++next[m];
+    }
+  }
+
+  // With ADJ_B, the rows of B to accumulate are its conjugated columns, so
+  // transpose it once.
+  Eigen::Tensor<T, 2, Eigen::RowMajor> conj_b_t;
+  const T* b_rows = b.data();
+  if (ADJ_B) {
+    Eigen::array<int, 2> shuffle(1, 0);
+    conj_b_t = b.shuffle(shuffle).conjugate();
+    b_rows = conj_b_t.data();
+  }
+
+  auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
+  const int64_t num_blocks = std::min<int64_t>(
+      out_rows, worker_threads.num_threads * kCsrBlocksPerThread);
+  // The first row of each block, so that the blocks have about the same
+  // number of nonzeros.
+  std::vector<int64_t> block_rows(num_blocks + 1, out_rows);
+  for (int64_t block = 0; block < num_blocks; ++block) {
+    const int64_t first_nonzero = nnz * block / num_blocks;
+    block_rows[block] =
+        std::lower_bound(row_offsets.begin(), row_offsets.end() - 1,
+                         first_nonzero) -
+        row_offsets.begin();
+  }
+  block_rows[0] = 0;
+
+  auto MultiplyBlocks = [&](int64_t start_block, int64_t limit_block) {
+    for (int64_t m = block_rows[start_block]; m < block_rows[limit_block];
+         ++m) {
+      Tsum* out_row = &out(m, 0);
+      for (int64_t j = row_offsets[m]; j < row_offsets[m + 1]; ++j) {
+        const Tsum a_value = static_cast<Tsum>(csr_values[j]);
+        const T* b_row = b_rows + csr_columns[j] * rhs_right;
+        for (std::size_t n = 0; n < rhs_right; ++n) {
+          out_row[n] += a_value * static_cast<Tsum>(b_row[n]);
+        }
+      }
+    }
+  };
+  const int64_t cost_per_block = 2 * nnz * rhs_right / num_blocks + 1;
+  Shard(worker_threads.num_threads, worker_threads.workers, num_blocks,
+        cost_per_block, MultiplyBlocks);
+  return OkStatus();
+}
+
+// Computes the product with SparseTensorDenseMatMulCsrImpl if it is large
+// enough to be worth running in parallel, with SparseTensorDenseMatMulImpl
+// otherwise.
+template <typename T, typename Tsum, typename Tindices, bool ADJ_A, bool ADJ_B>
+Status SparseTensorDenseMatMulDispatch(
+    OpKernelContext* ctx, typename TTypes<Tsum>::Matrix out,
+    typename TTypes<Tindices>::ConstMatrix a_indices,
+    typename TTypes<T>::ConstVec a_values, typename TTypes<T>::ConstMatrix b) {
+  const int64_t rhs_right = (ADJ_B ? b.dimension(0) : b.dimension(1));
+  if (ctx->device()->tensorflow_cpu_worker_threads()->num_threads > 1 &&
+      out.dimension(0) > 1 &&
+      static_cast<int64_t>(a_values.size()) * rhs_right >=
+          kMinCsrMultiplyAdds) {
+    return SparseTensorDenseMatMulCsrImpl<T, Tsum, Tindices, ADJ_A, ADJ_B>(
+        ctx, out, a_indices, a_values, b);
+  }
+  return SparseTensorDenseMatMulImpl<T, Tsum, Tindices, ADJ_A, ADJ_B>(
+      out, a_indices, a_values, b);
+}
 }  // namespace
 
 template <typename T, typename Tindices, bool ADJ_A, bool ADJ_B>
@@ -338,8 +472,8 @@ struct SparseTensorDenseMatMulFunctor<CPUDevice, T, Tindices, ADJ_A, ADJ_B> {
       auto temp_out = temp_out_t.matrix<Tsum>();
       temp_out.setZero();
       TF_RETURN_IF_ERROR(
-          SparseTensorDenseMatMulImpl<T, Tsum, Tindices, ADJ_A, ADJ_B>(
-              temp_out, a_indices, a_values, b));
+          SparseTensorDenseMatMulDispatch<T, Tsum, Tindices, ADJ_A, ADJ_B>(
+              ctx, temp_out, a_indices, a_values, b));
       out = temp_out.template cast<T>();
     } else {
       out.setZero();
@@ -348,8 +482,8 @@ struct SparseTensorDenseMatMulFunctor<CPUDevice, T, Tindices, ADJ_A, ADJ_B> {
       auto out_workaround =
           *reinterpret_cast<typename TTypes<Tsum>::Matrix*>(&out);
       TF_RETURN_IF_ERROR(
-          SparseTensorDenseMatMulImpl<T, Tsum, Tindices, ADJ_A, ADJ_B>(
-              out_workaround, a_indices, a_values, b));
+          SparseTensorDenseMatMulDispatch<T, Tsum, Tindices, ADJ_A, ADJ_B>(
+              ctx, out_workaround, a_indices, a_values, b));
     }
     return OkStatus();
   }
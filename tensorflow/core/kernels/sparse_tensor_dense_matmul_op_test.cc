@@ -120,4 +120,8 @@ BM_SparseTensorDenseMatmul(16384, 4096, 4096, 4096, false, true);
 BM_SparseTensorDenseMatmul(16384, 4096, 4096, 4096, true, false);
 BM_SparseTensorDenseMatmul(16384, 4096, 4096, 4096, true, true);
 
+// Message passing over a graph, with many more nonzeros than columns of B.
+BM_SparseTensorDenseMatmul(1048576, 65536, 65536, 64, false, false);
+BM_SparseTensorDenseMatmul(1048576, 65536, 65536, 64, true, false);
+
 }  // end namespace tensorflow
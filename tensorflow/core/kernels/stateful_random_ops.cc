@@ -124,6 +124,7 @@ Status UpdateVariableAndFill(
   // `UpdateVariableAndFill_Philox<CPU>` to avoid holding the lock while
   // filling.
   ScopedUnlockUnrefVar state_var_guard(var);
+  var->MarkAllRowsDirty();
   Tensor* var_tensor = var->tensor();
   TF_RETURN_IF_ERROR(CheckState(*var_tensor));
   auto var_tensor_flat = var_tensor->flat<StateElementType>();
@@ -303,6 +304,7 @@ class RngSkipOp : public OpKernel {
     OP_REQUIRES_OK(
         ctx, LookupResource(ctx, HandleFromInput(ctx, state_input_idx), &var));
     ScopedUnlockUnrefVar state_var_guard(var);
+    var->MarkAllRowsDirty();
     Tensor* var_tensor = var->tensor();
     OP_REQUIRES_OK(ctx, CheckState(*var_tensor));
     using T = StateElementType;
@@ -0,0 +1,207 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/string_ops.cc.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/op_requires.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+namespace text {
+
+namespace {
+
+// Splits `str` into `tokens` like StringSplitV2 with separator `sep`: on runs
+// of whitespace if `sep` is empty, otherwise on each occurrence of `sep`. The
+// tokens point into `str`.
+void SplitInto(StringPiece str, StringPiece sep,
+               std::vector<StringPiece>* tokens) {
+  tokens->clear();
+  if (sep.empty()) {
+    StringPiece token;
+    str_util::RemoveLeadingWhitespace(&str);
+    while (str_util::ConsumeNonWhitespace(&str, &token)) {
+      tokens->push_back(token);
+      str_util::RemoveLeadingWhitespace(&str);
+    }
+    return;
+  }
+  for (auto p = std::search(str.begin(), str.end(), sep.begin(), sep.end());
+       p != str.end();
+       p = std::search(str.begin(), str.end(), sep.begin(), sep.end())) {
+    tokens->push_back(str.substr(0, p - str.begin()));
+    str.remove_prefix(p - str.begin() + sep.size());
+  }
+  tokens->push_back(str);
+}
+
+// Computes StringToHashBucketFast(StringNGrams(StringSplitV2(input))) without
+// creating the tokens or the n-grams as strings. Tokens point into the input,
+// and an n-gram whose tokens are separated in the input by exactly
+// `separator` is hashed in place. The other n-grams are joined into a scratch
+// buffer that is reused across n-grams.
+template <typename SPLITS_TYPE>
+class StringNGramsToHashBucketFastOp : public OpKernel {
+ public:
+  explicit StringNGramsToHashBucketFastOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("split_separator", &split_sep_));
+    OP_REQUIRES_OK(context, context->GetAttr("separator", &separator_));
+    OP_REQUIRES_OK(context, context->GetAttr("ngram_widths", &ngram_widths_));
+    OP_REQUIRES_OK(context, context->GetAttr("preserve_short_sequences",
+                                             &preserve_short_));
+    OP_REQUIRES_OK(context, context->GetAttr("num_buckets", &num_buckets_));
+    for (int ngram_width : ngram_widths_) {
+      OP_REQUIRES(
+          context, ngram_width > 0,
+          errors::InvalidArgument("ngram_widths must contain positive values"));
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(input.shape()),
+                errors::InvalidArgument("input must be a vector, got shape: ",
+                                        input.shape().DebugString()));
+    const auto input_vec = input.vec<tstring>();
+    const int64_t batch_size = input_vec.size();
+
+    Tensor* splits;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                1, TensorShape({batch_size + 1}), &splits));
+    auto splits_vec = splits->vec<SPLITS_TYPE>();
+
+    // Count the n-grams of each input, then hash them, splitting the inputs
+    // again rather than keeping all their tokens.
+    const auto& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    const int64_t bytes_per_input =
+        input.TotalBytes() / std::max<int64_t>(1, batch_size);
+    const int64_t cost_per_input = 20 * (1 + bytes_per_input);
+    splits_vec(0) = 0;
+    Shard(worker_threads.num_threads, worker_threads.workers, batch_size,
+          cost_per_input, [&](int64_t start, int64_t limit) {
+            std::vector<StringPiece> tokens;
+            for (int64_t i = start; i < limit; ++i) {
+              SplitInto(input_vec(i), split_sep_, &tokens);
+              splits_vec(i + 1) = NumNGrams(tokens.size());
+            }
+          });
+    for (int64_t i = 0; i < batch_size; ++i) {
+      splits_vec(i + 1) += splits_vec(i);
+    }
+
+    Tensor* output;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({splits_vec(batch_size)}), &output));
+    auto output_vec = output->vec<int64_t>();
+    Shard(worker_threads.num_threads, worker_threads.workers, batch_size,
+          2 * ngram_widths_.size() * cost_per_input,
+          [&](int64_t start, int64_t limit) {
+            std::vector<StringPiece> tokens;
+            std::string scratch;
+            for (int64_t i = start; i < limit; ++i) {
+              SplitInto(input_vec(i), split_sep_, &tokens);
+              int64_t* out = &output_vec(splits_vec(i));
+              const int num_tokens = tokens.size();
+              for (int ngram_width : ngram_widths_) {
+                for (int t = 0; t + ngram_width <= num_tokens; ++t) {
+                  *out++ = Bucket(&tokens[t], ngram_width, &scratch);
+                }
+              }
+              if (out == &output_vec(splits_vec(i)) && preserve_short_ &&
+                  num_tokens > 0) {
+                *out++ = Bucket(tokens.data(), num_tokens, &scratch);
+              }
+              DCHECK_EQ(out - output_vec.data(), splits_vec(i + 1));
+            }
+          });
+  }
+
+ private:
+  SPLITS_TYPE NumNGrams(int num_tokens) const {
+    SPLITS_TYPE num_ngrams = 0;
+    for (int ngram_width : ngram_widths_) {
+      num_ngrams += std::max(0, num_tokens - ngram_width + 1);
+    }
+    if (preserve_short_ && num_tokens > 0 && num_ngrams == 0) {
+      num_ngrams = 1;
+    }
+    return num_ngrams;
+  }
+
+  // Returns the bucket of the n-gram of the `n` tokens at `tokens`.
+  int64_t Bucket(const StringPiece* tokens, int n, std::string* scratch) const {
+    StringPiece ngram = tokens[0];
+    for (int j = 1; j < n; ++j) {
+      const char* gap = ngram.data() + ngram.size();
+      if (tokens[j].data() != gap + separator_.size() ||
+          StringPiece(gap, separator_.size()) != separator_) {
+        ngram = Join(tokens, n, scratch);
+        break;
+      }
+      ngram = StringPiece(ngram.data(), tokens[j].data() + tokens[j].size() -
+                                            ngram.data());
+    }
+    // The number of buckets is always in the positive range of int64 so is
+    // the resulting bucket id.
+    return static_cast<int64_t>(Fingerprint64(ngram) % num_buckets_);
+  }
+
+  StringPiece Join(const StringPiece* tokens, int n,
+                   std::string* scratch) const {
+    scratch->clear();
+    for (int j = 0; j < n; ++j) {
+      if (j > 0) scratch->append(separator_);
+      scratch->append(tokens[j].data(), tokens[j].size());
+    }
+    return *scratch;
+  }
+
+  string split_sep_;
+  string separator_;
+  std::vector<int> ngram_widths_;
+  bool preserve_short_;
+  int64_t num_buckets_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StringNGramsToHashBucketFastOp);
+};
+
+}  // namespace
+
+REGISTER_KERNEL_BUILDER(Name("StringNGramsToHashBucketFast")
+                            .Device(DEVICE_CPU)
+                            .TypeConstraint<int32>("Tsplits"),
+                        StringNGramsToHashBucketFastOp<int32>);
+REGISTER_KERNEL_BUILDER(Name("StringNGramsToHashBucketFast")
+                            .Device(DEVICE_CPU)
+                            .TypeConstraint<int64_t>("Tsplits"),
+                        StringNGramsToHashBucketFastOp<int64_t>);
+
+}  // namespace text
+}  // namespace tensorflow
@@ -0,0 +1,95 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace text {
+namespace {
+
+constexpr int64_t kNumBuckets = 1000;
+
+class StringNGramsToHashBucketFastOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(const string& split_separator, const string& separator,
+              const std::vector<int>& ngram_widths, bool preserve) {
+    TF_ASSERT_OK(NodeDefBuilder("tested_op", "StringNGramsToHashBucketFast")
+                     .Attr("split_separator", split_separator)
+                     .Attr("separator", separator)
+                     .Attr("ngram_widths", ngram_widths)
+                     .Attr("preserve_short_sequences", preserve)
+                     .Attr("num_buckets", kNumBuckets)
+                     .Input(FakeInput())
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  void ExpectBuckets(const std::vector<string>& ngrams,
+                     const std::vector<int64_t>& splits) {
+    std::vector<int64_t> buckets;
+    for (const string& ngram : ngrams) {
+      buckets.push_back(Fingerprint64(ngram) % kNumBuckets);
+    }
+    test::ExpectTensorEqual<int64_t>(*GetOutput(0),
+                                     test::AsTensor<int64_t>(buckets));
+    test::ExpectTensorEqual<int64_t>(*GetOutput(1),
+                                     test::AsTensor<int64_t>(splits));
+  }
+};
+
+TEST_F(StringNGramsToHashBucketFastOpTest, WhitespaceSplitBigrams) {
+  MakeOp("", " ", {1, 2}, false);
+  AddInputFromArray<tstring>(TensorShape({3}),
+                             {"a b  c", " d\te ", ""});
+  TF_ASSERT_OK(RunOpKernel());
+  // The bigrams of the tokens separated by single spaces are hashed in
+  // place, the others are joined.
+  ExpectBuckets({"a", "b", "c", "a b", "b c", "d", "e", "d e"}, {0, 5, 8, 8});
+}
+
+TEST_F(StringNGramsToHashBucketFastOpTest, SeparatorSplitKeepsEmptyTokens) {
+  MakeOp(",", "|", {2}, false);
+  AddInputFromArray<tstring>(TensorShape({2}), {"x,,y", "z"});
+  TF_ASSERT_OK(RunOpKernel());
+  ExpectBuckets({"x|", "|y"}, {0, 2, 2});
+}
+
+TEST_F(StringNGramsToHashBucketFastOpTest, PreserveShortSequences) {
+  MakeOp("", "_", {3}, true);
+  AddInputFromArray<tstring>(TensorShape({3}), {"p q", "r s t", " "});
+  TF_ASSERT_OK(RunOpKernel());
+  ExpectBuckets({"p_q", "r_s_t"}, {0, 1, 2, 2});
+}
+
+TEST_F(StringNGramsToHashBucketFastOpTest, RejectsNonVectorInput) {
+  MakeOp("", " ", {1}, false);
+  AddInputFromArray<tstring>(TensorShape({1, 1}), {"a"});
+  EXPECT_FALSE(RunOpKernel().ok());
+}
+
+}  // namespace
+}  // namespace text
+}  // namespace tensorflow
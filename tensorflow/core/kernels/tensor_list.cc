@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/tensor_list.h"
 
+#include <utility>
+#include <vector>
+
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
@@ -51,10 +54,7 @@ void TensorList::Encode(VariantTensorData* data) const {
   data->set_metadata(metadata);
 }
 
-bool TensorList::Decode(const VariantTensorData& data) {
-  // TODO(srbs): Change the signature to Decode(VariantTensorData data) so
-  // that we do not have to copy each tensor individually below. This would
-  // require changing VariantTensorData::tensors() as well.
+bool TensorList::Decode(VariantTensorData data) {
   string metadata;
   data.get_metadata(&metadata);
   uint64 scratch;
@@ -68,17 +68,18 @@ bool TensorList::Decode(const VariantTensorData& data) {
     invalid_indices[i] = static_cast<size_t>(scratch);
   }
 
-  size_t total_num_tensors = data.tensors().size() + num_invalid_tensors;
+  std::vector<Tensor>& data_tensors = *data.mutable_tensors();
+  size_t total_num_tensors = data_tensors.size() + num_invalid_tensors;
   tensors().reserve(total_num_tensors);
   std::vector<size_t>::iterator invalid_indices_it = invalid_indices.begin();
-  std::vector<Tensor>::const_iterator tensors_it = data.tensors().begin();
+  std::vector<Tensor>::iterator tensors_it = data_tensors.begin();
   for (size_t i = 0; i < total_num_tensors; i++) {
     if (invalid_indices_it != invalid_indices.end() &&
         *invalid_indices_it == i) {
       tensors().emplace_back(Tensor(DT_INVALID));
       invalid_indices_it++;
-    } else if (tensors_it != data.tensors().end()) {
-      tensors().emplace_back(*tensors_it);
+    } else if (tensors_it != data_tensors.end()) {
+      tensors().emplace_back(std::move(*tensors_it));
       tensors_it++;
     } else {
       // VariantTensorData is corrupted.
@@ -109,7 +109,7 @@ class TensorList {
 
   void Encode(VariantTensorData* data) const;
 
-  bool Decode(const VariantTensorData& data);
+  bool Decode(VariantTensorData data);
 
   // TODO(apassos) fill this out
   string DebugString() const { return "TensorList"; }
@@ -20,7 +20,9 @@ limitations under the License.
 #include "tensorflow/core/kernels/topk_op.h"
 
 #include <algorithm>
+#include <functional>
 #include <numeric>
+#include <type_traits>
 #include <vector>
 
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
@@ -110,6 +112,218 @@ class TopK : public OpKernel {
 
 namespace functor {
 
+// Maps the values of T to unsigned integers of the same size in the same order,
+// so that the k-th largest value can be found one byte at a time. -0 and 0 map
+// to the same key, since they are equal. NaNs are not ordered.
+template <int kBytes>
+struct UnsignedOfSize;
+template <>
+struct UnsignedOfSize<1> {
+  using Type = uint8;
+};
+template <>
+struct UnsignedOfSize<2> {
+  using Type = uint16;
+};
+template <>
+struct UnsignedOfSize<4> {
+  using Type = uint32;
+};
+template <>
+struct UnsignedOfSize<8> {
+  using Type = uint64;
+};
+
+template <typename T, typename Enable = void>
+struct RadixKey {
+  using Type = typename UnsignedOfSize<sizeof(T)>::Type;
+  static constexpr Type kSignBit = Type{1} << (8 * sizeof(T) - 1);
+
+  static bool IsNaN(T value) { return Eigen::numext::isnan(value); }
+  static Type Of(T value) {
+    if (value == T(0)) return kSignBit;
+    const Type bits = Eigen::numext::bit_cast<Type>(value);
+    return (bits & kSignBit) ? static_cast<Type>(~bits)
+                             : static_cast<Type>(bits | kSignBit);
+  }
+};
+
+template <typename T>
+struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+  using Type = typename std::make_unsigned<T>::type;
+  static constexpr Type kSignBit =
+      std::is_signed<T>::value ? Type{1} << (8 * sizeof(T) - 1) : 0;
+
+  static bool IsNaN(T value) { return false; }
+  static Type Of(T value) { return static_cast<Type>(value) ^ kSignBit; }
+};
+
+// Rows with at least this many columns are selected by RadixTopK rather than
+// with a heap, if at least kMinRadixSelectK of their values are selected.
+constexpr int64_t kMinRadixSelectCols = 1 << 16;
+constexpr int kMinRadixSelectK = 16;
+
+// Selects the indices of the top k values of a row by radix select: the k-th
+// largest value is found one byte of its RadixKey at a time, from histograms
+// of the candidate keys, and the values greater than it, then the first values
+// equal to it, are selected. The selected indices are the ones of the heap,
+// which breaks ties by index, in increasing order.
+//
+// The columns of the row are split into `num_chunks` chunks, which the steps
+// that scan the row process independently, so that they can run in parallel:
+//   for each chunk: ComputeHistogram(chunk)
+//   if (!SelectTopByte()) the row holds a NaN
+//   for each chunk: GatherCandidates(chunk)
+//   SelectThreshold()
+//   for each chunk: WriteIndices(chunk, indices)
+template <typename T>
+class RadixTopK {
+ public:
+  RadixTopK(const T* row, int64_t num_cols, int k, int num_chunks)
+      : row_(row),
+        num_cols_(num_cols),
+        k_(k),
+        num_chunks_(num_chunks),
+        histograms_(num_chunks * 256, 0),
+        has_nan_(num_chunks, false),
+        candidates_(num_chunks),
+        num_selected_(num_chunks),
+        num_selected_equal_(num_chunks),
+        first_index_(num_chunks) {}
+
+  // Counts the top bytes of the keys of `chunk`.
+  void ComputeHistogram(int chunk) {
+    int64_t* histogram = &histograms_[chunk * 256];
+    for (int64_t c = ChunkStart(chunk); c < ChunkStart(chunk + 1); ++c) {
+      if (RadixKey<T>::IsNaN(row_[c])) {
+        has_nan_[chunk] = true;
+        return;
+      }
+      ++histogram[RadixKey<T>::Of(row_[c]) >> kTopShift];
+    }
+  }
+
+  // Selects the top byte of the k-th largest key. Returns false if the row
+  // holds a NaN, in which case the row must be selected another way.
+  bool SelectTopByte() {
+    for (int chunk = 0; chunk < num_chunks_; ++chunk) {
+      if (has_nan_[chunk]) return false;
+    }
+    int64_t histogram[256] = {};
+    for (int chunk = 0; chunk < num_chunks_; ++chunk) {
+      for (int b = 0; b < 256; ++b) {
+        histogram[b] += histograms_[chunk * 256 + b];
+      }
+    }
+    remaining_ = k_;
+    top_byte_ = SelectByte(histogram);
+    return true;
+  }
+
+  // Gathers the keys of `chunk` with the selected top byte.
+  void GatherCandidates(int chunk) {
+    std::vector<Key>& candidates = candidates_[chunk];
+    candidates.reserve(histograms_[chunk * 256 + top_byte_]);
+    for (int64_t c = ChunkStart(chunk); c < ChunkStart(chunk + 1); ++c) {
+      const Key key = RadixKey<T>::Of(row_[c]);
+      if (static_cast<int>(key >> kTopShift) == top_byte_) {
+        candidates.push_back(key);
+      }
+    }
+  }
+
+  // Selects the other bytes of the k-th largest key among the candidates, and
+  // the number of values each chunk selects.
+  void SelectThreshold() {
+    Key prefix = static_cast<Key>(static_cast<Key>(top_byte_) << kTopShift);
+    Key mask = static_cast<Key>(Key{0xFF} << kTopShift);
+    for (int shift = kTopShift - 8; shift >= 0; shift -= 8) {
+      int64_t histogram[256] = {};
+      for (const std::vector<Key>& candidates : candidates_) {
+        for (const Key key : candidates) {
+          if ((key & mask) == prefix) {
+            ++histogram[(key >> shift) & 0xFF];
+          }
+        }
+      }
+      prefix |=
+          static_cast<Key>(static_cast<Key>(SelectByte(histogram)) << shift);
+      mask |= static_cast<Key>(Key{0xFF} << shift);
+    }
+    threshold_ = prefix;
+
+    // `remaining_` values equal to the threshold are selected, the first ones
+    // by index.
+    int64_t num_equal_left = remaining_;
+    int64_t first_index = 0;
+    for (int chunk = 0; chunk < num_chunks_; ++chunk) {
+      int64_t num_greater = 0;
+      for (int b = top_byte_ + 1; b < 256; ++b) {
+        num_greater += histograms_[chunk * 256 + b];
+      }
+      int64_t num_equal = 0;
+      for (const Key key : candidates_[chunk]) {
+        num_greater += key > threshold_;
+        num_equal += key == threshold_;
+      }
+      num_selected_equal_[chunk] = std::min(num_equal, num_equal_left);
+      num_equal_left -= num_selected_equal_[chunk];
+      num_selected_[chunk] = num_greater + num_selected_equal_[chunk];
+      first_index_[chunk] = first_index;
+      first_index += num_selected_[chunk];
+    }
+    DCHECK_EQ(first_index, k_);
+  }
+
+  // Writes the selected indices of `chunk` to their range of the `k` entries
+  // of `indices`.
+  void WriteIndices(int chunk, int32* indices) const {
+    int32* out = indices + first_index_[chunk];
+    int64_t num_equal_left = num_selected_equal_[chunk];
+    for (int64_t c = ChunkStart(chunk); c < ChunkStart(chunk + 1); ++c) {
+      const Key key = RadixKey<T>::Of(row_[c]);
+      if (key > threshold_ || (key == threshold_ && num_equal_left-- > 0)) {
+        *out++ = static_cast<int32>(c);
+      }
+    }
+    DCHECK_EQ(out - indices, first_index_[chunk] + num_selected_[chunk]);
+  }
+
+ private:
+  using Key = typename RadixKey<T>::Type;
+  static constexpr int kTopShift = 8 * sizeof(Key) - 8;
+
+  int64_t ChunkStart(int chunk) const {
+    return num_cols_ * chunk / num_chunks_;
+  }
+
+  // Returns the byte of the `remaining_`-th largest key, given the histogram
+  // of the bytes of the keys, and subtracts from `remaining_` the number of
+  // keys with a larger byte.
+  int SelectByte(const int64_t* histogram) {
+    int b = 255;
+    for (; b > 0 && histogram[b] < remaining_; --b) {
+      remaining_ -= histogram[b];
+    }
+    return b;
+  }
+
+  const T* const row_;
+  const int64_t num_cols_;
+  const int k_;
+  const int num_chunks_;
+  std::vector<int64_t> histograms_;
+  // Not a vector<bool>, whose entries may share bytes across chunks.
+  std::vector<char> has_nan_;
+  std::vector<std::vector<Key>> candidates_;
+  int64_t remaining_ = 0;
+  int top_byte_ = 0;
+  Key threshold_ = 0;
+  std::vector<int64_t> num_selected_;
+  std::vector<int64_t> num_selected_equal_;
+  std::vector<int64_t> first_index_;
+};
+
 template <typename T>
 struct TopKFunctor<CPUDevice, T> {
   static EIGEN_ALWAYS_INLINE Status Compute(
@@ -142,19 +356,48 @@ struct TopKFunctor<CPUDevice, T> {
       return OkStatus();
     }
 
+    const auto StableComp = [](const T* input_data) {
+      return [input_data](const int32_t a, const int32_t b) {
+        if (input_data[b] < input_data[a]) {
+          return true;
+        } else if (input_data[b] > input_data[a]) {
+          return false;
+        } else {
+          return a < b;
+        }
+      };
+    };
+
+    // Selects the top k indices of row `b` with RadixTopK, splitting its
+    // columns into `num_chunks` chunks that `for_each_chunk` processes. Returns
+    // false if the row holds a NaN, leaving its indices unset.
+    const bool use_radix_select = k < num_cols && k >= kMinRadixSelectK &&
+                                  num_cols >= kMinRadixSelectCols;
+    using ForEachChunk = std::function<void(const std::function<void(int)>&)>;
+    auto RadixSelectRow = [&](int64_t b, int num_chunks,
+                              const ForEachChunk& for_each_chunk) {
+      RadixTopK<T> select(&input(b, 0), num_cols, k, num_chunks);
+      for_each_chunk([&select](int chunk) { select.ComputeHistogram(chunk); });
+      if (!select.SelectTopByte()) return false;
+      for_each_chunk([&select](int chunk) { select.GatherCandidates(chunk); });
+      select.SelectThreshold();
+      int32* row_indices = &indices(b, 0);
+      for_each_chunk([&select, row_indices](int chunk) {
+        select.WriteIndices(chunk, row_indices);
+      });
+      if (sorted) {
+        std::sort(row_indices, row_indices + k, StableComp(&input(b, 0)));
+      }
+      return true;
+    };
+    const ForEachChunk for_one_chunk = [](const std::function<void(int)>& fn) {
+      fn(0);
+    };
+
     auto SortIndices = [&](int64_t start_batch, int64_t limit_batch) {
       for (int32_t b = start_batch; b < limit_batch; ++b) {
         const T* input_data = &input(b, 0);
-        const auto stable_comp = [input_data](const int32_t a,
-                                              const int32_t b) {
-          if (input_data[b] < input_data[a]) {
-            return true;
-          } else if (input_data[b] > input_data[a]) {
-            return false;
-          } else {
-            return a < b;
-          }
-        };
+        const auto stable_comp = StableComp(input_data);
         const auto comp = [input_data](const int32_t a, const int32_t b) {
           return input_data[b] < input_data[a];
         };
@@ -185,6 +428,8 @@ struct TopKFunctor<CPUDevice, T> {
             }
             run_begin = run_end;
           }
+        } else if (use_radix_select && RadixSelectRow(b, 1, for_one_chunk)) {
+          // The indices of the row are selected already.
         } else {
           // Use the TopN heap object to sort.
           gtl::TopN<int32, decltype(stable_comp)> filter(k, stable_comp);
@@ -230,6 +475,35 @@ struct TopKFunctor<CPUDevice, T> {
                                    ? kint64max
                                    : static_cast<int64_t>(total_cost);
     auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+
+    // With fewer rows than threads, split each row across the threads instead.
+    if (use_radix_select && num_rows < worker_threads.num_threads) {
+      const int num_chunks = worker_threads.num_threads;
+      const int64_t chunk_cost = static_cast<int64_t>(
+          cmp_cost * static_cast<double>(num_cols / num_chunks));
+      const ForEachChunk for_all_chunks =
+          [&](const std::function<void(int)>& fn) {
+            Shard(worker_threads.num_threads, worker_threads.workers,
+                  num_chunks, chunk_cost,
+                  [&fn](int64_t start_chunk, int64_t limit_chunk) {
+                    for (int64_t chunk = start_chunk; chunk < limit_chunk;
+                         ++chunk) {
+                      fn(chunk);
+                    }
+                  });
+          };
+      for (int64_t b = 0; b < num_rows; ++b) {
+        if (RadixSelectRow(b, num_chunks, for_all_chunks)) {
+          std::transform(
+              &indices(b, 0), &indices(b, k), &values(b, 0),
+              [b, &input](const int32_t loc) { return input(b, loc); });
+        } else {
+          SortIndices(b, b + 1);
+        }
+      }
+      return OkStatus();
+    }
+
     Shard(worker_threads.num_threads, worker_threads.workers, num_rows,
           final_cost, SortIndices);
 
@@ -16,6 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_TRAINING_OP_HELPERS_H_
 #define TENSORFLOW_CORE_KERNELS_TRAINING_OP_HELPERS_H_
 
+#include <initializer_list>
+#include <type_traits>
+
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
@@ -245,6 +248,7 @@ Status GetInputTensorFromVariable(OpKernelContext* ctx, int input,
     }
     TF_RETURN_IF_ERROR(PrepareToUpdateVariable<Device, T>(
         ctx, var->tensor(), var->copy_on_read_mode.load()));
+    var->MarkAllRowsDirty();
     *out = *var->tensor();
     return OkStatus();
   }
@@ -252,6 +256,26 @@ Status GetInputTensorFromVariable(OpKernelContext* ctx, int input,
   return OkStatus();
 }
 
+// Marks the rows `indices` of the resource variables passed as inputs
+// `inputs` as written, for delta checkpoints (see Var::TakeDirtyRows()).
+// Marks all their rows when the indices are in device memory.
+template <typename Device>
+void MarkVariableRowsDirty(OpKernelContext* ctx,
+                           std::initializer_list<int> inputs,
+                           const Tensor& indices) {
+  if (!Var::DirtyRowsTracked()) return;
+  for (const int input : inputs) {
+    if (ctx->input_dtype(input) != DT_RESOURCE) continue;
+    core::RefCountPtr<Var> var;
+    if (!LookupResource(ctx, HandleFromInput(ctx, input), &var).ok()) continue;
+    if (std::is_same<Device, Eigen::ThreadPoolDevice>::value) {
+      var->MarkRowsDirty(indices);
+    } else {
+      var->MarkAllRowsDirty();
+    }
+  }
+}
+
 }  // end namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_KERNELS_TRAINING_OP_HELPERS_H_
@@ -17,6 +17,8 @@ limitations under the License.
 #include "tensorflow/core/kernels/training_ops.h"
 
 #include <algorithm>  // NOLINT
+#include <numeric>
+#include <vector>
 
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -26,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/bfloat16.h"
 #include "tensorflow/core/util/util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -771,6 +774,29 @@ struct SparseApplyAdadelta<CPUDevice, T, Tindex> {
   }
 };
 
+// Applies the Adam update with step size `alpha` to the `size` elements of a
+// variable at `var_ptr`, its accumulators at `m_ptr` and `v_ptr`, and its
+// gradient at `g_ptr`.
+template <typename T>
+void ApplyAdamToSpan(T* var_ptr, T* m_ptr, T* v_ptr, const T* g_ptr,
+                     Index size, T alpha, T beta1, T beta2, T epsilon,
+                     bool use_nesterov) {
+  auto var = typename TTypes<T>::UnalignedTensor(var_ptr, size);
+  auto m = typename TTypes<T>::UnalignedTensor(m_ptr, size);
+  auto v = typename TTypes<T>::UnalignedTensor(v_ptr, size);
+  auto g = typename TTypes<T>::UnalignedConstTensor(g_ptr, size);
+
+  if (use_nesterov) {
+    m += (g - m) * (T(1) - beta1);
+    v += (g.square() - v) * (T(1) - beta2);
+    var -= ((g * (T(1) - beta1) + beta1 * m) * alpha) / (v.sqrt() + epsilon);
+  } else {
+    m += (g - m) * (T(1) - beta1);
+    v += (g.square() - v) * (T(1) - beta2);
+    var -= (m * alpha) / (v.sqrt() + epsilon);
+  }
+}
+
 template <typename Device, typename T>
 struct ApplyAdamNonCuda {
   void operator()(const Device& d, typename TTypes<T>::Flat var,
@@ -806,21 +832,9 @@ struct ApplyAdamNonCuda {
                   use_nesterov, packet_size](int begin, int end) {
       int t_size = (end - begin) * packet_size;
       begin = begin * packet_size;
-      auto var = typename TTypes<T>::UnalignedTensor(var_ptr + begin, t_size);
-      auto m = typename TTypes<T>::UnalignedTensor(m_ptr + begin, t_size);
-      auto v = typename TTypes<T>::UnalignedTensor(v_ptr + begin, t_size);
-      auto g = typename TTypes<T>::UnalignedConstTensor(g_ptr + begin, t_size);
-
-      if (use_nesterov) {
-        m += (g - m) * (T(1) - beta1());
-        v += (g.square() - v) * (T(1) - beta2());
-        var -= ((g * (T(1) - beta1()) + beta1() * m) * alpha) /
-               (v.sqrt() + epsilon());
-      } else {
-        m += (g - m) * (T(1) - beta1());
-        v += (g.square() - v) * (T(1) - beta2());
-        var -= (m * alpha) / (v.sqrt() + epsilon());
-      }
+      ApplyAdamToSpan<T>(var_ptr + begin, m_ptr + begin, v_ptr + begin,
+                         g_ptr + begin, t_size, alpha, beta1(), beta2(),
+                         epsilon(), use_nesterov);
     };
 
     // Input data: var, v, m, grad.
@@ -1285,6 +1299,7 @@ class SparseApplyAdadeltaOp : public OpKernel {
           epsilon.scalar<T>(), grad.flat_outer_dims<T>(), indices_vec);
     }
 
+    MarkVariableRowsDirty<Device>(ctx, {0, 1, 2}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -1544,6 +1559,7 @@ class SparseApplyProximalGradientDescentOp : public OpKernel {
       }
     }
 
+    MarkVariableRowsDirty<CPUDevice>(ctx, {0}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -1947,6 +1963,7 @@ class SparseApplyAdagradOp : public OpKernel {
                  lr.scalar<T>(), lr.scalar<T>(), grad.flat_outer_dims<T>(),
                  indices.vec<Tindex>(), inner_dim, update_slots_));
 
+    MarkVariableRowsDirty<Device>(ctx, {0, 1}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -2080,6 +2097,7 @@ class SparseApplyAdagradV2Op : public OpKernel {
                  lr.scalar<T>(), epsilon.scalar<T>(), grad.flat_outer_dims<T>(),
                  indices.vec<Tindex>(), inner_dim, update_slots_));
 
+    MarkVariableRowsDirty<Device>(ctx, {0, 1}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -2228,6 +2246,7 @@ class SparseApplyProximalAdagradOp : public OpKernel {
                  lr.scalar<T>(), l1.scalar<T>(), l2.scalar<T>(),
                  grad.flat_outer_dims<T>(), indices.vec<Tindex>(), inner_dim));
 
+    MarkVariableRowsDirty<Device>(ctx, {0, 1}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -2557,6 +2576,7 @@ class SparseApplyAdagradDAOp : public OpKernel {
       }
     }
 
+    MarkVariableRowsDirty<CPUDevice>(ctx, {0, 1, 2}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -2930,6 +2950,7 @@ class SparseApplyFtrlOp : public OpKernel {
                  lr_power.scalar<T>(), grad.flat_outer_dims<T>(), indices_vec,
                  inner_dim, multiply_linear_by_lr_));
 
+    MarkVariableRowsDirty<Device>(ctx, {0, 1, 2}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -3250,6 +3271,7 @@ class SparseApplyMomentumOp : public OpKernel {
       }
     }
 
+    MarkVariableRowsDirty<CPUDevice>(ctx, {0, 1}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -3453,6 +3475,7 @@ class SparseApplyKerasMomentumOp : public OpKernel {
             "indices", SliceDebugString(indices.shape(), bad_i), " = ",
             indices_flat(bad_i), " is not in [0, ", var.dim_size(0), ")"));
 
+    MarkVariableRowsDirty<Device>(ctx, {0, 1}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -3654,6 +3677,130 @@ REGISTER_KERNELS(GPU, complex128);
 #undef REGISTER_CPU_KERNELS
 #undef REGISTER_KERNELS
 
+// Applies the updates of N ResourceApplyAdam ops with the same scalar inputs.
+// The elements of all the variables are split into chunks of about the same
+// size, which are sharded, so that many small variables are updated by one
+// kernel and one variable much larger than the others does not leave the
+// other threads idle.
+template <typename T>
+class ResourceApplyAdamMultiOp : public OpKernel {
+ public:
+  explicit ResourceApplyAdamMultiOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("N", &num_vars_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("use_locking", &use_exclusive_lock_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("use_nesterov", &use_nesterov_));
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    const bool sparse = false;
+    std::vector<int> variable_inputs(3 * num_vars_);
+    std::iota(variable_inputs.begin(), variable_inputs.end(), 0);
+    auto locks = MaybeLockVariableInputMutexesInOrder<CPUDevice, T>(
+        ctx, use_exclusive_lock_, sparse, variable_inputs);
+
+    // var[i], m[i] and v[i] are at 3 * i, 3 * i + 1 and 3 * i + 2.
+    std::vector<Tensor> variables(3 * num_vars_);
+    for (int i = 0; i < 3 * num_vars_; ++i) {
+      const int input = (i % 3) * num_vars_ + i / 3;
+      OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<CPUDevice, T>(
+                              ctx, input, use_exclusive_lock_, sparse,
+                              &variables[i]));
+      OP_REQUIRES(ctx, variables[i].IsInitialized(),
+                  errors::FailedPrecondition(
+                      "Attempting to use uninitialized variables: ",
+                      requested_input(input)));
+    }
+
+    const int scalars = 3 * num_vars_;
+    const char* const scalar_names[] = {"beta1_power", "beta2_power", "lr",
+                                        "beta1",       "beta2",
+                                        "epsilon"};
+    for (int i = 0; i < 6; ++i) {
+      const Tensor& scalar = ctx->input(scalars + i);
+      OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(scalar.shape()),
+                  errors::InvalidArgument(scalar_names[i], " is not a scalar: ",
+                                          scalar.shape().DebugString()));
+    }
+    const T beta1_power = ctx->input(scalars).scalar<T>()();
+    const T beta2_power = ctx->input(scalars + 1).scalar<T>()();
+    const T lr = ctx->input(scalars + 2).scalar<T>()();
+    const T beta1 = ctx->input(scalars + 3).scalar<T>()();
+    const T beta2 = ctx->input(scalars + 4).scalar<T>()();
+    const T epsilon = ctx->input(scalars + 5).scalar<T>()();
+
+    // The chunks of kChunkSize elements, but for the last of each variable,
+    // as (variable, first element) pairs.
+    std::vector<std::pair<int, int64_t>> chunks;
+    for (int i = 0; i < num_vars_; ++i) {
+      const Tensor& var = variables[3 * i];
+      const Tensor& m = variables[3 * i + 1];
+      const Tensor& v = variables[3 * i + 2];
+      const Tensor& grad = ctx->input(scalars + 6 + i);
+      OP_REQUIRES(ctx, var.shape().IsSameSize(m.shape()),
+                  errors::InvalidArgument(
+                      "var and m do not have the same shape",
+                      var.shape().DebugString(), " ", m.shape().DebugString()));
+      OP_REQUIRES(ctx, var.shape().IsSameSize(v.shape()),
+                  errors::InvalidArgument(
+                      "var and v do not have the same shape",
+                      var.shape().DebugString(), " ", v.shape().DebugString()));
+      OP_REQUIRES(
+          ctx, var.shape().IsSameSize(grad.shape()),
+          errors::InvalidArgument("var and grad do not have the same shape",
+                                  var.shape().DebugString(), " ",
+                                  grad.shape().DebugString()));
+      for (int64_t start = 0; start < var.NumElements(); start += kChunkSize) {
+        chunks.emplace_back(i, start);
+      }
+    }
+
+    const T alpha = lr * Eigen::numext::sqrt(T(1) - beta2_power) /
+                    (T(1) - beta1_power);
+    auto ApplyToChunks = [&](int64_t start_chunk, int64_t limit_chunk) {
+      for (int64_t c = start_chunk; c < limit_chunk; ++c) {
+        const int i = chunks[c].first;
+        const int64_t start = chunks[c].second;
+        const int64_t size =
+            std::min(kChunkSize, variables[3 * i].NumElements() - start);
+        functor::ApplyAdamToSpan<T>(
+            variables[3 * i].flat<T>().data() + start,
+            variables[3 * i + 1].flat<T>().data() + start,
+            variables[3 * i + 2].flat<T>().data() + start,
+            ctx->input(scalars + 6 + i).flat<T>().data() + start, size, alpha,
+            beta1, beta2, epsilon, use_nesterov_);
+      }
+    };
+    // The cost of ApplyAdamNonCuda per element.
+    const int64_t cost_per_chunk =
+        kChunkSize * (Eigen::TensorOpCost::AddCost<T>() * 10 +
+                      Eigen::TensorOpCost::MulCost<T>() * 6 +
+                      Eigen::TensorOpCost::DivCost<T>() + 7 * sizeof(T));
+    auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
+    Shard(worker_threads.num_threads, worker_threads.workers, chunks.size(),
+          cost_per_chunk, ApplyToChunks);
+  }
+
+ private:
+  static constexpr int64_t kChunkSize = 16384;
+
+  int num_vars_;
+  bool use_exclusive_lock_;
+  bool use_nesterov_;
+};
+
+#define REGISTER_CPU_KERNELS(T)                             \
+  REGISTER_KERNEL_BUILDER(Name("_ResourceApplyAdamMulti")   \
+                              .HostMemory("var")            \
+                              .HostMemory("m")              \
+                              .HostMemory("v")              \
+                              .Device(DEVICE_CPU)           \
+                              .TypeConstraint<T>("T"),      \
+                          ResourceApplyAdamMultiOp<T>);
+
+TF_CALL_FLOAT_TYPES(REGISTER_CPU_KERNELS);
+#undef REGISTER_CPU_KERNELS
+
 template <typename Device, typename T>
 class ApplyAdamWithAmsgradOp : public OpKernel {
  public:
@@ -4291,6 +4438,7 @@ class SparseApplyRMSPropOp : public OpKernel {
       }
     }
 
+    MarkVariableRowsDirty<CPUDevice>(ctx, {0, 1, 2}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -4433,6 +4581,7 @@ class SparseApplyCenteredRMSPropOp : public OpKernel {
       }
     }
 
+    MarkVariableRowsDirty<CPUDevice>(ctx, {0, 1, 2, 3}, indices);
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
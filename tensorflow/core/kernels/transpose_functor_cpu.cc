@@ -16,6 +16,9 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include <complex>
+#include <functional>
+#include <memory>
+#include <type_traits>
 
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/attr_value.pb.h"
@@ -25,6 +28,12 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/env_var.h"
+
+#if !defined(IS_MOBILE_PLATFORM)
+#include "tensorflow/compiler/xla/pjrt/transpose.h"
+#endif  // !defined(IS_MOBILE_PLATFORM)
 
 typedef Eigen::ThreadPoolDevice CPUDevice;
 
@@ -68,12 +77,71 @@ void TransposeSimple(const CPUDevice& device, const Tensor& in,
   device.parallelFor(in.NumElements(), cost, std::move(transpose_fn));
 }
 
+#if !defined(IS_MOBILE_PLATFORM)
+// Returns whether transposes use xla::TransposePlan, which can be disabled by
+// setting TF_CPU_USE_TRANSPOSE_PLANS=0.
+bool UseTransposePlans() {
+  static const bool use_transpose_plans = [] {
+    bool value;
+    TF_CHECK_OK(
+        ReadBoolFromEnvVar("TF_CPU_USE_TRANSPOSE_PLANS", true, &value));
+    return value;
+  }();
+  return use_transpose_plans;
+}
+
+// Transposes `in` into `out` with an xla::TransposePlan, which blocks the
+// transpose to be cache-friendly and uses vectorized kernels for the blocks,
+// unlike the Eigen shuffles that are slow for high ranks and small inner
+// dimensions. The plans are cached by shape and permutation, and executed on
+// the threads of `device`. Returns false if no plan supports the transpose.
+bool TransposeUsingPlan(const CPUDevice& device, const Tensor& in,
+                        const gtl::ArraySlice<int32> perm,
+                        size_t elem_size_in_bytes, Tensor* out) {
+  static constexpr int kPlanCacheCapacity = 64;
+  static mutex* mu = new mutex;
+  static xla::TransposePlanCache* cache =
+      new xla::TransposePlanCache(kPlanCacheCapacity);
+
+  const gtl::InlinedVector<int64_t, 4> dims = in.shape().dim_sizes();
+  const gtl::InlinedVector<int64_t, 8> permutation(perm.begin(), perm.end());
+  StatusOr<std::shared_ptr<xla::TransposePlan>> plan;
+  {
+    mutex_lock lock(*mu);
+    plan = cache->GetOrCreate(elem_size_in_bytes, dims, permutation,
+                              xla::TransposePlan::Tiling{},
+                              xla::TransposePlan::Tiling{},
+                              xla::TransposePlan::Transformation::kNone,
+                              device.numThreads());
+  }
+  if (!plan.ok()) {
+    VLOG(1) << "No transpose plan for " << in.shape().DebugString() << ": "
+            << plan.status();
+    return false;
+  }
+  (*plan)->Execute(in.tensor_data().data(),
+                   const_cast<char*>(out->tensor_data().data()),
+                   [&device](std::function<void()> work) {
+                     device.getPool()->Schedule(std::move(work));
+                   });
+  return true;
+}
+#endif  // !defined(IS_MOBILE_PLATFORM)
+
 }  // namespace
 
 template <typename T, bool conjugate>
 struct Transpose<CPUDevice, T, conjugate> {
   static void run(const CPUDevice& d, const Tensor& in,
                   const gtl::ArraySlice<int32> perm, Tensor* out) {
+#if !defined(IS_MOBILE_PLATFORM)
+    // The plans copy bytes, so they can't transpose e.g. strings.
+    if (!conjugate && std::is_trivially_copyable<T>::value &&
+        UseTransposePlans() &&
+        TransposeUsingPlan(d, in, perm, sizeof(T), out)) {
+      return;
+    }
+#endif  // !defined(IS_MOBILE_PLATFORM)
     switch (in.dims()) {
       case 2:
         internal::TransposeUsingEigen<CPUDevice, T, 2>(d, in, perm, conjugate,
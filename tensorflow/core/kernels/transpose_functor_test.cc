@@ -0,0 +1,183 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "absl/strings/str_join.h"
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/kernels/transpose_functor.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+template <typename T>
+T MakeValue(int i) {
+  return static_cast<T>(i % 251);
+}
+
+template <>
+complex64 MakeValue<complex64>(int i) {
+  return complex64(i, -i);
+}
+
+template <>
+complex128 MakeValue<complex128>(int i) {
+  return complex128(i, -2 * i);
+}
+
+template <>
+tstring MakeValue<tstring>(int i) {
+  // Longer than the inline capacity of tstring, so that the strings own heap
+  // memory.
+  return strings::StrCat("a string that is not stored inline ", i);
+}
+
+// Transposes `in` the way the CPU functor does with
+// TF_CPU_USE_TRANSPOSE_PLANS=0, i.e. with Eigen for ranks 2 to 8, and with an
+// index loop otherwise.
+template <typename T>
+void ReferenceTranspose(const CPUDevice& device, const Tensor& in,
+                        const std::vector<int32>& perm, Tensor* out) {
+  switch (in.dims()) {
+#define CASE(NDIMS)                                                          \
+  case NDIMS:                                                                \
+    internal::TransposeUsingEigen<CPUDevice, T, NDIMS>(device, in, perm,     \
+                                                       /*conjugate=*/false, \
+                                                       out);                 \
+    return;
+    CASE(2);
+    CASE(3);
+    CASE(4);
+    CASE(5);
+    CASE(6);
+    CASE(7);
+    CASE(8);
+#undef CASE
+    default:
+      break;
+  }
+  const int ndims = in.dims();
+  gtl::InlinedVector<int64_t, 8> in_strides =
+      ComputeStride<int64_t>(in.shape());
+  gtl::InlinedVector<int64_t, 8> out_strides =
+      ComputeStride<int64_t>(out->shape());
+  auto in_flat = in.flat<T>();
+  auto out_flat = out->flat<T>();
+  for (int64_t o_idx = 0; o_idx < out->NumElements(); ++o_idx) {
+    int64_t i_idx = 0;
+    int64_t t = o_idx;
+    for (int i = 0; i < ndims; ++i) {
+      i_idx += (t / out_strides[i]) * in_strides[perm[i]];
+      t %= out_strides[i];
+    }
+    out_flat(o_idx) = in_flat(i_idx);
+  }
+}
+
+class TransposeFunctorTest : public ::testing::Test {
+ protected:
+  TransposeFunctorTest()
+      : pool_(Env::Default(), "transpose_functor_test", kNumThreads),
+        device_(pool_.AsEigenThreadPool(), kNumThreads) {}
+
+  // Checks DoTranspose of a `shape` tensor by `perm` against
+  // ReferenceTranspose().
+  template <typename T>
+  void CheckTranspose(const TensorShape& shape,
+                      const std::vector<int32>& perm) {
+    SCOPED_TRACE(strings::StrCat(DataTypeString(DataTypeToEnum<T>::v()), " ",
+                                 shape.DebugString(), " perm ",
+                                 absl::StrJoin(perm, ",")));
+    Tensor in(DataTypeToEnum<T>::v(), shape);
+    test::FillFn<T>(&in, [](int i) { return MakeValue<T>(i); });
+    TensorShape out_shape;
+    for (int32 dim : perm) out_shape.AddDim(shape.dim_size(dim));
+    Tensor out(DataTypeToEnum<T>::v(), out_shape);
+    Tensor expected(DataTypeToEnum<T>::v(), out_shape);
+
+    TF_ASSERT_OK(DoTranspose(device_, in, perm, &out));
+    ReferenceTranspose<T>(device_, in, perm, &expected);
+    test::ExpectTensorEqual<T>(out, expected);
+  }
+
+  // Checks the transposes of random shapes of ranks 1 to 10, by the identity,
+  // the reversal and random permutations.
+  template <typename T>
+  void CheckRandomTransposes() {
+    std::mt19937 rng(/*seed=*/42);
+    for (int rank = 1; rank <= 10; ++rank) {
+      for (int i = 0; i < 4; ++i) {
+        // Keeps the tensors under about 4096 elements, with some dimensions
+        // of size 1.
+        const int max_dim = std::max(1, static_cast<int>(std::pow(
+                                            4096.0, 1.0 / rank)));
+        TensorShape shape;
+        for (int d = 0; d < rank; ++d) {
+          shape.AddDim(std::uniform_int_distribution<int>(1, max_dim)(rng));
+        }
+        std::vector<int32> perm(rank);
+        std::iota(perm.begin(), perm.end(), 0);
+        if (i == 1) {
+          std::reverse(perm.begin(), perm.end());
+        } else if (i > 1) {
+          std::shuffle(perm.begin(), perm.end(), rng);
+        }
+        CheckTranspose<T>(shape, perm);
+      }
+    }
+  }
+
+  static constexpr int kNumThreads = 4;
+  thread::ThreadPool pool_;
+  CPUDevice device_;
+};
+
+TEST_F(TransposeFunctorTest, Uint8) { CheckRandomTransposes<uint8>(); }
+TEST_F(TransposeFunctorTest, Int16) { CheckRandomTransposes<int16>(); }
+TEST_F(TransposeFunctorTest, Float) { CheckRandomTransposes<float>(); }
+TEST_F(TransposeFunctorTest, Double) { CheckRandomTransposes<double>(); }
+TEST_F(TransposeFunctorTest, Complex64) { CheckRandomTransposes<complex64>(); }
+TEST_F(TransposeFunctorTest, Complex128) {
+  CheckRandomTransposes<complex128>();
+}
+TEST_F(TransposeFunctorTest, String) { CheckRandomTransposes<tstring>(); }
+
+TEST_F(TransposeFunctorTest, LargeTransposes) {
+  // Large enough to be split between the threads.
+  CheckTranspose<float>(TensorShape({512, 384}), {1, 0});
+  CheckTranspose<uint8>(TensorShape({64, 3, 1024}), {2, 0, 1});
+  CheckTranspose<double>(TensorShape({8, 16, 32, 64}), {0, 3, 1, 2});
+  CheckTranspose<complex64>(TensorShape({3, 5, 7, 256}), {3, 2, 1, 0});
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -14,8 +14,10 @@ limitations under the License.
 ==============================================================================*/
 
 #include <functional>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/framework/bounds_check.h"
@@ -26,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/bfloat16.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace {
@@ -68,6 +71,149 @@ struct UniqueOpHashMap<bfloat16, TIndex> {
   using map_type = std::unordered_map<bfloat16, TIndex>;
 };
 
+// Vectors of integers with at least this many elements are uniquified in
+// parallel by `UniqueInParallel`.
+constexpr int64_t kMinParallelUniqueSize = 1 << 17;
+
+// Uniquifies the elements of `input`, a vector of integers, with the same
+// results as the sequential implementation of `UniqueOp`: the unique elements
+// are output in the order of their first occurrence. Sets `*uniq_size` to the
+// number of unique elements.
+//
+// The elements are partitioned by hash, so that all the occurrences of an
+// element land in the same partition, and the partitions are uniquified
+// independently. The index of a unique element in the output is then the
+// number of first occurrences of elements before its own.
+template <typename T, typename TIndex>
+void UniqueInParallel(OpKernelContext* context, const Tensor& input,
+                      int64_t axis, typename TTypes<TIndex>::Vec idx_vec,
+                      int64_t* uniq_size) {
+  const auto Tin = input.flat<T>();
+  const int64_t N = Tin.size();
+  const DeviceBase::CpuWorkerThreads& worker_threads =
+      *context->device()->tensorflow_cpu_worker_threads();
+
+  // One partition per thread, rounded up to a power of 2, and as many chunks
+  // of the input as partitions.
+  int log2_num_partitions = 0;
+  while ((1 << log2_num_partitions) < worker_threads.num_threads &&
+         log2_num_partitions < 8) {
+    ++log2_num_partitions;
+  }
+  const int num_partitions = 1 << log2_num_partitions;
+  const int num_chunks = num_partitions;
+  auto partition_of = [log2_num_partitions](T value) -> uint8 {
+    if (log2_num_partitions == 0) return 0;
+    return (static_cast<uint64>(value) * 0x9E3779B97F4A7C15ULL) >>
+           (64 - log2_num_partitions);
+  };
+  auto chunk_start = [N, num_chunks](int64_t chunk) {
+    return N * chunk / num_chunks;
+  };
+  // A hash map operation costs about 100 cycles.
+  const int64_t cost_per_chunk = 100 * (N / num_chunks + 1);
+  auto for_each_chunk = [&](std::function<void(int64_t)> fn) {
+    Shard(worker_threads.num_threads, worker_threads.workers, num_chunks,
+          cost_per_chunk, [&fn](int64_t begin, int64_t end) {
+            for (int64_t chunk = begin; chunk < end; ++chunk) {
+              fn(chunk);
+            }
+          });
+  };
+
+  // Partition the positions of the elements, in increasing order within each
+  // partition. The partition of each element is only computed once, so that
+  // the partitions are consistent.
+  std::vector<uint8> partitions(N);
+  std::vector<int64_t> counts(num_chunks * num_partitions, 0);
+  for_each_chunk([&](int64_t chunk) {
+    int64_t* chunk_counts = &counts[chunk * num_partitions];
+    for (int64_t i = chunk_start(chunk); i < chunk_start(chunk + 1); ++i) {
+      partitions[i] = partition_of(Tin(i));
+      ++chunk_counts[partitions[i]];
+    }
+  });
+  std::vector<int64_t> partition_starts(num_partitions + 1);
+  std::vector<int64_t> offsets(num_chunks * num_partitions);
+  int64_t offset = 0;
+  for (int p = 0; p < num_partitions; ++p) {
+    partition_starts[p] = offset;
+    for (int64_t chunk = 0; chunk < num_chunks; ++chunk) {
+      offsets[chunk * num_partitions + p] = offset;
+      offset += counts[chunk * num_partitions + p];
+    }
+  }
+  partition_starts[num_partitions] = N;
+  // The number of elements is limited to int32 by `UniqueOp`.
+  std::vector<int32> positions(N);
+  for_each_chunk([&](int64_t chunk) {
+    int64_t* chunk_offsets = &offsets[chunk * num_partitions];
+    for (int64_t i = chunk_start(chunk); i < chunk_start(chunk + 1); ++i) {
+      positions[chunk_offsets[partitions[i]]++] = i;
+    }
+  });
+
+  // Uniquify each partition. `local_ids` holds the index of each element
+  // among the unique elements of its partition, and `first_positions` the
+  // position of the first occurrence of each of them.
+  std::vector<int32> local_ids(N);
+  std::vector<std::vector<int32>> first_positions(num_partitions);
+  std::vector<uint8> is_first(N, 0);
+  for_each_chunk([&](int64_t p) {
+    typename UniqueOpHashMap<T, int32>::map_type uniq;
+    uniq.reserve(partition_starts[p + 1] - partition_starts[p]);
+    for (int64_t k = partition_starts[p]; k < partition_starts[p + 1]; ++k) {
+      const int32 i = positions[k];
+      auto it =
+          uniq.emplace(Tin(i), static_cast<int32>(first_positions[p].size()));
+      local_ids[k] = it.first->second;
+      if (it.second) {
+        first_positions[p].push_back(i);
+        is_first[i] = 1;
+      }
+    }
+  });
+
+  // Number the first occurrences in order, storing the index of each unique
+  // element at the position of its first occurrence in `idx_vec`.
+  std::vector<int64_t> chunk_num_firsts(num_chunks);
+  for_each_chunk([&](int64_t chunk) {
+    int64_t num_firsts = 0;
+    for (int64_t i = chunk_start(chunk); i < chunk_start(chunk + 1); ++i) {
+      num_firsts += is_first[i];
+    }
+    chunk_num_firsts[chunk] = num_firsts;
+  });
+  *uniq_size = 0;
+  for (int64_t chunk = 0; chunk < num_chunks; ++chunk) {
+    const int64_t num_firsts = chunk_num_firsts[chunk];
+    chunk_num_firsts[chunk] = *uniq_size;
+    *uniq_size += num_firsts;
+  }
+  for_each_chunk([&](int64_t chunk) {
+    TIndex next = chunk_num_firsts[chunk];
+    for (int64_t i = chunk_start(chunk); i < chunk_start(chunk + 1); ++i) {
+      if (is_first[i]) {
+        idx_vec(i) = next++;
+      }
+    }
+  });
+
+  TensorShape output_shape(input.shape());
+  output_shape.set_dim(axis, *uniq_size);
+  Tensor* output = nullptr;
+  OP_REQUIRES_OK(context, context->allocate_output(0, output_shape, &output));
+  auto Tout = output->flat<T>();
+  for_each_chunk([&](int64_t p) {
+    for (int32 first_position : first_positions[p]) {
+      Tout(idx_vec(first_position)) = Tin(first_position);
+    }
+    for (int64_t k = partition_starts[p]; k < partition_starts[p + 1]; ++k) {
+      idx_vec(positions[k]) = idx_vec(first_positions[p][local_ids[k]]);
+    }
+  });
+}
+
 // `UniqueOp` computes the unique elements in the input tensor.
 //
 // * `T` is the element type.
@@ -150,26 +296,33 @@ class UniqueOp : public OpKernel {
       auto Tin = input.flat<T>();
       const int64_t N = static_cast<int64_t>(Tin.size());
 
-      typename UniqueOpHashMap<T, TIndex>::map_type uniq;
-      uniq.reserve(2 * N);
-      for (Eigen::Index i = 0, j = 0; i < N; ++i) {
-        auto it = uniq.emplace(Tin(i), j);
-        idx_vec(i) = it.first->second;
-        if (it.second) {
-          ++j;
+      if (std::is_integral<T>::value && N >= kMinParallelUniqueSize &&
+          context->device()->tensorflow_cpu_worker_threads()->num_threads >
+              1) {
+        UniqueInParallel<T, TIndex>(context, input, axis, idx_vec, &uniq_size);
+        if (!context->status().ok()) return;
+      } else {
+        typename UniqueOpHashMap<T, TIndex>::map_type uniq;
+        uniq.reserve(2 * N);
+        for (Eigen::Index i = 0, j = 0; i < N; ++i) {
+          auto it = uniq.emplace(Tin(i), j);
+          idx_vec(i) = it.first->second;
+          if (it.second) {
+            ++j;
+          }
         }
-      }
 
-      uniq_size = static_cast<int64_t>(uniq.size());
-      TensorShape output_shape(input.shape());
-      output_shape.set_dim(axis, uniq_size);
-      Tensor* output = nullptr;
-      OP_REQUIRES_OK(context,
-                     context->allocate_output(0, output_shape, &output));
-      auto Tout = output->flat<T>();
+        uniq_size = static_cast<int64_t>(uniq.size());
+        TensorShape output_shape(input.shape());
+        output_shape.set_dim(axis, uniq_size);
+        Tensor* output = nullptr;
+        OP_REQUIRES_OK(context,
+                       context->allocate_output(0, output_shape, &output));
+        auto Tout = output->flat<T>();
 
-      for (const auto& it : uniq) {
-        Tout(it.second) = it.first;
+        for (const auto& it : uniq) {
+          Tout(it.second) = it.first;
+        }
       }
     } else {
       // General implementation when unique is run over multiple elements.
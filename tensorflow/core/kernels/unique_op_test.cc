@@ -15,11 +15,16 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
@@ -37,6 +42,46 @@ namespace {
 
 const int kMaxStrLen = 40;
 
+class UniqueOpTest : public OpsTestBase {};
+
+// Large integer inputs are uniquified in parallel, with the same results as
+// the sequential implementation.
+TEST_F(UniqueOpTest, LargeInt64InputKeepsFirstOccurrenceOrder) {
+  TF_ASSERT_OK(NodeDefBuilder("unique", "UniqueWithCounts")
+                   .Input(FakeInput(DT_INT64))
+                   .Attr("out_idx", DT_INT32)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+
+  const int kSize = 1 << 18;
+  std::vector<int64_t> values(kSize);
+  for (int i = 0; i < kSize; ++i) {
+    values[i] = (i * int64_t{7919}) % 10007 - 5000;
+  }
+  AddInputFromArray<int64_t>(TensorShape({kSize}), values);
+  TF_ASSERT_OK(RunOpKernel());
+
+  std::unordered_map<int64_t, int32> unique_index;
+  std::vector<int64_t> expected_unique;
+  std::vector<int32> expected_idx;
+  std::vector<int32> expected_count;
+  for (int64_t value : values) {
+    auto it = unique_index.emplace(value, expected_unique.size());
+    if (it.second) {
+      expected_unique.push_back(value);
+      expected_count.push_back(0);
+    }
+    expected_idx.push_back(it.first->second);
+    ++expected_count[it.first->second];
+  }
+  test::ExpectTensorEqual<int64_t>(*GetOutput(0),
+                                   test::AsTensor<int64_t>(expected_unique));
+  test::ExpectTensorEqual<int32>(*GetOutput(1),
+                                 test::AsTensor<int32>(expected_idx));
+  test::ExpectTensorEqual<int32>(*GetOutput(2),
+                                 test::AsTensor<int32>(expected_count));
+}
+
 TensorProto GetRandomInt32TensorProto(int dim, int max_int) {
   TensorProto tensor_proto;
   tensor_proto.set_dtype(DT_INT32);
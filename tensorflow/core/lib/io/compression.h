@@ -22,6 +22,8 @@ namespace tensorflow {
 namespace io {
 namespace compression {
 // NOLINTBEGIN(misc-unused-using-decls)
+using tsl::io::compression::kBlockSnappy;
+using tsl::io::compression::kBlockZlib;
 using tsl::io::compression::kGzip;
 using tsl::io::compression::kNone;
 using tsl::io::compression::kSnappy;
@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/lib/monitoring/counter.h"
 
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -44,6 +47,22 @@ TEST(LabeledCounterTest, GetCell) {
   EXPECT_EQ(100, same_cell->value());
 }
 
+TEST(LabeledCounterTest, IncrementFromManyThreads) {
+  auto* cell = counter_with_labels->GetCell("ManyThreadsOp");
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 20; ++i) {
+    threads.emplace_back([cell, i]() {
+      for (int j = 0; j < 1000; ++j) {
+        cell->IncrementBy(i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(190 * 1000, cell->value());
+}
+
 TEST(LabeledCounterDeathTest, DiesOnDecrement) {
   EXPECT_DEBUG_DEATH(
       { counter_with_labels->GetCell("DyingOp")->IncrementBy(-1); },
@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/lib/monitoring/sampler.h"
 
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -58,6 +61,27 @@ TEST(LabeledSamplerTest, ExplicitBucketBoundaries) {
   EqHistograms(expected, cell->value());
 }
 
+TEST(LabeledSamplerTest, AddFromManyThreads) {
+  Histogram expected({10.0, 20.0, DBL_MAX});
+  auto* cell = sampler_with_labels->GetCell("ManyThreads");
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 20; ++i) {
+    for (int j = 0; j < 100; ++j) {
+      expected.Add(i + j % 10);
+    }
+    threads.emplace_back([cell, i]() {
+      for (int j = 0; j < 100; ++j) {
+        cell->Add(i + j % 10);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EqHistograms(expected, cell->value());
+}
+
 auto* init_sampler_without_labels =
     Sampler<0>::New({"/tensorflow/test/init_sampler_without_labels",
                      "Sampler without labels initialized as empty."},
@@ -54,6 +54,11 @@ REGISTER_OP("BatchFunction")
     // NOTE: Support for `enable_large_batch_splitting == true` is still
     // developed in progress.
     .Attr("enable_large_batch_splitting: bool = false")
+    // If 'length_buckets' is set, inputs are padded along 'length_dim' to the
+    // smallest bucket fitting them, and batched with the inputs of the same
+    // bucket only.
+    .Attr("length_buckets: list(int) = []")
+    .Attr("length_dim: int = 1")
     // TODO(apassos): Fix this shape inference function. It requires shape
     // inference of function calls.
     .SetShapeFn(shape_inference::UnknownShape)
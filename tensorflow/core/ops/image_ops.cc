@@ -516,6 +516,29 @@ REGISTER_OP("DecodeAndCropJpeg")
       return OkStatus();
     });
 
+// --------------------------------------------------------------------------
+REGISTER_OP("DecodeAndResizeJpegBatch")
+    .Input("contents: string")
+    .Input("size: int32")
+    .Attr("channels: int = 3")
+    .Attr("fancy_upscaling: bool = true")
+    .Attr("try_recover_truncated: bool = false")
+    .Attr("acceptable_fraction: float = 1.0")
+    .Attr("dct_method: string = ''")
+    .Output("images: float")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle contents;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &contents));
+      int32_t channels;
+      TF_RETURN_IF_ERROR(c->GetAttr("channels", &channels));
+      if (channels != 1 && channels != 3) {
+        return errors::InvalidArgument("channels must be 1 or 3, got ",
+                                       channels);
+      }
+      return SetOutputToSizedImage(c, c->Dim(contents, 0), /*size_input_idx=*/1,
+                                   c->MakeDim(channels));
+    });
+
 // --------------------------------------------------------------------------
 REGISTER_OP("EncodeJpeg")
     .Input("image: uint8")
@@ -912,6 +935,45 @@ REGISTER_OP("CropAndResize")
                                    c->Dim(input, 3));
     });
 
+REGISTER_OP("CropResizeAndNormalize")
+    .Input("image: T")
+    .Input("boxes: float")
+    .Input("box_ind: int32")
+    .Input("crop_size: int32")
+    .Input("offset: float")
+    .Input("scale: float")
+    .Output("crops: float")
+    .Attr("T: {uint8, uint16, int8, int16, int32, int64, half, float, double}")
+    .Attr("extrapolation_value: float = 0")
+    .Attr("data_format: {'NHWC', 'NCHW'} = 'NHWC'")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 4, &input));
+      ShapeHandle boxes;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 2, &boxes));
+      ShapeHandle box_ind;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &box_ind));
+      DimensionHandle num_boxes_dim;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(boxes, 0), c->Dim(box_ind, 0), &num_boxes_dim));
+      DimensionHandle unused;
+      TF_RETURN_IF_ERROR(c->WithValue(c->Dim(boxes, 1), 4, &unused));
+      ShapeHandle unused_shape;
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(4), 1, &unused_shape));
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(5), 1, &unused_shape));
+
+      TF_RETURN_IF_ERROR(SetOutputToSizedImage(
+          c, num_boxes_dim, 3 /* size_input_idx */, c->Dim(input, 3)));
+      string data_format;
+      TF_RETURN_IF_ERROR(c->GetAttr("data_format", &data_format));
+      if (data_format == "NCHW") {
+        ShapeHandle crops = c->output(0);
+        c->set_output(0, c->MakeShape({c->Dim(crops, 0), c->Dim(crops, 3),
+                                       c->Dim(crops, 1), c->Dim(crops, 2)}));
+      }
+      return OkStatus();
+    });
+
 REGISTER_OP("CropAndResizeGradImage")
     .Input("grads: float")
     .Input("boxes: float")
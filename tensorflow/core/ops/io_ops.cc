@@ -83,6 +83,44 @@ REGISTER_OP("SaveV2")
       return OkStatus();
     });
 
+REGISTER_OP("WaitForSaveV2")
+    .Input("prefix: string")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      return OkStatus();
+    });
+
+REGISTER_OP("SaveDeltaV2")
+    .Input("prefix: string")
+    .Input("base_prefix: string")
+    .Input("tensor_names: string")
+    .Input("rows: N * int64")
+    .Input("tensors: dtypes")
+    .Attr("N: int >= 0")
+    .Attr("dtypes: list(type)")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      ShapeHandle s;
+      DimensionHandle unused_dim;
+      int n;
+      TF_RETURN_IF_ERROR(c->GetAttr("N", &n));
+
+      // Validate prefix and base_prefix.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+
+      // Validate tensor_names and rows.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &s));
+      TF_RETURN_IF_ERROR(c->WithValue(c->Dim(s, 0), n, &unused_dim));
+      for (int i = 0; i < n; ++i) {
+        TF_RETURN_IF_ERROR(c->WithRank(c->input(3 + i), 1, &unused));
+      }
+      return OkStatus();
+    });
+
 REGISTER_OP("RestoreV2")
     .Input("prefix: string")
     .Input("tensor_names: string")
@@ -1529,6 +1529,36 @@ REGISTER_OP("ApproxTopK")
     .Attr("T: {half, bfloat16, float}")
     .SetShapeFn(ApproxTopKShape);
 
+REGISTER_OP("MaxInnerProductTopK")
+    .Input("queries: float")
+    .Input("database: T")
+    .Input("k: int32")
+    .Output("scores: float")
+    .Output("indices: int32")
+    .Attr("T: {half, bfloat16, float}")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle queries;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 2, &queries));
+      ShapeHandle database;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 2, &database));
+      DimensionHandle unused;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(queries, 1), c->Dim(database, 1), &unused));
+      DimensionHandle k_dim;
+      TF_RETURN_IF_ERROR(c->MakeDimForScalarInput(2, &k_dim));
+      DimensionHandle num_rows = c->Dim(database, 0);
+      if (c->ValueKnown(num_rows) && c->ValueKnown(k_dim) &&
+          c->Value(num_rows) < c->Value(k_dim)) {
+        return errors::InvalidArgument(
+            "database must have at least k = ", c->Value(k_dim),
+            " rows but has ", c->Value(num_rows));
+      }
+      ShapeHandle output = c->Matrix(c->Dim(queries, 0), k_dim);
+      c->set_output(0, output);
+      c->set_output(1, output);
+      return OkStatus();
+    });
+
 // --------------------------------------------------------------------------
 
 REGISTER_OP("NthElement")
@@ -81,6 +81,23 @@ TEST(NNOpsTest, TopKV2_ShapeFn) {
       op, "[1,2,3,4];[]");
 }
 
+TEST(NNOpsTest, MaxInnerProductTopK_ShapeFn) {
+  ShapeInferenceTestOp op("MaxInnerProductTopK");
+  op.input_tensors.resize(3);
+
+  Tensor k_t = test::AsScalar<int32>(20);
+  op.input_tensors[2] = &k_t;
+
+  INFER_OK(op, "?;?;[]", "[?,20];[?,20]");
+  INFER_OK(op, "[5,?];[100,8];[]", "[d0_0,20];[d0_0,20]");
+
+  INFER_ERROR("Shape must be rank 2 but is rank 1", op, "[5];?;[]");
+  INFER_ERROR("Dimensions must be equal, but are 4 and 8", op,
+              "[5,4];[100,8];[]");
+  INFER_ERROR("database must have at least k = 20 rows but has 10", op,
+              "[5,8];[10,8];[]");
+}
+
 TEST(NNOpsTest, NthElement_ShapeFn) {
   ShapeInferenceTestOp op("NthElement");
   op.input_tensors.resize(2);
@@ -23,6 +23,8 @@ using shape_inference::InferenceContext;
 using shape_inference::ShapeHandle;
 
 Status RaggedRangeShapeFn(InferenceContext* c);
+Status RaggedRowReductionShapeFn(InferenceContext* c);
+Status RaggedSoftmaxShapeFn(InferenceContext* c);
 
 //==============================================================================
 // Registered Ops
@@ -38,6 +40,34 @@ REGISTER_OP("RaggedRange")
     .Attr("Tsplits: {int32, int64} = DT_INT64")
     .SetShapeFn(RaggedRangeShapeFn);
 
+REGISTER_OP("RaggedReduce")
+    .Input("rt_dense_values: T")
+    .Input("rt_row_splits: Tsplits")
+    .Output("output: T")
+    .Attr("reduction: {'sum', 'mean', 'max', 'min'}")
+    .Attr("T: {bfloat16, half, float, double, int32, int64}")
+    .Attr("Tsplits: {int32, int64} = DT_INT64")
+    .SetShapeFn(RaggedRowReductionShapeFn);
+
+REGISTER_OP("RaggedSoftmax")
+    .Input("rt_dense_values: T")
+    .Input("rt_row_splits: Tsplits")
+    .Output("output: T")
+    .Attr("T: {bfloat16, half, float, double}")
+    .Attr("Tsplits: {int32, int64} = DT_INT64")
+    .SetShapeFn(RaggedSoftmaxShapeFn);
+
+REGISTER_OP("RaggedEmbeddingLookup")
+    .Input("params: T")
+    .Input("ids: Tindices")
+    .Input("rt_row_splits: Tsplits")
+    .Output("output: T")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'mean'")
+    .Attr("T: {bfloat16, half, float, double}")
+    .Attr("Tindices: {int32, int64}")
+    .Attr("Tsplits: {int32, int64} = DT_INT64")
+    .SetShapeFn(RaggedRowReductionShapeFn);
+
 //==============================================================================
 // Shape Functions
 //==============================================================================
@@ -78,4 +108,37 @@ Status RaggedRangeShapeFn(InferenceContext* c) {
   return OkStatus();
 }
 
+// Used by RaggedReduce and RaggedEmbeddingLookup, whose output has a row for
+// each row of the ragged input, and the inner dimensions of the values
+// (resp. the params), which are the penultimate input.
+Status RaggedRowReductionShapeFn(InferenceContext* c) {
+  const int num_inputs = c->num_inputs();
+  ShapeHandle values;
+  TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &values));
+  if (num_inputs == 3) {
+    ShapeHandle ids;
+    TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &ids));
+  }
+  ShapeHandle row_splits;
+  TF_RETURN_IF_ERROR(c->WithRank(c->input(num_inputs - 1), 1, &row_splits));
+
+  DimensionHandle nrows;
+  TF_RETURN_IF_ERROR(c->Subtract(c->Dim(row_splits, 0), 1, &nrows));
+  ShapeHandle inner_shape;
+  TF_RETURN_IF_ERROR(c->Subshape(values, 1, &inner_shape));
+  ShapeHandle output;
+  TF_RETURN_IF_ERROR(c->Concatenate(c->Vector(nrows), inner_shape, &output));
+  c->set_output(0, output);
+  return OkStatus();
+}
+
+Status RaggedSoftmaxShapeFn(InferenceContext* c) {
+  ShapeHandle values;
+  TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &values));
+  ShapeHandle row_splits;
+  TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &row_splits));
+  c->set_output(0, values);
+  return OkStatus();
+}
+
 }  // namespace tensorflow
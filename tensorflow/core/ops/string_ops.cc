@@ -402,4 +402,24 @@ REGISTER_OP("StringNGrams")
       return OkStatus();
     });
 
+REGISTER_OP("StringNGramsToHashBucketFast")
+    .Attr("split_separator: string = ''")
+    .Attr("separator: string = ' '")
+    .Attr("ngram_widths: list(int) >= 1")
+    .Attr("preserve_short_sequences: bool = false")
+    .Attr("num_buckets: int >= 1")
+    .Attr("Tsplits: {int32, int64} = DT_INT64")
+    .Input("input: string")
+    .Output("output: int64")
+    .Output("output_splits: Tsplits")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &input));
+      DimensionHandle num_splits;
+      TF_RETURN_IF_ERROR(c->Add(c->Dim(input, 0), 1, &num_splits));
+      c->set_output(0, c->UnknownShapeOfRank(1));
+      c->set_output(1, c->Vector(num_splits));
+      return OkStatus();
+    });
+
 }  // namespace tensorflow
@@ -826,6 +826,54 @@ REGISTER_OP("ResourceApplyAdam")
     .Attr("use_nesterov: bool = false")
     .SetShapeFn(ApplyAdamShapeFn</*is_resource=*/true>);
 
+static Status ResourceApplyAdamMultiShapeFn(InferenceContext* c) {
+  int num_vars;
+  TF_RETURN_IF_ERROR(c->GetAttr("N", &num_vars));
+  ShapeHandle unused;
+  for (int i = 0; i < 6; ++i) {
+    // beta1_power, beta2_power, lr, beta1, beta2 and epsilon.
+    TF_RETURN_IF_ERROR(c->WithRank(c->input(3 * num_vars + i), 0, &unused));
+  }
+  for (int i = 0; i < num_vars; ++i) {
+    ShapeHandle s = ShapeOrHandleShape</*is_resource=*/true>(c, i);  // var
+    TF_RETURN_IF_ERROR(c->Merge(
+        s, ShapeOrHandleShape</*is_resource=*/true>(c, num_vars + i), &s));
+    TF_RETURN_IF_ERROR(c->Merge(
+        s, ShapeOrHandleShape</*is_resource=*/true>(c, 2 * num_vars + i),
+        &s));
+    TF_RETURN_IF_ERROR(c->Merge(s, c->input(3 * num_vars + 6 + i), &s));
+  }
+  return OkStatus();
+}
+
+REGISTER_OP("_ResourceApplyAdamMulti")
+    .Input("var: N * resource")
+    .Input("m: N * resource")
+    .Input("v: N * resource")
+    .Input("beta1_power: T")
+    .Input("beta2_power: T")
+    .Input("lr: T")
+    .Input("beta1: T")
+    .Input("beta2: T")
+    .Input("epsilon: T")
+    .Input("grad: N * T")
+    .Attr("N: int >= 1")
+    .Attr("T: {half, bfloat16, float, double}")
+    .Attr("use_locking: bool = false")
+    .Attr("use_nesterov: bool = false")
+    .SetShapeFn(ResourceApplyAdamMultiShapeFn)
+    .Doc(R"doc(
+Applies ResourceApplyAdam to `N` variables with the same hyperparameters.
+
+Computes the same updates as `N` ResourceApplyAdam ops sharing their scalar
+inputs, `var[i]`, `m[i]`, `v[i]` and `grad[i]` being the variable inputs and
+gradient of the i-th op, in one kernel that splits the elements of all the
+variables evenly across threads.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is expected to
+create these operators from groups of ResourceApplyAdam ops.
+)doc");
+
 template <bool is_resource>
 static Status ApplyAdamWithAmsgradShapeFn(InferenceContext* c) {
   ShapeHandle unused;
@@ -86,6 +86,10 @@ struct GraphExecutionRunOptions {
   // If true, just-in-time host compilation is disabled, and then if the
   // specified graph is not compiled, the execution will return an error.
   bool disable_compilation = false;
+
+  // The tenant the request is charged to, if the saved model controls
+  // admission. Defaults to the model name.
+  std::string tenant;
 };
 
 // Creates the default `SessionOptions` from a `GraphExecutionOptions`.
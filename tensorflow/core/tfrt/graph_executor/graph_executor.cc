@@ -354,6 +354,41 @@ void CreateSortedNamesAndOriginalIndices(absl::Span<const std::string> names,
 
 }  // namespace
 
+tensorflow::Status GraphExecutor::CompileGraph(
+    const RunOptions& run_options,
+    absl::Span<const std::pair<std::string, tensorflow::DataType>> inputs,
+    absl::Span<const std::string> output_tensor_names,
+    absl::Span<const std::string> target_tensor_names) {
+  // The names are sorted as in Run(), for the graph to be found by it.
+  std::vector<std::string> input_names;
+  input_names.reserve(inputs.size());
+  for (const auto& p : inputs) input_names.push_back(p.first);
+  std::vector<std::string> sorted_input_names;
+  std::vector<int> input_original_indices;
+  CreateSortedNamesAndOriginalIndices(input_names, sorted_input_names,
+                                      input_original_indices);
+  std::vector<tensorflow::DataType> sorted_input_dtypes;
+  sorted_input_dtypes.reserve(inputs.size());
+  for (int original_index : input_original_indices) {
+    sorted_input_dtypes.push_back(inputs.at(original_index).second);
+  }
+
+  std::vector<std::string> sorted_output_names;
+  std::vector<int> output_original_indices;
+  CreateSortedNamesAndOriginalIndices(output_tensor_names, sorted_output_names,
+                                      output_original_indices);
+
+  std::vector<std::string> sorted_target_node_names(target_tensor_names.begin(),
+                                                    target_tensor_names.end());
+  std::sort(sorted_target_node_names.begin(), sorted_target_node_names.end());
+
+  return GetOrCreateLoadedClientGraph(
+             run_options, sorted_input_names, sorted_input_dtypes,
+             sorted_output_names, sorted_target_node_names,
+             run_options.work_queue)
+      .status();
+}
+
 tensorflow::Status GraphExecutor::Run(
     const RunOptions& run_options,
     absl::Span<const std::pair<std::string, tensorflow::Tensor>> inputs,
@@ -207,6 +207,15 @@ class GraphExecutor {
       absl::Span<const std::string> target_tensor_names,
       std::vector<tensorflow::Tensor>* outputs);
 
+  // Compiles the client graph that Run() would run with inputs of these names
+  // and dtypes and the same outputs and targets, unless it is compiled
+  // already, so that the first Run() does not have to.
+  tensorflow::Status CompileGraph(
+      const RunOptions& run_options,
+      absl::Span<const std::pair<std::string, tensorflow::DataType>> inputs,
+      absl::Span<const std::string> output_tensor_names,
+      absl::Span<const std::string> target_tensor_names);
+
   // Runs the graph identified by `graph_name` using the input `inputs` and
   // stores the output of the execution in `outputs`. It is the client's
   // responsibility to ensure `graph_name` corresponds to logically different
@@ -0,0 +1,315 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/tfrt/runtime/request_sliced_work_queue.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "llvm/ADT/None.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/tfrt/utils/thread_pool.h"
+#include "tfrt/host_context/async_value.h"  // from @tf_runtime
+#include "tfrt/host_context/task_function.h"  // from @tf_runtime
+#include "tfrt/support/forward_decls.h"  // from @tf_runtime
+
+namespace tensorflow {
+namespace tfrt_stub {
+namespace {
+
+// The work queue whose threads the current thread belongs to, if any.
+thread_local const RequestSlicedWorkQueue* current_work_queue = nullptr;
+// The slice of the task run by the current inter-op thread, if any.
+thread_local RequestSlicedWorkQueue::Slice* current_slice = nullptr;
+
+// The work queue of a request, queueing its tasks in its slice.
+class RequestWorkQueue : public WorkQueueInterface {
+ public:
+  RequestWorkQueue(int64_t id, RequestSlicedWorkQueue* parent)
+      : WorkQueueInterface(id, parent->GetIntraOpThreadPool()),
+        parent_(parent),
+        slice_(parent->OpenSlice()) {}
+
+  ~RequestWorkQueue() override { parent_->CloseSlice(slice_); }
+
+  int GetParallelismLevel() const override {
+    return parent_->options().max_threads_per_request;
+  }
+  std::string name() const override { return parent_->name(); }
+
+  void AddTask(tfrt::TaskFunction work) override {
+    parent_->AddTaskToSlice(slice_, tensorflow::tfrt_stub::WrapWork(
+                                        id(), "inter", std::move(work)));
+  }
+
+  llvm::Optional<tfrt::TaskFunction> AddBlockingTask(
+      tfrt::TaskFunction work, bool allow_queuing) override {
+    return parent_->AddBlockingTask(
+        tensorflow::tfrt_stub::WrapWork(id(), "blocking", std::move(work)),
+        allow_queuing);
+  }
+
+  void Quiesce() override { parent_->Quiesce(); }
+
+  void Await(tfrt::ArrayRef<tfrt::RCReference<tfrt::AsyncValue>> values)
+      override {
+    parent_->Await(values);
+  }
+
+  bool IsInWorkerThread() const override {
+    return parent_->IsInWorkerThread();
+  }
+
+ private:
+  RequestSlicedWorkQueue* const parent_;  // Not owned.
+  const std::shared_ptr<RequestSlicedWorkQueue::Slice> slice_;
+};
+
+}  // namespace
+
+RequestSlicedWorkQueue::RequestSlicedWorkQueue(
+    const Options& options, thread::ThreadPoolInterface* intra_op_threadpool)
+    : WorkQueueInterface(/*id=*/0, intra_op_threadpool),
+      options_([&options] {
+        Options o = options;
+        o.num_threads = std::max(1, o.num_threads);
+        o.max_threads_per_request =
+            std::clamp(o.max_threads_per_request, 1, o.num_threads);
+        o.num_blocking_threads = std::max(1, o.num_blocking_threads);
+        return o;
+      }()) {
+  slices_.push_back(std::make_shared<Slice>(this));
+  blocking_threadpool_ = std::make_unique<thread::ThreadPool>(
+      Env::Default(), "request_sliced_blocking", options_.num_blocking_threads);
+  threads_.reserve(options_.num_threads);
+  for (int i = 0; i < options_.num_threads; ++i) {
+    threads_.emplace_back(Env::Default()->StartThread(
+        ThreadOptions(), "request_sliced_inter", [this] { WorkerLoop(); }));
+  }
+}
+
+RequestSlicedWorkQueue::~RequestSlicedWorkQueue() {
+  {
+    mutex_lock lock(mu_);
+    stopping_ = true;
+    cv_.notify_all();
+  }
+  // Joins the threads once they run out of tasks, and then the blocking
+  // tasks.
+  threads_.clear();
+  blocking_threadpool_.reset();
+}
+
+StatusOr<std::unique_ptr<WorkQueueInterface>>
+RequestSlicedWorkQueue::InitializeRequest(int64_t request_id) const {
+  // The request only touches the queue through its synchronized methods.
+  return {std::make_unique<RequestWorkQueue>(
+      request_id, const_cast<RequestSlicedWorkQueue*>(this))};
+}
+
+void RequestSlicedWorkQueue::AddTask(tfrt::TaskFunction work) {
+  std::shared_ptr<Slice> shared_slice;
+  {
+    mutex_lock lock(mu_);
+    shared_slice = slices_[0];
+  }
+  AddTaskToSlice(shared_slice, tensorflow::tfrt_stub::WrapWork(
+                                   id(), "inter", std::move(work)));
+}
+
+void RequestSlicedWorkQueue::AddTaskToSlice(
+    const std::shared_ptr<Slice>& slice, tfrt::TaskFunction work) {
+  mutex_lock lock(mu_);
+  slice->tasks_.push_back(std::move(work));
+  ++num_pending_tasks_;
+  // Only a thread allowed to run the task of the slice is worth waking up, but
+  // which one is cheaper to leave to them.
+  if (slice->num_running_ < options_.max_threads_per_request ||
+      slice->num_awaiting_ > 0) {
+    cv_.notify_all();
+  }
+}
+
+llvm::Optional<tfrt::TaskFunction> RequestSlicedWorkQueue::AddBlockingTask(
+    tfrt::TaskFunction work, bool allow_queuing) {
+  {
+    mutex_lock lock(mu_);
+    if (!allow_queuing &&
+        num_blocking_tasks_ >= options_.num_blocking_threads) {
+      return {std::move(work)};
+    }
+    ++num_blocking_tasks_;
+    ++num_pending_tasks_;
+  }
+  auto* copy = new tfrt::TaskFunction(std::move(work));
+  blocking_threadpool_->Schedule([this, copy] {
+    current_work_queue = this;
+    (*copy)();
+    delete copy;
+    current_work_queue = nullptr;
+    mutex_lock lock(mu_);
+    --num_blocking_tasks_;
+    --num_pending_tasks_;
+    if (num_pending_tasks_ == 0) cv_.notify_all();
+  });
+  return llvm::None;
+}
+
+void RequestSlicedWorkQueue::Quiesce() {
+  mutex_lock lock(mu_);
+  while (num_pending_tasks_ > 0) cv_.wait(lock);
+}
+
+void RequestSlicedWorkQueue::Await(
+    tfrt::ArrayRef<tfrt::RCReference<tfrt::AsyncValue>> values) {
+  // The values are available once it drops to zero. Guarded by `mu_`.
+  size_t num_unavailable = values.size();
+  for (auto& value : values) {
+    value->AndThen([this, &num_unavailable]() {
+      mutex_lock lock(mu_);
+      if (--num_unavailable == 0) cv_.notify_all();
+    });
+  }
+
+  // An inter-op thread runs the tasks of its slice while it waits, since no
+  // other thread of the slice may be free to run those producing the values.
+  Slice* const slice = current_slice;
+  mutex_lock lock(mu_);
+  if (slice != nullptr) ++slice->num_awaiting_;
+  while (num_unavailable > 0) {
+    if (slice == nullptr || slice->tasks_.empty()) {
+      cv_.wait(lock);
+      continue;
+    }
+    tfrt::TaskFunction task = std::move(slice->tasks_.front());
+    slice->tasks_.pop_front();
+    mu_.unlock();
+    task();
+    // Destroyed before locking again, like the tasks of WorkerLoop().
+    task = tfrt::TaskFunction();
+    mu_.lock();
+    if (--num_pending_tasks_ == 0) cv_.notify_all();
+  }
+  if (slice != nullptr) --slice->num_awaiting_;
+}
+
+bool RequestSlicedWorkQueue::IsInWorkerThread() const {
+  return current_work_queue == this;
+}
+
+std::shared_ptr<RequestSlicedWorkQueue::Slice>
+RequestSlicedWorkQueue::OpenSlice() {
+  auto slice = std::make_shared<Slice>(this);
+  mutex_lock lock(mu_);
+  slices_.push_back(slice);
+  return slice;
+}
+
+void RequestSlicedWorkQueue::CloseSlice(const std::shared_ptr<Slice>& slice) {
+  mutex_lock lock(mu_);
+  slice->closed_ = true;
+  if (!slice->tasks_.empty() || slice->num_running_ > 0) return;
+  auto it = std::find(slices_.begin(), slices_.end(), slice);
+  DCHECK(it != slices_.end());
+  RemoveSlice(it - slices_.begin());
+}
+
+void RequestSlicedWorkQueue::RemoveSlice(size_t index) {
+  DCHECK_GT(index, 0);
+  std::swap(slices_[index], slices_.back());
+  slices_.pop_back();
+  if (next_slice_ >= slices_.size()) next_slice_ = 0;
+}
+
+std::shared_ptr<RequestSlicedWorkQueue::Slice>
+RequestSlicedWorkQueue::NextRunnableSlice() {
+  for (size_t i = 0; i < slices_.size(); ++i) {
+    const size_t index = (next_slice_ + i) % slices_.size();
+    const std::shared_ptr<Slice>& slice = slices_[index];
+    if (!slice->tasks_.empty() &&
+        slice->num_running_ < options_.max_threads_per_request) {
+      next_slice_ = (index + 1) % slices_.size();
+      return slice;
+    }
+  }
+  return nullptr;
+}
+
+void RequestSlicedWorkQueue::WorkerLoop() {
+  current_work_queue = this;
+  // The slice of the task run last, if any.
+  std::shared_ptr<Slice> slice;
+  while (true) {
+    tfrt::TaskFunction task;
+    {
+      mutex_lock lock(mu_);
+      if (slice != nullptr) {
+        --slice->num_running_;
+        --num_pending_tasks_;
+        if (slice->closed_ && slice->tasks_.empty() &&
+            slice->num_running_ == 0) {
+          auto it = std::find(slices_.begin(), slices_.end(), slice);
+          if (it != slices_.end()) RemoveSlice(it - slices_.begin());
+        }
+        // Another thread may now run the next task of the slice, or the
+        // quiescing threads may be done waiting.
+        if (!slice->tasks_.empty() || num_pending_tasks_ == 0 || stopping_) {
+          cv_.notify_all();
+        }
+      }
+      while ((slice = NextRunnableSlice()) == nullptr) {
+        // The tasks held back by the limits of their slices are still run
+        // when stopping, by the threads running the other tasks of their
+        // slices.
+        if (stopping_ && num_pending_tasks_ == num_blocking_tasks_) {
+          current_work_queue = nullptr;
+          return;
+        }
+        cv_.wait(lock);
+      }
+      task = std::move(slice->tasks_.front());
+      slice->tasks_.pop_front();
+      ++slice->num_running_;
+    }
+    current_slice = slice.get();
+    task();
+    current_slice = nullptr;
+  }
+}
+
+std::unique_ptr<RequestSlicedWorkQueue> CreateRequestSlicedWorkQueue(
+    const RequestSlicedWorkQueue::Options& options, int num_intra_op_threads) {
+  // The thread pool is a base before the work queue, so that it outlives the
+  // threads of the work queue, which stop in the destructor of the latter.
+  struct IntraOpThreadPool {
+    explicit IntraOpThreadPool(int num_threads)
+        : intra_op_threadpool("request_sliced_intra", num_threads) {}
+    TfThreadPool intra_op_threadpool;
+  };
+
+  class Wrapper : private IntraOpThreadPool, public RequestSlicedWorkQueue {
+   public:
+    Wrapper(const Options& options, int num_intra_op_threads)
+        : IntraOpThreadPool(num_intra_op_threads),
+          RequestSlicedWorkQueue(options, &intra_op_threadpool) {}
+
+    ~Wrapper() override = default;
+  };
+
+  return std::make_unique<Wrapper>(options, num_intra_op_threads);
+}
+
+}  // namespace tfrt_stub
+}  // namespace tensorflow
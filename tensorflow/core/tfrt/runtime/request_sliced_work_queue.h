@@ -0,0 +1,158 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_TFRT_RUNTIME_REQUEST_SLICED_WORK_QUEUE_H_
+#define TENSORFLOW_CORE_TFRT_RUNTIME_REQUEST_SLICED_WORK_QUEUE_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/platform/threadpool_interface.h"
+#include "tensorflow/core/tfrt/runtime/work_queue_interface.h"
+#include "tfrt/host_context/async_value.h"  // from @tf_runtime
+#include "tfrt/host_context/task_function.h"  // from @tf_runtime
+#include "tfrt/support/forward_decls.h"  // from @tf_runtime
+
+namespace tensorflow {
+namespace tfrt_stub {
+
+// A work queue giving each in-flight request a slice of its threads, so that
+// a request with more work than its slice cannot hold up the others.
+//
+// The per-request work queues returned by InitializeRequest() queue their
+// tasks in a queue of their own, which up to `max_threads_per_request` of the
+// shared inter-op threads drain at a time, each taking the next task of the
+// request as it gets free. The threads go round-robin over the requests with
+// runnable tasks.
+//
+// Blocking tasks, like slow fallback kernels, run on a separate pool of
+// `num_blocking_threads` threads shared by all requests, so that they do not
+// take the inter-op threads from the other requests.
+//
+// A task awaiting values runs the other tasks of its request in the meantime,
+// since they may produce the values while all the threads of the slice are
+// waiting, e.g. its only one.
+class RequestSlicedWorkQueue : public WorkQueueInterface {
+ public:
+  struct Options {
+    // The inter-op threads shared by all the requests.
+    int num_threads = 1;
+    // The inter-op threads that may run the tasks of a request at a time.
+    int max_threads_per_request = 1;
+    // The threads running the blocking tasks of all the requests.
+    int num_blocking_threads = 1;
+  };
+
+  // A queue of the tasks of a request, only accessed by its work queue.
+  class Slice {
+   public:
+    explicit Slice(RequestSlicedWorkQueue* queue) : queue_(queue) {}
+
+   private:
+    friend class RequestSlicedWorkQueue;
+
+    RequestSlicedWorkQueue* const queue_;  // Not owned.
+    std::deque<tfrt::TaskFunction> tasks_ TF_GUARDED_BY(queue_->mu_);
+    // The number of threads running its tasks.
+    int num_running_ TF_GUARDED_BY(queue_->mu_) = 0;
+    // The number of those threads awaiting values, which run its tasks in
+    // the meantime.
+    int num_awaiting_ TF_GUARDED_BY(queue_->mu_) = 0;
+    // Whether the request is done, after which the slice goes away once its
+    // tasks are run.
+    bool closed_ TF_GUARDED_BY(queue_->mu_) = false;
+  };
+
+  // `intra_op_threadpool` is not owned.
+  RequestSlicedWorkQueue(const Options& options,
+                         thread::ThreadPoolInterface* intra_op_threadpool);
+
+  // Runs the queued tasks, and waits for them.
+  ~RequestSlicedWorkQueue() override;
+
+  StatusOr<std::unique_ptr<WorkQueueInterface>> InitializeRequest(
+      int64_t request_id) const override;
+
+  int GetParallelismLevel() const override { return options_.num_threads; }
+  std::string name() const override { return "RequestSlicedWorkQueue"; }
+
+  // Tasks added outside of a request share a slice.
+  void AddTask(tfrt::TaskFunction work) override;
+
+  llvm::Optional<tfrt::TaskFunction> AddBlockingTask(
+      tfrt::TaskFunction work, bool allow_queuing) override;
+
+  void Quiesce() override;
+
+  void Await(
+      tfrt::ArrayRef<::tfrt::RCReference<::tfrt::AsyncValue>> values) override;
+
+  bool IsInWorkerThread() const override;
+
+  // Adds `work` to the queue of `slice`, registered by OpenSlice().
+  void AddTaskToSlice(const std::shared_ptr<Slice>& slice,
+                      tfrt::TaskFunction work);
+
+  // Registers a slice for a new request.
+  std::shared_ptr<Slice> OpenSlice();
+
+  // Marks the request of `slice` as done.
+  void CloseSlice(const std::shared_ptr<Slice>& slice);
+
+  const Options& options() const { return options_; }
+
+ private:
+  void WorkerLoop();
+
+  // Returns the next slice with a task that a thread may run, if any.
+  std::shared_ptr<Slice> NextRunnableSlice() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Unregisters `slice` by swapping it with the last one.
+  void RemoveSlice(size_t index) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+
+  mutable mutex mu_;
+  condition_variable cv_;
+  // The slices of the in-flight requests, the first one shared by the tasks
+  // added outside of a request.
+  std::vector<std::shared_ptr<Slice>> slices_ TF_GUARDED_BY(mu_);
+  // Where the round-robin over `slices_` resumes.
+  size_t next_slice_ TF_GUARDED_BY(mu_) = 0;
+  // The tasks queued or running.
+  int64_t num_pending_tasks_ TF_GUARDED_BY(mu_) = 0;
+  // The blocking tasks running or queued on `blocking_threadpool_`.
+  int num_blocking_tasks_ TF_GUARDED_BY(mu_) = 0;
+  bool stopping_ TF_GUARDED_BY(mu_) = false;
+
+  std::unique_ptr<thread::ThreadPool> blocking_threadpool_;
+  std::vector<std::unique_ptr<Thread>> threads_;
+};
+
+// Creates a RequestSlicedWorkQueue with an intra-op thread pool of its own of
+// `num_intra_op_threads` threads.
+std::unique_ptr<RequestSlicedWorkQueue> CreateRequestSlicedWorkQueue(
+    const RequestSlicedWorkQueue::Options& options, int num_intra_op_threads);
+
+}  // namespace tfrt_stub
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_TFRT_RUNTIME_REQUEST_SLICED_WORK_QUEUE_H_
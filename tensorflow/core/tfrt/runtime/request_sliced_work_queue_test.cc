@@ -0,0 +1,183 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/tfrt/runtime/request_sliced_work_queue.h"
+
+#include <algorithm>
+#include <memory>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tfrt/host_context/async_value.h"  // from @tf_runtime
+#include "tfrt/host_context/async_value_ref.h"  // from @tf_runtime
+#include "tfrt/host_context/task_function.h"  // from @tf_runtime
+#include "tfrt/support/latch.h"  // from @tf_runtime
+
+namespace tensorflow {
+namespace tfrt_stub {
+namespace {
+
+std::unique_ptr<RequestSlicedWorkQueue> CreateWorkQueue(
+    int num_threads, int max_threads_per_request, int num_blocking_threads) {
+  RequestSlicedWorkQueue::Options options;
+  options.num_threads = num_threads;
+  options.max_threads_per_request = max_threads_per_request;
+  options.num_blocking_threads = num_blocking_threads;
+  return CreateRequestSlicedWorkQueue(options, /*num_intra_op_threads=*/1);
+}
+
+TEST(RequestSlicedWorkQueueTest, RunsTasks) {
+  auto work_queue = CreateWorkQueue(/*num_threads=*/2,
+                                    /*max_threads_per_request=*/2,
+                                    /*num_blocking_threads=*/1);
+  auto request_queue = work_queue->InitializeRequest(/*request_id=*/1);
+  TF_ASSERT_OK(request_queue.status());
+  EXPECT_NE((*request_queue)->GetIntraOpThreadPool(), nullptr);
+  EXPECT_EQ((*request_queue)->GetParallelismLevel(), 2);
+
+  tfrt::latch latch(20);
+  for (int i = 0; i < 10; ++i) {
+    (*request_queue)->AddTask(
+        tfrt::TaskFunction([&latch] { latch.count_down(); }));
+    work_queue->AddTask(tfrt::TaskFunction([&latch] { latch.count_down(); }));
+  }
+  latch.wait();
+  work_queue->Quiesce();
+}
+
+TEST(RequestSlicedWorkQueueTest, BoundsThreadsPerRequest) {
+  auto work_queue = CreateWorkQueue(/*num_threads=*/3,
+                                    /*max_threads_per_request=*/2,
+                                    /*num_blocking_threads=*/1);
+  auto heavy_request = work_queue->InitializeRequest(/*request_id=*/1);
+  auto light_request = work_queue->InitializeRequest(/*request_id=*/2);
+  TF_ASSERT_OK(heavy_request.status());
+  TF_ASSERT_OK(light_request.status());
+
+  // The heavy request has more stalled tasks than threads.
+  mutex mu;
+  int num_running = 0;
+  int max_running = 0;
+  Notification release;
+  tfrt::latch heavy_done(4);
+  for (int i = 0; i < 4; ++i) {
+    (*heavy_request)->AddTask(tfrt::TaskFunction([&] {
+      {
+        mutex_lock lock(mu);
+        max_running = std::max(max_running, ++num_running);
+      }
+      release.WaitForNotification();
+      {
+        mutex_lock lock(mu);
+        --num_running;
+      }
+      heavy_done.count_down();
+    }));
+  }
+
+  // The light request still gets a thread.
+  Notification light_done;
+  (*light_request)->AddTask(
+      tfrt::TaskFunction([&light_done] { light_done.Notify(); }));
+  light_done.WaitForNotification();
+
+  release.Notify();
+  heavy_done.wait();
+  mutex_lock lock(mu);
+  EXPECT_EQ(max_running, 2);
+}
+
+TEST(RequestSlicedWorkQueueTest, BlockingTasksRunOnTheirOwnThreads) {
+  auto work_queue = CreateWorkQueue(/*num_threads=*/1,
+                                    /*max_threads_per_request=*/1,
+                                    /*num_blocking_threads=*/1);
+  auto request_queue = work_queue->InitializeRequest(/*request_id=*/1);
+  TF_ASSERT_OK(request_queue.status());
+
+  Notification release;
+  Notification blocking_started;
+  EXPECT_FALSE((*request_queue)
+                   ->AddBlockingTask(tfrt::TaskFunction([&] {
+                                       blocking_started.Notify();
+                                       release.WaitForNotification();
+                                     }),
+                                     /*allow_queuing=*/false)
+                   .has_value());
+  blocking_started.WaitForNotification();
+
+  // The blocking thread is busy, and a task not allowed to queue is handed
+  // back.
+  EXPECT_TRUE((*request_queue)
+                  ->AddBlockingTask(tfrt::TaskFunction([] {}),
+                                    /*allow_queuing=*/false)
+                  .has_value());
+
+  // The inter-op thread is still free.
+  Notification task_done;
+  bool in_worker_thread = false;
+  (*request_queue)->AddTask(tfrt::TaskFunction([&] {
+    in_worker_thread = work_queue->IsInWorkerThread();
+    task_done.Notify();
+  }));
+  task_done.WaitForNotification();
+  EXPECT_TRUE(in_worker_thread);
+  EXPECT_FALSE(work_queue->IsInWorkerThread());
+
+  release.Notify();
+  work_queue->Quiesce();
+}
+
+TEST(RequestSlicedWorkQueueTest, RunsTasksOfFinishedRequests) {
+  auto work_queue = CreateWorkQueue(/*num_threads=*/1,
+                                    /*max_threads_per_request=*/1,
+                                    /*num_blocking_threads=*/1);
+  tfrt::latch latch(10);
+  {
+    auto request_queue = work_queue->InitializeRequest(/*request_id=*/1);
+    TF_ASSERT_OK(request_queue.status());
+    for (int i = 0; i < 10; ++i) {
+      (*request_queue)
+          ->AddTask(tfrt::TaskFunction([&latch] { latch.count_down(); }));
+    }
+  }
+  latch.wait();
+}
+
+TEST(RequestSlicedWorkQueueTest, RunsTasksOfTheRequestWhileAwaiting) {
+  auto work_queue = CreateWorkQueue(/*num_threads=*/1,
+                                    /*max_threads_per_request=*/1,
+                                    /*num_blocking_threads=*/1);
+  auto request_queue = work_queue->InitializeRequest(/*request_id=*/1);
+  TF_ASSERT_OK(request_queue.status());
+
+  // The only thread of the request awaits a value produced by a later task of
+  // the request, which it has to run itself.
+  auto value = tfrt::MakeUnconstructedAsyncValueRef<int>().ReleaseRCRef();
+  Notification done;
+  (*request_queue)->AddTask(tfrt::TaskFunction([&, value]() mutable {
+    (*request_queue)->AddTask(tfrt::TaskFunction([value] {
+      value->emplace<int>(1);
+    }));
+    work_queue->Await(std::move(value));
+    done.Notify();
+  }));
+  done.WaitForNotification();
+  work_queue->Quiesce();
+}
+
+}  // namespace
+}  // namespace tfrt_stub
+}  // namespace tensorflow
@@ -0,0 +1,200 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/tfrt/saved_model/aot_signature.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/compiler/xla/cpu_function_runtime.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace tfrt_stub {
+namespace {
+
+bool IsAligned(const Tensor& tensor) {
+  return reinterpret_cast<uintptr_t>(tensor.data()) %
+             xla::cpu_function_runtime::MinAlign() ==
+         0;
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<AotSignatureRunner>> AotSignatureRunner::Create(
+    const AotSignature& signature, DataTypeVector output_dtypes,
+    std::vector<TensorShape> output_shapes,
+    std::vector<Tensor> variable_values) {
+  if (!signature.create_function) {
+    return errors::InvalidArgument("The AOT signature has no function");
+  }
+  if (output_dtypes.size() != output_shapes.size()) {
+    return errors::InvalidArgument("Got ", output_dtypes.size(),
+                                   " output types but ", output_shapes.size(),
+                                   " output shapes");
+  }
+  for (DataType dtype : output_dtypes) {
+    if (!DataTypeCanUseMemcpy(dtype)) {
+      return errors::InvalidArgument("Unsupported AOT output type ",
+                                     DataTypeString(dtype));
+    }
+  }
+
+  std::unique_ptr<XlaCompiledCpuFunction> function =
+      signature.create_function();
+  if (static_cast<size_t>(function->num_variables()) !=
+          signature.variables.size() ||
+      variable_values.size() != signature.variables.size()) {
+    return errors::InvalidArgument(
+        "The AOT function has ", function->num_variables(),
+        " variables, but the signature lists ", signature.variables.size(),
+        " variables with ", variable_values.size(), " values");
+  }
+  const int num_inputs = function->num_args() - function->num_variables();
+  for (int i = 0; i < variable_values.size(); ++i) {
+    const size_t expected_size = function->arg_size(num_inputs + i);
+    if (variable_values[i].TotalBytes() != expected_size) {
+      return errors::InvalidArgument(
+          "Variable ", signature.variables[i], " has ",
+          variable_values[i].TotalBytes(), " bytes, but the AOT function "
+          "expects ", expected_size);
+    }
+    if (!IsAligned(variable_values[i])) {
+      variable_values[i] = tensor::DeepCopy(variable_values[i]);
+    }
+  }
+
+  auto runner = absl::WrapUnique(new AotSignatureRunner(
+      signature, std::move(output_dtypes), std::move(output_shapes),
+      std::move(variable_values), num_inputs));
+  runner->ReleaseFunction(std::move(function));
+  return runner;
+}
+
+AotSignatureRunner::AotSignatureRunner(const AotSignature& signature,
+                                       DataTypeVector output_dtypes,
+                                       std::vector<TensorShape> output_shapes,
+                                       std::vector<Tensor> variable_values,
+                                       int num_inputs)
+    : signature_(signature),
+      output_dtypes_(std::move(output_dtypes)),
+      output_shapes_(std::move(output_shapes)),
+      num_inputs_(num_inputs),
+      variable_values_(std::move(variable_values)) {}
+
+Status AotSignatureRunner::Run(absl::Span<const Tensor> inputs,
+                               std::vector<Tensor>* outputs) {
+  if (static_cast<int>(inputs.size()) != num_inputs_) {
+    return errors::InvalidArgument("The AOT function expects ", num_inputs_,
+                                   " inputs, but got ", inputs.size());
+  }
+
+  std::vector<Tensor> variable_values;
+  {
+    mutex_lock lock(mu_);
+    variable_values = variable_values_;
+  }
+  std::unique_ptr<XlaCompiledCpuFunction> function = AcquireFunction();
+  auto release_function =
+      gtl::MakeCleanup([&]() { ReleaseFunction(std::move(function)); });
+
+  // The arguments are set to the buffers of the inputs, unless these are
+  // underaligned, in which case they are copied to aligned buffers.
+  std::vector<Tensor> aligned_inputs;
+  for (int i = 0; i < inputs.size(); ++i) {
+    const Tensor* input = &inputs[i];
+    if (input->TotalBytes() != static_cast<size_t>(function->arg_size(i))) {
+      return errors::InvalidArgument(
+          "Input ", i, " of the AOT function has ", input->TotalBytes(),
+          " bytes, but it expects ", function->arg_size(i));
+    }
+    if (!IsAligned(*input)) {
+      aligned_inputs.push_back(tensor::DeepCopy(*input));
+      input = &aligned_inputs.back();
+    }
+    function->set_arg_data(i, input->data());
+  }
+  for (int i = 0; i < variable_values.size(); ++i) {
+    function->set_arg_data(num_inputs_ + i, variable_values[i].data());
+  }
+
+  if (!function->Run()) {
+    return errors::Internal("Failed to run the AOT function: ",
+                            function->error_msg());
+  }
+
+  outputs->clear();
+  outputs->reserve(output_dtypes_.size());
+  for (int i = 0; i < output_dtypes_.size(); ++i) {
+    Tensor output(output_dtypes_[i], output_shapes_[i]);
+    std::memcpy(output.data(), function->result_data(i), output.TotalBytes());
+    outputs->push_back(std::move(output));
+  }
+  return OkStatus();
+}
+
+Status AotSignatureRunner::RebindVariable(absl::string_view name,
+                                          Tensor value) {
+  auto it = std::find(signature_.variables.begin(),
+                      signature_.variables.end(), name);
+  if (it == signature_.variables.end()) {
+    return errors::NotFound("The AOT function has no variable ", name);
+  }
+  const int index = std::distance(signature_.variables.begin(), it);
+  if (!IsAligned(value)) value = tensor::DeepCopy(value);
+
+  mutex_lock lock(mu_);
+  Tensor& variable_value = variable_values_[index];
+  if (value.dtype() != variable_value.dtype() ||
+      value.shape() != variable_value.shape()) {
+    return errors::InvalidArgument(
+        "Variable ", name, " is a ", DataTypeString(variable_value.dtype()),
+        variable_value.shape().DebugString(), " tensor, but got a ",
+        DataTypeString(value.dtype()), value.shape().DebugString(), " one");
+  }
+  variable_value = std::move(value);
+  return OkStatus();
+}
+
+std::unique_ptr<XlaCompiledCpuFunction> AotSignatureRunner::AcquireFunction() {
+  {
+    mutex_lock lock(mu_);
+    if (!idle_functions_.empty()) {
+      std::unique_ptr<XlaCompiledCpuFunction> function =
+          std::move(idle_functions_.back());
+      idle_functions_.pop_back();
+      return function;
+    }
+  }
+  return signature_.create_function();
+}
+
+void AotSignatureRunner::ReleaseFunction(
+    std::unique_ptr<XlaCompiledCpuFunction> function) {
+  mutex_lock lock(mu_);
+  idle_functions_.push_back(std::move(function));
+}
+
+}  // namespace tfrt_stub
+}  // namespace tensorflow
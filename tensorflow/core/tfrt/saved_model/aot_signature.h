@@ -0,0 +1,105 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_TFRT_SAVED_MODEL_AOT_SIGNATURE_H_
+#define TENSORFLOW_CORE_TFRT_SAVED_MODEL_AOT_SIGNATURE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_compiled_cpu_function.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace tfrt_stub {
+
+// A signature of a saved model compiled ahead of time by tfcompile, e.g. by
+// `saved_model_cli aot_compile_cpu`, and linked into the serving binary.
+struct AotSignature {
+  // Creates an instance of the class generated by tfcompile, e.g.
+  //
+  //   [] {
+  //     return std::make_unique<MyModel>(
+  //         MyModel::AllocMode::RESULTS_PROFILES_AND_TEMPS_ONLY);
+  //   }
+  //
+  // The arguments of the function are always set by the runner, so they need
+  // not be allocated.
+  std::function<std::unique_ptr<XlaCompiledCpuFunction>()> create_function;
+
+  // The checkpoint keys of the variables fed to the function, in the order of
+  // its variable arguments, i.e. `variables_to_feed` of `aot_compile_cpu`.
+  // They are read from the checkpoint of the saved model and can be rebound
+  // later. Empty if the variables were frozen into the function.
+  std::vector<std::string> variables;
+};
+
+// Runs an AotSignature. The arguments of the function are the inputs of the
+// signature, in order, followed by its variables, and its first results are
+// the outputs of the signature, in order. Thread-safe.
+class AotSignatureRunner {
+ public:
+  // `output_dtypes` and `output_shapes` are the types and the shapes of the
+  // outputs of the signature, and `variable_values` the values of
+  // `signature.variables`.
+  static StatusOr<std::unique_ptr<AotSignatureRunner>> Create(
+      const AotSignature& signature, DataTypeVector output_dtypes,
+      std::vector<TensorShape> output_shapes,
+      std::vector<Tensor> variable_values);
+
+  // Runs the function on `inputs`, the inputs of the signature.
+  Status Run(absl::Span<const Tensor> inputs, std::vector<Tensor>* outputs);
+
+  // Rebinds the variable `name` to `value`, e.g. after the weights of the
+  // model were updated. The runs in progress keep using the previous value.
+  Status RebindVariable(absl::string_view name, Tensor value);
+
+ private:
+  AotSignatureRunner(const AotSignature& signature,
+                     DataTypeVector output_dtypes,
+                     std::vector<TensorShape> output_shapes,
+                     std::vector<Tensor> variable_values, int num_inputs);
+
+  // Returns an idle instance of the function, creating one if there is none.
+  std::unique_ptr<XlaCompiledCpuFunction> AcquireFunction();
+  void ReleaseFunction(std::unique_ptr<XlaCompiledCpuFunction> function);
+
+  const AotSignature signature_;
+  const DataTypeVector output_dtypes_;
+  const std::vector<TensorShape> output_shapes_;
+  const int num_inputs_;
+
+  mutex mu_;
+  std::vector<Tensor> variable_values_ TF_GUARDED_BY(mu_);
+  // The instances of the function that no run uses. The instances are not
+  // thread-safe, so concurrent runs use different instances.
+  std::vector<std::unique_ptr<XlaCompiledCpuFunction>> idle_functions_
+      TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt_stub
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_TFRT_SAVED_MODEL_AOT_SIGNATURE_H_
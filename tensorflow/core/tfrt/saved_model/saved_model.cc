@@ -20,6 +20,7 @@ limitations under the License.
 #include <iterator>
 #include <memory>
 #include <optional>
+#include <sstream>
 #include <string>
 #include <unordered_set>
 #include <utility>
@@ -34,6 +35,7 @@ limitations under the License.
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
+#include "tensorflow/cc/saved_model/constants.h"
 #include "tensorflow/cc/saved_model/reader.h"
 #include "tensorflow/compiler/mlir/tensorflow/ir/tf_saved_model.h"
 #include "tensorflow/compiler/mlir/tensorflow/translate/import_model.h"
@@ -45,7 +47,10 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/path.h"
@@ -54,15 +59,19 @@ limitations under the License.
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/protobuf/meta_graph.pb.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
+#include "tensorflow/core/public/version.h"
 #include "tensorflow/core/tfrt/graph_executor/graph_execution_options.h"
 #include "tensorflow/core/tfrt/graph_executor/graph_executor.h"
 #include "tensorflow/core/tfrt/mla/mla_utils.h"
 #include "tensorflow/core/tfrt/runtime/work_queue_interface.h"
+#include "tensorflow/core/tfrt/saved_model/aot_signature.h"
 #include "tensorflow/core/tfrt/saved_model/saved_model_import_input.h"
 #include "tensorflow/core/tfrt/tpu/tpu_resources.h"  // NOLINT(unused-includes): For tfrt::tpu::TpuModelResource
 #include "tensorflow/core/tfrt/utils/error_util.h"
 #include "tensorflow/core/tfrt/utils/fallback_tensor.h"
 #include "tensorflow/core/tfrt/utils/utils.h"
+#include "tensorflow/core/util/autotune_maps/autotune_serialize.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/tsl/platform/statusor.h"
 #include "tfrt/bef_executor/bef_file.h"  // from @tf_runtime
 #include "tfrt/core_runtime/core_runtime.h"  // from @tf_runtime
@@ -132,6 +141,92 @@ auto* saved_model_init_time_seconds =
         "/tensorflow/tfrt/saved_model/init_time",
         "Record the initialization time for the savedmodel.", "model_name");
 
+// Bumped whenever the cached BEF of an unchanged model and compile options
+// may differ, e.g. when the BEF format changes.
+constexpr int kBefCacheVersion = 1;
+
+// Identifies the build of the compiler, so that the BEFs cached by another
+// release are not reused.
+std::string BuildFingerprint() {
+  return absl::StrCat(TF_VERSION_STRING, "|graph_def_version=",
+                      TF_GRAPH_DEF_VERSION, "|compiler=",
+#if defined(__VERSION__)
+                      __VERSION__
+#elif defined(_MSC_FULL_VER)
+                      _MSC_FULL_VER
+#else
+                      "unknown"
+#endif
+  );
+}
+
+// Returns the path of the BEF compiled from `meta_graph_def` with `options` in
+// `bef_cache_dir`. The file name is a fingerprint of everything the BEF
+// depends on.
+std::string BefCachePath(const tensorflow::MetaGraphDef& meta_graph_def,
+                         const SavedModel::Options& options,
+                         absl::string_view bef_cache_dir) {
+  const GraphExecutionOptions& graph_options = options.graph_execution_options;
+  std::ostringstream compile_options;
+  compile_options << graph_options.compile_options;
+  const std::string options_key = absl::StrCat(
+      kBefCacheVersion, "|", BuildFingerprint(), "|", compile_options.str(),
+      "|use_bridge_for_gpu=", graph_options.compile_options.use_bridge_for_gpu,
+      "|sink_in_invariant_ops=",
+      graph_options.compile_options.sink_in_invariant_ops,
+      "|enable_lazy_loading=", options.enable_lazy_loading,
+      "|run_placer_grappler_on_functions=",
+      graph_options.run_placer_grappler_on_functions,
+      "|enable_grappler_function_optimizer=",
+      graph_options.enable_grappler_function_optimizer,
+      "|enable_tfrt_gpu=", graph_options.enable_tfrt_gpu);
+  return tensorflow::io::JoinPath(
+      bef_cache_dir,
+      absl::StrCat(absl::Hex(DeterministicProtoHash64(meta_graph_def),
+                             absl::kZeroPad16),
+                   "_",
+                   absl::Hex(tensorflow::Fingerprint64(options_key),
+                             absl::kZeroPad16),
+                   ".bef"));
+}
+
+// Reads the BEF at `path` into `bef`. Returns false if there is none.
+bool ReadBefFromCache(const std::string& path, tfrt::BefBuffer* bef) {
+  tensorflow::Env* env = tensorflow::Env::Default();
+  if (!env->FileExists(path).ok()) return false;
+  std::string contents;
+  const tensorflow::Status status =
+      tensorflow::ReadFileToString(env, path, &contents);
+  if (!status.ok() || contents.empty()) {
+    LOG(WARNING) << "TFRT failed to read cached BEF " << path << ": "
+                 << status;
+    return false;
+  }
+  bef->assign(contents.begin(), contents.end());
+  return true;
+}
+
+// Writes `bef` to `path`, through a temporary file so that concurrent loads
+// never read a partial BEF. Failures only lose the cache entry.
+void WriteBefToCache(const std::string& path, const tfrt::BefBuffer& bef) {
+  tensorflow::Env* env = tensorflow::Env::Default();
+  const std::string temp_path =
+      absl::StrCat(path, ".tmp-", env->NowMicros());
+  tensorflow::Status status = env->RecursivelyCreateDir(
+      std::string(tensorflow::io::Dirname(path)));
+  if (status.ok()) {
+    status = tensorflow::WriteStringToFile(
+        env, temp_path,
+        absl::string_view(reinterpret_cast<const char*>(bef.data()),
+                          bef.size()));
+  }
+  if (status.ok()) status = env->RenameFile(temp_path, path);
+  if (!status.ok()) {
+    LOG(WARNING) << "TFRT failed to cache BEF to " << path << ": " << status;
+    env->DeleteFile(temp_path).IgnoreError();
+  }
+}
+
 tensorflow::Tensor CreateScalarStringTensor(absl::string_view str) {
   return tensorflow::Tensor(tensorflow::tstring(str));
 }
@@ -488,6 +583,77 @@ tfrt::HostContext* SavedModel::GetHostContext() const {
   return runtime_->core_runtime()->GetHostContext();
 }
 
+tensorflow::StatusOr<WarmupReport> SavedModel::Warmup(
+    absl::Span<const WarmupRequest> requests, const WarmupOptions& options) {
+  WarmupReport report;
+  tensorflow::Env* env = tensorflow::Env::Default();
+  if (!options.autotune_maps_path.empty() &&
+      env->FileExists(options.autotune_maps_path).ok()) {
+    std::string autotune_maps;
+    tensorflow::Status status = tensorflow::ReadFileToString(
+        env, options.autotune_maps_path, &autotune_maps);
+    if (status.ok()) {
+      status = tensorflow::LoadSerializedAutotuneMaps(autotune_maps);
+    }
+    if (status.ok()) {
+      report.loaded_autotune_maps = true;
+    } else {
+      LOG(WARNING) << "TFRT failed to load autotune results from "
+                   << options.autotune_maps_path << ": " << status;
+    }
+  }
+
+  const auto warmup_start_time = absl::Now();
+  absl::flat_hash_map<std::string, int> signature_index;
+  RunOptions run_options;
+  for (int iteration = 0; iteration < options.num_iterations; ++iteration) {
+    for (const WarmupRequest& request : requests) {
+      auto inserted = signature_index.emplace(request.signature_name,
+                                              report.signatures.size());
+      if (inserted.second) {
+        report.signatures.emplace_back();
+        report.signatures.back().name = request.signature_name;
+      }
+      WarmupReport::Signature& signature =
+          report.signatures[inserted.first->second];
+
+      std::vector<tensorflow::Tensor> outputs;
+      const auto run_start_time = absl::Now();
+      const tensorflow::Status status =
+          Run(run_options, request.signature_name, request.inputs, &outputs);
+      const auto latency = absl::Now() - run_start_time;
+      if (signature.num_runs == 0) signature.first_latency = latency;
+      signature.last_latency = latency;
+      ++signature.num_runs;
+      if (!status.ok()) {
+        ++signature.num_failures;
+        LOG_FIRST_N(WARNING, 10) << "TFRT warmup request to signature "
+                                 << request.signature_name
+                                 << " failed: " << status;
+      }
+    }
+  }
+  for (const WarmupReport::Signature& signature : report.signatures) {
+    VLOG(1) << "TFRT warmed up signature " << signature.name << " with "
+            << signature.num_runs << " runs (" << signature.num_failures
+            << " failed), from "
+            << absl::ToInt64Milliseconds(signature.first_latency) << " ms to "
+            << absl::ToInt64Milliseconds(signature.last_latency) << " ms.";
+  }
+  VLOG(1) << "TFRT finished warming up. Took "
+          << absl::ToInt64Milliseconds(absl::Now() - warmup_start_time)
+          << " ms.";
+
+  if (!options.autotune_maps_path.empty()) {
+    std::string autotune_maps;
+    TF_RETURN_IF_ERROR(tensorflow::SerializeAutotuneMaps(&autotune_maps));
+    TF_RETURN_IF_ERROR(tensorflow::WriteStringToFile(
+        env, options.autotune_maps_path, autotune_maps));
+    report.saved_autotune_maps = true;
+  }
+  return report;
+}
+
 namespace {
 
 // Gets the signatures from `signature_defs` and inserts them into `signatures`.
@@ -602,6 +768,17 @@ SavedModelImpl::LoadSavedModel(Options options,
                                        meta_graph_def.graph_def());
   UpdateCompileOptions(options);
 
+  // The GPU bridge adds the functions of the XLA clusters to the fallback
+  // state while compiling, so its BEF alone cannot be reused.
+  std::string bef_cache_path;
+  const auto& compile_options = options.graph_execution_options.compile_options;
+  if (!options.bef_cache_dir.empty() &&
+      !(compile_options.device_target == TfrtDeviceInfraTarget::kGpu &&
+        compile_options.use_bridge_for_gpu)) {
+    bef_cache_path =
+        BefCachePath(meta_graph_def, options, options.bef_cache_dir);
+  }
+
   mlir::MLIRContext context;
 
   // Step 1: Import saved model from a proto to an MLIR module.
@@ -654,9 +831,26 @@ SavedModelImpl::LoadSavedModel(Options options,
                                   meta_graph_def.signature_def(), options);
   }
   tfrt::BefBuffer bef;
-  RETURN_IF_ERROR_IN_COMPILE(tensorflow::ConvertTfMlirToBef(
-      options.graph_execution_options.compile_options, mlir_module.get(), &bef,
-      fallback_state.get()));
+  tfrt::RCReference<tfrt::BEFFile> bef_file;
+  if (!bef_cache_path.empty() && ReadBefFromCache(bef_cache_path, &bef)) {
+    // E.g. a truncated file is recompiled, and replaces the cached one.
+    auto cached_bef_file = tfrt::CreateBefFileFromBefBuffer(
+        *options.graph_execution_options.runtime, bef);
+    if (cached_bef_file.ok()) {
+      VLOG(1) << "TFRT reusing the BEF cached in " << bef_cache_path;
+      bef_file = std::move(*cached_bef_file);
+    } else {
+      LOG(WARNING) << "TFRT recompiling the invalid BEF cached in "
+                   << bef_cache_path << ": " << cached_bef_file.status();
+    }
+  }
+  if (!bef_file) {
+    bef.clear();
+    RETURN_IF_ERROR_IN_COMPILE(tensorflow::ConvertTfMlirToBef(
+        options.graph_execution_options.compile_options, mlir_module.get(),
+        &bef, fallback_state.get()));
+    if (!bef_cache_path.empty()) WriteBefToCache(bef_cache_path, bef);
+  }
 
   const auto compile_duration = absl::Now() - compile_start_time;
   saved_model_compile_time_seconds->GetCell(std::string(saved_model_dir))
@@ -666,9 +860,11 @@ SavedModelImpl::LoadSavedModel(Options options,
 
   // Step 3: Initialize runtime states using special BEF functions.
   const auto init_start_time = absl::Now();
-  ASSIGN_OR_RETURN_IN_INIT(auto bef_file,
-                           tfrt::CreateBefFileFromBefBuffer(
-                               *options.graph_execution_options.runtime, bef));
+  if (!bef_file) {
+    ASSIGN_OR_RETURN_IN_INIT(
+        bef_file, tfrt::CreateBefFileFromBefBuffer(
+                      *options.graph_execution_options.runtime, bef));
+  }
 
   auto tpu_model_resource = std::make_unique<tfrt::tpu::TpuModelResource>();
   auto resource_context = CreateResourceContext(
@@ -697,11 +893,138 @@ SavedModelImpl::LoadSavedModel(Options options,
                             std::move(kernel_registry)));
 
   // Finally, create the saved model.
-  return {std::make_unique<SavedModelImpl>(
+  auto saved_model = std::make_unique<SavedModelImpl>(
       std::move(options), std::move(meta_graph_def), std::move(bef),
       std::move(bef_file), std::move(initializers_and_signatures.signature_map),
       std::move(fallback_state), std::move(tpu_model_resource),
-      std::move(resource_context), std::move(graph_executor))};
+      std::move(resource_context), std::move(graph_executor));
+
+  RETURN_IF_ERROR_WITH_STAGE_INFO(
+      "AOT signature loading", saved_model->LoadAotSignatures(saved_model_dir));
+
+  if (saved_model->options_.enable_lazy_loading) {
+    const auto warmup_start_time = absl::Now();
+    for (const std::string& name :
+         saved_model->options_.lazy_loading_warmup_signatures) {
+      RETURN_IF_ERROR_WITH_STAGE_INFO("signature warmup",
+                                      saved_model->WarmUpSignature(name));
+    }
+    if (!saved_model->options_.lazy_loading_warmup_signatures.empty()) {
+      LOG(INFO) << "TFRT finished warming up "
+                << saved_model->options_.lazy_loading_warmup_signatures.size()
+                << " signatures. Took "
+                << absl::ToInt64Milliseconds(absl::Now() - warmup_start_time)
+                << " ms.";
+    }
+  }
+  return {std::move(saved_model)};
+}
+
+tensorflow::Status SavedModelImpl::LoadAotSignatures(
+    absl::string_view saved_model_dir) {
+  std::unique_ptr<tensorflow::BundleReader> checkpoint;
+  for (const auto& [name, aot_signature] : options_.aot_signatures) {
+    const auto sig_iter = signatures_.find(name);
+    if (sig_iter == signatures_.end()) {
+      return tensorflow::errors::NotFound("failed to find AOT signature ",
+                                          name, " in the graph");
+    }
+    const internal::Signature& signature = sig_iter->second;
+
+    tensorflow::DataTypeVector output_dtypes;
+    std::vector<tensorflow::TensorShape> output_shapes;
+    for (int i = 0; i < signature.output_specs.size(); ++i) {
+      const TensorSpec& spec = signature.output_specs[i];
+      tensorflow::TensorShape shape;
+      if (!spec.shape.AsTensorShape(&shape)) {
+        return tensorflow::errors::InvalidArgument(
+            "Output ", signature.output_names[i], " of AOT signature ", name,
+            " has an unknown shape ", spec.shape.DebugString());
+      }
+      output_dtypes.push_back(spec.dtype);
+      output_shapes.push_back(std::move(shape));
+    }
+
+    std::vector<tensorflow::Tensor> variable_values;
+    for (const std::string& variable : aot_signature.variables) {
+      if (checkpoint == nullptr) {
+        checkpoint = std::make_unique<tensorflow::BundleReader>(
+            tensorflow::Env::Default(),
+            tensorflow::io::JoinPath(
+                saved_model_dir, tensorflow::kSavedModelVariablesDirectory,
+                tensorflow::kSavedModelVariablesFilename));
+        TF_RETURN_IF_ERROR(checkpoint->status());
+      }
+      tensorflow::DataType dtype;
+      tensorflow::TensorShape shape;
+      TF_RETURN_IF_ERROR(
+          checkpoint->LookupDtypeAndShape(variable, &dtype, &shape));
+      tensorflow::Tensor value(dtype, shape);
+      TF_RETURN_IF_ERROR(checkpoint->Lookup(variable, &value));
+      variable_values.push_back(std::move(value));
+    }
+
+    TF_ASSIGN_OR_RETURN(
+        aot_signature_runners_[name],
+        AotSignatureRunner::Create(aot_signature, std::move(output_dtypes),
+                                   std::move(output_shapes),
+                                   std::move(variable_values)));
+  }
+  if (!options_.aot_signatures.empty()) {
+    VLOG(1) << "TFRT loaded " << options_.aot_signatures.size()
+            << " AOT signatures.";
+  }
+  return OkStatus();
+}
+
+tensorflow::Status SavedModelImpl::RebindAotVariable(
+    absl::string_view name, absl::string_view variable,
+    tensorflow::Tensor value) {
+  const auto it = aot_signature_runners_.find(name);
+  if (it == aot_signature_runners_.end()) {
+    return tensorflow::errors::NotFound("failed to find AOT signature ", name);
+  }
+  return it->second->RebindVariable(variable, std::move(value));
+}
+
+tensorflow::Status SavedModelImpl::WarmUpSignature(absl::string_view name) {
+  const auto sig_iter = signatures_.find(name);
+  if (sig_iter == signatures_.end()) {
+    return tensorflow::errors::NotFound("failed to find signature ", name,
+                                        " to warm up in the graph");
+  }
+  const internal::Signature& signature = sig_iter->second;
+
+  if (!options_.lazy_loading_use_graph_executor) {
+    return GetOrCreateLoadingResult(RunOptions(), {std::string(name)})
+        .status();
+  }
+
+  // The graph executor is given the tensor names Run() finds for the
+  // signature.
+  const auto& signature_def = meta_graph_def_.signature_def().at(name);
+  std::vector<std::pair<std::string, tensorflow::DataType>> inputs;
+  inputs.reserve(signature.input_names.size());
+  for (int i = 0; i < signature.input_names.size(); ++i) {
+    const auto& tensor_info =
+        signature_def.inputs().at(signature.input_names[i]);
+    TF_RET_CHECK(tensor_info.encoding_case() == tensorflow::TensorInfo::kName)
+        << "Only dense tensor is supported, but got encoding case "
+        << tensor_info.encoding_case();
+    inputs.emplace_back(tensor_info.name(), signature.input_specs[i].dtype);
+  }
+  std::vector<std::string> output_tensor_names;
+  output_tensor_names.reserve(signature.output_names.size());
+  for (const auto& output_key : signature.output_names) {
+    const auto& tensor_info = signature_def.outputs().at(output_key);
+    TF_RET_CHECK(tensor_info.encoding_case() == tensorflow::TensorInfo::kName)
+        << "Only dense tensor is supported, but got encoding case "
+        << tensor_info.encoding_case();
+    output_tensor_names.push_back(tensor_info.name());
+  }
+  return graph_executor_->CompileGraph(RunOptions(), inputs,
+                                       output_tensor_names,
+                                       /*target_tensor_names=*/{});
 }
 
 SavedModelImpl::SavedModelImpl(
@@ -757,6 +1080,35 @@ tensorflow::Status SavedModelImpl::Run(
   const auto& signature = sig_iter->second;
   const auto& signature_def = meta_graph_def_.signature_def().at(name);
 
+  RequestAdmissionController* admission_controller =
+      options_.admission_controller;
+  const std::string& model_name =
+      options_.graph_execution_options.model_metadata.name();
+  const std::string& tenant =
+      run_options.tenant.empty() ? model_name : run_options.tenant;
+  int64_t input_bytes = 0;
+  absl::Duration predicted_cost;
+  if (admission_controller != nullptr) {
+    for (const auto& input : inputs) input_bytes += input.TotalBytes();
+    TF_RETURN_IF_ERROR(admission_controller->Admit(
+        tenant, model_name, name, input_bytes, &predicted_cost));
+  }
+  const absl::Time run_start_time = absl::Now();
+  auto record_cost = gtl::MakeCleanup([&]() {
+    if (admission_controller == nullptr) return;
+    admission_controller->RecordCost(tenant, model_name, name, input_bytes,
+                                     predicted_cost,
+                                     absl::Now() - run_start_time);
+  });
+
+  if (const auto aot_iter = aot_signature_runners_.find(name);
+      aot_iter != aot_signature_runners_.end()) {
+    TF_RETURN_IF_ERROR(
+        CheckInputSpecs(options_.graph_execution_options.model_metadata,
+                        run_options, name, signature, inputs));
+    return aot_iter->second->Run(inputs, outputs);
+  }
+
   if (options_.enable_lazy_loading &&
       options_.lazy_loading_use_graph_executor) {
     std::vector<std::pair<std::string, tensorflow::Tensor>> input_tensors;
@@ -26,7 +26,9 @@ limitations under the License.
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
+#include "tensorflow/core/common_runtime/request_admission_controller.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/protobuf/meta_graph.pb.h"
@@ -34,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/tfrt/graph_executor/graph_execution_options.h"
 #include "tensorflow/core/tfrt/graph_executor/graph_executor.h"
 #include "tensorflow/core/tfrt/runtime/runtime.h"
+#include "tensorflow/core/tfrt/saved_model/aot_signature.h"
 #include "tensorflow/core/tfrt/tpu/tpu_resources.h"  // NOLINT(unused-includes): For tfrt::tpu::TpuModelResource
 #include "tfrt/host_context/function.h"  // from @tf_runtime
 #include "tfrt/host_context/request_deadline_tracker.h"  // from @tf_runtime
@@ -106,6 +109,38 @@ class FunctionMetadata {
   const internal::Signature* signature_ = nullptr;
 };
 
+// A recorded request to a signature, replayed by SavedModel::Warmup().
+struct WarmupRequest {
+  std::string signature_name;
+  std::vector<tensorflow::Tensor> inputs;
+};
+
+struct WarmupOptions {
+  // How many times each request is replayed. Autotuning and some kernel caches
+  // only settle after the first run.
+  int num_iterations = 1;
+  // If non-empty, the autotune results are loaded from this file before the
+  // replay if it exists, and saved to it after.
+  std::string autotune_maps_path;
+};
+
+// What SavedModel::Warmup() warmed up.
+struct WarmupReport {
+  struct Signature {
+    std::string name;
+    int num_runs = 0;
+    int num_failures = 0;
+    // The latencies of the first and the last run of the signature.
+    absl::Duration first_latency;
+    absl::Duration last_latency;
+  };
+  std::vector<Signature> signatures;
+  // Whether the autotune results were loaded from or saved to
+  // `autotune_maps_path`.
+  bool loaded_autotune_maps = false;
+  bool saved_autotune_maps = false;
+};
+
 // SavedModel represents the in-memory states (graphs and variables) loaded from
 // a tensorflow saved model directory.
 class SavedModel {
@@ -127,6 +162,28 @@ class SavedModel {
     // TODO(b/216379787): Remove this option once b/239749833 is unblocked.
     bool lazy_loading_use_graph_executor = false;
 
+    // If lazy loading is enabled, these signatures are still loaded along with
+    // the saved model, so that their first invocations do not pay for it.
+    std::vector<std::string> lazy_loading_warmup_signatures;
+
+    // If set, Run() admits each request by its cost predicted from its input
+    // size, and records its run time as its cost. Not owned.
+    RequestAdmissionController* admission_controller = nullptr;
+
+    // If non-empty, the BEF compiled from the saved model is cached in this
+    // directory, keyed by fingerprints of the MetaGraphDef, the compile
+    // options and the TensorFlow build, and later loads of the same model with
+    // the same options reuse it instead of lowering the model to BEF again. A
+    // cached BEF that fails to load is compiled again. It may be the saved
+    // model directory itself, if it is writable.
+    std::string bef_cache_dir;
+
+    // The signatures compiled ahead of time, by signature name. Run() runs
+    // them with their AOT function instead of the graph, which skips the
+    // overhead of the graph runtime. Their variables are read from the
+    // checkpoint of the saved model when it is loaded.
+    absl::flat_hash_map<std::string, AotSignature> aot_signatures;
+
     GraphExecutionOptions graph_execution_options;
   };
 
@@ -190,6 +247,15 @@ class SavedModel {
       absl::Span<const std::string> target_node_names,
       std::vector<tensorflow::Tensor>* outputs) = 0;
 
+  // Replays `requests` before the model takes traffic, so that the first
+  // real requests do not pay for the lazy initialization they trigger: kernel
+  // creation in the fallback kernel caches, compilation of the XLA clusters,
+  // autotuning of convolutions, and lazily loaded signatures. Failed runs are
+  // reported, not returned, as recorded requests may be stale; only failing to
+  // save the autotune results is an error.
+  tensorflow::StatusOr<WarmupReport> Warmup(
+      absl::Span<const WarmupRequest> requests, const WarmupOptions& options);
+
  private:
   const Runtime* runtime_ = nullptr;
 };
@@ -253,6 +319,12 @@ class SavedModelImpl final : public SavedModel {
       absl::Span<const std::string> target_node_names,
       std::vector<tensorflow::Tensor>* outputs) override;
 
+  // Rebinds the variable `variable` of the AOT signature `name`, see
+  // Options::aot_signatures, to `value`.
+  tensorflow::Status RebindAotVariable(absl::string_view name,
+                                       absl::string_view variable,
+                                       tensorflow::Tensor value);
+
  private:
   // The result of loading signature(s).
   struct LoadingResult {
@@ -270,6 +342,14 @@ class SavedModelImpl final : public SavedModel {
       const std::vector<std::string>& output_nodes,
       const std::vector<std::string>& target_nodes);
 
+  // Creates the runners of `options_.aot_signatures`, reading their variables
+  // from the checkpoint in `saved_model_dir`.
+  tensorflow::Status LoadAotSignatures(absl::string_view saved_model_dir);
+
+  // Loads the signature `name` ahead of its first invocation, if lazy loading
+  // is enabled.
+  tensorflow::Status WarmUpSignature(absl::string_view name);
+
   // Given the joined signature, loads the subgraph and returns loading result.
   tensorflow::StatusOr<
       std::reference_wrapper<const SavedModelImpl::LoadingResult>>
@@ -307,6 +387,8 @@ class SavedModelImpl final : public SavedModel {
                       std::unique_ptr<LoadingResult>>
       loading_result_cache_ TF_GUARDED_BY(loading_result_cache_mu_);
   std::unique_ptr<GraphExecutor> graph_executor_;
+  absl::flat_hash_map<std::string, std::unique_ptr<AotSignatureRunner>>
+      aot_signature_runners_;
 };
 
 class SavedModelMiraImpl;
@@ -0,0 +1,267 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/tfrt/saved_model/serving_benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/core/common_runtime/request_cost.h"
+#include "tensorflow/core/common_runtime/request_cost_accessor.h"
+#include "tensorflow/core/common_runtime/request_cost_accessor_registry.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "third_party/tensorflow_serving/apis/prediction_log.pb.h"
+
+namespace tensorflow {
+namespace tfrt_stub {
+namespace {
+
+// The RequestCost of the request running on the current thread.
+thread_local RequestCost* current_request_cost = nullptr;
+
+class ServingBenchmarkRequestCostAccessor : public RequestCostAccessor {
+ public:
+  RequestCost* GetRequestCost() const override { return current_request_cost; }
+};
+
+REGISTER_REQUEST_COST_ACCESSOR("serving_benchmark",
+                               ServingBenchmarkRequestCostAccessor);
+
+int64_t NumCpuAllocations() {
+  absl::optional<AllocatorStats> stats = cpu_allocator()->GetStats();
+  return stats ? stats->num_allocs : 0;
+}
+
+absl::Duration ProcessCpuTime() {
+  return absl::Seconds(static_cast<double>(std::clock()) / CLOCKS_PER_SEC);
+}
+
+// Returns the `p`th percentile of the sorted `latencies`.
+absl::Duration Percentile(const std::vector<absl::Duration>& latencies,
+                          double p) {
+  if (latencies.empty()) return absl::ZeroDuration();
+  const int64_t rank = static_cast<int64_t>(std::ceil(p * latencies.size()));
+  return latencies[std::clamp<int64_t>(rank - 1, 0, latencies.size() - 1)];
+}
+
+// Accumulates the costs and the node times of the requests.
+class CostAggregator {
+ public:
+  void Add(const RequestCost& request_cost, const StepStats& step_stats) {
+    absl::flat_hash_map<std::string, absl::Duration> costs =
+        request_cost.GetCosts();
+    absl::MutexLock lock(&mu_);
+    for (const auto& [type, cost] : costs) {
+      costs_[type] += cost;
+    }
+    for (const DeviceStepStats& device_stats : step_stats.dev_stats()) {
+      for (const NodeExecStats& node_stats : device_stats.node_stats()) {
+        node_times_[node_stats.node_name()] +=
+            absl::Microseconds(node_stats.all_end_rel_micros());
+      }
+    }
+  }
+
+  void Report(int64_t num_requests, ServingBenchmarkResult* result) {
+    if (num_requests == 0) return;
+    absl::MutexLock lock(&mu_);
+    for (const auto& [type, cost] : costs_) {
+      result->cost_per_request[type] = cost / num_requests;
+    }
+    for (const auto& [node_name, time] : node_times_) {
+      result->node_time_per_request[node_name] = time / num_requests;
+    }
+  }
+
+ private:
+  absl::Mutex mu_;
+  absl::flat_hash_map<std::string, absl::Duration> costs_
+      ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, absl::Duration> node_times_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace
+
+StatusOr<std::vector<ServingRequest>> ReadRecordedRequests(
+    const std::string& path) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(Env::Default()->NewRandomAccessFile(path, &file));
+  io::SequentialRecordReader reader(file.get());
+  std::vector<ServingRequest> requests;
+  tstring record;
+  while (true) {
+    Status status = reader.ReadRecord(&record);
+    if (errors::IsOutOfRange(status)) break;
+    TF_RETURN_IF_ERROR(status);
+    serving::PredictionLog log;
+    if (!log.ParseFromArray(record.data(), record.size())) {
+      return errors::DataLoss("Failed to parse a PredictionLog in ", path);
+    }
+    if (!log.has_predict_log()) continue;
+    const serving::PredictRequest& predict_request =
+        log.predict_log().request();
+    ServingRequest& request = requests.emplace_back();
+    request.signature_name = predict_request.model_spec().signature_name();
+    for (const auto& [key, tensor_proto] : predict_request.inputs()) {
+      Tensor tensor;
+      if (!tensor.FromProto(tensor_proto)) {
+        return errors::DataLoss("Invalid input ", key, " of a request in ",
+                                path);
+      }
+      request.inputs.emplace_back(key, std::move(tensor));
+    }
+  }
+  return requests;
+}
+
+std::string ServingBenchmarkResult::DebugString() const {
+  std::string str = absl::StrCat(
+      runtime_name, ": ", num_requests, " requests, ", num_errors,
+      " errors, ", throughput_qps, " QPS\n", "  latency p50 ",
+      absl::FormatDuration(latency_p50), " p90 ",
+      absl::FormatDuration(latency_p90), " p99 ",
+      absl::FormatDuration(latency_p99), " p99.9 ",
+      absl::FormatDuration(latency_p999), " max ",
+      absl::FormatDuration(latency_max), "\n", "  per request: CPU ",
+      absl::FormatDuration(cpu_time_per_request), ", ",
+      allocations_per_request, " allocations\n");
+  std::vector<std::pair<std::string, absl::Duration>> costs(
+      cost_per_request.begin(), cost_per_request.end());
+  std::sort(costs.begin(), costs.end());
+  for (const auto& [type, cost] : costs) {
+    absl::StrAppend(&str, "  cost ", type, ": ", absl::FormatDuration(cost),
+                    "\n");
+  }
+  // The nodes that take the most time, which are the interesting ones.
+  constexpr int kMaxNodes = 10;
+  std::vector<std::pair<std::string, absl::Duration>> nodes(
+      node_time_per_request.begin(), node_time_per_request.end());
+  std::sort(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) {
+    return a.second > b.second;
+  });
+  for (size_t i = 0; i < nodes.size() && i < kMaxNodes; ++i) {
+    absl::StrAppend(&str, "  node ", nodes[i].first, ": ",
+                    absl::FormatDuration(nodes[i].second), "\n");
+  }
+  return str;
+}
+
+StatusOr<ServingBenchmarkResult> RunServingBenchmark(
+    ServingRuntime& runtime, absl::Span<const ServingRequest> requests,
+    const ServingBenchmarkOptions& options) {
+  if (requests.empty()) {
+    return errors::InvalidArgument("No requests to benchmark with");
+  }
+  if (options.target_qps <= 0 || options.num_client_threads <= 0) {
+    return errors::InvalidArgument(
+        "The target QPS and the number of client threads must be positive");
+  }
+
+  std::vector<Tensor> outputs;
+  for (int i = 0; i < options.num_warmup_runs; ++i) {
+    for (const ServingRequest& request : requests) {
+      Status status = runtime.Run(request, &outputs, /*step_stats=*/nullptr);
+      if (!status.ok()) {
+        return errors::CreateWithUpdatedMessage(
+            status, absl::StrCat("Failed to warm up ", runtime.name(),
+                                 " with signature ", request.signature_name,
+                                 ": ", status.error_message()));
+      }
+    }
+  }
+
+  const absl::Duration interval = absl::Seconds(1) / options.target_qps;
+  const int64_t num_requests =
+      std::max<int64_t>(1, options.duration / interval);
+  // Each request writes its own slot, so that they need no lock.
+  std::vector<absl::Duration> latencies(num_requests);
+  std::vector<char> failed(num_requests, false);
+  CostAggregator costs;
+
+  EnableCPUAllocatorStats();
+  const int64_t num_allocations = NumCpuAllocations();
+  const absl::Duration cpu_time = ProcessCpuTime();
+  const absl::Time start = absl::Now();
+  {
+    thread::ThreadPool clients(Env::Default(), "serving_benchmark",
+                               options.num_client_threads);
+    for (int64_t i = 0; i < num_requests; ++i) {
+      const absl::Time due = start + i * interval;
+      absl::SleepFor(due - absl::Now());
+      clients.Schedule([&, i, due]() {
+        const ServingRequest& request = requests[i % requests.size()];
+        RequestCost request_cost;
+        StepStats step_stats;
+        std::vector<Tensor> outputs;
+        current_request_cost = &request_cost;
+        Status status =
+            runtime.Run(request, &outputs,
+                        options.collect_step_stats ? &step_stats : nullptr);
+        current_request_cost = nullptr;
+        latencies[i] = absl::Now() - due;
+        if (!status.ok()) {
+          VLOG(1) << "Request " << i << " failed: " << status;
+          failed[i] = true;
+          return;
+        }
+        costs.Add(request_cost, step_stats);
+      });
+    }
+    // Waits for the requests to complete.
+  }
+  const absl::Duration elapsed = absl::Now() - start;
+
+  ServingBenchmarkResult result;
+  result.runtime_name = runtime.name();
+  result.num_requests = num_requests;
+  result.cpu_time_per_request = (ProcessCpuTime() - cpu_time) / num_requests;
+  result.allocations_per_request =
+      static_cast<double>(NumCpuAllocations() - num_allocations) /
+      num_requests;
+  std::vector<absl::Duration> successful_latencies;
+  successful_latencies.reserve(num_requests);
+  for (int64_t i = 0; i < num_requests; ++i) {
+    if (failed[i]) {
+      ++result.num_errors;
+    } else {
+      successful_latencies.push_back(latencies[i]);
+    }
+  }
+  std::sort(successful_latencies.begin(), successful_latencies.end());
+  result.latency_p50 = Percentile(successful_latencies, 0.5);
+  result.latency_p90 = Percentile(successful_latencies, 0.9);
+  result.latency_p99 = Percentile(successful_latencies, 0.99);
+  result.latency_p999 = Percentile(successful_latencies, 0.999);
+  result.latency_max = Percentile(successful_latencies, 1.0);
+  result.throughput_qps =
+      successful_latencies.size() / absl::ToDoubleSeconds(elapsed);
+  costs.Report(num_requests - result.num_errors, &result);
+  return result;
+}
+
+}  // namespace tfrt_stub
+}  // namespace tensorflow
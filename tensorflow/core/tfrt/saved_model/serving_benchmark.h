@@ -0,0 +1,119 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_TFRT_SAVED_MODEL_SERVING_BENCHMARK_H_
+#define TENSORFLOW_CORE_TFRT_SAVED_MODEL_SERVING_BENCHMARK_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+
+namespace tensorflow {
+namespace tfrt_stub {
+
+// A request to a signature of a saved model, with its inputs by input key.
+struct ServingRequest {
+  std::string signature_name;
+  std::vector<std::pair<std::string, Tensor>> inputs;
+};
+
+// Reads the predict requests recorded in the TFRecord file of PredictionLogs at
+// `path`, e.g. the `assets.extra/tf_serving_warmup_requests` of a saved model.
+// The other kinds of logs are skipped.
+StatusOr<std::vector<ServingRequest>> ReadRecordedRequests(
+    const std::string& path);
+
+// A runtime serving a saved model, benchmarked by RunServingBenchmark().
+// Implementations must be thread-safe.
+class ServingRuntime {
+ public:
+  virtual ~ServingRuntime() = default;
+
+  virtual std::string name() const = 0;
+
+  // Runs `request`. If `step_stats` is not null, the runtime records the stats
+  // of the ops of the run in it, if it can.
+  virtual Status Run(const ServingRequest& request,
+                     std::vector<Tensor>* outputs, StepStats* step_stats) = 0;
+};
+
+struct ServingBenchmarkOptions {
+  // The rate at which the requests are issued, regardless of how fast the
+  // runtime completes them.
+  double target_qps = 100;
+  // The number of threads running the requests. Requests that are due while
+  // all of them are busy are queued.
+  int num_client_threads = 8;
+  // How long requests are issued for.
+  absl::Duration duration = absl::Seconds(10);
+  // How many times each request is run before the measurement.
+  int num_warmup_runs = 1;
+  // If true, the runtimes are asked for the StepStats of each run, which
+  // usually slows them down.
+  bool collect_step_stats = false;
+};
+
+struct ServingBenchmarkResult {
+  std::string runtime_name;
+  int64_t num_requests = 0;
+  int64_t num_errors = 0;
+
+  // The latencies of the successful requests, from the time they were due
+  // rather than the time they started running, so that the time spent queued
+  // behind slower requests counts.
+  absl::Duration latency_p50;
+  absl::Duration latency_p90;
+  absl::Duration latency_p99;
+  absl::Duration latency_p999;
+  absl::Duration latency_max;
+
+  // The completed requests per second, which is below the target QPS if the
+  // runtime can't keep up.
+  double throughput_qps = 0;
+  // The CPU time of the process and the number of tensors allocated by the CPU
+  // allocator, per request.
+  absl::Duration cpu_time_per_request;
+  double allocations_per_request = 0;
+
+  // The mean costs recorded in the RequestCost of the requests, by cost type.
+  // Only recorded with TF_REQUEST_COST_ACCESSOR_TYPE=serving_benchmark, for
+  // the ops that run on the thread of the request, e.g. the batch ops.
+  absl::flat_hash_map<std::string, absl::Duration> cost_per_request;
+  // The mean time of each node per request, from the StepStats of the runs.
+  absl::flat_hash_map<std::string, absl::Duration> node_time_per_request;
+
+  std::string DebugString() const;
+};
+
+// Runs `requests` round-robin against `runtime`, open-loop at the target QPS
+// of `options`, and measures it. Fails if running a request fails during the
+// warmup.
+StatusOr<ServingBenchmarkResult> RunServingBenchmark(
+    ServingRuntime& runtime, absl::Span<const ServingRequest> requests,
+    const ServingBenchmarkOptions& options);
+
+}  // namespace tfrt_stub
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_TFRT_SAVED_MODEL_SERVING_BENCHMARK_H_
@@ -0,0 +1,149 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks the serving latency of a saved model on several runtimes, e.g.
+//
+//   serving_benchmark --saved_model_dir=/tmp/my_model --qps=200 \
+//     --runtimes=direct_session,tfrt,tfrt_request_sliced
+//
+// The requests are read from the warmup requests of the saved model, unless
+// --requests names another TFRecord file of PredictionLogs.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "absl/time/time.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/tfrt/runtime/request_sliced_work_queue.h"
+#include "tensorflow/core/tfrt/runtime/runtime.h"
+#include "tensorflow/core/tfrt/saved_model/serving_benchmark.h"
+#include "tensorflow/core/tfrt/saved_model/serving_benchmark_runtimes.h"
+#include "tensorflow/core/util/command_line_flags.h"
+
+int main(int argc, char** argv) {
+  using tensorflow::Flag;
+  using tensorflow::Flags;
+  namespace tfrt_stub = tensorflow::tfrt_stub;
+
+  std::string saved_model_dir;
+  std::string requests_path;
+  std::string runtimes = "direct_session,tfrt";
+  std::string tags = "serve";
+  tfrt_stub::ServingBenchmarkOptions options;
+  int64_t duration_seconds = absl::ToInt64Seconds(options.duration);
+  int num_inter_op_threads = 4;
+  int max_threads_per_request = 1;
+  std::vector<Flag> flag_list = {
+      Flag("saved_model_dir", &saved_model_dir, "saved model directory"),
+      Flag("requests", &requests_path,
+           "TFRecord file of PredictionLogs, by default the warmup requests "
+           "of the saved model"),
+      Flag("runtimes", &runtimes,
+           "comma-separated runtimes to benchmark: direct_session, tfrt, "
+           "tfrt_request_sliced"),
+      Flag("tags", &tags, "comma-separated tags of the meta graph"),
+      Flag("qps", &options.target_qps, "rate at which requests are issued"),
+      Flag("num_client_threads", &options.num_client_threads,
+           "number of threads running the requests"),
+      Flag("duration_seconds", &duration_seconds,
+           "how long requests are issued for"),
+      Flag("num_warmup_runs", &options.num_warmup_runs,
+           "how many times each request is run before the measurement"),
+      Flag("collect_step_stats", &options.collect_step_stats,
+           "whether to report the time of each node"),
+      Flag("num_inter_op_threads", &num_inter_op_threads,
+           "number of inter-op threads of the TFRT runtime"),
+      Flag("max_threads_per_request", &max_threads_per_request,
+           "number of inter-op threads a request may use at once on "
+           "tfrt_request_sliced"),
+  };
+  std::string usage = Flags::Usage(argv[0], flag_list);
+  if (!Flags::Parse(&argc, argv, flag_list) || saved_model_dir.empty()) {
+    LOG(ERROR) << usage;
+    return -1;
+  }
+  tensorflow::port::InitMain(argv[0], &argc, &argv);
+  options.duration = absl::Seconds(duration_seconds);
+  if (requests_path.empty()) {
+    requests_path = tensorflow::io::JoinPath(
+        saved_model_dir, "assets.extra", "tf_serving_warmup_requests");
+  }
+
+  auto requests = tfrt_stub::ReadRecordedRequests(requests_path);
+  if (!requests.ok()) {
+    LOG(ERROR) << "Failed to read the requests: " << requests.status();
+    return -1;
+  }
+  const std::vector<std::string> tag_list =
+      absl::StrSplit(tags, ',', absl::SkipEmpty());
+  const std::unordered_set<std::string> tag_set(tag_list.begin(),
+                                                tag_list.end());
+
+  // The TFRT runtimes must outlive the saved models.
+  std::unique_ptr<tfrt_stub::Runtime> tfrt_runtime;
+  std::unique_ptr<tfrt_stub::Runtime> request_sliced_runtime;
+  for (absl::string_view runtime_name :
+       absl::StrSplit(runtimes, ',', absl::SkipEmpty())) {
+    tensorflow::StatusOr<std::unique_ptr<tfrt_stub::ServingRuntime>> runtime;
+    if (runtime_name == "direct_session") {
+      runtime = tfrt_stub::CreateDirectSessionRuntime(saved_model_dir, tag_set);
+    } else if (runtime_name == "tfrt") {
+      if (!tfrt_runtime) {
+        tfrt_runtime = tfrt_stub::Runtime::Create(num_inter_op_threads);
+      }
+      runtime = tfrt_stub::CreateTfrtSavedModelRuntime(
+          saved_model_dir, tag_set,
+          tfrt_stub::SavedModel::Options(tfrt_runtime.get()));
+    } else if (runtime_name == "tfrt_request_sliced") {
+      // TFRT, with the inter-op threads shared fairly between the requests.
+      if (!request_sliced_runtime) {
+        tfrt_stub::RequestSlicedWorkQueue::Options work_queue_options;
+        work_queue_options.num_threads = num_inter_op_threads;
+        work_queue_options.max_threads_per_request = max_threads_per_request;
+        request_sliced_runtime =
+            tfrt_stub::Runtime::Create(tfrt_stub::CreateRequestSlicedWorkQueue(
+                work_queue_options, tensorflow::port::MaxParallelism()));
+      }
+      runtime = tfrt_stub::CreateTfrtSavedModelRuntime(
+          saved_model_dir, tag_set,
+          tfrt_stub::SavedModel::Options(request_sliced_runtime.get()));
+    } else {
+      LOG(ERROR) << "Unknown runtime " << runtime_name << "\n" << usage;
+      return -1;
+    }
+    if (!runtime.ok()) {
+      LOG(ERROR) << "Failed to load the saved model on " << runtime_name
+                 << ": " << runtime.status();
+      return -1;
+    }
+
+    auto result =
+        tfrt_stub::RunServingBenchmark(**runtime, *requests, options);
+    if (!result.ok()) {
+      LOG(ERROR) << "Failed to benchmark " << runtime_name << ": "
+                 << result.status();
+      return -1;
+    }
+    LOG(INFO) << result->DebugString();
+  }
+  return 0;
+}
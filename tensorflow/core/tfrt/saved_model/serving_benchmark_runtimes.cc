@@ -0,0 +1,156 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/tfrt/saved_model/serving_benchmark_runtimes.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/cc/saved_model/loader.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace tfrt_stub {
+namespace {
+
+class DirectSessionRuntime : public ServingRuntime {
+ public:
+  explicit DirectSessionRuntime(std::unique_ptr<SavedModelBundle> bundle)
+      : bundle_(std::move(bundle)) {
+    for (const auto& [name, signature_def] :
+         bundle_->meta_graph_def.signature_def()) {
+      Signature& signature = signatures_[name];
+      for (const auto& [key, tensor_info] : signature_def.inputs()) {
+        signature.input_names[key] = tensor_info.name();
+      }
+      for (const auto& [key, tensor_info] : signature_def.outputs()) {
+        signature.output_names.push_back(tensor_info.name());
+      }
+    }
+  }
+
+  std::string name() const override { return "DirectSession"; }
+
+  Status Run(const ServingRequest& request, std::vector<Tensor>* outputs,
+             StepStats* step_stats) override {
+    auto it = signatures_.find(request.signature_name);
+    if (it == signatures_.end()) {
+      return errors::NotFound("No signature ", request.signature_name);
+    }
+    const Signature& signature = it->second;
+    std::vector<std::pair<std::string, Tensor>> inputs;
+    inputs.reserve(request.inputs.size());
+    for (const auto& [key, tensor] : request.inputs) {
+      auto name_it = signature.input_names.find(key);
+      if (name_it == signature.input_names.end()) {
+        return errors::InvalidArgument("No input ", key, " in signature ",
+                                       request.signature_name);
+      }
+      inputs.emplace_back(name_it->second, tensor);
+    }
+
+    RunOptions run_options;
+    if (step_stats != nullptr) {
+      run_options.set_trace_level(RunOptions::FULL_TRACE);
+    }
+    RunMetadata run_metadata;
+    TF_RETURN_IF_ERROR(bundle_->GetSession()->Run(
+        run_options, inputs, signature.output_names,
+        /*target_tensor_names=*/{}, outputs, &run_metadata));
+    if (step_stats != nullptr) {
+      *step_stats = std::move(*run_metadata.mutable_step_stats());
+    }
+    return OkStatus();
+  }
+
+ private:
+  struct Signature {
+    absl::flat_hash_map<std::string, std::string> input_names;
+    std::vector<std::string> output_names;
+  };
+
+  std::unique_ptr<SavedModelBundle> bundle_;
+  absl::flat_hash_map<std::string, Signature> signatures_;
+};
+
+class TfrtSavedModelRuntime : public ServingRuntime {
+ public:
+  explicit TfrtSavedModelRuntime(std::unique_ptr<SavedModel> saved_model)
+      : saved_model_(std::move(saved_model)) {}
+
+  std::string name() const override { return "TfrtSavedModel"; }
+
+  Status Run(const ServingRequest& request, std::vector<Tensor>* outputs,
+             StepStats* step_stats) override {
+    std::optional<FunctionMetadata> metadata =
+        saved_model_->GetFunctionMetadata(request.signature_name);
+    if (!metadata.has_value()) {
+      return errors::NotFound("No signature ", request.signature_name);
+    }
+    // The inputs of a signature are passed in the order of its input names.
+    std::vector<Tensor> inputs;
+    inputs.reserve(metadata->GetInputNames().size());
+    for (const std::string& input_name : metadata->GetInputNames()) {
+      auto it = std::find_if(
+          request.inputs.begin(), request.inputs.end(),
+          [&](const auto& input) { return input.first == input_name; });
+      if (it == request.inputs.end()) {
+        return errors::InvalidArgument("Missing input ", input_name,
+                                       " of signature ",
+                                       request.signature_name);
+      }
+      inputs.push_back(it->second);
+    }
+    return saved_model_->Run(/*run_options=*/{}, request.signature_name,
+                             inputs, outputs);
+  }
+
+ private:
+  std::unique_ptr<SavedModel> saved_model_;
+};
+
+}  // namespace
+
+StatusOr<std::unique_ptr<ServingRuntime>> CreateDirectSessionRuntime(
+    const std::string& saved_model_dir,
+    const std::unordered_set<std::string>& tags,
+    const SessionOptions& session_options) {
+  auto bundle = std::make_unique<SavedModelBundle>();
+  TF_RETURN_IF_ERROR(LoadSavedModel(session_options, RunOptions(),
+                                    saved_model_dir, tags, bundle.get()));
+  return std::unique_ptr<ServingRuntime>(
+      new DirectSessionRuntime(std::move(bundle)));
+}
+
+StatusOr<std::unique_ptr<ServingRuntime>> CreateTfrtSavedModelRuntime(
+    const std::string& saved_model_dir,
+    const std::unordered_set<std::string>& tags, SavedModel::Options options) {
+  TF_ASSIGN_OR_RETURN(
+      std::unique_ptr<SavedModel> saved_model,
+      SavedModelImpl::LoadSavedModel(std::move(options), saved_model_dir,
+                                     tags));
+  return std::unique_ptr<ServingRuntime>(
+      new TfrtSavedModelRuntime(std::move(saved_model)));
+}
+
+}  // namespace tfrt_stub
+}  // namespace tensorflow
@@ -0,0 +1,47 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_TFRT_SAVED_MODEL_SERVING_BENCHMARK_RUNTIMES_H_
+#define TENSORFLOW_CORE_TFRT_SAVED_MODEL_SERVING_BENCHMARK_RUNTIMES_H_
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/tfrt/saved_model/saved_model.h"
+#include "tensorflow/core/tfrt/saved_model/serving_benchmark.h"
+
+namespace tensorflow {
+namespace tfrt_stub {
+
+// Serves the saved model at `saved_model_dir` with a DirectSession. Records
+// the StepStats of the runs when asked to.
+StatusOr<std::unique_ptr<ServingRuntime>> CreateDirectSessionRuntime(
+    const std::string& saved_model_dir,
+    const std::unordered_set<std::string>& tags,
+    const SessionOptions& session_options = SessionOptions());
+
+// Serves the saved model at `saved_model_dir` with SavedModelImpl, loaded
+// with `options`. The runtime of `options` must outlive the returned one.
+StatusOr<std::unique_ptr<ServingRuntime>> CreateTfrtSavedModelRuntime(
+    const std::string& saved_model_dir,
+    const std::unordered_set<std::string>& tags, SavedModel::Options options);
+
+}  // namespace tfrt_stub
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_TFRT_SAVED_MODEL_SERVING_BENCHMARK_RUNTIMES_H_
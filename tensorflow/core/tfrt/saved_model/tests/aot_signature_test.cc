@@ -0,0 +1,177 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/tfrt/saved_model/aot_signature.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/compiler/tf2xla/tf2xla.pb.h"
+#include "tensorflow/compiler/tf2xla/xla_jit_compiled_cpu_function.h"
+#include "tensorflow/compiler/xla/client/executable_build_options.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace tfrt_stub {
+namespace {
+
+// Returns x + v, where x is fed and v is a variable.
+std::unique_ptr<XlaJitCompiledCpuFunction> CompileSumWithVariable() {
+  constexpr char graph_text[] = R"pb(
+    node {
+      name: "v"
+      op: "VarHandleOp"
+      attr {
+        key: "dtype"
+        value { type: DT_INT32 }
+      }
+      attr {
+        key: "shared_name"
+        value { s: "v" }
+      }
+      attr {
+        key: "shape"
+        value { shape { dim { size: 2 } } }
+      }
+    }
+    node {
+      name: "read"
+      op: "ReadVariableOp"
+      input: "v"
+      attr {
+        key: "dtype"
+        value { type: DT_INT32 }
+      }
+    }
+    node {
+      name: "x"
+      op: "Placeholder"
+      attr {
+        key: "dtype"
+        value { type: DT_INT32 }
+      }
+    }
+    node {
+      name: "sum"
+      op: "Add"
+      input: "x"
+      input: "read"
+      attr {
+        key: "T"
+        value { type: DT_INT32 }
+      }
+    })pb";
+  constexpr char config_text[] = R"pb(
+    feed {
+      id { node_name: "x" }
+      shape { dim { size: 2 } }
+    }
+    variable {
+      node_name: "v"
+      shape { dim { size: 2 } }
+      type: DT_INT32
+      readonly: true
+    }
+    fetch { id { node_name: "sum" } })pb";
+  GraphDef graph_def;
+  CHECK(protobuf::TextFormat::ParseFromString(graph_text, &graph_def));
+  tf2xla::Config config;
+  CHECK(protobuf::TextFormat::ParseFromString(config_text, &config));
+  auto jit = XlaJitCompiledCpuFunction::Compile(graph_def, config,
+                                                xla::ExecutableBuildOptions());
+  TF_CHECK_OK(jit.status());
+  return std::move(jit).value();
+}
+
+class AotSignatureRunnerTest : public ::testing::Test {
+ protected:
+  AotSignatureRunnerTest() : jit_(CompileSumWithVariable()) {
+    signature_.create_function = [this]() {
+      return std::make_unique<XlaCompiledCpuFunction>(
+          jit_->StaticData(), XlaCompiledCpuFunction::AllocMode::
+                                  RESULTS_PROFILES_AND_TEMPS_ONLY);
+    };
+    signature_.variables = {"v"};
+  }
+
+  StatusOr<std::unique_ptr<AotSignatureRunner>> CreateRunner(
+      Tensor variable_value) {
+    return AotSignatureRunner::Create(signature_, {DT_INT32},
+                                      {TensorShape({2})}, {variable_value});
+  }
+
+  std::unique_ptr<XlaJitCompiledCpuFunction> jit_;
+  AotSignature signature_;
+};
+
+TEST_F(AotSignatureRunnerTest, RunsFunction) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<AotSignatureRunner> runner,
+      CreateRunner(test::AsTensor<int32>({10, 20}, TensorShape({2}))));
+
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(
+      runner->Run({test::AsTensor<int32>({1, 2}, TensorShape({2}))}, &outputs));
+  ASSERT_EQ(outputs.size(), 1);
+  test::ExpectTensorEqual<int32>(
+      outputs[0], test::AsTensor<int32>({11, 22}, TensorShape({2})));
+
+  // The inputs must match the arguments of the function.
+  EXPECT_FALSE(runner->Run({}, &outputs).ok());
+  EXPECT_FALSE(
+      runner->Run({test::AsTensor<int32>({1, 2, 3}, TensorShape({3}))},
+                  &outputs)
+          .ok());
+}
+
+TEST_F(AotSignatureRunnerTest, RebindsVariable) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<AotSignatureRunner> runner,
+      CreateRunner(test::AsTensor<int32>({10, 20}, TensorShape({2}))));
+
+  TF_ASSERT_OK(runner->RebindVariable(
+      "v", test::AsTensor<int32>({100, 200}, TensorShape({2}))));
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(
+      runner->Run({test::AsTensor<int32>({1, 2}, TensorShape({2}))}, &outputs));
+  test::ExpectTensorEqual<int32>(
+      outputs[0], test::AsTensor<int32>({101, 202}, TensorShape({2})));
+
+  EXPECT_FALSE(runner
+                   ->RebindVariable("w", test::AsTensor<int32>(
+                                             {1, 2}, TensorShape({2})))
+                   .ok());
+  EXPECT_FALSE(
+      runner->RebindVariable("v", test::AsTensor<float>({1}, TensorShape({1})))
+          .ok());
+}
+
+TEST_F(AotSignatureRunnerTest, ChecksVariables) {
+  EXPECT_FALSE(
+      CreateRunner(test::AsTensor<int32>({1, 2, 3}, TensorShape({3}))).ok());
+
+  signature_.variables = {};
+  EXPECT_FALSE(AotSignatureRunner::Create(signature_, {DT_INT32},
+                                          {TensorShape({2})}, {})
+                   .ok());
+}
+
+}  // namespace
+}  // namespace tfrt_stub
+}  // namespace tensorflow
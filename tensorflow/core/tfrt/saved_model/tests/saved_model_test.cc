@@ -23,6 +23,8 @@ limitations under the License.
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/resource_loader.h"
 #include "tensorflow/core/tfrt/fallback/cost_recorder.h"
 #include "tensorflow/core/tfrt/mla/mla_test_utils.h"
@@ -88,6 +90,129 @@ INSTANTIATE_TEST_SUITE_P(
         TestParams{0, 0, 0}, TestParams{1, 0, 0}, TestParams{0, 1, 0},
         TestParams{1, 1, 0}, TestParams{0, 1, 1}, TestParams{1, 1, 1}));
 
+TEST(SavedModelTest, LazyLoadingWarmup) {
+  std::string saved_model_dir = tensorflow::GetDataDependencyFilepath(
+      "tensorflow/core/tfrt/saved_model/tests/toy_v1");
+
+  for (bool use_graph_executor : {false, true}) {
+    auto runtime = DefaultTfrtRuntime(/*num_threads=*/1);
+    auto options = DefaultSavedModelOptions(runtime.get());
+    options.enable_lazy_loading = true;
+    options.lazy_loading_use_graph_executor = use_graph_executor;
+    options.lazy_loading_warmup_signatures = {"toy"};
+
+    auto saved_model = SavedModelImpl::LoadSavedModel(options, saved_model_dir,
+                                                      /*tags=*/{"serve"});
+    TF_ASSERT_OK(saved_model.status());
+
+    // The warmed up signature runs without compiling.
+    std::vector<tensorflow::Tensor> inputs;
+    inputs.push_back(
+        CreateTfTensor<int32_t>(/*shape=*/{1, 3}, /*data=*/{1, 1, 1}));
+    tfrt::SavedModel::RunOptions run_options;
+    run_options.disable_compilation = true;
+    std::vector<tensorflow::Tensor> outputs;
+    TF_ASSERT_OK((*saved_model)->Run(run_options, "toy", inputs, &outputs));
+    ASSERT_EQ(outputs.size(), 1);
+    EXPECT_THAT(GetTfTensorData<int32_t>(outputs[0]),
+                ::testing::ElementsAreArray({6}));
+  }
+
+  auto runtime = DefaultTfrtRuntime(/*num_threads=*/1);
+  auto options = DefaultSavedModelOptions(runtime.get());
+  options.enable_lazy_loading = true;
+  options.lazy_loading_warmup_signatures = {"missing"};
+  EXPECT_FALSE(SavedModelImpl::LoadSavedModel(options, saved_model_dir,
+                                              /*tags=*/{"serve"})
+                   .ok());
+}
+
+TEST(SavedModelTest, Warmup) {
+  std::string saved_model_dir = tensorflow::GetDataDependencyFilepath(
+      "tensorflow/core/tfrt/saved_model/tests/toy_v1");
+  auto runtime = DefaultTfrtRuntime(/*num_threads=*/1);
+  auto options = DefaultSavedModelOptions(runtime.get());
+  options.enable_lazy_loading = true;
+  auto saved_model = SavedModelImpl::LoadSavedModel(options, saved_model_dir,
+                                                    /*tags=*/{"serve"});
+  TF_ASSERT_OK(saved_model.status());
+
+  std::vector<WarmupRequest> requests(2);
+  requests[0].signature_name = "toy";
+  requests[0].inputs.push_back(
+      CreateTfTensor<int32_t>(/*shape=*/{1, 3}, /*data=*/{1, 1, 1}));
+  // A stale request is reported, not returned.
+  requests[1].signature_name = "toy";
+  requests[1].inputs.push_back(
+      CreateTfTensor<float>(/*shape=*/{1, 3}, /*data=*/{1, 1, 1}));
+  WarmupOptions warmup_options;
+  warmup_options.num_iterations = 2;
+  warmup_options.autotune_maps_path =
+      tensorflow::io::JoinPath(::testing::TempDir(), "autotune_maps");
+
+  auto report = (*saved_model)->Warmup(requests, warmup_options);
+  TF_ASSERT_OK(report.status());
+  ASSERT_EQ(report->signatures.size(), 1);
+  EXPECT_EQ(report->signatures[0].name, "toy");
+  EXPECT_EQ(report->signatures[0].num_runs, 4);
+  EXPECT_EQ(report->signatures[0].num_failures, 2);
+  EXPECT_FALSE(report->loaded_autotune_maps);
+  EXPECT_TRUE(report->saved_autotune_maps);
+
+  // The next warmup starts from the saved autotune results.
+  report = (*saved_model)->Warmup(requests, warmup_options);
+  TF_ASSERT_OK(report.status());
+  EXPECT_TRUE(report->loaded_autotune_maps);
+}
+
+TEST(SavedModelTest, BefCache) {
+  std::string saved_model_dir = tensorflow::GetDataDependencyFilepath(
+      "tensorflow/core/tfrt/saved_model/tests/toy_v1");
+  const std::string bef_cache_dir =
+      tensorflow::io::JoinPath(::testing::TempDir(), "bef_cache");
+
+  auto runtime = DefaultTfrtRuntime(/*num_threads=*/1);
+  auto options = DefaultSavedModelOptions(runtime.get());
+  options.bef_cache_dir = bef_cache_dir;
+
+  // The first load compiles the BEF and caches it, and the second one runs
+  // the cached BEF.
+  for (int i = 0; i < 2; ++i) {
+    auto saved_model = SavedModelImpl::LoadSavedModel(options, saved_model_dir,
+                                                      /*tags=*/{"serve"});
+    TF_ASSERT_OK(saved_model.status());
+
+    std::vector<std::string> cached_befs;
+    TF_ASSERT_OK(tensorflow::Env::Default()->GetMatchingPaths(
+        tensorflow::io::JoinPath(bef_cache_dir, "*.bef"), &cached_befs));
+    EXPECT_EQ(cached_befs.size(), 1);
+
+    std::vector<tensorflow::Tensor> inputs;
+    inputs.push_back(
+        CreateTfTensor<int32_t>(/*shape=*/{1, 3}, /*data=*/{1, 1, 1}));
+    std::vector<tensorflow::Tensor> outputs;
+    TF_ASSERT_OK((*saved_model)->Run({}, "toy", inputs, &outputs));
+    ASSERT_EQ(outputs.size(), 1);
+    EXPECT_THAT(GetTfTensorData<int32_t>(outputs[0]),
+                ::testing::ElementsAreArray({6}));
+  }
+
+  // An invalid cached BEF is recompiled and replaced.
+  std::vector<std::string> cached_befs;
+  TF_ASSERT_OK(tensorflow::Env::Default()->GetMatchingPaths(
+      tensorflow::io::JoinPath(bef_cache_dir, "*.bef"), &cached_befs));
+  ASSERT_EQ(cached_befs.size(), 1);
+  TF_ASSERT_OK(tensorflow::WriteStringToFile(tensorflow::Env::Default(),
+                                             cached_befs[0], "not a BEF"));
+  auto saved_model = SavedModelImpl::LoadSavedModel(options, saved_model_dir,
+                                                    /*tags=*/{"serve"});
+  TF_ASSERT_OK(saved_model.status());
+  std::string cached_bef;
+  TF_ASSERT_OK(tensorflow::ReadFileToString(tensorflow::Env::Default(),
+                                            cached_befs[0], &cached_bef));
+  EXPECT_NE(cached_bef, "not a BEF");
+}
+
 TEST(SavedModelTest, BasicV2) {
   // SavedModel toy contains a graph of a single 'tf.AddV2' op. It is generated
   // using the following python code:
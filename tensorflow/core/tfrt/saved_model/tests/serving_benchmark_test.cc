@@ -0,0 +1,130 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/tfrt/saved_model/serving_benchmark.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace tfrt_stub {
+namespace {
+
+// Sleeps for `latency` and fails the requests to the "fail" signature.
+class FakeRuntime : public ServingRuntime {
+ public:
+  explicit FakeRuntime(absl::Duration latency) : latency_(latency) {}
+
+  std::string name() const override { return "Fake"; }
+
+  Status Run(const ServingRequest& request, std::vector<Tensor>* outputs,
+             StepStats* step_stats) override {
+    {
+      absl::MutexLock lock(&mu_);
+      ++num_runs_;
+    }
+    absl::SleepFor(latency_);
+    if (request.signature_name == "fail") {
+      return errors::Internal("Failed");
+    }
+    outputs->push_back(request.inputs[0].second);
+    if (step_stats != nullptr) {
+      NodeExecStats* node_stats =
+          step_stats->add_dev_stats()->add_node_stats();
+      node_stats->set_node_name("node");
+      node_stats->set_all_end_rel_micros(absl::ToInt64Microseconds(latency_));
+    }
+    return OkStatus();
+  }
+
+  int num_runs() {
+    absl::MutexLock lock(&mu_);
+    return num_runs_;
+  }
+
+ private:
+  const absl::Duration latency_;
+  absl::Mutex mu_;
+  int num_runs_ = 0;
+};
+
+ServingRequest MakeRequest(const std::string& signature_name) {
+  return {signature_name, {{"x", test::AsScalar<int32>(1)}}};
+}
+
+TEST(ServingBenchmarkTest, MeasuresRequests) {
+  FakeRuntime runtime(absl::Milliseconds(2));
+  std::vector<ServingRequest> requests = {MakeRequest("a"),
+                                          MakeRequest("b")};
+  ServingBenchmarkOptions options;
+  options.target_qps = 200;
+  options.num_client_threads = 4;
+  options.duration = absl::Milliseconds(500);
+  options.num_warmup_runs = 2;
+  options.collect_step_stats = true;
+
+  TF_ASSERT_OK_AND_ASSIGN(ServingBenchmarkResult result,
+                          RunServingBenchmark(runtime, requests, options));
+  EXPECT_EQ(result.runtime_name, "Fake");
+  EXPECT_EQ(result.num_requests, 100);
+  EXPECT_EQ(result.num_errors, 0);
+  EXPECT_EQ(runtime.num_runs(), 104);
+
+  EXPECT_GE(result.latency_p50, absl::Milliseconds(2));
+  EXPECT_LE(result.latency_p50, result.latency_p90);
+  EXPECT_LE(result.latency_p90, result.latency_p99);
+  EXPECT_LE(result.latency_p99, result.latency_p999);
+  EXPECT_LE(result.latency_p999, result.latency_max);
+  EXPECT_GT(result.throughput_qps, 0);
+  EXPECT_LE(result.throughput_qps, options.target_qps * 1.1);
+  EXPECT_EQ(result.node_time_per_request.at("node"), absl::Milliseconds(2));
+  EXPECT_FALSE(result.DebugString().empty());
+}
+
+TEST(ServingBenchmarkTest, CountsErrors) {
+  FakeRuntime runtime(absl::ZeroDuration());
+  std::vector<ServingRequest> requests = {MakeRequest("a"),
+                                          MakeRequest("fail")};
+  ServingBenchmarkOptions options;
+  options.target_qps = 100;
+  options.duration = absl::Milliseconds(200);
+  options.num_warmup_runs = 0;
+
+  TF_ASSERT_OK_AND_ASSIGN(ServingBenchmarkResult result,
+                          RunServingBenchmark(runtime, requests, options));
+  EXPECT_EQ(result.num_requests, 20);
+  EXPECT_EQ(result.num_errors, 10);
+}
+
+TEST(ServingBenchmarkTest, FailsWarmup) {
+  FakeRuntime runtime(absl::ZeroDuration());
+  std::vector<ServingRequest> requests = {MakeRequest("fail")};
+  EXPECT_FALSE(
+      RunServingBenchmark(runtime, requests, ServingBenchmarkOptions()).ok());
+  EXPECT_FALSE(
+      RunServingBenchmark(runtime, {}, ServingBenchmarkOptions()).ok());
+}
+
+}  // namespace
+}  // namespace tfrt_stub
+}  // namespace tensorflow
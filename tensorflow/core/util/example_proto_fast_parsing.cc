@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include <cstring>
 #include <vector>
 
 #include "absl/base/casts.h"
@@ -25,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
@@ -113,6 +115,101 @@ constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
 
+constexpr int kMaxVarint64Bytes = 10;
+constexpr uint64 kVarintContinuationBits = 0x8080808080808080ULL;
+constexpr uint64 kVarintPayloadBits = 0x7f7f7f7f7f7f7f7fULL;
+
+// Decodes the varint at the beginning of [ptr, end) one byte at a time, like
+// CodedInputStream::ReadVarint64. Returns the number of bytes read, or 0 if the
+// varint is truncated or longer than kMaxVarint64Bytes.
+inline int DecodeVarint64(const uint8* ptr, const uint8* end, uint64* value) {
+  uint64 result = 0;
+  for (int i = 0; i < kMaxVarint64Bytes && ptr + i < end; ++i) {
+    result |= static_cast<uint64>(ptr[i] & 0x7f) << (7 * i);
+    if (ptr[i] < 0x80) {
+      *value = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+// Decodes the packed varints in [ptr, end), calling `emit` with each value.
+// Returns false if the buffer does not consist of well-formed varints.
+//
+// On little-endian machines the buffer is processed eight bytes at a time: a
+// word without continuation bits holds eight single-byte varints, and the 7-bit
+// groups of a varint of up to eight bytes are compacted with a few word-wide
+// shifts and masks rather than assembled byte by byte.
+template <typename Emit>
+bool DecodePackedVarint64s(const uint8* ptr, const uint8* end, Emit&& emit) {
+  if (port::kLittleEndian) {
+    while (end - ptr >= 8) {
+      uint64 word;
+      std::memcpy(&word, ptr, sizeof(word));
+      const uint64 terminators = ~word & kVarintContinuationBits;
+      if (terminators == kVarintContinuationBits) {
+        for (int i = 0; i < 8; ++i) emit(static_cast<uint64>(ptr[i]));
+        ptr += 8;
+        continue;
+      }
+      if (terminators == 0) {
+        // The varint is longer than eight bytes.
+        uint64 value;
+        const int length = DecodeVarint64(ptr, end, &value);
+        if (length == 0) return false;
+        emit(value);
+        ptr += length;
+        continue;
+      }
+      // The lowest terminator bit marks the last byte of the varint.
+      const int length =
+          (Log2Floor64(terminators & (~terminators + 1)) >> 3) + 1;
+      uint64 value = word & kVarintPayloadBits;
+      if (length < 8) value &= (uint64{1} << (8 * length)) - 1;
+      value = ((value & 0x7f007f007f007f00ULL) >> 1) |
+              (value & 0x007f007f007f007fULL);
+      value = ((value & 0x3fff00003fff0000ULL) >> 2) |
+              (value & 0x00003fff00003fffULL);
+      value = ((value & 0x0fffffff00000000ULL) >> 4) |
+              (value & 0x000000000fffffffULL);
+      emit(value);
+      ptr += length;
+    }
+  }
+  while (ptr < end) {
+    uint64 value;
+    const int length = DecodeVarint64(ptr, end, &value);
+    if (length == 0) return false;
+    emit(value);
+    ptr += length;
+  }
+  return true;
+}
+
+// Reads `length` bytes of packed varints from `stream`, calling `emit` with
+// each value.
+template <typename Emit>
+bool ReadPackedVarint64s(protobuf::io::CodedInputStream* stream, uint32 length,
+                         Emit&& emit) {
+  const void* data;
+  int size;
+  if (length > 0 && stream->GetDirectBufferPointer(&data, &size) &&
+      static_cast<uint32>(size) >= length) {
+    const uint8* begin = static_cast<const uint8*>(data);
+    return DecodePackedVarint64s(begin, begin + length, emit) &&
+           stream->Skip(length);
+  }
+  auto limit = stream->PushLimit(length);
+  while (!stream->ExpectAtEnd()) {
+    protobuf_uint64 n;  // There is no API for int64
+    if (!stream->ReadVarint64(&n)) return false;
+    emit(n);
+  }
+  stream->PopLimit(limit);
+  return true;
+}
+
 namespace parsed {
 
 // ParseDataType has to be called first, then appropriate ParseZzzzList.
@@ -299,15 +396,11 @@ class Feature {
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
         uint32 packed_length;
         if (!stream.ReadVarint32(&packed_length)) return false;
-        auto packed_limit = stream.PushLimit(packed_length);
-
-        while (!stream.ExpectAtEnd()) {
-          protobuf_uint64 n;  // There is no API for int64
-          if (!stream.ReadVarint64(&n)) return false;
-          int64_list->push_back(static_cast<int64_t>(n));
+        if (!ReadPackedVarint64s(&stream, packed_length, [int64_list](uint64 n) {
+              int64_list->push_back(static_cast<int64_t>(n));
+            })) {
+          return false;
         }
-
-        stream.PopLimit(packed_limit);
       } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
           if (!stream.ExpectTag(kVarintTag(1))) return false;
@@ -1921,6 +2014,17 @@ inline int ParseFloatFeature(protobuf::io::CodedInputStream* stream,
         return -1;
       }
       auto packed_limit = stream->PushLimit(packed_length);
+      constexpr int32_t kNumFloatBytes = 4;
+      if (port::kLittleEndian && packed_length % kNumFloatBytes == 0) {
+        // The packed floats have the in-memory layout of the output.
+        if (out != nullptr) {
+          if (!stream->ReadRaw(out, packed_length)) return -1;
+          out += packed_length / kNumFloatBytes;
+        } else if (!stream->Skip(packed_length)) {
+          return -1;
+        }
+        num_elements += packed_length / kNumFloatBytes;
+      }
       while (!stream->ExpectAtEnd()) {
         uint32 buffer32;
         if (!stream->ReadLittleEndian32(&buffer32)) {
@@ -1971,18 +2075,15 @@ inline int ParseInt64Feature(protobuf::io::CodedInputStream* stream,
           !stream->ReadVarint32(&packed_length)) {
         return -1;
       }
-      auto packed_limit = stream->PushLimit(packed_length);
-      while (!stream->ExpectAtEnd()) {
-        protobuf_uint64 n;  // There is no API for int64
-        if (!stream->ReadVarint64(&n)) {
-          return -1;
-        }
-        if (out != nullptr) {
-          *out++ = n;
-        }
-        num_elements++;
+      if (!ReadPackedVarint64s(stream, packed_length,
+                               [&out, &num_elements](uint64 n) {
+                                 if (out != nullptr) {
+                                   *out++ = n;
+                                 }
+                                 num_elements++;
+                               })) {
+        return -1;
       }
-      stream->PopLimit(packed_limit);
     } else if (peek_tag == kVarintTag(1)) {
       while (!stream->ExpectAtEnd()) {
         protobuf_uint64 n;  // There is no API for int64
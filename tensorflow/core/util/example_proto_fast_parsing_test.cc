@@ -217,6 +217,29 @@ TEST(FastParse, SingleInt64) {
   TestCorrectness(Serialize(example));
 }
 
+TEST(FastParse, PackedInt64AllVarintLengths) {
+  Example example;
+  auto* int64_list = (*example.mutable_features()->mutable_feature())["ids"]
+                         .mutable_int64_list();
+  // A run of single-byte varints followed by values of every varint length,
+  // including negative values which take ten bytes.
+  for (int i = 0; i < 20; ++i) int64_list->add_value(i);
+  for (int shift = 0; shift < 64; ++shift) {
+    int64_list->add_value(static_cast<int64_t>(uint64_t{1} << shift));
+    int64_list->add_value(-(int64_t{1} << (shift % 63)));
+    int64_list->add_value(shift);
+  }
+  TestCorrectness(Serialize(example));
+}
+
+TEST(FastParse, PackedFloats) {
+  Example example;
+  auto* float_list = (*example.mutable_features()->mutable_feature())["values"]
+                         .mutable_float_list();
+  for (int i = 0; i < 100; ++i) float_list->add_value(i * 0.5f);
+  TestCorrectness(Serialize(example));
+}
+
 static string ExampleWithSomeFeatures() {
   Example example;
 
@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
 
+#include <array>
+#include <atomic>
+
 #include "tensorflow/core/lib/strings/strcat.h"
 
 namespace tensorflow {
@@ -308,5 +311,110 @@ Status SparseTensor::IndicesValid() const {
   }
 }
 
+void SparseTensor::ParallelFor(
+    thread::ThreadPool* pool, int64_t total, int64_t cost_per_unit,
+    const std::function<void(int64_t, int64_t)>& fn) {
+  if (pool == nullptr) {
+    fn(0, total);
+  } else {
+    pool->ParallelFor(total, cost_per_unit, fn);
+  }
+}
+
+bool SparseTensor::RadixSortEntries(const VarDimArray& order,
+                                    thread::ThreadPool* pool,
+                                    std::vector<int64_t>* reorder) const {
+  const int64_t num_entries = ix_.dim_size(0);
+  const int dims = order.size();
+  // The keys are the indices linearized in row-major order of the dimensions
+  // `order`, so that they compare like the indices.
+  gtl::InlinedVector<int64_t, 8> strides(dims);
+  int64_t num_keys = 1;
+  for (int d = dims - 1; d >= 0; --d) {
+    const int64_t dim_size = shape_[order[d]];
+    if (dim_size <= 0 ||
+        num_keys > std::numeric_limits<int64_t>::max() / dim_size) {
+      return false;
+    }
+    strides[d] = num_keys;
+    num_keys *= dim_size;
+  }
+  const auto ix_t = ix_.matrix<int64_t>();
+  std::vector<uint64> keys(num_entries);
+  std::atomic<bool> in_bounds(true);
+  ParallelFor(pool, num_entries, 3 * dims, [&](int64_t begin, int64_t end) {
+    for (int64_t n = begin; n < end; ++n) {
+      uint64 key = 0;
+      for (int d = 0; d < dims; ++d) {
+        const int64_t index = ix_t(n, order[d]);
+        if (index < 0 || index >= shape_[order[d]]) {
+          in_bounds.store(false, std::memory_order_relaxed);
+          return;
+        }
+        key += index * strides[d];
+      }
+      keys[n] = key;
+    }
+  });
+  if (!in_bounds.load()) return false;
+
+  constexpr int kRadixBits = 8;
+  constexpr int kRadix = 1 << kRadixBits;
+  int num_key_bits = 0;
+  while (num_key_bits < 63 && (int64_t{1} << num_key_bits) < num_keys) {
+    ++num_key_bits;
+  }
+  // Each pass sorts the entries by a digit of their keys, stably, with a
+  // histogram per chunk of entries so that the chunks are scattered in
+  // parallel.
+  const int64_t num_chunks =
+      pool == nullptr ? 1
+                      : std::min<int64_t>(pool->NumThreads() * 4,
+                                          num_entries / kRadix + 1);
+  const int64_t chunk_size = (num_entries + num_chunks - 1) / num_chunks;
+  std::vector<std::array<int64_t, kRadix>> offsets(num_chunks);
+  reorder->resize(num_entries);
+  std::iota(reorder->begin(), reorder->end(), 0);
+  std::vector<uint64> sorted_keys(num_entries);
+  std::vector<int64_t> sorted_reorder(num_entries);
+  for (int shift = 0; shift < num_key_bits; shift += kRadixBits) {
+    ParallelFor(pool, num_chunks, 2 * chunk_size,
+                [&](int64_t begin, int64_t end) {
+                  for (int64_t c = begin; c < end; ++c) {
+                    offsets[c].fill(0);
+                    const int64_t limit =
+                        std::min(num_entries, (c + 1) * chunk_size);
+                    for (int64_t n = c * chunk_size; n < limit; ++n) {
+                      ++offsets[c][(keys[n] >> shift) & (kRadix - 1)];
+                    }
+                  }
+                });
+    int64_t offset = 0;
+    for (int digit = 0; digit < kRadix; ++digit) {
+      for (int64_t c = 0; c < num_chunks; ++c) {
+        const int64_t count = offsets[c][digit];
+        offsets[c][digit] = offset;
+        offset += count;
+      }
+    }
+    ParallelFor(pool, num_chunks, 4 * chunk_size,
+                [&](int64_t begin, int64_t end) {
+                  for (int64_t c = begin; c < end; ++c) {
+                    const int64_t limit =
+                        std::min(num_entries, (c + 1) * chunk_size);
+                    for (int64_t n = c * chunk_size; n < limit; ++n) {
+                      const int64_t position =
+                          offsets[c][(keys[n] >> shift) & (kRadix - 1)]++;
+                      sorted_keys[position] = keys[n];
+                      sorted_reorder[position] = (*reorder)[n];
+                    }
+                  }
+                });
+    keys.swap(sorted_keys);
+    reorder->swap(sorted_reorder);
+  }
+  return true;
+}
+
 }  // namespace sparse
 }  // namespace tensorflow
@@ -16,8 +16,10 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_UTIL_SPARSE_SPARSE_TENSOR_H_
 #define TENSORFLOW_CORE_UTIL_SPARSE_SPARSE_TENSOR_H_
 
+#include <functional>
 #include <limits>
 #include <numeric>
+#include <utility>
 #include <vector>
 
 #include "absl/base/macros.h"
@@ -32,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/sparse/dim_comparator.h"
 #include "tensorflow/core/util/sparse/group_iterator.h"
@@ -120,8 +123,10 @@ class SparseTensor {
   VarDimArray order() const { return order_; }
 
   // Resorts the indices and values according to the dimensions in order.
+  // Large tensors are sorted with a radix sort where possible, which runs on
+  // `pool` if it is not null.
   template <typename T>
-  void Reorder(const VarDimArray& order);
+  void Reorder(const VarDimArray& order, thread::ThreadPool* pool = nullptr);
 
   // Returns a group iterable that can be used for clumping indices
   // and values according to the group indices of interest.
@@ -214,6 +219,23 @@ class SparseTensor {
   template <bool standard_order>
   Status IndicesValidHelper() const;
 
+  // The minimum number of entries for which Reorder() tries a radix sort.
+  static constexpr int64_t kMinEntriesForRadixSort = 4096;
+
+  // Sets `reorder` to the entries sorted by their indices in the dimensions
+  // `order`. The indices are linearized into int64 keys, which are sorted
+  // with a parallel LSD radix sort on `pool` if it is not null. Returns false
+  // if the keys don't fit in an int64 or an index is out of bounds, in which
+  // case Reorder() falls back to a comparison sort.
+  bool RadixSortEntries(const VarDimArray& order, thread::ThreadPool* pool,
+                        std::vector<int64_t>* reorder) const;
+
+  // Runs `fn` over the ranges of [0, total) on `pool`, or inline if it is
+  // null.
+  static void ParallelFor(thread::ThreadPool* pool, int64_t total,
+                          int64_t cost_per_unit,
+                          const std::function<void(int64_t, int64_t)>& fn);
+
   // Helper for ToDense<T>()
   template <typename T>
   bool ValidateAndInitializeToDense(Tensor* out, bool initialize);
@@ -268,9 +290,10 @@ class SparseTensor {
 
 // This operation updates the indices and values Tensor rows, so it is
 // an in-place algorithm.  It requires O(N log N) time and O(N)
-// temporary space.
+// temporary space, or O(N) time with the radix sort.
 template <typename T>
-inline void SparseTensor::Reorder(const VarDimArray& order) {
+inline void SparseTensor::Reorder(const VarDimArray& order,
+                                  thread::ThreadPool* pool) {
   DCHECK_EQ(DataTypeToEnum<T>::v(), dtype())
       << "Reorder requested with the wrong datatype";
   DCHECK_EQ(order.size(), dims_) << "Order length must be SparseTensor rank";
@@ -278,6 +301,25 @@ inline void SparseTensor::Reorder(const VarDimArray& order) {
   auto vals_t = vals_.vec<T>();
 
   std::vector<int64_t> reorder(num_entries());
+  if (num_entries() >= kMinEntriesForRadixSort &&
+      RadixSortEntries(order, pool, &reorder)) {
+    // Gather the entries in their sorted order from copies of them.
+    const std::vector<int64_t> ix_copy(ix_t.data(), ix_t.data() + ix_t.size());
+    std::vector<T> vals_copy(std::make_move_iterator(vals_t.data()),
+                             std::make_move_iterator(vals_t.data() +
+                                                     vals_t.size()));
+    const int64_t dims = dims_;
+    ParallelFor(pool, reorder.size(), 2 * (dims + 1),
+                [&](int64_t begin, int64_t end) {
+                  for (int64_t n = begin; n < end; ++n) {
+                    std::copy_n(&ix_copy[reorder[n] * dims], dims,
+                                &ix_t(n, 0));
+                    vals_t(n) = std::move(vals_copy[reorder[n]]);
+                  }
+                });
+    order_ = ShapeArray(order.begin(), order.end());
+    return;
+  }
   std::iota(reorder.begin(), reorder.end(), 0);
 
   // Sort to get order of indices
@@ -15,18 +15,22 @@ limitations under the License.
 
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
+#include "absl/strings/str_join.h"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace sparse {
@@ -315,6 +319,58 @@ TEST(SparseTensorTest, ValidateIndicesFindsInvalid) {
             st_indices_valid.error_message());
 }
 
+// Reorders many random entries, which uses the radix sort if their indices
+// can be linearized, and checks that the entries are sorted and that the
+// values moved with their indices.
+void CheckReorderManyEntries(const std::vector<int64_t>& dims,
+                             const std::vector<int64_t>& order,
+                             thread::ThreadPool* pool) {
+  constexpr int64_t N = 10000;
+  const int64_t NDIM = dims.size();
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor ix(DT_INT64, TensorShape({N, NDIM}));
+  Tensor vals(DT_STRING, TensorShape({N}));
+  auto ix_t = ix.matrix<int64_t>();
+  auto vals_t = vals.vec<tstring>();
+  for (int64_t n = 0; n < N; ++n) {
+    std::vector<int64_t> index(NDIM);
+    for (int d = 0; d < NDIM; ++d) {
+      index[d] = rnd.Uniform64(std::min<int64_t>(dims[d], 100));
+      ix_t(n, d) = index[d];
+    }
+    vals_t(n) = absl::StrJoin(index, ",");
+  }
+  SparseTensor st;
+  TF_ASSERT_OK(SparseTensor::Create(ix, vals, dims, &st));
+
+  st.Reorder<tstring>(order, pool);
+  ix_t = st.indices().matrix<int64_t>();
+  vals_t = st.values().vec<tstring>();
+  for (int64_t n = 0; n < N; ++n) {
+    std::vector<int64_t> index(NDIM);
+    for (int d = 0; d < NDIM; ++d) index[d] = ix_t(n, d);
+    ASSERT_EQ(vals_t(n), absl::StrJoin(index, ","));
+    if (n == 0) continue;
+    std::vector<int64_t> key(NDIM);
+    std::vector<int64_t> previous_key(NDIM);
+    for (int d = 0; d < NDIM; ++d) {
+      key[d] = ix_t(n, order[d]);
+      previous_key[d] = ix_t(n - 1, order[d]);
+    }
+    ASSERT_LE(previous_key, key) << "at entry " << n;
+  }
+}
+
+TEST(SparseTensorTest, ReorderManyEntries) {
+  thread::ThreadPool pool(Env::Default(), "reorder", 4);
+  CheckReorderManyEntries({100, 60, 70}, {2, 0, 1}, &pool);
+  CheckReorderManyEntries({100, 60, 70}, {0, 1, 2}, nullptr);
+  CheckReorderManyEntries({100}, {0}, &pool);
+  // The linearized indices don't fit in an int64.
+  CheckReorderManyEntries({int64_t{1} << 40, int64_t{1} << 40}, {1, 0}, &pool);
+}
+
 TEST(SparseTensorTest, SparseTensorCheckBoundaries) {
   int N = 5;
   const int NDIM = 3;
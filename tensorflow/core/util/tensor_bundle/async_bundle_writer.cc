@@ -0,0 +1,217 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/async_bundle_writer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+
+namespace {
+
+using Entry = AsyncBundleWriter::Entry;
+
+Status WriteBundle(Env* env, const string& prefix,
+                   const std::vector<const Entry*>& entries,
+                   int data_alignment) {
+  BundleWriter::Options options;
+  options.data_alignment = data_alignment;
+  BundleWriter writer(env, prefix, options);
+  TF_RETURN_IF_ERROR(writer.status());
+  for (const Entry* entry : entries) {
+    if (entry->is_slice) {
+      TF_RETURN_IF_ERROR(writer.AddSlice(entry->key, entry->full_shape,
+                                         entry->slice, entry->tensor));
+    } else {
+      TF_RETURN_IF_ERROR(writer.Add(entry->key, entry->tensor));
+    }
+  }
+  return writer.Finish();
+}
+
+// Splits `entries` into up to `num_parts` parts of about the same size, each
+// in the order of `entries`. The slices of a tensor go to the same part, for
+// its writer to list them all.
+std::vector<std::vector<const Entry*>> Partition(
+    const std::vector<Entry>& entries, int num_parts) {
+  std::vector<string> keys;
+  absl::flat_hash_map<string, int64_t> bytes_of_key;
+  for (const Entry& entry : entries) {
+    auto inserted = bytes_of_key.insert({entry.key, 0});
+    if (inserted.second) keys.push_back(entry.key);
+    inserted.first->second += entry.tensor.TotalBytes();
+  }
+  num_parts = std::max(1, std::min<int>(num_parts, keys.size()));
+  std::vector<std::vector<const Entry*>> parts(num_parts);
+  if (num_parts == 1) {
+    for (const Entry& entry : entries) parts[0].push_back(&entry);
+    return parts;
+  }
+
+  // The largest tensors first, each to the smallest part so far.
+  std::stable_sort(keys.begin(), keys.end(),
+                   [&bytes_of_key](const string& a, const string& b) {
+                     return bytes_of_key[a] > bytes_of_key[b];
+                   });
+  absl::flat_hash_map<string, int> part_of_key;
+  std::vector<int64_t> part_bytes(num_parts, 0);
+  for (const string& key : keys) {
+    const int part =
+        std::min_element(part_bytes.begin(), part_bytes.end()) -
+        part_bytes.begin();
+    part_bytes[part] += bytes_of_key[key];
+    part_of_key[key] = part;
+  }
+  for (const Entry& entry : entries) {
+    parts[part_of_key[entry.key]].push_back(&entry);
+  }
+  return parts;
+}
+
+}  // namespace
+
+AsyncBundleWriter::AsyncBundleWriter(Env* env, int max_pending)
+    : env_(env), max_pending_(std::max(1, max_pending)) {}
+
+AsyncBundleWriter::~AsyncBundleWriter() {
+  Status status = Flush();
+  if (!status.ok()) LOG(ERROR) << status;
+}
+
+AsyncBundleWriter* AsyncBundleWriter::Global() {
+  static AsyncBundleWriter* writer = [] {
+    int64_t max_pending;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_ASYNC_CHECKPOINT_MAX_PENDING", 1,
+                                    &max_pending));
+    // The writer is never destroyed: the process waits for the checkpoints
+    // being written when it exits instead of dropping them.
+    std::atexit([] {
+      Status status = Global()->Flush();
+      if (!status.ok()) LOG(ERROR) << status;
+    });
+    return new AsyncBundleWriter(Env::Default(), max_pending);
+  }();
+  return writer;
+}
+
+Status AsyncBundleWriter::Schedule(const string& prefix,
+                                   std::vector<Entry> entries,
+                                   int num_writers, int data_alignment,
+                                   std::function<void(const Status&)> done) {
+  {
+    mutex_lock l(mu_);
+    while (pending_.contains(prefix) || pending_.size() >= max_pending_) {
+      cv_.wait(l);
+    }
+    if (!errors_.empty()) {
+      Status status = errors_.begin()->second;
+      errors_.clear();
+      return status;
+    }
+    pending_.insert(prefix);
+  }
+  VLOG(1) << "Scheduled asynchronous save of " << entries.size()
+          << " tensors to " << prefix;
+  env_->SchedClosure(
+      [this, prefix, entries = std::move(entries), num_writers, data_alignment,
+       done = std::move(done)]() {
+        Status status =
+            Write(env_, prefix, entries, num_writers, data_alignment);
+        if (!status.ok()) {
+          LOG(ERROR) << "Asynchronous save to " << prefix
+                     << " failed: " << status;
+        }
+        if (done) done(status);
+        mutex_lock l(mu_);
+        pending_.erase(prefix);
+        if (!status.ok()) {
+          errors_[prefix] = errors::CreateWithUpdatedMessage(
+              status, strings::StrCat("Asynchronous save to ", prefix,
+                                      " failed: ", status.error_message()));
+        }
+        cv_.notify_all();
+      });
+  return OkStatus();
+}
+
+Status AsyncBundleWriter::Wait(const string& prefix) {
+  mutex_lock l(mu_);
+  while (pending_.contains(prefix)) cv_.wait(l);
+  auto it = errors_.find(prefix);
+  if (it == errors_.end()) return OkStatus();
+  Status status = it->second;
+  errors_.erase(it);
+  return status;
+}
+
+Status AsyncBundleWriter::Flush() {
+  mutex_lock l(mu_);
+  while (!pending_.empty()) cv_.wait(l);
+  Status status;
+  for (const auto& error : errors_) {
+    if (!status.ok()) LOG(ERROR) << error.second;
+    status.Update(error.second);
+  }
+  errors_.clear();
+  return status;
+}
+
+Status AsyncBundleWriter::Write(Env* env, const string& prefix,
+                                const std::vector<Entry>& entries,
+                                int num_writers, int data_alignment) {
+  const auto parts = Partition(entries, num_writers);
+  if (parts.size() == 1) {
+    return WriteBundle(env, prefix, parts[0], data_alignment);
+  }
+
+  // Each part goes to a bundle of its own next to the merged one, one of
+  // them written by this thread.
+  const string temp_dir = strings::StrCat(prefix, "_temp_parts");
+  std::vector<tstring> part_prefixes;
+  for (int i = 0; i < parts.size(); ++i) {
+    part_prefixes.push_back(
+        io::JoinPath(temp_dir, strings::StrCat("part-", i)));
+  }
+  std::vector<Status> statuses(parts.size());
+  {
+    thread::ThreadPool pool(env, "checkpoint_writer", parts.size() - 1);
+    for (int i = 1; i < parts.size(); ++i) {
+      pool.Schedule(
+          [env, &parts, &part_prefixes, &statuses, i, data_alignment]() {
+            statuses[i] =
+                WriteBundle(env, part_prefixes[i], parts[i], data_alignment);
+          });
+    }
+    statuses[0] =
+        WriteBundle(env, part_prefixes[0], parts[0], data_alignment);
+  }
+  for (const Status& status : statuses) TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(MergeBundles(env, part_prefixes, prefix));
+  Status status = env->DeleteDir(temp_dir);
+  if (!status.ok()) VLOG(1) << status;
+  return OkStatus();
+}
+
+}  // namespace tensorflow
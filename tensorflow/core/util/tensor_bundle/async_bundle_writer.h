@@ -0,0 +1,112 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_ASYNC_BUNDLE_WRITER_H_
+#define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_ASYNC_BUNDLE_WRITER_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_slice.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Writes tensor bundles in the background, so that a save does not block its
+// caller for as long as the bundle takes to write.
+//
+// A bundle may also be written by several BundleWriters in parallel, each
+// writing a part of its tensors to a bundle of its own, which are then merged
+// with MergeBundles() into a bundle of as many data files.
+//
+// The tensors of a scheduled save must not be mutated until it finishes, so
+// the caller passes tensors nobody else refers to, e.g. deep copies.
+class AsyncBundleWriter {
+ public:
+  // A tensor to write, or a slice of a tensor if `is_slice` is set.
+  struct Entry {
+    string key;
+    Tensor tensor;
+    bool is_slice = false;
+    TensorShape full_shape;
+    TensorSlice slice;
+  };
+
+  // Saves up to `max_pending` bundles at a time.
+  AsyncBundleWriter(Env* env, int max_pending);
+
+  // Flushes the pending saves.
+  ~AsyncBundleWriter();
+
+  // Returns the writer shared by the save ops of the process, which saves up
+  // to TF_ASYNC_CHECKPOINT_MAX_PENDING bundles at a time (default 1). Its
+  // pending saves are flushed when the process exits.
+  static AsyncBundleWriter* Global();
+
+  // Schedules writing `entries` to the bundle at `prefix` with up to
+  // `num_writers` writers in parallel, aligning the tensors of its data files
+  // to `data_alignment` bytes, and returns without waiting for it. Calls
+  // `done`, if set, with the status of the write once the bundle is written,
+  // and before the save is finished for Wait().
+  //
+  // Waits first for an earlier save to the same prefix, and while too many
+  // saves are pending. Returns the error of an earlier save nobody waited
+  // for, if any, without scheduling this one or calling `done`.
+  Status Schedule(const string& prefix, std::vector<Entry> entries,
+                  int num_writers, int data_alignment = 1,
+                  std::function<void(const Status&)> done = nullptr);
+
+  // Waits for the save to `prefix`, if any is pending, and returns the error
+  // of the last save to `prefix` nobody waited for, if any.
+  Status Wait(const string& prefix);
+
+  // Waits for all the pending saves, and returns the error of a save nobody
+  // waited for, if any. The errors of the other saves are logged.
+  Status Flush();
+
+  // Writes `entries` to the bundle at `prefix` with up to `num_writers`
+  // writers in parallel, aligning the tensors of its data files to
+  // `data_alignment` bytes. Each writer writes its tensors in the order of
+  // `entries`.
+  static Status Write(Env* env, const string& prefix,
+                      const std::vector<Entry>& entries, int num_writers,
+                      int data_alignment = 1);
+
+ private:
+  Env* const env_;  // Not owned.
+  const int max_pending_;
+
+  mutex mu_;
+  condition_variable cv_;
+  // The prefixes of the saves scheduled and not finished.
+  absl::flat_hash_set<string> pending_ TF_GUARDED_BY(mu_);
+  // The errors of the finished saves, by prefix, until somebody sees them.
+  absl::flat_hash_map<string, Status> errors_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(AsyncBundleWriter);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_ASYNC_BUNDLE_WRITER_H_
@@ -0,0 +1,185 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/async_bundle_writer.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/tensor_bundle/naming.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace {
+
+using Entry = AsyncBundleWriter::Entry;
+
+string Prefix(const string& prefix) {
+  return io::JoinPath(testing::TmpDir(), prefix);
+}
+
+// Returns tensors "a", "b" and "c" of different sizes, and the two halves of
+// "sliced".
+std::vector<Entry> MakeEntries() {
+  std::vector<Entry> entries(5);
+  entries[0].key = "a";
+  entries[0].tensor = test::AsTensor<float>({1, 2, 3, 4, 5, 6, 7, 8});
+  entries[1].key = "b";
+  entries[1].tensor = test::AsTensor<int32>({9, 10});
+  entries[2].key = "c";
+  entries[2].tensor = test::AsTensor<tstring>({"x", "y", "z"});
+  for (int i = 0; i < 2; ++i) {
+    Entry& entry = entries[3 + i];
+    entry.key = "sliced";
+    entry.tensor = test::AsTensor<float>({i * 10.0f, i * 10.0f + 1});
+    entry.is_slice = true;
+    entry.full_shape = TensorShape({4});
+    entry.slice = TensorSlice({{i * 2, 2}});
+  }
+  return entries;
+}
+
+void ExpectEntries(const string& prefix, int num_data_files) {
+  // The data files of an earlier bundle at `prefix` are left in place.
+  for (int i = 0; i < num_data_files; ++i) {
+    TF_EXPECT_OK(
+        Env::Default()->FileExists(DataFilename(prefix, i, num_data_files)));
+  }
+
+  BundleReader reader(Env::Default(), prefix);
+  TF_ASSERT_OK(reader.status());
+  for (const Entry& entry : MakeEntries()) {
+    Tensor value(entry.tensor.dtype(), entry.tensor.shape());
+    if (entry.is_slice) {
+      TF_ASSERT_OK(reader.LookupSlice(entry.key, entry.slice, &value));
+      test::ExpectTensorEqual<float>(value, entry.tensor);
+    } else {
+      TF_ASSERT_OK(reader.Lookup(entry.key, &value));
+      EXPECT_EQ(value.DebugString(3), entry.tensor.DebugString(3));
+    }
+  }
+}
+
+TEST(AsyncBundleWriterTest, WritesInOneWriter) {
+  const string prefix = Prefix("one_writer");
+  TF_ASSERT_OK(AsyncBundleWriter::Write(Env::Default(), prefix, MakeEntries(),
+                                        /*num_writers=*/1));
+  ExpectEntries(prefix, 1);
+}
+
+TEST(AsyncBundleWriterTest, WritesInTheOrderOfTheEntries) {
+  const string prefix = Prefix("order");
+  const std::vector<Entry> entries = MakeEntries();
+  TF_ASSERT_OK(AsyncBundleWriter::Write(Env::Default(), prefix, entries,
+                                        /*num_writers=*/1));
+  // "a", the first tensor, is not the largest one.
+  string data;
+  TF_ASSERT_OK(ReadFileToString(
+      Env::Default(), DataFilename(prefix, 0, 1), &data));
+  EXPECT_TRUE(absl::StartsWith(data, entries[0].tensor.tensor_data()));
+}
+
+TEST(AsyncBundleWriterTest, WritesInParallelWriters) {
+  const string prefix = Prefix("parallel_writers");
+  TF_ASSERT_OK(AsyncBundleWriter::Write(Env::Default(), prefix, MakeEntries(),
+                                        /*num_writers=*/3));
+  ExpectEntries(prefix, 3);
+  EXPECT_FALSE(
+      Env::Default()->FileExists(strings::StrCat(prefix, "_temp_parts")).ok());
+}
+
+TEST(AsyncBundleWriterTest, NoMoreWritersThanTensors) {
+  const string prefix = Prefix("more_writers");
+  TF_ASSERT_OK(AsyncBundleWriter::Write(Env::Default(), prefix, MakeEntries(),
+                                        /*num_writers=*/10));
+  ExpectEntries(prefix, 4);
+}
+
+TEST(AsyncBundleWriterTest, WritesInBackground) {
+  AsyncBundleWriter writer(Env::Default(), /*max_pending=*/2);
+  const string prefix = Prefix("background");
+  TF_ASSERT_OK(writer.Schedule(prefix, MakeEntries(), /*num_writers=*/2));
+  TF_ASSERT_OK(writer.Wait(prefix));
+  ExpectEntries(prefix, 2);
+  // The next save to the prefix replaces it.
+  TF_ASSERT_OK(writer.Schedule(prefix, MakeEntries(), /*num_writers=*/1));
+  TF_ASSERT_OK(writer.Wait(prefix));
+  ExpectEntries(prefix, 1);
+}
+
+TEST(AsyncBundleWriterTest, CallsDoneBeforeTheSaveFinishes) {
+  AsyncBundleWriter writer(Env::Default(), /*max_pending=*/1);
+  const string prefix = Prefix("done");
+  bool written = false;
+  TF_ASSERT_OK(writer.Schedule(prefix, MakeEntries(), /*num_writers=*/1,
+                               /*data_alignment=*/1,
+                               [&written, prefix](const Status& status) {
+                                 TF_EXPECT_OK(status);
+                                 // The bundle is written.
+                                 written = BundleReader(Env::Default(), prefix)
+                                               .status()
+                                               .ok();
+                               }));
+  TF_ASSERT_OK(writer.Wait(prefix));
+  EXPECT_TRUE(written);
+}
+
+TEST(AsyncBundleWriterTest, FlushesPendingSaves) {
+  const string prefix_1 = Prefix("flush_1");
+  const string prefix_2 = Prefix("flush_2");
+  {
+    AsyncBundleWriter writer(Env::Default(), /*max_pending=*/2);
+    TF_ASSERT_OK(writer.Schedule(prefix_1, MakeEntries(), /*num_writers=*/1));
+    TF_ASSERT_OK(writer.Schedule(prefix_2, MakeEntries(), /*num_writers=*/1));
+    TF_ASSERT_OK(writer.Flush());
+    ExpectEntries(prefix_1, 1);
+    ExpectEntries(prefix_2, 1);
+
+    // The destructor flushes too.
+    TF_ASSERT_OK(writer.Schedule(prefix_1, MakeEntries(), /*num_writers=*/2));
+  }
+  ExpectEntries(prefix_1, 2);
+}
+
+TEST(AsyncBundleWriterTest, ReportsErrors) {
+  // A prefix under a file cannot be written.
+  const string file = Prefix("not_a_dir");
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), file, "contents"));
+  const string prefix = io::JoinPath(file, "ckpt");
+
+  AsyncBundleWriter writer(Env::Default(), /*max_pending=*/1);
+  TF_ASSERT_OK(writer.Schedule(prefix, MakeEntries(), /*num_writers=*/1));
+  Status status = writer.Wait(prefix);
+  EXPECT_FALSE(status.ok());
+  EXPECT_NE(status.error_message().find("Asynchronous save"), string::npos);
+  TF_EXPECT_OK(writer.Wait(prefix));
+
+  // A save nobody waited for fails the next one.
+  TF_ASSERT_OK(writer.Schedule(prefix, MakeEntries(), /*num_writers=*/1));
+  EXPECT_FALSE(
+      writer.Schedule(Prefix("after_error"), MakeEntries(), 1).ok());
+  TF_EXPECT_OK(writer.Schedule(Prefix("after_error"), MakeEntries(), 1));
+  TF_EXPECT_OK(writer.Wait(Prefix("after_error")));
+}
+
+}  // namespace
+}  // namespace tensorflow
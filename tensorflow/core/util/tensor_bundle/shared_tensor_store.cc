@@ -0,0 +1,165 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/shared_tensor_store.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/hash.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+namespace {
+
+uint64 HashTensor(const Tensor& tensor) {
+  const StringPiece data = tensor.tensor_data();
+  uint64 hash = Hash64(data.data(), data.size());
+  hash = Hash64Combine(hash, tensor.dtype());
+  for (int64_t dim : tensor.shape().dim_sizes()) {
+    hash = Hash64Combine(hash, dim);
+  }
+  return hash;
+}
+
+bool SameContents(const Tensor& a, const Tensor& b) {
+  if (a.dtype() != b.dtype() || a.shape() != b.shape()) return false;
+  const StringPiece a_data = a.tensor_data();
+  const StringPiece b_data = b.tensor_data();
+  return a_data.size() == b_data.size() &&
+         std::memcmp(a_data.data(), b_data.data(), a_data.size()) == 0;
+}
+
+}  // namespace
+
+struct SharedTensorStore::State {
+  mutex mu;
+  // The buffers by hash of the dtype, shape and contents of their tensors.
+  // Not owned: a buffer removes itself when its last reference is dropped.
+  absl::flat_hash_map<uint64, std::vector<Buffer*>> buffers TF_GUARDED_BY(mu);
+  int64_t num_tensors TF_GUARDED_BY(mu) = 0;
+  int64_t total_bytes TF_GUARDED_BY(mu) = 0;
+};
+
+// The buffer of a tensor of the store, referring to the tensor the store was
+// given.
+class SharedTensorStore::Buffer : public TensorBuffer {
+ public:
+  Buffer(std::shared_ptr<State> state, uint64 hash, const Tensor& tensor)
+      : TensorBuffer(const_cast<char*>(tensor.tensor_data().data())),
+        state_(std::move(state)),
+        hash_(hash),
+        tensor_(tensor) {}
+
+  const Tensor& tensor() const { return tensor_; }
+
+  // Refers to the buffer again, unless the last reference to it was dropped.
+  bool TryRefAgain() const { return TryRef(); }
+
+  size_t size() const override { return tensor_.TotalBytes(); }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size());
+    proto->set_allocator_name("SharedTensorStore");
+    proto->set_ptr(reinterpret_cast<uintptr_t>(data()));
+  }
+  // Keeps the tensors sharing the buffer from updating it in place.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  ~Buffer() override {
+    // The store finds no reference to the buffer from now on, since the
+    // last one was dropped, but may still compare it until it is removed.
+    mutex_lock l(state_->mu);
+    std::vector<Buffer*>& buffers = state_->buffers[hash_];
+    buffers.erase(std::find(buffers.begin(), buffers.end(), this));
+    if (buffers.empty()) state_->buffers.erase(hash_);
+    --state_->num_tensors;
+    state_->total_bytes -= size();
+  }
+
+  const std::shared_ptr<State> state_;
+  const uint64 hash_;
+  const Tensor tensor_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(Buffer);
+};
+
+SharedTensorStore::SharedTensorStore(int64_t min_bytes)
+    : min_bytes_(std::max<int64_t>(1, min_bytes)),
+      state_(std::make_shared<State>()) {}
+
+SharedTensorStore* SharedTensorStore::Global() {
+  static SharedTensorStore* store = []() -> SharedTensorStore* {
+    bool share;
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_SHARE_RESTORED_TENSORS", false, &share));
+    if (!share) return nullptr;
+    int64_t min_bytes;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_SHARE_RESTORED_TENSORS_MIN_BYTES",
+                                    4096, &min_bytes));
+    return new SharedTensorStore(min_bytes);
+  }();
+  return store;
+}
+
+Tensor SharedTensorStore::Intern(const Tensor& tensor) {
+  if (!tensor.IsInitialized() || !DataTypeCanUseMemcpy(tensor.dtype()) ||
+      tensor.TotalBytes() < min_bytes_) {
+    return tensor;
+  }
+  // Hashes out of the lock, which only compares the tensors of the same hash.
+  const uint64 hash = HashTensor(tensor);
+  mutex_lock l(state_->mu);
+  std::vector<Buffer*>& buffers = state_->buffers[hash];
+  for (Buffer* buffer : buffers) {
+    // A buffer being destroyed waits for the lock to remove itself.
+    if (SameContents(buffer->tensor(), tensor) && buffer->TryRefAgain()) {
+      VLOG(2) << "Sharing a restored tensor of " << tensor.TotalBytes()
+              << " bytes";
+      return Tensor(tensor.dtype(), tensor.shape(),
+                    core::RefCountPtr<TensorBuffer>(buffer));
+    }
+  }
+  Buffer* buffer = new Buffer(state_, hash, tensor);
+  buffers.push_back(buffer);
+  ++state_->num_tensors;
+  state_->total_bytes += buffer->size();
+  return Tensor(tensor.dtype(), tensor.shape(),
+                core::RefCountPtr<TensorBuffer>(buffer));
+}
+
+int64_t SharedTensorStore::num_tensors() const {
+  mutex_lock l(state_->mu);
+  return state_->num_tensors;
+}
+
+int64_t SharedTensorStore::total_bytes() const {
+  mutex_lock l(state_->mu);
+  return state_->total_bytes;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,75 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_SHARED_TENSOR_STORE_H_
+#define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_SHARED_TENSOR_STORE_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/macros.h"
+
+namespace tensorflow {
+
+// Shares the buffers of tensors of the same contents, so that the SavedModels
+// of a process restoring the same weights, e.g. several versions of a model
+// fine-tuned from a common base, or the same model loaded twice, keep one
+// copy of them.
+//
+// This is safe because the buffers of variables are copy-on-write: a variable
+// assigned a restored tensor refers to its buffer, and copies it before an
+// update unless it is the only one to refer to a buffer owning its memory.
+// The buffers of the store do not own their memory, so they are never
+// updated in place.
+//
+// The store refers to the tensors it returned weakly: a tensor is dropped
+// from the store, and its memory freed, as soon as nobody else refers to it,
+// e.g. once the SavedModels restoring it are unloaded.
+class SharedTensorStore {
+ public:
+  // Shares tensors of at least `min_bytes` bytes. The tensors returned may
+  // outlive the store.
+  explicit SharedTensorStore(int64_t min_bytes);
+
+  // Returns the store shared by the restore ops of the process if
+  // TF_SHARE_RESTORED_TENSORS is set, which shares tensors of at least
+  // TF_SHARE_RESTORED_TENSORS_MIN_BYTES bytes (default 4096), or null.
+  static SharedTensorStore* Global();
+
+  // Returns a tensor of the store of the same dtype, shape and contents as
+  // `tensor` if any, or else adds `tensor` to the store and returns it.
+  // Tensors too small or whose dtype cannot be compared byte-wise, like
+  // strings, are returned as they are.
+  Tensor Intern(const Tensor& tensor);
+
+  // The number and total size of the tensors of the store.
+  int64_t num_tensors() const;
+  int64_t total_bytes() const;
+
+ private:
+  class Buffer;
+  struct State;
+
+  const int64_t min_bytes_;
+  // Shared with the buffers of the store, which drop themselves from it.
+  const std::shared_ptr<State> state_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedTensorStore);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_SHARED_TENSOR_STORE_H_
@@ -0,0 +1,86 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/shared_tensor_store.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(SharedTensorStoreTest, SharesTensorsOfTheSameContents) {
+  SharedTensorStore store(/*min_bytes=*/1);
+  Tensor a = store.Intern(test::AsTensor<float>({1, 2, 3, 4}));
+  Tensor b = store.Intern(test::AsTensor<float>({1, 2, 3, 4}));
+  EXPECT_EQ(a.tensor_data().data(), b.tensor_data().data());
+  EXPECT_EQ(store.num_tensors(), 1);
+  EXPECT_EQ(store.total_bytes(), 16);
+
+  // Other contents, shapes or dtypes are not shared.
+  Tensor c = store.Intern(test::AsTensor<float>({1, 2, 3, 5}));
+  Tensor d = store.Intern(test::AsTensor<float>({1, 2, 3, 4}, {2, 2}));
+  Tensor e = store.Intern(test::AsTensor<int32>({1, 2, 3, 4}));
+  EXPECT_NE(c.tensor_data().data(), a.tensor_data().data());
+  EXPECT_NE(d.tensor_data().data(), a.tensor_data().data());
+  EXPECT_NE(e.tensor_data().data(), a.tensor_data().data());
+  EXPECT_EQ(store.num_tensors(), 4);
+}
+
+TEST(SharedTensorStoreTest, SkipsSmallAndStringTensors) {
+  SharedTensorStore store(/*min_bytes=*/16);
+  Tensor small = test::AsTensor<float>({1, 2});
+  EXPECT_EQ(store.Intern(small).tensor_data().data(),
+            small.tensor_data().data());
+  store.Intern(test::AsTensor<tstring>({"a", "b", "c", "d", "e"}));
+  EXPECT_EQ(store.num_tensors(), 0);
+}
+
+TEST(SharedTensorStoreTest, DropsTensorsNobodyRefersTo) {
+  SharedTensorStore store(/*min_bytes=*/1);
+  Tensor kept = store.Intern(test::AsTensor<float>({1, 2, 3, 4}));
+  store.Intern(test::AsTensor<float>({5, 6, 7, 8}));
+  EXPECT_EQ(store.num_tensors(), 1);
+  EXPECT_EQ(store.total_bytes(), 16);
+  EXPECT_EQ(store.Intern(test::AsTensor<float>({1, 2, 3, 4}))
+                .tensor_data()
+                .data(),
+            kept.tensor_data().data());
+
+  kept = Tensor();
+  EXPECT_EQ(store.num_tensors(), 0);
+  EXPECT_EQ(store.total_bytes(), 0);
+}
+
+TEST(SharedTensorStoreTest, SharedTensorsAreNotUpdatedInPlace) {
+  SharedTensorStore store(/*min_bytes=*/1);
+  // Even the only tensor of a buffer of the store may share it later.
+  Tensor a = store.Intern(test::AsTensor<float>({1, 2, 3, 4}));
+  EXPECT_FALSE(a.RefCountIsOne());
+  Tensor b = store.Intern(test::AsTensor<float>({1, 2, 3, 4}));
+  EXPECT_FALSE(b.RefCountIsOne());
+}
+
+TEST(SharedTensorStoreTest, TensorsOutliveTheStore) {
+  Tensor a;
+  {
+    SharedTensorStore store(/*min_bytes=*/1);
+    a = store.Intern(test::AsTensor<float>({1, 2, 3, 4}));
+  }
+  test::ExpectTensorEqual<float>(a, test::AsTensor<float>({1, 2, 3, 4}));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -16,11 +16,13 @@ limitations under the License.
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <utility>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
@@ -405,6 +407,39 @@ table::Options TableBuilderOptions() {
 // Writes zeros to output buffer to align the next write to the requested
 // alignment. "size" is the current size of the buffer and is updated to the
 // new size.
+// The keys of the entries storing the row indices and values of a delta entry.
+string DeltaRowsKey(StringPiece key) {
+  return strings::StrCat(key, "/.DELTA_ROWS");
+}
+string DeltaValuesKey(StringPiece key) {
+  return strings::StrCat(key, "/.DELTA_VALUES");
+}
+
+// A buffer referring to the bytes of a tensor in a data file mapped into
+// memory.  It does not own them, so that Tensor::RefCountIsOne() is false and
+// the ops updating tensors in place copy it first.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     uint64 offset, size_t size)
+      : TensorBuffer(const_cast<char*>(
+            static_cast<const char*>(region->data()) + offset)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("MappedTensorBundle");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
 Status PadAlignment(FileOutputBuffer* out, int alignment, int64_t* size) {
   int bytes_over = *size % alignment;
   if (bytes_over == 0) {
@@ -525,6 +560,61 @@ Status BundleWriter::AddSlice(StringPiece full_tensor_key,
   return status_;
 }
 
+Status BundleWriter::AddRows(StringPiece key, const TensorShape& full_shape,
+                             const Tensor& rows, const Tensor& values) {
+  if (!status_.ok()) return status_;
+  CHECK_NE(key, kHeaderEntryKey);
+  if (options_.base_prefix.empty()) {
+    status_ = errors::FailedPrecondition("Adding rows of ", key,
+                                         " to a bundle without a base");
+    return status_;
+  }
+  if (!DataTypeCanUseMemcpy(values.dtype())) {
+    status_ = errors::InvalidArgument("Adding rows of ", key, " of type ",
+                                      DataTypeString(values.dtype()));
+    return status_;
+  }
+  if (rows.dtype() != DT_INT64 || !TensorShapeUtils::IsVector(rows.shape()) ||
+      full_shape.dims() < 1 || values.dims() != full_shape.dims() ||
+      values.dim_size(0) != rows.NumElements()) {
+    status_ = errors::InvalidArgument(
+        "Adding rows of ", key, " of shape ", full_shape.DebugString(),
+        " with row indices ", rows.DebugString(), " and values of shape ",
+        values.shape().DebugString());
+    return status_;
+  }
+  for (int d = 1; d < full_shape.dims(); ++d) {
+    if (values.dim_size(d) != full_shape.dim_size(d)) {
+      status_ = errors::InvalidArgument(
+          "Adding rows of ", key, " of shape ", full_shape.DebugString(),
+          " with values of shape ", values.shape().DebugString());
+      return status_;
+    }
+  }
+  const auto rows_vec = rows.vec<int64_t>();
+  for (int64_t i = 0; i < rows_vec.size(); ++i) {
+    const int64_t row = rows_vec(i);
+    if (row < 0 || row >= full_shape.dim_size(0)) {
+      status_ = errors::InvalidArgument("Adding row ", row, " of ", key,
+                                        " of shape ", full_shape.DebugString());
+      return status_;
+    }
+  }
+  const string key_string(key);
+  if (entries_.find(key_string) != entries_.end()) {
+    status_ = errors::InvalidArgument("Adding duplicate key: ", key);
+    return status_;
+  }
+
+  TF_RETURN_IF_ERROR(Add(DeltaRowsKey(key), rows));
+  TF_RETURN_IF_ERROR(Add(DeltaValuesKey(key), values));
+  BundleEntryProto* entry = &entries_[key_string];
+  entry->set_dtype(values.dtype());
+  full_shape.AsProto(entry->mutable_shape());
+  entry->set_delta(true);
+  return status_;
+}
+
 // TODO(zongheng): on metadata write failure or !status_.ok(), consider removing
 // the orphaned data file.
 Status BundleWriter::Finish() {
@@ -559,6 +649,7 @@ Status BundleWriter::Finish() {
     VersionDef* version = header.mutable_version();
     version->set_producer(kTensorBundleVersion);
     version->set_min_consumer(kTensorBundleMinConsumer);
+    header.set_base_prefix(options_.base_prefix);
 
     builder.Add(kHeaderEntryKey, header.SerializeAsString());
 
@@ -593,6 +684,7 @@ struct MergeState {
   bool seen_first_bundle = false;
   BundleHeaderProto_Endianness endianness;
   VersionDef version;
+  string base_prefix;
 
   // Tensor key -> BundleEntryProto.
   std::map<string, BundleEntryProto> entries;
@@ -634,6 +726,7 @@ static Status MergeOneBundle(Env* env, StringPiece prefix,
       merge_state->seen_first_bundle = true;
       merge_state->endianness = header.endianness();
       merge_state->version = header.version();
+      merge_state->base_prefix = header.base_prefix();
     } else {
       // Validates "endianness".
       if (merge_state->endianness != header.endianness()) {
@@ -649,6 +742,12 @@ static Status MergeOneBundle(Env* env, StringPiece prefix,
             "Merging bundles with different format versions: merged ",
             merge_version, " vs. curr ", curr_version);
       }
+      // Validates "base_prefix".
+      if (merge_state->base_prefix != header.base_prefix()) {
+        return errors::InvalidArgument(
+            "Merging bundles with different bases: merged ",
+            merge_state->base_prefix, " vs. curr ", header.base_prefix());
+      }
     }
     num_shards = header.num_shards();
     iter->Next();
@@ -743,6 +842,7 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
     header.set_num_shards(merge.num_shards);
     header.set_endianness(merge.endianness);
     *header.mutable_version() = merge.version;
+    header.set_base_prefix(merge.base_prefix);
     builder.Add(kHeaderEntryKey, header.SerializeAsString());
     // All others.
     for (const auto& p : merge.entries) {
@@ -819,6 +919,11 @@ BundleReader::BundleReader(
   }
   status_ = CheckVersions(header.version(), kTensorBundleVersion,
                           kTensorBundleMinProducer, "Checkpoint", "checkpoint");
+  if (!status_.ok() || header.base_prefix().empty()) return;
+
+  base_ = std::make_unique<BundleReader>(env_, header.base_prefix(),
+                                         enable_multi_threading_for_testing);
+  status_ = base_->status();
 }
 
 BundleReader::~BundleReader() {
@@ -865,6 +970,60 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return OkStatus();
 }
 
+bool BundleReader::InBase(StringPiece key) {
+  if (base_ == nullptr) return false;
+  Seek(key);
+  return !Valid() || this->key() != key;
+}
+
+Status BundleReader::GetDeltaValue(StringPiece key, Tensor* val) {
+  if (base_ == nullptr) {
+    return errors::DataLoss("Delta entry ", key, " in ", prefix_,
+                            ", which has no base");
+  }
+  TF_RETURN_IF_ERROR(base_->Lookup(key, val));
+
+  BundleEntryProto rows_entry, values_entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(DeltaRowsKey(key), &rows_entry));
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(DeltaValuesKey(key), &values_entry));
+  Tensor rows(DT_INT64, TensorShape(rows_entry.shape()));
+  TF_RETURN_IF_ERROR(GetValue(rows_entry, &rows));
+  Tensor values(val->dtype(), TensorShape(values_entry.shape()));
+  TF_RETURN_IF_ERROR(GetValue(values_entry, &values));
+
+  const int64_t num_rows = val->dims() > 0 ? val->dim_size(0) : 0;
+  if (!DataTypeCanUseMemcpy(val->dtype()) ||
+      !TensorShapeUtils::IsVector(rows.shape()) ||
+      values.dims() != val->dims() || values.dims() < 1 ||
+      values.dim_size(0) != rows.NumElements()) {
+    return errors::DataLoss("Delta entry ", key, " of type ",
+                            DataTypeString(val->dtype()), " and shape ",
+                            val->shape().DebugString(), " stores ",
+                            rows.NumElements(), " row indices and values of "
+                            "shape ", values.shape().DebugString());
+  }
+  if (num_rows == 0) return OkStatus();
+  const size_t row_bytes = val->TotalBytes() / num_rows;
+  if (values.TotalBytes() != row_bytes * rows.NumElements()) {
+    return errors::DataLoss("Delta entry ", key, " of shape ",
+                            val->shape().DebugString(),
+                            " stores values of shape ",
+                            values.shape().DebugString());
+  }
+  char* data = const_cast<char*>(val->tensor_data().data());
+  const char* values_data = values.tensor_data().data();
+  const auto rows_vec = rows.vec<int64_t>();
+  for (int64_t i = 0; i < rows.NumElements(); ++i) {
+    const int64_t row = rows_vec(i);
+    if (row < 0 || row >= num_rows) {
+      return errors::DataLoss("Delta entry ", key, " of shape ",
+                              val->shape().DebugString(), " stores row ", row);
+    }
+    memcpy(data + row * row_bytes, values_data + i * row_bytes, row_bytes);
+  }
+  return OkStatus();
+}
+
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
@@ -1008,10 +1167,13 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
 
 Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   CHECK(val != nullptr);
+  if (InBase(key)) return base_->Lookup(key, val);
   BundleEntryProto entry;
   TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
 
-  if (entry.slices().empty()) {
+  if (entry.delta()) {
+    return GetDeltaValue(key, val);
+  } else if (entry.slices().empty()) {
     return GetValue(entry, val);
   } else {
     return GetSliceValue(
@@ -1020,6 +1182,72 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   }
 }
 
+Status BundleReader::LookupMapped(StringPiece key, Tensor* val) {
+  CHECK(val != nullptr);
+  if (InBase(key)) return base_->LookupMapped(key, val);
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+  const TensorShape shape(entry.shape());
+
+  std::shared_ptr<ReadOnlyMemoryRegion> region;
+  if (!entry.delta() && entry.slices().empty() && !need_to_swap_bytes_ &&
+      DataTypeCanUseMemcpy(entry.dtype()) && entry.size() > 0) {
+    TF_RETURN_IF_ERROR(GetMappedData(entry.shard_id(), &region));
+  }
+  if (region != nullptr &&
+      (reinterpret_cast<uintptr_t>(region->data()) + entry.offset()) %
+              EIGEN_MAX_ALIGN_BYTES !=
+          0) {
+    VLOG(2) << "Not mapping the underaligned tensor " << key << " of "
+            << prefix_;
+    region = nullptr;
+  }
+  if (region == nullptr) {
+    Tensor value(entry.dtype(), shape);
+    TF_RETURN_IF_ERROR(Lookup(key, &value));
+    *val = std::move(value);
+    return OkStatus();
+  }
+
+  const uint64 expected_size =
+      shape.num_elements() * DataTypeSize(entry.dtype());
+  if (entry.size() != expected_size) {
+    return errors::DataLoss("Invalid size in bundle entry: key ", key,
+                            "; stored size ", entry.size(),
+                            "; expected size ", expected_size);
+  }
+  if (entry.offset() + entry.size() > region->length()) {
+    return errors::DataLoss("TensorBundle at ", prefix_, " shard ",
+                            entry.shard_id(), " (", region->length(),
+                            " bytes): Tensor ", key, " at offset ",
+                            entry.offset(), " (", entry.size(),
+                            " bytes) is past the end of the file");
+  }
+  auto* buffer =
+      new MappedTensorBuffer(std::move(region), entry.offset(), entry.size());
+  *val = Tensor(entry.dtype(), shape, buffer);
+  buffer->Unref();
+  return OkStatus();
+}
+
+Status BundleReader::GetMappedData(
+    int32 shard_id, std::shared_ptr<ReadOnlyMemoryRegion>* region) {
+  auto it = mapped_data_.find(shard_id);
+  if (it == mapped_data_.end()) {
+    std::unique_ptr<ReadOnlyMemoryRegion> mapped;
+    Status s = env_->NewReadOnlyMemoryRegionFromFile(
+        DataFilename(prefix_, shard_id, num_shards_), &mapped);
+    if (errors::IsUnimplemented(s)) {
+      VLOG(1) << "Not mapping the data files of " << prefix_ << ": " << s;
+    } else if (!s.ok()) {
+      return s;
+    }
+    it = mapped_data_.emplace(shard_id, std::move(mapped)).first;
+  }
+  *region = it->second;
+  return OkStatus();
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -1029,7 +1257,13 @@ Status BundleReader::ReadCurrent(Tensor* val) {
                             entry.shape().ShortDebugString());
   }
 
-  if (entry.slices().empty()) {
+  if (entry.delta()) {
+    // Reading the delta moves the iterator, which is restored after.
+    const string key(iter_->key());
+    Status s = GetDeltaValue(key, val);
+    Seek(key);
+    return s;
+  } else if (entry.slices().empty()) {
     return GetValue(entry, val);
   } else {
     return GetSliceValue(
@@ -1041,6 +1275,7 @@ Status BundleReader::ReadCurrent(Tensor* val) {
 Status BundleReader::LookupTensorSlices(StringPiece key,
                                         std::vector<TensorSlice>* slices) {
   slices->clear();
+  if (InBase(key)) return base_->LookupTensorSlices(key, slices);
   BundleEntryProto entry;
   TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
   slices->reserve(entry.slices_size());
@@ -1053,8 +1288,15 @@ Status BundleReader::LookupTensorSlices(StringPiece key,
 Status BundleReader::LookupSlice(StringPiece full_tensor_key,
                                  const TensorSlice& slice_spec, Tensor* val) {
   CHECK(val != nullptr);
+  if (InBase(full_tensor_key)) {
+    return base_->LookupSlice(full_tensor_key, slice_spec, val);
+  }
   BundleEntryProto entry;
   TF_RETURN_IF_ERROR(GetBundleEntryProto(full_tensor_key, &entry));
+  if (entry.delta()) {
+    return errors::Unimplemented("Reading a slice of delta entry ",
+                                 full_tensor_key);
+  }
   return GetSliceValue(full_tensor_key, entry, slice_spec, val);
 }
 
@@ -1174,12 +1416,14 @@ Status BundleReader::GetSliceValue(StringPiece full_tensor_key,
 }
 
 bool BundleReader::Contains(StringPiece key) {
+  if (InBase(key)) return base_->Contains(key);
   Seek(key);
   return Valid() && (this->key() == key);
 }
 
 Status BundleReader::LookupDtypeAndShape(StringPiece key, DataType* dtype,
                                          TensorShape* shape) {
+  if (InBase(key)) return base_->LookupDtypeAndShape(key, dtype, shape);
   BundleEntryProto entry;
   TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
   *dtype = entry.dtype();
@@ -1192,6 +1436,18 @@ Status BundleReader::LookupTensorShape(StringPiece key, TensorShape* shape) {
   return LookupDtypeAndShape(key, &ignored, shape);
 }
 
+Status BundleReader::LookupShardId(StringPiece key, int* shard_id) {
+  if (InBase(key)) {
+    TF_RETURN_IF_ERROR(base_->LookupShardId(key, shard_id));
+    *shard_id = -1;
+    return OkStatus();
+  }
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+  *shard_id = entry.slices().empty() && !entry.delta() ? entry.shard_id() : -1;
+  return OkStatus();
+}
+
 string BundleReader::DebugString() {
   // Format used below emulates that of TensorSliceReader::DebugString().
   string shape_str;
@@ -62,6 +62,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_TENSOR_BUNDLE_H_
 
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -114,8 +115,13 @@ class BundleWriter {
   struct Options {
     Options() {}
     // Alignment, in bytes, for tensor data.
-    // Must be >= 1. The default size of 1 densely packs tensors.
+    // Must be >= 1. The default size of 1 densely packs tensors.  A multiple
+    // of EIGEN_MAX_ALIGN_BYTES lets BundleReader::LookupMapped() map all the
+    // tensors it can.
     int data_alignment{1};
+    // If non-empty, the bundle is a delta of the bundle at this prefix, to
+    // which AddRows() may add rows of its tensors.
+    string base_prefix;
   };
   BundleWriter(Env* env, StringPiece prefix,
                const Options& options = Options());
@@ -144,6 +150,17 @@ class BundleWriter {
                   const TensorShape& full_tensor_shape,
                   const TensorSlice& slice_spec, const Tensor& slice_tensor);
 
+  // Delta checkpoints support.
+  // Adds the rows "rows" of the tensor of shape "full_shape" keyed by "key",
+  // with values "values", the other rows being those of the tensor keyed by
+  // "key" in the base bundle. "rows" is an int64 vector of distinct row
+  // indices, and row i of "values" is the value of row rows[i].
+  //
+  // REQUIRES: a non-empty "base_prefix" in the options, and a dtype that can
+  // be memcpy'ed.
+  Status AddRows(StringPiece key, const TensorShape& full_shape,
+                 const Tensor& rows, const Tensor& values);
+
   // Finishes the writer and flushes.
   Status Finish() TF_MUST_USE_RESULT;
 
@@ -193,6 +210,10 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 // On construction, silently attempts to read the metadata associated with
 // "prefix".  If caller intends to call any function afterwards, "status()"
 // must be checked.
+//
+// A delta bundle (see BundleWriter::AddRows()) also opens its base bundle, from
+// which the Lookup functions read the tensors and rows it does not store.  The
+// iteration functions only see the entries of the delta bundle itself.
 // All threads accessing the same BundleReader must synchronize.
 class BundleReader {
  public:
@@ -232,6 +253,13 @@ class BundleReader {
   Status LookupTensorShape(StringPiece key,
                            TensorShape* shape) TF_MUST_USE_RESULT;
 
+  // Looks up the index of the data file storing the tensor keyed by "key".
+  // Sets "shard_id" to -1 for a partitioned tensor, whose slices may be
+  // stored in several data files, and for a tensor read from the base bundle
+  // of a delta bundle.
+  // REQUIRES: status().ok()
+  Status LookupShardId(StringPiece key, int* shard_id) TF_MUST_USE_RESULT;
+
   // Looks up the tensor keyed by "key".  If "key" refers to a partitioned
   // tensor, attempts to look up the full contents using all stored slices.
   //
@@ -246,6 +274,23 @@ class BundleReader {
   // REQUIRES: status().ok()
   Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up the tensor keyed by "key" like "Lookup()", but returns, if
+  // possible, a tensor referring to the bytes of its data file mapped into
+  // memory rather than a copy of them.  The processes mapping the same file
+  // share these through the page cache.  "val" is replaced, not filled.
+  //
+  // A mapped tensor is read-only.  It does not own its memory, so that the
+  // resource variables assigned it copy it before an update.  Its checksum is
+  // not validated, so that its pages are only read when it is used.
+  //
+  // Only the tensors of memcpy-able dtypes that are suitably aligned in their
+  // data file (see BundleWriter::Options::data_alignment) are mapped.  The
+  // others, partitioned tensors, the tensors of a delta bundle or of a bundle
+  // of a different endianness, and the tensors of a file system that cannot
+  // map files are read with "Lookup()".
+  // REQUIRES: status().ok()
+  Status LookupMapped(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
@@ -297,11 +342,25 @@ class BundleReader {
   Status GetBundleEntryProto(StringPiece key,
                              BundleEntryProto* entry) TF_MUST_USE_RESULT;
 
+  // Returns whether "key" is only stored in the base bundle, if any.
+  // REQUIRES: status().ok()
+  bool InBase(StringPiece key);
+
+  // Reads the tensor of the delta entry keyed by "key": its value in the base
+  // bundle, updated with the rows stored in this one.
+  Status GetDeltaValue(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
+
   // Reads the tensor value described by the metadata proto "entry".
   // Usage for "val" follows the comment of "Lookup()".
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // Maps the data file "shard_id" into memory, unless it already is.  Sets
+  // "region" to null if its file system cannot map files.
+  Status GetMappedData(int32 shard_id,
+                       std::shared_ptr<ReadOnlyMemoryRegion>* region)
+      TF_MUST_USE_RESULT;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -320,11 +379,18 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32, io::InputBuffer*> data_;
+  // The data files mapped into memory by "LookupMapped()", or null for those
+  // that cannot be.  Shared with the tensors referring to them.
+  std::unordered_map<int32, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
   std::unordered_map<string, checkpoint::TensorSliceSet*> tensor_slices_;
 
+  // The reader of the base bundle of a delta bundle, or null.
+  std::unique_ptr<BundleReader> base_;
+
   // Expected number of data file shards in the bundle.  Extracted by reading
   // the header entry in the metadata table.
   int num_shards_;
@@ -384,6 +450,11 @@ Status BundleReader::SortForSequentialAccess(
   };
   absl::flat_hash_map<string, FileOffset> file_offsets;
   for (const T& element : container) {
+    // Tensors read from the base bundle go first.
+    if (InBase(get_key(element))) {
+      file_offsets[get_key(element)] = {-1, 0};
+      continue;
+    }
     BundleEntryProto entry;
     TF_RETURN_IF_ERROR(GetBundleEntryProto(get_key(element), &entry));
     file_offsets[get_key(element)] = {entry.shard_id(), entry.offset()};
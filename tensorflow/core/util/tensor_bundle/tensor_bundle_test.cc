@@ -951,6 +951,75 @@ TEST(TensorBundleTest, SortForSequentialAccess) {
                           "tensor-1-2", "tensor-1-1", "tensor-1-0"));
 }
 
+TEST(TensorBundleTest, DeltaBundles) {
+  Env* env = Env::Default();
+  const string base_prefix = Prefix("delta_base");
+  {
+    BundleWriter writer(env, base_prefix);
+    TF_EXPECT_OK(writer.Add("embedding", test::AsTensor<float>(
+                                             {0, 1, 2, 3, 4, 5, 6, 7},
+                                             TensorShape({4, 2}))));
+    TF_EXPECT_OK(writer.Add("unchanged", Constant_2x3<float>(1.)));
+    TF_EXPECT_OK(writer.Add("replaced", Constant_2x3<float>(2.)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  const string delta_prefix = Prefix("delta");
+  {
+    BundleWriter::Options options;
+    options.base_prefix = base_prefix;
+    BundleWriter writer(env, delta_prefix, options);
+    TF_EXPECT_OK(writer.AddRows("embedding", TensorShape({4, 2}),
+                                test::AsTensor<int64_t>({3, 1}),
+                                test::AsTensor<float>({30, 31, 10, 11},
+                                                      TensorShape({2, 2}))));
+    TF_EXPECT_OK(writer.Add("replaced", Constant_2x3<float>(3.)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+
+  BundleReader reader(env, delta_prefix);
+  TF_ASSERT_OK(reader.status());
+  Expect<float>(&reader, "embedding",
+                test::AsTensor<float>({0, 1, 10, 11, 4, 5, 30, 31},
+                                      TensorShape({4, 2})));
+  Expect<float>(&reader, "unchanged", Constant_2x3<float>(1.));
+  Expect<float>(&reader, "replaced", Constant_2x3<float>(3.));
+  EXPECT_FALSE(reader.Contains("missing"));
+  int shard_id;
+  TF_ASSERT_OK(reader.LookupShardId("unchanged", &shard_id));
+  EXPECT_EQ(shard_id, -1);
+  TF_ASSERT_OK(reader.LookupShardId("replaced", &shard_id));
+  EXPECT_EQ(shard_id, 0);
+}
+
+TEST(TensorBundleTest, DeltaBundleErrors) {
+  {  // No base.
+    BundleWriter writer(Env::Default(), Prefix("delta_no_base"));
+    EXPECT_FALSE(writer
+                     .AddRows("foo", TensorShape({2, 3}),
+                              test::AsTensor<int64_t>({0}),
+                              Constant<float>(1, TensorShape({1, 3})))
+                     .ok());
+  }
+  BundleWriter::Options options;
+  options.base_prefix = Prefix("delta_base");
+  {  // Mismatched values.
+    BundleWriter writer(Env::Default(), Prefix("delta_bad_values"), options);
+    EXPECT_FALSE(writer
+                     .AddRows("foo", TensorShape({2, 3}),
+                              test::AsTensor<int64_t>({0}),
+                              Constant<float>(1, TensorShape({1, 2})))
+                     .ok());
+  }
+  {  // Row out of range.
+    BundleWriter writer(Env::Default(), Prefix("delta_bad_row"), options);
+    EXPECT_FALSE(writer
+                     .AddRows("foo", TensorShape({2, 3}),
+                              test::AsTensor<int64_t>({2}),
+                              Constant<float>(1, TensorShape({1, 3})))
+                     .ok());
+  }
+}
+
 TEST(TensorBundleTest, Error) {
   {  // Dup keys.
     BundleWriter writer(Env::Default(), Prefix("dup"));
@@ -1201,6 +1270,46 @@ TEST_F(TensorBundleAlignmentTest, AlignmentTest) {
   }
 }
 
+TEST(TensorBundleTest, MappedTensors) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("mapped"), opts);
+    TF_EXPECT_OK(writer.Add("flag", Constant(true, TensorShape({1}))));
+    TF_EXPECT_OK(writer.Add("names", test::AsTensor<tstring>({"a", "b"})));
+    TF_EXPECT_OK(writer.Add("weights", Constant_100x100<float>(2)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  Tensor weights, names;
+  {
+    BundleReader reader(Env::Default(), Prefix("mapped"));
+    TF_ASSERT_OK(reader.status());
+    TF_ASSERT_OK(reader.LookupMapped("weights", &weights));
+    TF_ASSERT_OK(reader.LookupMapped("names", &names));
+    EXPECT_TRUE(errors::IsNotFound(reader.LookupMapped("missing", &names)));
+  }
+  // The mapped tensor outlives its reader, and does not own its memory.
+  test::ExpectTensorEqual<float>(weights, Constant_100x100<float>(2));
+  EXPECT_FALSE(weights.RefCountIsOne());
+  EXPECT_TRUE(weights.IsAligned());
+  // String tensors are read.
+  test::ExpectTensorEqual<tstring>(names, test::AsTensor<tstring>({"a", "b"}));
+  EXPECT_TRUE(names.RefCountIsOne());
+
+  // So are the tensors of densely packed data files.
+  {
+    BundleWriter writer(Env::Default(), Prefix("unaligned"));
+    TF_EXPECT_OK(writer.Add("flag", Constant(true, TensorShape({1}))));
+    TF_EXPECT_OK(writer.Add("weights", Constant_100x100<float>(3)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader reader(Env::Default(), Prefix("unaligned"));
+  TF_ASSERT_OK(reader.status());
+  TF_ASSERT_OK(reader.LookupMapped("weights", &weights));
+  test::ExpectTensorEqual<float>(weights, Constant_100x100<float>(3));
+  EXPECT_TRUE(weights.RefCountIsOne());
+}
+
 static void BM_BundleAlignment(::testing::benchmark::State& state) {
   {
     const int alignment = state.range(0);
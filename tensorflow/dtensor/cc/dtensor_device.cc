@@ -71,11 +71,13 @@ limitations under the License.
 #include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
+#include "tensorflow/core/public/version.h"
 #include "tensorflow/core/util/dump_graph.h"
 #include "tensorflow/dtensor/cc/constants.h"
 #include "tensorflow/dtensor/cc/dstatus.h"
 #include "tensorflow/dtensor/cc/dtensor_device_util.h"
 #include "tensorflow/dtensor/cc/dtensor_graph_to_mlir_pass.h"
+#include "tensorflow/dtensor/cc/dtensor_utils.h"
 #include "tensorflow/dtensor/cc/parallel_executor.h"
 #include "tensorflow/dtensor/cc/small_constant_optimization.h"
 #include "tensorflow/dtensor/cc/tensor_layout.h"
@@ -1397,6 +1399,33 @@ DTensorDevice::DTensorOperationToModule(
   return result;
 }
 
+namespace {
+
+// Returns the key of a function in the persistent cache of SPMD expanded
+// functions. Unlike the in-process cache key, which identifies the function by
+// its name, it covers the definitions of the function and of the functions it
+// calls, as well as the devices, the flags of the DTensor passes, set through
+// the environment variables of DTensor, and the TensorFlow version.
+Fprint128 PersistentCacheKey(const FunctionLibraryDefinition& flib_def,
+                             const FunctionDef& function_def,
+                             Fprint128 cache_key,
+                             const std::vector<Device*>& tf_devices) {
+  FunctionDefLibrary library =
+      flib_def.ReachableDefinitions(function_def).ToProto();
+  *library.add_function() = function_def;
+  std::string serialized;
+  SerializeToStringDeterministic(library, &serialized);
+  cache_key = FingerprintCat128(cache_key, Fingerprint128(serialized));
+  for (const Device* device : tf_devices) {
+    cache_key = FingerprintCat128(cache_key, Fingerprint128(device->name()));
+  }
+  cache_key =
+      FingerprintCat128(cache_key, Fingerprint128(SpmdExpansionEnvVars()));
+  return FingerprintCat128(cache_key, Fingerprint128(TF_VERSION_STRING));
+}
+
+}  // namespace
+
 void DTensorDevice::ModuleToExecutionFunctions(
     TFE_Context* context, const std::vector<TensorWithLayout*>& inputs,
     const DTensorOperation& doperation, const NameAttrList& eager_attributes,
@@ -1430,8 +1459,15 @@ void DTensorDevice::ModuleToExecutionFunctions(
   {
     profiler::TraceMe activity([&] { return "DTensorDevice::RunMLIRPasses"; },
                                profiler::TraceMeLevel::kInfo);
-    RETURN_C_STATUS_IF_NOT_OK(pass_runner_.Run(*lowering_context.module),
-                              status);
+    std::optional<Fprint128> persistent_cache_key;
+    if (function_def) {
+      persistent_cache_key = PersistentCacheKey(
+          *flib_def, *function_def, lowering_context.doperation_cache_key,
+          tensorflow::unwrap(context)->ListAllTfDevices());
+    }
+    RETURN_C_STATUS_IF_NOT_OK(
+        pass_runner_.Run(*lowering_context.module, persistent_cache_key),
+        status);
   }
   // Converts MLIR to GraphDef and merges to the global Graph.
   absl::flat_hash_set<Node*> control_ret_nodes;
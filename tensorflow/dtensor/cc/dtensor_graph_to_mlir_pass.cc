@@ -16,8 +16,10 @@ limitations under the License.
 #include "tensorflow/dtensor/cc/dtensor_graph_to_mlir_pass.h"
 
 #include <memory>
+#include <string>
 #include <utility>
 
+#include "llvm/Support/raw_ostream.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"  // from @llvm-project
 #include "mlir/IR/Builders.h"  // from @llvm-project
 #include "mlir/IR/BuiltinAttributes.h"  // from @llvm-project
@@ -26,6 +28,7 @@ limitations under the License.
 #include "mlir/IR/Dialect.h"  // from @llvm-project
 #include "mlir/IR/SymbolTable.h"  // from @llvm-project
 #include "mlir/IR/Types.h"  // from @llvm-project
+#include "mlir/Parser/Parser.h"  // from @llvm-project
 #include "mlir/Support/LogicalResult.h"  // from @llvm-project
 #include "tensorflow/compiler/jit/flags.h"
 #include "tensorflow/compiler/mlir/tensorflow/ir/tf_device.h"
@@ -41,6 +44,8 @@ limitations under the License.
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/util/dump_graph.h"
 #include "tensorflow/dtensor/cc/constants.h"
@@ -112,7 +117,85 @@ DTensorMlirPassRunner::ImportGraphToMlir(
   return module_ref;
 }
 
-Status DTensorMlirPassRunner::Run(mlir::ModuleOp module) {
+namespace {
+
+std::string CachedModuleFilename(const std::string& cache_dir,
+                                 Fprint128 key) {
+  return io::JoinPath(cache_dir, absl::StrCat("dtensor_module_", key.low64,
+                                              "_", key.high64, ".mlir"));
+}
+
+}  // namespace
+
+bool DTensorMlirPassRunner::LoadCachedModule(const std::string& cache_dir,
+                                             Fprint128 key,
+                                             mlir::ModuleOp module) {
+  const std::string filename = CachedModuleFilename(cache_dir, key);
+  Env* env = Env::Default();
+  if (!env->FileExists(filename).ok()) return false;
+  std::string contents;
+  Status status = ReadFileToString(env, filename, &contents);
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to read the cached module " << filename << ": "
+                 << status;
+    return false;
+  }
+
+  // The pipeline may produce ops of dialects that are only loaded when it
+  // first runs.
+  mlir::DialectRegistry registry;
+  pass_manager_.getDependentDialects(registry);
+  context_.appendDialectRegistry(registry);
+  mlir::StatusScopedDiagnosticHandler diag_handler(&context_);
+  mlir::OwningOpRef<mlir::ModuleOp> cached_module =
+      mlir::parseSourceString<mlir::ModuleOp>(contents, &context_);
+  if (!cached_module) {
+    LOG(WARNING) << "Failed to parse the cached module " << filename << ": "
+                 << diag_handler.ConsumeStatus();
+    return false;
+  }
+  module.getBody()->clear();
+  module.getBody()->getOperations().splice(
+      module.getBody()->end(), cached_module->getBody()->getOperations());
+  module->setAttrs(cached_module.get()->getAttrDictionary());
+  VLOG(1) << "Loaded the cached module " << filename;
+  return true;
+}
+
+Status DTensorMlirPassRunner::SaveCachedModule(const std::string& cache_dir,
+                                               Fprint128 key,
+                                               mlir::ModuleOp module) {
+  std::string contents;
+  llvm::raw_string_ostream os(contents);
+  // The generic form round-trips even for ops without a custom parser.
+  module->print(os, mlir::OpPrintingFlags().printGenericOpForm());
+  os.flush();
+
+  // Write to a temporary file first, so that the other clients sharing the
+  // directory never see a partially written module.
+  Env* env = Env::Default();
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(cache_dir));
+  const std::string filename = CachedModuleFilename(cache_dir, key);
+  std::string tmp_filename = filename;
+  if (!env->CreateUniqueFileName(&tmp_filename, ".tmp")) {
+    return errors::Internal("Failed to create a temporary file for ",
+                            filename);
+  }
+  TF_RETURN_IF_ERROR(WriteStringToFile(env, tmp_filename, contents));
+  TF_RETURN_IF_ERROR(env->RenameFile(tmp_filename, filename));
+  VLOG(1) << "Saved the transformed module to " << filename;
+  return OkStatus();
+}
+
+Status DTensorMlirPassRunner::Run(
+    mlir::ModuleOp module, std::optional<Fprint128> persistent_cache_key) {
+  const std::string cache_dir =
+      persistent_cache_key.has_value() ? dtensor::SpmdCacheDir() : "";
+  if (!cache_dir.empty() &&
+      LoadCachedModule(cache_dir, *persistent_cache_key, module)) {
+    return OkStatus();
+  }
+
   // Executes and collects results from the passes.
   mlir::StatusScopedDiagnosticHandler diag_handler(&context_);
 
@@ -123,6 +206,13 @@ Status DTensorMlirPassRunner::Run(mlir::ModuleOp module) {
   TF_RETURN_IF_ERROR(diag_handler.ConsumeStatus());
 
   if (logging_enabled_) pass_manager_.getContext()->enableMultithreading();
+
+  if (!cache_dir.empty()) {
+    Status status = SaveCachedModule(cache_dir, *persistent_cache_key, module);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to cache the transformed module: " << status;
+    }
+  }
   return OkStatus();
 }
 
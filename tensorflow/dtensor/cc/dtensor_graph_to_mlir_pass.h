@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_DTENSOR_CC_DTENSOR_GRAPH_TO_MLIR_PASS_H_
 
 #include <memory>
+#include <optional>
 
 #include "absl/container/flat_hash_set.h"
 #include "mlir/IR/MLIRContext.h"  // from @llvm-project
@@ -39,8 +40,14 @@ class DTensorMlirPassRunner {
       const FunctionLibraryDefinition& flib_def, const Graph& graph,
       Fprint128 cache_key);
 
-  // Transforms input MLIR module with DTensor Pass pipeline.
-  Status Run(mlir::ModuleOp module);
+  // Transforms input MLIR module with DTensor Pass pipeline. If the persistent
+  // cache is enabled (see dtensor::SpmdCacheDir()) and `persistent_cache_key`
+  // is set, the transformed module is loaded from the cache when it holds one
+  // for the key, e.g. stored by another client or an earlier run, and stored
+  // in the cache otherwise. The key must cover everything the transformation
+  // depends on.
+  Status Run(mlir::ModuleOp module,
+             std::optional<Fprint128> persistent_cache_key = std::nullopt);
 
  private:
   // N.B. op_registration_ must be initialized before context/pass-manager to
@@ -49,6 +56,13 @@ class DTensorMlirPassRunner {
   mlir::MLIRContext context_;
   mlir::PassManager pass_manager_;
 
+  // Replaces the contents of `module` with the module cached under `key`.
+  // Returns false if there is none.
+  bool LoadCachedModule(const std::string& cache_dir, Fprint128 key,
+                        mlir::ModuleOp module);
+  Status SaveCachedModule(const std::string& cache_dir, Fprint128 key,
+                          mlir::ModuleOp module);
+
   bool logging_enabled_;
 };
 
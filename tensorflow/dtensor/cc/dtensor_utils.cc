@@ -15,13 +15,26 @@ limitations under the License.
 
 #include "tensorflow/dtensor/cc/dtensor_utils.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <string>
+#include <vector>
 
 #include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
 #include "absl/strings/numbers.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
 #include "tensorflow/core/platform/logging.h"
 
+#ifndef _WIN32
+extern "C" {
+
+extern char** environ;
+
+}  // extern "C"
+#endif
+
 namespace tensorflow {
 namespace dtensor {
 
@@ -127,5 +140,41 @@ bool EnableReplicatedSpmdAsDefault(const std::string& op_name) {
   return dtensor_enable_replicated_spmd_as_default != nullptr;
 }
 
+std::string SpmdCacheDir() {
+  char* dtensor_spmd_cache_dir_str = std::getenv("DTENSOR_SPMD_CACHE_DIR");
+  if (dtensor_spmd_cache_dir_str == nullptr) return "";
+  return dtensor_spmd_cache_dir_str;
+}
+
+std::string SpmdExpansionEnvVars() {
+#ifdef _WIN32
+  char** env = _environ;
+#else
+  char** env = environ;
+#endif
+  // All the variables of DTensor but the ones which only affect logging or
+  // where the cache is, so that the new flags are covered by default. The
+  // client ID only affects logging, and the clients share the cache.
+  constexpr absl::string_view kIgnoredVars[] = {
+      "DTENSOR_CLIENT_ID=", "DTENSOR_LOG_ON_ALL_TASKS=",
+      "DTENSOR_LOG_OP_BY_OP=", "DTENSOR_SPMD_CACHE_DIR="};
+  std::vector<std::string> vars;
+  for (; env != nullptr && *env != nullptr; ++env) {
+    absl::string_view var = *env;
+    if (!absl::StartsWith(var, "DTENSOR_") &&
+        !absl::StartsWith(var, "LOWER_DTENSOR_")) {
+      continue;
+    }
+    if (std::none_of(std::begin(kIgnoredVars), std::end(kIgnoredVars),
+                     [var](absl::string_view ignored) {
+                       return absl::StartsWith(var, ignored);
+                     })) {
+      vars.emplace_back(var);
+    }
+  }
+  std::sort(vars.begin(), vars.end());
+  return absl::StrJoin(vars, "\n");
+}
+
 }  // namespace dtensor
 }  // namespace tensorflow
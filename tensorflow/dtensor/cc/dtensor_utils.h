@@ -60,6 +60,16 @@ bool LowerCollectiveGatherToCollectiveGatherV2();
 // implementation to default to the ReplicatedOpSpmdExpander.
 bool EnableReplicatedSpmdAsDefault(const std::string& op_name);
 
+// Returns the directory of the persistent cache of SPMD expanded functions,
+// which can be shared by the clients and across runs, or an empty string if
+// the cache is disabled.
+std::string SpmdCacheDir();
+
+// Returns the DTensor environment variables which may change the SPMD
+// expansion, e.g. the ones read by EnableReplicatedSpmdAsDefault(), as sorted
+// "name=value" lines, for the keys of the persistent cache.
+std::string SpmdExpansionEnvVars();
+
 }  // namespace dtensor
 }  // namespace tensorflow
 
@@ -0,0 +1,92 @@
+# Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for the persistent cache of SPMD expanded functions."""
+
+import os
+import tempfile
+from unittest import mock
+
+import numpy as np
+
+# pylint: disable=g-direct-tensorflow-import
+from tensorflow.dtensor.python import api
+from tensorflow.dtensor.python import layout as layout_lib
+from tensorflow.dtensor.python.tests import test_util
+from tensorflow.python.eager.polymorphic_function import polymorphic_function
+from tensorflow.python.framework import constant_op
+from tensorflow.python.platform import test
+# pylint: enable=g-direct-tensorflow-import
+
+_MESH_DIM_X = 'x'
+
+
+class SpmdCacheTest(test_util.DTensorBaseTest):
+
+  def setUp(self):
+    super().setUp()
+    global_ids = test_util.create_device_ids_array((2,))
+    local_ids = np.ravel(global_ids).tolist()
+    mesh_dict = {
+        device: layout_lib.Mesh([_MESH_DIM_X], global_ids, local_ids,
+                                test_util.create_device_list((2,), device))
+        for device in ('CPU', 'GPU', 'TPU')
+    }
+    self.mesh = self.configTestMesh(mesh_dict)
+    self.cache_dir = tempfile.mkdtemp(dir=self.get_temp_dir())
+
+    @polymorphic_function.function
+    def f(x):
+      return x * 2.0 + 1.0
+
+    self.f = f
+
+  def run_with_new_device(self):
+    # A new DTensor device starts with empty in-process caches, so that the
+    # function is looked up in the persistent cache.
+    test_util.reset_dtensor()
+    x = api.copy_to_mesh(
+        constant_op.constant([1.0, 2.0]),
+        layout_lib.Layout.replicated(self.mesh, rank=1))
+    self.assertAllEqual(api.unpack(self.f(x))[0], [3.0, 5.0])
+
+  def cached_modules(self):
+    return sorted(
+        os.path.join(self.cache_dir, name)
+        for name in os.listdir(self.cache_dir)
+        if name.startswith('dtensor_module_') and name.endswith('.mlir'))
+
+  def test_miss_hit_and_changed_key(self):
+    with mock.patch.dict(os.environ,
+                         {'DTENSOR_SPMD_CACHE_DIR': self.cache_dir}):
+      # The first run misses and stores the expanded function.
+      self.run_with_new_device()
+      modules = self.cached_modules()
+      self.assertLen(modules, 1)
+      # A hit doesn't write the module again.
+      os.utime(modules[0], ns=(0, 0))
+      self.run_with_new_device()
+      self.assertEqual(self.cached_modules(), modules)
+      self.assertEqual(os.stat(modules[0]).st_mtime_ns, 0)
+
+      # The flags of the expansion are part of the key.
+      flag = 'DTENSOR_ENABLE_REPLICATED_SPMD_AS_DEFAULT_TF.MOD'
+      with mock.patch.dict(os.environ, {flag: '1'}):
+        self.run_with_new_device()
+      self.assertLen(self.cached_modules(), 2)
+      self.assertEqual(os.stat(modules[0]).st_mtime_ns, 0)
+
+
+if __name__ == '__main__':
+  test.main()
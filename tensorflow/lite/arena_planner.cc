@@ -272,6 +272,11 @@ TfLiteStatus ArenaPlanner::PlanAllocations() {
   }
   // Note that graph outputs will never be scheduled for deallocation. We
   // could do that here for completeness, but it won't have any effect.
+  if (!group_first_node_.empty()) {
+    for (int i = 0; i < static_cast<int>(num_tensors); ++i) {
+      ExtendToConcurrentNodeGroups(i);
+    }
+  }
   return kTfLiteOk;
 }
 
@@ -296,6 +301,7 @@ TfLiteStatus ArenaPlanner::ExecuteAllocations(int first_node, int last_node) {
       if (!preserve_all_tensors_) {
         dealloc_node_[tensor_index] = i;
       }
+      ExtendToConcurrentNodeGroups(tensor_index);
     }
   }
 
@@ -320,10 +326,42 @@ TfLiteStatus ArenaPlanner::ExecuteAllocations(int first_node, int last_node) {
   return kTfLiteOk;
 }
 
-TfLiteStatus ArenaPlanner::ReleaseNonPersistentMemory() {
-  // Clear non-persistent arena's buffer.
-  TF_LITE_ENSURE_STATUS(arena_.ReleaseBuffer());
-  // Set data pointers for all non-persistent tensors to nullptr.
+void ArenaPlanner::UseSharedArena(SharedMemoryArena* shared_arena) {
+  arena_.UseSharedArena(shared_arena,
+                        [this]() { ClearNonPersistentTensors(); });
+}
+
+TfLiteStatus ArenaPlanner::SetConcurrentNodeGroups(
+    const std::vector<int>& group_of_node) {
+  const int num_nodes = group_of_node.size();
+  group_first_node_.resize(num_nodes);
+  group_last_node_.resize(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    const bool continues_group =
+        i > 0 && group_of_node[i] == group_of_node[i - 1];
+    group_first_node_[i] = continues_group ? group_first_node_[i - 1] : i;
+  }
+  for (int i = num_nodes - 1; i >= 0; --i) {
+    const bool continues_group =
+        i + 1 < num_nodes && group_of_node[i] == group_of_node[i + 1];
+    group_last_node_[i] = continues_group ? group_last_node_[i + 1] : i;
+  }
+  return kTfLiteOk;
+}
+
+void ArenaPlanner::ExtendToConcurrentNodeGroups(int32_t tensor_index) {
+  const int32_t num_nodes = group_first_node_.size();
+  const int32_t alloc_node = alloc_node_[tensor_index];
+  if (alloc_node != kNodeNotAssigned && alloc_node < num_nodes) {
+    alloc_node_[tensor_index] = group_first_node_[alloc_node];
+  }
+  const int32_t dealloc_node = dealloc_node_[tensor_index];
+  if (dealloc_node != kNodeNotAssigned && dealloc_node < num_nodes) {
+    dealloc_node_[tensor_index] = group_last_node_[dealloc_node];
+  }
+}
+
+void ArenaPlanner::ClearNonPersistentTensors() {
   TfLiteTensor* tensors = graph_info_->tensors();
   for (int i = 0; i < static_cast<int>(graph_info_->num_tensors()); ++i) {
     TfLiteTensor& tensor = tensors[i];
@@ -331,6 +369,13 @@ TfLiteStatus ArenaPlanner::ReleaseNonPersistentMemory() {
       tensor.data.raw = nullptr;
     }
   }
+}
+
+TfLiteStatus ArenaPlanner::ReleaseNonPersistentMemory() {
+  // Clear non-persistent arena's buffer.
+  TF_LITE_ENSURE_STATUS(arena_.ReleaseBuffer());
+  // Set data pointers for all non-persistent tensors to nullptr.
+  ClearNonPersistentTensors();
   return kTfLiteOk;
 }
 
@@ -376,8 +421,17 @@ TfLiteStatus ArenaPlanner::Commit(bool* reallocated) {
 }
 
 void ArenaPlanner::CreateTensorAllocationVector(
-    std::vector<int32_t>* tensors_to_allocate) {
+    std::vector<int32_t>* tensors_to_allocate, AllocationOrder order) {
   const TfLiteTensor* tensors = this->graph_info_->tensors();
+  const int64_t num_nodes =
+      static_cast<int64_t>(graph_info_->num_execution_nodes());
+  auto lifetime = [&](int idx) -> int64_t {
+    // The tensors never deallocated live until the end of the inference.
+    const int64_t last_node = dealloc_node_[idx] == kNodeNotAssigned
+                                  ? num_nodes
+                                  : dealloc_node_[idx];
+    return last_node - alloc_node_[idx] + 1;
+  };
   auto tensor_compare = [&](int idx1, int idx2) {
     // Tensors that have lifespan through the whole model inference time are
     // allocated at the beginning of memory slice. Their respective order
@@ -392,9 +446,32 @@ void ArenaPlanner::CreateTensorAllocationVector(
       return false;
     }
 
-    // All other tensors are sorted in non-increasing order of their size.
     auto size1 = tensors[idx1].bytes;
     auto size2 = tensors[idx2].bytes;
+    switch (order) {
+      case AllocationOrder::kBySize:
+        break;
+      case AllocationOrder::kByLifetime:
+        if (lifetime(idx1) != lifetime(idx2)) {
+          return lifetime(idx1) > lifetime(idx2);
+        }
+        break;
+      case AllocationOrder::kBySizeTimesLifetime: {
+        const double area1 = static_cast<double>(size1) * lifetime(idx1);
+        const double area2 = static_cast<double>(size2) * lifetime(idx2);
+        if (area1 != area2) {
+          return area1 > area2;
+        }
+        break;
+      }
+      case AllocationOrder::kByFirstUse:
+        if (alloc_node_[idx1] != alloc_node_[idx2]) {
+          return alloc_node_[idx1] < alloc_node_[idx2];
+        }
+        break;
+    }
+
+    // All other tensors are sorted in non-increasing order of their size.
     if (size1 != size2) {
       return size1 > size2;
     }
@@ -407,6 +484,49 @@ void ArenaPlanner::CreateTensorAllocationVector(
             tensor_compare);
 }
 
+bool ArenaPlanner::SharesBuffer(int32_t tensor_index) const {
+  auto it = actual_tensor_id_.find(tensor_index);
+  if (it == actual_tensor_id_.end()) {
+    return false;
+  }
+  const TfLiteAllocationType allocation_type =
+      graph_info_->tensors()[it->second].allocation_type;
+  return allocation_type == kTfLiteArenaRwPersistent ||
+         allocation_type == kTfLiteArenaRw;
+}
+
+TfLiteStatus ArenaPlanner::FindBestAllocationOrder(
+    const std::vector<int32_t>& tensors_to_allocate,
+    AllocationOrder* best_order) {
+  const TfLiteTensor* tensors = graph_info_->tensors();
+  *best_order = AllocationOrder::kBySize;
+  size_t best_size = std::numeric_limits<size_t>::max();
+  for (AllocationOrder order :
+       {AllocationOrder::kBySize, AllocationOrder::kByLifetime,
+        AllocationOrder::kBySizeTimesLifetime, AllocationOrder::kByFirstUse}) {
+    std::vector<int32_t> ordered_tensors = tensors_to_allocate;
+    CreateTensorAllocationVector(&ordered_tensors, order);
+    // Places the tensors in a scratch arena, which never allocates a buffer.
+    SimpleMemoryArena scratch_arena(kDefaultArenaAlignment);
+    ArenaAllocWithUsageInterval alloc;
+    for (int32_t tensor_index : ordered_tensors) {
+      const TfLiteTensor& tensor = tensors[tensor_index];
+      if (tensor.allocation_type != kTfLiteArenaRw ||
+          SharesBuffer(tensor_index)) {
+        continue;
+      }
+      TF_LITE_ENSURE_STATUS(scratch_arena.Allocate(
+          context_, tensor_alignment_, tensor.bytes, tensor_index,
+          alloc_node_[tensor_index], dealloc_node_[tensor_index], &alloc));
+    }
+    if (scratch_arena.RequiredBufferSize() < best_size) {
+      best_size = scratch_arena.RequiredBufferSize();
+      *best_order = order;
+    }
+  }
+  return kTfLiteOk;
+}
+
 std::vector<int32_t> ArenaPlanner::GetTensorsToAllocate(int first_node,
                                                         int last_node) {
   int num_tensors = static_cast<int>(graph_info_->num_tensors());
@@ -445,15 +565,22 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(
     last_active_node_ = last_node;
     return kTfLiteOk;
   }
+  AllocationOrder order = AllocationOrder::kBySize;
   if (first_node < last_active_node_) {
     arena_.ResetAllocs();
     last_active_node_ = first_node;
+    // Only the tensors of the whole graph are placed in an empty arena, as in
+    // the search.
+    if (placement_search_ && first_node == 0) {
+      TF_LITE_ENSURE_STATUS(
+          FindBestAllocationOrder(*tensors_allocated, &order));
+    }
   } else {
     // NOMUTANTS -- This function has no impact on the results, it only makes
     // exection faster.
     arena_.PurgeActiveAllocs(first_node);
   }
-  CreateTensorAllocationVector(tensors_allocated);
+  CreateTensorAllocationVector(tensors_allocated, order);
   // Vector of ids of already allocated tensors, ordered by offset.
   for (const auto& tensor_index : *tensors_allocated) {
     TfLiteTensor& tensor = tensors[tensor_index];
@@ -68,11 +68,43 @@ class ArenaPlanner : public MemoryPlanner {
   void DumpDebugInfo(const std::vector<int>& execution_plan) const override;
   void GetAllocInfo(size_t* arena_size,
                     size_t* arena_persist_size) const override;
+  TfLiteStatus SetConcurrentNodeGroups(
+      const std::vector<int>& group_of_node) override;
 
   // Returns the base arena location for a given allocation type.
   std::intptr_t BasePointer(TfLiteAllocationType type);
 
+  // Allocates the non-persistent tensors from `shared_arena`, shared with the
+  // planners of other interpreters. When another planner commits its tensors
+  // to it, the non-persistent tensors of this one are released, as by
+  // ReleaseNonPersistentMemory(). Must be called before PlanAllocations().
+  void UseSharedArena(SharedMemoryArena* shared_arena);
+
+  // Places the non-persistent tensors of the whole graph in several orders
+  // and keeps the one taking the least memory, instead of only placing them
+  // from the largest to the smallest. The planning takes a few times longer,
+  // but the arena is never larger.
+  void EnablePlacementSearch(bool enable = true) {
+    placement_search_ = enable;
+  }
+
  private:
+  // Set data pointers for all non-persistent tensors to nullptr.
+  void ClearNonPersistentTensors();
+
+  // The orders in which the tensors may be placed in the arena, all keeping
+  // the tensors alive for the whole inference first.
+  enum class AllocationOrder {
+    // From the largest to the smallest.
+    kBySize,
+    // From the longest lived to the shortest lived.
+    kByLifetime,
+    // From the largest area in the size by lifetime plane to the smallest.
+    kBySizeTimesLifetime,
+    // From the first allocated to the last allocated.
+    kByFirstUse,
+  };
+
   // Identify tensors which may share memory.
   void IdentifySharedTensors();
   // Make sure all the arenas have reserved enough memory to store all their
@@ -85,7 +117,23 @@ class ArenaPlanner : public MemoryPlanner {
   // - Other tensors (e.g. intermediate and temporary ones) are sorted from
   // largest to smallest. For equal sized tensors, the tensor which is used
   // first goes first.
-  void CreateTensorAllocationVector(std::vector<int32_t>* tensors_to_allocate);
+  void CreateTensorAllocationVector(
+      std::vector<int32_t>* tensors_to_allocate,
+      AllocationOrder order = AllocationOrder::kBySize);
+
+  // Sets `best_order` to the order in which placing `tensors_to_allocate` in
+  // an empty arena takes the least memory, preferring the earliest order on
+  // ties.
+  TfLiteStatus FindBestAllocationOrder(
+      const std::vector<int32_t>& tensors_to_allocate,
+      AllocationOrder* best_order);
+
+  // True if `tensor_index` shares the buffer of another tensor of its arena.
+  bool SharesBuffer(int32_t tensor_index) const;
+
+  // Extends the usage interval of `tensor_index` to the first and last nodes
+  // of the concurrent node groups it starts and ends in.
+  void ExtendToConcurrentNodeGroups(int32_t tensor_index);
 
   // Returns vector containing the indices of all tensors allocated between
   // `first_node` and `last_node`.
@@ -130,6 +178,11 @@ class ArenaPlanner : public MemoryPlanner {
   // the node's operation.
   std::vector<int32_t> dealloc_node_;
 
+  // The first and last nodes of the concurrent node group of each node, empty
+  // for no groups.
+  std::vector<int32_t> group_first_node_;
+  std::vector<int32_t> group_last_node_;
+
   // Raw memory buffer that is allocated for all temporary and graph outputs
   // that are declared kTfLiteArenaRw.
   SimpleMemoryArena arena_;
@@ -138,6 +191,9 @@ class ArenaPlanner : public MemoryPlanner {
   // declared as kTfLiteArenaRwPersistent.
   SimpleMemoryArena persistent_arena_;
 
+  // If true, searches for the order placing the tensors in the least memory.
+  bool placement_search_ = false;
+
   // If true, then no overlapping of memory areas is done, meaning intermediate
   // tensors and temporary tensors can be queried after running.
   // (modulo running delegates)
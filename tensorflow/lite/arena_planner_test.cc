@@ -922,6 +922,81 @@ TEST_F(ArenaPlannerTest, GraphWithIntermediates) {
   EXPECT_EQ(GetOffset(2), GetOffsetAfter(5));
 }
 
+TEST_F(ArenaPlannerTest, PlacementSearch) {
+  TestGraph graph({0},
+                  {
+                      /* in, out, tmp */
+                      {{0}, {1}, {}},
+                      {{1}, {2}, {}},
+                      {{2}, {3}, {}},
+                      {{3, 1, 2}, {4}, {}},
+                      {{4, 3}, {5}, {}},
+                  },
+                  {5});
+  const std::vector<size_t> sizes = {32, 28, 8, 16, 8, 32};
+  for (int i = 0; i < sizes.size(); ++i) {
+    (*graph.tensors())[i].bytes = sizes[i];
+  }
+  size_t greedy_size, persistent_size;
+  SetGraph(&graph);
+  Execute(0, graph.nodes().size() - 1);
+  planner_->GetAllocInfo(&greedy_size, &persistent_size);
+
+  // Another order takes less memory than placing the tensors by size.
+  size_t searched_size;
+  SetGraph(&graph);
+  planner_->EnablePlacementSearch();
+  Execute(0, graph.nodes().size() - 1);
+  planner_->GetAllocInfo(&searched_size, &persistent_size);
+  EXPECT_LT(searched_size, greedy_size);
+
+  // The tensors alive at the same time do not overlap. The input lives
+  // through the whole graph, the others from the node writing them to the last
+  // node reading them, or to the end for the output.
+  const std::vector<std::pair<int, int>> lifetimes = {
+      {0, 4}, {0, 3}, {1, 3}, {2, 4}, {3, 4}, {4, 4}};
+  for (int i = 0; i < sizes.size(); ++i) {
+    for (int j = i + 1; j < sizes.size(); ++j) {
+      if (lifetimes[i].second < lifetimes[j].first ||
+          lifetimes[j].second < lifetimes[i].first) {
+        continue;
+      }
+      EXPECT_TRUE(GetOffsetAfter(i) <= GetOffset(j) ||
+                  GetOffsetAfter(j) <= GetOffset(i))
+          << i << " and " << j << " overlap";
+    }
+  }
+}
+
+TEST_F(ArenaPlannerTest, ConcurrentNodeGroups) {
+  TestGraph graph({0},
+                  {
+                      /* in, out, tmp */
+                      {{0}, {1}, {4}},
+                      {{0}, {2}, {5}},
+                      {{1, 2}, {3}, {6}},
+                  },
+                  {3});
+  SetGraph(&graph);
+  Execute(0, graph.nodes().size() - 1);
+  // The temporaries of the first two ops are shared when run one by one.
+  EXPECT_EQ(GetOffset(4), GetOffset(5));
+
+  // They are all allocated together when the first two ops run concurrently.
+  SetGraph(&graph);
+  ASSERT_EQ(planner_->SetConcurrentNodeGroups({0, 0, 1}), kTfLiteOk);
+  ASSERT_EQ(planner_->PlanAllocations(), kTfLiteOk);
+  Execute(0, graph.nodes().size() - 1);
+  for (int i : {0, 1, 2, 4}) {
+    for (int j : {0, 1, 2, 4, 5}) {
+      if (j <= i) continue;
+      EXPECT_TRUE(GetOffsetAfter(i) <= GetOffset(j) ||
+                  GetOffsetAfter(j) <= GetOffset(i))
+          << i << " and " << j << " overlap";
+    }
+  }
+}
+
 TEST_F(ArenaPlannerTest, DebugTensors) {
   TestGraph graph({0, 1},
                   {
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/lite/core/async/async_subgraph.h"
 
+#include <memory>
 #include <vector>
 
 #include "tensorflow/lite/core/c/c_api_types.h"
@@ -21,6 +22,7 @@ limitations under the License.
 #include "tensorflow/lite/core/subgraph.h"
 #include "tensorflow/lite/core/async/async_kernel_internal.h"
 #include "tensorflow/lite/core/async/common.h"
+#include "tensorflow/lite/core/async/cpu_backend_async_kernel.h"
 #include "tensorflow/lite/core/async/task_internal.h"
 #include "tensorflow/lite/logger.h"
 #include "tensorflow/lite/minimal_logging.h"
@@ -45,9 +47,11 @@ TfLiteAsyncKernel* AsyncSubgraph::async_kernel() const {
 }
 
 AsyncSubgraph::AsyncSubgraph(Subgraph* subgraph) : subgraph_(subgraph) {
-  // Currently we only support one delegate and fully delegated subgph.
+  // Currently we only support one delegate and fully delegated subgph. The
+  // other subgraphs are run by the CPU backend.
   if (!IsFullyDelegated()) {
-    subgraph->ReportError("Model is no fully delegated by 1 backend.");
+    cpu_kernel_ = std::make_unique<CpuBackendAsyncKernel>(subgraph);
+    async_kernel_ = cpu_kernel_->kernel();
     return;
   }
   // TODO(b/191883048): Add/Check delegate flag to indicate kernel support.
@@ -16,6 +16,7 @@ limitations under the License.
 #define TENSORFLOW_LITE_CORE_ASYNC_ASYNC_SUBGRAPH_H_
 
 #include <atomic>
+#include <memory>
 #include <vector>
 
 #include "tensorflow/lite/core/c/c_api_types.h"
@@ -23,6 +24,7 @@ limitations under the License.
 #include "tensorflow/lite/core/subgraph.h"
 #include "tensorflow/lite/core/async/async_kernel_internal.h"
 #include "tensorflow/lite/core/async/common.h"
+#include "tensorflow/lite/core/async/cpu_backend_async_kernel.h"
 #include "tensorflow/lite/core/async/interop/c/types.h"
 
 namespace tflite {
@@ -33,6 +35,9 @@ class AsyncSubgraphTestPeer;
 
 // AsyncSubgraph class manages to dispatch I/O information and
 // schedule executions to underlying delegate kernels.
+// The subgraphs not fully delegated to 1 backend are run by the
+// `CpuBackendAsyncKernel`, which binds the registered buffers to the I/O
+// tensors without copies.
 // TODO(b/191883048): Currently we require either `AllocateTensors` or
 // `EnsureTensorAllocation` called to ensure the backend kernels are prepared.
 // However, we don't need to allocate the CPU memory for input / output tensors.
@@ -166,6 +171,9 @@ class AsyncSubgraph {
   // Not owned.
   mutable TfLiteAsyncKernel* async_kernel_ = nullptr;
   TfLiteOpaqueNode* opaque_node_ = nullptr;
+
+  // The kernel of the subgraph if not fully delegated.
+  std::unique_ptr<CpuBackendAsyncKernel> cpu_kernel_;
 };
 
 }  // namespace async
@@ -0,0 +1,375 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/core/async/cpu_backend_async_kernel.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>  // NOLINT(build/c++11)
+#include <set>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/dma-buf.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "tensorflow/lite/core/c/c_api_types.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/subgraph.h"
+#include "tensorflow/lite/core/async/common.h"
+#include "tensorflow/lite/core/async/interop/attribute_keys.h"
+#include "tensorflow/lite/core/async/interop/c/attribute_map.h"
+#include "tensorflow/lite/core/async/interop/c/constants.h"
+#include "tensorflow/lite/core/async/interop/c/types.h"
+#include "tensorflow/lite/core/async/task_internal.h"
+#include "tensorflow/lite/minimal_logging.h"
+
+namespace tflite {
+namespace async {
+namespace {
+
+constexpr uint32_t kBufferTypeKey = static_cast<uint32_t>(
+    TfLiteBufferAttributeKey::kBufferResourceTypeName);
+constexpr uint32_t kOffsetKey =
+    static_cast<uint32_t>(TfLiteBufferAttributeKey::kOffset);
+constexpr uint32_t kSizeKey =
+    static_cast<uint32_t>(TfLiteBufferAttributeKey::kSize);
+constexpr uint32_t kSyncTypeKey =
+    static_cast<uint32_t>(TfLiteSyncAttributeKey::kSyncObjectTypeName);
+
+bool IsSupportedBufferType(const char* type) {
+#if defined(__linux__)
+  if (std::strcmp(type, kTfLiteBufferTypeDmaBuf) == 0) return true;
+#endif
+  return std::strcmp(type, kTfLiteBufferTypeHostMemory) == 0;
+}
+
+bool IsSupportedSyncType(const char* type) {
+#if defined(__linux__)
+  if (std::strcmp(type, kTfLiteSyncTypeSyncFence) == 0) return true;
+#endif
+  return std::strcmp(type, kTfLiteSyncTypeNoSyncObj) == 0;
+}
+
+#if defined(__linux__)
+// Waits for the fence to signal and closes it.
+TfLiteStatus WaitForFence(int fd) {
+  if (fd < 0) return kTfLiteOk;
+  pollfd poll_fd = {fd, POLLIN, 0};
+  int ret;
+  do {
+    ret = poll(&poll_fd, 1, /*timeout=*/-1);
+  } while (ret < 0 && (errno == EINTR || errno == EAGAIN));
+  close(fd);
+  if (ret < 0 || (poll_fd.revents & (POLLERR | POLLNVAL)) != 0) {
+    TFLITE_LOG(TFLITE_LOG_ERROR, "Failed to wait for the input sync fence.");
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+// Flushes or invalidates the CPU caches of a dma-buf around the CPU accesses.
+void SyncDmaBuf(int fd, uint64_t flags) {
+  dma_buf_sync sync = {flags | DMA_BUF_SYNC_RW};
+  while (ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) < 0 &&
+         (errno == EINTR || errno == EAGAIN)) {
+  }
+}
+#endif
+
+}  // namespace
+
+CpuBackendAsyncKernel::CpuBackendAsyncKernel(Subgraph* subgraph)
+    : subgraph_(subgraph) {}
+
+CpuBackendAsyncKernel::~CpuBackendAsyncKernel() {
+#if defined(__linux__)
+  for (const auto& handle_and_buffer : buffers_) {
+    const Buffer& buffer = handle_and_buffer.second;
+    if (buffer.dma_buf_fd >= 0 && buffer.pool == kTfLiteNullBufferHandle) {
+      munmap(buffer.data, buffer.bytes);
+    }
+  }
+#endif
+}
+
+TfLiteStatus CpuBackendAsyncKernel::RegisterBuffer(
+    TfLiteOpaqueContext* context, TfLiteIoType io_type,
+    const TfLiteBackendBuffer* buffer, const TfLiteAttributeMap* attrs,
+    TfLiteBufferHandle handle) {
+  const char* type = nullptr;
+  size_t bytes = 0;
+  if (!TfLiteAttributeMapGetStringAttr(attrs, kBufferTypeKey, &type) ||
+      !IsSupportedBufferType(type) ||
+      !TfLiteAttributeMapGetSizeTAttr(attrs, kSizeKey, &bytes)) {
+    TFLITE_LOG(TFLITE_LOG_ERROR,
+               "The CPU backend requires a supported buffer type and size.");
+    return kTfLiteError;
+  }
+  void* ptr = TfLiteBackendBufferGetPtr(buffer);
+  if (ptr == nullptr) return kTfLiteError;
+
+  Buffer registered;
+  registered.bytes = bytes;
+  if (std::strcmp(type, kTfLiteBufferTypeHostMemory) == 0) {
+    registered.data = static_cast<char*>(ptr);
+  } else {
+#if defined(__linux__)
+    const int fd = *static_cast<const int*>(ptr);
+    void* data =
+        mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      TFLITE_LOG(TFLITE_LOG_ERROR, "Failed to map the dma-buf: %s",
+                 std::strerror(errno));
+      return kTfLiteError;
+    }
+    registered.data = static_cast<char*>(data);
+    registered.dma_buf_fd = fd;
+#endif
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffers_[handle] = registered;
+  return kTfLiteOk;
+}
+
+TfLiteStatus CpuBackendAsyncKernel::RegisterBufferSlice(
+    TfLiteOpaqueContext* context, TfLiteBufferHandle buffer_pool,
+    const TfLiteAttributeMap* attrs, TfLiteBufferHandle handle) {
+  size_t offset = 0;
+  size_t bytes = 0;
+  if (!TfLiteAttributeMapGetSizeTAttr(attrs, kOffsetKey, &offset) ||
+      !TfLiteAttributeMapGetSizeTAttr(attrs, kSizeKey, &bytes)) {
+    return kTfLiteError;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = buffers_.find(buffer_pool);
+  if (it == buffers_.end() || it->second.pool != kTfLiteNullBufferHandle ||
+      offset > it->second.bytes || bytes > it->second.bytes - offset) {
+    return kTfLiteError;
+  }
+  Buffer slice = it->second;
+  slice.data += offset;
+  slice.bytes = bytes;
+  slice.pool = buffer_pool;
+  slice.num_slices = 0;
+  ++it->second.num_slices;
+  buffers_[handle] = slice;
+  return kTfLiteOk;
+}
+
+TfLiteStatus CpuBackendAsyncKernel::UnregisterBuffer(
+    TfLiteOpaqueContext* context, TfLiteBufferHandle handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = buffers_.find(handle);
+  // The pools are kept mapped until their slices are unregistered.
+  if (it == buffers_.end() || it->second.num_slices != 0) return kTfLiteError;
+  const Buffer& buffer = it->second;
+  if (buffer.pool != kTfLiteNullBufferHandle) {
+    --buffers_[buffer.pool].num_slices;
+  } else if (buffer.dma_buf_fd >= 0) {
+#if defined(__linux__)
+    munmap(buffer.data, buffer.bytes);
+#endif
+  }
+  buffers_.erase(it);
+  return kTfLiteOk;
+}
+
+std::vector<const char*> CpuBackendAsyncKernel::SupportedBufferTypes(
+    TfLiteIoType io_type) const {
+#if defined(__linux__)
+  return {kTfLiteBufferTypeHostMemory, kTfLiteBufferTypeDmaBuf};
+#else
+  return {kTfLiteBufferTypeHostMemory};
+#endif
+}
+
+std::vector<const char*> CpuBackendAsyncKernel::SupportedSynchronizations(
+    TfLiteIoType io_type) const {
+#if defined(__linux__)
+  return {kTfLiteSyncTypeNoSyncObj, kTfLiteSyncTypeSyncFence};
+#else
+  return {kTfLiteSyncTypeNoSyncObj};
+#endif
+}
+
+bool CpuBackendAsyncKernel::ReconcileRestrictions(
+    TfLiteOpaqueContext* context, TfLiteOpaqueNode* node, int tensor_index,
+    const TfLiteAttributeMap* user_provided_attributes,
+    TfLiteAttributeMap* merged, TfLiteAttributeMap* conflict) const {
+  TfLiteAttributeMapCopy(user_provided_attributes, merged);
+  if (TfLiteAttributeMapIsSyncAttributeMap(user_provided_attributes)) {
+    const char* type = nullptr;
+    if (TfLiteAttributeMapGetStringAttr(user_provided_attributes, kSyncTypeKey,
+                                        &type) &&
+        !IsSupportedSyncType(type)) {
+      if (conflict) {
+        TfLiteAttributeMapSetStringAttr(conflict, kSyncTypeKey, type);
+      }
+      return false;
+    }
+    return true;
+  }
+  bool reconciled = true;
+  const char* type = nullptr;
+  if (TfLiteAttributeMapGetStringAttr(user_provided_attributes,
+                                      kBufferTypeKey, &type) &&
+      !IsSupportedBufferType(type)) {
+    if (conflict) {
+      TfLiteAttributeMapSetStringAttr(conflict, kBufferTypeKey, type);
+    }
+    reconciled = false;
+  }
+  // The buffer holds at least the tensor.
+  size_t bytes = 0;
+  const size_t tensor_bytes = subgraph_->tensor(tensor_index)->bytes;
+  if (!TfLiteAttributeMapGetSizeTAttr(user_provided_attributes, kSizeKey,
+                                      &bytes) ||
+      bytes < tensor_bytes) {
+    TfLiteAttributeMapSetSizeTAttr(merged, kSizeKey, tensor_bytes);
+  }
+  return reconciled;
+}
+
+TfLiteStatus CpuBackendAsyncKernel::SetAttributes(
+    TfLiteOpaqueContext* context, TfLiteOpaqueNode* node, int tensor_index,
+    const TfLiteAttributeMap* attrs) {
+  const char* type = nullptr;
+  if (TfLiteAttributeMapIsSyncAttributeMap(attrs)) {
+    if (!TfLiteAttributeMapGetStringAttr(attrs, kSyncTypeKey, &type)) {
+      type = kTfLiteSyncTypeNoSyncObj;
+    }
+    if (!IsSupportedSyncType(type)) return kTfLiteError;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (std::strcmp(type, kTfLiteSyncTypeNoSyncObj) == 0) {
+      sync_fence_tensors_.erase(tensor_index);
+    } else {
+      sync_fence_tensors_.insert(tensor_index);
+    }
+    return kTfLiteOk;
+  }
+  if (TfLiteAttributeMapGetStringAttr(attrs, kBufferTypeKey, &type) &&
+      !IsSupportedBufferType(type)) {
+    return kTfLiteError;
+  }
+  size_t bytes = 0;
+  if (TfLiteAttributeMapGetSizeTAttr(attrs, kSizeKey, &bytes) &&
+      bytes < subgraph_->tensor(tensor_index)->bytes) {
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus CpuBackendAsyncKernel::Prepare(TfLiteOpaqueContext* context,
+                                            TfLiteOpaqueNode* node) {
+  return subgraph_->AllocateTensors();
+}
+
+TfLiteStatus CpuBackendAsyncKernel::BindTensor(int tensor_index,
+                                               TfLiteBufferHandle handle,
+                                               std::set<int>* dma_buf_fds) {
+  TfLiteCustomAllocation allocation;
+  if (handle == kTfLiteNullBufferHandle) {
+    if (bound_tensors_.count(tensor_index) == 0) return kTfLiteOk;
+    std::vector<char>& buffer = tensor_buffers_[tensor_index];
+    buffer.resize(subgraph_->tensor(tensor_index)->bytes);
+    allocation = {buffer.data(), buffer.size()};
+  } else {
+    auto it = buffers_.find(handle);
+    if (it == buffers_.end()) {
+      TFLITE_LOG(TFLITE_LOG_ERROR, "Buffer handle %d is not registered.",
+                 handle);
+      return kTfLiteError;
+    }
+    allocation = {it->second.data, it->second.bytes};
+    if (it->second.dma_buf_fd >= 0) dma_buf_fds->insert(it->second.dma_buf_fd);
+    tensor_buffers_.erase(tensor_index);
+    bound_tensors_.insert(tensor_index);
+  }
+  // The CPU kernels don't require the arena alignment of their tensors.
+  return subgraph_->SetCustomAllocationForTensor(
+      tensor_index, allocation, kTfLiteCustomAllocationFlagsSkipAlignCheck);
+}
+
+TfLiteStatus CpuBackendAsyncKernel::Eval(TfLiteOpaqueContext* context,
+                                         TfLiteOpaqueNode* node,
+                                         TfLiteExecutionTask* task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::set<int> dma_buf_fds;
+  TfLiteStatus status = kTfLiteOk;
+  for (int tensor_index : subgraph_->inputs()) {
+    if (tensor_index == kTfLiteOptionalTensor) continue;
+#if defined(__linux__)
+    TfLiteSynchronization* sync = task->task->GetSynchronization(tensor_index);
+    if (sync_fence_tensors_.count(tensor_index) != 0 && sync != nullptr &&
+        TfLiteSynchronizationGetPtr(sync) != nullptr) {
+      // Waits for all the fences, which are owned by the kernel.
+      if (WaitForFence(*static_cast<int*>(TfLiteSynchronizationGetPtr(
+              sync))) != kTfLiteOk) {
+        status = kTfLiteError;
+      }
+    }
+#endif
+    if (status == kTfLiteOk) {
+      status = BindTensor(tensor_index,
+                          task->task->GetBufferHandle(tensor_index),
+                          &dma_buf_fds);
+    }
+  }
+  for (int tensor_index : subgraph_->outputs()) {
+    if (status != kTfLiteOk) break;
+    status = BindTensor(tensor_index, task->task->GetBufferHandle(tensor_index),
+                        &dma_buf_fds);
+  }
+  // Verifies the size of the bound buffers.
+  if (status == kTfLiteOk) status = subgraph_->AllocateTensors();
+  if (status != kTfLiteOk) return status;
+
+#if defined(__linux__)
+  for (int fd : dma_buf_fds) SyncDmaBuf(fd, DMA_BUF_SYNC_START);
+#endif
+  status = subgraph_->Invoke();
+#if defined(__linux__)
+  for (int fd : dma_buf_fds) SyncDmaBuf(fd, DMA_BUF_SYNC_END);
+  // The outputs are ready, as signaled by an invalid fence.
+  for (int tensor_index : subgraph_->outputs()) {
+    TfLiteSynchronization* sync = task->task->GetSynchronization(tensor_index);
+    if (sync_fence_tensors_.count(tensor_index) != 0 && sync != nullptr &&
+        TfLiteSynchronizationGetPtr(sync) != nullptr) {
+      *static_cast<int*>(TfLiteSynchronizationGetPtr(sync)) = -1;
+    }
+  }
+#endif
+  return status;
+}
+
+TfLiteStatus CpuBackendAsyncKernel::Wait(TfLiteOpaqueContext* context,
+                                         TfLiteExecutionTask* task) {
+  // The execution ends within `Eval`.
+  return task->task->Status();
+}
+
+TfLiteStatus CpuBackendAsyncKernel::Finish(TfLiteOpaqueContext* context,
+                                           TfLiteExecutionTask* task) {
+  return kTfLiteOk;
+}
+
+}  // namespace async
+}  // namespace tflite
@@ -0,0 +1,119 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_CORE_ASYNC_CPU_BACKEND_ASYNC_KERNEL_H_
+#define TENSORFLOW_LITE_CORE_ASYNC_CPU_BACKEND_ASYNC_KERNEL_H_
+
+#include <cstddef>
+#include <map>
+#include <mutex>  // NOLINT(build/c++11)
+#include <set>
+#include <vector>
+
+#include "tensorflow/lite/core/c/c_api_types.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/subgraph.h"
+#include "tensorflow/lite/core/async/async_kernel_internal.h"
+#include "tensorflow/lite/core/async/backend_async_kernel_interface.h"
+#include "tensorflow/lite/core/async/common.h"
+
+namespace tflite {
+namespace async {
+
+// The async kernel of the subgraphs not fully delegated to an async backend.
+// It binds the registered buffers to the input and output tensors of the
+// subgraph as custom allocations, so the CPU kernels read and write them
+// without copies, and invokes the subgraph in `Eval`.
+//
+// Supports `kTfLiteBufferTypeHostMemory` buffers, and on Linux
+// `kTfLiteBufferTypeDmaBuf` buffers, which are mapped when registered, and
+// `kTfLiteSyncTypeSyncFence` synchronizations. The input fences are waited on
+// before invoking the subgraph, and the outputs are ready when `Eval` returns.
+//
+// The tensors bound to a buffer in one task and not in a later one are bound
+// to a buffer of the kernel, as their arena memory is not planned anymore.
+class CpuBackendAsyncKernel : public delegates::BackendAsyncKernelInterface {
+ public:
+  explicit CpuBackendAsyncKernel(Subgraph* subgraph);
+  ~CpuBackendAsyncKernel() override;
+
+  TfLiteStatus RegisterBuffer(TfLiteOpaqueContext* context,
+                              TfLiteIoType io_type,
+                              const TfLiteBackendBuffer* buffer,
+                              const TfLiteAttributeMap* attrs,
+                              TfLiteBufferHandle handle) override;
+  TfLiteStatus RegisterBufferSlice(TfLiteOpaqueContext* context,
+                                   TfLiteBufferHandle buffer_pool,
+                                   const TfLiteAttributeMap* attrs,
+                                   TfLiteBufferHandle handle) override;
+  TfLiteStatus UnregisterBuffer(TfLiteOpaqueContext* context,
+                                TfLiteBufferHandle handle) override;
+
+  std::vector<const char*> SupportedBufferTypes(
+      TfLiteIoType io_type) const override;
+  std::vector<const char*> SupportedSynchronizations(
+      TfLiteIoType io_type) const override;
+  bool ReconcileRestrictions(TfLiteOpaqueContext* context,
+                             TfLiteOpaqueNode* node, int tensor_index,
+                             const TfLiteAttributeMap* user_provided_attributes,
+                             TfLiteAttributeMap* merged,
+                             TfLiteAttributeMap* conflict) const override;
+  TfLiteStatus SetAttributes(TfLiteOpaqueContext* context,
+                             TfLiteOpaqueNode* node, int tensor_index,
+                             const TfLiteAttributeMap* attrs) override;
+  TfLiteStatus Prepare(TfLiteOpaqueContext* context,
+                       TfLiteOpaqueNode* node) override;
+
+  TfLiteStatus Eval(TfLiteOpaqueContext* context, TfLiteOpaqueNode* node,
+                    TfLiteExecutionTask* task) override;
+  TfLiteStatus Wait(TfLiteOpaqueContext* context,
+                    TfLiteExecutionTask* task) override;
+  TfLiteStatus Finish(TfLiteOpaqueContext* context,
+                      TfLiteExecutionTask* task) override;
+
+ private:
+  struct Buffer {
+    char* data = nullptr;
+    size_t bytes = 0;
+    // The file descriptor of the mapped dma-buf, or -1.
+    int dma_buf_fd = -1;
+    // The buffer the slice is taken from, or kTfLiteNullBufferHandle.
+    TfLiteBufferHandle pool = kTfLiteNullBufferHandle;
+    int num_slices = 0;
+  };
+
+  // Binds the tensor at `tensor_index` to the buffer of `handle`, or to a
+  // buffer of the kernel if it was bound before and `handle` is null.
+  // Adds the dma-buf of the buffer, if any, to `dma_buf_fds`.
+  TfLiteStatus BindTensor(int tensor_index, TfLiteBufferHandle handle,
+                          std::set<int>* dma_buf_fds);
+
+  // Not owned.
+  Subgraph* subgraph_;
+
+  std::mutex mutex_;
+  std::map<TfLiteBufferHandle, Buffer> buffers_;
+  // The tensors with sync fence synchronizations.
+  std::set<int> sync_fence_tensors_;
+  // The tensors bound to a buffer by the kernel.
+  std::set<int> bound_tensors_;
+  // The buffers of the kernel of the tensors bound to no buffer in the last
+  // task.
+  std::map<int, std::vector<char>> tensor_buffers_;
+};
+
+}  // namespace async
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_CORE_ASYNC_CPU_BACKEND_ASYNC_KERNEL_H_
@@ -0,0 +1,229 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/core/async/cpu_backend_async_kernel.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/lite/core/c/builtin_op_data.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/interpreter.h"
+#include "tensorflow/lite/core/async/async_subgraph.h"
+#include "tensorflow/lite/core/async/interop/attribute_keys.h"
+#include "tensorflow/lite/core/async/interop/c/attribute_map.h"
+#include "tensorflow/lite/core/async/interop/c/constants.h"
+#include "tensorflow/lite/core/async/interop/c/types.h"
+#include "tensorflow/lite/core/async/task_internal.h"
+#include "tensorflow/lite/kernels/builtin_op_kernels.h"
+
+namespace tflite {
+namespace async {
+namespace {
+
+constexpr uint32_t kBufferTypeKey = static_cast<uint32_t>(
+    TfLiteBufferAttributeKey::kBufferResourceTypeName);
+constexpr uint32_t kSizeKey =
+    static_cast<uint32_t>(TfLiteBufferAttributeKey::kSize);
+constexpr size_t kTensorBytes = 4 * sizeof(float);
+
+class CpuBackendAsyncKernelTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    interpreter_ = std::make_unique<Interpreter>();
+    interpreter_->AddTensors(3);
+    interpreter_->SetInputs({0, 1});
+    interpreter_->SetOutputs({2});
+    TfLiteQuantizationParams quant;
+    for (int i = 0; i < 3; ++i) {
+      interpreter_->SetTensorParametersReadWrite(i, kTfLiteFloat32, "", {4},
+                                                 quant);
+    }
+    auto* params =
+        reinterpret_cast<TfLiteAddParams*>(malloc(sizeof(TfLiteAddParams)));
+    params->activation = kTfLiteActNone;
+    params->pot_scale_int16 = false;
+    interpreter_->AddNodeWithParameters({0, 1}, {2}, nullptr, 0, params,
+                                        ops::builtin::Register_ADD());
+    subgraph_ = std::make_unique<AsyncSubgraph>(interpreter_->subgraph(0));
+  }
+
+  void TearDown() override {
+    subgraph_.reset();
+    for (auto* buffer : buffers_) TfLiteBackendBufferDelete(buffer);
+  }
+
+  TfLiteBufferHandle Register(TfLiteIoType io_type, float* data) {
+    auto* buffer = TfLiteBackendBufferCreate();
+    buffers_.push_back(buffer);
+    TfLiteBackendBufferSetPtr(buffer, data);
+    auto* attrs = TfLiteAttributeMapCreate(kTfLiteBufferAttrMap);
+    TfLiteAttributeMapSetStringAttr(attrs, kBufferTypeKey,
+                                    kTfLiteBufferTypeHostMemory);
+    TfLiteAttributeMapSetSizeTAttr(attrs, kSizeKey, kTensorBytes);
+    TfLiteBufferHandle handle = kTfLiteNullBufferHandle;
+    EXPECT_EQ(kTfLiteOk,
+              subgraph_->RegisterBuffer(io_type, buffer, attrs, &handle));
+    TfLiteAttributeMapDelete(attrs);
+    return handle;
+  }
+
+  TfLiteExecutionTask* CreateTask() {
+    auto* task = subgraph_->CreateTask();
+    task->task->SetInputNameMap(&input_names_);
+    task->task->SetOutputNameMap(&output_names_);
+    return task;
+  }
+
+  std::unique_ptr<Interpreter> interpreter_;
+  std::unique_ptr<AsyncSubgraph> subgraph_;
+  std::vector<TfLiteBackendBuffer*> buffers_;
+  const ExecutionTask::TensorNameMapT input_names_ = {{"x", 0}, {"y", 1}};
+  const ExecutionTask::TensorNameMapT output_names_ = {{"z", 2}};
+};
+
+TEST_F(CpuBackendAsyncKernelTest, SupportsHostMemory) {
+  EXPECT_THAT(subgraph_->SupportedBufferTypes(kTfLiteIoInput),
+              ::testing::Contains(::testing::StrEq(
+                  kTfLiteBufferTypeHostMemory)));
+  EXPECT_THAT(subgraph_->SupportedSynchronizations(kTfLiteIoOutput),
+              ::testing::Contains(::testing::StrEq(kTfLiteSyncTypeNoSyncObj)));
+}
+
+TEST_F(CpuBackendAsyncKernelTest, ReconcilesBufferSize) {
+  ASSERT_EQ(kTfLiteOk, interpreter_->AllocateTensors());
+  auto* attrs = TfLiteAttributeMapCreate(kTfLiteBufferAttrMap);
+  auto* merged = TfLiteAttributeMapCreate(kTfLiteBufferAttrMap);
+  auto* conflict = TfLiteAttributeMapCreate(kTfLiteBufferAttrMap);
+  TfLiteAttributeMapSetStringAttr(attrs, kBufferTypeKey,
+                                  kTfLiteBufferTypeHostMemory);
+  TfLiteAttributeMapSetSizeTAttr(attrs, kSizeKey, 1);
+  EXPECT_TRUE(subgraph_->ReconcileRestrictions(0, attrs, merged, conflict));
+  size_t size = 0;
+  EXPECT_TRUE(TfLiteAttributeMapGetSizeTAttr(merged, kSizeKey, &size));
+  EXPECT_EQ(size, kTensorBytes);
+  EXPECT_EQ(kTfLiteError, subgraph_->SetAttributes(0, attrs));
+  EXPECT_EQ(kTfLiteOk, subgraph_->SetAttributes(0, merged));
+
+  TfLiteAttributeMapSetStringAttr(attrs, kBufferTypeKey, "unknown");
+  EXPECT_FALSE(subgraph_->ReconcileRestrictions(0, attrs, merged, conflict));
+  const char* type = nullptr;
+  EXPECT_TRUE(TfLiteAttributeMapGetStringAttr(conflict, kBufferTypeKey, &type));
+  EXPECT_STREQ(type, "unknown");
+
+  TfLiteAttributeMapDelete(attrs);
+  TfLiteAttributeMapDelete(merged);
+  TfLiteAttributeMapDelete(conflict);
+}
+
+TEST_F(CpuBackendAsyncKernelTest, InvokesWithoutCopies) {
+  alignas(64) float x[4] = {1, 2, 3, 4};
+  alignas(64) float y[4] = {10, 20, 30, 40};
+  alignas(64) float z[4] = {};
+  const TfLiteBufferHandle x_handle = Register(kTfLiteIoInput, x);
+  const TfLiteBufferHandle y_handle = Register(kTfLiteIoInput, y);
+  const TfLiteBufferHandle z_handle = Register(kTfLiteIoOutput, z);
+  ASSERT_EQ(kTfLiteOk, subgraph_->Prepare());
+
+  auto* task = CreateTask();
+  ASSERT_EQ(kTfLiteOk, task->task->SetBufferHandle(kTfLiteIoInput, "x",
+                                                   x_handle));
+  ASSERT_EQ(kTfLiteOk, task->task->SetBufferHandle(kTfLiteIoInput, "y",
+                                                   y_handle));
+  ASSERT_EQ(kTfLiteOk, task->task->SetBufferHandle(kTfLiteIoOutput, "z",
+                                                   z_handle));
+  ASSERT_EQ(kTfLiteOk, subgraph_->InvokeAsync(task));
+  ASSERT_EQ(kTfLiteOk, subgraph_->Wait(task));
+  EXPECT_THAT(z, ::testing::ElementsAre(11, 22, 33, 44));
+  EXPECT_EQ(interpreter_->tensor(0)->data.f, x);
+  EXPECT_EQ(interpreter_->tensor(2)->data.f, z);
+  EXPECT_EQ(kTfLiteOk, subgraph_->Finish(task));
+
+  // The output is not written to the buffer of the last task.
+  x[0] = 5;
+  task = CreateTask();
+  ASSERT_EQ(kTfLiteOk, task->task->SetBufferHandle(kTfLiteIoInput, "x",
+                                                   x_handle));
+  ASSERT_EQ(kTfLiteOk, task->task->SetBufferHandle(kTfLiteIoInput, "y",
+                                                   y_handle));
+  ASSERT_EQ(kTfLiteOk, subgraph_->InvokeAsync(task));
+  ASSERT_EQ(kTfLiteOk, subgraph_->Wait(task));
+  EXPECT_THAT(z, ::testing::ElementsAre(11, 22, 33, 44));
+  EXPECT_NE(interpreter_->tensor(2)->data.f, z);
+  EXPECT_EQ(interpreter_->tensor(2)->data.f[0], 15);
+  EXPECT_EQ(kTfLiteOk, subgraph_->Finish(task));
+
+  EXPECT_EQ(kTfLiteOk, subgraph_->UnregisterBuffer(x_handle));
+  EXPECT_EQ(kTfLiteOk, subgraph_->UnregisterBuffer(y_handle));
+  EXPECT_EQ(kTfLiteOk, subgraph_->UnregisterBuffer(z_handle));
+}
+
+TEST_F(CpuBackendAsyncKernelTest, InvokesWithBufferSlices) {
+  alignas(64) float pool[8] = {1, 2, 3, 4, 10, 20, 30, 40};
+  alignas(64) float z[4] = {};
+  auto* buffer = TfLiteBackendBufferCreate();
+  buffers_.push_back(buffer);
+  TfLiteBackendBufferSetPtr(buffer, pool);
+  auto* attrs = TfLiteAttributeMapCreate(kTfLiteBufferAttrMap);
+  TfLiteAttributeMapSetStringAttr(attrs, kBufferTypeKey,
+                                  kTfLiteBufferTypeHostMemory);
+  TfLiteAttributeMapSetSizeTAttr(attrs, kSizeKey, sizeof(pool));
+  TfLiteBufferHandle pool_handle;
+  ASSERT_EQ(kTfLiteOk, subgraph_->RegisterBuffer(kTfLiteIoInput, buffer, attrs,
+                                                 &pool_handle));
+  TfLiteBufferHandle x_handle;
+  TfLiteBufferHandle y_handle;
+  TfLiteAttributeMapSetSizeTAttr(attrs, kSizeKey, kTensorBytes);
+  const uint32_t offset_key =
+      static_cast<uint32_t>(TfLiteBufferAttributeKey::kOffset);
+  TfLiteAttributeMapSetSizeTAttr(attrs, offset_key, 0);
+  ASSERT_EQ(kTfLiteOk,
+            subgraph_->RegisterBufferSlice(pool_handle, attrs, &x_handle));
+  TfLiteAttributeMapSetSizeTAttr(attrs, offset_key, kTensorBytes);
+  ASSERT_EQ(kTfLiteOk,
+            subgraph_->RegisterBufferSlice(pool_handle, attrs, &y_handle));
+  // The slice must be within the pool.
+  TfLiteBufferHandle out_of_bounds_handle;
+  TfLiteAttributeMapSetSizeTAttr(attrs, offset_key, sizeof(pool));
+  EXPECT_EQ(kTfLiteError, subgraph_->RegisterBufferSlice(
+                              pool_handle, attrs, &out_of_bounds_handle));
+  TfLiteAttributeMapDelete(attrs);
+  const TfLiteBufferHandle z_handle = Register(kTfLiteIoOutput, z);
+  ASSERT_EQ(kTfLiteOk, subgraph_->Prepare());
+
+  auto* task = CreateTask();
+  task->task->SetBufferHandle(kTfLiteIoInput, "x", x_handle);
+  task->task->SetBufferHandle(kTfLiteIoInput, "y", y_handle);
+  task->task->SetBufferHandle(kTfLiteIoOutput, "z", z_handle);
+  ASSERT_EQ(kTfLiteOk, subgraph_->InvokeAsync(task));
+  ASSERT_EQ(kTfLiteOk, subgraph_->Wait(task));
+  EXPECT_THAT(z, ::testing::ElementsAre(11, 22, 33, 44));
+  EXPECT_EQ(kTfLiteOk, subgraph_->Finish(task));
+
+  // The pool outlives its slices.
+  EXPECT_EQ(kTfLiteError, subgraph_->UnregisterBuffer(pool_handle));
+  EXPECT_EQ(kTfLiteOk, subgraph_->UnregisterBuffer(x_handle));
+  EXPECT_EQ(kTfLiteOk, subgraph_->UnregisterBuffer(y_handle));
+  EXPECT_EQ(kTfLiteOk, subgraph_->UnregisterBuffer(pool_handle));
+}
+
+}  // namespace
+}  // namespace async
+}  // namespace tflite
@@ -17,5 +17,8 @@ limitations under the License.
 extern "C" {
 
 const char kTfLiteSyncTypeNoSyncObj[] = "no_sync_obj";
+const char kTfLiteSyncTypeSyncFence[] = "sync_fence";
+const char kTfLiteBufferTypeHostMemory[] = "host_memory";
+const char kTfLiteBufferTypeDmaBuf[] = "dma_buf";
 
 }  // extern "C"
@@ -38,6 +38,29 @@ extern "C" {
 /// output tensor must be ready when AsyncSignatureRunner::Wait returns.
 TFL_CAPI_EXPORT extern const char kTfLiteSyncTypeNoSyncObj[];  // "no_sync_obj"
 
+/// Synchronization type name of Linux sync fences.
+///
+/// The synchronization object is a pointer to the `int` file descriptor of the
+/// fence. The backend closes the fences of the input tensors once signaled.
+/// For output tensors, the backend sets the file descriptor of a fence
+/// signaled when the output is ready, or -1 if it is already ready, and the
+/// user closes it.
+TFL_CAPI_EXPORT extern const char kTfLiteSyncTypeSyncFence[];  // "sync_fence"
+
+/// Buffer type name of host memory.
+///
+/// The buffer object is the address of the memory, which must hold the
+/// `kSize` bytes set in the buffer attributes.
+TFL_CAPI_EXPORT extern const char kTfLiteBufferTypeHostMemory[];
+// "host_memory"
+
+/// Buffer type name of Linux dma-bufs, e.g. exported from an AHardwareBuffer
+/// or a camera or video buffer.
+///
+/// The buffer object is a pointer to the `int` file descriptor of the dma-buf,
+/// of the `kSize` bytes set in the buffer attributes.
+TFL_CAPI_EXPORT extern const char kTfLiteBufferTypeDmaBuf[];  // "dma_buf"
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
@@ -270,6 +270,14 @@ class Interpreter {
     return primary_subgraph().execution_plan();
   }
 
+  /// Returns the number of invocations the outputs lag the inputs by when
+  /// the delegated and CPU partitions are pipelined, see
+  /// `InterpreterOptions::SetPipelineDelegatePartitions()`, 0 otherwise.
+  /// \warning Experimental interface, subject to change.
+  int pipeline_latency() const {
+    return primary_subgraph().pipeline_latency();
+  }
+
   /// Get a mutable tensor data structure.
   // TODO(aselle): Create a safe ArrayHandle interface to avoid exposing this
   // read/write access to structure
@@ -734,6 +742,14 @@ class Interpreter {
   /// \brief Apply InterpreterOptions which tunes behavior of the interpreter.
   TfLiteStatus ApplyOptions(InterpreterOptions* options);
 
+  /// \warning This is an experimental API and subject to change. \n
+  /// \brief Makes the kernels repacking their constant weights map them from
+  /// `cache` when it holds them, and add them to it otherwise, for
+  /// `PackedWeightsCache::Flush()` to write them for the next interpreters.
+  /// The cache is set on the current CPU backend context, and must outlive
+  /// the interpreter. Must be called before `AllocateTensors()`.
+  void SetPackedWeightsCache(PackedWeightsCache* cache);
+
 #ifndef DOXYGEN_SKIP
   /// \warning This is an experimental API and subject to change. \n
   /// \brief Return the number of subgraphs in the model.
@@ -141,6 +141,14 @@ TfLiteStatus Interpreter::ApplyOptions(InterpreterOptions* options) {
   return ApplyOptionsImpl(options);
 }
 
+void Interpreter::SetPackedWeightsCache(PackedWeightsCache* cache) {
+  auto* external_context = static_cast<ExternalCpuBackendContext*>(
+      external_contexts_[kTfLiteCpuBackendContext]);
+  if (external_context != nullptr) {
+    external_context->set_packed_weights_cache(cache);
+  }
+}
+
 SignatureRunner* Interpreter::GetSignatureRunner(const char* signature_key) {
   auto iter = signature_runner_map_.find(signature_key);
   if (iter != signature_runner_map_.end()) {
@@ -25,6 +25,7 @@ namespace ops {
 namespace custom {
 
 TfLiteRegistration* Register_NUMERIC_VERIFY();
+TfLiteRegistration* Register_ASSIGN_VARIABLE_SLICE();
 TfLiteRegistration* Register_AUDIO_SPECTROGRAM();
 TfLiteRegistration* Register_MFCC();
 TfLiteRegistration* Register_DETECTION_POSTPROCESS();
@@ -356,6 +357,8 @@ BuiltinOpResolver::BuiltinOpResolver() {
              /* min_version = */ 1,
              /* max_version = */ 2);
   AddCustom("NumericVerify", tflite::ops::custom::Register_NUMERIC_VERIFY());
+  AddCustom("AssignVariableSlice",
+            tflite::ops::custom::Register_ASSIGN_VARIABLE_SLICE());
   // TODO(andrewharp, ahentz): Move these somewhere more appropriate so that
   // custom ops aren't always included by default.
   AddCustom("Mfcc", tflite::ops::custom::Register_MFCC());
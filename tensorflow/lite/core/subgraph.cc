@@ -20,12 +20,16 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>  // NOLINT(build/c++11)
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -42,6 +46,7 @@ limitations under the License.
 #include "tensorflow/lite/core/macros.h"
 #include "tensorflow/lite/experimental/remat/metadata_util.h"
 #include "tensorflow/lite/experimental/resource/resource_base.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/graph_info.h"
 #include "tensorflow/lite/memory_planner.h"
 #include "tensorflow/lite/minimal_logging.h"
@@ -70,6 +75,31 @@ struct TfLiteQuantizationDeleter {
 using ScopedTfLiteQuantization =
     std::unique_ptr<TfLiteQuantization, TfLiteQuantizationDeleter>;
 
+// Returns a copy of `quantization` owning its parameters.
+TfLiteQuantization CopyQuantization(const TfLiteQuantization& quantization) {
+  TfLiteQuantization copy = {kTfLiteNoQuantization, nullptr};
+  if (quantization.type != kTfLiteAffineQuantization ||
+      quantization.params == nullptr) {
+    return copy;
+  }
+  const auto* params =
+      static_cast<const TfLiteAffineQuantization*>(quantization.params);
+  auto* copy_params = static_cast<TfLiteAffineQuantization*>(
+      malloc(sizeof(TfLiteAffineQuantization)));
+  copy_params->scale = nullptr;
+  if (params->scale) {
+    copy_params->scale = TfLiteFloatArrayCreate(params->scale->size);
+    std::memcpy(copy_params->scale->data, params->scale->data,
+                params->scale->size * sizeof(float));
+  }
+  copy_params->zero_point =
+      params->zero_point ? TfLiteIntArrayCopy(params->zero_point) : nullptr;
+  copy_params->quantized_dimension = params->quantized_dimension;
+  copy.type = kTfLiteAffineQuantization;
+  copy.params = copy_params;
+  return copy;
+}
+
 struct TfLiteSparsityDeleter {
   void operator()(TfLiteSparsity* s) {
     if (s) TfLiteSparsityFree(s);
@@ -247,6 +277,102 @@ class InterpreterInfo : public GraphInfo {
   Subgraph* subgraph_;
 };
 
+namespace {
+// The pool whose workers the current thread belongs to, if any, and the CPU
+// backend context of the worker.
+thread_local const InterOpThreadPool* current_inter_op_thread_pool = nullptr;
+thread_local TfLiteExternalContext* current_cpu_backend_context = nullptr;
+}  // namespace
+
+// Runs the nodes of a level with the calling thread. Each worker has a CPU
+// backend context of its own, as the ones of the kernels are not thread-safe.
+class InterOpThreadPool {
+ public:
+  explicit InterOpThreadPool(int num_workers) {
+    for (int i = 0; i < num_workers; ++i) {
+      cpu_backend_contexts_.push_back(
+          std::make_unique<ExternalCpuBackendContext>());
+    }
+    for (int i = 0; i < num_workers; ++i) {
+      workers_.emplace_back(
+          [this, i] { WorkerLoop(cpu_backend_contexts_[i].get()); });
+    }
+  }
+
+  ~InterOpThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  int num_workers() const { return workers_.size(); }
+
+  // Runs `task(i)` for each `i` in [0, num_tasks) on the workers and the
+  // calling thread, and returns once they are all done.
+  void ParallelFor(int num_tasks, const std::function<void(int)>& task) {
+    std::unique_lock<std::mutex> lock(mu_);
+    task_ = &task;
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    num_done_ = 0;
+    work_cv_.notify_all();
+    RunTasks(lock);
+    done_cv_.wait(lock, [this] { return num_done_ == num_tasks_; });
+    task_ = nullptr;
+  }
+
+  // Returns the CPU backend context of the current thread if it is a worker
+  // of this pool, nullptr otherwise.
+  TfLiteExternalContext* CurrentCpuBackendContext() const {
+    return current_inter_op_thread_pool == this ? current_cpu_backend_context
+                                                : nullptr;
+  }
+
+ private:
+  void WorkerLoop(ExternalCpuBackendContext* cpu_backend_context) {
+    current_inter_op_thread_pool = this;
+    current_cpu_backend_context = cpu_backend_context;
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+      work_cv_.wait(lock, [this] {
+        return stopping_ || (task_ != nullptr && next_task_ < num_tasks_);
+      });
+      if (stopping_) break;
+      RunTasks(lock);
+    }
+    current_inter_op_thread_pool = nullptr;
+    current_cpu_backend_context = nullptr;
+  }
+
+  // Runs the tasks left, with `lock` held between them.
+  void RunTasks(std::unique_lock<std::mutex>& lock) {
+    while (task_ != nullptr && next_task_ < num_tasks_) {
+      const int task_index = next_task_++;
+      const std::function<void(int)>* task = task_;
+      lock.unlock();
+      (*task)(task_index);
+      lock.lock();
+      if (++num_done_ == num_tasks_) done_cv_.notify_all();
+    }
+  }
+
+  std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(int)>* task_ = nullptr;
+  int num_tasks_ = 0;
+  int next_task_ = 0;
+  int num_done_ = 0;
+  bool stopping_ = false;
+  std::vector<std::unique_ptr<ExternalCpuBackendContext>> cpu_backend_contexts_;
+  std::vector<std::thread> workers_;
+};
+
 Subgraph::Subgraph(ErrorReporter* error_reporter,
                    TfLiteExternalContext** external_contexts,
                    std::vector<std::unique_ptr<Subgraph>>* subgraphs,
@@ -587,6 +713,14 @@ TfLiteStatus Subgraph::ReplaceNodeSubsetsWithDelegateKernels(
 
 TfLiteExternalContext* Subgraph::GetExternalContext(
     TfLiteExternalContextType type) {
+  // The kernels run by the workers of the pool use the CPU backend contexts
+  // of the workers.
+  if (type == kTfLiteCpuBackendContext && inter_op_thread_pool_) {
+    if (TfLiteExternalContext* worker_context =
+            inter_op_thread_pool_->CurrentCpuBackendContext()) {
+      return worker_context;
+    }
+  }
   if (static_cast<int>(type) >= 0 && type < kTfLiteMaxExternalContexts) {
     return external_contexts_[type];
   }
@@ -876,8 +1010,28 @@ TfLiteStatus Subgraph::AllocateTensors() {
   if (memory_planner_) {
     TF_LITE_ENSURE_STATUS(memory_planner_->ResetAllocations());
   }
-
-  TF_LITE_ENSURE_STATUS(PrepareOpsAndTensors());
+  TearDownPipeline();
+  TF_LITE_ENSURE_STATUS(ScheduleConcurrentNodes());
+  TF_LITE_ENSURE_STATUS(SchedulePipelineStages());
+  kernels_warmed_up_ = false;
+
+  // When only inputs were resized since the ops were last prepared, only the
+  // ops whose inputs changed shape are prepared again. The models with
+  // dynamic tensors keep preparing their ops while invoked, so they prepare
+  // them all.
+  if (ShouldPrepareOnlyAffectedOps() && only_inputs_resized_ &&
+      !has_dynamic_tensors_) {
+    changed_tensors_.assign(tensors_.size(), false);
+    for (int tensor_index : resized_inputs_) {
+      changed_tensors_[tensor_index] = true;
+    }
+  }
+  only_inputs_resized_ = false;
+  const TfLiteStatus prepare_status = PrepareOpsAndTensors();
+  changed_tensors_.clear();
+  TF_LITE_ENSURE_STATUS(prepare_status);
+  resized_inputs_.clear();
+  only_inputs_resized_ = true;
 
   state_ = kStateInvokable;
 
@@ -912,7 +1066,7 @@ TfLiteStatus Subgraph::AllocateTensors() {
       }
     }
   }
-  return kTfLiteOk;
+  return SetUpPipeline();
 }
 
 // TODO(b/115961645): Support non-zero default values.
@@ -949,6 +1103,7 @@ TfLiteStatus Subgraph::AddNodeWithParameters(
     return kTfLiteError;
   }
   state_ = kStateUninvokable;
+  only_inputs_resized_ = false;
 
   TF_LITE_ENSURE_OK(&context_, CheckTensorIndices("node inputs", inputs.data(),
                                                   inputs.size()));
@@ -1065,7 +1220,9 @@ TfLiteStatus Subgraph::ResizeInputTensor(int tensor_index,
     // Undo delegation if it resulted in the graph being immutable.
     TF_LITE_ENSURE_STATUS(UndoAllDelegates());
   }
+  TearDownPipeline();
   state_ = kStateUninvokable;
+  resized_inputs_.push_back(tensor_index);
   return ResizeTensorImpl(tensor, ConvertVectorToTfLiteIntArray(dims));
 }
 
@@ -1109,6 +1266,7 @@ TfLiteStatus Subgraph::ReleaseNonPersistentMemory() {
 
 TfLiteStatus Subgraph::ReleaseMemory() {
   state_ = kStateUninvokable;
+  only_inputs_resized_ = false;
   ReleaseNonPersistentMemory();
 
   // Free dynamic input tensors.
@@ -1243,6 +1401,26 @@ TfLiteStatus Subgraph::PrepareOpsStartingAt(
     const TfLiteRegistration& registration =
         nodes_and_registration_[node_index].second;
     EnsureTensorsVectorCapacity();
+    if (!changed_tensors_.empty() && !NodeInputsChanged(node) &&
+        !OpMightHaveSideEffect(&node, &registration)) {
+      // The op was prepared for the same input shapes already.
+      *last_execution_plan_index_prepared = execution_plan_index;
+      continue;
+    }
+    // The output shapes before preparing the op, to tell the ops reading them
+    // whether they changed.
+    std::vector<std::vector<int>> output_dims;
+    if (!changed_tensors_.empty()) {
+      output_dims.resize(node.outputs->size);
+      for (int i = 0; i < node.outputs->size; ++i) {
+        const int tensor_index = node.outputs->data[i];
+        if (tensor_index == kTfLiteOptionalTensor) continue;
+        const TfLiteIntArray* dims = tensors_[tensor_index].dims;
+        if (dims != nullptr) {
+          output_dims[i].assign(dims->data, dims->data + dims->size);
+        }
+      }
+    }
 #ifdef TF_LITE_TENSORFLOW_PROFILER
     tflite::OnTfLiteOpPrepare(GetTFLiteOpName(registration), subgraph_index_,
                               node_index);
@@ -1253,6 +1431,20 @@ TfLiteStatus Subgraph::PrepareOpsStartingAt(
                     "failed to prepare");
       return op_prepare_status;
     }
+    if (!changed_tensors_.empty()) {
+      EnsureTensorsVectorCapacity();
+      changed_tensors_.resize(tensors_.size(), true);
+      for (int i = 0; i < node.outputs->size; ++i) {
+        const int tensor_index = node.outputs->data[i];
+        if (tensor_index == kTfLiteOptionalTensor) continue;
+        const TfLiteIntArray* dims = tensors_[tensor_index].dims;
+        if (dims == nullptr ||
+            !EqualArrayAndTfLiteIntArray(dims, output_dims[i].size(),
+                                         output_dims[i].data())) {
+          changed_tensors_[tensor_index] = true;
+        }
+      }
+    }
 
     *last_execution_plan_index_prepared = execution_plan_index;
 
@@ -1267,15 +1459,47 @@ TfLiteStatus Subgraph::PrepareOpsStartingAt(
   return kTfLiteOk;
 }
 
+bool Subgraph::NodeInputsChanged(const TfLiteNode& node) const {
+  for (int i = 0; i < node.inputs->size; ++i) {
+    const int tensor_index = node.inputs->data[i];
+    if (tensor_index != kTfLiteOptionalTensor &&
+        (tensor_index >= changed_tensors_.size() ||
+         changed_tensors_[tensor_index])) {
+      return true;
+    }
+  }
+  return false;
+}
+
 TfLiteStatus Subgraph::PrepareOpsAndTensors() {
   if (!memory_planner_) {
 #ifdef TFLITE_USE_SIMPLE_MEMORY_PLANNER
     memory_planner_.reset(new SimplePlanner(&context_, CreateGraphInfo()));
 #else
-    memory_planner_ = std::make_unique<ArenaPlanner>(
+    auto arena_planner = std::make_unique<ArenaPlanner>(
         &context_, CreateGraphInfo(), ShouldPreserveAllTensors(),
         kDefaultTensorAlignment, subgraph_index_);
+    // The other subgraphs, like the bodies of control flow ops, run while the
+    // tensors of the primary one are in use, so they keep arenas of their own.
+    if (subgraph_index_ == 0 && options_ &&
+        options_->GetSharedMemoryArena() != nullptr) {
+      arena_planner->UseSharedArena(options_->GetSharedMemoryArena());
+    }
+    if (options_ && options_->GetArenaPlacementSearch()) {
+      arena_planner->EnablePlacementSearch();
+    }
+    memory_planner_ = std::move(arena_planner);
 #endif
+    if (!concurrent_node_groups_.empty() &&
+        memory_planner_->SetConcurrentNodeGroups(concurrent_node_groups_) !=
+            kTfLiteOk) {
+      concurrent_node_groups_.clear();
+    }
+    if (!pipeline_stages_.empty() &&
+        memory_planner_->SetConcurrentNodeGroups(
+            std::vector<int>(execution_plan_.size(), 0)) != kTfLiteOk) {
+      pipeline_stages_.clear();
+    }
     memory_planner_->PlanAllocations();
   }
 
@@ -1396,7 +1620,10 @@ TfLiteStatus Subgraph::InvokeImpl() {
     ReportError("Invoke called on model that is not ready.");
     return kTfLiteError;
   } else if (memory_planner_ && !memory_planner_->HasNonPersistentMemory()) {
-    ReportError("Non-persistent memory is not available.");
+    // E.g. it was released, or taken by another interpreter sharing the arena.
+    ReportError(
+        "Non-persistent memory is not available, AllocateTensors() has to be "
+        "called first.");
     return kTfLiteError;
   }
   TFLITE_SCOPED_TAGGED_DEFAULT_PROFILE(profiler_.get(), "Invoke");
@@ -1405,6 +1632,15 @@ TfLiteStatus Subgraph::InvokeImpl() {
       tflite::OnTfLiteSubgraphInvoke(name_.c_str(), subgraph_index_);
 #endif  // TF_LITE_TENSORFLOW_PROFILER
 
+  if (pipelined_tensors_active_ || ShouldInvokeConcurrently()) {
+    status = pipelined_tensors_active_ ? InvokePipelined()
+                                       : InvokeConcurrently();
+#ifdef TF_LITE_TENSORFLOW_PROFILER
+    tflite::OnTfLiteSubgraphInvokeEnd(trace_subgraph);
+#endif  // TF_LITE_TENSORFLOW_PROFILER
+    return status;
+  }
+
   // Invocations are always done in node order.
   // Note that calling Invoke repeatedly will cause the original memory plan to
   // be reused, unless either ResizeInputTensor() or AllocateTensors() has been
@@ -1520,12 +1756,482 @@ TfLiteStatus Subgraph::InvokeImpl() {
     tflite::OnTfLiteOpInvokeEnd(trace_op);
 #endif  // TF_LITE_TENSORFLOW_PROFILER
   }
+  kernels_warmed_up_ = true;
+  warmed_up_num_threads_ = context_.recommended_num_threads;
 #ifdef TF_LITE_TENSORFLOW_PROFILER
   tflite::OnTfLiteSubgraphInvokeEnd(trace_subgraph);
 #endif  // TF_LITE_TENSORFLOW_PROFILER
   return status;
 }
 
+TfLiteStatus Subgraph::ScheduleConcurrentNodes() {
+  if (NumInterOpThreads() <= 1 && concurrent_node_groups_.empty()) {
+    return kTfLiteOk;
+  }
+  std::vector<int> execution_plan = execution_plan_;
+  std::vector<int> group_of_node;
+  // The primary subgraph only, as the others may run on the workers, and
+  // without the delegates, whose kernels may not run concurrently.
+  if (NumInterOpThreads() > 1 && subgraph_index_ == 0 &&
+      delegates_applied_.empty()) {
+    // The first level from which each tensor may be read.
+    std::vector<int> ready_level(tensors_.size(), 0);
+    std::vector<int> level(execution_plan_.size());
+    int min_level = 0;
+    int max_level = -1;
+    for (int i = 0; i < execution_plan_.size(); ++i) {
+      const auto& node_and_registration =
+          nodes_and_registration_[execution_plan_[i]];
+      const TfLiteNode& node = node_and_registration.first;
+      bool runs_alone =
+          OpMightHaveSideEffect(&node, &node_and_registration.second);
+      level[i] = min_level;
+      for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+        if (tensor_index == kTfLiteOptionalTensor) continue;
+        level[i] = std::max(level[i], ready_level[tensor_index]);
+        runs_alone |= tensors_[tensor_index].is_variable;
+      }
+      if (runs_alone) {
+        // After all the earlier nodes, and before all the later ones.
+        level[i] = max_level + 1;
+        min_level = level[i] + 1;
+      }
+      for (int tensor_index : TfLiteIntArrayView(node.outputs)) {
+        if (tensor_index == kTfLiteOptionalTensor) continue;
+        ready_level[tensor_index] = level[i] + 1;
+      }
+      max_level = std::max(max_level, level[i]);
+    }
+    std::vector<int> order(execution_plan_.size());
+    for (int i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&level](int a, int b) { return level[a] < level[b]; });
+    group_of_node.resize(order.size());
+    for (int i = 0; i < order.size(); ++i) {
+      execution_plan[i] = execution_plan_[order[i]];
+      group_of_node[i] = level[order[i]];
+    }
+  }
+  if (execution_plan == execution_plan_ &&
+      group_of_node == concurrent_node_groups_) {
+    return kTfLiteOk;
+  }
+  // Unless the planner can keep the tensors of the nodes of a level apart, the
+  // nodes are run one by one.
+  if (memory_planner_ &&
+      memory_planner_->SetConcurrentNodeGroups(group_of_node) != kTfLiteOk) {
+    concurrent_node_groups_.clear();
+    return kTfLiteOk;
+  }
+  execution_plan_ = std::move(execution_plan);
+  concurrent_node_groups_ = std::move(group_of_node);
+  if (memory_planner_) {
+    TF_LITE_ENSURE_STATUS(memory_planner_->PlanAllocations());
+  }
+  return kTfLiteOk;
+}
+
+bool Subgraph::ShouldInvokeConcurrently() const {
+  // The per op profiling is not thread-safe, and the dynamic tensors are
+  // allocated and the ops reading them prepared while invoking.
+  return !concurrent_node_groups_.empty() && kernels_warmed_up_ &&
+         warmed_up_num_threads_ == context_.recommended_num_threads &&
+         concurrent_node_groups_.size() == execution_plan_.size() &&
+         !has_dynamic_tensors_ && profiler_ == nullptr &&
+         next_execution_plan_index_to_prepare_ == execution_plan_.size();
+}
+
+TfLiteStatus Subgraph::InvokeConcurrently() {
+  const int num_workers = NumInterOpThreads() - 1;
+  if (!inter_op_thread_pool_ ||
+      inter_op_thread_pool_->num_workers() != num_workers) {
+    inter_op_thread_pool_ = std::make_unique<InterOpThreadPool>(num_workers);
+  }
+  std::vector<TfLiteStatus> statuses;
+  const int num_nodes = execution_plan_.size();
+  for (int group_begin = 0; group_begin < num_nodes;) {
+    int group_end = group_begin + 1;
+    while (group_end < num_nodes && concurrent_node_groups_[group_end] ==
+                                        concurrent_node_groups_[group_begin]) {
+      ++group_end;
+    }
+    if (check_cancelled_func_ != nullptr &&
+        check_cancelled_func_(cancellation_data_)) {
+      ReportError("Client requested cancel during Invoke()");
+      return kTfLiteError;
+    }
+    if (continue_invocation_ && !continue_invocation_->test_and_set()) {
+      // `Cancel` is called and cancellation flag is flipped.
+      ReportError("Client requested cancel during Invoke()");
+      return kTfLiteCancelled;
+    }
+    // The tensors may only move between the levels.
+    EnsureTensorsVectorCapacity();
+    if (group_end - group_begin == 1) {
+      TF_LITE_ENSURE_STATUS(InvokeNode(group_begin));
+    } else {
+      statuses.assign(group_end - group_begin, kTfLiteOk);
+      inter_op_thread_pool_->ParallelFor(
+          group_end - group_begin, [this, group_begin, &statuses](int i) {
+            statuses[i] = InvokeNode(group_begin + i);
+          });
+      for (TfLiteStatus status : statuses) {
+        TF_LITE_ENSURE_STATUS(status);
+      }
+    }
+    group_begin = group_end;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::InvokeNode(int execution_plan_index) {
+  const int node_index = execution_plan_[execution_plan_index];
+  TfLiteNode& node = nodes_and_registration_[node_index].first;
+  const TfLiteRegistration& registration =
+      nodes_and_registration_[node_index].second;
+  for (int i = 0; i < node.inputs->size; ++i) {
+    const int tensor_index = node.inputs->data[i];
+    if (tensor_index == kTfLiteOptionalTensor) {
+      continue;
+    }
+    const TfLiteTensor& tensor = tensors_[tensor_index];
+    // As in InvokeImpl(), the shape input of reshape may lack data.
+    if (tensor.data.raw == nullptr && tensor.bytes > 0 &&
+        !(registration.builtin_code == kTfLiteBuiltinReshape && i == 1 &&
+          tensor.dims->size != 1)) {
+      ReportError("Input tensor %d lacks data", tensor_index);
+      return kTfLiteError;
+    }
+  }
+  if (auto s = OpInvoke(registration, &node); s != kTfLiteOk) {
+    auto err = ReportOpError(&context_, node, registration, node_index,
+                             "failed to invoke");
+    return s == kTfLiteCancelled ? s : err;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::SchedulePipelineStages() {
+  std::vector<PipelineStage> stages;
+  int num_delegate_locks = 0;
+  // The primary subgraph only, as the others run within the nodes of a stage.
+  if (ShouldPipelineDelegatePartitions() && subgraph_index_ == 0 &&
+      concurrent_node_groups_.empty()) {
+    std::vector<const TfLiteDelegate*> locked_delegates;
+    const TfLiteDelegate* stage_delegate = nullptr;
+    for (int i = 0; i < execution_plan_.size(); ++i) {
+      const auto& node_and_registration =
+          nodes_and_registration_[execution_plan_[i]];
+      const TfLiteNode& node = node_and_registration.first;
+      // The stateful nodes would see the frames out of order.
+      bool is_stateful =
+          OpMightHaveSideEffect(&node, &node_and_registration.second);
+      for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+        if (tensor_index == kTfLiteOptionalTensor) continue;
+        is_stateful |= tensors_[tensor_index].is_variable;
+      }
+      if (is_stateful) {
+        stages.clear();
+        break;
+      }
+      if (!stages.empty() && node.delegate == stage_delegate) {
+        stages.back().end = i + 1;
+        continue;
+      }
+      stage_delegate = node.delegate;
+      int delegate_lock = -1;
+      if (node.delegate != nullptr) {
+        auto it = std::find(locked_delegates.begin(), locked_delegates.end(),
+                            node.delegate);
+        delegate_lock = it - locked_delegates.begin();
+        if (it == locked_delegates.end()) {
+          locked_delegates.push_back(node.delegate);
+        }
+      }
+      stages.push_back({i, i + 1, delegate_lock});
+    }
+    if (stages.size() < 2) stages.clear();
+    num_delegate_locks = locked_delegates.size();
+  }
+  auto same_stage = [](const PipelineStage& a, const PipelineStage& b) {
+    return a.begin == b.begin && a.end == b.end &&
+           a.delegate_lock == b.delegate_lock;
+  };
+  if (std::equal(stages.begin(), stages.end(), pipeline_stages_.begin(),
+                 pipeline_stages_.end(), same_stage)) {
+    return kTfLiteOk;
+  }
+  pipeline_stages_ = std::move(stages);
+  pipeline_delegate_mutexes_.reset(new std::mutex[num_delegate_locks]);
+  if (memory_planner_) {
+    // Unless the planner can keep all the tensors apart, the stages are run
+    // one by one.
+    const std::vector<int> group_of_node =
+        pipeline_stages_.empty() ? concurrent_node_groups_
+                                 : std::vector<int>(execution_plan_.size(), 0);
+    if (memory_planner_->SetConcurrentNodeGroups(group_of_node) !=
+        kTfLiteOk) {
+      pipeline_stages_.clear();
+      return kTfLiteOk;
+    }
+    TF_LITE_ENSURE_STATUS(memory_planner_->PlanAllocations());
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::SetUpPipeline() {
+  const int num_stages = pipeline_stages_.size();
+  if (num_stages < 2 || has_dynamic_tensors_) return kTfLiteOk;
+
+  // The stages accessing each tensor, in order, and the one which must use
+  // the tensor itself: the first one for the inputs, set before it runs, the
+  // last one for the outputs, read after it ran, and the one of the delegate
+  // kernels accessing it, which keep the tensor indices.
+  std::vector<std::vector<int>> stages_of_tensor(tensors_.size());
+  std::vector<int> tensor_stage(tensors_.size(), -1);
+  bool can_pipeline = true;
+  auto access = [&](int tensor_index, int stage, bool uses_tensor) {
+    if (tensor_index == kTfLiteOptionalTensor) return;
+    std::vector<int>& stages = stages_of_tensor[tensor_index];
+    if (stages.empty() || stages.back() != stage) stages.push_back(stage);
+    if (uses_tensor) {
+      can_pipeline &= tensor_stage[tensor_index] == -1 ||
+                      tensor_stage[tensor_index] == stage;
+      tensor_stage[tensor_index] = stage;
+    }
+  };
+  for (int tensor_index : inputs_) access(tensor_index, 0, true);
+  for (int stage = 0; stage < num_stages; ++stage) {
+    for (int i = pipeline_stages_[stage].begin;
+         i < pipeline_stages_[stage].end; ++i) {
+      const TfLiteNode& node =
+          nodes_and_registration_[execution_plan_[i]].first;
+      for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+        access(tensor_index, stage, node.delegate != nullptr);
+      }
+      for (int tensor_index : TfLiteIntArrayView(node.outputs)) {
+        access(tensor_index, stage, node.delegate != nullptr);
+      }
+    }
+  }
+  for (int tensor_index : outputs_) access(tensor_index, num_stages - 1, true);
+
+  std::vector<PipelinedTensor> pipelined_tensors;
+  std::vector<int> pipelined_of_tensor(tensors_.size(), -1);
+  for (int tensor_index = 0;
+       can_pipeline && tensor_index < stages_of_tensor.size(); ++tensor_index) {
+    const std::vector<int>& stages = stages_of_tensor[tensor_index];
+    if (stages.size() < 2) continue;
+    const TfLiteTensor& tensor = tensors_[tensor_index];
+    // The constant tensors are only read.
+    if (tensor.allocation_type == kTfLiteMmapRo ||
+        tensor.allocation_type == kTfLitePersistentRo) {
+      continue;
+    }
+    if (tensor.allocation_type != kTfLiteArenaRw ||
+        tensor.buffer_handle != kTfLiteNullBufferHandle || tensor.is_variable) {
+      can_pipeline = false;
+      break;
+    }
+    PipelinedTensor pipelined;
+    pipelined.tensor_index = tensor_index;
+    pipelined.allocation_type = tensor.allocation_type;
+    pipelined.data = tensor.data.raw;
+    pipelined.num_slots = stages.back() - stages.front() + 1;
+    pipelined.slot_bytes = (tensor.bytes + kDefaultTensorAlignment - 1) /
+                           kDefaultTensorAlignment * kDefaultTensorAlignment;
+    pipelined_of_tensor[tensor_index] = pipelined_tensors.size();
+    pipelined_tensors.push_back(std::move(pipelined));
+  }
+  if (!can_pipeline) {
+    TFLITE_LOG(tflite::TFLITE_LOG_WARNING,
+               "The delegated and CPU partitions are not pipelined, as a "
+               "tensor crossing them is not in the arena or is used by the "
+               "delegate kernels of several partitions.");
+    return kTfLiteOk;
+  }
+
+  for (PipelinedTensor& pipelined : pipelined_tensors) {
+    const int tensor_index = pipelined.tensor_index;
+    const std::vector<int>& stages = stages_of_tensor[tensor_index];
+    if (tensor_stage[tensor_index] == -1) {
+      tensor_stage[tensor_index] = stages.front();
+    }
+    for (int stage : stages) {
+      int stage_tensor_index = tensor_index;
+      if (stage != tensor_stage[tensor_index]) {
+        auto it = pipeline_stage_tensors_.find({tensor_index, stage});
+        if (it == pipeline_stage_tensors_.end()) {
+          int new_tensor_index;
+          TF_LITE_ENSURE_STATUS(AddTensors(1, &new_tensor_index));
+          it = pipeline_stage_tensors_
+                   .emplace(std::make_pair(tensor_index, stage),
+                            new_tensor_index)
+                   .first;
+        }
+        stage_tensor_index = it->second;
+        const TfLiteTensor& tensor = tensors_[tensor_index];
+        TfLiteTensor& stage_tensor = tensors_[stage_tensor_index];
+        TfLiteTensorReset(tensor.type, tensor.name,
+                          TfLiteIntArrayCopy(tensor.dims), tensor.params,
+                          /*buffer=*/nullptr, tensor.bytes, kTfLiteCustom,
+                          /*allocation=*/nullptr, /*is_variable=*/false,
+                          &stage_tensor);
+        stage_tensor.quantization = CopyQuantization(tensor.quantization);
+      }
+      pipelined.stage_tensors.emplace_back(stage, stage_tensor_index);
+    }
+    // Out of the arena, which would point it back to its allocation.
+    tensors_[tensor_index].allocation_type = kTfLiteCustom;
+    pipelined.buffer.reset(new char[pipelined.num_slots * pipelined.slot_bytes +
+                                    kDefaultTensorAlignment]);
+    const uintptr_t buffer =
+        reinterpret_cast<uintptr_t>(pipelined.buffer.get());
+    pipelined.slots = reinterpret_cast<char*>(
+        (buffer + kDefaultTensorAlignment - 1) / kDefaultTensorAlignment *
+        kDefaultTensorAlignment);
+  }
+
+  // The CPU nodes read and write the tensors of their stage.
+  for (int stage = 0; stage < num_stages; ++stage) {
+    for (int i = pipeline_stages_[stage].begin;
+         i < pipeline_stages_[stage].end; ++i) {
+      const int node_index = execution_plan_[i];
+      TfLiteNode& node = nodes_and_registration_[node_index].first;
+      if (node.delegate != nullptr) continue;
+      for (bool is_output : {false, true}) {
+        TfLiteIntArray* node_tensors = is_output ? node.outputs : node.inputs;
+        for (int position = 0; position < node_tensors->size; ++position) {
+          const int tensor_index = node_tensors->data[position];
+          if (tensor_index == kTfLiteOptionalTensor ||
+              pipelined_of_tensor[tensor_index] == -1) {
+            continue;
+          }
+          for (const auto& stage_tensor :
+               pipelined_tensors[pipelined_of_tensor[tensor_index]]
+                   .stage_tensors) {
+            if (stage_tensor.first != stage ||
+                stage_tensor.second == tensor_index) {
+              continue;
+            }
+            pipelined_node_tensors_.push_back(
+                {node_index, is_output, position, tensor_index});
+            node_tensors->data[position] = stage_tensor.second;
+          }
+        }
+      }
+    }
+  }
+  pipelined_tensors_ = std::move(pipelined_tensors);
+  pipelined_tensors_active_ = true;
+  pipeline_tick_ = 0;
+  pipeline_sequential_ticks_ = 0;
+  SetPipelineFrames(0, num_stages - 1, pipeline_tick_);
+  return kTfLiteOk;
+}
+
+void Subgraph::TearDownPipeline() {
+  if (!pipelined_tensors_active_) return;
+  for (const PipelinedNodeTensor& node_tensor : pipelined_node_tensors_) {
+    TfLiteNode& node = nodes_and_registration_[node_tensor.node_index].first;
+    TfLiteIntArray* node_tensors =
+        node_tensor.is_output ? node.outputs : node.inputs;
+    node_tensors->data[node_tensor.position] = node_tensor.tensor_index;
+  }
+  for (const PipelinedTensor& pipelined : pipelined_tensors_) {
+    for (const auto& stage_tensor : pipelined.stage_tensors) {
+      tensors_[stage_tensor.second].data.raw = nullptr;
+    }
+    TfLiteTensor& tensor = tensors_[pipelined.tensor_index];
+    tensor.allocation_type = pipelined.allocation_type;
+    tensor.data.raw = pipelined.data;
+  }
+  pipelined_node_tensors_.clear();
+  pipelined_tensors_.clear();
+  pipelined_tensors_active_ = false;
+}
+
+void Subgraph::SetPipelineFrames(int first_stage, int last_stage,
+                                 int64_t tick) {
+  for (const PipelinedTensor& pipelined : pipelined_tensors_) {
+    for (const auto& stage_tensor : pipelined.stage_tensors) {
+      const int stage = stage_tensor.first;
+      if (stage < first_stage || stage > last_stage) continue;
+      // The stage processes the frame of invocation `tick - stage`, whose
+      // buffer is in use from the first to the last stage accessing the
+      // tensor, while the stages in between process the next frames.
+      const int64_t frame = tick - stage;
+      const int slot = (frame % pipelined.num_slots + pipelined.num_slots) %
+                       pipelined.num_slots;
+      tensors_[stage_tensor.second].data.raw =
+          pipelined.slots + slot * pipelined.slot_bytes;
+    }
+  }
+}
+
+TfLiteStatus Subgraph::InvokePipelined() {
+  const int num_stages = pipeline_stages_.size();
+  if (check_cancelled_func_ != nullptr &&
+      check_cancelled_func_(cancellation_data_)) {
+    ReportError("Client requested cancel during Invoke()");
+    return kTfLiteError;
+  }
+  if (continue_invocation_ && !continue_invocation_->test_and_set()) {
+    // `Cancel` is called and cancellation flag is flipped.
+    ReportError("Client requested cancel during Invoke()");
+    return kTfLiteCancelled;
+  }
+  // The first stage is already on the frame whose inputs were set.
+  SetPipelineFrames(1, num_stages - 1, pipeline_tick_);
+  // The later stages have no frame until the first ones reached them.
+  const int num_active_stages =
+      std::min<int64_t>(pipeline_tick_ + 1, num_stages);
+  EnsureTensorsVectorCapacity();
+  if (pipeline_num_threads_ != context_.recommended_num_threads) {
+    pipeline_num_threads_ = context_.recommended_num_threads;
+    pipeline_sequential_ticks_ = 0;
+  }
+  // As in ShouldInvokeConcurrently(), the per op profiling is not
+  // thread-safe.
+  if (pipeline_sequential_ticks_ >= num_stages && profiler_ == nullptr) {
+    if (!inter_op_thread_pool_ ||
+        inter_op_thread_pool_->num_workers() != num_stages - 1) {
+      inter_op_thread_pool_ =
+          std::make_unique<InterOpThreadPool>(num_stages - 1);
+    }
+    std::vector<TfLiteStatus> statuses(num_active_stages, kTfLiteOk);
+    inter_op_thread_pool_->ParallelFor(
+        num_active_stages, [this, &statuses](int stage) {
+          statuses[stage] = InvokePipelineStage(stage);
+        });
+    for (TfLiteStatus status : statuses) {
+      TF_LITE_ENSURE_STATUS(status);
+    }
+  } else {
+    for (int stage = 0; stage < num_active_stages; ++stage) {
+      TF_LITE_ENSURE_STATUS(InvokePipelineStage(stage));
+    }
+    ++pipeline_sequential_ticks_;
+  }
+  ++pipeline_tick_;
+  // The inputs of the next frame are set in between.
+  SetPipelineFrames(0, 0, pipeline_tick_);
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::InvokePipelineStage(int stage) {
+  const PipelineStage& pipeline_stage = pipeline_stages_[stage];
+  std::unique_lock<std::mutex> lock;
+  if (pipeline_stage.delegate_lock >= 0) {
+    lock = std::unique_lock<std::mutex>(
+        pipeline_delegate_mutexes_[pipeline_stage.delegate_lock]);
+  }
+  for (int i = pipeline_stage.begin; i < pipeline_stage.end; ++i) {
+    TF_LITE_ENSURE_STATUS(InvokeNode(i));
+  }
+  return kTfLiteOk;
+}
+
 TfLiteStatus Subgraph::ResizeTensor(TfLiteContext* context,
                                     TfLiteTensor* tensor,
                                     TfLiteIntArray* new_size) {
@@ -1665,6 +2371,7 @@ TfLiteStatus Subgraph::SetTensorParametersReadOnly(
     tensor.allocation = allocation;
   } else {
     state_ = kStateUninvokable;
+    only_inputs_resized_ = false;
     TfLiteTensorReset(type, name, ConvertArrayToTfLiteIntArray(ndims, dims),
                       GetLegacyQuantization(quantization),
                       const_cast<char*>(buffer), bytes, kTfLiteMmapRo,
@@ -1832,6 +2539,8 @@ void Subgraph::SwitchToKernelContext() {
 }
 
 TfLiteStatus Subgraph::UndoAllDelegates() {
+  // The stages are those of the delegated graph.
+  TearDownPipeline();
   // Return early if there is nothing to reset to.
   if (pre_delegation_execution_plan_.empty()) return kTfLiteOk;
 
@@ -1905,6 +2614,7 @@ TfLiteStatus Subgraph::UndoAllDelegates() {
   nodes_and_registration_.resize(max_retained_node_index + 1);
   // After undoing delegates, the graph is uninvokable, but mutable.
   state_ = kStateUninvokable;
+  only_inputs_resized_ = false;
 
   delegates_undone_ = true;
   return kTfLiteOk;
@@ -1957,6 +2667,7 @@ void Subgraph::EnsureTensorsVectorCapacity() {
 TfLiteStatus Subgraph::EnsureMemoryAllocations() {
   if (memory_planner_) {
     state_ = kStateUninvokable;
+    only_inputs_resized_ = false;
     TF_LITE_ENSURE_OK(&context_, memory_planner_->PlanAllocations());
   }
   TF_LITE_ENSURE_OK(&context_, AllocateTensors());
@@ -1978,6 +2689,7 @@ TfLiteStatus Subgraph::ModifyGraphWithDelegateImpl(TfLiteDelegate* delegate) {
     ReportError("Null delegate.");
     return kTfLiteDelegateError;
   }
+  TearDownPipeline();
 
   // Resets delegation & leaves graph in consistent state if delegate status is
   // not okay.
@@ -2009,6 +2721,7 @@ TfLiteStatus Subgraph::ModifyGraphWithDelegateImpl(TfLiteDelegate* delegate) {
     // tensors.
     // Reset the state to force tensor/op reallocation.
     state_ = kStateUninvokable;
+    only_inputs_resized_ = false;
   } else if (!delegate_supports_dynamic_shapes) {
     // Check if graph has dynamic tensors by preparing ops.
     int last_execution_plan_index_prepared;
@@ -2049,6 +2762,7 @@ TfLiteStatus Subgraph::ModifyGraphWithDelegateImpl(TfLiteDelegate* delegate) {
     // CASE 1: Current delegate does not support dynamic shapes.
     // Reset the state to force tensor/op reallocation.
     state_ = kStateUninvokable;
+    only_inputs_resized_ = false;
     TF_LITE_ENSURE_STATUS(
         reset_delegation_if_not_ok(EnsureMemoryAllocations()));
     // After using a delegate which doesn't support dynamic tensors, make the
@@ -23,6 +23,7 @@ limitations under the License.
 #include <cstdlib>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -63,6 +64,8 @@ class TestDelegate;  // Class for friend declarations.
 }  // namespace delegates
 #endif  // DOXYGEN_SKIP
 
+class InterOpThreadPool;
+
 class Subgraph {
  public:
 #ifndef DOXYGEN_SKIP
@@ -456,6 +459,33 @@ class Subgraph {
     return (options_ && options_->GetDisableDelegateClustering());
   }
 
+  // WARNING: This is an experimental API and subject to change.
+  // True if `AllocateTensors` after resizing inputs only prepares the ops
+  // whose inputs changed shape.
+  bool ShouldPrepareOnlyAffectedOps() const {
+    return (options_ && options_->GetPrepareOnlyAffectedOps());
+  }
+
+  // WARNING: This is an experimental API and subject to change.
+  // The number of threads running the independent ops at once.
+  int NumInterOpThreads() const {
+    return options_ ? options_->GetNumInterOpThreads() : 1;
+  }
+
+  // WARNING: This is an experimental API and subject to change.
+  // True if the delegated and CPU partitions are pipelined across
+  // invocations when possible.
+  bool ShouldPipelineDelegatePartitions() const {
+    return options_ && options_->GetPipelineDelegatePartitions();
+  }
+
+  // WARNING: This is an experimental API and subject to change.
+  // The number of invocations the outputs lag the inputs by when the
+  // partitions are pipelined, 0 otherwise.
+  int pipeline_latency() const {
+    return pipelined_tensors_active_ ? pipeline_stages_.size() - 1 : 0;
+  }
+
  private:
 #ifndef DOXYGEN_SKIP
   friend class tflite::impl::InterpreterBuilder;
@@ -548,6 +578,10 @@ class Subgraph {
   // to wait until Invoke() to resolve the sizes of dynamic tensors.
   TfLiteStatus PrepareOpsAndTensors();
 
+  // True if an input of `node` changed shape while only the ops depending on
+  // the resized inputs are prepared again.
+  bool NodeInputsChanged(const TfLiteNode& node) const;
+
   // Call OpPrepare() for all ops starting at 'first_node'. Stop when a
   // dynamic tensors is found or all ops have been prepared. Fill
   // 'last_node_prepared' with the id of the op containing dynamic tensors, or
@@ -581,6 +615,48 @@ class Subgraph {
   // Does not report invoke status through profiler.
   TfLiteStatus InvokeImpl();
 
+  // Groups the nodes into levels running concurrently when the ops are run on
+  // several threads, each level with the nodes whose inputs are all produced
+  // by the earlier levels, and orders the execution plan by level. Nodes with
+  // side effects or updating variable tensors get levels of their own.
+  TfLiteStatus ScheduleConcurrentNodes();
+
+  // True if `InvokeImpl` runs the nodes of each level concurrently.
+  bool ShouldInvokeConcurrently() const;
+
+  // Runs the nodes level by level, those of a level concurrently.
+  TfLiteStatus InvokeConcurrently();
+
+  // Runs the node at `execution_plan_index` of a static graph, from any
+  // thread.
+  TfLiteStatus InvokeNode(int execution_plan_index);
+
+  // Splits the execution plan into pipeline stages, each of the consecutive
+  // nodes run by the same delegate or by the CPU, when the partitions are
+  // pipelined. The planner keeps all the tensors alive together then, as the
+  // stages run at once.
+  TfLiteStatus SchedulePipelineStages();
+
+  // Gives each tensor accessed by several stages of the prepared graph a
+  // buffer per frame in flight, and a tensor to each stage accessing it
+  // besides the one using the tensor itself, read and written through by
+  // the nodes of the stage. Leaves the invocations sequential if the graph
+  // can't be pipelined.
+  TfLiteStatus SetUpPipeline();
+
+  // Restores the nodes and the tensors changed by `SetUpPipeline`.
+  void TearDownPipeline();
+
+  // Points the tensors of the stages in [first_stage, last_stage] to the
+  // buffers of the frames they process in invocation `tick`.
+  void SetPipelineFrames(int first_stage, int last_stage, int64_t tick);
+
+  // Runs all the stages at once on their frames.
+  TfLiteStatus InvokePipelined();
+
+  // Runs the nodes of `stage`, from any thread.
+  TfLiteStatus InvokePipelineStage(int stage);
+
   // Allow a delegate to look at the graph and modify the graph to handle
   // parts of the graph themselves. After this is called, the graph may
   // contain new nodes that replace 1 more nodes.
@@ -903,6 +979,86 @@ class Subgraph {
   // Maps tensor index to custom allocation for all applicable tensors.
   std::map<int, TfLiteCustomAllocation> custom_allocations_;
 
+  // True if only inputs were resized since all the ops were last prepared, in
+  // which case `AllocateTensors` may only prepare the ops depending on them
+  // again.
+  bool only_inputs_resized_ = false;
+
+  // The inputs resized since all the ops were last prepared.
+  std::vector<int> resized_inputs_;
+
+  // While `AllocateTensors` only prepares the ops depending on the resized
+  // inputs, whether each tensor changed shape. Empty otherwise.
+  std::vector<bool> changed_tensors_;
+
+  // The level of each node of the execution plan, in which it runs
+  // concurrently with the other nodes of the level. Empty if the nodes are
+  // run one by one.
+  std::vector<int> concurrent_node_groups_;
+
+  // The threads running the nodes of a level with the calling one.
+  std::unique_ptr<InterOpThreadPool> inter_op_thread_pool_;
+
+  // True if the nodes were run one by one since they were last prepared, with
+  // `warmed_up_num_threads_` recommended threads. The kernels lazily create
+  // some of their state, like the Eigen thread pool, on the first run, which
+  // is not thread-safe.
+  bool kernels_warmed_up_ = false;
+  int warmed_up_num_threads_ = 0;
+
+  // A range of the execution plan pipelined with the other stages.
+  struct PipelineStage {
+    int begin;
+    int end;
+    // The index of the mutex serializing the stages of the same delegate,
+    // whose kernels may not run concurrently, or -1 for the CPU ones.
+    int delegate_lock;
+  };
+
+  // A tensor accessed by several pipeline stages.
+  struct PipelinedTensor {
+    int tensor_index;
+    TfLiteAllocationType allocation_type;
+    char* data;
+    // The buffers of the frames in flight, one per stage from the first to
+    // the last one accessing the tensor, `slot_bytes` each.
+    std::unique_ptr<char[]> buffer;
+    char* slots;
+    size_t slot_bytes;
+    int num_slots;
+    // The stages accessing the tensor and the tensor each of them uses.
+    std::vector<std::pair<int, int>> stage_tensors;
+  };
+
+  // A tensor of a node replaced by the one of its stage.
+  struct PipelinedNodeTensor {
+    int node_index;
+    bool is_output;
+    int position;
+    int tensor_index;
+  };
+
+  // The pipeline stages of the execution plan, empty if the invocations are
+  // not pipelined.
+  std::vector<PipelineStage> pipeline_stages_;
+  std::unique_ptr<std::mutex[]> pipeline_delegate_mutexes_;
+
+  // The tensors of the stages, set up after preparing the nodes.
+  bool pipelined_tensors_active_ = false;
+  std::vector<PipelinedTensor> pipelined_tensors_;
+  std::vector<PipelinedNodeTensor> pipelined_node_tensors_;
+  // The tensor added for each tensor and stage, kept once set up, as the
+  // tensors are never removed.
+  std::map<std::pair<int, int>, int> pipeline_stage_tensors_;
+
+  // The invocations run since the pipeline was set up, and those run one
+  // stage after the other with `pipeline_num_threads_` recommended threads,
+  // which the pipeline waits for until each stage ran once, while the
+  // kernels set up their state.
+  int64_t pipeline_tick_ = 0;
+  int pipeline_sequential_ticks_ = 0;
+  int pipeline_num_threads_ = 0;
+
   // Tracking bit for whether a tensor was resized in the course of an op
   // invocation. This is a useful hint to ensure that dynamic tensor outputs
   // trigger downstream reallocation after op invocation.
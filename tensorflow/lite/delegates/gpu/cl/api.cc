@@ -24,6 +24,7 @@ limitations under the License.
 #include <algorithm>
 #include <cstring>
 #include <memory>
+#include <string>
 #include <variant>
 #include <vector>
 
@@ -993,6 +994,12 @@ class InferenceEnvironmentImpl : public InferenceEnvironment {
     return data;
   }
 
+  std::string GetDeviceIdentifier() const final {
+    const OpenClInfo& info = environment_.device().GetInfo().opencl_info;
+    return info.vendor_name + "/" + info.device_name + "/" +
+           info.platform_version + "/" + info.driver_version;
+  }
+
   const InferenceEnvironmentProperties& properties() const {
     return properties_;
   }
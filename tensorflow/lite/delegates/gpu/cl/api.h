@@ -24,6 +24,7 @@ limitations under the License.
 
 #include <cstdint>
 #include <memory>
+#include <string>
 
 #include "absl/types/span.h"
 #include "tensorflow/lite/delegates/gpu/api.h"
@@ -105,6 +106,12 @@ class InferenceEnvironment {
   // Returned data is valid only if used on the same device, otherwise it will
   // not be compatible and will be discarded.
   virtual std::vector<uint8_t> GetSerializedBinaryCache() const = 0;
+
+  // Returns a string identifying the GPU and the OpenCL driver of this
+  // environment. Serialized models and binary caches built in an environment
+  // are only compatible with the environments of the same identifier, so
+  // clients persisting them can use it to invalidate them.
+  virtual std::string GetDeviceIdentifier() const = 0;
 };
 
 struct InferenceEnvironmentOptions {
@@ -53,6 +53,7 @@ using delegates::Serialization;
 using delegates::SerializationParams;
 
 constexpr char kSerializedDataPrefix[] = "gpuv2_data_";
+constexpr size_t kSerializedDataHeaderSize = 32;
 
 InferencePriority ToPriority(int32_t priority) {
   switch (priority) {
@@ -400,16 +401,19 @@ class DelegateKernel {
       RETURN_IF_ERROR(cl_environment_->NewInferenceBuilder(
           options, std::move(*graph), builder));
     } else {
-      // If serialization data is found, initialize CL from it & return early.
+      RETURN_IF_ERROR(cl::NewInferenceEnvironment(env_options, &cl_environment_,
+                                                  &properties));
+      // If serialization data of this GPU and driver is found, initialize CL
+      // from it & return early.
       if (MaybeInitializeSerializedOpenCL(context, delegate_params, builder,
-                                          &options, &env_options, &properties,
-                                          serialization)
+                                          &options, serialization)
               .ok()) {
         return absl::OkStatus();
       }
-
-      RETURN_IF_ERROR(cl::NewInferenceEnvironment(env_options, &cl_environment_,
-                                                  &properties));
+      if (!cl_environment_) {
+        RETURN_IF_ERROR(cl::NewInferenceEnvironment(
+            env_options, &cl_environment_, &properties));
+      }
       *graph_is_destroyed = true;
       std::vector<uint8_t> serialized_model;
       RETURN_IF_ERROR(cl_environment_->BuildSerializedModel(
@@ -426,12 +430,24 @@ class DelegateKernel {
     return absl::OkStatus();
   }
 
-  // Returns Ok only if serialized data is successsfully found.
+  // The header of the serialized data, identifying the GPU and the driver the
+  // compiled programs and the tuned work group sizes it holds are valid for.
+  // Padded to keep the serialized model aligned.
+  std::string SerializedDataHeader() const {
+    const std::string device_identifier =
+        cl_environment_->GetDeviceIdentifier();
+    std::string header = delegates::StrFingerprint(device_identifier.data(),
+                                                   device_identifier.size());
+    header.resize(kSerializedDataHeaderSize, '\n');
+    return header;
+  }
+
+  // Returns Ok only if serialized data is successsfully found. Clears the data
+  // of another GPU or driver, or failing to load, in which case the
+  // environment is reset too, as it may hold some of its programs.
   absl::Status MaybeInitializeSerializedOpenCL(
       TfLiteContext* context, const TfLiteDelegateParams* delegate_params,
       std::unique_ptr<InferenceBuilder>* builder, cl::InferenceOptions* options,
-      cl::InferenceEnvironmentOptions* env_options,
-      cl::InferenceEnvironmentProperties* properties,
       Serialization* serialization) {
     if (!serialization) return absl::InvalidArgumentError("No serialization");
     // We use a fingerprint of the options to ensure compatibility.
@@ -443,21 +459,33 @@ class DelegateKernel {
 
     std::string model_data;
     auto model_data_status = data_key.GetData(context, &model_data);
-    if (model_data_status == kTfLiteOk) {
-      absl::Span<const uint8_t> model_span = absl::Span<const uint8_t>{
-          reinterpret_cast<const uint8_t*>(model_data.data()),
-          model_data.size()};
-      RETURN_IF_ERROR(cl::NewInferenceEnvironment(
-          *env_options, &cl_environment_, properties));
-      RETURN_IF_ERROR(
-          cl_environment_->NewInferenceBuilder(model_span, builder));
-      TFLITE_LOG_PROD_ONCE(
-          tflite::TFLITE_LOG_INFO,
-          "Initialized OpenCL-based API from serialized data.");
-      return absl::OkStatus();
+    if (model_data_status != kTfLiteOk) {
+      return absl::NotFoundError("Serialization data not found");
     }
-
-    return absl::NotFoundError("Serialization data not found");
+    const std::string header = SerializedDataHeader();
+    if (model_data.compare(0, header.size(), header) != 0) {
+      TFLITE_LOG_PROD(tflite::TFLITE_LOG_INFO,
+                      "Serialized data is of another GPU or OpenCL driver, "
+                      "building it again.");
+      data_key.ClearData(context);
+      return absl::NotFoundError("Serialization data is stale");
+    }
+    absl::Span<const uint8_t> model_span = absl::Span<const uint8_t>{
+        reinterpret_cast<const uint8_t*>(model_data.data()) + header.size(),
+        model_data.size() - header.size()};
+    const absl::Status status =
+        cl_environment_->NewInferenceBuilder(model_span, builder);
+    if (!status.ok()) {
+      TFLITE_LOG_PROD(tflite::TFLITE_LOG_WARNING,
+                      "Failed to load serialized data, building it again: %s",
+                      std::string(status.message()).c_str());
+      data_key.ClearData(context);
+      cl_environment_.reset();
+      return status;
+    }
+    TFLITE_LOG_PROD_ONCE(tflite::TFLITE_LOG_INFO,
+                         "Initialized OpenCL-based API from serialized data.");
+    return absl::OkStatus();
   }
 
   // Returns Ok only if serialization happens successfully.
@@ -470,13 +498,14 @@ class DelegateKernel {
     std::string options_fingerprint =
         delegates::StrFingerprint(options, sizeof(cl::InferenceOptions));
 
-    // Save data.
+    // Save data, after the header of the GPU and driver.
     auto data_key = serialization->GetEntryForKernel(
         std::string(kSerializedDataPrefix) + options_fingerprint, context,
         delegate_params);
-    auto save_status = data_key.SetData(
-        context, reinterpret_cast<const char*>(serialized_model.data()),
-        serialized_model.size());
+    std::string data = SerializedDataHeader();
+    data.append(reinterpret_cast<const char*>(serialized_model.data()),
+                serialized_model.size());
+    auto save_status = data_key.SetData(context, data.data(), data.size());
     if (save_status != kTfLiteOk) {
       return absl::InvalidArgumentError("Failed to save serialized data");
     }
@@ -22,16 +22,18 @@ limitations under the License.
 #include <fcntl.h>
 #include <sys/file.h>
 #include <unistd.h>
-
-#include <cstring>
 #endif  // defined(_WIN32)
 
 #include <time.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/lite/c/common.h"
@@ -43,6 +45,7 @@ namespace delegates {
 namespace {
 
 static const char kDelegatedNodesSuffix[] = "_dnodes";
+static const char kPartitionLatenciesSuffix[] = "_platencies";
 
 // Farmhash Fingerprint
 inline uint64_t CombineFingerprints(uint64_t l, uint64_t h) {
@@ -70,6 +73,19 @@ inline std::string GetFilePath(const std::string& cache_dir,
   return JoinPath(cache_dir, file_name);
 }
 
+template <typename T>
+void AppendValue(const T& value, std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool ReadValue(const std::string& buffer, size_t* offset, T* value) {
+  if (buffer.size() - *offset < sizeof(T)) return false;
+  std::memcpy(value, buffer.data() + *offset, sizeof(T));
+  *offset += sizeof(T);
+  return true;
+}
+
 }  // namespace
 
 std::string StrFingerprint(const void* data, const size_t num_bytes) {
@@ -226,6 +242,18 @@ TfLiteStatus SerializationEntry::GetData(TfLiteContext* context,
   }
 }
 
+TfLiteStatus SerializationEntry::ClearData(TfLiteContext* context) const {
+  auto filepath = GetFilePath(cache_dir_, model_token_, fingerprint_);
+  if (std::remove(filepath.c_str()) < 0 && errno != ENOENT) {
+    TF_LITE_KERNEL_LOG(context, "Failed to remove %s: %s", filepath.c_str(),
+                       std::strerror(errno));
+    return kTfLiteDelegateDataWriteError;
+  }
+  TFLITE_LOG(TFLITE_LOG_INFO, "Cleared serialized data for model %s at %s",
+             model_token_.c_str(), filepath.c_str());
+  return kTfLiteOk;
+}
+
 SerializationEntry Serialization::GetEntryImpl(
     const std::string& custom_key, TfLiteContext* context,
     const TfLiteDelegateParams* delegate_params) {
@@ -318,5 +346,90 @@ TfLiteStatus GetDelegatedNodes(TfLiteContext* context,
   return kTfLiteOk;
 }
 
+TfLiteStatus SavePartitionLatencies(
+    TfLiteContext* context, Serialization* serialization,
+    const std::string& delegate_id,
+    const std::vector<PartitionLatency>& latencies) {
+  // Layout: number of partitions, then for each partition its number of
+  // nodes, its nodes, and its delegate & CPU latencies.
+  std::string buffer;
+  AppendValue<int32_t>(latencies.size(), &buffer);
+  for (const PartitionLatency& latency : latencies) {
+    AppendValue<int32_t>(latency.nodes.size(), &buffer);
+    for (int node : latency.nodes) AppendValue<int32_t>(node, &buffer);
+    AppendValue<int64_t>(latency.delegate_latency_us, &buffer);
+    AppendValue<int64_t>(latency.cpu_latency_us, &buffer);
+  }
+  std::string cache_key = delegate_id + kPartitionLatenciesSuffix;
+  auto entry = serialization->GetEntryForDelegate(cache_key, context);
+  return entry.SetData(context, buffer.data(), buffer.size());
+}
+
+TfLiteStatus GetPartitionLatencies(TfLiteContext* context,
+                                   Serialization* serialization,
+                                   const std::string& delegate_id,
+                                   std::vector<PartitionLatency>* latencies) {
+  if (!latencies) return kTfLiteError;
+  std::string cache_key = delegate_id + kPartitionLatenciesSuffix;
+  auto entry = serialization->GetEntryForDelegate(cache_key, context);
+
+  std::string read_buffer;
+  TF_LITE_ENSURE_STATUS(entry.GetData(context, &read_buffer));
+  size_t offset = 0;
+  int32_t num_partitions;
+  if (!ReadValue(read_buffer, &offset, &num_partitions) ||
+      num_partitions < 0) {
+    return kTfLiteDelegateDataReadError;
+  }
+  std::vector<PartitionLatency> read_latencies;
+  for (int i = 0; i < num_partitions; ++i) {
+    PartitionLatency latency;
+    int32_t num_nodes;
+    if (!ReadValue(read_buffer, &offset, &num_nodes) || num_nodes < 0 ||
+        (read_buffer.size() - offset) / sizeof(int32_t) <
+            static_cast<size_t>(num_nodes)) {
+      return kTfLiteDelegateDataReadError;
+    }
+    latency.nodes.resize(num_nodes);
+    for (int& node : latency.nodes) {
+      int32_t value;
+      ReadValue(read_buffer, &offset, &value);
+      node = value;
+    }
+    if (!ReadValue(read_buffer, &offset, &latency.delegate_latency_us) ||
+        !ReadValue(read_buffer, &offset, &latency.cpu_latency_us)) {
+      return kTfLiteDelegateDataReadError;
+    }
+    read_latencies.push_back(std::move(latency));
+  }
+  if (offset != read_buffer.size()) return kTfLiteDelegateDataReadError;
+  *latencies = std::move(read_latencies);
+  return kTfLiteOk;
+}
+
+std::vector<TfLiteDelegateParams*> SelectProfitablePartitions(
+    const std::vector<TfLiteDelegateParams*>& partitions,
+    const std::vector<PartitionLatency>& latencies, float min_speedup) {
+  std::vector<TfLiteDelegateParams*> selected;
+  for (TfLiteDelegateParams* partition : partitions) {
+    const TfLiteIntArray* nodes = partition->nodes_to_replace;
+    auto latency = std::find_if(
+        latencies.begin(), latencies.end(),
+        [nodes](const PartitionLatency& latency) {
+          return latency.nodes.size() == static_cast<size_t>(nodes->size) &&
+                 std::equal(latency.nodes.begin(), latency.nodes.end(),
+                            nodes->data);
+        });
+    // Partitions that weren't measured, e.g. because the delegate options
+    // changed the partitioning, are kept.
+    if (latency == latencies.end() ||
+        latency->delegate_latency_us * min_speedup <=
+            latency->cpu_latency_us) {
+      selected.push_back(partition);
+    }
+  }
+  return selected;
+}
+
 }  // namespace delegates
 }  // namespace tflite
@@ -119,6 +119,14 @@ class SerializationEntry {
   //   kTfLiteError for unexpected error.
   TfLiteStatus GetData(TfLiteContext* context, std::string* data) const;
 
+  // Removes the data corresponding to this key, if any, for instance when the
+  // delegate finds it stale or invalid.
+  //
+  // Returns:
+  //   kTfLiteOk if no data is stored anymore
+  //   kTfLiteDelegateDataWriteError if the data could not be removed.
+  TfLiteStatus ClearData(TfLiteContext* context) const;
+
   // Non-copyable.
   SerializationEntry(const SerializationEntry&) = delete;
   SerializationEntry& operator=(const SerializationEntry&) = delete;
@@ -225,6 +233,45 @@ TfLiteStatus GetDelegatedNodes(TfLiteContext* context,
                                const std::string& delegate_id,
                                TfLiteIntArray** node_ids);
 
+// Latencies of a delegated partition, measured on the first runs of a model:
+// the latency of the delegate kernel replacing the partition (including its
+// input & output transfers) and the total latency of the same nodes run by the
+// CPU kernels, in microseconds.
+struct PartitionLatency {
+  // The nodes_to_replace of the partition, in the execution plan order.
+  std::vector<int> nodes;
+  int64_t delegate_latency_us = 0;
+  int64_t cpu_latency_us = 0;
+};
+
+// Helper for delegates to save the latencies measured for their partitions,
+// so that later runs of the model delegate only the profitable partitions
+// (see SelectProfitablePartitions). Like SaveDelegatedNodes, the entry is
+// based on the `context` & `delegate_id`, and the latencies are only
+// meaningful on the device they were measured on.
+TfLiteStatus SavePartitionLatencies(
+    TfLiteContext* context, Serialization* serialization,
+    const std::string& delegate_id,
+    const std::vector<PartitionLatency>& latencies);
+
+// Retrieves the partition latencies that were saved earlier with
+// SavePartitionLatencies. Returns kTfLiteDelegateDataNotFound if none were
+// saved, and kTfLiteDelegateDataReadError if the saved data is malformed.
+TfLiteStatus GetPartitionLatencies(TfLiteContext* context,
+                                   Serialization* serialization,
+                                   const std::string& delegate_id,
+                                   std::vector<PartitionLatency>* latencies);
+
+// Returns the `partitions` worth delegating, in the same order: a partition
+// with measured latencies is only kept if it runs at least `min_speedup`
+// times faster on the delegate than on CPU. This typically drops the small
+// partitions at the boundaries of the supported ops, whose transfers cost more
+// than the delegate saves. Partitions without latencies are kept, so that
+// they can be measured.
+std::vector<TfLiteDelegateParams*> SelectProfitablePartitions(
+    const std::vector<TfLiteDelegateParams*>& partitions,
+    const std::vector<PartitionLatency>& latencies, float min_speedup = 1.0f);
+
 }  // namespace delegates
 }  // namespace tflite
 
@@ -310,6 +310,29 @@ TEST_F(SerializationTest, SerializationData) {
   }
 }
 
+TEST_F(SerializationTest, ClearData) {
+  float value = 456.24;
+  std::string model_token = "model1";
+  std::string test_dir = getSerializationDir();
+  TfLiteContext context = GenerateTfLiteContext(/*num_tensors*/ 30);
+  TfLiteDelegateParams partition = GenerateTfLiteDelegateParams(
+      /*num_nodes=*/2, /*num_input_tensors=*/3, /*num_output_tensors=*/1);
+  SerializationParams serialization_params = {model_token.c_str(),
+                                              test_dir.c_str()};
+  Serialization serialization(serialization_params);
+  auto entry =
+      serialization.GetEntryForKernel("clear_test", &context, &partition);
+  ASSERT_EQ(entry.SetData(&context, reinterpret_cast<const char*>(&value),
+                          sizeof(value)),
+            kTfLiteOk);
+
+  ASSERT_EQ(entry.ClearData(&context), kTfLiteOk);
+  std::string read_back;
+  EXPECT_EQ(entry.GetData(&context, &read_back), kTfLiteDelegateDataNotFound);
+  // Clearing missing data succeeds.
+  EXPECT_EQ(entry.ClearData(&context), kTfLiteOk);
+}
+
 TEST_F(SerializationTest, CachingDelegatedNodes) {
   std::string model_token = "model1";
   std::string test_dir = getSerializationDir();
@@ -367,6 +390,84 @@ TEST_F(SerializationTest, CachingDelegatedNodes) {
   TfLiteIntArrayFree(empty_nodes_array);
 }
 
+TEST_F(SerializationTest, CachingPartitionLatencies) {
+  std::string model_token = "model1";
+  std::string test_dir = getSerializationDir();
+  SerializationParams serialization_params = {model_token.c_str(),
+                                              test_dir.c_str()};
+  Serialization serialization(serialization_params);
+  TfLiteContext context = GenerateTfLiteContext(/*num_tensors*/ 30);
+  const std::string test_delegate_id = "dummy_delegate";
+
+  std::vector<PartitionLatency> latencies(2);
+  latencies[0].nodes = {0, 1, 2};
+  latencies[0].delegate_latency_us = 100;
+  latencies[0].cpu_latency_us = 500;
+  latencies[1].nodes = {5};
+  latencies[1].delegate_latency_us = 40;
+  latencies[1].cpu_latency_us = 10;
+
+  std::vector<PartitionLatency> read_back;
+  ASSERT_EQ(GetPartitionLatencies(&context, &serialization, test_delegate_id,
+                                  &read_back),
+            kTfLiteDelegateDataNotFound);
+  ASSERT_EQ(SavePartitionLatencies(&context, &serialization, test_delegate_id,
+                                   latencies),
+            kTfLiteOk);
+  ASSERT_EQ(GetPartitionLatencies(&context, &serialization, test_delegate_id,
+                                  &read_back),
+            kTfLiteOk);
+  ASSERT_EQ(read_back.size(), 2);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(read_back[i].nodes, latencies[i].nodes);
+    EXPECT_EQ(read_back[i].delegate_latency_us,
+              latencies[i].delegate_latency_us);
+    EXPECT_EQ(read_back[i].cpu_latency_us, latencies[i].cpu_latency_us);
+  }
+  ASSERT_EQ(GetPartitionLatencies(&context, &serialization, test_delegate_id,
+                                  nullptr),
+            kTfLiteError);
+
+  // Truncated data is rejected.
+  auto entry = serialization.GetEntryForDelegate(
+      test_delegate_id + "_platencies", &context);
+  std::string data;
+  ASSERT_EQ(entry.GetData(&context, &data), kTfLiteOk);
+  ASSERT_EQ(entry.SetData(&context, data.data(), data.size() - 1), kTfLiteOk);
+  EXPECT_EQ(GetPartitionLatencies(&context, &serialization, test_delegate_id,
+                                  &read_back),
+            kTfLiteDelegateDataReadError);
+  EXPECT_EQ(entry.ClearData(&context), kTfLiteOk);
+}
+
+TEST_F(SerializationTest, SelectProfitablePartitions) {
+  TfLiteDelegateParams large = GenerateTfLiteDelegateParams(
+      /*num_nodes=*/3, /*num_input_tensors=*/1, /*num_output_tensors=*/1);
+  TfLiteDelegateParams small = GenerateTfLiteDelegateParams(
+      /*num_nodes=*/1, /*num_input_tensors=*/1, /*num_output_tensors=*/1);
+  small.nodes_to_replace->data[0] = 5;
+  TfLiteDelegateParams unmeasured = GenerateTfLiteDelegateParams(
+      /*num_nodes=*/1, /*num_input_tensors=*/1, /*num_output_tensors=*/1);
+  unmeasured.nodes_to_replace->data[0] = 7;
+  const std::vector<TfLiteDelegateParams*> partitions = {&large, &small,
+                                                         &unmeasured};
+
+  std::vector<PartitionLatency> latencies(2);
+  latencies[0].nodes = {0, 1, 2};
+  latencies[0].delegate_latency_us = 100;
+  latencies[0].cpu_latency_us = 150;
+  latencies[1].nodes = {5};
+  latencies[1].delegate_latency_us = 40;
+  latencies[1].cpu_latency_us = 10;
+
+  EXPECT_EQ(SelectProfitablePartitions(partitions, {}), partitions);
+  EXPECT_EQ(SelectProfitablePartitions(partitions, latencies),
+            (std::vector<TfLiteDelegateParams*>{&large, &unmeasured}));
+  EXPECT_EQ(SelectProfitablePartitions(partitions, latencies,
+                                       /*min_speedup=*/2.0f),
+            (std::vector<TfLiteDelegateParams*>{&unmeasured}));
+}
+
 }  // namespace
 }  // namespace delegates
 }  // namespace tflite
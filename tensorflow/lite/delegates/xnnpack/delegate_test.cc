@@ -13,14 +13,21 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <random>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "pthreadpool.h"  // from @pthreadpool
+#include "tensorflow/lite/core/kernels/register.h"
+#include "tensorflow/lite/core/model_builder.h"
+#include "tensorflow/lite/delegates/xnnpack/conv_2d_tester.h"
 #include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/interpreter.h"
 
 namespace tflite {
 namespace xnnpack {
@@ -62,5 +69,63 @@ TEST(Delegate, GetThreadPool) {
   ASSERT_EQ(2, pthreadpool_get_threads_count(threadpool));
 }
 
+TEST(Delegate, DynamicShapes) {
+  std::vector<char> buffer = Conv2DTester()
+                                 .InputChannels(3)
+                                 .OutputChannels(4)
+                                 .InputHeight(5)
+                                 .InputWidth(5)
+                                 .KernelHeight(3)
+                                 .KernelWidth(3)
+                                 .CreateTfLiteModel();
+  const Model* model = GetModel(buffer.data());
+  ops::builtin::BuiltinOpResolverWithoutDefaultDelegates resolver;
+
+  std::unique_ptr<Interpreter> delegate_interpreter;
+  ASSERT_EQ(kTfLiteOk,
+            InterpreterBuilder(model, resolver)(&delegate_interpreter));
+  std::unique_ptr<Interpreter> default_interpreter;
+  ASSERT_EQ(kTfLiteOk,
+            InterpreterBuilder(model, resolver)(&default_interpreter));
+
+  TfLiteXNNPackDelegateOptions delegate_options =
+      TfLiteXNNPackDelegateOptionsDefault();
+  delegate_options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_DYNAMIC_SHAPES;
+  std::unique_ptr<TfLiteDelegate, decltype(&TfLiteXNNPackDelegateDelete)>
+      xnnpack_delegate(TfLiteXNNPackDelegateCreate(&delegate_options),
+                       TfLiteXNNPackDelegateDelete);
+  ASSERT_EQ(kTfLiteOk, delegate_interpreter->ModifyGraphWithDelegate(
+                           xnnpack_delegate.get()));
+  ASSERT_EQ(1, delegate_interpreter->execution_plan().size());
+
+  // Batch sizes seen before switch back to their cached runtimes.
+  for (int batch_size : {3, 1, 3, 2}) {
+    for (Interpreter* interpreter :
+         {delegate_interpreter.get(), default_interpreter.get()}) {
+      ASSERT_EQ(kTfLiteOk,
+                interpreter->ResizeInputTensor(interpreter->inputs()[0],
+                                               {batch_size, 5, 5, 3}));
+      ASSERT_EQ(kTfLiteOk, interpreter->AllocateTensors());
+      float* input = interpreter->typed_input_tensor<float>(0);
+      for (int i = 0; i < batch_size * 5 * 5 * 3; i++) {
+        input[i] = static_cast<float>(i % 7) - 3.0f;
+      }
+      ASSERT_EQ(kTfLiteOk, interpreter->Invoke());
+    }
+    // The delegate kept the graph delegated.
+    ASSERT_EQ(1, delegate_interpreter->execution_plan().size());
+
+    const float* delegate_output =
+        delegate_interpreter->typed_output_tensor<float>(0);
+    const float* default_output =
+        default_interpreter->typed_output_tensor<float>(0);
+    for (int i = 0; i < batch_size * 3 * 3 * 4; i++) {
+      EXPECT_NEAR(default_output[i], delegate_output[i],
+                  1.0e-4f * std::max(1.0f, std::abs(default_output[i])))
+          << "batch size " << batch_size << ", element " << i;
+    }
+  }
+}
+
 }  // namespace xnnpack
 }  // namespace tflite
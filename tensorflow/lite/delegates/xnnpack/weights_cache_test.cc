@@ -13,7 +13,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <cstdio>
 #include <memory>  // For std::unique_ptr.
+#include <string>
 #include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
@@ -164,6 +167,53 @@ TEST(XNNPACK_WEIGHTS_CACHE, SoftFinalization) {
   ASSERT_EQ(kTfLiteOk, interpreter2->Invoke());
 }
 
+TEST(XNNPACK_WEIGHTS_CACHE, UnpackedWeightsFile) {
+  std::vector<char> buffer = Conv2DTester()
+                                 .InputChannels(3)
+                                 .OutputChannels(5)
+                                 .InputHeight(4)
+                                 .InputWidth(4)
+                                 .KernelHeight(3)
+                                 .KernelWidth(3)
+                                 .FP16Weights()
+                                 .CreateTfLiteModel();
+  const Model* model = GetModel(buffer.data());
+  ops::builtin::BuiltinOpResolverWithoutDefaultDelegates resolver;
+
+  const std::string path = ::testing::TempDir() + "/unpacked_weights";
+  std::remove(path.c_str());
+  TfLiteXNNPackDelegateOptions delegate_options =
+      TfLiteXNNPackDelegateOptionsDefault();
+  delegate_options.weights_cache_file_path = path.c_str();
+
+  // The first delegate unpacks the FP16 weights and writes them to the file,
+  // the second one maps them.
+  std::vector<float> outputs[2];
+  for (std::vector<float>& output : outputs) {
+    std::unique_ptr<Interpreter> interpreter;
+    ASSERT_EQ(kTfLiteOk, InterpreterBuilder(model, resolver)(&interpreter));
+    std::unique_ptr<TfLiteDelegate, decltype(&TfLiteXNNPackDelegateDelete)>
+        delegate(TfLiteXNNPackDelegateCreate(&delegate_options),
+                 TfLiteXNNPackDelegateDelete);
+    ASSERT_EQ(kTfLiteOk, interpreter->ModifyGraphWithDelegate(delegate.get()));
+    ASSERT_EQ(kTfLiteOk, interpreter->AllocateTensors());
+
+    FILE* file = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    std::fclose(file);
+
+    float* input = interpreter->typed_input_tensor<float>(0);
+    std::fill(input, input + 3 * 4 * 4, 0.5f);
+    ASSERT_EQ(kTfLiteOk, interpreter->Invoke());
+    const TfLiteTensor* output_tensor =
+        interpreter->tensor(interpreter->outputs()[0]);
+    const float* output_data = interpreter->typed_output_tensor<float>(0);
+    output.assign(output_data,
+                  output_data + output_tensor->bytes / sizeof(float));
+  }
+  EXPECT_EQ(outputs[0], outputs[1]);
+}
+
 // Dummy class to use with parameterized test.
 class WeightsCacheTest : public testing::TestWithParam<size_t> {};
 
@@ -20,6 +20,7 @@ limitations under the License.
 #include <cinttypes>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <limits>
 #include <map>
@@ -43,6 +44,7 @@ limitations under the License.
 #include "tensorflow/lite/kernels/kernel_util.h"
 #include "tensorflow/lite/kernels/padding.h"
 #include "tensorflow/lite/minimal_logging.h"
+#include "tensorflow/lite/packed_weights_cache.h"
 #include "tensorflow/lite/tools/optimize/reduced_precision_support.h"
 
 struct TfLiteXNNPackDelegateWeightsCache;
@@ -69,6 +71,37 @@ void CopyTensorDataInt32OrInt64(int64_t* dst, const TfLiteTensor& tensor,
   }
 }
 
+// Names the unpacking of static tensor `input` by the builtin operator
+// `builtin_code`, for its result to be looked up in the file of unpacked
+// weights. Returns false if the result depends on more than the data and the
+// name, in which case the unpacking is not cached.
+bool GetUnpackingName(int builtin_code, const TfLiteTensor& input,
+                      std::string* name) {
+  if (builtin_code != kTfLiteBuiltinDequantize || input.sparsity != nullptr) {
+    return false;
+  }
+  switch (input.type) {
+    case kTfLiteFloat16:
+      *name = "xnnpack/dequantize/fp16";
+      return true;
+    case kTfLiteInt8: {
+      const auto* quant_params =
+          static_cast<const TfLiteAffineQuantization*>(
+              input.quantization.params);
+      if (quant_params == nullptr || quant_params->scale->size != 1) {
+        return false;
+      }
+      char buffer[64];
+      std::snprintf(buffer, sizeof(buffer), "xnnpack/dequantize/int8/%a/%d",
+                    input.params.scale, input.params.zero_point);
+      *name = buffer;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
 xnn_datatype GetXNNPackDatatype(TfLiteContext* context,
                                 const TfLiteTensor& tensor, int t) {
   switch (tensor.type) {
@@ -496,6 +529,16 @@ class Delegate {
     options_ =
         options != nullptr ? *options : TfLiteXNNPackDelegateOptionsDefault();
     workspace_.reset(workspace);
+    if (options_.weights_cache_file_path != nullptr) {
+      unpacked_weights_cache_ = std::make_unique<PackedWeightsCache>(
+          options_.weights_cache_file_path);
+    }
+    if (dynamic_shapes()) {
+      // The shapes of the delegated tensors are propagated by preparing the
+      // original nodes, for the runtimes to be created for them.
+      delegate_.flags |= kTfLiteDelegateFlagsAllowDynamicTensors |
+                         kTfLiteDelegateFlagsRequirePropagatedShapes;
+    }
   }
 
   TfLiteIntArray* PrepareOpsToDelegate(TfLiteContext* context);
@@ -524,6 +567,13 @@ class Delegate {
 
   bool handle_variable_ops() const { return options_.handle_variable_ops; }
 
+  // Resource tensors are bound to XNNPACK values in the order the subgraphs
+  // are created, so the subgraphs handling variables are not created again.
+  bool dynamic_shapes() const {
+    return !handle_variable_ops() &&
+           (options_.flags & TFLITE_XNNPACK_DELEGATE_FLAG_DYNAMIC_SHAPES) != 0;
+  }
+
   pthreadpool_t threadpool() const {
 #if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
     return nullptr;
@@ -542,6 +592,20 @@ class Delegate {
 
   xnn_workspace_t workspace() const { return workspace_.get(); }
 
+  // Returns the unpacked data of quasi-static tensor t, or nullptr if t is not
+  // quasi-static.
+  const char* static_unpacked_data(int t) const {
+    const auto mapped_it = static_mapped_data_map_.find(t);
+    if (mapped_it != static_mapped_data_map_.end()) {
+      return mapped_it->second;
+    }
+    const auto it = static_unpacked_data_map_.find(t);
+    if (it != static_unpacked_data_map_.end()) {
+      return static_unpacked_data_.data() + it->second;
+    }
+    return nullptr;
+  }
+
   TfLiteStatus AssociateVariableWithDimAndType(int local_id,
                                                const TfLiteTensor* tensor,
                                                TfLiteContext* logging_context) {
@@ -590,6 +654,12 @@ class Delegate {
   // Mapping from a tensor index for a quasi-static tensor to the offset to
   // its unpacked data within static_unpacked_data_.
   std::unordered_map<int, size_t> static_unpacked_data_map_;
+  // Mapping from a tensor index for a quasi-static tensor to its unpacked data
+  // mapped from unpacked_weights_cache_.
+  std::unordered_map<int, const char*> static_mapped_data_map_;
+  // File of the unpacked data of quasi-static tensors, if
+  // options_.weights_cache_file_path is set.
+  std::unique_ptr<PackedWeightsCache> unpacked_weights_cache_;
   // Set of indices of nodes which unpack static data, e.g. Dequantize
   // operators which convert FP16 static weights to FP32. These nodes are simply
   // ignored in the delegate implementation, because their outputs are
@@ -649,6 +719,21 @@ class Subgraph {
   static Subgraph* Create(TfLiteContext* context,
                           const TfLiteDelegateParams* params,
                           Delegate& delegate) {
+    std::unordered_set<int> externals;
+    xnn_runtime_t runtime =
+        CreateRuntime(context, params, delegate, &externals);
+    if (runtime == nullptr) {
+      return nullptr;
+    }
+    return new Subgraph(context, params, delegate, runtime, externals);
+  }
+
+  // Creates an XNNPACK runtime for the nodes replaced by the subgraph, with
+  // the current shapes of their tensors. Returns nullptr on error.
+  static xnn_runtime_t CreateRuntime(TfLiteContext* context,
+                                     const TfLiteDelegateParams* params,
+                                     Delegate& delegate,
+                                     std::unordered_set<int>* externals_out) {
     // Convert subgraph inputs and outputs to hash sets for faster lookup.
     const std::unordered_set<int> inputs(
         &params->input_tensors->data[0],
@@ -658,7 +743,7 @@ class Subgraph {
       const int output_tensor_idx = params->output_tensors->data[o];
       // Exclude quasi-static tensors and shared variable tensors which may have
       // become subgraph outputs after partitioning.
-      if (delegate.static_unpacked_data_map_.count(output_tensor_idx) == 0 &&
+      if (delegate.static_unpacked_data(output_tensor_idx) == nullptr &&
           context->tensors[output_tensor_idx].type != kTfLiteResource) {
         outputs.insert(output_tensor_idx);
       }
@@ -843,10 +928,7 @@ class Subgraph {
         data = context->tensors[t].data.raw_const;
       } else {
         // Check for quasi-static data.
-        const auto it = delegate.static_unpacked_data_map_.find(t);
-        if (it != delegate.static_unpacked_data_map_.end()) {
-          data = delegate.static_unpacked_data_.data() + it->second;
-        }
+        data = delegate.static_unpacked_data(t);
       }
       if (inputs.count(t) != 0) {
         flags |= XNN_VALUE_FLAG_EXTERNAL_INPUT;
@@ -911,6 +993,10 @@ class Subgraph {
          delegate.static_unpacked_data_map_) {
       quasi_static_tensors.insert(entry.first);
     }
+    for (const std::pair<const int, const char*>& entry :
+         delegate.static_mapped_data_map_) {
+      quasi_static_tensors.insert(entry.first);
+    }
 
     // Create XNNPACK nodes for TFLite delegate nodes
     for (int i = 0; i < params->nodes_to_replace->size; i++) {
@@ -972,10 +1058,45 @@ class Subgraph {
       return nullptr;
     }
 
-    return new Subgraph(delegate, runtime_ptr, externals);
+    *externals_out = std::move(externals);
+    return runtime_ptr;
   }
 
-  TfLiteStatus Prepare(TfLiteContext* context) { return kTfLiteOk; }
+  TfLiteStatus Prepare(TfLiteContext* context) {
+    if (!delegate_.dynamic_shapes()) {
+      return kTfLiteOk;
+    }
+    std::vector<int> input_shapes = GetInputShapes(context);
+    if (input_shapes == input_shapes_) {
+      return kTfLiteOk;
+    }
+
+    std::unique_ptr<xnn_runtime, decltype(&xnn_delete_runtime)> runtime(
+        nullptr, &xnn_delete_runtime);
+    auto it = cached_runtimes_.find(input_shapes);
+    if (it != cached_runtimes_.end()) {
+      runtime = std::move(it->second);
+      cached_runtimes_.erase(it);
+    } else {
+      const TfLiteDelegateParams params = {
+          /*delegate=*/nullptr, nodes_to_replace_.get(), input_tensors_.get(),
+          output_tensors_.get()};
+      std::unordered_set<int> externals;
+      runtime.reset(CreateRuntime(context, &params, delegate_, &externals));
+      if (runtime == nullptr) {
+        return kTfLiteError;
+      }
+    }
+    cached_runtimes_.emplace(std::move(input_shapes_), std::move(runtime_));
+    runtime_ = std::move(runtime);
+    input_shapes_ = std::move(input_shapes);
+
+    // The new runtime needs setting up with the external tensors.
+    for (std::pair<const int, void*>& io_info : externals_) {
+      io_info.second = nullptr;
+    }
+    return kTfLiteOk;
+  }
 
   TfLiteStatus Invoke(TfLiteContext* context) {
     bool any_pointers_changed = false;
@@ -5499,19 +5620,57 @@ class Subgraph {
   }
 
  private:
-  Subgraph(const Delegate& delegate, xnn_runtime_t runtime,
+  Subgraph(TfLiteContext* context, const TfLiteDelegateParams* params,
+           Delegate& delegate, xnn_runtime_t runtime,
            const std::unordered_set<int>& externals)
-      : runtime_(runtime, &xnn_delete_runtime) {
+      : delegate_(delegate), runtime_(runtime, &xnn_delete_runtime) {
     for (int t : externals) {
       externals_[t] = nullptr;
     }
     has_variables_ = !delegate.GetAllVariableTensors().empty();
+    if (delegate.dynamic_shapes()) {
+      nodes_to_replace_.reset(TfLiteIntArrayCopy(params->nodes_to_replace));
+      input_tensors_.reset(TfLiteIntArrayCopy(params->input_tensors));
+      output_tensors_.reset(TfLiteIntArrayCopy(params->output_tensors));
+      input_shapes_ = GetInputShapes(context);
+    }
   }
 
+  // Returns the ranks and dimensions of the input tensors, concatenated.
+  std::vector<int> GetInputShapes(const TfLiteContext* context) const {
+    std::vector<int> input_shapes;
+    for (int i = 0; i < input_tensors_->size; i++) {
+      const TfLiteIntArray* dims =
+          context->tensors[input_tensors_->data[i]].dims;
+      input_shapes.push_back(dims->size);
+      input_shapes.insert(input_shapes.end(), &dims->data[0],
+                          &dims->data[dims->size]);
+    }
+    return input_shapes;
+  }
+
+  // Delegate which created the subgraph, for creating runtimes for other
+  // input shapes.
+  Delegate& delegate_;
+
   // XNNPACK Runtime (subgraph + workspace) with smart-pointer for lifetime
   // management.
   std::unique_ptr<xnn_runtime, decltype(&xnn_delete_runtime)> runtime_{
       nullptr, &xnn_delete_runtime};
+  // Nodes, inputs and outputs of the subgraph, if the delegate creates
+  // runtimes for other input shapes.
+  std::unique_ptr<TfLiteIntArray, decltype(&TfLiteIntArrayFree)>
+      nodes_to_replace_{nullptr, &TfLiteIntArrayFree};
+  std::unique_ptr<TfLiteIntArray, decltype(&TfLiteIntArrayFree)>
+      input_tensors_{nullptr, &TfLiteIntArrayFree};
+  std::unique_ptr<TfLiteIntArray, decltype(&TfLiteIntArrayFree)>
+      output_tensors_{nullptr, &TfLiteIntArrayFree};
+  // Input shapes of runtime_, as returned by GetInputShapes.
+  std::vector<int> input_shapes_;
+  // Runtimes created for other input shapes, by the input shapes.
+  std::map<std::vector<int>,
+           std::unique_ptr<xnn_runtime, decltype(&xnn_delete_runtime)>>
+      cached_runtimes_;
   // Mapping from TFLite Tensor IDs (same as XNNPACK Value IDs) for
   // input/output tensors in the delegated subgraph to their data locations.
   std::unordered_map<int, void*> externals_;
@@ -5528,6 +5687,7 @@ class Subgraph {
 TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
   // Clear previous data, in case the delegate is reused without re-creation.
   static_unpacked_data_map_.clear();
+  static_mapped_data_map_.clear();
   static_unpacked_data_.clear();
   static_unpack_nodes_.clear();
   static_sparse_weights_.clear();
@@ -5675,6 +5835,7 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
             });
 
   // Unpack static data of all tensors
+  bool unpacked_weights_to_cache = false;
   for (int t : sorted_quasi_static_tensors_to_unpack) {
     const int producer_index = quasi_static_tensors_producers[t];
     // Check if TFLite nodes can be delegated to XNNPACK
@@ -5707,9 +5868,9 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
     const TfLiteTensor& input_tensor = context->tensors[node->inputs->data[0]];
 
     // Consider the case when the input to unpacking node is quasi-static.
-    const auto static_unpacked_input_it_ =
-        static_unpacked_data_map_.find(node->inputs->data[0]);
-    if (static_unpacked_input_it_ == static_unpacked_data_map_.end()) {
+    const bool static_unpacked_input =
+        static_unpacked_data(node->inputs->data[0]) != nullptr;
+    if (!static_unpacked_input) {
       if (input_tensor.allocation_type != kTfLiteMmapRo) {
         TF_LITE_KERNEL_LOG(
             context,
@@ -5743,6 +5904,27 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
       }
     }
 
+    // Map the data unpacked by an earlier delegate instance, if any.
+    std::string unpacking_name;
+    uint64_t unpacked_weights_key = 0;
+    const bool cache_unpacked_weights =
+        unpacked_weights_cache_ != nullptr &&
+        GetUnpackingName(registration->builtin_code, input_tensor,
+                         &unpacking_name);
+    if (cache_unpacked_weights) {
+      unpacked_weights_key = PackedWeightsCache::Key(
+          unpacking_name.c_str(),
+          static_unpacked_input ? static_unpacked_data(node->inputs->data[0])
+                                : input_tensor.data.raw_const,
+          input_tensor.bytes);
+      const void* mapped_data = unpacked_weights_cache_->Lookup(
+          unpacked_weights_key, context->tensors[t].bytes);
+      if (mapped_data != nullptr) {
+        static_mapped_data_map_[t] = static_cast<const char*>(mapped_data);
+        continue;
+      }
+    }
+
     // Align to XNN_EXTRA_BYTES bytes
     while (static_unpacked_data_.size() % XNN_EXTRA_BYTES != 0) {
       static_unpacked_data_.push_back(0);
@@ -5752,8 +5934,8 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
 
     char* unpacked_data = static_unpacked_data_.data() + tensor_offset;
     const char* packed_data =
-        static_unpacked_input_it_ != static_unpacked_data_map_.end()
-            ? static_unpacked_data_.data() + static_unpacked_input_it_->second
+        static_unpacked_input
+            ? static_unpacked_data(node->inputs->data[0])
             : static_cast<const char*>(input_tensor.data.data);
     switch (registration->builtin_code) {
       case kTfLiteBuiltinDequantize: {
@@ -5860,6 +6042,15 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
     }
 
     static_unpacked_data_map_[t] = tensor_offset;
+    if (cache_unpacked_weights) {
+      unpacked_weights_cache_->Insert(unpacked_weights_key, unpacked_data,
+                                      context->tensors[t].bytes);
+      unpacked_weights_to_cache = true;
+    }
+  }
+  if (unpacked_weights_to_cache) {
+    // On failure, the next delegate instances unpack the weights again.
+    unpacked_weights_cache_->Flush();
   }
 
   // Add nodes that unpack static data consumed by delegated nodes.
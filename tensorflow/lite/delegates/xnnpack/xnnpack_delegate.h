@@ -29,6 +29,14 @@ extern "C" {
 #define TFLITE_XNNPACK_DELEGATE_FLAG_QU8 0x00000002
 // Force FP16 inference for FP32 operators.
 #define TFLITE_XNNPACK_DELEGATE_FLAG_FORCE_FP16 0x00000004
+// Keep the delegation when the input shapes change, and switch to an XNNPACK
+// runtime created for the new shapes instead, e.g. for a variable batch size.
+// The runtimes are cached by the input shapes, so each set of shapes is only
+// paid for once; a shared weights cache avoids packing the weights again for
+// every runtime. Ignored if handle_variable_ops is set.
+//
+// WARNING: This API is experimental and subject to change.
+#define TFLITE_XNNPACK_DELEGATE_FLAG_DYNAMIC_SHAPES 0x00000008
 
 struct TfLiteXNNPackDelegateWeightsCache;
 
@@ -40,6 +48,7 @@ typedef struct {
   // - TFLITE_XNNPACK_DELEGATE_FLAG_QS8
   // - TFLITE_XNNPACK_DELEGATE_FLAG_QU8
   // - TFLITE_XNNPACK_DELEGATE_FLAG_FORCE_FP16
+  // - TFLITE_XNNPACK_DELEGATE_FLAG_DYNAMIC_SHAPES
   uint32_t flags;
   // Cache for packed weights, can be shared between multiple instances of
   // delegates.
@@ -47,6 +56,14 @@ typedef struct {
   // Whether READ_VARIABLE, ASSIGN_VARIABLE, and VARIABLE_HANDLE operations
   // should be handled by XNNPACK.
   bool handle_variable_ops;
+  // Path to a file of the static weights unpacked by the delegate (e.g.
+  // dequantized from FP16), for the delegate instances created later, in this
+  // or other processes, to map them instead of unpacking them again. The file
+  // is created or updated when the delegate unpacks weights missing from it.
+  // The path is copied. NULL disables the file.
+  //
+  // WARNING: This API is experimental and subject to change.
+  const char* weights_cache_file_path;
 } TfLiteXNNPackDelegateOptions;
 
 // Returns a structure with the default XNNPack delegate options.
@@ -63,7 +80,9 @@ TFL_CAPI_EXPORT TfLiteDelegate* TfLiteXNNPackDelegateCreate(
 
 // Performs the same task as TfLiteXNNPackDelegateCreate, with one exception.
 // If the context passed contains a non-null xnnpack_threadpool field,
-// we will use it as the threadpool for the delegate created.
+// we will use it as the threadpool for the delegate created. This is the
+// pthreadpool of the ExternalThreadPool set on the cpu backend context, if it
+// has one.
 TfLiteDelegate* TfLiteXNNPackDelegateCreateWithThreadpool(
     const TfLiteXNNPackDelegateOptions* options, TfLiteContext* context);
 
@@ -0,0 +1,211 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/experimental/batching/batching_interpreter.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstring>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/minimal_logging.h"
+
+namespace tflite {
+namespace batching {
+
+std::unique_ptr<BatchingInterpreter> BatchingInterpreter::Create(
+    std::unique_ptr<Interpreter> interpreter, const BatchingOptions& options) {
+  if (interpreter == nullptr || options.max_batch_size < 1 ||
+      options.batch_timeout_micros < 0) {
+    TFLITE_LOG(TFLITE_LOG_ERROR, "Invalid batching options.");
+    return nullptr;
+  }
+  const std::vector<int>& allowed_sizes = options.allowed_batch_sizes;
+  if (!allowed_sizes.empty() &&
+      (!std::is_sorted(allowed_sizes.begin(), allowed_sizes.end()) ||
+       allowed_sizes.front() < 1 ||
+       allowed_sizes.back() != options.max_batch_size)) {
+    TFLITE_LOG(TFLITE_LOG_ERROR,
+               "The allowed batch sizes must be increasing and end with the "
+               "max batch size.");
+    return nullptr;
+  }
+
+  std::unique_ptr<BatchingInterpreter> batching_interpreter(
+      new BatchingInterpreter(std::move(interpreter), options));
+  Interpreter* const interp = batching_interpreter->interpreter_.get();
+  for (int input : interp->inputs()) {
+    const TfLiteTensor* tensor = interp->tensor(input);
+    if (tensor->dims == nullptr || tensor->dims->size < 1 ||
+        tensor->type == kTfLiteString) {
+      TFLITE_LOG(TFLITE_LOG_ERROR, "Input %d can't be batched.", input);
+      return nullptr;
+    }
+    std::vector<int> shape(tensor->dims->data,
+                           tensor->dims->data + tensor->dims->size);
+    shape[0] = 1;
+    batching_interpreter->input_example_shapes_.push_back(std::move(shape));
+  }
+  // Prepares the graph for a single example to get the size of the examples.
+  if (batching_interpreter->ResizeBatch(1) != kTfLiteOk) return nullptr;
+  for (int input : interp->inputs()) {
+    batching_interpreter->input_example_bytes_.push_back(
+        interp->tensor(input)->bytes);
+  }
+  for (int output : interp->outputs()) {
+    const TfLiteTensor* tensor = interp->tensor(output);
+    if (tensor->dims == nullptr || tensor->dims->size < 1 ||
+        tensor->dims->data[0] != 1 || tensor->type == kTfLiteString ||
+        tensor->allocation_type == kTfLiteDynamic) {
+      TFLITE_LOG(TFLITE_LOG_ERROR, "Output %d can't be batched.", output);
+      return nullptr;
+    }
+    batching_interpreter->output_example_bytes_.push_back(tensor->bytes);
+  }
+
+  batching_interpreter->batching_thread_ = std::make_unique<std::thread>(
+      [self = batching_interpreter.get()]() { self->RunBatches(); });
+  return batching_interpreter;
+}
+
+BatchingInterpreter::BatchingInterpreter(
+    std::unique_ptr<Interpreter> interpreter, const BatchingOptions& options)
+    : interpreter_(std::move(interpreter)), options_(options) {}
+
+BatchingInterpreter::~BatchingInterpreter() {
+  if (batching_thread_ == nullptr) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  requests_changed_.notify_one();
+  batching_thread_->join();
+}
+
+TfLiteStatus BatchingInterpreter::Invoke(const std::vector<const void*>& inputs,
+                                         const std::vector<void*>& outputs) {
+  if (inputs.size() != input_example_bytes_.size() ||
+      outputs.size() != output_example_bytes_.size()) {
+    return kTfLiteError;
+  }
+  Request request;
+  request.inputs = &inputs;
+  request.outputs = &outputs;
+  request.enqueue_time = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    requests_.push_back(&request);
+  }
+  requests_changed_.notify_one();
+  request.done.WaitForNotification();
+  return request.status;
+}
+
+TfLiteStatus BatchingInterpreter::ResizeBatch(int batch_size) {
+  const std::vector<int>& inputs = interpreter_->inputs();
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    std::vector<int> shape = input_example_shapes_[i];
+    shape[0] = batch_size;
+    if (interpreter_->ResizeInputTensor(inputs[i], shape) != kTfLiteOk) {
+      return kTfLiteError;
+    }
+  }
+  if (interpreter_->AllocateTensors() != kTfLiteOk) return kTfLiteError;
+  current_batch_size_ = batch_size;
+  return kTfLiteOk;
+}
+
+int BatchingInterpreter::PaddedBatchSize(int num_requests) const {
+  const std::vector<int>& allowed_sizes = options_.allowed_batch_sizes;
+  if (allowed_sizes.empty()) return num_requests;
+  return *std::lower_bound(allowed_sizes.begin(), allowed_sizes.end(),
+                           num_requests);
+}
+
+void BatchingInterpreter::RunBatches() {
+  const auto timeout =
+      std::chrono::microseconds(options_.batch_timeout_micros);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    requests_changed_.wait(lock,
+                           [this]() { return stopped_ || !requests_.empty(); });
+    // The pending requests are run before stopping.
+    if (requests_.empty()) return;
+    const size_t max_batch_size = options_.max_batch_size;
+    requests_changed_.wait_until(
+        lock, requests_.front()->enqueue_time + timeout, [&]() {
+          return stopped_ || requests_.size() >= max_batch_size;
+        });
+
+    const size_t batch_size = std::min(requests_.size(), max_batch_size);
+    std::vector<Request*> batch(requests_.begin(),
+                                requests_.begin() + batch_size);
+    requests_.erase(requests_.begin(), requests_.begin() + batch_size);
+    lock.unlock();
+    const TfLiteStatus status = RunBatch(batch);
+    for (Request* request : batch) {
+      request->status = status;
+      request->done.Notify();
+    }
+    lock.lock();
+  }
+}
+
+TfLiteStatus BatchingInterpreter::RunBatch(const std::vector<Request*>& batch) {
+  const int batch_size = PaddedBatchSize(batch.size());
+  if (batch_size != current_batch_size_ &&
+      ResizeBatch(batch_size) != kTfLiteOk) {
+    TFLITE_LOG(TFLITE_LOG_ERROR,
+               "Failed to resize the inputs to a batch of %d.", batch_size);
+    // Prepares the graph again for the next batch.
+    current_batch_size_ = 0;
+    return kTfLiteError;
+  }
+
+  for (size_t i = 0; i < input_example_bytes_.size(); ++i) {
+    const size_t example_bytes = input_example_bytes_[i];
+    char* data = interpreter_->input_tensor(i)->data.raw;
+    for (const Request* request : batch) {
+      std::memcpy(data, (*request->inputs)[i], example_bytes);
+      data += example_bytes;
+    }
+    std::memset(data, 0, (batch_size - batch.size()) * example_bytes);
+  }
+
+  if (interpreter_->Invoke() != kTfLiteOk) return kTfLiteError;
+
+  for (size_t i = 0; i < output_example_bytes_.size(); ++i) {
+    const size_t example_bytes = output_example_bytes_[i];
+    const TfLiteTensor* output = interpreter_->output_tensor(i);
+    if (output->bytes != batch_size * example_bytes) {
+      TFLITE_LOG(TFLITE_LOG_ERROR,
+                 "Output %zu doesn't have the batch as its first dimension.",
+                 i);
+      return kTfLiteError;
+    }
+    const char* data = output->data.raw;
+    for (const Request* request : batch) {
+      std::memcpy((*request->outputs)[i], data, example_bytes);
+      data += example_bytes;
+    }
+  }
+  return kTfLiteOk;
+}
+
+}  // namespace batching
+}  // namespace tflite
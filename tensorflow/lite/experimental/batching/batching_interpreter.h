@@ -0,0 +1,135 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_BATCHING_BATCHING_INTERPRETER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_BATCHING_BATCHING_INTERPRETER_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>   // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/interpreter.h"
+
+namespace tflite {
+namespace batching {
+
+// Options of a BatchingInterpreter. They mirror the options of the batch
+// schedulers of tensorflow/core/kernels/batching_util.
+struct BatchingOptions {
+  // The largest number of requests run by a single Invoke of the interpreter.
+  int max_batch_size = 8;
+
+  // How long the first request of a batch waits for more requests before the
+  // batch is run, in microseconds.
+  int64_t batch_timeout_micros = 1000;
+
+  // If not empty, the only batch sizes the interpreter is run with, in
+  // increasing order, the last one being max_batch_size. A batch is padded
+  // with zeros up to the next allowed size, which bounds the number of
+  // distinct input shapes the interpreter is prepared for.
+  std::vector<int> allowed_batch_sizes;
+};
+
+// Runs the single-example requests of many threads batched together, which
+// amortizes the overhead of Invoke for small models served at a high rate.
+//
+// The requests are queued, and a batch is closed when it has
+// max_batch_size requests or when its first request has waited for
+// batch_timeout_micros. The batching thread then resizes the first dimension
+// of the inputs to the batch size if it changed, copies the inputs of the
+// requests, invokes the interpreter once, and copies each request's slice of
+// the outputs.
+//
+// Resizing the inputs prepares the graph again, so InterpreterOptions::
+// SetPrepareOnlyAffectedOps() or allowed_batch_sizes keep that cheap.
+//
+// WARNING: This is an experimental API and subject to change.
+class BatchingInterpreter {
+ public:
+  // Takes ownership of `interpreter`, whose inputs and outputs must all have
+  // the batch as their first dimension, and must not be strings or have
+  // dynamic shapes. The interpreter is only used by the batching thread from
+  // then on. Returns nullptr if the interpreter can't be batched.
+  static std::unique_ptr<BatchingInterpreter> Create(
+      std::unique_ptr<Interpreter> interpreter,
+      const BatchingOptions& options);
+
+  // Runs the pending requests before returning.
+  ~BatchingInterpreter();
+
+  // Runs a single example: `inputs[i]` holds one example of the i-th input of
+  // the interpreter, i.e. input_example_bytes(i) bytes, and `outputs[i]`
+  // receives one example of the i-th output. Blocks until the batch of the
+  // request has run, and returns the status of its Invoke.
+  // Thread-safe.
+  TfLiteStatus Invoke(const std::vector<const void*>& inputs,
+                      const std::vector<void*>& outputs);
+
+  size_t input_example_bytes(int i) const { return input_example_bytes_[i]; }
+  size_t output_example_bytes(int i) const { return output_example_bytes_[i]; }
+
+  BatchingInterpreter(const BatchingInterpreter&) = delete;
+  BatchingInterpreter& operator=(const BatchingInterpreter&) = delete;
+
+ private:
+  struct Request {
+    const std::vector<const void*>* inputs;
+    const std::vector<void*>* outputs;
+    std::chrono::steady_clock::time_point enqueue_time;
+    TfLiteStatus status = kTfLiteOk;
+    absl::Notification done;
+  };
+
+  BatchingInterpreter(std::unique_ptr<Interpreter> interpreter,
+                      const BatchingOptions& options);
+
+  // Resizes the inputs to a batch of `batch_size` examples.
+  TfLiteStatus ResizeBatch(int batch_size);
+
+  // Returns the batch size the interpreter runs `num_requests` requests with.
+  int PaddedBatchSize(int num_requests) const;
+
+  // Runs the queued requests until the interpreter is destroyed.
+  void RunBatches();
+
+  TfLiteStatus RunBatch(const std::vector<Request*>& batch);
+
+  const std::unique_ptr<Interpreter> interpreter_;
+  const BatchingOptions options_;
+
+  // The shape of one example of each input, with a first dimension of 1.
+  std::vector<std::vector<int>> input_example_shapes_;
+  std::vector<size_t> input_example_bytes_;
+  std::vector<size_t> output_example_bytes_;
+  int current_batch_size_ = 1;
+
+  std::mutex mutex_;
+  std::condition_variable requests_changed_;
+  std::deque<Request*> requests_;
+  bool stopped_ = false;
+  std::unique_ptr<std::thread> batching_thread_;
+};
+
+}  // namespace batching
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_BATCHING_BATCHING_INTERPRETER_H_
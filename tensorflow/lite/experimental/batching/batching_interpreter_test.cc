@@ -0,0 +1,162 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/experimental/batching/batching_interpreter.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/interpreter.h"
+
+namespace tflite {
+namespace batching {
+namespace {
+
+using ::testing::ElementsAre;
+
+// The batch sizes the TimesTwo op was invoked with.
+std::vector<int>* invoked_batch_sizes = nullptr;
+
+TfLiteStatus TimesTwoPrepare(TfLiteContext* context, TfLiteNode* node) {
+  const TfLiteTensor* input = &context->tensors[node->inputs->data[0]];
+  TfLiteTensor* output = &context->tensors[node->outputs->data[0]];
+  return context->ResizeTensor(context, output,
+                               TfLiteIntArrayCopy(input->dims));
+}
+
+TfLiteStatus TimesTwoInvoke(TfLiteContext* context, TfLiteNode* node) {
+  const TfLiteTensor* input = &context->tensors[node->inputs->data[0]];
+  TfLiteTensor* output = &context->tensors[node->outputs->data[0]];
+  for (size_t i = 0; i < input->bytes / sizeof(float); ++i) {
+    output->data.f[i] = 2 * input->data.f[i];
+  }
+  invoked_batch_sizes->push_back(input->dims->data[0]);
+  return kTfLiteOk;
+}
+
+// Returns an interpreter doubling its [batch, 2] float input.
+std::unique_ptr<Interpreter> CreateTimesTwoInterpreter() {
+  auto interpreter = std::make_unique<Interpreter>();
+  interpreter->AddTensors(2);
+  interpreter->SetInputs({0});
+  interpreter->SetOutputs({1});
+  TfLiteQuantizationParams quant;
+  interpreter->SetTensorParametersReadWrite(0, kTfLiteFloat32, "input", {1, 2},
+                                            quant);
+  interpreter->SetTensorParametersReadWrite(1, kTfLiteFloat32, "output",
+                                            {1, 2}, quant);
+  static TfLiteRegistration registration = {/*init=*/nullptr,
+                                            /*free=*/nullptr, TimesTwoPrepare,
+                                            TimesTwoInvoke};
+  interpreter->AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr,
+                                     &registration);
+  return interpreter;
+}
+
+class BatchingInterpreterTest : public ::testing::Test {
+ protected:
+  void SetUp() override { invoked_batch_sizes = &batch_sizes_; }
+  void TearDown() override { invoked_batch_sizes = nullptr; }
+
+  std::vector<int> batch_sizes_;
+};
+
+TEST_F(BatchingInterpreterTest, SingleRequest) {
+  BatchingOptions options;
+  options.batch_timeout_micros = 0;
+  auto batching_interpreter =
+      BatchingInterpreter::Create(CreateTimesTwoInterpreter(), options);
+  ASSERT_NE(batching_interpreter, nullptr);
+  EXPECT_EQ(batching_interpreter->input_example_bytes(0), 2 * sizeof(float));
+  EXPECT_EQ(batching_interpreter->output_example_bytes(0), 2 * sizeof(float));
+
+  float input[] = {1, 2};
+  float output[2];
+  ASSERT_EQ(batching_interpreter->Invoke({input}, {output}), kTfLiteOk);
+  EXPECT_THAT(output, ElementsAre(2, 4));
+  EXPECT_EQ(batching_interpreter->Invoke({input, input}, {output}),
+            kTfLiteError);
+
+  batching_interpreter.reset();
+  EXPECT_THAT(batch_sizes_, ElementsAre(1));
+}
+
+TEST_F(BatchingInterpreterTest, ConcurrentRequestsAreBatched) {
+  BatchingOptions options;
+  options.max_batch_size = 4;
+  // The batch is only closed when it's full.
+  options.batch_timeout_micros = 60 * 1000 * 1000;
+  auto batching_interpreter =
+      BatchingInterpreter::Create(CreateTimesTwoInterpreter(), options);
+  ASSERT_NE(batching_interpreter, nullptr);
+
+  std::vector<std::vector<float>> outputs(4, std::vector<float>(2));
+  std::vector<TfLiteStatus> statuses(4);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&, i]() {
+      const float input[] = {static_cast<float>(i), -1.f};
+      statuses[i] =
+          batching_interpreter->Invoke({input}, {outputs[i].data()});
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(statuses[i], kTfLiteOk);
+    EXPECT_THAT(outputs[i], ElementsAre(2 * i, -2));
+  }
+  batching_interpreter.reset();
+  EXPECT_THAT(batch_sizes_, ElementsAre(4));
+}
+
+TEST_F(BatchingInterpreterTest, PadsToAllowedBatchSizes) {
+  BatchingOptions options;
+  options.max_batch_size = 4;
+  options.batch_timeout_micros = 0;
+  options.allowed_batch_sizes = {2, 4};
+  auto batching_interpreter =
+      BatchingInterpreter::Create(CreateTimesTwoInterpreter(), options);
+  ASSERT_NE(batching_interpreter, nullptr);
+
+  float input[] = {3, 4};
+  float output[2];
+  ASSERT_EQ(batching_interpreter->Invoke({input}, {output}), kTfLiteOk);
+  EXPECT_THAT(output, ElementsAre(6, 8));
+  ASSERT_EQ(batching_interpreter->Invoke({input}, {output}), kTfLiteOk);
+
+  batching_interpreter.reset();
+  EXPECT_THAT(batch_sizes_, ElementsAre(2, 2));
+}
+
+TEST_F(BatchingInterpreterTest, InvalidOptions) {
+  BatchingOptions options;
+  options.max_batch_size = 0;
+  EXPECT_EQ(BatchingInterpreter::Create(CreateTimesTwoInterpreter(), options),
+            nullptr);
+
+  options.max_batch_size = 4;
+  options.allowed_batch_sizes = {1, 2};
+  EXPECT_EQ(BatchingInterpreter::Create(CreateTimesTwoInterpreter(), options),
+            nullptr);
+}
+
+}  // namespace
+}  // namespace batching
+}  // namespace tflite
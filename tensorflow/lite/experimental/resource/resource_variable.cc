@@ -15,10 +15,13 @@ limitations under the License.
 
 #include "tensorflow/lite/experimental/resource/resource_variable.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "tensorflow/lite/core/c/c_api_types.h"
 
@@ -82,6 +85,54 @@ TfLiteStatus ResourceVariable::AssignFrom(const TfLiteTensor* tensor) {
   return kTfLiteOk;
 }
 
+TfLiteStatus ResourceVariable::UpdateSliceFrom(const TfLiteTensor* update,
+                                               const int64_t* start_indices) {
+  if (!is_initialized_ || update->type != tensor_.type ||
+      update->dims->size != tensor_.dims->size) {
+    return kTfLiteError;
+  }
+  const int rank = tensor_.dims->size;
+  int64_t num_elements = 1;
+  int64_t num_update_elements = 1;
+  std::vector<int64_t> starts(rank);
+  for (int i = 0; i < rank; ++i) {
+    const int dim = tensor_.dims->data[i];
+    const int update_dim = update->dims->data[i];
+    if (update_dim > dim) return kTfLiteError;
+    starts[i] = std::min<int64_t>(std::max<int64_t>(start_indices[i], 0),
+                                  dim - update_dim);
+    num_elements *= dim;
+    num_update_elements *= update_dim;
+  }
+  if (num_update_elements == 0) return kTfLiteOk;
+  const size_t element_bytes = tensor_.bytes / num_elements;
+  if (update->bytes != num_update_elements * element_bytes) {
+    return kTfLiteError;
+  }
+  if (rank == 0) {
+    memcpy(tensor_.data.raw, update->data.raw, element_bytes);
+    return kTfLiteOk;
+  }
+
+  // Copy the innermost rows of the update one at a time, walking the indices
+  // of the outer dimensions like an odometer.
+  const size_t row_bytes = update->dims->data[rank - 1] * element_bytes;
+  std::vector<int64_t> index(rank, 0);
+  for (const char* src = update->data.raw;
+       src < update->data.raw + update->bytes; src += row_bytes) {
+    int64_t offset = 0;
+    for (int i = 0; i < rank; ++i) {
+      offset = offset * tensor_.dims->data[i] + starts[i] + index[i];
+    }
+    memcpy(tensor_.data.raw + offset * element_bytes, src, row_bytes);
+    for (int i = rank - 2; i >= 0; --i) {
+      if (++index[i] < update->dims->data[i]) break;
+      index[i] = 0;
+    }
+  }
+  return kTfLiteOk;
+}
+
 void CreateResourceVariableIfNotAvailable(ResourceMap* resources,
                                           int resource_id) {
   if (resources->count(resource_id) != 0) {
@@ -15,6 +15,8 @@ limitations under the License.
 #ifndef TENSORFLOW_LITE_EXPERIMENTAL_RESOURCE_RESOURCE_VARIABLE_H_
 #define TENSORFLOW_LITE_EXPERIMENTAL_RESOURCE_RESOURCE_VARIABLE_H_
 
+#include <cstdint>
+
 #include "tensorflow/lite/core/c/common.h"
 #include "tensorflow/lite/experimental/resource/resource_base.h"
 
@@ -38,6 +40,16 @@ class ResourceVariable : public ResourceBase {
   // Assigns data from a tensor. Copies its type, shape and data over.
   TfLiteStatus AssignFrom(const TfLiteTensor* tensor);
 
+  // Copies `update` over the slice of the variable starting at
+  // `start_indices`, which holds one index per dimension, in place. The
+  // indices are clamped so that the slice fits, as in XLA's
+  // DynamicUpdateSlice. The variable must already be initialized with the
+  // type of `update`, and its buffer is never reallocated, so appending to a
+  // variable of its final size (e.g. the key-value cache of a decoder) costs
+  // only the copy of the update.
+  TfLiteStatus UpdateSliceFrom(const TfLiteTensor* update,
+                               const int64_t* start_indices);
+
   // Get the data tensor stored in the resource variable.
   // Returns `nullptr` if the variable is never initialized by calling
   // `AssignFrom`.
@@ -170,6 +170,44 @@ TEST(ResourceTest, AssignDifferentSizeTensor) {
   TfLiteTensorFree(&tensor_b);
 }
 
+TEST(ResourceTest, UpdateSliceInPlace) {
+  ResourceVariable var;
+  TfLiteTensor cache, update;
+  InitTensor({3, 4}, kTfLiteDynamic, 0.0f, &cache);
+  InitTensor({1, 2}, kTfLiteDynamic, 1.0f, &update);
+
+  // The slice can't be updated before the variable is assigned.
+  const int64_t start_indices[2] = {1, 1};
+  EXPECT_EQ(kTfLiteError, var.UpdateSliceFrom(&update, start_indices));
+
+  EXPECT_EQ(kTfLiteOk, var.AssignFrom(&cache));
+  const char* buffer = var.GetTensor()->data.raw;
+  EXPECT_EQ(kTfLiteOk, var.UpdateSliceFrom(&update, start_indices));
+  update.data.f[0] = 2.0f;
+  update.data.f[1] = 3.0f;
+  // The start indices are clamped for the slice to fit.
+  const int64_t clamped_start_indices[2] = {5, 3};
+  EXPECT_EQ(kTfLiteOk, var.UpdateSliceFrom(&update, clamped_start_indices));
+
+  auto* value = var.GetTensor();
+  // The update is written in place.
+  EXPECT_EQ(buffer, value->data.raw);
+  const std::vector<float> expected = {0, 0, 0, 0,  //
+                                       0, 1, 1, 0,  //
+                                       0, 0, 2, 3};
+  EXPECT_EQ(expected, std::vector<float>(value->data.f, value->data.f + 12));
+
+  // The update must have the same rank and fit in the variable.
+  TfLiteTensor large_update;
+  InitTensor({1, 5}, kTfLiteDynamic, 1.0f, &large_update);
+  EXPECT_EQ(kTfLiteError, var.UpdateSliceFrom(&large_update, start_indices));
+
+  // Cleanup
+  TfLiteTensorFree(&cache);
+  TfLiteTensorFree(&update);
+  TfLiteTensorFree(&large_update);
+}
+
 TEST(IsBuiltinResource, IsBuiltinResourceTest) {
   TfLiteTensor tensor;
   tensor.type = kTfLiteResource;
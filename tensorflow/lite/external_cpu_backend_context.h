@@ -15,6 +15,7 @@ limitations under the License.
 #ifndef TENSORFLOW_LITE_EXTERNAL_CPU_BACKEND_CONTEXT_H_
 #define TENSORFLOW_LITE_EXTERNAL_CPU_BACKEND_CONTEXT_H_
 
+#include <functional>
 #include <memory>
 #include <utility>
 
@@ -22,6 +23,31 @@ limitations under the License.
 
 namespace tflite {
 
+class PackedWeightsCache;
+
+// A thread pool of the application that TF Lite can run its parallel work on
+// instead of creating its own threads, so that the threads of TF Lite and of
+// the application don't contend for the same cores.
+class ExternalThreadPool {
+ public:
+  virtual ~ExternalThreadPool() {}
+
+  // The number of threads running the tasks, including the calling thread.
+  virtual int NumThreads() const = 0;
+
+  // Runs 'task(i)' for each i in [0, num_tasks), possibly concurrently on the
+  // calling thread and the threads of the pool, and returns once they all
+  // returned.
+  virtual void ParallelFor(int num_tasks,
+                           const std::function<void(int)>& task) = 0;
+
+  // Returns the pthreadpool_t the XNNPACK delegate created with the cpu
+  // backend context parallelizes on, or null for it to create its own pool. As
+  // XNNPACK only runs on pthreadpool, a pool sharing its threads with XNNPACK
+  // has to be built on it.
+  virtual void* GetPthreadpool() { return nullptr; }
+};
+
 // This is the base class for TF Lite internal backend contexts (like a
 // RUY-based cpu backend context class). A derived internal backend context is
 // generally a collection of utilities (i.e. a thread pool etc.) for TF Lite to
@@ -38,6 +64,15 @@ class TfLiteInternalBackendContext {
   // A context may internally cache prepacked versions of constant tensors for
   // faster computation. This function will clear any caches on the context.
   virtual void ClearCaches() = 0;
+
+  // Runs the parallel work on 'thread_pool' instead of the internal thread
+  // pools of the context, unless it is null. Not owned.
+  virtual void SetExternalThreadPool(ExternalThreadPool* thread_pool) {}
+
+  // Sets how long the idle threads of the internal thread pools busy-wait for
+  // new work before blocking, in milliseconds. Negative keeps the default of
+  // the thread pools.
+  virtual void SetThreadPoolSpinMilliseconds(float milliseconds) {}
 };
 
 // This TfLiteExternalContext-derived class is the default
@@ -92,9 +127,50 @@ class ExternalCpuBackendContext : public TfLiteExternalContext {
     return internal_backend_context_.get();
   }
 
+  // The cache of the weights repacked by the kernels, if any. Not owned.
+  void set_packed_weights_cache(PackedWeightsCache* packed_weights_cache) {
+    packed_weights_cache_ = packed_weights_cache;
+  }
+
+  PackedWeightsCache* packed_weights_cache() const {
+    return packed_weights_cache_;
+  }
+
+  // The thread pool of the application the parallel work of the interpreters
+  // sharing this context runs on, if any. Not owned. Their number of threads
+  // should be set to thread_pool->NumThreads().
+  void set_external_thread_pool(ExternalThreadPool* thread_pool) {
+    external_thread_pool_ = thread_pool;
+    if (internal_backend_context_) {
+      internal_backend_context_->SetExternalThreadPool(thread_pool);
+    }
+  }
+
+  ExternalThreadPool* external_thread_pool() const {
+    return external_thread_pool_;
+  }
+
+  // How long the idle threads of the internal thread pools busy-wait for new
+  // work before blocking, in milliseconds. Spinning lowers the latency of the
+  // back-to-back parallel work of the interpreters, at the cost of the cores
+  // the application could use meanwhile. Negative keeps the default.
+  void set_thread_pool_spin_milliseconds(float milliseconds) {
+    thread_pool_spin_milliseconds_ = milliseconds;
+    if (internal_backend_context_) {
+      internal_backend_context_->SetThreadPoolSpinMilliseconds(milliseconds);
+    }
+  }
+
+  float thread_pool_spin_milliseconds() const {
+    return thread_pool_spin_milliseconds_;
+  }
+
  private:
   // Note the actual internal backend context object is lazily initialized.
   std::unique_ptr<TfLiteInternalBackendContext> internal_backend_context_;
+  PackedWeightsCache* packed_weights_cache_ = nullptr;
+  ExternalThreadPool* external_thread_pool_ = nullptr;
+  float thread_pool_spin_milliseconds_ = -1.0f;
 
   ExternalCpuBackendContext(const ExternalCpuBackendContext&) = delete;
   ExternalCpuBackendContext& operator=(const ExternalCpuBackendContext&) =
@@ -21,6 +21,8 @@ limitations under the License.
 
 namespace tflite {
 
+class SharedMemoryArena;
+
 /// Options class for `Interpreter`.
 /// WARNING: This is an experimental API and subject to change.
 class InterpreterOptions {
@@ -29,7 +31,12 @@ class InterpreterOptions {
       : experimental_preserve_all_tensors_(false),
         experimental_ensure_dynamic_tensors_are_released_(false),
         experimental_optimize_memory_for_large_tensors_(0),
-        experimental_disable_delegate_clustering_(false) {}
+        experimental_disable_delegate_clustering_(false),
+        experimental_shared_memory_arena_(nullptr),
+        experimental_arena_placement_search_(false),
+        experimental_prepare_only_affected_ops_(false),
+        experimental_num_inter_op_threads_(1),
+        experimental_pipeline_delegate_partitions_(false) {}
 
   /// Preserving all intermediates tensors for debugging.
   /// WARNING: This is an experimental API and subject to change.
@@ -93,11 +100,114 @@ class InterpreterOptions {
     experimental_disable_delegate_clustering_ = value;
   }
 
+  /// Allocates the non-persistent tensors of the primary subgraph from
+  /// `shared_arena`, which the interpreters of models that never run at the
+  /// same time can share, so that they take as much memory as the largest of
+  /// them instead of the sum. `shared_arena` is not owned and must outlive the
+  /// interpreter.
+  ///
+  /// The arena holds the tensors of one interpreter at a time: after another
+  /// interpreter allocated its tensors, `Invoke()` fails until
+  /// `AllocateTensors()` is called again, which has to be done before setting
+  /// the inputs, and the outputs are only valid until then.
+  /// WARNING: This is an experimental API and subject to change.
+  void SetSharedMemoryArena(SharedMemoryArena* shared_arena) {
+    experimental_shared_memory_arena_ = shared_arena;
+  }
+
+  /// Returns the arena set by `SetSharedMemoryArena()`, if any.
+  /// WARNING: This is an experimental API and subject to change.
+  SharedMemoryArena* GetSharedMemoryArena() {
+    return experimental_shared_memory_arena_;
+  }
+
+  /// Plans the arena of each subgraph by placing its non-persistent tensors
+  /// in several orders and keeping the one taking the least memory, instead
+  /// of only from the largest to the smallest tensor. `AllocateTensors()`
+  /// takes a few times longer to plan, but the arenas are never larger.
+  /// WARNING: This is an experimental API and subject to change.
+  void SetArenaPlacementSearch(bool value = true) {
+    experimental_arena_placement_search_ = value;
+  }
+
+  /// Returns if the `experimental_arena_placement_search_` feature is enabled.
+  /// WARNING: This is an experimental API and subject to change.
+  bool GetArenaPlacementSearch() {
+    return experimental_arena_placement_search_;
+  }
+
+  /// After resizing inputs, makes `AllocateTensors()` only prepare again the
+  /// ops whose inputs changed shape, following the shape changes from the
+  /// resized inputs through the graph, instead of all the ops. Ops with side
+  /// effects, like control flow and resource ops, are always prepared again.
+  /// The arena is still planned again, and only grows when the new plan does
+  /// not fit.
+  /// WARNING: This is an experimental API and subject to change.
+  void SetPrepareOnlyAffectedOps(bool value = true) {
+    experimental_prepare_only_affected_ops_ = value;
+  }
+
+  /// Returns if the `experimental_prepare_only_affected_ops_` feature is
+  /// enabled.
+  /// WARNING: This is an experimental API and subject to change.
+  bool GetPrepareOnlyAffectedOps() {
+    return experimental_prepare_only_affected_ops_;
+  }
+
+  /// Runs the independent ops of the primary subgraph on up to
+  /// `num_threads` threads at once, the calling one included. The ops are
+  /// run level by level, each level holding the ops whose inputs are all
+  /// produced by the earlier levels, so the arena keeps the tensors of all
+  /// the ops of a level alive together. Ops with side effects, delegated
+  /// ops and ops updating variable tensors are run alone, and models with
+  /// dynamic tensors or a profiler are run sequentially, as is the first
+  /// invocation after preparing the ops, while the kernels set up their
+  /// state. 1, the default, runs all the ops sequentially.
+  /// WARNING: This is an experimental API and subject to change.
+  void SetNumInterOpThreads(int num_threads) {
+    experimental_num_inter_op_threads_ = num_threads;
+  }
+
+  /// Returns the number of threads running the independent ops at once.
+  /// WARNING: This is an experimental API and subject to change.
+  int GetNumInterOpThreads() { return experimental_num_inter_op_threads_; }
+
+  /// Pipelines the delegated and CPU partitions of the primary subgraph
+  /// across invocations. The execution plan is split into stages of the
+  /// consecutive ops run by the same delegate or by the CPU, and each
+  /// `Invoke()` runs every stage at once on the frame of a different
+  /// invocation: the first stage on the inputs just set, the second one on
+  /// those of the previous invocation, and so on. The outputs therefore lag
+  /// the inputs by `Interpreter::pipeline_latency()` invocations, during
+  /// which they are not valid, and the last frames are only completed by
+  /// invoking that many times more. The tensors crossing stages get a buffer
+  /// per frame in flight, and the arena keeps all the other tensors alive
+  /// together. Preparing the ops again, as `AllocateTensors()` does after
+  /// resizing inputs, restarts the pipeline. Models with side effects,
+  /// variable or dynamic tensors, delegate buffer handles or a delegate
+  /// reading a tensor in several stages are run sequentially.
+  /// WARNING: This is an experimental API and subject to change.
+  void SetPipelineDelegatePartitions(bool value = true) {
+    experimental_pipeline_delegate_partitions_ = value;
+  }
+
+  /// Returns if the `experimental_pipeline_delegate_partitions_` feature is
+  /// enabled.
+  /// WARNING: This is an experimental API and subject to change.
+  bool GetPipelineDelegatePartitions() {
+    return experimental_pipeline_delegate_partitions_;
+  }
+
  private:
   bool experimental_preserve_all_tensors_;
   bool experimental_ensure_dynamic_tensors_are_released_;
   int experimental_optimize_memory_for_large_tensors_;
   bool experimental_disable_delegate_clustering_;
+  SharedMemoryArena* experimental_shared_memory_arena_;
+  bool experimental_arena_placement_search_;
+  bool experimental_prepare_only_affected_ops_;
+  int experimental_num_inter_op_threads_;
+  bool experimental_pipeline_delegate_partitions_;
 };
 
 }  // namespace tflite
@@ -31,6 +31,7 @@ limitations under the License.
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/lite/context_util.h"
 #include "tensorflow/lite/core/c/builtin_op_data.h"
 #include "tensorflow/lite/core/c/c_api_types.h"
 #include "tensorflow/lite/core/c/common.h"
@@ -40,6 +41,7 @@ limitations under the License.
 #include "tensorflow/lite/interpreter_test_util.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
 #include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/simple_memory_arena.h"
 #include "tensorflow/lite/string_type.h"
 #include "tensorflow/lite/string_util.h"
 #include "tensorflow/lite/testing/util.h"
@@ -748,6 +750,51 @@ TEST(BasicInterpreter, ReleaseNonPersistentMemory) {
   ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
 }
 
+TEST(BasicInterpreter, InvokeAfterSharedArenaEviction) {
+  SharedMemoryArena shared_arena;
+  InterpreterOptions options;
+  options.SetSharedMemoryArena(&shared_arena);
+  TfLiteRegistration reg = GetPassthroughOpRegistration();
+  auto build = [&](Interpreter* interpreter) {
+    ASSERT_EQ(interpreter->AddTensors(2), kTfLiteOk);
+    ASSERT_EQ(interpreter->SetInputs({0}), kTfLiteOk);
+    ASSERT_EQ(interpreter->SetOutputs({1}), kTfLiteOk);
+    TfLiteQuantizationParams quantized;
+    ASSERT_EQ(interpreter->SetTensorParametersReadWrite(0, kTfLiteFloat32,
+                                                        "in1", {3}, quantized),
+              kTfLiteOk);
+    ASSERT_EQ(interpreter->SetTensorParametersReadWrite(1, kTfLiteFloat32,
+                                                        "out0", {3}, quantized),
+              kTfLiteOk);
+    ASSERT_EQ(interpreter->AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr,
+                                                 &reg),
+              kTfLiteOk);
+    ASSERT_EQ(interpreter->ApplyOptions(&options), kTfLiteOk);
+  };
+  Interpreter interpreter1;
+  Interpreter interpreter2;
+  build(&interpreter1);
+  build(&interpreter2);
+
+  ASSERT_EQ(interpreter1.AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(interpreter1.Invoke(), kTfLiteOk);
+  // Allocating the tensors of the second interpreter evicts those of the
+  // first one, whose Invoke() fails until they are allocated again.
+  ASSERT_EQ(interpreter2.AllocateTensors(), kTfLiteOk);
+  EXPECT_EQ(interpreter1.tensor(0)->data.raw, nullptr);
+  ASSERT_NE(interpreter1.Invoke(), kTfLiteOk);
+  ASSERT_EQ(interpreter2.Invoke(), kTfLiteOk);
+
+  ASSERT_EQ(interpreter1.AllocateTensors(), kTfLiteOk);
+  float* input = interpreter1.typed_input_tensor<float>(0);
+  ASSERT_NE(input, nullptr);
+  for (int i = 0; i < 3; ++i) input[i] = i;
+  ASSERT_EQ(interpreter1.Invoke(), kTfLiteOk);
+  const float* output = interpreter1.typed_output_tensor<float>(0);
+  for (int i = 0; i < 3; ++i) EXPECT_EQ(output[i], i);
+  ASSERT_NE(interpreter2.Invoke(), kTfLiteOk);
+}
+
 // Forcefully divides tensor allocation in three steps: one before invocation
 // and two more at invocation time. This happens because we use string tensors
 // and their sizes can't be determined until invocation time.
@@ -1121,6 +1168,225 @@ TEST(BasicInterpreter, ReleaseDynamicTensors) {
   ASSERT_EQ(interpreter.tensor(3)->bytes, sizeof(float) * 6 * 6);
 }
 
+TEST(BasicInterpreter, PrepareOnlyAffectedOps) {
+  // Assemble a graph of ops copying the shape of their input to their output,
+  // reading the two inputs 0 and 1 through a chain of two ops and one op.
+  Interpreter interpreter;
+  interpreter.AddTensors(5);
+  interpreter.SetInputs({0, 1});
+  interpreter.SetOutputs({3, 4});
+  TfLiteQuantizationParams quant;
+  for (int i = 0; i < 5; ++i) {
+    interpreter.SetTensorParametersReadWrite(i, kTfLiteFloat32, "", {2},
+                                             quant);
+  }
+  TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+  reg.init = [](TfLiteContext* context, const char* buffer, size_t length) {
+    // The node counts its prepares in the int of its init data.
+    return reinterpret_cast<void*>(const_cast<char*>(buffer));
+  };
+  reg.prepare = [](TfLiteContext* context, TfLiteNode* node) {
+    ++*reinterpret_cast<int*>(node->user_data);
+    const TfLiteTensor* input = &context->tensors[node->inputs->data[0]];
+    TfLiteTensor* output = &context->tensors[node->outputs->data[0]];
+    return context->ResizeTensor(context, output,
+                                 TfLiteIntArrayCopy(input->dims));
+  };
+  reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+    return kTfLiteOk;
+  };
+  int num_prepares[3] = {0, 0, 0};
+  const std::vector<std::pair<int, int>> input_and_output = {
+      {0, 2}, {2, 3}, {1, 4}};
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(interpreter.AddNodeWithParameters(
+                  {input_and_output[i].first}, {input_and_output[i].second},
+                  reinterpret_cast<const char*>(&num_prepares[i]),
+                  sizeof(int), nullptr, &reg),
+              kTfLiteOk);
+  }
+  InterpreterOptions options;
+  options.SetPrepareOnlyAffectedOps();
+  interpreter.ApplyOptions(&options);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  EXPECT_THAT(num_prepares, ElementsAre(1, 1, 1));
+
+  // Only the chain reading the resized input is prepared again.
+  ASSERT_EQ(interpreter.ResizeInputTensor(0, {5}), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  EXPECT_THAT(num_prepares, ElementsAre(2, 2, 1));
+  EXPECT_EQ(interpreter.tensor(3)->bytes, sizeof(float) * 5);
+  EXPECT_EQ(interpreter.tensor(4)->bytes, sizeof(float) * 2);
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+
+  ASSERT_EQ(interpreter.ResizeInputTensor(1, {3}), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  EXPECT_THAT(num_prepares, ElementsAre(2, 2, 2));
+  EXPECT_EQ(interpreter.tensor(4)->bytes, sizeof(float) * 3);
+}
+
+TEST(BasicInterpreter, InterOpParallelism) {
+  // Assemble a graph computing (x + 1 + 1) + 2 * x, in which the op doubling
+  // the input does not depend on the two ops adding one.
+  Interpreter interpreter;
+  interpreter.AddTensors(5);
+  interpreter.SetInputs({0});
+  interpreter.SetOutputs({4});
+  TfLiteQuantizationParams quant;
+  for (int i = 0; i < 5; ++i) {
+    interpreter.SetTensorParametersReadWrite(i, kTfLiteFloat32, "", {3},
+                                             quant);
+  }
+  TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+  reg.init = [](TfLiteContext* context, const char* buffer, size_t length) {
+    // The node reads what it computes from its init data.
+    return reinterpret_cast<void*>(const_cast<char*>(buffer));
+  };
+  reg.prepare = [](TfLiteContext* context, TfLiteNode* node) {
+    const TfLiteTensor* input = &context->tensors[node->inputs->data[0]];
+    TfLiteTensor* output = &context->tensors[node->outputs->data[0]];
+    return context->ResizeTensor(context, output,
+                                 TfLiteIntArrayCopy(input->dims));
+  };
+  reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+    const char op = *reinterpret_cast<const char*>(node->user_data);
+    const float* a = context->tensors[node->inputs->data[0]].data.f;
+    const float* b =
+        context->tensors[node->inputs->data[node->inputs->size - 1]].data.f;
+    float* output = context->tensors[node->outputs->data[0]].data.f;
+    for (int i = 0; i < 3; ++i) {
+      output[i] = op == '+' ? a[i] + 1 : op == '*' ? a[i] * 2 : a[i] + b[i];
+    }
+    return kTfLiteOk;
+  };
+  const char ops[] = {'+', '+', '*', 's'};
+  const std::vector<std::pair<std::vector<int>, int>> inputs_and_output = {
+      {{0}, 1}, {{1}, 2}, {{0}, 3}, {{2, 3}, 4}};
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(interpreter.AddNodeWithParameters(
+                  inputs_and_output[i].first, {inputs_and_output[i].second},
+                  &ops[i], 1, nullptr, &reg),
+              kTfLiteOk);
+  }
+  InterpreterOptions options;
+  options.SetNumInterOpThreads(3);
+  interpreter.ApplyOptions(&options);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  // The doubling op moves to the level of the first op.
+  EXPECT_THAT(interpreter.execution_plan(), ElementsAre(0, 2, 1, 3));
+
+  // The first run is sequential, the next ones concurrent.
+  for (int run = 0; run < 3; ++run) {
+    for (int i = 0; i < 3; ++i) {
+      interpreter.typed_tensor<float>(0)[i] = i + run;
+    }
+    ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ(interpreter.typed_tensor<float>(4)[i], 3 * (i + run) + 2);
+    }
+  }
+  // The tensors of the ops of a level do not overlap.
+  const TfLiteTensor* doubled = interpreter.tensor(3);
+  for (int i : {0, 1, 2}) {
+    const TfLiteTensor* other = interpreter.tensor(i);
+    EXPECT_TRUE(doubled->data.raw + doubled->bytes <= other->data.raw ||
+                other->data.raw + other->bytes <= doubled->data.raw)
+        << i;
+  }
+}
+
+TEST(BasicInterpreter, PipelinedDelegatePartitions) {
+  // Assemble a graph computing (x + 1) * 2 + 1, in which a delegate runs the
+  // ops adding one and the CPU the op doubling.
+  Interpreter interpreter;
+  interpreter.AddTensors(4);
+  interpreter.SetInputs({0});
+  interpreter.SetOutputs({3});
+  TfLiteQuantizationParams quant;
+  for (int i = 0; i < 4; ++i) {
+    interpreter.SetTensorParametersReadWrite(i, kTfLiteFloat32, "", {3},
+                                             quant);
+  }
+  TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+  reg.init = [](TfLiteContext* context, const char* buffer, size_t length) {
+    return reinterpret_cast<void*>(const_cast<char*>(buffer));
+  };
+  reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+    const char op = *reinterpret_cast<const char*>(node->user_data);
+    const float* input = context->tensors[node->inputs->data[0]].data.f;
+    float* output = context->tensors[node->outputs->data[0]].data.f;
+    for (int i = 0; i < 3; ++i) {
+      output[i] = op == '+' ? input[i] + 1 : input[i] * 2;
+    }
+    return kTfLiteOk;
+  };
+  const char ops[] = {'+', '*', '+'};
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(interpreter.AddNodeWithParameters({i}, {i + 1}, &ops[i], 1,
+                                                nullptr, &reg),
+              kTfLiteOk);
+  }
+  TfLiteDelegate delegate = TfLiteDelegateCreate();
+  delegate.Prepare = [](TfLiteContext* context,
+                        TfLiteDelegate* delegate) -> TfLiteStatus {
+    TfLiteIntArray* execution_plan;
+    TF_LITE_ENSURE_STATUS(context->GetExecutionPlan(context, &execution_plan));
+    std::vector<int> nodes_to_replace;
+    for (int node_index : TfLiteIntArrayView(execution_plan)) {
+      TfLiteNode* node;
+      TfLiteRegistration* registration;
+      TF_LITE_ENSURE_STATUS(context->GetNodeAndRegistration(
+          context, node_index, &node, &registration));
+      if (*reinterpret_cast<const char*>(node->user_data) == '+') {
+        nodes_to_replace.push_back(node_index);
+      }
+    }
+    TfLiteRegistration kernel = {nullptr, nullptr, nullptr, nullptr};
+    // Each partition holds one op adding one.
+    kernel.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+      const float* input = context->tensors[node->inputs->data[0]].data.f;
+      float* output = context->tensors[node->outputs->data[0]].data.f;
+      for (int i = 0; i < 3; ++i) output[i] = input[i] + 1;
+      return kTfLiteOk;
+    };
+    std::unique_ptr<TfLiteIntArray, decltype(&TfLiteIntArrayFree)> nodes(
+        ConvertVectorToTfLiteIntArray(nodes_to_replace), TfLiteIntArrayFree);
+    return context->ReplaceNodeSubsetsWithDelegateKernels(
+        context, kernel, nodes.get(), delegate);
+  };
+  InterpreterOptions options;
+  options.SetPipelineDelegatePartitions();
+  interpreter.ApplyOptions(&options);
+  ASSERT_EQ(interpreter.ModifyGraphWithDelegate(&delegate), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(interpreter.execution_plan().size(), 3);
+  EXPECT_EQ(interpreter.pipeline_latency(), 2);
+
+  // The outputs are those of the inputs set two invocations before. The
+  // first runs are sequential, the next ones concurrent.
+  auto run_frames = [&interpreter](int num_frames) {
+    for (int frame = 0; frame < num_frames; ++frame) {
+      for (int i = 0; i < 3; ++i) {
+        interpreter.typed_tensor<float>(0)[i] = i + frame;
+      }
+      ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+      if (frame < 2) continue;
+      for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(interpreter.typed_tensor<float>(3)[i],
+                  (i + frame - 1) * 2 + 1)
+            << frame;
+      }
+    }
+  };
+  run_frames(8);
+
+  // Preparing the ops again restarts the pipeline.
+  ASSERT_EQ(interpreter.ResizeInputTensor(0, {1, 3}), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  EXPECT_EQ(interpreter.pipeline_latency(), 2);
+  run_frames(4);
+}
+
 TEST(InterpreterTensorsCapacityTest, TestWithinHeadroom) {
   Interpreter interpreter;
   ASSERT_EQ(interpreter.AddTensors(Interpreter::kTensorsReservedCapacity),
@@ -0,0 +1,110 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <stdint.h>
+
+#include <vector>
+
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/subgraph.h"
+#include "tensorflow/lite/experimental/resource/resource_variable.h"
+#include "tensorflow/lite/kernels/internal/tensor.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+
+namespace tflite {
+namespace ops {
+namespace custom {
+namespace assign_variable_slice {
+
+constexpr int kInputVariableId = 0;
+constexpr int kInputUpdate = 1;
+constexpr int kInputStartIndices = 2;
+
+// Writes the update into the slice of a resource variable in place, with the
+// semantics of DynamicUpdateSlice. It saves reading the whole variable,
+// updating a copy and assigning it back, e.g. when appending the keys and
+// values of a token to the cache of a decoder.
+TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
+  TF_LITE_ENSURE_EQ(context, NumInputs(node), 3);
+  TF_LITE_ENSURE_EQ(context, NumOutputs(node), 0);
+
+  const TfLiteTensor* input_resource_id_tensor;
+  TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kInputVariableId,
+                                          &input_resource_id_tensor));
+  TF_LITE_ENSURE(context, (input_resource_id_tensor->type == kTfLiteResource ||
+                           input_resource_id_tensor->type == kTfLiteInt32));
+  TF_LITE_ENSURE_EQ(context, NumElements(input_resource_id_tensor), 1);
+
+  const TfLiteTensor* start_indices;
+  TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kInputStartIndices,
+                                          &start_indices));
+  TF_LITE_ENSURE(context, start_indices->type == kTfLiteInt32 ||
+                              start_indices->type == kTfLiteInt64);
+  TF_LITE_ENSURE_EQ(context, NumDimensions(start_indices), 1);
+
+  return kTfLiteOk;
+}
+
+TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
+  Subgraph* subgraph = reinterpret_cast<Subgraph*>(context->impl_);
+
+  const TfLiteTensor* input_resource_id_tensor;
+  TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kInputVariableId,
+                                          &input_resource_id_tensor));
+  const TfLiteTensor* update;
+  TF_LITE_ENSURE_OK(context,
+                    GetInputSafe(context, node, kInputUpdate, &update));
+  const TfLiteTensor* start_indices;
+  TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kInputStartIndices,
+                                          &start_indices));
+
+  int resource_id = input_resource_id_tensor->data.i32[0];
+  auto& resources = subgraph->resources();
+  auto* variable = resource::GetResourceVariable(&resources, resource_id);
+  TF_LITE_ENSURE(context, variable != nullptr);
+  // The variable is assigned its full size first, as the slice is written
+  // into its buffer.
+  TfLiteTensor* variable_tensor = variable->GetTensor();
+  TF_LITE_ENSURE(context, variable_tensor != nullptr);
+  TF_LITE_ENSURE_TYPES_EQ(context, update->type, variable_tensor->type);
+  TF_LITE_ENSURE_EQ(context, NumDimensions(update),
+                    NumDimensions(variable_tensor));
+  TF_LITE_ENSURE_EQ(context, NumElements(start_indices),
+                    NumDimensions(variable_tensor));
+  for (int i = 0; i < NumDimensions(update); ++i) {
+    TF_LITE_ENSURE(context, SizeOfDimension(update, i) <=
+                                SizeOfDimension(variable_tensor, i));
+  }
+
+  std::vector<int64_t> indices(NumElements(start_indices));
+  for (int i = 0; i < NumElements(start_indices); ++i) {
+    indices[i] = start_indices->type == kTfLiteInt32
+                     ? GetTensorData<int32_t>(start_indices)[i]
+                     : GetTensorData<int64_t>(start_indices)[i];
+  }
+  return variable->UpdateSliceFrom(update, indices.data());
+}
+
+}  // namespace assign_variable_slice
+
+TfLiteRegistration* Register_ASSIGN_VARIABLE_SLICE() {
+  static TfLiteRegistration r = {nullptr, nullptr,
+                                 assign_variable_slice::Prepare,
+                                 assign_variable_slice::Eval};
+  return &r;
+}
+
+}  // namespace custom
+}  // namespace ops
+}  // namespace tflite
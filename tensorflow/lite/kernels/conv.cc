@@ -37,6 +37,7 @@ limitations under the License.
 #include "tensorflow/lite/kernels/internal/optimized/multithreaded_conv.h"
 #endif
 #include "tensorflow/lite/kernels/internal/optimized/optimized_ops.h"
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/fully_connected.h"
 #include "tensorflow/lite/kernels/internal/quantization_util.h"
 #include "tensorflow/lite/kernels/internal/reference/conv.h"
 #include "tensorflow/lite/kernels/internal/reference/integer_ops/conv.h"
@@ -45,6 +46,7 @@ limitations under the License.
 #include "tensorflow/lite/kernels/internal/tensor_utils.h"
 #include "tensorflow/lite/kernels/kernel_util.h"
 #include "tensorflow/lite/kernels/padding.h"
+#include "tensorflow/lite/packed_weights_cache.h"
 #include "tensorflow/lite/util.h"
 
 namespace tflite {
@@ -108,6 +110,9 @@ struct OpData {
 
   bool need_hwcn_weights = false;
   bool have_weights_been_transposed = false;
+  // The cache to add the transposed constant weights to, and their key.
+  PackedWeightsCache* packed_weights_cache = nullptr;
+  uint64_t hwcn_weights_key = 0;
   bool need_im2col = false;
   // If it's true, it means im2col is needed but gets disabled because the
   // temporary im2col tensor requires too much memory (i.e.
@@ -120,6 +125,16 @@ struct OpData {
 
   // Number of convolution groups.
   int32_t groups = 1;
+
+  // Sparse filters are only supported by 1x1 convolutions with unit strides,
+  // which are run as a fully connected layer whose weights are the filter
+  // without its spatial dimensions. 'fc_sparsity' describes these weights,
+  // stored by blocks of sparse_block_rows x sparse_block_cols.
+  bool is_sparse = false;
+  std::vector<TfLiteDimensionMetadata> fc_dim_metadata;
+  TfLiteSparsity fc_sparsity = {};
+  int sparse_block_rows = 1;
+  int sparse_block_cols = 1;
 };
 
 inline PaddingType RuntimePaddingType(TfLitePadding padding) {
@@ -323,6 +338,112 @@ static TfLiteStatus AllocateTemporaryTensorsIfRequired(
   return kTfLiteOk;
 }
 
+// Checks that the sparse filter is supported, i.e. that it is the filter of a
+// 1x1 convolution with unit strides whose [channels_out, channels_in] weights
+// are stored randomly sparse, or by blocks of 1x4, 1x16 or 4x4 in row major
+// order, and sets up the sparsity of the equivalent fully connected weights.
+TfLiteStatus PrepareSparseFilter(TfLiteContext* context,
+                                 const TfLiteConvParams* params,
+                                 const TfLiteTensor* input,
+                                 const TfLiteTensor* filter, bool is_hybrid,
+                                 OpData* data) {
+  if (filter->dims->data[1] != 1 || filter->dims->data[2] != 1 ||
+      params->stride_width != 1 || params->stride_height != 1 ||
+      params->dilation_width_factor != 1 ||
+      params->dilation_height_factor != 1 || data->groups != 1 || is_hybrid ||
+      (input->type != kTfLiteFloat32 && input->type != kTfLiteInt8)) {
+    TF_LITE_KERNEL_LOG(context,
+                       "Sparse filters are only supported by float32 and int8 "
+                       "1x1 convolutions with unit strides and dilations.");
+    return kTfLiteError;
+  }
+
+  // The filter dimensions are traversed in order, with the block dimensions
+  // of the channels_out and channels_in dimensions last.
+  const TfLiteSparsity& sparsity = *filter->sparsity;
+  const int dim_metadata_size = sparsity.dim_metadata_size;
+  int block_rows = 1;
+  int block_cols = 1;
+  bool is_supported =
+      dim_metadata_size >= 4 && dim_metadata_size <= 6 &&
+      sparsity.traversal_order != nullptr &&
+      sparsity.traversal_order->size == dim_metadata_size;
+  for (int i = 0; is_supported && i < dim_metadata_size; ++i) {
+    is_supported = sparsity.traversal_order->data[i] == i &&
+                   (i == 3) == (sparsity.dim_metadata[i].format ==
+                                kTfLiteDimSparseCSR);
+  }
+  if (is_supported && dim_metadata_size == 5) {
+    is_supported = sparsity.block_map != nullptr &&
+                   sparsity.block_map->size == 1 &&
+                   sparsity.block_map->data[0] == 3;
+    block_cols = sparsity.dim_metadata[4].dense_size;
+  } else if (is_supported && dim_metadata_size == 6) {
+    is_supported = sparsity.block_map != nullptr &&
+                   sparsity.block_map->size == 2 &&
+                   sparsity.block_map->data[0] == 0 &&
+                   sparsity.block_map->data[1] == 3;
+    block_rows = sparsity.dim_metadata[4].dense_size;
+    block_cols = sparsity.dim_metadata[5].dense_size;
+  }
+  if (input->type == kTfLiteFloat32) {
+    is_supported = is_supported &&
+                   ((block_rows == 1 && (block_cols == 1 || block_cols == 4)) ||
+                    (block_rows == 4 && block_cols == 4));
+  } else {
+    is_supported =
+        is_supported &&
+        ((block_rows == 1 && (block_cols == 4 || block_cols == 16)) ||
+         (block_rows == 4 && block_cols == 4));
+  }
+  if (!is_supported) {
+    TF_LITE_KERNEL_LOG(context, "Unsupported sparse convolution filter.");
+    return kTfLiteError;
+  }
+
+  // Verify that the blocks and their indices fit in the filter.
+  const int channels_out = filter->dims->data[0];
+  const int channels_in = filter->dims->data[3];
+  const TfLiteDimensionMetadata& w0 = sparsity.dim_metadata[0];
+  const TfLiteDimensionMetadata& w1 = sparsity.dim_metadata[3];
+  TF_LITE_ENSURE_EQ(context, w0.dense_size * block_rows, channels_out);
+  TF_LITE_ENSURE_EQ(context, channels_in % block_cols, 0);
+  TF_LITE_ENSURE(context, w1.array_segments != nullptr &&
+                              w1.array_indices != nullptr);
+  TF_LITE_ENSURE_EQ(context, w1.array_segments->size, w0.dense_size + 1);
+  TF_LITE_ENSURE_EQ(context, w1.array_segments->data[0], 0);
+  for (int i = 0; i < w0.dense_size; ++i) {
+    TF_LITE_ENSURE(context, w1.array_segments->data[i] <=
+                                w1.array_segments->data[i + 1]);
+  }
+  const int num_blocks = w1.array_segments->data[w0.dense_size];
+  TF_LITE_ENSURE(context, w1.array_indices->size >= num_blocks);
+  for (int i = 0; i < num_blocks; ++i) {
+    TF_LITE_ENSURE(context, w1.array_indices->data[i] >= 0 &&
+                                w1.array_indices->data[i] <
+                                    channels_in / block_cols);
+  }
+  const size_t values_bytes = static_cast<size_t>(num_blocks) * block_rows *
+                              block_cols * TfLiteTypeGetSize(filter->type);
+  TF_LITE_ENSURE(context, values_bytes <= filter->bytes);
+
+  // The fully connected weights drop the unit filter_height and filter_width
+  // dimensions.
+  data->fc_dim_metadata.clear();
+  for (int i = 0; i < dim_metadata_size; ++i) {
+    if (i != 1 && i != 2) {
+      data->fc_dim_metadata.push_back(sparsity.dim_metadata[i]);
+    }
+  }
+  data->fc_sparsity = {};
+  data->fc_sparsity.dim_metadata = data->fc_dim_metadata.data();
+  data->fc_sparsity.dim_metadata_size = data->fc_dim_metadata.size();
+  data->sparse_block_rows = block_rows;
+  data->sparse_block_cols = block_cols;
+  data->is_sparse = true;
+  return kTfLiteOk;
+}
+
 TfLiteStatus Prepare(KernelType kernel_type, TfLiteContext* context,
                      TfLiteNode* node) {
   auto* params = reinterpret_cast<TfLiteConvParams*>(node->builtin_data);
@@ -418,10 +539,16 @@ TfLiteStatus Prepare(KernelType kernel_type, TfLiteContext* context,
     }
   }
 
+  data->is_sparse = false;
+  if (filter->sparsity != nullptr) {
+    TF_LITE_ENSURE_STATUS(PrepareSparseFilter(context, params, input, filter,
+                                              is_hybrid, data));
+  }
+
   // The multi-threaded kernel supports neither dilation nor hybrid kernels, and
   // is incompatible with mutable input filters that might change between evals.
   data->supports_multithreaded_kernel =
-      (kernel_type == kMultithreadOptimized) &&
+      (kernel_type == kMultithreadOptimized) && !data->is_sparse &&
       (context->recommended_num_threads != 1) && !is_hybrid &&
       (params->dilation_width_factor == 1) &&
       (params->dilation_height_factor == 1) &&
@@ -478,6 +605,16 @@ TfLiteStatus Prepare(KernelType kernel_type, TfLiteContext* context,
         &data->output_activation_min, &data->output_activation_max,
         data->per_channel_output_multiplier.data(),
         data->per_channel_output_shift.data(), channels_out));
+
+    // The sparse kernels requantize all the output channels alike.
+    if (data->is_sparse) {
+      for (int i = 1; i < channels_out; ++i) {
+        TF_LITE_ENSURE_EQ(context, data->per_channel_output_multiplier[i],
+                          data->per_channel_output_multiplier[0]);
+        TF_LITE_ENSURE_EQ(context, data->per_channel_output_shift[i],
+                          data->per_channel_output_shift[0]);
+      }
+    }
   }
 
   TfLiteIntArray* output_size = TfLiteIntArrayCreate(4);
@@ -528,15 +665,39 @@ TfLiteStatus Prepare(KernelType kernel_type, TfLiteContext* context,
         &context->tensors[node->temporaries->data[data->hwcn_weights_index]];
     hwcn_weights->type = input_type;
     hwcn_weights->name = "Conv_hwcn_weights";
-    hwcn_weights->allocation_type = kTfLiteArenaRwPersistent;
 
-    auto hwcn_weights_status =
-        context->ResizeTensor(context, hwcn_weights, hwcn_weights_size);
-    if (hwcn_weights_status != kTfLiteOk) return hwcn_weights_status;
+    // Constant weights transposed by an earlier interpreter are mapped from
+    // the packed weights cache, instead of being transposed again.
+    data->packed_weights_cache =
+        IsConstantTensor(filter)
+            ? CpuBackendContext::GetPackedWeightsCache(context)
+            : nullptr;
+    const void* cached_hwcn_weights = nullptr;
+    if (data->packed_weights_cache != nullptr) {
+      data->hwcn_weights_key = PackedWeightsCache::Key(
+          "conv_hwcn_weights", filter->data.raw, filter->bytes);
+      cached_hwcn_weights = data->packed_weights_cache->Lookup(
+          data->hwcn_weights_key, filter->bytes);
+    }
+    if (cached_hwcn_weights != nullptr) {
+      TfLiteIntArrayFree(hwcn_weights->dims);
+      hwcn_weights->dims = hwcn_weights_size;
+      hwcn_weights->allocation_type = kTfLiteMmapRo;
+      hwcn_weights->data.raw =
+          const_cast<char*>(static_cast<const char*>(cached_hwcn_weights));
+      hwcn_weights->bytes = filter->bytes;
+      data->have_weights_been_transposed = true;
+    } else {
+      hwcn_weights->allocation_type = kTfLiteArenaRwPersistent;
+
+      auto hwcn_weights_status =
+          context->ResizeTensor(context, hwcn_weights, hwcn_weights_size);
+      if (hwcn_weights_status != kTfLiteOk) return hwcn_weights_status;
 
-    // TODO(petewarden): If Resize() is called when the size hasn't actually
-    // changed, this will do extra redundant work.
-    data->have_weights_been_transposed = false;
+      // TODO(petewarden): If Resize() is called when the size hasn't actually
+      // changed, this will do extra redundant work.
+      data->have_weights_been_transposed = false;
+    }
   }
 
   if (is_hybrid) {
@@ -1169,6 +1330,78 @@ TfLiteStatus EvalHybrid(TfLiteContext* context, TfLiteNode* node,
   return kTfLiteOk;
 }
 
+// Runs the 1x1 convolution with a sparse filter as a fully connected layer of
+// the [batches * height * width, channels_in] input.
+TfLiteStatus EvalSparse(TfLiteContext* context, TfLiteConvParams* params,
+                        OpData* data, const TfLiteTensor* input,
+                        const TfLiteTensor* filter, const TfLiteTensor* bias,
+                        TfLiteTensor* output) {
+  const int channels_in = filter->dims->data[3];
+  const int channels_out = filter->dims->data[0];
+  const int rows = NumElements(input) / channels_in;
+  const RuntimeShape input_shape({rows, channels_in});
+  const RuntimeShape weights_shape({channels_out, channels_in});
+  const RuntimeShape bias_shape({channels_out});
+  const RuntimeShape output_shape({rows, channels_out});
+  const TfLiteSparsity& sparsity = data->fc_sparsity;
+  CpuBackendContext* cpu_backend_context =
+      CpuBackendContext::GetFromContext(context);
+  FullyConnectedParams op_params;
+  if (input->type == kTfLiteFloat32) {
+    CalculateActivationRange(params->activation,
+                             &op_params.float_activation_min,
+                             &op_params.float_activation_max);
+    if (data->sparse_block_cols == 1) {
+      optimized_ops::FullyConnectedSparseWeight(
+          sparsity, op_params, input_shape, GetTensorData<float>(input),
+          weights_shape, GetTensorData<float>(filter), bias_shape,
+          GetTensorData<float>(bias), output_shape,
+          GetTensorData<float>(output));
+    } else if (data->sparse_block_rows == 1) {
+      optimized_ops::FullyConnectedSparseWeight1x4(
+          sparsity, op_params, input_shape, GetTensorData<float>(input),
+          weights_shape, GetTensorData<float>(filter), bias_shape,
+          GetTensorData<float>(bias), output_shape,
+          GetTensorData<float>(output), cpu_backend_context);
+    } else {
+      optimized_ops::FullyConnectedSparseWeight4x4(
+          sparsity, op_params, input_shape, GetTensorData<float>(input),
+          weights_shape, GetTensorData<float>(filter), bias_shape,
+          GetTensorData<float>(bias), output_shape,
+          GetTensorData<float>(output), cpu_backend_context);
+    }
+    return kTfLiteOk;
+  }
+
+  op_params.input_offset = -input->params.zero_point;
+  op_params.weights_offset = 0;
+  op_params.output_offset = output->params.zero_point;
+  op_params.output_multiplier = data->per_channel_output_multiplier[0];
+  op_params.output_shift = data->per_channel_output_shift[0];
+  op_params.quantized_activation_min = data->output_activation_min;
+  op_params.quantized_activation_max = data->output_activation_max;
+  if (data->sparse_block_cols == 16) {
+    optimized_ops::FullyConnectedSparseWeight1x16(
+        sparsity, op_params, input_shape, GetTensorData<int8_t>(input),
+        weights_shape, GetTensorData<int8_t>(filter), bias_shape,
+        GetTensorData<int32_t>(bias), output_shape,
+        GetTensorData<int8_t>(output), cpu_backend_context);
+  } else if (data->sparse_block_rows == 1) {
+    optimized_ops::FullyConnectedSparseWeight1x4(
+        sparsity, op_params, input_shape, GetTensorData<int8_t>(input),
+        weights_shape, GetTensorData<int8_t>(filter), bias_shape,
+        GetTensorData<int32_t>(bias), output_shape,
+        GetTensorData<int8_t>(output), cpu_backend_context);
+  } else {
+    optimized_ops::FullyConnectedSparseWeight4x4(
+        sparsity, op_params, input_shape, GetTensorData<int8_t>(input),
+        weights_shape, GetTensorData<int8_t>(filter), bias_shape,
+        GetTensorData<int32_t>(bias), output_shape,
+        GetTensorData<int8_t>(output), cpu_backend_context);
+  }
+  return kTfLiteOk;
+}
+
 template <KernelType kernel_type, TfLiteType input_type>
 TfLiteStatus EvalImpl(TfLiteContext* context, TfLiteNode* node) {
   auto* params = reinterpret_cast<TfLiteConvParams*>(node->builtin_data);
@@ -1182,6 +1415,9 @@ TfLiteStatus EvalImpl(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, 1, &filter));
   bool has_bias = node->inputs->size == 3;
   const TfLiteTensor* bias = has_bias ? GetInput(context, node, 2) : nullptr;
+  if (data->is_sparse) {
+    return EvalSparse(context, params, data, input, filter, bias, output);
+  }
   TfLiteTensor* im2col =
       data->need_im2col
           ? &context->tensors[node->temporaries->data[data->im2col_index]]
@@ -1194,6 +1430,11 @@ TfLiteStatus EvalImpl(TfLiteContext* context, TfLiteNode* node) {
   if (data->need_hwcn_weights && !data->have_weights_been_transposed) {
     TransposeFloatTensor(filter, hwcn_weights);
     data->have_weights_been_transposed = true;
+    if (data->packed_weights_cache != nullptr) {
+      data->packed_weights_cache->Insert(data->hwcn_weights_key,
+                                         hwcn_weights->data.raw,
+                                         hwcn_weights->bytes);
+    }
   }
 
   TFLITE_DCHECK_EQ(input_type, input->type);
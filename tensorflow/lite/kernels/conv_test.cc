@@ -2046,6 +2046,128 @@ TEST_P(ConvolutionOpTest, SimpleTestHybridWithDilationPerChannel) {
                                  0.16)));
 }
 
+// A 1x1 convolution with unit strides whose filter is sparse.
+class SparseConvolutionOpModel : public SingleOpModel {
+ public:
+  SparseConvolutionOpModel(TfLiteRegistration* registration,
+                           const TensorData& input, const TensorData& filter,
+                           const std::vector<float>& filter_data,
+                           const TensorData& output) {
+    input_ = AddInput(input);
+    filter_ = AddConstSparseInput(filter, filter_data);
+    const int bias_size = filter.shape[0];
+    if (input.type == TensorType_FLOAT32) {
+      bias_ = AddInput({TensorType_FLOAT32, {bias_size}});
+    } else {
+      const float bias_scale = GetScale(input_) * GetScale(filter_);
+      bias_ = AddInput({TensorType_INT32, {bias_size}, 0, 0, bias_scale});
+    }
+    output_ = AddOutput(output);
+
+    SetBuiltinOp(BuiltinOperator_CONV_2D, BuiltinOptions_Conv2DOptions,
+                 CreateConv2DOptions(builder_, Padding_VALID,
+                                     /*stride_w=*/1, /*stride_h=*/1)
+                     .Union());
+    resolver_ = std::make_unique<SingleOpResolver>(BuiltinOperator_CONV_2D,
+                                                   registration);
+    BuildInterpreter({GetShape(input_), GetShape(filter_), GetShape(bias_)});
+  }
+
+  void SetInput(const std::vector<float>& data) {
+    if (interpreter_->tensor(input_)->type == kTfLiteFloat32) {
+      PopulateTensor(input_, data);
+    } else {
+      QuantizeAndPopulate<int8_t>(input_, data);
+    }
+  }
+  void SetBias(const std::vector<float>& data) {
+    if (interpreter_->tensor(bias_)->type == kTfLiteFloat32) {
+      PopulateTensor(bias_, data);
+    } else {
+      QuantizeAndPopulate<int32_t>(bias_, data);
+    }
+  }
+
+  template <typename T>
+  std::vector<T> GetOutput() {
+    return ExtractVector<T>(output_);
+  }
+  std::vector<int> GetOutputShape() { return GetTensorShape(output_); }
+
+ private:
+  int input_;
+  int filter_;
+  int bias_;
+  int output_;
+};
+
+TEST_P(ConvolutionOpTest, SparseFilter4x4Float32) {
+  TensorData filter = {TensorType_FLOAT32, {8, 1, 1, 8}};
+  filter.traversal_order = {0, 1, 2, 3, 4, 5};
+  filter.format = {kTfLiteDimDense, kTfLiteDimDense, kTfLiteDimDense,
+                   kTfLiteDimSparseCSR};
+  filter.block_map = {0, 3};
+  filter.block_size = {4, 4};
+  SparseConvolutionOpModel m(GetRegistration(),
+                             {TensorType_FLOAT32, {1, 2, 2, 8}}, filter,
+                             {
+                                 1,  2,  3,  4,  0,  0,  0,  0,   // out = 0
+                                 -1, -2, -3, -4, 0,  0,  0,  0,   // out = 1
+                                 1,  0,  1,  0,  0,  0,  0,  0,   // out = 2
+                                 0,  1,  0,  1,  0,  0,  0,  0,   // out = 3
+                                 0,  0,  0,  0,  1,  1,  1,  1,   // out = 4
+                                 0,  0,  0,  0,  2,  -2, 2,  -2,  // out = 5
+                                 0,  0,  0,  0,  0,  0,  0,  0,   // out = 6
+                                 0,  0,  0,  0,  -1, 2,  -3, 4,   // out = 7
+                             },
+                             {TensorType_FLOAT32, {}});
+  m.SetInput({
+      1,  2,  3, 4, 5,  6, 7,  8,  // y = 0, x = 0
+      -1, -2, 3, 4, -5, 6, -7, 8,  // y = 0, x = 1
+      1,  1,  1, 1, 1,  1, 1,  1,  // y = 1, x = 0
+      0,  0,  0, 0, 0,  0, 0,  0,  // y = 1, x = 1
+  });
+  m.SetBias({1, 2, 3, 4, 5, 6, 7, 8});
+
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutputShape(), ElementsAreArray({1, 2, 2, 8}));
+  EXPECT_THAT(m.GetOutput<float>(), ElementsAreArray({
+                                        31, -28, 7, 10, 31, 2,   7, 26,  //
+                                        21, -18, 5, 6,  7,  -46, 7, 78,  //
+                                        11, -8,  5, 6,  9,  6,   7, 10,  //
+                                        1,  2,   3, 4,  5,  6,   7, 8,   //
+                                    }));
+}
+
+TEST_P(ConvolutionOpTest, SparseFilter1x4Int8) {
+  TensorData filter = {TensorType_INT8, {3, 1, 1, 8}, 0, 0, 1};
+  filter.traversal_order = {0, 1, 2, 3, 4};
+  filter.format = {kTfLiteDimDense, kTfLiteDimDense, kTfLiteDimDense,
+                   kTfLiteDimSparseCSR};
+  filter.block_map = {3};
+  filter.block_size = {4};
+  SparseConvolutionOpModel m(GetRegistration(),
+                             {TensorType_INT8, {1, 1, 2, 8}, 0, 0, 1, 2},
+                             filter,
+                             {
+                                 1,  2,  3,  4,  0, 0, 0, 0,  // out = 0
+                                 0,  0,  0,  0,  0, 0, 0, 0,  // out = 1
+                                 -1, -2, -3, -4, 4, 3, 2, 1,  // out = 2
+                             },
+                             {TensorType_INT8, {}, 0, 0, 1, -1});
+  m.SetInput({
+      1, 2, 3, 4, 1,  2,  3,  4,   // x = 0
+      4, 3, 2, 1, -4, -3, -2, -1,  // x = 1
+  });
+  m.SetBias({1, 2, 3});
+
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutputShape(), ElementsAreArray({1, 1, 2, 3}));
+  EXPECT_THAT(m.GetOutput<int8_t>(), ElementsAreArray({30, 1, -8, 20, 1, -48}));
+}
+
 const auto kQuantizedKernelMap = new std::map<string, TfLiteRegistration*>({
     {"GenericOptimized", ops::builtin::Register_CONV_2D_UINT8()},
 });
@@ -101,6 +101,13 @@ bool CpuBackendContext::CpuInfo::Avx() { return false; }
 bool CpuBackendContext::CpuInfo::Avx512() { return false; }
 #endif  // TFLITE_HAVE_CPUINFO
 
+PackedWeightsCache* CpuBackendContext::GetPackedWeightsCache(
+    TfLiteContext* context) {
+  auto* external_context = static_cast<ExternalCpuBackendContext*>(
+      context->GetExternalContext(context, kTfLiteCpuBackendContext));
+  return external_context ? external_context->packed_weights_cache() : nullptr;
+}
+
 CpuBackendContext* CpuBackendContext::GetFromContext(TfLiteContext* context) {
   auto* external_context = static_cast<ExternalCpuBackendContext*>(
       context->GetExternalContext(context, kTfLiteCpuBackendContext));
@@ -118,6 +125,10 @@ CpuBackendContext* CpuBackendContext::GetFromContext(TfLiteContext* context) {
     // that's wrapped inside ExternalCpuBackendContext.
     cpu_backend_context = new CpuBackendContext();
     cpu_backend_context->SetMaxNumThreads(context->recommended_num_threads);
+    cpu_backend_context->SetExternalThreadPool(
+        external_context->external_thread_pool());
+    cpu_backend_context->SetThreadPoolSpinMilliseconds(
+        external_context->thread_pool_spin_milliseconds());
     external_context->set_internal_backend_context(
         std::unique_ptr<TfLiteInternalBackendContext>(cpu_backend_context));
   }
@@ -150,7 +161,17 @@ void CpuBackendContext::SetMaxNumThreads(int max_num_threads) {
 
 void CpuBackendContext::SetUseCaching(bool flag) { use_caching_ = flag; }
 
+void CpuBackendContext::SetThreadPoolSpinMilliseconds(float milliseconds) {
+  if (milliseconds >= 0) {
+    ruy_context_->mutable_thread_pool()->set_spin_milliseconds(milliseconds);
+  }
+}
+
 pthreadpool_t CpuBackendContext::get_xnnpack_threadpool() {
+  if (external_thread_pool_ != nullptr &&
+      external_thread_pool_->GetPthreadpool() != nullptr) {
+    return static_cast<pthreadpool_t>(external_thread_pool_->GetPthreadpool());
+  }
   if (!xnnpack_threadpool_ && max_num_threads_ > 1) {
     xnnpack_threadpool_.reset(
         pthreadpool_create(static_cast<size_t>(max_num_threads_)));
@@ -35,6 +35,10 @@ class CpuBackendContext final : public TfLiteInternalBackendContext {
  public:
   static CpuBackendContext* GetFromContext(TfLiteContext* context);
 
+  // Returns the cache of the weights repacked by the kernels set on the
+  // interpreter of `context`, if any.
+  static PackedWeightsCache* GetPackedWeightsCache(TfLiteContext* context);
+
   CpuBackendContext();
   ~CpuBackendContext() override;
 
@@ -54,10 +58,26 @@ class CpuBackendContext final : public TfLiteInternalBackendContext {
 
   bool use_caching() const { return use_caching_; }
 
+  // Returns the pthreadpool of the external thread pool if it has one.
   pthreadpool_t get_xnnpack_threadpool();
 
   void ClearCaches() override { ruy_context_->ClearPrepackedCache(); }
 
+  void SetExternalThreadPool(ExternalThreadPool* thread_pool) override {
+    external_thread_pool_ = thread_pool;
+  }
+
+  // The thread pool of the application that cpu_backend_threadpool::Execute
+  // runs the tasks on, if any. Note that the GEMMs of ruy and gemmlowp still
+  // run on their own thread pools.
+  ExternalThreadPool* external_thread_pool() const {
+    return external_thread_pool_;
+  }
+
+  // Only applies to the thread pool of ruy, gemmlowp spinning for a fixed
+  // duration.
+  void SetThreadPoolSpinMilliseconds(float milliseconds) override;
+
   // Gemmlowp on x86 is a deprecated path but some clients may still use
   // this path based on link time dependencies.
   bool PreferGemmlowpOnX86();
@@ -123,6 +143,8 @@ class CpuBackendContext final : public TfLiteInternalBackendContext {
   std::unique_ptr<pthreadpool, decltype(&pthreadpool_destroy)>
       xnnpack_threadpool_{nullptr, &pthreadpool_destroy};
 
+  ExternalThreadPool* external_thread_pool_ = nullptr;
+
   CpuBackendContext(const CpuBackendContext&) = delete;
 };
 
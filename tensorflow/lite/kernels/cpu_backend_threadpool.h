@@ -29,6 +29,17 @@ limitations under the License.
 namespace tflite {
 namespace cpu_backend_threadpool {
 
+// Runs the tasks on the external thread pool of the application set on
+// 'cpu_backend_context', if any. Returns whether it did.
+template <typename TaskType>
+bool ExecuteOnExternalThreadPool(int tasks_count, TaskType* tasks,
+                                 CpuBackendContext* cpu_backend_context) {
+  ExternalThreadPool* thread_pool = cpu_backend_context->external_thread_pool();
+  if (thread_pool == nullptr) return false;
+  thread_pool->ParallelFor(tasks_count, [tasks](int i) { tasks[i].Run(); });
+  return true;
+}
+
 #ifdef TFLITE_WITH_RUY
 
 using Task = ruy::Task;
@@ -37,6 +48,9 @@ template <typename TaskType>
 void Execute(int tasks_count, TaskType* tasks,
              CpuBackendContext* cpu_backend_context) {
   TFLITE_DCHECK_LE(tasks_count, cpu_backend_context->max_num_threads());
+  if (ExecuteOnExternalThreadPool(tasks_count, tasks, cpu_backend_context)) {
+    return;
+  }
   cpu_backend_context->ruy_context()->mutable_thread_pool()->Execute(
       tasks_count, tasks);
 }
@@ -49,6 +63,9 @@ template <typename TaskType>
 void Execute(int tasks_count, TaskType* tasks,
              CpuBackendContext* cpu_backend_context) {
   TFLITE_DCHECK_LE(tasks_count, cpu_backend_context->max_num_threads());
+  if (ExecuteOnExternalThreadPool(tasks_count, tasks, cpu_backend_context)) {
+    return;
+  }
   cpu_backend_context->gemmlowp_context()->workers_pool()->Execute(tasks_count,
                                                                    tasks);
 }
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/lite/kernels/cpu_backend_threadpool.h"
 
+#include <functional>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -89,6 +90,42 @@ TEST(CpuBackendThreadpoolTest, TenThreadsSize1234567) {
   TestGenerateArrayOfIncrementingInts(10, 1234567);
 }
 
+// Runs the tasks serially on the calling thread.
+class FakeExternalThreadPool : public ExternalThreadPool {
+ public:
+  int NumThreads() const override { return 4; }
+  void ParallelFor(int num_tasks,
+                   const std::function<void(int)>& task) override {
+    ++num_calls_;
+    for (int i = 0; i < num_tasks; ++i) task(i);
+  }
+  int num_calls() const { return num_calls_; }
+
+ private:
+  int num_calls_ = 0;
+};
+
+TEST(CpuBackendThreadpoolTest, ExternalThreadPool) {
+  std::vector<int> buffer(1000);
+  std::vector<TestGenerateArrayOfIncrementingIntsTask> tasks;
+  for (int i = 0; i < 4; ++i) {
+    tasks.emplace_back(buffer.data(), i * 250, (i + 1) * 250);
+  }
+
+  FakeExternalThreadPool thread_pool;
+  CpuBackendContext context;
+  context.SetMaxNumThreads(thread_pool.NumThreads());
+  context.SetExternalThreadPool(&thread_pool);
+  cpu_backend_threadpool::Execute(tasks.size(), tasks.data(), &context);
+
+  EXPECT_EQ(thread_pool.num_calls(), 1);
+  for (int i = 0; i < buffer.size(); i++) {
+    ASSERT_EQ(buffer[i], i);
+  }
+  // There is no pthreadpool to share with XNNPACK, which gets its own.
+  EXPECT_NE(context.get_xnnpack_threadpool(), nullptr);
+}
+
 }  // namespace
 
 }  // namespace tflite
@@ -29,6 +29,7 @@ TfLiteRegistration* Register_HASHTABLE_IMPORT();
 TfLiteRegistration* Register_HASHTABLE_SIZE();
 TfLiteRegistration* Register_IRFFT2D();
 TfLiteRegistration* Register_MAX_POOL_3D();
+TfLiteRegistration* Register_MULTI_HEAD_ATTENTION();
 TfLiteRegistration* Register_MULTINOMIAL();
 TfLiteRegistration* Register_RANDOM_STANDARD_NORMAL();
 TfLiteRegistration* Register_RANDOM_UNIFORM();
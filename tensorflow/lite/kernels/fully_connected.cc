@@ -52,6 +52,30 @@ bool SupportedSparsityFormat(const TfLiteSparsity& sparsity) {
 
 static const int kDimMetadataSizeRandomSparse = 2;
 static const int kDimMetadataSizeBlockSparse = 3;
+// The metadata size of weights sparse by blocks of several rows, whose blocks
+// are mapped to both the dimensions of the weights.
+static const int kDimMetadataSize2DBlockSparse = 4;
+
+// Returns whether the sparse weights are stored by blocks of
+// block_rows x block_cols, the blocks being in row major order.
+bool IsBlockSparse(const TfLiteSparsity& sparsity, int block_rows,
+                   int block_cols) {
+  if (block_rows == 1) {
+    return sparsity.dim_metadata_size == kDimMetadataSizeBlockSparse &&
+           sparsity.dim_metadata[2].dense_size == block_cols;
+  }
+  if (sparsity.dim_metadata_size != kDimMetadataSize2DBlockSparse ||
+      sparsity.block_map == nullptr || sparsity.block_map->size != 2 ||
+      sparsity.block_map->data[0] != 0 || sparsity.block_map->data[1] != 1 ||
+      sparsity.traversal_order == nullptr) {
+    return false;
+  }
+  for (int i = 0; i < sparsity.traversal_order->size; ++i) {
+    if (sparsity.traversal_order->data[i] != i) return false;
+  }
+  return sparsity.dim_metadata[2].dense_size == block_rows &&
+         sparsity.dim_metadata[3].dense_size == block_cols;
+}
 
 TfLiteStatus CreateLedgerTensor(const TfLiteSparsity* sparsity,
                                 TfLiteContext* context, TfLiteTensor* ledger) {
@@ -135,7 +159,8 @@ inline TfLiteStatus CheckTypes(TfLiteContext* context,
                                const TfLiteTensor* bias, TfLiteTensor* output,
                                TfLiteFullyConnectedParams* params) {
   const bool is_quantized =
-      ((filter->type == kTfLiteUInt8) || (filter->type == kTfLiteInt8));
+      ((filter->type == kTfLiteUInt8) || (filter->type == kTfLiteInt8) ||
+       (filter->type == kTfLiteInt4));
   const bool is_hybrid = is_quantized && (input->type == kTfLiteFloat32);
   const bool is_shuffled =
       is_quantized && (params->weights_format ==
@@ -146,6 +171,14 @@ inline TfLiteStatus CheckTypes(TfLiteContext* context,
   const bool is_optional_bias_int =
       !bias || (bias->type == kTfLiteInt32) || (bias->type == kTfLiteInt64);
 
+  if (filter->type == kTfLiteInt4) {
+    // Int4 weights are only dequantized on the fly against float inputs.
+    TF_LITE_ENSURE(context, is_hybrid);
+    TF_LITE_ENSURE_EQ(context, params->weights_format,
+                      kTfLiteFullyConnectedWeightsFormatDefault);
+    TF_LITE_ENSURE(context, filter->sparsity == nullptr);
+  }
+
   if (is_quantized) {
     if (is_shuffled) {
       TF_LITE_ENSURE_TYPES_EQ(context, input->type, kTfLiteUInt8);
@@ -334,9 +367,24 @@ TfLiteStatus PrepareImpl(TfLiteContext* context, TfLiteNode* node) {
   // quantized values prior to multiplication by the scaling factor.
   const bool is_hybrid =
       (input->type == kTfLiteFloat32 &&
-       (filter->type == kTfLiteUInt8 || filter->type == kTfLiteInt8));
+       (filter->type == kTfLiteUInt8 || filter->type == kTfLiteInt8 ||
+        filter->type == kTfLiteInt4));
   const bool is_sparse = filter->sparsity != nullptr;
   if (is_hybrid) {
+    if (filter->type == kTfLiteInt4) {
+      // The int4 weights may be quantized per output channel.
+      const auto* affine_quantization =
+          reinterpret_cast<TfLiteAffineQuantization*>(
+              filter->quantization.params);
+      if (filter->quantization.type == kTfLiteAffineQuantization &&
+          affine_quantization && affine_quantization->scale &&
+          affine_quantization->scale->size > 1) {
+        TF_LITE_ENSURE_EQ(context, affine_quantization->scale->size,
+                          num_units);
+        TF_LITE_ENSURE_EQ(context, affine_quantization->quantized_dimension,
+                          0);
+      }
+    }
     TfLiteIntArrayFree(node->temporaries);
     data->compute_row_sums = true;
     if (is_sparse) {
@@ -349,7 +397,9 @@ TfLiteStatus PrepareImpl(TfLiteContext* context, TfLiteNode* node) {
     TfLiteTensor* input_quantized;
     TF_LITE_ENSURE_OK(context, GetTemporarySafe(context, node, /*index=*/0,
                                                 &input_quantized));
-    input_quantized->type = filter->type;
+    // The inputs are multiplied with int4 weights as int8.
+    input_quantized->type =
+        filter->type == kTfLiteInt4 ? kTfLiteInt8 : filter->type;
     input_quantized->allocation_type = kTfLiteArenaRw;
 
     TfLiteIntArray* input_quantized_size = TfLiteIntArrayCopy(input->dims);
@@ -458,7 +508,8 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   const TfLiteTensor* input;
   TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kInputTensor, &input));
   const bool is_quantized =
-      ((filter->type == kTfLiteUInt8) || (filter->type == kTfLiteInt8));
+      ((filter->type == kTfLiteUInt8) || (filter->type == kTfLiteInt8) ||
+       (filter->type == kTfLiteInt4));
   const bool is_hybrid = is_quantized && (input->type == kTfLiteFloat32);
   const bool is_pie = kernel_type == kLegacyPie;
 
@@ -556,18 +607,44 @@ TfLiteStatus EvalHybridDense(
   tensor_utils::BatchQuantizeFloats(
       input_ptr, batch_size, input_size, quant_data, scaling_factors_ptr,
       input_offset_ptr, params->asymmetric_quantize_inputs);
+  float filter_scale = filter->params.scale;
+  const float* per_channel_scale = nullptr;
+  if (filter->type == kTfLiteInt4) {
+    const auto* affine_quantization =
+        reinterpret_cast<TfLiteAffineQuantization*>(
+            filter->quantization.params);
+    if (affine_quantization && affine_quantization->scale &&
+        affine_quantization->scale->size > 1) {
+      filter_scale = 1.0f;
+      per_channel_scale = affine_quantization->scale->data;
+    }
+  }
   for (int b = 0; b < batch_size; ++b) {
     // Incorporate scaling of the filter.
-    scaling_factors_ptr[b] *= filter->params.scale;
+    scaling_factors_ptr[b] *= filter_scale;
   }
 
-  // Compute output += weight * quantized_input
-  int32_t* scratch = GetTensorData<int32_t>(accum_scratch);
-  tensor_utils::MatrixBatchVectorMultiplyAccumulate(
-      filter_data, num_units, input_size, quant_data, scaling_factors_ptr,
-      batch_size, GetTensorData<float>(output), /*per_channel_scale=*/nullptr,
-      input_offset_ptr, scratch, row_sums_ptr, &data->compute_row_sums,
-      CpuBackendContext::GetFromContext(context));
+  if (filter->type == kTfLiteInt4) {
+    // Compute output += weight * quantized_input, unpacking the int4 weights
+    // in the inner loop rather than into a buffer as large as the filter.
+    if (params->asymmetric_quantize_inputs && data->compute_row_sums) {
+      tensor_utils::ReductionSumVectorInt4(filter_data, row_sums_ptr,
+                                           num_units, input_size);
+      data->compute_row_sums = false;
+    }
+    tensor_utils::MatrixBatchVectorMultiplyAccumulateInt4(
+        filter_data, num_units, input_size, quant_data, scaling_factors_ptr,
+        batch_size, GetTensorData<float>(output), per_channel_scale,
+        input_offset_ptr, row_sums_ptr);
+  } else {
+    // Compute output += weight * quantized_input
+    int32_t* scratch = GetTensorData<int32_t>(accum_scratch);
+    tensor_utils::MatrixBatchVectorMultiplyAccumulate(
+        filter_data, num_units, input_size, quant_data, scaling_factors_ptr,
+        batch_size, GetTensorData<float>(output), /*per_channel_scale=*/nullptr,
+        input_offset_ptr, scratch, row_sums_ptr, &data->compute_row_sums,
+        CpuBackendContext::GetFromContext(context));
+  }
 
   // Apply activation function to floats.
   tensor_utils::ApplyActivationToVector(
@@ -930,8 +1007,21 @@ bool VerifySparsity(const RuntimeShape& weights_shape,
   const int batches = FlatSizeSkipDim(output_shape, output_dims_count - 1);
   const int output_depth = MatchingDim(weights_shape, weights_dims_count - 2,
                                        output_shape, output_dims_count - 1);
+  // The indices of block-sparse weights are in units of blocks.
+  int block_rows = 1;
+  int block_cols = 1;
+  if (sparsity->dim_metadata_size == kDimMetadataSizeBlockSparse) {
+    block_cols = sparsity->dim_metadata[2].dense_size;
+  } else if (sparsity->dim_metadata_size == kDimMetadataSize2DBlockSparse) {
+    block_rows = sparsity->dim_metadata[2].dense_size;
+    block_cols = sparsity->dim_metadata[3].dense_size;
+  }
+  if (block_rows <= 0 || block_cols <= 0 || output_depth % block_rows != 0 ||
+      accum_depth % block_cols != 0) {
+    return false;
+  }
   const int max_batch_index = batches - 1;
-  const int max_output = max_batch_index * output_depth + w0_size;
+  const int max_output = max_batch_index * output_depth + w0_size * block_rows;
   const int max_batch_depth = accum_depth * max_batch_index;
 
   // Verify output size is enough.
@@ -939,8 +1029,10 @@ bool VerifySparsity(const RuntimeShape& weights_shape,
 
   // Verify index from sparse in input is valid.
   for (int i = 0; i < sparsity->dim_metadata[1].array_indices->size; ++i) {
-    if (input_elements <=
-        max_batch_depth + sparsity->dim_metadata[1].array_indices->data[i])
+    if (input_elements <
+        max_batch_depth +
+            (sparsity->dim_metadata[1].array_indices->data[i] + 1) *
+                block_cols)
       return false;
   }
   return true;
@@ -1025,8 +1117,7 @@ TfLiteStatus EvalQuantized(TfLiteContext* context, TfLiteNode* node,
                 "Invalid quantized and sparse fully-connected format.");
             return kTfLiteError;
           }
-          if (sparsity.dim_metadata_size == kDimMetadataSizeBlockSparse &&
-              sparsity.dim_metadata[2].dense_size == 16) {
+          if (IsBlockSparse(sparsity, 1, 16)) {
             // Block sparse with block size of 1x16.
             optimized_ops::FullyConnectedSparseWeight1x16(
                 sparsity, op_params, input_shape, GetTensorData<int8_t>(input),
@@ -1034,6 +1125,22 @@ TfLiteStatus EvalQuantized(TfLiteContext* context, TfLiteNode* node,
                 GetTensorData<int32_t>(bias), output_shape,
                 GetTensorData<int8_t>(output),
                 CpuBackendContext::GetFromContext(context));
+          } else if (IsBlockSparse(sparsity, 1, 4)) {
+            // Block sparse with block size of 1x4.
+            optimized_ops::FullyConnectedSparseWeight1x4(
+                sparsity, op_params, input_shape, GetTensorData<int8_t>(input),
+                filter_shape, GetTensorData<int8_t>(filter), bias_shape,
+                GetTensorData<int32_t>(bias), output_shape,
+                GetTensorData<int8_t>(output),
+                CpuBackendContext::GetFromContext(context));
+          } else if (IsBlockSparse(sparsity, 4, 4)) {
+            // Block sparse with block size of 4x4.
+            optimized_ops::FullyConnectedSparseWeight4x4(
+                sparsity, op_params, input_shape, GetTensorData<int8_t>(input),
+                filter_shape, GetTensorData<int8_t>(filter), bias_shape,
+                GetTensorData<int32_t>(bias), output_shape,
+                GetTensorData<int8_t>(output),
+                CpuBackendContext::GetFromContext(context));
           } else {
             TF_LITE_KERNEL_LOG(
                 context, "Unsupported sparse fully-connected weight format.");
@@ -1215,8 +1322,7 @@ TfLiteStatus EvalFloat(TfLiteContext* context, TfLiteNode* node,
             filter_shape, GetTensorData<float>(filter),  // Disable formatting
             bias_shape, GetTensorData<float>(bias),      // Disable formatting
             output_shape, GetTensorData<float>(output));
-      } else if (sparsity.dim_metadata_size == kDimMetadataSizeBlockSparse &&
-                 sparsity.dim_metadata[2].dense_size == 4) {
+      } else if (IsBlockSparse(sparsity, 1, 4)) {
         // Block sparse with block size of 1x4.
         optimized_ops::FullyConnectedSparseWeight1x4(
             sparsity, op_params,                         // Disable formatting
@@ -1225,6 +1331,15 @@ TfLiteStatus EvalFloat(TfLiteContext* context, TfLiteNode* node,
             bias_shape, GetTensorData<float>(bias),      // Disable formatting
             output_shape, GetTensorData<float>(output),
             CpuBackendContext::GetFromContext(context));
+      } else if (IsBlockSparse(sparsity, 4, 4)) {
+        // Block sparse with block size of 4x4.
+        optimized_ops::FullyConnectedSparseWeight4x4(
+            sparsity, op_params,                         // Disable formatting
+            input_shape, GetTensorData<float>(input),    // Disable formatting
+            filter_shape, GetTensorData<float>(filter),  // Disable formatting
+            bias_shape, GetTensorData<float>(bias),      // Disable formatting
+            output_shape, GetTensorData<float>(output),
+            CpuBackendContext::GetFromContext(context));
       } else {
         TF_LITE_KERNEL_LOG(context,
                            "Unsupported sparse fully-connected weight format.");
@@ -1304,6 +1419,10 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
         TF_LITE_KERNEL_LOG(context, "Unhandled fully-connected weights format");
         return kTfLiteError;
       }
+    case kTfLiteInt4:
+      // Only the hybrid path, as checked in Prepare.
+      return EvalQuantized<kernel_type>(context, node, params, data, input,
+                                        filter, bias, output);
     default:
       TF_LITE_KERNEL_LOG(context,
                          "Filter data type %s currently not supported.",
@@ -444,6 +444,10 @@ class HybridFullyConnectedOpModel : public SingleOpModel {
     SignedSymmetricQuantizeAndPopulate(weights_, f);
   }
 
+  void SetPerChannelWeights(const std::vector<float>& data) {
+    PerChannelSymmetricQuantizeAndPopulate(weights_, data);
+  }
+
   void SetInput(const std::vector<float>& f) { PopulateTensor(input_, f); }
   std::vector<float> GetOutput() { return ExtractVector<float>(output_); }
   std::vector<int> GetOutputShape() { return GetTensorShape(output_); }
@@ -1274,6 +1278,68 @@ TEST(HybridFullyConnectedOpTest, SimpleTestQuantizedInt8MultiThreaded) {
   }
 }
 
+TEST(HybridFullyConnectedOpTest, SimpleTestPerChannelQuantizedInt4) {
+  HybridFullyConnectedOpModel m(
+      /*units=*/3, /*batches=*/2,
+      /*input=*/{TensorType_FLOAT32, {2, 10}},
+      /*weights=*/
+      {TensorType_INT4, {3, 10}, 0, 0, 0, 0, true, {1.0, 2.0, 3.0}, {0, 0, 0},
+       0});  // Hybrid
+
+  m.SetPerChannelWeights({
+      1, 2, 3, 4,  5,  6,  7,  -1, -2, -3,  // u = 0
+      2, 4, 6, 8,  10, 12, 14, -2, -4, -6,  // u = 1
+      3, 6, 9, 12, 15, 18, 21, -3, -6, -9,  // u = 2
+  });
+  m.SetBias({1, 2, 3});
+
+  m.SetInput({
+      1, 2, 3, 4, 5, 6, 7, 8,  -9, -10,  // b = 0
+      1, 2, 3, 4, 5, 6, 7, -8, 9,  -10,  // b = 1
+  });
+
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutput(), ElementsAreArray(ArrayFloatNear(
+                                 {
+                                     181, 362, 543,  //
+                                     161, 322, 483,  //
+                                 },
+                                 /*max_abs_error=*/5.0f)));
+}
+
+TEST(HybridAsymmetricInputFullyConnectedOpTest, SimpleTestQuantizedInt4) {
+  HybridFullyConnectedOpModel m(
+      /*units=*/3, /*batches=*/2,
+      /*input=*/{TensorType_FLOAT32, {2, 7}},
+      /*weights=*/
+      {TensorType_INT4, {3, 7}, 0, 0, 0, 0, true, {1.0}, {0}, 0},
+      {TensorType_FLOAT32},
+      /*asymmetric_quantize_input*/ true);
+
+  // Rows of an odd length start in the middle of the packed bytes.
+  m.SetPerChannelWeights({
+      1,  2,  3,  4,  5,  6,  7,   // u = 0
+      -1, -2, -3, -4, -5, -6, -7,  // u = 1
+      1,  -1, 1,  -1, 1,  -1, 1,   // u = 2
+  });
+  m.SetBias({1, 2, 3});
+
+  m.SetInput({
+      1, 2, 3, 4, 5, 6, 7,    // b = 0
+      1, 0, 1, 0, -1, 0, -1,  // b = 1
+  });
+
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutput(), ElementsAreArray(ArrayFloatNear(
+                                 {
+                                     141, 0, 7,  //
+                                     0, 10, 3,   //
+                                 },
+                                 /*max_abs_error=*/1.0f)));
+}
+
 TEST(HybridAsymmetricInputFullyConnectedOpTest, SimpleTestQuantizedUint8) {
   HybridFullyConnectedOpModel m(
       /*units=*/3, /*batches=*/2,
@@ -1860,6 +1926,47 @@ TEST_P(SparseFullyConnectedOpTest, Simple1x4TestMultiThreadedMoreBatches) {
   }
 }
 
+TEST_P(SparseFullyConnectedOpTest, Simple4x4Test) {
+  std::initializer_list<float> weight_data = {
+      1,  2,  3,  4,  0,  0,  0,  0,   // u = 0
+      -1, -2, -3, -4, 0,  0,  0,  0,   // u = 1
+      1,  0,  1,  0,  0,  0,  0,  0,   // u = 2
+      0,  1,  0,  1,  0,  0,  0,  0,   // u = 3
+      0,  0,  0,  0,  1,  1,  1,  1,   // u = 4
+      0,  0,  0,  0,  2,  -2, 2,  -2,  // u = 5
+      0,  0,  0,  0,  0,  0,  0,  0,   // u = 6
+      0,  0,  0,  0,  -1, 2,  -3, 4,   // u = 7
+  };
+  TensorData weight = {};
+  weight.type = TensorType_FLOAT32;
+  weight.shape = {8, 8};
+  weight.traversal_order = {0, 1, 2, 3};
+  weight.format = {kTfLiteDimDense, kTfLiteDimSparseCSR};
+  weight.block_map = {0, 1};
+  weight.block_size = {4, 4};
+  for (int num_threads = 1; num_threads <= 2; num_threads++) {
+    SparseFullyConnectedOpModel<float> m(
+        GetRegistration(),
+        /*units=*/8, /*batches=*/2,
+        /*input=*/{TensorType_FLOAT32, {2, 8}}, weight, weight_data,
+        /*output=*/{TensorType_FLOAT32},
+        /*bias_tensor_optional=*/false, /*num_threads=*/num_threads);
+    m.SetBias({1, 2, 3, 4, 5, 6, 7, 8});
+
+    m.SetInput({
+        1,  2,  3, 4, 5,  6, 7,  8,  // b = 0
+        -1, -2, 3, 4, -5, 6, -7, 8,  // b = 1
+    });
+
+    ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+    EXPECT_THAT(m.GetOutputShape(), ElementsAre(2, 8));
+    EXPECT_THAT(m.GetOutput(), ElementsAre(31, 0, 7, 10, 31, 2, 7, 26,  // b = 0
+                                           21, 0, 5, 6, 7, 0, 7, 78     // b = 1
+                                           ));
+  }
+}
+
 TEST_P(SparseHybridFullyConnectedOpTest, SparseHybrid1x16Test) {
   std::initializer_list<float> weight_data = {
       /* 1st row */
@@ -2099,6 +2206,71 @@ TEST_P(SparseQuantizedFullyConnectedOpTest, Simple1x16TestNoBias) {
   EXPECT_THAT(m.GetOutput(), ElementsAre(10, 0, 22, 0, 0, 18));
 }
 
+TEST_P(SparseQuantizedFullyConnectedOpTest, Simple1x4Test) {
+  std::vector<float> weight_data = {
+      1,  2,  3,  4,  0, 0, 0, 0,  // u = 0
+      0,  0,  0,  0,  0, 0, 0, 0,  // u = 1
+      -1, -2, -3, -4, 4, 3, 2, 1,  // u = 2
+  };
+  TensorData weight = {TensorType_INT8, {3, 8}, 0, 0, 1};
+  weight.traversal_order = {0, 1, 2};
+  weight.format = {kTfLiteDimDense, kTfLiteDimSparseCSR};
+  weight.block_map = {1};
+  weight.block_size = {4};
+  SparseQuantizedFullyConnectedOpModel m(
+      GetRegistration(),
+      /*units=*/3, /*batches=*/2,
+      /*input=*/{TensorType_INT8, {2, 8}, 0, 0, 1}, weight, weight_data,
+      /*output=*/{TensorType_INT8, {}, 0, 0, 1});
+
+  m.SetBias({1, 2, 3});
+  m.SetInput({
+      1, 2, 3, 4, 1, 2, 3, 4,  // b = 0
+      4, 3, 2, 1, 4, 3, 2, 1,  // b = 1
+  });
+
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutputShape(), ElementsAre(2, 3));
+  EXPECT_THAT(m.GetOutput(), ElementsAre(31, 2, 0, 21, 2, 13));
+}
+
+TEST_P(SparseQuantizedFullyConnectedOpTest, Simple4x4Test) {
+  std::vector<float> weight_data = {
+      1,  2,  3,  4,  0,  0,  0,  0,   // u = 0
+      -1, -2, -3, -4, 0,  0,  0,  0,   // u = 1
+      1,  0,  1,  0,  0,  0,  0,  0,   // u = 2
+      0,  1,  0,  1,  0,  0,  0,  0,   // u = 3
+      0,  0,  0,  0,  1,  1,  1,  1,   // u = 4
+      0,  0,  0,  0,  2,  -2, 2,  -2,  // u = 5
+      0,  0,  0,  0,  0,  0,  0,  0,   // u = 6
+      0,  0,  0,  0,  -1, 2,  -3, 4,   // u = 7
+  };
+  TensorData weight = {TensorType_INT8, {8, 8}, 0, 0, 1};
+  weight.traversal_order = {0, 1, 2, 3};
+  weight.format = {kTfLiteDimDense, kTfLiteDimSparseCSR};
+  weight.block_map = {0, 1};
+  weight.block_size = {4, 4};
+  SparseQuantizedFullyConnectedOpModel m(
+      GetRegistration(),
+      /*units=*/8, /*batches=*/2,
+      /*input=*/{TensorType_INT8, {2, 8}, 0, 0, 1}, weight, weight_data,
+      /*output=*/{TensorType_INT8, {}, 0, 0, 1});
+
+  m.SetBias({1, 2, 3, 4, 5, 6, 7, 8});
+  m.SetInput({
+      1, 2, 3, 4, 1, 2, 3, 4,  // b = 0
+      4, 3, 2, 1, 4, 3, 2, 1,  // b = 1
+  });
+
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutputShape(), ElementsAre(2, 8));
+  EXPECT_THAT(m.GetOutput(), ElementsAre(31, 0, 7, 10, 15, 2, 7, 18,  // b = 0
+                                         21, 0, 9, 8, 15, 10, 7, 8    // b = 1
+                                         ));
+}
+
 TEST_P(SparseQuantizedFullyConnectedOpTest, Simple1x16TestScaledInputOutput) {
   std::initializer_list<float> weight_data = {
       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
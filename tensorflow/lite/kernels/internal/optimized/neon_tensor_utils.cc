@@ -219,6 +219,26 @@ inline int32x4x2_t MultiplyByQuantizedMultiplier2Rows(
 }
 #endif  // TFLITE_SINGLE_ROUNDING
 
+// Loads 4 int8 values, which may be unaligned, as a single int32.
+inline int32_t LoadInt8x4(const int8_t* ptr) {
+  int32_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+// Adds the bias to the int32 dot product of a row and requantizes it to int8,
+// as the quantized sparse kernels do.
+inline int8_t RequantizeSparseAccumulator(
+    int32_t acc, int32_t bias_value, int32_t output_multiplier,
+    int32_t output_shift, int32_t output_offset, int32_t output_activation_min,
+    int32_t output_activation_max) {
+  acc = MultiplyByQuantizedMultiplier(acc + bias_value, output_multiplier,
+                                      output_shift);
+  acc += output_offset;
+  return static_cast<int8_t>(ActivationFunctionWithMinMax(
+      acc, output_activation_min, output_activation_max));
+}
+
 }  // namespace
 
 void NeonMatrixBatchVectorMultiplyAccumulate(const float* matrix, int m_rows,
@@ -1510,6 +1530,69 @@ inline int64x2x2_t MulAdd(int32x4_t acc, int32x4_t lhs, int32x4_t rhs) {
   return result;
 }
 
+void NeonMatrixBatchVectorMultiplyAccumulateInt4(
+    const int8_t* __restrict__ matrix, const int m_rows, const int m_cols,
+    const int8_t* __restrict__ vectors, const float* scaling_factors,
+    int n_batch, float* __restrict__ result, const float* per_channel_scale,
+    const int32_t* input_offset, const int32_t* row_sums) {
+  TFLITE_DCHECK_EQ(m_cols % 2, 0);
+  const int packed_cols = m_cols / 2;
+  const int postamble_start = m_cols & ~(2 * kInt8ValuesPerNeonVector - 1);
+  for (int batch = 0; batch < n_batch; ++batch, vectors += m_cols) {
+    const float batch_scaling_factor = scaling_factors[batch];
+    const int32_t batch_offset = input_offset ? input_offset[batch] : 0;
+    for (int row = 0; row < m_rows; ++row) {
+      const int8_t* row_ptr = matrix + row * packed_cols;
+      // Prefetch the row to cache.
+      __builtin_prefetch(row_ptr, 0 /* prefetch for read */,
+                         3 /* temporal locality */);
+      int32x4_t dotprod_32x4 = vmovq_n_s32(0);
+
+      // For every block of 32 4-bit weights.
+      int col = 0;
+      for (; col < postamble_start; col += 2 * kInt8ValuesPerNeonVector) {
+        const int8x16_t packed_8x16 = vld1q_s8(row_ptr + col / 2);
+        // Sign-extend the low and the high nibbles, and interleave them back
+        // into the order of the weights.
+        const int8x16x2_t row_8x16x2 =
+            vzipq_s8(vshrq_n_s8(vshlq_n_s8(packed_8x16, 4), 4),
+                     vshrq_n_s8(packed_8x16, 4));
+        const int8x16_t vec_0_8x16 = vld1q_s8(vectors + col);
+        const int8x16_t vec_1_8x16 =
+            vld1q_s8(vectors + col + kInt8ValuesPerNeonVector);
+        // The 4-bit weights keep the sum of the 4 products within 16 bits.
+        int16x8_t prod_16x8 = vmull_s8(vget_low_s8(vec_0_8x16),
+                                       vget_low_s8(row_8x16x2.val[0]));
+        prod_16x8 = vmlal_s8(prod_16x8, vget_high_s8(vec_0_8x16),
+                             vget_high_s8(row_8x16x2.val[0]));
+        prod_16x8 = vmlal_s8(prod_16x8, vget_low_s8(vec_1_8x16),
+                             vget_low_s8(row_8x16x2.val[1]));
+        prod_16x8 = vmlal_s8(prod_16x8, vget_high_s8(vec_1_8x16),
+                             vget_high_s8(row_8x16x2.val[1]));
+        dotprod_32x4 = vpadalq_s16(dotprod_32x4, prod_16x8);
+      }  // for col
+
+      int32_t dotprod = AccumulateNeonLane(dotprod_32x4);
+
+      // Postamble loop, two weights at a time.
+      for (; TFLITE_UNLIKELY(col < m_cols); col += 2) {
+        const int8_t packed = row_ptr[col / 2];
+        dotprod += (static_cast<int8_t>(packed << 4) >> 4) * vectors[col];
+        dotprod += (packed >> 4) * vectors[col + 1];
+      }  // for col
+      if (input_offset) {
+        dotprod -= row_sums[row] * batch_offset;
+      }
+      float scale = batch_scaling_factor;
+      if (per_channel_scale) {
+        scale *= per_channel_scale[row];
+      }
+      *result += dotprod * scale;
+      ++result;
+    }  // for row
+  }    // for batch
+}
+
 void NeonApplyLayerNorm(const int16_t* input, const int16_t* layer_norm_weights,
                         const int32_t* bias, int32_t layer_norm_scale_a,
                         int32_t layer_norm_scale_b, int32_t variance_limit,
@@ -2031,6 +2114,171 @@ void NeonSparseMatrixBatchVectorMultiplyAccumulate1x16(
   }
 }
 
+void NeonSparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  constexpr int kBlockSize = 4;
+  constexpr int kBlocksPerNeonVector = kInt8ValuesPerNeonVector / kBlockSize;
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+
+  for (int batch = 0; batch < n_batch; ++batch) {
+    const int8_t* matrix_ptr = matrix;
+    const int8_t* vector_in_batch = vector + batch * m_cols;
+    for (int row = 0; row < m_rows; ++row) {
+      int32x4_t acc_i32x4 = vmovq_n_s32(0);
+      int32x4_t matrix_row_sum_i32x4 = vmovq_n_s32(0);
+      int i = segments[row];
+      // Gathers the vector values of 4 non-zero blocks at a time, so that the
+      // accumulation loop works on full NEON vectors.
+      for (; i + kBlocksPerNeonVector <= segments[row + 1];
+           i += kBlocksPerNeonVector) {
+        int32x4_t vector_i32x4 = vmovq_n_s32(0);
+        vector_i32x4 = vsetq_lane_s32(
+            LoadInt8x4(vector_in_batch + indices[i] * kBlockSize),
+            vector_i32x4, 0);
+        vector_i32x4 = vsetq_lane_s32(
+            LoadInt8x4(vector_in_batch + indices[i + 1] * kBlockSize),
+            vector_i32x4, 1);
+        vector_i32x4 = vsetq_lane_s32(
+            LoadInt8x4(vector_in_batch + indices[i + 2] * kBlockSize),
+            vector_i32x4, 2);
+        vector_i32x4 = vsetq_lane_s32(
+            LoadInt8x4(vector_in_batch + indices[i + 3] * kBlockSize),
+            vector_i32x4, 3);
+        const int8x16_t vector_i8x16 = vreinterpretq_s8_s32(vector_i32x4);
+        const int8x16_t matrix_i8x16 = vld1q_s8(matrix_ptr);
+
+        // Multiply the vector and matrix row and add to accumulator.
+        int16x8_t acc_i16x8 =
+            vmull_s8(vget_low_s8(vector_i8x16), vget_low_s8(matrix_i8x16));
+        acc_i16x8 = vmlal_s8(acc_i16x8, vget_high_s8(vector_i8x16),
+                             vget_high_s8(matrix_i8x16));
+        acc_i32x4 = vpadalq_s16(acc_i32x4, acc_i16x8);
+        matrix_row_sum_i32x4 =
+            vpadalq_s16(matrix_row_sum_i32x4, vpaddlq_s8(matrix_i8x16));
+        matrix_ptr += kInt8ValuesPerNeonVector;
+      }
+      int32_t acc = AccumulateNeonLane(acc_i32x4);
+      int32_t matrix_row_sum = AccumulateNeonLane(matrix_row_sum_i32x4);
+      for (; TFLITE_UNLIKELY(i < segments[row + 1]); ++i) {
+        const int8_t* vector_block_in_batch_ptr =
+            vector_in_batch + indices[i] * kBlockSize;
+        for (int c = 0; c < kBlockSize; ++c) {
+          acc += *matrix_ptr * vector_block_in_batch_ptr[c];
+          matrix_row_sum += *matrix_ptr++;
+        }
+      }
+      const int32_t bias_value = bias_vector != nullptr ? bias_vector[row] : 0;
+      result[batch * m_rows + row] = RequantizeSparseAccumulator(
+          acc + input_offset * matrix_row_sum, bias_value, output_multiplier,
+          output_shift, output_offset, output_activation_min,
+          output_activation_max);
+    }
+  }
+}
+
+void NeonSparseMatrixBatchVectorMultiplyAccumulate4x4(
+    const float* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const float* __restrict__ vector, int n_batch, float* __restrict__ result) {
+  constexpr int kBlockSize = kFloatValuesPerNeonVector;
+  TFLITE_DCHECK_EQ(m_rows % kBlockSize, 0);
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+
+  for (int batch = 0; batch < n_batch; batch++) {
+    const float* matrix_ptr = matrix;
+    const float* vector_in_batch = vector + batch * m_cols;
+    float* result_in_batch = result + batch * m_rows;
+    for (int block_row = 0; block_row < m_rows / kBlockSize; block_row++) {
+      // One accumulator per row of the blocks.
+      float32x4_t acc0_32x4 = vmovq_n_f32(0.0);
+      float32x4_t acc1_32x4 = vmovq_n_f32(0.0);
+      float32x4_t acc2_32x4 = vmovq_n_f32(0.0);
+      float32x4_t acc3_32x4 = vmovq_n_f32(0.0);
+
+      for (int i = segments[block_row]; i < segments[block_row + 1]; i++) {
+        // Load the 4 float values of the vector, shared by the block rows.
+        const float32x4_t vector_f32x4 =
+            vld1q_f32(vector_in_batch + indices[i] * kBlockSize);
+        acc0_32x4 = vmlaq_f32(acc0_32x4, vld1q_f32(matrix_ptr), vector_f32x4);
+        acc1_32x4 = vmlaq_f32(acc1_32x4, vld1q_f32(matrix_ptr + kBlockSize),
+                              vector_f32x4);
+        acc2_32x4 = vmlaq_f32(
+            acc2_32x4, vld1q_f32(matrix_ptr + 2 * kBlockSize), vector_f32x4);
+        acc3_32x4 = vmlaq_f32(
+            acc3_32x4, vld1q_f32(matrix_ptr + 3 * kBlockSize), vector_f32x4);
+        matrix_ptr += kBlockSize * kBlockSize;
+      }
+      float* result_block = result_in_batch + block_row * kBlockSize;
+      result_block[0] += AccumulateNeonLane(acc0_32x4);
+      result_block[1] += AccumulateNeonLane(acc1_32x4);
+      result_block[2] += AccumulateNeonLane(acc2_32x4);
+      result_block[3] += AccumulateNeonLane(acc3_32x4);
+    }
+  }
+}
+
+void NeonSparseMatrixBatchVectorMultiplyAccumulate4x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  constexpr int kBlockSize = 4;
+  TFLITE_DCHECK_EQ(m_rows % kBlockSize, 0);
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+
+  for (int batch = 0; batch < n_batch; ++batch) {
+    const int8_t* matrix_ptr = matrix;
+    const int8_t* vector_in_batch = vector + batch * m_cols;
+    int8_t* result_in_batch = result + batch * m_rows;
+    for (int block_row = 0; block_row < m_rows / kBlockSize; ++block_row) {
+      // The partial dot products of the rows 0 and 1, and of the rows 2 and 3
+      // of the blocks, two lanes per row.
+      int32x4_t acc01_i32x4 = vmovq_n_s32(0);
+      int32x4_t acc23_i32x4 = vmovq_n_s32(0);
+      int32x4_t matrix_row_sums_i32x4 = vmovq_n_s32(0);
+
+      for (int i = segments[block_row]; i < segments[block_row + 1]; ++i) {
+        // Repeat the 4 int8 values of the vector for each row of the block.
+        const int8x16_t vector_i8x16 = vreinterpretq_s8_s32(
+            vdupq_n_s32(LoadInt8x4(vector_in_batch + indices[i] * kBlockSize)));
+        const int8x16_t matrix_i8x16 = vld1q_s8(matrix_ptr);
+        acc01_i32x4 = vpadalq_s16(
+            acc01_i32x4,
+            vmull_s8(vget_low_s8(vector_i8x16), vget_low_s8(matrix_i8x16)));
+        acc23_i32x4 = vpadalq_s16(
+            acc23_i32x4,
+            vmull_s8(vget_high_s8(vector_i8x16), vget_high_s8(matrix_i8x16)));
+        matrix_row_sums_i32x4 =
+            vpadalq_s16(matrix_row_sums_i32x4, vpaddlq_s8(matrix_i8x16));
+        matrix_ptr += kBlockSize * kBlockSize;
+      }
+      const int32x4_t dot_prods_i32x4 = vcombine_s32(
+          vpadd_s32(vget_low_s32(acc01_i32x4), vget_high_s32(acc01_i32x4)),
+          vpadd_s32(vget_low_s32(acc23_i32x4), vget_high_s32(acc23_i32x4)));
+      int32_t acc[kBlockSize];
+      vst1q_s32(acc, vmlaq_n_s32(dot_prods_i32x4, matrix_row_sums_i32x4,
+                                 input_offset));
+      for (int r = 0; r < kBlockSize; ++r) {
+        const int row = block_row * kBlockSize + r;
+        const int32_t bias_value =
+            bias_vector != nullptr ? bias_vector[row] : 0;
+        result_in_batch[row] = RequantizeSparseAccumulator(
+            acc[r], bias_value, output_multiplier, output_shift, output_offset,
+            output_activation_min, output_activation_max);
+      }
+    }
+  }
+}
+
 void NeonSparseMatrixBatchVectorMultiplyAccumulate(
     const float* __restrict__ matrix, const uint8_t* __restrict__ ledger,
     int m_rows, int m_cols, const float* __restrict__ vector, int n_batch,
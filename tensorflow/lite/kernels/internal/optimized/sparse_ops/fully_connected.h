@@ -76,15 +76,26 @@ inline void FullyConnectedSparseWeight(
   }
 }
 
-inline void FullyConnectedSparseWeight1x16Impl(
+// Runs a quantized fully connected with a symmetric quantized weight stored in
+// block compressed sparse row format with blocks of kBlockRows x kBlockCols,
+// for the batches in [thread_start, thread_end).
+template <int kBlockRows, int kBlockCols>
+inline void FullyConnectedSparseWeightBlockImpl(
     const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
     const RuntimeShape& input_shape, const int8_t* input_data,
     const RuntimeShape& weights_shape, const int8_t* weights_data,
     const RuntimeShape& bias_shape, const int32_t* bias_data,
     const RuntimeShape& output_shape, int8_t* output_data, int thread_start,
     int thread_end, const CpuBackendContext& cpu_backend_context) {
+  static_assert((kBlockRows == 1 && kBlockCols == 16) ||
+                    (kBlockRows == 1 && kBlockCols == 4) ||
+                    (kBlockRows == 4 && kBlockCols == 4),
+                "Unsupported block size.");
   ruy::profiler::ScopeLabel label("FullyConnected");
-  ruy::profiler::ScopeLabel inner_label("1x16 Block Sparse");
+  ruy::profiler::ScopeLabel inner_label(
+      kBlockCols == 16  ? "1x16 Block Sparse"
+      : kBlockRows == 1 ? "1x4 Block Sparse"
+                        : "4x4 Block Sparse");
 
   const int input_dims_count = input_shape.DimensionsCount();
   const int output_dims_count = output_shape.DimensionsCount();
@@ -104,23 +115,58 @@ inline void FullyConnectedSparseWeight1x16Impl(
   const int* w1_segments = sparsity.dim_metadata[1].array_segments->data;
   const int* w1_indices = sparsity.dim_metadata[1].array_indices->data;
 
-  tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x16(
-      weights_data, w1_segments, w1_indices, weights_shape.Dims(0),
-      weights_shape.Dims(1), input_data + thread_start * input_depth, bias_data,
-      batches, input_offset, output_multiplier, output_shift, output_offset,
-      output_activation_min, output_activation_max,
-      output_data + thread_start * output_depth);
+  if (kBlockCols == 16) {
+    tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x16(
+        weights_data, w1_segments, w1_indices, output_depth, input_depth,
+        input_data + thread_start * input_depth, bias_data, batches,
+        input_offset, output_multiplier, output_shift, output_offset,
+        output_activation_min, output_activation_max,
+        output_data + thread_start * output_depth);
+  } else if (kBlockRows == 1) {
+    tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x4(
+        weights_data, w1_segments, w1_indices, output_depth, input_depth,
+        input_data + thread_start * input_depth, bias_data, batches,
+        input_offset, output_multiplier, output_shift, output_offset,
+        output_activation_min, output_activation_max,
+        output_data + thread_start * output_depth);
+  } else {
+    tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate4x4(
+        weights_data, w1_segments, w1_indices, output_depth, input_depth,
+        input_data + thread_start * input_depth, bias_data, batches,
+        input_offset, output_multiplier, output_shift, output_offset,
+        output_activation_min, output_activation_max,
+        output_data + thread_start * output_depth);
+  }
 }
 
-inline void FullyConnectedSparseWeight1x4Impl(
+inline void FullyConnectedSparseWeight1x16Impl(
+    const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
+    const RuntimeShape& input_shape, const int8_t* input_data,
+    const RuntimeShape& weights_shape, const int8_t* weights_data,
+    const RuntimeShape& bias_shape, const int32_t* bias_data,
+    const RuntimeShape& output_shape, int8_t* output_data, int thread_start,
+    int thread_end, const CpuBackendContext& cpu_backend_context) {
+  FullyConnectedSparseWeightBlockImpl<1, 16>(
+      sparsity, params, input_shape, input_data, weights_shape, weights_data,
+      bias_shape, bias_data, output_shape, output_data, thread_start,
+      thread_end, cpu_backend_context);
+}
+
+// Runs a float fully connected with a weight stored in block compressed sparse
+// row format with blocks of kBlockRows x 4, for the batches in
+// [thread_start, thread_end).
+template <int kBlockRows>
+inline void FullyConnectedSparseWeightBlockImpl(
     const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
     const RuntimeShape& input_shape, const float* input_data,
     const RuntimeShape& weights_shape, const float* weights_data,
     const RuntimeShape& bias_shape, const float* bias_data,
     const RuntimeShape& output_shape, float* output_data, int thread_start,
     int thread_end, const CpuBackendContext& cpu_backend_context) {
+  static_assert(kBlockRows == 1 || kBlockRows == 4, "Unsupported block size.");
   ruy::profiler::ScopeLabel label("FullyConnected");
-  ruy::profiler::ScopeLabel inner_label("1x4 Block Sparse");
+  ruy::profiler::ScopeLabel inner_label(kBlockRows == 1 ? "1x4 Block Sparse"
+                                                        : "4x4 Block Sparse");
   const float output_activation_min = params.float_activation_min;
   const float output_activation_max = params.float_activation_max;
 
@@ -135,10 +181,17 @@ inline void FullyConnectedSparseWeight1x4Impl(
   const int* w1_segments = sparsity.dim_metadata[1].array_segments->data;
   const int* w1_indices = sparsity.dim_metadata[1].array_indices->data;
 
-  tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x4(
-      weights_data, w1_segments, w1_indices, weights_shape.Dims(0),
-      weights_shape.Dims(1), input_data + thread_start * input_depth, batches,
-      output_data + thread_start * output_depth);
+  if (kBlockRows == 1) {
+    tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x4(
+        weights_data, w1_segments, w1_indices, output_depth, input_depth,
+        input_data + thread_start * input_depth, batches,
+        output_data + thread_start * output_depth);
+  } else {
+    tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate4x4(
+        weights_data, w1_segments, w1_indices, output_depth, input_depth,
+        input_data + thread_start * input_depth, batches,
+        output_data + thread_start * output_depth);
+  }
 
   ruy::profiler::ScopeLabel activation_label("activation function");
   for (int b = thread_start; b < thread_end; ++b) {
@@ -151,8 +204,22 @@ inline void FullyConnectedSparseWeight1x4Impl(
   }
 }
 
-struct FullyConnectedSparseWeight1x4Task : cpu_backend_threadpool::Task {
-  FullyConnectedSparseWeight1x4Task(
+inline void FullyConnectedSparseWeight1x4Impl(
+    const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
+    const RuntimeShape& input_shape, const float* input_data,
+    const RuntimeShape& weights_shape, const float* weights_data,
+    const RuntimeShape& bias_shape, const float* bias_data,
+    const RuntimeShape& output_shape, float* output_data, int thread_start,
+    int thread_end, const CpuBackendContext& cpu_backend_context) {
+  FullyConnectedSparseWeightBlockImpl<1>(
+      sparsity, params, input_shape, input_data, weights_shape, weights_data,
+      bias_shape, bias_data, output_shape, output_data, thread_start,
+      thread_end, cpu_backend_context);
+}
+
+template <int kBlockRows>
+struct FullyConnectedSparseWeightBlockTask : cpu_backend_threadpool::Task {
+  FullyConnectedSparseWeightBlockTask(
       const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
       const RuntimeShape& input_shape, const float* input_data,
       const RuntimeShape& weights_shape, const float* weights_data,
@@ -174,7 +241,7 @@ struct FullyConnectedSparseWeight1x4Task : cpu_backend_threadpool::Task {
         cpu_backend_context(cpu_backend_context_x) {}
 
   void Run() override {
-    FullyConnectedSparseWeight1x4Impl(
+    FullyConnectedSparseWeightBlockImpl<kBlockRows>(
         sparsity, params, input_shape, input_data, weights_shape, weights_data,
         bias_shape, bias_data, output_shape, output_data, thread_start,
         thread_end, cpu_backend_context);
@@ -196,31 +263,15 @@ struct FullyConnectedSparseWeight1x4Task : cpu_backend_threadpool::Task {
   const CpuBackendContext& cpu_backend_context;
 };
 
-inline void FullyConnectedSparseWeight1x16(
-    const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
-    const RuntimeShape& input_shape, const int8_t* input_data,
-    const RuntimeShape& weights_shape, const int8_t* weights_data,
-    const RuntimeShape& bias_shape, const int32_t* bias_data,
-    const RuntimeShape& output_shape, int8_t* output_data,
-    CpuBackendContext* cpu_backend_context) {
-  const int output_elements = output_shape.FlatSize();
-  memset(output_data, 0, output_elements * sizeof(int8_t));
-
-  const int batches =
-      FlatSizeSkipDim(output_shape, output_shape.DimensionsCount() - 1);
-
-  // TODO(b/220851507): Add multi-thread support for quantized sparse kernel.
-  return FullyConnectedSparseWeight1x16Impl(
-      sparsity, params, input_shape, input_data, weights_shape, weights_data,
-      bias_shape, bias_data, output_shape, output_data, 0, batches,
-      *cpu_backend_context);
-}
+using FullyConnectedSparseWeight1x4Task =
+    FullyConnectedSparseWeightBlockTask<1>;
 
 // The multi-threaded kernel slices the workload along the batch dimension. If
 // there's not enough batches of data, the number of threads used is equal to
 // the batch size. We can improve this later with slicing along the row
 // dimension of the weight.
-inline void FullyConnectedSparseWeight1x4(
+template <int kBlockRows>
+inline void FullyConnectedSparseWeightBlock(
     const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
     const RuntimeShape& input_shape, const float* input_data,
     const RuntimeShape& weights_shape, const float* weights_data,
@@ -235,12 +286,12 @@ inline void FullyConnectedSparseWeight1x4(
       FlatSizeSkipDim(output_shape, output_shape.DimensionsCount() - 1);
   const int thread_count = std::max(1, std::min(batches, max_threads));
   if (thread_count == 1) {
-    return FullyConnectedSparseWeight1x4Impl(
+    return FullyConnectedSparseWeightBlockImpl<kBlockRows>(
         sparsity, params, input_shape, input_data, weights_shape, weights_data,
         bias_shape, bias_data, output_shape, output_data, 0, batches,
         *cpu_backend_context);
   }
-  std::vector<FullyConnectedSparseWeight1x4Task> tasks;
+  std::vector<FullyConnectedSparseWeightBlockTask<kBlockRows>> tasks;
   tasks.reserve(thread_count);
   int thread_start = 0;
   for (int i = 0; i < thread_count; ++i) {
@@ -260,6 +311,91 @@ inline void FullyConnectedSparseWeight1x4(
                                   cpu_backend_context);
 }
 
+// Runs a quantized fully connected with a symmetric quantized weight stored in
+// block compressed sparse row format with blocks of kBlockRows x kBlockCols.
+template <int kBlockRows, int kBlockCols>
+inline void FullyConnectedSparseWeightBlock(
+    const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
+    const RuntimeShape& input_shape, const int8_t* input_data,
+    const RuntimeShape& weights_shape, const int8_t* weights_data,
+    const RuntimeShape& bias_shape, const int32_t* bias_data,
+    const RuntimeShape& output_shape, int8_t* output_data,
+    CpuBackendContext* cpu_backend_context) {
+  const int output_elements = output_shape.FlatSize();
+  memset(output_data, 0, output_elements * sizeof(int8_t));
+
+  const int batches =
+      FlatSizeSkipDim(output_shape, output_shape.DimensionsCount() - 1);
+
+  // TODO(b/220851507): Add multi-thread support for quantized sparse kernel.
+  return FullyConnectedSparseWeightBlockImpl<kBlockRows, kBlockCols>(
+      sparsity, params, input_shape, input_data, weights_shape, weights_data,
+      bias_shape, bias_data, output_shape, output_data, 0, batches,
+      *cpu_backend_context);
+}
+
+inline void FullyConnectedSparseWeight1x16(
+    const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
+    const RuntimeShape& input_shape, const int8_t* input_data,
+    const RuntimeShape& weights_shape, const int8_t* weights_data,
+    const RuntimeShape& bias_shape, const int32_t* bias_data,
+    const RuntimeShape& output_shape, int8_t* output_data,
+    CpuBackendContext* cpu_backend_context) {
+  FullyConnectedSparseWeightBlock<1, 16>(
+      sparsity, params, input_shape, input_data, weights_shape, weights_data,
+      bias_shape, bias_data, output_shape, output_data, cpu_backend_context);
+}
+
+inline void FullyConnectedSparseWeight1x4(
+    const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
+    const RuntimeShape& input_shape, const int8_t* input_data,
+    const RuntimeShape& weights_shape, const int8_t* weights_data,
+    const RuntimeShape& bias_shape, const int32_t* bias_data,
+    const RuntimeShape& output_shape, int8_t* output_data,
+    CpuBackendContext* cpu_backend_context) {
+  FullyConnectedSparseWeightBlock<1, 4>(
+      sparsity, params, input_shape, input_data, weights_shape, weights_data,
+      bias_shape, bias_data, output_shape, output_data, cpu_backend_context);
+}
+
+inline void FullyConnectedSparseWeight4x4(
+    const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
+    const RuntimeShape& input_shape, const int8_t* input_data,
+    const RuntimeShape& weights_shape, const int8_t* weights_data,
+    const RuntimeShape& bias_shape, const int32_t* bias_data,
+    const RuntimeShape& output_shape, int8_t* output_data,
+    CpuBackendContext* cpu_backend_context) {
+  FullyConnectedSparseWeightBlock<4, 4>(
+      sparsity, params, input_shape, input_data, weights_shape, weights_data,
+      bias_shape, bias_data, output_shape, output_data, cpu_backend_context);
+}
+
+inline void FullyConnectedSparseWeight1x4(
+    const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
+    const RuntimeShape& input_shape, const float* input_data,
+    const RuntimeShape& weights_shape, const float* weights_data,
+    const RuntimeShape& bias_shape, const float* bias_data,
+    const RuntimeShape& output_shape, float* output_data,
+    CpuBackendContext* cpu_backend_context) {
+  FullyConnectedSparseWeightBlock<1>(
+      sparsity, params, input_shape, input_data, weights_shape, weights_data,
+      bias_shape, bias_data, output_shape, output_data, cpu_backend_context);
+}
+
+// Same as the function above, but the weight is stored with blocks of 4x4,
+// i.e. the rows are also grouped by 4.
+inline void FullyConnectedSparseWeight4x4(
+    const TfLiteSparsity& sparsity, const FullyConnectedParams& params,
+    const RuntimeShape& input_shape, const float* input_data,
+    const RuntimeShape& weights_shape, const float* weights_data,
+    const RuntimeShape& bias_shape, const float* bias_data,
+    const RuntimeShape& output_shape, float* output_data,
+    CpuBackendContext* cpu_backend_context) {
+  FullyConnectedSparseWeightBlock<4>(
+      sparsity, params, input_shape, input_data, weights_shape, weights_data,
+      bias_shape, bias_data, output_shape, output_data, cpu_backend_context);
+}
+
 }  // namespace optimized_ops
 }  // namespace tflite
 #endif  // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_FULLY_CONNECTED_H_
@@ -26,11 +26,13 @@ limitations under the License.
 #endif
 
 #include <cstdint>
+#include <cstring>
 
 #include "ruy/profiler/instrumentation.h"  // from @ruy
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
 #include "tensorflow/lite/kernels/cpu_backend_gemm.h"
 #include "tensorflow/lite/kernels/cpu_backend_gemm_params.h"
+#include "tensorflow/lite/kernels/internal/common.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
 
 namespace tflite {
@@ -117,6 +119,50 @@ static inline __m256i DotProdInt8x4x8(__m256i a_16x16, __m256i b_16x16) {
 }
 #endif  // __AVX2__
 
+// Unpacks 16 bytes of densely packed int4 values into two XMM registers of 16
+// int8 values each, keeping the order of the values.
+static inline void UnpackInt4x32(__m128i packed_8x16, __m128i* low_8x16,
+                                 __m128i* high_8x16) {
+  const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+  const __m128i sign_bit = _mm_set1_epi8(0x08);
+  // Sign-extend the nibbles as (x ^ 8) - 8, as there is no 8-bit shift.
+  const __m128i even_8x16 = _mm_sub_epi8(
+      _mm_xor_si128(_mm_and_si128(packed_8x16, nibble_mask), sign_bit),
+      sign_bit);
+  const __m128i odd_8x16 = _mm_sub_epi8(
+      _mm_xor_si128(
+          _mm_and_si128(_mm_srli_epi16(packed_8x16, 4), nibble_mask),
+          sign_bit),
+      sign_bit);
+  *low_8x16 = _mm_unpacklo_epi8(even_8x16, odd_8x16);
+  *high_8x16 = _mm_unpackhi_epi8(even_8x16, odd_8x16);
+}
+
+#ifdef __AVX2__
+// Same as `UnpackInt4x32` for 32 bytes of packed values.
+static inline void UnpackInt4x64(__m256i packed_8x32, __m256i* low_8x32,
+                                 __m256i* high_8x32) {
+  const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+  const __m256i sign_bit = _mm256_set1_epi8(0x08);
+  const __m256i even_8x32 = _mm256_sub_epi8(
+      _mm256_xor_si256(_mm256_and_si256(packed_8x32, nibble_mask), sign_bit),
+      sign_bit);
+  const __m256i odd_8x32 = _mm256_sub_epi8(
+      _mm256_xor_si256(
+          _mm256_and_si256(_mm256_srli_epi16(packed_8x32, 4), nibble_mask),
+          sign_bit),
+      sign_bit);
+  // The unpacking interleaves within the 128-bit lanes, so the lanes are
+  // swapped back into order.
+  const __m256i interleaved_low = _mm256_unpacklo_epi8(even_8x32, odd_8x32);
+  const __m256i interleaved_high = _mm256_unpackhi_epi8(even_8x32, odd_8x32);
+  *low_8x32 =
+      _mm256_permute2x128_si256(interleaved_low, interleaved_high, 0x20);
+  *high_8x32 =
+      _mm256_permute2x128_si256(interleaved_low, interleaved_high, 0x31);
+}
+#endif  // __AVX2__
+
 // Horizontally add each of 4 XMM registers with 4 int32 values, pack result
 // into a single XMM register. Similar to ReduceInt32x4, but with 4x inputs.
 static inline __m128i ReduceInt32x4x4(__m128i a, __m128i b, __m128i c,
@@ -196,6 +242,46 @@ void Avx2MatrixBatchVectorMultiplyAccumulateImpl(
   }
 }
 
+void Avx2SparseMatrixBatchVectorMultiplyAccumulate4x4Impl(
+    const float* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const float* __restrict__ vector, int n_batch, float* __restrict__ result) {
+  constexpr int kBlockSize = 4;
+  TFLITE_DCHECK_EQ(m_rows % kBlockSize, 0);
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+
+  for (int b = 0; b < n_batch; ++b) {
+    const float* matrix_ptr = matrix;
+    const float* vector_in_batch = vector + b * m_cols;
+    float* result_in_batch = result + b * m_rows;
+    for (int block_row = 0; block_row < m_rows / kBlockSize; ++block_row) {
+      // Each YMM register accumulates two rows of the blocks, one per 128-bit
+      // lane.
+      __m256 acc01_32x8 = _mm256_setzero_ps();
+      __m256 acc23_32x8 = _mm256_setzero_ps();
+      for (int i = segments[block_row]; i < segments[block_row + 1]; ++i) {
+        // Load the 4 float values of the vector into both lanes.
+        const __m256 vector_f32x8 = _mm256_broadcast_ps(
+            reinterpret_cast<const __m128*>(vector_in_batch +
+                                            indices[i] * kBlockSize));
+        const __m256 matrix01_f32x8 = _mm256_loadu_ps(matrix_ptr);
+        const __m256 matrix23_f32x8 =
+            _mm256_loadu_ps(matrix_ptr + 2 * kBlockSize);
+        acc01_32x8 = _mm256_add_ps(
+            acc01_32x8, _mm256_mul_ps(matrix01_f32x8, vector_f32x8));
+        acc23_32x8 = _mm256_add_ps(
+            acc23_32x8, _mm256_mul_ps(matrix23_f32x8, vector_f32x8));
+        matrix_ptr += kBlockSize * kBlockSize;
+      }
+      float* result_block = result_in_batch + block_row * kBlockSize;
+      result_block[0] += ReduceFloat32x4(_mm256_castps256_ps128(acc01_32x8));
+      result_block[1] += ReduceFloat32x4(_mm256_extractf128_ps(acc01_32x8, 1));
+      result_block[2] += ReduceFloat32x4(_mm256_castps256_ps128(acc23_32x8));
+      result_block[3] += ReduceFloat32x4(_mm256_extractf128_ps(acc23_32x8, 1));
+    }
+  }
+}
+
 void Avx2MatrixBatchVectorMultiplyAccumulateImpl(
     const int8_t* __restrict__ matrix, const int m_rows, const int m_cols,
     const int8_t* __restrict__ vectors,
@@ -487,6 +573,76 @@ void SseMatrixBatchVectorMultiplyAccumulate(
       per_channel_scale, input_offset, row_sums);
 }
 
+void SseMatrixBatchVectorMultiplyAccumulateInt4(
+    const int8_t* __restrict__ matrix, const int m_rows, const int m_cols,
+    const int8_t* __restrict__ vectors,
+    const float* __restrict__ scaling_factors, int n_batch,
+    float* __restrict__ result, const float* per_channel_scale,
+    const int32_t* input_offset, const int32_t* row_sums) {
+  TFLITE_DCHECK_EQ(m_cols % 2, 0);
+  const std::intptr_t packed_cols = m_cols / 2;
+  for (std::intptr_t batch = 0; batch < n_batch; ++batch) {
+    const float batch_scaling_factor = scaling_factors[batch];
+    const int32_t batch_offset = input_offset ? input_offset[batch] : 0;
+    for (std::intptr_t row = 0; row < m_rows; ++row) {
+      const int8_t* __restrict__ row_ptr = matrix + row * packed_cols;
+      __m128i dotprod_32x4 = _mm_setzero_si128();
+      std::intptr_t col = 0;
+#ifdef __AVX2__
+      // For every block of 64x 4-bit weights.
+      __m256i dotprod_32x8 = _mm256_setzero_si256();
+      for (; col < (m_cols & ~63); col += 64) {
+        __m256i row_low_8x32, row_high_8x32;
+        UnpackInt4x64(_mm256_loadu_si256(
+                          reinterpret_cast<const __m256i*>(row_ptr + col / 2)),
+                      &row_low_8x32, &row_high_8x32);
+        const __m256i vec_low_8x32 =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vectors + col));
+        const __m256i vec_high_8x32 = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(vectors + col + 32));
+        dotprod_32x8 = _mm256_add_epi32(
+            dotprod_32x8, DotProdInt8x4x8(vec_low_8x32, row_low_8x32));
+        dotprod_32x8 = _mm256_add_epi32(
+            dotprod_32x8, DotProdInt8x4x8(vec_high_8x32, row_high_8x32));
+      }
+      dotprod_32x4 = _mm_add_epi32(_mm256_castsi256_si128(dotprod_32x8),
+                                   _mm256_extracti128_si256(dotprod_32x8, 1));
+#endif  // __AVX2__
+      // For every block of 32x 4-bit weights.
+      for (; col < (m_cols & ~31); col += 32) {
+        __m128i row_low_8x16, row_high_8x16;
+        UnpackInt4x32(_mm_loadu_si128(
+                          reinterpret_cast<const __m128i*>(row_ptr + col / 2)),
+                      &row_low_8x16, &row_high_8x16);
+        const __m128i vec_low_8x16 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(vectors + col));
+        const __m128i vec_high_8x16 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(vectors + col + 16));
+        dotprod_32x4 = _mm_add_epi32(
+            dotprod_32x4, DotProdInt8x4x4(vec_low_8x16, row_low_8x16));
+        dotprod_32x4 = _mm_add_epi32(
+            dotprod_32x4, DotProdInt8x4x4(vec_high_8x16, row_high_8x16));
+      }
+      int32_t sum = ReduceInt32x4(dotprod_32x4);
+      // Postamble loop for <32x remaining 4-bit weights, two at a time.
+      for (; col < m_cols; col += 2) {
+        const int8_t packed = row_ptr[col / 2];
+        sum += (static_cast<int8_t>(packed << 4) >> 4) * vectors[col];
+        sum += (packed >> 4) * vectors[col + 1];
+      }
+      if (input_offset) {
+        sum -= row_sums[row] * batch_offset;
+      }
+      const float row_scale =
+          per_channel_scale ? per_channel_scale[row] * batch_scaling_factor
+                            : batch_scaling_factor;
+      *result += sum * row_scale;
+      ++result;
+    }  // for row
+    vectors += m_cols;
+  }  // for batch
+}
+
 namespace {
 
 // Implements sparse-matrix - vector multiply-accumulate.
@@ -617,6 +773,136 @@ void SseSparseMatrixBatchVectorMultiplyAccumulate(
   }  // for batch
 }
 
+namespace {
+
+// Loads 4 int8 values, which may be unaligned, as a single int32.
+inline int32_t LoadInt8x4(const int8_t* ptr) {
+  int32_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+// Adds the bias to the int32 dot product of a row and requantizes it to int8,
+// as the quantized sparse kernels do.
+inline int8_t RequantizeSparseAccumulator(
+    int32_t acc, int32_t bias_value, int32_t output_multiplier,
+    int32_t output_shift, int32_t output_offset, int32_t output_activation_min,
+    int32_t output_activation_max) {
+  acc = MultiplyByQuantizedMultiplier(acc + bias_value, output_multiplier,
+                                      output_shift);
+  acc += output_offset;
+  return static_cast<int8_t>(ActivationFunctionWithMinMax(
+      acc, output_activation_min, output_activation_max));
+}
+
+}  // namespace
+
+void SseSparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  constexpr int kBlockSize = 4;
+  // The number of blocks whose dot products are computed in one XMM register.
+  constexpr int kBlocksPerXmm = 4;
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+  const __m128i ones_8x16 = _mm_set1_epi8(1);
+
+  for (int batch = 0; batch < n_batch; ++batch) {
+    const int8_t* matrix_ptr = matrix;
+    const int8_t* vector_in_batch = vector + batch * m_cols;
+    for (int row = 0; row < m_rows; ++row) {
+      __m128i dotprod_32x4 = _mm_setzero_si128();
+      __m128i row_sum_32x4 = _mm_setzero_si128();
+      int i = segments[row];
+      for (; i + kBlocksPerXmm <= segments[row + 1]; i += kBlocksPerXmm) {
+        // Gather the vector values of 4 non-zero blocks.
+        const __m128i vec_8x16 = _mm_setr_epi32(
+            LoadInt8x4(vector_in_batch + indices[i] * kBlockSize),
+            LoadInt8x4(vector_in_batch + indices[i + 1] * kBlockSize),
+            LoadInt8x4(vector_in_batch + indices[i + 2] * kBlockSize),
+            LoadInt8x4(vector_in_batch + indices[i + 3] * kBlockSize));
+        const __m128i row_8x16 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(matrix_ptr));
+        // dotprod += vec · row
+        dotprod_32x4 =
+            _mm_add_epi32(dotprod_32x4, DotProdInt8x4x4(vec_8x16, row_8x16));
+        row_sum_32x4 =
+            _mm_add_epi32(row_sum_32x4, DotProdInt8x4x4(ones_8x16, row_8x16));
+        matrix_ptr += kBlockSize * kBlocksPerXmm;
+      }
+      int32_t dotprod = ReduceInt32x4(dotprod_32x4);
+      int32_t row_sum = ReduceInt32x4(row_sum_32x4);
+      for (; i < segments[row + 1]; ++i) {
+        const int8_t* vector_block_in_batch_ptr =
+            vector_in_batch + indices[i] * kBlockSize;
+        for (int c = 0; c < kBlockSize; ++c) {
+          dotprod += *matrix_ptr * vector_block_in_batch_ptr[c];
+          row_sum += *matrix_ptr++;
+        }
+      }
+      const int32_t bias_value = bias_vector != nullptr ? bias_vector[row] : 0;
+      result[batch * m_rows + row] = RequantizeSparseAccumulator(
+          dotprod + input_offset * row_sum, bias_value, output_multiplier,
+          output_shift, output_offset, output_activation_min,
+          output_activation_max);
+    }  // for row
+  }    // for batch
+}
+
+void SseSparseMatrixBatchVectorMultiplyAccumulate4x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  constexpr int kBlockSize = 4;
+  TFLITE_DCHECK_EQ(m_rows % kBlockSize, 0);
+  TFLITE_DCHECK_EQ(m_cols % kBlockSize, 0);
+  const __m128i ones_8x16 = _mm_set1_epi8(1);
+
+  for (int batch = 0; batch < n_batch; ++batch) {
+    const int8_t* matrix_ptr = matrix;
+    const int8_t* vector_in_batch = vector + batch * m_cols;
+    int8_t* result_in_batch = result + batch * m_rows;
+    for (int block_row = 0; block_row < m_rows / kBlockSize; ++block_row) {
+      // One lane per row of the blocks.
+      __m128i dotprod_32x4 = _mm_setzero_si128();
+      __m128i row_sums_32x4 = _mm_setzero_si128();
+      for (int i = segments[block_row]; i < segments[block_row + 1]; ++i) {
+        // Repeat the 4 vector values for each row of the block.
+        const __m128i vec_8x16 = _mm_set1_epi32(
+            LoadInt8x4(vector_in_batch + indices[i] * kBlockSize));
+        const __m128i block_8x16 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(matrix_ptr));
+        dotprod_32x4 =
+            _mm_add_epi32(dotprod_32x4, DotProdInt8x4x4(vec_8x16, block_8x16));
+        row_sums_32x4 = _mm_add_epi32(row_sums_32x4,
+                                      DotProdInt8x4x4(ones_8x16, block_8x16));
+        matrix_ptr += kBlockSize * kBlockSize;
+      }
+      int32_t dotprod[kBlockSize];
+      int32_t row_sums[kBlockSize];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dotprod), dotprod_32x4);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(row_sums), row_sums_32x4);
+      for (int r = 0; r < kBlockSize; ++r) {
+        const int row = block_row * kBlockSize + r;
+        const int32_t bias_value =
+            bias_vector != nullptr ? bias_vector[row] : 0;
+        result_in_batch[row] = RequantizeSparseAccumulator(
+            dotprod[r] + input_offset * row_sums[r], bias_value,
+            output_multiplier, output_shift, output_offset,
+            output_activation_min, output_activation_max);
+      }
+    }  // for block_row
+  }    // for batch
+}
+
 void SseReductionSumVector(const int8_t* input_vector, int32_t* output_vector,
                            const int output_size, const int reduction_size) {
   static constexpr std::intptr_t kBlockSize = 16;
@@ -80,6 +80,21 @@ void UnpackDenseInt4IntoInt8(const int8_t* src_buffer, int num_elements,
   }
 }
 
+void ReductionSumVectorInt4(const int8_t* packed_matrix,
+                            int32_t* output_vector, int output_size,
+                            int reduction_size) {
+  int element = 0;
+  for (int o = 0; o < output_size; o++) {
+    int32_t sum = 0;
+    for (int r = 0; r < reduction_size; r++, element++) {
+      const int8_t packed = packed_matrix[element / 2];
+      sum += (element & 1) ? packed >> 4
+                           : static_cast<int8_t>(packed << 4) >> 4;
+    }
+    output_vector[o] = sum;
+  }
+}
+
 }  // namespace tensor_utils
 }  // namespace tflite
 
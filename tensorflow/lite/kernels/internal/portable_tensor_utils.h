@@ -193,6 +193,21 @@ void SparseMatrixBatchVectorMultiplyAccumulate1x4(
     const int32_t* __restrict__ indices, int m_rows, int m_cols,
     const float* __restrict__ vector, int n_batch, float* __restrict__ result);
 
+// Same as the function above, but the matrix is a sparse tensor with block
+// pattern 4x4, stored in block compressed sparse row format:
+//   1. A matrix array stores the non-zero blocks in order, each block in row
+//      major.
+//   2. A segments array of m_rows / 4 + 1 elements delimits the non-zero
+//      blocks of each row of blocks in the indices array.
+//   3. An indices array stores the column of each non-zero block, in units of
+//      blocks.
+// This function assumes that m_rows and m_cols are multiples of the block size
+// (4 in this case) so that there's no incomplete block.
+void SparseMatrixBatchVectorMultiplyAccumulate4x4(
+    const float* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const float* __restrict__ vector, int n_batch, float* __restrict__ result);
+
 // Same as the function above, but the matrix is stored in block compressed
 // sparse row format with block pattern 1x16 which consists of two arrays:
 //   1. A matrix array stores non-zero blocks of the matrix in row major.
@@ -245,6 +260,28 @@ void SparseMatrixBatchVectorMultiplyAccumulate1x16(
     const int32_t output_activation_min, const int32_t output_activation_max,
     int8_t* __restrict__ result);
 
+// Same as the function above, but with block pattern 1x4.
+void SparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result);
+
+// Same as the function above, but with block pattern 4x4, stored as in the
+// float version of SparseMatrixBatchVectorMultiplyAccumulate4x4. This function
+// assumes that m_rows and m_cols are multiples of 4.
+void SparseMatrixBatchVectorMultiplyAccumulate4x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result);
+
 // Same as the function above, but the matrix is stored in block compressed
 // sparse row format with block pattern 1x16 which consists of two arrays:
 //   1. A matrix array stores non-zero blocks of the matrix in row major.
@@ -500,6 +537,16 @@ void MatrixBatchVectorMultiplyAccumulate(
     const int32_t* input_offset, int32_t* scratch, int32_t* row_sums,
     bool* compute_row_sums, CpuBackendContext* context);
 
+// Same as the function above except that the matrix is int4, densely packed
+// two values per byte in the order of `UnpackDenseInt4IntoInt8`, and that the
+// row sums are given rather than cached. `row_sums` is only read if
+// `input_offset` is not null.
+void MatrixBatchVectorMultiplyAccumulateInt4(
+    const int8_t* __restrict__ matrix, const int m_rows, const int m_cols,
+    const int8_t* __restrict__ vectors, const float* scaling_factors,
+    int n_batch, float* __restrict__ result, const float* per_channel_scale,
+    const int32_t* input_offset, const int32_t* row_sums);
+
 // Same as the function above, but provides separate scaling factor for the
 // matrix and the vectors. The scaling factors are multiplied in the
 // scaling_factor_scratch buffer.
@@ -616,6 +663,12 @@ void ApplySignbitToVector(const float* __restrict__ vector, int v_size,
 void UnpackDenseInt4IntoInt8(const int8_t* src_buffer, int num_elements,
                              int8_t* dst_buffer);
 
+// Sums the rows of an int4 matrix of `output_size` rows of `reduction_size`
+// values, densely packed in the order of `UnpackDenseInt4IntoInt8`.
+void ReductionSumVectorInt4(const int8_t* packed_matrix,
+                            int32_t* output_vector, int output_size,
+                            int reduction_size);
+
 }  // namespace tensor_utils
 
 }  // namespace tflite
@@ -35,6 +35,83 @@ namespace tensor_utils {
 namespace {
 const int32_t kInt16Max = std::numeric_limits<int16_t>::max();
 const int32_t kInt16Min = std::numeric_limits<int16_t>::min();
+
+// Multiplies a matrix stored in block compressed sparse row format with
+// blocks of kBlockRows x kBlockCols by a batch of vectors, see
+// SparseMatrixBatchVectorMultiplyAccumulate4x4.
+template <int kBlockRows, int kBlockCols>
+void SparseMatrixBatchVectorMultiplyAccumulateBlock(
+    const float* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const float* __restrict__ vector, int n_batch, float* __restrict__ result) {
+  TFLITE_DCHECK_EQ(m_rows % kBlockRows, 0);
+  TFLITE_DCHECK_EQ(m_cols % kBlockCols, 0);
+  for (int batch = 0; batch < n_batch; ++batch) {
+    const float* matrix_ptr = matrix;
+    const float* vector_in_batch = vector + batch * m_cols;
+    float* result_in_batch = result + batch * m_rows;
+    for (int block_row = 0; block_row < m_rows / kBlockRows; ++block_row) {
+      float dot_prod[kBlockRows] = {};
+      for (int i = segments[block_row]; i < segments[block_row + 1]; ++i) {
+        const float* vector_block_in_batch_ptr =
+            vector_in_batch + indices[i] * kBlockCols;
+        for (int r = 0; r < kBlockRows; ++r) {
+          for (int c = 0; c < kBlockCols; ++c) {
+            dot_prod[r] += *matrix_ptr++ * vector_block_in_batch_ptr[c];
+          }
+        }
+      }
+      for (int r = 0; r < kBlockRows; ++r) {
+        result_in_batch[block_row * kBlockRows + r] += dot_prod[r];
+      }
+    }
+  }
+}
+
+// Same as the function above for a symmetric quantized matrix, with the
+// results requantized to int8 as in
+// SparseMatrixBatchVectorMultiplyAccumulate1x16.
+template <int kBlockRows, int kBlockCols>
+void SparseMatrixBatchVectorMultiplyAccumulateBlock(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  TFLITE_DCHECK_EQ(m_rows % kBlockRows, 0);
+  TFLITE_DCHECK_EQ(m_cols % kBlockCols, 0);
+  for (int batch = 0; batch < n_batch; ++batch) {
+    const int8_t* matrix_ptr = matrix;
+    const int8_t* vector_in_batch = vector + batch * m_cols;
+    int8_t* result_in_batch = result + batch * m_rows;
+    for (int block_row = 0; block_row < m_rows / kBlockRows; ++block_row) {
+      int32_t dot_prod[kBlockRows] = {};
+      for (int i = segments[block_row]; i < segments[block_row + 1]; ++i) {
+        const int8_t* vector_block_in_batch_ptr =
+            vector_in_batch + indices[i] * kBlockCols;
+        for (int r = 0; r < kBlockRows; ++r) {
+          for (int c = 0; c < kBlockCols; ++c) {
+            dot_prod[r] += *matrix_ptr *
+                           (vector_block_in_batch_ptr[c] + input_offset);
+            ++matrix_ptr;
+          }
+        }
+      }
+      for (int r = 0; r < kBlockRows; ++r) {
+        const int row = block_row * kBlockRows + r;
+        const int32_t bias_value =
+            bias_vector != nullptr ? bias_vector[row] : 0;
+        int32_t acc = MultiplyByQuantizedMultiplier(
+            dot_prod[r] + bias_value, output_multiplier, output_shift);
+        acc += output_offset;
+        result_in_batch[row] = static_cast<int8_t>(ActivationFunctionWithMinMax(
+            acc, output_activation_min, output_activation_max));
+      }
+    }
+  }
+}
 }  // namespace
 
 void PortableSymmetricQuantizeFloats(const float* values, const int size,
@@ -203,6 +280,38 @@ void PortableMatrixBatchVectorMultiplyAccumulate(
   }    // for batch
 }
 
+void PortableMatrixBatchVectorMultiplyAccumulateInt4(
+    const int8_t* __restrict__ matrix, const int m_rows, const int m_cols,
+    const int8_t* __restrict__ vectors, const float* scaling_factors,
+    int n_batch, float* __restrict__ result, const float* per_channel_scale,
+    const int32_t* input_offset, const int32_t* row_sums) {
+  for (int batch = 0; batch < n_batch; ++batch, vectors += m_cols) {
+    const float batch_scaling_factor = scaling_factors[batch];
+    const int32_t batch_offset = input_offset ? input_offset[batch] : 0;
+    // The rows are packed back to back, so a row of odd length starts in the
+    // middle of a byte.
+    int element = 0;
+    for (int row = 0; row < m_rows; ++row) {
+      int32_t dotprod = 0;
+      for (int col = 0; col < m_cols; ++col, ++element) {
+        const int8_t packed = matrix[element / 2];
+        const int8_t value =
+            (element & 1) ? packed >> 4 : static_cast<int8_t>(packed << 4) >> 4;
+        dotprod += value * vectors[col];
+      }  // for col
+      if (input_offset) {
+        dotprod -= row_sums[row] * batch_offset;
+      }
+      float scale = batch_scaling_factor;
+      if (per_channel_scale) {
+        scale *= per_channel_scale[row];
+      }
+      *result += dotprod * scale;
+      ++result;
+    }  // for row
+  }    // for batch
+}
+
 void PortableSparseMatrixBatchVectorMultiplyAccumulate1x4(
     const float* __restrict__ matrix, const int32_t* __restrict__ segments,
     const int32_t* __restrict__ indices, int m_rows, int m_cols,
@@ -262,6 +371,42 @@ void PortableSparseMatrixBatchVectorMultiplyAccumulate1x16(
   }
 }
 
+void PortableSparseMatrixBatchVectorMultiplyAccumulate1x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  SparseMatrixBatchVectorMultiplyAccumulateBlock<1, 4>(
+      matrix, segments, indices, m_rows, m_cols, vector, bias_vector, n_batch,
+      input_offset, output_multiplier, output_shift, output_offset,
+      output_activation_min, output_activation_max, result);
+}
+
+void PortableSparseMatrixBatchVectorMultiplyAccumulate4x4(
+    const float* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const float* __restrict__ vector, int n_batch, float* __restrict__ result) {
+  SparseMatrixBatchVectorMultiplyAccumulateBlock<4, 4>(
+      matrix, segments, indices, m_rows, m_cols, vector, n_batch, result);
+}
+
+void PortableSparseMatrixBatchVectorMultiplyAccumulate4x4(
+    const int8_t* __restrict__ matrix, const int32_t* __restrict__ segments,
+    const int32_t* __restrict__ indices, int m_rows, int m_cols,
+    const int8_t* __restrict__ vector, const int32_t* __restrict__ bias_vector,
+    int n_batch, const int32_t input_offset, const int32_t output_multiplier,
+    const int32_t output_shift, const int32_t output_offset,
+    const int32_t output_activation_min, const int32_t output_activation_max,
+    int8_t* __restrict__ result) {
+  SparseMatrixBatchVectorMultiplyAccumulateBlock<4, 4>(
+      matrix, segments, indices, m_rows, m_cols, vector, bias_vector, n_batch,
+      input_offset, output_multiplier, output_shift, output_offset,
+      output_activation_min, output_activation_max, result);
+}
+
 void PortableSparseMatrixBatchVectorMultiplyAccumulate(
     const float* __restrict__ matrix, const uint8_t* __restrict__ ledger,
     int m_rows, int m_cols, const float* __restrict__ vector, int n_batch,
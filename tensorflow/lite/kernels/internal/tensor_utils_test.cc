@@ -2124,6 +2124,77 @@ TEST(uKernels, UnpackInt4OddLength) {
               testing::Pointwise(testing::Eq(), expected_output));
 }
 
+TEST(uKernels, ReductionSumVectorInt4Test) {
+  // The rows of 3 values {1, 2, 3} and {4, -8, -1} share the middle byte.
+  const int8_t input[3] = {0x21, 0x43, static_cast<int8_t>(0xF8)};
+  int32_t output[2];
+  ReductionSumVectorInt4(input, output, 2, 3);
+  EXPECT_THAT(output, testing::ElementsAre(6, -5));
+}
+
+// Packs the int4 `values` densely, two per byte.
+std::vector<int8_t> PackInt4(const std::vector<int8_t>& values) {
+  std::vector<int8_t> packed((values.size() + 1) / 2);
+  for (int i = 0; i < values.size(); ++i) {
+    packed[i / 2] |= static_cast<int8_t>((values[i] & 0x0F) << (4 * (i % 2)));
+  }
+  return packed;
+}
+
+void TestMatrixBatchVectorMultiplyAccumulateInt4(int rows, int cols,
+                                                 int batch) {
+  std::vector<int8_t> matrix(rows * cols);
+  for (int i = 0; i < matrix.size(); ++i) {
+    matrix[i] = (i * 7) % 16 - 8;
+  }
+  std::vector<int8_t> vectors(batch * cols);
+  for (int i = 0; i < vectors.size(); ++i) {
+    vectors[i] = (i * 11) % 255 - 127;
+  }
+  std::vector<float> scaling_factors(batch);
+  std::vector<int32_t> input_offsets(batch);
+  for (int b = 0; b < batch; ++b) {
+    scaling_factors[b] = 0.5f + b;
+    input_offsets[b] = b - 1;
+  }
+  std::vector<float> per_channel_scales(rows);
+  for (int r = 0; r < rows; ++r) {
+    per_channel_scales[r] = 0.25f * (r + 1);
+  }
+
+  std::vector<float> expected(rows * batch, 1.0f);
+  for (int b = 0; b < batch; ++b) {
+    for (int r = 0; r < rows; ++r) {
+      int32_t dotprod = 0;
+      for (int c = 0; c < cols; ++c) {
+        dotprod += matrix[r * cols + c] *
+                   (vectors[b * cols + c] - input_offsets[b]);
+      }
+      expected[b * rows + r] +=
+          dotprod * scaling_factors[b] * per_channel_scales[r];
+    }
+  }
+
+  const std::vector<int8_t> packed_matrix = PackInt4(matrix);
+  std::vector<int32_t> row_sums(rows);
+  ReductionSumVectorInt4(packed_matrix.data(), row_sums.data(), rows, cols);
+  std::vector<float> result(rows * batch, 1.0f);
+  MatrixBatchVectorMultiplyAccumulateInt4(
+      packed_matrix.data(), rows, cols, vectors.data(), scaling_factors.data(),
+      batch, result.data(), per_channel_scales.data(), input_offsets.data(),
+      row_sums.data());
+  EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(expected, 1e-5)))
+      << rows << "x" << cols << " with a batch of " << batch;
+}
+
+TEST(uKernels, MatrixBatchVectorMultiplyAccumulateInt4Test) {
+  // Rows of odd length, and rows exercising the vectorized loops and their
+  // postambles.
+  TestMatrixBatchVectorMultiplyAccumulateInt4(3, 7, 2);
+  TestMatrixBatchVectorMultiplyAccumulateInt4(4, 64, 1);
+  TestMatrixBatchVectorMultiplyAccumulateInt4(5, 130, 3);
+}
+
 }  // namespace tensor_utils
 }  // namespace tflite
 
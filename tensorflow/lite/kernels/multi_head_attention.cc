@@ -0,0 +1,388 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "flatbuffers/flexbuffers.h"  // from @flatbuffers
+#include "ruy/profiler/instrumentation.h"  // from @ruy
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/kernels/cpu_backend_context.h"
+#include "tensorflow/lite/kernels/cpu_backend_threadpool.h"
+#include "tensorflow/lite/kernels/custom_ops_register.h"
+#include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+
+namespace tflite {
+namespace ops {
+namespace custom {
+namespace multi_head_attention {
+
+// Computes softmax(query * key^T * scale + mask) * value for each batch and
+// each head, the inputs and the output being laid out as
+// [batches, sequence_length, num_heads, head_size], as produced by the
+// projections of an attention layer. The optional mask is added to the logits
+// and is of shape [batches or 1, query_length, key_length].
+//
+// The logits are never materialized: the keys are processed by tiles, and the
+// softmax is computed in a streaming fashion, rescaling the accumulated output
+// whenever the running maximum of the logits of a query increases. The
+// scratch memory is thus independent of the sequence lengths.
+constexpr int kQueryTensor = 0;
+constexpr int kKeyTensor = 1;
+constexpr int kValueTensor = 2;
+constexpr int kMaskTensor = 3;
+constexpr int kOutputTensor = 0;
+
+// The number of queries sharing a tile of keys while it is in the cache, and
+// the number of keys of a tile.
+constexpr int kQueryTileSize = 4;
+constexpr int kKeyTileSize = 64;
+
+constexpr const char kScaleStr[] = "scale";
+constexpr const char kCausalStr[] = "causal";
+
+struct OpData {
+  // The scale of the logits, or 0 to scale them by 1 / sqrt(head_size).
+  float scale = 0.f;
+  // Whether query i only attends the keys up to i + key_length - query_length,
+  // i.e. the last query is aligned with the last key, as when the keys also
+  // hold the cached keys of the previous steps.
+  bool causal = false;
+  // The index of the temporary tensor holding the scratch memory of each
+  // thread.
+  int scratch_tensor_index;
+  int thread_count = 1;
+};
+
+struct AttentionParams {
+  int query_length;
+  int key_length;
+  int num_heads;
+  int head_size;
+  int value_size;
+  float scale;
+  bool causal;
+  const float* query;
+  const float* key;
+  const float* value;
+  // Null when there is no mask.
+  const float* mask;
+  int mask_batches;
+  float* output;
+};
+
+// The number of floats of scratch memory used by a thread.
+int ScratchSize(int value_size) {
+  return kQueryTileSize * (kKeyTileSize + value_size + 2);
+}
+
+// Attends the queries of 'head' of 'batch' to its keys.
+void AttendHead(const AttentionParams& params, int batch, int head,
+                float* scratch) {
+  const int query_length = params.query_length;
+  const int key_length = params.key_length;
+  const int head_size = params.head_size;
+  const int value_size = params.value_size;
+  const int qk_stride = params.num_heads * head_size;
+  const int value_stride = params.num_heads * value_size;
+  const float* query =
+      params.query + (batch * query_length * params.num_heads + head) *
+                         head_size;
+  const float* key =
+      params.key + (batch * key_length * params.num_heads + head) * head_size;
+  const float* value =
+      params.value + (batch * key_length * params.num_heads + head) *
+                         value_size;
+  float* output =
+      params.output + (batch * query_length * params.num_heads + head) *
+                          value_size;
+  const float* mask = nullptr;
+  if (params.mask != nullptr) {
+    mask = params.mask + (params.mask_batches == 1 ? 0 : batch) *
+                             query_length * key_length;
+  }
+  const int causal_offset = key_length - query_length;
+
+  float* logits = scratch;
+  float* accumulators = logits + kQueryTileSize * kKeyTileSize;
+  float* max_logits = accumulators + kQueryTileSize * value_size;
+  float* sums = max_logits + kQueryTileSize;
+
+  for (int q_start = 0; q_start < query_length; q_start += kQueryTileSize) {
+    const int q_count = std::min(kQueryTileSize, query_length - q_start);
+    std::fill(max_logits, max_logits + q_count,
+              -std::numeric_limits<float>::infinity());
+    std::fill(sums, sums + q_count, 0.f);
+    std::fill(accumulators, accumulators + q_count * value_size, 0.f);
+
+    // The keys past the causal limit of the last query of the tile are
+    // skipped.
+    int keys_end = key_length;
+    if (params.causal) {
+      keys_end = std::min(
+          key_length, std::max(0, q_start + q_count + causal_offset));
+    }
+    for (int k_start = 0; k_start < keys_end; k_start += kKeyTileSize) {
+      const int k_count = std::min(kKeyTileSize, keys_end - k_start);
+      for (int i = 0; i < q_count; ++i) {
+        const int q_index = q_start + i;
+        int count = k_count;
+        if (params.causal) {
+          count = std::min(
+              count, std::max(0, q_index + causal_offset + 1 - k_start));
+        }
+        if (count == 0) continue;
+
+        const float* query_row = query + q_index * qk_stride;
+        float* row_logits = logits + i * kKeyTileSize;
+        float tile_max = -std::numeric_limits<float>::infinity();
+        for (int j = 0; j < count; ++j) {
+          const float* key_row = key + (k_start + j) * qk_stride;
+          float dot = 0.f;
+          for (int d = 0; d < head_size; ++d) {
+            dot += query_row[d] * key_row[d];
+          }
+          dot *= params.scale;
+          if (mask != nullptr) dot += mask[q_index * key_length + k_start + j];
+          row_logits[j] = dot;
+          tile_max = std::max(tile_max, dot);
+        }
+        // All the keys of the tile are masked out.
+        if (tile_max == -std::numeric_limits<float>::infinity()) continue;
+
+        float* accumulator = accumulators + i * value_size;
+        const float max_logit = std::max(max_logits[i], tile_max);
+        if (max_logit > max_logits[i]) {
+          const float rescale = std::exp(max_logits[i] - max_logit);
+          sums[i] *= rescale;
+          for (int d = 0; d < value_size; ++d) accumulator[d] *= rescale;
+          max_logits[i] = max_logit;
+        }
+        for (int j = 0; j < count; ++j) {
+          const float weight = std::exp(row_logits[j] - max_logit);
+          sums[i] += weight;
+          const float* value_row = value + (k_start + j) * value_stride;
+          for (int d = 0; d < value_size; ++d) {
+            accumulator[d] += weight * value_row[d];
+          }
+        }
+      }
+    }
+
+    for (int i = 0; i < q_count; ++i) {
+      // The queries that attend no key are set to 0.
+      const float inverse_sum = sums[i] > 0.f ? 1.f / sums[i] : 0.f;
+      const float* accumulator = accumulators + i * value_size;
+      float* output_row = output + (q_start + i) * value_stride;
+      for (int d = 0; d < value_size; ++d) {
+        output_row[d] = accumulator[d] * inverse_sum;
+      }
+    }
+  }
+}
+
+// Attends the heads in [start, end) of all the batches.
+struct AttentionTask : cpu_backend_threadpool::Task {
+  AttentionTask(const AttentionParams& params, int start, int end,
+                float* scratch)
+      : params(params), start(start), end(end), scratch(scratch) {}
+
+  void Run() override {
+    for (int i = start; i < end; ++i) {
+      AttendHead(params, i / params.num_heads, i % params.num_heads, scratch);
+    }
+  }
+
+ private:
+  const AttentionParams& params;
+  int start;
+  int end;
+  float* scratch;
+};
+
+void* Init(TfLiteContext* context, const char* buffer, size_t length) {
+  auto* op_data = new OpData();
+  context->AddTensors(context, 1, &op_data->scratch_tensor_index);
+  if (buffer == nullptr || length == 0) return op_data;
+
+  const flexbuffers::Map& m =
+      flexbuffers::GetRoot(reinterpret_cast<const uint8_t*>(buffer), length)
+          .AsMap();
+  const flexbuffers::Reference scale = m[kScaleStr];
+  if (!scale.IsNull()) op_data->scale = scale.AsFloat();
+  const flexbuffers::Reference causal = m[kCausalStr];
+  if (!causal.IsNull()) op_data->causal = causal.AsBool();
+  return op_data;
+}
+
+void Free(TfLiteContext* context, void* buffer) {
+  delete reinterpret_cast<OpData*>(buffer);
+}
+
+TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
+  OpData* op_data = reinterpret_cast<OpData*>(node->user_data);
+  TF_LITE_ENSURE(context, NumInputs(node) == 3 || NumInputs(node) == 4);
+  TF_LITE_ENSURE_EQ(context, NumOutputs(node), 1);
+
+  const TfLiteTensor* query;
+  TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kQueryTensor, &query));
+  const TfLiteTensor* key;
+  TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kKeyTensor, &key));
+  const TfLiteTensor* value;
+  TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kValueTensor, &value));
+  TfLiteTensor* output;
+  TF_LITE_ENSURE_OK(context,
+                    GetOutputSafe(context, node, kOutputTensor, &output));
+
+  TF_LITE_ENSURE_TYPES_EQ(context, query->type, kTfLiteFloat32);
+  TF_LITE_ENSURE_TYPES_EQ(context, key->type, kTfLiteFloat32);
+  TF_LITE_ENSURE_TYPES_EQ(context, value->type, kTfLiteFloat32);
+  TF_LITE_ENSURE_TYPES_EQ(context, output->type, kTfLiteFloat32);
+  TF_LITE_ENSURE_EQ(context, NumDimensions(query), 4);
+  TF_LITE_ENSURE_EQ(context, NumDimensions(key), 4);
+  TF_LITE_ENSURE_EQ(context, NumDimensions(value), 4);
+
+  const int batches = SizeOfDimension(query, 0);
+  const int query_length = SizeOfDimension(query, 1);
+  const int num_heads = SizeOfDimension(query, 2);
+  const int head_size = SizeOfDimension(query, 3);
+  const int key_length = SizeOfDimension(key, 1);
+  const int value_size = SizeOfDimension(value, 3);
+  TF_LITE_ENSURE_EQ(context, SizeOfDimension(key, 0), batches);
+  TF_LITE_ENSURE_EQ(context, SizeOfDimension(key, 2), num_heads);
+  TF_LITE_ENSURE_EQ(context, SizeOfDimension(key, 3), head_size);
+  TF_LITE_ENSURE_EQ(context, SizeOfDimension(value, 0), batches);
+  TF_LITE_ENSURE_EQ(context, SizeOfDimension(value, 1), key_length);
+  TF_LITE_ENSURE_EQ(context, SizeOfDimension(value, 2), num_heads);
+
+  if (NumInputs(node) == 4) {
+    const TfLiteTensor* mask;
+    TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kMaskTensor, &mask));
+    TF_LITE_ENSURE_TYPES_EQ(context, mask->type, kTfLiteFloat32);
+    TF_LITE_ENSURE_EQ(context, NumDimensions(mask), 3);
+    TF_LITE_ENSURE(context, SizeOfDimension(mask, 0) == 1 ||
+                                SizeOfDimension(mask, 0) == batches);
+    TF_LITE_ENSURE_EQ(context, SizeOfDimension(mask, 1), query_length);
+    TF_LITE_ENSURE_EQ(context, SizeOfDimension(mask, 2), key_length);
+  }
+
+  CpuBackendContext* cpu_backend_context =
+      CpuBackendContext::GetFromContext(context);
+  op_data->thread_count =
+      std::max(1, std::min(batches * num_heads,
+                           cpu_backend_context->max_num_threads()));
+
+  TfLiteIntArrayFree(node->temporaries);
+  node->temporaries = TfLiteIntArrayCreate(1);
+  node->temporaries->data[0] = op_data->scratch_tensor_index;
+  TfLiteTensor* scratch;
+  TF_LITE_ENSURE_OK(context,
+                    GetTemporarySafe(context, node, /*index=*/0, &scratch));
+  scratch->type = kTfLiteFloat32;
+  scratch->allocation_type = kTfLiteArenaRw;
+  TfLiteIntArray* scratch_shape = TfLiteIntArrayCreate(2);
+  scratch_shape->data[0] = op_data->thread_count;
+  scratch_shape->data[1] = ScratchSize(value_size);
+  TF_LITE_ENSURE_OK(context,
+                    context->ResizeTensor(context, scratch, scratch_shape));
+
+  TfLiteIntArray* output_shape = TfLiteIntArrayCreate(4);
+  output_shape->data[0] = batches;
+  output_shape->data[1] = query_length;
+  output_shape->data[2] = num_heads;
+  output_shape->data[3] = value_size;
+  return context->ResizeTensor(context, output, output_shape);
+}
+
+TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
+  ruy::profiler::ScopeLabel label("MultiHeadAttention");
+  OpData* op_data = reinterpret_cast<OpData*>(node->user_data);
+  const TfLiteTensor* query;
+  TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kQueryTensor, &query));
+  const TfLiteTensor* key;
+  TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kKeyTensor, &key));
+  const TfLiteTensor* value;
+  TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kValueTensor, &value));
+  TfLiteTensor* output;
+  TF_LITE_ENSURE_OK(context,
+                    GetOutputSafe(context, node, kOutputTensor, &output));
+  TfLiteTensor* scratch;
+  TF_LITE_ENSURE_OK(context,
+                    GetTemporarySafe(context, node, /*index=*/0, &scratch));
+
+  AttentionParams params;
+  const int batches = SizeOfDimension(query, 0);
+  params.query_length = SizeOfDimension(query, 1);
+  params.key_length = SizeOfDimension(key, 1);
+  params.num_heads = SizeOfDimension(query, 2);
+  params.head_size = SizeOfDimension(query, 3);
+  params.value_size = SizeOfDimension(value, 3);
+  params.scale = op_data->scale != 0.f
+                     ? op_data->scale
+                     : 1.f / std::sqrt(static_cast<float>(params.head_size));
+  params.causal = op_data->causal;
+  params.query = GetTensorData<float>(query);
+  params.key = GetTensorData<float>(key);
+  params.value = GetTensorData<float>(value);
+  params.mask = nullptr;
+  params.mask_batches = 1;
+  if (NumInputs(node) == 4) {
+    const TfLiteTensor* mask;
+    TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, kMaskTensor, &mask));
+    params.mask = GetTensorData<float>(mask);
+    params.mask_batches = SizeOfDimension(mask, 0);
+  }
+  params.output = GetTensorData<float>(output);
+
+  float* scratch_data = GetTensorData<float>(scratch);
+  const int scratch_size = ScratchSize(params.value_size);
+  const int total_heads = batches * params.num_heads;
+  const int thread_count = op_data->thread_count;
+  if (thread_count == 1) {
+    AttentionTask(params, 0, total_heads, scratch_data).Run();
+    return kTfLiteOk;
+  }
+
+  std::vector<AttentionTask> tasks;
+  tasks.reserve(thread_count);
+  int start = 0;
+  for (int i = 0; i < thread_count; ++i) {
+    int end = start + total_heads / thread_count;
+    if (i < total_heads % thread_count) ++end;
+    tasks.emplace_back(params, start, end, scratch_data + i * scratch_size);
+    start = end;
+  }
+  cpu_backend_threadpool::Execute(tasks.size(), tasks.data(),
+                                  CpuBackendContext::GetFromContext(context));
+  return kTfLiteOk;
+}
+
+}  // namespace multi_head_attention
+
+TfLiteRegistration* Register_MULTI_HEAD_ATTENTION() {
+  static TfLiteRegistration r = {
+      multi_head_attention::Init, multi_head_attention::Free,
+      multi_head_attention::Prepare, multi_head_attention::Eval};
+  return &r;
+}
+
+}  // namespace custom
+}  // namespace ops
+}  // namespace tflite
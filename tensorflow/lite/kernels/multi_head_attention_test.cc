@@ -0,0 +1,245 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "flatbuffers/flexbuffers.h"  // from @flatbuffers
+#include "tensorflow/lite/kernels/custom_ops_register.h"
+#include "tensorflow/lite/kernels/test_util.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace tflite {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+
+class MultiHeadAttentionOpModel : public SingleOpModel {
+ public:
+  MultiHeadAttentionOpModel(const std::vector<int>& query_shape,
+                            const std::vector<int>& key_shape,
+                            const std::vector<int>& value_shape,
+                            float scale = 0.f, bool causal = false,
+                            const std::vector<int>& mask_shape = {},
+                            int num_threads = -1) {
+    query_ = AddInput({TensorType_FLOAT32, query_shape});
+    key_ = AddInput({TensorType_FLOAT32, key_shape});
+    value_ = AddInput({TensorType_FLOAT32, value_shape});
+    std::vector<std::vector<int>> input_shapes = {query_shape, key_shape,
+                                                  value_shape};
+    if (!mask_shape.empty()) {
+      mask_ = AddInput({TensorType_FLOAT32, mask_shape});
+      input_shapes.push_back(mask_shape);
+    }
+    output_ = AddOutput({TensorType_FLOAT32, {}});
+
+    flexbuffers::Builder fbb;
+    fbb.Map([&]() {
+      if (scale != 0.f) fbb.Float("scale", scale);
+      fbb.Bool("causal", causal);
+    });
+    fbb.Finish();
+    SetCustomOp("MultiHeadAttention", fbb.GetBuffer(),
+                ops::custom::Register_MULTI_HEAD_ATTENTION);
+    BuildInterpreter(input_shapes, num_threads,
+                     /*allow_fp32_relax_to_fp16=*/false,
+                     /*apply_delegate=*/true);
+  }
+
+  void SetQuery(const std::vector<float>& data) {
+    PopulateTensor(query_, data);
+  }
+  void SetKey(const std::vector<float>& data) { PopulateTensor(key_, data); }
+  void SetValue(const std::vector<float>& data) {
+    PopulateTensor(value_, data);
+  }
+  void SetMask(const std::vector<float>& data) { PopulateTensor(mask_, data); }
+
+  std::vector<float> GetOutput() { return ExtractVector<float>(output_); }
+  std::vector<int> GetOutputShape() { return GetTensorShape(output_); }
+
+ private:
+  int query_;
+  int key_;
+  int value_;
+  int mask_;
+  int output_;
+};
+
+// Computes the attention of [batches, length, num_heads, size] inputs with
+// the logits fully materialized.
+std::vector<float> ReferenceAttention(
+    const std::vector<float>& query, const std::vector<float>& key,
+    const std::vector<float>& value, int batches, int query_length,
+    int key_length, int num_heads, int head_size, int value_size, float scale,
+    bool causal) {
+  std::vector<float> output(batches * query_length * num_heads * value_size);
+  for (int b = 0; b < batches; ++b) {
+    for (int h = 0; h < num_heads; ++h) {
+      for (int i = 0; i < query_length; ++i) {
+        std::vector<double> logits(key_length);
+        double max_logit = -std::numeric_limits<double>::infinity();
+        for (int j = 0; j < key_length; ++j) {
+          double dot = 0;
+          for (int d = 0; d < head_size; ++d) {
+            dot += query[((b * query_length + i) * num_heads + h) * head_size +
+                         d] *
+                   key[((b * key_length + j) * num_heads + h) * head_size + d];
+          }
+          logits[j] = dot * scale;
+          if (causal && j > i + key_length - query_length) {
+            logits[j] = -std::numeric_limits<double>::infinity();
+          }
+          max_logit = std::max(max_logit, logits[j]);
+        }
+        double sum = 0;
+        for (int j = 0; j < key_length; ++j) {
+          logits[j] = std::exp(logits[j] - max_logit);
+          sum += logits[j];
+        }
+        for (int d = 0; d < value_size; ++d) {
+          double total = 0;
+          for (int j = 0; j < key_length; ++j) {
+            total +=
+                logits[j] *
+                value[((b * key_length + j) * num_heads + h) * value_size + d];
+          }
+          output[((b * query_length + i) * num_heads + h) * value_size + d] =
+              total / sum;
+        }
+      }
+    }
+  }
+  return output;
+}
+
+TEST(MultiHeadAttentionOpTest, SingleHead) {
+  MultiHeadAttentionOpModel m({1, 2, 1, 2}, {1, 3, 1, 2}, {1, 3, 1, 2},
+                              /*scale=*/1.f);
+  m.SetQuery({1, 0, 0, 1});
+  m.SetKey({1, 0, 0, 1, 1, 1});
+  m.SetValue({1, 2, 3, 4, 5, 6});
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutputShape(), ElementsAre(1, 2, 1, 2));
+  EXPECT_THAT(m.GetOutput(),
+              ElementsAreArray(ArrayFloatNear({3, 4, 3.533913, 4.533913})));
+}
+
+TEST(MultiHeadAttentionOpTest, DefaultScale) {
+  MultiHeadAttentionOpModel m({1, 2, 1, 2}, {1, 3, 1, 2}, {1, 3, 1, 2});
+  m.SetQuery({1, 0, 0, 1});
+  m.SetKey({1, 0, 0, 1, 1, 1});
+  m.SetValue({1, 2, 3, 4, 5, 6});
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutput(),
+              ElementsAreArray(ArrayFloatNear({3, 4, 3.406673, 4.406673})));
+}
+
+TEST(MultiHeadAttentionOpTest, Causal) {
+  MultiHeadAttentionOpModel m({1, 3, 1, 2}, {1, 3, 1, 2}, {1, 3, 1, 2},
+                              /*scale=*/1.f, /*causal=*/true);
+  m.SetQuery({1, 0, 0, 1, 1, 1});
+  m.SetKey({1, 0, 0, 1, 1, 1});
+  m.SetValue({1, 2, 3, 4, 5, 6});
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutput(), ElementsAreArray(ArrayFloatNear(
+                                 {1, 2, 2.462117, 3.462117, 3.728351,
+                                  4.728351})));
+}
+
+TEST(MultiHeadAttentionOpTest, CausalWithMoreKeysThanQueries) {
+  // The last query attends all the keys.
+  MultiHeadAttentionOpModel m({1, 2, 1, 2}, {1, 3, 1, 2}, {1, 3, 1, 2},
+                              /*scale=*/1.f, /*causal=*/true);
+  m.SetQuery({1, 0, 0, 1});
+  m.SetKey({1, 0, 0, 1, 1, 1});
+  m.SetValue({1, 2, 3, 4, 5, 6});
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutput(), ElementsAreArray(ArrayFloatNear(
+                                 {1.537883, 2.537883, 3.533913, 4.533913})));
+}
+
+TEST(MultiHeadAttentionOpTest, Mask) {
+  MultiHeadAttentionOpModel m({1, 2, 1, 2}, {1, 3, 1, 2}, {1, 3, 1, 2},
+                              /*scale=*/1.f, /*causal=*/false,
+                              /*mask_shape=*/{1, 2, 3});
+  m.SetQuery({1, 0, 0, 1});
+  m.SetKey({1, 0, 0, 1, 1, 1});
+  m.SetValue({1, 2, 3, 4, 5, 6});
+  m.SetMask({0, -std::numeric_limits<float>::infinity(), 0, 0, 0, -1e9});
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutput(), ElementsAreArray(ArrayFloatNear(
+                                 {3, 4, 2.462117, 3.462117})));
+}
+
+TEST(MultiHeadAttentionOpTest, LongSequencesMultiThreaded) {
+  // The sequences span several tiles of queries and keys.
+  const int batches = 2;
+  const int query_length = 37;
+  const int key_length = 150;
+  const int num_heads = 3;
+  const int head_size = 8;
+  const int value_size = 5;
+  std::mt19937 random_engine(1);
+  std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+  auto random_vector = [&](int size) {
+    std::vector<float> v(size);
+    for (float& x : v) x = distribution(random_engine);
+    return v;
+  };
+  const std::vector<float> query =
+      random_vector(batches * query_length * num_heads * head_size);
+  const std::vector<float> key =
+      random_vector(batches * key_length * num_heads * head_size);
+  const std::vector<float> value =
+      random_vector(batches * key_length * num_heads * value_size);
+
+  for (bool causal : {false, true}) {
+    for (int num_threads : {1, 4}) {
+      MultiHeadAttentionOpModel m(
+          {batches, query_length, num_heads, head_size},
+          {batches, key_length, num_heads, head_size},
+          {batches, key_length, num_heads, value_size}, /*scale=*/0.5f, causal,
+          /*mask_shape=*/{}, num_threads);
+      m.SetQuery(query);
+      m.SetKey(key);
+      m.SetValue(value);
+      ASSERT_EQ(m.Invoke(), kTfLiteOk);
+
+      EXPECT_THAT(m.GetOutputShape(),
+                  ElementsAre(batches, query_length, num_heads, value_size));
+      EXPECT_THAT(m.GetOutput(),
+                  ElementsAreArray(ArrayFloatNear(
+                      ReferenceAttention(query, key, value, batches,
+                                         query_length, key_length, num_heads,
+                                         head_size, value_size, 0.5f, causal),
+                      1e-5)));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace tflite
@@ -14,7 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include <stdint.h>
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "flatbuffers/flexbuffers.h"  // from @flatbuffers
@@ -24,6 +26,14 @@ limitations under the License.
 #include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
 
 namespace tflite {
+namespace ops {
+namespace custom {
+
+TfLiteRegistration* Register_ASSIGN_VARIABLE_SLICE();
+
+}  // namespace custom
+}  // namespace ops
+
 namespace {
 const char kContainer[] = "c";
 const char kSharedName[] = "a";
@@ -140,6 +150,44 @@ class VariableOpsTest : public ::testing::Test {
                                         read_registration_, &node_index);
   }
 
+  void ConstructGraphWithSliceUpdate() {
+    interpreter_ = std::make_unique<Interpreter>();
+    // Construct a graph like this:
+    //   Input: %0, %1, %2
+    //   Output: %4
+    //   %3 = var_handle()
+    //   variable_assign(%3, %0)
+    //   variable_assign_slice(%3, %1, %2)
+    //   %4 = read(%3)
+
+    int first_new_tensor_index;
+    ASSERT_EQ(interpreter_->AddTensors(5, &first_new_tensor_index), kTfLiteOk);
+    ASSERT_EQ(interpreter_->SetInputs({0, 1, 2}), kTfLiteOk);
+    ASSERT_EQ(interpreter_->SetOutputs({4}), kTfLiteOk);
+    interpreter_->SetTensorParametersReadWrite(0, kTfLiteFloat32, "", {3, 2},
+                                               TfLiteQuantization());
+    interpreter_->SetTensorParametersReadWrite(1, kTfLiteFloat32, "", {1, 2},
+                                               TfLiteQuantization());
+    interpreter_->SetTensorParametersReadWrite(2, kTfLiteInt32, "", {2},
+                                               TfLiteQuantization());
+    interpreter_->SetTensorParametersReadWrite(3, kTfLiteResource, "", 0,
+                                               nullptr, {}, false);
+    interpreter_->SetTensorParametersReadWrite(4, kTfLiteFloat32, "", {3, 2},
+                                               TfLiteQuantization());
+    int node_index;
+
+    TfLiteVarHandleParams* var_handle_params = GetVarHandleParams();
+    interpreter_->AddNodeWithParameters({}, {3}, nullptr, 0, var_handle_params,
+                                        var_handle_registration_, &node_index);
+    interpreter_->AddNodeWithParameters({3, 0}, {}, nullptr, 0, nullptr,
+                                        assign_registration_, &node_index);
+    interpreter_->AddNodeWithParameters(
+        {3, 1, 2}, {}, nullptr, 0, nullptr,
+        ::tflite::ops::custom::Register_ASSIGN_VARIABLE_SLICE(), &node_index);
+    interpreter_->AddNodeWithParameters({3}, {4}, nullptr, 0, nullptr,
+                                        read_registration_, &node_index);
+  }
+
   TfLiteRegistration* assign_registration_;
   TfLiteRegistration* read_registration_;
   TfLiteRegistration* var_handle_registration_;
@@ -177,6 +225,24 @@ TEST_F(VariableOpsTest, TestAssignThenReadVariableWithKnownShape) {
   EXPECT_EQ(GetTensorData<float>(output)[3], 4.0);
 }
 
+TEST_F(VariableOpsTest, TestAssignSliceThenReadVariable) {
+  ConstructGraphWithSliceUpdate();
+  ASSERT_EQ(interpreter_->AllocateTensors(), kTfLiteOk);
+  float* cache = GetTensorData<float>(interpreter_->tensor(0));
+  std::fill(cache, cache + 6, 0.0f);
+  GetTensorData<float>(interpreter_->tensor(1))[0] = 1.0;
+  GetTensorData<float>(interpreter_->tensor(1))[1] = 2.0;
+  GetTensorData<int32_t>(interpreter_->tensor(2))[0] = 1;
+  GetTensorData<int32_t>(interpreter_->tensor(2))[1] = 0;
+  ASSERT_EQ(interpreter_->Invoke(), kTfLiteOk);
+
+  // Verify output.
+  TfLiteTensor* output = interpreter_->tensor(4);
+  const float* output_data = GetTensorData<float>(output);
+  EXPECT_EQ(std::vector<float>(output_data, output_data + 6),
+            std::vector<float>({0.0, 0.0, 1.0, 2.0, 0.0, 0.0}));
+}
+
 TEST_F(VariableOpsTest, TestReadVariableBeforeAssign) {
   ConstructInvalidGraph();
   ASSERT_EQ(interpreter_->AllocateTensors(), kTfLiteOk);
@@ -69,6 +69,16 @@ class MemoryPlanner {
   // Returns a map of allocation information. It's only used for debugging.
   virtual void GetAllocInfo(size_t *arena_size,
                             size_t *arena_persist_size) const = 0;
+
+  // Keeps the tensors of the nodes of each group allocated for the whole
+  // group, for its nodes to run concurrently. `group_of_node` holds the group
+  // of each node in execution order, the nodes of a group being consecutive,
+  // or is empty for no groups. Takes effect from the next PlanAllocations().
+  // Returns an error if the planner does not support it.
+  virtual TfLiteStatus SetConcurrentNodeGroups(
+      const std::vector<int>& group_of_node) {
+    return kTfLiteError;
+  }
 };
 
 }  // namespace tflite
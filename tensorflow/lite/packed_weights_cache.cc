@@ -0,0 +1,194 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/packed_weights_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/minimal_logging.h"
+#include "tensorflow/lite/stderr_reporter.h"
+#include "tensorflow/lite/util.h"
+
+namespace tflite {
+namespace {
+
+// The file starts with a header and the table of its weights, followed by
+// the weights at offsets aligned to `kDefaultTensorAlignment`.
+constexpr char kMagic[8] = {'T', 'F', 'L', 'P', 'W', 'C', '0', '1'};
+
+struct FileHeader {
+  char magic[8];
+  uint64_t num_weights;
+};
+
+struct FileEntry {
+  uint64_t key;
+  uint64_t offset;
+  uint64_t bytes;
+};
+
+constexpr uint64_t kFnvPrime = 0x100000001b3ULL;
+
+uint64_t HashBytes(const void* data, size_t bytes, uint64_t hash) {
+  const char* p = static_cast<const char*>(data);
+  // Words at a time, as the weights run to megabytes.
+  for (; bytes >= sizeof(uint64_t); bytes -= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    hash = (hash ^ word) * kFnvPrime;
+    hash ^= hash >> 29;
+    p += sizeof(word);
+  }
+  for (; bytes > 0; --bytes) {
+    hash = (hash ^ static_cast<unsigned char>(*p++)) * kFnvPrime;
+  }
+  return hash;
+}
+
+uint64_t AlignOffset(uint64_t offset) {
+  return (offset + kDefaultTensorAlignment - 1) / kDefaultTensorAlignment *
+         kDefaultTensorAlignment;
+}
+
+bool FileExists(const std::string& path) {
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) return false;
+  std::fclose(file);
+  return true;
+}
+
+}  // namespace
+
+PackedWeightsCache::PackedWeightsCache(std::string path)
+    : path_(std::move(path)) {
+  if (!MMAPAllocation::IsSupported() || !FileExists(path_)) return;
+  auto file = std::make_unique<MMAPAllocation>(path_.c_str(),
+                                               DefaultErrorReporter());
+  if (!file->valid() || file->bytes() < sizeof(FileHeader)) return;
+  const char* base = static_cast<const char*>(file->base());
+  FileHeader header;
+  std::memcpy(&header, base, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.num_weights >
+          (file->bytes() - sizeof(FileHeader)) / sizeof(FileEntry)) {
+    TFLITE_LOG(TFLITE_LOG_WARNING, "Ignoring invalid packed weights cache %s",
+               path_.c_str());
+    return;
+  }
+  for (uint64_t i = 0; i < header.num_weights; ++i) {
+    FileEntry entry;
+    std::memcpy(&entry, base + sizeof(FileHeader) + i * sizeof(FileEntry),
+                sizeof(entry));
+    if (entry.offset % kDefaultTensorAlignment != 0 ||
+        entry.offset > file->bytes() ||
+        entry.bytes > file->bytes() - entry.offset) {
+      TFLITE_LOG(TFLITE_LOG_WARNING, "Ignoring invalid packed weights cache %s",
+                 path_.c_str());
+      mapped_.clear();
+      return;
+    }
+    mapped_[entry.key] = {base + entry.offset, entry.bytes};
+  }
+  file_ = std::move(file);
+}
+
+uint64_t PackedWeightsCache::Key(const char* packing, const void* data,
+                                 size_t bytes) {
+  uint64_t hash = HashBytes(packing, std::strlen(packing), 0xcbf29ce484222325);
+  hash = HashBytes(&bytes, sizeof(bytes), hash);
+  return HashBytes(data, bytes, hash);
+}
+
+const void* PackedWeightsCache::Lookup(uint64_t key, size_t bytes) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = mapped_.find(key);
+  if (it == mapped_.end() || it->second.bytes != bytes) return nullptr;
+  return it->second.data;
+}
+
+void PackedWeightsCache::Insert(uint64_t key, const void* data, size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (mapped_.count(key) != 0 || inserted_.count(key) != 0) return;
+  const char* begin = static_cast<const char*>(data);
+  inserted_.emplace(key, std::vector<char>(begin, begin + bytes));
+}
+
+TfLiteStatus PackedWeightsCache::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (inserted_.empty()) return kTfLiteOk;
+  std::vector<std::pair<uint64_t, Weights>> weights(mapped_.begin(),
+                                                    mapped_.end());
+  for (const auto& key_and_data : inserted_) {
+    weights.push_back(
+        {key_and_data.first,
+         {key_and_data.second.data(), key_and_data.second.size()}});
+  }
+
+  FileHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.num_weights = weights.size();
+  std::vector<FileEntry> entries;
+  uint64_t offset =
+      AlignOffset(sizeof(FileHeader) + weights.size() * sizeof(FileEntry));
+  for (const auto& key_and_weights : weights) {
+    entries.push_back({key_and_weights.first, offset,
+                       key_and_weights.second.bytes});
+    offset = AlignOffset(offset + key_and_weights.second.bytes);
+  }
+
+  // The other processes keep mapping the replaced file, or map the new one
+  // once it is complete.
+  const std::string temp_path =
+      path_ + ".tmp" + std::to_string(std::random_device()());
+  FILE* file = std::fopen(temp_path.c_str(), "wb");
+  if (file == nullptr) {
+    TFLITE_LOG(TFLITE_LOG_ERROR, "Failed to create %s", temp_path.c_str());
+    return kTfLiteError;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(entries.data(), sizeof(FileEntry), entries.size(),
+                        file) == entries.size();
+  const std::vector<char> padding(kDefaultTensorAlignment, 0);
+  uint64_t written = sizeof(FileHeader) + entries.size() * sizeof(FileEntry);
+  for (size_t i = 0; ok && i < weights.size(); ++i) {
+    const size_t padding_bytes = entries[i].offset - written;
+    ok = std::fwrite(padding.data(), 1, padding_bytes, file) ==
+             padding_bytes &&
+         std::fwrite(weights[i].second.data, 1, weights[i].second.bytes,
+                     file) == weights[i].second.bytes;
+    written = entries[i].offset + weights[i].second.bytes;
+  }
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok || std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+    TFLITE_LOG(TFLITE_LOG_ERROR, "Failed to write the packed weights to %s",
+               path_.c_str());
+    std::remove(temp_path.c_str());
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+size_t PackedWeightsCache::num_mapped() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return mapped_.size();
+}
+
+}  // namespace tflite
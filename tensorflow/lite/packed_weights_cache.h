@@ -0,0 +1,90 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_PACKED_WEIGHTS_CACHE_H_
+#define TENSORFLOW_LITE_PACKED_WEIGHTS_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/core/c/common.h"
+
+namespace tflite {
+
+/// A file of the weights repacked by the kernels on their first run, for the
+/// next interpreters to map them instead of repacking them in memory of their
+/// own. The processes mapping the file share its pages through the page
+/// cache.
+///
+/// The packed weights are looked up by the packing and the content of the
+/// original weights, so a cache may be shared by several models. The weights
+/// packed by the interpreters using the cache are only written to the file by
+/// `Flush()`, which replaces it as a whole.
+///
+/// It's thread-safe.
+/// WARNING: This is an experimental API and subject to change.
+class PackedWeightsCache {
+ public:
+  /// Maps the packed weights in the file at `path`, if any. The cache starts
+  /// empty if the file is missing or invalid.
+  explicit PackedWeightsCache(std::string path);
+
+  PackedWeightsCache(const PackedWeightsCache&) = delete;
+  PackedWeightsCache& operator=(const PackedWeightsCache&) = delete;
+
+  /// Returns the key of the weights packed by `packing` from the `bytes`
+  /// bytes of the original weights at `data`.
+  static uint64_t Key(const char* packing, const void* data, size_t bytes);
+
+  /// Returns the mapped packed weights of `key`, or nullptr unless the file
+  /// holds `bytes` bytes for it. The weights are aligned to
+  /// `kDefaultTensorAlignment` and live as long as the cache.
+  const void* Lookup(uint64_t key, size_t bytes) const;
+
+  /// Adds the packed weights of `key` to write to the file on the next
+  /// `Flush()`, copying them.
+  void Insert(uint64_t key, const void* data, size_t bytes);
+
+  /// Writes the mapped and the inserted weights to a new file, which
+  /// atomically replaces the one at `path`. Does nothing if no weights were
+  /// inserted.
+  TfLiteStatus Flush();
+
+  /// Returns the number of weights mapped from the file.
+  size_t num_mapped() const;
+
+ private:
+  struct Weights {
+    const void* data;
+    size_t bytes;
+  };
+
+  const std::string path_;
+  mutable std::mutex mutex_;
+  std::unique_ptr<Allocation> file_;
+  // NOLINTNEXTLINE - absl::flat_hash_map increases binary size by 106kB.
+  std::unordered_map<uint64_t, Weights> mapped_;
+  // NOLINTNEXTLINE - absl::flat_hash_map increases binary size by 106kB.
+  std::unordered_map<uint64_t, std::vector<char>> inserted_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_PACKED_WEIGHTS_CACHE_H_
@@ -0,0 +1,104 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/packed_weights_cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/util.h"
+
+namespace tflite {
+namespace {
+
+std::string CachePath(const char* name) {
+  std::string path = ::testing::TempDir() + "/" + name;
+  std::remove(path.c_str());
+  return path;
+}
+
+TEST(PackedWeightsCacheTest, KeyDependsOnPackingAndContent) {
+  const std::vector<float> weights = {1, 2, 3};
+  const std::vector<float> other_weights = {1, 2, 4};
+  const uint64_t key = PackedWeightsCache::Key(
+      "transpose", weights.data(), weights.size() * sizeof(float));
+  EXPECT_EQ(key, PackedWeightsCache::Key("transpose", weights.data(),
+                                         weights.size() * sizeof(float)));
+  EXPECT_NE(key, PackedWeightsCache::Key("shuffle", weights.data(),
+                                         weights.size() * sizeof(float)));
+  EXPECT_NE(key, PackedWeightsCache::Key("transpose", other_weights.data(),
+                                         weights.size() * sizeof(float)));
+}
+
+TEST(PackedWeightsCacheTest, MapsFlushedWeights) {
+  if (!MMAPAllocation::IsSupported()) return;
+  const std::string path = CachePath("flushed_weights");
+  const std::vector<float> first = {1, 2, 3};
+  const std::vector<float> second = {4, 5, 6, 7, 8};
+  {
+    PackedWeightsCache cache(path);
+    EXPECT_EQ(cache.num_mapped(), 0);
+    cache.Insert(1, first.data(), first.size() * sizeof(float));
+    // The inserted weights are only mapped from the written file.
+    EXPECT_EQ(cache.Lookup(1, first.size() * sizeof(float)), nullptr);
+    ASSERT_EQ(cache.Flush(), kTfLiteOk);
+  }
+  {
+    PackedWeightsCache cache(path);
+    EXPECT_EQ(cache.num_mapped(), 1);
+    cache.Insert(2, second.data(), second.size() * sizeof(float));
+    ASSERT_EQ(cache.Flush(), kTfLiteOk);
+  }
+
+  PackedWeightsCache cache(path);
+  EXPECT_EQ(cache.num_mapped(), 2);
+  const void* mapped_first = cache.Lookup(1, first.size() * sizeof(float));
+  const void* mapped_second = cache.Lookup(2, second.size() * sizeof(float));
+  ASSERT_NE(mapped_first, nullptr);
+  ASSERT_NE(mapped_second, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(mapped_second) %
+                kDefaultTensorAlignment,
+            0);
+  EXPECT_EQ(std::memcmp(mapped_first, first.data(),
+                        first.size() * sizeof(float)),
+            0);
+  EXPECT_EQ(std::memcmp(mapped_second, second.data(),
+                        second.size() * sizeof(float)),
+            0);
+  // The weights of another size are not the ones looked up.
+  EXPECT_EQ(cache.Lookup(1, sizeof(float)), nullptr);
+  EXPECT_EQ(cache.Lookup(3, sizeof(float)), nullptr);
+}
+
+TEST(PackedWeightsCacheTest, IgnoresInvalidFile) {
+  const std::string path = CachePath("invalid_weights");
+  FILE* file = std::fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  const char garbage[] = "not a packed weights cache";
+  std::fwrite(garbage, 1, sizeof(garbage), file);
+  std::fclose(file);
+
+  PackedWeightsCache cache(path);
+  EXPECT_EQ(cache.num_mapped(), 0);
+  EXPECT_EQ(cache.Lookup(1, 4), nullptr);
+}
+
+}  // namespace
+}  // namespace tflite
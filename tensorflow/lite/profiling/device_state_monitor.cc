@@ -0,0 +1,219 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/device_state_monitor.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <unistd.h>
+#endif  // __linux__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "tensorflow/lite/minimal_logging.h"
+#include "tensorflow/lite/profiling/time.h"
+
+namespace tflite {
+namespace profiling {
+namespace {
+
+#ifdef __linux__
+// Reads the integer at the start of the file at 'path', or returns
+// DeviceState::kValueNotSet.
+int64_t ReadInt64(const std::string& path) {
+  FILE* fp = fopen(path.c_str(), "r");
+  if (fp == nullptr) return DeviceState::kValueNotSet;
+  long long value;  // NOLINT(runtime/int)
+  const bool read = fscanf(fp, "%lld", &value) == 1;
+  fclose(fp);
+  return read ? value : DeviceState::kValueNotSet;
+}
+
+int64_t HzToKhz(int64_t hz) {
+  return hz == DeviceState::kValueNotSet ? hz : hz / 1000;
+}
+
+// Reads the current frequency and the frequency cap of the GPU, from the kgsl
+// entries of Adreno GPUs or else from the devfreq entry of the GPU.
+void ReadGpuFreq(DeviceState* state) {
+  const std::string kgsl = "/sys/class/kgsl/kgsl-3d0/";
+  state->gpu_cur_freq_khz = HzToKhz(ReadInt64(kgsl + "gpuclk"));
+  if (state->gpu_cur_freq_khz != DeviceState::kValueNotSet) {
+    state->gpu_max_freq_khz = HzToKhz(ReadInt64(kgsl + "max_gpuclk"));
+    return;
+  }
+
+  const std::string devfreq = "/sys/class/devfreq/";
+  DIR* dir = opendir(devfreq.c_str());
+  if (dir == nullptr) return;
+  while (const dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name.find("gpu") == std::string::npos &&
+        name.find("mali") == std::string::npos) {
+      continue;
+    }
+    state->gpu_cur_freq_khz = HzToKhz(ReadInt64(devfreq + name + "/cur_freq"));
+    state->gpu_max_freq_khz = HzToKhz(ReadInt64(devfreq + name + "/max_freq"));
+    if (state->gpu_cur_freq_khz != DeviceState::kValueNotSet) break;
+  }
+  closedir(dir);
+}
+#endif  // __linux__
+
+int64_t MaxValue(const std::vector<int64_t>& values) {
+  int64_t max = DeviceState::kValueNotSet;
+  for (int64_t value : values) max = std::max(max, value);
+  return max;
+}
+
+}  // namespace
+
+constexpr int64_t DeviceState::kValueNotSet;
+
+int64_t DeviceState::MaxCpuCurFreqKhz() const {
+  return MaxValue(cpu_cur_freq_khz);
+}
+
+int64_t DeviceState::MaxCpuMaxFreqKhz() const {
+  return MaxValue(cpu_max_freq_khz);
+}
+
+DeviceState GetDeviceState() {
+  DeviceState state;
+  state.timestamp_us = time::NowMicros();
+#ifdef __linux__
+  const long num_cpus = sysconf(_SC_NPROCESSORS_CONF);  // NOLINT(runtime/int)
+  for (long cpu = 0; cpu < num_cpus; ++cpu) {  // NOLINT(runtime/int)
+    // The values of the offline CPUs are not set.
+    const std::string cpufreq =
+        "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/";
+    state.cpu_cur_freq_khz.push_back(ReadInt64(cpufreq + "scaling_cur_freq"));
+    state.cpu_max_freq_khz.push_back(ReadInt64(cpufreq + "scaling_max_freq"));
+  }
+  if (MaxValue(state.cpu_cur_freq_khz) == DeviceState::kValueNotSet) {
+    state.cpu_cur_freq_khz.clear();
+    state.cpu_max_freq_khz.clear();
+  }
+
+  ReadGpuFreq(&state);
+
+  // The thermal zones are numbered from 0.
+  for (int zone = 0;; ++zone) {
+    const int64_t temperature_mc =
+        ReadInt64("/sys/class/thermal/thermal_zone" + std::to_string(zone) +
+                  "/temp");
+    if (temperature_mc == DeviceState::kValueNotSet) break;
+    state.max_temperature_mc =
+        std::max(state.max_temperature_mc, temperature_mc);
+  }
+#endif  // __linux__
+  return state;
+}
+
+bool DeviceStateMonitor::Sampler::IsSupported() {
+  const DeviceState state = GetDeviceState();
+  return !state.cpu_cur_freq_khz.empty() ||
+         state.gpu_cur_freq_khz != DeviceState::kValueNotSet ||
+         state.max_temperature_mc != DeviceState::kValueNotSet;
+}
+
+DeviceStateMonitor::DeviceStateMonitor(int sampling_interval_ms,
+                                       std::unique_ptr<Sampler> sampler)
+    : sampler_(std::move(sampler)),
+      is_supported_(false),
+      sampling_interval_(absl::Milliseconds(sampling_interval_ms)) {
+  is_supported_ = (sampler_ != nullptr && sampler_->IsSupported());
+  if (!is_supported_) {
+    TFLITE_LOG(TFLITE_LOG_INFO,
+               "Getting the device state isn't supported on this platform!\n");
+    return;
+  }
+}
+
+void DeviceStateMonitor::Start() {
+  if (!is_supported_) return;
+  if (check_state_thd_ != nullptr) {
+    TFLITE_LOG(TFLITE_LOG_INFO,
+               "Device state monitoring has already started!\n");
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.clear();
+  }
+  stop_signal_ = std::make_unique<absl::Notification>();
+  check_state_thd_ = std::make_unique<std::thread>(([this]() {
+    // Note we retrieve the device state at the very beginning of the thread.
+    while (true) {
+      DeviceState state = sampler_->GetDeviceState();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        samples_.push_back(std::move(state));
+      }
+      if (stop_signal_->HasBeenNotified()) break;
+      sampler_->SleepFor(sampling_interval_);
+    }
+  }));
+}
+
+void DeviceStateMonitor::Stop() {
+  if (!is_supported_) return;
+  if (check_state_thd_ == nullptr) {
+    TFLITE_LOG(TFLITE_LOG_INFO,
+               "Device state monitoring hasn't started yet or has stopped!\n");
+    return;
+  }
+  StopInternal();
+}
+
+void DeviceStateMonitor::StopInternal() {
+  if (check_state_thd_ == nullptr) return;
+  stop_signal_->Notify();
+  check_state_thd_->join();
+  stop_signal_.reset(nullptr);
+  check_state_thd_.reset(nullptr);
+}
+
+std::vector<DeviceState> DeviceStateMonitor::GetSamples() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return samples_;
+}
+
+bool DeviceStateMonitor::WaitForCooldown(int64_t max_temperature_mc,
+                                         absl::Duration timeout) {
+  if (!is_supported_) return true;
+  const absl::Time deadline = absl::Now() + timeout;
+  while (true) {
+    const int64_t temperature_mc =
+        sampler_->GetDeviceState().max_temperature_mc;
+    if (temperature_mc == DeviceState::kValueNotSet ||
+        temperature_mc <= max_temperature_mc) {
+      return true;
+    }
+    if (absl::Now() >= deadline) return false;
+    sampler_->SleepFor(sampling_interval_);
+  }
+}
+
+}  // namespace profiling
+}  // namespace tflite
@@ -0,0 +1,124 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_PROFILING_DEVICE_STATE_MONITOR_H_
+#define TENSORFLOW_LITE_PROFILING_DEVICE_STATE_MONITOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>   // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace tflite {
+namespace profiling {
+
+// The frequencies and the thermal state of the device at some point in time.
+// The values that aren't available on the device are set to kValueNotSet.
+struct DeviceState {
+  static constexpr int64_t kValueNotSet = -1;
+
+  // The time of the sample, as returned by profiling::time::NowMicros().
+  int64_t timestamp_us = 0;
+
+  // The current frequency and the frequency cap of each CPU in kHz. The cap is
+  // lowered by the thermal throttling.
+  std::vector<int64_t> cpu_cur_freq_khz;
+  std::vector<int64_t> cpu_max_freq_khz;
+
+  // The current frequency and the frequency cap of the GPU in kHz.
+  int64_t gpu_cur_freq_khz = kValueNotSet;
+  int64_t gpu_max_freq_khz = kValueNotSet;
+
+  // The highest temperature of the thermal zones in millidegrees Celsius.
+  int64_t max_temperature_mc = kValueNotSet;
+
+  // The highest current frequency and the highest frequency cap of the CPUs,
+  // i.e. of the fastest core the benchmarked thread most likely runs on.
+  int64_t MaxCpuCurFreqKhz() const;
+  int64_t MaxCpuMaxFreqKhz() const;
+};
+
+// Reads the current state of the device from the cpufreq, devfreq, kgsl and
+// thermal sysfs entries on Linux. Returns a state with no values set on other
+// platforms.
+DeviceState GetDeviceState();
+
+// Samples the frequencies and the thermal state of the device periodically in
+// a separate thread, so that a benchmark can tell the runs slowed down by the
+// frequency scaling or the thermal throttling of the device.
+class DeviceStateMonitor {
+ public:
+  // A helper class that does the device state sampling. This allows injecting
+  // an external dependency for the sake of testing or providing
+  // platform-specific implementations.
+  class Sampler {
+   public:
+    virtual ~Sampler() {}
+    virtual bool IsSupported();
+    virtual DeviceState GetDeviceState() {
+      return tflite::profiling::GetDeviceState();
+    }
+    virtual void SleepFor(const absl::Duration& duration) {
+      absl::SleepFor(duration);
+    }
+  };
+
+  explicit DeviceStateMonitor(int sampling_interval_ms = 200)
+      : DeviceStateMonitor(sampling_interval_ms, std::make_unique<Sampler>()) {}
+  DeviceStateMonitor(int sampling_interval_ms,
+                     std::unique_ptr<Sampler> sampler);
+  ~DeviceStateMonitor() { StopInternal(); }
+
+  bool IsSupported() const { return is_supported_; }
+
+  void Start();
+  void Stop();
+
+  // Returns the states sampled since the last 'Start', in increasing order of
+  // time. Can be called while the device state is being monitored.
+  std::vector<DeviceState> GetSamples() const;
+
+  // Waits until the highest temperature of the device is at most
+  // 'max_temperature_mc', checking it at the sampling interval, for at most
+  // 'timeout'. Returns whether the device cooled down, or whether its
+  // temperature isn't available.
+  bool WaitForCooldown(int64_t max_temperature_mc, absl::Duration timeout);
+
+  DeviceStateMonitor(DeviceStateMonitor&) = delete;
+  DeviceStateMonitor& operator=(const DeviceStateMonitor&) = delete;
+  DeviceStateMonitor(DeviceStateMonitor&&) = delete;
+  DeviceStateMonitor& operator=(const DeviceStateMonitor&&) = delete;
+
+ private:
+  void StopInternal();
+
+  std::unique_ptr<Sampler> sampler_ = nullptr;
+  bool is_supported_ = false;
+  std::unique_ptr<absl::Notification> stop_signal_ = nullptr;
+  absl::Duration sampling_interval_;
+  std::unique_ptr<std::thread> check_state_thd_ = nullptr;
+
+  mutable std::mutex mutex_;
+  std::vector<DeviceState> samples_;
+};
+
+}  // namespace profiling
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_PROFILING_DEVICE_STATE_MONITOR_H_
@@ -0,0 +1,105 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/device_state_monitor.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace tflite {
+namespace profiling {
+namespace {
+
+class DeviceStateNotSupportedSampler : public DeviceStateMonitor::Sampler {
+ public:
+  bool IsSupported() override { return false; }
+};
+
+// Reports a device heating up by 1 degree and whose CPU is slowed down by
+// 100 MHz at each sample.
+class FakeDeviceStateSampler : public DeviceStateMonitor::Sampler {
+ public:
+  explicit FakeDeviceStateSampler(int64_t* num_samples)
+      : num_samples_(num_samples) {}
+  bool IsSupported() override { return true; }
+  DeviceState GetDeviceState() override {
+    DeviceState state;
+    state.timestamp_us = *num_samples_;
+    state.cpu_cur_freq_khz = {1000000 - 100000 * *num_samples_, 500000};
+    state.cpu_max_freq_khz = {1000000, 1000000};
+    state.max_temperature_mc = 40000 + 1000 * *num_samples_;
+    ++*num_samples_;
+    return state;
+  }
+  void SleepFor(const absl::Duration& duration) override {
+    absl::SleepFor(duration);
+  }
+
+ private:
+  int64_t* const num_samples_;
+};
+
+TEST(DeviceStateMonitor, NotSupported) {
+  DeviceStateMonitor monitor1(
+      50, std::make_unique<DeviceStateNotSupportedSampler>());
+  EXPECT_FALSE(monitor1.IsSupported());
+  monitor1.Start();
+  monitor1.Stop();
+  EXPECT_TRUE(monitor1.GetSamples().empty());
+  EXPECT_TRUE(monitor1.WaitForCooldown(0, absl::Seconds(1)));
+
+  DeviceStateMonitor monitor2(50, nullptr);
+  EXPECT_FALSE(monitor2.IsSupported());
+}
+
+TEST(DeviceStateMonitor, SamplesUntilStopped) {
+  int64_t num_samples = 0;
+  DeviceStateMonitor monitor(
+      1, std::make_unique<FakeDeviceStateSampler>(&num_samples));
+  monitor.Start();
+  monitor.Stop();
+
+  const std::vector<DeviceState> samples = monitor.GetSamples();
+  ASSERT_EQ(samples.size(), num_samples);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    EXPECT_EQ(samples[i].timestamp_us, i);
+    EXPECT_EQ(samples[i].MaxCpuMaxFreqKhz(), 1000000);
+  }
+  EXPECT_EQ(samples[0].MaxCpuCurFreqKhz(), 1000000);
+}
+
+TEST(DeviceStateMonitor, WaitsForCooldown) {
+  int64_t num_samples = 0;
+  DeviceStateMonitor monitor(
+      1, std::make_unique<FakeDeviceStateSampler>(&num_samples));
+  EXPECT_TRUE(monitor.WaitForCooldown(45000, absl::Seconds(10)));
+  EXPECT_EQ(num_samples, 1);
+  // The fake device only heats up.
+  EXPECT_FALSE(monitor.WaitForCooldown(0, absl::Milliseconds(1)));
+}
+
+TEST(DeviceState, NoCpuFrequency) {
+  DeviceState state;
+  EXPECT_EQ(state.MaxCpuCurFreqKhz(), DeviceState::kValueNotSet);
+  EXPECT_EQ(state.MaxCpuMaxFreqKhz(), DeviceState::kValueNotSet);
+}
+
+}  // namespace
+}  // namespace profiling
+}  // namespace tflite
@@ -0,0 +1,159 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/telemetry/sampling_profiler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/profiling/memory_info.h"
+#include "tensorflow/lite/profiling/telemetry/telemetry_status.h"
+#include "tensorflow/lite/profiling/time.h"
+
+namespace tflite::telemetry {
+namespace {
+
+int HistogramBucket(uint64_t elapsed_us) {
+  int bucket = 0;
+  while (elapsed_us != 0 &&
+         bucket < SamplingTelemetryProfiler::kNumHistogramBuckets - 1) {
+    elapsed_us >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+profiling::memory::MemoryUsage MaxMemoryUsage(
+    const profiling::memory::MemoryUsage& a,
+    const profiling::memory::MemoryUsage& b) {
+  profiling::memory::MemoryUsage max;
+  max.mem_footprint_kb = std::max(a.mem_footprint_kb, b.mem_footprint_kb);
+  max.total_allocated_bytes =
+      std::max(a.total_allocated_bytes, b.total_allocated_bytes);
+  max.in_use_allocated_bytes =
+      std::max(a.in_use_allocated_bytes, b.in_use_allocated_bytes);
+  return max;
+}
+
+}  // namespace
+
+SamplingTelemetryProfiler::SamplingTelemetryProfiler(int sampling_period,
+                                                     Callback callback)
+    : sampling_period_(std::max(sampling_period, 1)),
+      callback_(std::move(callback)) {}
+
+std::vector<SamplingTelemetryProfiler::OpStats>
+SamplingTelemetryProfiler::GetOpStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<OpStats> stats;
+  stats.reserve(op_stats_.size());
+  for (const auto& key_and_stats : op_stats_) {
+    stats.push_back(key_and_stats.second);
+  }
+  return stats;
+}
+
+profiling::memory::MemoryUsage SamplingTelemetryProfiler::GetPeakMemoryUsage()
+    const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return peak_memory_usage_;
+}
+
+int64_t SamplingTelemetryProfiler::num_samples() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_samples_;
+}
+
+void SamplingTelemetryProfiler::ReportTelemetryEvent(
+    const char* event_name, TelemetryStatusCode status) {
+  if (std::strcmp(event_name, "Invoke") != 0) return;
+  std::unique_lock<std::mutex> lock(mutex_);
+  // The subgraphs invoked by the control flow ops end within their op.
+  if (depth_ != 0) return;
+  const bool sampled = sampling_;
+  const uint64_t invoke_index = invoke_index_++;
+  sampling_ = invoke_index_ % sampling_period_ == 0;
+  if (!sampled) return;
+
+  InvokeSample sample = std::move(sample_);
+  sample_ = InvokeSample();
+  sample.invoke_index = invoke_index;
+  sample.elapsed_us =
+      begin_us_.empty() ? 0 : profiling::time::NowMicros() - begin_us_[0];
+  begin_us_.clear();
+  sample.memory_usage = profiling::memory::GetMemoryUsage();
+
+  ++num_samples_;
+  for (const OpTiming& timing : sample.ops) Aggregate(timing);
+  peak_memory_usage_ =
+      num_samples_ == 1
+          ? sample.memory_usage
+          : MaxMemoryUsage(peak_memory_usage_, sample.memory_usage);
+  // The callback may take long, so it doesn't block the other readers.
+  lock.unlock();
+  if (callback_) callback_(sample);
+}
+
+uint32_t SamplingTelemetryProfiler::ReportBeginOpInvokeEvent(
+    const char* op_name, int64_t op_idx, int64_t subgraph_idx) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int depth = depth_++;
+  if (!sampling_) return kNotSampled;
+  sample_.ops.push_back({op_name, op_idx, subgraph_idx, depth, 0});
+  begin_us_.push_back(profiling::time::NowMicros());
+  return sample_.ops.size() - 1;
+}
+
+void SamplingTelemetryProfiler::ReportEndOpInvokeEvent(uint32_t event_handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  --depth_;
+  if (event_handle >= sample_.ops.size()) return;
+  sample_.ops[event_handle].elapsed_us =
+      profiling::time::NowMicros() - begin_us_[event_handle];
+}
+
+void SamplingTelemetryProfiler::ReportOpInvokeEvent(const char* op_name,
+                                                    uint64_t elapsed_time,
+                                                    int64_t op_idx,
+                                                    int64_t subgraph_idx) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!sampling_) return;
+  sample_.ops.push_back({op_name, op_idx, subgraph_idx, depth_, elapsed_time});
+  begin_us_.push_back(profiling::time::NowMicros() - elapsed_time);
+}
+
+void SamplingTelemetryProfiler::Aggregate(const OpTiming& timing) {
+  auto key = std::make_tuple(timing.subgraph_idx, timing.op_idx, timing.depth);
+  auto it = op_stats_.find(key);
+  if (it == op_stats_.end()) {
+    OpStats stats;
+    stats.op_name = timing.op_name;
+    stats.op_idx = timing.op_idx;
+    stats.subgraph_idx = timing.subgraph_idx;
+    stats.depth = timing.depth;
+    it = op_stats_.emplace(key, std::move(stats)).first;
+  }
+  OpStats& stats = it->second;
+  ++stats.count;
+  stats.total_us += timing.elapsed_us;
+  stats.min_us = std::min(stats.min_us, timing.elapsed_us);
+  stats.max_us = std::max(stats.max_us, timing.elapsed_us);
+  ++stats.histogram[HistogramBucket(timing.elapsed_us)];
+}
+
+}  // namespace tflite::telemetry
@@ -0,0 +1,136 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_PROFILING_TELEMETRY_SAMPLING_PROFILER_H_
+#define TENSORFLOW_LITE_PROFILING_TELEMETRY_SAMPLING_PROFILER_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "tensorflow/lite/profiling/memory_info.h"
+#include "tensorflow/lite/profiling/telemetry/c/telemetry_setting.h"
+#include "tensorflow/lite/profiling/telemetry/profiler.h"
+#include "tensorflow/lite/profiling/telemetry/telemetry_status.h"
+
+namespace tflite::telemetry {
+
+// A telemetry profiler streaming the op timings of one in every
+// `sampling_period` invocations, to be cheap enough to stay installed in
+// production. The other invocations only count the nesting of the op events.
+//
+// The timings of a sampled invocation are passed to the callback, if any, and
+// aggregated into per-op histograms. The nodes of a delegate kernel report the
+// timings of the delegate partitions, and the ops they or the control flow ops
+// invoke are reported nested in them.
+//
+// An invocation ends with the "Invoke" telemetry event reported outside of any
+// op, so the profiler should be installed to a single interpreter.
+class SamplingTelemetryProfiler : public TelemetryProfiler {
+ public:
+  static constexpr int kNumHistogramBuckets = 32;
+
+  struct OpTiming {
+    std::string op_name;
+    int64_t op_idx;
+    int64_t subgraph_idx;
+    // The number of enclosing op events, e.g. 1 for the ops within a delegate
+    // partition.
+    int depth;
+    uint64_t elapsed_us;
+  };
+
+  struct InvokeSample {
+    // The index of the invocation since the profiler was installed.
+    uint64_t invoke_index = 0;
+    // The time from the beginning of the first op to the end of invocation.
+    uint64_t elapsed_us = 0;
+    std::vector<OpTiming> ops;
+    // The memory usage of the process at the end of invocation.
+    profiling::memory::MemoryUsage memory_usage;
+  };
+
+  struct OpStats {
+    std::string op_name;
+    int64_t op_idx;
+    int64_t subgraph_idx;
+    int depth;
+    int64_t count = 0;
+    uint64_t total_us = 0;
+    uint64_t min_us = UINT64_MAX;
+    uint64_t max_us = 0;
+    // `histogram[i]` counts the timings in [2^(i-1), 2^i) microseconds, and
+    // `histogram[0]` those below 1 microsecond.
+    std::vector<int64_t> histogram =
+        std::vector<int64_t>(kNumHistogramBuckets, 0);
+  };
+
+  using Callback = std::function<void(const InvokeSample&)>;
+
+  // Samples one in every `sampling_period` invocations, starting with the
+  // first. `callback` is called on the thread of the interpreter.
+  explicit SamplingTelemetryProfiler(int sampling_period,
+                                     Callback callback = nullptr);
+
+  // Returns the aggregated stats of the sampled ops, ordered by subgraph, op
+  // index and depth.
+  std::vector<OpStats> GetOpStats() const;
+
+  // Returns the highest memory usage of the process over the sampled
+  // invocations, or the default one if none was sampled.
+  profiling::memory::MemoryUsage GetPeakMemoryUsage() const;
+
+  int64_t num_samples() const;
+
+  void ReportTelemetryEvent(const char* event_name,
+                            TelemetryStatusCode status) override;
+  void ReportTelemetryOpEvent(const char* event_name, int64_t op_idx,
+                              int64_t subgraph_idx,
+                              TelemetryStatusCode status) override {}
+  void ReportSettings(const char* setting_name,
+                      const TfLiteTelemetrySettings* settings) override {}
+  uint32_t ReportBeginOpInvokeEvent(const char* op_name, int64_t op_idx,
+                                    int64_t subgraph_idx) override;
+  void ReportEndOpInvokeEvent(uint32_t event_handle) override;
+  void ReportOpInvokeEvent(const char* op_name, uint64_t elapsed_time,
+                           int64_t op_idx, int64_t subgraph_idx) override;
+
+ private:
+  // The handle of the op events of the invocations not sampled.
+  static constexpr uint32_t kNotSampled = UINT32_MAX - 1;
+
+  void Aggregate(const OpTiming& timing);
+
+  const int sampling_period_;
+  const Callback callback_;
+
+  mutable std::mutex mutex_;
+  uint64_t invoke_index_ = 0;
+  bool sampling_ = true;
+  int depth_ = 0;
+  InvokeSample sample_;
+  // The beginning time of the op events of `sample_.ops`.
+  std::vector<uint64_t> begin_us_;
+  std::map<std::tuple<int64_t, int64_t, int>, OpStats> op_stats_;
+  profiling::memory::MemoryUsage peak_memory_usage_;
+  int64_t num_samples_ = 0;
+};
+
+}  // namespace tflite::telemetry
+
+#endif  // TENSORFLOW_LITE_PROFILING_TELEMETRY_SAMPLING_PROFILER_H_
@@ -0,0 +1,124 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/telemetry/sampling_profiler.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/profiling/telemetry/telemetry.h"
+
+namespace tflite::telemetry {
+namespace {
+
+class SamplingTelemetryProfilerTest : public ::testing::Test {
+ protected:
+  SamplingTelemetryProfilerTest()
+      : profiler_(/*sampling_period=*/2,
+                  [this](const SamplingTelemetryProfiler::InvokeSample&
+                             sample) { samples_.push_back(sample); }) {
+    context_.profiler = &profiler_;
+  }
+
+  // Invokes a subgraph of a delegate partition of two ops and a builtin op.
+  void Invoke() {
+    Profiler* profiler = &profiler_;
+    uint32_t partition = profiler->BeginEvent(
+        "Delegate", Profiler::EventType::OPERATOR_INVOKE_EVENT, 0, 0);
+    uint32_t delegate_op = profiler->BeginEvent(
+        "Conv2D", Profiler::EventType::DELEGATE_OPERATOR_INVOKE_EVENT, 0, 0);
+    profiler->EndEvent(delegate_op);
+    profiler->AddEvent(
+        "Add", Profiler::EventType::DELEGATE_PROFILED_OPERATOR_INVOKE_EVENT,
+        /*metric=*/5, 1, 0);
+    profiler->EndEvent(partition);
+    uint32_t op = profiler->BeginEvent(
+        "Softmax", Profiler::EventType::OPERATOR_INVOKE_EVENT, 1, 0);
+    profiler->EndEvent(op);
+    TelemetryReportEvent(&context_, "Invoke", kTfLiteOk);
+  }
+
+  SamplingTelemetryProfiler profiler_;
+  TfLiteContext context_{};
+  std::vector<SamplingTelemetryProfiler::InvokeSample> samples_;
+};
+
+TEST_F(SamplingTelemetryProfilerTest, SamplesOneInPeriodInvocations) {
+  for (int i = 0; i < 5; ++i) Invoke();
+
+  ASSERT_EQ(samples_.size(), 3);
+  EXPECT_EQ(profiler_.num_samples(), 3);
+  EXPECT_EQ(samples_[0].invoke_index, 0);
+  EXPECT_EQ(samples_[1].invoke_index, 2);
+  EXPECT_EQ(samples_[2].invoke_index, 4);
+
+  const auto& ops = samples_[1].ops;
+  ASSERT_EQ(ops.size(), 4);
+  EXPECT_EQ(ops[0].op_name, "Delegate");
+  EXPECT_EQ(ops[0].depth, 0);
+  EXPECT_EQ(ops[1].op_name, "Conv2D");
+  EXPECT_EQ(ops[1].depth, 1);
+  EXPECT_EQ(ops[2].op_name, "Add");
+  EXPECT_EQ(ops[2].depth, 1);
+  EXPECT_EQ(ops[2].elapsed_us, 5);
+  EXPECT_EQ(ops[3].op_name, "Softmax");
+  EXPECT_EQ(ops[3].op_idx, 1);
+  EXPECT_EQ(ops[3].depth, 0);
+  EXPECT_GE(samples_[1].elapsed_us, ops[0].elapsed_us);
+}
+
+TEST_F(SamplingTelemetryProfilerTest, IgnoresInvocationsOfChildSubgraphs) {
+  Profiler* profiler = &profiler_;
+  uint32_t op = profiler->BeginEvent(
+      "While", Profiler::EventType::OPERATOR_INVOKE_EVENT, 0, 0);
+  uint32_t body_op = profiler->BeginEvent(
+      "Add", Profiler::EventType::OPERATOR_INVOKE_EVENT, 0, 1);
+  profiler->EndEvent(body_op);
+  TelemetryReportEvent(&context_, "Invoke", kTfLiteOk);
+  EXPECT_TRUE(samples_.empty());
+  profiler->EndEvent(op);
+  TelemetryReportEvent(&context_, "Invoke", kTfLiteOk);
+
+  ASSERT_EQ(samples_.size(), 1);
+  ASSERT_EQ(samples_[0].ops.size(), 2);
+  EXPECT_EQ(samples_[0].ops[1].subgraph_idx, 1);
+  EXPECT_EQ(samples_[0].ops[1].depth, 1);
+}
+
+TEST_F(SamplingTelemetryProfilerTest, AggregatesOpStats) {
+  for (int i = 0; i < 4; ++i) Invoke();
+
+  const auto stats = profiler_.GetOpStats();
+  ASSERT_EQ(stats.size(), 4);
+  for (const auto& op_stats : stats) {
+    EXPECT_EQ(op_stats.count, 2);
+    EXPECT_LE(op_stats.min_us, op_stats.max_us);
+    int64_t histogram_count = 0;
+    for (int64_t count : op_stats.histogram) histogram_count += count;
+    EXPECT_EQ(histogram_count, 2);
+  }
+  // Ordered by subgraph, op index and depth.
+  EXPECT_EQ(stats[0].op_name, "Delegate");
+  EXPECT_EQ(stats[1].op_name, "Conv2D");
+  EXPECT_EQ(stats[2].op_name, "Softmax");
+  EXPECT_EQ(stats[3].op_name, "Add");
+  EXPECT_EQ(stats[3].total_us, 10);
+  // 5 microseconds are in [4, 8).
+  EXPECT_EQ(stats[3].histogram[3], 2);
+}
+
+}  // namespace
+}  // namespace tflite::telemetry
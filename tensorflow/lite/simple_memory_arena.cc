@@ -24,6 +24,7 @@ limitations under the License.
 #include <limits>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/lite/core/c/common.h"
@@ -44,6 +45,62 @@ T AlignTo(size_t alignment, T offset) {
 
 namespace tflite {
 
+char* SharedMemoryArena::Commit(SimpleMemoryArena* arena, size_t alignment,
+                                size_t required_size, bool* reallocated) {
+  // The contents are only kept for the arena committed last.
+  const bool keep_contents = owner_ == arena;
+  *reallocated = !keep_contents;
+  if (!keep_contents && owner_ != nullptr) {
+    owner_->Evict();
+  }
+  owner_ = arena;
+  char* aligned_ptr = reinterpret_cast<char*>(
+      AlignTo(alignment, reinterpret_cast<intptr_t>(buffer_.get())));
+  if (required_size > buffer_size_ || aligned_ptr != buffer_aligned_ptr_) {
+    *reallocated = true;
+    char* new_alloc = new char[required_size];
+    char* new_aligned_ptr = reinterpret_cast<char*>(
+        AlignTo(alignment, reinterpret_cast<intptr_t>(new_alloc)));
+    if (keep_contents && buffer_size_ > 0) {
+      size_t copy_amount =
+          std::min(buffer_.get() + buffer_size_ - buffer_aligned_ptr_,
+                   new_alloc + required_size - new_aligned_ptr);
+      memcpy(new_aligned_ptr, buffer_aligned_ptr_, copy_amount);
+    }
+    buffer_.reset(new_alloc);
+    buffer_size_ = required_size;
+    buffer_aligned_ptr_ = new_aligned_ptr;
+  }
+  return buffer_aligned_ptr_;
+}
+
+void SharedMemoryArena::Release(SimpleMemoryArena* arena) {
+  if (owner_ == arena) {
+    owner_ = nullptr;
+  }
+}
+
+SimpleMemoryArena::~SimpleMemoryArena() {
+  if (shared_arena_ != nullptr) {
+    shared_arena_->Release(this);
+  }
+}
+
+void SimpleMemoryArena::UseSharedArena(SharedMemoryArena* shared_arena,
+                                       std::function<void()> on_evicted) {
+  shared_arena_ = shared_arena;
+  on_evicted_ = std::move(on_evicted);
+}
+
+void SimpleMemoryArena::Evict() {
+  committed_ = false;
+  underlying_buffer_size_ = 0;
+  underlying_buffer_aligned_ptr_ = nullptr;
+  if (on_evicted_) {
+    on_evicted_();
+  }
+}
+
 void SimpleMemoryArena::PurgeAfter(int32_t node) {
   for (int i = 0; i < active_allocs_.size(); ++i) {
     if (active_allocs_[i].first_node > node) {
@@ -144,6 +201,13 @@ TfLiteStatus SimpleMemoryArena::Allocate(
 TfLiteStatus SimpleMemoryArena::Commit(TfLiteContext* context,
                                        bool* arena_reallocated) {
   size_t required_size = RequiredBufferSize();
+  if (shared_arena_ != nullptr) {
+    underlying_buffer_aligned_ptr_ = shared_arena_->Commit(
+        this, arena_alignment_, required_size, arena_reallocated);
+    underlying_buffer_size_ = shared_arena_->GetBufferSize();
+    committed_ = true;
+    return kTfLiteOk;
+  }
   if (required_size > underlying_buffer_size_) {
     *arena_reallocated = true;
 #ifdef TF_LITE_TENSORFLOW_PROFILER
@@ -211,6 +275,12 @@ TfLiteStatus SimpleMemoryArena::ClearPlan() {
 
 TfLiteStatus SimpleMemoryArena::ReleaseBuffer() {
   committed_ = false;
+  if (shared_arena_ != nullptr) {
+    shared_arena_->Release(this);
+    underlying_buffer_size_ = 0;
+    underlying_buffer_aligned_ptr_ = nullptr;
+    return kTfLiteOk;
+  }
 #ifdef TF_LITE_TENSORFLOW_PROFILER
   OnTfLiteArenaDealloc(subgraph_index_, reinterpret_cast<std::uintptr_t>(this),
                        underlying_buffer_size_);
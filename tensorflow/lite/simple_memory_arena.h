@@ -18,6 +18,7 @@ limitations under the License.
 #include <stddef.h>
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -55,6 +56,47 @@ struct ArenaAllocWithUsageInterval {
   }
 };
 
+class SimpleMemoryArena;
+
+// A buffer shared by the non-persistent arenas of several interpreters which
+// never run at the same time, so that they take as much memory as the largest
+// of them instead of the sum.
+//
+// The buffer holds the tensors of one arena at a time: committing an arena to
+// it evicts the tensors of the arena committed before, which then has to be
+// committed again before use. The buffer must outlive the arenas using it, and
+// it is not thread-safe.
+class SharedMemoryArena {
+ public:
+  SharedMemoryArena() = default;
+  SharedMemoryArena(const SharedMemoryArena&) = delete;
+  SharedMemoryArena& operator=(const SharedMemoryArena&) = delete;
+
+  // The size of the buffer, that of the largest arena committed to it.
+  size_t GetBufferSize() const { return buffer_size_; }
+
+  // The arena whose tensors the buffer holds, if any.
+  const SimpleMemoryArena* owner() const { return owner_; }
+
+ private:
+  friend class SimpleMemoryArena;
+
+  // Grows the buffer to at least `required_size` bytes for `arena`, evicting
+  // the arena committed before, and returns its start aligned to `alignment`.
+  // Sets `reallocated` if the allocations of `arena` have to be resolved
+  // again.
+  char* Commit(SimpleMemoryArena* arena, size_t alignment,
+               size_t required_size, bool* reallocated);
+
+  // Keeps the buffer, for the next arena committed to it.
+  void Release(SimpleMemoryArena* arena);
+
+  std::unique_ptr<char[]> buffer_;
+  size_t buffer_size_ = 0;
+  char* buffer_aligned_ptr_ = nullptr;
+  SimpleMemoryArena* owner_ = nullptr;
+};
+
 // This small class is responsible for allocating, deallocating and reusing
 // dynamic memory from a common underlying buffer. The arena can be used in
 // scenarios when the pattern of memory allocations and deallocations is
@@ -70,6 +112,14 @@ class SimpleMemoryArena {
         underlying_buffer_size_(0),
         active_allocs_() {}
 
+  ~SimpleMemoryArena();
+
+  // Commits the arena to `shared_arena` instead of a buffer of its own, and
+  // calls `on_evicted` when another arena takes it. Must be called before the
+  // arena is committed.
+  void UseSharedArena(SharedMemoryArena* shared_arena,
+                      std::function<void()> on_evicted);
+
   // Delete all allocs. This should be called when allocating the first node of
   // a subgraph.
   void ResetAllocs();
@@ -122,6 +172,7 @@ class SimpleMemoryArena {
   // again until Commit() is called & tensor allocations are resolved.
   TfLiteStatus ReleaseBuffer();
 
+  // While committed to a shared arena, the size of the shared arena.
   size_t GetBufferSize() const { return underlying_buffer_size_; }
 
   std::intptr_t BasePointer() const {
@@ -149,6 +200,11 @@ class SimpleMemoryArena {
   int subgraph_index_;
 
  private:
+  friend class SharedMemoryArena;
+
+  // Called when another arena is committed to `shared_arena_`.
+  void Evict();
+
   bool committed_;
   size_t arena_alignment_;
   size_t high_water_mark_;
@@ -156,6 +212,8 @@ class SimpleMemoryArena {
   size_t underlying_buffer_size_;
   char* underlying_buffer_aligned_ptr_;
   std::vector<ArenaAllocWithUsageInterval> active_allocs_;
+  SharedMemoryArena* shared_arena_ = nullptr;
+  std::function<void()> on_evicted_;
 };
 
 }  // namespace tflite
@@ -322,6 +322,56 @@ TEST(SimpleMemoryArenaTest, TestClearBuffer) {
   EXPECT_NE(resolved_ptr, nullptr);
 }
 
+TEST(SimpleMemoryArenaTest, TestSharedArena) {
+  TfLiteContext context;
+  context.ReportError = ReportError;
+  SharedMemoryArena shared_arena;
+  SimpleMemoryArena arena1(64);
+  SimpleMemoryArena arena2(64);
+  int num_evictions1 = 0;
+  arena1.UseSharedArena(&shared_arena, [&]() { ++num_evictions1; });
+  arena2.UseSharedArena(&shared_arena, nullptr);
+  ArenaAllocWithUsageInterval alloc1, alloc2;
+  arena1.Allocate(&context, 32, 4095, 0, 0, 1, &alloc1);
+  arena2.Allocate(&context, 32, 1023, 0, 0, 1, &alloc2);
+
+  bool reallocated = false;
+  ASSERT_EQ(arena1.Commit(&context, &reallocated), kTfLiteOk);
+  EXPECT_TRUE(reallocated);
+  EXPECT_EQ(shared_arena.owner(), &arena1);
+  char* resolved_ptr1 = nullptr;
+  ASSERT_EQ(arena1.ResolveAlloc(&context, alloc1, &resolved_ptr1), kTfLiteOk);
+  EXPECT_NE(resolved_ptr1, nullptr);
+  const size_t buffer_size = shared_arena.GetBufferSize();
+  EXPECT_EQ(buffer_size, arena1.RequiredBufferSize());
+
+  // Committing the second arena evicts the first one, and reuses the buffer.
+  ASSERT_EQ(arena2.Commit(&context, &reallocated), kTfLiteOk);
+  EXPECT_TRUE(reallocated);
+  EXPECT_EQ(num_evictions1, 1);
+  EXPECT_EQ(shared_arena.owner(), &arena2);
+  EXPECT_EQ(shared_arena.GetBufferSize(), buffer_size);
+  EXPECT_EQ(arena1.GetBufferSize(), 0);
+  char* resolved_ptr2 = nullptr;
+  ASSERT_NE(arena1.ResolveAlloc(&context, alloc1, &resolved_ptr2), kTfLiteOk);
+  ASSERT_EQ(arena2.ResolveAlloc(&context, alloc2, &resolved_ptr2), kTfLiteOk);
+  EXPECT_EQ(resolved_ptr2, resolved_ptr1);
+
+  // Committing the owner again keeps its allocations.
+  ASSERT_EQ(arena2.Commit(&context, &reallocated), kTfLiteOk);
+  EXPECT_FALSE(reallocated);
+
+  // Releasing the owner keeps the buffer for the next one.
+  ASSERT_EQ(arena2.ReleaseBuffer(), kTfLiteOk);
+  EXPECT_EQ(shared_arena.owner(), nullptr);
+  EXPECT_EQ(shared_arena.GetBufferSize(), buffer_size);
+  ASSERT_EQ(arena1.Commit(&context, &reallocated), kTfLiteOk);
+  EXPECT_TRUE(reallocated);
+  EXPECT_EQ(num_evictions1, 1);
+  ASSERT_EQ(arena1.ResolveAlloc(&context, alloc1, &resolved_ptr1), kTfLiteOk);
+  EXPECT_EQ(resolved_ptr1, resolved_ptr2);
+}
+
 // Test parameterized by whether ClearBuffer() is called before ClearPlan(), or
 // vice versa.
 class BufferAndPlanClearingTest : public ::testing::Test,
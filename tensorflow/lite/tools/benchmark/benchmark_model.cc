@@ -19,11 +19,16 @@ limitations under the License.
 #include <unistd.h>
 #endif  // __linux__
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
+#include "absl/time/time.h"
+#include "tensorflow/lite/profiling/device_state_monitor.h"
 #include "tensorflow/lite/profiling/memory_info.h"
 #include "tensorflow/lite/profiling/time.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_utils.h"
@@ -34,6 +39,7 @@ namespace benchmark {
 using tensorflow::Stat;
 
 constexpr int kMemoryCheckIntervalMs = 50;
+constexpr int kDeviceStateCheckIntervalMs = 200;
 
 #ifdef __linux__
 void GetRssStats(size_t* vsize, size_t* rss, size_t* shared, size_t* code) {
@@ -71,6 +77,13 @@ BenchmarkParams BenchmarkModel::DefaultParams() {
                   BenchmarkParam::Create<bool>(false));
   params.AddParam("memory_footprint_check_interval_ms",
                   BenchmarkParam::Create<int32_t>(kMemoryCheckIntervalMs));
+  params.AddParam("report_device_state", BenchmarkParam::Create<bool>(false));
+  params.AddParam("device_state_check_interval_ms",
+                  BenchmarkParam::Create<int32_t>(kDeviceStateCheckIntervalMs));
+  params.AddParam("throughput_window_secs",
+                  BenchmarkParam::Create<float>(10.0f));
+  params.AddParam("cooldown_temperature", BenchmarkParam::Create<float>(-1.0f));
+  params.AddParam("cooldown_max_secs", BenchmarkParam::Create<float>(300.0f));
   return params;
 }
 
@@ -114,6 +127,231 @@ void BenchmarkLoggingListener::OnBenchmarkEnd(const BenchmarkResults& results) {
   }
 }
 
+namespace {
+
+using profiling::DeviceState;
+
+// Returns the range of the samples in [start_us, end_us], or the last sample
+// before 'start_us', or else the first one, if there's none in the range.
+std::pair<std::vector<DeviceState>::const_iterator,
+          std::vector<DeviceState>::const_iterator>
+SamplesInRange(const std::vector<DeviceState>& samples, int64_t start_us,
+               int64_t end_us) {
+  auto begin = std::lower_bound(
+      samples.begin(), samples.end(), start_us,
+      [](const DeviceState& s, int64_t t) { return s.timestamp_us < t; });
+  auto end = std::upper_bound(
+      begin, samples.end(), end_us,
+      [](int64_t t, const DeviceState& s) { return t < s.timestamp_us; });
+  if (begin == end && !samples.empty()) {
+    if (begin != samples.begin()) --begin;
+    end = begin + 1;
+  }
+  return {begin, end};
+}
+
+// Returns the average of the highest current CPU frequencies sampled in
+// [start_us, end_us], or DeviceState::kValueNotSet.
+int64_t AvgCpuFreqKhz(const std::vector<DeviceState>& samples,
+                      int64_t start_us, int64_t end_us) {
+  const auto range = SamplesInRange(samples, start_us, end_us);
+  int64_t sum = 0;
+  int count = 0;
+  for (auto it = range.first; it != range.second; ++it) {
+    const int64_t freq_khz = it->MaxCpuCurFreqKhz();
+    if (freq_khz == DeviceState::kValueNotSet) continue;
+    sum += freq_khz;
+    ++count;
+  }
+  return count > 0 ? sum / count : DeviceState::kValueNotSet;
+}
+
+// Returns whether the frequency cap of a CPU or of the GPU in 'state' is lower
+// than the one in 'initial'.
+bool IsThrottled(const DeviceState& initial, const DeviceState& state) {
+  const size_t num_cpus =
+      std::min(initial.cpu_max_freq_khz.size(), state.cpu_max_freq_khz.size());
+  for (size_t i = 0; i < num_cpus; ++i) {
+    // The offline CPUs have no frequency cap.
+    if (initial.cpu_max_freq_khz[i] == DeviceState::kValueNotSet ||
+        state.cpu_max_freq_khz[i] == DeviceState::kValueNotSet) {
+      continue;
+    }
+    if (state.cpu_max_freq_khz[i] < initial.cpu_max_freq_khz[i]) return true;
+  }
+  return initial.gpu_max_freq_khz != DeviceState::kValueNotSet &&
+         state.gpu_max_freq_khz != DeviceState::kValueNotSet &&
+         state.gpu_max_freq_khz < initial.gpu_max_freq_khz;
+}
+
+}  // namespace
+
+void DeviceStateListener::OnBenchmarkStart(const BenchmarkParams& params) {
+  regular_runs_.clear();
+  monitor_->Start();
+}
+
+void DeviceStateListener::OnSingleRunStart(RunType run_type) {
+  in_regular_run_ = run_type == REGULAR;
+  run_start_us_ = profiling::time::NowMicros();
+}
+
+void DeviceStateListener::OnSingleRunEnd() {
+  if (!in_regular_run_) return;
+  const int64_t end_us = profiling::time::NowMicros();
+  regular_runs_.push_back({run_start_us_, end_us});
+}
+
+void DeviceStateListener::OnBenchmarkEnd(const BenchmarkResults& results) {
+  monitor_->Stop();
+  const std::vector<DeviceState> samples = monitor_->GetSamples();
+  ComputeResults(samples);
+  LogResults(samples);
+}
+
+void DeviceStateListener::ComputeResults(
+    const std::vector<DeviceState>& samples) {
+  throttling_start_us_ = -1;
+  normalized_inference_time_us_ = Stat<int64_t>();
+  throughput_windows_.clear();
+  if (samples.empty()) return;
+
+  const DeviceState& initial = samples.front();
+  const int64_t origin_us = regular_runs_.empty()
+                                ? initial.timestamp_us
+                                : regular_runs_.front().start_us;
+  for (const DeviceState& state : samples) {
+    if (IsThrottled(initial, state)) {
+      throttling_start_us_ =
+          std::max<int64_t>(state.timestamp_us - origin_us, 0);
+      break;
+    }
+  }
+  if (regular_runs_.empty()) return;
+
+  const int64_t initial_cpu_cap_khz = initial.MaxCpuMaxFreqKhz();
+  const int64_t window_us =
+      std::max<int64_t>(throughput_window_secs_ * 1e6, 1);
+  for (const RunTiming& run : regular_runs_) {
+    const int64_t latency_us = run.end_us - run.start_us;
+    const int64_t freq_khz = AvgCpuFreqKhz(samples, run.start_us, run.end_us);
+    if (initial_cpu_cap_khz > 0 && freq_khz != DeviceState::kValueNotSet) {
+      normalized_inference_time_us_.UpdateStat(latency_us * freq_khz /
+                                               initial_cpu_cap_khz);
+    }
+
+    // The short last window ends with its last run, so the runs are counted
+    // in the window they start in.
+    const size_t index = (run.start_us - origin_us) / window_us;
+    if (index >= throughput_windows_.size()) {
+      throughput_windows_.resize(index + 1);
+    }
+    ++throughput_windows_[index].num_runs;
+    throughput_windows_[index].total_latency_us += latency_us;
+  }
+
+  for (size_t i = 0; i < throughput_windows_.size(); ++i) {
+    ThroughputWindow& window = throughput_windows_[i];
+    window.start_us = origin_us + i * window_us;
+    window.end_us = i + 1 < throughput_windows_.size()
+                        ? window.start_us + window_us
+                        : regular_runs_.back().end_us;
+    window.avg_cpu_freq_khz =
+        AvgCpuFreqKhz(samples, window.start_us, window.end_us);
+    const auto range = SamplesInRange(samples, window.start_us, window.end_us);
+    for (auto it = range.first; it != range.second; ++it) {
+      window.max_temperature_mc =
+          std::max(window.max_temperature_mc, it->max_temperature_mc);
+    }
+  }
+}
+
+void DeviceStateListener::LogResults(
+    const std::vector<DeviceState>& samples) const {
+  if (samples.empty()) {
+    TFLITE_LOG(INFO) << "The device state wasn't sampled during the runs.";
+    return;
+  }
+
+  const DeviceState& initial = samples.front();
+  const DeviceState& last = samples.back();
+  int64_t min_cpu_freq_khz = DeviceState::kValueNotSet;
+  int64_t max_gpu_freq_khz = DeviceState::kValueNotSet;
+  int64_t max_temperature_mc = DeviceState::kValueNotSet;
+  for (const DeviceState& state : samples) {
+    const int64_t cpu_freq_khz = state.MaxCpuCurFreqKhz();
+    if (cpu_freq_khz != DeviceState::kValueNotSet &&
+        (min_cpu_freq_khz == DeviceState::kValueNotSet ||
+         cpu_freq_khz < min_cpu_freq_khz)) {
+      min_cpu_freq_khz = cpu_freq_khz;
+    }
+    max_gpu_freq_khz = std::max(max_gpu_freq_khz, state.gpu_cur_freq_khz);
+    max_temperature_mc = std::max(max_temperature_mc, state.max_temperature_mc);
+  }
+
+  TFLITE_LOG(INFO) << "Device state during the benchmark (" << samples.size()
+                   << " samples):";
+  if (initial.MaxCpuMaxFreqKhz() != DeviceState::kValueNotSet) {
+    TFLITE_LOG(INFO) << "- CPU frequency (MHz): cap at start="
+                     << initial.MaxCpuMaxFreqKhz() / 1000
+                     << " cap at end=" << last.MaxCpuMaxFreqKhz() / 1000
+                     << " lowest of the fastest core="
+                     << min_cpu_freq_khz / 1000;
+  }
+  if (max_gpu_freq_khz != DeviceState::kValueNotSet) {
+    TFLITE_LOG(INFO) << "- GPU frequency (MHz): cap at start="
+                     << initial.gpu_max_freq_khz / 1000
+                     << " cap at end=" << last.gpu_max_freq_khz / 1000
+                     << " highest=" << max_gpu_freq_khz / 1000;
+  }
+  if (max_temperature_mc != DeviceState::kValueNotSet) {
+    TFLITE_LOG(INFO) << "- Temperature (Celsius): start="
+                     << initial.max_temperature_mc / 1000.0
+                     << " end=" << last.max_temperature_mc / 1000.0
+                     << " highest=" << max_temperature_mc / 1000.0;
+  }
+  if (throttling_start_us_ >= 0) {
+    TFLITE_LOG(WARN) << "Throttling detected " << throttling_start_us_ / 1e6
+                     << " seconds after the start of the regular runs: the "
+                        "results of the runs after it aren't comparable to "
+                        "the ones of an unthrottled device.";
+  } else {
+    TFLITE_LOG(INFO) << "No throttling detected.";
+  }
+
+  if (normalized_inference_time_us_.count() > 0) {
+    std::stringstream stream;
+    normalized_inference_time_us_.OutputToStream(&stream);
+    TFLITE_LOG(INFO)
+        << "Inference timings normalized to the CPU frequency cap at start "
+           "in us: "
+        << stream.str();
+  }
+
+  if (throughput_windows_.empty()) return;
+  TFLITE_LOG(INFO) << "Sustained throughput over " << throughput_window_secs_
+                   << " seconds windows:";
+  const int64_t origin_us = throughput_windows_.front().start_us;
+  for (const ThroughputWindow& window : throughput_windows_) {
+    std::stringstream stream;
+    stream << std::fixed << std::setprecision(1) << "["
+           << (window.start_us - origin_us) / 1e6 << "s, "
+           << (window.end_us - origin_us) / 1e6
+           << "s): " << window.runs_per_second() << " runs/s";
+    if (window.num_runs > 0) {
+      stream << ", avg latency=" << window.total_latency_us / window.num_runs
+             << " us";
+    }
+    if (window.avg_cpu_freq_khz != DeviceState::kValueNotSet) {
+      stream << ", CPU=" << window.avg_cpu_freq_khz / 1000 << " MHz";
+    }
+    if (window.max_temperature_mc != DeviceState::kValueNotSet) {
+      stream << ", " << window.max_temperature_mc / 1000.0 << " Celsius";
+    }
+    TFLITE_LOG(INFO) << stream.str();
+  }
+}
+
 std::vector<Flag> BenchmarkModel::GetFlags() {
   return {
       CreateFlag<int32_t>(
@@ -171,7 +409,31 @@ std::vector<Flag> BenchmarkModel::GetFlags() {
       CreateFlag<int32_t>("memory_footprint_check_interval_ms", &params_,
                           "The interval in millisecond between two consecutive "
                           "memory footprint checks. This is only used when "
-                          "--report_peak_memory_footprint is set to true.")};
+                          "--report_peak_memory_footprint is set to true."),
+      CreateFlag<bool>(
+          "report_device_state", &params_,
+          "Report the CPU and GPU frequencies and the temperature of the "
+          "device by periodically checking them during the runs, whether the "
+          "device throttled, the latency normalized to the CPU frequency and "
+          "the sustained throughput over --throughput_window_secs windows. "
+          "Internally, a separate thread will be spawned for this periodic "
+          "check."),
+      CreateFlag<int32_t>("device_state_check_interval_ms", &params_,
+                          "The interval in millisecond between two consecutive "
+                          "device state checks."),
+      CreateFlag<float>("throughput_window_secs", &params_,
+                        "The duration in seconds of the windows the sustained "
+                        "throughput is reported over when "
+                        "--report_device_state is set to true."),
+      CreateFlag<float>(
+          "cooldown_temperature", &params_,
+          "If positive, wait before the warmup runs until the highest "
+          "temperature of the thermal zones of the device is at most this "
+          "many degrees Celsius, so that consecutive benchmarks start from "
+          "the same thermal state."),
+      CreateFlag<float>("cooldown_max_secs", &params_,
+                        "The maximum number of seconds to wait for the device "
+                        "to cool down to --cooldown_temperature.")};
 }
 
 void BenchmarkModel::LogParams() {
@@ -198,6 +460,17 @@ void BenchmarkModel::LogParams() {
                       "Report the peak memory footprint", verbose);
   LOG_BENCHMARK_PARAM(int32_t, "memory_footprint_check_interval_ms",
                       "Memory footprint check interval (ms)", verbose);
+  LOG_BENCHMARK_PARAM(bool, "report_device_state",
+                      "Report the device frequencies and thermal state",
+                      verbose);
+  LOG_BENCHMARK_PARAM(int32_t, "device_state_check_interval_ms",
+                      "Device state check interval (ms)", verbose);
+  LOG_BENCHMARK_PARAM(float, "throughput_window_secs",
+                      "Sustained throughput window (seconds)", verbose);
+  LOG_BENCHMARK_PARAM(float, "cooldown_temperature",
+                      "Cooldown temperature (Celsius)", verbose);
+  LOG_BENCHMARK_PARAM(float, "cooldown_max_secs",
+                      "Max cooldown duration (seconds)", verbose);
 }
 
 TfLiteStatus BenchmarkModel::PrepareInputData() { return kTfLiteOk; }
@@ -268,6 +541,21 @@ TfLiteStatus BenchmarkModel::ValidateParams() {
                            kMemoryCheckIntervalMs);
     }
   }
+  const int32_t device_state_interval =
+      params_.Get<int32_t>("device_state_check_interval_ms");
+  if (device_state_interval <= 0) {
+    TFLITE_LOG(WARN) << "--device_state_check_interval_ms is set to "
+                     << device_state_interval
+                     << " (ms), This value is invalid, and it will be set to "
+                        "the default value "
+                     << kDeviceStateCheckIntervalMs << " (ms).";
+    params_.Set<int32_t>("device_state_check_interval_ms",
+                         kDeviceStateCheckIntervalMs);
+  }
+  if (params_.Get<float>("throughput_window_secs") <= 0) {
+    TFLITE_LOG(ERROR) << "--throughput_window_secs must be positive.";
+    return kTfLiteError;
+  }
   return kTfLiteOk;
 }
 
@@ -311,12 +599,38 @@ TfLiteStatus BenchmarkModel::Run() {
     params_.Set("min_secs", -1.0f);
   }
 
+  auto device_state_monitor = MayCreateDeviceStateMonitor();
+  const float cooldown_temperature = params_.Get<float>("cooldown_temperature");
+  if (device_state_monitor != nullptr && cooldown_temperature > 0) {
+    const float cooldown_max_secs = params_.Get<float>("cooldown_max_secs");
+    TFLITE_LOG(INFO) << "Waiting for the device to cool down to "
+                     << cooldown_temperature << " Celsius.";
+    if (!device_state_monitor->WaitForCooldown(
+            static_cast<int64_t>(cooldown_temperature * 1000),
+            absl::Seconds(cooldown_max_secs))) {
+      TFLITE_LOG(WARN) << "The device didn't cool down to "
+                       << cooldown_temperature << " Celsius in "
+                       << cooldown_max_secs << " seconds.";
+    }
+  }
+  // The device state listener only lives through this benchmark.
+  const int num_listeners = NumListeners();
+  std::unique_ptr<DeviceStateListener> device_state_listener;
+  if (device_state_monitor != nullptr &&
+      params_.Get<bool>("report_device_state")) {
+    device_state_listener = std::make_unique<DeviceStateListener>(
+        device_state_monitor.get(),
+        params_.Get<float>("throughput_window_secs"));
+    AddListener(device_state_listener.get());
+  }
+
   listeners_.OnBenchmarkStart(params_);
   Stat<int64_t> warmup_time_us =
       Run(params_.Get<int32_t>("warmup_runs"),
           params_.Get<float>("warmup_min_secs"), params_.Get<float>("max_secs"),
           WARMUP, &status);
   if (status != kTfLiteOk) {
+    RemoveListeners(num_listeners);
     return status;
   }
 
@@ -335,6 +649,7 @@ TfLiteStatus BenchmarkModel::Run() {
   listeners_.OnBenchmarkEnd({model_size_mb, startup_latency_us, input_bytes,
                              warmup_time_us, inference_time_us, init_mem_usage,
                              overall_mem_usage, peak_mem_mb});
+  RemoveListeners(num_listeners);
   return status;
 }
 
@@ -373,5 +688,15 @@ BenchmarkModel::MayCreateMemoryUsageMonitor() const {
       params_.Get<int32_t>("memory_footprint_check_interval_ms"));
 }
 
+std::unique_ptr<profiling::DeviceStateMonitor>
+BenchmarkModel::MayCreateDeviceStateMonitor() const {
+  if (!params_.Get<bool>("report_device_state") &&
+      params_.Get<float>("cooldown_temperature") <= 0) {
+    return nullptr;
+  }
+  return std::make_unique<profiling::DeviceStateMonitor>(
+      params_.Get<int32_t>("device_state_check_interval_ms"));
+}
+
 }  // namespace benchmark
 }  // namespace tflite
@@ -19,6 +19,7 @@ limitations under the License.
 #include <cmath>
 #include <cstdint>
 #include <limits>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <unordered_set>
@@ -27,6 +28,7 @@ limitations under the License.
 
 #include "tensorflow/core/util/stats_calculator.h"
 #include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/profiling/device_state_monitor.h"
 #include "tensorflow/lite/profiling/memory_info.h"
 #include "tensorflow/lite/profiling/memory_usage_monitor.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_params.h"
@@ -166,6 +168,77 @@ class BenchmarkLoggingListener : public BenchmarkListener {
   void OnBenchmarkEnd(const BenchmarkResults& results) override;
 };
 
+// Benchmark listener that logs the frequencies and the thermal state of the
+// device sampled by a DeviceStateMonitor during the runs: whether the device
+// throttled, the latencies of the regular runs normalized to the CPU frequency
+// cap at the start, and the throughput over consecutive windows of time, i.e.
+// the sustained throughput as the device heats up.
+class DeviceStateListener : public BenchmarkListener {
+ public:
+  // The regular runs and the device state over a window of time.
+  struct ThroughputWindow {
+    int64_t start_us = 0;
+    int64_t end_us = 0;
+    int num_runs = 0;
+    int64_t total_latency_us = 0;
+    // The average of the highest current CPU frequencies, in kHz, and the
+    // highest temperature sampled in the window, or kValueNotSet.
+    int64_t avg_cpu_freq_khz = profiling::DeviceState::kValueNotSet;
+    int64_t max_temperature_mc = profiling::DeviceState::kValueNotSet;
+
+    double runs_per_second() const {
+      return end_us > start_us ? num_runs * 1e6 / (end_us - start_us) : 0.0;
+    }
+  };
+
+  // Doesn't own 'monitor', which is started and stopped by the listener.
+  DeviceStateListener(profiling::DeviceStateMonitor* monitor,
+                      float throughput_window_secs)
+      : monitor_(monitor), throughput_window_secs_(throughput_window_secs) {}
+
+  void OnBenchmarkStart(const BenchmarkParams& params) override;
+  void OnSingleRunStart(RunType run_type) override;
+  void OnSingleRunEnd() override;
+  void OnBenchmarkEnd(const BenchmarkResults& results) override;
+
+  // The results of the last benchmark, available once it ended.
+  //
+  // The time the frequency cap of the CPUs or of the GPU was first lowered
+  // below the one at the start, relative to the first regular run, or -1 when
+  // the device didn't throttle.
+  int64_t throttling_start_us() const { return throttling_start_us_; }
+  // The latency of each regular run scaled by the ratio of the CPU frequency
+  // during the run to the CPU frequency cap at the start, i.e. an estimate of
+  // the latency of the run at the frequency it would have run at without the
+  // frequency scaling and the throttling.
+  const tensorflow::Stat<int64_t>& normalized_inference_time_us() const {
+    return normalized_inference_time_us_;
+  }
+  const std::vector<ThroughputWindow>& throughput_windows() const {
+    return throughput_windows_;
+  }
+
+ private:
+  struct RunTiming {
+    int64_t start_us;
+    int64_t end_us;
+  };
+
+  void ComputeResults(const std::vector<profiling::DeviceState>& samples);
+  void LogResults(const std::vector<profiling::DeviceState>& samples) const;
+
+  profiling::DeviceStateMonitor* const monitor_;
+  const float throughput_window_secs_;
+
+  bool in_regular_run_ = false;
+  int64_t run_start_us_ = 0;
+  std::vector<RunTiming> regular_runs_;
+
+  int64_t throttling_start_us_ = -1;
+  tensorflow::Stat<int64_t> normalized_inference_time_us_;
+  std::vector<ThroughputWindow> throughput_windows_;
+};
+
 template <typename T>
 Flag CreateFlag(const char* name, BenchmarkParams* params,
                 const std::string& usage) {
@@ -230,6 +303,11 @@ class BenchmarkModel {
   virtual std::unique_ptr<profiling::memory::MemoryUsageMonitor>
   MayCreateMemoryUsageMonitor() const;
 
+  // Create a DeviceStateMonitor to report the device state during the runs or
+  // to wait for the device to cool down before them if specified.
+  virtual std::unique_ptr<profiling::DeviceStateMonitor>
+  MayCreateDeviceStateMonitor() const;
+
   BenchmarkParams params_;
   BenchmarkListeners listeners_;
 };
@@ -0,0 +1,367 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/tools/benchmark/benchmark_multi_model.h"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/core/c/c_api_types.h"
+#include "tensorflow/lite/profiling/memory_info.h"
+#include "tensorflow/lite/profiling/memory_usage_monitor.h"
+#include "tensorflow/lite/profiling/time.h"
+#include "tensorflow/lite/tools/benchmark/benchmark_params.h"
+#include "tensorflow/lite/tools/command_line_flags.h"
+#include "tensorflow/lite/tools/logging.h"
+
+namespace tflite {
+namespace benchmark {
+namespace {
+
+constexpr int kMemoryCheckIntervalMs = 50;
+
+// Splits 'str' into its entries separated by 'delim', skipping the empty ones.
+std::vector<std::string> Split(const std::string& str, char delim) {
+  std::vector<std::string> entries;
+  std::istringstream input(str);
+  for (std::string entry; std::getline(input, entry, delim);) {
+    if (!entry.empty()) entries.push_back(entry);
+  }
+  return entries;
+}
+
+// Sets the nice value of the calling thread to 'priority'.
+void SetThreadPriority(int32_t priority) {
+#ifdef __linux__
+  // On Linux, the nice value is a per-thread attribute.
+  const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+  if (setpriority(PRIO_PROCESS, tid, priority) != 0) {
+    TFLITE_LOG(WARN) << "Failed to set the priority of the thread to "
+                     << priority << ": " << std::strerror(errno)
+                     << ". Lowering the nice value requires privileges.";
+  }
+#else
+  TFLITE_LOG(WARN) << "Setting the priority of the benchmark threads is only "
+                      "supported on Linux.";
+#endif  // __linux__
+}
+
+}  // namespace
+
+void ConcurrentRunStatsRecorder::OnBenchmarkStart(
+    const BenchmarkParams& params) {
+  started_ = true;
+  const float run_frequency = params.Get<float>("run_frequency");
+  period_us_ = run_frequency > 0 ? 1e6 / run_frequency : -1.0;
+  if (on_benchmark_start_) on_benchmark_start_();
+}
+
+void ConcurrentRunStatsRecorder::OnSingleRunStart(RunType run_type) {
+  in_regular_run_ = run_type == REGULAR;
+  run_start_us_ = profiling::time::NowMicros();
+  if (in_regular_run_ && first_regular_run_start_us_ < 0) {
+    first_regular_run_start_us_ = run_start_us_;
+  }
+}
+
+void ConcurrentRunStatsRecorder::OnSingleRunEnd() {
+  if (!in_regular_run_) return;
+  const int64_t end_us = profiling::time::NowMicros();
+  latencies_us_.push_back(end_us - run_start_us_);
+  if (period_us_ > 0) {
+    // The n-th regular run is due by the end of the n-th period.
+    const double deadline_us = first_regular_run_start_us_ +
+                               latencies_us_.size() * period_us_;
+    if (end_us > deadline_us) ++num_missed_deadlines_;
+  }
+}
+
+void ConcurrentRunStatsRecorder::OnBenchmarkEnd(
+    const BenchmarkResults& results) {
+  completed_ = true;
+  results_ = results;
+  std::sort(latencies_us_.begin(), latencies_us_.end());
+}
+
+int64_t ConcurrentRunStatsRecorder::LatencyPercentileUs(
+    double percentile) const {
+  if (latencies_us_.empty()) return 0;
+  // The nearest-rank percentile.
+  const double rank = std::ceil(percentile / 100.0 * latencies_us_.size());
+  const size_t index = std::min(static_cast<size_t>(std::max(rank, 1.0)) - 1,
+                                latencies_us_.size() - 1);
+  return latencies_us_[index];
+}
+
+BenchmarkMultiModel::BenchmarkMultiModel(ModelFactory model_factory)
+    : params_(DefaultParams()),
+      model_factory_(std::move(model_factory)),
+      peak_mem_mb_(
+          profiling::memory::MemoryUsageMonitor::kInvalidMemUsageMB) {}
+
+BenchmarkParams BenchmarkMultiModel::DefaultParams() {
+  BenchmarkParams params;
+  params.AddParam("models", BenchmarkParam::Create<std::string>(""));
+  params.AddParam("report_peak_memory_footprint",
+                  BenchmarkParam::Create<bool>(false));
+  params.AddParam("memory_footprint_check_interval_ms",
+                  BenchmarkParam::Create<int32_t>(kMemoryCheckIntervalMs));
+  return params;
+}
+
+std::vector<Flag> BenchmarkMultiModel::GetFlags() {
+  return {
+      CreateFlag<std::string>(
+          "models", &params_,
+          "A semicolon-separated list of the models to benchmark concurrently, "
+          "each given as a space-separated list of the benchmark flags of the "
+          "model, e.g. '--graph=a.tflite --run_frequency=30 --priority=-5;"
+          "--graph=b.tflite --use_gpu=true'. --priority sets the nice value "
+          "of the thread running the model. The flags not given to any model "
+          "apply to all of them."),
+      CreateFlag<bool>(
+          "report_peak_memory_footprint", &params_,
+          "Report the peak memory footprint of all the models by periodically "
+          "checking the memory footprint. Internally, a separate thread will "
+          "be spawned for this periodic check. Therefore, the performance "
+          "benchmark result could be affected."),
+      CreateFlag<int32_t>("memory_footprint_check_interval_ms", &params_,
+                          "The interval in millisecond between two consecutive "
+                          "memory footprint checks. This is only used when "
+                          "--report_peak_memory_footprint is set to true."),
+  };
+}
+
+TfLiteStatus BenchmarkMultiModel::ParseFlags(int* argc, char** argv) {
+  auto flag_list = GetFlags();
+  const bool parse_result =
+      Flags::Parse(argc, const_cast<const char**>(argv), flag_list);
+  if (!parse_result) {
+    std::string usage = Flags::Usage(argv[0], flag_list);
+    TFLITE_LOG(ERROR) << usage;
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+BenchmarkMultiModel::Model* BenchmarkMultiModel::CreateModel(
+    int32_t priority) {
+  models_.emplace_back();
+  Model* model = &models_.back();
+  model->model = model_factory_();
+  model->stats = std::make_unique<ConcurrentRunStatsRecorder>(
+      [this]() { WaitForAllModels(); });
+  model->priority = priority;
+  model->model->AddListener(model->stats.get());
+  return model;
+}
+
+BenchmarkModel* BenchmarkMultiModel::AddModel(const BenchmarkParams& params,
+                                              int32_t priority) {
+  Model* model = CreateModel(priority);
+  model->model->mutable_params()->Set(params);
+  return model->model.get();
+}
+
+TfLiteStatus BenchmarkMultiModel::CreateModels(int argc, char** argv) {
+  const std::vector<std::string> model_flags =
+      Split(params_.Get<std::string>("models"), ';');
+  if (model_flags.empty()) {
+    TFLITE_LOG(ERROR) << "No model is given by --models.";
+    return kTfLiteError;
+  }
+
+  for (const std::string& flags : model_flags) {
+    // The flags of the model come first as the first occurrence of a flag
+    // takes precedence.
+    std::vector<std::string> args = {argv[0]};
+    for (std::string& flag : Split(flags, ' ')) args.push_back(std::move(flag));
+    for (int i = 1; i < argc; ++i) args.push_back(argv[i]);
+    std::vector<char*> model_argv;
+    for (std::string& arg : args) model_argv.push_back(&arg[0]);
+    int model_argc = model_argv.size();
+
+    int32_t priority = 0;
+    std::vector<Flag> priority_flag = {Flag::CreateFlag(
+        "priority", &priority,
+        "The nice value of the thread running the model.")};
+    if (!Flags::Parse(&model_argc,
+                      const_cast<const char**>(model_argv.data()),
+                      priority_flag)) {
+      TFLITE_LOG(ERROR) << "Cannot parse the flags of the model: '" << flags
+                        << "'.";
+      return kTfLiteError;
+    }
+
+    Model* model = CreateModel(priority);
+    if (TfLiteStatus status =
+            model->model->ParseFlags(&model_argc, model_argv.data());
+        status != kTfLiteOk) {
+      TFLITE_LOG(ERROR) << "Error while parsing the flags of the model: '"
+                        << flags << "'.";
+      return status;
+    }
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus BenchmarkMultiModel::Run(int argc, char** argv) {
+  // Parse flags that are supported by this particular binary first.
+  if (TfLiteStatus status = ParseFlags(&argc, argv); status != kTfLiteOk) {
+    TFLITE_LOG(ERROR) << "Error while parsing the flags for multi-model runs: "
+                      << status;
+    return status;
+  }
+  TF_LITE_ENSURE_STATUS(CreateModels(argc, argv));
+  return Run();
+}
+
+void BenchmarkMultiModel::WaitForAllModels() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  MarkModelReadyLocked();
+  all_models_ready_.wait(lock, [this]() { return num_pending_models_ == 0; });
+}
+
+void BenchmarkMultiModel::MarkModelReady() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  MarkModelReadyLocked();
+}
+
+void BenchmarkMultiModel::MarkModelReadyLocked() {
+  if (--num_pending_models_ != 0) return;
+  init_mem_usage_ = profiling::memory::GetMemoryUsage() - start_mem_usage_;
+  all_models_ready_.notify_all();
+}
+
+void BenchmarkMultiModel::RunModel(Model* model) {
+  if (model->priority != 0) SetThreadPriority(model->priority);
+  model->status = model->model->Run();
+  // The model failed before its first run, so the others don't wait for it.
+  if (!model->stats->started()) MarkModelReady();
+}
+
+TfLiteStatus BenchmarkMultiModel::Run() {
+  if (models_.empty()) {
+    TFLITE_LOG(ERROR) << "No model to benchmark.";
+    return kTfLiteError;
+  }
+
+  std::unique_ptr<profiling::memory::MemoryUsageMonitor> peak_memory_reporter;
+  if (params_.Get<bool>("report_peak_memory_footprint")) {
+    int32_t interval =
+        params_.Get<int32_t>("memory_footprint_check_interval_ms");
+    if (interval <= 0) interval = kMemoryCheckIntervalMs;
+    peak_memory_reporter =
+        std::make_unique<profiling::memory::MemoryUsageMonitor>(interval);
+    peak_memory_reporter->Start();
+  }
+
+  num_pending_models_ = models_.size();
+  start_mem_usage_ = profiling::memory::GetMemoryUsage();
+  std::vector<std::thread> threads;
+  threads.reserve(models_.size());
+  for (Model& model : models_) {
+    threads.emplace_back([this, &model]() { RunModel(&model); });
+  }
+  for (std::thread& thread : threads) thread.join();
+  overall_mem_usage_ = profiling::memory::GetMemoryUsage() - start_mem_usage_;
+
+  if (peak_memory_reporter != nullptr) {
+    peak_memory_reporter->Stop();
+    peak_mem_mb_ = peak_memory_reporter->GetPeakMemUsageInMB();
+  }
+
+  OutputStats();
+
+  TfLiteStatus status = kTfLiteOk;
+  for (const Model& model : models_) {
+    if (model.status != kTfLiteOk) status = model.status;
+  }
+  return status;
+}
+
+std::string BenchmarkMultiModel::ModelName(int index) const {
+  const BenchmarkParams& params = *models_[index].model->mutable_params();
+  for (const char* name : {"benchmark_name", "graph"}) {
+    if (params.HasParam(name) && !params.Get<std::string>(name).empty()) {
+      return params.Get<std::string>(name);
+    }
+  }
+  return "model #" + std::to_string(index);
+}
+
+void BenchmarkMultiModel::OutputStats() {
+  // Make a 80-character-long header.
+  TFLITE_LOG(INFO) << "\n==================Summary of Concurrent Runs of All "
+                      "Models==================";
+  for (int i = 0; i < NumModels(); ++i) {
+    const ConcurrentRunStatsRecorder& stats = *models_[i].stats;
+    std::stringstream stream;
+    stream << ModelName(i) << ": ";
+    if (!stats.completed()) {
+      stream << "failed!";
+      TFLITE_LOG(INFO) << stream.str();
+      continue;
+    }
+    stats.results().inference_time_us().OutputToStream(&stream);
+    stream << " p50=" << stats.LatencyPercentileUs(50)
+           << " p90=" << stats.LatencyPercentileUs(90)
+           << " p99=" << stats.LatencyPercentileUs(99);
+    if (stats.has_deadlines()) {
+      const size_t num_runs = stats.latencies_us().size();
+      stream << " missed_deadlines=" << stats.num_missed_deadlines() << "/"
+             << num_runs;
+      if (num_runs > 0) {
+        stream << " (" << std::fixed << std::setprecision(1)
+               << 100.0 * stats.num_missed_deadlines() / num_runs << "%)";
+      }
+    }
+    TFLITE_LOG(INFO) << stream.str();
+  }
+
+  if (!init_mem_usage_.IsSupported()) return;
+  TFLITE_LOG(INFO)
+      << "Note: as the benchmark tool itself affects memory footprint, the "
+         "following is only APPROXIMATE to the actual memory footprint of the "
+         "models at runtime. Take the information at your discretion.";
+  TFLITE_LOG(INFO) << "Memory footprint delta of all models from the start of "
+                      "the runs (MB): "
+                   << "init=" << init_mem_usage_.mem_footprint_kb / 1024.0
+                   << " overall="
+                   << overall_mem_usage_.mem_footprint_kb / 1024.0;
+  if (peak_mem_mb_ > 0) {
+    TFLITE_LOG(INFO)
+        << "Overall peak memory footprint (MB) via periodic monitoring: "
+        << peak_mem_mb_;
+  }
+}
+
+}  // namespace benchmark
+}  // namespace tflite
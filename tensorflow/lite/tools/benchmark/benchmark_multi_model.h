@@ -0,0 +1,172 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_TOOLS_BENCHMARK_BENCHMARK_MULTI_MODEL_H_
+#define TENSORFLOW_LITE_TOOLS_BENCHMARK_BENCHMARK_MULTI_MODEL_H_
+
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/core/c/c_api_types.h"
+#include "tensorflow/lite/profiling/memory_info.h"
+#include "tensorflow/lite/tools/benchmark/benchmark_model.h"
+#include "tensorflow/lite/tools/benchmark/benchmark_params.h"
+
+namespace tflite {
+namespace benchmark {
+
+// Records the latencies of the regular runs of one of the models benchmarked
+// by 'BenchmarkMultiModel', and the runs that missed their deadline, i.e. that
+// ended after the end of their period in the schedule of a model benchmarked
+// at a fixed --run_frequency.
+class ConcurrentRunStatsRecorder : public BenchmarkListener {
+ public:
+  // 'on_benchmark_start' is invoked once the model is initialized, right
+  // before its first run.
+  explicit ConcurrentRunStatsRecorder(
+      std::function<void()> on_benchmark_start = nullptr)
+      : on_benchmark_start_(std::move(on_benchmark_start)) {}
+
+  void OnBenchmarkStart(const BenchmarkParams& params) override;
+  void OnSingleRunStart(RunType run_type) override;
+  void OnSingleRunEnd() override;
+  void OnBenchmarkEnd(const BenchmarkResults& results) override;
+
+  bool started() const { return started_; }
+  bool completed() const { return completed_; }
+  const BenchmarkResults& results() const { return results_; }
+  // The latencies of the regular runs in microseconds, in increasing order
+  // once the benchmark completed.
+  const std::vector<int64_t>& latencies_us() const { return latencies_us_; }
+  // Returns the latency under which 'percentile' percent of the regular runs
+  // ended, or 0 if there was none.
+  int64_t LatencyPercentileUs(double percentile) const;
+  // The number of regular runs that missed their deadline. Always 0 when the
+  // model isn't benchmarked at a fixed --run_frequency.
+  int64_t num_missed_deadlines() const { return num_missed_deadlines_; }
+  bool has_deadlines() const { return period_us_ > 0; }
+
+ private:
+  std::function<void()> on_benchmark_start_;
+  bool started_ = false;
+  bool completed_ = false;
+  BenchmarkResults results_;
+
+  double period_us_ = -1.0;
+  bool in_regular_run_ = false;
+  int64_t run_start_us_ = 0;
+  // The start of the first regular run, which the fixed-rate schedule of the
+  // regular runs starts from.
+  int64_t first_regular_run_start_us_ = -1;
+  std::vector<int64_t> latencies_us_;
+  int64_t num_missed_deadlines_ = 0;
+};
+
+// Benchmarks several models concurrently, each on its own thread with its own
+// benchmark parameters, e.g. the graph, the delegate, the --run_frequency and
+// the priority of the thread. As the models contend for the CPU, the
+// accelerators and the memory bandwidth, this reports the latency distribution
+// and the missed deadlines of each model, and the memory footprint of all of
+// them, which a single-model benchmark can't tell about a device running them
+// together.
+//
+// All the models are initialized before any of them is run, so that they run
+// concurrently from their first run.
+class BenchmarkMultiModel {
+ public:
+  // Creates the object that drives the benchmark of one of the models.
+  using ModelFactory = std::function<std::unique_ptr<BenchmarkModel>()>;
+
+  explicit BenchmarkMultiModel(ModelFactory model_factory);
+
+  virtual ~BenchmarkMultiModel() {}
+
+  // Runs the benchmark of the models of --models, with the flags in 'argv' not
+  // parsed by this class applied to all of them.
+  TfLiteStatus Run(int argc, char** argv);
+
+  // Runs the benchmark of the models added by 'AddModel'.
+  TfLiteStatus Run();
+
+  // Adds a model to benchmark with 'params', on a thread of 'priority'.
+  // Returns the object driving the benchmark of the model, which is owned by
+  // this object.
+  BenchmarkModel* AddModel(const BenchmarkParams& params, int32_t priority = 0);
+
+  int NumModels() const { return models_.size(); }
+  const ConcurrentRunStatsRecorder& GetModelStats(int index) const {
+    return *models_[index].stats;
+  }
+
+  virtual void OutputStats();
+
+ protected:
+  static BenchmarkParams DefaultParams();
+
+  // Unparsable flags will remain in 'argv' in the original order and 'argc'
+  // will be updated accordingly.
+  TfLiteStatus ParseFlags(int* argc, char** argv);
+  virtual std::vector<Flag> GetFlags();
+
+  // Creates one model for each entry of --models, with the flags of the entry
+  // and the ones in 'argv', the former taking precedence.
+  TfLiteStatus CreateModels(int argc, char** argv);
+
+  virtual std::string ModelName(int index) const;
+
+  BenchmarkParams params_;
+
+ private:
+  struct Model {
+    std::unique_ptr<BenchmarkModel> model;
+    std::unique_ptr<ConcurrentRunStatsRecorder> stats;
+    // The nice value of the thread running the model, or 0 to keep the one of
+    // the process.
+    int32_t priority = 0;
+    TfLiteStatus status = kTfLiteOk;
+  };
+
+  Model* CreateModel(int32_t priority);
+  void RunModel(Model* model);
+
+  // Blocks until all the models are initialized or failed to.
+  void WaitForAllModels();
+  // Marks a model as initialized or failed to, unblocking 'WaitForAllModels'
+  // if it is the last one.
+  void MarkModelReady();
+  void MarkModelReadyLocked();
+
+  ModelFactory model_factory_;
+  std::vector<Model> models_;
+
+  std::mutex mutex_;
+  std::condition_variable all_models_ready_;
+  int num_pending_models_ = 0;
+  profiling::memory::MemoryUsage init_mem_usage_;
+  profiling::memory::MemoryUsage start_mem_usage_;
+  profiling::memory::MemoryUsage overall_mem_usage_;
+  float peak_mem_mb_ = -1.0f;
+};
+
+}  // namespace benchmark
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_TOOLS_BENCHMARK_BENCHMARK_MULTI_MODEL_H_
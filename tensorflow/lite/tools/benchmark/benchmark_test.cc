@@ -16,6 +16,7 @@ limitations under the License.
 #include <fcntl.h>
 #endif  // !defined(_WIN32)
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -31,8 +32,11 @@ limitations under the License.
 #include "tensorflow/lite/core/c/c_api_types.h"
 #include "tensorflow/lite/core/c/common.h"
 #include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/profiling/device_state_monitor.h"
+#include "tensorflow/lite/profiling/time.h"
 #include "tensorflow/lite/string_util.h"
 #include "tensorflow/lite/testing/util.h"
+#include "tensorflow/lite/tools/benchmark/benchmark_multi_model.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_performance_options.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_tflite_model.h"
 #include "tensorflow/lite/tools/command_line_flags.h"
@@ -462,6 +466,66 @@ class MaxDurationWorksTestListener : public BenchmarkListener {
   }
 };
 
+TEST(BenchmarkTest, DoesntCrashMultiModel) {
+  ASSERT_THAT(g_fp32_model_path, testing::NotNull());
+  ASSERT_THAT(g_int8_model_path, testing::NotNull());
+
+  BenchmarkMultiModel benchmark(
+      []() { return std::make_unique<BenchmarkTfLiteModel>(); });
+  BenchmarkParams fp32_params = CreateFp32Params();
+  fp32_params.Set<float>("run_frequency", 100.0f);
+  benchmark.AddModel(fp32_params);
+  BenchmarkParams int8_params = CreateInt8Params();
+  int8_params.Set<bool>("enable_op_profiling", true);
+  benchmark.AddModel(int8_params);
+  EXPECT_EQ(kTfLiteOk, benchmark.Run());
+
+  ASSERT_EQ(2, benchmark.NumModels());
+  for (int i = 0; i < benchmark.NumModels(); ++i) {
+    const ConcurrentRunStatsRecorder& stats = benchmark.GetModelStats(i);
+    EXPECT_TRUE(stats.completed());
+    const int64_t num_runs = stats.latencies_us().size();
+    EXPECT_EQ(stats.results().inference_time_us().count(), num_runs);
+    EXPECT_LE(stats.LatencyPercentileUs(50), stats.LatencyPercentileUs(99));
+    EXPECT_LE(stats.num_missed_deadlines(), num_runs);
+  }
+  EXPECT_TRUE(benchmark.GetModelStats(0).has_deadlines());
+  EXPECT_FALSE(benchmark.GetModelStats(1).has_deadlines());
+}
+
+TEST(BenchmarkTest, RunMultiModelWithFlags) {
+  ASSERT_THAT(g_fp32_model_path, testing::NotNull());
+  ASSERT_THAT(g_int8_model_path, testing::NotNull());
+
+  BenchmarkMultiModel benchmark(
+      []() { return std::make_unique<BenchmarkTfLiteModel>(); });
+  ScopedCommandlineArgs scoped_argv(
+      {"--models=--graph=" + *g_fp32_model_path +
+           " --run_frequency=50 --priority=1;--graph=" + *g_int8_model_path,
+       "--num_runs=2", "--min_secs=0.1"});
+  EXPECT_EQ(kTfLiteOk, benchmark.Run(scoped_argv.argc(), scoped_argv.argv()));
+
+  ASSERT_EQ(2, benchmark.NumModels());
+  EXPECT_TRUE(benchmark.GetModelStats(0).has_deadlines());
+  EXPECT_FALSE(benchmark.GetModelStats(1).has_deadlines());
+  EXPECT_GE(benchmark.GetModelStats(1).latencies_us().size(), 2u);
+}
+
+TEST(BenchmarkTest, MultiModelDoesntWaitForFailedModels) {
+  ASSERT_THAT(g_fp32_model_path, testing::NotNull());
+
+  BenchmarkMultiModel benchmark(
+      []() { return std::make_unique<BenchmarkTfLiteModel>(); });
+  BenchmarkParams invalid_params = CreateFp32Params();
+  invalid_params.Set<std::string>("graph", "dummy/path");
+  benchmark.AddModel(invalid_params);
+  benchmark.AddModel(CreateFp32Params());
+  EXPECT_EQ(kTfLiteError, benchmark.Run());
+
+  EXPECT_FALSE(benchmark.GetModelStats(0).completed());
+  EXPECT_TRUE(benchmark.GetModelStats(1).completed());
+}
+
 TEST(BenchmarkTest, MaxDurationWorks) {
   ASSERT_THAT(g_fp32_model_path, testing::NotNull());
   BenchmarkParams params = BenchmarkTfLiteModel::DefaultParams();
@@ -473,6 +537,66 @@ TEST(BenchmarkTest, MaxDurationWorks) {
   benchmark.Run();
 }
 
+// Reports a CPU whose frequency cap is lowered from 2 GHz to 1 GHz once
+// 'throttled' is set.
+class ThrottlingDeviceStateSampler
+    : public profiling::DeviceStateMonitor::Sampler {
+ public:
+  explicit ThrottlingDeviceStateSampler(const std::atomic<bool>* throttled)
+      : throttled_(throttled) {}
+  bool IsSupported() override { return true; }
+  profiling::DeviceState GetDeviceState() override {
+    profiling::DeviceState state;
+    state.timestamp_us = profiling::time::NowMicros();
+    const int64_t freq_khz = *throttled_ ? 1000000 : 2000000;
+    state.cpu_cur_freq_khz = {freq_khz};
+    state.cpu_max_freq_khz = {freq_khz};
+    state.max_temperature_mc = *throttled_ ? 80000 : 40000;
+    return state;
+  }
+
+ private:
+  const std::atomic<bool>* const throttled_;
+};
+
+TEST(BenchmarkTest, DeviceStateListenerDetectsThrottling) {
+  std::atomic<bool> throttled(false);
+  profiling::DeviceStateMonitor monitor(
+      /*sampling_interval_ms=*/1,
+      std::make_unique<ThrottlingDeviceStateSampler>(&throttled));
+  DeviceStateListener listener(&monitor, /*throughput_window_secs=*/0.02f);
+  listener.OnBenchmarkStart(BenchmarkParams());
+  for (int i = 0; i < 10; ++i) {
+    if (i == 5) {
+      throttled = true;
+      profiling::time::SleepForMicros(10000);
+    }
+    listener.OnSingleRunStart(REGULAR);
+    profiling::time::SleepForMicros(5000);
+    listener.OnSingleRunEnd();
+  }
+  listener.OnBenchmarkEnd(BenchmarkResults());
+
+  EXPECT_GT(listener.throttling_start_us(), 0);
+  const auto& normalized_time_us = listener.normalized_inference_time_us();
+  EXPECT_EQ(normalized_time_us.count(), 10);
+  // The throttled runs are normalized to about half their latency.
+  EXPECT_LT(normalized_time_us.min(), 4000);
+  EXPECT_GE(normalized_time_us.max(), 5000);
+
+  const auto& windows = listener.throughput_windows();
+  ASSERT_GE(windows.size(), 2);
+  int num_runs = 0;
+  for (const auto& window : windows) {
+    num_runs += window.num_runs;
+    EXPECT_LT(window.start_us, window.end_us);
+  }
+  EXPECT_EQ(num_runs, 10);
+  EXPECT_EQ(windows.front().max_temperature_mc, 40000);
+  EXPECT_EQ(windows.back().max_temperature_mc, 80000);
+  EXPECT_EQ(windows.back().avg_cpu_freq_khz, 1000000);
+}
+
 TEST(BenchmarkTest, ParametersArePopulatedWhenInputShapeIsNotSpecified) {
   ASSERT_THAT(g_fp32_model_path, testing::NotNull());
 
@@ -76,7 +76,8 @@ PYBIND11_MODULE(_pywrap_server_lib, m) {
                  server->SnapshotTaskProgresses(&snapshot_task_progresses);
              tensorflow::MaybeRaiseFromStatus(status);
              return snapshot_task_progresses;
-           });
+           })
+      .def("drain", &tensorflow::data::WorkerGrpcDataServer::Drain);
 
   m.def(
       "TF_DATA_NewDispatchServer",
@@ -1504,6 +1504,24 @@ class StaticVocabularyTableTest(BaseLookupTableTest):
     self.assertEqual(loaded.is_ref_counting(), is_anonymous)
 
 
+def _dense_hash_table_bucket_tag(key):
+  """The tag byte the DenseHashTable kernel keeps for an int64 `key`."""
+  mask = (1 << 64) - 1
+  return 0x80 | (((key & mask) * 0x9E3779B97F4A7C15) & mask) >> 57
+
+
+def _keys_sharing_bucket_and_tag(num_buckets, num_keys):
+  """Returns `num_keys` int64 keys with the same home bucket and tag."""
+  keys_by_tag = {}
+  key = 5
+  while True:
+    keys = keys_by_tag.setdefault(_dense_hash_table_bucket_tag(key), [])
+    keys.append(key)
+    if len(keys) == num_keys:
+      return keys
+    key += num_buckets
+
+
 @parameterized.named_parameters(
     (f"_{is_anonymous}", is_anonymous) for is_anonymous in [False, True])
 class DenseHashTableOpTest(test.TestCase):
@@ -2275,6 +2293,112 @@ class DenseHashTableOpTest(test.TestCase):
     result = self.evaluate(output)
     self.assertAllEqual([-1, 51, 52, 53, -1, 54, 55, 56, -1], result)
 
+  def testReprobeSameTag(self, is_anonymous):
+    if is_anonymous and not tf2.enabled():
+      self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
+    # The keys have the same home bucket and the same tag byte, so only the
+    # key comparison tells them apart.
+    a, b, c, d = _keys_sharing_bucket_and_tag(num_buckets=64, num_keys=4)
+    table = lookup_ops.DenseHashTable(
+        dtypes.int64,
+        dtypes.int64,
+        default_value=-1,
+        empty_key=0,
+        deleted_key=-1,
+        initial_num_buckets=64,
+        experimental_is_anonymous=is_anonymous)
+
+    self.evaluate(
+        table.insert(
+            constant_op.constant([a, b, c], dtypes.int64),
+            constant_op.constant([1, 2, 3], dtypes.int64)))
+    self.assertAllEqual(3, self.evaluate(table.size()))
+    self.assertAllEqual(
+        [1, 2, 3, -1],
+        self.evaluate(
+            table.lookup(constant_op.constant([a, b, c, d], dtypes.int64))))
+
+    # Updating a key doesn't take the bucket of another key with its tag.
+    self.evaluate(
+        table.insert(
+            constant_op.constant([c], dtypes.int64),
+            constant_op.constant([30], dtypes.int64)))
+    self.assertAllEqual(3, self.evaluate(table.size()))
+    self.assertAllEqual(
+        [1, 2, 30, -1],
+        self.evaluate(
+            table.lookup(constant_op.constant([a, b, c, d], dtypes.int64))))
+
+  def testRemoveKeepsReprobing(self, is_anonymous):
+    if is_anonymous and not tf2.enabled():
+      self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
+    a, b, c, d = _keys_sharing_bucket_and_tag(num_buckets=64, num_keys=4)
+    table = lookup_ops.DenseHashTable(
+        dtypes.int64,
+        dtypes.int64,
+        default_value=-1,
+        empty_key=0,
+        deleted_key=-1,
+        initial_num_buckets=64,
+        experimental_is_anonymous=is_anonymous)
+    self.evaluate(
+        table.insert(
+            constant_op.constant([a, b, c], dtypes.int64),
+            constant_op.constant([1, 2, 3], dtypes.int64)))
+
+    # Removing a missing key with the same tag removes nothing.
+    self.evaluate(table.remove(constant_op.constant([d], dtypes.int64)))
+    self.assertAllEqual(3, self.evaluate(table.size()))
+
+    # The keys probed past the removed one are still found.
+    self.evaluate(table.remove(constant_op.constant([a], dtypes.int64)))
+    self.assertAllEqual(2, self.evaluate(table.size()))
+    self.assertAllEqual(
+        [-1, 2, 3, -1],
+        self.evaluate(
+            table.lookup(constant_op.constant([a, b, c, d], dtypes.int64))))
+
+    # A new key reuses the deleted bucket, and c isn't inserted twice.
+    self.evaluate(
+        table.insert(
+            constant_op.constant([d, c], dtypes.int64),
+            constant_op.constant([4, 30], dtypes.int64)))
+    self.assertAllEqual(3, self.evaluate(table.size()))
+    self.assertAllEqual(
+        [-1, 2, 30, 4],
+        self.evaluate(
+            table.lookup(constant_op.constant([a, b, c, d], dtypes.int64))))
+    exported_keys, _ = self.evaluate(table.export())
+    self.assertAllEqual(64, len(exported_keys))
+    self.assertAllEqual([c], exported_keys[exported_keys == c])
+
+  def testGrowAfterRemove(self, is_anonymous):
+    if is_anonymous and not tf2.enabled():
+      self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
+    table = lookup_ops.DenseHashTable(
+        dtypes.int64,
+        dtypes.int64,
+        default_value=-1,
+        empty_key=0,
+        deleted_key=-1,
+        initial_num_buckets=4,
+        experimental_is_anonymous=is_anonymous)
+    expected = {}
+    for start in range(1, 2001, 250):
+      keys = np.arange(start, start + 250, dtype=np.int64) * 16
+      self.evaluate(table.insert(keys, keys + 1))
+      expected.update(zip(keys, keys + 1))
+      removed = keys[::3]
+      self.evaluate(table.remove(removed))
+      for key in removed:
+        del expected[key]
+      self.assertAllEqual(len(expected), self.evaluate(table.size()))
+
+    self.assertGreater(len(self.evaluate(table.export()[0])), 1024)
+    keys = np.arange(1, 2252, dtype=np.int64) * 16
+    self.assertAllEqual([expected.get(key, -1) for key in keys],
+                        self.evaluate(table.lookup(keys)))
+
   def testCustomEmptyKey(self, is_anonymous):
     if is_anonymous and not tf2.enabled():
       self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
@@ -110,6 +110,18 @@ class EinsumOpTest(test.TestCase):
     self._check('ab,ab->', (3, 4), (3, 4))
     self._check('abce,badf->abcd', (1, 2, 3, 4), (2, 1, 4, 3))
 
+  def testContractionOrder(self):
+    # The output is the transposed product of the operands.
+    self._check('ij,jk->ki', (2, 3), (3, 4))
+    self._check('bij,bjk->bki', (5, 2, 3), (5, 3, 4))
+    # The contract dimensions are in different orders in the operands.
+    self._check('abc,cbd->ad', (2, 3, 4), (4, 3, 5))
+    self._check('acb,cbd->ad', (2, 4, 3), (4, 3, 5))
+    self._check('cab,bcd->ad', (4, 2, 3), (3, 4, 5))
+    # The free dimensions are not sorted.
+    self._check('bac,cd->bad', (2, 3, 4), (4, 5))
+    self._check('bac,cd->dba', (2, 3, 4), (4, 5))
+
   def testRepeatedIndices(self):
     # Repeated indices.
     self._check('ijj,k->ik', (2, 3, 3), (4,))
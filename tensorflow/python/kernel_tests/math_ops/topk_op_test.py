@@ -167,6 +167,33 @@ class TopKTest(test.TestCase):
       values = -np.sort(-inputs, axis=1)[:, :k]
       self._validateTopK(inputs, k, values, indices)
 
+  def _testLongRowTopK(self, dtype, b):
+    # Rows long enough to be selected by radix select, with repeated values
+    # of both signs.
+    n = 1 << 17
+    inputs = np.random.randint(-100, 100, size=(b, n)).astype(dtype)
+    for k in [20, 500]:
+      indices = np.argsort(-inputs, axis=1, kind="mergesort")[:, :k]
+      values = -np.sort(-inputs, axis=1)[:, :k]
+      self._validateTopK(inputs, k, values, indices)
+      self._validateTopK(inputs, k, values, indices, sorted=False)
+
+  def testLongRowTopK(self):
+    for b in [1, 16]:
+      self._testLongRowTopK(np.float32, b)
+      self._testLongRowTopK(np.int32, b)
+
+  def testLongRowTopKWithNan(self):
+    n = 1 << 17
+    inputs = np.random.permutation(np.linspace(0, 1, n)).astype(np.float32)
+    inputs[7] = np.nan
+    inputs = inputs.reshape(1, n)
+    k = 20
+    with self.cached_session():
+      values, indices = self.evaluate(nn_ops.top_k(inputs, k))
+    self.assertEqual(values.shape, (1, k))
+    self.assertEqual(indices.shape, (1, k))
+
   def testTopAll(self):
     inputs = [[0.1, 0.3, 0.2, 0.4], [0.1, 0.3, 0.3, 0.2]]
     self._validateTopK(inputs, 4, [[0.4, 0.3, 0.2, 0.1], [0.3, 0.3, 0.2, 0.1]],
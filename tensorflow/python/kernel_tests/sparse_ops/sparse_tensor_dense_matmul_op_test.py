@@ -238,6 +238,29 @@ class SparseTensorDenseMatMulTest(test.TestCase):
     self._testLarge(np.complex64)
     self._testLarge(np.complex128)
 
+  # Tests products large enough to be computed in parallel on CPU.
+  def testManyNonzeros(self):
+    np.random.seed(127)  # Repeatable results
+    for np_dtype in [np.float16, np.float32, np.complex64]:
+      x = _maybe_complex(np.random.rand(2000, 300).astype(np_dtype))
+      x[np.abs(x) < 0.7] = 0
+      y = _maybe_complex(np.random.randn(300, 64).astype(np_dtype))
+      self._testMatmul(x, y, adjoint_a=False, adjoint_b=False)
+      self._testMatmul(x.transpose(), y, adjoint_a=True, adjoint_b=False)
+      self._testMatmul(x, y.transpose(), adjoint_a=False, adjoint_b=True)
+      self._testMatmul(
+          x.transpose(), y.transpose(), adjoint_a=True, adjoint_b=True)
+
+  def testInvalidIndicesWithManyNonzeros(self):
+    indices = np.array([[i // 300, i % 300] for i in range(60000)])
+    indices[-1] = [199, 300]
+    values = np.ones(60000, dtype=np.float32)
+    sparse_t = sparse_tensor.SparseTensor(indices, values, [200, 300])
+    dense_t = np.ones([300, 64], dtype=np.float32)
+    with self.assertRaisesOpError(
+        "k .300. from index.59999,1. out of bounds .>=300."):
+      self.evaluate(sparse_ops.sparse_tensor_dense_matmul(sparse_t, dense_t))
+
   # Tests random sized matrices.
   def testFloatRandom(self):
     np.random.seed(127)  # Repeatable results
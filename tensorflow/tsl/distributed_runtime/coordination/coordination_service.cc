@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/tsl/distributed_runtime/coordination/coordination_service.h"
 
 #include <algorithm>
+#include <array>
 #include <cstdint>
 #include <functional>
 #include <iterator>
@@ -61,6 +62,8 @@ constexpr absl::Duration kDevicePropagationTimeout = absl::Hours(1);
 constexpr int kDefaultHeartbeatTimeoutMs = 10 * 1000;  // 10 seconds
 constexpr int kServiceToClientTimeoutMs = 10 * 1000;   // 10 seconds
 constexpr size_t kOngoingBarriersSoftLimit = 20;
+// Number of independently locked shards of the key-value store.
+constexpr int kNumKeyValueShards = 16;
 constexpr char kHealthCheckThread[] = "CoordinationServiceHealthCheck";
 
 std::string GetTaskName(absl::string_view job_name, int task_id) {
@@ -132,6 +135,14 @@ class CoordinationServiceStandaloneImpl : public CoordinationServiceInterface {
                        const CoordinatedTask& task) override;
 
  private:
+  // Implements BarrierAsync(). Moves the callbacks of the barrier to
+  // `done_callbacks` instead of calling them if this call passes it.
+  void BarrierAsyncLocked(
+      const std::string& barrier_id, absl::Duration timeout,
+      const CoordinatedTask& task,
+      const std::vector<CoordinatedTask>& participating_tasks,
+      StatusCallback done, std::vector<StatusCallback>* done_callbacks)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(state_mu_);
   const DeviceInfo& ListClusterDevices() override
       TF_EXCLUSIVE_LOCKS_REQUIRED(state_mu_);
   uint64_t GetServiceIncarnation() override;
@@ -164,8 +175,12 @@ class CoordinationServiceStandaloneImpl : public CoordinationServiceInterface {
         tasks_at_barrier;
     std::vector<StatusCallback> done_callbacks;
   };
+  // Passes the barrier with `result`. The callbacks of the participating
+  // tasks are moved to `done_callbacks` if non-null, for the caller to call
+  // them once it releases `state_mu_`; otherwise they are called here.
   void PassBarrier(absl::string_view barrier_id, Status result,
-                   BarrierState* barrier)
+                   BarrierState* barrier,
+                   std::vector<StatusCallback>* done_callbacks = nullptr)
       TF_EXCLUSIVE_LOCKS_REQUIRED(state_mu_);
   // Check if participating tasks are specified correctly across barrier calls.
   bool ValidateTaskArgs(
@@ -245,11 +260,20 @@ class CoordinationServiceStandaloneImpl : public CoordinationServiceInterface {
       TF_GUARDED_BY(state_mu_);
   DeviceInfo cluster_devices_ TF_GUARDED_BY(state_mu_);
 
-  mutex kv_mu_;
-  // Ordered map to store config key-values
-  std::map<std::string, std::string> kv_store_ TF_GUARDED_BY(kv_mu_);
-  absl::flat_hash_map<std::string, std::vector<StatusOrValueCallback>> get_cb_
-      TF_GUARDED_BY(kv_mu_);
+  // The key-values are sharded by key, so that calls for different keys from
+  // many tasks do not contend on a single lock. Directory calls visit all the
+  // shards.
+  struct KeyValueShard {
+    mutex mu;
+    // Ordered map to store config key-values
+    std::map<std::string, std::string> kv_store TF_GUARDED_BY(mu);
+    absl::flat_hash_map<std::string, std::vector<StatusOrValueCallback>>
+        get_cb TF_GUARDED_BY(mu);
+  };
+  KeyValueShard& GetKeyValueShard(absl::string_view norm_key) {
+    return kv_shards_[absl::HashOf(norm_key) % kNumKeyValueShards];
+  }
+  std::array<KeyValueShard, kNumKeyValueShards> kv_shards_;
 
   mutex check_staleness_thread_shutdown_mu_;
   condition_variable check_staleness_thread_cv_;
@@ -377,10 +401,10 @@ void CoordinationServiceStandaloneImpl::StartCheckStaleness() {
               return;
             }
           }
-          // Heartbeat check.
-          Status status = OkStatus();
+          // Heartbeat check. The scan only reads the task states, so that it
+          // does not hold back the heartbeats of large clusters.
           {
-            mutex_lock l(state_mu_);
+            tf_shared_lock l(state_mu_);
             for (const auto& [task_name, task_state] : cluster_state_) {
               // Skip tasks that are not registered or in error state
               if (task_state->GetState() !=
@@ -393,14 +417,29 @@ void CoordinationServiceStandaloneImpl::StartCheckStaleness() {
                        << " stale?=" << is_stale;
               if (is_stale) {
                 stale_task_names.push_back(task_name);
-                status = MakeCoordinationError(errors::Unavailable(
-                    "Task ", task_name,
-                    " heartbeat timeout. This indicates that the remote task "
-                    "has failed, got preempted, or crashed unexpectedly."));
-                SetTaskError(task_name, status);
               }
             }
           }
+          if (!stale_task_names.empty()) {
+            mutex_lock l(state_mu_);
+            // Tasks may have changed state since the scan.
+            int num_stale_tasks = 0;
+            for (absl::string_view task_name : stale_task_names) {
+              auto it = cluster_state_.find(task_name);
+              if (it == cluster_state_.end() ||
+                  it->second->GetState() !=
+                      CoordinatedTaskState::TASKSTATE_CONNECTED) {
+                continue;
+              }
+              const Status status = MakeCoordinationError(errors::Unavailable(
+                  "Task ", task_name,
+                  " heartbeat timeout. This indicates that the remote task "
+                  "has failed, got preempted, or crashed unexpectedly."));
+              SetTaskError(task_name, status);
+              stale_task_names[num_stale_tasks++] = task_name;
+            }
+            stale_task_names.resize(num_stale_tasks);
+          }
           // Propagate heartbeat timeout errors to other connected tasks.
           if (!stale_task_names.empty()) {
             if (!has_service_to_client_connection) {
@@ -458,9 +497,13 @@ void CoordinationServiceStandaloneImpl::StartCheckStaleness() {
 }
 
 void CoordinationServiceStandaloneImpl::Stop(bool shut_staleness_thread) {
-  {
-    mutex_lock l(kv_mu_);
-    for (const auto& [key, get_kv_callbacks] : get_cb_) {
+  for (KeyValueShard& shard : kv_shards_) {
+    absl::flat_hash_map<std::string, std::vector<StatusOrValueCallback>> get_cb;
+    {
+      mutex_lock l(shard.mu);
+      std::swap(get_cb, shard.get_cb);
+    }
+    for (const auto& [key, get_kv_callbacks] : get_cb) {
       for (const auto& get_kv_callback : get_kv_callbacks) {
         get_kv_callback(errors::Cancelled(
             absl::StrCat("Coordination service is shutting down. Cancelling "
@@ -468,7 +511,6 @@ void CoordinationServiceStandaloneImpl::Stop(bool shut_staleness_thread) {
                          key)));
       }
     }
-    get_cb_.clear();
   }
   {
     mutex_lock l(state_mu_);
@@ -631,6 +673,8 @@ Status CoordinationServiceStandaloneImpl::DisconnectTask(
   return OkStatus();
 }
 
+// Also called by the callbacks of the device propagation barrier after the
+// lock is released: the devices are only written when it passes, before.
 const DeviceInfo& CoordinationServiceStandaloneImpl::ListClusterDevices() {
   return cluster_devices_;
 }
@@ -688,26 +732,29 @@ Status CoordinationServiceStandaloneImpl::RecordHeartbeat(
   const std::string& task_name = GetTaskName(task);
   Status s = OkStatus();
   {
-    mutex_lock l(state_mu_);
-    if (!cluster_state_.contains(task_name)) {
+    // Heartbeats only read the task state, and record their time under a lock
+    // of their own, so that the heartbeats of many tasks do not serialize.
+    tf_shared_lock l(state_mu_);
+    auto it = cluster_state_.find(task_name);
+    if (it == cluster_state_.end()) {
       return MakeCoordinationError(errors::InvalidArgument(
           "Unexpected task request with task_name=", task_name));
     }
-    if (!cluster_state_[task_name]->GetStatus().ok()) {
-      return cluster_state_[task_name]->GetStatus();
-    } else if (cluster_state_[task_name]->GetState() ==
+    TaskState* task_state = it->second.get();
+    if (!task_state->GetStatus().ok()) {
+      return task_state->GetStatus();
+    } else if (task_state->GetState() ==
                    CoordinatedTaskState::TASKSTATE_DISCONNECTED &&
                // We accept heartbeats for a short grace period to account for
                // the lag time between the service recording the state change
                // and the agent stopping heartbeats.
                Env::Default()->NowMicros() >
-                   cluster_state_[task_name]
-                       ->GetDisconnectedGracePeriodMicros()) {
+                   task_state->GetDisconnectedGracePeriodMicros()) {
       return MakeCoordinationError(errors::InvalidArgument(
           "Task with task_name=", task_name,
           " must be registered before sending heartbeat messages"));
     }
-    s = cluster_state_[task_name]->RecordHeartbeat(incarnation);
+    s = task_state->RecordHeartbeat(incarnation);
   }
 
   // Set and propagate any heartbeat errors.
@@ -851,18 +898,25 @@ Status CoordinationServiceStandaloneImpl::InsertKeyValue(
     const std::string& key, const std::string& value) {
   VLOG(3) << "InsertKeyValue(): " << key << ": " << value;
   const std::string& norm_key = NormalizeKey(key);
-  mutex_lock l(kv_mu_);
-  if (kv_store_.find(norm_key) != kv_store_.end()) {
-    return MakeCoordinationError(
-        errors::AlreadyExists("Config key ", key, " already exists."));
-  }
-  kv_store_.emplace(norm_key, value);
-  auto iter = get_cb_.find(norm_key);
-  if (iter != get_cb_.end()) {
-    for (const auto& cb : iter->second) {
-      cb(value);
+  KeyValueShard& shard = GetKeyValueShard(norm_key);
+  std::vector<StatusOrValueCallback> callbacks;
+  {
+    mutex_lock l(shard.mu);
+    if (shard.kv_store.find(norm_key) != shard.kv_store.end()) {
+      return MakeCoordinationError(
+          errors::AlreadyExists("Config key ", key, " already exists."));
     }
-    get_cb_.erase(iter);
+    shard.kv_store.emplace(norm_key, value);
+    auto iter = shard.get_cb.find(norm_key);
+    if (iter != shard.get_cb.end()) {
+      callbacks = std::move(iter->second);
+      shard.get_cb.erase(iter);
+    }
+  }
+  // The waiters, possibly every task of the cluster, are answered without
+  // holding the shard.
+  for (const auto& cb : callbacks) {
+    cb(value);
   }
   return OkStatus();
 }
@@ -871,27 +925,28 @@ void CoordinationServiceStandaloneImpl::GetKeyValueAsync(
     const std::string& key, StatusOrValueCallback done) {
   VLOG(3) << "GetKeyValue(): " << key;
   const std::string& norm_key = NormalizeKey(key);
-  mutex_lock l(kv_mu_);
-  const auto& iter = kv_store_.find(norm_key);
-  if (iter != kv_store_.end()) {
-    done(iter->second);
-    return;
-  }
-  auto cb_iter = get_cb_.find(norm_key);
-  if (cb_iter == get_cb_.end()) {
-    cb_iter =
-        get_cb_.emplace(norm_key, std::vector<StatusOrValueCallback>()).first;
+  KeyValueShard& shard = GetKeyValueShard(norm_key);
+  std::string value;
+  {
+    mutex_lock l(shard.mu);
+    const auto& iter = shard.kv_store.find(norm_key);
+    if (iter == shard.kv_store.end()) {
+      shard.get_cb[norm_key].emplace_back(std::move(done));
+      return;
+    }
+    value = iter->second;
   }
-  cb_iter->second.emplace_back(std::move(done));
+  done(value);
 }
 
 StatusOr<std::string> CoordinationServiceStandaloneImpl::TryGetKeyValue(
     const std::string& key) {
   VLOG(3) << "TryGetKeyValue(): " << key;
   const std::string& norm_key = NormalizeKey(key);
-  mutex_lock l(kv_mu_);
-  const auto& iter = kv_store_.find(norm_key);
-  if (iter == kv_store_.end()) {
+  KeyValueShard& shard = GetKeyValueShard(norm_key);
+  mutex_lock l(shard.mu);
+  const auto& iter = shard.kv_store.find(norm_key);
+  if (iter == shard.kv_store.end()) {
     return errors::NotFound("Config key ", key, " not found.");
   }
   return iter->second;
@@ -904,23 +959,30 @@ std::vector<KeyValueEntry> CoordinationServiceStandaloneImpl::GetKeyValueDir(
   const std::string norm_key = NormalizeKey(directory_key);
   const std::string dir = absl::StrCat(norm_key, "/");
 
-  mutex_lock l(kv_mu_);
-  // Find first key in ordered map that has the directory prefix.
-  auto begin = kv_store_.lower_bound(dir);
-  std::map<std::string, std::string>::iterator it;
-  // Iterate through key range that match directory prefix.
-  for (it = begin; it != kv_store_.end(); ++it) {
-    // Stop once the next key does not have the directory prefix. Since keys are
-    // ordered, none of the other keys would have a matching prefix.
-    if (std::mismatch(dir.begin(), dir.end(), it->first.begin()).first !=
-        dir.end()) {
-      break;
+  for (KeyValueShard& shard : kv_shards_) {
+    mutex_lock l(shard.mu);
+    // Find first key in ordered map that has the directory prefix.
+    auto begin = shard.kv_store.lower_bound(dir);
+    std::map<std::string, std::string>::iterator it;
+    // Iterate through key range that match directory prefix.
+    for (it = begin; it != shard.kv_store.end(); ++it) {
+      // Stop once the next key does not have the directory prefix. Since keys
+      // are ordered, none of the other keys would have a matching prefix.
+      if (std::mismatch(dir.begin(), dir.end(), it->first.begin()).first !=
+          dir.end()) {
+        break;
+      }
+      KeyValueEntry kv;
+      kv.set_key(it->first);
+      kv.set_value(it->second);
+      kvs_in_directory.push_back(kv);
     }
-    KeyValueEntry kv;
-    kv.set_key(it->first);
-    kv.set_value(it->second);
-    kvs_in_directory.push_back(kv);
   }
+  // Keys are listed in order, as from a single ordered map.
+  std::sort(kvs_in_directory.begin(), kvs_in_directory.end(),
+            [](const KeyValueEntry& a, const KeyValueEntry& b) {
+              return a.key() < b.key();
+            });
 
   return kvs_in_directory;
 }
@@ -929,20 +991,24 @@ Status CoordinationServiceStandaloneImpl::DeleteKeyValue(
     const std::string& key) {
   VLOG(3) << "DeleteKeyValue(): " << key;
   const std::string& norm_key = NormalizeKey(key);
-  mutex_lock l(kv_mu_);
   // Delete directory: find key range that match directory prefix
   const std::string& dir = strings::StrCat(norm_key, "/");
-  auto begin = kv_store_.lower_bound(dir);
-  std::map<std::string, std::string>::iterator end;
-  for (end = begin; end != kv_store_.end(); end++) {
-    if (std::mismatch(dir.begin(), dir.end(), end->first.begin()).first !=
-        dir.end())
-      break;
+  for (KeyValueShard& shard : kv_shards_) {
+    mutex_lock l(shard.mu);
+    auto begin = shard.kv_store.lower_bound(dir);
+    std::map<std::string, std::string>::iterator end;
+    for (end = begin; end != shard.kv_store.end(); end++) {
+      if (std::mismatch(dir.begin(), dir.end(), end->first.begin()).first !=
+          dir.end())
+        break;
+    }
+    shard.kv_store.erase(begin, end);
   }
-  kv_store_.erase(begin, end);
-  auto iter = kv_store_.find(norm_key);
-  if (iter != kv_store_.end()) {
-    kv_store_.erase(iter);
+  KeyValueShard& shard = GetKeyValueShard(norm_key);
+  mutex_lock l(shard.mu);
+  auto iter = shard.kv_store.find(norm_key);
+  if (iter != shard.kv_store.end()) {
+    shard.kv_store.erase(iter);
   }
   return OkStatus();
 }
@@ -969,7 +1035,24 @@ void CoordinationServiceStandaloneImpl::BarrierAsync(
     StatusCallback done) {
   VLOG(3) << "Task " << GetTaskName(task) << "invoked BarrierAsync("
           << barrier_id << ").";
-  mutex_lock l(state_mu_);
+  // The callbacks of a barrier passed by this call, called once the lock is
+  // released: all tasks of the cluster may wait on the barrier.
+  std::vector<StatusCallback> done_callbacks;
+  {
+    mutex_lock l(state_mu_);
+    BarrierAsyncLocked(barrier_id, timeout, task, participating_tasks,
+                       std::move(done), &done_callbacks);
+  }
+  for (const auto& callback : done_callbacks) {
+    callback(OkStatus());
+  }
+}
+
+void CoordinationServiceStandaloneImpl::BarrierAsyncLocked(
+    const std::string& barrier_id, absl::Duration timeout,
+    const CoordinatedTask& task,
+    const std::vector<CoordinatedTask>& participating_tasks,
+    StatusCallback done, std::vector<StatusCallback>* done_callbacks) {
   auto pair = barriers_.try_emplace(barrier_id);
   auto it = pair.first;
   bool inserted = pair.second;
@@ -1082,7 +1165,7 @@ void CoordinationServiceStandaloneImpl::BarrierAsync(
     --barrier->num_pending_tasks;
 
     if (barrier->num_pending_tasks == 0) {
-      PassBarrier(barrier_id, OkStatus(), barrier);
+      PassBarrier(barrier_id, OkStatus(), barrier, done_callbacks);
       return;
     }
   }
@@ -1116,7 +1199,8 @@ Status CoordinationServiceStandaloneImpl::CancelBarrier(
 
 // Mark barrier as passed.
 void CoordinationServiceStandaloneImpl::PassBarrier(
-    absl::string_view barrier_id, Status result, BarrierState* barrier) {
+    absl::string_view barrier_id, Status result, BarrierState* barrier,
+    std::vector<StatusCallback>* done_callbacks) {
   barrier->passed = true;
   barrier->result = result;
   VLOG(3) << "Barrier(" << barrier_id << ") has passed with status: " << result;
@@ -1164,8 +1248,12 @@ void CoordinationServiceStandaloneImpl::PassBarrier(
   // Note: barrier_id shouldn't be referenced after this line as its lifetime
   // may be tied to one of the callbacks.
   // Propagate results to participating tasks.
-  for (const auto& callback : barrier->done_callbacks) {
-    callback(result);
+  if (done_callbacks != nullptr) {
+    *done_callbacks = std::move(barrier->done_callbacks);
+  } else {
+    for (const auto& callback : barrier->done_callbacks) {
+      callback(result);
+    }
   }
   barrier->done_callbacks.clear();
 }
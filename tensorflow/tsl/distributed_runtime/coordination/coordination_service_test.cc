@@ -47,6 +47,7 @@ using ::testing::UnorderedElementsAre;
 
 using tensorflow::CoordinatedJob;
 using tensorflow::CoordinatedTask;
+using tensorflow::CoordinatedTaskState;
 using tensorflow::CoordinationServiceConfig;
 using tensorflow::DeviceInfo;
 using tensorflow::KeyValueEntry;
@@ -581,6 +582,29 @@ TEST_F(CoordinateTwoTasksTest, GetKeyValueDir_MultipleValuesInDirectory) {
                                            EqualsProto(kv_sub)));
 }
 
+TEST_F(CoordinateTwoTasksTest, GetKeyValueDir_ManyValues_ReturnsSortedList) {
+  EnableCoordinationService();
+  // Enough keys to be stored in different shards.
+  std::vector<KeyValueEntry> kvs;
+  for (int i = 0; i < 100; ++i) {
+    kvs.push_back(CreateKv(absl::StrCat("dir/path", 1000 + i),
+                           absl::StrCat("value", i)));
+  }
+  for (int i = kvs.size() - 1; i >= 0; --i) {
+    TF_ASSERT_OK(coord_service_->InsertKeyValue(kvs[i].key(), kvs[i].value()));
+  }
+
+  std::vector<KeyValueEntry> result = coord_service_->GetKeyValueDir("dir");
+
+  ASSERT_EQ(result.size(), kvs.size());
+  for (int i = 0; i < kvs.size(); ++i) {
+    EXPECT_THAT(result[i], EqualsProto(kvs[i]));
+  }
+
+  TF_ASSERT_OK(coord_service_->DeleteKeyValue("dir"));
+  EXPECT_THAT(coord_service_->GetKeyValueDir("dir"), IsEmpty());
+}
+
 TEST_F(CoordinateTwoTasksTest, GetKeyValueDir_Empty_ReturnsEmptyList) {
   EnableCoordinationService();
 
@@ -867,6 +891,29 @@ TEST_F(CoordinationBarrierTest, Barrier) {
   TF_EXPECT_OK(barrier_status_2);
 }
 
+TEST_F(CoordinationBarrierTest, BarrierCallbacksMayCallService) {
+  const std::string barrier_id = "barrier_id";
+  absl::Duration timeout = absl::Seconds(5);
+  std::vector<Status> barrier_statuses(3);
+  std::vector<CoordinatedTaskState> task_states(3);
+  for (int i = 0; i < 3; ++i) {
+    // The callbacks are called without the service holding its lock.
+    GetCoordinationService()->BarrierAsync(
+        barrier_id, timeout, GetTask(i),
+        /*participating_tasks=*/{}, [this, i, &barrier_statuses,
+                                     &task_states](Status s) {
+          barrier_statuses[i] = s;
+          task_states[i] =
+              GetCoordinationService()->GetTaskState({GetTask(i)})[0].state();
+        });
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    TF_EXPECT_OK(barrier_statuses[i]);
+    EXPECT_EQ(task_states[i], CoordinatedTaskState::TASKSTATE_CONNECTED);
+  }
+}
+
 TEST_F(CoordinationBarrierTest, BarrierWithSubsetOfTasks) {
   const std::string barrier_id = "barrier_id";
   absl::Duration timeout = absl::Seconds(5);
@@ -16,10 +16,13 @@ limitations under the License.
 #include "tensorflow/tsl/framework/bfc_allocator.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/tsl/framework/allocator_retry.h"
 #include "tensorflow/tsl/lib/core/bits.h"
@@ -39,6 +42,184 @@ namespace tsl {
 
 constexpr BFCAllocator::ChunkHandle BFCAllocator::kInvalidChunkHandle;
 
+// Caches chunks freed by the users of the allocator, so that they can be handed
+// out again to allocations of the same requested size without taking the
+// allocator lock. Threads are assigned round-robin to a fixed number of shards,
+// each of which caches the chunks freed by its threads.
+//
+// The chunks held by the cache are still in use as far as the bins are
+// concerned, so the cache also accounts for the bytes in use by the users of
+// the allocator. All methods are thread-safe, and may be called with `lock_`
+// held but never acquire it.
+class BFCAllocator::ChunkCache {
+ public:
+  struct CachedChunk {
+    void* ptr = nullptr;
+    size_t requested_size = 0;
+    size_t size = 0;
+  };
+
+  ChunkCache(size_t max_chunk_bytes, size_t bytes_per_shard)
+      : max_chunk_bytes_(max_chunk_bytes), bytes_per_shard_(bytes_per_shard) {}
+
+  size_t max_chunk_bytes() const { return max_chunk_bytes_; }
+
+  // Remembers the sizes of the chunk at `ptr`, just allocated from the bins,
+  // so that it can be cached when it is freed.
+  void Register(void* ptr, size_t requested_size, size_t size) {
+    Registry& registry = RegistryFor(ptr);
+    mutex_lock l(registry.mu);
+    registry.chunks[ptr] = {ptr, requested_size, size};
+  }
+
+  // Looks up the chunk registered at `ptr`. Returns false if there is none.
+  bool Lookup(void* ptr, CachedChunk* chunk) {
+    Registry& registry = RegistryFor(ptr);
+    tf_shared_lock l(registry.mu);
+    auto it = registry.chunks.find(ptr);
+    if (it == registry.chunks.end()) {
+      return false;
+    }
+    *chunk = it->second;
+    return true;
+  }
+
+  // Forgets the chunk at `ptr`, which is being returned to the bins.
+  void Unregister(void* ptr) {
+    Registry& registry = RegistryFor(ptr);
+    mutex_lock l(registry.mu);
+    registry.chunks.erase(ptr);
+  }
+
+  // Returns a chunk allocated with `requested_size` bytes from the calling
+  // thread's shard, or nullptr if there is none.
+  void* Pop(size_t requested_size) {
+    Shard& shard = ThreadShard();
+    CachedChunk chunk;
+    {
+      mutex_lock l(shard.mu);
+      auto it = shard.chunks.find(requested_size);
+      if (it == shard.chunks.end()) {
+        return nullptr;
+      }
+      chunk = it->second.back();
+      it->second.pop_back();
+      if (it->second.empty()) {
+        shard.chunks.erase(it);
+      }
+      shard.bytes -= chunk.size;
+    }
+    num_allocs_.fetch_add(1, std::memory_order_relaxed);
+    RecordAllocation(chunk.size);
+    return chunk.ptr;
+  }
+
+  // Caches `chunk` in the calling thread's shard. If the shard grows past its
+  // budget, moves chunks out until it holds at most half of it, appending
+  // their pointers to `evicted`.
+  void Push(const CachedChunk& chunk, std::vector<void*>* evicted) {
+    RecordDeallocation(chunk.size);
+    Shard& shard = ThreadShard();
+    mutex_lock l(shard.mu);
+    shard.chunks[chunk.requested_size].push_back(chunk);
+    shard.bytes += chunk.size;
+    if (shard.bytes > bytes_per_shard_) {
+      EvictLocked(shard, bytes_per_shard_ / 2, evicted);
+    }
+  }
+
+  // Empties all the shards, appending the pointers of their chunks to `ptrs`.
+  void Drain(std::vector<void*>* ptrs) {
+    for (Shard& shard : shards_) {
+      mutex_lock l(shard.mu);
+      EvictLocked(shard, /*max_bytes=*/0, ptrs);
+    }
+  }
+
+  // Accounts for a chunk of `size` bytes handed out to, or freed by, the
+  // users of the allocator.
+  void RecordAllocation(size_t size) {
+    const int64_t bytes_in_use =
+        bytes_in_use_.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = peak_bytes_in_use_.load(std::memory_order_relaxed);
+    while (bytes_in_use > peak &&
+           !peak_bytes_in_use_.compare_exchange_weak(
+               peak, bytes_in_use, std::memory_order_relaxed)) {
+    }
+  }
+  void RecordDeallocation(size_t size) {
+    bytes_in_use_.fetch_sub(size, std::memory_order_relaxed);
+  }
+
+  // Overrides the stats of `stats`, computed from the bins, with the ones seen
+  // by the users of the allocator.
+  void UpdateStats(AllocatorStats* stats) const {
+    stats->num_allocs += num_allocs_.load(std::memory_order_relaxed);
+    stats->bytes_in_use = bytes_in_use_.load(std::memory_order_relaxed);
+    stats->peak_bytes_in_use =
+        peak_bytes_in_use_.load(std::memory_order_relaxed);
+  }
+
+  void ClearStats() {
+    num_allocs_.store(0, std::memory_order_relaxed);
+    peak_bytes_in_use_.store(bytes_in_use_.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr int kNumShards = 64;
+
+  struct Shard {
+    mutex mu;
+    // Cached chunks by requested size, most recently freed last.
+    absl::flat_hash_map<size_t, std::vector<CachedChunk>> chunks
+        TF_GUARDED_BY(mu);
+    size_t bytes TF_GUARDED_BY(mu) = 0;
+  };
+
+  // Chunks that may be cached by their pointers. This is sharded by pointer
+  // rather than by thread since chunks are often freed by other threads than
+  // the ones that allocated them.
+  struct Registry {
+    mutex mu;
+    absl::flat_hash_map<void*, CachedChunk> chunks TF_GUARDED_BY(mu);
+  };
+
+  Shard& ThreadShard() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local const size_t shard =
+        next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+    return shards_[shard];
+  }
+
+  Registry& RegistryFor(const void* ptr) {
+    const uintptr_t chunk_index =
+        reinterpret_cast<uintptr_t>(ptr) >> kMinAllocationBits;
+    return registries_[chunk_index % kNumShards];
+  }
+
+  void EvictLocked(Shard& shard, size_t max_bytes, std::vector<void*>* evicted)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(shard.mu) {
+    for (auto it = shard.chunks.begin();
+         shard.bytes > max_bytes && it != shard.chunks.end();) {
+      for (const CachedChunk& chunk : it->second) {
+        evicted->push_back(chunk.ptr);
+        shard.bytes -= chunk.size;
+      }
+      shard.chunks.erase(it++);
+    }
+  }
+
+  const size_t max_chunk_bytes_;
+  const size_t bytes_per_shard_;
+  std::array<Shard, kNumShards> shards_;
+  std::array<Registry, kNumShards> registries_;
+
+  std::atomic<int64_t> num_allocs_{0};
+  std::atomic<int64_t> bytes_in_use_{0};
+  std::atomic<int64_t> peak_bytes_in_use_{0};
+};
+
 BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
                            size_t total_memory, const string& name,
                            const Options& opts)
@@ -47,7 +228,12 @@ BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
       sub_allocator_(std::move(sub_allocator)),
       name_(name),
       free_chunks_list_(kInvalidChunkHandle),
-      next_allocation_id_(1) {
+      next_allocation_id_(1),
+      timeline_(opts.memory_timeline_size) {
+  if (opts.chunk_cache_max_chunk_bytes > 0 && opts.memory_timeline_size == 0) {
+    chunk_cache_ = std::make_unique<ChunkCache>(
+        opts.chunk_cache_max_chunk_bytes, opts.chunk_cache_bytes_per_thread);
+  }
   if (opts.allow_growth) {
     // 2MiB smallest initial allocation, unless total memory available
     // is less.
@@ -330,6 +516,11 @@ bool BFCAllocator::DeallocateFreeRegions(size_t rounded_bytes)
     return false;
   }
 
+  // Regions whose chunks are only held by the chunk cache are free.
+  if (chunk_cache_ != nullptr) {
+    FlushChunkCache();
+  }
+
   // Searching for free regions.
   absl::flat_hash_set<void*> free_region_ptrs;
   size_t total_free_bytes = 0;
@@ -430,6 +621,15 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
   // The BFC allocator tries to find the best fit first.
   BinNum bin_num = BinNumForSize(rounded_bytes);
 
+  if (chunk_cache_ != nullptr && freed_before == 0 &&
+      rounded_bytes <= chunk_cache_->max_chunk_bytes() &&
+      !tsl::profiler::TraceMe::Active()) {
+    void* ptr = chunk_cache_->Pop(num_bytes);
+    if (ptr != nullptr) {
+      return ptr;
+    }
+  }
+
   mutex_lock l(lock_);
   if (!timestamped_chunks_.empty()) {
     // Merge timestamped chunks whose counts have become safe for general use.
@@ -450,6 +650,16 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
     }
   }
 
+  // Chunks held by the chunk cache may be coalesced into a large enough one
+  // once they are returned to the bins.
+  if (chunk_cache_ != nullptr && FlushChunkCache()) {
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, freed_before);
+    if (ptr != nullptr) {
+      AddTraceMe("MemoryAllocation", ptr);
+      return ptr;
+    }
+  }
+
   if ((freed_before == 0) && (!timestamped_chunks_.empty())) {
     // We're unable to satisfy an allocation request without a specific
     // timestamp requirement.  Rather than fail, try merging any held-out
@@ -609,6 +819,20 @@ void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
             std::max(stats_.peak_bytes_in_use, stats_.bytes_in_use);
         stats_.largest_alloc_size =
             std::max<std::size_t>(stats_.largest_alloc_size, chunk->size);
+        if (chunk_cache_ != nullptr) {
+          chunk_cache_->RecordAllocation(chunk->size);
+          if (chunk->size <= chunk_cache_->max_chunk_bytes()) {
+            chunk_cache_->Register(chunk->ptr, num_bytes, chunk->size);
+          }
+        }
+        if (!timeline_.empty()) {
+          const auto& annotation =
+              profiler::ScopedMemoryDebugAnnotation::CurrentAnnotation();
+          chunk->timeline_op_name = annotation.pending_op_name;
+          RecordTimelineEvent(chunk->size, annotation.pending_op_name,
+                              annotation.pending_region_type,
+                              annotation.pending_step_id);
+        }
 
 #ifdef TENSORFLOW_MEM_DEBUG
         if (ShouldRecordOpName()) {
@@ -684,17 +908,63 @@ void BFCAllocator::SplitChunk(BFCAllocator::ChunkHandle h, size_t num_bytes) {
 void BFCAllocator::DeallocateRaw(void* ptr) {
   VLOG(3) << "DeallocateRaw " << Name() << " "
           << (ptr ? RequestedSize(ptr) : 0);
+  if (chunk_cache_ != nullptr && CacheChunk(ptr)) {
+    return;
+  }
   DeallocateRawInternal(ptr);
   retry_helper_.NotifyDealloc();
 }
 
+bool BFCAllocator::CacheChunk(void* ptr) {
+  // Freed chunks must be timestamped, and traced so that memory profiles are
+  // complete, both of which require going through the bins.
+  ChunkCache::CachedChunk chunk;
+  if (ptr == nullptr ||
+      timing_counter_.load(std::memory_order_acquire) != nullptr ||
+      tsl::profiler::TraceMe::Active() || !chunk_cache_->Lookup(ptr, &chunk)) {
+    return false;
+  }
+  std::vector<void*> evicted;
+  chunk_cache_->Push(chunk, &evicted);
+  if (!evicted.empty()) {
+    {
+      mutex_lock l(lock_);
+      for (void* evicted_ptr : evicted) {
+        chunk_cache_->Unregister(evicted_ptr);
+        DeallocateChunk(evicted_ptr);
+      }
+    }
+    retry_helper_.NotifyDealloc();
+  }
+  return true;
+}
+
+bool BFCAllocator::FlushChunkCache() {
+  std::vector<void*> ptrs;
+  chunk_cache_->Drain(&ptrs);
+  for (void* ptr : ptrs) {
+    chunk_cache_->Unregister(ptr);
+    DeallocateChunk(ptr);
+  }
+  return !ptrs.empty();
+}
+
 void BFCAllocator::DeallocateRawInternal(void* ptr) {
   if (ptr == nullptr) {
     VLOG(2) << "tried to deallocate nullptr";
     return;
   }
   mutex_lock l(lock_);
+  if (chunk_cache_ != nullptr) {
+    BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
+    CHECK(h != kInvalidChunkHandle);
+    chunk_cache_->Unregister(ptr);
+    chunk_cache_->RecordDeallocation(ChunkFromHandle(h)->size);
+  }
+  DeallocateChunk(ptr);
+}
 
+void BFCAllocator::DeallocateChunk(void* ptr) {
   // Find the chunk from the ptr.
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle);
@@ -703,6 +973,8 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
   void* chunk_ptr = chunk->ptr;
   int64_t req_bytes = chunk->requested_size;
   int64_t alloc_bytes = chunk->size;
+  const char* op_name = chunk->timeline_op_name;
+  chunk->timeline_op_name = nullptr;
 
   MarkFree(h);
 
@@ -711,16 +983,97 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
     InsertFreeChunkIntoBin(h);
     timestamped_chunks_.push_back(h);
   } else {
-    InsertFreeChunkIntoBin(TryToCoalesce(h, false));
+    h = TryToCoalesce(h, false);
+    InsertFreeChunkIntoBin(h);
   }
 
   // TraceMe needs to be added after MarkFree and InsertFreeChunkIntoBin for
   // correct aggregation stats (bytes_in_use, fragmentation).
   AddTraceMe("MemoryDeallocation", chunk_ptr, req_bytes, alloc_bytes);
+  if (!timeline_.empty()) {
+    RecordTimelineEvent(-alloc_bytes, op_name, /*region_type=*/nullptr,
+                        /*step_id=*/0);
+  }
 
   if (VLOG_IS_ON(4)) {
     LOG(INFO) << "F: " << RenderOccupancy();
   }
+
+  if (opts_.pool_bytes_soft_limit > 0 &&
+      *stats_.pool_bytes > opts_.pool_bytes_soft_limit) {
+    ReleaseFreeChunk(h, opts_.pool_bytes_soft_limit);
+  }
+}
+
+size_t BFCAllocator::ReleaseFreeMemory(size_t max_pool_bytes) {
+  mutex_lock l(lock_);
+  if (chunk_cache_ != nullptr) {
+    FlushChunkCache();
+  }
+  if (!timestamped_chunks_.empty()) {
+    MergeTimestampedChunks(0);
+  }
+
+  // Releasing memory may remove regions, so find their last chunks first.
+  std::vector<ChunkHandle> last_chunks;
+  for (const AllocationRegion& region : region_manager_.regions()) {
+    ChunkHandle h = region_manager_.get_handle(region.ptr());
+    while (ChunkFromHandle(h)->next != kInvalidChunkHandle) {
+      h = ChunkFromHandle(h)->next;
+    }
+    last_chunks.push_back(h);
+  }
+  size_t released_bytes = 0;
+  for (ChunkHandle h : last_chunks) {
+    released_bytes += ReleaseFreeChunk(h, max_pool_bytes);
+  }
+  VLOG(1) << "Released " << strings::HumanReadableNumBytes(released_bytes)
+          << " of free memory from " << Name();
+  return released_bytes;
+}
+
+size_t BFCAllocator::ReleaseFreeChunk(ChunkHandle h, size_t max_pool_bytes) {
+  Chunk* c = ChunkFromHandle(h);
+  if (c->in_use() || c->freed_at_count > 0 || c->next != kInvalidChunkHandle ||
+      *stats_.pool_bytes <= max_pool_bytes) {
+    return 0;
+  }
+  AllocationRegion* region = region_manager_.MutableRegionFor(c->ptr);
+  RemoveFreeChunkFromBin(h);
+  size_t released_bytes = 0;
+  // Release the allocations that extended the region, from the last one,
+  // as long as the chunk covers them.
+  while (*stats_.pool_bytes > max_pool_bytes &&
+         region->sub_allocation_sizes().size() > 1) {
+    const size_t bytes = region->sub_allocation_sizes().back();
+    char* ptr = static_cast<char*>(region->end_ptr()) - bytes;
+    if (ptr < c->ptr) break;
+    if (ptr == c->ptr) {
+      ChunkFromHandle(c->prev)->next = kInvalidChunkHandle;
+      DeleteChunk(h);
+      c = nullptr;
+    } else {
+      c->size -= bytes;
+    }
+    region->shrink();
+    sub_allocator_->Free(ptr, bytes);
+    *stats_.pool_bytes -= bytes;
+    released_bytes += bytes;
+    if (c == nullptr) return released_bytes;
+  }
+  // Release the whole region if the chunk covers it.
+  if (*stats_.pool_bytes > max_pool_bytes &&
+      region->sub_allocation_sizes().size() == 1 && c->ptr == region->ptr()) {
+    void* ptr = region->ptr();
+    const size_t bytes = region->memory_size();
+    DeleteChunk(h);
+    region_manager_.RemoveAllocationRegion(ptr);
+    sub_allocator_->Free(ptr, bytes);
+    *stats_.pool_bytes -= bytes;
+    return released_bytes + bytes;
+  }
+  InsertFreeChunkIntoBin(h);
+  return released_bytes;
 }
 
 // Merges h1 and h2 when Chunk(h1)->next is h2 and Chunk(h2)->prev is c1.
@@ -800,8 +1153,9 @@ void BFCAllocator::MarkFree(BFCAllocator::ChunkHandle h) {
   c->allocation_id = -1;
 
   // Optionally record the free time.
-  if (timing_counter_) {
-    c->freed_at_count = timing_counter_->next();
+  if (SharedCounter* timing_counter =
+          timing_counter_.load(std::memory_order_acquire)) {
+    c->freed_at_count = timing_counter->next();
   }
 
   // Updates the stats.
@@ -1136,6 +1490,9 @@ void BFCAllocator::MaybeWriteMemoryMap() {
 
 MemoryDump BFCAllocator::RecordMemoryMap() {
   mutex_lock l(lock_);
+  if (chunk_cache_ != nullptr) {
+    FlushChunkCache();
+  }
   return RecordMemoryMapInternal();
 }
 
@@ -1205,9 +1562,96 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
   return md;
 }
 
+void BFCAllocator::RecordTimelineEvent(int64_t bytes, const char* op_name,
+                                       const char* region_type,
+                                       int64_t step_id) {
+  TimelineEvent& event = timeline_[num_timeline_events_ % timeline_.size()];
+  ++num_timeline_events_;
+  event.time_us = Env::Default()->NowMicros();
+  event.bytes = bytes;
+  event.bytes_in_use = stats_.bytes_in_use;
+  event.largest_free_chunk = LargestFreeChunk();
+  // Unlike GetFragmentation(), this tolerates a pool that is fully in use.
+  const int64_t bytes_available = *stats_.pool_bytes - stats_.bytes_in_use;
+  event.fragmentation =
+      bytes_available > 0
+          ? static_cast<float>(bytes_available - event.largest_free_chunk) /
+                bytes_available
+          : 0;
+  event.op_name = op_name;
+  event.region_type = region_type;
+  event.step_id = step_id;
+
+  auto it = live_bytes_by_op_.try_emplace(op_name, 0).first;
+  it->second += bytes;
+  if (it->second == 0) {
+    live_bytes_by_op_.erase(it);
+  }
+  if (bytes > 0 && stats_.bytes_in_use > timeline_peak_bytes_in_use_) {
+    timeline_peak_bytes_in_use_ = stats_.bytes_in_use;
+    timeline_peak_time_us_ = event.time_us;
+    live_bytes_by_op_at_peak_ = live_bytes_by_op_;
+  }
+}
+
+MemoryTimeline BFCAllocator::RecordMemoryTimeline(int max_top_ops) {
+  MemoryTimeline timeline;
+  timeline.set_allocator_name(Name());
+  mutex_lock l(lock_);
+  if (timeline_.empty()) {
+    return timeline;
+  }
+  const uint64 num_events =
+      std::min<uint64>(num_timeline_events_, timeline_.size());
+  timeline.set_num_dropped_events(num_timeline_events_ - num_events);
+  for (uint64 i = num_timeline_events_ - num_events; i < num_timeline_events_;
+       ++i) {
+    const TimelineEvent& event = timeline_[i % timeline_.size()];
+    tensorflow::MemTimelineEvent* e = timeline.add_event();
+    e->set_time_us(event.time_us);
+    e->set_bytes(event.bytes);
+    e->set_bytes_in_use(event.bytes_in_use);
+    e->set_largest_free_chunk(event.largest_free_chunk);
+    e->set_fragmentation_metric(event.fragmentation);
+    e->set_op_name(event.op_name ? event.op_name : "UNKNOWN");
+    e->set_step_id(event.step_id);
+    if (event.region_type != nullptr) {
+      e->set_region_type(event.region_type);
+    }
+  }
+
+  timeline.set_peak_bytes_in_use(timeline_peak_bytes_in_use_);
+  timeline.set_peak_time_us(timeline_peak_time_us_);
+  // The same op name may be referred to by different pointers.
+  absl::flat_hash_map<string, int64_t> bytes_by_op;
+  for (const auto& [op_name, bytes] : live_bytes_by_op_at_peak_) {
+    bytes_by_op[op_name ? op_name : "UNKNOWN"] += bytes;
+  }
+  std::vector<std::pair<string, int64_t>> top_ops(bytes_by_op.begin(),
+                                                  bytes_by_op.end());
+  std::sort(top_ops.begin(), top_ops.end(),
+            [](const auto& a, const auto& b) {
+              return a.second != b.second ? a.second > b.second
+                                          : a.first < b.first;
+            });
+  if (top_ops.size() > static_cast<size_t>(max_top_ops)) {
+    top_ops.resize(max_top_ops);
+  }
+  for (const auto& [op_name, bytes] : top_ops) {
+    tensorflow::MemOpBytes* op = timeline.add_top_ops_at_peak();
+    op->set_op_name(op_name);
+    op->set_bytes_in_use(bytes);
+  }
+  return timeline;
+}
+
 absl::optional<AllocatorStats> BFCAllocator::GetStats() {
   mutex_lock l(lock_);
-  return stats_;
+  AllocatorStats stats = stats_;
+  if (chunk_cache_ != nullptr) {
+    chunk_cache_->UpdateStats(&stats);
+  }
+  return stats;
 }
 
 bool BFCAllocator::ClearStats() {
@@ -1215,6 +1659,9 @@ bool BFCAllocator::ClearStats() {
   stats_.num_allocs = 0;
   stats_.peak_bytes_in_use = stats_.bytes_in_use;
   stats_.largest_alloc_size = 0;
+  if (chunk_cache_ != nullptr) {
+    chunk_cache_->ClearStats();
+  }
   return true;
 }
 
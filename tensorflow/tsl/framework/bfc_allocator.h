@@ -23,6 +23,7 @@ limitations under the License.
 #include <unordered_map>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "tensorflow/tsl/framework/allocator.h"
 #include "tensorflow/tsl/framework/allocator_retry.h"
@@ -36,9 +37,11 @@ limitations under the License.
 
 namespace tensorflow {
 class MemoryDump;
+class MemoryTimeline;
 }
 namespace tsl {
 using tensorflow::MemoryDump;
+using tensorflow::MemoryTimeline;
 
 // A memory allocator that implements a 'best-fit with coalescing'
 // algorithm.  This is essentially a very simple version of Doug Lea's
@@ -68,6 +71,36 @@ class BFCAllocator : public Allocator {
     // Controls when a chunk should be split, if its size exceeds the requested
     // allocation size.
     double fragmentation_fraction = 0;
+
+    // If positive, freed chunks of at most this many bytes are kept in
+    // per-thread caches, and handed out again to allocations of the same
+    // requested size without taking the allocator lock. This trades some
+    // memory held back from the bins for less lock contention when many
+    // threads allocate small buffers. Chunks handed out from a cache keep the
+    // allocation id of their previous allocation.
+    //
+    // The caches are bypassed while a timing counter is set or a profiler
+    // trace is being collected, and are flushed back to the bins when an
+    // allocation can't otherwise be satisfied.
+    size_t chunk_cache_max_chunk_bytes = 0;
+
+    // The number of bytes each per-thread cache may hold. A cache that grows
+    // past this is trimmed to half of it, returning chunks to the bins.
+    size_t chunk_cache_bytes_per_thread = 1 << 20;
+
+    // If positive, the allocator records its most recent allocations and
+    // deallocations, up to this many, along with the fragmentation at the
+    // time, for RecordMemoryTimeline(). It also keeps the bytes in use by
+    // each op, to report the ops that held the most memory at the peak.
+    // This disables the chunk caches, whose allocations would be missed.
+    size_t memory_timeline_size = 0;
+
+    // If positive, memory held by the allocator beyond this many bytes is
+    // returned to the sub-allocator as soon as it is free, so that a peak of
+    // usage doesn't keep it from others sharing the device, e.g. another
+    // process on the same GPU. Allocations beyond the limit are then slower,
+    // as they get memory from the sub-allocator again.
+    size_t pool_bytes_soft_limit = 0;
   };
   BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator, size_t total_memory,
                const string& name, const Options& opts);
@@ -97,7 +130,9 @@ class BFCAllocator : public Allocator {
 
   bool ClearStats() override;
 
-  void SetTimingCounter(SharedCounter* sc) { timing_counter_ = sc; }
+  void SetTimingCounter(SharedCounter* sc) {
+    timing_counter_.store(sc, std::memory_order_release);
+  }
 
   void SetSafeFrontier(uint64 count) override;
 
@@ -107,8 +142,21 @@ class BFCAllocator : public Allocator {
 
   MemoryDump RecordMemoryMap();
 
+  // Returns the memory timeline, with the `max_top_ops` ops that held the
+  // most memory at the peak. Empty unless Options::memory_timeline_size is
+  // positive.
+  MemoryTimeline RecordMemoryTimeline(int max_top_ops = 10);
+
+  // Returns free memory to the sub-allocator until at most `max_pool_bytes`
+  // remain held by the allocator, e.g. so that another process sharing the
+  // device can use it. Memory is returned in whole sub-allocator allocations:
+  // free regions, and the free allocations at the end of regions that were
+  // extended by adjacent allocations. Returns the number of bytes released.
+  size_t ReleaseFreeMemory(size_t max_pool_bytes = 0);
+
  private:
   struct Bin;
+  class ChunkCache;
 
   void* AllocateRawInternal(size_t alignment, size_t num_bytes,
                             bool dump_log_on_failure,
@@ -120,6 +168,19 @@ class BFCAllocator : public Allocator {
 
   void DeallocateRawInternal(void* ptr);
 
+  // Returns the chunk at `ptr` to the bins, coalescing it with its neighbors
+  // when possible.
+  void DeallocateChunk(void* ptr) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Puts the chunk at `ptr` into the calling thread's chunk cache, returning
+  // the chunks evicted from the cache to the bins. Returns false if the chunk
+  // can't be cached and must be deallocated instead.
+  bool CacheChunk(void* ptr) TF_LOCKS_EXCLUDED(lock_);
+
+  // Returns all the chunks held by the chunk cache to the bins. Returns true if
+  // there were any.
+  bool FlushChunkCache() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Chunks whose freed_at_count is later than the safe frontier value are kept
   // on a special list and not subject to merging immediately upon being freed.
   //
@@ -208,6 +269,9 @@ class BFCAllocator : public Allocator {
     // Optional count when this chunk was most recently made free.
     uint64 freed_at_count = 0;
 
+    // The op that allocated the chunk, if the memory timeline is enabled.
+    const char* timeline_op_name = nullptr;
+
     bool in_use() const { return allocation_id != -1; }
 
 #ifdef TENSORFLOW_MEM_DEBUG
@@ -294,7 +358,8 @@ class BFCAllocator : public Allocator {
         : ptr_(ptr),
           memory_size_(memory_size),
           end_ptr_(
-              static_cast<void*>(static_cast<char*>(ptr_) + memory_size_)) {
+              static_cast<void*>(static_cast<char*>(ptr_) + memory_size_)),
+          sub_allocation_sizes_({memory_size}) {
       DCHECK_EQ(0, memory_size % kMinAllocationSize);
       const size_t n_handles =
           (memory_size + kMinAllocationSize - 1) / kMinAllocationSize;
@@ -319,6 +384,23 @@ class BFCAllocator : public Allocator {
       const size_t n_handles =
           (memory_size_ + kMinAllocationSize - 1) / kMinAllocationSize;
       handles_.resize(n_handles, kInvalidChunkHandle);
+      sub_allocation_sizes_.push_back(size);
+    }
+    // Removes the last sub-allocator allocation from a region extended by
+    // it, returning its size.
+    size_t shrink() {
+      DCHECK_GT(sub_allocation_sizes_.size(), 1);
+      const size_t size = sub_allocation_sizes_.back();
+      sub_allocation_sizes_.pop_back();
+      memory_size_ -= size;
+      end_ptr_ = static_cast<void*>(static_cast<char*>(end_ptr_) - size);
+      handles_.resize(memory_size_ / kMinAllocationSize);
+      return size;
+    }
+    // The sizes of the sub-allocator allocations the region consists of, in
+    // address order.
+    const std::vector<size_t>& sub_allocation_sizes() const {
+      return sub_allocation_sizes_;
     }
     ChunkHandle get_handle(const void* p) const {
       return handles_[IndexFor(p)];
@@ -332,6 +414,7 @@ class BFCAllocator : public Allocator {
       std::swap(memory_size_, other->memory_size_);
       std::swap(end_ptr_, other->end_ptr_);
       std::swap(handles_, other->handles_);
+      std::swap(sub_allocation_sizes_, other->sub_allocation_sizes_);
     }
 
     size_t IndexFor(const void* p) const {
@@ -352,6 +435,8 @@ class BFCAllocator : public Allocator {
     // for the memory allocation represented by "p"
     std::vector<ChunkHandle> handles_;
 
+    std::vector<size_t> sub_allocation_sizes_;
+
     TF_DISALLOW_COPY_AND_ASSIGN(AllocationRegion);
   };
 
@@ -408,6 +493,11 @@ class BFCAllocator : public Allocator {
       return regions_.erase(it);
     }
 
+    void RemoveAllocationRegion(const void* p) {
+      regions_.erase(
+          std::upper_bound(regions_.begin(), regions_.end(), p, &Comparator));
+    }
+
     ChunkHandle get_handle(const void* p) const {
       return RegionFor(p)->get_handle(p);
     }
@@ -419,15 +509,15 @@ class BFCAllocator : public Allocator {
 
     const std::vector<AllocationRegion>& regions() const { return regions_; }
 
+    AllocationRegion* MutableRegionFor(const void* p) {
+      return const_cast<AllocationRegion*>(RegionFor(p));
+    }
+
    private:
     static bool Comparator(const void* ptr, const AllocationRegion& other) {
       return ptr < other.end_ptr();
     }
 
-    AllocationRegion* MutableRegionFor(const void* p) {
-      return const_cast<AllocationRegion*>(RegionFor(p));
-    }
-
     const AllocationRegion* RegionFor(const void* p) const {
       auto entry =
           std::upper_bound(regions_.begin(), regions_.end(), p, &Comparator);
@@ -465,6 +555,12 @@ class BFCAllocator : public Allocator {
   void DeallocateRegions(const absl::flat_hash_set<void*>& region_ptrs)
       TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Returns the memory of the free chunk `h` to the sub-allocator while more
+  // than `max_pool_bytes` are held, if `h` is the last chunk of its region.
+  // Returns the number of bytes released.
+  size_t ReleaseFreeChunk(ChunkHandle h, size_t max_pool_bytes)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Returns a pointer to an underlying allocated chunk of size
   // 'rounded_bytes'.
   void* FindChunkPtr(BinNum bin_num, size_t rounded_bytes, size_t num_bytes,
@@ -501,6 +597,12 @@ class BFCAllocator : public Allocator {
       TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
   void MaybeWriteMemoryMap() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Appends an event to the memory timeline, after the allocator was updated
+  // for it. `bytes` is negative for deallocations.
+  void RecordTimelineEvent(int64_t bytes, const char* op_name,
+                           const char* region_type, int64_t step_id)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   ChunkHandle AllocateChunk() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
   void DeallocateChunk(ChunkHandle h) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
@@ -591,11 +693,17 @@ class BFCAllocator : public Allocator {
 
   std::unique_ptr<SubAllocator> sub_allocator_;
   string name_;
-  SharedCounter* timing_counter_ = nullptr;
+  // Atomic, since the chunk cache checks it without holding `lock_`.
+  std::atomic<SharedCounter*> timing_counter_ = {nullptr};
   std::deque<ChunkHandle> timestamped_chunks_;
 
   std::atomic<uint64> safe_frontier_ = {0};
 
+  // Null unless Options::chunk_cache_max_chunk_bytes is positive. While set,
+  // it also keeps the stats of the bytes in use as seen by the users of the
+  // allocator, which don't count the chunks held by the cache.
+  std::unique_ptr<ChunkCache> chunk_cache_;
+
   // Structures mutable after construction
   mutable mutex lock_;
   RegionManager region_manager_ TF_GUARDED_BY(lock_);
@@ -611,6 +719,29 @@ class BFCAllocator : public Allocator {
 
   // Stats.
   AllocatorStats stats_ TF_GUARDED_BY(lock_);
+
+  // The memory timeline, a ring buffer of Options::memory_timeline_size
+  // events, the oldest of which is at num_timeline_events_ % size once it
+  // has wrapped around.
+  struct TimelineEvent {
+    int64_t time_us = 0;
+    int64_t bytes = 0;
+    int64_t bytes_in_use = 0;
+    int64_t largest_free_chunk = 0;
+    float fragmentation = 0;
+    const char* op_name = nullptr;
+    const char* region_type = nullptr;
+    int64_t step_id = 0;
+  };
+  std::vector<TimelineEvent> timeline_ TF_GUARDED_BY(lock_);
+  uint64 num_timeline_events_ TF_GUARDED_BY(lock_) = 0;
+  absl::flat_hash_map<const char*, int64_t> live_bytes_by_op_
+      TF_GUARDED_BY(lock_);
+  absl::flat_hash_map<const char*, int64_t> live_bytes_by_op_at_peak_
+      TF_GUARDED_BY(lock_);
+  int64_t timeline_peak_bytes_in_use_ TF_GUARDED_BY(lock_) = 0;
+  int64_t timeline_peak_time_us_ TF_GUARDED_BY(lock_) = 0;
+
 #ifdef TENSORFLOW_MEM_DEBUG
   int64 action_counter_ TF_GUARDED_BY(lock_) = 0;
 #define MEM_DEBUG_SIZE_HISTORY_SIZE 4096
@@ -15,8 +15,10 @@ limitations under the License.
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
-// SSE4.2 accelerated CRC32c.
+// Hardware accelerated CRC32c, with the SSE4.2 or the ARMv8 crc32c
+// instructions.
 
 // See if the SSE4.2 crc32c instruction is available.
 #undef USE_SSE_CRC32C
@@ -37,14 +39,25 @@ limitations under the License.
 #undef USE_SSE_CRC32C
 #endif
 
+// See if the ARMv8 crc32c instructions are available. They are optional in
+// ARMv8.0, so this requires compiling for a target that has them, e.g. with
+// -march=armv8-a+crc.
+#undef USE_ARM_CRC32C
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define USE_ARM_CRC32C 1
+#endif
+
 #ifdef USE_SSE_CRC32C
 #include <nmmintrin.h>
 #endif
+#ifdef USE_ARM_CRC32C
+#include <arm_acle.h>
+#endif
 
 namespace tsl {
 namespace crc32c {
 
-#ifndef USE_SSE_CRC32C
+#if !defined(USE_SSE_CRC32C) && !defined(USE_ARM_CRC32C)
 
 bool CanAccelerate() { return false; }
 uint32_t AcceleratedExtend(uint32_t crc, const char *buf, size_t size) {
@@ -54,9 +67,102 @@ uint32_t AcceleratedExtend(uint32_t crc, const char *buf, size_t size) {
 
 #else
 
+#ifdef USE_SSE_CRC32C
 // SSE4.2 optimized crc32c computation.
 bool CanAccelerate() { return __builtin_cpu_supports("sse4.2"); }
 
+static inline uint32_t Crc8(uint32_t crc, uint8_t value) {
+  return _mm_crc32_u8(crc, value);
+}
+static inline uint64_t Crc64(uint64_t crc, uint64_t value) {
+  return _mm_crc32_u64(crc, value);
+}
+#else
+// ARMv8 optimized crc32c computation. The target has the instructions.
+bool CanAccelerate() { return true; }
+
+static inline uint32_t Crc8(uint32_t crc, uint8_t value) {
+  return __crc32cb(crc, value);
+}
+static inline uint64_t Crc64(uint64_t crc, uint64_t value) {
+  return __crc32cd(static_cast<uint32_t>(crc), value);
+}
+#endif
+
+static inline uint64_t Load64(const uint8_t *p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// The crc32c polynomial, bit-reflected.
+static constexpr uint32_t kPoly = 0x82f63b78u;
+
+// Returns a * b modulo the polynomial, where bit 31 is the coefficient of x^0.
+static uint32_t MultiplyModPoly(uint32_t a, uint32_t b) {
+  uint32_t product = 0;
+  for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+    if (a & m) product ^= b;
+    b = (b & 1) ? (b >> 1) ^ kPoly : b >> 1;
+  }
+  return product;
+}
+
+// Shifts the crc32c register state through a fixed number of zero bytes, i.e.
+// multiplies it by x^(8 * num_bytes) modulo the polynomial, with a table per
+// byte of the state, since this is linear.
+class ZeroBytesShift {
+ public:
+  explicit ZeroBytesShift(size_t num_bytes) {
+    // x^(8 * num_bytes), by repeated squaring.
+    uint32_t power = 1u << 31;
+    for (uint32_t square = 1u << 23; num_bytes != 0; num_bytes >>= 1) {
+      if (num_bytes & 1) power = MultiplyModPoly(power, square);
+      square = MultiplyModPoly(square, square);
+    }
+    for (int i = 0; i < 4; ++i) {
+      for (uint32_t b = 0; b < 256; ++b) {
+        table_[i][b] = MultiplyModPoly(power, b << (8 * i));
+      }
+    }
+  }
+
+  uint32_t operator()(uint32_t crc) const {
+    return table_[0][crc & 0xff] ^ table_[1][(crc >> 8) & 0xff] ^
+           table_[2][(crc >> 16) & 0xff] ^ table_[3][crc >> 24];
+  }
+
+ private:
+  uint32_t table_[4][256];
+};
+
+// The latency of the crc32c instruction is three times its reciprocal
+// throughput, so a single dependency chain uses a third of it. Long buffers
+// are instead processed as three interleaved streams of kStreamSize bytes,
+// whose crcs are then combined by shifting.
+template <size_t kStreamSize>
+static inline uint64_t ExtendInterleaved(uint64_t crc0, const uint8_t **p,
+                                         const uint8_t *e) {
+  if (e - *p < static_cast<ptrdiff_t>(3 * kStreamSize)) {
+    return crc0;
+  }
+  static const ZeroBytesShift *shift = new ZeroBytesShift(kStreamSize);
+  const uint8_t *s = *p;
+  while (e - s >= static_cast<ptrdiff_t>(3 * kStreamSize)) {
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    for (size_t i = 0; i < kStreamSize; i += 8) {
+      crc0 = Crc64(crc0, Load64(s + i));
+      crc1 = Crc64(crc1, Load64(s + kStreamSize + i));
+      crc2 = Crc64(crc2, Load64(s + 2 * kStreamSize + i));
+    }
+    crc0 = (*shift)((*shift)(crc0) ^ crc1) ^ crc2;
+    s += 3 * kStreamSize;
+  }
+  *p = s;
+  return crc0;
+}
+
 uint32_t AcceleratedExtend(uint32_t crc, const char *buf, size_t size) {
   const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
   const uint8_t *e = p + size;
@@ -70,23 +176,26 @@ uint32_t AcceleratedExtend(uint32_t crc, const char *buf, size_t size) {
   if (x <= e) {
     // Process bytes until finished or p is 8-byte aligned
     while (p != x) {
-      l = _mm_crc32_u8(l, *p);
+      l = Crc8(l, *p);
       p++;
     }
   }
 
-  // Process bytes 16 at a time
   uint64_t l64 = l;
+  l64 = ExtendInterleaved<8192>(l64, &p, e);
+  l64 = ExtendInterleaved<256>(l64, &p, e);
+
+  // Process bytes 16 at a time
   while ((e - p) >= 16) {
-    l64 = _mm_crc32_u64(l64, *reinterpret_cast<const uint64_t *>(p));
-    l64 = _mm_crc32_u64(l64, *reinterpret_cast<const uint64_t *>(p + 8));
+    l64 = Crc64(l64, Load64(p));
+    l64 = Crc64(l64, Load64(p + 8));
     p += 16;
   }
 
   // Process remaining bytes one at a time.
   l = l64;
   while (p < e) {
-    l = _mm_crc32_u8(l, *p);
+    l = Crc8(l, *p);
     p++;
   }
 
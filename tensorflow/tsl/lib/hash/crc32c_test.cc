@@ -58,6 +58,34 @@ TEST(CRC, StandardResults) {
 
 TEST(CRC, Values) { ASSERT_NE(Value("a", 1), Value("foo", 3)); }
 
+// Bit-at-a-time reference implementation.
+static uint32 ReferenceValue(const char* data, size_t n) {
+  uint32 crc = 0xffffffffu;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= static_cast<uint8>(data[i]);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78u : 0);
+    }
+  }
+  return crc ^ 0xffffffffu;
+}
+
+TEST(CRC, LongValues) {
+  // Cover the sizes around those of the interleaved streams of the
+  // accelerated code, at all alignments.
+  std::string data(3 * 8192 + 3 * 256 + 64, 0);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(i * 7 + (i >> 8));
+  }
+  for (size_t n : {767, 768, 769, 24575, 24576, 24577, 25376}) {
+    for (size_t offset = 0; offset < 8; offset++) {
+      ASSERT_EQ(ReferenceValue(data.data() + offset, n),
+                Value(data.data() + offset, n))
+          << n << " bytes at " << offset;
+    }
+  }
+}
+
 TEST(CRC, Extend) {
   ASSERT_EQ(Value("hello world", 11), Extend(Value("hello ", 6), "world", 5));
 }
@@ -0,0 +1,203 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/lib/io/block_compressed_inputstream.h"
+#include "tensorflow/tsl/lib/io/block_compressed_outputbuffer.h"
+#include "tensorflow/tsl/lib/io/block_compression_options.h"
+#include "tensorflow/tsl/lib/io/random_inputstream.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/test.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+std::string GenTestString(int size) {
+  std::string result;
+  result.reserve(size);
+  for (int i = 0; i < size; ++i) {
+    result.push_back('a' + (i / 10) % 26);
+  }
+  return result;
+}
+
+// Writes `data` in pieces of `write_size` bytes, flushing after every
+// `flush_every` pieces if positive.
+void WriteFile(const std::string& fname, const std::string& data,
+               const BlockCompressionOptions& options, size_t write_size,
+               int flush_every = 0) {
+  Env* env = Env::Default();
+  std::unique_ptr<WritableFile> file;
+  TF_ASSERT_OK(env->NewWritableFile(fname, &file));
+  BlockCompressedOutputBuffer out(file.get(), options);
+  for (size_t i = 0; i * write_size < data.size(); ++i) {
+    TF_ASSERT_OK(out.Append(StringPiece(data).substr(i * write_size,
+                                                     write_size)));
+    if (flush_every > 0 && i % flush_every == 0) {
+      TF_ASSERT_OK(out.Flush());
+    }
+  }
+  TF_ASSERT_OK(out.Close());
+  TF_ASSERT_OK(file->Close());
+}
+
+TEST(BlockCompressedBuffers, RoundTrip) {
+  Env* env = Env::Default();
+  std::string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  const std::string data = GenTestString(100000);
+  for (auto codec :
+       {BlockCompressionOptions::UNCOMPRESSED, BlockCompressionOptions::SNAPPY,
+        BlockCompressionOptions::ZLIB}) {
+    for (int64_t block_size : {1, 1000, 4096, 1 << 20}) {
+      for (int num_threads : {1, 4}) {
+        for (int flush_every : {0, 7}) {
+          BlockCompressionOptions options;
+          options.codec = codec;
+          options.block_size = block_size;
+          options.num_threads = num_threads;
+          WriteFile(fname, data, options, /*write_size=*/1500, flush_every);
+
+          std::unique_ptr<RandomAccessFile> file;
+          TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+          RandomAccessInputStream input_stream(file.get());
+          BlockCompressedInputStream in(&input_stream, options,
+                                        /*owns_input_stream=*/false);
+          tstring result;
+          TF_ASSERT_OK(in.ReadNBytes(10, &result));
+          EXPECT_EQ(result, data.substr(0, 10));
+          TF_ASSERT_OK(in.ReadNBytes(data.size() - 10, &result));
+          EXPECT_EQ(result, data.substr(10));
+          EXPECT_EQ(in.Tell(), data.size());
+          EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &result)));
+          EXPECT_TRUE(result.empty());
+        }
+      }
+    }
+  }
+}
+
+TEST(BlockCompressedBuffers, SkipAndReset) {
+  Env* env = Env::Default();
+  std::string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  const std::string data = GenTestString(100000);
+  BlockCompressionOptions options;
+  options.block_size = 1000;
+  options.num_threads = 2;
+  WriteFile(fname, data, options, /*write_size=*/data.size());
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+  BlockCompressedInputStream in(new RandomAccessInputStream(file.get()),
+                                options, /*owns_input_stream=*/true);
+  tstring result;
+  TF_ASSERT_OK(in.SkipNBytes(500));
+  TF_ASSERT_OK(in.ReadNBytes(1000, &result));
+  EXPECT_EQ(result, data.substr(500, 1000));
+  // Skips the blocks read ahead and the following ones.
+  TF_ASSERT_OK(in.SkipNBytes(50000));
+  EXPECT_EQ(in.Tell(), 51500);
+  TF_ASSERT_OK(in.ReadNBytes(100, &result));
+  EXPECT_EQ(result, data.substr(51500, 100));
+  EXPECT_TRUE(errors::IsOutOfRange(in.SkipNBytes(data.size())));
+  EXPECT_EQ(in.Tell(), data.size());
+
+  TF_ASSERT_OK(in.Reset());
+  EXPECT_EQ(in.Tell(), 0);
+  TF_ASSERT_OK(in.ReadNBytes(data.size(), &result));
+  EXPECT_EQ(result, data);
+}
+
+TEST(BlockCompressedBuffers, IncompressibleBlocks) {
+  Env* env = Env::Default();
+  std::string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  std::string data(10000, 0);
+  uint32 state = 1;
+  for (char& c : data) {
+    state = state * 1103515245 + 12345;
+    c = static_cast<char>(state >> 24);
+  }
+  BlockCompressionOptions options;
+  options.codec = BlockCompressionOptions::ZLIB;
+  options.block_size = 1000;
+  WriteFile(fname, data, options, /*write_size=*/data.size());
+
+  // The blocks are stored uncompressed.
+  uint64 file_size;
+  TF_ASSERT_OK(env->GetFileSize(fname, &file_size));
+  EXPECT_EQ(file_size,
+            data.size() + 10 * (BlockCompressionOptions::kHeaderSize +
+                                BlockCompressionOptions::kFooterSize));
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+  RandomAccessInputStream input_stream(file.get());
+  BlockCompressedInputStream in(&input_stream, options,
+                                /*owns_input_stream=*/false);
+  tstring result;
+  TF_ASSERT_OK(in.ReadNBytes(data.size(), &result));
+  EXPECT_EQ(result, data);
+}
+
+TEST(BlockCompressedBuffers, CorruptedBlock) {
+  Env* env = Env::Default();
+  std::string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  const std::string data = GenTestString(10000);
+  BlockCompressionOptions options;
+  options.block_size = 1000;
+  WriteFile(fname, data, options, /*write_size=*/data.size());
+
+  std::string contents;
+  TF_ASSERT_OK(ReadFileToString(env, fname, &contents));
+  for (size_t offset : {size_t{0}, contents.size() / 2}) {
+    std::string corrupted = contents;
+    corrupted[offset] ^= 1;
+    TF_ASSERT_OK(WriteStringToFile(env, fname, corrupted));
+
+    std::unique_ptr<RandomAccessFile> file;
+    TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+    RandomAccessInputStream input_stream(file.get());
+    BlockCompressedInputStream in(&input_stream, options,
+                                  /*owns_input_stream=*/false);
+    tstring result;
+    Status s = in.ReadNBytes(data.size(), &result);
+    EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+  }
+
+  // A truncated file.
+  TF_ASSERT_OK(
+      WriteStringToFile(env, fname, contents.substr(0, contents.size() - 1)));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+  RandomAccessInputStream input_stream(file.get());
+  BlockCompressedInputStream in(&input_stream, options,
+                                /*owns_input_stream=*/false);
+  tstring result;
+  Status s = in.ReadNBytes(data.size(), &result);
+  EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tsl
@@ -0,0 +1,297 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/lib/io/block_compressed_inputstream.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "tensorflow/tsl/lib/hash/crc32c.h"
+#include "tensorflow/tsl/platform/coding.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/notification.h"
+#include "tensorflow/tsl/platform/raw_coding.h"
+#include "tensorflow/tsl/platform/snappy.h"
+
+namespace tsl {
+namespace io {
+
+struct BlockCompressedInputStream::Block {
+  // The offset of the block in the input, for error messages.
+  int64_t offset = 0;
+  uint32 length = 0;
+  uint32 uncompressed_length = 0;
+  uint8 codec = BlockCompressionOptions::UNCOMPRESSED;
+  uint32 masked_crc = 0;
+  tstring compressed;
+
+  // Set once decompressed.
+  tstring uncompressed;
+  Status status;
+  Notification decompressed_notification;
+};
+
+namespace {
+
+// Verifies and decompresses `*compressed_data` into `*uncompressed`.
+Status UncompressBlock(int64_t offset, uint8 codec, uint32 masked_crc,
+                       uint32 uncompressed_length, tstring* compressed_data,
+                       tstring* uncompressed) {
+  const tstring& compressed = *compressed_data;
+  if (crc32c::Unmask(masked_crc) !=
+      crc32c::Value(compressed.data(), compressed.size())) {
+    return errors::DataLoss("corrupted block at ", offset);
+  }
+  switch (codec) {
+    case BlockCompressionOptions::UNCOMPRESSED:
+      if (compressed.size() != uncompressed_length) break;
+      std::swap(*uncompressed, *compressed_data);
+      return OkStatus();
+    case BlockCompressionOptions::SNAPPY: {
+      size_t length;
+      if (!port::Snappy_GetUncompressedLength(compressed.data(),
+                                              compressed.size(), &length) ||
+          length != uncompressed_length) {
+        break;
+      }
+      uncompressed->resize_uninitialized(length);
+      if (!port::Snappy_Uncompress(compressed.data(), compressed.size(),
+                                   &(*uncompressed)[0])) {
+        break;
+      }
+      return OkStatus();
+    }
+    case BlockCompressionOptions::ZLIB: {
+      uLongf length = uncompressed_length;
+      uncompressed->resize_uninitialized(length);
+      if (uncompress(reinterpret_cast<Bytef*>(&(*uncompressed)[0]), &length,
+                     reinterpret_cast<const Bytef*>(compressed.data()),
+                     compressed.size()) != Z_OK ||
+          length != uncompressed_length) {
+        break;
+      }
+      return OkStatus();
+    }
+    default:
+      return errors::DataLoss("unknown codec ", codec, " of block at ",
+                              offset);
+  }
+  return errors::DataLoss("failed to decompress block at ", offset);
+}
+
+}  // namespace
+
+BlockCompressedInputStream::BlockCompressedInputStream(
+    InputStreamInterface* input_stream, const BlockCompressionOptions& options,
+    bool owns_input_stream)
+    : input_stream_(input_stream),
+      owns_input_stream_(owns_input_stream),
+      max_pending_blocks_(2 * std::max(options.num_threads, 1)),
+      thread_pool_(new thread::ThreadPool(Env::Default(), "block_decompression",
+                                          std::max(options.num_threads, 1))) {}
+
+BlockCompressedInputStream::~BlockCompressedInputStream() {
+  // Waits for the blocks being decompressed.
+  thread_pool_.reset();
+  if (owns_input_stream_) {
+    delete input_stream_;
+  }
+}
+
+Status BlockCompressedInputStream::ReadBlockHeader(Block* block,
+                                                   bool* end_of_input) {
+  *end_of_input = false;
+  block->offset = input_stream_->Tell();
+  tstring header;
+  Status s =
+      input_stream_->ReadNBytes(BlockCompressionOptions::kHeaderSize, &header);
+  if (errors::IsOutOfRange(s) && header.empty()) {
+    *end_of_input = true;
+    return OkStatus();
+  }
+  if (errors::IsOutOfRange(s)) {
+    return errors::DataLoss("truncated block at ", block->offset);
+  }
+  TF_RETURN_IF_ERROR(s);
+  const size_t crc_offset = 2 * sizeof(uint32) + sizeof(uint8);
+  if (crc32c::Unmask(core::DecodeFixed32(header.data() + crc_offset)) !=
+      crc32c::Value(header.data(), crc_offset)) {
+    return errors::DataLoss("corrupted block at ", block->offset);
+  }
+  block->length = core::DecodeFixed32(header.data());
+  block->uncompressed_length =
+      core::DecodeFixed32(header.data() + sizeof(uint32));
+  block->codec = static_cast<uint8>(header[2 * sizeof(uint32)]);
+  return OkStatus();
+}
+
+Status BlockCompressedInputStream::ReadBlockData(Block* block) {
+  Status s = input_stream_->ReadNBytes(block->length, &block->compressed);
+  if (s.ok()) {
+    tstring footer;
+    s = input_stream_->ReadNBytes(BlockCompressionOptions::kFooterSize,
+                                  &footer);
+    if (s.ok()) block->masked_crc = core::DecodeFixed32(footer.data());
+  }
+  if (errors::IsOutOfRange(s)) {
+    return errors::DataLoss("truncated block at ", block->offset);
+  }
+  return s;
+}
+
+void BlockCompressedInputStream::ScheduleBlocks() {
+  while (read_ahead_status_.ok() && !end_of_input_ &&
+         pending_blocks_.size() < max_pending_blocks_) {
+    auto block = std::make_shared<Block>();
+    read_ahead_status_ = ReadBlockHeader(block.get(), &end_of_input_);
+    if (!read_ahead_status_.ok() || end_of_input_) return;
+    read_ahead_status_ = ReadBlockData(block.get());
+    if (!read_ahead_status_.ok()) return;
+    ScheduleBlock(std::move(block));
+  }
+}
+
+void BlockCompressedInputStream::ScheduleBlock(std::shared_ptr<Block> block) {
+  pending_blocks_.push_back(block);
+  thread_pool_->Schedule([block]() {
+    block->status = UncompressBlock(block->offset, block->codec,
+                                    block->masked_crc,
+                                    block->uncompressed_length,
+                                    &block->compressed, &block->uncompressed);
+    block->compressed.clear();
+    block->decompressed_notification.Notify();
+  });
+}
+
+Status BlockCompressedInputStream::NextBlock() {
+  current_block_.reset();
+  current_block_pos_ = 0;
+  ScheduleBlocks();
+  if (pending_blocks_.empty()) {
+    TF_RETURN_IF_ERROR(read_ahead_status_);
+    return errors::OutOfRange("reached end of stream");
+  }
+  std::shared_ptr<Block> block = std::move(pending_blocks_.front());
+  pending_blocks_.pop_front();
+  // Keeps the following blocks decompressing meanwhile.
+  ScheduleBlocks();
+  block->decompressed_notification.WaitForNotification();
+  TF_RETURN_IF_ERROR(block->status);
+  current_block_ = std::move(block);
+  return OkStatus();
+}
+
+Status BlockCompressedInputStream::ReadNBytes(int64_t bytes_to_read,
+                                              tstring* result) {
+  result->clear();
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Can't read a negative number of bytes: ",
+                                   bytes_to_read);
+  }
+  result->resize_uninitialized(bytes_to_read);
+  size_t bytes_copied = 0;
+  while (bytes_copied < static_cast<size_t>(bytes_to_read)) {
+    if (current_block_ == nullptr ||
+        current_block_pos_ == current_block_->uncompressed.size()) {
+      Status s = NextBlock();
+      if (!s.ok()) {
+        result->resize(bytes_copied);
+        return s;
+      }
+      continue;
+    }
+    const size_t n =
+        std::min(bytes_to_read - bytes_copied,
+                 current_block_->uncompressed.size() - current_block_pos_);
+    memcpy(&(*result)[bytes_copied],
+           current_block_->uncompressed.data() + current_block_pos_, n);
+    current_block_pos_ += n;
+    bytes_copied += n;
+    bytes_read_ += n;
+  }
+  return OkStatus();
+}
+
+Status BlockCompressedInputStream::SkipNBytes(int64_t bytes_to_skip) {
+  if (bytes_to_skip < 0) {
+    return errors::InvalidArgument("Can't skip a negative number of bytes: ",
+                                   bytes_to_skip);
+  }
+  while (bytes_to_skip > 0) {
+    if (current_block_ != nullptr &&
+        current_block_pos_ < current_block_->uncompressed.size()) {
+      const size_t n = std::min<size_t>(
+          bytes_to_skip,
+          current_block_->uncompressed.size() - current_block_pos_);
+      current_block_pos_ += n;
+      bytes_to_skip -= n;
+      bytes_read_ += n;
+      continue;
+    }
+    // Skips the pending blocks entirely within the bytes to skip, whose
+    // decompression is wasted, and then the blocks not yet read, without
+    // reading their data.
+    if (!pending_blocks_.empty()) {
+      const Block& block = *pending_blocks_.front();
+      if (block.uncompressed_length <= bytes_to_skip) {
+        bytes_to_skip -= block.uncompressed_length;
+        bytes_read_ += block.uncompressed_length;
+        pending_blocks_.pop_front();
+        continue;
+      }
+    } else if (read_ahead_status_.ok() && !end_of_input_) {
+      auto block = std::make_shared<Block>();
+      TF_RETURN_IF_ERROR(ReadBlockHeader(block.get(), &end_of_input_));
+      if (end_of_input_) break;
+      if (block->uncompressed_length <= bytes_to_skip) {
+        Status s = input_stream_->SkipNBytes(
+            block->length + BlockCompressionOptions::kFooterSize);
+        if (errors::IsOutOfRange(s)) {
+          return errors::DataLoss("truncated block at ", block->offset);
+        }
+        TF_RETURN_IF_ERROR(s);
+        bytes_to_skip -= block->uncompressed_length;
+        bytes_read_ += block->uncompressed_length;
+        continue;
+      }
+      TF_RETURN_IF_ERROR(ReadBlockData(block.get()));
+      ScheduleBlock(std::move(block));
+    }
+    TF_RETURN_IF_ERROR(NextBlock());
+  }
+  if (bytes_to_skip > 0) {
+    return errors::OutOfRange("reached end of stream");
+  }
+  return OkStatus();
+}
+
+int64_t BlockCompressedInputStream::Tell() const { return bytes_read_; }
+
+Status BlockCompressedInputStream::Reset() {
+  pending_blocks_.clear();
+  read_ahead_status_ = OkStatus();
+  end_of_input_ = false;
+  current_block_.reset();
+  current_block_pos_ = 0;
+  bytes_read_ = 0;
+  return input_stream_->Reset();
+}
+
+}  // namespace io
+}  // namespace tsl
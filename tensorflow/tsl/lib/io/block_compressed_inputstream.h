@@ -0,0 +1,109 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_BLOCK_COMPRESSED_INPUTSTREAM_H_
+#define TENSORFLOW_TSL_LIB_IO_BLOCK_COMPRESSED_INPUTSTREAM_H_
+
+#include <deque>
+#include <memory>
+
+#include "tensorflow/tsl/lib/io/block_compression_options.h"
+#include "tensorflow/tsl/lib/io/inputstream_interface.h"
+#include "tensorflow/tsl/platform/macros.h"
+#include "tensorflow/tsl/platform/status.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+#include "tensorflow/tsl/platform/types.h"
+
+namespace tsl {
+namespace io {
+
+// Decompresses the format described in BlockCompressionOptions. The upcoming
+// blocks are read ahead and decompressed in parallel on `options.num_threads`
+// threads.
+class BlockCompressedInputStream : public InputStreamInterface {
+ public:
+  // Creates a BlockCompressedInputStream for `input_stream`.
+  //
+  // Takes ownership of `input_stream` iff `owns_input_stream` is true.
+  BlockCompressedInputStream(InputStreamInterface* input_stream,
+                             const BlockCompressionOptions& options,
+                             bool owns_input_stream);
+
+  ~BlockCompressedInputStream() override;
+
+  // Reads bytes_to_read bytes into *result, overwriting *result.
+  //
+  // Return Status codes:
+  // OK:           If successful.
+  // OUT_OF_RANGE: If there are not enough bytes to read before
+  //               the end of the stream.
+  // DATA_LOSS:    If a block is corrupted.
+  // others:       If reading from stream failed.
+  Status ReadNBytes(int64_t bytes_to_read, tstring* result) override;
+
+  // Skips the blocks entirely within the next bytes_to_skip bytes without
+  // decompressing them.
+  Status SkipNBytes(int64_t bytes_to_skip) override;
+
+  int64_t Tell() const override;
+
+  Status Reset() override;
+
+ private:
+  struct Block;
+
+  // Reads the header of the next block from `input_stream_` into `*block`.
+  // Sets `*end_of_input` instead at the end of `input_stream_`.
+  Status ReadBlockHeader(Block* block, bool* end_of_input);
+
+  // Reads the data of the block whose header was read into `*block`.
+  Status ReadBlockData(Block* block);
+
+  // Reads the data of the next blocks and schedules their decompression, until
+  // `max_pending_blocks_` blocks are pending.
+  void ScheduleBlocks();
+
+  // Schedules the decompression of `block`, whose data was read.
+  void ScheduleBlock(std::shared_ptr<Block> block);
+
+  // Makes the next pending block the current block, once decompressed.
+  Status NextBlock();
+
+  InputStreamInterface* input_stream_;
+  const bool owns_input_stream_;
+  const size_t max_pending_blocks_;
+
+  // The blocks read ahead, in order.
+  std::deque<std::shared_ptr<Block>> pending_blocks_;
+  // The first error reading ahead, returned once the pending blocks are read.
+  Status read_ahead_status_;
+  bool end_of_input_ = false;
+
+  // The block being read, and the number of its bytes read.
+  std::shared_ptr<Block> current_block_;
+  size_t current_block_pos_ = 0;
+
+  // Specifies the number of decompressed bytes currently read.
+  int64_t bytes_read_ = 0;
+
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BlockCompressedInputStream);
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_BLOCK_COMPRESSED_INPUTSTREAM_H_
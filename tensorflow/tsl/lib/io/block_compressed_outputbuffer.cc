@@ -0,0 +1,179 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/lib/io/block_compressed_outputbuffer.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/tsl/lib/hash/crc32c.h"
+#include "tensorflow/tsl/platform/coding.h"
+#include "tensorflow/tsl/platform/notification.h"
+#include "tensorflow/tsl/platform/snappy.h"
+
+namespace tsl {
+namespace io {
+
+struct BlockCompressedOutputBuffer::Block {
+  std::string input;
+  std::string compressed;
+  BlockCompressionOptions::Codec codec;
+  Notification compressed_notification;
+
+  // The data stored in the block.
+  StringPiece data() const {
+    return codec == BlockCompressionOptions::UNCOMPRESSED ? input
+                                                          : compressed;
+  }
+};
+
+namespace {
+
+// Compresses `input` into `*compressed` with `options.codec`, and returns the
+// codec of the block.
+BlockCompressionOptions::Codec CompressBlock(
+    const BlockCompressionOptions& options, const std::string& input,
+    std::string* compressed) {
+  bool ok = false;
+  switch (options.codec) {
+    case BlockCompressionOptions::SNAPPY:
+      ok = port::Snappy_Compress(input.data(), input.size(), compressed);
+      break;
+    case BlockCompressionOptions::ZLIB: {
+      uLongf length = compressBound(input.size());
+      compressed->resize(length);
+      ok = compress2(reinterpret_cast<Bytef*>(&(*compressed)[0]), &length,
+                     reinterpret_cast<const Bytef*>(input.data()),
+                     input.size(), options.zlib_compression_level) == Z_OK;
+      compressed->resize(length);
+      break;
+    }
+    case BlockCompressionOptions::UNCOMPRESSED:
+      break;
+  }
+  if (ok && compressed->size() < input.size()) return options.codec;
+  compressed->clear();
+  return BlockCompressionOptions::UNCOMPRESSED;
+}
+
+uint32 MaskedCrc(StringPiece data) {
+  return crc32c::Mask(crc32c::Value(data.data(), data.size()));
+}
+
+}  // namespace
+
+BlockCompressedOutputBuffer::BlockCompressedOutputBuffer(
+    WritableFile* file, const BlockCompressionOptions& options)
+    : file_(file),
+      options_(options),
+      block_size_(std::max<int64_t>(options.block_size, 1)),
+      max_pending_blocks_(2 * std::max(options.num_threads, 1)),
+      thread_pool_(new thread::ThreadPool(Env::Default(), "block_compression",
+                                          std::max(options.num_threads, 1))) {
+  input_.reserve(block_size_);
+}
+
+BlockCompressedOutputBuffer::~BlockCompressedOutputBuffer() {
+  // Waits for the blocks being compressed.
+  thread_pool_.reset();
+}
+
+Status BlockCompressedOutputBuffer::Append(StringPiece data) {
+  while (!data.empty()) {
+    const size_t n = std::min(data.size(), block_size_ - input_.size());
+    input_.append(data.data(), n);
+    data.remove_prefix(n);
+    if (input_.size() == block_size_) {
+      ScheduleBlock();
+      TF_RETURN_IF_ERROR(WriteBlocks(/*wait_for_all=*/false));
+    }
+  }
+  return OkStatus();
+}
+
+#if defined(TF_CORD_SUPPORT)
+Status BlockCompressedOutputBuffer::Append(const absl::Cord& cord) {
+  for (absl::string_view fragment : cord.Chunks()) {
+    TF_RETURN_IF_ERROR(Append(fragment));
+  }
+  return OkStatus();
+}
+#endif
+
+Status BlockCompressedOutputBuffer::Close() {
+  // Given that we do not own `file`, we don't close it.
+  return Flush();
+}
+
+Status BlockCompressedOutputBuffer::Name(StringPiece* result) const {
+  return file_->Name(result);
+}
+
+Status BlockCompressedOutputBuffer::Sync() {
+  TF_RETURN_IF_ERROR(Flush());
+  return file_->Sync();
+}
+
+Status BlockCompressedOutputBuffer::Tell(int64_t* position) {
+  return file_->Tell(position);
+}
+
+Status BlockCompressedOutputBuffer::Flush() {
+  if (!input_.empty()) ScheduleBlock();
+  return WriteBlocks(/*wait_for_all=*/true);
+}
+
+void BlockCompressedOutputBuffer::ScheduleBlock() {
+  auto block = std::make_shared<Block>();
+  block->input = std::move(input_);
+  input_.clear();
+  input_.reserve(block_size_);
+  blocks_.push_back(block);
+  thread_pool_->Schedule([options = options_, block]() {
+    block->codec = CompressBlock(options, block->input, &block->compressed);
+    block->compressed_notification.Notify();
+  });
+}
+
+Status BlockCompressedOutputBuffer::WriteBlocks(bool wait_for_all) {
+  while (!blocks_.empty()) {
+    Block* block = blocks_.front().get();
+    if (wait_for_all || blocks_.size() > max_pending_blocks_) {
+      block->compressed_notification.WaitForNotification();
+    } else if (!block->compressed_notification.HasBeenNotified()) {
+      break;
+    }
+    const StringPiece data = block->data();
+    char header[BlockCompressionOptions::kHeaderSize];
+    core::EncodeFixed32(header, data.size());
+    core::EncodeFixed32(header + sizeof(uint32), block->input.size());
+    header[2 * sizeof(uint32)] = block->codec;
+    core::EncodeFixed32(
+        header + 2 * sizeof(uint32) + sizeof(uint8),
+        MaskedCrc(StringPiece(header, 2 * sizeof(uint32) + sizeof(uint8))));
+    char footer[BlockCompressionOptions::kFooterSize];
+    core::EncodeFixed32(footer, MaskedCrc(data));
+    TF_RETURN_IF_ERROR(file_->Append(StringPiece(header, sizeof(header))));
+    TF_RETURN_IF_ERROR(file_->Append(data));
+    TF_RETURN_IF_ERROR(file_->Append(StringPiece(footer, sizeof(footer))));
+    blocks_.pop_front();
+  }
+  return OkStatus();
+}
+
+}  // namespace io
+}  // namespace tsl
@@ -0,0 +1,103 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_BLOCK_COMPRESSED_OUTPUTBUFFER_H_
+#define TENSORFLOW_TSL_LIB_IO_BLOCK_COMPRESSED_OUTPUTBUFFER_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "tensorflow/tsl/lib/io/block_compression_options.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/macros.h"
+#include "tensorflow/tsl/platform/status.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+#include "tensorflow/tsl/platform/types.h"
+
+namespace tsl {
+namespace io {
+
+// Compresses input data in blocks of `options.block_size` bytes, in parallel
+// on `options.num_threads` threads, and writes them to `file` in the format
+// described in BlockCompressionOptions.
+class BlockCompressedOutputBuffer : public WritableFile {
+ public:
+  // Does not take ownership of `file`.
+  BlockCompressedOutputBuffer(WritableFile* file,
+                              const BlockCompressionOptions& options);
+
+  // Per convention, the dtor does not call Flush() or Close(). We expect the
+  // caller to call those manually when done.
+  ~BlockCompressedOutputBuffer() override;
+
+  // Adds `data` to the current block. Full blocks are compressed in the
+  // background and written to file in order as they complete.
+  Status Append(StringPiece data) override;
+
+#if defined(TF_CORD_SUPPORT)
+  Status Append(const absl::Cord& cord) override;
+#endif
+
+  // Compresses any buffered input and writes all output to file. This must be
+  // called before the destructor to avoid any data loss. Does not close the
+  // file.
+  Status Close() override;
+
+  // Returns the name of the underlying file.
+  Status Name(StringPiece* result) const override;
+
+  // Compresses any buffered input, writes all output to file and syncs it.
+  Status Sync() override;
+
+  // Returns the write position in the underlying file. The position does not
+  // reflect buffered, un-flushed data.
+  Status Tell(int64_t* position) override;
+
+  // Compresses any buffered input, as a shorter block, and writes all output
+  // to file. Does not flush the file.
+  Status Flush() override;
+
+ private:
+  struct Block;
+
+  // Schedules the compression of `input_` as a block.
+  void ScheduleBlock();
+
+  // Writes the compressed blocks at the front of `blocks_` to file, in order.
+  // Waits for the compression of all the blocks if `wait_for_all`, or else
+  // of the blocks past the first `max_pending_blocks_`.
+  Status WriteBlocks(bool wait_for_all);
+
+  WritableFile* file_;  // Not owned
+  const BlockCompressionOptions options_;
+  const size_t block_size_;
+  const size_t max_pending_blocks_;
+
+  // The input of the current block.
+  std::string input_;
+
+  // The blocks scheduled for compression and not yet written, in order.
+  std::deque<std::shared_ptr<Block>> blocks_;
+
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BlockCompressedOutputBuffer);
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_BLOCK_COMPRESSED_OUTPUTBUFFER_H_
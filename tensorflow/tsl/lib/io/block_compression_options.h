@@ -0,0 +1,70 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_BLOCK_COMPRESSION_OPTIONS_H_
+#define TENSORFLOW_TSL_LIB_IO_BLOCK_COMPRESSION_OPTIONS_H_
+
+#include "tensorflow/tsl/platform/types.h"
+
+namespace tsl {
+namespace io {
+
+// Options of the block-compressed format written by BlockCompressedOutputBuffer
+// and read by BlockCompressedInputStream.
+//
+// The format is a sequence of blocks, each of which holds up to `block_size`
+// bytes of the input compressed independently of the other blocks, so that
+// the blocks can be compressed and decompressed in parallel. Format of a
+// single block:
+//  uint32    length of the compressed data
+//  uint32    length of the uncompressed data
+//  uint8     codec
+//  uint32    masked crc of the above
+//  byte      compressed data[length]
+//  uint32    masked crc of the compressed data
+// Readers skip blocks without decompressing them.
+struct BlockCompressionOptions {
+  // The codecs of the blocks, stored in the format.
+  enum Codec : uint8 {
+    // Blocks which don't get smaller when compressed are stored uncompressed.
+    UNCOMPRESSED = 0,
+    SNAPPY = 1,
+    ZLIB = 2,
+  };
+
+  static constexpr size_t kHeaderSize =
+      2 * sizeof(uint32) + sizeof(uint8) + sizeof(uint32);
+  static constexpr size_t kFooterSize = sizeof(uint32);
+
+  // The codec the blocks are written with. Readers support all codecs.
+  Codec codec = SNAPPY;
+
+  // Maximum number of bytes of the input compressed as a block. Blocks are
+  // shorter only when the output is flushed.
+  int64_t block_size = 1 << 20;
+
+  // Number of threads compressing or decompressing blocks. Up to twice as many
+  // blocks are buffered.
+  int num_threads = 4;
+
+  // The compression level of ZLIB, between 0 and 9, or -1 for the default of
+  // zlib.
+  int8 zlib_compression_level = -1;
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_BLOCK_COMPRESSION_OPTIONS_H_
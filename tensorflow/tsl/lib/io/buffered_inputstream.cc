@@ -102,12 +102,41 @@ Status BufferedInputStream::ReadNBytes(int64_t bytes_to_read, tstring* result) {
   if (pos_ == limit_ && !file_status_.ok() && bytes_to_read > 0) {
     return file_status_;
   }
-  result->reserve(bytes_to_read);
+  result->resize_uninitialized(bytes_to_read);
+  size_t bytes_read = 0;
+  Status s = ReadNBytes(bytes_to_read, &(*result)[0], &bytes_read);
+  result->resize(bytes_read);
+  return s;
+}
+
+Status BufferedInputStream::ReadNBytes(int64_t bytes_to_read, char* result,
+                                       size_t* bytes_read) {
+  *bytes_read = 0;
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Can't read a negative number of bytes: ",
+                                   bytes_to_read);
+  }
+  if (pos_ == limit_ && !file_status_.ok() && bytes_to_read > 0) {
+    return file_status_;
+  }
 
   Status s;
-  while (result->size() < static_cast<size_t>(bytes_to_read)) {
+  while (*bytes_read < static_cast<size_t>(bytes_to_read)) {
     // Check whether the buffer is fully read or not.
     if (pos_ == limit_) {
+      const size_t bytes_remaining = bytes_to_read - *bytes_read;
+      if (bytes_remaining >= size_) {
+        // Copying through the buffer would not save any reads, so read the
+        // rest straight into `result`.
+        size_t bytes_read_directly = 0;
+        s = input_stream_->ReadNBytes(bytes_remaining, result + *bytes_read,
+                                      &bytes_read_directly);
+        *bytes_read += bytes_read_directly;
+        if (!s.ok()) {
+          file_status_ = s;
+        }
+        break;
+      }
       s = FillBuffer();
       // If we didn't read any bytes, we're at the end of the file; break out.
       if (limit_ == 0) {
@@ -116,16 +145,17 @@ Status BufferedInputStream::ReadNBytes(int64_t bytes_to_read, tstring* result) {
         break;
       }
     }
-    const int64_t bytes_to_copy =
-        std::min<int64_t>(limit_ - pos_, bytes_to_read - result->size());
-    result->insert(result->size(), buf_, pos_, bytes_to_copy);
+    const size_t bytes_to_copy =
+        std::min<size_t>(limit_ - pos_, bytes_to_read - *bytes_read);
+    memcpy(result + *bytes_read, buf_.data() + pos_, bytes_to_copy);
     pos_ += bytes_to_copy;
+    *bytes_read += bytes_to_copy;
   }
   // Filling the buffer might lead to a situation when we go past the end of
   // the file leading to an OutOfRange() status return. But we might have
   // obtained enough data to satisfy the function call. Returning OK then.
   if (errors::IsOutOfRange(s) &&
-      (result->size() == static_cast<size_t>(bytes_to_read))) {
+      (*bytes_read == static_cast<size_t>(bytes_to_read))) {
     return OkStatus();
   }
   return s;
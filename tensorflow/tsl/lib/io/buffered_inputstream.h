@@ -45,6 +45,11 @@ class BufferedInputStream : public InputStreamInterface {
 
   Status ReadNBytes(int64_t bytes_to_read, tstring* result) override;
 
+  // Reads that do not fit in the buffer bypass it once the buffered bytes are
+  // consumed, and are read from the underlying stream directly into `result`.
+  Status ReadNBytes(int64_t bytes_to_read, char* result,
+                    size_t* bytes_read) override;
+
   Status SkipNBytes(int64_t bytes_to_skip) override;
 
   int64_t Tell() const override;
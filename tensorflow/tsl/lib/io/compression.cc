@@ -23,6 +23,8 @@ const char kNone[] = "";
 const char kGzip[] = "GZIP";
 const char kSnappy[] = "SNAPPY";
 const char kZlib[] = "ZLIB";
+const char kBlockSnappy[] = "BLOCK_SNAPPY";
+const char kBlockZlib[] = "BLOCK_ZLIB";
 
 }  // namespace compression
 }  // namespace io
@@ -24,6 +24,9 @@ extern const char kNone[];
 extern const char kGzip[];
 extern const char kSnappy[];
 extern const char kZlib[];
+// The block-compressed format of BlockCompressionOptions.
+extern const char kBlockSnappy[];
+extern const char kBlockZlib[];
 
 }  // namespace compression
 }  // namespace io
@@ -42,6 +42,11 @@ Status InputBuffer::FillBuffer() {
   pos_ = buf_;
   limit_ = pos_ + data.size();
   file_pos_ += data.size();
+  if (s.ok()) {
+    // Reads are mostly sequential, so let the file fetch the next buffer while
+    // the caller consumes this one.
+    file_->ReadAhead(file_pos_, size_).IgnoreError();
+  }
   return s;
 }
 
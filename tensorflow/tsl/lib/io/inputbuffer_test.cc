@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/tsl/lib/io/inputbuffer.h"
 
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/tsl/lib/core/status_test_util.h"
@@ -35,6 +37,31 @@ static std::vector<int> BufferSizes() {
           12, 13, 14, 15, 16, 17, 18, 19, 20, 65536};
 }
 
+// Records the read-ahead hints issued to the wrapped file.
+class ReadAheadRecordingFile : public RandomAccessFile {
+ public:
+  explicit ReadAheadRecordingFile(std::unique_ptr<RandomAccessFile> file)
+      : file_(std::move(file)) {}
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    return file_->Read(offset, n, result, scratch);
+  }
+
+  Status ReadAhead(uint64 offset, size_t n) const override {
+    read_aheads_.emplace_back(offset, n);
+    return OkStatus();
+  }
+
+  const std::vector<std::pair<uint64, size_t>>& read_aheads() const {
+    return read_aheads_;
+  }
+
+ private:
+  std::unique_ptr<RandomAccessFile> file_;
+  mutable std::vector<std::pair<uint64, size_t>> read_aheads_;
+};
+
 TEST(InputBuffer, ReadLine_Empty) {
   Env* env = Env::Default();
   string fname;
@@ -421,5 +448,29 @@ TEST(InputBuffer, Hint) {
   }
 }
 
+TEST(InputBuffer, ReadAhead) {
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  TF_ASSERT_OK(WriteStringToFile(env, fname, "0123456789"));
+
+  std::unique_ptr<RandomAccessFile> base_file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &base_file));
+  ReadAheadRecordingFile file(std::move(base_file));
+  string read;
+  io::InputBuffer in(&file, 4);
+
+  TF_CHECK_OK(in.ReadNBytes(3, &read));
+  EXPECT_EQ(read, "012");
+  TF_CHECK_OK(in.ReadNBytes(3, &read));
+  EXPECT_EQ(read, "345");
+  // The last buffer reaches the end of the file, so no read-ahead follows it.
+  EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(5, &read)));
+  EXPECT_EQ(read, "6789");
+  EXPECT_THAT(file.read_aheads(),
+              ::testing::ElementsAre(std::make_pair(uint64{4}, size_t{4}),
+                                     std::make_pair(uint64{8}, size_t{4})));
+}
+
 }  // namespace
 }  // namespace tsl
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/tsl/lib/io/inputstream_interface.h"
 
+#include <string.h>
+
 #include "tensorflow/tsl/platform/errors.h"
 
 namespace tsl {
@@ -24,6 +26,15 @@ namespace io {
 // 8MB at a time.
 static constexpr int64_t kMaxSkipSize = 8 * 1024 * 1024;
 
+Status InputStreamInterface::ReadNBytes(int64_t bytes_to_read, char* result,
+                                        size_t* bytes_read) {
+  tstring data;
+  Status s = ReadNBytes(bytes_to_read, &data);
+  memcpy(result, data.data(), data.size());
+  *bytes_read = data.size();
+  return s;
+}
+
 Status InputStreamInterface::SkipNBytes(int64_t bytes_to_skip) {
   if (bytes_to_skip < 0) {
     return errors::InvalidArgument("Can't skip a negative number of bytes");
@@ -37,6 +37,16 @@ class InputStreamInterface {
   //  * OUT_OF_RANGE - not enough bytes remaining before end of file.
   virtual Status ReadNBytes(int64_t bytes_to_read, tstring* result) = 0;
 
+  // Reads the next bytes_to_read from the file into `result`, which must have
+  // room for bytes_to_read bytes, and stores the number of bytes read in
+  // `*bytes_read`. Typical return codes:
+  //  * OK - in case of success.
+  //  * OUT_OF_RANGE - not enough bytes remaining before end of file.
+  // The default implementation reads into a temporary string and copies it;
+  // streams that can fill `result` directly should override it.
+  virtual Status ReadNBytes(int64_t bytes_to_read, char* result,
+                            size_t* bytes_read);
+
 #if defined(TF_CORD_SUPPORT)
   // Reads the next bytes_to_read from the file. Typical return codes:
   //  * OK - in case of success.
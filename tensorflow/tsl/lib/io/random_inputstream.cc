@@ -37,16 +37,30 @@ Status RandomAccessInputStream::ReadNBytes(int64_t bytes_to_read,
   }
   result->clear();
   result->resize_uninitialized(bytes_to_read);
-  char* result_buffer = &(*result)[0];
+  size_t bytes_read = 0;
+  Status s = ReadNBytes(bytes_to_read, &(*result)[0], &bytes_read);
+  result->resize(bytes_read);
+  return s;
+}
+
+Status RandomAccessInputStream::ReadNBytes(int64_t bytes_to_read, char* result,
+                                           size_t* bytes_read) {
+  *bytes_read = 0;
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Cannot read negative number of bytes");
+  }
   StringPiece data;
-  Status s = file_->Read(pos_, bytes_to_read, &data, result_buffer);
-  if (data.data() != result_buffer) {
-    memmove(result_buffer, data.data(), data.size());
+  Status s = file_->Read(pos_, bytes_to_read, &data, result);
+  if (data.data() != result) {
+    memmove(result, data.data(), data.size());
   }
-  result->resize(data.size());
+  *bytes_read = data.size();
   if (s.ok() || errors::IsOutOfRange(s)) {
     pos_ += data.size();
   }
+  if (s.ok() && read_ahead_bytes_ > 0) {
+    file_->ReadAhead(pos_, read_ahead_bytes_).IgnoreError();
+  }
   return s;
 }
 
@@ -35,6 +35,9 @@ class RandomAccessInputStream : public InputStreamInterface {
 
   Status ReadNBytes(int64_t bytes_to_read, tstring* result) override;
 
+  Status ReadNBytes(int64_t bytes_to_read, char* result,
+                    size_t* bytes_read) override;
+
 #if defined(TF_CORD_SUPPORT)
   Status ReadNBytes(int64_t bytes_to_read, absl::Cord* result) override;
 #endif
@@ -50,10 +53,15 @@ class RandomAccessInputStream : public InputStreamInterface {
 
   Status Reset() override { return Seek(0); }
 
+  // After each read, hints the file to fetch the next `bytes` bytes in the
+  // background. 0 disables read-ahead.
+  void SetReadAheadBytes(size_t bytes) { read_ahead_bytes_ = bytes; }
+
  private:
   RandomAccessFile* file_;  // Not owned.
   int64_t pos_ = 0;         // Tracks where we are in the file.
   bool owns_file_ = false;
+  size_t read_ahead_bytes_ = 0;
 };
 
 }  // namespace io
@@ -17,6 +17,8 @@ limitations under the License.
 
 #include <limits.h>
 
+#include <algorithm>
+
 #include "tensorflow/tsl/lib/hash/crc32c.h"
 #include "tensorflow/tsl/lib/io/buffered_inputstream.h"
 #include "tensorflow/tsl/lib/io/compression.h"
@@ -46,6 +48,12 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
     options.zlib_options = io::ZlibCompressionOptions::GZIP();
   } else if (compression_type == compression::kSnappy) {
     options.compression_type = io::RecordReaderOptions::SNAPPY_COMPRESSION;
+  } else if (compression_type == compression::kBlockSnappy) {
+    options.compression_type = io::RecordReaderOptions::BLOCK_COMPRESSION;
+    options.block_compression_options.codec = BlockCompressionOptions::SNAPPY;
+  } else if (compression_type == compression::kBlockZlib) {
+    options.compression_type = io::RecordReaderOptions::BLOCK_COMPRESSION;
+    options.block_compression_options.codec = BlockCompressionOptions::ZLIB;
   } else if (compression_type != compression::kNone) {
     LOG(ERROR) << "Unsupported compression_type:" << compression_type
                << ". No compression will be used.";
@@ -57,9 +65,14 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
 RecordReader::RecordReader(RandomAccessFile* file,
                            const RecordReaderOptions& options)
     : options_(options),
+      file_(file),
       input_stream_(new RandomAccessInputStream(file)),
       last_read_failed_(false) {
   if (options.buffer_size > 0) {
+    // Buffered reads are sequential, so the file can fetch the next buffer in
+    // the background.
+    static_cast<RandomAccessInputStream*>(input_stream_.get())
+        ->SetReadAheadBytes(options.buffer_size);
     input_stream_.reset(new BufferedInputStream(input_stream_.release(),
                                                 options.buffer_size, true));
   }
@@ -77,15 +90,39 @@ RecordReader::RecordReader(RandomAccessFile* file,
     input_stream_.reset(
         new SnappyInputStream(input_stream_.release(),
                               options.snappy_options.output_buffer_size, true));
+  } else if (options.compression_type ==
+             RecordReaderOptions::BLOCK_COMPRESSION) {
+    input_stream_.reset(new BlockCompressedInputStream(
+        input_stream_.release(), options.block_compression_options, true));
   } else if (options.compression_type == RecordReaderOptions::NONE) {
     // Nothing to do.
   } else {
     LOG(FATAL) << "Unrecognized compression type :" << options.compression_type;
   }
 #endif
+  // The offsets of the records are only those of the file if uncompressed.
+  if (options.verify_checksums_in_background &&
+      options.compression_type == RecordReaderOptions::NONE) {
+    verification_thread_.reset(new thread::ThreadPool(
+        Env::Default(), "record_checksum_verification", 1));
+  }
+}
+
+RecordReader::~RecordReader() {
+  if (verification_thread_ != nullptr) {
+    BackgroundVerificationStatus(/*wait=*/true).IgnoreError();
+  }
 }
 
 namespace {
+// Number of bytes of a record read and checksummed at a time. Small enough for
+// the chunk to stay in cache between the read and the checksum.
+constexpr size_t kChecksumChunkSize = 1 << 20;  // 1MB
+
+// Maximum number of records whose checksums are verified in the background at
+// a time. The reader waits for the verification of older records past it.
+constexpr int kMaxPendingVerifications = 64;
+
 inline const char* GetChecksumErrorSuffix(uint64 offset) {
   if (offset == 0) {
     return " (Is this even a TFRecord file?)";
@@ -101,14 +138,27 @@ inline const char* GetChecksumErrorSuffix(uint64 offset) {
 // and is used only in error messages. For failures at offset 0,
 // a reminder about the file format is added, because TFRecord files
 // contain no explicit format marker.
-Status RecordReader::ReadChecksummed(uint64 offset, size_t n, tstring* result) {
+Status RecordReader::ReadChecksummed(uint64 offset, size_t n, tstring* result,
+                                     bool allow_background_verification) {
   if (n >= SIZE_MAX - sizeof(uint32)) {
     return errors::DataLoss("record size too large",
                             GetChecksumErrorSuffix(offset));
   }
 
   const size_t expected = n + sizeof(uint32);
-  TF_RETURN_IF_ERROR(input_stream_->ReadNBytes(expected, result));
+  const bool verify_in_background =
+      allow_background_verification && verification_thread_ != nullptr;
+  uint32 crc = 0;
+  if (verify_in_background) {
+    TF_RETURN_IF_ERROR(input_stream_->ReadNBytes(expected, result));
+  } else if (options_.compression_type == RecordReaderOptions::NONE) {
+    TF_RETURN_IF_ERROR(ReadAndChecksum(n, result, &crc));
+  } else {
+    TF_RETURN_IF_ERROR(input_stream_->ReadNBytes(expected, result));
+    if (result->size() == expected) {
+      crc = crc32c::Value(result->data(), n);
+    }
+  }
 
   if (result->size() != expected) {
     if (result->empty()) {
@@ -120,7 +170,9 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n, tstring* result) {
   }
 
   const uint32 masked_crc = core::DecodeFixed32(result->data() + n);
-  if (crc32c::Unmask(masked_crc) != crc32c::Value(result->data(), n)) {
+  if (verify_in_background) {
+    VerifyInBackground(offset, n, masked_crc);
+  } else if (crc32c::Unmask(masked_crc) != crc) {
     return errors::DataLoss("corrupted record at ", offset,
                             GetChecksumErrorSuffix(offset));
   }
@@ -128,6 +180,80 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n, tstring* result) {
   return OkStatus();
 }
 
+Status RecordReader::ReadAndChecksum(size_t n, tstring* result, uint32* crc) {
+  const size_t expected = n + sizeof(uint32);
+  result->clear();
+  result->resize_uninitialized(expected);
+  // Large records are read in chunks of at least the buffer size, so they skip
+  // the input buffer, and each chunk is checksummed while it is still in cache.
+  const size_t chunk_size =
+      std::max<size_t>(kChecksumChunkSize, options_.buffer_size);
+  char* data = &(*result)[0];
+  size_t bytes_read = 0;
+  *crc = 0;
+  Status s;
+  while (s.ok() && bytes_read < expected) {
+    size_t chunk_bytes_read = 0;
+    s = input_stream_->ReadNBytes(std::min(chunk_size, expected - bytes_read),
+                                  data + bytes_read, &chunk_bytes_read);
+    if (bytes_read < n) {
+      *crc = crc32c::Extend(*crc, data + bytes_read,
+                            std::min(chunk_bytes_read, n - bytes_read));
+    }
+    bytes_read += chunk_bytes_read;
+  }
+  result->resize(bytes_read);
+  return s;
+}
+
+void RecordReader::VerifyInBackground(uint64 offset, size_t n,
+                                      uint32 masked_crc) {
+  {
+    mutex_lock l(verification_mu_);
+    while (num_pending_verifications_ >= kMaxPendingVerifications) {
+      verification_cv_.wait(l);
+    }
+    ++num_pending_verifications_;
+  }
+  verification_thread_->Schedule([this, offset, n, masked_crc]() {
+    std::unique_ptr<char[]> buffer(
+        new char[std::min<size_t>(std::max<size_t>(n, 1), kChecksumChunkSize)]);
+    uint32 crc = 0;
+    Status s;
+    for (size_t bytes_read = 0; s.ok() && bytes_read < n;) {
+      const size_t chunk_size = std::min(n - bytes_read, kChecksumChunkSize);
+      StringPiece chunk;
+      s = file_->Read(offset + bytes_read, chunk_size, &chunk, buffer.get());
+      if (chunk.size() != chunk_size) {
+        // The file was truncated since the record was read.
+        if (s.ok() || errors::IsOutOfRange(s)) {
+          s = errors::DataLoss("truncated record at ", offset);
+        }
+        break;
+      }
+      s = OkStatus();
+      crc = crc32c::Extend(crc, chunk.data(), chunk.size());
+      bytes_read += chunk_size;
+    }
+    if (s.ok() && crc32c::Unmask(masked_crc) != crc) {
+      s = errors::DataLoss("corrupted record at ", offset,
+                           GetChecksumErrorSuffix(offset));
+    }
+    mutex_lock l(verification_mu_);
+    verification_status_.Update(s);
+    --num_pending_verifications_;
+    verification_cv_.notify_all();
+  });
+}
+
+Status RecordReader::BackgroundVerificationStatus(bool wait) {
+  mutex_lock l(verification_mu_);
+  while (wait && num_pending_verifications_ > 0) {
+    verification_cv_.wait(l);
+  }
+  return verification_status_;
+}
+
 Status RecordReader::GetMetadata(Metadata* md) {
   if (!md) {
     return errors::InvalidArgument(
@@ -197,18 +323,26 @@ Status RecordReader::PositionInputStream(uint64 offset) {
 }
 
 Status RecordReader::ReadRecord(uint64* offset, tstring* record) {
+  if (verification_thread_ != nullptr) {
+    TF_RETURN_IF_ERROR(BackgroundVerificationStatus(/*wait=*/false));
+  }
   TF_RETURN_IF_ERROR(PositionInputStream(*offset));
 
   // Read header data.
   Status s = ReadChecksummed(*offset, sizeof(uint64), record);
   if (!s.ok()) {
     last_read_failed_ = true;
+    if (errors::IsOutOfRange(s) && verification_thread_ != nullptr) {
+      // Report the corrupted records before the end of the file.
+      TF_RETURN_IF_ERROR(BackgroundVerificationStatus(/*wait=*/true));
+    }
     return s;
   }
   const uint64 length = core::DecodeFixed64(record->data());
 
   // Read data
-  s = ReadChecksummed(*offset + kHeaderSize, length, record);
+  s = ReadChecksummed(*offset + kHeaderSize, length, record,
+                      /*allow_background_verification=*/true);
   if (!s.ok()) {
     last_read_failed_ = true;
     if (errors::IsOutOfRange(s)) {
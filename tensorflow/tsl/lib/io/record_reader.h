@@ -20,12 +20,17 @@ limitations under the License.
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/stringpiece.h"
 #if !defined(IS_SLIM_BUILD)
+#include "tensorflow/tsl/lib/io/block_compressed_inputstream.h"
+#include "tensorflow/tsl/lib/io/block_compression_options.h"
 #include "tensorflow/tsl/lib/io/snappy/snappy_compression_options.h"
 #include "tensorflow/tsl/lib/io/snappy/snappy_inputstream.h"
 #include "tensorflow/tsl/lib/io/zlib_compression_options.h"
 #include "tensorflow/tsl/lib/io/zlib_inputstream.h"
 #endif  // IS_SLIM_BUILD
 #include "tensorflow/tsl/platform/macros.h"
+#include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/thread_annotations.h"
+#include "tensorflow/tsl/platform/threadpool.h"
 #include "tensorflow/tsl/platform/types.h"
 
 namespace tsl {
@@ -37,7 +42,9 @@ struct RecordReaderOptions {
   enum CompressionType {
     NONE = 0,
     ZLIB_COMPRESSION = 1,
-    SNAPPY_COMPRESSION = 2
+    SNAPPY_COMPRESSION = 2,
+    // Independently compressed blocks, see BlockCompressionOptions.
+    BLOCK_COMPRESSION = 3
   };
   CompressionType compression_type = NONE;
 
@@ -46,6 +53,12 @@ struct RecordReaderOptions {
   // compressed files.) Consider using SequentialRecordReader.
   int64_t buffer_size = 0;
 
+  // If true, the checksums of the data of uncompressed records are verified in
+  // a background thread, which reads the records from the file again, instead
+  // of before ReadRecord() returns them. A record that fails verification is
+  // reported by a later call, so this is meant for trusted local storage.
+  bool verify_checksums_in_background = false;
+
   static RecordReaderOptions CreateRecordReaderOptions(
       const string& compression_type);
 
@@ -53,6 +66,7 @@ struct RecordReaderOptions {
   // Options specific to compression.
   ZlibCompressionOptions zlib_options;
   SnappyCompressionOptions snappy_options;
+  BlockCompressionOptions block_compression_options;
 #endif  // IS_SLIM_BUILD
 };
 
@@ -89,11 +103,14 @@ class RecordReader {
       tsl::RandomAccessFile* file,
       const RecordReaderOptions& options = RecordReaderOptions());
 
-  virtual ~RecordReader() = default;
+  virtual ~RecordReader();
 
   // Read the record at "*offset" into *record and update *offset to
   // point to the offset of the next record.  Returns OK on success,
   // OUT_OF_RANGE for end of file, or something else for an error.
+  //
+  // With verify_checksums_in_background, returns DATA_LOSS if a record
+  // returned earlier turned out to be corrupted.
   Status ReadRecord(uint64* offset, tstring* record);
 
   // Skip num_to_skip record starting at "*offset" and update *offset
@@ -115,15 +132,36 @@ class RecordReader {
   Status GetMetadata(Metadata* md);
 
  private:
-  Status ReadChecksummed(uint64 offset, size_t n, tstring* result);
+  // If `allow_background_verification`, the checksum may be verified by
+  // VerifyInBackground() instead.
+  Status ReadChecksummed(uint64 offset, size_t n, tstring* result,
+                         bool allow_background_verification = false);
+  // Reads n+4 bytes from an uncompressed file into *result and computes the
+  // crc32c of the first n bytes in the same pass.
+  Status ReadAndChecksum(size_t n, tstring* result, uint32* crc);
   Status PositionInputStream(uint64 offset);
 
+  // Verifies that the n bytes of the file at offset have the checksum
+  // masked_crc in the background.
+  void VerifyInBackground(uint64 offset, size_t n, uint32 masked_crc);
+  // Returns the first error of the background verifications, after waiting
+  // for those in progress if `wait`.
+  Status BackgroundVerificationStatus(bool wait);
+
   RecordReaderOptions options_;
+  RandomAccessFile* const file_;
   std::unique_ptr<InputStreamInterface> input_stream_;
   bool last_read_failed_;
 
   std::unique_ptr<Metadata> cached_metadata_;
 
+  // Set if the checksums are verified in the background.
+  std::unique_ptr<thread::ThreadPool> verification_thread_;
+  mutex verification_mu_;
+  condition_variable verification_cv_;
+  int num_pending_verifications_ TF_GUARDED_BY(verification_mu_) = 0;
+  Status verification_status_ TF_GUARDED_BY(verification_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(RecordReader);
 };
 
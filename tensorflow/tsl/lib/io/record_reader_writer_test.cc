@@ -24,6 +24,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/lib/io/compression.h"
 #include "tensorflow/tsl/platform/env.h"
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/logging.h"
@@ -162,6 +163,123 @@ TEST(RecordReaderWriterTest, TestBasics) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestLargeRecords) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_large_test";
+  // Larger than the chunks the reader checksums at a time.
+  string large_record(3 * 1024 * 1024 + 7, 'a');
+  for (size_t i = 0; i < large_record.size(); i += 4096) {
+    large_record[i] = static_cast<char>(i / 4096);
+  }
+
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_EXPECT_OK(writer.WriteRecord(large_record));
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_CHECK_OK(writer.Flush());
+  }
+
+  for (int64_t buf_size : {0, 1, 256 * 1024, 4 * 1024 * 1024}) {
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReaderOptions options;
+    options.buffer_size = buf_size;
+    io::RecordReader reader(read_file.get(), options);
+    uint64 offset = 0;
+    tstring record;
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("abc", record);
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ(large_record, record);
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("defg", record);
+    EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+  }
+
+  {
+    // Corrupt one byte in the last chunk of the large record.
+    string contents;
+    TF_CHECK_OK(ReadFileToString(env, fname, &contents));
+    const size_t large_record_offset =
+        io::RecordReader::kHeaderSize + 3 + io::RecordReader::kFooterSize +
+        io::RecordReader::kHeaderSize;
+    contents[large_record_offset + large_record.size() - 1] ^= 1;
+    TF_CHECK_OK(WriteStringToFile(env, fname, contents));
+  }
+
+  for (int64_t buf_size : {0, 256 * 1024}) {
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReaderOptions options;
+    options.buffer_size = buf_size;
+    io::RecordReader reader(read_file.get(), options);
+    uint64 offset = 0;
+    tstring record;
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    Status s = reader.ReadRecord(&offset, &record);
+    EXPECT_EQ(error::DATA_LOSS, s.code()) << s;
+  }
+}
+
+TEST(RecordReaderWriterTest, TestBackgroundVerification) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_verify_test";
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_EXPECT_OK(writer.WriteRecord("hij"));
+    TF_CHECK_OK(writer.Flush());
+  }
+
+  io::RecordReaderOptions options;
+  options.verify_checksums_in_background = true;
+  {
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReader reader(read_file.get(), options);
+    uint64 offset = 0;
+    tstring record;
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("abc", record);
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("defg", record);
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("hij", record);
+    EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+  }
+
+  {
+    // Corrupt the data of the second record.
+    string contents;
+    TF_CHECK_OK(ReadFileToString(env, fname, &contents));
+    contents[2 * io::RecordReader::kHeaderSize + 3 +
+             io::RecordReader::kFooterSize] ^= 1;
+    TF_CHECK_OK(WriteStringToFile(env, fname, contents));
+  }
+
+  {
+    // The corruption is reported by a later read, at the latest at the end of
+    // the file.
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReader reader(read_file.get(), options);
+    uint64 offset = 0;
+    tstring record;
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("abc", record);
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    Status s;
+    while (s.ok()) s = reader.ReadRecord(&offset, &record);
+    EXPECT_EQ(error::DATA_LOSS, s.code()) << s;
+  }
+}
+
 TEST(RecordReaderWriterTest, TestSkipBasic) {
   Env* env = Env::Default();
   string fname = testing::TmpDir() + "/record_reader_writer_skip_basic_test";
@@ -305,6 +423,47 @@ TEST(RecordReaderWriterTest, TestSnappy) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestBlockCompression) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_block_test";
+
+  for (const char* compression_type :
+       {io::compression::kBlockSnappy, io::compression::kBlockZlib}) {
+    {
+      std::unique_ptr<WritableFile> file;
+      TF_CHECK_OK(env->NewWritableFile(fname, &file));
+      io::RecordWriterOptions options =
+          io::RecordWriterOptions::CreateRecordWriterOptions(compression_type);
+      options.block_compression_options.block_size = 100;
+      io::RecordWriter writer(file.get(), options);
+      for (int i = 0; i < 100; ++i) {
+        TF_EXPECT_OK(writer.WriteRecord(strings::StrCat("record ", i)));
+      }
+      TF_CHECK_OK(writer.Close());
+    }
+
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReaderOptions options =
+        io::RecordReaderOptions::CreateRecordReaderOptions(compression_type);
+    io::RecordReader reader(read_file.get(), options);
+    uint64 offset = 0;
+    uint64 offset_of_record_50 = 0;
+    tstring record;
+    for (int i = 0; i < 100; ++i) {
+      if (i == 50) offset_of_record_50 = offset;
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+      EXPECT_EQ(strings::StrCat("record ", i), record);
+    }
+    EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+
+    // Seeking back skips the blocks before the record.
+    offset = offset_of_record_50;
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("record 50", record);
+  }
+}
+
 TEST(RecordReaderWriterTest, TestZlib) {
   Env* env = Env::Default();
   string fname = testing::TmpDir() + "/record_reader_writer_zlib_test";
@@ -30,6 +30,10 @@ bool IsZlibCompressed(const RecordWriterOptions& options) {
 bool IsSnappyCompressed(const RecordWriterOptions& options) {
   return options.compression_type == RecordWriterOptions::SNAPPY_COMPRESSION;
 }
+
+bool IsBlockCompressed(const RecordWriterOptions& options) {
+  return options.compression_type == RecordWriterOptions::BLOCK_COMPRESSION;
+}
 }  // namespace
 
 RecordWriterOptions RecordWriterOptions::CreateRecordWriterOptions(
@@ -49,6 +53,12 @@ RecordWriterOptions RecordWriterOptions::CreateRecordWriterOptions(
     options.zlib_options = io::ZlibCompressionOptions::GZIP();
   } else if (compression_type == compression::kSnappy) {
     options.compression_type = io::RecordWriterOptions::SNAPPY_COMPRESSION;
+  } else if (compression_type == compression::kBlockSnappy) {
+    options.compression_type = io::RecordWriterOptions::BLOCK_COMPRESSION;
+    options.block_compression_options.codec = BlockCompressionOptions::SNAPPY;
+  } else if (compression_type == compression::kBlockZlib) {
+    options.compression_type = io::RecordWriterOptions::BLOCK_COMPRESSION;
+    options.block_compression_options.codec = BlockCompressionOptions::ZLIB;
   } else if (compression_type != compression::kNone) {
     LOG(ERROR) << "Unsupported compression_type:" << compression_type
                << ". No compression will be used.";
@@ -79,6 +89,9 @@ RecordWriter::RecordWriter(WritableFile* dest,
     dest_ =
         new SnappyOutputBuffer(dest, options.snappy_options.input_buffer_size,
                                options.snappy_options.output_buffer_size);
+  } else if (IsBlockCompressed(options)) {
+    dest_ = new BlockCompressedOutputBuffer(dest,
+                                            options.block_compression_options);
   } else if (options.compression_type == RecordWriterOptions::NONE) {
     // Nothing to do
   } else {
@@ -138,7 +151,8 @@ Status RecordWriter::WriteRecord(const absl::Cord& data) {
 
 Status RecordWriter::Close() {
   if (dest_ == nullptr) return OkStatus();
-  if (IsZlibCompressed(options_) || IsSnappyCompressed(options_)) {
+  if (IsZlibCompressed(options_) || IsSnappyCompressed(options_) ||
+      IsBlockCompressed(options_)) {
     Status s = dest_->Close();
     delete dest_;
     dest_ = nullptr;
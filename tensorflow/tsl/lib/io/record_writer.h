@@ -21,6 +21,8 @@ limitations under the License.
 #include "tensorflow/tsl/platform/status.h"
 #include "tensorflow/tsl/platform/stringpiece.h"
 #if !defined(IS_SLIM_BUILD)
+#include "tensorflow/tsl/lib/io/block_compressed_outputbuffer.h"
+#include "tensorflow/tsl/lib/io/block_compression_options.h"
 #include "tensorflow/tsl/lib/io/snappy/snappy_compression_options.h"
 #include "tensorflow/tsl/lib/io/snappy/snappy_outputbuffer.h"
 #include "tensorflow/tsl/lib/io/zlib_compression_options.h"
@@ -41,7 +43,9 @@ struct RecordWriterOptions {
   enum CompressionType {
     NONE = 0,
     ZLIB_COMPRESSION = 1,
-    SNAPPY_COMPRESSION = 2
+    SNAPPY_COMPRESSION = 2,
+    // Independently compressed blocks, see BlockCompressionOptions.
+    BLOCK_COMPRESSION = 3
   };
   CompressionType compression_type = NONE;
 
@@ -52,6 +56,7 @@ struct RecordWriterOptions {
   // Options specific to compression.
   io::ZlibCompressionOptions zlib_options;
   io::SnappyCompressionOptions snappy_options;
+  io::BlockCompressionOptions block_compression_options;
 #endif  // IS_SLIM_BUILD
 };
 
@@ -139,19 +139,17 @@ Status ZlibInputStream::ReadFromStream() {
     bytes_to_read -= z_stream_def_->stream->avail_in;
     read_location += z_stream_def_->stream->avail_in;
   }
-  tstring data;
   // Try to read enough data to fill up z_stream_def_->input.
-  // TODO(rohanj): Add a char* version of ReadNBytes to InputStreamInterface
-  // and use that instead to make this more efficient.
-  Status s = input_stream_->ReadNBytes(bytes_to_read, &data);
-  memcpy(read_location, data.data(), data.size());
+  size_t bytes_read = 0;
+  Status s = input_stream_->ReadNBytes(bytes_to_read, read_location,
+                                       &bytes_read);
 
   // Since we moved unread data to the head of the input stream we can point
   // next_in to the head of the input stream.
   z_stream_def_->stream->next_in = z_stream_def_->input.get();
 
-  // Note: data.size() could be different from bytes_to_read.
-  z_stream_def_->stream->avail_in += data.size();
+  // Note: bytes_read could be different from bytes_to_read.
+  z_stream_def_->stream->avail_in += bytes_read;
 
   if (!s.ok() && !errors::IsOutOfRange(s)) {
     return s;
@@ -162,7 +160,7 @@ Status ZlibInputStream::ReadFromStream() {
   // possible that on the last read there isn't enough data in the stream to
   // fill up the buffer in which case input_stream_->ReadNBytes would return an
   // OutOfRange error.
-  if (data.empty()) {
+  if (bytes_read == 0) {
     return errors::OutOfRange("EOF reached");
   }
   if (errors::IsOutOfRange(s)) {
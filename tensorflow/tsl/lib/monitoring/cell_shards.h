@@ -0,0 +1,46 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_MONITORING_CELL_SHARDS_H_
+#define TENSORFLOW_TSL_LIB_MONITORING_CELL_SHARDS_H_
+
+#include <atomic>
+
+namespace tsl {
+namespace monitoring {
+namespace internal {
+
+// The number of shards the values of counter and sampler cells are split
+// into, so that threads updating the same cell mostly touch different cache
+// lines. The shards are merged when the cell is read.
+constexpr int kNumCellShards = 8;
+
+// The size of the cache lines the shards are aligned to.
+constexpr int kCellShardAlignment = 64;
+
+// Returns the shard of the calling thread. Threads are assigned shards
+// round-robin when they first update a cell.
+inline int CurrentCellShard() {
+  static std::atomic<unsigned> next_shard{0};
+  static thread_local const int shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kNumCellShards;
+  return shard;
+}
+
+}  // namespace internal
+}  // namespace monitoring
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_MONITORING_CELL_SHARDS_H_
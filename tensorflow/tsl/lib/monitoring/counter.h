@@ -82,6 +82,7 @@ class Counter {
 #include <memory>
 #include <tuple>
 
+#include "tensorflow/tsl/lib/monitoring/cell_shards.h"
 #include "tensorflow/tsl/lib/monitoring/collection_registry.h"
 #include "tensorflow/tsl/lib/monitoring/metric_def.h"
 #include "tensorflow/tsl/platform/logging.h"
@@ -101,10 +102,13 @@ namespace monitoring {
 // to which both cells belong) and performance (since map indexing and
 // associated locking are both avoided).
 //
+// The value is split into shards updated by different threads, so that
+// incrementing a cell from many threads doesn't contend on a single cache line.
+//
 // This class is thread-safe.
 class CounterCell {
  public:
-  explicit CounterCell(int64_t value) : value_(value) {}
+  explicit CounterCell(int64_t value) { shards_[0].value = value; }
   ~CounterCell() {}
 
   // Atomically increments the value by step.
@@ -115,7 +119,10 @@ class CounterCell {
   int64_t value() const;
 
  private:
-  std::atomic<int64_t> value_;
+  struct alignas(internal::kCellShardAlignment) Shard {
+    std::atomic<int64_t> value{0};
+  };
+  std::array<Shard, internal::kNumCellShards> shards_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(CounterCell);
 };
@@ -198,10 +205,17 @@ class Counter {
 
 inline void CounterCell::IncrementBy(const int64_t step) {
   DCHECK_LE(0, step) << "Must not decrement cumulative metrics.";
-  value_ += step;
+  shards_[internal::CurrentCellShard()].value.fetch_add(
+      step, std::memory_order_relaxed);
 }
 
-inline int64_t CounterCell::value() const { return value_; }
+inline int64_t CounterCell::value() const {
+  int64_t value = 0;
+  for (const Shard& shard : shards_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
 
 template <int NumLabels>
 template <typename... MetricDefArgs>
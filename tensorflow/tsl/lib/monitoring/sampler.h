@@ -112,6 +112,8 @@ class Sampler {
 
 #include <float.h>
 
+#include <algorithm>
+#include <array>
 #include <map>
 #include <memory>
 #include <tuple>
@@ -119,6 +121,7 @@ class Sampler {
 #include <vector>
 
 #include "tensorflow/tsl/lib/histogram/histogram.h"
+#include "tensorflow/tsl/lib/monitoring/cell_shards.h"
 #include "tensorflow/tsl/lib/monitoring/collection_registry.h"
 #include "tensorflow/tsl/lib/monitoring/metric_def.h"
 #include "tensorflow/tsl/platform/macros.h"
@@ -139,11 +142,18 @@ using tensorflow::HistogramProto;
 // to which both cells belong) and performance (since map indexing and
 // associated locking are both avoided).
 //
+// The histogram is split into shards updated by different threads, each with
+// its own lock, so that adding samples to a cell from many threads doesn't
+// contend on a single lock. The shards are merged when the value is read.
+//
 // This class is thread-safe.
 class SamplerCell {
  public:
-  explicit SamplerCell(const std::vector<double>& bucket_limits)
-      : histogram_(bucket_limits) {}
+  explicit SamplerCell(const std::vector<double>& bucket_limits) {
+    for (auto& shard : shards_) {
+      shard = std::make_unique<Shard>(bucket_limits);
+    }
+  }
 
   ~SamplerCell() {}
 
@@ -154,7 +164,12 @@ class SamplerCell {
   HistogramProto value() const;
 
  private:
-  histogram::ThreadSafeHistogram histogram_;
+  struct alignas(internal::kCellShardAlignment) Shard {
+    explicit Shard(const std::vector<double>& bucket_limits)
+        : histogram(bucket_limits) {}
+    histogram::ThreadSafeHistogram histogram;
+  };
+  std::array<std::unique_ptr<Shard>, internal::kNumCellShards> shards_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(SamplerCell);
 };
@@ -282,11 +297,28 @@ class Sampler {
 //  Implementation details follow. API readers may skip.
 ////
 
-inline void SamplerCell::Add(const double sample) { histogram_.Add(sample); }
+inline void SamplerCell::Add(const double sample) {
+  shards_[internal::CurrentCellShard()]->histogram.Add(sample);
+}
 
 inline HistogramProto SamplerCell::value() const {
   HistogramProto pb;
-  histogram_.EncodeToProto(&pb, true /* preserve_zero_buckets */);
+  shards_[0]->histogram.EncodeToProto(&pb, true /* preserve_zero_buckets */);
+  // The shards have the same buckets, since zero buckets are preserved.
+  HistogramProto shard_pb;
+  for (int i = 1; i < internal::kNumCellShards; ++i) {
+    shards_[i]->histogram.EncodeToProto(&shard_pb,
+                                        true /* preserve_zero_buckets */);
+    if (shard_pb.num() == 0) continue;
+    pb.set_min(std::min(pb.min(), shard_pb.min()));
+    pb.set_max(std::max(pb.max(), shard_pb.max()));
+    pb.set_num(pb.num() + shard_pb.num());
+    pb.set_sum(pb.sum() + shard_pb.sum());
+    pb.set_sum_squares(pb.sum_squares() + shard_pb.sum_squares());
+    for (int j = 0; j < pb.bucket_size(); ++j) {
+      pb.set_bucket(j, pb.bucket(j) + shard_pb.bucket(j));
+    }
+  }
   return pb;
 }
 
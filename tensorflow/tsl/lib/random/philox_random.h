@@ -190,6 +190,47 @@ class PhiloxRandom {
     return counter;
   }
 
+  // Fills `results` with the next `kBatchSize` groups of four random numbers,
+  // i.e. the groups that `kBatchSize` calls to operator() would return. The
+  // groups are computed in lockstep, so that the compiler vectorizes the
+  // rounds across them, e.g. 8 groups at a time with AVX2.
+  template <int kBatchSize>
+  PHILOX_DEVICE_INLINE void GenerateBatch(ResultType* results) {
+    uint32_t c0[kBatchSize];
+    uint32_t c1[kBatchSize];
+    uint32_t c2[kBatchSize];
+    uint32_t c3[kBatchSize];
+    for (int i = 0; i < kBatchSize; ++i) {
+      c0[i] = counter_[0];
+      c1[i] = counter_[1];
+      c2[i] = counter_[2];
+      c3[i] = counter_[3];
+      SkipOne();
+    }
+    Key key = key_;
+    for (int round = 0; round < 10; ++round) {
+      for (int i = 0; i < kBatchSize; ++i) {
+        uint32_t lo0;
+        uint32_t hi0;
+        MultiplyHighLow(kPhiloxM4x32A, c0[i], &lo0, &hi0);
+        uint32_t lo1;
+        uint32_t hi1;
+        MultiplyHighLow(kPhiloxM4x32B, c2[i], &lo1, &hi1);
+        c0[i] = hi1 ^ c1[i] ^ key[0];
+        c1[i] = lo1;
+        c2[i] = hi0 ^ c3[i] ^ key[1];
+        c3[i] = lo0;
+      }
+      RaiseKey(&key);
+    }
+    for (int i = 0; i < kBatchSize; ++i) {
+      results[i][0] = c0[i];
+      results[i][1] = c1[i];
+      results[i][2] = c2[i];
+      results[i][3] = c3[i];
+    }
+  }
+
  private:
   // We use the same constants as recommended by the original paper.
   static constexpr uint32_t kPhiloxW32A = 0x9E3779B9;
@@ -69,6 +69,39 @@ TEST(PhiloxRandomTest, SkipMatchTest) {
   }
 }
 
+// This test checks that generating a batch of samples is equivalent to
+// generating them one group at a time, including across counter carries.
+TEST(PhiloxRandomTest, GenerateBatchMatchTest) {
+  constexpr int kBatchSize = 16;
+  for (uint32 counter_lo : {0u, 0xFFFFFFF8u}) {
+    PhiloxRandom::ResultType counter;
+    counter[0] = counter_lo;
+    counter[1] = 0xFFFFFFFF;
+    counter[2] = 7;
+    counter[3] = 0;
+    PhiloxRandom::Key key;
+    key[0] = static_cast<uint32>(GetTestSeed());
+    key[1] = 42;
+
+    PhiloxRandom batch_gen(counter, key);
+    PhiloxRandom::ResultType batch[kBatchSize];
+    batch_gen.GenerateBatch<kBatchSize>(batch);
+    PhiloxRandom gen(counter, key);
+    for (int i = 0; i < kBatchSize; ++i) {
+      PhiloxRandom::ResultType expected = gen();
+      for (int j = 0; j < PhiloxRandom::kResultElementCount; ++j) {
+        ASSERT_EQ(batch[i][j], expected[j]);
+      }
+    }
+    // Both generators are at the same point of the stream afterwards.
+    PhiloxRandom::ResultType next = batch_gen();
+    PhiloxRandom::ResultType expected = gen();
+    for (int j = 0; j < PhiloxRandom::kResultElementCount; ++j) {
+      ASSERT_EQ(next[j], expected[j]);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace random
 }  // namespace tsl
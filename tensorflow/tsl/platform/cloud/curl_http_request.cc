@@ -16,12 +16,15 @@ limitations under the License.
 #include "tensorflow/tsl/platform/cloud/curl_http_request.h"
 
 #include <algorithm>
+#include <unordered_map>
 
 #include "tensorflow/tsl/lib/gtl/map_util.h"
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/macros.h"
+#include "tensorflow/tsl/platform/mutex.h"
 #include "tensorflow/tsl/platform/scanner.h"
 #include "tensorflow/tsl/platform/str_util.h"
+#include "tensorflow/tsl/platform/thread_annotations.h"
 #include "tensorflow/tsl/platform/types.h"
 #include "tensorflow/tsl/util/env_var.h"
 
@@ -113,9 +116,105 @@ class LibCurlProxy : public LibCurl {
 
   void curl_free(void* p) override { ::curl_free(p); }
 };
+
+// A curl share handle through which the requests reuse the connections, the
+// TLS sessions and the DNS cache of each other, instead of opening and closing
+// a connection per request. This includes the addresses that GcsDnsCache
+// resolves for the requests.
+class CurlShare {
+ public:
+  // Returns nullptr if the share handle couldn't be created.
+  static CURLSH* Get() {
+    static CurlShare* share = new CurlShare;
+    return share->share_;
+  }
+
+ private:
+  CurlShare() : share_(curl_share_init()) {
+    if (share_ == nullptr) {
+      LOG(WARNING) << "Couldn't initialize a curl share handle, the HTTP "
+                      "requests won't share their connections.";
+      return;
+    }
+    CHECK_EQ(curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &CurlShare::Lock),
+             CURLSHE_OK);
+    CHECK_EQ(
+        curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &CurlShare::Unlock),
+        CURLSHE_OK);
+    CHECK_EQ(curl_share_setopt(share_, CURLSHOPT_USERDATA, this), CURLSHE_OK);
+    for (curl_lock_data data : {CURL_LOCK_DATA_DNS, CURL_LOCK_DATA_SSL_SESSION,
+                                CURL_LOCK_DATA_CONNECT}) {
+      CHECK_EQ(curl_share_setopt(share_, CURLSHOPT_SHARE, data), CURLSHE_OK);
+    }
+  }
+
+  // Serialize the accesses of concurrent requests to each kind of shared data.
+  static void Lock(CURL* curl, curl_lock_data data, curl_lock_access access,
+                   void* share) TF_NO_THREAD_SAFETY_ANALYSIS {
+    static_cast<CurlShare*>(share)->mu_[data].lock();
+  }
+  static void Unlock(CURL* curl, curl_lock_data data,
+                     void* share) TF_NO_THREAD_SAFETY_ANALYSIS {
+    static_cast<CurlShare*>(share)->mu_[data].unlock();
+  }
+
+  CURLSH* const share_;
+  mutex mu_[CURL_LOCK_DATA_LAST];
+};
+
+// Limits the number of requests in flight to each host, and so the number of
+// connections open to it. The limit is read from TF_CURL_MAX_HOST_CONNECTIONS
+// by each request, 0 meaning no limit.
+class HostConnectionLimiter {
+ public:
+  static HostConnectionLimiter* Get() {
+    static HostConnectionLimiter* limiter = new HostConnectionLimiter;
+    return limiter;
+  }
+
+  void Acquire(const string& host, int64_t max_connections) {
+    mutex_lock l(mu_);
+    while (connections_[host] >= max_connections) {
+      cv_.wait(l);
+    }
+    ++connections_[host];
+  }
+
+  void Release(const string& host) {
+    mutex_lock l(mu_);
+    if (--connections_[host] == 0) {
+      connections_.erase(host);
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  mutex mu_;
+  condition_variable cv_;
+  std::unordered_map<string, int64_t> connections_ TF_GUARDED_BY(mu_);
+};
+
+// Returns the host, and the port if any, of `uri`.
+string GetHost(StringPiece uri) {
+  const size_t scheme_end = uri.find("://");
+  if (scheme_end != StringPiece::npos) {
+    uri.remove_prefix(scheme_end + 3);
+  }
+  return string(uri.substr(0, uri.find_first_of("/?#")));
+}
+
 }  // namespace
 
-CurlHttpRequest::CurlHttpRequest() : CurlHttpRequest(LibCurlProxy::Load()) {}
+CurlHttpRequest::CurlHttpRequest() : CurlHttpRequest(LibCurlProxy::Load()) {
+  // Only the requests of the actual libcurl can share its handles.
+  bool share_connections = true;
+  TF_CHECK_OK(ReadBoolFromEnvVar("TF_CURL_SHARE_CONNECTIONS",
+                                 /*default_val=*/true, &share_connections));
+  CURLSH* share = share_connections ? CurlShare::Get() : nullptr;
+  if (share != nullptr) {
+    CHECK_CURL_OK(libcurl_->curl_easy_setopt(curl_, CURLOPT_SHARE, share));
+  }
+}
 
 CurlHttpRequest::CurlHttpRequest(LibCurl* libcurl, Env* env)
     : libcurl_(libcurl), env_(env) {
@@ -140,9 +239,17 @@ CurlHttpRequest::CurlHttpRequest(LibCurl* libcurl, Env* env)
   // Do not use signals for timeouts - does not work in multi-threaded programs.
   CHECK_CURL_OK(libcurl_->curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L));
 
-  // TODO(b/74351157): Enable HTTP/2.
-  CHECK_CURL_OK(libcurl_->curl_easy_setopt(curl_, CURLOPT_HTTP_VERSION,
-                                           CURL_HTTP_VERSION_1_1));
+  // HTTP/2 is opt-in, and libcurl may be built without it, in which case the
+  // requests fall back to HTTP/1.1.
+  bool use_http2 = false;
+  TF_CHECK_OK(ReadBoolFromEnvVar("TF_CURL_HTTP2", /*default_val=*/false,
+                                 &use_http2));
+  if (!use_http2 ||
+      libcurl_->curl_easy_setopt(curl_, CURLOPT_HTTP_VERSION,
+                                 CURL_HTTP_VERSION_2TLS) != CURLE_OK) {
+    CHECK_CURL_OK(libcurl_->curl_easy_setopt(curl_, CURLOPT_HTTP_VERSION,
+                                             CURL_HTTP_VERSION_1_1));
+  }
 
   // Set up the progress meter.
   CHECK_CURL_OK(
@@ -444,7 +551,17 @@ Status CurlHttpRequest::Send() {
     stats_->RecordRequest(this, uri_, method_);
   }
 
+  int64_t max_host_connections = 0;
+  TF_CHECK_OK(ReadInt64FromEnvVar("TF_CURL_MAX_HOST_CONNECTIONS",
+                                  /*default_val=*/0, &max_host_connections));
+  const string host = max_host_connections > 0 ? GetHost(uri_) : "";
+  if (max_host_connections > 0) {
+    HostConnectionLimiter::Get()->Acquire(host, max_host_connections);
+  }
   const CURLcode curl_result = libcurl_->curl_easy_perform(curl_);
+  if (max_host_connections > 0) {
+    HostConnectionLimiter::Get()->Release(host);
+  }
   TF_RETURN_IF_ERROR(CURLcodeToStatus(curl_result, error_buffer));
 
   double written_size = 0;
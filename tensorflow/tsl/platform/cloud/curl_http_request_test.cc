@@ -67,6 +67,12 @@ class FakeLibCurl : public LibCurl {
       case CURLOPT_PUT:
         is_put_ = param;
         break;
+      case CURLOPT_HTTP_VERSION:
+        if (param == CURL_HTTP_VERSION_2TLS && !http2_supported_) {
+          return CURLE_UNSUPPORTED_PROTOCOL;
+        }
+        http_version_ = param;
+        break;
       default:
         break;
     }
@@ -245,6 +251,8 @@ class FakeLibCurl : public LibCurl {
   std::vector<string>* headers_ = nullptr;
   bool is_post_ = false;
   bool is_put_ = false;
+  uint64 http_version_ = CURL_HTTP_VERSION_NONE;
+  bool http2_supported_ = true;
   void* write_data_ = nullptr;
   size_t (*write_callback_)(const void* ptr, size_t size, size_t nmemb,
                             void* userdata) = nullptr;
@@ -357,6 +365,42 @@ TEST(CurlHttpRequestTest, GetRequest_CustomCaInfoFlag) {
   EXPECT_EQ(200, http_request.GetResponseCode());
 }
 
+TEST(CurlHttpRequestTest, GetRequest_Http2) {
+  FakeLibCurl libcurl("get response", 200);
+  {
+    CurlHttpRequest http_request(&libcurl);
+    EXPECT_EQ(CURL_HTTP_VERSION_1_1, libcurl.http_version_);
+  }
+
+  setenv("TF_CURL_HTTP2", "true", 1);
+  {
+    CurlHttpRequest http_request(&libcurl);
+    EXPECT_EQ(CURL_HTTP_VERSION_2TLS, libcurl.http_version_);
+  }
+  // Fall back to HTTP/1.1 if libcurl doesn't support HTTP/2.
+  libcurl.http2_supported_ = false;
+  {
+    CurlHttpRequest http_request(&libcurl);
+    EXPECT_EQ(CURL_HTTP_VERSION_1_1, libcurl.http_version_);
+  }
+  unsetenv("TF_CURL_HTTP2");
+}
+
+TEST(CurlHttpRequestTest, GetRequest_MaxHostConnections) {
+  setenv("TF_CURL_MAX_HOST_CONNECTIONS", "1", 1);
+  // The requests to a host are sent one after the other.
+  for (int i = 0; i < 2; ++i) {
+    FakeLibCurl libcurl("get response", 200);
+    CurlHttpRequest http_request(&libcurl);
+    std::vector<char> scratch;
+    http_request.SetUri("http://www.testuri.com/path");
+    http_request.SetResultBuffer(&scratch);
+    TF_EXPECT_OK(http_request.Send());
+    EXPECT_EQ("get response", string(scratch.begin(), scratch.end()));
+  }
+  unsetenv("TF_CURL_MAX_HOST_CONNECTIONS");
+}
+
 TEST(CurlHttpRequestTest, GetRequest_Direct_ResponseTooLarge) {
   FakeLibCurl libcurl("get response", 200);
   CurlHttpRequest http_request(&libcurl);
@@ -53,6 +53,7 @@ limitations under the License.
 #include "tensorflow/tsl/platform/str_util.h"
 #include "tensorflow/tsl/platform/stringprintf.h"
 #include "tensorflow/tsl/platform/thread_annotations.h"
+#include "tensorflow/tsl/platform/threadpool.h"
 #include "tensorflow/tsl/profiler/lib/traceme.h"
 
 #ifdef _WIN32
@@ -159,6 +160,11 @@ constexpr char kAppendMode[] = "GCS_APPEND_MODE";
 // default as the multiple API calls required add a risk of stranding temporary
 // objects.
 constexpr char kComposeAppend[] = "compose";
+// The maximum number of source objects of a GCS compose request.
+constexpr int kMaxComposeSources = 32;
+// The size of the buffer used to copy the parts of parallel composite uploads
+// to their own temporary files.
+constexpr size_t kPartCopyBufferSize = 1024 * 1024;
 
 Status GetTmpFilename(string* filename) {
   *filename = io::GetTempFilename("");
@@ -469,6 +475,7 @@ class GcsWritableFile : public WritableFile {
                   GcsFileSystem::TimeoutConfig* timeouts,
                   std::function<void()> file_cache_erase,
                   RetryConfig retry_config, bool compose_append,
+                  uint64 parallel_upload_part_size, int parallel_upload_threads,
                   SessionCreator session_creator,
                   ObjectUploader object_uploader, StatusPoller status_poller,
                   GenerationGetter generation_getter)
@@ -480,6 +487,8 @@ class GcsWritableFile : public WritableFile {
         sync_needed_(true),
         retry_config_(retry_config),
         compose_append_(compose_append),
+        parallel_upload_part_size_(parallel_upload_part_size),
+        parallel_upload_threads_(parallel_upload_threads),
         start_offset_(0),
         session_creator_(std::move(session_creator)),
         object_uploader_(std::move(object_uploader)),
@@ -503,6 +512,7 @@ class GcsWritableFile : public WritableFile {
                   GcsFileSystem::TimeoutConfig* timeouts,
                   std::function<void()> file_cache_erase,
                   RetryConfig retry_config, bool compose_append,
+                  uint64 parallel_upload_part_size, int parallel_upload_threads,
                   SessionCreator session_creator,
                   ObjectUploader object_uploader, StatusPoller status_poller,
                   GenerationGetter generation_getter)
@@ -514,6 +524,8 @@ class GcsWritableFile : public WritableFile {
         sync_needed_(true),
         retry_config_(retry_config),
         compose_append_(compose_append),
+        parallel_upload_part_size_(parallel_upload_part_size),
+        parallel_upload_threads_(parallel_upload_threads),
         start_offset_(0),
         session_creator_(std::move(session_creator)),
         object_uploader_(std::move(object_uploader)),
@@ -528,6 +540,7 @@ class GcsWritableFile : public WritableFile {
 
   ~GcsWritableFile() override {
     Close().IgnoreError();
+    ClearParts().IgnoreError();
     std::remove(tmp_content_filename_.c_str());
   }
 
@@ -540,6 +553,11 @@ class GcsWritableFile : public WritableFile {
       return errors::Internal(
           "Could not append to the internal temporary file.");
     }
+    if (parallel_upload_enabled()) {
+      // Upload the parts buffered so far while the rest of the file is
+      // written.
+      TF_RETURN_IF_ERROR(ScheduleFullParts());
+    }
     return OkStatus();
   }
 
@@ -599,6 +617,13 @@ class GcsWritableFile : public WritableFile {
       return errors::Internal(
           "Could not write to the internal temporary file.");
     }
+    if (parallel_upload_enabled()) {
+      uint64 file_size;
+      TF_RETURN_IF_ERROR(GetCurrentFileSize(&file_size));
+      if (!parts_.empty() || file_size > parallel_upload_part_size_) {
+        return ParallelSyncImpl(file_size);
+      }
+    }
     UploadSessionHandle session_handle;
     uint64 start_offset = 0;
     string object_to_upload = object_;
@@ -658,6 +683,219 @@ class GcsWritableFile : public WritableFile {
     return upload_status;
   }
 
+  /// \brief Uploads the file to GCS in a parallel composite upload.
+  ///
+  /// The parts of the file are uploaded concurrently to temporary objects,
+  /// each one with its own resumable upload session and retries, and these are
+  /// then composed into the object. The full parts are usually scheduled by
+  /// Append() already, so only the rest of the file is left to upload.
+  Status ParallelSyncImpl(uint64 file_size) {
+    Status status = ScheduleFullParts();
+    const uint64 scheduled_size = parts_.size() * parallel_upload_part_size_;
+    if (status.ok() && file_size > scheduled_size) {
+      status = SchedulePart(scheduled_size, file_size - scheduled_size);
+    }
+    const int num_parts = parts_.size();
+    // The parts are uploaded again on the next sync, since the last one may
+    // grow in between.
+    status.Update(ClearParts());
+    if (errors::IsNotFound(status)) {
+      // As in SyncImpl(), rely on the RetryingFileSystem to retry the upload.
+      return errors::Unavailable(strings::StrCat(
+          "Upload to gs://", bucket_, "/", object_,
+          " failed, caused by: ", status.error_message()));
+    }
+    TF_RETURN_IF_ERROR(status);
+    TF_RETURN_IF_ERROR(ComposeParts(num_parts));
+    // Erase the file from the file cache on every successful write.
+    file_cache_erase_();
+    return OkStatus();
+  }
+
+  bool parallel_upload_enabled() const {
+    return parallel_upload_part_size_ > 0 && !compose_append_;
+  }
+
+  /// Schedules the upload of the full parts of the file not scheduled yet.
+  Status ScheduleFullParts() {
+    uint64 file_size;
+    TF_RETURN_IF_ERROR(GetCurrentFileSize(&file_size));
+    const uint64 part_size = parallel_upload_part_size_;
+    while ((parts_.size() + 1) * part_size <= file_size) {
+      TF_RETURN_IF_ERROR(SchedulePart(parts_.size() * part_size, part_size));
+    }
+    return OkStatus();
+  }
+
+  /// \brief Schedules the upload of the `size` bytes of the file at `offset` as
+  /// its next part.
+  ///
+  /// The part is first copied to its own temporary file, since the internal
+  /// temporary file keeps growing while the part is uploaded.
+  Status SchedulePart(uint64 offset, uint64 size) {
+    outfile_.flush();
+    if (!outfile_.good()) {
+      return errors::Internal(
+          "Could not write to the internal temporary file.");
+    }
+    auto part = std::make_unique<Part>();
+    TF_RETURN_IF_ERROR(GetTmpFilename(&part->tmp_content_filename));
+    TF_RETURN_IF_ERROR(
+        CopyToPartFile(offset, size, part->tmp_content_filename));
+    if (part_upload_threads_ == nullptr) {
+      part_upload_threads_ = std::make_unique<thread::ThreadPool>(
+          Env::Default(), "gcs_part_upload", parallel_upload_threads_);
+    }
+    Part* const scheduled_part = part.get();
+    const string part_object = GetPartObject(parts_.size());
+    parts_.push_back(std::move(part));
+    part_upload_threads_->Schedule([this, scheduled_part, part_object, size]() {
+      const Status status = UploadPart(
+          part_object, scheduled_part->tmp_content_filename, size);
+      mutex_lock l(parts_mu_);
+      scheduled_part->status = status;
+      scheduled_part->done = true;
+      parts_cv_.notify_all();
+    });
+    return OkStatus();
+  }
+
+  Status CopyToPartFile(uint64 offset, uint64 size, const string& filename) {
+    std::ifstream in(tmp_content_filename_, std::ifstream::binary);
+    std::ofstream out(filename, std::ofstream::binary);
+    in.seekg(offset);
+    std::vector<char> buffer(std::min<uint64>(size, kPartCopyBufferSize));
+    while (size > 0 && in.good() && out.good()) {
+      const uint64 n = std::min<uint64>(size, buffer.size());
+      in.read(buffer.data(), n);
+      out.write(buffer.data(), n);
+      size -= n;
+    }
+    out.flush();
+    if (!in.good() || !out.good()) {
+      return errors::Internal(
+          "Could not copy a part of the internal temporary file.");
+    }
+    return OkStatus();
+  }
+
+  /// Uploads the `size` bytes of `filename` to the temporary object
+  /// `part_object`, resuming failed uploads.
+  Status UploadPart(const string& part_object, const string& filename,
+                    uint64 size) {
+    const string part_path = GetGcsPathWithObject(part_object);
+    UploadSessionHandle session_handle;
+    TF_RETURN_IF_ERROR(RetryingUtils::CallWithRetries(
+        [&]() {
+          return session_creator_(/*start_offset=*/0, part_object, bucket_,
+                                  size, part_path, &session_handle);
+        },
+        retry_config_));
+    uint64 already_uploaded = 0;
+    bool first_attempt = true;
+    return RetryingUtils::CallWithRetries(
+        [&]() {
+          if (session_handle.resumable && !first_attempt) {
+            bool completed;
+            TF_RETURN_IF_ERROR(status_poller_(session_handle.session_uri, size,
+                                              part_path, &completed,
+                                              &already_uploaded));
+            if (completed) {
+              return OkStatus();
+            }
+          }
+          first_attempt = false;
+          return object_uploader_(session_handle.session_uri,
+                                  /*start_offset=*/0, already_uploaded,
+                                  filename, size, part_path);
+        },
+        retry_config_);
+  }
+
+  /// \brief Waits for the scheduled parts and forgets them. Returns the first
+  /// error of their uploads.
+  Status ClearParts() {
+    Status status;
+    {
+      mutex_lock l(parts_mu_);
+      for (const auto& part : parts_) {
+        while (!part->done) {
+          parts_cv_.wait(l);
+        }
+        status.Update(part->status);
+      }
+    }
+    for (const auto& part : parts_) {
+      std::remove(part->tmp_content_filename.c_str());
+    }
+    parts_.clear();
+    return status;
+  }
+
+  /// \brief Composes the first `num_parts` uploaded parts into the object and
+  /// deletes them.
+  ///
+  /// A compose request takes at most kMaxComposeSources objects, so more parts
+  /// are appended to the object in several requests.
+  Status ComposeParts(int num_parts) {
+    VLOG(3) << "ComposeParts: " << num_parts << " parts to " << GetGcsPath();
+    for (int part = 0; part < num_parts;) {
+      std::vector<string> sources;
+      if (part > 0) {
+        sources.push_back(object_);
+      }
+      while (sources.size() < static_cast<size_t>(kMaxComposeSources) &&
+             part < num_parts) {
+        sources.push_back(GetPartObject(part++));
+      }
+      TF_RETURN_IF_ERROR(RetryingUtils::CallWithRetries(
+          [&sources, this]() {
+            std::unique_ptr<HttpRequest> request;
+            TF_RETURN_IF_ERROR(filesystem_->CreateHttpRequest(&request));
+
+            request->SetUri(strings::StrCat(kGcsUriBase, "b/", bucket_, "/o/",
+                                            request->EscapeString(object_),
+                                            "/compose"));
+
+            string request_body = "{'sourceObjects': [";
+            for (size_t i = 0; i < sources.size(); ++i) {
+              strings::StrAppend(&request_body, i > 0 ? "," : "",
+                                 "{'name': '", sources[i], "'}");
+            }
+            strings::StrAppend(&request_body, "]}");
+            request->SetTimeouts(timeouts_->connect, timeouts_->idle,
+                                 timeouts_->metadata);
+            request->AddHeader("content-type", "application/json");
+            request->SetPostFromBuffer(request_body.c_str(),
+                                       request_body.size());
+            TF_RETURN_WITH_CONTEXT_IF_ERROR(
+                request->Send(), " when composing to ", GetGcsPath());
+            return OkStatus();
+          },
+          retry_config_));
+    }
+
+    for (int part = 0; part < num_parts; ++part) {
+      const string part_path = GetGcsPathWithObject(GetPartObject(part));
+      const Status status = RetryingUtils::DeleteWithRetries(
+          [&part_path, this]() {
+            return filesystem_->DeleteFile(part_path, nullptr);
+          },
+          retry_config_);
+      // The object is complete, so don't fail the upload for a stranded
+      // temporary object.
+      if (!status.ok()) {
+        LOG(WARNING) << "Could not delete " << part_path << ": " << status;
+      }
+    }
+    return OkStatus();
+  }
+
+  string GetPartObject(int part) const {
+    return strings::StrCat(io::Dirname(object_), "/.tmpcompose/",
+                           io::Basename(object_), ".part", part);
+  }
+
   Status CheckWritable() const {
     if (!outfile_.is_open()) {
       return errors::FailedPrecondition(
@@ -772,12 +1010,27 @@ class GcsWritableFile : public WritableFile {
   bool sync_needed_;  // whether there is buffered data that needs to be synced
   RetryConfig retry_config_ = GetGcsRetryConfig();
   bool compose_append_;
+  const uint64 parallel_upload_part_size_;
+  const int parallel_upload_threads_;
   uint64 start_offset_;
   // Callbacks to the file system used to upload object into GCS.
   const SessionCreator session_creator_;
   const ObjectUploader object_uploader_;
   const StatusPoller status_poller_;
   const GenerationGetter generation_getter_;
+
+  // A part of a parallel composite upload.
+  struct Part {
+    string tmp_content_filename;
+    // The result of the upload, set once it's done. Guarded by parts_mu_.
+    Status status;
+    bool done = false;
+  };
+  // The parts scheduled for upload since the last sync, in order.
+  std::vector<std::unique_ptr<Part>> parts_;
+  mutex parts_mu_;
+  condition_variable parts_cv_;
+  std::unique_ptr<thread::ThreadPool> part_upload_threads_;
 };
 
 class GcsReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
@@ -846,12 +1099,17 @@ GcsFileSystem::GcsFileSystem(bool make_default_cache) {
   if (GetEnvVar(kMaxStaleness, strings::safe_strtou64, &value)) {
     max_staleness = value;
   }
+
+  if (GetEnvVar(kReadAheadBlocks, strings::safe_strtou64, &value)) {
+    read_ahead_blocks_ = value;
+  }
   if (!make_default_cache) {
     max_bytes = 0;
   }
   VLOG(1) << "GCS cache max size = " << max_bytes << " ; "
           << "block size = " << block_size_ << " ; "
-          << "max staleness = " << max_staleness;
+          << "max staleness = " << max_staleness << " ; "
+          << "read-ahead blocks = " << read_ahead_blocks_;
   file_block_cache_ = MakeFileBlockCache(block_size_, max_bytes, max_staleness);
   // Apply overrides for the stat cache max age and max entries, if provided.
   uint64 stat_cache_max_age = kStatCacheDefaultMaxAge;
@@ -973,6 +1231,14 @@ GcsFileSystem::GcsFileSystem(bool make_default_cache) {
     compose_append_ = false;
   }
 
+  if (GetEnvVar(kParallelUploadPartSize, strings::safe_strtou64, &value)) {
+    parallel_upload_part_size_ = value * 1024 * 1024;
+  }
+  int32_t threads;
+  if (GetEnvVar(kParallelUploadThreads, strings::safe_strto32, &threads)) {
+    parallel_upload_threads_ = std::max(threads, 1);
+  }
+
   retry_config_ = GetGcsRetryConfig();
 }
 
@@ -985,7 +1251,8 @@ GcsFileSystem::GcsFileSystem(
     size_t matching_paths_cache_max_entries, RetryConfig retry_config,
     TimeoutConfig timeouts, const std::unordered_set<string>& allowed_locations,
     std::pair<const string, const string>* additional_header,
-    bool compose_append)
+    bool compose_append, uint64 parallel_upload_part_size,
+    int parallel_upload_threads)
     : timeouts_(timeouts),
       retry_config_(retry_config),
       auth_provider_(std::move(auth_provider)),
@@ -1001,6 +1268,8 @@ GcsFileSystem::GcsFileSystem(
           kCacheNeverExpire, kBucketLocationCacheMaxEntries)),
       allowed_locations_(allowed_locations),
       compose_append_(compose_append),
+      parallel_upload_part_size_(parallel_upload_part_size),
+      parallel_upload_threads_(std::max(parallel_upload_threads, 1)),
       additional_header_(additional_header) {}
 
 Status GcsFileSystem::NewRandomAccessFile(
@@ -1081,7 +1350,8 @@ std::unique_ptr<FileBlockCache> GcsFileSystem::MakeFileBlockCache(
              size_t* bytes_transferred) {
         return LoadBufferFromGCS(filename, offset, n, buffer,
                                  bytes_transferred);
-      }));
+      },
+      Env::Default(), read_ahead_blocks_));
 
   // Check if cache is enabled here to avoid unnecessary mutex contention.
   cache_enabled_ = file_block_cache->IsCacheEnabled();
@@ -1347,8 +1617,8 @@ Status GcsFileSystem::NewWritableFile(const string& fname,
   result->reset(new GcsWritableFile(
       bucket, object, this, &timeouts_,
       [this, fname]() { ClearFileCaches(fname); }, retry_config_,
-      compose_append_, session_creator, object_uploader, status_poller,
-      generation_getter));
+      compose_append_, parallel_upload_part_size_, parallel_upload_threads_,
+      session_creator, object_uploader, status_poller, generation_getter));
   return OkStatus();
 }
 
@@ -1427,8 +1697,8 @@ Status GcsFileSystem::NewAppendableFile(const string& fname,
   result->reset(new GcsWritableFile(
       bucket, object, this, old_content_filename, &timeouts_,
       [this, fname]() { ClearFileCaches(fname); }, retry_config_,
-      compose_append_, session_creator, object_uploader, status_poller,
-      generation_getter));
+      compose_append_, parallel_upload_part_size_, parallel_upload_threads_,
+      session_creator, object_uploader, status_poller, generation_getter));
   return OkStatus();
 }
 
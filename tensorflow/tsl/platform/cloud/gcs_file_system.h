@@ -62,6 +62,19 @@ constexpr size_t kDefaultMaxCacheSize = 0;
 // will be evicted on the next read.
 constexpr char kMaxStaleness[] = "GCS_READ_CACHE_MAX_STALENESS";
 constexpr uint64 kDefaultMaxStaleness = 0;
+// The environment variable that sets the number of blocks fetched concurrently
+// ahead of sequential reads, when the block cache is enabled. Defaults to 0,
+// i.e. no read-ahead.
+constexpr char kReadAheadBlocks[] = "GCS_READ_AHEAD_BLOCKS";
+// The environment variable that enables parallel composite uploads of the
+// written files larger than a part, and sets the size of the parts. Specified
+// in MB. Defaults to 0, i.e. the files are uploaded in a single stream. Ignored
+// in the compose append mode.
+constexpr char kParallelUploadPartSize[] = "GCS_PARALLEL_UPLOAD_PART_SIZE_MB";
+// The environment variable that overrides the number of parts of a file
+// uploaded concurrently.
+constexpr char kParallelUploadThreads[] = "GCS_PARALLEL_UPLOAD_THREADS";
+constexpr int kDefaultParallelUploadThreads = 8;
 
 // Helper function to extract an environment variable and convert it into a
 // value of type T.
@@ -140,7 +153,8 @@ class GcsFileSystem : public FileSystem {
                 RetryConfig retry_config, TimeoutConfig timeouts,
                 const std::unordered_set<string>& allowed_locations,
                 std::pair<const string, const string>* additional_header,
-                bool compose_append);
+                bool compose_append, uint64 parallel_upload_part_size = 0,
+                int parallel_upload_threads = kDefaultParallelUploadThreads);
 
   TF_USE_FILESYSTEM_METHODS_WITH_NO_TRANSACTION_SUPPORT;
 
@@ -215,6 +229,10 @@ class GcsFileSystem : public FileSystem {
   }
 
   bool compose_append() const { return compose_append_; }
+  uint64 parallel_upload_part_size() const {
+    return parallel_upload_part_size_;
+  }
+  int parallel_upload_threads() const { return parallel_upload_threads_; }
   string additional_header_name() const {
     return additional_header_ ? additional_header_->first : "";
   }
@@ -415,6 +433,9 @@ class GcsFileSystem : public FileSystem {
   // Reads smaller than block_size_ will trigger a read of block_size_.
   uint64 block_size_;
 
+  // The number of blocks the block cache reads ahead of sequential reads.
+  size_t read_ahead_blocks_ = 0;
+
   // block_cache_lock_ protects the file_block_cache_ pointer (Note that
   // FileBlockCache instances are themselves threadsafe).
   mutex block_cache_lock_;
@@ -436,6 +457,11 @@ class GcsFileSystem : public FileSystem {
   std::unordered_set<string> allowed_locations_;
   bool compose_append_;
 
+  // The size of the parts of parallel composite uploads, or 0 if disabled, and
+  // the number of parts of a file uploaded concurrently.
+  uint64 parallel_upload_part_size_ = 0;
+  int parallel_upload_threads_ = kDefaultParallelUploadThreads;
+
   GcsStatsInterface* stats_ = nullptr;  // Not owned.
 
   // Additional header material to be transmitted with all GCS requests
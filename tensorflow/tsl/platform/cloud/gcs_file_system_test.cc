@@ -1314,6 +1314,108 @@ TEST(GcsFileSystemTest, NewWritableFile_UploadReturns410) {
   EXPECT_EQ(tmp_files_before, results.size());
 }
 
+TEST(GcsFileSystemTest, NewWritableFile_ParallelCompositeUpload) {
+  // With a single upload thread, the parts are uploaded in order.
+  std::vector<HttpRequest*> requests(
+      {new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+           "uploadType=resumable&name=path%2F.tmpcompose%2Fwriteable.txt."
+           "part0\n"
+           "Auth Token: fake_token\n"
+           "Header X-Upload-Content-Length: 8\n"
+           "Post: yes\n"
+           "Timeouts: 5 1 10\n",
+           "", {{"Location", "https://custom/upload/part0"}}),
+       new FakeHttpRequest("Uri: https://custom/upload/part0\n"
+                           "Auth Token: fake_token\n"
+                           "Header Content-Range: bytes 0-7/8\n"
+                           "Timeouts: 5 1 30\n"
+                           "Put body: content1\n",
+                           ""),
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+           "uploadType=resumable&name=path%2F.tmpcompose%2Fwriteable.txt."
+           "part1\n"
+           "Auth Token: fake_token\n"
+           "Header X-Upload-Content-Length: 8\n"
+           "Post: yes\n"
+           "Timeouts: 5 1 10\n",
+           "", {{"Location", "https://custom/upload/part1"}}),
+       new FakeHttpRequest("Uri: https://custom/upload/part1\n"
+                           "Auth Token: fake_token\n"
+                           "Header Content-Range: bytes 0-7/8\n"
+                           "Timeouts: 5 1 30\n"
+                           "Put body: ,content\n",
+                           ""),
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+           "uploadType=resumable&name=path%2F.tmpcompose%2Fwriteable.txt."
+           "part2\n"
+           "Auth Token: fake_token\n"
+           "Header X-Upload-Content-Length: 1\n"
+           "Post: yes\n"
+           "Timeouts: 5 1 10\n",
+           "", {{"Location", "https://custom/upload/part2"}}),
+       new FakeHttpRequest("Uri: https://custom/upload/part2\n"
+                           "Auth Token: fake_token\n"
+                           "Header Content-Range: bytes 0-0/1\n"
+                           "Timeouts: 5 1 30\n"
+                           "Put body: 2\n",
+                           ""),
+       // Compose the parts into the object.
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+           "path%2Fwriteable.txt/compose\n"
+           "Auth Token: fake_token\n"
+           "Timeouts: 5 1 10\n"
+           "Header content-type: application/json\n"
+           "Post body: {'sourceObjects': ["
+           "{'name': 'path/.tmpcompose/writeable.txt.part0'},"
+           "{'name': 'path/.tmpcompose/writeable.txt.part1'},"
+           "{'name': 'path/.tmpcompose/writeable.txt.part2'}]}\n",
+           ""),
+       // Delete the parts.
+       new FakeHttpRequest("Uri: https://www.googleapis.com/storage/v1/b/"
+                           "bucket/o/path%2F.tmpcompose%2Fwriteable.txt.part0\n"
+                           "Auth Token: fake_token\n"
+                           "Timeouts: 5 1 10\n"
+                           "Delete: yes\n",
+                           ""),
+       new FakeHttpRequest("Uri: https://www.googleapis.com/storage/v1/b/"
+                           "bucket/o/path%2F.tmpcompose%2Fwriteable.txt.part1\n"
+                           "Auth Token: fake_token\n"
+                           "Timeouts: 5 1 10\n"
+                           "Delete: yes\n",
+                           ""),
+       new FakeHttpRequest("Uri: https://www.googleapis.com/storage/v1/b/"
+                           "bucket/o/path%2F.tmpcompose%2Fwriteable.txt.part2\n"
+                           "Auth Token: fake_token\n"
+                           "Timeouts: 5 1 10\n"
+                           "Delete: yes\n",
+                           "")});
+  GcsFileSystem fs(
+      std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+      std::unique_ptr<HttpRequest::Factory>(
+          new FakeHttpRequestFactory(&requests)),
+      std::unique_ptr<ZoneProvider>(new FakeZoneProvider), 0 /* block size */,
+      0 /* max bytes */, 0 /* max staleness */, 0 /* stat cache max age */,
+      0 /* stat cache max entries */, 0 /* matching paths cache max age */,
+      0 /* matching paths cache max entries */, kTestRetryConfig,
+      kTestTimeoutConfig, *kAllowedLocationsDefault,
+      nullptr /* gcs additional header */, false /* compose append */,
+      8 /* parallel upload part size */, 1 /* parallel upload threads */);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(
+      fs.NewWritableFile("gs://bucket/path/writeable.txt", nullptr, &file));
+
+  // The full parts are uploaded as they are written, and the rest of the file
+  // when it's closed.
+  TF_EXPECT_OK(file->Append("content1,"));
+  TF_EXPECT_OK(file->Append("content2"));
+  TF_EXPECT_OK(file->Close());
+}
+
 TEST(GcsFileSystemTest, NewWritableFile_NoObjectName) {
   std::vector<HttpRequest*> requests;
   GcsFileSystem fs(
@@ -4082,5 +4184,15 @@ TEST(GcsFileSystemTest, AppendModeDefault) {
   EXPECT_EQ(false, fs1.compose_append());
 }
 
+TEST(GcsFileSystemTest, OverrideParallelUpload) {
+  setenv("GCS_PARALLEL_UPLOAD_PART_SIZE_MB", "16", 1);
+  setenv("GCS_PARALLEL_UPLOAD_THREADS", "4", 1);
+  GcsFileSystem fs1;
+  EXPECT_EQ(16 * 1024 * 1024, fs1.parallel_upload_part_size());
+  EXPECT_EQ(4, fs1.parallel_upload_threads());
+  unsetenv("GCS_PARALLEL_UPLOAD_PART_SIZE_MB");
+  unsetenv("GCS_PARALLEL_UPLOAD_THREADS");
+}
+
 }  // namespace
 }  // namespace tsl
@@ -17,6 +17,8 @@ limitations under the License.
 
 #include <cstring>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "absl/cleanup/cleanup.h"
 #include "tensorflow/tsl/platform/env.h"
@@ -41,13 +43,18 @@ std::shared_ptr<RamFileBlockCache::Block> RamFileBlockCache::Lookup(
       if (cache_stats_ != nullptr) {
         cache_stats_->RecordCacheHitBlockSize(entry->second->data.size());
       }
+      entry->second->read_ahead = false;
       return entry->second;
     } else {
       // Remove the stale block and continue.
       RemoveFile_Locked(key.first);
     }
   }
+  return Insert_Locked(key);
+}
 
+std::shared_ptr<RamFileBlockCache::Block> RamFileBlockCache::Insert_Locked(
+    const Key& key) {
   // Insert a new empty block, setting the bookkeeping to sentinel values
   // in order to update them as appropriate.
   auto new_entry = std::make_shared<Block>();
@@ -83,13 +90,15 @@ Status RamFileBlockCache::UpdateLRU(const Key& key,
 
   // Check for inconsistent state. If there is a block later in the same file
   // in the cache, and our current block is not block size, this likely means
-  // we have inconsistent state within the cache. Note: it's possible some
-  // incomplete reads may still go undetected.
+  // we have inconsistent state within the cache. The blocks fetched ahead of
+  // the reads may legitimately extend past the end of the file though. Note:
+  // it's possible some incomplete reads may still go undetected.
   if (block->data.size() < block_size_) {
-    Key fmax = std::make_pair(key.first, std::numeric_limits<size_t>::max());
-    auto fcmp = block_map_.upper_bound(fmax);
-    if (fcmp != block_map_.begin() && key < (--fcmp)->first) {
-      return errors::Internal("Block cache contents are inconsistent.");
+    for (auto it = block_map_.upper_bound(key);
+         it != block_map_.end() && it->first.first == key.first; ++it) {
+      if (!it->second->read_ahead) {
+        return errors::Internal("Block cache contents are inconsistent.");
+      }
     }
   }
 
@@ -185,6 +194,7 @@ Status RamFileBlockCache::Read(const string& filename, size_t offset, size_t n,
     finish += block_size_;
   }
   size_t total_bytes_transferred = 0;
+  bool reached_eof = false;
   // Now iterate through the blocks, reading them one at a time.
   for (size_t pos = start; pos < finish; pos += block_size_) {
     Key key = std::make_pair(filename, pos);
@@ -222,13 +232,55 @@ Status RamFileBlockCache::Read(const string& filename, size_t offset, size_t n,
     }
     if (data.size() < block_size_) {
       // The block was a partial block and thus signals EOF at its upper bound.
+      reached_eof = true;
       break;
     }
   }
   *bytes_transferred = total_bytes_transferred;
+  if (read_ahead_threads_ != nullptr && !reached_eof) {
+    MaybeReadAhead(filename, offset, offset + n, finish);
+  }
   return OkStatus();
 }
 
+void RamFileBlockCache::MaybeReadAhead(const string& filename, size_t offset,
+                                       size_t end, size_t block_end) {
+  std::vector<std::pair<Key, std::shared_ptr<Block>>> blocks;
+  {
+    mutex_lock lock(mu_);
+    // A file is read sequentially if each read starts within a block of the
+    // end of the previous one, the first read starting at the beginning.
+    size_t& previous_end = read_end_offsets_[filename];
+    const bool sequential = offset + block_size_ > previous_end &&
+                            offset < previous_end + block_size_;
+    previous_end = end;
+    if (!sequential) return;
+    for (size_t i = 0; i < max_read_ahead_blocks_; ++i) {
+      Key key = std::make_pair(filename, block_end + i * block_size_);
+      if (block_map_.find(key) != block_map_.end()) continue;
+      std::shared_ptr<Block> block = Insert_Locked(key);
+      block->read_ahead = true;
+      blocks.emplace_back(std::move(key), std::move(block));
+    }
+  }
+  for (auto& [key, block] : blocks) {
+    read_ahead_threads_->Schedule(
+        [this, key = std::move(key), block = std::move(block)]() {
+          // A failed read-ahead is retried by the read of the block.
+          if (!MaybeFetch(key, block).ok()) return;
+          mutex_lock lock(mu_);
+          if (block->data.empty()) {
+            // The block is past the end of the file.
+            auto entry = block_map_.find(key);
+            if (entry != block_map_.end() && entry->second == block) {
+              RemoveBlock(entry);
+            }
+          }
+          Trim();
+        });
+  }
+}
+
 bool RamFileBlockCache::ValidateAndUpdateFileSignature(const string& filename,
                                                        int64_t file_signature) {
   mutex_lock lock(mu_);
@@ -273,6 +325,7 @@ void RamFileBlockCache::Flush() {
   block_map_.clear();
   lru_list_.clear();
   lra_list_.clear();
+  read_end_offsets_.clear();
   cache_size_ = 0;
 }
 
@@ -282,6 +335,7 @@ void RamFileBlockCache::RemoveFile(const string& filename) {
 }
 
 void RamFileBlockCache::RemoveFile_Locked(const string& filename) {
+  read_end_offsets_.erase(filename);
   Key begin = std::make_pair(filename, 0);
   auto it = block_map_.lower_bound(begin);
   while (it != block_map_.end() && it->first.first == filename) {
@@ -30,6 +30,7 @@ limitations under the License.
 #include "tensorflow/tsl/platform/status.h"
 #include "tensorflow/tsl/platform/stringpiece.h"
 #include "tensorflow/tsl/platform/thread_annotations.h"
+#include "tensorflow/tsl/platform/threadpool.h"
 #include "tensorflow/tsl/platform/types.h"
 
 namespace tsl {
@@ -50,22 +51,35 @@ class RamFileBlockCache : public FileBlockCache {
                                size_t* bytes_transferred)>
       BlockFetcher;
 
+  /// When `max_read_ahead_blocks` is positive, reads that continue the
+  /// previous read of the same file also fetch up to that many of the
+  /// following blocks in the background, concurrently, so that sequential
+  /// reads of a file are not bound by the latency of a single fetch.
   RamFileBlockCache(size_t block_size, size_t max_bytes, uint64 max_staleness,
-                    BlockFetcher block_fetcher, Env* env = Env::Default())
+                    BlockFetcher block_fetcher, Env* env = Env::Default(),
+                    size_t max_read_ahead_blocks = 0)
       : block_size_(block_size),
         max_bytes_(max_bytes),
         max_staleness_(max_staleness),
         block_fetcher_(block_fetcher),
-        env_(env) {
+        env_(env),
+        max_read_ahead_blocks_(max_read_ahead_blocks) {
     if (max_staleness_ > 0) {
       pruning_thread_.reset(env_->StartThread(ThreadOptions(), "TF_prune_FBC",
                                               [this] { Prune(); }));
     }
+    if (IsCacheEnabled() && max_read_ahead_blocks_ > 0) {
+      read_ahead_threads_ = std::make_unique<thread::ThreadPool>(
+          env_, "TF_read_ahead_FBC", max_read_ahead_blocks_);
+    }
     VLOG(1) << "GCS file block cache is "
             << (IsCacheEnabled() ? "enabled" : "disabled");
   }
 
   ~RamFileBlockCache() override {
+    // Destroying read_ahead_threads_ will block until the ongoing read-aheads
+    // finish.
+    read_ahead_threads_.reset();
     if (pruning_thread_) {
       stop_pruning_thread_.Notify();
       // Destroying pruning_thread_ will block until Prune() receives the above
@@ -131,6 +145,8 @@ class RamFileBlockCache : public FileBlockCache {
   const BlockFetcher block_fetcher_;
   /// The Env from which we read timestamps.
   Env* const env_;  // not owned
+  /// The maximum number of blocks fetched ahead of a sequential read.
+  const size_t max_read_ahead_blocks_;
 
   /// \brief The key type for the file block cache.
   ///
@@ -175,6 +191,8 @@ class RamFileBlockCache : public FileBlockCache {
     std::list<Key>::iterator lra_iterator;
     /// The timestamp (seconds since epoch) at which the block was cached.
     uint64 timestamp;
+    /// Whether the block was fetched ahead of a read and no read used it yet.
+    bool read_ahead = false;
     /// Mutex to guard state variable
     mutex mu;
     /// The state of the block.
@@ -197,6 +215,17 @@ class RamFileBlockCache : public FileBlockCache {
   /// Look up a Key in the block cache.
   std::shared_ptr<Block> Lookup(const Key& key) TF_LOCKS_EXCLUDED(mu_);
 
+  /// Insert a new empty block for `key`, with mu_ already held.
+  std::shared_ptr<Block> Insert_Locked(const Key& key)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  /// If the read of `filename` from `offset` to `end` continues the previous
+  /// read of the file, fetches the blocks following `block_end`, the
+  /// block-aligned end of the read, that are not in the cache yet, in the
+  /// background.
+  void MaybeReadAhead(const string& filename, size_t offset, size_t end,
+                      size_t block_end) TF_LOCKS_EXCLUDED(mu_);
+
   Status MaybeFetch(const Key& key, const std::shared_ptr<Block>& block)
       TF_LOCKS_EXCLUDED(mu_);
 
@@ -243,6 +272,14 @@ class RamFileBlockCache : public FileBlockCache {
 
   // A filename->file_signature map.
   std::map<string, int64_t> file_signature_map_ TF_GUARDED_BY(mu_);
+
+  // The end offset of the previous read of each file, when read-ahead is
+  // enabled.
+  std::map<string, size_t> read_end_offsets_ TF_GUARDED_BY(mu_);
+
+  /// The threads fetching the blocks ahead of sequential reads. Also bounds
+  /// the number of concurrent read-ahead fetches.
+  std::unique_ptr<thread::ThreadPool> read_ahead_threads_;
 };
 
 }  // namespace tsl
@@ -15,12 +15,14 @@ limitations under the License.
 
 #include "tensorflow/tsl/platform/cloud/ram_file_block_cache.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "tensorflow/tsl/lib/core/status_test_util.h"
 #include "tensorflow/tsl/platform/blocking_counter.h"
 #include "tensorflow/tsl/platform/cloud/now_seconds_env.h"
 #include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/mutex.h"
 #include "tensorflow/tsl/platform/notification.h"
 #include "tensorflow/tsl/platform/test.h"
 
@@ -566,5 +568,70 @@ TEST(RamFileBlockCacheTest, Flush) {
   EXPECT_EQ(calls, 2);
 }
 
+TEST(RamFileBlockCacheTest, ReadAhead) {
+  // The file has two full blocks and a partial one.
+  const size_t block_size = 16;
+  const size_t file_size = 2 * block_size + 8;
+  mutex mu;
+  std::vector<size_t> fetched;
+  auto fetcher = [&mu, &fetched, file_size](
+                     const string& filename, size_t offset, size_t n,
+                     char* buffer, size_t* bytes_transferred) {
+    {
+      mutex_lock lock(mu);
+      fetched.push_back(offset);
+    }
+    const size_t bytes = offset < file_size ? std::min(n, file_size - offset)
+                                            : 0;
+    memset(buffer, 'a' + offset / block_size, bytes);
+    *bytes_transferred = bytes;
+    return OkStatus();
+  };
+  auto num_fetched = [&mu, &fetched]() {
+    mutex_lock lock(mu);
+    return fetched.size();
+  };
+  RamFileBlockCache cache(block_size, 8 * block_size, 0, fetcher,
+                          Env::Default(), /*max_read_ahead_blocks=*/2);
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache, "a", 0, block_size, &out));
+  EXPECT_EQ(out, std::vector<char>(block_size, 'a'));
+  // The two following blocks are fetched in the background.
+  for (int i = 0; i < 1000 && num_fetched() < 3; ++i) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  EXPECT_EQ(num_fetched(), 3);
+  TF_EXPECT_OK(ReadCache(&cache, "a", block_size, block_size, &out));
+  EXPECT_EQ(out, std::vector<char>(block_size, 'b'));
+  // Reading past the end of the file returns the partial block, even though
+  // the block after it may be read ahead concurrently.
+  TF_EXPECT_OK(ReadCache(&cache, "a", 2 * block_size, block_size, &out));
+  EXPECT_EQ(out, std::vector<char>(8, 'c'));
+  {
+    mutex_lock lock(mu);
+    EXPECT_EQ(fetched[0], 0);
+    EXPECT_EQ(fetched[1] + fetched[2], 3 * block_size);
+  }
+}
+
+TEST(RamFileBlockCacheTest, NoReadAheadForRandomReads) {
+  int calls = 0;
+  auto fetcher = [&calls](const string& filename, size_t offset, size_t n,
+                          char* buffer, size_t* bytes_transferred) {
+    calls++;
+    memset(buffer, 'x', n);
+    *bytes_transferred = n;
+    return OkStatus();
+  };
+  RamFileBlockCache cache(16, 1024, 0, fetcher, Env::Default(),
+                          /*max_read_ahead_blocks=*/2);
+  std::vector<char> out;
+  // The first read of a file doesn't start at its beginning, so it isn't
+  // sequential.
+  TF_EXPECT_OK(ReadCache(&cache, "a", 320, 16, &out));
+  TF_EXPECT_OK(ReadCache(&cache, "a", 64, 16, &out));
+  EXPECT_EQ(calls, 2);
+}
+
 }  // namespace
 }  // namespace tsl
@@ -37,6 +37,9 @@ limitations under the License.
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+
+#include <algorithm>
+#include <vector>
 #ifdef TF_USE_SNAPPY
 #include "snappy.h"
 #endif
@@ -162,6 +165,30 @@ int GetCurrentCPU() {
   return kUnknownCPU;
 }
 
+bool SetCurrentThreadCpuAffinity(const std::vector<int>& cpus) {
+#if defined(__linux__)
+  if (cpus.empty()) return false;
+  const int ncpus = *std::max_element(cpus.begin(), cpus.end()) + 1;
+  const size_t setsize = CPU_ALLOC_SIZE(ncpus);
+  cpu_set_t* mask = CPU_ALLOC(ncpus);
+  if (!mask) return false;
+  CPU_ZERO_S(setsize, mask);
+  for (int cpu : cpus) {
+    if (cpu < 0) {
+      CPU_FREE(mask);
+      return false;
+    }
+    CPU_SET_S(cpu, setsize, mask);
+  }
+  // On Linux, a pid of 0 denotes the calling thread.
+  const bool result = sched_setaffinity(0, setsize, mask) == 0;
+  CPU_FREE(mask);
+  return result;
+#else
+  return false;
+#endif
+}
+
 int NumHyperthreadsPerCore() {
   static const int ht_per_core = tsl::port::CPUIDNumSMT();
   return (ht_per_core > 0) ? ht_per_core : 1;
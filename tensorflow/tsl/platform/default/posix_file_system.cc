@@ -18,6 +18,8 @@ limitations under the License.
 #include <fcntl.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 
 #if defined(__linux__)
@@ -45,15 +47,27 @@ using ::tsl::errors::IOError;
 // 128KB of copy buffer
 constexpr size_t kPosixCopyFileBufferSize = 128 * 1024;
 
+// Returns true if random-access files should act on read-ahead hints. Enabled
+// by setting TF_POSIX_FILE_READAHEAD to "1" or "true".
+static bool ReadAheadEnabled() {
+  static const bool enabled = [] {
+    const char* value = getenv("TF_POSIX_FILE_READAHEAD");
+    return value != nullptr &&
+           (strcmp(value, "1") == 0 || strcmp(value, "true") == 0);
+  }();
+  return enabled;
+}
+
 // pread() based random-access
 class PosixRandomAccessFile : public RandomAccessFile {
  private:
   string filename_;
   int fd_;
+  bool read_ahead_;
 
  public:
-  PosixRandomAccessFile(const string& fname, int fd)
-      : filename_(fname), fd_(fd) {}
+  PosixRandomAccessFile(const string& fname, int fd, bool read_ahead)
+      : filename_(fname), fd_(fd), read_ahead_(read_ahead) {}
   ~PosixRandomAccessFile() override {
     if (close(fd_) < 0) {
       LOG(ERROR) << "close() failed: " << strerror(errno);
@@ -96,6 +110,21 @@ class PosixRandomAccessFile : public RandomAccessFile {
     return s;
   }
 
+  Status ReadAhead(uint64 offset, size_t n) const override {
+#if defined(POSIX_FADV_WILLNEED)
+    // Starts asynchronous readahead into the page cache, so the reading thread
+    // does not block on the device for the hinted range.
+    if (read_ahead_ && n > 0) {
+      int err = posix_fadvise(fd_, static_cast<off_t>(offset),
+                              static_cast<off_t>(n), POSIX_FADV_WILLNEED);
+      if (err != 0) {
+        return IOError(filename_, err);
+      }
+    }
+#endif
+    return OkStatus();
+  }
+
 #if defined(TF_CORD_SUPPORT)
   Status Read(uint64 offset, size_t n, absl::Cord* cord) const override {
     if (n == 0) {
@@ -230,7 +259,8 @@ Status PosixFileSystem::NewRandomAccessFile(
   if (fd < 0) {
     s = IOError(fname, errno);
   } else {
-    result->reset(new PosixRandomAccessFile(translated_fname, fd));
+    result->reset(
+        new PosixRandomAccessFile(translated_fname, fd, ReadAheadEnabled()));
   }
   return s;
 }
@@ -596,6 +596,8 @@ struct ThreadOptions {
   /// Guard area size to use near thread stacks to use (in bytes)
   size_t guard_size = 0;  // 0: use system default value
   int numa_node = port::kNUMANoAffinity;
+  /// CPUs to which the thread is pinned, if not empty.
+  std::vector<int> cpu_affinity;
 };
 
 /// A utility routine: copy contents of `src` in file system `src_fs`
@@ -765,6 +765,17 @@ class RandomAccessFile {
   virtual tsl::Status Read(uint64 offset, size_t n, StringPiece* result,
                            char* scratch) const = 0;
 
+  /// \brief Hints that `n` bytes starting at `offset` will be read soon.
+  ///
+  /// Implementations may start fetching the range in the background, so that
+  /// a later `Read` of the range does not block on the device. This is an
+  /// optional operation; the default implementation does nothing.
+  ///
+  /// Safe for concurrent use by multiple threads.
+  virtual tsl::Status ReadAhead(uint64 offset, size_t n) const {
+    return OkStatus();
+  }
+
 #if defined(TF_CORD_SUPPORT)
   /// \brief Read up to `n` bytes from the file starting at `offset`.
   virtual tsl::Status Read(uint64 offset, size_t n, absl::Cord* cord) const {
@@ -21,6 +21,7 @@ limitations under the License.
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/tsl/platform/blocking_counter.h"
 #include "tensorflow/tsl/platform/context.h"
+#include "tensorflow/tsl/platform/cpu_info.h"
 #include "tensorflow/tsl/platform/denormal.h"
 #include "tensorflow/tsl/platform/logging.h"
 #include "tensorflow/tsl/platform/mutex.h"
@@ -60,6 +61,11 @@ struct EigenEnvironment {
       if (thread_options_.numa_node != port::kNUMANoAffinity) {
         port::NUMASetThreadNodeAffinity(thread_options_.numa_node);
       }
+      if (!thread_options_.cpu_affinity.empty() &&
+          !port::SetCurrentThreadCpuAffinity(thread_options_.cpu_affinity)) {
+        LOG(WARNING) << "Could not pin a thread of pool " << name_
+                     << " to its CPUs.";
+      }
       f();
     });
   }
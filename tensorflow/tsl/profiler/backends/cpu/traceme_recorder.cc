@@ -36,6 +36,8 @@ namespace internal {
 
 std::atomic<int> g_trace_level(TraceMeRecorder::kTracingDisabled);
 
+std::atomic<uint32> g_trace_sampling_threshold(TraceMeRecorder::kSampleAll);
+
 // g_trace_level implementation must be lock-free for faster execution of the
 // TraceMe API. This can be commented (if compilation is failing) but execution
 // might be slow (even when tracing is disabled).
@@ -339,7 +341,7 @@ void TraceMeRecorder::Clear() {
 }
 
 // This method is performance critical and should be kept fast. It is called
-// when tracing stops. The mutex is held, so no threads can be
+// when tracing stops, or when events are collected. The mutex is held, so no threads can be
 // registered/unregistered. This ensures only the control thread calls
 // ThreadLocalRecorder::Consume().
 TraceMeRecorder::Events TraceMeRecorder::Consume() {
@@ -365,10 +367,23 @@ TraceMeRecorder::Events TraceMeRecorder::Consume() {
   return result;
 }
 
-bool TraceMeRecorder::StartRecording(int level) {
+bool TraceMeRecorder::StartRecording(int level,
+                                     double sampling_probability) {
   level = std::max(0, level);
+  const uint32 threshold =
+      sampling_probability >= 1.0
+          ? kSampleAll
+          : static_cast<uint32>(std::max(0.0, sampling_probability) *
+                                static_cast<double>(kSampleAll));
   mutex_lock lock(mutex_);
   // Change trace_level_ while holding mutex_.
+  if (internal::g_trace_level.load(std::memory_order_acquire) !=
+      kTracingDisabled) {
+    return false;
+  }
+  // The sampling threshold is set before the level, which publishes it.
+  internal::g_trace_sampling_threshold.store(threshold,
+                                             std::memory_order_relaxed);
   int expected = kTracingDisabled;
   bool started = internal::g_trace_level.compare_exchange_strong(
       expected, level, std::memory_order_acq_rel);
@@ -379,6 +394,16 @@ bool TraceMeRecorder::StartRecording(int level) {
   return started;
 }
 
+/*static*/ bool TraceMeRecorder::Sample(uint32 threshold) {
+  // A xorshift generator per thread, so that sampling takes no lock.
+  thread_local static uint32 state =
+      Env::Default()->GetCurrentThreadId() * 2654435761u | 1;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state < threshold;
+}
+
 void TraceMeRecorder::Record(Event&& event) {
   static thread_local ThreadLocalRecorderWrapper thread_local_recorder;
   thread_local_recorder.Record(std::move(event));
@@ -392,9 +417,17 @@ TraceMeRecorder::Events TraceMeRecorder::StopRecording() {
           kTracingDisabled, std::memory_order_acq_rel) != kTracingDisabled) {
     events = Consume();
   }
+  internal::g_trace_sampling_threshold.store(kSampleAll,
+                                             std::memory_order_relaxed);
   return events;
 }
 
+TraceMeRecorder::Events TraceMeRecorder::CollectRecording() {
+  mutex_lock lock(mutex_);
+  if (!Active(/*level=*/0)) return {};
+  return Consume();
+}
+
 /*static*/ int64_t TraceMeRecorder::NewActivityId() {
   // Activity IDs: To avoid contention over a counter, the top 32 bits identify
   // the originating thread, the bottom 32 bits name the event within a thread.
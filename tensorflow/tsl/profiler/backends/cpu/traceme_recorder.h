@@ -36,6 +36,11 @@ namespace internal {
 // Modified by TraceMeRecorder singleton when tracing starts/stops.
 TF_EXPORT extern std::atomic<int> g_trace_level;
 
+// Probability with which the TraceMe events are recorded while tracing, in
+// units of 2^-32, or TraceMeRecorder::kSampleAll.
+// Modified by TraceMeRecorder singleton when tracing starts/stops.
+TF_EXPORT extern std::atomic<uint32> g_trace_sampling_threshold;
+
 }  // namespace internal
 
 // TraceMeRecorder is a singleton repository of TraceMe events.
@@ -83,20 +88,39 @@ class TraceMeRecorder {
   // Starts recording of TraceMe().
   // Only traces <= level will be recorded.
   // Level must be >= 0. If level is 0, no traces will be recorded.
-  static bool Start(int level) { return Get()->StartRecording(level); }
+  // Each trace is recorded with probability sampling_probability, for
+  // continuous profiling at low overhead.
+  static bool Start(int level, double sampling_probability = 1.0) {
+    return Get()->StartRecording(level, sampling_probability);
+  }
 
-  // Stops recording and returns events recorded since Start().
+  // Stops recording and returns events recorded since Start() or Collect().
   // Events passed to Record after Stop has started will be dropped.
   static Events Stop() { return Get()->StopRecording(); }
 
+  // Returns events recorded since Start() or the previous Collect(), without
+  // stopping recording. Start and end events split across calls are dropped.
+  static Events Collect() { return Get()->CollectRecording(); }
+
   // Returns whether we're currently recording. Racy, but cheap!
   static inline bool Active(int level = 1) {
     return internal::g_trace_level.load(std::memory_order_acquire) >= level;
   }
 
+  // Returns whether to record a trace starting now, given the sampling
+  // probability of Start(). Cheap if all traces are recorded.
+  static inline bool Sampled() {
+    const uint32 threshold =
+        internal::g_trace_sampling_threshold.load(std::memory_order_relaxed);
+    return TF_PREDICT_TRUE(threshold == kSampleAll) || Sample(threshold);
+  }
+
   // Default value for trace_level_ when tracing is disabled
   static constexpr int kTracingDisabled = -1;
 
+  // Value of the sampling threshold when all traces are recorded.
+  static constexpr uint32 kSampleAll = ~uint32{0};
+
   // Records an event. Non-blocking.
   static void Record(Event&& event);
 
@@ -117,8 +141,12 @@ class TraceMeRecorder {
   void RegisterThread(uint32 tid, std::shared_ptr<ThreadLocalRecorder> thread);
   void UnregisterThread(uint32 tid);
 
-  bool StartRecording(int level);
+  bool StartRecording(int level, double sampling_probability);
   Events StopRecording();
+  Events CollectRecording();
+
+  // Returns true with probability threshold * 2^-32.
+  static bool Sample(uint32 threshold);
 
   // Clears events from all active threads that were added due to Record
   // racing with StopRecording.
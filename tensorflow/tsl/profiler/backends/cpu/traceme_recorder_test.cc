@@ -56,6 +56,43 @@ TEST(RecorderTest, SingleThreaded) {
               ElementsAre(Named("during1"), Named("during2")));
 }
 
+TEST(RecorderTest, Collect) {
+  int64_t start_time = GetCurrentTimeNanos();
+  int64_t end_time = start_time + UniToNano(1);
+
+  EXPECT_TRUE(TraceMeRecorder::Collect().empty());
+  TraceMeRecorder::Start(/*level=*/1);
+  TraceMeRecorder::Record({"during1", start_time, end_time});
+  auto results = TraceMeRecorder::Collect();
+  TraceMeRecorder::Record({"during2", start_time, end_time});
+  auto more_results = TraceMeRecorder::Stop();
+
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_THAT(results[0].events, ElementsAre(Named("during1")));
+  ASSERT_EQ(more_results.size(), 1);
+  EXPECT_THAT(more_results[0].events, ElementsAre(Named("during2")));
+}
+
+TEST(RecorderTest, Sampling) {
+  constexpr int kNumTraces = 100000;
+  auto count_sampled = []() {
+    int num_sampled = 0;
+    for (int i = 0; i < kNumTraces; ++i) {
+      if (TraceMeRecorder::Sampled()) ++num_sampled;
+    }
+    return num_sampled;
+  };
+
+  TraceMeRecorder::Start(/*level=*/1, /*sampling_probability=*/0.25);
+  const int num_sampled = count_sampled();
+  TraceMeRecorder::Stop();
+  EXPECT_GT(num_sampled, kNumTraces / 5);
+  EXPECT_LT(num_sampled, kNumTraces * 3 / 10);
+
+  // All traces are sampled again once stopped.
+  EXPECT_EQ(count_sampled(), kNumTraces);
+}
+
 // Checks the functional behavior of the recorder, when used from several
 // unsynchronized threads.
 //
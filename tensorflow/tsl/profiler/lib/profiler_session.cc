@@ -15,10 +15,13 @@ limitations under the License.
 
 #include "tensorflow/tsl/profiler/lib/profiler_session.h"
 
+#include <algorithm>
+#include <map>
 #include <memory>
 #include <utility>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/logging.h"
 #include "tensorflow/tsl/platform/mutex.h"
@@ -29,7 +32,9 @@ limitations under the License.
 #include "tensorflow/tsl/profiler/protobuf/xplane.pb.h"
 
 #if !defined(IS_MOBILE_PLATFORM)
+#include "tensorflow/tsl/lib/histogram/histogram.h"
 #include "tensorflow/tsl/platform/host_info.h"
+#include "tensorflow/tsl/profiler/backends/cpu/traceme_recorder.h"
 #include "tensorflow/tsl/profiler/convert/post_process_single_host_xplane.h"
 #include "tensorflow/tsl/profiler/lib/profiler_collection.h"
 #include "tensorflow/tsl/profiler/lib/profiler_factory.h"
@@ -51,6 +56,29 @@ ProfileOptions GetOptions(const ProfileOptions& opts) {
   return options;
 }
 
+#if !defined(IS_MOBILE_PLATFORM)
+// Aggregates the latencies of the complete events by name, without the
+// metadata encoded by TraceMeEncode.
+ProfilerSession::LatencyHistograms AggregateLatencies(
+    const profiler::TraceMeRecorder::Events& events) {
+  std::map<absl::string_view, histogram::Histogram> histograms;
+  for (const auto& thread : events) {
+    for (const auto& event : thread.events) {
+      if (!event.IsComplete()) continue;
+      absl::string_view name = event.name;
+      histograms[name.substr(0, name.find('#'))].Add(event.end_time -
+                                                     event.start_time);
+    }
+  }
+  ProfilerSession::LatencyHistograms latencies;
+  for (const auto& [name, histogram] : histograms) {
+    histogram.EncodeToProto(&latencies[name],
+                            /*preserve_zero_buckets=*/false);
+  }
+  return latencies;
+}
+#endif
+
 };  // namespace
 
 /*static*/ std::unique_ptr<ProfilerSession> ProfilerSession::Create(
@@ -58,6 +86,13 @@ ProfileOptions GetOptions(const ProfileOptions& opts) {
   return absl::WrapUnique(new ProfilerSession(options));
 }
 
+/*static*/ std::unique_ptr<ProfilerSession> ProfilerSession::CreateContinuous(
+    const ProfileOptions& options, double sampling_probability,
+    int64_t export_interval_ms, LatencyExporter exporter) {
+  return absl::WrapUnique(new ProfilerSession(
+      options, sampling_probability, export_interval_ms, std::move(exporter)));
+}
+
 Status ProfilerSession::Status() {
   mutex_lock l(mutex_);
   return status_;
@@ -68,6 +103,9 @@ Status ProfilerSession::CollectDataInternal(XSpace* space) {
   mutex_lock l(mutex_);
   TF_RETURN_IF_ERROR(status_);
   LOG(INFO) << "Profiler session collecting data.";
+  if (export_thread_ != nullptr) {
+    StopContinuousProfiling();
+  }
   if (profilers_ != nullptr) {
     profilers_->Stop().IgnoreError();
     profilers_->CollectData(space).IgnoreError();
@@ -77,6 +115,26 @@ Status ProfilerSession::CollectDataInternal(XSpace* space) {
   profiler_lock_.ReleaseIfActive();
   return OkStatus();
 }
+
+void ProfilerSession::ExportLatenciesPeriodically() {
+  mutex_lock l(export_mutex_);
+  while (!stop_export_) {
+    WaitForMilliseconds(&l, &export_cv_, export_interval_ms_);
+    if (stop_export_) break;
+    latency_exporter_(
+        AggregateLatencies(profiler::TraceMeRecorder::Collect()));
+  }
+}
+
+void ProfilerSession::StopContinuousProfiling() {
+  {
+    mutex_lock l(export_mutex_);
+    stop_export_ = true;
+  }
+  export_cv_.notify_all();
+  export_thread_.reset();  // Joins the thread.
+  latency_exporter_(AggregateLatencies(profiler::TraceMeRecorder::Stop()));
+}
 #endif
 
 Status ProfilerSession::CollectData(XSpace* space) {
@@ -126,9 +184,48 @@ ProfilerSession::ProfilerSession(const ProfileOptions& options)
 #endif
 }
 
+ProfilerSession::ProfilerSession(const ProfileOptions& options,
+                                 double sampling_probability,
+                                 int64_t export_interval_ms,
+                                 LatencyExporter exporter)
+#if defined(IS_MOBILE_PLATFORM)
+    : status_(errors::Unimplemented(
+          "Profiler is unimplemented for mobile platforms.")) {
+#else
+    : options_(GetOptions(options)),
+      latency_exporter_(std::move(exporter)),
+      export_interval_ms_(std::max<int64_t>(export_interval_ms, 1)) {
+  auto profiler_lock = profiler::ProfilerLock::Acquire();
+  if (!profiler_lock.ok()) {
+    status_ = profiler_lock.status();
+    return;
+  }
+  profiler_lock_ = *std::move(profiler_lock);
+
+  // Only TraceMe events are recorded, since the other profilers can't be
+  // sampled.
+  if (!profiler::TraceMeRecorder::Start(options_.host_tracer_level(),
+                                        sampling_probability)) {
+    status_ = errors::Internal("Failed to start TraceMeRecorder");
+    profiler_lock_.ReleaseIfActive();
+    return;
+  }
+  LOG(INFO) << "Continuous profiler session started, sampling "
+            << sampling_probability << " of the events.";
+  start_time_ns_ = profiler::GetCurrentTimeNanos();
+  mutex_lock l(mutex_);
+  export_thread_.reset(Env::Default()->StartThread(
+      {}, "continuous_profiler", [this]() { ExportLatenciesPeriodically(); }));
+#endif
+}
+
 ProfilerSession::~ProfilerSession() {
 #if !defined(IS_MOBILE_PLATFORM)
   LOG(INFO) << "Profiler session tear down.";
+  mutex_lock l(mutex_);
+  if (export_thread_ != nullptr) {
+    StopContinuousProfiling();
+  }
 #endif
 }
 
@@ -17,8 +17,11 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/tsl/platform/env.h"
 #include "tensorflow/tsl/platform/mutex.h"
 #include "tensorflow/tsl/platform/platform.h"
 #include "tensorflow/tsl/platform/status.h"
@@ -26,6 +29,7 @@ limitations under the License.
 #include "tensorflow/tsl/platform/types.h"
 #include "tensorflow/tsl/profiler/protobuf/profiler_options.pb.h"
 #include "tensorflow/tsl/profiler/protobuf/xplane.pb.h"
+#include "tensorflow/tsl/protobuf/histogram.pb.h"
 
 #if !defined(IS_MOBILE_PLATFORM)
 #include "tensorflow/tsl/profiler/lib/profiler_interface.h"
@@ -45,6 +49,22 @@ class ProfilerSession {
   static std::unique_ptr<ProfilerSession> Create(
     const tensorflow::ProfileOptions& options);
 
+  // Latencies of TraceMe events in nanoseconds, by name without metadata.
+  using LatencyHistograms =
+      absl::flat_hash_map<std::string, tensorflow::HistogramProto>;
+  using LatencyExporter = std::function<void(const LatencyHistograms&)>;
+
+  // Creates a ProfilerSession which profiles continuously, at low overhead,
+  // until it is destroyed or CollectData is called. Only the TraceMe events up
+  // to options.host_tracer_level are recorded, each with probability
+  // `sampling_probability`. Every `export_interval_ms`, the events recorded
+  // since the previous export are aggregated into latency histograms, which
+  // are passed to `exporter` on a background thread. CollectData exports the
+  // last histograms and collects no other data.
+  static std::unique_ptr<ProfilerSession> CreateContinuous(
+      const tensorflow::ProfileOptions& options, double sampling_probability,
+      int64_t export_interval_ms, LatencyExporter exporter);
+
   static tensorflow::ProfileOptions DefaultOptions() {
     tensorflow::ProfileOptions options;
     options.set_version(1);
@@ -70,6 +90,11 @@ class ProfilerSession {
   // Constructs an instance of the class and starts profiling
   explicit ProfilerSession(const tensorflow::ProfileOptions& options);
 
+  // Constructs an instance of the class and starts continuous profiling.
+  ProfilerSession(const tensorflow::ProfileOptions& options,
+                  double sampling_probability, int64_t export_interval_ms,
+                  LatencyExporter exporter);
+
   // ProfilerSession is neither copyable or movable.
   ProfilerSession(const ProfilerSession&) = delete;
   ProfilerSession& operator=(const ProfilerSession&) = delete;
@@ -78,12 +103,26 @@ class ProfilerSession {
   // Collects profile data into XSpace without post-processsing.
   tsl::Status CollectDataInternal(tensorflow::profiler::XSpace* space);
 
+  // Exports the latencies of continuous profiling every export_interval_ms_.
+  void ExportLatenciesPeriodically() TF_LOCKS_EXCLUDED(export_mutex_);
+
+  // Stops continuous profiling and exports the last latencies.
+  void StopContinuousProfiling() TF_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   profiler::ProfilerLock profiler_lock_ TF_GUARDED_BY(mutex_);
 
   std::unique_ptr<profiler::ProfilerInterface> profilers_ TF_GUARDED_BY(mutex_);
 
   uint64 start_time_ns_;
   tensorflow::ProfileOptions options_;
+
+  // Set in continuous profiling sessions.
+  LatencyExporter latency_exporter_;
+  int64_t export_interval_ms_ = 0;
+  std::unique_ptr<Thread> export_thread_ TF_GUARDED_BY(mutex_);
+  mutex export_mutex_;
+  condition_variable export_cv_;
+  bool stop_export_ TF_GUARDED_BY(export_mutex_) = false;
 #endif
   tsl::Status status_ TF_GUARDED_BY(mutex_);
   mutex mutex_;